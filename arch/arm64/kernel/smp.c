@@ -36,6 +36,7 @@
 #include <linux/completion.h>
 #include <linux/of.h>
 #include <linux/irq_work.h>
+#include <linux/cpuidle.h>
 
 #include <asm/alternative.h>
 #include <asm/atomic.h>
@@ -688,6 +689,7 @@ void handle_IPI(int ipinr, struct pt_regs *regs)
 	if ((unsigned)ipinr < NR_IPI) {
 		trace_ipi_entry(ipi_types[ipinr]);
 		__inc_irq_stat(cpu, ipi_irqs[ipinr]);
+		cpuidle_note_wakeup_ipi(ipinr, ipi_types[ipinr]);
 	}
 
 	switch (ipinr) {
@@ -0,0 +1,463 @@
+/*
+ * Compression algorithm benchmark
+ *
+ * Compresses and decompresses a corpus with every requested algorithm
+ * and block size, from a number of threads in parallel, and reports
+ * throughput, compression ratio and per block latency percentiles.
+ *
+ * The corpus is either loaded through the firmware loader (e.g. raw
+ * page dumps taken from a device: corpus=zram_pages.bin) or generated.
+ * Like tcrypt, all the work is done at module load time and loading
+ * always "fails" so the module can simply be inserted again.
+ *
+ *   insmod comp_bench.ko algs=lz4,lzo block_sizes=4096,65536 threads=4
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ */
+
+#define pr_fmt(fmt) "comp_bench: " fmt
+
+#include <linux/crypto.h>
+#include <linux/err.h>
+#include <linux/firmware.h>
+#include <linux/kthread.h>
+#include <linux/completion.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+#include "comp_fill.h"
+
+#define BENCH_MAX_ALGS		8
+#define BENCH_MAX_BSIZES	8
+#define BENCH_MAX_THREADS	16
+/* latency samples kept per thread and phase for the percentiles */
+#define BENCH_MAX_SAMPLES	65536
+/* generated corpus size and maximum size of a loaded one */
+#define BENCH_GEN_CORPUS	(4 << 20)
+#define BENCH_MAX_CORPUS	(64 << 20)
+
+static char *algs[BENCH_MAX_ALGS] = { "lzo", "lz4", "lz4hc", "deflate" };
+static int nr_algs = 4;
+module_param_array(algs, charp, &nr_algs, 0);
+MODULE_PARM_DESC(algs, "compression algorithms to test");
+
+static unsigned int block_sizes[BENCH_MAX_BSIZES] = { 4096, 16384, 65536 };
+static int nr_block_sizes = 3;
+module_param_array(block_sizes, uint, &nr_block_sizes, 0);
+MODULE_PARM_DESC(block_sizes, "block sizes in bytes");
+
+static unsigned int threads = 1;
+module_param(threads, uint, 0);
+MODULE_PARM_DESC(threads, "number of threads compressing in parallel");
+
+static unsigned int passes = 4;
+module_param(passes, uint, 0);
+MODULE_PARM_DESC(passes, "passes over the corpus per thread and phase");
+
+static char *corpus;
+module_param(corpus, charp, 0);
+MODULE_PARM_DESC(corpus, "firmware file used as corpus (default generated)");
+
+struct bench_block {
+	unsigned int clen;
+	u8 *cdata;
+};
+
+struct bench_ctx {
+	const char *alg;
+	unsigned int bsize;
+	unsigned int nr_blocks;
+	const u8 *data;
+	struct bench_block *blocks;
+	atomic_t nr_ready;
+	struct completion start;
+};
+
+struct bench_thread {
+	struct bench_ctx *ctx;
+	struct task_struct *task;
+	struct crypto_comp *tfm;
+	struct completion done;
+	bool decompress;
+	int err;
+	u64 bytes;
+	u64 time_ns;
+	unsigned int nr_samples;
+	u32 *samples;
+	u8 *buf;
+};
+
+static struct bench_thread bench_threads[BENCH_MAX_THREADS];
+
+/*
+ * tcrypt's data plus zero runs: a 512 byte run at the start of about half
+ * of the 2KB chunks, the way zeroed pages and padding show up in dumps.
+ */
+static void bench_fill(u8 *buf, size_t len)
+{
+	size_t i;
+
+	test_comp_fill(buf, len);
+	for (i = 0; i < len; i += 2048)
+		if (prandom_u32() & 1)
+			memset(buf + i, 0, min_t(size_t, len - i, 512));
+}
+
+static int bench_one_block(struct bench_thread *bt, unsigned int idx)
+{
+	struct bench_ctx *ctx = bt->ctx;
+	struct bench_block *blk = &ctx->blocks[idx];
+	unsigned int len = ctx->bsize * 2;
+
+	if (bt->decompress) {
+		len = ctx->bsize;
+		return crypto_comp_decompress(bt->tfm, blk->cdata, blk->clen,
+					      bt->buf, &len);
+	}
+
+	return crypto_comp_compress(bt->tfm, ctx->data + idx * ctx->bsize,
+				    ctx->bsize, bt->buf, &len);
+}
+
+static int bench_thread_fn(void *arg)
+{
+	struct bench_thread *bt = arg;
+	struct bench_ctx *ctx = bt->ctx;
+	unsigned int pass, i, idx;
+	u64 start, t0, t1;
+	int ret = 0;
+
+	atomic_inc(&ctx->nr_ready);
+	wait_for_completion(&ctx->start);
+
+	start = ktime_get_ns();
+	for (pass = 0; pass < passes && !ret; pass++) {
+		for (i = 0; i < ctx->nr_blocks; i++) {
+			/* spread the threads over the corpus */
+			idx = (i + (bt - bench_threads) * ctx->nr_blocks /
+			       threads) % ctx->nr_blocks;
+
+			t0 = ktime_get_ns();
+			ret = bench_one_block(bt, idx);
+			t1 = ktime_get_ns();
+			if (ret)
+				break;
+
+			/* once full, overwrite random slots */
+			if (bt->nr_samples < BENCH_MAX_SAMPLES)
+				bt->samples[bt->nr_samples++] = t1 - t0;
+			else
+				bt->samples[prandom_u32() %
+					    BENCH_MAX_SAMPLES] = t1 - t0;
+
+			bt->bytes += ctx->bsize;
+			cond_resched();
+		}
+	}
+	bt->time_ns = ktime_get_ns() - start;
+	bt->err = ret;
+
+	complete(&bt->done);
+	return 0;
+}
+
+static int bench_cmp_u32(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Run one phase on all threads, return the wall clock time in ns */
+static int bench_phase(struct bench_ctx *ctx, bool decompress, u64 *wall_ns)
+{
+	unsigned int i;
+	u64 start;
+	int err = 0;
+
+	atomic_set(&ctx->nr_ready, 0);
+	init_completion(&ctx->start);
+
+	for (i = 0; i < threads; i++) {
+		struct bench_thread *bt = &bench_threads[i];
+
+		bt->ctx = ctx;
+		bt->decompress = decompress;
+		bt->err = 0;
+		bt->bytes = 0;
+		bt->nr_samples = 0;
+		init_completion(&bt->done);
+		bt->task = kthread_run(bench_thread_fn, bt, "comp_bench/%u", i);
+		if (IS_ERR(bt->task)) {
+			err = PTR_ERR(bt->task);
+			break;
+		}
+	}
+
+	/* threads that did start still have to be released and reaped */
+	while (atomic_read(&ctx->nr_ready) < i)
+		schedule_timeout_uninterruptible(1);
+
+	start = ktime_get_ns();
+	complete_all(&ctx->start);
+	while (i--) {
+		wait_for_completion(&bench_threads[i].done);
+		if (bench_threads[i].err)
+			err = bench_threads[i].err;
+	}
+	*wall_ns = ktime_get_ns() - start;
+
+	return err;
+}
+
+static void bench_report(const char *what, u64 wall_ns)
+{
+	unsigned int i, n = 0;
+	u64 bytes = 0;
+	u32 *all;
+
+	for (i = 0; i < threads; i++) {
+		bytes += bench_threads[i].bytes;
+		n += bench_threads[i].nr_samples;
+	}
+	if (!n)
+		return;
+
+	all = vmalloc(n * sizeof(*all));
+	if (!all)
+		return;
+
+	n = 0;
+	for (i = 0; i < threads; i++) {
+		memcpy(all + n, bench_threads[i].samples,
+		       bench_threads[i].nr_samples * sizeof(*all));
+		n += bench_threads[i].nr_samples;
+	}
+	sort(all, n, sizeof(*all), bench_cmp_u32, NULL);
+
+	pr_info("  %-10s %7llu MB/s  lat(us) p50 %5u p90 %5u p99 %5u max %5u\n",
+		/* bytes per us is MB/s */
+		what, div64_u64(bytes * 1000, max_t(u64, wall_ns, 1)),
+		all[n / 2] / 1000, all[n * 9 / 10] / 1000,
+		all[n * 99 / 100] / 1000, all[n - 1] / 1000);
+
+	vfree(all);
+}
+
+static int bench_prepare(struct bench_ctx *ctx, u64 *clen_total)
+{
+	struct crypto_comp *tfm = bench_threads[0].tfm;
+	u8 *buf = bench_threads[0].buf;
+	unsigned int i, len;
+	int ret;
+
+	*clen_total = 0;
+	for (i = 0; i < ctx->nr_blocks; i++) {
+		struct bench_block *blk = &ctx->blocks[i];
+
+		len = ctx->bsize * 2;
+		ret = crypto_comp_compress(tfm, ctx->data + i * ctx->bsize,
+					   ctx->bsize, buf, &len);
+		if (ret)
+			return ret;
+
+		blk->cdata = kmalloc(len, GFP_KERNEL);
+		if (!blk->cdata)
+			return -ENOMEM;
+		memcpy(blk->cdata, buf, len);
+		blk->clen = len;
+		*clen_total += len;
+	}
+
+	return 0;
+}
+
+static void bench_cleanup(struct bench_ctx *ctx)
+{
+	unsigned int i;
+
+	for (i = 0; i < ctx->nr_blocks; i++)
+		kfree(ctx->blocks[i].cdata);
+	memset(ctx->blocks, 0, ctx->nr_blocks * sizeof(*ctx->blocks));
+}
+
+static int bench_alloc_threads(const char *alg, unsigned int bsize)
+{
+	unsigned int i;
+
+	for (i = 0; i < threads; i++) {
+		struct bench_thread *bt = &bench_threads[i];
+
+		bt->tfm = crypto_alloc_comp(alg, 0, 0);
+		if (IS_ERR(bt->tfm)) {
+			int err = PTR_ERR(bt->tfm);
+
+			bt->tfm = NULL;
+			return err;
+		}
+		/* incompressible data may grow a little */
+		bt->buf = vmalloc(bsize * 2);
+		if (!bt->buf)
+			return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void bench_free_threads(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < threads; i++) {
+		struct bench_thread *bt = &bench_threads[i];
+
+		if (bt->tfm)
+			crypto_free_comp(bt->tfm);
+		bt->tfm = NULL;
+		vfree(bt->buf);
+		bt->buf = NULL;
+	}
+}
+
+static void bench_run(const char *alg, const u8 *data, size_t size,
+		      struct bench_block *blocks)
+{
+	struct bench_ctx ctx;
+	unsigned int i;
+	u64 clen, wall_ns;
+	int err;
+
+	for (i = 0; i < nr_block_sizes; i++) {
+		ctx.alg = alg;
+		ctx.bsize = block_sizes[i];
+		ctx.nr_blocks = size / ctx.bsize;
+		ctx.data = data;
+		ctx.blocks = blocks;
+
+		if (!ctx.bsize || !ctx.nr_blocks) {
+			pr_err("%u byte blocks don't fit the corpus\n",
+			       ctx.bsize);
+			continue;
+		}
+
+		err = bench_alloc_threads(alg, ctx.bsize);
+		if (err) {
+			pr_err("%s: can't set up %u threads: %d\n",
+			       alg, threads, err);
+			bench_free_threads();
+			return;
+		}
+
+		err = bench_prepare(&ctx, &clen);
+		if (err)
+			goto out;
+
+		pr_info("%s, %u byte blocks, %u threads: ratio %llu.%02llu\n",
+			alg, ctx.bsize, threads,
+			div64_u64((u64)ctx.nr_blocks * ctx.bsize, clen),
+			div64_u64((u64)ctx.nr_blocks * ctx.bsize * 100, clen) %
+			100);
+
+		err = bench_phase(&ctx, false, &wall_ns);
+		if (err)
+			goto out;
+		bench_report("compress", wall_ns);
+
+		err = bench_phase(&ctx, true, &wall_ns);
+		if (err)
+			goto out;
+		bench_report("decompress", wall_ns);
+out:
+		if (err)
+			pr_err("%s, %u byte blocks failed: %d\n",
+			       alg, ctx.bsize, err);
+		bench_cleanup(&ctx);
+		bench_free_threads();
+	}
+}
+
+static int __init comp_bench_init(void)
+{
+	const struct firmware *fw = NULL;
+	struct bench_block *blocks = NULL;
+	unsigned int i, min_bsize = UINT_MAX;
+	const u8 *data;
+	u8 *gen = NULL;
+	size_t size;
+	int err = -ENOMEM;
+
+	if (!threads || threads > BENCH_MAX_THREADS) {
+		pr_err("threads must be 1..%d\n", BENCH_MAX_THREADS);
+		return -EINVAL;
+	}
+
+	if (corpus) {
+		err = request_firmware_direct(&fw, corpus, NULL);
+		if (err) {
+			pr_err("can't load corpus %s: %d\n", corpus, err);
+			return err;
+		}
+		data = fw->data;
+		size = min_t(size_t, fw->size, BENCH_MAX_CORPUS);
+	} else {
+		gen = vmalloc(BENCH_GEN_CORPUS);
+		if (!gen)
+			return -ENOMEM;
+		bench_fill(gen, BENCH_GEN_CORPUS);
+		data = gen;
+		size = BENCH_GEN_CORPUS;
+	}
+
+	for (i = 0; i < nr_block_sizes; i++)
+		if (block_sizes[i])
+			min_bsize = min(min_bsize, block_sizes[i]);
+	if (min_bsize == UINT_MAX) {
+		err = -EINVAL;
+		goto out;
+	}
+
+	blocks = vzalloc((size / min_bsize + 1) * sizeof(*blocks));
+	if (!blocks)
+		goto out;
+
+	for (i = 0; i < threads; i++) {
+		bench_threads[i].samples = vmalloc(BENCH_MAX_SAMPLES *
+						   sizeof(u32));
+		if (!bench_threads[i].samples)
+			goto out;
+	}
+
+	pr_info("corpus: %s, %zu bytes\n", corpus ? corpus : "generated", size);
+	for (i = 0; i < nr_algs; i++)
+		bench_run(algs[i], data, size, blocks);
+
+	/* all the work is done, don't keep the module around */
+	err = -EAGAIN;
+out:
+	for (i = 0; i < threads; i++) {
+		vfree(bench_threads[i].samples);
+		bench_threads[i].samples = NULL;
+	}
+	vfree(blocks);
+	vfree(gen);
+	release_firmware(fw);
+
+	return err;
+}
+
+static void __exit comp_bench_exit(void) { }
+
+module_init(comp_bench_init);
+module_exit(comp_bench_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Compression algorithm benchmark");
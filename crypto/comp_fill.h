@@ -0,0 +1,34 @@
+/*
+ * Synthetic input for the compression speed tests.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ */
+#ifndef _CRYPTO_COMP_FILL_H
+#define _CRYPTO_COMP_FILL_H
+
+#include <linux/random.h>
+#include <linux/types.h>
+
+/*
+ * Fill @buf with data that compresses roughly like swapped out anon
+ * memory: runs of repeated words, small integers and some noise.
+ */
+static inline void test_comp_fill(u8 *buf, unsigned int len)
+{
+	static const char words[] = "the quick brown fox jumps over the "
+				    "lazy dog 0123456789 ";
+	unsigned int i;
+
+	for (i = 0; i < len; i++) {
+		if (!(prandom_u32() & 15))
+			buf[i] = prandom_u32();
+		else
+			buf[i] = words[(i / 4 + (i >> 9)) % (sizeof(words) - 1)];
+	}
+}
+
+#endif	/* _CRYPTO_COMP_FILL_H */
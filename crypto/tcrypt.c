@@ -33,6 +33,9 @@
 #include <linux/jiffies.h>
 #include <linux/timex.h>
 #include <linux/interrupt.h>
+#include <linux/vmalloc.h>
+#include <linux/random.h>
+#include "comp_fill.h"
 #include "tcrypt.h"
 #include "internal.h"
 
@@ -1202,6 +1205,86 @@ out:
 	crypto_free_ablkcipher(tfm);
 }
 
+static void test_comp_speed(const char *algo, unsigned int secs,
+			    unsigned int *blens)
+{
+	struct crypto_comp *tfm;
+	u8 *src, *comp, *decomp;
+	unsigned int max_blen = 0;
+	int i;
+
+	tfm = crypto_alloc_comp(algo, 0, 0);
+	if (IS_ERR(tfm)) {
+		printk(KERN_ERR "failed to load transform for %s: %ld\n", algo,
+		       PTR_ERR(tfm));
+		return;
+	}
+
+	printk(KERN_INFO "\ntesting speed of %s (%s)\n", algo,
+			get_driver_name(crypto_comp, tfm));
+
+	if (!secs)
+		secs = 1;
+
+	for (i = 0; blens[i]; i++)
+		max_blen = max(max_blen, blens[i]);
+
+	src = vmalloc(max_blen);
+	/* incompressible input may grow a little */
+	comp = vmalloc(max_blen * 2);
+	decomp = vmalloc(max_blen);
+	if (!src || !comp || !decomp)
+		goto out;
+
+	test_comp_fill(src, max_blen);
+
+	for (i = 0; blens[i]; i++) {
+		unsigned int blen = blens[i], clen = 0, dlen = 0;
+		unsigned long start, end, ccount, dcount;
+		int ret;
+
+		for (start = jiffies, end = start + secs * HZ, ccount = 0;
+		     time_before(jiffies, end); ccount++) {
+			clen = max_blen * 2;
+			ret = crypto_comp_compress(tfm, src, blen, comp, &clen);
+			if (ret)
+				goto err;
+		}
+
+		for (start = jiffies, end = start + secs * HZ, dcount = 0;
+		     time_before(jiffies, end); dcount++) {
+			dlen = blen;
+			ret = crypto_comp_decompress(tfm, comp, clen,
+						     decomp, &dlen);
+			if (ret)
+				goto err;
+		}
+
+		if (dlen != blen || memcmp(src, decomp, blen)) {
+			printk(KERN_ERR "%s: round trip of %u bytes failed\n",
+			       algo, blen);
+			goto out;
+		}
+
+		printk(KERN_INFO "%6u byte blocks, ratio %3u%%: "
+		       "compress %6lu KB/sec, decompress %6lu KB/sec\n",
+		       blen, clen * 100 / blen,
+		       ccount * blen / secs / 1024,
+		       dcount * blen / secs / 1024);
+		continue;
+err:
+		printk(KERN_ERR "%s: %u byte blocks failed: %d\n",
+		       algo, blen, ret);
+		goto out;
+	}
+
+out:
+	vfree(decomp);
+	vfree(comp);
+	vfree(src);
+	crypto_free_comp(tfm);
+}
+
 static void test_available(void)
 {
 	char **name = check;
@@ -2119,6 +2202,53 @@ static int do_test(int m)
 				   speed_template_8_32);
 		break;
 
+	case 510:
+		/* disk encryption: each xts(aes) driver, then speck */
+		test_acipher_speed("qcrypto-xts-aes", ENCRYPT, sec, NULL, 0,
+				   speed_template_32_64);
+		test_acipher_speed("qcrypto-xts-aes", DECRYPT, sec, NULL, 0,
+				   speed_template_32_64);
+		test_acipher_speed("xts-aes-ce", ENCRYPT, sec, NULL, 0,
+				   speed_template_32_64);
+		test_acipher_speed("xts-aes-ce", DECRYPT, sec, NULL, 0,
+				   speed_template_32_64);
+		test_acipher_speed("xts-aes-neon", ENCRYPT, sec, NULL, 0,
+				   speed_template_32_64);
+		test_acipher_speed("xts-aes-neon", DECRYPT, sec, NULL, 0,
+				   speed_template_32_64);
+		test_acipher_speed("xts(aes)", ENCRYPT, sec, NULL, 0,
+				   speed_template_32_64);
+		test_acipher_speed("xts(aes)", DECRYPT, sec, NULL, 0,
+				   speed_template_32_64);
+		test_acipher_speed("xts(speck128)", ENCRYPT, sec, NULL, 0,
+				   speed_template_32_48_64);
+		test_acipher_speed("xts(speck128)", DECRYPT, sec, NULL, 0,
+				   speed_template_32_48_64);
+		test_acipher_speed("xts(speck64)", ENCRYPT, sec, NULL, 0,
+				   speed_template_24_32);
+		test_acipher_speed("xts(speck64)", DECRYPT, sec, NULL, 0,
+				   speed_template_24_32);
+		break;
+
+	case 600:
+		test_comp_speed("lz4", sec, comp_speed_template);
+		if (mode > 600 && mode < 700) break;
+
+	case 601:
+		test_comp_speed("lz4hc", sec, comp_speed_template);
+		if (mode > 600 && mode < 700) break;
+
+	case 602:
+		test_comp_speed("lzo", sec, comp_speed_template);
+		if (mode > 600 && mode < 700) break;
+
+	case 603:
+		test_comp_speed("deflate", sec, comp_speed_template);
+		if (mode > 600 && mode < 700) break;
+
+	case 699:
+		break;
+
 	case 1000:
 		test_available();
 		break;
@@ -52,6 +52,7 @@ static struct cipher_speed_template des3_speed_template[] = {
  */
 static u8 speed_template_8[] = {8, 0};
 static u8 speed_template_24[] = {24, 0};
+static u8 speed_template_24_32[] = {24, 32, 0};
 static u8 speed_template_8_16[] = {8, 16, 0};
 static u8 speed_template_8_32[] = {8, 32, 0};
 static u8 speed_template_16_32[] = {16, 32, 0};
@@ -126,4 +127,11 @@ static struct hash_speed hash_speed_template_16[] = {
 	{  .blen = 0,	.plen = 0,	.klen = 0, }
 };
 
+/*
+ * Compression speed tests, block sizes in bytes
+ */
+static unsigned int comp_speed_template[] = {
+	1024, 4096, 16384, 65536, 0
+};
+
 #endif	/* _CRYPTO_TCRYPT_H */
@@ -32,6 +32,11 @@
 #include <linux/cpufreq.h>
 #include <linux/timer.h>
 #include <linux/wakeup_reason.h>
+#include <linux/platform_device.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
 
 #include "../base.h"
 #include "power.h"
@@ -57,6 +62,31 @@ static LIST_HEAD(dpm_noirq_list);
 struct suspend_stats suspend_stats;
 static DEFINE_MUTEX(dpm_list_mtx);
 static pm_message_t pm_transition;
+static DEFINE_MUTEX(dpm_links_mtx);
+
+/*
+ * PM dependency between two devices that are not parent and child: the
+ * supplier suspends after and resumes before the consumer.  Links are
+ * protected by dpm_links_mtx, nested in dpm_list_mtx when both are needed.
+ * The waiters only take the former, as async_schedule() may run them
+ * synchronously from under the latter.
+ */
+struct dpm_link {
+	struct device		*supplier;
+	struct device		*consumer;
+	struct list_head	s_node;	/* in supplier->power.consumers */
+	struct list_head	c_node;	/* in consumer->power.suppliers */
+};
+
+#define DPM_RESUME_EVENTS	(PM_EVENT_RESUME | PM_EVENT_THAW | \
+				 PM_EVENT_RESTORE | PM_EVENT_RECOVER)
+
+/* Resume budget, from the start of the noirq resume to screen on */
+static ktime_t dpm_wakeup_time;
+static u32 dpm_resume_us;
+static u32 dpm_screen_on_us;
+static bool dpm_screen_on_pending;
+static u32 dpm_resume_budget_ms = 500;
 
 #ifdef CONFIG_SEC_PM
 extern int wakeup_gpio_irq_flag;
@@ -102,6 +132,8 @@ void device_pm_sleep_init(struct device *dev)
 	complete_all(&dev->power.completion);
 	dev->power.wakeup = NULL;
 	INIT_LIST_HEAD(&dev->power.entry);
+	INIT_LIST_HEAD(&dev->power.suppliers);
+	INIT_LIST_HEAD(&dev->power.consumers);
 }
 
 /**
@@ -136,6 +168,22 @@ void device_pm_add(struct device *dev)
 	mutex_unlock(&dpm_list_mtx);
 }
 
+static void dpm_drop_links(struct device *dev)
+{
+	struct dpm_link *link, *tmp;
+
+	list_for_each_entry_safe(link, tmp, &dev->power.suppliers, c_node) {
+		list_del(&link->s_node);
+		list_del(&link->c_node);
+		kfree(link);
+	}
+	list_for_each_entry_safe(link, tmp, &dev->power.consumers, s_node) {
+		list_del(&link->s_node);
+		list_del(&link->c_node);
+		kfree(link);
+	}
+}
+
 /**
  * device_pm_remove - Remove a device from the PM core's list of active devices.
  * @dev: Device to be removed from the list.
@@ -147,6 +195,9 @@ void device_pm_remove(struct device *dev)
 	complete_all(&dev->power.completion);
 	mutex_lock(&dpm_list_mtx);
 	list_del_init(&dev->power.entry);
+	mutex_lock(&dpm_links_mtx);
+	dpm_drop_links(dev);
+	mutex_unlock(&dpm_links_mtx);
 	mutex_unlock(&dpm_list_mtx);
 	device_wakeup_disable(dev);
 	pm_runtime_remove(dev);
@@ -203,6 +254,123 @@ void device_pm_move_last(struct device *dev)
 	list_move_tail(&dev->power.entry, &dpm_list);
 }
 
+/* Does @dev rely on @target, directly or through its ancestors? */
+static bool dpm_depends_on(struct device *dev, struct device *target)
+{
+	struct dpm_link *link;
+
+	if (dev == target)
+		return true;
+
+	if (dev->parent && dpm_depends_on(dev->parent, target))
+		return true;
+
+	list_for_each_entry(link, &dev->power.suppliers, c_node)
+		if (dpm_depends_on(link->supplier, target))
+			return true;
+
+	return false;
+}
+
+static void dpm_reorder_to_tail(struct device *dev);
+
+static int dpm_reorder_fn(struct device *dev, void *data)
+{
+	dpm_reorder_to_tail(dev);
+	return 0;
+}
+
+/*
+ * Move @dev, its descendants and its consumers to the end of dpm_list, so
+ * that devices handled synchronously also honour the new dependency.
+ */
+static void dpm_reorder_to_tail(struct device *dev)
+{
+	struct dpm_link *link;
+
+	if (!list_empty(&dev->power.entry))
+		list_move_tail(&dev->power.entry, &dpm_list);
+	device_for_each_child(dev, NULL, dpm_reorder_fn);
+	list_for_each_entry(link, &dev->power.consumers, s_node)
+		dpm_reorder_to_tail(link->consumer);
+}
+
+/**
+ * device_pm_add_link - Make a device's system PM depend on another one.
+ * @consumer: Device that needs @supplier.
+ * @supplier: Device that must stay active while @consumer is.
+ *
+ * Suspend @supplier only after @consumer and resume it before, even when
+ * either of them is handled asynchronously.  Both devices must have been
+ * registered, and the link cannot be added during a system transition.
+ */
+int device_pm_add_link(struct device *consumer, struct device *supplier)
+{
+	struct dpm_link *link, *l;
+	int ret = 0;
+
+	if (!consumer || !supplier)
+		return -EINVAL;
+
+	link = kzalloc(sizeof(*link), GFP_KERNEL);
+	if (!link)
+		return -ENOMEM;
+
+	mutex_lock(&dpm_list_mtx);
+	mutex_lock(&dpm_links_mtx);
+	if (list_empty(&consumer->power.entry) ||
+	    list_empty(&supplier->power.entry)) {
+		ret = -ENODEV;
+		goto out;
+	}
+	if (consumer->power.is_prepared || supplier->power.is_prepared) {
+		ret = -EBUSY;
+		goto out;
+	}
+	if (dpm_depends_on(supplier, consumer)) {
+		ret = -EINVAL;
+		goto out;
+	}
+	list_for_each_entry(l, &consumer->power.suppliers, c_node)
+		if (l->supplier == supplier)
+			goto out;
+
+	link->supplier = supplier;
+	link->consumer = consumer;
+	list_add_tail(&link->s_node, &supplier->power.consumers);
+	list_add_tail(&link->c_node, &consumer->power.suppliers);
+	dpm_reorder_to_tail(consumer);
+	link = NULL;
+ out:
+	mutex_unlock(&dpm_links_mtx);
+	mutex_unlock(&dpm_list_mtx);
+	kfree(link);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(device_pm_add_link);
+
+/**
+ * device_pm_remove_link - Drop a link added by device_pm_add_link().
+ * @consumer: Device that needed @supplier.
+ * @supplier: Device @consumer depended on.
+ */
+void device_pm_remove_link(struct device *consumer, struct device *supplier)
+{
+	struct dpm_link *link;
+
+	mutex_lock(&dpm_links_mtx);
+	list_for_each_entry(link, &consumer->power.suppliers, c_node) {
+		if (link->supplier == supplier) {
+			list_del(&link->s_node);
+			list_del(&link->c_node);
+			kfree(link);
+			break;
+		}
+	}
+	mutex_unlock(&dpm_links_mtx);
+}
+EXPORT_SYMBOL_GPL(device_pm_remove_link);
+
 static ktime_t initcall_debug_start(struct device *dev)
 {
 	ktime_t calltime = ktime_set(0, 0);
@@ -257,6 +425,80 @@ static void dpm_wait_for_children(struct device *dev, bool async)
        device_for_each_child(dev, &async, dpm_wait_fn);
 }
 
+static bool dpm_must_wait(struct device *dev, bool async)
+{
+	return (async || (pm_async_enabled && dev->power.async_suspend)) &&
+		!completion_done(&dev->power.completion);
+}
+
+/*
+ * The linked devices can't be waited for under dpm_links_mtx, so look for
+ * one that is still busy, wait for it with the lock dropped and rescan
+ * until none is left.  Links don't change during a transition, so the
+ * unlocked list_empty() checks are fine.
+ */
+static void dpm_wait_for_suppliers(struct device *dev, bool async)
+{
+	struct dpm_link *link;
+	struct device *other;
+
+	if (list_empty(&dev->power.suppliers))
+		return;
+
+	do {
+		other = NULL;
+		mutex_lock(&dpm_links_mtx);
+		list_for_each_entry(link, &dev->power.suppliers, c_node) {
+			if (dpm_must_wait(link->supplier, async)) {
+				other = get_device(link->supplier);
+				break;
+			}
+		}
+		mutex_unlock(&dpm_links_mtx);
+		if (other) {
+			dpm_wait(other, async);
+			put_device(other);
+		}
+	} while (other);
+}
+
+static void dpm_wait_for_consumers(struct device *dev, bool async)
+{
+	struct dpm_link *link;
+	struct device *other;
+
+	if (list_empty(&dev->power.consumers))
+		return;
+
+	do {
+		other = NULL;
+		mutex_lock(&dpm_links_mtx);
+		list_for_each_entry(link, &dev->power.consumers, s_node) {
+			if (dpm_must_wait(link->consumer, async)) {
+				other = get_device(link->consumer);
+				break;
+			}
+		}
+		mutex_unlock(&dpm_links_mtx);
+		if (other) {
+			dpm_wait(other, async);
+			put_device(other);
+		}
+	} while (other);
+}
+
+static void dpm_wait_for_superior(struct device *dev, bool async)
+{
+	dpm_wait(dev->parent, async);
+	dpm_wait_for_suppliers(dev, async);
+}
+
+static void dpm_wait_for_subordinate(struct device *dev, bool async)
+{
+	dpm_wait_for_children(dev, async);
+	dpm_wait_for_consumers(dev, async);
+}
+
 /**
  * pm_op - Return the PM operation appropriate for given PM event.
  * @ops: PM operations to choose from.
@@ -391,7 +633,8 @@ static void dpm_show_time(ktime_t starttime, pm_message_t state, char *info)
 static int dpm_run_callback(pm_callback_t cb, struct device *dev,
 			    pm_message_t state, char *info)
 {
-	ktime_t calltime;
+	ktime_t calltime, start;
+	s64 usecs;
 	int error;
 
 	if (!cb)
@@ -401,10 +644,17 @@ static int dpm_run_callback(pm_callback_t cb, struct device *dev,
 
 	pm_dev_dbg(dev, state, info);
 	trace_device_pm_callback_start(dev, info, state.event);
+	start = ktime_get();
 	error = cb(dev);
+	usecs = ktime_us_delta(ktime_get(), start);
 	trace_device_pm_callback_end(dev, error);
 	suspend_report_result(cb, error);
 
+	if (state.event & DPM_RESUME_EVENTS)
+		dev->power.resume_time_us += usecs;
+	else
+		dev->power.suspend_time_us += usecs;
+
 	initcall_debug_report(dev, calltime, error, state, info);
 
 	return error;
@@ -501,7 +751,7 @@ static int device_resume_noirq(struct device *dev, pm_message_t state, bool asyn
 	if (!dev->power.is_noirq_suspended)
 		goto Out;
 
-	dpm_wait(dev->parent, async);
+	dpm_wait_for_superior(dev, async);
 
 	if (dev->pm_domain) {
 		info = "noirq power domain ";
@@ -566,6 +816,8 @@ void dpm_resume_noirq(pm_message_t state)
 #endif
 
 	trace_suspend_resume(TPS("dpm_resume_noirq"), state.event, true);
+	dpm_wakeup_time = starttime;
+	dpm_screen_on_pending = true;
 	mutex_lock(&dpm_list_mtx);
 	pm_transition = state;
 
@@ -637,7 +889,7 @@ static int device_resume_early(struct device *dev, pm_message_t state, bool asyn
 	if (!dev->power.is_late_suspended)
 		goto Out;
 
-	dpm_wait(dev->parent, async);
+	dpm_wait_for_superior(dev, async);
 
 	if (dev->pm_domain) {
 		info = "early power domain ";
@@ -769,7 +1021,7 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 		goto Complete;
 	}
 
-	dpm_wait(dev->parent, async);
+	dpm_wait_for_superior(dev, async);
 	dpm_watchdog_set(&wd, dev);
 	device_lock(dev);
 
@@ -902,6 +1154,7 @@ void dpm_resume(pm_message_t state)
 	mutex_unlock(&dpm_list_mtx);
 	async_synchronize_full();
 	dpm_show_time(starttime, state, NULL);
+	dpm_resume_us = ktime_us_delta(ktime_get(), dpm_wakeup_time);
 
 	cpufreq_resume();
 	trace_suspend_resume(TPS("dpm_resume"), state.event, false);
@@ -980,6 +1233,10 @@ void dpm_complete(pm_message_t state)
 		device_complete(dev, state);
 
 		mutex_lock(&dpm_list_mtx);
+		if (dev->power.async_auto) {
+			dev->power.async_auto = false;
+			dev->power.async_suspend = false;
+		}
 		put_device(dev);
 	}
 	list_splice(&list, &dpm_list);
@@ -1051,7 +1308,7 @@ static int __device_suspend_noirq(struct device *dev, pm_message_t state, bool a
 	if (dev->power.syscore || dev->power.direct_complete)
 		goto Complete;
 
-	dpm_wait_for_children(dev, async);
+	dpm_wait_for_subordinate(dev, async);
 
 	if (dev->pm_domain) {
 		info = "noirq power domain ";
@@ -1192,7 +1449,7 @@ static int __device_suspend_late(struct device *dev, pm_message_t state, bool as
 	if (dev->power.syscore || dev->power.direct_complete)
 		goto Complete;
 
-	dpm_wait_for_children(dev, async);
+	dpm_wait_for_subordinate(dev, async);
 
 	if (dev->pm_domain) {
 		info = "late power domain ";
@@ -1362,7 +1619,7 @@ static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 	char suspend_abort[MAX_SUSPEND_ABORT_LEN];
 	DECLARE_DPM_WATCHDOG_ON_STACK(wd);
 
-	dpm_wait_for_children(dev, async);
+	dpm_wait_for_subordinate(dev, async);
 
 	if (async_error) {
 		dev->power.direct_complete = false;
@@ -1629,6 +1886,34 @@ static int device_prepare(struct device *dev, pm_message_t state)
 	return 0;
 }
 
+static int dpm_has_child(struct device *dev, void *data)
+{
+	return 1;
+}
+
+/*
+ * With pm_async set to 2, also handle asynchronously the devices we know
+ * nobody depends on implicitly: devices with a bound driver and no children,
+ * outside of power domains and of the platform bus, where the clock,
+ * regulator and pin controllers live.  Called with dpm_list_mtx held once
+ * @dev has been prepared, so it can't gain children any more.
+ */
+static void dpm_auto_async(struct device *dev)
+{
+	if (pm_async_enabled < 2 || dev->power.async_suspend)
+		return;
+
+	if (dev->power.syscore || !dev->driver || dev->pm_domain ||
+	    dev->bus == &platform_bus_type)
+		return;
+
+	if (device_for_each_child(dev, NULL, dpm_has_child))
+		return;
+
+	dev->power.async_suspend = true;
+	dev->power.async_auto = true;
+}
+
 /**
  * dpm_prepare - Prepare all non-sysdev devices for a system PM transition.
  * @state: PM transition of the system being carried out.
@@ -1665,6 +1950,9 @@ int dpm_prepare(pm_message_t state)
 			break;
 		}
 		dev->power.is_prepared = true;
+		dev->power.suspend_time_us = 0;
+		dev->power.resume_time_us = 0;
+		dpm_auto_async(dev);
 		if (!list_empty(&dev->power.entry))
 			list_move_tail(&dev->power.entry, &dpm_prepared_list);
 		put_device(dev);
@@ -1735,3 +2023,199 @@ void dpm_for_each_dev(void *data, void (*fn)(struct device *, void *))
 	device_pm_unlock();
 }
 EXPORT_SYMBOL_GPL(dpm_for_each_dev);
+
+/**
+ * pm_resume_screen_on - Report that the display is back on after a resume.
+ *
+ * Called by the display driver when it unblanks; the first call after each
+ * system resume closes the resume budget window.
+ */
+void pm_resume_screen_on(void)
+{
+	if (!dpm_screen_on_pending)
+		return;
+
+	dpm_screen_on_pending = false;
+	dpm_screen_on_us = ktime_us_delta(ktime_get(), dpm_wakeup_time);
+	if (dpm_screen_on_us > dpm_resume_budget_ms * USEC_PER_MSEC)
+		pr_warn("PM: screen on %u.%03u msecs after wakeup, over the %u msecs budget\n",
+			dpm_screen_on_us / USEC_PER_MSEC,
+			dpm_screen_on_us % USEC_PER_MSEC, dpm_resume_budget_ms);
+}
+EXPORT_SYMBOL_GPL(pm_resume_screen_on);
+
+#ifdef CONFIG_DEBUG_FS
+struct dpm_time_entry {
+	struct device	*dev;
+	u32		suspend_us;
+	u32		resume_us;
+};
+
+static int dpm_time_cmp(const void *a, const void *b)
+{
+	const struct dpm_time_entry *ea = a, *eb = b;
+	u32 ca = ea->suspend_us + ea->resume_us;
+	u32 cb = eb->suspend_us + eb->resume_us;
+
+	if (ca == cb)
+		return 0;
+	return ca < cb ? 1 : -1;
+}
+
+static int dpm_resume_cmp(const void *a, const void *b)
+{
+	const struct dpm_time_entry *ea = a, *eb = b;
+
+	if (ea->resume_us == eb->resume_us)
+		return 0;
+	return ea->resume_us < eb->resume_us ? 1 : -1;
+}
+
+/*
+ * Collect the devices that spent time in their callbacks during the last
+ * transition, sorted with @cmp; called with dpm_list_mtx held.
+ */
+static struct dpm_time_entry *dpm_collect_times(unsigned int *nr,
+		int (*cmp)(const void *, const void *))
+{
+	struct dpm_time_entry *entries;
+	struct list_head *lists[] = { &dpm_list, &dpm_prepared_list };
+	struct device *dev;
+	unsigned int i, n = 0;
+
+	for (i = 0; i < ARRAY_SIZE(lists); i++)
+		list_for_each_entry(dev, lists[i], power.entry)
+			n++;
+
+	entries = kcalloc(max(n, 1U), sizeof(*entries), GFP_KERNEL);
+	if (!entries)
+		return NULL;
+
+	n = 0;
+	for (i = 0; i < ARRAY_SIZE(lists); i++) {
+		list_for_each_entry(dev, lists[i], power.entry) {
+			if (!dev->power.suspend_time_us &&
+			    !dev->power.resume_time_us)
+				continue;
+			entries[n].dev = dev;
+			entries[n].suspend_us = dev->power.suspend_time_us;
+			entries[n].resume_us = dev->power.resume_time_us;
+			n++;
+		}
+	}
+	sort(entries, n, sizeof(*entries), cmp, NULL);
+
+	*nr = n;
+	return entries;
+}
+
+static int dpm_device_times_show(struct seq_file *m, void *v)
+{
+	struct dpm_time_entry *entries;
+	unsigned int i, nr;
+
+	mutex_lock(&dpm_list_mtx);
+	entries = dpm_collect_times(&nr, dpm_time_cmp);
+	if (!entries) {
+		mutex_unlock(&dpm_list_mtx);
+		return -ENOMEM;
+	}
+
+	seq_printf(m, "%10s %10s %5s  %s\n", "suspend-us", "resume-us",
+		   "async", "device");
+	for (i = 0; i < nr; i++)
+		seq_printf(m, "%10u %10u %5s  %s\n", entries[i].suspend_us,
+			   entries[i].resume_us,
+			   entries[i].dev->power.async_suspend ? "yes" : "no",
+			   dev_name(entries[i].dev));
+	mutex_unlock(&dpm_list_mtx);
+
+	kfree(entries);
+	return 0;
+}
+
+static int dpm_device_times_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dpm_device_times_show, NULL);
+}
+
+static const struct file_operations dpm_device_times_fops = {
+	.open		= dpm_device_times_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+#define DPM_BUDGET_TOP	10
+
+static int dpm_resume_budget_show(struct seq_file *m, void *v)
+{
+	struct dpm_time_entry *entries;
+	unsigned int i, nr;
+
+	seq_printf(m, "budget:       %u ms\n", dpm_resume_budget_ms);
+	seq_printf(m, "devices:      %u.%03u ms\n",
+		   dpm_resume_us / USEC_PER_MSEC,
+		   dpm_resume_us % USEC_PER_MSEC);
+	if (dpm_screen_on_pending)
+		seq_puts(m, "screen on:    pending\n");
+	else
+		seq_printf(m, "screen on:    %u.%03u ms%s\n",
+			   dpm_screen_on_us / USEC_PER_MSEC,
+			   dpm_screen_on_us % USEC_PER_MSEC,
+			   dpm_screen_on_us >
+			   dpm_resume_budget_ms * USEC_PER_MSEC ?
+			   " (over budget)" : "");
+
+	mutex_lock(&dpm_list_mtx);
+	entries = dpm_collect_times(&nr, dpm_resume_cmp);
+	if (!entries) {
+		mutex_unlock(&dpm_list_mtx);
+		return -ENOMEM;
+	}
+
+	seq_puts(m, "slowest resume callbacks:\n");
+	for (i = 0; i < nr && i < DPM_BUDGET_TOP; i++) {
+		if (!entries[i].resume_us)
+			break;
+		seq_printf(m, "%10u us %5s  %s\n", entries[i].resume_us,
+			   entries[i].dev->power.async_suspend ? "async" : "",
+			   dev_name(entries[i].dev));
+	}
+	mutex_unlock(&dpm_list_mtx);
+
+	kfree(entries);
+	return 0;
+}
+
+static int dpm_resume_budget_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dpm_resume_budget_show, NULL);
+}
+
+static const struct file_operations dpm_resume_budget_fops = {
+	.open		= dpm_resume_budget_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init dpm_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("dpm", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	debugfs_create_file("device_times", S_IRUGO, dir, NULL,
+			    &dpm_device_times_fops);
+	debugfs_create_file("resume_budget", S_IRUGO, dir, NULL,
+			    &dpm_resume_budget_fops);
+	debugfs_create_u32("resume_budget_ms", S_IRUGO | S_IWUSR, dir,
+			   &dpm_resume_budget_ms);
+
+	return 0;
+}
+late_initcall(dpm_debugfs_init);
+#endif /* CONFIG_DEBUG_FS */
@@ -140,6 +140,15 @@ struct regmap {
 	/* if set, the device supports multi write mode */
 	bool can_multi_write;
 
+	/* regcache_sync() statistics, see regmap-debugfs */
+	unsigned int sync_count;
+	unsigned int sync_writes;	/* bus writes of the last sync */
+	unsigned int sync_regs;		/* registers written by the last sync */
+	unsigned int sync_last_us;
+	unsigned int sync_max_us;
+	u64 sync_total_us;
+	u64 sync_total_writes;
+
 	struct rb_root range_tree;
 	void *selector_work_buf;	/* Scratch buffer used for selector */
 };
@@ -16,6 +16,7 @@
 #include <trace/events/regmap.h>
 #include <linux/bsearch.h>
 #include <linux/sort.h>
+#include <linux/ktime.h>
 
 #include "internal.h"
 
@@ -280,6 +281,23 @@ static int regcache_default_sync(struct regmap *map, unsigned int min,
 	return 0;
 }
 
+static void regcache_sync_stats_start(struct regmap *map)
+{
+	map->sync_writes = 0;
+	map->sync_regs = 0;
+}
+
+static void regcache_sync_stats_end(struct regmap *map, ktime_t start)
+{
+	unsigned int us = ktime_us_delta(ktime_get(), start);
+
+	map->sync_count++;
+	map->sync_last_us = us;
+	map->sync_max_us = max(map->sync_max_us, us);
+	map->sync_total_us += us;
+	map->sync_total_writes += map->sync_writes;
+}
+
 /**
  * regcache_sync: Sync the register cache with the hardware.
  *
@@ -293,6 +311,7 @@ static int regcache_default_sync(struct regmap *map, unsigned int min,
  */
 int regcache_sync(struct regmap *map)
 {
+	ktime_t start = ktime_get();
 	int ret = 0;
 	unsigned int i;
 	const char *name;
@@ -301,6 +320,7 @@ int regcache_sync(struct regmap *map)
 	BUG_ON(!map->cache_ops);
 
 	map->lock(map->lock_arg);
+	regcache_sync_stats_start(map);
 	/* Remember the initial bypass state */
 	bypass = map->cache_bypass;
 	dev_dbg(map->dev, "Syncing %s cache\n",
@@ -317,6 +337,8 @@ int regcache_sync(struct regmap *map)
 	map->cache_bypass = 1;
 	for (i = 0; i < map->patch_regs; i++) {
 		ret = _regmap_write(map, map->patch[i].reg, map->patch[i].def);
+		map->sync_writes++;
+		map->sync_regs++;
 		if (ret != 0) {
 			dev_err(map->dev, "Failed to write %x = %x: %d\n",
 				map->patch[i].reg, map->patch[i].def, ret);
@@ -340,6 +362,7 @@ out:
 	map->unlock(map->lock_arg);
 
 	regmap_async_complete(map);
+	regcache_sync_stats_end(map, start);
 
 	trace_regcache_sync(map, name, "stop");
 
@@ -362,6 +385,7 @@ EXPORT_SYMBOL_GPL(regcache_sync);
 int regcache_sync_region(struct regmap *map, unsigned int min,
 			 unsigned int max)
 {
+	ktime_t start = ktime_get();
 	int ret = 0;
 	const char *name;
 	unsigned int bypass;
@@ -369,6 +393,7 @@ int regcache_sync_region(struct regmap *map, unsigned int min,
 	BUG_ON(!map->cache_ops);
 
 	map->lock(map->lock_arg);
+	regcache_sync_stats_start(map);
 
 	/* Remember the initial bypass state */
 	bypass = map->cache_bypass;
@@ -395,6 +420,7 @@ out:
 	map->unlock(map->lock_arg);
 
 	regmap_async_complete(map);
+	regcache_sync_stats_end(map, start);
 
 	trace_regcache_sync(map, name, "stop region");
 
@@ -616,6 +642,8 @@ static int regcache_sync_block_single(struct regmap *map, void *block,
 		map->cache_bypass = 1;
 
 		ret = _regmap_write(map, regtmp, val);
+		map->sync_writes++;
+		map->sync_regs++;
 
 		map->cache_bypass = 0;
 		if (ret != 0) {
@@ -647,6 +675,8 @@ static int regcache_sync_block_raw_flush(struct regmap *map, const void **data,
 	map->cache_bypass = 1;
 
 	ret = _regmap_raw_write(map, base, *data, count * val_bytes);
+	map->sync_writes++;
+	map->sync_regs += count;
 	if (ret)
 		dev_err(map->dev, "Unable to sync registers %#x-%#x. %d\n",
 			base, cur - map->reg_stride, ret);
@@ -699,6 +729,8 @@ static int regcache_sync_block_raw_multi_reg(struct regmap *map, void *block,
 		dev_dbg(map->dev, "%s: start: 0x%x - end: 0x%x\n",
 			__func__, regs[0].reg, regs[num_regs-1].reg);
 		ret = _regmap_raw_multi_reg_write(map, regs, num_regs);
+		map->sync_writes++;
+		map->sync_regs += num_regs;
 	}
 	kfree(regs);
 	return ret;
@@ -710,42 +742,54 @@ static int regcache_sync_block_raw(struct regmap *map, void *block,
 			    unsigned int end)
 {
 	unsigned int i, val;
-	unsigned int regtmp = 0;
-	unsigned int base = 0;
+	unsigned int regtmp;
+	unsigned int base = 0, last = 0;
+	unsigned int gap = 0, max_gap;
 	const void *data = NULL;
 	int ret;
 
+	/*
+	 * Rewriting a few registers that hold their hardware default is
+	 * cheaper than splitting the burst around them, as long as that is
+	 * no more data than the address and padding a new write repeats.
+	 */
+	max_gap = DIV_ROUND_UP(map->format.reg_bytes + map->format.pad_bytes,
+			       map->format.val_bytes);
+
 	for (i = start; i < end; i++) {
 		regtmp = block_base + (i * map->reg_stride);
 
-		if (!regcache_reg_present(cache_present, i)) {
-			ret = regcache_sync_block_raw_flush(map, &data,
-							    base, regtmp);
-			if (ret != 0)
-				return ret;
-			continue;
+		if (regcache_reg_present(cache_present, i)) {
+			val = regcache_get_val(map, block, i);
+
+			/* Is this the hardware default?  If not, write it. */
+			ret = regcache_lookup_reg(map, regtmp);
+			if (ret < 0 || val != map->reg_defaults[ret].def) {
+				if (!data) {
+					data = regcache_get_val_addr(map,
+								     block, i);
+					base = regtmp;
+				}
+				last = regtmp + map->reg_stride;
+				gap = 0;
+				continue;
+			}
+
+			if (data && gap < max_gap &&
+			    regmap_writeable(map, regtmp)) {
+				gap++;
+				continue;
+			}
 		}
 
-		val = regcache_get_val(map, block, i);
-
-		/* Is this the hardware default?  If so skip. */
-		ret = regcache_lookup_reg(map, regtmp);
-		if (ret >= 0 && val == map->reg_defaults[ret].def) {
-			ret = regcache_sync_block_raw_flush(map, &data,
-							    base, regtmp);
-			if (ret != 0)
-				return ret;
-			continue;
-		}
-
-		if (!data) {
-			data = regcache_get_val_addr(map, block, i);
-			base = regtmp;
-		}
+		/* Write out the burst up to its last non-default register */
+		gap = 0;
+		ret = regcache_sync_block_raw_flush(map, &data, base, last);
+		if (ret != 0)
+			return ret;
 	}
 
-	return regcache_sync_block_raw_flush(map, &data, base, regtmp +
-			map->reg_stride);
+	return regcache_sync_block_raw_flush(map, &data, base, last);
 }
 
 int regcache_sync_block(struct regmap *map, void *block,
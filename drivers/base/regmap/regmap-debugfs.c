@@ -326,6 +326,32 @@ static const struct file_operations regmap_range_fops = {
 	.llseek = default_llseek,
 };
 
+static ssize_t regmap_sync_stats_read_file(struct file *file,
+					  char __user *user_buf, size_t count,
+					  loff_t *ppos)
+{
+	struct regmap *map = file->private_data;
+	char buf[256];
+	int len;
+
+	len = scnprintf(buf, sizeof(buf),
+			"syncs: %u\n"
+			"last: %u us, %u writes, %u registers\n"
+			"max: %u us\n"
+			"total: %llu us, %llu writes\n",
+			map->sync_count, map->sync_last_us, map->sync_writes,
+			map->sync_regs, map->sync_max_us,
+			map->sync_total_us, map->sync_total_writes);
+
+	return simple_read_from_buffer(user_buf, count, ppos, buf, len);
+}
+
+static const struct file_operations regmap_sync_stats_fops = {
+	.open = simple_open,
+	.read = regmap_sync_stats_read_file,
+	.llseek = default_llseek,
+};
+
 static ssize_t regmap_reg_ranges_read_file(struct file *file,
 					   char __user *user_buf, size_t count,
 					   loff_t *ppos)
@@ -534,6 +560,8 @@ void regmap_debugfs_init(struct regmap *map, const char *name)
 				    &map->cache_dirty);
 		debugfs_create_bool("cache_bypass", 0400, map->debugfs,
 				    &map->cache_bypass);
+		debugfs_create_file("sync_stats", 0400, map->debugfs,
+				    map, &regmap_sync_stats_fops);
 	}
 
 	next = rb_first(&map->range_tree);
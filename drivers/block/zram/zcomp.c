@@ -11,6 +11,7 @@
 #include <linux/string.h>
 #include <linux/err.h>
 #include <linux/slab.h>
+#include <linux/mm.h>
 #include <linux/wait.h>
 #include <linux/sched.h>
 #include <linux/cpu.h>
@@ -44,12 +45,18 @@ static void zcomp_strm_free(struct zcomp_strm *zstrm)
 }
 
 /*
- * allocate new zcomp_strm structure with ->tfm initialized by
- * backend, return NULL on error
+ * allocate new zcomp_strm structure for @cpu with ->tfm initialized by
+ * backend, return NULL on error. The stream and its buffer come from
+ * @cpu's memory node, since only that CPU is ever going to touch them.
  */
-static struct zcomp_strm *zcomp_strm_alloc(struct zcomp *comp)
+static struct zcomp_strm *zcomp_strm_alloc(struct zcomp *comp,
+		unsigned long cpu)
 {
-	struct zcomp_strm *zstrm = kmalloc(sizeof(*zstrm), GFP_KERNEL);
+	int nid = cpu_to_node(cpu);
+	struct zcomp_strm *zstrm;
+	struct page *page;
+
+	zstrm = kzalloc_node(sizeof(*zstrm), GFP_KERNEL, nid);
 	if (!zstrm)
 		return NULL;
 
@@ -58,7 +65,9 @@ static struct zcomp_strm *zcomp_strm_alloc(struct zcomp *comp)
 	 * allocate 2 pages. 1 for compressed data, plus 1 extra for the
 	 * case when compressed size is larger than the original one
 	 */
-	zstrm->buffer = (void *)__get_free_pages(GFP_KERNEL | __GFP_ZERO, 1);
+	page = alloc_pages_node(nid, GFP_KERNEL | __GFP_ZERO, 1);
+	if (page)
+		zstrm->buffer = page_address(page);
 	if (IS_ERR_OR_NULL(zstrm->tfm) || !zstrm->buffer) {
 		zcomp_strm_free(zstrm);
 		zstrm = NULL;
@@ -116,6 +125,12 @@ ssize_t zcomp_available_show(const char *comp, char *buf)
 	return sz;
 }
 
+/*
+ * Streams are strictly per-CPU: getting one disables preemption until
+ * the matching zcomp_stream_put(), so there is no pool, no lock and no
+ * wait queue to contend on. Callers must not sleep in between, but may
+ * already run with preemption disabled.
+ */
 struct zcomp_strm *zcomp_stream_get(struct zcomp *comp)
 {
 	return *get_cpu_ptr(comp->stream);
@@ -169,7 +184,7 @@ static int __zcomp_cpu_notifier(struct zcomp *comp,
 	case CPU_UP_PREPARE:
 		if (WARN_ON(*per_cpu_ptr(comp->stream, cpu)))
 			break;
-		zstrm = zcomp_strm_alloc(comp);
+		zstrm = zcomp_strm_alloc(comp, cpu);
 		if (IS_ERR_OR_NULL(zstrm)) {
 			pr_err("Can't allocate a compression stream\n");
 			return NOTIFY_BAD;
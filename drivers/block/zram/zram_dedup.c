@@ -0,0 +1,234 @@
+/*
+ * Same-content page deduplication for zram
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ */
+
+#define KMSG_COMPONENT "zram"
+#define pr_fmt(fmt) KMSG_COMPONENT ": " fmt
+
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/jhash.h>
+#include <linux/log2.h>
+
+#include "zram_drv.h"
+
+/* One hash bucket for every ZRAM_HASH_PAGES pages of disksize */
+#define ZRAM_HASH_SHIFT		4
+#define ZRAM_HASH_SIZE_MIN	(1 << 10)
+#define ZRAM_HASH_SIZE_MAX	(1 << 20)
+
+static struct kmem_cache *zram_entry_cache;
+static DEFINE_MUTEX(zram_entry_cache_lock);
+static int zram_entry_cache_users;
+
+u64 zram_dedup_dup_size(struct zram *zram)
+{
+	return (u64)atomic64_read(&zram->stats.dup_data_size);
+}
+
+u64 zram_dedup_meta_size(struct zram *zram)
+{
+	return (u64)atomic64_read(&zram->stats.meta_data_size);
+}
+
+/*
+ * The checksum is computed over the data exactly as it is stored in
+ * zsmalloc, i.e. over the compressed buffer, so a lookup never needs to
+ * decompress a candidate: compression is deterministic, so identical
+ * pages produce identical objects.
+ */
+u32 zram_dedup_checksum(const void *mem, unsigned int len)
+{
+	return jhash(mem, len, 0);
+}
+
+static struct zram_hash *zram_dedup_bucket(struct zram_meta *meta,
+				u32 checksum)
+{
+	return &meta->hash[checksum & (meta->hash_size - 1)];
+}
+
+static bool zram_dedup_match(struct zram_meta *meta,
+		struct zram_entry *entry, const void *mem, unsigned int len)
+{
+	void *cmem;
+	bool match;
+
+	cmem = zs_map_object(meta->mem_pool, entry->handle, ZS_MM_RO);
+	match = !memcmp(cmem, mem, len);
+	zs_unmap_object(meta->mem_pool, entry->handle);
+
+	return match;
+}
+
+/*
+ * Look for a stored object with the same content as @mem and take a
+ * reference to it. Returns NULL if there is none.
+ */
+struct zram_entry *zram_dedup_find(struct zram *zram, const void *mem,
+				unsigned int len, u32 checksum)
+{
+	struct zram_meta *meta = zram->meta;
+	struct zram_hash *hash = zram_dedup_bucket(meta, checksum);
+	struct zram_entry *entry;
+
+	spin_lock(&hash->lock);
+	hlist_for_each_entry(entry, &hash->head, node) {
+		if (entry->checksum != checksum || entry->len != len)
+			continue;
+
+		if (zram_dedup_match(meta, entry, mem, len)) {
+			entry->refcount++;
+			spin_unlock(&hash->lock);
+
+			atomic64_inc(&zram->stats.dedup_hits);
+			atomic64_add(len, &zram->stats.dup_data_size);
+			return entry;
+		}
+	}
+	spin_unlock(&hash->lock);
+
+	return NULL;
+}
+
+/*
+ * Make a freshly stored object available for sharing. The caller owns
+ * the initial reference. Returns NULL if no entry could be allocated,
+ * in which case the object just stays private to its table entry.
+ */
+struct zram_entry *zram_dedup_insert(struct zram *zram, unsigned long handle,
+				unsigned int len, u32 checksum)
+{
+	struct zram_meta *meta = zram->meta;
+	struct zram_hash *hash;
+	struct zram_entry *entry;
+
+	entry = kmem_cache_alloc(zram_entry_cache, GFP_NOIO | __GFP_NOWARN);
+	if (!entry)
+		return NULL;
+
+	entry->handle = handle;
+	entry->len = len;
+	entry->checksum = checksum;
+	entry->refcount = 1;
+
+	hash = zram_dedup_bucket(meta, checksum);
+	spin_lock(&hash->lock);
+	hlist_add_head(&entry->node, &hash->head);
+	spin_unlock(&hash->lock);
+
+	atomic64_add(sizeof(*entry), &zram->stats.meta_data_size);
+	return entry;
+}
+
+/* Whether other table entries refer to the object of @entry as well */
+bool zram_dedup_shared(struct zram *zram, struct zram_entry *entry)
+{
+	struct zram_hash *hash = zram_dedup_bucket(zram->meta,
+						entry->checksum);
+	bool shared;
+
+	spin_lock(&hash->lock);
+	shared = entry->refcount > 1;
+	spin_unlock(&hash->lock);
+
+	return shared;
+}
+
+/*
+ * Drop a reference. Returns true if it was the last one, in which case
+ * the entry is gone and the caller has to free the zsmalloc object.
+ */
+bool zram_dedup_put(struct zram *zram, struct zram_entry *entry)
+{
+	struct zram_hash *hash = zram_dedup_bucket(zram->meta,
+						entry->checksum);
+	unsigned long refcount;
+
+	spin_lock(&hash->lock);
+	refcount = --entry->refcount;
+	if (!refcount)
+		hlist_del(&entry->node);
+	spin_unlock(&hash->lock);
+
+	if (refcount) {
+		atomic64_sub(entry->len, &zram->stats.dup_data_size);
+		return false;
+	}
+
+	atomic64_sub(sizeof(*entry), &zram->stats.meta_data_size);
+	kmem_cache_free(zram_entry_cache, entry);
+	return true;
+}
+
+int zram_dedup_init(struct zram_meta *meta, size_t num_pages)
+{
+	size_t i;
+
+	mutex_lock(&zram_entry_cache_lock);
+	if (!zram_entry_cache_users) {
+		zram_entry_cache = KMEM_CACHE(zram_entry, 0);
+		if (!zram_entry_cache) {
+			mutex_unlock(&zram_entry_cache_lock);
+			return -ENOMEM;
+		}
+	}
+	zram_entry_cache_users++;
+	mutex_unlock(&zram_entry_cache_lock);
+
+	meta->hash_size = roundup_pow_of_two(clamp_t(size_t,
+			num_pages >> ZRAM_HASH_SHIFT,
+			ZRAM_HASH_SIZE_MIN, ZRAM_HASH_SIZE_MAX));
+	meta->hash = vzalloc(meta->hash_size * sizeof(struct zram_hash));
+	if (!meta->hash) {
+		pr_err("Error allocating zram entry hash\n");
+		meta->hash_size = 0;
+		zram_dedup_fini(meta);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < meta->hash_size; i++) {
+		spin_lock_init(&meta->hash[i].lock);
+		INIT_HLIST_HEAD(&meta->hash[i].head);
+	}
+
+	return 0;
+}
+
+/*
+ * Called on device reset, when no I/O can be in flight anymore. Frees
+ * every object still registered in the hash; zram_meta_free() skips the
+ * table entries referring to them.
+ */
+void zram_dedup_fini(struct zram_meta *meta)
+{
+	struct zram_entry *entry;
+	struct hlist_node *tmp;
+	size_t i;
+
+	for (i = 0; i < meta->hash_size; i++) {
+		hlist_for_each_entry_safe(entry, tmp, &meta->hash[i].head,
+					node) {
+			hlist_del(&entry->node);
+			zs_free(meta->mem_pool, entry->handle);
+			kmem_cache_free(zram_entry_cache, entry);
+		}
+	}
+
+	vfree(meta->hash);
+	meta->hash = NULL;
+	meta->hash_size = 0;
+
+	mutex_lock(&zram_entry_cache_lock);
+	if (!--zram_entry_cache_users) {
+		kmem_cache_destroy(zram_entry_cache);
+		zram_entry_cache = NULL;
+	}
+	mutex_unlock(&zram_entry_cache_lock);
+}
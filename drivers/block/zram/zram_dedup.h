@@ -0,0 +1,86 @@
+/*
+ * Same-content page deduplication for zram
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ */
+
+#ifndef _ZRAM_DEDUP_H_
+#define _ZRAM_DEDUP_H_
+
+struct zram;
+struct zram_meta;
+
+/*
+ * One zsmalloc object that may be shared by several table entries
+ * holding byte-identical data.
+ */
+struct zram_entry {
+	struct hlist_node node;
+	unsigned long handle;
+	unsigned int len;
+	u32 checksum;
+	/* protected by the hash bucket lock */
+	unsigned long refcount;
+};
+
+struct zram_hash {
+	spinlock_t lock;
+	struct hlist_head head;
+};
+
+#ifdef CONFIG_ZRAM_DEDUP
+u64 zram_dedup_dup_size(struct zram *zram);
+u64 zram_dedup_meta_size(struct zram *zram);
+
+u32 zram_dedup_checksum(const void *mem, unsigned int len);
+struct zram_entry *zram_dedup_find(struct zram *zram, const void *mem,
+				unsigned int len, u32 checksum);
+struct zram_entry *zram_dedup_insert(struct zram *zram, unsigned long handle,
+				unsigned int len, u32 checksum);
+bool zram_dedup_shared(struct zram *zram, struct zram_entry *entry);
+bool zram_dedup_put(struct zram *zram, struct zram_entry *entry);
+
+int zram_dedup_init(struct zram_meta *meta, size_t num_pages);
+void zram_dedup_fini(struct zram_meta *meta);
+#else
+
+static inline u64 zram_dedup_dup_size(struct zram *zram) { return 0; }
+static inline u64 zram_dedup_meta_size(struct zram *zram) { return 0; }
+
+static inline u32 zram_dedup_checksum(const void *mem, unsigned int len)
+{
+	return 0;
+}
+static inline struct zram_entry *zram_dedup_find(struct zram *zram,
+		const void *mem, unsigned int len, u32 checksum)
+{
+	return NULL;
+}
+static inline struct zram_entry *zram_dedup_insert(struct zram *zram,
+		unsigned long handle, unsigned int len, u32 checksum)
+{
+	return NULL;
+}
+static inline bool zram_dedup_shared(struct zram *zram,
+				struct zram_entry *entry)
+{
+	return false;
+}
+static inline bool zram_dedup_put(struct zram *zram,
+				struct zram_entry *entry)
+{
+	return true;
+}
+
+static inline int zram_dedup_init(struct zram_meta *meta, size_t num_pages)
+{
+	return 0;
+}
+static inline void zram_dedup_fini(struct zram_meta *meta) { }
+
+#endif
+
+#endif /* _ZRAM_DEDUP_H_ */
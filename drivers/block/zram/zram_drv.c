@@ -117,6 +117,41 @@ static void zram_set_obj_size(struct zram_meta *meta,
 	meta->table[index].value = (flags << ZRAM_FLAG_SHIFT) | size;
 }
 
+#ifdef CONFIG_ZRAM_DEDUP
+static bool zram_dedup_enabled(struct zram_meta *meta)
+{
+	return meta->hash;
+}
+
+static struct zram_entry *zram_get_entry(struct zram_meta *meta, u32 index)
+{
+	return meta->table[index].entry;
+}
+
+static void zram_set_entry(struct zram_meta *meta, u32 index,
+			struct zram_entry *entry)
+{
+	meta->table[index].entry = entry;
+}
+#else
+static inline bool zram_dedup_enabled(struct zram_meta *meta) { return false; }
+static inline struct zram_entry *zram_get_entry(struct zram_meta *meta,
+			u32 index)
+{
+	return NULL;
+}
+static inline void zram_set_entry(struct zram_meta *meta, u32 index,
+			struct zram_entry *entry) {}
+#endif
+
+/* the compressor a stored page has to be decompressed with */
+static struct zcomp *zram_get_comp(struct zram *zram, u32 index)
+{
+	if (zram_test_flag(zram->meta, index, ZRAM_RECOMP))
+		return zram->recomp;
+	return zram->comp;
+}
+
 static inline bool is_partial_io(struct bio_vec *bvec)
 {
 	return bvec->bv_len != PAGE_SIZE;
@@ -377,6 +412,94 @@ static ssize_t comp_algorithm_store(struct device *dev,
 	return len;
 }
 
+#ifdef CONFIG_ZRAM_DEDUP
+static ssize_t use_dedup_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	bool val;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	val = zram->use_dedup;
+	up_read(&zram->init_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", (int)val);
+}
+
+static ssize_t use_dedup_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	int val;
+	struct zram *zram = dev_to_zram(dev);
+
+	if (kstrtoint(buf, 10, &val) || (val != 0 && val != 1))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change dedup usage for initialized device\n");
+		return -EBUSY;
+	}
+	zram->use_dedup = val;
+	up_write(&zram->init_lock);
+	return len;
+}
+
+static bool zram_use_dedup(struct zram *zram)
+{
+	return zram->use_dedup;
+}
+#else
+static inline bool zram_use_dedup(struct zram *zram) { return false; }
+#endif
+
+static ssize_t recomp_algorithm_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	size_t sz;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	if (zram->recomp_algorithm[0])
+		sz = zcomp_available_show(zram->recomp_algorithm, buf);
+	else
+		sz = scnprintf(buf, PAGE_SIZE, "none\n");
+	up_read(&zram->init_lock);
+
+	return sz;
+}
+
+static ssize_t recomp_algorithm_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	char compressor[CRYPTO_MAX_ALG_NAME];
+	size_t sz;
+
+	strlcpy(compressor, buf, sizeof(compressor));
+	/* ignore trailing newline */
+	sz = strlen(compressor);
+	if (sz > 0 && compressor[sz - 1] == '\n')
+		compressor[sz - 1] = 0x00;
+
+	if (!strcmp(compressor, "none"))
+		compressor[0] = 0x00;
+	else if (!zcomp_available_algorithm(compressor))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change algorithm for initialized device\n");
+		return -EBUSY;
+	}
+
+	strlcpy(zram->recomp_algorithm, compressor, sizeof(compressor));
+	up_write(&zram->init_lock);
+	return len;
+}
+
 static ssize_t compact_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
@@ -400,15 +523,22 @@ static ssize_t io_stat_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
 	struct zram *zram = dev_to_zram(dev);
+	u64 bd_reads = 0, bd_writes = 0;
 	ssize_t ret;
 
 	down_read(&zram->init_lock);
+#ifdef CONFIG_ZRAM_WRITEBACK
+	bd_reads = atomic64_read(&zram->stats.bd_reads);
+	bd_writes = atomic64_read(&zram->stats.bd_writes);
+#endif
 	ret = scnprintf(buf, PAGE_SIZE,
-			"%8llu %8llu %8llu %8llu\n",
+			"%8llu %8llu %8llu %8llu %8llu %8llu\n",
 			(u64)atomic64_read(&zram->stats.failed_reads),
 			(u64)atomic64_read(&zram->stats.failed_writes),
 			(u64)atomic64_read(&zram->stats.invalid_io),
-			(u64)atomic64_read(&zram->stats.notify_free));
+			(u64)atomic64_read(&zram->stats.notify_free),
+			bd_reads,
+			bd_writes);
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -419,7 +549,7 @@ static ssize_t mm_stat_show(struct device *dev,
 {
 	struct zram *zram = dev_to_zram(dev);
 	struct zs_pool_stats pool_stats;
-	u64 orig_size, mem_used = 0;
+	u64 orig_size, mem_used = 0, bd_count = 0, dedup_hits = 0;
 	long max_used;
 	ssize_t ret;
 
@@ -433,16 +563,28 @@ static ssize_t mm_stat_show(struct device *dev,
 
 	orig_size = atomic64_read(&zram->stats.pages_stored);
 	max_used = atomic_long_read(&zram->stats.max_used_pages);
+#ifdef CONFIG_ZRAM_WRITEBACK
+	bd_count = atomic64_read(&zram->stats.bd_count);
+#endif
+
+#ifdef CONFIG_ZRAM_DEDUP
+	dedup_hits = atomic64_read(&zram->stats.dedup_hits);
+#endif
 
 	ret = scnprintf(buf, PAGE_SIZE,
-			"%8llu %8llu %8llu %8lu %8ld %8llu %8lu\n",
+			"%8llu %8llu %8llu %8lu %8ld %8llu %8lu %8llu"
+			" %8llu %8llu %8llu\n",
 			orig_size << PAGE_SHIFT,
 			(u64)atomic64_read(&zram->stats.compr_data_size),
 			mem_used << PAGE_SHIFT,
 			zram->limit_pages << PAGE_SHIFT,
 			max_used << PAGE_SHIFT,
 			(u64)atomic64_read(&zram->stats.zero_pages),
-			pool_stats.pages_compacted);
+			pool_stats.pages_compacted,
+			bd_count << PAGE_SHIFT,
+			zram_dedup_dup_size(zram),
+			zram_dedup_meta_size(zram),
+			dedup_hits);
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -498,12 +640,22 @@ static void zram_meta_free(struct zram_meta *meta, u64 disksize)
 	for (index = 0; index < num_pages; index++) {
 		unsigned long handle = meta->table[index].handle;
 
-		if (!handle)
+		/*
+		 * Written back pages only hold a backing device block,
+		 * which goes away together with the bitmap.
+		 */
+		if (!handle || zram_test_flag(meta, index, ZRAM_WB))
+			continue;
+
+		/* Shared objects are released by zram_dedup_fini() */
+		if (zram_get_entry(meta, index))
 			continue;
 
 		zs_free(meta->mem_pool, handle);
 	}
 
+	if (zram_dedup_enabled(meta))
+		zram_dedup_fini(meta);
 	zs_destroy_pool(meta->mem_pool);
 	vfree(meta->table);
 	kfree(meta);
@@ -512,7 +664,7 @@ static void zram_meta_free(struct zram_meta *meta, u64 disksize)
 static struct zram_meta *zram_meta_alloc(char *pool_name, u64 disksize)
 {
 	size_t num_pages;
-	struct zram_meta *meta = kmalloc(sizeof(*meta), GFP_KERNEL);
+	struct zram_meta *meta = kzalloc(sizeof(*meta), GFP_KERNEL);
 
 	if (!meta)
 		return NULL;
@@ -538,6 +690,117 @@ out_error:
 	return NULL;
 }
 
+#ifdef CONFIG_ZRAM_WRITEBACK
+/* Number of pages packed into a single bio by writeback_store() */
+#define ZRAM_WB_BATCH_PAGES	32
+
+static bool zram_wb_enabled(struct zram *zram)
+{
+	return zram->backing_dev;
+}
+
+/*
+ * Reserve @nr_pages contiguous blocks on the backing device. Block 0 is
+ * never handed out so that a zero handle keeps meaning "no data".
+ * Returns the first block index, or 0 if there is no such free range.
+ */
+static unsigned long alloc_block_bdev(struct zram *zram,
+				unsigned int nr_pages)
+{
+	unsigned long blk_idx;
+
+	spin_lock(&zram->bitmap_lock);
+	blk_idx = bitmap_find_next_zero_area(zram->bitmap, zram->nr_pages,
+					1, nr_pages, 0);
+	if (blk_idx + nr_pages > zram->nr_pages) {
+		spin_unlock(&zram->bitmap_lock);
+		return 0;
+	}
+	bitmap_set(zram->bitmap, blk_idx, nr_pages);
+	spin_unlock(&zram->bitmap_lock);
+
+	return blk_idx;
+}
+
+static void free_block_bdev(struct zram *zram, unsigned long blk_idx,
+				unsigned int nr_pages)
+{
+	spin_lock(&zram->bitmap_lock);
+	bitmap_clear(zram->bitmap, blk_idx, nr_pages);
+	spin_unlock(&zram->bitmap_lock);
+}
+
+static int read_from_bdev(struct zram *zram, struct page *page,
+				unsigned long blk_idx)
+{
+	struct bio *bio;
+	int ret;
+
+	bio = bio_alloc(GFP_NOIO, 1);
+	if (!bio)
+		return -ENOMEM;
+
+	bio->bi_iter.bi_sector = blk_idx * SECTORS_PER_PAGE;
+	bio->bi_bdev = zram->bdev;
+	if (!bio_add_page(bio, page, PAGE_SIZE, 0)) {
+		bio_put(bio);
+		return -EIO;
+	}
+
+	ret = submit_bio_wait(READ, bio);
+	bio_put(bio);
+	if (!ret)
+		atomic64_inc(&zram->stats.bd_reads);
+
+	return ret;
+}
+
+/*
+ * Fault a written back page in from the backing device into @mem.
+ * Must be called from a context that can sleep. Returns -EAGAIN if
+ * the slot is not (or no longer) stored on the backing device.
+ */
+static int zram_read_wb_page(struct zram *zram, char *mem, u32 index)
+{
+	struct zram_meta *meta = zram->meta;
+	unsigned long blk_idx;
+	struct page *page;
+	void *src;
+	int ret;
+
+	page = alloc_page(GFP_NOIO);
+	if (!page)
+		return -ENOMEM;
+
+	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+	if (!zram_test_flag(meta, index, ZRAM_WB)) {
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		__free_page(page);
+		return -EAGAIN;
+	}
+	blk_idx = meta->table[index].handle;
+	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+
+	ret = read_from_bdev(zram, page, blk_idx);
+	if (!ret) {
+		src = kmap_atomic(page);
+		memcpy(mem, src, PAGE_SIZE);
+		kunmap_atomic(src);
+	}
+	__free_page(page);
+
+	return ret;
+}
+#else
+static inline bool zram_wb_enabled(struct zram *zram) { return false; }
+static inline void free_block_bdev(struct zram *zram, unsigned long blk_idx,
+				unsigned int nr_pages) {}
+static int zram_read_wb_page(struct zram *zram, char *mem, u32 index)
+{
+	return -EIO;
+}
+#endif
+
 /*
  * To protect concurrent access to the same index entry,
  * caller should hold this table index entry's bit_spinlock to
@@ -547,6 +810,21 @@ static void zram_free_page(struct zram *zram, size_t index)
 {
 	struct zram_meta *meta = zram->meta;
 	unsigned long handle = meta->table[index].handle;
+	struct zram_entry *entry;
+
+	zram_clear_flag(meta, index, ZRAM_IDLE);
+	zram_clear_flag(meta, index, ZRAM_HUGE);
+	zram_clear_flag(meta, index, ZRAM_RECOMP);
+
+	if (zram_test_flag(meta, index, ZRAM_WB)) {
+		zram_clear_flag(meta, index, ZRAM_WB);
+		free_block_bdev(zram, handle, 1);
+#ifdef CONFIG_ZRAM_WRITEBACK
+		atomic64_dec(&zram->stats.bd_count);
+#endif
+		meta->table[index].handle = 0;
+		return;
+	}
 
 	if (unlikely(!handle)) {
 		/*
@@ -560,13 +838,16 @@ static void zram_free_page(struct zram *zram, size_t index)
 		return;
 	}
 
-	zs_free(meta->mem_pool, handle);
-
-	atomic64_sub(zram_get_obj_size(meta, index),
-			&zram->stats.compr_data_size);
+	entry = zram_get_entry(meta, index);
+	if (!entry || zram_dedup_put(zram, entry)) {
+		zs_free(meta->mem_pool, handle);
+		atomic64_sub(zram_get_obj_size(meta, index),
+				&zram->stats.compr_data_size);
+	}
 	atomic64_dec(&zram->stats.pages_stored);
 
 	meta->table[index].handle = 0;
+	zram_set_entry(meta, index, NULL);
 	zram_set_obj_size(meta, index, 0);
 }
 
@@ -588,14 +869,21 @@ static int zram_decompress_page(struct zram *zram, char *mem, u32 index)
 		return 0;
 	}
 
+	/* The caller has to fault it in with zram_read_wb_page() */
+	if (zram_test_flag(meta, index, ZRAM_WB)) {
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		return -EAGAIN;
+	}
+
 	cmem = zs_map_object(meta->mem_pool, handle, ZS_MM_RO);
 	if (size == PAGE_SIZE) {
 		memcpy(mem, cmem, PAGE_SIZE);
 	} else {
-		struct zcomp_strm *zstrm = zcomp_stream_get(zram->comp);
+		struct zcomp *comp = zram_get_comp(zram, index);
+		struct zcomp_strm *zstrm = zcomp_stream_get(comp);
 
- 		ret = zcomp_decompress(zstrm, cmem, size, mem);
-		zcomp_stream_put(zram->comp);
+		ret = zcomp_decompress(zstrm, cmem, size, mem);
+		zcomp_stream_put(comp);
 	}
 	zs_unmap_object(meta->mem_pool, handle);
 	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
@@ -609,6 +897,29 @@ static int zram_decompress_page(struct zram *zram, char *mem, u32 index)
 	return 0;
 }
 
+static int zram_bvec_read_wb(struct zram *zram, struct bio_vec *bvec,
+			  u32 index, int offset)
+{
+	int ret;
+	unsigned char *user_mem, *uncmem;
+
+	uncmem = kmalloc(PAGE_SIZE, GFP_NOIO);
+	if (!uncmem)
+		return -ENOMEM;
+
+	ret = zram_read_wb_page(zram, uncmem, index);
+	if (!ret) {
+		user_mem = kmap_atomic(bvec->bv_page);
+		memcpy(user_mem + bvec->bv_offset, uncmem + offset,
+				bvec->bv_len);
+		kunmap_atomic(user_mem);
+		flush_dcache_page(bvec->bv_page);
+	}
+	kfree(uncmem);
+
+	return ret;
+}
+
 static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 			  u32 index, int offset)
 {
@@ -616,17 +927,28 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 	struct page *page;
 	unsigned char *user_mem, *uncmem = NULL;
 	struct zram_meta *meta = zram->meta;
+	bool wb;
 	page = bvec->bv_page;
 
+again:
 	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+	zram_clear_flag(meta, index, ZRAM_IDLE);
 	if (unlikely(!meta->table[index].handle) ||
 			zram_test_flag(meta, index, ZRAM_ZERO)) {
 		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
 		handle_zero_page(bvec);
 		return 0;
 	}
+	wb = zram_test_flag(meta, index, ZRAM_WB);
 	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
 
+	if (unlikely(wb)) {
+		ret = zram_bvec_read_wb(zram, bvec, index, offset);
+		if (ret == -EAGAIN)
+			goto again;
+		return ret;
+	}
+
 	if (is_partial_io(bvec))
 		/* Use  a temporary buffer to decompress the page */
 		uncmem = kmalloc(PAGE_SIZE, GFP_NOIO);
@@ -656,6 +978,9 @@ out_cleanup:
 	kunmap_atomic(user_mem);
 	if (is_partial_io(bvec))
 		kfree(uncmem);
+	/* the page was written back after we dropped the slot lock */
+	if (unlikely(ret == -EAGAIN))
+		goto again;
 	return ret;
 }
 
@@ -669,8 +994,10 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 	unsigned char *user_mem, *cmem, *src, *uncmem = NULL;
 	struct zram_meta *meta = zram->meta;
 	struct zcomp_strm *zstrm = NULL;
+	struct zram_entry *entry = NULL;
 	unsigned long alloced_pages;
 	static unsigned long zram_rs_time;
+	u32 checksum = 0;
 
 	page = bvec->bv_page;
 	if (is_partial_io(bvec)) {
@@ -683,7 +1010,11 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 			ret = -ENOMEM;
 			goto out;
 		}
-		ret = zram_decompress_page(zram, uncmem, index);
+		do {
+			ret = zram_decompress_page(zram, uncmem, index);
+			if (ret == -EAGAIN)
+				ret = zram_read_wb_page(zram, uncmem, index);
+		} while (ret == -EAGAIN);
 		if (ret)
 			goto out;
 	}
@@ -733,6 +1064,28 @@ compress_again:
 			src = uncmem;
 	}
 
+	if (zram_dedup_enabled(meta)) {
+		void *data = src;
+
+		/* an uncompressed full page is stored from the bvec page */
+		if (clen == PAGE_SIZE && !is_partial_io(bvec))
+			data = kmap_atomic(page);
+		checksum = zram_dedup_checksum(data, clen);
+		entry = zram_dedup_find(zram, data, clen, checksum);
+		if (data != src)
+			kunmap_atomic(data);
+
+		if (entry) {
+			zcomp_stream_put(zram->comp);
+			zstrm = NULL;
+			/* coming from the slow path */
+			if (handle)
+				zs_free(meta->mem_pool, handle);
+			handle = entry->handle;
+			goto store;
+		}
+	}
+
 	/*
 	 * handle allocation has 2 paths:
 	 * a) fast path is executed with preemption disabled (for
@@ -795,6 +1148,11 @@ compress_again:
 	zstrm = NULL;
 	zs_unmap_object(meta->mem_pool, handle);
 
+	if (zram_dedup_enabled(meta))
+		entry = zram_dedup_insert(zram, handle, clen, checksum);
+	atomic64_add(clen, &zram->stats.compr_data_size);
+
+store:
 	/*
 	 * Free memory associated with this sector
 	 * before overwriting unused sectors.
@@ -803,11 +1161,13 @@ compress_again:
 	zram_free_page(zram, index);
 
 	meta->table[index].handle = handle;
+	zram_set_entry(meta, index, entry);
 	zram_set_obj_size(meta, index, clen);
+	if (clen == PAGE_SIZE)
+		zram_set_flag(meta, index, ZRAM_HUGE);
 	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
 
 	/* Update stats */
-	atomic64_add(clen, &zram->stats.compr_data_size);
 	atomic64_inc(&zram->stats.pages_stored);
 out:
 	if (zstrm)
@@ -856,6 +1216,535 @@ static void zram_bio_discard(struct zram *zram, u32 index,
 	}
 }
 
+#ifdef CONFIG_ZRAM_WRITEBACK
+static void reset_bdev(struct zram *zram)
+{
+	struct block_device *bdev;
+
+	if (!zram_wb_enabled(zram))
+		return;
+
+	bdev = zram->bdev;
+	if (zram->old_block_size)
+		set_blocksize(bdev, zram->old_block_size);
+	blkdev_put(bdev, FMODE_READ|FMODE_WRITE|FMODE_EXCL);
+	/* hope filp_close flush all of IO */
+	filp_close(zram->backing_dev, NULL);
+	zram->backing_dev = NULL;
+	zram->old_block_size = 0;
+	zram->bdev = NULL;
+
+	vfree(zram->bitmap);
+	zram->bitmap = NULL;
+	zram->nr_pages = 0;
+}
+
+static ssize_t backing_dev_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	struct file *file;
+	char *p;
+	ssize_t ret;
+
+	down_read(&zram->init_lock);
+	file = zram->backing_dev;
+	if (!file) {
+		memcpy(buf, "none\n", 5);
+		up_read(&zram->init_lock);
+		return 5;
+	}
+
+	p = d_path(&file->f_path, buf, PAGE_SIZE - 1);
+	if (IS_ERR(p)) {
+		ret = PTR_ERR(p);
+		goto out;
+	}
+
+	ret = strlen(p);
+	memmove(buf, p, ret);
+	buf[ret++] = '\n';
+out:
+	up_read(&zram->init_lock);
+	return ret;
+}
+
+static ssize_t backing_dev_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	char *file_name;
+	size_t sz;
+	struct file *backing_dev = NULL;
+	struct inode *inode;
+	struct address_space *mapping;
+	unsigned int bitmap_sz, old_block_size = 0;
+	unsigned long nr_pages, *bitmap = NULL;
+	struct block_device *bdev = NULL;
+	int err;
+	struct zram *zram = dev_to_zram(dev);
+
+	file_name = kmalloc(PATH_MAX, GFP_KERNEL);
+	if (!file_name)
+		return -ENOMEM;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		pr_info("Can't setup backing device for initialized device\n");
+		err = -EBUSY;
+		goto out;
+	}
+
+	strlcpy(file_name, buf, PATH_MAX);
+	/* ignore trailing newline */
+	sz = strlen(file_name);
+	if (sz > 0 && file_name[sz - 1] == '\n')
+		file_name[sz - 1] = 0x00;
+
+	backing_dev = filp_open(file_name, O_RDWR|O_LARGEFILE, 0);
+	if (IS_ERR(backing_dev)) {
+		err = PTR_ERR(backing_dev);
+		backing_dev = NULL;
+		goto out;
+	}
+
+	mapping = backing_dev->f_mapping;
+	inode = mapping->host;
+
+	/*
+	 * Only block devices are supported; a regular file can be used
+	 * by putting a loop device on top of it.
+	 */
+	if (!S_ISBLK(inode->i_mode)) {
+		err = -ENOTBLK;
+		goto out;
+	}
+
+	bdev = bdgrab(I_BDEV(inode));
+	err = blkdev_get(bdev, FMODE_READ | FMODE_WRITE | FMODE_EXCL, zram);
+	if (err < 0) {
+		bdev = NULL;
+		goto out;
+	}
+
+	nr_pages = i_size_read(inode) >> PAGE_SHIFT;
+	bitmap_sz = BITS_TO_LONGS(nr_pages) * sizeof(long);
+	bitmap = vzalloc(bitmap_sz);
+	if (!bitmap) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	old_block_size = block_size(bdev);
+	err = set_blocksize(bdev, PAGE_SIZE);
+	if (err)
+		goto out;
+
+	reset_bdev(zram);
+	spin_lock_init(&zram->bitmap_lock);
+
+	zram->old_block_size = old_block_size;
+	zram->bdev = bdev;
+	zram->backing_dev = backing_dev;
+	zram->bitmap = bitmap;
+	zram->nr_pages = nr_pages;
+	up_write(&zram->init_lock);
+
+	pr_info("setup backing device %s\n", file_name);
+	kfree(file_name);
+
+	return len;
+out:
+	if (bitmap)
+		vfree(bitmap);
+
+	if (bdev)
+		blkdev_put(bdev, FMODE_READ | FMODE_WRITE | FMODE_EXCL);
+
+	if (backing_dev)
+		filp_close(backing_dev, NULL);
+
+	up_write(&zram->init_lock);
+
+	kfree(file_name);
+
+	return err;
+}
+
+static ssize_t idle_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	struct zram_meta *meta;
+	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
+	unsigned long index;
+
+	if (!sysfs_streq(buf, "all"))
+		return -EINVAL;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram)) {
+		up_read(&zram->init_lock);
+		return -EINVAL;
+	}
+
+	meta = zram->meta;
+	for (index = 0; index < nr_pages; index++) {
+		/*
+		 * Do not mark ZRAM_UNDER_WB slot as ZRAM_IDLE to close race.
+		 * See the comment in writeback_store.
+		 */
+		bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+		if (meta->table[index].handle &&
+				!zram_test_flag(meta, index, ZRAM_WB) &&
+				!zram_test_flag(meta, index, ZRAM_UNDER_WB))
+			zram_set_flag(meta, index, ZRAM_IDLE);
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+	}
+
+	up_read(&zram->init_lock);
+
+	return len;
+}
+
+/*
+ * Write @nr_pages decompressed pages out to consecutive blocks of the
+ * backing device starting at @blk_idx with a single bio.
+ */
+static int write_to_bdev(struct zram *zram, struct page **pages,
+			unsigned int nr_pages, unsigned long blk_idx)
+{
+	struct bio *bio;
+	unsigned int i;
+	int ret;
+
+	bio = bio_alloc(GFP_KERNEL, nr_pages);
+	if (!bio)
+		return -ENOMEM;
+
+	bio->bi_iter.bi_sector = blk_idx * SECTORS_PER_PAGE;
+	bio->bi_bdev = zram->bdev;
+	for (i = 0; i < nr_pages; i++) {
+		if (!bio_add_page(bio, pages[i], PAGE_SIZE, 0)) {
+			bio_put(bio);
+			return -EIO;
+		}
+	}
+
+	ret = submit_bio_wait(WRITE | REQ_SYNC, bio);
+	bio_put(bio);
+	if (!ret)
+		atomic64_add(nr_pages, &zram->stats.bd_writes);
+
+	return ret;
+}
+
+/*
+ * Submit one batch collected by writeback_store() and swap the zsmalloc
+ * objects of the slots that stayed idle for their backing device blocks.
+ * Slots which were accessed or freed meanwhile keep their in-memory copy.
+ */
+static int zram_writeback_batch(struct zram *zram, struct page **pages,
+			u32 *indices, unsigned int nr_pages)
+{
+	struct zram_meta *meta = zram->meta;
+	unsigned long blk_idx;
+	unsigned int i;
+	int ret;
+
+	blk_idx = alloc_block_bdev(zram, nr_pages);
+	if (blk_idx) {
+		ret = write_to_bdev(zram, pages, nr_pages, blk_idx);
+		if (ret) {
+			free_block_bdev(zram, blk_idx, nr_pages);
+			blk_idx = 0;
+		}
+	} else {
+		ret = -ENOSPC;
+	}
+
+	for (i = 0; i < nr_pages; i++) {
+		u32 index = indices[i];
+
+		bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+		if (!blk_idx) {
+			zram_clear_flag(meta, index, ZRAM_UNDER_WB);
+			zram_clear_flag(meta, index, ZRAM_IDLE);
+			bit_spin_unlock(ZRAM_ACCESS,
+					&meta->table[index].value);
+			continue;
+		}
+
+		/*
+		 * We released the slot lock during the IO, so the slot
+		 * could have been freed or accessed. Either way ZRAM_IDLE
+		 * is gone and the block we wrote is stale.
+		 */
+		if (!zram_test_flag(meta, index, ZRAM_UNDER_WB) ||
+				!zram_test_flag(meta, index, ZRAM_IDLE)) {
+			zram_clear_flag(meta, index, ZRAM_UNDER_WB);
+			bit_spin_unlock(ZRAM_ACCESS,
+					&meta->table[index].value);
+			free_block_bdev(zram, blk_idx + i, 1);
+			continue;
+		}
+
+		zram_free_page(zram, index);
+		zram_clear_flag(meta, index, ZRAM_UNDER_WB);
+		zram_set_flag(meta, index, ZRAM_WB);
+		meta->table[index].handle = blk_idx + i;
+		atomic64_inc(&zram->stats.bd_count);
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+	}
+
+	return ret;
+}
+
+#define IDLE_WRITEBACK	(1 << 0)
+#define HUGE_WRITEBACK	(1 << 1)
+
+static ssize_t writeback_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	struct zram_meta *meta;
+	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
+	struct page *pages[ZRAM_WB_BATCH_PAGES] = { NULL };
+	u32 indices[ZRAM_WB_BATCH_PAGES];
+	unsigned int nr_batch = 0;
+	unsigned long index;
+	ssize_t ret = len;
+	int mode, err, i;
+
+	if (sysfs_streq(buf, "idle"))
+		mode = IDLE_WRITEBACK;
+	else if (sysfs_streq(buf, "huge"))
+		mode = HUGE_WRITEBACK;
+	else
+		return -EINVAL;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram)) {
+		ret = -EINVAL;
+		goto release_init_lock;
+	}
+
+	if (!zram_wb_enabled(zram)) {
+		ret = -ENODEV;
+		goto release_init_lock;
+	}
+
+	for (i = 0; i < ZRAM_WB_BATCH_PAGES; i++) {
+		pages[i] = alloc_page(GFP_KERNEL);
+		if (!pages[i]) {
+			ret = -ENOMEM;
+			goto free_pages;
+		}
+	}
+
+	meta = zram->meta;
+	for (index = 0; index < nr_pages; index++) {
+		void *mem;
+
+		bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+		if (!meta->table[index].handle ||
+				zram_test_flag(meta, index, ZRAM_ZERO) ||
+				zram_test_flag(meta, index, ZRAM_WB) ||
+				zram_test_flag(meta, index, ZRAM_UNDER_WB))
+			goto next;
+
+		if ((mode & IDLE_WRITEBACK &&
+			  !zram_test_flag(meta, index, ZRAM_IDLE)) ||
+		    (mode & HUGE_WRITEBACK &&
+			  !zram_test_flag(meta, index, ZRAM_HUGE)))
+			goto next;
+		/*
+		 * Clearing ZRAM_UNDER_WB is duty of caller.
+		 * IOW, zram_free_page never clear it.
+		 */
+		zram_set_flag(meta, index, ZRAM_UNDER_WB);
+		/* Need for hugepage writeback racing */
+		zram_set_flag(meta, index, ZRAM_IDLE);
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+
+		mem = kmap(pages[nr_batch]);
+		err = zram_decompress_page(zram, mem, index);
+		kunmap(pages[nr_batch]);
+		if (err) {
+			bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+			zram_clear_flag(meta, index, ZRAM_UNDER_WB);
+			zram_clear_flag(meta, index, ZRAM_IDLE);
+			bit_spin_unlock(ZRAM_ACCESS,
+					&meta->table[index].value);
+			continue;
+		}
+
+		indices[nr_batch++] = index;
+		if (nr_batch == ZRAM_WB_BATCH_PAGES) {
+			err = zram_writeback_batch(zram, pages, indices,
+						nr_batch);
+			nr_batch = 0;
+			if (err) {
+				ret = err;
+				break;
+			}
+		}
+		continue;
+next:
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+	}
+
+	if (nr_batch) {
+		err = zram_writeback_batch(zram, pages, indices, nr_batch);
+		if (err)
+			ret = err;
+	}
+
+free_pages:
+	for (i = 0; i < ZRAM_WB_BATCH_PAGES; i++)
+		if (pages[i])
+			__free_page(pages[i]);
+release_init_lock:
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+#else
+static inline void reset_bdev(struct zram *zram) {}
+#endif
+
+#define RECOMP_IDLE	(1 << 0)
+#define RECOMP_HUGE	(1 << 1)
+
+/*
+ * Re-encode one stored page with the secondary algorithm and keep the
+ * result only if it is smaller. @mem is a PAGE_SIZE scratch buffer.
+ * The slot lock is held throughout, so nothing can sneak in between
+ * reading the old object and replacing it; zs_malloc() therefore must
+ * not sleep and a failed allocation just skips the page.
+ */
+static void zram_recompress_page(struct zram *zram, u32 index, int mode,
+				void *mem)
+{
+	struct zram_meta *meta = zram->meta;
+	struct zcomp_strm *zstrm;
+	struct zram_entry *entry;
+	unsigned long handle, new_handle;
+	unsigned int size, new_size;
+	void *cmem;
+	int ret;
+
+	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+	handle = meta->table[index].handle;
+	if (!handle ||
+			zram_test_flag(meta, index, ZRAM_ZERO) ||
+			zram_test_flag(meta, index, ZRAM_WB) ||
+			zram_test_flag(meta, index, ZRAM_UNDER_WB) ||
+			zram_test_flag(meta, index, ZRAM_RECOMP))
+		goto out;
+
+	if ((mode & RECOMP_IDLE) && !zram_test_flag(meta, index, ZRAM_IDLE))
+		goto out;
+	if ((mode & RECOMP_HUGE) && !zram_test_flag(meta, index, ZRAM_HUGE))
+		goto out;
+
+	/* recompressing a shared object would duplicate it */
+	entry = zram_get_entry(meta, index);
+	if (entry && zram_dedup_shared(zram, entry))
+		goto out;
+
+	size = zram_get_obj_size(meta, index);
+	cmem = zs_map_object(meta->mem_pool, handle, ZS_MM_RO);
+	if (size == PAGE_SIZE) {
+		memcpy(mem, cmem, PAGE_SIZE);
+		ret = 0;
+	} else {
+		zstrm = zcomp_stream_get(zram->comp);
+		ret = zcomp_decompress(zstrm, cmem, size, mem);
+		zcomp_stream_put(zram->comp);
+	}
+	zs_unmap_object(meta->mem_pool, handle);
+	if (ret)
+		goto out;
+
+	zstrm = zcomp_stream_get(zram->recomp);
+	ret = zcomp_compress(zstrm, mem, &new_size);
+	if (ret || new_size >= size || new_size > max_zpage_size)
+		goto out_put;
+
+	new_handle = zs_malloc(meta->mem_pool, new_size,
+			__GFP_NOWARN | __GFP_HIGHMEM | __GFP_MOVABLE);
+	if (!new_handle)
+		goto out_put;
+
+	cmem = zs_map_object(meta->mem_pool, new_handle, ZS_MM_WO);
+	memcpy(cmem, zstrm->buffer, new_size);
+	zs_unmap_object(meta->mem_pool, new_handle);
+	zcomp_stream_put(zram->recomp);
+
+	if (!entry || zram_dedup_put(zram, entry)) {
+		zs_free(meta->mem_pool, handle);
+		atomic64_sub(size, &zram->stats.compr_data_size);
+	}
+	atomic64_add(new_size, &zram->stats.compr_data_size);
+
+	meta->table[index].handle = new_handle;
+	zram_set_entry(meta, index, NULL);
+	zram_set_obj_size(meta, index, new_size);
+	zram_clear_flag(meta, index, ZRAM_HUGE);
+	zram_set_flag(meta, index, ZRAM_RECOMP);
+	goto out;
+
+out_put:
+	zcomp_stream_put(zram->recomp);
+out:
+	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+}
+
+static ssize_t recompress_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
+	unsigned long index;
+	ssize_t ret = len;
+	void *mem;
+	int mode;
+
+	if (sysfs_streq(buf, "idle"))
+		mode = RECOMP_IDLE;
+	else if (sysfs_streq(buf, "huge"))
+		mode = RECOMP_HUGE;
+	else if (sysfs_streq(buf, "all"))
+		mode = 0;
+	else
+		return -EINVAL;
+
+	mem = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!mem)
+		return -ENOMEM;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (!zram->recomp) {
+		ret = -ENODEV;
+		goto out;
+	}
+
+	for (index = 0; index < nr_pages; index++) {
+		zram_recompress_page(zram, index, mode, mem);
+		cond_resched();
+	}
+out:
+	up_read(&zram->init_lock);
+	kfree(mem);
+
+	return ret;
+}
+
 static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
 			int offset, int rw)
 {
@@ -1024,7 +1913,7 @@ out:
 static void zram_reset_device(struct zram *zram)
 {
 	struct zram_meta *meta;
-	struct zcomp *comp;
+	struct zcomp *comp, *recomp;
 	u64 disksize;
 
 	down_write(&zram->init_lock);
@@ -1038,6 +1927,8 @@ static void zram_reset_device(struct zram *zram)
 
 	meta = zram->meta;
 	comp = zram->comp;
+	recomp = zram->recomp;
+	zram->recomp = NULL;
 	disksize = zram->disksize;
 	/*
 	 * Refcount will go down to 0 eventually and r/w handler
@@ -1054,6 +1945,7 @@ static void zram_reset_device(struct zram *zram)
 	/* Reset stats */
 	memset(&zram->stats, 0, sizeof(zram->stats));
 	zram->disksize = 0;
+	reset_bdev(zram);
 
 	set_capacity(zram->disk, 0);
 	part_stat_set_all(&zram->disk->part0, 0);
@@ -1062,13 +1954,15 @@ static void zram_reset_device(struct zram *zram)
 	/* I/O operation under all of CPU are done so let's free */
 	zram_meta_free(meta, disksize);
 	zcomp_destroy(comp);
+	if (recomp)
+		zcomp_destroy(recomp);
 }
 
 static ssize_t disksize_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
 	u64 disksize;
-	struct zcomp *comp;
+	struct zcomp *comp, *recomp = NULL;
 	struct zram_meta *meta;
 	struct zram *zram = dev_to_zram(dev);
 	int err;
@@ -1082,6 +1976,12 @@ static ssize_t disksize_store(struct device *dev,
 	if (!meta)
 		return -ENOMEM;
 
+	if (zram_use_dedup(zram)) {
+		err = zram_dedup_init(meta, disksize >> PAGE_SHIFT);
+		if (err)
+			goto out_free_meta;
+	}
+
 	comp = zcomp_create(zram->compressor);
 	if (IS_ERR(comp)) {
 		pr_err("Cannot initialise %s compressing backend\n",
@@ -1090,6 +1990,17 @@ static ssize_t disksize_store(struct device *dev,
 		goto out_free_meta;
 	}
 
+	if (zram->recomp_algorithm[0]) {
+		recomp = zcomp_create(zram->recomp_algorithm);
+		if (IS_ERR(recomp)) {
+			pr_err("Cannot initialise %s compressing backend\n",
+					zram->recomp_algorithm);
+			err = PTR_ERR(recomp);
+			recomp = NULL;
+			goto out_destroy_comp_unlocked;
+		}
+	}
+
 	down_write(&zram->init_lock);
 	if (init_done(zram)) {
 		pr_info("Cannot change disksize for initialized device\n");
@@ -1101,6 +2012,7 @@ static ssize_t disksize_store(struct device *dev,
 	atomic_set(&zram->refcount, 1);
 	zram->meta = meta;
 	zram->comp = comp;
+	zram->recomp = recomp;
 	zram->disksize = disksize;
 	set_capacity(zram->disk, zram->disksize >> SECTOR_SHIFT);
 	up_write(&zram->init_lock);
@@ -1116,6 +2028,9 @@ static ssize_t disksize_store(struct device *dev,
 
 out_destroy_comp:
 	up_write(&zram->init_lock);
+out_destroy_comp_unlocked:
+	if (recomp)
+		zcomp_destroy(recomp);
 	zcomp_destroy(comp);
 out_free_meta:
 	zram_meta_free(meta, disksize);
@@ -1199,6 +2114,16 @@ static DEVICE_ATTR_RW(mem_limit);
 static DEVICE_ATTR_RW(mem_used_max);
 static DEVICE_ATTR_RW(max_comp_streams);
 static DEVICE_ATTR_RW(comp_algorithm);
+static DEVICE_ATTR_RW(recomp_algorithm);
+static DEVICE_ATTR_WO(recompress);
+#ifdef CONFIG_ZRAM_DEDUP
+static DEVICE_ATTR_RW(use_dedup);
+#endif
+#ifdef CONFIG_ZRAM_WRITEBACK
+static DEVICE_ATTR_RW(backing_dev);
+static DEVICE_ATTR_WO(idle);
+static DEVICE_ATTR_WO(writeback);
+#endif
 
 static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_disksize.attr,
@@ -1219,6 +2144,16 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_mem_used_max.attr,
 	&dev_attr_max_comp_streams.attr,
 	&dev_attr_comp_algorithm.attr,
+	&dev_attr_recomp_algorithm.attr,
+	&dev_attr_recompress.attr,
+#ifdef CONFIG_ZRAM_DEDUP
+	&dev_attr_use_dedup.attr,
+#endif
+#ifdef CONFIG_ZRAM_WRITEBACK
+	&dev_attr_backing_dev.attr,
+	&dev_attr_idle.attr,
+	&dev_attr_writeback.attr,
+#endif
 	&dev_attr_io_stat.attr,
 	&dev_attr_mm_stat.attr,
 	&dev_attr_debug_stat.attr,
@@ -50,6 +50,13 @@
 #include <soc/qcom/ramdump.h>
 #include <linux/workqueue.h>
 #include <linux/wait.h>
+#include <linux/shrinker.h>
+#include <linux/poll.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/trace_adsprpc.h>
 
 
 #define TZ_PIL_PROTECT_MEM_SUBSYS_ID 0x0C
@@ -73,6 +80,10 @@
 
 #define IS_CACHE_ALIGNED(x) (((x) & ((L1_CACHE_BYTES)-1)) == 0)
 #define FASTRPC_STATIC_HANDLE_KERNEL (1)
+/* idle invoke mappings kept per file, see fastrpc_mmap_free() */
+#define FASTRPC_MAP_LRU_MAX (64)
+/* async jobs one file may have in flight */
+#define FASTRPC_ASYNC_MAX (64)
 
 static void file_free_work_handler(struct work_struct *w);
 
@@ -167,6 +178,12 @@ struct smq_invoke_ctx {
 	struct smq_msg msg;
 	unsigned int magic;
 	uint64_t ctxid;
+	remote_arg_t *upra;
+	uint64_t jobid;
+	bool async;
+	struct list_head async_node;
+	bool timed;
+	uint64_t rsp_ns;
 };
 
 struct fastrpc_ctx_lst {
@@ -252,6 +269,18 @@ struct fastrpc_mmap {
 	uintptr_t raddr;
 	int uncached;
 	bool is_filemap; /*flag to indicate map used in process init*/
+	struct list_head lru;
+};
+
+/* time spent in each phase of fastrpc_internal_invoke(), in ns */
+struct fastrpc_perf {
+	uint64_t count;
+	uint64_t getargs;	/* context setup and argument marshalling */
+	uint64_t invargs;	/* cache maintenance before and after send */
+	uint64_t link;		/* handing the message to smd/glink */
+	uint64_t dsp;		/* send until the response arrives */
+	uint64_t wakeup;	/* response until the caller runs again */
+	uint64_t putargs;	/* copying results back */
 };
 
 struct fastrpc_file {
@@ -269,10 +298,26 @@ struct fastrpc_file {
 	int ssrcount;
 	struct fastrpc_apps *apps;
 	struct mutex map_mutex;
+	struct list_head map_lru;
+	int map_lru_count;
+	bool map_lru_off;
+	spinlock_t async_lock;
+	struct list_head async_done;
+	wait_queue_head_t async_wq;
+	uint64_t async_seq;
+	int async_count;
+	struct fastrpc_perf perf;
 };
 
 static struct fastrpc_apps gfa;
 
+/* set through debugfs, see fastrpc_debugfs_init() */
+static u32 fastrpc_perf_enable;
+static struct dentry *fastrpc_debugfs_root;
+
+/* keeps files on gfa.drivers alive while the shrinker releases their maps */
+static DEFINE_MUTEX(fastrpc_map_lru_mutex);
+
 static struct fastrpc_channel_ctx gcinfo[NUM_CHANNELS] = {
 	{
 		.name = "adsprpc-smd",
@@ -389,11 +434,67 @@ static void fastrpc_mmap_add(struct fastrpc_mmap *map)
 	}
 }
 
+static void fastrpc_mmap_release(struct fastrpc_mmap *map);
+
+static void fastrpc_mmap_lru_del(struct fastrpc_file *fl,
+				 struct fastrpc_mmap *map)
+{
+	list_del_init(&map->lru);
+	fl->map_lru_count--;
+}
+
+/*
+ * Keep an idle invoke mapping around so the next invoke with the same
+ * buffer skips the attach, SMMU map and hyp assign. Called with fl->hlock
+ * held; returns the least recently used entry if the LRU overflowed.
+ */
+static struct fastrpc_mmap *fastrpc_mmap_lru_add(struct fastrpc_file *fl,
+						 struct fastrpc_mmap *map)
+{
+	struct fastrpc_mmap *victim;
+
+	list_add(&map->lru, &fl->map_lru);
+	fl->map_lru_count++;
+	if (fl->map_lru_count <= FASTRPC_MAP_LRU_MAX)
+		return NULL;
+
+	victim = list_entry(fl->map_lru.prev, struct fastrpc_mmap, lru);
+	fastrpc_mmap_lru_del(fl, victim);
+	hlist_del_init(&victim->hn);
+	return victim;
+}
+
+static unsigned long fastrpc_mmap_lru_evict(struct fastrpc_file *fl,
+					    unsigned long nr)
+{
+	struct fastrpc_mmap *map;
+	unsigned long freed = 0;
+
+	while (freed < nr) {
+		map = NULL;
+		spin_lock(&fl->hlock);
+		if (!list_empty(&fl->map_lru)) {
+			map = list_entry(fl->map_lru.prev, struct fastrpc_mmap,
+					 lru);
+			fastrpc_mmap_lru_del(fl, map);
+			hlist_del_init(&map->hn);
+		}
+		spin_unlock(&fl->hlock);
+		if (!map)
+			break;
+		fastrpc_mmap_release(map);
+		freed++;
+	}
+	return freed;
+}
+
 static int fastrpc_mmap_find(struct fastrpc_file *fl, int fd, uintptr_t va,
 			size_t len, int mflags, struct fastrpc_mmap **ppmap)
 {
 	struct fastrpc_apps *me = &gfa;
 	struct fastrpc_mmap *match = NULL, *map = NULL;
+	struct fastrpc_mmap *stale = NULL;
+	struct dma_buf *buf;
 	struct hlist_node *n;
 	if ((va + len) < va)
 		return -EOVERFLOW;
@@ -414,21 +515,43 @@ static int fastrpc_mmap_find(struct fastrpc_file *fl, int fd, uintptr_t va,
 		}
 		spin_unlock(&me->hlock);
 	} else {
+		/*
+		 * The fd may have been closed and reused for another buffer
+		 * since the map was made, so match on the dma_buf as well.
+		 */
+		buf = dma_buf_get(fd);
+		if (IS_ERR_OR_NULL(buf))
+			return -ENOTTY;
 		spin_lock(&fl->hlock);
 		hlist_for_each_entry_safe(map, n, &fl->maps, hn) {
 			if (va >= map->va &&
 				va + len <= map->va + map->len &&
 				map->fd == fd) {
+				if (map->buf != buf) {
+					/* drop one stale idle map */
+					if (!map->refs && !stale) {
+						fastrpc_mmap_lru_del(fl, map);
+						hlist_del_init(&map->hn);
+						stale = map;
+					}
+					continue;
+				}
 				if (map->refs + 1 == INT_MAX) {
 					spin_unlock(&fl->hlock);
+					dma_buf_put(buf);
 					return -ETOOMANYREFS;
 				}
+				if (!map->refs)
+					fastrpc_mmap_lru_del(fl, map);
 				map->refs++;
 				match = map;
 				break;
 			}
 		}
 		spin_unlock(&fl->hlock);
+		dma_buf_put(buf);
+		if (stale)
+			fastrpc_mmap_release(stale);
 	}
 	if (match) {
 		*ppmap = match;
@@ -503,7 +626,6 @@ static void fastrpc_mmap_free(struct fastrpc_mmap *map)
 {
 	struct fastrpc_apps *me = &gfa;
 	struct fastrpc_file *fl;
-	int vmid;
 
 	if (!map)
 		return;
@@ -517,12 +639,36 @@ static void fastrpc_mmap_free(struct fastrpc_mmap *map)
 	} else {
 		spin_lock(&fl->hlock);
 		map->refs--;
+		/*
+		 * Only maps made for invoke arguments are cached: mappings
+		 * set up on the DSP, process init maps and maps already
+		 * unlinked by munmap go away at once.
+		 */
+		if (!map->refs && !fl->map_lru_off && !map->raddr &&
+		    !map->is_filemap && !hlist_unhashed(&map->hn)) {
+			struct fastrpc_mmap *victim;
+
+			victim = fastrpc_mmap_lru_add(fl, map);
+			spin_unlock(&fl->hlock);
+			if (victim)
+				fastrpc_mmap_release(victim);
+			return;
+		}
 		if (!map->refs)
 			hlist_del_init(&map->hn);
 		spin_unlock(&fl->hlock);
 	}
 	if (map->refs > 0)
 		return;
+	fastrpc_mmap_release(map);
+}
+
+static void fastrpc_mmap_release(struct fastrpc_mmap *map)
+{
+	struct fastrpc_apps *me = &gfa;
+	struct fastrpc_file *fl = map->fl;
+	int vmid;
+
 	if (map->flags == ADSP_MMAP_HEAP_ADDR) {
 		DEFINE_DMA_ATTRS(attrs);
 
@@ -589,6 +735,7 @@ static int fastrpc_mmap_create(struct fastrpc_file *fl, int fd, uintptr_t va,
 	map->flags = mflags;
 	map->refs = 1;
 	INIT_HLIST_NODE(&map->hn);
+	INIT_LIST_HEAD(&map->lru);
 	map->fl = fl;
 	map->fd = fd;
 	map->is_filemap = false;
@@ -892,6 +1039,7 @@ static int context_alloc(struct fastrpc_file *fl, uint32_t kernel,
 
 	INIT_HLIST_NODE(&ctx->hn);
 	hlist_add_fake(&ctx->hn);
+	INIT_LIST_HEAD(&ctx->async_node);
 	ctx->fl = fl;
 	ctx->maps = (struct fastrpc_mmap **)(&ctx[1]);
 	ctx->lpra = (remote_arg_t *)(&ctx->maps[bufs]);
@@ -969,6 +1117,13 @@ static void context_free(struct smq_invoke_ctx *ctx)
 	spin_lock(&ctx->fl->hlock);
 	hlist_del_init(&ctx->hn);
 	spin_unlock(&ctx->fl->hlock);
+	if (ctx->async) {
+		unsigned long flags;
+
+		spin_lock_irqsave(&ctx->fl->async_lock, flags);
+		list_del_init(&ctx->async_node);
+		spin_unlock_irqrestore(&ctx->fl->async_lock, flags);
+	}
 	for (i = 0; i < nbufs; ++i)
 		fastrpc_mmap_free(ctx->maps[i]);
 	fastrpc_buf_free(ctx->buf, 1);
@@ -987,10 +1142,37 @@ static void context_free(struct smq_invoke_ctx *ctx)
 	kfree(ctx);
 }
 
+/*
+ * Deliver the response of a job: complete it for the synchronous waiter, or
+ * hand an async job to the file's completion queue.  The choice is made
+ * under async_lock, which fastrpc_internal_invoke_async() also holds to arm
+ * a job, so exactly one side queues it.  Either way the ctx may be freed as
+ * soon as it is completed or queued, so only the file is touched afterwards.
+ */
+static void context_complete(struct smq_invoke_ctx *ctx)
+{
+	struct fastrpc_file *fl = ctx->fl;
+	unsigned long flags;
+	bool async;
+
+	spin_lock_irqsave(&fl->async_lock, flags);
+	async = ctx->async;
+	if (!async)
+		complete(&ctx->work);
+	else if (list_empty(&ctx->async_node))
+		list_add_tail(&ctx->async_node, &fl->async_done);
+	spin_unlock_irqrestore(&fl->async_lock, flags);
+	if (async)
+		wake_up_interruptible(&fl->async_wq);
+}
+
 static void context_notify_user(struct smq_invoke_ctx *ctx, int retval)
 {
+	if (ctx->timed)
+		ctx->rsp_ns = ktime_get_ns();
+	trace_fastrpc_invoke_rsp(ctx->ctxid, retval);
 	ctx->retval = retval;
-	complete(&ctx->work);
+	context_complete(ctx);
 }
 
 static void fastrpc_notify_users(struct fastrpc_file *me)
@@ -999,9 +1181,8 @@ static void fastrpc_notify_users(struct fastrpc_file *me)
 	struct hlist_node *n;
 
 	spin_lock(&me->hlock);
-	hlist_for_each_entry_safe(ictx, n, &me->clst.pending, hn) {
-		complete(&ictx->work);
-	}
+	hlist_for_each_entry_safe(ictx, n, &me->clst.pending, hn)
+		context_complete(ictx);
 	hlist_for_each_entry_safe(ictx, n, &me->clst.interrupted, hn) {
 		complete(&ictx->work);
 	}
@@ -1485,12 +1666,46 @@ static void fastrpc_init(struct fastrpc_apps *me)
 
 static int fastrpc_release_current_dsp_process(struct fastrpc_file *fl);
 
+static inline uint64_t fastrpc_perf_phase(bool timed, uint64_t *t)
+{
+	uint64_t now, delta;
+
+	if (!timed)
+		return 0;
+	now = ktime_get_ns();
+	delta = now - *t;
+	*t = now;
+	return delta;
+}
+
+static void fastrpc_perf_record(struct fastrpc_file *fl, uint32_t handle,
+				uint32_t sc, struct fastrpc_perf *perf)
+{
+	trace_fastrpc_invoke_done(fl->cid, handle, sc, perf->getargs,
+				  perf->invargs, perf->link, perf->dsp,
+				  perf->wakeup, perf->putargs);
+	if (!fastrpc_perf_enable)
+		return;
+	spin_lock(&fl->hlock);
+	fl->perf.count++;
+	fl->perf.getargs += perf->getargs;
+	fl->perf.invargs += perf->invargs;
+	fl->perf.link += perf->link;
+	fl->perf.dsp += perf->dsp;
+	fl->perf.wakeup += perf->wakeup;
+	fl->perf.putargs += perf->putargs;
+	spin_unlock(&fl->hlock);
+}
+
 static int fastrpc_internal_invoke(struct fastrpc_file *fl, uint32_t mode,
 				   uint32_t kernel,
 				   struct fastrpc_ioctl_invoke_fd *invokefd)
 {
 	struct smq_invoke_ctx *ctx = NULL;
 	struct fastrpc_ioctl_invoke *invoke = &invokefd->inv;
+	struct fastrpc_perf perf = {0};
+	uint64_t t = 0, sent = 0;
+	bool timed = false;
 	int cid = fl->cid;
 	int interrupted = 0;
 	int err = 0;
@@ -1524,24 +1739,35 @@ static int fastrpc_internal_invoke(struct fastrpc_file *fl, uint32_t mode,
 			goto wait;
 	}
 
+	/* restarted calls are not timed, their first leg was lost */
+	timed = fastrpc_perf_enable || trace_fastrpc_invoke_done_enabled();
+	if (timed)
+		t = ktime_get_ns();
 	VERIFY(err, 0 == context_alloc(fl, kernel, invokefd, &ctx));
 	if (err)
 		goto bail;
+	ctx->timed = timed;
 
 	if (REMOTE_SCALARS_LENGTH(ctx->sc)) {
 		VERIFY(err, 0 == get_args(kernel, ctx));
 		if (err)
 			goto bail;
 	}
+	perf.getargs = fastrpc_perf_phase(timed, &t);
 
 	inv_args_pre(ctx);
 	if (FASTRPC_MODE_SERIAL == mode)
 		inv_args(ctx);
+	perf.invargs = fastrpc_perf_phase(timed, &t);
 	VERIFY(err, 0 == fastrpc_invoke_send(ctx, kernel, invoke->handle));
 	if (err)
 		goto bail;
+	perf.link = fastrpc_perf_phase(timed, &t);
+	sent = t;
+	trace_fastrpc_invoke_send(cid, invoke->handle, ctx->sc, ctx->ctxid);
 	if (FASTRPC_MODE_PARALLEL == mode)
 		inv_args(ctx);
+	perf.invargs += fastrpc_perf_phase(timed, &t);
  wait:
 	if (kernel)
 		wait_for_completion(&ctx->work);
@@ -1551,19 +1777,200 @@ static int fastrpc_internal_invoke(struct fastrpc_file *fl, uint32_t mode,
 		if (err)
 			goto bail;
 	}
+	if (timed) {
+		uint64_t rsp = ctx->rsp_ns;
+
+		t = ktime_get_ns();
+		/* no timestamp if the wait was ended by SSR */
+		if (rsp < sent || rsp > t)
+			rsp = t;
+		perf.dsp = rsp - sent;
+		perf.wakeup = t - rsp;
+	}
 	VERIFY(err, 0 == (err = ctx->retval));
 	if (err)
 		goto bail;
 	VERIFY(err, 0 == put_args(kernel, ctx, invoke->pra));
 	if (err)
 		goto bail;
+	if (timed) {
+		perf.putargs = fastrpc_perf_phase(timed, &t);
+		fastrpc_perf_record(fl, invoke->handle, ctx->sc, &perf);
+	}
  bail:
 	if (ctx && interrupted == -ERESTARTSYS)
 		context_save_interrupted(ctx);
 	else if (ctx)
 		context_free(ctx);
-	if (fl->ssrcount != fl->apps->channel[cid].ssrcount)
+	if (fl->ssrcount != fl->apps->channel[cid].ssrcount) {
+		/* the DSP restarted, don't keep its mappings around */
+		fastrpc_mmap_lru_evict(fl, ULONG_MAX);
+		err = ECONNRESET;
+	}
+	return err;
+}
+
+static int fastrpc_internal_invoke_async(struct fastrpc_file *fl,
+				uint32_t mode,
+				struct fastrpc_ioctl_invoke_async *inva)
+{
+	struct smq_invoke_ctx *ctx = NULL;
+	struct fastrpc_ioctl_invoke *invoke = &inva->inv.inv;
+	unsigned long flags;
+	bool queued;
+	int cid = fl->cid;
+	int err = 0;
+
+	VERIFY(err, invoke->handle != FASTRPC_STATIC_HANDLE_KERNEL);
+	if (err)
+		return err;
+	VERIFY(err, fl->sctx != NULL);
+	if (err)
+		return err;
+	VERIFY(err, fl->cid >= 0 && fl->cid < NUM_CHANNELS);
+	if (err)
+		return err;
+	if (fl->sctx->smmu.faults)
+		return FASTRPC_ENOSUCH;
+
+	spin_lock_irqsave(&fl->async_lock, flags);
+	if (fl->async_count < FASTRPC_ASYNC_MAX)
+		fl->async_count++;
+	else
+		err = -EAGAIN;
+	spin_unlock_irqrestore(&fl->async_lock, flags);
+	if (err)
+		return err;
+
+	VERIFY(err, 0 == context_alloc(fl, 0, &inva->inv, &ctx));
+	if (err)
+		goto bail;
+	ctx->upra = invoke->pra;
+
+	if (REMOTE_SCALARS_LENGTH(ctx->sc)) {
+		VERIFY(err, 0 == get_args(0, ctx));
+		if (err)
+			goto bail;
+	}
+
+	inv_args_pre(ctx);
+	if (FASTRPC_MODE_SERIAL == mode)
+		inv_args(ctx);
+	VERIFY(err, 0 == fastrpc_invoke_send(ctx, 0, invoke->handle));
+	if (err)
+		goto bail;
+	if (FASTRPC_MODE_PARALLEL == mode)
+		inv_args(ctx);
+
+	/*
+	 * The reply may already be in; context_complete() then completed the
+	 * ctx under async_lock, so queue it here, otherwise it will queue the
+	 * ctx itself.  The reaper owns the ctx once the lock is dropped.
+	 */
+	spin_lock_irqsave(&fl->async_lock, flags);
+	inva->jobid = ctx->jobid = ++fl->async_seq;
+	ctx->async = true;
+	queued = completion_done(&ctx->work);
+	if (queued)
+		list_add_tail(&ctx->async_node, &fl->async_done);
+	spin_unlock_irqrestore(&fl->async_lock, flags);
+	if (queued)
+		wake_up_interruptible(&fl->async_wq);
+	return 0;
+ bail:
+	if (ctx)
+		context_free(ctx);
+	spin_lock_irqsave(&fl->async_lock, flags);
+	fl->async_count--;
+	spin_unlock_irqrestore(&fl->async_lock, flags);
+	if (fl->ssrcount != fl->apps->channel[cid].ssrcount) {
+		fastrpc_mmap_lru_evict(fl, ULONG_MAX);
 		err = ECONNRESET;
+	}
+	return err;
+}
+
+static struct smq_invoke_ctx *fastrpc_async_dequeue(struct fastrpc_file *fl)
+{
+	struct smq_invoke_ctx *ctx = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&fl->async_lock, flags);
+	if (!list_empty(&fl->async_done)) {
+		ctx = list_first_entry(&fl->async_done, struct smq_invoke_ctx,
+				       async_node);
+		list_del_init(&ctx->async_node);
+		/* reaped: a late notification must not queue it again */
+		ctx->async = false;
+		fl->async_count--;
+	}
+	spin_unlock_irqrestore(&fl->async_lock, flags);
+	return ctx;
+}
+
+static bool fastrpc_async_ready(struct fastrpc_file *fl)
+{
+	unsigned long flags;
+	bool ready;
+
+	spin_lock_irqsave(&fl->async_lock, flags);
+	ready = !list_empty(&fl->async_done);
+	spin_unlock_irqrestore(&fl->async_lock, flags);
+	return ready;
+}
+
+static int fastrpc_internal_async_wait(struct fastrpc_file *fl,
+				struct fastrpc_ioctl_async_wait *aw)
+{
+	struct fastrpc_async_result res = {0};
+	struct smq_invoke_ctx *ctx;
+	uint32_t count = 0;
+	bool ssr = false;
+	long ret = 0;
+	int err = 0;
+
+	VERIFY(err, fl->tgid == current->tgid);
+	if (err)
+		goto bail;
+	if (!aw->count)
+		goto bail;
+
+	if (aw->timeout < 0)
+		ret = wait_event_interruptible(fl->async_wq,
+					       fastrpc_async_ready(fl));
+	else if (aw->timeout > 0)
+		ret = wait_event_interruptible_timeout(fl->async_wq,
+				fastrpc_async_ready(fl),
+				msecs_to_jiffies(aw->timeout));
+	if (ret < 0) {
+		err = ret;
+		goto bail;
+	}
+
+	while (count < aw->count) {
+		ctx = fastrpc_async_dequeue(fl);
+		if (!ctx)
+			break;
+		res.jobid = ctx->jobid;
+		res.retval = ctx->retval;
+		if (!res.retval)
+			res.retval = put_args(0, ctx, ctx->upra);
+		if (fl->ssrcount != fl->apps->channel[fl->cid].ssrcount) {
+			res.retval = ECONNRESET;
+			ssr = true;
+		}
+		context_free(ctx);
+		K_COPY_TO_USER(err, 0, &aw->results[count], &res, sizeof(res));
+		if (err)
+			break;
+		count++;
+	}
+	if (ssr)
+		fastrpc_mmap_lru_evict(fl, ULONG_MAX);
+	if (!err && !count)
+		err = aw->timeout ? -ETIMEDOUT : -EAGAIN;
+ bail:
+	aw->count = count;
 	return err;
 }
 
@@ -2039,9 +2446,11 @@ static int fastrpc_file_free(struct fastrpc_file *fl)
 		return 0;
 	cid = fl->cid;
 
+	mutex_lock(&fastrpc_map_lru_mutex);
 	spin_lock(&fl->apps->hlock);
 	hlist_del_init(&fl->hn);
 	spin_unlock(&fl->apps->hlock);
+	mutex_unlock(&fastrpc_map_lru_mutex);
 
 	if (!fl->sctx)
 		goto bail;
@@ -2051,6 +2460,10 @@ static int fastrpc_file_free(struct fastrpc_file *fl)
 		fastrpc_buf_free(fl->init_mem, 0);
 	fastrpc_context_list_dtor(fl);
 	fastrpc_cached_buf_list_free(fl);
+	spin_lock(&fl->hlock);
+	fl->map_lru_off = true;
+	spin_unlock(&fl->hlock);
+	fastrpc_mmap_lru_evict(fl, ULONG_MAX);
 	hlist_for_each_entry_safe(map, n, &fl->maps, hn) {
 		fastrpc_mmap_free(map);
 	}
@@ -2332,6 +2745,10 @@ static int fastrpc_device_open(struct inode *inode, struct file *filp)
 	INIT_HLIST_HEAD(&fl->maps);
 	INIT_HLIST_HEAD(&fl->cached_bufs);
 	INIT_HLIST_HEAD(&fl->remote_bufs);
+	INIT_LIST_HEAD(&fl->map_lru);
+	spin_lock_init(&fl->async_lock);
+	INIT_LIST_HEAD(&fl->async_done);
+	init_waitqueue_head(&fl->async_wq);
 	INIT_HLIST_NODE(&fl->hn);
 	fl->tgid = current->tgid;
 	fl->apps = me;
@@ -2436,6 +2853,8 @@ static long fastrpc_device_ioctl(struct file *file, unsigned int ioctl_num,
 		struct fastrpc_ioctl_munmap_64 munmap64;
 		struct fastrpc_ioctl_init init;
 		struct fastrpc_ioctl_control cp;
+		struct fastrpc_ioctl_invoke_async inva;
+		struct fastrpc_ioctl_async_wait aw;
 	} p;
 	union {
 		struct fastrpc_ioctl_mmap mmap;
@@ -2460,6 +2879,30 @@ static long fastrpc_device_ioctl(struct file *file, unsigned int ioctl_num,
 		if (err)
 			goto bail;
 		break;
+	case FASTRPC_IOCTL_INVOKE_ASYNC:
+		K_COPY_FROM_USER(err, 0, &p.inva, param, sizeof(p.inva));
+		if (err)
+			goto bail;
+		VERIFY(err, 0 == (err = fastrpc_internal_invoke_async(fl,
+						fl->mode, &p.inva)));
+		if (err)
+			goto bail;
+		K_COPY_TO_USER(err, 0, param, &p.inva, sizeof(p.inva));
+		if (err)
+			goto bail;
+		break;
+	case FASTRPC_IOCTL_ASYNC_WAIT:
+		K_COPY_FROM_USER(err, 0, &p.aw, param, sizeof(p.aw));
+		if (err)
+			goto bail;
+		VERIFY(err, 0 == (err = fastrpc_internal_async_wait(fl,
+							&p.aw)));
+		if (err)
+			goto bail;
+		K_COPY_TO_USER(err, 0, param, &p.aw, sizeof(p.aw));
+		if (err)
+			goto bail;
+		break;
 	case FASTRPC_IOCTL_MMAP:
 		K_COPY_FROM_USER(err, 0, &p.mmap, param,
 						sizeof(p.mmap));
@@ -2614,10 +3057,24 @@ static int fastrpc_smmu_fault_handler(struct iommu_domain *domain,
 	return 0;
 }
 
+static unsigned int fastrpc_device_poll(struct file *file, poll_table *wait)
+{
+	struct fastrpc_file *fl = (struct fastrpc_file *)file->private_data;
+	unsigned int mask = 0;
+
+	if (!fl)
+		return POLLERR;
+	poll_wait(file, &fl->async_wq, wait);
+	if (fastrpc_async_ready(fl))
+		mask |= POLLIN | POLLRDNORM;
+	return mask;
+}
+
 static const struct file_operations fops = {
 	.open = fastrpc_device_open,
 	.release = fastrpc_device_release,
 	.unlocked_ioctl = fastrpc_device_ioctl,
+	.poll = fastrpc_device_poll,
 	.compat_ioctl = compat_fastrpc_device_ioctl,
 };
 
@@ -2892,6 +3349,115 @@ static struct platform_driver fastrpc_driver = {
 	},
 };
 
+static unsigned long fastrpc_map_shrink_count(struct shrinker *shrink,
+					      struct shrink_control *sc)
+{
+	struct fastrpc_apps *me = &gfa;
+	struct fastrpc_file *fl;
+	unsigned long count = 0;
+
+	spin_lock(&me->hlock);
+	hlist_for_each_entry(fl, &me->drivers, hn)
+		count += fl->map_lru_count;
+	spin_unlock(&me->hlock);
+	return count;
+}
+
+static unsigned long fastrpc_map_shrink_scan(struct shrinker *shrink,
+					     struct shrink_control *sc)
+{
+	struct fastrpc_apps *me = &gfa;
+	struct fastrpc_file *fl;
+	unsigned long freed = 0;
+
+	if (!mutex_trylock(&fastrpc_map_lru_mutex))
+		return SHRINK_STOP;
+
+	/* files can't leave gfa.drivers while the mutex is held */
+	spin_lock(&me->hlock);
+	hlist_for_each_entry(fl, &me->drivers, hn) {
+		spin_unlock(&me->hlock);
+		freed += fastrpc_mmap_lru_evict(fl, sc->nr_to_scan - freed);
+		spin_lock(&me->hlock);
+		if (freed >= sc->nr_to_scan)
+			break;
+	}
+	spin_unlock(&me->hlock);
+	mutex_unlock(&fastrpc_map_lru_mutex);
+	return freed;
+}
+
+static struct shrinker fastrpc_map_shrinker = {
+	.count_objects = fastrpc_map_shrink_count,
+	.scan_objects = fastrpc_map_shrink_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
+static inline uint64_t fastrpc_perf_avg(uint64_t total, uint64_t count)
+{
+	return count ? div64_u64(total, count) : 0;
+}
+
+static int fastrpc_perf_show(struct seq_file *s, void *unused)
+{
+	struct fastrpc_apps *me = &gfa;
+	struct fastrpc_file *fl;
+	struct fastrpc_perf perf;
+
+	seq_printf(s, "%-7s %-3s %-10s %-10s %-10s %-10s %-10s %-10s %s\n",
+		   "tgid", "cid", "count", "getargs", "invargs", "link",
+		   "dsp", "wakeup", "putargs");
+	spin_lock(&me->hlock);
+	hlist_for_each_entry(fl, &me->drivers, hn) {
+		spin_lock(&fl->hlock);
+		perf = fl->perf;
+		spin_unlock(&fl->hlock);
+		if (!perf.count)
+			continue;
+		seq_printf(s,
+			"%-7d %-3d %-10llu %-10llu %-10llu %-10llu %-10llu %-10llu %llu\n",
+			fl->tgid, fl->cid, perf.count,
+			fastrpc_perf_avg(perf.getargs, perf.count),
+			fastrpc_perf_avg(perf.invargs, perf.count),
+			fastrpc_perf_avg(perf.link, perf.count),
+			fastrpc_perf_avg(perf.dsp, perf.count),
+			fastrpc_perf_avg(perf.wakeup, perf.count),
+			fastrpc_perf_avg(perf.putargs, perf.count));
+	}
+	spin_unlock(&me->hlock);
+	return 0;
+}
+
+static int fastrpc_perf_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, fastrpc_perf_show, inode->i_private);
+}
+
+static const struct file_operations fastrpc_perf_fops = {
+	.open = fastrpc_perf_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/*
+ * adsprpc/perf_enable turns on the per-file phase accounting and
+ * adsprpc/perf prints the average ns spent in each phase per invoke.
+ * The fastrpc tracepoints work regardless of perf_enable.
+ */
+static void fastrpc_debugfs_init(void)
+{
+	fastrpc_debugfs_root = debugfs_create_dir("adsprpc", NULL);
+	if (IS_ERR_OR_NULL(fastrpc_debugfs_root)) {
+		fastrpc_debugfs_root = NULL;
+		return;
+	}
+	debugfs_create_bool("perf_enable", 0644, fastrpc_debugfs_root,
+			    &fastrpc_perf_enable);
+	debugfs_create_file("perf", 0444, fastrpc_debugfs_root, NULL,
+			    &fastrpc_perf_fops);
+}
+
 static int __init fastrpc_device_init(void)
 {
 	struct fastrpc_apps *me = &gfa;
@@ -2946,6 +3512,8 @@ static int __init fastrpc_device_init(void)
 	VERIFY(err, !IS_ERR_OR_NULL(me->client));
 	if (err)
 		goto device_create_bail;
+	register_shrinker(&fastrpc_map_shrinker);
+	fastrpc_debugfs_init();
 	return 0;
 device_create_bail:
 	for (i = 0; i < NUM_CHANNELS; i++) {
@@ -2971,6 +3539,8 @@ static void __exit fastrpc_device_exit(void)
 	struct fastrpc_apps *me = &gfa;
 	int i;
 
+	debugfs_remove_recursive(fastrpc_debugfs_root);
+	unregister_shrinker(&fastrpc_map_shrinker);
 	fastrpc_file_list_dtor(me);
 	fastrpc_deinit();
 	if (me->wq) {
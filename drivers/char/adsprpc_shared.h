@@ -27,6 +27,9 @@
 #define FASTRPC_IOCTL_GETINFO	_IOWR('R', 8, uint32_t)
 #define FASTRPC_GLINK_GUID "fastrpcglink-apps-dsp"
 #define FASTRPC_IOCTL_CONTROL	_IOWR('R', 12, struct fastrpc_ioctl_control)
+#define FASTRPC_IOCTL_INVOKE_ASYNC \
+		_IOWR('R', 16, struct fastrpc_ioctl_invoke_async)
+#define FASTRPC_IOCTL_ASYNC_WAIT _IOWR('R', 17, struct fastrpc_ioctl_async_wait)
 
 #define FASTRPC_SMD_GUID "fastrpcsmd-apps-dsp"
 #define DEVICE_NAME      "adsprpc-smd"
@@ -130,6 +133,28 @@ struct fastrpc_ioctl_invoke_fd {
 	int *fds;		/* fd list */
 };
 
+/*
+ * Submit without waiting for the DSP.  The argument list and every output
+ * buffer must stay valid until the job is reaped with
+ * FASTRPC_IOCTL_ASYNC_WAIT, which copies the results back.
+ */
+struct fastrpc_ioctl_invoke_async {
+	struct fastrpc_ioctl_invoke_fd inv;
+	uint64_t jobid;		/* returned job id */
+};
+
+struct fastrpc_async_result {
+	uint64_t jobid;		/* job id returned by INVOKE_ASYNC */
+	int32_t retval;		/* result of the remote call */
+	uint32_t reserved;
+};
+
+struct fastrpc_ioctl_async_wait {
+	struct fastrpc_async_result *results;	/* result array */
+	uint32_t count;		/* in: array length, out: results filled */
+	int32_t timeout;	/* ms to wait, < 0 forever, 0 don't wait */
+};
+
 struct fastrpc_ioctl_init {
 	uint32_t flags;		/* one of FASTRPC_INIT_* macros */
 	uintptr_t file;		/* pointer to elf file */
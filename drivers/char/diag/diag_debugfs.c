@@ -16,7 +16,11 @@
 #include <linux/debugfs.h>
 #include <linux/atomic.h>
 #include <linux/uaccess.h>
+#include <linux/ktime.h>
+#include <linux/random.h>
+#include <linux/crc-ccitt.h>
 #include "diagchar.h"
+#include "diagchar_hdlc.h"
 #include "diagfwd.h"
 #ifdef CONFIG_DIAGFWD_BRIDGE_CODE
 #include "diagfwd_bridge.h"
@@ -38,6 +42,8 @@
 #include "diag_ipc_logging.h"
 
 #define DEBUG_BUF_SIZE	4096
+#define HDLC_BENCH_SIZE	8192
+#define HDLC_BENCH_ITER	256
 static struct dentry *diag_dbgfs_dent;
 static int diag_dbgfs_table_index;
 static int diag_dbgfs_mempool_index;
@@ -254,6 +260,105 @@ static ssize_t diag_dbgfs_read_power(struct file *file, char __user *ubuf,
 	return ret;
 }
 
+static unsigned int diag_dbgfs_hdlc_rate(s64 us)
+{
+	/* KB/s over HDLC_BENCH_ITER passes of HDLC_BENCH_SIZE bytes */
+	if (us <= 0)
+		us = 1;
+	return div64_s64((s64)HDLC_BENCH_SIZE * HDLC_BENCH_ITER * 1000000,
+			 us * 1024);
+}
+
+static ssize_t diag_dbgfs_read_hdlc_bench(struct file *file,
+					  char __user *ubuf, size_t count,
+					  loff_t *ppos)
+{
+	struct diag_send_desc_type send = { NULL, NULL, DIAG_STATE_START, 1 };
+	struct diag_hdlc_dest_type enc = { NULL, NULL, 0 };
+	struct diag_hdlc_decode_type hdlc;
+	unsigned int enc_len = 0;
+	unsigned int dest_size;
+	uint8_t *src, *dest, *dec;
+	s64 crc_ref_us, crc_us, enc_us, dec_us;
+	uint16_t crc_ref = 0, crc = 0;
+	ktime_t start;
+	char *buf;
+	int ret = 0;
+	int i;
+
+	if (*ppos)
+		return 0;
+
+	/* Worst case every byte is escaped, plus the CRC and terminator */
+	dest_size = 2 * (HDLC_BENCH_SIZE + HDLC_FOOTER_LEN);
+	src = kmalloc(HDLC_BENCH_SIZE, GFP_KERNEL);
+	dest = kmalloc(dest_size, GFP_KERNEL);
+	dec = kmalloc(dest_size, GFP_KERNEL);
+	buf = kzalloc(DEBUG_BUF_SIZE, GFP_KERNEL);
+	if (!src || !dest || !dec || !buf) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	prandom_bytes(src, HDLC_BENCH_SIZE);
+
+	start = ktime_get();
+	for (i = 0; i < HDLC_BENCH_ITER; i++)
+		crc_ref = crc_ccitt(0xFFFF, src, HDLC_BENCH_SIZE);
+	crc_ref_us = ktime_us_delta(ktime_get(), start);
+
+	start = ktime_get();
+	for (i = 0; i < HDLC_BENCH_ITER; i++)
+		crc = diag_hdlc_crc(0xFFFF, src, HDLC_BENCH_SIZE);
+	crc_us = ktime_us_delta(ktime_get(), start);
+
+	start = ktime_get();
+	for (i = 0; i < HDLC_BENCH_ITER; i++) {
+		send.pkt = src;
+		send.last = src + HDLC_BENCH_SIZE - 1;
+		send.state = DIAG_STATE_START;
+		enc.dest = dest;
+		enc.dest_last = dest + dest_size - 1;
+		diag_hdlc_encode(&send, &enc);
+	}
+	enc_us = ktime_us_delta(ktime_get(), start);
+	enc_len = (uint8_t *)enc.dest - dest;
+
+	start = ktime_get();
+	for (i = 0; i < HDLC_BENCH_ITER; i++) {
+		memset(&hdlc, 0, sizeof(hdlc));
+		hdlc.src_ptr = dest;
+		hdlc.src_size = enc_len;
+		hdlc.dest_ptr = dec;
+		hdlc.dest_size = dest_size;
+		diag_hdlc_decode(&hdlc);
+	}
+	dec_us = ktime_us_delta(ktime_get(), start);
+
+	ret = scnprintf(buf, DEBUG_BUF_SIZE,
+		"Buffer size: %d bytes, passes: %d\n"
+		"crc_ccitt:     %u KB/s\n"
+		"diag_hdlc_crc: %u KB/s (%s)\n"
+		"encode:        %u KB/s, %u bytes out\n"
+		"decode:        %u KB/s (%s)\n",
+		HDLC_BENCH_SIZE, HDLC_BENCH_ITER,
+		diag_dbgfs_hdlc_rate(crc_ref_us),
+		diag_dbgfs_hdlc_rate(crc_us),
+		(crc == crc_ref) ? "match" : "MISMATCH",
+		diag_dbgfs_hdlc_rate(enc_us), enc_len,
+		diag_dbgfs_hdlc_rate(dec_us),
+		(hdlc.dest_idx == HDLC_BENCH_SIZE + HDLC_FOOTER_LEN &&
+		 !memcmp(dec, src, HDLC_BENCH_SIZE) &&
+		 !crc_check(dec, hdlc.dest_idx)) ? "match" : "MISMATCH");
+
+	ret = simple_read_from_buffer(ubuf, count, ppos, buf, ret);
+out:
+	kfree(buf);
+	kfree(dec);
+	kfree(dest);
+	kfree(src);
+	return ret;
+}
+
 static ssize_t diag_dbgfs_read_table(struct file *file, char __user *ubuf,
 				     size_t count, loff_t *ppos)
 {
@@ -976,6 +1081,10 @@ const struct file_operations diag_dbgfs_debug_ops = {
 	.write = diag_dbgfs_write_debug
 };
 
+const struct file_operations diag_dbgfs_hdlc_bench_ops = {
+	.read = diag_dbgfs_read_hdlc_bench,
+};
+
 int diag_debugfs_init(void)
 {
 	struct dentry *entry = NULL;
@@ -1029,6 +1138,11 @@ int diag_debugfs_init(void)
 	if (!entry)
 		goto err;
 
+	entry = debugfs_create_file("hdlc_bench", 0444, diag_dbgfs_dent, 0,
+				    &diag_dbgfs_hdlc_bench_ops);
+	if (!entry)
+		goto err;
+
 #ifdef CONFIG_DIAGFWD_BRIDGE_CODE
 	entry = debugfs_create_file("bridge", 0444, diag_dbgfs_dent, 0,
 				    &diag_dbgfs_bridge_ops);
@@ -23,6 +23,11 @@
 #include <linux/delay.h>
 #include <linux/kmemleak.h>
 #include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/mm.h>
+#include <linux/kref.h>
+#include <linux/log2.h>
+#include <linux/sizes.h>
 #include "diagchar.h"
 #include "diag_memorydevice.h"
 #include "diagfwd_bridge.h"
@@ -138,14 +143,131 @@ void diag_md_close_all()
 	diag_ws_reset(DIAG_WS_MUX);
 }
 
+struct diag_md_ring *diag_md_ring_create(uint32_t size)
+{
+	struct diag_md_ring *ring;
+
+	size = clamp_t(uint32_t, size, DIAG_MD_RING_MIN_SIZE,
+		       DIAG_MD_RING_MAX_SIZE);
+	size = roundup_pow_of_two(size);
+
+	ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+	if (!ring)
+		return NULL;
+
+	ring->map_size = PAGE_SIZE + size;
+	ring->ctl = vmalloc_user(ring->map_size);
+	if (!ring->ctl) {
+		kfree(ring);
+		return NULL;
+	}
+	ring->data = (unsigned char *)ring->ctl + PAGE_SIZE;
+	ring->size = size;
+	ring->ctl->size = size;
+	ring->ctl->data_offset = PAGE_SIZE;
+	kref_init(&ring->kref);
+	spin_lock_init(&ring->lock);
+
+	return ring;
+}
+
+static void diag_md_ring_release(struct kref *kref)
+{
+	struct diag_md_ring *ring = container_of(kref, struct diag_md_ring,
+						 kref);
+
+	vfree(ring->ctl);
+	kfree(ring);
+}
+
+void diag_md_ring_get(struct diag_md_ring *ring)
+{
+	kref_get(&ring->kref);
+}
+
+void diag_md_ring_put(struct diag_md_ring *ring)
+{
+	kref_put(&ring->kref, diag_md_ring_release);
+}
+
+int diag_md_ring_empty(struct diag_md_ring *ring)
+{
+	return ACCESS_ONCE(ring->ctl->head) == ACCESS_ONCE(ring->ctl->tail);
+}
+
+/*
+ * Append a record to the ring. The ring never overwrites data the logger
+ * has not consumed; when it is full the record is dropped and counted.
+ */
+static int diag_md_ring_write(struct diag_md_ring *ring, int proc,
+			      unsigned char *buf, int len)
+{
+	struct diag_md_ring_ctl *ctl = ring->ctl;
+	struct diag_md_ring_rec *rec;
+	unsigned long flags;
+	uint32_t rec_len;
+	uint32_t to_end;
+	uint32_t head;
+	uint32_t used;
+	uint32_t pos;
+	uint32_t pad = 0;
+
+	rec_len = ALIGN(sizeof(*rec) + len, DIAG_MD_RING_ALIGN);
+
+	spin_lock_irqsave(&ring->lock, flags);
+	head = ctl->head;
+	used = head - ACCESS_ONCE(ctl->tail);
+	pos = head & (ring->size - 1);
+	to_end = ring->size - pos;
+	if (to_end < rec_len)
+		pad = to_end;
+
+	if (used > ring->size || rec_len + pad > ring->size - used) {
+		ctl->dropped++;
+		spin_unlock_irqrestore(&ring->lock, flags);
+		return -ENOMEM;
+	}
+
+	if (pad) {
+		rec = (struct diag_md_ring_rec *)(ring->data + pos);
+		rec->proc = DIAG_MD_RING_PAD;
+		rec->len = pad - sizeof(*rec);
+		head += pad;
+		pos = 0;
+	}
+
+	rec = (struct diag_md_ring_rec *)(ring->data + pos);
+	rec->proc = proc;
+	rec->len = len;
+	memcpy(rec + 1, buf, len);
+
+	/* The record must be visible before the logger can see the head */
+	smp_wmb();
+	ctl->head = head + rec_len;
+	spin_unlock_irqrestore(&ring->lock, flags);
+
+	return 0;
+}
+
+int diag_md_ring_mmap(struct diag_md_ring *ring, struct vm_area_struct *vma)
+{
+	if (vma->vm_pgoff ||
+	    vma->vm_end - vma->vm_start > ring->map_size)
+		return -EINVAL;
+
+	return remap_vmalloc_range(vma, ring->ctl, 0);
+}
+
 int diag_md_write(int id, unsigned char *buf, int len, int ctx)
 {
 	int i, pid = 0;
+	int err, proc;
 	uint8_t found = 0;
 	unsigned long flags;
 	struct diag_md_info *ch = NULL;
 	uint8_t peripheral;
 	struct diag_md_session_t *session_info = NULL;
+	struct diag_md_ring *ring = NULL;
 
 	if (id < 0 || id >= NUM_DIAG_MD_DEV || id >= DIAG_NUM_PROC)
 		return -EINVAL;
@@ -167,12 +289,38 @@ int diag_md_write(int id, unsigned char *buf, int len, int ctx)
 		return -EIO;
 	}
 	pid = session_info->pid;
+	ring = session_info->ring;
+	if (ring)
+		diag_md_ring_get(ring);
 	mutex_unlock(&driver->md_session_lock);
 	DIAG_LOG(DIAG_DEBUG_PERIPHERALS, "%s:%d: released md_session_lock\n", __func__, __LINE__);
 
 	ch = &diag_md[id];
-	if (!ch || !ch->md_info_inited)
+	if (!ch || !ch->md_info_inited) {
+		if (ring)
+			diag_md_ring_put(ring);
 		return -EINVAL;
+	}
+
+	/*
+	 * With a ring the data is copied once into the shared mapping and
+	 * the buffer goes straight back to its owner; there is no table
+	 * entry and no read() copy.
+	 */
+	if (ring) {
+		proc = (id > 0) ? diag_get_remote(id) : 0;
+		err = diag_md_ring_write(ring, proc, buf, len);
+		diag_md_ring_put(ring);
+		if (err)
+			return err;
+		spin_lock_irqsave(&ch->lock, flags);
+		if (ch->ops && ch->ops->write_done)
+			ch->ops->write_done(buf, len, ctx,
+					    DIAG_MEMORY_DEVICE_MODE);
+		spin_unlock_irqrestore(&ch->lock, flags);
+		wake_up_interruptible(&driver->wait_q);
+		return 0;
+	}
 
 	spin_lock_irqsave(&ch->lock, flags);
 	for (i = 0; i < ch->num_tbl_entries && !found; i++) {
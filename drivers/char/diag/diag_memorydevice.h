@@ -13,6 +13,11 @@
 #ifndef DIAG_MEMORYDEVICE_H
 #define DIAG_MEMORYDEVICE_H
 
+#include <linux/kref.h>
+#include <linux/sizes.h>
+#include <linux/spinlock.h>
+#include <linux/diagchar.h>
+
 #define DIAG_MD_LOCAL		0
 #define DIAG_MD_LOCAL_LAST	1
 #define DIAG_MD_BRIDGE_BASE	DIAG_MD_LOCAL_LAST
@@ -44,6 +49,22 @@ struct diag_md_info {
 	struct diag_mux_ops *ops;
 };
 
+/*
+ * Per session ring shared with the logging process through mmap(). The
+ * session, every mapping and writers in flight each hold a reference.
+ */
+struct diag_md_ring {
+	struct kref kref;
+	spinlock_t lock;
+	struct diag_md_ring_ctl *ctl;
+	unsigned char *data;
+	uint32_t size;
+	size_t map_size;
+};
+
+#define DIAG_MD_RING_MIN_SIZE	SZ_64K
+#define DIAG_MD_RING_MAX_SIZE	SZ_16M
+
 extern struct diag_md_info diag_md[NUM_DIAG_MD_DEV];
 
 int diag_md_init(void);
@@ -57,4 +78,10 @@ int diag_md_close_peripheral(int id, uint8_t peripheral);
 int diag_md_write(int id, unsigned char *buf, int len, int ctx);
 int diag_md_copy_to_user(char __user *buf, int *pret, size_t buf_size,
 			 struct diag_md_session_t *info);
+struct vm_area_struct;
+struct diag_md_ring *diag_md_ring_create(uint32_t size);
+void diag_md_ring_get(struct diag_md_ring *ring);
+void diag_md_ring_put(struct diag_md_ring *ring);
+int diag_md_ring_empty(struct diag_md_ring *ring);
+int diag_md_ring_mmap(struct diag_md_ring *ring, struct vm_area_struct *vma);
 #endif
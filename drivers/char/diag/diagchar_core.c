@@ -25,6 +25,8 @@
 #include <linux/sched.h>
 #include <linux/platform_device.h>
 #include <linux/msm_mhi.h>
+#include <linux/poll.h>
+#include <linux/mm.h>
 #ifdef CONFIG_DIAG_OVER_USB
 #include <linux/usb/usbdiag.h>
 #endif
@@ -1266,6 +1268,8 @@ static void diag_md_session_exit(void)
 			diag_event_mask_free(session_info->event_mask);
 			kfree(session_info->event_mask);
 			session_info->event_mask = NULL;
+			if (session_info->ring)
+				diag_md_ring_put(session_info->ring);
 			kfree(session_info);
 			session_info = NULL;
 			driver->md_session_map[i] = NULL;
@@ -1413,6 +1417,10 @@ static void diag_md_session_close(int pid)
 	kfree(session_info->event_mask);
 	session_info->event_mask = NULL;
 	del_timer(&session_info->hdlc_reset_timer);
+	if (session_info->ring) {
+		diag_md_ring_put(session_info->ring);
+		session_info->ring = NULL;
+	}
 
 	for (i = 0; i < NUM_MD_SESSIONS && !found; i++) {
 		if (driver->md_session_map[i] != NULL)
@@ -2114,6 +2122,34 @@ static int diag_ioctl_hdlc_toggle(unsigned long ioarg)
 	return 0;
 }
 
+static int diag_ioctl_md_ring_setup(unsigned long ioarg)
+{
+	uint32_t size;
+	struct diag_md_ring *ring = NULL;
+	struct diag_md_session_t *session_info = NULL;
+
+	if (copy_from_user(&size, (void __user *)ioarg, sizeof(size)))
+		return -EFAULT;
+
+	ring = diag_md_ring_create(size);
+	if (!ring)
+		return -ENOMEM;
+
+	mutex_lock(&driver->md_session_lock);
+	session_info = diag_md_session_get_pid(current->tgid);
+	if (!session_info || session_info->ring) {
+		mutex_unlock(&driver->md_session_lock);
+		diag_md_ring_put(ring);
+		return session_info ? -EEXIST : -EINVAL;
+	}
+	session_info->ring = ring;
+	mutex_unlock(&driver->md_session_lock);
+
+	DIAG_LOG(DIAG_DEBUG_USERSPACE, "md ring size %u for pid %d\n",
+		 ring->size, current->tgid);
+	return 0;
+}
+
 static int diag_ioctl_register_callback(unsigned long ioarg)
 {
 	int err = 0;
@@ -2355,6 +2391,9 @@ long diagchar_compat_ioctl(struct file *filp,
 	case DIAG_IOCTL_HDLC_TOGGLE:
 		result = diag_ioctl_hdlc_toggle(ioarg);
 		break;
+	case DIAG_IOCTL_MD_RING_SETUP:
+		result = diag_ioctl_md_ring_setup(ioarg);
+		break;
 	case DIAG_IOCTL_QUERY_CON_ALL:
 		con_param.diag_con_all = DIAG_CON_ALL;
 		con_param.num_peripherals = NUM_PERIPHERALS;
@@ -2491,6 +2530,9 @@ long diagchar_ioctl(struct file *filp,
 	case DIAG_IOCTL_HDLC_TOGGLE:
 		result = diag_ioctl_hdlc_toggle(ioarg);
 		break;
+	case DIAG_IOCTL_MD_RING_SETUP:
+		result = diag_ioctl_md_ring_setup(ioarg);
+		break;
 	case DIAG_IOCTL_QUERY_CON_ALL:
 		con_param.diag_con_all = DIAG_CON_ALL;
 		con_param.num_peripherals = NUM_PERIPHERALS;
@@ -3642,10 +3684,82 @@ static int diag_real_time_info_init(void)
 	return 0;
 }
 
+static void diagchar_vma_open(struct vm_area_struct *vma)
+{
+	diag_md_ring_get(vma->vm_private_data);
+}
+
+static void diagchar_vma_close(struct vm_area_struct *vma)
+{
+	diag_md_ring_put(vma->vm_private_data);
+}
+
+static const struct vm_operations_struct diagchar_vm_ops = {
+	.open = diagchar_vma_open,
+	.close = diagchar_vma_close,
+};
+
+static int diagchar_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	int err;
+	struct diag_md_ring *ring = NULL;
+	struct diag_md_session_t *session_info = NULL;
+
+	mutex_lock(&driver->md_session_lock);
+	session_info = diag_md_session_get_pid(current->tgid);
+	if (session_info && session_info->ring) {
+		ring = session_info->ring;
+		diag_md_ring_get(ring);
+	}
+	mutex_unlock(&driver->md_session_lock);
+
+	if (!ring)
+		return -EINVAL;
+
+	err = diag_md_ring_mmap(ring, vma);
+	if (err) {
+		diag_md_ring_put(ring);
+		return err;
+	}
+
+	/* The mapping keeps the ring alive after the session closes */
+	vma->vm_private_data = ring;
+	vma->vm_ops = &diagchar_vm_ops;
+	return 0;
+}
+
+static unsigned int diagchar_poll(struct file *file, poll_table *wait)
+{
+	int i;
+	unsigned int mask = 0;
+	struct diag_md_session_t *session_info = NULL;
+
+	poll_wait(file, &driver->wait_q, wait);
+
+	mutex_lock(&driver->diagchar_mutex);
+	for (i = 0; i < driver->num_clients; i++) {
+		if (driver->client_map[i].pid == current->tgid &&
+		    atomic_read(&driver->data_ready_notif[i]) > 0)
+			mask |= POLLIN | POLLRDNORM;
+	}
+	mutex_unlock(&driver->diagchar_mutex);
+
+	mutex_lock(&driver->md_session_lock);
+	session_info = diag_md_session_get_pid(current->tgid);
+	if (session_info && session_info->ring &&
+	    !diag_md_ring_empty(session_info->ring))
+		mask |= POLLIN | POLLRDNORM;
+	mutex_unlock(&driver->md_session_lock);
+
+	return mask;
+}
+
 static const struct file_operations diagcharfops = {
 	.owner = THIS_MODULE,
 	.read = diagchar_read,
 	.write = diagchar_write,
+	.mmap = diagchar_mmap,
+	.poll = diagchar_poll,
 #ifdef CONFIG_COMPAT
 	.compat_ioctl = diagchar_compat_ioctl,
 #endif
@@ -3804,6 +3918,7 @@ static int __init diagchar_init(void)
 	diag_stats_init();
 	diag_debug_init();
 	diag_md_session_init();
+	diag_hdlc_init();
 
 	driver->incoming_pkt.capacity = DIAG_MAX_REQ_SIZE;
 	driver->incoming_pkt.data = kzalloc(DIAG_MAX_REQ_SIZE, GFP_KERNEL);
@@ -20,6 +20,9 @@
 #include <linux/uaccess.h>
 #include <linux/ratelimit.h>
 #include <linux/crc-ccitt.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <asm/unaligned.h>
 #include "diagchar_hdlc.h"
 #include "diagchar.h"
 
@@ -31,6 +34,83 @@ MODULE_LICENSE("GPL v2");
 #define CRC_16_L_STEP(xx_crc, xx_c) \
 	crc_ccitt_byte(xx_crc, xx_c)
 
+/*
+ * Slice-by-8 tables for the reflected CRC-CCITT used by HDLC framing.
+ * crc_slice[0] is crc_ccitt_table; crc_slice[k][i] is the CRC of byte i
+ * followed by k zero bytes, so eight table lookups advance the CRC by
+ * eight input bytes at once.
+ */
+static uint16_t crc_slice[8][256];
+
+void diag_hdlc_init(void)
+{
+	unsigned int i, k;
+	uint16_t crc;
+
+	for (i = 0; i < 256; i++) {
+		crc = crc_ccitt_table[i];
+		crc_slice[0][i] = crc;
+		for (k = 1; k < 8; k++) {
+			crc = CRC_16_L_STEP(crc, 0);
+			crc_slice[k][i] = crc;
+		}
+	}
+}
+
+uint16_t diag_hdlc_crc(uint16_t crc, const uint8_t *buf, size_t len)
+{
+	uint32_t lo, hi;
+
+	for (; len >= 8; len -= 8, buf += 8) {
+		lo = get_unaligned_le32(buf) ^ crc;
+		hi = get_unaligned_le32(buf + 4);
+		crc = crc_slice[7][lo & 0xFF] ^
+		      crc_slice[6][(lo >> 8) & 0xFF] ^
+		      crc_slice[5][(lo >> 16) & 0xFF] ^
+		      crc_slice[4][lo >> 24] ^
+		      crc_slice[3][hi & 0xFF] ^
+		      crc_slice[2][(hi >> 8) & 0xFF] ^
+		      crc_slice[1][(hi >> 16) & 0xFF] ^
+		      crc_slice[0][hi >> 24];
+	}
+
+	while (len--)
+		crc = CRC_16_L_STEP(crc, *buf++);
+
+	return crc;
+}
+
+#define HDLC_ONES	REPEAT_BYTE(0x01)
+#define HDLC_HIGHS	REPEAT_BYTE(0x80)
+#define HDLC_HAS_BYTE(w, c) \
+	((((w) ^ REPEAT_BYTE(c)) - HDLC_ONES) & ~((w) ^ REPEAT_BYTE(c)) & \
+	 HDLC_HIGHS)
+
+/*
+ * Return the number of leading bytes in buf that need no escaping, i.e.
+ * are neither CONTROL_CHAR nor ESC_CHAR. Whole words are checked at a
+ * time and the word containing a special byte is finished bytewise.
+ */
+static size_t diag_hdlc_clean_run(const uint8_t *buf, size_t len)
+{
+	unsigned long word;
+	size_t i = 0;
+
+	for (; i + sizeof(word) <= len; i += sizeof(word)) {
+		word = get_unaligned((const unsigned long *)(buf + i));
+		if (HDLC_HAS_BYTE(word, CONTROL_CHAR) ||
+		    HDLC_HAS_BYTE(word, ESC_CHAR))
+			break;
+	}
+
+	for (; i < len; i++) {
+		if (buf[i] == CONTROL_CHAR || buf[i] == ESC_CHAR)
+			break;
+	}
+
+	return i;
+}
+
 void diag_hdlc_encode(struct diag_send_desc_type *src_desc,
 		      struct diag_hdlc_dest_type *enc)
 {
@@ -42,6 +122,7 @@ void diag_hdlc_encode(struct diag_send_desc_type *src_desc,
 	unsigned char src_byte = 0;
 	enum diag_send_state_enum_type state;
 	unsigned int used = 0;
+	size_t run;
 
 	if (src_desc && enc) {
 
@@ -67,34 +148,34 @@ void diag_hdlc_encode(struct diag_send_desc_type *src_desc,
 			   of 2 dest bytes for an escaped byte */
 			while (src <= src_last && dest <= dest_last) {
 
-				src_byte = *src++;
-
-				if ((src_byte == CONTROL_CHAR) ||
-				    (src_byte == ESC_CHAR)) {
-
-					/* If the escape character is not the
-					   last byte */
-					if (dest != dest_last) {
-						crc = CRC_16_L_STEP(crc,
-								    src_byte);
+				/* Copy bytes that need no escaping in bulk */
+				run = min_t(size_t, src_last - src + 1,
+					    dest_last - dest + 1);
+				run = diag_hdlc_clean_run(src, run);
+				if (run) {
+					crc = diag_hdlc_crc(crc, src, run);
+					memcpy(dest, src, run);
+					src += run;
+					dest += run;
+					used += run;
+					if (src > src_last || dest > dest_last)
+						break;
+				}
 
-						*dest++ = ESC_CHAR;
-						used++;
+				/* *src is CONTROL_CHAR or ESC_CHAR here. If
+				   the escape character is the last byte, it
+				   goes out with the next buffer */
+				if (dest == dest_last)
+					break;
 
-						*dest++ = src_byte
-							  ^ ESC_MASK;
-						used++;
-					} else {
+				src_byte = *src++;
+				crc = CRC_16_L_STEP(crc, src_byte);
 
-						src--;
-						break;
-					}
+				*dest++ = ESC_CHAR;
+				used++;
 
-				} else {
-					crc = CRC_16_L_STEP(crc, src_byte);
-					*dest++ = src_byte;
-					used++;
-				}
+				*dest++ = src_byte ^ ESC_MASK;
+				used++;
 			}
 
 			if (src > src_last) {
@@ -171,6 +252,7 @@ int diag_hdlc_decode(struct diag_hdlc_decode_type *hdlc)
 
 	unsigned int len = 0;
 	unsigned int i;
+	unsigned int run;
 	uint8_t src_byte;
 
 	int pkt_bnd = HDLC_INCOMPLETE;
@@ -192,6 +274,17 @@ int diag_hdlc_decode(struct diag_hdlc_decode_type *hdlc)
 
 		for (i = 0; i < src_length; i++) {
 
+			/* Copy bytes that need no unescaping in bulk */
+			if (!hdlc->escaping) {
+				run = diag_hdlc_clean_run(&src_ptr[i],
+					min(src_length - i, dest_length - len));
+				memcpy(&dest_ptr[len], &src_ptr[i], run);
+				len += run;
+				i += run;
+				if (len >= dest_length || i >= src_length)
+					break;
+			}
+
 			src_byte = src_ptr[i];
 
 			if (hdlc->escaping) {
@@ -251,7 +344,7 @@ int crc_check(uint8_t *buf, uint16_t len)
 	 * Run CRC check for the original input. Skip the last 3 CRC
 	 * bytes
 	 */
-	crc = crc_ccitt(crc, buf, len-3);
+	crc = diag_hdlc_crc(crc, buf, len-3);
 	crc ^= CRC_16_L_SEED;
 
 	/* Check the computed CRC against the original CRC bytes. */
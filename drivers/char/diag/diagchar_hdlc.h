@@ -56,6 +56,10 @@ int diag_hdlc_decode(struct diag_hdlc_decode_type *hdlc);
 
 int crc_check(uint8_t *buf, uint16_t len);
 
+void diag_hdlc_init(void);
+
+uint16_t diag_hdlc_crc(uint16_t crc, const uint8_t *buf, size_t len);
+
 #define ESC_CHAR     0x7D
 #define ESC_MASK     0x20
 
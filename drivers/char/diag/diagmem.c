@@ -158,45 +158,70 @@ void diagmem_setsize(int pool_idx, int itemsize, int poolsize)
 		 diag_mempools[pool_idx].poolsize);
 }
 
+/*
+ * A pool's count doubles as a reference on the pool itself. Allocations
+ * reserve a slot by bumping count without taking the pool lock, which
+ * mempool_alloc() already serializes internally. diagmem_exit() can only
+ * tear the pool down by moving an idle count from 0 to -1, so a pool is
+ * never destroyed while a reserved slot is being filled.
+ */
+static int diagmem_reserve(struct diag_mempool_t *mempool)
+{
+	atomic_t *count = (atomic_t *)&mempool->count;
+	int old;
+	int cur;
+
+	cur = atomic_read(count);
+	while (cur >= 0 && cur < mempool->poolsize) {
+		old = atomic_cmpxchg(count, cur, cur + 1);
+		if (old == cur)
+			return 1;
+		cur = old;
+	}
+
+	return 0;
+}
+
 void *diagmem_alloc(struct diagchar_dev *driver, int size, int pool_type)
 {
 	void *buf = NULL;
-	int i = 0;
-	unsigned long flags;
+	mempool_t *pool;
 	struct diag_mempool_t *mempool = NULL;
 
 	if (!driver)
 		return NULL;
 
-	for (i = 0; i < NUM_MEMORY_POOLS; i++) {
-		mempool = &diag_mempools[i];
-		if (pool_type != mempool->id)
-			continue;
-		if (!mempool->pool) {
+	if (pool_type < 0 || pool_type >= NUM_MEMORY_POOLS)
+		return NULL;
+
+	mempool = &diag_mempools[pool_type];
+	if (size == 0 || size > mempool->itemsize) {
+		pr_err_ratelimited("diag: cannot alloc from mempool %s, invalid size: %d\n",
+				   mempool->name, size);
+		return NULL;
+	}
+
+	if (diagmem_reserve(mempool)) {
+		pool = ACCESS_ONCE(mempool->pool);
+		if (!pool) {
+			atomic_dec((atomic_t *)&mempool->count);
 			pr_err_ratelimited("diag: %s mempool is not initialized yet\n",
 					   mempool->name);
-			break;
-		}
-		if (size == 0 || size > mempool->itemsize) {
-			pr_err_ratelimited("diag: cannot alloc from mempool %s, invalid size: %d\n",
-					   mempool->name, size);
-			break;
+			return NULL;
 		}
-		spin_lock_irqsave(&mempool->lock, flags);
-		if (mempool->count < mempool->poolsize) {
-			atomic_add(1, (atomic_t *)&mempool->count);
-			buf = mempool_alloc(mempool->pool, GFP_ATOMIC);
+		buf = mempool_alloc(pool, GFP_ATOMIC);
+		if (buf)
 			kmemleak_not_leak(buf);
-		}
-		spin_unlock_irqrestore(&mempool->lock, flags);
-		if (!buf) {
-			pr_debug_ratelimited("diag: Unable to allocate buffer from memory pool %s, size: %d/%d count: %d/%d\n",
-					     mempool->name,
-					     size, mempool->itemsize,
-					     mempool->count,
-					     mempool->poolsize);
-		}
-		break;
+		else
+			atomic_dec((atomic_t *)&mempool->count);
+	}
+
+	if (!buf) {
+		pr_debug_ratelimited("diag: Unable to allocate buffer from memory pool %s, size: %d/%d count: %d/%d\n",
+				     mempool->name,
+				     size, mempool->itemsize,
+				     mempool->count,
+				     mempool->poolsize);
 	}
 
 	return buf;
@@ -204,32 +229,30 @@ void *diagmem_alloc(struct diagchar_dev *driver, int size, int pool_type)
 
 void diagmem_free(struct diagchar_dev *driver, void *buf, int pool_type)
 {
-	int i = 0;
-	unsigned long flags;
 	struct diag_mempool_t *mempool = NULL;
 
 	if (!driver || !buf)
 		return;
 
-	for (i = 0; i < NUM_MEMORY_POOLS; i++) {
-		mempool = &diag_mempools[i];
-		if (pool_type != mempool->id)
-			continue;
-		if (!mempool->pool) {
-			pr_err_ratelimited("diag: %s mempool is not initialized yet\n",
-					   mempool->name);
-			break;
-		}
-		spin_lock_irqsave(&mempool->lock, flags);
-		if (mempool->count > 0) {
-			mempool_free(buf, mempool->pool);
-			atomic_add(-1, (atomic_t *)&mempool->count);
-		} else {
-			pr_err_ratelimited("diag: Attempting to free items from %s mempool which is already empty\n",
+	if (pool_type < 0 || pool_type >= NUM_MEMORY_POOLS)
+		return;
+
+	mempool = &diag_mempools[pool_type];
+	if (!mempool->pool) {
+		pr_err_ratelimited("diag: %s mempool is not initialized yet\n",
+				   mempool->name);
+		return;
+	}
+
+	/* Return the buffer before dropping the slot that pins the pool */
+	if (mempool->count > 0) {
+		mempool_free(buf, mempool->pool);
+		if (atomic_dec_if_positive((atomic_t *)&mempool->count) < 0)
+			pr_err_ratelimited("diag: %s mempool count underflow\n",
 					   mempool->name);
-		}
-		spin_unlock_irqrestore(&mempool->lock, flags);
-		break;
+	} else {
+		pr_err_ratelimited("diag: Attempting to free items from %s mempool which is already empty\n",
+				   mempool->name);
 	}
 }
 
@@ -282,9 +305,13 @@ void diagmem_exit(struct diagchar_dev *driver, int index)
 
 	mempool = &diag_mempools[index];
 	spin_lock_irqsave(&mempool->lock, flags);
-	if (mempool->count == 0 && mempool->pool != NULL) {
+	if (mempool->pool != NULL &&
+	    atomic_cmpxchg((atomic_t *)&mempool->count, 0, -1) == 0) {
 		mempool_destroy(mempool->pool);
 		mempool->pool = NULL;
+		/* Publish the NULL pool before allocations can reserve again */
+		smp_mb();
+		atomic_set((atomic_t *)&mempool->count, 0);
 	} else {
 		pr_err("diag: Unable to destory %s pool, count: %d\n",
 		       mempool->name, mempool->count);
@@ -22,6 +22,7 @@
 #include <linux/slab.h>
 #include <linux/input.h>
 #include <linux/time.h>
+#include <trace/events/power.h>
 
 struct cpu_sync {
 	int cpu;
@@ -41,7 +42,30 @@ module_param(input_boost_ms, uint, 0644);
 static bool sched_boost_on_input;
 module_param(sched_boost_on_input, bool, 0644);
 
+/*
+ * Related thread group (/proc/<pid>/sched_group_id) of the focused app's
+ * UI and render threads.  When set, only the clusters those threads are
+ * on get the input boost floor; 0 boosts every cpu.
+ */
+static unsigned int input_boost_group;
+module_param(input_boost_group, uint, 0644);
+
+/*
+ * When set, the boost lasts while display frames keep being committed and
+ * ends frame_idle_ms after the last one (or input_boost_ms after the input
+ * if no frame comes), up to input_boost_max_ms.  0 keeps the fixed
+ * input_boost_ms boost.
+ */
+static unsigned int frame_idle_ms;
+module_param(frame_idle_ms, uint, 0644);
+
+static unsigned int input_boost_max_ms = 1000;
+module_param(input_boost_max_ms, uint, 0644);
+
 static bool sched_boost_active;
+static bool input_boost_active;
+static ktime_t input_boost_start;
+static unsigned int input_boost_frames;
 
 static struct delayed_work input_boost_rem;
 static u64 last_input_time;
@@ -115,58 +139,46 @@ static const struct kernel_param_ops param_ops_input_boost_freq = {
 module_param_cb(input_boost_freq, &param_ops_input_boost_freq, NULL, 0644);
 
 /*
- * The CPUFREQ_ADJUST notifier is used to override the current policy min to
- * make sure policy min >= boost_min. The cpufreq framework then does the job
- * of enforcing the new policy.
- *
- * The sync kthread needs to run on the CPU in question to avoid deadlocks in
- * the wake up code. Achieve this by binding the thread to the respective
- * CPU. But a CPU going offline unbinds threads from that CPU. So, set it up
- * again each time the CPU comes back up. We can use CPUFREQ_START to figure
- * out a CPU is coming online instead of registering for hotplug notifiers.
+ * Each cpu's input_boost_min is cast as a boost vote; the cpufreq
+ * constraint aggregator enforces it as the policy min, below any thermal
+ * or userspace limit.
  */
-static int boost_adjust_notify(struct notifier_block *nb, unsigned long val,
-				void *data)
+static void update_policy_online(void)
 {
-	struct cpufreq_policy *policy = data;
-	unsigned int cpu = policy->cpu;
-	struct cpu_sync *s = &per_cpu(sync_info, cpu);
-	unsigned int ib_min = s->input_boost_min;
-
-	switch (val) {
-	case CPUFREQ_ADJUST:
-		if (!ib_min)
-			break;
-
-		pr_debug("CPU%u policy min before boost: %u kHz\n",
-			 cpu, policy->min);
-		pr_debug("CPU%u boost min: %u kHz\n", cpu, ib_min);
+	unsigned int i;
 
-		cpufreq_verify_within_limits(policy, ib_min, UINT_MAX);
+	for_each_possible_cpu(i)
+		cpufreq_constraint_set(CPUFREQ_CONSTRAINT_BOOST, i,
+				per_cpu(sync_info, i).input_boost_min, UINT_MAX);
+	cpufreq_constraint_update();
+}
 
-		pr_debug("CPU%u policy min after boost: %u kHz\n",
-			 cpu, policy->min);
-		break;
-	}
+static void input_boost_end(void)
+{
+	if (!input_boost_active)
+		return;
 
-	return NOTIFY_OK;
+	input_boost_active = false;
+	trace_cpu_boost_input_end(
+		ktime_to_ms(ktime_sub(ktime_get(), input_boost_start)),
+		input_boost_frames);
 }
 
-static struct notifier_block boost_adjust_nb = {
-	.notifier_call = boost_adjust_notify,
-};
-
-static void update_policy_online(void)
+/* Is @cpu in a cluster that runs one of @targets? */
+static bool input_boost_targeted(unsigned int cpu,
+				 const struct cpumask *targets)
 {
-	unsigned int i;
+	struct cpufreq_policy *policy;
+	bool ret;
 
-	/* Re-evaluate policy to trigger adjust notifier for online CPUs */
-	get_online_cpus();
-	for_each_online_cpu(i) {
-		pr_debug("Updating policy for CPU%d\n", i);
-		cpufreq_update_policy(i);
-	}
-	put_online_cpus();
+	policy = cpufreq_cpu_get(cpu);
+	if (!policy)
+		return cpumask_test_cpu(cpu, targets);
+
+	ret = cpumask_intersects(policy->related_cpus, targets);
+	cpufreq_cpu_put(policy);
+
+	return ret;
 }
 
 static void do_input_boost_rem(struct work_struct *work)
@@ -174,6 +186,8 @@ static void do_input_boost_rem(struct work_struct *work)
 	unsigned int i, ret;
 	struct cpu_sync *i_sync_info;
 
+	input_boost_end();
+
 	/* Reset the input_boost_min for all CPUs in the system */
 	pr_debug("Resetting input boost min for all CPUs\n");
 	for_each_possible_cpu(i) {
@@ -196,20 +210,35 @@ static void do_input_boost(struct work_struct *work)
 {
 	unsigned int i, ret;
 	struct cpu_sync *i_sync_info;
+	struct cpumask targets;
 
 	cancel_delayed_work_sync(&input_boost_rem);
+	input_boost_end();
 	if (sched_boost_active) {
 		sched_set_boost(0);
 		sched_boost_active = false;
 	}
 
-	/* Set the input_boost_min for all CPUs in the system */
-	pr_debug("Setting input boost min for all CPUs\n");
+	/* Boost the clusters of the focused app's threads, or all of them */
+	if (!input_boost_group ||
+	    !sched_get_group_cpus(input_boost_group, &targets))
+		cpumask_copy(&targets, cpu_possible_mask);
+
+	pr_debug("Setting input boost min for CPUs %#lx\n",
+		 cpumask_bits(&targets)[0]);
 	for_each_possible_cpu(i) {
 		i_sync_info = &per_cpu(sync_info, i);
-		i_sync_info->input_boost_min = i_sync_info->input_boost_freq;
+		i_sync_info->input_boost_min =
+			input_boost_targeted(i, &targets) ?
+			i_sync_info->input_boost_freq : 0;
 	}
 
+	input_boost_start = ktime_get();
+	input_boost_frames = 0;
+	input_boost_active = true;
+	trace_cpu_boost_input_start(cpumask_bits(&targets)[0],
+				    input_boost_group);
+
 	/* Update policies for all online CPUs */
 	update_policy_online();
 
@@ -226,6 +255,28 @@ static void do_input_boost(struct work_struct *work)
 					msecs_to_jiffies(input_boost_ms));
 }
 
+static int cpuboost_frame_notify(struct notifier_block *nb,
+				 unsigned long val, void *data)
+{
+	s64 elapsed_ms;
+
+	if (!frame_idle_ms || !ACCESS_ONCE(input_boost_active))
+		return NOTIFY_OK;
+
+	input_boost_frames++;
+	elapsed_ms = ktime_to_ms(ktime_sub(ktime_get(), input_boost_start));
+	if (elapsed_ms < input_boost_max_ms)
+		mod_delayed_work(cpu_boost_wq, &input_boost_rem,
+				 msecs_to_jiffies(min_t(s64, frame_idle_ms,
+					input_boost_max_ms - elapsed_ms)));
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block cpuboost_frame_nb = {
+	.notifier_call = cpuboost_frame_notify,
+};
+
 static void cpuboost_input_event(struct input_handle *handle,
 		unsigned int type, unsigned int code, int value)
 {
@@ -332,7 +383,7 @@ static int cpu_boost_init(void)
 		s = &per_cpu(sync_info, cpu);
 		s->cpu = cpu;
 	}
-	cpufreq_register_notifier(&boost_adjust_nb, CPUFREQ_POLICY_NOTIFIER);
+	cpufreq_register_notifier(&cpuboost_frame_nb, CPUFREQ_FRAME_NOTIFIER);
 	ret = input_register_handler(&cpuboost_input_handler);
 
 	return ret;
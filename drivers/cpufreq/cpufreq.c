@@ -85,6 +85,7 @@ static void handle_update(struct work_struct *work);
 static BLOCKING_NOTIFIER_HEAD(cpufreq_policy_notifier_list);
 static struct srcu_notifier_head cpufreq_transition_notifier_list;
 struct atomic_notifier_head cpufreq_govinfo_notifier_list;
+static ATOMIC_NOTIFIER_HEAD(cpufreq_frame_notifier_list);
 
 static bool init_cpufreq_transition_notifier_list_called;
 static int __init init_cpufreq_transition_notifier_list(void)
@@ -1944,6 +1945,10 @@ int cpufreq_register_notifier(struct notifier_block *nb, unsigned int list)
 		ret = atomic_notifier_chain_register(
 				&cpufreq_govinfo_notifier_list, nb);
 		break;
+	case CPUFREQ_FRAME_NOTIFIER:
+		ret = atomic_notifier_chain_register(
+				&cpufreq_frame_notifier_list, nb);
+		break;
 	default:
 		ret = -EINVAL;
 	}
@@ -1982,6 +1987,10 @@ int cpufreq_unregister_notifier(struct notifier_block *nb, unsigned int list)
 		ret = atomic_notifier_chain_unregister(
 				&cpufreq_govinfo_notifier_list, nb);
 		break;
+	case CPUFREQ_FRAME_NOTIFIER:
+		ret = atomic_notifier_chain_unregister(
+				&cpufreq_frame_notifier_list, nb);
+		break;
 	default:
 		ret = -EINVAL;
 	}
@@ -1990,6 +1999,18 @@ int cpufreq_unregister_notifier(struct notifier_block *nb, unsigned int list)
 }
 EXPORT_SYMBOL(cpufreq_unregister_notifier);
 
+/**
+ *	cpufreq_notify_frame_commit - tell CPUFREQ_FRAME_NOTIFIER users that
+ *	a display frame was committed
+ *
+ *	May be called from atomic context.
+ */
+void cpufreq_notify_frame_commit(void)
+{
+	atomic_notifier_call_chain(&cpufreq_frame_notifier_list, 0, NULL);
+}
+EXPORT_SYMBOL(cpufreq_notify_frame_commit);
+
 
 /*********************************************************************
  *                              GOVERNORS                            *
@@ -2075,6 +2096,38 @@ static int __target_index(struct cpufreq_policy *policy,
 	return retval;
 }
 
+/**
+ * cpufreq_driver_fast_switch - set a frequency from scheduler context
+ * @policy: policy with fast_switch_possible set
+ * @target_freq: new frequency, clamped to the policy limits
+ *
+ * Neither policy->rwsem nor the transition notifiers are used, which both
+ * may sleep, so notifier users only see the new frequency in policy->cur
+ * and the cpu_frequency tracepoint.  The caller serializes calls for the
+ * same policy.  Returns the frequency that was set, or 0.
+ */
+unsigned int cpufreq_driver_fast_switch(struct cpufreq_policy *policy,
+					unsigned int target_freq)
+{
+	unsigned int freq;
+	int cpu;
+
+	if (!policy->fast_switch_possible || !cpufreq_driver->fast_switch)
+		return 0;
+
+	target_freq = clamp_val(target_freq, policy->min, policy->max);
+
+	freq = cpufreq_driver->fast_switch(policy, target_freq);
+	if (freq) {
+		policy->cur = freq;
+		for_each_cpu(cpu, policy->cpus)
+			trace_cpu_frequency(freq, cpu);
+	}
+
+	return freq;
+}
+EXPORT_SYMBOL_GPL(cpufreq_driver_fast_switch);
+
 int __cpufreq_driver_target(struct cpufreq_policy *policy,
 			    unsigned int target_freq,
 			    unsigned int relation)
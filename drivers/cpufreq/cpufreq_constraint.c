@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2016, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Single aggregator for the min/max frequency votes of thermal, boost,
+ * perfd and user requesters.  Votes are recorded per cpu and resolved per
+ * policy in priority order from one policy notifier, and a policy is only
+ * re-evaluated when a batch of vote changes actually moves its range.
+ */
+
+#define pr_fmt(fmt) "cpufreq-constraint: " fmt
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/cpufreq.h>
+#include <linux/cpu.h>
+#include <linux/cpumask.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+
+struct cpufreq_vote {
+	unsigned int min;
+	unsigned int max;
+};
+
+static const char * const constraint_names[CPUFREQ_CONSTRAINT_NR] = {
+	[CPUFREQ_CONSTRAINT_THERMAL]	= "thermal",
+	[CPUFREQ_CONSTRAINT_USER]	= "user",
+	[CPUFREQ_CONSTRAINT_PERFD]	= "perfd",
+	[CPUFREQ_CONSTRAINT_BOOST]	= "boost",
+};
+
+static DEFINE_PER_CPU(struct cpufreq_vote [CPUFREQ_CONSTRAINT_NR], votes);
+/* Range last resolved for the policy of each cpu */
+static DEFINE_PER_CPU(struct cpufreq_vote, applied);
+
+/* Protects votes, applied and pending */
+static DEFINE_SPINLOCK(constraint_lock);
+static struct cpumask pending;
+/* Serializes the policy updates of concurrent batches */
+static DEFINE_MUTEX(constraint_update_lock);
+
+static void constraint_update_work(struct work_struct *work)
+{
+	cpufreq_constraint_update();
+}
+static DECLARE_WORK(constraint_work, constraint_update_work);
+
+/*
+ * Resolve the votes of the online cpus of a policy; called with
+ * constraint_lock held.  Offline cpus have no say, so a vote left behind
+ * by a cpu that went down can't pin its cluster.
+ */
+static void constraint_resolve(const struct cpumask *cpus,
+			       struct cpufreq_vote *range)
+{
+	unsigned int cpu, vmin, vmax;
+	int type;
+
+	range->min = 0;
+	range->max = UINT_MAX;
+
+	for (type = 0; type < CPUFREQ_CONSTRAINT_NR; type++) {
+		vmin = 0;
+		vmax = UINT_MAX;
+		for_each_cpu(cpu, cpus) {
+			vmin = max(vmin, per_cpu(votes, cpu)[type].min);
+			vmax = min(vmax, per_cpu(votes, cpu)[type].max);
+		}
+
+		/* Never undo what a higher priority requester asked for */
+		if (vmax < range->max)
+			range->max = max(vmax, range->min);
+		if (vmin > range->min)
+			range->min = min(vmin, range->max);
+	}
+}
+
+/**
+ * cpufreq_constraint_set - record a min/max frequency vote
+ * @type:	requester casting the vote
+ * @cpu:	cpu whose policy the vote applies to
+ * @min:	minimum frequency in kHz (0: none)
+ * @max:	maximum frequency in kHz (0 or UINT_MAX: none)
+ *
+ * The vote takes effect asynchronously, together with every other vote
+ * made in the meantime; call cpufreq_constraint_update() to apply the
+ * pending votes right away.  May be called from atomic context.
+ */
+int cpufreq_constraint_set(enum cpufreq_constraint_type type,
+			   unsigned int cpu, unsigned int min,
+			   unsigned int max)
+{
+	struct cpufreq_vote *vote;
+	unsigned long flags;
+
+	if (type >= CPUFREQ_CONSTRAINT_NR || cpu >= nr_cpu_ids)
+		return -EINVAL;
+
+	if (!max)
+		max = UINT_MAX;
+
+	spin_lock_irqsave(&constraint_lock, flags);
+	vote = &per_cpu(votes, cpu)[type];
+	if (vote->min == min && vote->max == max) {
+		spin_unlock_irqrestore(&constraint_lock, flags);
+		return 0;
+	}
+	vote->min = min;
+	vote->max = max;
+	cpumask_set_cpu(cpu, &pending);
+	spin_unlock_irqrestore(&constraint_lock, flags);
+
+	schedule_work(&constraint_work);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(cpufreq_constraint_set);
+
+/**
+ * cpufreq_constraint_update - apply all pending votes now
+ *
+ * Re-evaluates each online policy with a pending vote at most once, and
+ * only if the resolved range differs from the one last applied.
+ */
+void cpufreq_constraint_update(void)
+{
+	struct cpufreq_policy *policy;
+	struct cpufreq_vote range;
+	struct cpumask batch;
+	unsigned int cpu;
+	bool changed;
+	int ret;
+
+	mutex_lock(&constraint_update_lock);
+	spin_lock_irq(&constraint_lock);
+	cpumask_copy(&batch, &pending);
+	cpumask_clear(&pending);
+	spin_unlock_irq(&constraint_lock);
+
+	get_online_cpus();
+	for_each_cpu(cpu, &batch) {
+		policy = cpufreq_cpu_get(cpu);
+		if (!policy)
+			continue;
+		cpumask_andnot(&batch, &batch, policy->related_cpus);
+
+		spin_lock_irq(&constraint_lock);
+		constraint_resolve(policy->cpus, &range);
+		changed = range.min != per_cpu(applied, policy->cpu).min ||
+			  range.max != per_cpu(applied, policy->cpu).max;
+		spin_unlock_irq(&constraint_lock);
+
+		if (changed && cpu_online(policy->cpu)) {
+			ret = cpufreq_update_policy(policy->cpu);
+			if (ret)
+				pr_err("cpu%u policy update failed: %d\n",
+				       policy->cpu, ret);
+		}
+		cpufreq_cpu_put(policy);
+	}
+	put_online_cpus();
+	mutex_unlock(&constraint_update_lock);
+}
+EXPORT_SYMBOL_GPL(cpufreq_constraint_update);
+
+/*
+ * Apply the resolved range at CPUFREQ_INCOMPATIBLE so that it has the
+ * final say over any remaining CPUFREQ_ADJUST users.
+ */
+static int constraint_policy_notify(struct notifier_block *nb,
+				    unsigned long val, void *data)
+{
+	struct cpufreq_policy *policy = data;
+	struct cpufreq_vote range;
+	unsigned int cpu;
+
+	if (val != CPUFREQ_INCOMPATIBLE)
+		return NOTIFY_OK;
+
+	spin_lock_irq(&constraint_lock);
+	constraint_resolve(policy->cpus, &range);
+	for_each_cpu(cpu, policy->related_cpus)
+		per_cpu(applied, cpu) = range;
+	spin_unlock_irq(&constraint_lock);
+
+	pr_debug("cpu%u: limiting to %u-%u kHz\n", policy->cpu,
+		 range.min, range.max);
+	cpufreq_verify_within_limits(policy, range.min, range.max);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block constraint_policy_nb = {
+	.notifier_call = constraint_policy_notify,
+};
+
+static ssize_t show_constraints(struct kobject *kobj,
+				struct attribute *attr, char *buf)
+{
+	struct cpufreq_vote *vote;
+	unsigned int cpu;
+	ssize_t len = 0;
+	int type;
+
+	spin_lock_irq(&constraint_lock);
+	for_each_possible_cpu(cpu) {
+		len += scnprintf(buf + len, PAGE_SIZE - len, "cpu%u:", cpu);
+		for (type = 0; type < CPUFREQ_CONSTRAINT_NR; type++) {
+			vote = &per_cpu(votes, cpu)[type];
+			len += scnprintf(buf + len, PAGE_SIZE - len,
+					 " %s=%u-%u", constraint_names[type],
+					 vote->min, vote->max);
+		}
+		len += scnprintf(buf + len, PAGE_SIZE - len, " applied=%u-%u\n",
+				 per_cpu(applied, cpu).min,
+				 per_cpu(applied, cpu).max);
+	}
+	spin_unlock_irq(&constraint_lock);
+
+	return len;
+}
+define_one_global_ro(constraints);
+
+static int __init cpufreq_constraint_init(void)
+{
+	unsigned int cpu;
+	int type, ret;
+
+	for_each_possible_cpu(cpu) {
+		for (type = 0; type < CPUFREQ_CONSTRAINT_NR; type++)
+			per_cpu(votes, cpu)[type].max = UINT_MAX;
+		per_cpu(applied, cpu).max = UINT_MAX;
+	}
+
+	ret = cpufreq_register_notifier(&constraint_policy_nb,
+					CPUFREQ_POLICY_NOTIFIER);
+	if (ret)
+		return ret;
+
+	WARN_ON(cpufreq_get_global_kobject());
+	ret = sysfs_create_file(cpufreq_global_kobject, &constraints.attr);
+	if (ret)
+		pr_warn("cannot create constraints sysfs file: %d\n", ret);
+
+	return 0;
+}
+core_initcall(cpufreq_constraint_init);
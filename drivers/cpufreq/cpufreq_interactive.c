@@ -139,6 +139,14 @@ struct cpufreq_interactive_tunables {
 	bool use_sched_load;
 	bool use_migration_notif;
 
+	/*
+	 * With both of the above set the scheduler alerts the governor on
+	 * migrations and window rollovers that change the required
+	 * frequency, so the timer is only a fallback and fires every
+	 * fallback_windows windows.
+	 */
+	unsigned int fallback_windows;
+
 	/*
 	 * Whether to align timer windows across all CPUs. When
 	 * use_sched_load is true, this flag is ignored and windows
@@ -192,6 +200,20 @@ static u64 round_to_nw_start(u64 jif,
 	return ret;
 }
 
+/* Jiffy at which the policy timer next evaluates the load */
+static u64 next_eval_jiffy(u64 jif,
+			   struct cpufreq_interactive_tunables *tunables)
+{
+	u64 expires = round_to_nw_start(jif, tunables);
+
+	if (tunables->use_sched_load && tunables->use_migration_notif &&
+	    tunables->fallback_windows > 1)
+		expires += (u64)(tunables->fallback_windows - 1) *
+				usecs_to_jiffies(tunables->timer_rate);
+
+	return expires;
+}
+
 static inline int set_window_helper(
 			struct cpufreq_interactive_tunables *tunables)
 {
@@ -211,7 +233,7 @@ static void cpufreq_interactive_timer_resched(unsigned long cpu,
 	int i;
 
 	spin_lock_irqsave(&ppol->load_lock, flags);
-	expires = round_to_nw_start(ppol->last_evaluated_jiffy, tunables);
+	expires = next_eval_jiffy(ppol->last_evaluated_jiffy, tunables);
 	if (!slack_only) {
 		for_each_cpu(i, ppol->policy->cpus) {
 			pcpu = &per_cpu(cpuinfo, i);
@@ -247,7 +269,7 @@ static void cpufreq_interactive_timer_start(
 {
 	struct cpufreq_interactive_policyinfo *ppol = per_cpu(polinfo, cpu);
 	struct cpufreq_interactive_cpuinfo *pcpu;
-	u64 expires = round_to_nw_start(ppol->last_evaluated_jiffy, tunables);
+	u64 expires = next_eval_jiffy(ppol->last_evaluated_jiffy, tunables);
 	unsigned long flags;
 	int i;
 
@@ -1105,6 +1127,28 @@ show_store_one(ignore_hispeed_on_notif);
 show_store_one(fast_ramp_down);
 show_store_one(enable_prediction);
 
+static ssize_t show_fallback_windows(
+		struct cpufreq_interactive_tunables *tunables, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", tunables->fallback_windows);
+}
+
+static ssize_t store_fallback_windows(
+		struct cpufreq_interactive_tunables *tunables,
+		const char *buf, size_t count)
+{
+	int ret;
+	unsigned int val;
+
+	ret = kstrtouint(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	if (!val)
+		return -EINVAL;
+	tunables->fallback_windows = val;
+	return count;
+}
+
 static ssize_t show_go_hispeed_load(struct cpufreq_interactive_tunables
 		*tunables, char *buf)
 {
@@ -1499,6 +1543,7 @@ show_store_gov_pol_sys(align_windows);
 show_store_gov_pol_sys(ignore_hispeed_on_notif);
 show_store_gov_pol_sys(fast_ramp_down);
 show_store_gov_pol_sys(enable_prediction);
+show_store_gov_pol_sys(fallback_windows);
 #if defined(CONFIG_ARCH_MSM8953) || defined(CONFIG_ARCH_MSM8917)
 show_store_gov_pol_sys(lpm_disable_freq);
 #endif
@@ -1532,6 +1577,7 @@ gov_sys_pol_attr_rw(align_windows);
 gov_sys_pol_attr_rw(ignore_hispeed_on_notif);
 gov_sys_pol_attr_rw(fast_ramp_down);
 gov_sys_pol_attr_rw(enable_prediction);
+gov_sys_pol_attr_rw(fallback_windows);
 #if defined(CONFIG_ARCH_MSM8953) || defined(CONFIG_ARCH_MSM8917)
 gov_sys_pol_attr_rw(lpm_disable_freq);
 #endif
@@ -1562,6 +1608,7 @@ static struct attribute *interactive_attributes_gov_sys[] = {
 	&ignore_hispeed_on_notif_gov_sys.attr,
 	&fast_ramp_down_gov_sys.attr,
 	&enable_prediction_gov_sys.attr,
+	&fallback_windows_gov_sys.attr,
 #if defined(CONFIG_ARCH_MSM8953) || defined(CONFIG_ARCH_MSM8917)
 	&lpm_disable_freq_gov_sys.attr,
 #endif
@@ -1593,6 +1640,7 @@ static struct attribute *interactive_attributes_gov_pol[] = {
 	&ignore_hispeed_on_notif_gov_pol.attr,
 	&fast_ramp_down_gov_pol.attr,
 	&enable_prediction_gov_pol.attr,
+	&fallback_windows_gov_pol.attr,
 #if defined(CONFIG_ARCH_MSM8953) || defined(CONFIG_ARCH_MSM8917)
 	&lpm_disable_freq_gov_pol.attr,
 #endif
@@ -1635,6 +1683,7 @@ static struct cpufreq_interactive_tunables *alloc_tunable(
 	tunables->timer_rate = DEFAULT_TIMER_RATE;
 	tunables->boostpulse_duration_val = DEFAULT_MIN_SAMPLE_TIME;
 	tunables->timer_slack_val = DEFAULT_TIMER_SLACK;
+	tunables->fallback_windows = 1;
 
 	spin_lock_init(&tunables->target_loads_lock);
 	spin_lock_init(&tunables->above_hispeed_delay_lock);
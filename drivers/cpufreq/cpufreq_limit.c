@@ -37,6 +37,8 @@ struct cpufreq_limit_handle {
 static DEFINE_MUTEX(cpufreq_limit_lock);
 static LIST_HEAD(cpufreq_limit_requests);
 
+static void cpufreq_limit_update(void);
+
 /**
  * cpufreq_limit_get - limit min_freq or max_freq, return cpufreq_limit_handle
  * @min_freq	limit minimum frequency (0: none)
@@ -47,7 +49,6 @@ struct cpufreq_limit_handle *cpufreq_limit_get(unsigned long min_freq,
 		unsigned long max_freq, char *label)
 {
 	struct cpufreq_limit_handle *handle;
-	int i;
 
 	if (max_freq && max_freq < min_freq)
 		return ERR_PTR(-EINVAL);
@@ -71,13 +72,7 @@ struct cpufreq_limit_handle *cpufreq_limit_get(unsigned long min_freq,
 	list_add_tail(&handle->node, &cpufreq_limit_requests);
 	mutex_unlock(&cpufreq_limit_lock);
 
-	/* Re-evaluate policy to trigger adjust notifier for online CPUs */
-	get_online_cpus();
-
-	for_each_online_cpu(i)
-		cpufreq_update_policy(i);
-
-	put_online_cpus();
+	cpufreq_limit_update();
 
 	return handle;
 }
@@ -89,8 +84,6 @@ struct cpufreq_limit_handle *cpufreq_limit_get(unsigned long min_freq,
  */
 int cpufreq_limit_put(struct cpufreq_limit_handle *handle)
 {
-	int i;
-
 	if (handle == NULL || IS_ERR(handle))
 		return -EINVAL;
 
@@ -101,10 +94,7 @@ int cpufreq_limit_put(struct cpufreq_limit_handle *handle)
 	list_del(&handle->node);
 	mutex_unlock(&cpufreq_limit_lock);
 
-	get_online_cpus();
-	for_each_online_cpu(i)
-		cpufreq_update_policy(i);
-	put_online_cpus();
+	cpufreq_limit_update();
 
 	kfree(handle);
 	return 0;
@@ -367,15 +357,12 @@ ssize_t cpufreq_limit_get_table(char *buf)
 }
 #endif /* CONFIG_CPU_FREQ_LIMIT_HMP */
 
-static int cpufreq_limit_notifier_policy(struct notifier_block *nb,
-		unsigned long val, void *data)
+/* Resolve the limit requests into the USER vote for @policy's cpus */
+static void cpufreq_limit_vote(struct cpufreq_policy *policy)
 {
-	struct cpufreq_policy *policy = data;
 	struct cpufreq_limit_handle *handle;
 	unsigned long min = 0, max = ULONG_MAX;
-
-	if (val != CPUFREQ_ADJUST)
-		goto done;
+	unsigned int cpu;
 
 	mutex_lock(&cpufreq_limit_lock);
 	list_for_each_entry(handle, &cpufreq_limit_requests, node) {
@@ -391,18 +378,12 @@ static int cpufreq_limit_notifier_policy(struct notifier_block *nb,
 		policy->user_policy.min, policy->user_policy.max,
 		policy->min, policy->max);
 #endif
-/*
-	if (policy->user_policy.min > min)
-		min = policy->user_policy.min;
-	if (policy->user_policy.max && policy->user_policy.max < max)
-		max = policy->user_policy.max;
-*/
 
 	mutex_unlock(&cpufreq_limit_lock);
 
 	if (!min && max == ULONG_MAX) {
 		cpufreq_limit_hmp_boost(0);
-		goto done;
+		goto vote;
 	}
 
 	if (!min) {
@@ -421,9 +402,46 @@ static int cpufreq_limit_notifier_policy(struct notifier_block *nb,
 
 	pr_debug("%s: limiting cpu%d cpufreq to %lu-%lu\n", __func__,
 			policy->cpu, min, max);
+vote:
+	for_each_cpu(cpu, policy->related_cpus)
+		cpufreq_constraint_set(CPUFREQ_CONSTRAINT_USER, cpu, min,
+				       min_t(unsigned long, max, UINT_MAX));
+}
+
+/* Re-vote for every online policy and apply the result in one batch */
+static void cpufreq_limit_update(void)
+{
+	struct cpufreq_policy *policy;
+	struct cpumask done;
+	unsigned int cpu;
+
+	cpumask_clear(&done);
+	get_online_cpus();
+	for_each_online_cpu(cpu) {
+		if (cpumask_test_cpu(cpu, &done))
+			continue;
+		policy = cpufreq_cpu_get(cpu);
+		if (!policy)
+			continue;
+		cpufreq_limit_vote(policy);
+		cpumask_or(&done, &done, policy->related_cpus);
+		cpufreq_cpu_put(policy);
+	}
+	put_online_cpus();
+
+	cpufreq_constraint_update();
+}
+
+/*
+ * A policy coming up after its whole cluster was offline missed the
+ * updates made meanwhile; refresh its vote before it is first evaluated.
+ */
+static int cpufreq_limit_notifier_policy(struct notifier_block *nb,
+		unsigned long val, void *data)
+{
+	if (val == CPUFREQ_START)
+		cpufreq_limit_vote(data);
 
-	cpufreq_verify_within_limits(policy, min, max);
-done:
 	return 0;
 }
 
@@ -17,7 +17,20 @@
 #include <linux/of.h>
 #include <linux/sched.h>
 #include <linux/cputime.h>
+#include <linux/seqlock.h>
+#ifdef CONFIG_CPU_FREQ_UID_STAT
+#include <linux/hashtable.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/cred.h>
+#endif
 
+/*
+ * Only serializes table setup and the current_in_state readers.  The
+ * time-in-state accounting has a single writer per policy (the
+ * transition notifier, serialized by the cpufreq core) and readers
+ * sample it through stat->seq, so it never takes this lock.
+ */
 static spinlock_t cpufreq_stats_lock;
 
 struct cpufreq_stats {
@@ -27,13 +40,23 @@ struct cpufreq_stats {
 	unsigned int max_state;
 	unsigned int state_num;
 	unsigned int last_index;
+	seqcount_t seq;
 	u64 *time_in_state;
 	unsigned int *freq_table;
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	unsigned int *trans_table;
 #endif
+#ifdef CONFIG_CPU_FREQ_UID_STAT
+	unsigned int uid_base;
+#endif
 };
 
+#ifdef CONFIG_CPU_FREQ_STAT_DETAILS
+/* The trans_table costs max_state^2 ints per policy; allow opting out */
+static bool trans_table_enabled = true;
+module_param_named(trans_table, trans_table_enabled, bool, 0444);
+#endif
+
 struct all_cpufreq_stats {
 	unsigned int state_num;
 	cputime64_t *time_in_state;
@@ -55,6 +78,8 @@ static struct all_freq_table *all_freq_table;
 
 static DEFINE_PER_CPU(struct all_cpufreq_stats *, all_cpufreq_stats);
 static DEFINE_PER_CPU(struct cpufreq_stats *, cpufreq_stats_table);
+/* Policy stats for every related cpu, for the per-task accounting hooks */
+static DEFINE_PER_CPU(struct cpufreq_stats *, cpufreq_stats_cpu);
 static DEFINE_PER_CPU(struct cpufreq_power_stats *, cpufreq_power_stats);
 
 struct cpufreq_stats_attribute {
@@ -62,30 +87,57 @@ struct cpufreq_stats_attribute {
 	ssize_t(*show) (struct cpufreq_stats *, char *);
 };
 
-static int cpufreq_stats_update(unsigned int cpu)
+/*
+ * Called only from the transition notifier, which the cpufreq core
+ * serializes per policy, so plain stores inside the seqcount suffice.
+ */
+static void cpufreq_stats_update(struct cpufreq_stats *stat,
+				 unsigned int new_index)
 {
-	struct cpufreq_stats *stat;
 	struct all_cpufreq_stats *all_stat;
-	unsigned long long cur_time;
+	unsigned int old_index = stat->last_index;
+	unsigned long long cur_time, delta;
 
+	all_stat = per_cpu(all_cpufreq_stats, stat->cpu);
+
+	write_seqcount_begin(&stat->seq);
 	cur_time = get_jiffies_64();
-	spin_lock(&cpufreq_stats_lock);
-	stat = per_cpu(cpufreq_stats_table, cpu);
-	all_stat = per_cpu(all_cpufreq_stats, cpu);
-	if (!stat) {
-		spin_unlock(&cpufreq_stats_lock);
-		return 0;
-	}
-	if (stat->time_in_state) {
-		stat->time_in_state[stat->last_index] +=
-			cur_time - stat->last_time;
-		if (all_stat)
-			all_stat->time_in_state[stat->last_index] +=
-					cur_time - stat->last_time;
-	}
+	delta = cur_time - stat->last_time;
+	stat->time_in_state[old_index] += delta;
+	if (all_stat)
+		all_stat->time_in_state[old_index] += delta;
 	stat->last_time = cur_time;
-	spin_unlock(&cpufreq_stats_lock);
-	return 0;
+	if (old_index != new_index) {
+		stat->last_index = new_index;
+#ifdef CONFIG_CPU_FREQ_STAT_DETAILS
+		if (stat->trans_table)
+			stat->trans_table[old_index * stat->max_state +
+					  new_index]++;
+#endif
+		stat->total_trans++;
+	}
+	write_seqcount_end(&stat->seq);
+}
+
+/*
+ * Sample times[index] (stat->time_in_state or the matching all_stat
+ * array) including the time accrued in the current state since the last
+ * transition, without writing anything back.
+ */
+static u64 cpufreq_stats_read(struct cpufreq_stats *stat, const u64 *times,
+			      unsigned int index, u64 now)
+{
+	unsigned int seq;
+	u64 time;
+
+	do {
+		seq = read_seqcount_begin(&stat->seq);
+		time = times[index];
+		if (index == stat->last_index)
+			time += now - stat->last_time;
+	} while (read_seqcount_retry(&stat->seq, seq));
+
+	return time;
 }
 
 static ssize_t show_total_trans(struct cpufreq_policy *policy, char *buf)
@@ -93,26 +145,204 @@ static ssize_t show_total_trans(struct cpufreq_policy *policy, char *buf)
 	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
 	if (!stat)
 		return 0;
-	return sprintf(buf, "%d\n",
-			per_cpu(cpufreq_stats_table, stat->cpu)->total_trans);
+	return sprintf(buf, "%d\n", ACCESS_ONCE(stat->total_trans));
 }
 
 static ssize_t show_time_in_state(struct cpufreq_policy *policy, char *buf)
 {
 	ssize_t len = 0;
 	int i;
+	u64 now = get_jiffies_64();
 	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
 	if (!stat)
 		return 0;
-	cpufreq_stats_update(stat->cpu);
 	for (i = 0; i < stat->state_num; i++) {
 		len += sprintf(buf + len, "%u %llu\n", stat->freq_table[i],
-			(unsigned long long)
-			jiffies_64_to_clock_t(stat->time_in_state[i]));
+			(unsigned long long)jiffies_64_to_clock_t(
+			cpufreq_stats_read(stat, stat->time_in_state, i, now)));
 	}
 	return len;
 }
 
+#ifdef CONFIG_CPU_FREQ_UID_STAT
+/*
+ * Per-UID time-in-state.  Every policy owns uid_base..uid_base+state_num
+ * slots of a global state space, assigned the first time the policy is
+ * seen and kept across hotplug.  Entries are looked up locklessly under
+ * RCU from the tick; uid_lock only covers inserting or growing one.
+ */
+struct uid_entry {
+	uid_t uid;
+	unsigned int max_state;
+	struct hlist_node hash;
+	struct rcu_head rcu;
+	atomic64_t time_in_state[0];
+};
+
+static DEFINE_HASHTABLE(uid_hash_table, 7);
+static DEFINE_SPINLOCK(uid_lock);
+static DEFINE_MUTEX(uid_state_mutex);
+static unsigned int uid_nr_states;
+static unsigned int *uid_state_freqs;
+static DEFINE_PER_CPU(int, uid_state_base) = -1;
+
+static struct uid_entry *find_uid_entry_rcu(uid_t uid)
+{
+	struct uid_entry *uid_entry;
+
+	hash_for_each_possible_rcu(uid_hash_table, uid_entry, hash, uid) {
+		if (uid_entry->uid == uid)
+			return uid_entry;
+	}
+	return NULL;
+}
+
+/*
+ * Returns an entry for @uid with at least @index + 1 slots, allocating
+ * or growing it as needed.  Called from the tick, hence GFP_ATOMIC.
+ */
+static struct uid_entry *get_uid_entry(uid_t uid, unsigned int index)
+{
+	struct uid_entry *uid_entry, *old;
+	unsigned int max_state, i;
+	unsigned long flags;
+
+	uid_entry = find_uid_entry_rcu(uid);
+	if (likely(uid_entry && index < uid_entry->max_state))
+		return uid_entry;
+
+	spin_lock_irqsave(&uid_lock, flags);
+	old = find_uid_entry_rcu(uid);
+	if (old && index < old->max_state) {
+		uid_entry = old;
+		goto out;
+	}
+
+	max_state = max(ACCESS_ONCE(uid_nr_states), index + 1);
+	uid_entry = kzalloc(sizeof(*uid_entry) +
+			    max_state * sizeof(atomic64_t), GFP_ATOMIC);
+	if (!uid_entry)
+		goto out;
+	uid_entry->uid = uid;
+	uid_entry->max_state = max_state;
+
+	if (old) {
+		for (i = 0; i < old->max_state; i++)
+			atomic64_set(&uid_entry->time_in_state[i],
+				     atomic64_read(&old->time_in_state[i]));
+		hlist_replace_rcu(&old->hash, &uid_entry->hash);
+		kfree_rcu(old, rcu);
+	} else {
+		hash_add_rcu(uid_hash_table, &uid_entry->hash, uid);
+	}
+out:
+	spin_unlock_irqrestore(&uid_lock, flags);
+	return uid_entry;
+}
+
+static void acct_update_uid_time(struct task_struct *task,
+				 struct cpufreq_stats *stats,
+				 cputime_t cputime)
+{
+	struct uid_entry *uid_entry;
+	unsigned int index;
+	uid_t uid;
+
+	index = ACCESS_ONCE(stats->last_index);
+	if (unlikely(stats->uid_base == UINT_MAX || index >= stats->state_num))
+		return;
+
+	index += stats->uid_base;
+	uid = from_kuid_munged(&init_user_ns, task_uid(task));
+
+	rcu_read_lock();
+	uid_entry = get_uid_entry(uid, index);
+	if (uid_entry)
+		atomic64_add((__force u64)cputime,
+			     &uid_entry->time_in_state[index]);
+	rcu_read_unlock();
+}
+
+/* Reserve a range of the UID state space for @policy on first use */
+static void uid_stats_register_policy(struct cpufreq_policy *policy,
+				      struct cpufreq_stats *stat)
+{
+	unsigned int *freqs;
+	unsigned int cpu;
+	int base;
+
+	mutex_lock(&uid_state_mutex);
+	base = per_cpu(uid_state_base, policy->cpu);
+	if (base < 0) {
+		freqs = krealloc(uid_state_freqs, (uid_nr_states +
+				 stat->state_num) * sizeof(*freqs), GFP_KERNEL);
+		if (!freqs) {
+			mutex_unlock(&uid_state_mutex);
+			stat->uid_base = UINT_MAX;
+			return;
+		}
+		memcpy(freqs + uid_nr_states, stat->freq_table,
+		       stat->state_num * sizeof(*freqs));
+		uid_state_freqs = freqs;
+		base = uid_nr_states;
+		for_each_cpu(cpu, policy->related_cpus)
+			per_cpu(uid_state_base, cpu) = base;
+		ACCESS_ONCE(uid_nr_states) = uid_nr_states + stat->state_num;
+	}
+	stat->uid_base = base;
+	mutex_unlock(&uid_state_mutex);
+}
+
+static int uid_time_in_state_show(struct seq_file *m, void *v)
+{
+	struct uid_entry *uid_entry;
+	unsigned int i;
+	int bkt;
+
+	mutex_lock(&uid_state_mutex);
+	seq_puts(m, "uid:");
+	for (i = 0; i < uid_nr_states; i++)
+		seq_printf(m, " %u", uid_state_freqs[i]);
+	seq_putc(m, '\n');
+
+	rcu_read_lock();
+	hash_for_each_rcu(uid_hash_table, bkt, uid_entry, hash) {
+		seq_printf(m, "%d:", uid_entry->uid);
+		for (i = 0; i < uid_nr_states; i++) {
+			u64 time = 0;
+
+			if (i < uid_entry->max_state)
+				time = atomic64_read(
+					&uid_entry->time_in_state[i]);
+			seq_printf(m, " %llu", (unsigned long long)
+				   cputime64_to_clock_t(time));
+		}
+		seq_putc(m, '\n');
+	}
+	rcu_read_unlock();
+	mutex_unlock(&uid_state_mutex);
+	return 0;
+}
+
+static int uid_time_in_state_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, uid_time_in_state_show, NULL);
+}
+
+static const struct file_operations uid_time_in_state_fops = {
+	.open		= uid_time_in_state_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#else
+static inline void acct_update_uid_time(struct task_struct *task,
+					struct cpufreq_stats *stats,
+					cputime_t cputime) { }
+static inline void uid_stats_register_policy(struct cpufreq_policy *policy,
+					     struct cpufreq_stats *stat) { }
+#endif
+
 static int get_index_all_cpufreq_stat(struct all_cpufreq_stats *all_stat,
 		unsigned int freq)
 {
@@ -129,17 +359,23 @@ static int get_index_all_cpufreq_stat(struct all_cpufreq_stats *all_stat,
 void acct_update_power(struct task_struct *task, cputime_t cputime) {
 	struct cpufreq_power_stats *powerstats;
 	struct cpufreq_stats *stats;
-	unsigned int cpu_num, curr;
+	unsigned int cpu_num, curr, index;
 
 	if (!task)
 		return;
 	cpu_num = task_cpu(task);
+	stats = per_cpu(cpufreq_stats_cpu, cpu_num);
+	if (!stats)
+		return;
+
+	acct_update_uid_time(task, stats, cputime);
+
 	powerstats = per_cpu(cpufreq_power_stats, cpu_num);
-	stats = per_cpu(cpufreq_stats_table, cpu_num);
-	if (!powerstats || !stats)
+	index = ACCESS_ONCE(stats->last_index);
+	if (!powerstats || index >= powerstats->state_num)
 		return;
 
-	curr = powerstats->curr[stats->last_index];
+	curr = powerstats->curr[index];
 	if (task->cpu_power != ULLONG_MAX)
 		task->cpu_power += curr * cputime_to_usecs(cputime);
 }
@@ -174,14 +410,13 @@ static ssize_t show_all_time_in_state(struct kobject *kobj,
 	ssize_t len = 0;
 	unsigned int i, cpu, freq, index;
 	struct all_cpufreq_stats *all_stat;
+	struct cpufreq_stats *stat;
 	struct cpufreq_policy *policy;
+	u64 time, now = get_jiffies_64();
 
 	len += scnprintf(buf + len, PAGE_SIZE - len, "freq\t\t");
-	for_each_possible_cpu(cpu) {
+	for_each_possible_cpu(cpu)
 		len += scnprintf(buf + len, PAGE_SIZE - len, "cpu%d\t\t", cpu);
-		if (cpu_online(cpu))
-			cpufreq_stats_update(cpu);
-	}
 
 	if (!all_freq_table)
 		goto out;
@@ -193,11 +428,17 @@ static ssize_t show_all_time_in_state(struct kobject *kobj,
 			if (policy == NULL)
 				continue;
 			all_stat = per_cpu(all_cpufreq_stats, policy->cpu);
+			stat = per_cpu(cpufreq_stats_table, policy->cpu);
 			index = get_index_all_cpufreq_stat(all_stat, freq);
 			if (index != -1) {
+				time = (__force u64)all_stat->time_in_state[index];
+				if (stat)
+					time = cpufreq_stats_read(stat,
+						(__force u64 *)all_stat->time_in_state,
+						index, now);
 				len += scnprintf(buf + len, PAGE_SIZE - len,
 					"%llu\t\t", (unsigned long long)
-					cputime64_to_clock_t(all_stat->time_in_state[index]));
+					cputime64_to_clock_t(time));
 			} else {
 				len += scnprintf(buf + len, PAGE_SIZE - len,
 						"N/A\t\t");
@@ -218,9 +459,8 @@ static ssize_t show_trans_table(struct cpufreq_policy *policy, char *buf)
 	int i, j;
 
 	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
-	if (!stat)
+	if (!stat || !stat->trans_table)
 		return 0;
-	cpufreq_stats_update(stat->cpu);
 	len += snprintf(buf + len, PAGE_SIZE - len, "   From  :    To\n");
 	len += snprintf(buf + len, PAGE_SIZE - len, "         : ");
 	for (i = 0; i < stat->state_num; i++) {
@@ -269,8 +509,22 @@ static struct attribute *default_attrs[] = {
 #endif
 	NULL
 };
+
+#ifdef CONFIG_CPU_FREQ_STAT_DETAILS
+static umode_t stats_attr_visible(struct kobject *kobj,
+				  struct attribute *attr, int n)
+{
+	if (attr == &trans_table.attr && !trans_table_enabled)
+		return 0;
+	return attr->mode;
+}
+#endif
+
 static struct attribute_group stats_attr_group = {
 	.attrs = default_attrs,
+#ifdef CONFIG_CPU_FREQ_STAT_DETAILS
+	.is_visible = stats_attr_visible,
+#endif
 	.name = "stats"
 };
 
@@ -292,12 +546,18 @@ static int freq_table_get_index(struct cpufreq_stats *stat, unsigned int freq)
 static void __cpufreq_stats_free_table(struct cpufreq_policy *policy)
 {
 	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
+	unsigned int cpu;
 
 	if (!stat)
 		return;
 
 	pr_debug("%s: Free stat table\n", __func__);
 
+	for_each_cpu(cpu, policy->related_cpus)
+		per_cpu(cpufreq_stats_cpu, cpu) = NULL;
+	/* acct_update_power() runs from the tick with irqs off */
+	synchronize_sched();
+
 	sysfs_remove_group(&policy->kobj, &stats_attr_group);
 	kfree(stat->time_in_state);
 	kfree(stat);
@@ -383,7 +643,8 @@ static int __cpufreq_stats_create_table(struct cpufreq_policy *policy,
 	alloc_size = count * sizeof(int) + count * sizeof(u64);
 
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
-	alloc_size += count * count * sizeof(int);
+	if (trans_table_enabled)
+		alloc_size += count * count * sizeof(int);
 #endif
 	stat->max_state = count;
 	stat->time_in_state = kzalloc(alloc_size, GFP_KERNEL);
@@ -394,17 +655,22 @@ static int __cpufreq_stats_create_table(struct cpufreq_policy *policy,
 	stat->freq_table = (unsigned int *)(stat->time_in_state + count);
 
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
-	stat->trans_table = stat->freq_table + count;
+	if (trans_table_enabled)
+		stat->trans_table = stat->freq_table + count;
 #endif
 	i = 0;
 	cpufreq_for_each_valid_entry(pos, table)
 		if (freq_table_get_index(stat, pos->frequency) == -1)
 			stat->freq_table[i++] = pos->frequency;
 	stat->state_num = i;
-	spin_lock(&cpufreq_stats_lock);
+	seqcount_init(&stat->seq);
 	stat->last_time = get_jiffies_64();
 	stat->last_index = freq_table_get_index(stat, policy->cur);
-	spin_unlock(&cpufreq_stats_lock);
+	uid_stats_register_policy(policy, stat);
+	/* Publish to the accounting hooks only once fully set up */
+	smp_wmb();
+	for_each_cpu(i, policy->related_cpus)
+		per_cpu(cpufreq_stats_cpu, i) = stat;
 	return 0;
 error_alloc:
 	sysfs_remove_group(&policy->kobj, &stats_attr_group);
@@ -655,18 +921,7 @@ static int cpufreq_stat_notifier_trans(struct notifier_block *nb,
 	if (old_index == -1 || new_index == -1)
 		return 0;
 
-	cpufreq_stats_update(freq->cpu);
-
-	if (old_index == new_index)
-		return 0;
-
-	spin_lock(&cpufreq_stats_lock);
-	stat->last_index = new_index;
-#ifdef CONFIG_CPU_FREQ_STAT_DETAILS
-	stat->trans_table[old_index * stat->max_state + new_index]++;
-#endif
-	stat->total_trans++;
-	spin_unlock(&cpufreq_stats_lock);
+	cpufreq_stats_update(stat, new_index);
 	return 0;
 }
 
@@ -718,6 +973,11 @@ static int __init cpufreq_stats_init(void)
 	if (ret)
 		pr_warn("Cannot create sysfs file for cpufreq current stats\n");
 
+#ifdef CONFIG_CPU_FREQ_UID_STAT
+	if (!proc_create("uid_time_in_state", 0444, NULL,
+			 &uid_time_in_state_fops))
+		pr_warn("Cannot create /proc/uid_time_in_state\n");
+#endif
 	return 0;
 }
 static void __exit cpufreq_stats_exit(void)
@@ -732,6 +992,9 @@ static void __exit cpufreq_stats_exit(void)
 		cpufreq_stats_free_table(cpu);
 	cpufreq_allstats_free();
 	cpufreq_powerstats_free();
+#ifdef CONFIG_CPU_FREQ_UID_STAT
+	remove_proc_entry("uid_time_in_state", NULL);
+#endif
 	cpufreq_put_global_kobject();
 }
 
@@ -40,6 +40,7 @@ static struct clk *cpu_clk[NR_CPUS];
 static struct clk *l2_clk;
 static DEFINE_PER_CPU(struct cpufreq_frequency_table *, freq_table);
 static bool hotplug_ready;
+static bool fast_switch_ok;
 
 struct cpufreq_suspend_t {
 	struct mutex suspend_mutex;
@@ -117,6 +118,39 @@ done:
 	return ret;
 }
 
+/*
+ * Scheduler driven switch: called with interrupts off, so no suspend_mutex
+ * and no transition notifiers.  Only enabled when the DT says the cpu
+ * clock's set_rate does not sleep (qcom,cpufreq-fast-switch).
+ */
+static unsigned int msm_cpufreq_fast_switch(struct cpufreq_policy *policy,
+					    unsigned int target_freq)
+{
+	struct cpufreq_frequency_table *table = per_cpu(freq_table, policy->cpu);
+	unsigned int new_freq;
+	unsigned long rate;
+	int index;
+
+	if (per_cpu(suspend_data, policy->cpu).device_suspended || !table)
+		return 0;
+
+	if (cpufreq_frequency_table_target(policy, table, target_freq,
+					   CPUFREQ_RELATION_L, &index))
+		return 0;
+
+	new_freq = table[index].frequency;
+	if (new_freq == policy->cur)
+		return 0;
+
+	trace_cpu_frequency_switch_start(policy->cur, new_freq, policy->cpu);
+	rate = clk_round_rate(cpu_clk[policy->cpu], new_freq * 1000);
+	if (clk_set_rate(cpu_clk[policy->cpu], rate))
+		return 0;
+	trace_cpu_frequency_switch_end(policy->cpu);
+
+	return new_freq;
+}
+
 static int msm_cpufreq_verify(struct cpufreq_policy *policy)
 {
 	cpufreq_verify_within_limits(policy, policy->cpuinfo.min_freq,
@@ -151,6 +185,8 @@ static int msm_cpufreq_init(struct cpufreq_policy *policy)
 	if (cpufreq_frequency_table_cpuinfo(policy, table))
 		pr_err("cpufreq: failed to get policy min/max\n");
 
+	policy->fast_switch_possible = fast_switch_ok;
+
 	cur_freq = clk_get_rate(cpu_clk[policy->cpu])/1000;
 
 	if (cpufreq_frequency_table_target(policy, table, cur_freq,
@@ -315,6 +351,7 @@ static struct cpufreq_driver msm_cpufreq_driver = {
 	.init		= msm_cpufreq_init,
 	.verify		= msm_cpufreq_verify,
 	.target		= msm_cpufreq_target,
+	.fast_switch	= msm_cpufreq_fast_switch,
 	.get		= msm_cpufreq_get_freq,
 	.name		= "msm",
 	.attr		= msm_freq_attr,
@@ -415,6 +452,10 @@ static int __init msm_cpufreq_probe(struct platform_device *pdev)
 	if (of_property_read_bool(dev->of_node, "qcom,governor-per-policy"))
 		msm_cpufreq_driver.flags |= CPUFREQ_HAVE_GOVERNOR_PER_POLICY;
 
+	/* cpu clocks that can be reprogrammed with interrupts disabled */
+	fast_switch_ok = of_property_read_bool(dev->of_node,
+					       "qcom,cpufreq-fast-switch");
+
 	/* Parse commong cpufreq table for all CPUs */
 	ftbl = cpufreq_parse_dt(dev, "qcom,cpufreq-table", 0);
 	if (!IS_ERR(ftbl)) {
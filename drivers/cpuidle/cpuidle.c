@@ -19,6 +19,8 @@
 #include <linux/ktime.h>
 #include <linux/hrtimer.h>
 #include <linux/module.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <trace/events/power.h>
 
 #include "cpuidle.h"
@@ -104,6 +106,182 @@ static int cpuidle_find_deepest_state(struct cpuidle_driver *drv,
 	return ret;
 }
 
+/*
+ * Wakeup source attribution.  cpuidle_enter_state() arms
+ * cpuidle_wakeup_pending with the state index (+1) before going idle, and
+ * the first irq or ipi handled on the way out is charged with the wakeup.
+ * The counters are only ever written by their own cpu with irqs off.
+ */
+#define CPUIDLE_WAKEUP_IRQS	16
+#define CPUIDLE_WAKEUP_IPIS	8
+
+struct cpuidle_wakeup_src {
+	unsigned int irq;
+	unsigned long count;
+	unsigned long deep;	/* woken from a state deeper than the first */
+	unsigned long cluster;	/* also woke the cpu's cluster */
+};
+
+struct cpuidle_wakeup_stats {
+	struct cpuidle_wakeup_src irqs[CPUIDLE_WAKEUP_IRQS];
+	struct cpuidle_wakeup_src ipis[CPUIDLE_WAKEUP_IPIS];
+	unsigned long other;	/* irqs that did not fit in irqs[] */
+	unsigned long unknown;	/* left idle without taking an interrupt */
+	bool cluster;		/* the pending wakeup also woke the cluster */
+	int last_state;
+	unsigned int last_irq;	/* 0: not an irq */
+	int last_ipi;		/* ipi + 1, 0: not an ipi */
+	unsigned int steer_irq;	/* last irq that woke the cluster */
+};
+
+DEFINE_PER_CPU(int, cpuidle_wakeup_pending);
+EXPORT_PER_CPU_SYMBOL_GPL(cpuidle_wakeup_pending);
+static DEFINE_PER_CPU(struct cpuidle_wakeup_stats, cpuidle_wakeup);
+static const char *cpuidle_wakeup_ipi_names[CPUIDLE_WAKEUP_IPIS];
+
+void __cpuidle_note_wakeup(unsigned int irq, int ipi, const char *ipi_name)
+{
+	struct cpuidle_wakeup_stats *ws = this_cpu_ptr(&cpuidle_wakeup);
+	struct cpuidle_wakeup_src *src = NULL;
+	int state, i;
+
+	state = this_cpu_xchg(cpuidle_wakeup_pending, 0);
+	if (!state)
+		return;
+
+	ws->last_state = state - 1;
+	ws->last_irq = irq;
+	ws->last_ipi = irq ? 0 : ipi + 1;
+
+	if (irq) {
+		for (i = 0; i < CPUIDLE_WAKEUP_IRQS; i++) {
+			if (ws->irqs[i].irq == irq || !ws->irqs[i].count) {
+				src = &ws->irqs[i];
+				src->irq = irq;
+				break;
+			}
+		}
+		if (ws->cluster)
+			ws->steer_irq = irq;
+	} else if (ipi >= 0 && ipi < CPUIDLE_WAKEUP_IPIS) {
+		src = &ws->ipis[ipi];
+		if (ipi_name)
+			cpuidle_wakeup_ipi_names[ipi] = ipi_name;
+	}
+
+	if (src) {
+		src->count++;
+		if (state > 1)
+			src->deep++;
+		if (ws->cluster)
+			src->cluster++;
+	} else {
+		ws->other++;
+	}
+	ws->cluster = false;
+}
+EXPORT_SYMBOL_GPL(__cpuidle_note_wakeup);
+
+/**
+ * cpuidle_note_cluster_wakeup - the idle period being left woke the cluster
+ *
+ * Called by drivers with cluster level states, irqs off, before they
+ * re-enable interrupts, so that the wakeup source is also counted as a
+ * cluster wakeup.
+ */
+void cpuidle_note_cluster_wakeup(void)
+{
+	if (__this_cpu_read(cpuidle_wakeup_pending))
+		__this_cpu_write(cpuidle_wakeup.cluster, true);
+}
+EXPORT_SYMBOL_GPL(cpuidle_note_cluster_wakeup);
+
+/**
+ * cpuidle_cluster_wakeup_irq - consume the irq that last woke the cluster
+ *
+ * Returns the irq charged with the last cluster wakeup of this cpu that
+ * hasn't been consumed yet, or 0.
+ */
+unsigned int cpuidle_cluster_wakeup_irq(void)
+{
+	return this_cpu_xchg(cpuidle_wakeup.steer_irq, 0);
+}
+EXPORT_SYMBOL_GPL(cpuidle_cluster_wakeup_irq);
+
+/* Nothing was handled on the way out of idle: need_resched, polling, ... */
+static void cpuidle_wakeup_end(void)
+{
+	struct cpuidle_wakeup_stats *ws = this_cpu_ptr(&cpuidle_wakeup);
+	int state;
+
+	state = this_cpu_xchg(cpuidle_wakeup_pending, 0);
+	if (!state)
+		return;
+
+	ws->last_state = state - 1;
+	ws->last_irq = 0;
+	ws->last_ipi = 0;
+	ws->cluster = false;
+	ws->unknown++;
+}
+
+static void cpuidle_wakeup_show_src(struct seq_file *m, const char *name,
+				    struct cpuidle_wakeup_src *src)
+{
+	seq_printf(m, "  %-10s %10lu deep %10lu cluster %10lu\n", name,
+		   src->count, src->deep, src->cluster);
+}
+
+static int cpuidle_wakeups_show(struct seq_file *m, void *v)
+{
+	struct cpuidle_wakeup_stats *ws;
+	const char *name;
+	char buf[16];
+	int cpu, i;
+
+	for_each_possible_cpu(cpu) {
+		ws = &per_cpu(cpuidle_wakeup, cpu);
+		seq_printf(m, "cpu%d: last state %d ", cpu, ws->last_state);
+		if (ws->last_irq)
+			seq_printf(m, "irq %u", ws->last_irq);
+		else if (ws->last_ipi)
+			seq_printf(m, "ipi %d", ws->last_ipi - 1);
+		else
+			seq_puts(m, "none");
+		seq_printf(m, " unknown %lu other %lu\n", ws->unknown,
+			   ws->other);
+
+		for (i = 0; i < CPUIDLE_WAKEUP_IRQS && ws->irqs[i].count; i++) {
+			snprintf(buf, sizeof(buf), "irq%u", ws->irqs[i].irq);
+			cpuidle_wakeup_show_src(m, buf, &ws->irqs[i]);
+		}
+		for (i = 0; i < CPUIDLE_WAKEUP_IPIS; i++) {
+			if (!ws->ipis[i].count)
+				continue;
+			name = cpuidle_wakeup_ipi_names[i];
+			if (!name) {
+				snprintf(buf, sizeof(buf), "ipi%d", i);
+				name = buf;
+			}
+			cpuidle_wakeup_show_src(m, name, &ws->ipis[i]);
+		}
+	}
+
+	return 0;
+}
+
+static int cpuidle_wakeups_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cpuidle_wakeups_show, NULL);
+}
+
+static const struct file_operations cpuidle_wakeups_fops = {
+	.open		= cpuidle_wakeups_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 /**
  * cpuidle_enter_state - enter the state and update stats
  * @dev: cpuidle device for this cpu
@@ -122,13 +300,16 @@ int cpuidle_enter_state(struct cpuidle_device *dev, struct cpuidle_driver *drv,
 	trace_cpu_idle_rcuidle(index, dev->cpu);
 	time_start = ktime_get();
 
+	__this_cpu_write(cpuidle_wakeup_pending, index + 1);
 	entered_state = target_state->enter(dev, drv, index);
 
 	time_end = ktime_get();
 	trace_cpu_idle_rcuidle(PWR_EVENT_EXIT, dev->cpu);
 
-	if (!cpuidle_state_is_coupled(dev, drv, entered_state))
+	if (!cpuidle_state_is_coupled(dev, drv, entered_state)) {
 		local_irq_enable();
+		cpuidle_wakeup_end();
+	}
 
 	diff = ktime_to_us(ktime_sub(time_end, time_start));
 	if (diff > INT_MAX)
@@ -588,6 +769,8 @@ static int __init cpuidle_init(void)
 		return ret;
 
 	latency_notifier_init(&cpuidle_latency_notifier);
+	debugfs_create_file("cpuidle_wakeups", S_IRUGO, NULL, NULL,
+			    &cpuidle_wakeups_fops);
 
 	return 0;
 }
@@ -19,6 +19,9 @@
 #include <linux/mutex.h>
 #include <linux/clk.h>
 #include <linux/cpu.h>
+#include <linux/irq.h>
+#include <linux/interrupt.h>
+#include <linux/workqueue.h>
 #include <linux/of.h>
 #include <linux/irqchip/msm-mpm-irq.h>
 #include <linux/hrtimer.h>
@@ -35,6 +38,9 @@
 #include <linux/moduleparam.h>
 #include <linux/sched.h>
 #include <linux/cpu_pm.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <clocksource/arm_arch_timer.h>
 #include <soc/qcom/spm.h>
 #include <soc/qcom/pm.h>
 #include <soc/qcom/rpm-notifier.h>
@@ -152,6 +158,200 @@ module_param_named(sleep_disabled,
 static uint32_t bias_hyst;
 module_param_named(bias_hyst, bias_hyst, uint, 0664);
 
+/*
+ * Idle duration prediction from the recent history of each cpu's actual
+ * residencies, which catches periodic non-timer wakeups (IRQs, IPIs) the
+ * next timer event knows nothing about.  When a prediction keeps a cpu
+ * shallower than its timers would allow, a history timer wakes it at the
+ * predicted time plus tmr_add so a wrong guess only costs one shallow
+ * period before the cpu goes deep.
+ */
+#define MAXSAMPLES 5
+
+struct lpm_history {
+	uint32_t resi[MAXSAMPLES];
+	uint32_t hptr;
+	int nsamp;
+	bool hinvalid;
+	bool htmr_wkup;
+	bool htmr_fired;	/* woken by the history timer this time */
+	int64_t pred_wakeup;	/* ns; 0 when nothing was predicted */
+};
+
+static DEFINE_PER_CPU(struct lpm_history, hist);
+static DEFINE_PER_CPU(struct hrtimer, histtimer);
+
+static bool lpm_prediction = true;
+module_param_named(lpm_prediction, lpm_prediction, bool, 0664);
+
+/* A history this steady (us) is trusted whatever its average */
+static uint32_t ref_stddev = 100;
+module_param_named(ref_stddev, ref_stddev, uint, 0664);
+
+static uint32_t tmr_add = 100;
+module_param_named(tmr_add, tmr_add, uint, 0664);
+
+/*
+ * Runtime entry/exit latency of each cpu level.  Entry is the software
+ * cost from lpm_cpuidle_enter() up to the sleep call, timed with the
+ * architected counter; exit is how late the cpu got back after the
+ * timer event it slept until, so it is only sampled on timer wakeups.
+ * Each is kept as a histogram with four buckets per power of two, halved
+ * every LAT_DECAY samples so that the percentiles follow temperature and
+ * voltage drift.
+ */
+#define LAT_BUCKETS	64
+#define LAT_DECAY	1024
+#define LAT_REFRESH	64
+#define LAT_MAX_US	10000
+
+struct lpm_lat_hist {
+	uint32_t bucket[LAT_BUCKETS];
+	uint32_t count;
+};
+
+struct lpm_level_lat {
+	struct lpm_lat_hist entry;
+	struct lpm_lat_hist exit;
+	uint32_t measured_us;	/* entry + exit at latency_pct, 0 if unknown */
+};
+
+static DEFINE_PER_CPU(struct lpm_level_lat [NR_LPM_LEVELS], lpm_lat);
+
+/*
+ * Move a movable irq that woke a cluster out of cluster idle over to the
+ * cpus of other clusters that aren't voting for cluster idle.
+ */
+static bool irq_steer;
+module_param_named(irq_steer, irq_steer, bool, 0664);
+
+struct lpm_steer {
+	struct work_struct work;
+	unsigned int irq;
+};
+
+static DEFINE_PER_CPU(struct lpm_steer, lpm_steer);
+
+/* Use the measured cpu level latencies instead of the DT ones */
+static bool use_measured_latency;
+module_param_named(use_measured_latency, use_measured_latency, bool, 0664);
+
+static uint32_t latency_pct = 90;
+module_param_named(latency_pct, latency_pct, uint, 0664);
+
+static int lat_bucket(uint32_t us)
+{
+	int f;
+
+	if (us < 4)
+		return us;
+
+	f = fls(us) - 1;
+	return min((f - 1) * 4 + (int)((us >> (f - 2)) & 3), LAT_BUCKETS - 1);
+}
+
+/* Smallest latency (us) falling into bucket @idx */
+static uint32_t lat_bucket_floor(int idx)
+{
+	if (idx < 4)
+		return idx;
+
+	return (4 + (idx & 3)) << (idx / 4 - 1);
+}
+
+static uint32_t lat_percentile(struct lpm_lat_hist *hist, uint32_t pct)
+{
+	uint64_t target;
+	uint32_t sum = 0;
+	int i;
+
+	if (!hist->count)
+		return 0;
+
+	target = (uint64_t)hist->count * min(pct, 100U);
+	target = DIV_ROUND_UP_ULL(target, 100);
+
+	for (i = 0; i < LAT_BUCKETS - 1; i++) {
+		sum += hist->bucket[i];
+		if (sum >= target)
+			return lat_bucket_floor(i + 1) - 1;
+	}
+
+	return lat_bucket_floor(LAT_BUCKETS - 1);
+}
+
+static void lat_hist_add(struct lpm_lat_hist *hist, uint32_t us)
+{
+	int i;
+
+	if (hist->count >= LAT_DECAY) {
+		hist->count = 0;
+		for (i = 0; i < LAT_BUCKETS; i++) {
+			hist->bucket[i] >>= 1;
+			hist->count += hist->bucket[i];
+		}
+	}
+
+	hist->bucket[lat_bucket(us)]++;
+	hist->count++;
+}
+
+static void lpm_lat_update(int cpu, int idx, uint64_t entry_cycles,
+		int64_t wake_ns, int64_t expected_ns)
+{
+	struct lpm_level_lat *lat = &per_cpu(lpm_lat, cpu)[idx];
+	uint32_t rate = arch_timer_get_rate();
+	uint32_t entry_us, exit_us;
+
+	if (!rate || idx >= NR_LPM_LEVELS)
+		return;
+
+	entry_us = (uint32_t)div_u64(entry_cycles * USEC_PER_SEC, rate);
+	if (entry_us < LAT_MAX_US)
+		lat_hist_add(&lat->entry, entry_us);
+
+	/* Woken before the timer: some other interrupt, nothing to learn */
+	if (wake_ns < expected_ns)
+		return;
+
+	exit_us = (uint32_t)div_s64(wake_ns - expected_ns, NSEC_PER_USEC);
+	if (exit_us >= LAT_MAX_US)
+		return;
+
+	lat_hist_add(&lat->exit, exit_us);
+	if (!(lat->exit.count % LAT_REFRESH))
+		lat->measured_us = lat_percentile(&lat->entry, latency_pct) +
+			lat_percentile(&lat->exit, latency_pct);
+}
+
+static uint32_t lpm_cpu_level_latency(int cpu, int idx,
+		struct power_params *pwr)
+{
+	uint32_t measured;
+
+	if (!use_measured_latency)
+		return pwr->latency_us;
+
+	measured = per_cpu(lpm_lat, cpu)[idx].measured_us;
+	return measured ? measured : pwr->latency_us;
+}
+
+/* Worst measured latency of a cpu level across @cluster's cpus */
+static uint32_t cluster_cpu_level_latency(struct lpm_cluster *cluster, int idx)
+{
+	struct power_params *pwr = &cluster->cpu->levels[idx].pwr;
+	uint32_t latency = 0;
+	int cpu;
+
+	if (!use_measured_latency)
+		return pwr->latency_us;
+
+	for_each_cpu(cpu, &cluster->child_cpus)
+		latency = max(latency, per_cpu(lpm_lat, cpu)[idx].measured_us);
+
+	return latency ? latency : pwr->latency_us;
+}
+
 #ifdef CONFIG_SEC_PM
 extern int wakeup_gpio_irq_flag;
 #endif
@@ -227,7 +427,6 @@ static uint32_t least_cpu_latency(struct list_head *child,
 {
 	struct list_head *list;
 	struct lpm_cpu_level *level;
-	struct power_params *pwr_params;
 	struct lpm_cpu *cpu;
 	struct lpm_cluster *n;
 	uint32_t latency = 0;
@@ -241,12 +440,13 @@ static uint32_t least_cpu_latency(struct list_head *child,
 		}
 		cpu = n->cpu;
 		for (i = 0; i < cpu->nlevels; i++) {
+			uint32_t lvl_latency;
+
 			level = &cpu->levels[i];
-			pwr_params = &level->pwr;
 			if (lat_level->reset_level == level->reset_level) {
-				if ((latency > pwr_params->latency_us)
-							|| (!latency))
-					latency = pwr_params->latency_us;
+				lvl_latency = cluster_cpu_level_latency(n, i);
+				if ((latency > lvl_latency) || (!latency))
+					latency = lvl_latency;
 				break;
 			}
 		}
@@ -376,6 +576,115 @@ static enum hrtimer_restart lpm_hrtimer_cb(struct hrtimer *h)
 	return HRTIMER_NORESTART;
 }
 
+static enum hrtimer_restart histtimer_fn(struct hrtimer *h)
+{
+	struct lpm_history *history = this_cpu_ptr(&hist);
+
+	/* The prediction was too short; don't trust the next sample */
+	history->hinvalid = true;
+	history->htmr_fired = true;
+	return HRTIMER_NORESTART;
+}
+
+static void histtimer_start(uint32_t time_us)
+{
+	ktime_t time = ns_to_ktime((u64)time_us * NSEC_PER_USEC);
+
+	hrtimer_start(this_cpu_ptr(&histtimer), time, HRTIMER_MODE_REL_PINNED);
+}
+
+static void histtimer_cancel(void)
+{
+	struct hrtimer *timer = this_cpu_ptr(&histtimer);
+
+	if (hrtimer_active(timer))
+		hrtimer_try_to_cancel(timer);
+}
+
+/*
+ * Predict the next idle duration of @cpu in us, or 0 if its history
+ * isn't consistent enough.  Like the menu governor, drop the longest
+ * samples one at a time until the rest agree or too few are left.
+ */
+static uint32_t lpm_cpu_predict(int cpu)
+{
+	struct lpm_history *history = &per_cpu(hist, cpu);
+	uint64_t avg, stddev;
+	int64_t max, thresh = LLONG_MAX;
+	int i, divisor;
+
+	if (!lpm_prediction)
+		return 0;
+
+	/* Last exit came from the history timer: merge, don't predict */
+	if (history->hinvalid) {
+		history->hinvalid = false;
+		history->htmr_wkup = true;
+		return 0;
+	}
+
+	if (history->nsamp < MAXSAMPLES)
+		return 0;
+
+again:
+	max = avg = divisor = stddev = 0;
+	for (i = 0; i < MAXSAMPLES; i++) {
+		int64_t value = history->resi[i];
+
+		if (value <= thresh) {
+			avg += value;
+			divisor++;
+			if (value > max)
+				max = value;
+		}
+	}
+	do_div(avg, divisor);
+
+	for (i = 0; i < MAXSAMPLES; i++) {
+		int64_t value = history->resi[i];
+
+		if (value <= thresh) {
+			int64_t diff = value - avg;
+
+			stddev += diff * diff;
+		}
+	}
+	do_div(stddev, divisor);
+	stddev = int_sqrt(stddev);
+
+	if (((avg > stddev * 6) && (divisor >= (MAXSAMPLES - 1)))
+			|| stddev <= ref_stddev)
+		return (uint32_t)avg;
+
+	if (divisor > (MAXSAMPLES - 1)) {
+		thresh = max - 1;
+		goto again;
+	}
+
+	return 0;
+}
+
+static void update_history(struct cpuidle_device *dev, uint32_t resi_us)
+{
+	struct lpm_history *history = &per_cpu(hist, dev->cpu);
+
+	if (!lpm_prediction)
+		return;
+
+	if (history->htmr_wkup) {
+		/* Extend the sample the history timer cut short */
+		history->hptr = (history->hptr + MAXSAMPLES - 1) % MAXSAMPLES;
+		history->resi[history->hptr] += resi_us;
+		history->htmr_wkup = false;
+	} else {
+		history->resi[history->hptr] = resi_us;
+	}
+
+	history->hptr = (history->hptr + 1) % MAXSAMPLES;
+	if (history->nsamp < MAXSAMPLES)
+		history->nsamp++;
+}
+
 static void msm_pm_set_timer(uint32_t modified_time_us)
 {
 	u64 modified_time_ns = modified_time_us * NSEC_PER_USEC;
@@ -501,10 +810,14 @@ static int cpu_power_select(struct cpuidle_device *dev,
 	int i;
 	uint32_t lvl_latency_us = 0;
 	uint32_t *residency = get_per_cpu_max_residency(dev->cpu);
+	struct lpm_history *history = &per_cpu(hist, dev->cpu);
+	uint32_t predicted = 0, htime;
 
 	if (!cpu)
 		return -EINVAL;
 
+	history->pred_wakeup = 0;
+
 	if (sleep_disabled || sleep_us  < 0)
 		return 0;
 
@@ -515,10 +828,15 @@ static int cpu_power_select(struct cpuidle_device *dev,
 		goto done_select;
 	}
 
+	predicted = lpm_cpu_predict(dev->cpu);
+	if (predicted >= sleep_us)
+		predicted = 0;
+
 	for (i = 0; i < cpu->nlevels; i++) {
 		struct lpm_cpu_level *level = &cpu->levels[i];
 		struct power_params *pwr_params = &level->pwr;
-		uint32_t next_wakeup_us = (uint32_t)sleep_us;
+		uint32_t next_wakeup_us = predicted ? predicted :
+						(uint32_t)sleep_us;
 		enum msm_pm_sleep_mode mode = level->mode;
 		bool allow;
 
@@ -527,7 +845,7 @@ static int cpu_power_select(struct cpuidle_device *dev,
 		if (!allow)
 			continue;
 
-		lvl_latency_us = pwr_params->latency_us;
+		lvl_latency_us = lpm_cpu_level_latency(dev->cpu, i, pwr_params);
 
 		if (latency_us <= lvl_latency_us)
 			break;
@@ -557,6 +875,18 @@ static int cpu_power_select(struct cpuidle_device *dev,
 	if (modified_time_us)
 		msm_pm_set_timer(modified_time_us);
 
+	/*
+	 * The prediction held the cpu shallower than its timers allow; make
+	 * sure it gets another chance at a deeper level if it's wrong.
+	 */
+	if (predicted && best_level >= 0 && best_level < cpu->nlevels - 1) {
+		history->pred_wakeup = ktime_to_ns(ktime_get()) +
+					(int64_t)predicted * NSEC_PER_USEC;
+		htime = min(predicted + tmr_add, residency[best_level]);
+		if (sleep_us > htime && (sleep_us - htime) > residency[best_level])
+			histtimer_start(htime);
+	}
+
 done_select:
 	trace_cpu_power_select(best_level, sleep_us, latency_us, next_event_us);
 
@@ -605,6 +935,30 @@ static uint64_t get_cluster_sleep_time(struct lpm_cluster *cluster,
 		return 0;
 }
 
+/*
+ * Earliest predicted wakeup among the cpus of @cluster, in us from now,
+ * or ~0 if none of them has a prediction that is still in the future.
+ */
+static uint32_t cluster_predict(struct lpm_cluster *cluster)
+{
+	int64_t now = ktime_to_ns(ktime_get()), next = LLONG_MAX, pred;
+	int cpu;
+
+	if (!lpm_prediction)
+		return ~0U;
+
+	for_each_cpu(cpu, &cluster->num_children_in_sync) {
+		pred = per_cpu(hist, cpu).pred_wakeup;
+		if (pred > now && pred < next)
+			next = pred;
+	}
+
+	if (next == LLONG_MAX)
+		return ~0U;
+
+	return (uint32_t)div_s64(next - now, NSEC_PER_USEC);
+}
+
 static int cluster_select(struct lpm_cluster *cluster, bool from_idle)
 {
 	int best_level = -1;
@@ -617,6 +971,8 @@ static int cluster_select(struct lpm_cluster *cluster, bool from_idle)
 		return -EINVAL;
 
 	sleep_us = (uint32_t)get_cluster_sleep_time(cluster, NULL, from_idle);
+	if (from_idle)
+		sleep_us = min(sleep_us, cluster_predict(cluster));
 
 	if (cpumask_and(&mask, cpu_online_mask, &cluster->child_cpus))
 		latency_us = pm_qos_request_for_cpumask(PM_QOS_CPU_DMA_LATENCY,
@@ -846,9 +1202,20 @@ static void cluster_unprepare(struct lpm_cluster *cluster,
 	if (!first_cpu || cluster->last_level == cluster->default_level)
 		goto unlock_return;
 
-	if (cluster->stats->sleep_time)
+	if (from_idle)
+		cpuidle_note_cluster_wakeup();
+
+	if (cluster->stats->sleep_time) {
 		cluster->stats->sleep_time = end_time -
 			cluster->stats->sleep_time;
+		/* Woke before the previous level would have stopped paying */
+		if (from_idle && cluster->last_level > 0 &&
+			cluster->stats->sleep_time < (int64_t)cluster->levels[
+				cluster->last_level - 1].pwr.max_residency *
+				NSEC_PER_USEC)
+			lpm_stats_cluster_mispredict(cluster->stats,
+					cluster->last_level, true);
+	}
 	lpm_stats_cluster_exit(cluster->stats, cluster->last_level, true);
 
 	level = &cluster->levels[cluster->last_level];
@@ -1065,6 +1432,108 @@ bool psci_enter_sleep(struct lpm_cluster *cluster, int idx, bool from_idle)
 }
 #endif
 
+static int lpm_latency_show(struct seq_file *m, void *v)
+{
+	struct lpm_cluster *cluster;
+	struct lpm_level_lat *lat;
+	int cpu, i;
+
+	for_each_possible_cpu(cpu) {
+		cluster = per_cpu(cpu_cluster, cpu);
+		if (!cluster || !cluster->cpu)
+			continue;
+
+		for (i = 0; i < cluster->cpu->nlevels; i++) {
+			lat = &per_cpu(lpm_lat, cpu)[i];
+			seq_printf(m, "cpu%d %-12s dt %5u measured %5u",
+				cpu, cluster->cpu->levels[i].name,
+				cluster->cpu->levels[i].pwr.latency_us,
+				lat->measured_us);
+			seq_printf(m, " entry %u/%u/%u exit %u/%u/%u (%u)\n",
+				lat_percentile(&lat->entry, 50),
+				lat_percentile(&lat->entry, 90),
+				lat_percentile(&lat->entry, 99),
+				lat_percentile(&lat->exit, 50),
+				lat_percentile(&lat->exit, 90),
+				lat_percentile(&lat->exit, 99),
+				lat->exit.count);
+		}
+	}
+
+	return 0;
+}
+
+static int lpm_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lpm_latency_show, NULL);
+}
+
+static const struct file_operations lpm_latency_fops = {
+	.open		= lpm_latency_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/* Online cpus of the clusters other than @skip not voting for cluster idle */
+static void cluster_awake_cpus(struct lpm_cluster *cl,
+		struct lpm_cluster *skip, struct cpumask *mask)
+{
+	struct lpm_cluster *n;
+	struct cpumask awake;
+
+	if (!cl->cpu) {
+		list_for_each_entry(n, &cl->child, list)
+			cluster_awake_cpus(n, skip, mask);
+		return;
+	}
+
+	if (cl == skip)
+		return;
+
+	spin_lock(&cl->sync_lock);
+	cpumask_andnot(&awake, &cl->child_cpus, &cl->num_children_in_sync);
+	spin_unlock(&cl->sync_lock);
+
+	cpumask_and(&awake, &awake, cpu_online_mask);
+	cpumask_or(mask, mask, &awake);
+}
+
+static void lpm_steer_fn(struct work_struct *work)
+{
+	struct lpm_steer *steer = container_of(work, struct lpm_steer, work);
+	struct lpm_cluster *cluster = per_cpu(cpu_cluster, smp_processor_id());
+	struct irq_data *data = irq_get_irq_data(steer->irq);
+	struct cpumask target;
+	int ret;
+
+	if (!cluster || !data || irqd_is_per_cpu(data) ||
+			!irqd_can_balance(data) || !irq_can_set_affinity(steer->irq))
+		return;
+
+	cpumask_clear(&target);
+	cluster_awake_cpus(lpm_root_node, cluster, &target);
+	if (cpumask_empty(&target) || cpumask_subset(data->affinity, &target))
+		return;
+
+	ret = irq_set_affinity(steer->irq, &target);
+	pr_debug("%s: irq%u woke %s, moved to 0x%lx: %d\n", __func__,
+			steer->irq, cluster->cluster_name,
+			cpumask_bits(&target)[0], ret);
+}
+
+static void lpm_steer_wakeup_irq(void)
+{
+	struct lpm_steer *steer = this_cpu_ptr(&lpm_steer);
+	unsigned int irq = cpuidle_cluster_wakeup_irq();
+
+	if (!irq || work_pending(&steer->work))
+		return;
+
+	steer->irq = irq;
+	schedule_work_on(smp_processor_id(), &steer->work);
+}
+
 static int lpm_cpuidle_select(struct cpuidle_driver *drv,
 		struct cpuidle_device *dev)
 {
@@ -1091,10 +1560,19 @@ static int lpm_cpuidle_enter(struct cpuidle_device *dev,
 	int64_t start_time = ktime_to_ns(ktime_get()), end_time;
 	struct power_params *pwr_params;
 	struct clk *cpu_clk = per_cpu(cpu_clocks, dev->cpu);
+	struct lpm_history *history = &per_cpu(hist, dev->cpu);
+	uint32_t *residency = get_per_cpu_max_residency(dev->cpu);
+	uint64_t start_cycles = arch_counter_get_cntvct(), entry_cycles;
+	struct tick_device *td = this_cpu_ptr(&tick_cpu_device);
+	int64_t expected_ns = KTIME_MAX, wake_ns;
 
 	if (idx < 0)
 		return -EINVAL;
 
+	/* The timer event this cpu sleeps until, unless woken earlier */
+	if (td->evtdev)
+		expected_ns = ktime_to_ns(td->evtdev->next_event);
+
 	pwr_params = &cluster->cpu->levels[idx].pwr;
 	sched_set_cpu_cstate(smp_processor_id(), idx + 1,
 		pwr_params->energy_overhead, pwr_params->latency_us);
@@ -1121,8 +1599,10 @@ static int lpm_cpuidle_enter(struct cpuidle_device *dev,
 		secdbg_sched_msg("+Idle(%s)", cluster->cpu->levels[idx].name);
 #endif
 		}
+		entry_cycles = arch_counter_get_cntvct() - start_cycles;
 		success = msm_cpu_pm_enter_sleep(cluster->cpu->levels[idx].mode,
 				true);
+		wake_ns = ktime_to_ns(ktime_get());
 
 		if (idx > 0){
 			update_debug_pc_event(CPU_EXIT, idx, success,
@@ -1138,15 +1618,22 @@ static int lpm_cpuidle_enter(struct cpuidle_device *dev,
 			secdbg_sched_msg("+Idle(%s)", cluster->cpu->levels[idx].name);
 #endif
 
+		entry_cycles = arch_counter_get_cntvct() - start_cycles;
 		success = psci_enter_sleep(cluster, idx, true);
+		wake_ns = ktime_to_ns(ktime_get());
 
 #ifdef CONFIG_SEC_DEBUG
 			secdbg_sched_msg("-Idle(%s)", cluster->cpu->levels[idx].name);
 #endif
 	}
 
+	if (success)
+		lpm_lat_update(dev->cpu, idx, entry_cycles, wake_ns,
+				expected_ns);
+
 exit:
 	end_time = ktime_to_ns(ktime_get());
+	histtimer_cancel();
 	lpm_stats_cpu_exit(idx, end_time, success);
 
 	if (idx > 0 && cpu_clk && l2_clk)
@@ -1160,9 +1647,21 @@ exit:
 	trace_cpu_idle_exit(idx, success);
 	sec_debug_cpu_lpm_log(dev->cpu, idx, success, 0);
 	end_time = ktime_to_ns(ktime_get()) - start_time;
-	dev->last_residency = do_div(end_time, 1000);
+	do_div(end_time, 1000);
+	dev->last_residency = end_time;
+
+	if (history->htmr_fired) {
+		history->htmr_fired = false;
+		lpm_stats_cpu_mispredict(idx, false);
+	}
+	else if (idx > 0 && dev->last_residency < residency[idx - 1])
+		lpm_stats_cpu_mispredict(idx, true);
+	update_history(dev, dev->last_residency);
 	local_irq_enable();
 
+	if (irq_steer)
+		lpm_steer_wakeup_irq();
+
 	return idx;
 }
 
@@ -1480,6 +1979,7 @@ static int lpm_probe(struct platform_device *pdev)
 {
 	int ret;
 	int size;
+	unsigned int cpu;
 	struct kobject *module_kobj = NULL;
 
 	get_online_cpus();
@@ -1505,6 +2005,12 @@ static int lpm_probe(struct platform_device *pdev)
 	put_cpu();
 	suspend_set_ops(&lpm_suspend_ops);
 	hrtimer_init(&lpm_hrtimer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	for_each_possible_cpu(cpu) {
+		hrtimer_init(&per_cpu(histtimer, cpu), CLOCK_MONOTONIC,
+				HRTIMER_MODE_REL);
+		per_cpu(histtimer, cpu).function = histtimer_fn;
+		INIT_WORK(&per_cpu(lpm_steer, cpu).work, lpm_steer_fn);
+	}
 	lpm_clk_init(pdev);
 
 	ret = remote_spin_lock_init(&scm_handoff_lock, SCM_HANDOFF_LOCK_ID);
@@ -1528,6 +2034,8 @@ static int lpm_probe(struct platform_device *pdev)
 		goto failed;
 	}
 	register_hotcpu_notifier(&lpm_cpu_nblk);
+	debugfs_create_file("lpm_latency", S_IRUGO, NULL, NULL,
+			&lpm_latency_fops);
 	module_kobj = kset_find_obj(module_kset, KBUILD_MODNAME);
 	if (!module_kobj) {
 		pr_err("%s: cannot find kobject for module %s\n",
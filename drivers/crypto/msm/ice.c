@@ -21,6 +21,11 @@
 #include <linux/cdev.h>
 #include <linux/regulator/consumer.h>
 #include <linux/msm-bus.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/math64.h>
 #include <linux/pfk.h>
 #include <crypto/ice.h>
 #include <soc/qcom/scm.h>
@@ -45,6 +50,7 @@
 #define QCOM_SDCC_ICE_DEV	"icesdcc"
 #define QCOM_ICE_TYPE_NAME_LEN 8
 #define QCOM_ICE_MAX_BIST_CHECK_COUNT 100
+#define QCOM_ICE_HW_IDLE_DELAY_MS 0
 
 struct ice_clk_info {
 	struct list_head list;
@@ -66,7 +72,46 @@ struct qcom_ice_bus_vote {
 	struct device_attribute max_bus_bw;
 };
 
+/*
+ * Activity window around qcom_ice_setup_ice_hw(). Key programming powers
+ * ICE up (regulator, clocks, bus vote) and drops it again right after the
+ * SCM call, so a burst of key loads pays the full power up sequence each
+ * time. Users are reference counted and, when idle_delay_ms is set, the
+ * power down is deferred so that the next request of the burst finds ICE
+ * still powered. ICE runs with its low power mode enabled
+ * (qcom_ice_low_power_mode_enable()), so the core clock gates itself
+ * while the window is open but idle.
+ *
+ * The counters are protected by stats_lock since resume and reset may be
+ * called from the storage driver in atomic context.
+ */
+struct qcom_ice_hw_stats {
+	u64			cold_enables;
+	u64			warm_enables;
+	u64			idle_offs;
+	u64			resumes;
+	u64			resumes_busy;
+	u64			resets;
+	u64			resets_busy;
+	s64			cold_enable_us_total;
+	s64			cold_enable_us_max;
+	s64			reset_us_total;
+	s64			reset_us_max;
+};
+
+struct qcom_ice_hw_window {
+	struct mutex		lock;
+	int			users;
+	bool			powered;
+	u32			idle_delay_ms;
+	struct delayed_work	idle_work;
+	spinlock_t		stats_lock;
+	struct qcom_ice_hw_stats stats;
+	struct dentry		*debugfs;
+};
+
 static LIST_HEAD(ice_devices);
+static struct dentry *ice_debugfs_root;
 /*
  * ICE HW device structure.
  */
@@ -92,6 +137,7 @@ struct ice_device {
 	struct qcom_ice_bus_vote bus_vote;
 	ktime_t			ice_reset_start_time;
 	ktime_t			ice_reset_complete_time;
+	struct qcom_ice_hw_window hw_win;
 };
 
 static int qti_ice_setting_config(struct request *req,
@@ -138,6 +184,10 @@ static int qti_ice_setting_config(struct request *req,
 }
 
 static int qcom_ice_enable_clocks(struct ice_device *, bool);
+static void qcom_ice_hw_window_init(struct ice_device *ice_dev);
+static void qcom_ice_hw_window_exit(struct ice_device *ice_dev);
+static void qcom_ice_hw_window_account(struct ice_device *ice_dev,
+		u64 *cnt, u64 *busy_cnt, s64 *total, s64 *max, s64 us);
 
 #ifdef CONFIG_MSM_BUS_SCALING
 
@@ -776,6 +826,7 @@ static int qcom_ice_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, ice_dev);
 	list_add_tail(&ice_dev->list, &ice_devices);
+	qcom_ice_hw_window_init(ice_dev);
 
 	goto out;
 
@@ -794,6 +845,7 @@ static int qcom_ice_remove(struct platform_device *pdev)
 	if (!ice_dev)
 		return 0;
 
+	qcom_ice_hw_window_exit(ice_dev);
 	qcom_ice_disable_intr(ice_dev);
 
 	device_init_wakeup(&pdev->dev, false);
@@ -801,6 +853,10 @@ static int qcom_ice_remove(struct platform_device *pdev)
 		iounmap(ice_dev->mmio);
 
 	list_del_init(&ice_dev->list);
+	if (list_empty(&ice_devices)) {
+		debugfs_remove(ice_debugfs_root);
+		ice_debugfs_root = NULL;
+	}
 	kfree(ice_dev);
 
 	return 1;
@@ -1078,6 +1134,7 @@ static int qcom_ice_init(struct platform_device *pdev,
 
 static int qcom_ice_finish_power_collapse(struct ice_device *ice_dev)
 {
+	struct qcom_ice_hw_stats *st = &ice_dev->hw_win.stats;
 	int err = 0;
 
 	if (ice_dev->is_ice_disable_fuse_blown) {
@@ -1110,6 +1167,10 @@ static int qcom_ice_finish_power_collapse(struct ice_device *ice_dev)
 	}
 
 	ice_dev->ice_reset_complete_time = ktime_get();
+	qcom_ice_hw_window_account(ice_dev, &st->resets, &st->resets_busy,
+		&st->reset_us_total, &st->reset_us_max,
+		ktime_us_delta(ice_dev->ice_reset_complete_time,
+			       ice_dev->ice_reset_start_time));
 out:
 	return err;
 }
@@ -1133,6 +1194,9 @@ static int qcom_ice_resume(struct platform_device *pdev)
 	if (!ice_dev)
 		return -EINVAL;
 
+	qcom_ice_hw_window_account(ice_dev, &ice_dev->hw_win.stats.resumes,
+			&ice_dev->hw_win.stats.resumes_busy, NULL, NULL, 0);
+
 	if (ice_dev->is_ice_clk_available) {
 		/*
 		 * Storage is calling this function after power collapse which
@@ -1661,6 +1725,231 @@ out:
 	return ret;
 }
 
+/*
+ * Bump @cnt, and @busy_cnt as well when an activity window is open, i.e.
+ * the event landed in the middle of a burst of crypto requests. @us is
+ * folded into @total/@max when those are given.
+ */
+static void qcom_ice_hw_window_account(struct ice_device *ice_dev,
+		u64 *cnt, u64 *busy_cnt, s64 *total, s64 *max, s64 us)
+{
+	struct qcom_ice_hw_window *win = &ice_dev->hw_win;
+	unsigned long flags;
+
+	spin_lock_irqsave(&win->stats_lock, flags);
+	(*cnt)++;
+	if (busy_cnt && ACCESS_ONCE(win->users))
+		(*busy_cnt)++;
+	if (total) {
+		*total += us;
+		if (us > *max)
+			*max = us;
+	}
+	spin_unlock_irqrestore(&win->stats_lock, flags);
+}
+
+static void qcom_ice_hw_idle_work(struct work_struct *work)
+{
+	struct qcom_ice_hw_window *win = container_of(to_delayed_work(work),
+					struct qcom_ice_hw_window, idle_work);
+	struct ice_device *ice_dev = container_of(win, struct ice_device,
+						  hw_win);
+	bool off = false;
+
+	mutex_lock(&win->lock);
+	if (!win->users && win->powered) {
+		disable_ice_setup(ice_dev);
+		win->powered = false;
+		off = true;
+	}
+	mutex_unlock(&win->lock);
+
+	if (off)
+		qcom_ice_hw_window_account(ice_dev, &win->stats.idle_offs,
+					   NULL, NULL, NULL, 0);
+}
+
+static int qcom_ice_hw_get(struct ice_device *ice_dev)
+{
+	struct qcom_ice_hw_window *win = &ice_dev->hw_win;
+	ktime_t start;
+	s64 us;
+	int ret = 0;
+
+	mutex_lock(&win->lock);
+	/* the idle work re-checks users under the lock, no need to sync */
+	cancel_delayed_work(&win->idle_work);
+	if (win->powered) {
+		win->users++;
+		mutex_unlock(&win->lock);
+		qcom_ice_hw_window_account(ice_dev, &win->stats.warm_enables,
+					   NULL, NULL, NULL, 0);
+		return 0;
+	}
+
+	start = ktime_get();
+	ret = enable_ice_setup(ice_dev);
+	if (!ret) {
+		win->powered = true;
+		win->users++;
+	}
+	mutex_unlock(&win->lock);
+
+	if (!ret) {
+		us = ktime_us_delta(ktime_get(), start);
+		qcom_ice_hw_window_account(ice_dev, &win->stats.cold_enables,
+			NULL, &win->stats.cold_enable_us_total,
+			&win->stats.cold_enable_us_max, us);
+	}
+
+	return ret;
+}
+
+static int qcom_ice_hw_put(struct ice_device *ice_dev)
+{
+	struct qcom_ice_hw_window *win = &ice_dev->hw_win;
+	int ret = 0;
+
+	mutex_lock(&win->lock);
+	if (WARN_ON(!win->users)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (--win->users)
+		goto out;
+
+	if (win->idle_delay_ms) {
+		mod_delayed_work(system_wq, &win->idle_work,
+				 msecs_to_jiffies(win->idle_delay_ms));
+	} else {
+		ret = disable_ice_setup(ice_dev);
+		win->powered = false;
+	}
+out:
+	mutex_unlock(&win->lock);
+	return ret;
+}
+
+static int qcom_ice_hw_window_show(struct seq_file *m, void *unused)
+{
+	struct ice_device *ice_dev = m->private;
+	struct qcom_ice_hw_window *win = &ice_dev->hw_win;
+	struct qcom_ice_hw_stats snap;
+	unsigned long flags;
+
+	spin_lock_irqsave(&win->stats_lock, flags);
+	snap = win->stats;
+	spin_unlock_irqrestore(&win->stats_lock, flags);
+
+	seq_printf(m, "idle_delay_ms:     %u\n", win->idle_delay_ms);
+	seq_printf(m, "users:             %d\n", win->users);
+	seq_printf(m, "powered:           %d\n", win->powered);
+	seq_printf(m, "cold enables:      %llu\n", snap.cold_enables);
+	seq_printf(m, "warm enables:      %llu\n", snap.warm_enables);
+	seq_printf(m, "idle power offs:   %llu\n", snap.idle_offs);
+	seq_printf(m, "cold enable avg:   %lld us\n", snap.cold_enables ?
+		   div64_s64(snap.cold_enable_us_total,
+			     snap.cold_enables) : 0);
+	seq_printf(m, "cold enable max:   %lld us\n",
+		   snap.cold_enable_us_max);
+	seq_printf(m, "resumes:           %llu\n", snap.resumes);
+	seq_printf(m, "resumes under I/O: %llu\n", snap.resumes_busy);
+	seq_printf(m, "resets:            %llu\n", snap.resets);
+	seq_printf(m, "resets under I/O:  %llu\n", snap.resets_busy);
+	seq_printf(m, "reset avg:         %lld us\n", snap.resets ?
+		   div64_s64(snap.reset_us_total, snap.resets) : 0);
+	seq_printf(m, "reset max:         %lld us\n", snap.reset_us_max);
+
+	return 0;
+}
+
+static int qcom_ice_hw_window_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, qcom_ice_hw_window_show, inode->i_private);
+}
+
+/*
+ * Writing a number sets the idle delay in milliseconds, 0 powers ICE down
+ * as soon as the last user is gone. Any write resets the counters.
+ */
+static ssize_t qcom_ice_hw_window_write(struct file *file,
+		const char __user *ubuf, size_t count, loff_t *ppos)
+{
+	struct seq_file *m = file->private_data;
+	struct ice_device *ice_dev = m->private;
+	struct qcom_ice_hw_window *win = &ice_dev->hw_win;
+	unsigned long flags;
+	unsigned int delay;
+	int ret;
+
+	ret = kstrtouint_from_user(ubuf, count, 0, &delay);
+	if (ret)
+		return ret;
+
+	mutex_lock(&win->lock);
+	win->idle_delay_ms = delay;
+	if (!win->users && win->powered)
+		mod_delayed_work(system_wq, &win->idle_work,
+				 msecs_to_jiffies(delay));
+	mutex_unlock(&win->lock);
+
+	spin_lock_irqsave(&win->stats_lock, flags);
+	memset(&win->stats, 0, sizeof(win->stats));
+	spin_unlock_irqrestore(&win->stats_lock, flags);
+
+	return count;
+}
+
+static const struct file_operations qcom_ice_hw_window_fops = {
+	.open = qcom_ice_hw_window_open,
+	.read = seq_read,
+	.write = qcom_ice_hw_window_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void qcom_ice_hw_window_init(struct ice_device *ice_dev)
+{
+	struct qcom_ice_hw_window *win = &ice_dev->hw_win;
+
+	mutex_init(&win->lock);
+	spin_lock_init(&win->stats_lock);
+	INIT_DELAYED_WORK(&win->idle_work, qcom_ice_hw_idle_work);
+	win->idle_delay_ms = QCOM_ICE_HW_IDLE_DELAY_MS;
+
+	/* statistics are optional, don't fail probe over them */
+	if (!ice_debugfs_root) {
+		ice_debugfs_root = debugfs_create_dir("qcom_ice", NULL);
+		if (IS_ERR(ice_debugfs_root))
+			ice_debugfs_root = NULL;
+	}
+	if (!ice_debugfs_root)
+		return;
+
+	win->debugfs = debugfs_create_file(ice_dev->ice_instance_type,
+			S_IRUSR | S_IWUSR, ice_debugfs_root, ice_dev,
+			&qcom_ice_hw_window_fops);
+	if (IS_ERR(win->debugfs))
+		win->debugfs = NULL;
+}
+
+static void qcom_ice_hw_window_exit(struct ice_device *ice_dev)
+{
+	struct qcom_ice_hw_window *win = &ice_dev->hw_win;
+
+	debugfs_remove(win->debugfs);
+	win->debugfs = NULL;
+
+	cancel_delayed_work_sync(&win->idle_work);
+	mutex_lock(&win->lock);
+	if (win->powered && !win->users) {
+		disable_ice_setup(ice_dev);
+		win->powered = false;
+	}
+	mutex_unlock(&win->lock);
+}
+
 int qcom_ice_setup_ice_hw(const char *storage_type, int enable)
 {
 	int ret = -1;
@@ -1671,9 +1960,9 @@ int qcom_ice_setup_ice_hw(const char *storage_type, int enable)
 		return ret;
 
 	if (enable)
-		return enable_ice_setup(ice_dev);
+		return qcom_ice_hw_get(ice_dev);
 	else
-		return disable_ice_setup(ice_dev);
+		return qcom_ice_hw_put(ice_dev);
 }
 
 struct qcom_ice_variant_ops *qcom_ice_get_variant_ops(struct device_node *node)
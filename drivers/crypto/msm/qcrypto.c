@@ -114,6 +114,7 @@ struct crypto_stat {
 	u64 ablk_cipher_3des_dec;
 	u64 ablk_cipher_op_success;
 	u64 ablk_cipher_op_fail;
+	u64 ablk_cipher_sw_fallback;
 	u64 sha1_digest;
 	u64 sha256_digest;
 	u64 sha1_hmac_digest;
@@ -125,6 +126,17 @@ static struct crypto_stat _qcrypto_stat;
 static struct dentry *_debug_dent;
 static char _debug_read_buf[DEBUG_MAX_RW_BUF];
 static bool _qcrypto_init_assign;
+
+/*
+ * AES requests of at most this many bytes are run on the software fallback
+ * (the ARMv8 CE instructions when present) rather than queued to the crypto
+ * engine, whose BAM descriptor setup dominates the cost of short requests.
+ */
+static unsigned int sw_fallback_max_len = 512;
+module_param(sw_fallback_max_len, uint, 0644);
+MODULE_PARM_DESC(sw_fallback_max_len,
+	"Largest AES request in bytes run on the software fallback (0: none)");
+
 struct crypto_priv;
 struct qcrypto_req_control {
 	unsigned int index;
@@ -417,6 +429,8 @@ struct qcrypto_cipher_ctx {
 	u8 ccm4309_nonce[QCRYPTO_CCM4309_NONCE_LEN];
 
 	struct crypto_ablkcipher *cipher_aes192_fb;
+	/* cipher_aes192_fb holds the current key, see sw_fallback_max_len */
+	bool sw_fb_keyed;
 
 	struct crypto_ahash *ahash_aead_aes192_fb;
 };
@@ -933,6 +947,21 @@ static int _qcrypto_cra_aes_ablkcipher_init(struct crypto_tfm *tfm)
 	return _qcrypto_cra_ablkcipher_init(tfm);
 };
 
+static int _qcrypto_cra_aes_xts_init(struct crypto_tfm *tfm)
+{
+	const char *name = tfm->__crt_alg->cra_name;
+	struct qcrypto_cipher_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	/* Only used for short requests, so it is not fatal to go without */
+	ctx->cipher_aes192_fb = crypto_alloc_ablkcipher(name, 0,
+			CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK);
+	if (IS_ERR(ctx->cipher_aes192_fb)) {
+		pr_debug("No fallback algo %s\n", name);
+		ctx->cipher_aes192_fb = NULL;
+	}
+	return _qcrypto_cra_ablkcipher_init(tfm);
+};
+
 static int _qcrypto_cra_aead_sha1_init(struct crypto_tfm *tfm)
 {
 	int rc;
@@ -1121,6 +1150,9 @@ static int _disp_stats(int id)
 	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
 			"   ABLK CIPHER operation fail          : %llu\n",
 					pstat->ablk_cipher_op_fail);
+	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
+			"   ABLK CIPHER software fallback       : %llu\n",
+					pstat->ablk_cipher_sw_fallback);
 	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
 			"\n");
 
@@ -1343,19 +1375,30 @@ static int _qcrypto_check_aes_keylen(struct crypto_ablkcipher *cipher,
 	return 0;
 }
 
-static int _qcrypto_setkey_aes_192_fallback(struct crypto_ablkcipher *cipher,
-		const u8 *key)
+static int _qcrypto_setkey_sw_fallback(struct crypto_ablkcipher *cipher,
+		const u8 *key, unsigned int len)
 {
 	struct crypto_tfm *tfm = crypto_ablkcipher_tfm(cipher);
 	struct qcrypto_cipher_ctx *ctx = crypto_tfm_ctx(tfm);
 	int ret;
 
-	ctx->enc_key_len = AES_KEYSIZE_192;
 	ctx->cipher_aes192_fb->base.crt_flags &= ~CRYPTO_TFM_REQ_MASK;
 	ctx->cipher_aes192_fb->base.crt_flags |=
 			(cipher->base.crt_flags & CRYPTO_TFM_REQ_MASK);
-	ret = crypto_ablkcipher_setkey(ctx->cipher_aes192_fb, key,
-			AES_KEYSIZE_192);
+	ret = crypto_ablkcipher_setkey(ctx->cipher_aes192_fb, key, len);
+	ctx->sw_fb_keyed = !ret;
+	return ret;
+}
+
+static int _qcrypto_setkey_aes_192_fallback(struct crypto_ablkcipher *cipher,
+		const u8 *key)
+{
+	struct crypto_tfm *tfm = crypto_ablkcipher_tfm(cipher);
+	struct qcrypto_cipher_ctx *ctx = crypto_tfm_ctx(tfm);
+	int ret;
+
+	ctx->enc_key_len = AES_KEYSIZE_192;
+	ret = _qcrypto_setkey_sw_fallback(cipher, key, AES_KEYSIZE_192);
 	if (ret) {
 		tfm->crt_flags &= ~CRYPTO_TFM_RES_MASK;
 		tfm->crt_flags |=
@@ -1371,6 +1414,7 @@ static int _qcrypto_setkey_aes(struct crypto_ablkcipher *cipher, const u8 *key,
 	struct qcrypto_cipher_ctx *ctx = crypto_tfm_ctx(tfm);
 	struct crypto_priv *cp = ctx->cp;
 
+	ctx->sw_fb_keyed = false;
 	if ((ctx->flags & QCRYPTO_CTX_USE_HW_KEY) == QCRYPTO_CTX_USE_HW_KEY)
 		return 0;
 
@@ -1389,6 +1433,8 @@ static int _qcrypto_setkey_aes(struct crypto_ablkcipher *cipher, const u8 *key,
 				pr_err("%s Inavlid key pointer\n", __func__);
 				return -EINVAL;
 			}
+			if (ctx->cipher_aes192_fb)
+				_qcrypto_setkey_sw_fallback(cipher, key, len);
 		}
 	}
 	return 0;
@@ -1401,6 +1447,7 @@ static int _qcrypto_setkey_aes_xts(struct crypto_ablkcipher *cipher,
 	struct qcrypto_cipher_ctx *ctx = crypto_tfm_ctx(tfm);
 	struct crypto_priv *cp = ctx->cp;
 
+	ctx->sw_fb_keyed = false;
 	if ((ctx->flags & QCRYPTO_CTX_USE_HW_KEY) == QCRYPTO_CTX_USE_HW_KEY)
 		return 0;
 	if (_qcrypto_check_aes_keylen(cipher, cp, len/2)) {
@@ -1414,6 +1461,8 @@ static int _qcrypto_setkey_aes_xts(struct crypto_ablkcipher *cipher,
 				pr_err("%s Inavlid key pointer\n", __func__);
 				return -EINVAL;
 			}
+			if (ctx->cipher_aes192_fb)
+				_qcrypto_setkey_sw_fallback(cipher, key, len);
 		}
 	}
 	return 0;
@@ -2597,6 +2646,18 @@ static int _qcrypto_queue_req(struct crypto_priv *cp,
 	return ret;
 }
 
+static bool _qcrypto_use_sw_fallback(struct qcrypto_cipher_ctx *ctx,
+		struct ablkcipher_request *req)
+{
+	if (!ctx->sw_fb_keyed || req->nbytes > ACCESS_ONCE(sw_fallback_max_len))
+		return false;
+	if (ctx->flags & (QCRYPTO_CTX_USE_HW_KEY | QCRYPTO_CTX_USE_PIPE_KEY))
+		return false;
+
+	_qcrypto_stat.ablk_cipher_sw_fallback++;
+	return true;
+}
+
 static int _qcrypto_enc_aes_192_fallback(struct ablkcipher_request *req)
 {
 	struct crypto_tfm *tfm =
@@ -2639,9 +2700,10 @@ static int _qcrypto_enc_aes_ecb(struct ablkcipher_request *req)
 	dev_info(&ctx->pengine->pdev->dev, "_qcrypto_enc_aes_ecb: %pK\n", req);
 #endif
 
-	if ((ctx->enc_key_len == AES_KEYSIZE_192) &&
+	if (((ctx->enc_key_len == AES_KEYSIZE_192) &&
 			(!cp->ce_support.aes_key_192) &&
-				ctx->cipher_aes192_fb)
+				ctx->cipher_aes192_fb) ||
+			_qcrypto_use_sw_fallback(ctx, req))
 		return _qcrypto_enc_aes_192_fallback(req);
 
 	rctx = ablkcipher_request_ctx(req);
@@ -2669,9 +2731,10 @@ static int _qcrypto_enc_aes_cbc(struct ablkcipher_request *req)
 	dev_info(&ctx->pengine->pdev->dev, "_qcrypto_enc_aes_cbc: %pK\n", req);
 #endif
 
-	if ((ctx->enc_key_len == AES_KEYSIZE_192) &&
+	if (((ctx->enc_key_len == AES_KEYSIZE_192) &&
 			(!cp->ce_support.aes_key_192) &&
-				ctx->cipher_aes192_fb)
+				ctx->cipher_aes192_fb) ||
+			_qcrypto_use_sw_fallback(ctx, req))
 		return _qcrypto_enc_aes_192_fallback(req);
 
 	rctx = ablkcipher_request_ctx(req);
@@ -2699,9 +2762,10 @@ static int _qcrypto_enc_aes_ctr(struct ablkcipher_request *req)
 	dev_info(&ctx->pengine->pdev->dev, "_qcrypto_enc_aes_ctr: %pK\n", req);
 #endif
 
-	if ((ctx->enc_key_len == AES_KEYSIZE_192) &&
+	if (((ctx->enc_key_len == AES_KEYSIZE_192) &&
 			(!cp->ce_support.aes_key_192) &&
-				ctx->cipher_aes192_fb)
+				ctx->cipher_aes192_fb) ||
+			_qcrypto_use_sw_fallback(ctx, req))
 		return _qcrypto_enc_aes_192_fallback(req);
 
 	rctx = ablkcipher_request_ctx(req);
@@ -2725,6 +2789,10 @@ static int _qcrypto_enc_aes_xts(struct ablkcipher_request *req)
 
 	BUG_ON(crypto_tfm_alg_type(req->base.tfm) !=
 					CRYPTO_ALG_TYPE_ABLKCIPHER);
+
+	if (_qcrypto_use_sw_fallback(ctx, req))
+		return _qcrypto_enc_aes_192_fallback(req);
+
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
 	rctx->alg = CIPHER_ALG_AES;
@@ -2883,9 +2951,10 @@ static int _qcrypto_dec_aes_ecb(struct ablkcipher_request *req)
 	dev_info(&ctx->pengine->pdev->dev, "_qcrypto_dec_aes_ecb: %pK\n", req);
 #endif
 
-	if ((ctx->enc_key_len == AES_KEYSIZE_192) &&
+	if (((ctx->enc_key_len == AES_KEYSIZE_192) &&
 			(!cp->ce_support.aes_key_192) &&
-				ctx->cipher_aes192_fb)
+				ctx->cipher_aes192_fb) ||
+			_qcrypto_use_sw_fallback(ctx, req))
 		return _qcrypto_dec_aes_192_fallback(req);
 
 	rctx = ablkcipher_request_ctx(req);
@@ -2913,9 +2982,10 @@ static int _qcrypto_dec_aes_cbc(struct ablkcipher_request *req)
 	dev_info(&ctx->pengine->pdev->dev, "_qcrypto_dec_aes_cbc: %pK\n", req);
 #endif
 
-	if ((ctx->enc_key_len == AES_KEYSIZE_192) &&
+	if (((ctx->enc_key_len == AES_KEYSIZE_192) &&
 			(!cp->ce_support.aes_key_192) &&
-				ctx->cipher_aes192_fb)
+				ctx->cipher_aes192_fb) ||
+			_qcrypto_use_sw_fallback(ctx, req))
 		return _qcrypto_dec_aes_192_fallback(req);
 
 	rctx = ablkcipher_request_ctx(req);
@@ -2943,9 +3013,10 @@ static int _qcrypto_dec_aes_ctr(struct ablkcipher_request *req)
 	dev_info(&ctx->pengine->pdev->dev, "_qcrypto_dec_aes_ctr: %pK\n", req);
 #endif
 
-	if ((ctx->enc_key_len == AES_KEYSIZE_192) &&
+	if (((ctx->enc_key_len == AES_KEYSIZE_192) &&
 			(!cp->ce_support.aes_key_192) &&
-				ctx->cipher_aes192_fb)
+				ctx->cipher_aes192_fb) ||
+			_qcrypto_use_sw_fallback(ctx, req))
 		return _qcrypto_dec_aes_192_fallback(req);
 
 	rctx = ablkcipher_request_ctx(req);
@@ -3055,6 +3126,10 @@ static int _qcrypto_dec_aes_xts(struct ablkcipher_request *req)
 
 	BUG_ON(crypto_tfm_alg_type(req->base.tfm) !=
 					CRYPTO_ALG_TYPE_ABLKCIPHER);
+
+	if (_qcrypto_use_sw_fallback(ctx, req))
+		return _qcrypto_dec_aes_192_fallback(req);
+
 	rctx = ablkcipher_request_ctx(req);
 	rctx->aead = 0;
 	rctx->alg = CIPHER_ALG_AES;
@@ -4955,14 +5030,15 @@ static struct crypto_alg _qcrypto_ablk_cipher_xts_algo = {
 	.cra_name	= "xts(aes)",
 	.cra_driver_name = "qcrypto-xts-aes",
 	.cra_priority	= 300,
-	.cra_flags	= CRYPTO_ALG_TYPE_ABLKCIPHER | CRYPTO_ALG_ASYNC,
+	.cra_flags	= CRYPTO_ALG_TYPE_ABLKCIPHER | CRYPTO_ALG_ASYNC |
+				CRYPTO_ALG_NEED_FALLBACK,
 	.cra_blocksize	= AES_BLOCK_SIZE,
 	.cra_ctxsize	= sizeof(struct qcrypto_cipher_ctx),
 	.cra_alignmask	= 0,
 	.cra_type	= &crypto_ablkcipher_type,
 	.cra_module	= THIS_MODULE,
-	.cra_init	= _qcrypto_cra_ablkcipher_init,
-	.cra_exit	= _qcrypto_cra_ablkcipher_exit,
+	.cra_init	= _qcrypto_cra_aes_xts_init,
+	.cra_exit	= _qcrypto_cra_aes_ablkcipher_exit,
 	.cra_u		= {
 		.ablkcipher = {
 			.ivsize		= AES_BLOCK_SIZE,
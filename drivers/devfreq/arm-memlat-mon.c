@@ -36,11 +36,14 @@ enum ev_index {
 	INST_IDX,
 	L2DM_IDX,
 	CYC_IDX,
+	STALL_IDX,
 	NUM_EVENTS
 };
 #define INST_EV		0x08
 #define L2DM_EV		0x17
 #define CYC_EV		0x11
+/* STALL_BACKEND is optional, it is only counted when the DT asks for it */
+#define STALL_EV	0x24
 
 struct event_data {
 	struct perf_event *pevent;
@@ -56,6 +59,7 @@ static DEFINE_PER_CPU(struct memlat_hwmon_data, pm_data);
 
 struct cpu_grp_info {
 	cpumask_t cpus;
+	unsigned int event_ids[NUM_EVENTS];	/* 0: not counted */
 	struct memlat_hwmon hw;
 	struct notifier_block arm_memlat_cpu_notif;
 };
@@ -100,7 +104,7 @@ static void read_perf_counters(int cpu, struct cpu_grp_info *cpu_grp)
 	int cpu_idx;
 	struct memlat_hwmon_data *hw_data = &per_cpu(pm_data, cpu);
 	struct memlat_hwmon *hw = &cpu_grp->hw;
-	unsigned long cyc_cnt;
+	unsigned long cyc_cnt, stall_cnt;
 
 	if (hw_data->init_pending)
 		return;
@@ -115,6 +119,15 @@ static void read_perf_counters(int cpu, struct cpu_grp_info *cpu_grp)
 
 	cyc_cnt = read_event(&hw_data->events[CYC_IDX]);
 	hw->core_stats[cpu_idx].freq = compute_freq(hw_data, cyc_cnt);
+
+	if (hw_data->events[STALL_IDX].pevent) {
+		stall_cnt = read_event(&hw_data->events[STALL_IDX]);
+		stall_cnt = min(stall_cnt, cyc_cnt);
+		hw->core_stats[cpu_idx].stall_pct = cyc_cnt ?
+			mult_frac(100, stall_cnt, cyc_cnt) : 0;
+	} else {
+		hw->core_stats[cpu_idx].stall_pct = 100;
+	}
 }
 
 static unsigned long get_cnt(struct memlat_hwmon *hw)
@@ -135,7 +148,10 @@ static void delete_events(struct memlat_hwmon_data *hw_data)
 
 	for (i = 0; i < NUM_EVENTS; i++) {
 		hw_data->events[i].prev_count = 0;
-		perf_event_release_kernel(hw_data->events[i].pevent);
+		if (hw_data->events[i].pevent) {
+			perf_event_release_kernel(hw_data->events[i].pevent);
+			hw_data->events[i].pevent = NULL;
+		}
 	}
 }
 
@@ -159,6 +175,7 @@ static void stop_hwmon(struct memlat_hwmon *hw)
 		hw->core_stats[idx].inst_count = 0;
 		hw->core_stats[idx].mem_count = 0;
 		hw->core_stats[idx].freq = 0;
+		hw->core_stats[idx].stall_pct = 0;
 	}
 	put_online_cpus();
 
@@ -181,43 +198,37 @@ static struct perf_event_attr *alloc_attr(void)
 	return attr;
 }
 
-static int set_events(struct memlat_hwmon_data *hw_data, int cpu)
+static int set_events(struct cpu_grp_info *cpu_grp,
+		      struct memlat_hwmon_data *hw_data, int cpu)
 {
 	struct perf_event *pevent;
 	struct perf_event_attr *attr;
-	int err;
+	int i, err;
 
 	/* Allocate an attribute for event initialization */
 	attr = alloc_attr();
 	if (IS_ERR(attr))
 		return PTR_ERR(attr);
 
-	attr->config = INST_EV;
-	pevent = perf_event_create_kernel_counter(attr, cpu, NULL, NULL, NULL);
-	if (IS_ERR(pevent))
-		goto err_out;
-	hw_data->events[INST_IDX].pevent = pevent;
-	perf_event_enable(hw_data->events[INST_IDX].pevent);
-
-	attr->config = L2DM_EV;
-	pevent = perf_event_create_kernel_counter(attr, cpu, NULL, NULL, NULL);
-	if (IS_ERR(pevent))
-		goto err_out;
-	hw_data->events[L2DM_IDX].pevent = pevent;
-	perf_event_enable(hw_data->events[L2DM_IDX].pevent);
-
-	attr->config = CYC_EV;
-	pevent = perf_event_create_kernel_counter(attr, cpu, NULL, NULL, NULL);
-	if (IS_ERR(pevent))
-		goto err_out;
-	hw_data->events[CYC_IDX].pevent = pevent;
-	perf_event_enable(hw_data->events[CYC_IDX].pevent);
+	for (i = 0; i < NUM_EVENTS; i++) {
+		if (!cpu_grp->event_ids[i])
+			continue;
+
+		attr->config = cpu_grp->event_ids[i];
+		pevent = perf_event_create_kernel_counter(attr, cpu, NULL,
+							  NULL, NULL);
+		if (IS_ERR(pevent))
+			goto err_out;
+		hw_data->events[i].pevent = pevent;
+		perf_event_enable(hw_data->events[i].pevent);
+	}
 
 	kfree(attr);
 	return 0;
 
 err_out:
 	err = PTR_ERR(pevent);
+	delete_events(hw_data);
 	kfree(attr);
 	return err;
 }
@@ -227,11 +238,13 @@ static int arm_memlat_cpu_callback(struct notifier_block *nb,
 {
 	unsigned long cpu = (unsigned long)hcpu;
 	struct memlat_hwmon_data *hw_data = &per_cpu(pm_data, cpu);
+	struct cpu_grp_info *cpu_grp = container_of(nb,
+				struct cpu_grp_info, arm_memlat_cpu_notif);
 
 	if ((action != CPU_ONLINE) || !hw_data->init_pending)
 		return NOTIFY_OK;
 
-	if (set_events(hw_data, cpu))
+	if (set_events(cpu_grp, hw_data, cpu))
 		pr_warn("Failed to create perf event for CPU%lu\n", cpu);
 
 	hw_data->init_pending = false;
@@ -251,7 +264,7 @@ static int start_hwmon(struct memlat_hwmon *hw)
 	get_online_cpus();
 	for_each_cpu(cpu, &cpu_grp->cpus) {
 		hw_data = &per_cpu(pm_data, cpu);
-		ret = set_events(hw_data, cpu);
+		ret = set_events(cpu_grp, hw_data, cpu);
 		if (ret) {
 			if (!cpu_online(cpu)) {
 				hw_data->init_pending = true;
@@ -319,6 +332,20 @@ static int arm_memlat_mon_driver_probe(struct platform_device *pdev)
 		return -ENODEV;
 	}
 
+	/* Event numbers may differ between the core types of the groups */
+	cpu_grp->event_ids[INST_IDX] = INST_EV;
+	cpu_grp->event_ids[L2DM_IDX] = L2DM_EV;
+	cpu_grp->event_ids[CYC_IDX] = CYC_EV;
+	of_property_read_u32(dev->of_node, "qcom,inst-ev",
+			     &cpu_grp->event_ids[INST_IDX]);
+	of_property_read_u32(dev->of_node, "qcom,cachemiss-ev",
+			     &cpu_grp->event_ids[L2DM_IDX]);
+	if (of_property_read_bool(dev->of_node, "qcom,stall-cycle-ev")) {
+		cpu_grp->event_ids[STALL_IDX] = STALL_EV;
+		of_property_read_u32(dev->of_node, "qcom,stall-cycle-ev",
+				     &cpu_grp->event_ids[STALL_IDX]);
+	}
+
 	hw->num_cores = cpumask_weight(&cpu_grp->cpus);
 	hw->core_stats = devm_kzalloc(dev, hw->num_cores *
 				sizeof(*(hw->core_stats)), GFP_KERNEL);
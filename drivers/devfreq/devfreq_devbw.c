@@ -26,10 +26,12 @@
 #include <linux/interrupt.h>
 #include <linux/devfreq.h>
 #include <linux/of.h>
+#include <linux/workqueue.h>
 #include <trace/events/power.h>
 #include <linux/msm-bus.h>
 #include <linux/msm-bus-board.h>
 #include <linux/devfreq_boost.h>
+#include "devfreq_trace.h"
 
 /* Has to be ULL to prevent overflow where this macro is used. */
 #define MBYTE (1ULL << 20)
@@ -45,20 +47,40 @@ struct dev_data {
 	int cur_idx;
 	int cur_ab;
 	int cur_ib;
+	int req_ab;
+	int req_ib;
 	long gov_ab;
 	unsigned int ab_percent;
 	struct devfreq *df;
 	struct devfreq_dev_profile dp;
+	struct device *dev;
+	struct list_head list;
 };
 
-static int set_bw(struct device *dev, int new_ib, int new_ab)
+/*
+ * All devbw devices vote for the same DDR from their own governors
+ * (cpufreq, bw_hwmon, gpubw_mon, adreno tz...). Their requests are
+ * collected here and published together: a vote going up is applied
+ * right away along with whatever else is pending, while votes going down
+ * wait for the end of the current epoch, so one governor dropping DDR
+ * just before another raises it again doesn't bounce the bus.
+ */
+static LIST_HEAD(devbw_list);
+static DEFINE_MUTEX(devbw_lock);
+static ktime_t devbw_last_flush;
+
+static unsigned int epoch_ms = 20;
+module_param(epoch_ms, uint, 0644);
+
+static void devbw_flush_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(devbw_flush_work, devbw_flush_work_fn);
+
+static int publish_bw(struct dev_data *d)
 {
-	struct dev_data *d = dev_get_drvdata(dev);
+	struct device *dev = d->dev;
+	int new_ib = d->req_ib, new_ab = d->req_ab;
 	int i, ret;
 
-	if (d->cur_ib == new_ib && d->cur_ab == new_ab)
-		return 0;
-
 	i = (d->cur_idx + 1) % DBL_BUF;
 
 	d->bw_levels[i].vectors[0].ib = new_ib * MBYTE;
@@ -80,6 +102,68 @@ static int set_bw(struct device *dev, int new_ib, int new_ab)
 	return ret;
 }
 
+/*
+ * Publish the pending request of every device; called with devbw_lock
+ * held. Returns the msm_bus result for @caller.
+ */
+static int devbw_flush(struct dev_data *caller)
+{
+	struct dev_data *d;
+	unsigned int updates = 0;
+	int ret = 0, err, max_ib = 0, total_ab = 0;
+
+	list_for_each_entry(d, &devbw_list, list) {
+		if (d->req_ib != d->cur_ib || d->req_ab != d->cur_ab) {
+			err = publish_bw(d);
+			if (d == caller)
+				ret = err;
+			updates++;
+		}
+		trace_devfreq_bw_vote(dev_name(d->dev), d->req_ib, d->req_ab,
+				      d->cur_ib, d->cur_ab);
+		max_ib = max(max_ib, d->cur_ib);
+		total_ab += d->cur_ab;
+	}
+
+	devbw_last_flush = ktime_get();
+	trace_devfreq_bw_epoch(updates, 0, max_ib, total_ab);
+
+	return ret;
+}
+
+static void devbw_flush_work_fn(struct work_struct *work)
+{
+	mutex_lock(&devbw_lock);
+	devbw_flush(NULL);
+	mutex_unlock(&devbw_lock);
+}
+
+static int set_bw(struct device *dev, int new_ib, int new_ab)
+{
+	struct dev_data *d = dev_get_drvdata(dev);
+	unsigned int elapsed;
+	int ret = 0;
+
+	mutex_lock(&devbw_lock);
+	d->req_ib = new_ib;
+	d->req_ab = new_ab;
+	if (d->cur_ib == new_ib && d->cur_ab == new_ab)
+		goto out;
+
+	elapsed = ktime_to_ms(ktime_sub(ktime_get(), devbw_last_flush));
+	if (new_ib > d->cur_ib || new_ab > d->cur_ab || elapsed >= epoch_ms) {
+		cancel_delayed_work(&devbw_flush_work);
+		ret = devbw_flush(d);
+	} else if (!delayed_work_pending(&devbw_flush_work)) {
+		schedule_delayed_work(&devbw_flush_work,
+				msecs_to_jiffies(epoch_ms - elapsed));
+		trace_devfreq_bw_epoch(0, 1, d->cur_ib, d->cur_ab);
+	}
+out:
+	mutex_unlock(&devbw_lock);
+	return ret;
+}
+
 static unsigned int find_ab(struct dev_data *d, unsigned long *freq)
 {
 	return (d->ab_percent * (*freq)) / 100;
@@ -145,6 +229,7 @@ int devfreq_add_devbw(struct device *dev)
 	if (!d)
 		return -ENOMEM;
 	dev_set_drvdata(dev, d);
+	d->dev = dev;
 
 	if (of_find_property(dev->of_node, PROP_PORTS, &len)) {
 		len /= sizeof(ports[0]);
@@ -226,8 +311,15 @@ int devfreq_add_devbw(struct device *dev)
 	if (of_property_read_string(dev->of_node, "governor", &gov_name))
 		gov_name = "performance";
 
+	mutex_lock(&devbw_lock);
+	list_add_tail(&d->list, &devbw_list);
+	mutex_unlock(&devbw_lock);
+
 	d->df = devfreq_add_device(dev, p, gov_name, NULL);
 	if (IS_ERR(d->df)) {
+		mutex_lock(&devbw_lock);
+		list_del(&d->list);
+		mutex_unlock(&devbw_lock);
 		msm_bus_scale_unregister_client(d->bus_client);
 		return PTR_ERR(d->df);
 	}
@@ -241,6 +333,10 @@ int devfreq_add_devbw(struct device *dev)
 int devfreq_remove_devbw(struct device *dev)
 {
 	struct dev_data *d = dev_get_drvdata(dev);
+
+	mutex_lock(&devbw_lock);
+	list_del(&d->list);
+	mutex_unlock(&devbw_lock);
 	msm_bus_scale_unregister_client(d->bus_client);
 	devfreq_remove_device(d->df);
 	return 0;
@@ -37,6 +37,51 @@ TRACE_EVENT(devfreq_msg,
 	)
 );
 
+TRACE_EVENT(devfreq_bw_vote,
+	TP_PROTO(const char *name, int req_ib, int req_ab, int ib, int ab),
+	TP_ARGS(name, req_ib, req_ab, ib, ab),
+	TP_STRUCT__entry(
+		__string(name, name)
+		__field(int, req_ib)
+		__field(int, req_ab)
+		__field(int, ib)
+		__field(int, ab)
+	),
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->req_ib = req_ib;
+		__entry->req_ab = req_ab;
+		__entry->ib = ib;
+		__entry->ab = ab;
+	),
+	TP_printk(
+		"dev: %s, req_ib=%d, req_ab=%d, ib=%d, ab=%d",
+		__get_str(name), __entry->req_ib, __entry->req_ab,
+		__entry->ib, __entry->ab
+	)
+);
+
+TRACE_EVENT(devfreq_bw_epoch,
+	TP_PROTO(unsigned int updates, unsigned int deferred, int ib, int ab),
+	TP_ARGS(updates, deferred, ib, ab),
+	TP_STRUCT__entry(
+		__field(unsigned int, updates)
+		__field(unsigned int, deferred)
+		__field(int, ib)
+		__field(int, ab)
+	),
+	TP_fast_assign(
+		__entry->updates = updates;
+		__entry->deferred = deferred;
+		__entry->ib = ib;
+		__entry->ab = ab;
+	),
+	TP_printk(
+		"updates=%u, deferred=%u, max_ib=%d, total_ab=%d",
+		__entry->updates, __entry->deferred, __entry->ib, __entry->ab
+	)
+);
+
 #endif /* _DEVFREQ_TRACE_H */
 
 /* This part must be outside protection */
@@ -29,6 +29,7 @@
 #include <linux/platform_device.h>
 #include <linux/of.h>
 #include <linux/devfreq.h>
+#include <linux/workqueue.h>
 #include <trace/events/power.h>
 #include "governor.h"
 #include "governor_bw_hwmon.h"
@@ -51,6 +52,9 @@ struct hwmon_node {
 	unsigned int low_power_ceil_mbps;
 	unsigned int low_power_io_percent;
 	unsigned int low_power_delay;
+	unsigned int burst_thres;
+	unsigned int burst_memory;
+	unsigned int floor_percent;
 	unsigned int mbps_zones[NUM_MBPS_ZONES];
 
 	unsigned long prev_ab;
@@ -69,6 +73,9 @@ struct hwmon_node {
 	unsigned long prev_req;
 	unsigned long up_wake_mbps;
 	unsigned long down_wake_mbps;
+	unsigned long prev_meas_mbps;
+	unsigned long burst_peak;
+	unsigned long burst_mem;
 	unsigned int wake;
 	unsigned int down_cnt;
 	ktime_t prev_ts;
@@ -92,6 +99,10 @@ static DEFINE_MUTEX(list_lock);
 static int use_cnt;
 static DEFINE_MUTEX(state_lock);
 
+/* Expected bandwidth of each floor client, in MBps */
+static unsigned long floor_mbps[BW_HWMON_FLOOR_NR];
+static DEFINE_SPINLOCK(floor_lock);
+
 #define show_attr(name) \
 static ssize_t show_##name(struct device *dev,				\
 			struct device_attribute *attr, char *buf)	\
@@ -264,6 +275,19 @@ unsigned long to_mbps_zone(struct hwmon_node *node, unsigned long mbps)
 	return node->hw->df->max_freq;
 }
 
+static unsigned long get_floor_mbps(void)
+{
+	unsigned long flags, sum = 0;
+	int i;
+
+	spin_lock_irqsave(&floor_lock, flags);
+	for (i = 0; i < BW_HWMON_FLOOR_NR; i++)
+		sum += floor_mbps[i];
+	spin_unlock_irqrestore(&floor_lock, flags);
+
+	return sum;
+}
+
 #define MIN_MBPS	500UL
 #define HIST_PEAK_TOL	60
 static unsigned long get_bw_and_set_irq(struct hwmon_node *node,
@@ -329,6 +353,32 @@ static unsigned long get_bw_and_set_irq(struct hwmon_node *node,
 	meas_mbps_zone = (meas_mbps_zone * io_percent) / 100;
 	meas_mbps_zone = max(meas_mbps, meas_mbps_zone);
 
+	/*
+	 * Burst prediction: a window that grows by more than burst_thres
+	 * percent over the previous one starts a burst. Bursts tend to
+	 * repeat (frame after frame), so go straight to the peak of the last
+	 * one seen in the past burst_memory windows instead of walking up to
+	 * it one up-wake at a time, else extrapolate the current slope.
+	 */
+	if (node->burst_mem)
+		node->burst_mem--;
+	else
+		node->burst_peak = 0;
+
+	if (node->burst_thres && node->burst_memory && meas_mbps > MIN_MBPS
+	    && meas_mbps * 100 > node->prev_meas_mbps
+				* (100 + node->burst_thres)) {
+		if (node->burst_peak > meas_mbps)
+			req_mbps = max(req_mbps, node->burst_peak);
+		else
+			req_mbps = max(req_mbps, min(meas_mbps_zone,
+				2 * meas_mbps - node->prev_meas_mbps));
+		node->burst_mem = node->burst_memory;
+	}
+	if (node->burst_mem)
+		node->burst_peak = max(node->burst_peak, meas_mbps);
+	node->prev_meas_mbps = meas_mbps;
+
 	/*
 	 * If this is a wake up due to BW increase, vote much higher BW than
 	 * what we measure to stay ahead of increasing traffic and then set
@@ -429,6 +479,10 @@ static unsigned long get_bw_and_set_irq(struct hwmon_node *node,
 		*ab = roundup(new_bw, node->bw_step);
 
 	*freq = (new_bw * 100) / io_percent;
+	/* The floor hints are total DDR bandwidth, so they only raise IB */
+	if (node->floor_percent)
+		*freq = max(*freq, (get_floor_mbps() * node->floor_percent)
+				/ 100);
 	trace_bw_hwmon_update(dev_name(node->hw->df->dev.parent),
 				new_bw,
 				*freq,
@@ -488,6 +542,48 @@ int update_bw_hwmon(struct bw_hwmon *hwmon)
 	return 0;
 }
 
+static void floor_update_fn(struct work_struct *work)
+{
+	struct hwmon_node *node;
+
+	mutex_lock(&list_lock);
+	list_for_each_entry(node, &hwmon_list, list)
+		if (node->floor_percent && node->mon_started)
+			update_bw_hwmon(node->hw);
+	mutex_unlock(&list_lock);
+}
+static DECLARE_WORK(floor_update_work, floor_update_fn);
+
+/**
+ * bw_hwmon_set_floor - hint the bandwidth a client is about to use
+ * @client:	client giving the hint
+ * @mbps:	expected bandwidth in MBps, 0 to drop the hint
+ *
+ * The hints of all clients add up to a floor on the IB vote of every
+ * bw_hwmon device with a non-zero floor_percent. A raised floor is
+ * applied right away rather than at the end of the sampling window, so
+ * DDR is already up when the burst arrives. May be called from atomic
+ * context.
+ */
+int bw_hwmon_set_floor(enum bw_hwmon_floor_client client, unsigned long mbps)
+{
+	unsigned long flags, old;
+
+	if (client >= BW_HWMON_FLOOR_NR)
+		return -EINVAL;
+
+	spin_lock_irqsave(&floor_lock, flags);
+	old = floor_mbps[client];
+	floor_mbps[client] = mbps;
+	spin_unlock_irqrestore(&floor_lock, flags);
+
+	if (mbps > old)
+		schedule_work(&floor_update_work);
+
+	return 0;
+}
+EXPORT_SYMBOL(bw_hwmon_set_floor);
+
 static int start_monitor(struct devfreq *df, bool init)
 {
 	struct hwmon_node *node = df->data;
@@ -730,6 +826,9 @@ gov_attr(idle_mbps, 0U, 2000U);
 gov_attr(low_power_ceil_mbps, 0U, 2500U);
 gov_attr(low_power_io_percent, 1U, 100U);
 gov_attr(low_power_delay, 1U, 60U);
+gov_attr(burst_thres, 0U, 1000U);
+gov_attr(burst_memory, 0U, 90U);
+gov_attr(floor_percent, 0U, 100U);
 gov_list_attr(mbps_zones, NUM_MBPS_ZONES, 0U, UINT_MAX);
 
 static struct attribute *dev_attr[] = {
@@ -749,6 +848,9 @@ static struct attribute *dev_attr[] = {
 	&dev_attr_low_power_ceil_mbps.attr,
 	&dev_attr_low_power_io_percent.attr,
 	&dev_attr_low_power_delay.attr,
+	&dev_attr_burst_thres.attr,
+	&dev_attr_burst_memory.attr,
+	&dev_attr_floor_percent.attr,
 	&dev_attr_mbps_zones.attr,
 	&dev_attr_throttle_adj.attr,
 	NULL,
@@ -892,6 +994,9 @@ int register_bw_hwmon(struct device *dev, struct bw_hwmon *hwmon)
 	node->hyst_trigger_count = 3;
 	node->hyst_length = 0;
 	node->idle_mbps = 400;
+	node->burst_thres = 0;
+	node->burst_memory = 20;
+	node->floor_percent = 100;
 	node->mbps_zones[0] = 0;
 	node->hw = hwmon;
 
@@ -35,8 +35,10 @@
 
 struct memlat_node {
 	unsigned int ratio_ceil;
+	unsigned int stall_floor;
 	unsigned int freq_thresh_mhz;
 	unsigned int mult_factor;
+	struct core_dev_map *freq_map;
 	bool mon_started;
 	struct list_head list;
 	void *orig_data;
@@ -83,12 +85,33 @@ show_attr(__attr)			\
 store_attr(__attr, min, max)		\
 static DEVICE_ATTR(__attr, 0644, show_##__attr, store_##__attr)
 
+/*
+ * Device vote for a latency bound core running at @core_mhz: the entry of
+ * the core-dev table covering that frequency, or a plain multiple of it
+ * when the table isn't used.
+ */
+static unsigned long core_to_dev_freq(struct memlat_node *node,
+				      unsigned long core_mhz)
+{
+	struct core_dev_map *map = node->freq_map;
+
+	if (!map)
+		return core_mhz * node->mult_factor;
+
+	while (map->core_mhz && map->core_mhz < core_mhz)
+		map++;
+	if (!map->core_mhz)
+		map--;
+
+	return map->target_freq;
+}
+
 static unsigned long compute_dev_vote(struct devfreq *df)
 {
 	int i, lat_dev;
 	struct memlat_node *node = df->data;
 	struct memlat_hwmon *hw = node->hw;
-	unsigned long max_freq = 0;
+	unsigned long max_freq = 0, vote = 0;
 	unsigned int ratio;
 
 	hw->get_cnt(hw);
@@ -103,9 +126,15 @@ static unsigned long compute_dev_vote(struct devfreq *df)
 					hw->core_stats[i].id,
 					hw->core_stats[i].inst_count,
 					hw->core_stats[i].mem_count,
-					hw->core_stats[i].freq, ratio);
+					hw->core_stats[i].freq,
+					hw->core_stats[i].stall_pct, ratio);
 
+		/*
+		 * A low instruction to miss ratio only means latency bound
+		 * if the core actually spends its cycles stalled on memory.
+		 */
 		if (ratio && ratio <= node->ratio_ceil
+		    && hw->core_stats[i].stall_pct >= node->stall_floor
 		    && hw->core_stats[i].freq >= node->freq_thresh_mhz
 		    && hw->core_stats[i].freq > max_freq) {
 			lat_dev = i;
@@ -113,15 +142,16 @@ static unsigned long compute_dev_vote(struct devfreq *df)
 		}
 	}
 
-	if (max_freq)
+	if (max_freq) {
+		vote = core_to_dev_freq(node, max_freq);
 		trace_memlat_dev_update(dev_name(df->dev.parent),
 					hw->core_stats[lat_dev].id,
 					hw->core_stats[lat_dev].inst_count,
 					hw->core_stats[lat_dev].mem_count,
-					hw->core_stats[lat_dev].freq,
-					max_freq * node->mult_factor);
+					hw->core_stats[lat_dev].freq, vote);
+	}
 
-	return max_freq;
+	return vote;
 }
 
 static struct memlat_node *find_memlat_node(struct devfreq *df)
@@ -224,21 +254,19 @@ static int devfreq_memlat_get_freq(struct devfreq *df,
 					unsigned long *freq,
 					u32 *flag)
 {
-	unsigned long mhz;
-	struct memlat_node *node = df->data;
-
-	mhz = compute_dev_vote(df);
-	*freq = mhz ? (mhz * node->mult_factor) : 0;
+	*freq = compute_dev_vote(df);
 
 	return 0;
 }
 
 gov_attr(ratio_ceil, 1U, 1000U);
+gov_attr(stall_floor, 0U, 100U);
 gov_attr(freq_thresh_mhz, 300U, 5000U);
 gov_attr(mult_factor, 1U, 10U);
 
 static struct attribute *dev_attr[] = {
 	&dev_attr_ratio_ceil.attr,
+	&dev_attr_stall_floor.attr,
 	&dev_attr_freq_thresh_mhz.attr,
 	&dev_attr_mult_factor.attr,
 	NULL,
@@ -295,6 +323,47 @@ static struct devfreq_governor devfreq_gov_memlat = {
 	.event_handler = devfreq_memlat_ev_handler,
 };
 
+#define NUM_COLS	2
+static struct core_dev_map *init_core_dev_map(struct device *dev,
+					      char *prop_name)
+{
+	int len, nf, i, j;
+	u32 data;
+	struct core_dev_map *tbl;
+	int ret;
+
+	if (!of_find_property(dev->of_node, prop_name, &len))
+		return NULL;
+	len /= sizeof(data);
+
+	if (len % NUM_COLS || len == 0)
+		return NULL;
+	nf = len / NUM_COLS;
+
+	tbl = devm_kzalloc(dev, (nf + 1) * sizeof(*tbl), GFP_KERNEL);
+	if (!tbl)
+		return NULL;
+
+	for (i = 0, j = 0; i < nf; i++, j += NUM_COLS) {
+		ret = of_property_read_u32_index(dev->of_node, prop_name, j,
+						 &data);
+		if (ret)
+			return NULL;
+		tbl[i].core_mhz = data / 1000;
+
+		ret = of_property_read_u32_index(dev->of_node, prop_name,
+						 j + 1, &data);
+		if (ret)
+			return NULL;
+		tbl[i].target_freq = data;
+		dev_dbg(dev, "Entry%d CPU:%u, Dev:%u\n", i, tbl[i].core_mhz,
+			tbl[i].target_freq);
+	}
+	tbl[i].core_mhz = 0;
+
+	return tbl;
+}
+
 int register_memlat(struct device *dev, struct memlat_hwmon *hw)
 {
 	int ret = 0;
@@ -311,10 +380,21 @@ int register_memlat(struct device *dev, struct memlat_hwmon *hw)
 	node->attr_grp = &dev_attr_group;
 
 	node->ratio_ceil = 10;
+	node->stall_floor = 0;
 	node->freq_thresh_mhz = 900;
 	node->mult_factor = 8;
 	node->hw = hw;
 
+	/* Each monitored cpu group may be tuned for its own core type */
+	of_property_read_u32(dev->of_node, "qcom,ratio-ceil",
+			     &node->ratio_ceil);
+	of_property_read_u32(dev->of_node, "qcom,stall-floor",
+			     &node->stall_floor);
+	of_property_read_u32(dev->of_node, "qcom,freq-thresh-mhz",
+			     &node->freq_thresh_mhz);
+	node->stall_floor = min(node->stall_floor, 100U);
+	node->freq_map = init_core_dev_map(dev, "qcom,core-dev-table");
+
 	mutex_lock(&list_lock);
 	list_add_tail(&node->list, &memlat_list);
 	mutex_unlock(&list_lock);
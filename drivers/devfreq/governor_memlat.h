@@ -23,12 +23,27 @@
  * @mem_count:			Number of memory accesses made.
  * @freq:			Effective frequency of the device in the
  *				last interval.
+ * @stall_pct:			Percentage of cycles the device was stalled
+ *				on its backend in the last interval; 100 when
+ *				the monitor doesn't count stalls.
  */
 struct dev_stats {
 	int id;
 	unsigned long inst_count;
 	unsigned long mem_count;
 	unsigned long freq;
+	unsigned long stall_pct;
+};
+
+/**
+ * struct core_dev_map - Core frequency to device frequency mapping
+ * @core_mhz:			Core frequency, in MHz.
+ * @target_freq:		Device frequency voted for at or below
+ *				@core_mhz.
+ */
+struct core_dev_map {
+	unsigned int core_mhz;
+	unsigned int target_freq;
 };
 
 /**
@@ -130,6 +130,34 @@ static void dma_buf_poll_cb(struct fence *fence, struct fence_cb *cb)
 	spin_unlock_irqrestore(&dcb->poll->lock, flags);
 }
 
+/*
+ * Whether every fence @events depends on has already signaled, judged from
+ * the signaled bit alone so that it can be done under rcu_read_lock without
+ * a reference: fences are freed by RCU.
+ */
+static bool dma_buf_poll_signaled(struct reservation_object_list *fobj,
+				  unsigned shared_count,
+				  struct fence *fence_excl,
+				  unsigned long events)
+{
+	unsigned i;
+
+	if (fence_excl && (!(events & POLLOUT) || shared_count == 0) &&
+	    !test_bit(FENCE_FLAG_SIGNALED_BIT, &fence_excl->flags))
+		return false;
+
+	if (events & POLLOUT) {
+		for (i = 0; i < shared_count; ++i) {
+			struct fence *fence = rcu_dereference(fobj->shared[i]);
+
+			if (!test_bit(FENCE_FLAG_SIGNALED_BIT, &fence->flags))
+				return false;
+		}
+	}
+
+	return true;
+}
+
 static unsigned int dma_buf_poll(struct file *file, poll_table *poll)
 {
 	struct dma_buf *dmabuf;
@@ -163,9 +191,21 @@ retry:
 	fence_excl = rcu_dereference(resv->fence_excl);
 	if (read_seqcount_retry(&resv->seq, seq)) {
 		rcu_read_unlock();
+		reservation_wait_stat_inc(retry);
 		goto retry;
 	}
 
+	/*
+	 * Compositors poll a lot of idle buffers: answer those without the
+	 * poll lock and without queueing callbacks just to have them fire.
+	 */
+	if (dma_buf_poll_signaled(fobj, shared_count, fence_excl, events)) {
+		rcu_read_unlock();
+		reservation_wait_stat_inc(poll_nosleep);
+		return events;
+	}
+	reservation_wait_stat_inc(poll_sleep);
+
 	if (fence_excl && (!(events & POLLOUT) || shared_count == 0)) {
 		struct dma_buf_poll_cb_t *dcb = &dmabuf->cb_excl;
 		unsigned long pevents = POLLIN;
@@ -826,6 +866,19 @@ static int dma_buf_describe(struct seq_file *s)
 	return 0;
 }
 
+static int dma_buf_wait_stats(struct seq_file *s)
+{
+	struct reservation_wait_stats stats;
+
+	reservation_wait_stats_read(&stats);
+	seq_printf(s, "wait_nosleep: %lu\n", stats.nosleep);
+	seq_printf(s, "wait_sleep: %lu\n", stats.sleep);
+	seq_printf(s, "poll_nosleep: %lu\n", stats.poll_nosleep);
+	seq_printf(s, "poll_sleep: %lu\n", stats.poll_sleep);
+	seq_printf(s, "seqcount_retry: %lu\n", stats.retry);
+	return 0;
+}
+
 static int dma_buf_show(struct seq_file *s, void *unused)
 {
 	void (*func)(struct seq_file *) = s->private;
@@ -862,6 +915,9 @@ static int dma_buf_init_debugfs(void)
 	if (err)
 		pr_debug("dma_buf: debugfs: failed to create node bufinfo\n");
 
+	if (dma_buf_debugfs_create_file("wait_stats", dma_buf_wait_stats))
+		pr_debug("dma_buf: debugfs: failed to create node wait_stats\n");
+
 	return err;
 }
 
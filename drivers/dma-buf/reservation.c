@@ -38,6 +38,30 @@
 DEFINE_WW_CLASS(reservation_ww_class);
 EXPORT_SYMBOL(reservation_ww_class);
 
+DEFINE_PER_CPU(struct reservation_wait_stats, reservation_wait_stats);
+EXPORT_PER_CPU_SYMBOL_GPL(reservation_wait_stats);
+
+/**
+ * reservation_wait_stats_read - sum the wait statistics of all cpus
+ * @stats:	[out]	totals since boot
+ */
+void reservation_wait_stats_read(struct reservation_wait_stats *stats)
+{
+	struct reservation_wait_stats *s;
+	int cpu;
+
+	memset(stats, 0, sizeof(*stats));
+	for_each_possible_cpu(cpu) {
+		s = &per_cpu(reservation_wait_stats, cpu);
+		stats->nosleep += s->nosleep;
+		stats->sleep += s->sleep;
+		stats->retry += s->retry;
+		stats->poll_nosleep += s->poll_nosleep;
+		stats->poll_sleep += s->poll_sleep;
+	}
+}
+EXPORT_SYMBOL_GPL(reservation_wait_stats_read);
+
 struct lock_class_key reservation_seqcount_class;
 EXPORT_SYMBOL(reservation_seqcount_class);
 
@@ -326,6 +350,7 @@ long reservation_object_wait_timeout_rcu(struct reservation_object *obj,
 	struct fence *fence;
 	unsigned seq, shared_count, i = 0;
 	long ret = timeout;
+	bool slept = false;
 
 retry:
 	fence = NULL;
@@ -381,15 +406,22 @@ retry:
 
 	rcu_read_unlock();
 	if (fence) {
+		slept = true;
 		ret = fence_wait_timeout(fence, intr, ret);
 		fence_put(fence);
 		if (ret > 0 && wait_all && (i + 1 < shared_count))
 			goto retry;
 	}
+
+	if (slept)
+		reservation_wait_stat_inc(sleep);
+	else
+		reservation_wait_stat_inc(nosleep);
 	return ret;
 
 unlock_retry:
 	rcu_read_unlock();
+	reservation_wait_stat_inc(retry);
 	goto retry;
 }
 EXPORT_SYMBOL_GPL(reservation_object_wait_timeout_rcu);
@@ -470,6 +502,7 @@ retry:
 
 unlock_retry:
 	rcu_read_unlock();
+	reservation_wait_stat_inc(retry);
 	goto retry;
 }
 EXPORT_SYMBOL_GPL(reservation_object_test_signaled_rcu);
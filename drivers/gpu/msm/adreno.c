@@ -914,6 +914,7 @@ static int adreno_probe(struct platform_device *pdev)
 
 	adreno_debugfs_init(adreno_dev);
 	adreno_profile_init(adreno_dev);
+	adreno_perfcounter_stream_init(adreno_dev);
 
 	adreno_sysfs_init(adreno_dev);
 
@@ -2008,6 +2009,35 @@ static int adreno_setproperty(struct kgsl_device_private *dev_priv,
 			kgsl_context_put(context);
 		}
 		break;
+	case KGSL_PROP_CONTEXT_DEADLINE: {
+			struct kgsl_context_deadline deadline;
+			struct kgsl_context *context;
+			struct adreno_context *drawctxt;
+
+			if (sizebytes != sizeof(deadline))
+				break;
+
+			if (copy_from_user(&deadline, value,
+				sizeof(deadline))) {
+				status = -EFAULT;
+				break;
+			}
+
+			context = kgsl_context_get_owner(dev_priv,
+							deadline.context_id);
+
+			if (context == NULL)
+				break;
+
+			drawctxt = ADRENO_CONTEXT(context);
+			drawctxt->deadline_us = deadline.deadline_us;
+			drawctxt->deadline_flags =
+				deadline.flags & KGSL_CONTEXT_DEADLINE_UI;
+			status = 0;
+
+			kgsl_context_put(context);
+		}
+		break;
 	default:
 		break;
 	}
@@ -2774,6 +2804,7 @@ static const struct kgsl_functable adreno_functable = {
 	.waittimestamp = adreno_waittimestamp,
 	.readtimestamp = adreno_readtimestamp,
 	.issueibcmds = adreno_ringbuffer_issueibcmds,
+	.issueibcmds_list = adreno_ringbuffer_issueibcmds_list,
 	.ioctl = adreno_ioctl,
 	.compat_ioctl = adreno_compat_ioctl,
 	.power_stats = adreno_power_stats,
@@ -343,6 +343,7 @@ struct adreno_gpu_core {
  * @ft_pf_policy: Defines the fault policy for page faults
  * @ocmem_hdl: Handle to the ocmem allocated buffer
  * @profile: Container for adreno profiler information
+ * @perfstream: Perfcounters streamed to a user ring buffer
  * @dispatcher: Container for adreno GPU dispatcher
  * @pwron_fixup: Command buffer to run a post-power collapse shader workaround
  * @pwron_fixup_dwords: Number of dwords in the command buffer
@@ -400,6 +401,7 @@ struct adreno_device {
 	unsigned long ft_pf_policy;
 	struct ocmem_buf *ocmem_hdl;
 	struct adreno_profile profile;
+	struct adreno_perfcounter_stream perfstream;
 	struct adreno_dispatcher dispatcher;
 	struct kgsl_memdesc pwron_fixup;
 	unsigned int pwron_fixup_dwords;
@@ -925,6 +927,9 @@ long adreno_ioctl_perfcounter_get(struct kgsl_device_private *dev_priv,
 long adreno_ioctl_perfcounter_put(struct kgsl_device_private *dev_priv,
 	unsigned int cmd, void *data);
 
+long adreno_ioctl_perfcounter_stream(struct kgsl_device_private *dev_priv,
+	unsigned int cmd, void *data);
+
 int adreno_efuse_map(struct adreno_device *adreno_dev);
 int adreno_efuse_read_u32(struct adreno_device *adreno_dev, unsigned int offset,
 		unsigned int *val);
@@ -220,6 +220,7 @@ static struct kgsl_ioctl adreno_compat_ioctl_funcs[] = {
 		adreno_ioctl_perfcounter_query_compat },
 	{ IOCTL_KGSL_PERFCOUNTER_READ_COMPAT,
 		adreno_ioctl_perfcounter_read_compat },
+	{ IOCTL_KGSL_PERFCOUNTER_STREAM, adreno_ioctl_perfcounter_stream },
 };
 
 long adreno_compat_ioctl(struct kgsl_device_private *dev_priv,
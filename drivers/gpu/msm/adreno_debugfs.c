@@ -16,6 +16,7 @@
 #include <linux/debugfs.h>
 #include <linux/uaccess.h>
 #include <linux/io.h>
+#include <linux/math64.h>
 
 #include "kgsl.h"
 #include "adreno.h"
@@ -292,6 +293,18 @@ static int ctx_print(struct seq_file *s, void *unused)
 		   queued, consumed, retired,
 		   drawctxt->internal_timestamp);
 
+	seq_printf(s, "deadline: %u us%s\n", drawctxt->deadline_us,
+		   (drawctxt->deadline_flags & KGSL_CONTEXT_DEADLINE_UI) ?
+		   " ui" : "");
+	seq_printf(s, "queue latency: count: %llu avg: %llu us max: %llu us\n",
+		   drawctxt->queue_count,
+		   drawctxt->queue_count ?
+		   div64_u64(drawctxt->queue_ns_total,
+			     drawctxt->queue_count * NSEC_PER_USEC) : 0,
+		   div_u64(drawctxt->queue_ns_max, NSEC_PER_USEC));
+	seq_printf(s, "deadline misses: %u preempts: %u\n",
+		   drawctxt->deadline_misses, drawctxt->deadline_preempts);
+
 	seq_puts(s, "cmdqueue:\n");
 
 	spin_lock(&drawctxt->lock);
@@ -16,6 +16,7 @@
 #include <linux/sched.h>
 #include <linux/jiffies.h>
 #include <linux/err.h>
+#include <linux/ktime.h>
 
 #include "kgsl.h"
 #include "kgsl_cffdump.h"
@@ -78,6 +79,23 @@ unsigned int adreno_cmdbatch_timeout = 2000;
 /* Interval for reading and comparing fault detection registers */
 static unsigned int _fault_timer_interval = 200;
 
+/*
+ * If set then the dispatcher picks the pending context whose oldest command
+ * batch has the earliest deadline instead of the highest priority one, and
+ * marks a ringbuffer for preemption when the deadline of one of its contexts
+ * is at risk (closer than _deadline_slack_us away, or already missed).
+ */
+static unsigned int _deadline_sched;
+
+/* Default submission deadline (in microseconds) for contexts */
+static unsigned int _context_deadline_us = 100000;
+
+/* Default submission deadline (in microseconds) for compositor/UI contexts */
+static unsigned int _ui_deadline_us = 8000;
+
+/* Slack (in microseconds) under which a deadline is considered at risk */
+static unsigned int _deadline_slack_us = 2000;
+
 #define CMDQUEUE_RB(_cmdqueue) \
 	((struct adreno_ringbuffer *) \
 		container_of((_cmdqueue), struct adreno_ringbuffer, dispatch_q))
@@ -352,11 +370,22 @@ static bool _marker_expired(struct kgsl_cmdbatch *cmdbatch)
 			cmdbatch->marker_timestamp);
 }
 
+/* Must be called with drawctxt->lock held */
+static inline void _update_head_deadline(struct adreno_context *drawctxt)
+{
+	if (drawctxt->cmdqueue_head == drawctxt->cmdqueue_tail)
+		drawctxt->head_deadline = 0;
+	else
+		drawctxt->head_deadline =
+			drawctxt->cmdqueue[drawctxt->cmdqueue_head]->deadline_ns;
+}
+
 static inline void _pop_cmdbatch(struct adreno_context *drawctxt)
 {
 	drawctxt->cmdqueue_head = CMDQUEUE_NEXT(drawctxt->cmdqueue_head,
 		ADRENO_CONTEXT_CMDQUEUE_SIZE);
 	drawctxt->queued--;
+	_update_head_deadline(drawctxt);
 }
 /**
  * Removes all expired marker and sync cmdbatches from
@@ -515,6 +544,7 @@ static inline int adreno_dispatcher_requeue_cmdbatch(
 
 	/* Reset the command queue head to reflect the newly requeued change */
 	drawctxt->cmdqueue_head = prev;
+	_update_head_deadline(drawctxt);
 	spin_unlock(&drawctxt->lock);
 	return 0;
 }
@@ -565,13 +595,31 @@ static int sendcmd(struct adreno_device *adreno_dev,
 	struct adreno_dispatcher_cmdqueue *dispatch_q =
 				ADRENO_CMDBATCH_DISPATCH_CMDQUEUE(cmdbatch);
 	struct adreno_submit_time time;
+	struct adreno_ringbuffer_stage stage;
 	uint64_t secs = 0;
 	unsigned long nsecs = 0;
 	int ret;
 
+	if (test_bit(ADRENO_DEVICE_CMDBATCH_PROFILE, &adreno_dev->priv)) {
+		set_bit(CMDBATCH_FLAG_PROFILE, &cmdbatch->priv);
+		cmdbatch->profile_index = adreno_dev->cmdbatch_profile_index;
+		adreno_dev->cmdbatch_profile_index =
+			(adreno_dev->cmdbatch_profile_index + 1) %
+			ADRENO_CMDBATCH_PROFILE_COUNT;
+	}
+
+	/*
+	 * Assemble the IBs before taking the device mutex. The ringbuffer
+	 * checks the staged commands again once the mutex is held and simply
+	 * rebuilds them if the context state changed in the meantime, so a
+	 * failure here isn't fatal.
+	 */
+	adreno_ringbuffer_stagecmd(adreno_dev, cmdbatch, &stage);
+
 	mutex_lock(&device->mutex);
 	if (adreno_gpu_halt(adreno_dev) != 0) {
 		mutex_unlock(&device->mutex);
+		adreno_ringbuffer_unstagecmd(&stage);
 		return -EBUSY;
 	}
 
@@ -586,21 +634,14 @@ static int sendcmd(struct adreno_device *adreno_dev,
 			dispatcher->inflight--;
 			dispatch_q->inflight--;
 			mutex_unlock(&device->mutex);
+			adreno_ringbuffer_unstagecmd(&stage);
 			return ret;
 		}
 
 		set_bit(ADRENO_DISPATCHER_POWER, &dispatcher->priv);
 	}
 
-	if (test_bit(ADRENO_DEVICE_CMDBATCH_PROFILE, &adreno_dev->priv)) {
-		set_bit(CMDBATCH_FLAG_PROFILE, &cmdbatch->priv);
-		cmdbatch->profile_index = adreno_dev->cmdbatch_profile_index;
-		adreno_dev->cmdbatch_profile_index =
-			(adreno_dev->cmdbatch_profile_index + 1) %
-			ADRENO_CMDBATCH_PROFILE_COUNT;
-	}
-
-	ret = adreno_ringbuffer_submitcmd(adreno_dev, cmdbatch, &time);
+	ret = adreno_ringbuffer_submitcmd(adreno_dev, cmdbatch, &time, &stage);
 
 	/*
 	 * On the first command, if the submission was successful, then read the
@@ -633,6 +674,7 @@ static int sendcmd(struct adreno_device *adreno_dev,
 		dispatch_q->inflight--;
 
 		mutex_unlock(&device->mutex);
+		adreno_ringbuffer_unstagecmd(&stage);
 
 		/*
 		 * Don't log a message in case of:
@@ -658,8 +700,10 @@ static int sendcmd(struct adreno_device *adreno_dev,
 		adreno_get_rptr(drawctxt->rb));
 
 	mutex_unlock(&device->mutex);
+	adreno_ringbuffer_unstagecmd(&stage);
 
 	cmdbatch->submit_ticks = time.ticks;
+	cmdbatch->submit_ns = time.ktime;
 
 	dispatch_q->cmd_q[dispatch_q->tail] = cmdbatch;
 	dispatch_q->tail = (dispatch_q->tail + 1) %
@@ -696,6 +740,30 @@ static int sendcmd(struct adreno_device *adreno_dev,
 	return 0;
 }
 
+/**
+ * _track_queue_latency() - Account the time a command batch spent queued
+ * @drawctxt: Pointer to the adreno draw context
+ * @queued_ns: queued_ns of the cmdbatch that was just submitted
+ * @deadline_ns: deadline_ns of the cmdbatch that was just submitted
+ *
+ * Called with the dispatcher mutex held, which serializes the stats. The
+ * times are copied before sendcmd() since the cmdbatch may be retired by
+ * the time it returns.
+ */
+static void _track_queue_latency(struct adreno_context *drawctxt,
+		u64 queued_ns, u64 deadline_ns)
+{
+	u64 now = ktime_get_ns();
+	u64 latency = now - queued_ns;
+
+	drawctxt->queue_count++;
+	drawctxt->queue_ns_total += latency;
+	if (latency > drawctxt->queue_ns_max)
+		drawctxt->queue_ns_max = latency;
+	if (now > deadline_ns)
+		drawctxt->deadline_misses++;
+}
+
 /**
  * dispatcher_context_sendcmds() - Send commands from a context to the GPU
  * @adreno_dev: Pointer to the adreno device struct
@@ -714,6 +782,7 @@ static int dispatcher_context_sendcmds(struct adreno_device *adreno_dev,
 	int ret = 0;
 	int inflight = _cmdqueue_inflight(dispatch_q);
 	unsigned int timestamp;
+	u64 queued_ns, deadline_ns;
 
 	if (dispatch_q->inflight >= inflight) {
 		expire_markers(drawctxt);
@@ -758,6 +827,8 @@ static int dispatcher_context_sendcmds(struct adreno_device *adreno_dev,
 		}
 
 		timestamp = cmdbatch->timestamp;
+		queued_ns = cmdbatch->queued_ns;
+		deadline_ns = cmdbatch->deadline_ns;
 
 		ret = sendcmd(adreno_dev, cmdbatch);
 
@@ -785,6 +856,7 @@ static int dispatcher_context_sendcmds(struct adreno_device *adreno_dev,
 		}
 
 		drawctxt->submitted_timestamp = timestamp;
+		_track_queue_latency(drawctxt, queued_ns, deadline_ns);
 
 		count++;
 	}
@@ -804,6 +876,65 @@ static int dispatcher_context_sendcmds(struct adreno_device *adreno_dev,
 	return ret;
 }
 
+/**
+ * _deadline_next_context() - Pick the pending context to dispatch next
+ * @adreno_dev: Pointer to the adreno device struct
+ *
+ * In deadline mode return the context whose oldest command batch has the
+ * earliest deadline, otherwise (or if no context has a deadline) the highest
+ * priority one. Must be called with the plist_lock held.
+ */
+static struct adreno_context *_deadline_next_context(
+		struct adreno_device *adreno_dev)
+{
+	struct adreno_dispatcher *dispatcher = &adreno_dev->dispatcher;
+	struct adreno_context *drawctxt, *next = NULL;
+	u64 deadline, earliest = 0;
+
+	if (_deadline_sched) {
+		plist_for_each_entry(drawctxt, &dispatcher->pending, pending) {
+			deadline = ACCESS_ONCE(drawctxt->head_deadline);
+			if (deadline && (!earliest || deadline < earliest)) {
+				earliest = deadline;
+				next = drawctxt;
+			}
+		}
+	}
+
+	if (next == NULL)
+		next = plist_first_entry(&dispatcher->pending,
+			struct adreno_context, pending);
+
+	return next;
+}
+
+/**
+ * _deadline_check_preempt() - Preempt towards a context at risk
+ * @adreno_dev: Pointer to the adreno device struct
+ * @drawctxt: Pointer to the adreno draw context about to be dispatched
+ *
+ * If the context's oldest deadline is at risk and its ringbuffer is not the
+ * one running, mark the ringbuffer starved so that the next preemption pass
+ * (run by sendcmd()) switches to it ahead of the priority order.
+ */
+static void _deadline_check_preempt(struct adreno_device *adreno_dev,
+		struct adreno_context *drawctxt)
+{
+	u64 deadline = ACCESS_ONCE(drawctxt->head_deadline);
+
+	if (!_deadline_sched || !deadline ||
+		!adreno_is_preemption_enabled(adreno_dev) ||
+		drawctxt->rb == adreno_dev->cur_rb)
+		return;
+
+	if (ktime_get_ns() + (u64) _deadline_slack_us * NSEC_PER_USEC <
+		deadline)
+		return;
+
+	if (!test_and_set_bit(drawctxt->rb->id, &adreno_dev->preempt.starved))
+		drawctxt->deadline_preempts++;
+}
+
 /**
  * _adreno_dispatcher_issuecmds() - Issue commmands from pending contexts
  * @adreno_dev: Pointer to the adreno device struct
@@ -843,8 +974,7 @@ static void _adreno_dispatcher_issuecmds(struct adreno_device *adreno_dev)
 		}
 
 		/* Get the next entry on the list */
-		drawctxt = plist_first_entry(&dispatcher->pending,
-			struct adreno_context, pending);
+		drawctxt = _deadline_next_context(adreno_dev);
 
 		plist_del(&drawctxt->pending, &dispatcher->pending);
 
@@ -856,6 +986,8 @@ static void _adreno_dispatcher_issuecmds(struct adreno_device *adreno_dev)
 			continue;
 		}
 
+		_deadline_check_preempt(adreno_dev, drawctxt);
+
 		ret = dispatcher_context_sendcmds(adreno_dev, drawctxt);
 
 		/* Don't bother requeuing on -ENOENT - context is detached */
@@ -991,31 +1123,25 @@ static int get_timestamp(struct adreno_context *drawctxt,
 }
 
 /**
- * adreno_dispactcher_queue_cmd() - Queue a new command in the context
+ * _queue_cmd_locked() - Add a single command batch to the context queue
  * @adreno_dev: Pointer to the adreno device struct
  * @drawctxt: Pointer to the adreno draw context
+ * @dispatch_q: Dispatcher queue of the ringbuffer the context submits to
  * @cmdbatch: Pointer to the command batch being submitted
  * @timestamp: Pointer to the requested timestamp
  *
- * Queue a command in the context - if there isn't any room in the queue, then
- * block until there is
+ * Must be called with drawctxt->lock held.  The lock is dropped and
+ * reacquired while waiting for room in the context queue.  Return 1 if the
+ * command batch was queued, 0 if it was retired on the marker fastpath or a
+ * negative error code.  The lock is held on return in all cases.
  */
-int adreno_dispatcher_queue_cmd(struct adreno_device *adreno_dev,
-		struct adreno_context *drawctxt, struct kgsl_cmdbatch *cmdbatch,
-		uint32_t *timestamp)
+static int _queue_cmd_locked(struct adreno_device *adreno_dev,
+		struct adreno_context *drawctxt,
+		struct adreno_dispatcher_cmdqueue *dispatch_q,
+		struct kgsl_cmdbatch *cmdbatch, uint32_t *timestamp)
 {
-	struct adreno_dispatcher_cmdqueue *dispatch_q =
-				ADRENO_CMDBATCH_DISPATCH_CMDQUEUE(cmdbatch);
-	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
 	int ret;
 
-	spin_lock(&drawctxt->lock);
-
-	if (kgsl_context_detached(&drawctxt->base)) {
-		spin_unlock(&drawctxt->lock);
-		return -ENOENT;
-	}
-
 	/*
 	 * Force the preamble for this submission only - this is usually
 	 * requested by the dispatcher as part of fault recovery
@@ -1078,30 +1204,22 @@ int adreno_dispatcher_queue_cmd(struct adreno_device *adreno_dev,
 		spin_lock(&drawctxt->lock);
 		trace_adreno_drawctxt_wake(drawctxt);
 
-		if (ret <= 0) {
-			spin_unlock(&drawctxt->lock);
+		if (ret <= 0)
 			return (ret == 0) ? -ETIMEDOUT : (int) ret;
-		}
 	}
 	/*
 	 * Account for the possiblity that the context got invalidated
 	 * while we were sleeping
 	 */
 
-	if (kgsl_context_invalid(&drawctxt->base)) {
-		spin_unlock(&drawctxt->lock);
+	if (kgsl_context_invalid(&drawctxt->base))
 		return -EDEADLK;
-	}
-	if (kgsl_context_detached(&drawctxt->base)) {
-		spin_unlock(&drawctxt->lock);
+	if (kgsl_context_detached(&drawctxt->base))
 		return -ENOENT;
-	}
 
 	ret = get_timestamp(drawctxt, cmdbatch, timestamp);
-	if (ret) {
-		spin_unlock(&drawctxt->lock);
+	if (ret)
 		return ret;
-	}
 
 	cmdbatch->timestamp = *timestamp;
 
@@ -1118,7 +1236,6 @@ int adreno_dispatcher_queue_cmd(struct adreno_device *adreno_dev,
 				drawctxt->queued);
 
 			_retire_marker(cmdbatch);
-			spin_unlock(&drawctxt->lock);
 			return 0;
 		}
 
@@ -1152,10 +1269,19 @@ int adreno_dispatcher_queue_cmd(struct adreno_device *adreno_dev,
 	else
 		cmdbatch->fault_policy = adreno_dev->ft_policy;
 
+	/* Stamp the submission deadline used by the deadline scheduler */
+	cmdbatch->queued_ns = ktime_get_ns();
+	cmdbatch->deadline_ns = cmdbatch->queued_ns + (u64) NSEC_PER_USEC *
+		(drawctxt->deadline_us ? drawctxt->deadline_us :
+		(drawctxt->deadline_flags & KGSL_CONTEXT_DEADLINE_UI) ?
+		_ui_deadline_us : _context_deadline_us);
+
 	/* Put the command into the queue */
 	drawctxt->cmdqueue[drawctxt->cmdqueue_tail] = cmdbatch;
 	drawctxt->cmdqueue_tail = (drawctxt->cmdqueue_tail + 1) %
 		ADRENO_CONTEXT_CMDQUEUE_SIZE;
+	if (drawctxt->head_deadline == 0)
+		_update_head_deadline(drawctxt);
 
 	/*
 	 * If this is a real command then we need to force any markers queued
@@ -1180,7 +1306,22 @@ int adreno_dispatcher_queue_cmd(struct adreno_device *adreno_dev,
 
 	_track_context(adreno_dev, dispatch_q, drawctxt);
 
-	spin_unlock(&drawctxt->lock);
+	return 1;
+}
+
+/**
+ * _queue_cmds_kick() - Tell the dispatcher about newly queued commands
+ * @adreno_dev: Pointer to the adreno device struct
+ * @drawctxt: Pointer to the adreno draw context
+ * @dispatch_q: Dispatcher queue of the ringbuffer the context submits to
+ *
+ * Must be called without drawctxt->lock held.
+ */
+static void _queue_cmds_kick(struct adreno_device *adreno_dev,
+		struct adreno_context *drawctxt,
+		struct adreno_dispatcher_cmdqueue *dispatch_q)
+{
+	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
 
 	if (device->pwrctrl.l2pc_update_queue)
 		kgsl_pwrctrl_update_l2pc(&adreno_dev->dev,
@@ -1200,8 +1341,92 @@ int adreno_dispatcher_queue_cmd(struct adreno_device *adreno_dev,
 
 	if (dispatch_q->inflight < _context_cmdbatch_burst)
 		adreno_dispatcher_issuecmds(adreno_dev);
+}
 
-	return 0;
+/**
+ * adreno_dispatcher_queue_cmds() - Queue a list of commands in the context
+ * @adreno_dev: Pointer to the adreno device struct
+ * @drawctxt: Pointer to the adreno draw context
+ * @cmdbatch: Array of command batches to submit in order
+ * @timestamps: Array of requested timestamps, one per command batch
+ * @count: Number of command batches in the array
+ * @submitted: Returns the number of command batches that were queued
+ *
+ * Queue all the commands under a single hold of the context lock and only
+ * wake the dispatcher once the whole list is in the queue.  If the context
+ * queue fills up part way through the list the dispatcher is kicked before
+ * waiting for room so it can drain what was queued so far.  On error the
+ * command batches from *submitted onwards still belong to the caller.
+ */
+int adreno_dispatcher_queue_cmds(struct adreno_device *adreno_dev,
+		struct adreno_context *drawctxt, struct kgsl_cmdbatch **cmdbatch,
+		uint32_t *timestamps, unsigned int count,
+		unsigned int *submitted)
+{
+	struct adreno_dispatcher_cmdqueue *dispatch_q =
+				ADRENO_CMDBATCH_DISPATCH_CMDQUEUE(cmdbatch[0]);
+	bool queued = false;
+	unsigned int i;
+	int ret = 0;
+
+	*submitted = 0;
+
+	spin_lock(&drawctxt->lock);
+
+	if (kgsl_context_detached(&drawctxt->base)) {
+		spin_unlock(&drawctxt->lock);
+		return -ENOENT;
+	}
+
+	for (i = 0; i < count; i++) {
+		/*
+		 * Don't go to sleep on a full queue with commands the
+		 * dispatcher doesn't know about yet
+		 */
+		if (queued && drawctxt->queued >= _context_cmdqueue_size) {
+			spin_unlock(&drawctxt->lock);
+			_queue_cmds_kick(adreno_dev, drawctxt, dispatch_q);
+			queued = false;
+			spin_lock(&drawctxt->lock);
+		}
+
+		ret = _queue_cmd_locked(adreno_dev, drawctxt, dispatch_q,
+			cmdbatch[i], &timestamps[i]);
+		if (ret < 0)
+			break;
+
+		if (ret)
+			queued = true;
+	}
+
+	spin_unlock(&drawctxt->lock);
+
+	*submitted = i;
+
+	if (queued)
+		_queue_cmds_kick(adreno_dev, drawctxt, dispatch_q);
+
+	return ret < 0 ? ret : 0;
+}
+
+/**
+ * adreno_dispactcher_queue_cmd() - Queue a new command in the context
+ * @adreno_dev: Pointer to the adreno device struct
+ * @drawctxt: Pointer to the adreno draw context
+ * @cmdbatch: Pointer to the command batch being submitted
+ * @timestamp: Pointer to the requested timestamp
+ *
+ * Queue a command in the context - if there isn't any room in the queue, then
+ * block until there is
+ */
+int adreno_dispatcher_queue_cmd(struct adreno_device *adreno_dev,
+		struct adreno_context *drawctxt, struct kgsl_cmdbatch *cmdbatch,
+		uint32_t *timestamp)
+{
+	unsigned int submitted;
+
+	return adreno_dispatcher_queue_cmds(adreno_dev, drawctxt, &cmdbatch,
+		timestamp, 1, &submitted);
 }
 
 static int _mark_context(int id, void *ptr, void *data)
@@ -1975,6 +2200,50 @@ static void cmdbatch_profile_ticks(struct adreno_device *adreno_dev,
 	*retire = entry->retired;
 }
 
+/**
+ * _track_frame_work() - Account a retired cmdbatch to the current frame
+ * @adreno_dev: Pointer to the adreno device
+ * @drawctxt: Context that owns the cmdbatch
+ * @cmdbatch: The cmdbatch being retired
+ *
+ * Accumulate the time between submission (or the retirement of the previous
+ * cmdbatch, whichever is later) and retirement so that queued work is not
+ * counted twice.  At the end of a frame convert the total to GPU cycles at the
+ * current frequency and pass the prediction for the next frame to pwrscale.
+ */
+static void _track_frame_work(struct adreno_device *adreno_dev,
+		struct adreno_context *drawctxt, struct kgsl_cmdbatch *cmdbatch)
+{
+	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
+	u64 now, begin, cycles;
+
+	if (!device->pwrscale.frame.enabled)
+		return;
+
+	now = local_clock();
+	begin = max(cmdbatch->submit_ns, drawctxt->frame_retire_ns);
+	if (now > begin)
+		drawctxt->frame_busy_ns += now - begin;
+	drawctxt->frame_retire_ns = now;
+
+	if (!(cmdbatch->flags & KGSL_CMDBATCH_END_OF_FRAME))
+		return;
+
+	cycles = div_u64(drawctxt->frame_busy_ns *
+		kgsl_pwrctrl_active_freq(&device->pwrctrl), NSEC_PER_SEC);
+	drawctxt->frame_busy_ns = 0;
+
+	/* Follow heavier frames immediately, decay over a few lighter ones */
+	if (cycles >= drawctxt->frame_cycles)
+		drawctxt->frame_cycles = cycles;
+	else
+		drawctxt->frame_cycles = (drawctxt->frame_cycles * 3 +
+			cycles) >> 2;
+
+	kgsl_pwrscale_frame_done(device, drawctxt->base.id,
+		drawctxt->frame_cycles);
+}
+
 static void retire_cmdbatch(struct adreno_device *adreno_dev,
 		struct kgsl_cmdbatch *cmdbatch)
 {
@@ -2011,6 +2280,9 @@ static void retire_cmdbatch(struct adreno_device *adreno_dev,
 	drawctxt->ticks_index = (drawctxt->ticks_index + 1) %
 		SUBMIT_RETIRE_TICKS_SIZE;
 
+	_track_frame_work(adreno_dev, drawctxt, cmdbatch);
+	adreno_perfcounter_stream_retire(adreno_dev, cmdbatch);
+
 	kgsl_cmdbatch_destroy(cmdbatch);
 }
 
@@ -2366,6 +2638,14 @@ struct dispatcher_attribute {
 		.value = &(_value), \
 	}
 
+#define DISPATCHER_BOOL_ATTR(_name, _mode, _value) \
+	struct dispatcher_attribute dispatcher_attr_##_name =  { \
+		.attr = { .name = __stringify(_name), .mode = _mode }, \
+		.show = _show_uint, \
+		.store = _store_bool, \
+		.value = &(_value), \
+	}
+
 #define to_dispatcher_attr(_a) \
 	container_of((_a), struct dispatcher_attribute, attr)
 #define to_dispatcher(k) container_of(k, struct adreno_dispatcher, kobj)
@@ -2388,6 +2668,21 @@ static ssize_t _store_uint(struct adreno_dispatcher *dispatcher,
 	return size;
 }
 
+static ssize_t _store_bool(struct adreno_dispatcher *dispatcher,
+		struct dispatcher_attribute *attr,
+		const char *buf, size_t size)
+{
+	unsigned int val = 0;
+	int ret;
+
+	ret = kgsl_sysfs_store(buf, &val);
+	if (ret)
+		return ret;
+
+	*((unsigned int *) attr->value) = val ? 1 : 0;
+	return size;
+}
+
 static ssize_t _show_uint(struct adreno_dispatcher *dispatcher,
 		struct dispatcher_attribute *attr,
 		char *buf)
@@ -2426,6 +2721,11 @@ static DISPATCHER_UINT_ATTR(dispatch_time_slice, 0644, 0,
 	adreno_dispatch_time_slice);
 static DISPATCHER_UINT_ATTR(dispatch_starvation_time, 0644, 0,
 	adreno_dispatch_starvation_time);
+static DISPATCHER_BOOL_ATTR(deadline_sched, 0644, _deadline_sched);
+static DISPATCHER_UINT_ATTR(context_deadline_us, 0644, 0,
+	_context_deadline_us);
+static DISPATCHER_UINT_ATTR(ui_deadline_us, 0644, 0, _ui_deadline_us);
+static DISPATCHER_UINT_ATTR(deadline_slack_us, 0644, 0, _deadline_slack_us);
 
 static struct attribute *dispatcher_attrs[] = {
 	&dispatcher_attr_inflight.attr,
@@ -2440,6 +2740,10 @@ static struct attribute *dispatcher_attrs[] = {
 	&dispatcher_attr_disp_preempt_fair_sched.attr,
 	&dispatcher_attr_dispatch_time_slice.attr,
 	&dispatcher_attr_dispatch_starvation_time.attr,
+	&dispatcher_attr_deadline_sched.attr,
+	&dispatcher_attr_context_deadline_us.attr,
+	&dispatcher_attr_ui_deadline_us.attr,
+	&dispatcher_attr_deadline_slack_us.attr,
 	NULL,
 };
 
@@ -113,6 +113,10 @@ void adreno_dispatcher_stop_fault_timer(struct kgsl_device *device);
 int adreno_dispatcher_queue_cmd(struct adreno_device *adreno_dev,
 		struct adreno_context *drawctxt, struct kgsl_cmdbatch *cmdbatch,
 		uint32_t *timestamp);
+int adreno_dispatcher_queue_cmds(struct adreno_device *adreno_dev,
+		struct adreno_context *drawctxt, struct kgsl_cmdbatch **cmdbatch,
+		uint32_t *timestamps, unsigned int count,
+		unsigned int *submitted);
 
 void adreno_dispatcher_schedule(struct kgsl_device *device);
 void adreno_dispatcher_pause(struct adreno_device *adreno_dev);
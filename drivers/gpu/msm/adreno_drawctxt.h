@@ -52,6 +52,19 @@ struct kgsl_context;
  *		 be written.
  * @active_node: Linkage for nodes in active_list
  * @active_time: Time when this context last seen
+ * @deadline_us: Submission deadline set by userspace, 0 for the default
+ * @deadline_flags: KGSL_CONTEXT_DEADLINE_* flags set by userspace
+ * @head_deadline: deadline_ns of the cmdbatch at the head of the cmdqueue,
+ *		   0 if the cmdqueue is empty. Guarded by drawctxt->lock.
+ * @queue_count: Number of cmdbatches submitted to the ringbuffer
+ * @queue_ns_total: Total time cmdbatches waited in the cmdqueue
+ * @queue_ns_max: Longest time a cmdbatch waited in the cmdqueue
+ * @deadline_misses: Number of cmdbatches submitted after their deadline
+ * @deadline_preempts: Number of times this context's ringbuffer was marked
+ *		       for preemption because its deadline was at risk
+ * @frame_busy_ns: GPU time accumulated by the frame currently being retired
+ * @frame_retire_ns: local_clock() when the last cmdbatch was retired
+ * @frame_cycles: Predicted GPU cycles needed by the next frame
  */
 struct adreno_context {
 	struct kgsl_context base;
@@ -81,6 +94,18 @@ struct adreno_context {
 
 	struct list_head active_node;
 	unsigned long active_time;
+
+	unsigned int deadline_us;
+	unsigned int deadline_flags;
+	u64 head_deadline;
+	u64 queue_count;
+	u64 queue_ns_total;
+	u64 queue_ns_max;
+	unsigned int deadline_misses;
+	unsigned int deadline_preempts;
+	u64 frame_busy_ns;
+	u64 frame_retire_ns;
+	u64 frame_cycles;
 };
 
 /* Flag definitions for flag field in adreno_context */
@@ -113,6 +113,26 @@ static long adreno_ioctl_preemption_counters_query(
 	return 0;
 }
 
+long adreno_ioctl_perfcounter_stream(struct kgsl_device_private *dev_priv,
+		unsigned int cmd, void *data)
+{
+	struct adreno_device *adreno_dev = ADRENO_DEVICE(dev_priv->device);
+	struct kgsl_perfcounter_stream *param = data;
+	struct kgsl_context *context;
+
+	if (param->flags)
+		return (long) adreno_perfcounter_stream_start(dev_priv, param);
+
+	context = kgsl_context_get_owner(dev_priv, param->context_id);
+	if (context == NULL)
+		return -EINVAL;
+
+	adreno_perfcounter_stream_stop(adreno_dev, context);
+	kgsl_context_put(context);
+
+	return 0;
+}
+
 long adreno_ioctl_helper(struct kgsl_device_private *dev_priv,
 		unsigned int cmd, unsigned long arg,
 		const struct kgsl_ioctl *cmds, int len)
@@ -158,6 +178,7 @@ static struct kgsl_ioctl adreno_ioctl_funcs[] = {
 	{ IOCTL_KGSL_PERFCOUNTER_READ, adreno_ioctl_perfcounter_read },
 	{ IOCTL_KGSL_PREEMPTIONCOUNTER_QUERY,
 		adreno_ioctl_preemption_counters_query },
+	{ IOCTL_KGSL_PERFCOUNTER_STREAM, adreno_ioctl_perfcounter_stream },
 };
 
 long adreno_ioctl(struct kgsl_device_private *dev_priv,
@@ -1039,3 +1039,364 @@ uint64_t adreno_perfcounter_read(struct adreno_device *adreno_dev,
 		return _perfcounter_read_default(adreno_dev, group, counter);
 	}
 }
+
+/* Size in dwords of a stream sample, matches the adreno_profile log entry */
+#define PERFSTREAM_SAMPLE_SIZE(cnt) (6 + (cnt) * 5)
+
+static inline void _perfstream_write(unsigned int *data, unsigned int size,
+		unsigned int *head, unsigned int val)
+{
+	data[*head] = val;
+	*head = (*head + 1) % size;
+}
+
+/*
+ * _perfstream_sample() - Append one sample to the stream ring
+ * @adreno_dev: Pointer to the adreno device
+ * @timestamp: Timestamp to record with the sample
+ *
+ * Must be called with the stream lock held and the GPU active.
+ */
+static void _perfstream_sample(struct adreno_device *adreno_dev,
+		unsigned int timestamp)
+{
+	struct adreno_perfcounter_stream *stream = &adreno_dev->perfstream;
+	struct kgsl_perfcounter_stream_header *header = stream->header;
+	struct kgsl_context *context = stream->context;
+	unsigned int *data = (unsigned int *) (header + 1);
+	unsigned int size = header->size;
+	unsigned int head = header->head;
+	unsigned int tail = ACCESS_ONCE(header->tail);
+	unsigned int i;
+
+	/* The consumer owns tail - don't trust it to be in range */
+	if (tail >= size || head >= size) {
+		header->dropped++;
+		return;
+	}
+
+	if ((tail + size - head - 1) % size <
+			PERFSTREAM_SAMPLE_SIZE(stream->count)) {
+		header->dropped++;
+		return;
+	}
+
+	_perfstream_write(data, size, &head, stream->count);
+	_perfstream_write(data, size, &head, ADRENO_CONTEXT(context)->type);
+	_perfstream_write(data, size, &head, pid_nr(context->proc_priv->pid));
+	_perfstream_write(data, size, &head, context->tid);
+	_perfstream_write(data, size, &head, context->id);
+	_perfstream_write(data, size, &head, timestamp);
+
+	for (i = 0; i < stream->count; i++) {
+		struct adreno_perfstream_counter *c = &stream->counters[i];
+		uint64_t val = adreno_perfcounter_read(adreno_dev, c->groupid,
+			c->reg);
+
+		_perfstream_write(data, size, &head,
+			c->groupid << 16 | (c->countable & 0xffff));
+		_perfstream_write(data, size, &head, upper_32_bits(c->last));
+		_perfstream_write(data, size, &head, lower_32_bits(c->last));
+		_perfstream_write(data, size, &head, upper_32_bits(val));
+		_perfstream_write(data, size, &head, lower_32_bits(val));
+
+		c->last = val;
+	}
+
+	/* Make sure the sample is visible before the new head */
+	wmb();
+	header->head = head;
+}
+
+static void _perfstream_work(struct work_struct *work)
+{
+	struct adreno_device *adreno_dev = container_of(to_delayed_work(work),
+			struct adreno_device, perfstream.work);
+	struct adreno_perfcounter_stream *stream = &adreno_dev->perfstream;
+	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
+	unsigned int timestamp = 0;
+
+	/* The device mutex keeps the GPU from changing state under us */
+	mutex_lock(&device->mutex);
+	spin_lock(&stream->lock);
+
+	if (stream->context == NULL)
+		goto done;
+
+	/* Don't wake the GPU just to sample idle counters */
+	if (device->state == KGSL_STATE_ACTIVE) {
+		kgsl_readtimestamp(device, stream->context,
+			KGSL_TIMESTAMP_RETIRED, &timestamp);
+		_perfstream_sample(adreno_dev, timestamp);
+	}
+
+	schedule_delayed_work(&stream->work,
+		usecs_to_jiffies(stream->period_us));
+done:
+	spin_unlock(&stream->lock);
+	mutex_unlock(&device->mutex);
+}
+
+/**
+ * adreno_perfcounter_stream_init() - Initialize the perfcounter stream
+ * @adreno_dev: Pointer to the adreno device
+ */
+void adreno_perfcounter_stream_init(struct adreno_device *adreno_dev)
+{
+	spin_lock_init(&adreno_dev->perfstream.lock);
+	INIT_DELAYED_WORK(&adreno_dev->perfstream.work, _perfstream_work);
+}
+
+static void _perfstream_put_counters(struct adreno_device *adreno_dev,
+		struct adreno_perfstream_counter *counters, unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++)
+		adreno_perfcounter_put(adreno_dev, counters[i].groupid,
+			counters[i].countable, PERFCOUNTER_FLAG_KERNEL);
+}
+
+static int _perfstream_get_counters(struct adreno_device *adreno_dev,
+		struct adreno_perfstream_counter *counters, unsigned int count)
+{
+	struct adreno_perfcounters *perfcounters =
+		ADRENO_PERFCOUNTERS(adreno_dev);
+	struct adreno_perfcount_group *group;
+	unsigned int i, j;
+	int ret;
+
+	for (i = 0; i < count; i++) {
+		ret = adreno_perfcounter_get(adreno_dev, counters[i].groupid,
+			counters[i].countable, NULL, NULL,
+			PERFCOUNTER_FLAG_KERNEL);
+		if (ret)
+			goto err;
+
+		group = &perfcounters->groups[counters[i].groupid];
+
+		for (j = 0; j < group->reg_count; j++)
+			if (group->regs[j].countable == counters[i].countable)
+				break;
+
+		counters[i].reg = j;
+		counters[i].last = adreno_perfcounter_read(adreno_dev,
+			counters[i].groupid, j);
+	}
+
+	return 0;
+err:
+	_perfstream_put_counters(adreno_dev, counters, i);
+	return ret;
+}
+
+/**
+ * adreno_perfcounter_stream_start() - Start streaming perfcounters
+ * @dev_priv: Pointer to the process device private
+ * @param: Stream parameters from userspace
+ *
+ * Reserve the requested counters and begin writing samples into the
+ * GPU object named in @param on every retire or every period.  Return 0 on
+ * success or a negative error code.
+ */
+int adreno_perfcounter_stream_start(struct kgsl_device_private *dev_priv,
+	struct kgsl_perfcounter_stream *param)
+{
+	struct kgsl_device *device = dev_priv->device;
+	struct adreno_device *adreno_dev = ADRENO_DEVICE(device);
+	struct adreno_perfcounter_stream *stream = &adreno_dev->perfstream;
+	struct adreno_perfcounters *perfcounters =
+		ADRENO_PERFCOUNTERS(adreno_dev);
+	struct kgsl_perfcounter_read_group list[KGSL_PERFCOUNTER_STREAM_MAX];
+	struct adreno_perfstream_counter counters[KGSL_PERFCOUNTER_STREAM_MAX];
+	struct kgsl_perfcounter_stream_header *header;
+	struct kgsl_context *context;
+	struct kgsl_mem_entry *entry;
+	uint64_t size;
+	unsigned int i;
+	int ret;
+
+	if (perfcounters == NULL)
+		return -EINVAL;
+
+	if (param->flags != KGSL_PERFCOUNTER_STREAM_RETIRE &&
+		param->flags != KGSL_PERFCOUNTER_STREAM_PERIOD)
+		return -EINVAL;
+
+	if (param->flags == KGSL_PERFCOUNTER_STREAM_PERIOD &&
+		param->period_us == 0)
+		return -EINVAL;
+
+	if (param->count == 0 || param->count > KGSL_PERFCOUNTER_STREAM_MAX)
+		return -EINVAL;
+
+	if (copy_from_user(list, to_user_ptr(param->counters),
+			param->count * sizeof(list[0])))
+		return -EFAULT;
+
+	for (i = 0; i < param->count; i++) {
+		if (list[i].groupid >= perfcounters->group_count)
+			return -EINVAL;
+
+		counters[i].groupid = list[i].groupid;
+		counters[i].countable = list[i].countable;
+	}
+
+	context = kgsl_context_get_owner(dev_priv, param->context_id);
+	if (context == NULL)
+		return -EINVAL;
+
+	entry = kgsl_sharedmem_find_id(dev_priv->process_priv, param->id);
+	if (entry == NULL) {
+		ret = -EINVAL;
+		goto put_context;
+	}
+
+	/* The kernel mapping is write-combined, so the user one must be too */
+	if (kgsl_memdesc_get_cachemode(&entry->memdesc) ==
+			KGSL_CACHEMODE_WRITEBACK ||
+		kgsl_memdesc_get_cachemode(&entry->memdesc) ==
+			KGSL_CACHEMODE_WRITETHROUGH) {
+		ret = -EINVAL;
+		goto put_entry;
+	}
+
+	size = entry->memdesc.size;
+	if (size < sizeof(*header) + PERFSTREAM_SAMPLE_SIZE(param->count) *
+			sizeof(unsigned int) * 2) {
+		ret = -EINVAL;
+		goto put_entry;
+	}
+
+	header = kgsl_memdesc_map(&entry->memdesc);
+	if (header == NULL) {
+		ret = -ENOMEM;
+		goto put_entry;
+	}
+
+	mutex_lock(&device->mutex);
+
+	if (stream->context != NULL) {
+		ret = -EBUSY;
+		goto unlock;
+	}
+
+	/* The context may have been detached since we looked it up */
+	if (kgsl_context_detached(context)) {
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	ret = kgsl_active_count_get(device);
+	if (ret)
+		goto unlock;
+
+	ret = _perfstream_get_counters(adreno_dev, counters, param->count);
+	kgsl_active_count_put(device);
+	if (ret)
+		goto unlock;
+
+	header->head = 0;
+	header->tail = 0;
+	header->size = (size - sizeof(*header)) / sizeof(unsigned int);
+	header->dropped = 0;
+	wmb();
+
+	spin_lock(&stream->lock);
+	memcpy(stream->counters, counters, param->count * sizeof(counters[0]));
+	stream->count = param->count;
+	stream->flags = param->flags;
+	stream->period_us = param->period_us;
+	stream->header = header;
+	stream->entry = entry;
+	stream->context = context;
+	spin_unlock(&stream->lock);
+
+	if (stream->flags == KGSL_PERFCOUNTER_STREAM_PERIOD)
+		schedule_delayed_work(&stream->work,
+			usecs_to_jiffies(stream->period_us));
+
+	mutex_unlock(&device->mutex);
+	return 0;
+
+unlock:
+	mutex_unlock(&device->mutex);
+	kgsl_memdesc_unmap(&entry->memdesc);
+put_entry:
+	kgsl_mem_entry_put(entry);
+put_context:
+	kgsl_context_put(context);
+	return ret;
+}
+
+/**
+ * adreno_perfcounter_stream_stop() - Stop streaming perfcounters
+ * @adreno_dev: Pointer to the adreno device
+ * @context: Context that owns the stream
+ *
+ * Stop the stream if it belongs to @context and release the counters and
+ * buffer it holds.  Must be called without the device mutex held.
+ */
+void adreno_perfcounter_stream_stop(struct adreno_device *adreno_dev,
+	struct kgsl_context *context)
+{
+	struct adreno_perfcounter_stream *stream = &adreno_dev->perfstream;
+	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
+	struct kgsl_mem_entry *entry;
+
+	mutex_lock(&device->mutex);
+
+	if (context == NULL || stream->context != context) {
+		mutex_unlock(&device->mutex);
+		return;
+	}
+
+	spin_lock(&stream->lock);
+	entry = stream->entry;
+	stream->context = NULL;
+	stream->entry = NULL;
+	stream->header = NULL;
+	spin_unlock(&stream->lock);
+
+	_perfstream_put_counters(adreno_dev, stream->counters, stream->count);
+	stream->count = 0;
+
+	mutex_unlock(&device->mutex);
+
+	/* The work bails out and doesn't rearm once the context is cleared */
+	cancel_delayed_work_sync(&stream->work);
+
+	kgsl_memdesc_unmap(&entry->memdesc);
+	kgsl_mem_entry_put(entry);
+	kgsl_context_put(context);
+}
+
+/**
+ * adreno_perfcounter_stream_retire() - Sample the stream on a retire
+ * @adreno_dev: Pointer to the adreno device
+ * @cmdbatch: The cmdbatch being retired
+ *
+ * Called by the dispatcher for every retired cmdbatch.  Append a sample if
+ * the stream samples on retire and the cmdbatch belongs to its context.
+ * The dispatcher holds an active count while cmdbatches are inflight and
+ * may already hold the device mutex, so only the stream lock is taken here.
+ */
+void adreno_perfcounter_stream_retire(struct adreno_device *adreno_dev,
+	struct kgsl_cmdbatch *cmdbatch)
+{
+	struct adreno_perfcounter_stream *stream = &adreno_dev->perfstream;
+	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
+
+	/* Unlocked peek to keep the common case cheap */
+	if (ACCESS_ONCE(stream->context) != cmdbatch->context)
+		return;
+
+	spin_lock(&stream->lock);
+
+	if (stream->context == cmdbatch->context &&
+		stream->flags == KGSL_PERFCOUNTER_STREAM_RETIRE &&
+		device->state == KGSL_STATE_ACTIVE)
+		_perfstream_sample(adreno_dev, cmdbatch->timestamp);
+
+	spin_unlock(&stream->lock);
+}
@@ -90,6 +90,47 @@ struct adreno_invalid_countables {
 	int num_countables;
 };
 
+/**
+ * struct adreno_perfstream_counter - A counter sampled by the stream
+ * @groupid: Perfcounter group
+ * @countable: Countable selected in the group
+ * @reg: Index of the register holding @countable
+ * @last: Value read at the previous sample
+ */
+struct adreno_perfstream_counter {
+	unsigned int groupid;
+	unsigned int countable;
+	unsigned int reg;
+	uint64_t last;
+};
+
+/**
+ * struct adreno_perfcounter_stream - Counters streamed to a user ring buffer
+ * @lock: Protects the stream against sampling from the dispatcher
+ * @context: Context that owns the stream, NULL if the stream is idle
+ * @entry: GPU object holding the ring
+ * @header: Kernel mapping of the ring header, the data area follows it
+ * @flags: KGSL_PERFCOUNTER_STREAM_* sampling mode
+ * @period_us: Sampling period for KGSL_PERFCOUNTER_STREAM_PERIOD
+ * @count: Number of entries in @counters
+ * @counters: Counters to sample
+ * @work: Periodic sampling work
+ *
+ * The stream is changed with both the device mutex and @lock held, so
+ * holding either is enough to sample it.
+ */
+struct adreno_perfcounter_stream {
+	spinlock_t lock;
+	struct kgsl_context *context;
+	struct kgsl_mem_entry *entry;
+	struct kgsl_perfcounter_stream_header *header;
+	unsigned int flags;
+	unsigned int period_us;
+	unsigned int count;
+	struct adreno_perfstream_counter counters[KGSL_PERFCOUNTER_STREAM_MAX];
+	struct delayed_work work;
+};
+
 #define ADRENO_PERFCOUNTER_GROUP_FLAGS(core, offset, name, flags) \
 	[KGSL_PERFCOUNTER_GROUP_##offset] = { core##_perfcounters_##name, \
 	ARRAY_SIZE(core##_perfcounters_##name), __stringify(name), flags }
@@ -138,4 +179,12 @@ int adreno_perfcounter_get(struct adreno_device *adreno_dev,
 int adreno_perfcounter_put(struct adreno_device *adreno_dev,
 	unsigned int groupid, unsigned int countable, unsigned int flags);
 
+void adreno_perfcounter_stream_init(struct adreno_device *adreno_dev);
+int adreno_perfcounter_stream_start(struct kgsl_device_private *dev_priv,
+	struct kgsl_perfcounter_stream *param);
+void adreno_perfcounter_stream_stop(struct adreno_device *adreno_dev,
+	struct kgsl_context *context);
+void adreno_perfcounter_stream_retire(struct adreno_device *adreno_dev,
+	struct kgsl_cmdbatch *cmdbatch);
+
 #endif /* __ADRENO_PERFCOUNTER_H */
@@ -313,6 +313,13 @@ static int _adreno_ringbuffer_probe(struct adreno_device *adreno_dev,
 	kgsl_allocate_global(KGSL_DEVICE(adreno_dev), &rb->profile_desc,
 		PAGE_SIZE, KGSL_MEMFLAGS_GPUREADONLY, 0, "profile_desc");
 
+	/*
+	 * Staging buffer for command batch IBs. If this fails submissions
+	 * allocate a buffer each time instead.
+	 */
+	rb->stage_buf = kmalloc(ADRENO_RB_STAGE_DWORDS * sizeof(unsigned int),
+		GFP_KERNEL);
+
 	return kgsl_allocate_global(KGSL_DEVICE(adreno_dev), &rb->buffer_desc,
 			KGSL_RB_SIZE, KGSL_MEMFLAGS_GPUREADONLY,
 			0, "ringbuffer");
@@ -360,6 +367,7 @@ static void _adreno_ringbuffer_close(struct adreno_device *adreno_dev,
 	kgsl_free_global(device, &rb->preemption_desc);
 	kgsl_free_global(device, &rb->profile_desc);
 	kgsl_free_global(device, &rb->buffer_desc);
+	kfree(rb->stage_buf);
 	kgsl_del_event_group(&rb->events);
 	memset(rb, 0, sizeof(struct adreno_ringbuffer));
 }
@@ -787,37 +795,69 @@ static inline bool _ringbuffer_verify_ib(struct kgsl_device_private *dev_priv,
 	return true;
 }
 
+static int _ringbuffer_check_cmdbatch(struct kgsl_device_private *dev_priv,
+		struct kgsl_context *context, struct kgsl_cmdbatch *cmdbatch)
+{
+	struct adreno_device *adreno_dev = ADRENO_DEVICE(dev_priv->device);
+	struct kgsl_memobj_node *ib;
+
+	/* Verify the IBs before they get queued */
+	list_for_each_entry(ib, &cmdbatch->cmdlist, node)
+		if (_ringbuffer_verify_ib(dev_priv, context, ib) == false)
+			return -EINVAL;
+
+	/* A3XX does not have support for command batch profiling */
+	if (adreno_is_a3xx(adreno_dev) &&
+			(cmdbatch->flags & KGSL_CMDBATCH_PROFILING))
+		return -EOPNOTSUPP;
+
+	return 0;
+}
+
 int
 adreno_ringbuffer_issueibcmds(struct kgsl_device_private *dev_priv,
 				struct kgsl_context *context,
 				struct kgsl_cmdbatch *cmdbatch,
 				uint32_t *timestamp)
+{
+	unsigned int submitted;
+
+	return adreno_ringbuffer_issueibcmds_list(dev_priv, context,
+		&cmdbatch, timestamp, 1, &submitted);
+}
+
+int
+adreno_ringbuffer_issueibcmds_list(struct kgsl_device_private *dev_priv,
+				struct kgsl_context *context,
+				struct kgsl_cmdbatch **cmdbatch,
+				uint32_t *timestamps, unsigned int count,
+				unsigned int *submitted)
 {
 	struct kgsl_device *device = dev_priv->device;
 	struct adreno_device *adreno_dev = ADRENO_DEVICE(device);
 	struct adreno_context *drawctxt = ADRENO_CONTEXT(context);
-	struct kgsl_memobj_node *ib;
+	unsigned int i;
 	int ret;
 
+	*submitted = 0;
+
 	if (kgsl_context_invalid(context))
 		return -EDEADLK;
 
-	/* Verify the IBs before they get queued */
-	list_for_each_entry(ib, &cmdbatch->cmdlist, node)
-		if (_ringbuffer_verify_ib(dev_priv, context, ib) == false)
-			return -EINVAL;
+	/* Verify the whole list up front so that nothing is partially queued */
+	for (i = 0; i < count; i++) {
+		ret = _ringbuffer_check_cmdbatch(dev_priv, context,
+			cmdbatch[i]);
+		if (ret)
+			return ret;
+	}
 
 	/* wait for the suspend gate */
 	wait_for_completion(&device->cmdbatch_gate);
 
-	/* A3XX does not have support for command batch profiling */
-	if (adreno_is_a3xx(adreno_dev) &&
-			(cmdbatch->flags & KGSL_CMDBATCH_PROFILING))
-		return -EOPNOTSUPP;
-
-	/* Queue the command in the ringbuffer */
-	ret = adreno_dispatcher_queue_cmd(adreno_dev, drawctxt, cmdbatch,
-		timestamp);
+	/* Queue the commands in the ringbuffer */
+	ret = adreno_dispatcher_queue_cmds(adreno_dev, drawctxt, cmdbatch,
+		timestamps, count, submitted);
 
 	/*
 	 * Return -EPROTO if the device has faulted since the last time we
@@ -900,76 +940,26 @@ static int set_user_profiling(struct adreno_device *adreno_dev,
 	return index;
 }
 
-/* adreno_rindbuffer_submitcmd - submit userspace IBs to the GPU */
-int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
-		struct kgsl_cmdbatch *cmdbatch, struct adreno_submit_time *time)
+/*
+ * _stage_state() - Work out which optional commands a command batch needs
+ * based on the current state of the context and the ringbuffer
+ */
+static void _stage_state(struct adreno_device *adreno_dev,
+		struct adreno_ringbuffer *rb, struct kgsl_cmdbatch *cmdbatch,
+		bool profile_buffer, struct adreno_ringbuffer_stage *stage)
 {
-	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
 	struct adreno_gpudev *gpudev = ADRENO_GPU_DEVICE(adreno_dev);
-	struct kgsl_memobj_node *ib;
-	unsigned int numibs = 0;
-	unsigned int *link;
-	unsigned int *cmds;
-	struct kgsl_context *context;
-	struct adreno_context *drawctxt;
-	bool use_preamble = true;
-	bool cmdbatch_user_profiling = false;
-	bool cmdbatch_kernel_profiling = false;
-	int flags = KGSL_CMD_FLAGS_NONE;
-	int ret;
-	struct adreno_ringbuffer *rb;
-	struct kgsl_cmdbatch_profiling_buffer *profile_buffer = NULL;
-	unsigned int dwords = 0;
-	struct adreno_submit_time local;
+	struct adreno_context *drawctxt = ADRENO_CONTEXT(cmdbatch->context);
 
-	struct kgsl_mem_entry *entry = cmdbatch->profiling_buf_entry;
-	if (entry)
-		profile_buffer = kgsl_gpuaddr_to_vaddr(&entry->memdesc,
-					cmdbatch->profiling_buffer_gpuaddr);
-
-	context = cmdbatch->context;
-	drawctxt = ADRENO_CONTEXT(context);
-
-	/* Get the total IBs in the list */
-	list_for_each_entry(ib, &cmdbatch->cmdlist, node)
-		numibs++;
-
-	rb = drawctxt->rb;
-
-	/* process any profiling results that are available into the log_buf */
-	adreno_profile_process_results(adreno_dev);
-
-	/*
-	 * If SKIP CMD flag is set for current context
-	 * a) set SKIPCMD as fault_recovery for current commandbatch
-	 * b) store context's commandbatch fault_policy in current
-	 *    commandbatch fault_policy and clear context's commandbatch
-	 *    fault_policy
-	 * c) force preamble for commandbatch
-	 */
-	if (test_bit(ADRENO_CONTEXT_SKIP_CMD, &drawctxt->base.priv) &&
-		(!test_bit(CMDBATCH_FLAG_SKIP, &cmdbatch->priv))) {
-
-		set_bit(KGSL_FT_SKIPCMD, &cmdbatch->fault_recovery);
-		cmdbatch->fault_policy = drawctxt->fault_policy;
-		set_bit(CMDBATCH_FLAG_FORCE_PREAMBLE, &cmdbatch->priv);
-
-		/* if context is detached print fault recovery */
-		adreno_fault_skipcmd_detached(adreno_dev, drawctxt, cmdbatch);
-
-		/* clear the drawctxt flags */
-		clear_bit(ADRENO_CONTEXT_SKIP_CMD, &drawctxt->base.priv);
-		drawctxt->fault_policy = 0;
-	}
+	stage->rb = rb;
 
 	/*When preamble is enabled, the preamble buffer with state restoration
 	commands are stored in the first node of the IB chain. We can skip that
 	if a context switch hasn't occured */
-
-	if ((drawctxt->base.flags & KGSL_CONTEXT_PREAMBLE) &&
+	stage->use_preamble =
+		!((drawctxt->base.flags & KGSL_CONTEXT_PREAMBLE) &&
 		!test_bit(CMDBATCH_FLAG_FORCE_PREAMBLE, &cmdbatch->priv) &&
-		(rb->drawctxt_active == drawctxt))
-		use_preamble = false;
+		(rb->drawctxt_active == drawctxt));
 
 	/*
 	 * In skip mode don't issue the draw IBs but keep all the other
@@ -977,9 +967,50 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 	 * the accounting sane. Set start_index and numibs to 0 to just
 	 * generate the start and end markers and skip everything else
 	 */
-	if (test_bit(CMDBATCH_FLAG_SKIP, &cmdbatch->priv)) {
-		use_preamble = false;
-		numibs = 0;
+	stage->skip = test_bit(CMDBATCH_FLAG_SKIP, &cmdbatch->priv);
+	if (stage->skip)
+		stage->use_preamble = false;
+
+	stage->user_profiling = (cmdbatch->flags & KGSL_CMDBATCH_PROFILING) &&
+		!adreno_is_a3xx(adreno_dev) && profile_buffer;
+
+	stage->kernel_profiling = test_bit(CMDBATCH_FLAG_PROFILE,
+		&cmdbatch->priv);
+
+	stage->yield = gpudev->preemption_yield_enable &&
+		adreno_is_preemption_enabled(adreno_dev);
+}
+
+static bool _stage_valid(struct adreno_ringbuffer_stage *stage,
+		struct adreno_ringbuffer_stage *state)
+{
+	return stage->link != NULL && stage->rb == state->rb &&
+		stage->use_preamble == state->use_preamble &&
+		stage->skip == state->skip &&
+		stage->user_profiling == state->user_profiling &&
+		stage->kernel_profiling == state->kernel_profiling &&
+		stage->yield == state->yield;
+}
+
+/*
+ * _stage_cmds() - Assemble the IBs for a command batch into the staging
+ * buffer according to the decisions already made in @stage
+ */
+static int _stage_cmds(struct adreno_device *adreno_dev,
+		struct kgsl_cmdbatch *cmdbatch,
+		struct adreno_ringbuffer_stage *stage)
+{
+	struct adreno_gpudev *gpudev = ADRENO_GPU_DEVICE(adreno_dev);
+	struct adreno_ringbuffer *rb = stage->rb;
+	struct kgsl_memobj_node *ib;
+	bool use_preamble = stage->use_preamble;
+	unsigned int numibs = 0;
+	unsigned int dwords;
+	unsigned int *cmds;
+
+	if (!stage->skip) {
+		list_for_each_entry(ib, &cmdbatch->cmdlist, node)
+			numibs++;
 	}
 
 	/*
@@ -994,50 +1025,37 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 	/* Each IB takes up 30 dwords in worst case */
 	dwords += (numibs * 30);
 
-	if (cmdbatch->flags & KGSL_CMDBATCH_PROFILING &&
-		!adreno_is_a3xx(adreno_dev) && profile_buffer) {
-		cmdbatch_user_profiling = true;
-
-		/*
-		 * User side profiling uses two IB1s, one before with 4 dwords
-		 * per INDIRECT_BUFFER_PFE call
-		 */
+	/*
+	 * User side profiling uses two IB1s, one before with 4 dwords
+	 * per INDIRECT_BUFFER_PFE call
+	 */
+	if (stage->user_profiling)
 		dwords += 8;
 
-		/*
-		 * we want to use an adreno_submit_time struct to get the
-		 * precise moment when the command is submitted to the
-		 * ringbuffer.  If an upstream caller already passed down a
-		 * pointer piggyback on that otherwise use a local struct
-		 */
-
-		if (time == NULL)
-			time = &local;
-	}
-
-	if (test_bit(CMDBATCH_FLAG_PROFILE, &cmdbatch->priv)) {
-		cmdbatch_kernel_profiling = true;
+	if (stage->kernel_profiling) {
 		dwords += 6;
 		if (adreno_is_a5xx(adreno_dev))
 			dwords += 2;
 	}
 
-	if (gpudev->preemption_yield_enable &&
-				adreno_is_preemption_enabled(adreno_dev))
+	if (stage->yield)
 		dwords += 8;
 
-	link = kzalloc(sizeof(unsigned int) *  dwords, GFP_KERNEL);
-	if (!link) {
-		ret = -ENOMEM;
-		goto done;
-	}
+	if (rb->stage_buf != NULL && dwords <= ADRENO_RB_STAGE_DWORDS)
+		stage->link = rb->stage_buf;
+	else
+		stage->link = kmalloc(sizeof(unsigned int) * dwords,
+			GFP_KERNEL);
+
+	if (stage->link == NULL)
+		return -ENOMEM;
 
-	cmds = link;
+	cmds = stage->link;
 
 	*cmds++ = cp_packet(adreno_dev, CP_NOP, 1);
 	*cmds++ = KGSL_START_OF_IB_IDENTIFIER;
 
-	if (cmdbatch_kernel_profiling) {
+	if (stage->kernel_profiling) {
 		cmds += _get_alwayson_counter(adreno_dev, cmds,
 			adreno_dev->cmdbatch_profile_buffer.gpuaddr +
 			ADRENO_CMDBATCH_PROFILE_OFFSET(cmdbatch->profile_index,
@@ -1048,7 +1066,7 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 	 * Add IB1 to read the GPU ticks at the start of the cmdbatch and
 	 * write it into the appropriate cmdbatch profiling buffer offset
 	 */
-	if (cmdbatch_user_profiling) {
+	if (stage->user_profiling) {
 		cmds += set_user_profiling(adreno_dev, rb, cmds,
 			cmdbatch->profiling_buffer_gpuaddr +
 			offsetof(struct kgsl_cmdbatch_profiling_buffer,
@@ -1076,11 +1094,10 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 		}
 	}
 
-	if (gpudev->preemption_yield_enable &&
-				adreno_is_preemption_enabled(adreno_dev))
+	if (stage->yield)
 		cmds += gpudev->preemption_yield_enable(cmds);
 
-	if (cmdbatch_kernel_profiling) {
+	if (stage->kernel_profiling) {
 		cmds += _get_alwayson_counter(adreno_dev, cmds,
 			adreno_dev->cmdbatch_profile_buffer.gpuaddr +
 			ADRENO_CMDBATCH_PROFILE_OFFSET(cmdbatch->profile_index,
@@ -1091,7 +1108,7 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 	 * Add IB1 to read the GPU ticks at the end of the cmdbatch and
 	 * write it into the appropriate cmdbatch profiling buffer offset
 	 */
-	if (cmdbatch_user_profiling) {
+	if (stage->user_profiling) {
 		cmds += set_user_profiling(adreno_dev, rb, cmds,
 			cmdbatch->profiling_buffer_gpuaddr +
 			offsetof(struct kgsl_cmdbatch_profiling_buffer,
@@ -1101,6 +1118,144 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 	*cmds++ = cp_packet(adreno_dev, CP_NOP, 1);
 	*cmds++ = KGSL_END_OF_IB_IDENTIFIER;
 
+	stage->dwords = cmds - stage->link;
+	return 0;
+}
+
+/**
+ * adreno_ringbuffer_stagecmd() - Assemble the IBs for a command batch ahead
+ * of submission
+ * @adreno_dev: Pointer to an adreno device
+ * @cmdbatch: Command batch that is about to be submitted
+ * @stage: Staging state to fill, passed on to adreno_ringbuffer_submitcmd()
+ *
+ * Build the IB list for @cmdbatch without holding the device mutex so the
+ * only work left under the mutex is the context switch and the copy into the
+ * ringbuffer. The caller must release @stage with
+ * adreno_ringbuffer_unstagecmd() once the command batch has been submitted.
+ */
+int adreno_ringbuffer_stagecmd(struct adreno_device *adreno_dev,
+		struct kgsl_cmdbatch *cmdbatch,
+		struct adreno_ringbuffer_stage *stage)
+{
+	struct adreno_context *drawctxt = ADRENO_CONTEXT(cmdbatch->context);
+
+	memset(stage, 0, sizeof(*stage));
+
+	/*
+	 * A pending SKIP_CMD changes the command batch flags under the mutex
+	 * so there is no point in assembling anything yet
+	 */
+	if (test_bit(ADRENO_CONTEXT_SKIP_CMD, &drawctxt->base.priv))
+		return 0;
+
+	_stage_state(adreno_dev, drawctxt->rb, cmdbatch,
+		cmdbatch->profiling_buf_entry != NULL, stage);
+
+	return _stage_cmds(adreno_dev, cmdbatch, stage);
+}
+
+/**
+ * adreno_ringbuffer_unstagecmd() - Release the buffer for a staged command
+ * batch
+ * @stage: Staging state filled by adreno_ringbuffer_stagecmd()
+ */
+void adreno_ringbuffer_unstagecmd(struct adreno_ringbuffer_stage *stage)
+{
+	if (stage->link != NULL && stage->link != stage->rb->stage_buf)
+		kfree(stage->link);
+
+	stage->link = NULL;
+}
+
+/* adreno_rindbuffer_submitcmd - submit userspace IBs to the GPU */
+int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
+		struct kgsl_cmdbatch *cmdbatch, struct adreno_submit_time *time,
+		struct adreno_ringbuffer_stage *stage)
+{
+	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
+	struct kgsl_memobj_node *ib;
+	unsigned int numibs = 0;
+	struct kgsl_context *context;
+	struct adreno_context *drawctxt;
+	int flags = KGSL_CMD_FLAGS_NONE;
+	int ret;
+	struct adreno_ringbuffer *rb;
+	struct kgsl_cmdbatch_profiling_buffer *profile_buffer = NULL;
+	struct adreno_ringbuffer_stage local_stage = { 0 };
+	struct adreno_ringbuffer_stage state = { 0 };
+	struct adreno_submit_time local;
+
+	struct kgsl_mem_entry *entry = cmdbatch->profiling_buf_entry;
+	if (entry)
+		profile_buffer = kgsl_gpuaddr_to_vaddr(&entry->memdesc,
+					cmdbatch->profiling_buffer_gpuaddr);
+
+	context = cmdbatch->context;
+	drawctxt = ADRENO_CONTEXT(context);
+
+	if (stage == NULL)
+		stage = &local_stage;
+
+	/* Get the total IBs in the list */
+	list_for_each_entry(ib, &cmdbatch->cmdlist, node)
+		numibs++;
+
+	rb = drawctxt->rb;
+
+	/* process any profiling results that are available into the log_buf */
+	adreno_profile_process_results(adreno_dev);
+
+	/*
+	 * If SKIP CMD flag is set for current context
+	 * a) set SKIPCMD as fault_recovery for current commandbatch
+	 * b) store context's commandbatch fault_policy in current
+	 *    commandbatch fault_policy and clear context's commandbatch
+	 *    fault_policy
+	 * c) force preamble for commandbatch
+	 */
+	if (test_bit(ADRENO_CONTEXT_SKIP_CMD, &drawctxt->base.priv) &&
+		(!test_bit(CMDBATCH_FLAG_SKIP, &cmdbatch->priv))) {
+
+		set_bit(KGSL_FT_SKIPCMD, &cmdbatch->fault_recovery);
+		cmdbatch->fault_policy = drawctxt->fault_policy;
+		set_bit(CMDBATCH_FLAG_FORCE_PREAMBLE, &cmdbatch->priv);
+
+		/* if context is detached print fault recovery */
+		adreno_fault_skipcmd_detached(adreno_dev, drawctxt, cmdbatch);
+
+		/* clear the drawctxt flags */
+		clear_bit(ADRENO_CONTEXT_SKIP_CMD, &drawctxt->base.priv);
+		drawctxt->fault_policy = 0;
+	}
+
+	if (test_bit(CMDBATCH_FLAG_SKIP, &cmdbatch->priv))
+		numibs = 0;
+
+	/*
+	 * Check the staged commands against the state under the mutex and
+	 * only assemble them again if something changed since they were built
+	 */
+	_stage_state(adreno_dev, rb, cmdbatch, profile_buffer != NULL, &state);
+
+	if (!_stage_valid(stage, &state)) {
+		adreno_ringbuffer_unstagecmd(stage);
+		*stage = state;
+
+		ret = _stage_cmds(adreno_dev, cmdbatch, stage);
+		if (ret)
+			goto done;
+	}
+
+	/*
+	 * we want to use an adreno_submit_time struct to get the
+	 * precise moment when the command is submitted to the
+	 * ringbuffer.  If an upstream caller already passed down a
+	 * pointer piggyback on that otherwise use a local struct
+	 */
+	if (stage->user_profiling && time == NULL)
+		time = &local;
+
 	/* Context switches commands should *always* be on the GPU */
 	ret = adreno_drawctxt_switch(adreno_dev, rb, drawctxt,
 		ADRENO_CONTEXT_SWITCH_FORCE_GPU);
@@ -1140,7 +1295,7 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 
 
 	ret = adreno_ringbuffer_addcmds(rb, flags,
-					&link[0], (cmds - link),
+					stage->link, stage->dwords,
 					cmdbatch->timestamp, time);
 
 	if (!ret) {
@@ -1148,7 +1303,7 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 		cmdbatch->global_ts = drawctxt->internal_timestamp;
 
 		/* Put the timevalues in the profiling buffer */
-		if (cmdbatch_user_profiling) {
+		if (stage->user_profiling) {
 			/*
 			* Return kernel clock time to the the client
 			* if requested
@@ -1182,7 +1337,7 @@ done:
 			numibs, cmdbatch->timestamp,
 			cmdbatch->flags, ret, drawctxt->type);
 
-	kfree(link);
+	adreno_ringbuffer_unstagecmd(&local_stage);
 	return ret;
 }
 
@@ -34,6 +34,12 @@
  */
 #define KGSL_RB_DWORDS (KGSL_RB_SIZE >> 2)
 
+/*
+ * Size of the per ringbuffer buffer used to assemble command batch IBs before
+ * the device mutex is taken. Larger command batches fall back to kmalloc.
+ */
+#define ADRENO_RB_STAGE_DWORDS (PAGE_SIZE >> 2)
+
 struct kgsl_device;
 struct kgsl_device_private;
 
@@ -50,6 +56,34 @@ struct adreno_submit_time {
 	struct timespec utime;
 };
 
+/**
+ * struct adreno_ringbuffer_stage - Command batch IBs assembled ahead of
+ * submission
+ * @rb: Ringbuffer the commands were assembled for
+ * @link: Buffer holding the assembled commands
+ * @dwords: Number of dwords assembled in @link
+ * @use_preamble: True if the preamble IB was included
+ * @skip: True if the draw IBs were left out
+ * @kernel_profiling: True if kernel side profiling was included
+ * @user_profiling: True if user side profiling was included
+ * @yield: True if the preemption yield packets were included
+ *
+ * The commands are assembled outside of the device mutex based on the state
+ * of the context and ringbuffer at the time. adreno_ringbuffer_submitcmd()
+ * checks the same state again under the mutex and rebuilds the commands if
+ * anything changed in the meantime.
+ */
+struct adreno_ringbuffer_stage {
+	struct adreno_ringbuffer *rb;
+	unsigned int *link;
+	unsigned int dwords;
+	bool use_preamble;
+	bool skip;
+	bool kernel_profiling;
+	bool user_profiling;
+	bool yield;
+};
+
 /**
  * struct adreno_ringbuffer_pagetable_info - Contains fields used during a
  * pagetable switch.
@@ -141,6 +175,12 @@ struct adreno_ringbuffer {
 	 */
 	u32 profile_index;
 	struct timer_list timer;
+	/**
+	 * @stage_buf: Buffer for assembling command batch IBs outside of the
+	 * device mutex. Only the dispatcher submits command batches so one
+	 * buffer per ringbuffer is enough.
+	 */
+	unsigned int *stage_buf;
 };
 
 /* Returns the current ringbuffer */
@@ -153,9 +193,22 @@ int adreno_ringbuffer_issueibcmds(struct kgsl_device_private *dev_priv,
 				struct kgsl_cmdbatch *cmdbatch,
 				uint32_t *timestamp);
 
+int adreno_ringbuffer_issueibcmds_list(struct kgsl_device_private *dev_priv,
+				struct kgsl_context *context,
+				struct kgsl_cmdbatch **cmdbatch,
+				uint32_t *timestamps, unsigned int count,
+				unsigned int *submitted);
+
+int adreno_ringbuffer_stagecmd(struct adreno_device *adreno_dev,
+		struct kgsl_cmdbatch *cmdbatch,
+		struct adreno_ringbuffer_stage *stage);
+
+void adreno_ringbuffer_unstagecmd(struct adreno_ringbuffer_stage *stage);
+
 int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 		struct kgsl_cmdbatch *cmdbatch,
-		struct adreno_submit_time *time);
+		struct adreno_submit_time *time,
+		struct adreno_ringbuffer_stage *stage);
 
 int adreno_ringbuffer_probe(struct adreno_device *adreno_dev, bool nopreempt);
 
@@ -79,6 +79,8 @@ struct kgsl_dma_buf_meta {
 };
 
 static void kgsl_mem_entry_detach_process(struct kgsl_mem_entry *entry);
+static void kgsl_mem_entry_untrack_id(struct kgsl_mem_entry *entry);
+static void kgsl_mem_entry_put_process(struct kgsl_mem_entry *entry);
 
 static const struct file_operations kgsl_fops;
 
@@ -276,22 +278,16 @@ static void kgsl_destroy_ion(struct kgsl_dma_buf_meta *meta)
 }
 #endif
 
-void
-kgsl_mem_entry_destroy(struct kref *kref)
+/*
+ * Release the GPU address and the process reference of a memory entry that
+ * has already been removed from the process idr and free the memory
+ */
+static void _mem_entry_release(struct kgsl_mem_entry *entry)
 {
-	struct kgsl_mem_entry *entry = container_of(kref,
-						    struct kgsl_mem_entry,
-						    refcount);
-	unsigned int memtype;
-
-	if (entry == NULL)
-		return;
-
 	/* pull out the memtype before the flags get cleared */
-	memtype = kgsl_memdesc_usermem_type(&entry->memdesc);
+	unsigned int memtype = kgsl_memdesc_usermem_type(&entry->memdesc);
 
-	/* Detach from process list */
-	kgsl_mem_entry_detach_process(entry);
+	kgsl_mem_entry_put_process(entry);
 
 	if (memtype != KGSL_MEM_ENTRY_KERNEL)
 		atomic_long_sub(entry->memdesc.size,
@@ -334,6 +330,78 @@ kgsl_mem_entry_destroy(struct kref *kref)
 
 	kfree(entry);
 }
+
+/*
+ * Tear down gathered memory entries: unmap all of them, invalidate the TLB
+ * once per pagetable and only then release the GPU addresses and the pages.
+ * Nothing can be reused while a stale TLB entry might still point at it.
+ */
+static void _mem_entry_gather_work(struct work_struct *work)
+{
+	struct llist_node *list = llist_del_all(&kgsl_driver.mem_gather);
+	struct kgsl_mem_entry *entry, *tmp;
+	struct kgsl_pagetable *pagetable = NULL;
+
+	list = llist_reverse_order(list);
+
+	/* Anything that fails here is unmapped the regular way on release */
+	llist_for_each_entry(entry, list, gather)
+		kgsl_mmu_unmap_gather(entry->memdesc.pagetable,
+			&entry->memdesc);
+
+	llist_for_each_entry(entry, list, gather) {
+		if (entry->memdesc.pagetable != pagetable) {
+			pagetable = entry->memdesc.pagetable;
+			kgsl_mmu_flush_tlb(pagetable);
+		}
+	}
+
+	llist_for_each_entry_safe(entry, tmp, list, gather)
+		_mem_entry_release(entry);
+}
+
+/*
+ * Queue a dead memory entry to have its unmap batched with others.  Only
+ * mapped per-process memory on a pagetable that can defer TLB invalidation
+ * qualifies.  The entry is already gone from the process idr so the short
+ * delay is not visible to userspace.
+ */
+static bool kgsl_mem_entry_gather(struct kgsl_mem_entry *entry)
+{
+	struct kgsl_memdesc *memdesc = &entry->memdesc;
+
+	if (kgsl_driver.workqueue == NULL ||
+		!(memdesc->priv & KGSL_MEMDESC_MAPPED) ||
+		kgsl_memdesc_is_global(memdesc) ||
+		kgsl_memdesc_is_secured(memdesc) ||
+		!PT_OP_VALID(memdesc->pagetable, mmu_unmap_gather))
+		return false;
+
+	if (llist_add(&entry->gather, &kgsl_driver.mem_gather))
+		queue_work(kgsl_driver.workqueue,
+			&kgsl_driver.mem_gather_work);
+
+	return true;
+}
+
+void
+kgsl_mem_entry_destroy(struct kref *kref)
+{
+	struct kgsl_mem_entry *entry = container_of(kref,
+						    struct kgsl_mem_entry,
+						    refcount);
+
+	if (entry == NULL)
+		return;
+
+	/* Detach from process list */
+	kgsl_mem_entry_untrack_id(entry);
+
+	if (kgsl_mem_entry_gather(entry))
+		return;
+
+	_mem_entry_release(entry);
+}
 EXPORT_SYMBOL(kgsl_mem_entry_destroy);
 
 /* Allocate a IOVA for memory objects that don't use SVM */
@@ -423,14 +491,11 @@ static int kgsl_mem_entry_attach_process(struct kgsl_device *device,
 	return ret;
 }
 
-/* Detach a memory entry from a process and unmap it from the MMU */
-static void kgsl_mem_entry_detach_process(struct kgsl_mem_entry *entry)
+/* Remove a memory entry from the process idr so it can't be looked up */
+static void kgsl_mem_entry_untrack_id(struct kgsl_mem_entry *entry)
 {
 	unsigned int type;
 
-	if (entry == NULL)
-		return;
-
 	/*
 	 * First remove the entry from mem_idr list
 	 * so that no one can operate on obsolete values
@@ -444,7 +509,11 @@ static void kgsl_mem_entry_detach_process(struct kgsl_mem_entry *entry)
 	entry->priv->stats[type].cur -= entry->memdesc.size;
 
 	spin_unlock(&entry->priv->mem_lock);
+}
 
+/* Unmap a memory entry from the MMU and drop its process reference */
+static void kgsl_mem_entry_put_process(struct kgsl_mem_entry *entry)
+{
 	kgsl_mmu_put_gpuaddr(&entry->memdesc);
 
 	kgsl_process_private_put(entry->priv);
@@ -452,6 +521,16 @@ static void kgsl_mem_entry_detach_process(struct kgsl_mem_entry *entry)
 	entry->priv = NULL;
 }
 
+/* Detach a memory entry from a process and unmap it from the MMU */
+static void kgsl_mem_entry_detach_process(struct kgsl_mem_entry *entry)
+{
+	if (entry == NULL)
+		return;
+
+	kgsl_mem_entry_untrack_id(entry);
+	kgsl_mem_entry_put_process(entry);
+}
+
 /**
  * kgsl_context_dump() - dump information about a draw context
  * @device: KGSL device that owns the context
@@ -1631,23 +1710,16 @@ done:
 	return result;
 }
 
-long kgsl_ioctl_gpu_command(struct kgsl_device_private *dev_priv,
-		unsigned int cmd, void *data)
+/*
+ * Sanity check the flags and counts of a kgsl_gpu_command - the SYNC bit is
+ * supposed to identify a dummy sync object so warn the user if they specified
+ * any IBs with it.  A MARKER command can either have IBs or not but if the
+ * command has 0 IBs it is automatically assumed to be a marker.  If none of
+ * the above make sure that the user specified a sane number of IBs
+ */
+static int _gpu_command_check(struct kgsl_device *device,
+		struct kgsl_gpu_command *param)
 {
-	struct kgsl_gpu_command *param = data;
-	struct kgsl_device *device = dev_priv->device;
-	struct kgsl_context *context;
-	struct kgsl_cmdbatch *cmdbatch = NULL;
-
-	long result = -EINVAL;
-
-	/*
-	 * The SYNC bit is supposed to identify a dummy sync object so warn the
-	 * user if they specified any IBs with it.  A MARKER command can either
-	 * have IBs or not but if the command has 0 IBs it is automatically
-	 * assumed to be a marker.  If none of the above make sure that the user
-	 * specified a sane number of IBs
-	 */
 	if ((param->flags & KGSL_CMDBATCH_SYNC) && param->numcmds)
 		KGSL_DEV_ERR_ONCE(device,
 			"Commands specified with the SYNC flag.  They will be ignored\n");
@@ -1660,42 +1732,74 @@ long kgsl_ioctl_gpu_command(struct kgsl_device_private *dev_priv,
 		param->numsyncs > KGSL_MAX_SYNCPOINTS)
 		return -EINVAL;
 
-	context = kgsl_context_get_owner(dev_priv, param->context_id);
-	if (context == NULL)
-		return -EINVAL;
+	return 0;
+}
+
+/* Build a command batch from a checked kgsl_gpu_command */
+static struct kgsl_cmdbatch *_gpu_command_create(struct kgsl_device *device,
+		struct kgsl_context *context, struct kgsl_gpu_command *param)
+{
+	struct kgsl_cmdbatch *cmdbatch;
+	int ret;
 
 	cmdbatch = kgsl_cmdbatch_create(device, context, param->flags);
-	if (IS_ERR(cmdbatch)) {
-		result = PTR_ERR(cmdbatch);
-		goto done;
-	}
+	if (IS_ERR(cmdbatch))
+		return cmdbatch;
 
-	result = kgsl_cmdbatch_add_cmdlist(device, cmdbatch,
+	ret = kgsl_cmdbatch_add_cmdlist(device, cmdbatch,
 		to_user_ptr(param->cmdlist),
 		param->cmdsize, param->numcmds);
-	if (result)
-		goto done;
+	if (ret)
+		goto err;
 
-	result = kgsl_cmdbatch_add_memlist(device, cmdbatch,
+	ret = kgsl_cmdbatch_add_memlist(device, cmdbatch,
 		to_user_ptr(param->objlist),
 		param->objsize, param->numobjs);
-	if (result)
-		goto done;
+	if (ret)
+		goto err;
 
-	result = kgsl_cmdbatch_add_synclist(device, cmdbatch,
+	ret = kgsl_cmdbatch_add_synclist(device, cmdbatch,
 		to_user_ptr(param->synclist),
 		param->syncsize, param->numsyncs);
-	if (result)
-		goto done;
+	if (ret)
+		goto err;
 
 	/* If no profiling buffer was specified, clear the flag */
 	if (cmdbatch->profiling_buf_entry == NULL)
 		cmdbatch->flags &= ~KGSL_CMDBATCH_PROFILING;
 
+	return cmdbatch;
+err:
+	kgsl_cmdbatch_destroy(cmdbatch);
+	return ERR_PTR(ret);
+}
+
+long kgsl_ioctl_gpu_command(struct kgsl_device_private *dev_priv,
+		unsigned int cmd, void *data)
+{
+	struct kgsl_gpu_command *param = data;
+	struct kgsl_device *device = dev_priv->device;
+	struct kgsl_context *context;
+	struct kgsl_cmdbatch *cmdbatch;
+	long result;
+
+	result = _gpu_command_check(device, param);
+	if (result)
+		return result;
+
+	context = kgsl_context_get_owner(dev_priv, param->context_id);
+	if (context == NULL)
+		return -EINVAL;
+
+	cmdbatch = _gpu_command_create(device, context, param);
+	if (IS_ERR(cmdbatch)) {
+		result = PTR_ERR(cmdbatch);
+		goto done;
+	}
+
 	result = dev_priv->device->ftbl->issueibcmds(dev_priv, context,
 		cmdbatch, &param->timestamp);
 
-done:
 	/*
 	 * -EPROTO is a "success" error - it just tells the user that the
 	 * context had previously faulted
@@ -1703,6 +1807,150 @@ done:
 	if (result && result != -EPROTO)
 		kgsl_cmdbatch_destroy(cmdbatch);
 
+done:
+	kgsl_context_put(context);
+	return result;
+}
+
+/* Queue a list of command batches, one at a time if the device can't batch */
+static int _issueibcmds_list(struct kgsl_device_private *dev_priv,
+		struct kgsl_context *context, struct kgsl_cmdbatch **cmdbatch,
+		uint32_t *timestamps, unsigned int count,
+		unsigned int *submitted)
+{
+	struct kgsl_device *device = dev_priv->device;
+	unsigned int i;
+	int ret = 0;
+
+	if (device->ftbl->issueibcmds_list)
+		return device->ftbl->issueibcmds_list(dev_priv, context,
+			cmdbatch, timestamps, count, submitted);
+
+	for (i = 0; i < count; i++) {
+		ret = device->ftbl->issueibcmds(dev_priv, context,
+			cmdbatch[i], &timestamps[i]);
+		if (ret && ret != -EPROTO)
+			break;
+	}
+
+	*submitted = i;
+	return ret;
+}
+
+long kgsl_ioctl_gpu_command_list(struct kgsl_device_private *dev_priv,
+		unsigned int cmd, void *data)
+{
+	struct kgsl_gpu_command_list *param = data;
+	struct kgsl_device *device = dev_priv->device;
+	struct kgsl_context *context;
+	struct kgsl_gpu_command *cmds;
+	struct kgsl_cmdbatch **cmdbatch;
+	uint32_t *timestamps;
+	void __user *ptr = to_user_ptr(param->cmds);
+	unsigned int i, first, count = 0, submitted = 0;
+	long result;
+
+	if (param->numcmds == 0 || param->numcmds > KGSL_MAX_GPU_COMMANDS ||
+		param->numsyncs > KGSL_MAX_SYNCPOINTS)
+		return -EINVAL;
+
+	context = kgsl_context_get_owner(dev_priv, param->context_id);
+	if (context == NULL)
+		return -EINVAL;
+
+	/* Leave room for the leading SYNC batch with the shared syncpoints */
+	cmds = kcalloc(param->numcmds, sizeof(*cmds), GFP_KERNEL);
+	cmdbatch = kcalloc(param->numcmds + 1, sizeof(*cmdbatch), GFP_KERNEL);
+	timestamps = kcalloc(param->numcmds + 1, sizeof(*timestamps),
+		GFP_KERNEL);
+	if (cmds == NULL || cmdbatch == NULL || timestamps == NULL) {
+		result = -ENOMEM;
+		goto done;
+	}
+
+	/*
+	 * Shared syncpoints go into a SYNC batch queued ahead of the list.
+	 * Commands in a context retire in order so every entry in the list
+	 * ends up waiting for them.
+	 */
+	if (param->numsyncs) {
+		cmdbatch[0] = kgsl_cmdbatch_create(device, context,
+			KGSL_CMDBATCH_SYNC);
+		if (IS_ERR(cmdbatch[0])) {
+			result = PTR_ERR(cmdbatch[0]);
+			goto done;
+		}
+
+		count++;
+
+		result = kgsl_cmdbatch_add_synclist(device, cmdbatch[0],
+			to_user_ptr(param->synclist),
+			param->syncsize, param->numsyncs);
+		if (result)
+			goto done;
+	}
+
+	first = count;
+
+	for (i = 0; i < param->numcmds; i++) {
+		struct kgsl_gpu_command *c = &cmds[i];
+
+		result = _copy_from_user(c, ptr, sizeof(*c), param->cmdsize);
+		if (result)
+			goto done;
+
+		ptr += param->cmdsize;
+
+		if (c->context_id && c->context_id != param->context_id) {
+			result = -EINVAL;
+			goto done;
+		}
+
+		result = _gpu_command_check(device, c);
+		if (result)
+			goto done;
+
+		cmdbatch[count] = _gpu_command_create(device, context, c);
+		if (IS_ERR(cmdbatch[count])) {
+			result = PTR_ERR(cmdbatch[count]);
+			goto done;
+		}
+
+		timestamps[count++] = c->timestamp;
+	}
+
+	result = _issueibcmds_list(dev_priv, context, cmdbatch, timestamps,
+		count, &submitted);
+
+	/*
+	 * Hand the timestamps of everything that was queued back to the user.
+	 * Anything from submitted onwards still belongs to us.
+	 */
+	ptr = to_user_ptr(param->cmds) +
+		offsetof(struct kgsl_gpu_command, timestamp);
+	if (param->cmdsize < offsetofend(struct kgsl_gpu_command, timestamp))
+		ptr = NULL;
+
+	for (i = first; i < submitted; i++) {
+		param->timestamp = timestamps[i];
+
+		if (ptr == NULL)
+			continue;
+
+		if (copy_to_user(ptr, &timestamps[i], sizeof(timestamps[i]))) {
+			result = -EFAULT;
+			ptr = NULL;
+		} else
+			ptr += param->cmdsize;
+	}
+
+done:
+	for (i = submitted; i < count; i++)
+		kgsl_cmdbatch_destroy(cmdbatch[i]);
+
+	kfree(timestamps);
+	kfree(cmdbatch);
+	kfree(cmds);
 	kgsl_context_put(context);
 	return result;
 }
@@ -4375,6 +4623,8 @@ static int __init kgsl_core_init(void)
 	kgsl_driver.mem_workqueue = alloc_workqueue("kgsl-mementry",
 		WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
 
+	INIT_WORK(&kgsl_driver.mem_gather_work, _mem_entry_gather_work);
+
 	init_kthread_worker(&kgsl_driver.worker);
 
 	kgsl_driver.worker_thread = kthread_run(kthread_worker_fn,
@@ -23,6 +23,7 @@
 #include <linux/mutex.h>
 #include <linux/cdev.h>
 #include <linux/regulator/consumer.h>
+#include <linux/llist.h>
 #include <linux/mm.h>
 #include <linux/dma-attrs.h>
 #include <linux/uaccess.h>
@@ -83,6 +84,7 @@ static inline void KGSL_STATS_ADD(uint64_t size, atomic_long_t *stat,
 
 #define KGSL_MAX_NUMIBS 100000
 #define KGSL_MAX_SYNCPOINTS 32
+#define KGSL_MAX_GPU_COMMANDS 32
 
 struct kgsl_device;
 struct kgsl_context;
@@ -105,6 +107,8 @@ struct kgsl_context;
  * @full_cache_threshold: the threshold that triggers a full cache flush
  * @workqueue: Pointer to a single threaded workqueue
  * @mem_workqueue: Pointer to a workqueue for deferring memory entries
+ * @mem_gather: Dead memory entries waiting for a batched unmap
+ * @mem_gather_work: Work item that unmaps and frees the gathered entries
  */
 struct kgsl_driver {
 	struct cdev cdev;
@@ -134,6 +138,8 @@ struct kgsl_driver {
 	unsigned int full_cache_threshold;
 	struct workqueue_struct *workqueue;
 	struct workqueue_struct *mem_workqueue;
+	struct llist_head mem_gather;
+	struct work_struct mem_gather_work;
 	struct kthread_worker worker;
 	struct task_struct *worker_thread;
 };
@@ -242,6 +248,7 @@ struct kgsl_memdesc {
  * @dev_priv: back pointer to the device file that created this entry.
  * @metadata: String containing user specified metadata for the entry
  * @work: Work struct used to schedule a kgsl_mem_entry_put in atomic contexts
+ * @gather: Node in kgsl_driver.mem_gather while waiting for a batched unmap
  */
 struct kgsl_mem_entry {
 	struct kref refcount;
@@ -253,6 +260,7 @@ struct kgsl_mem_entry {
 	int pending_free;
 	char metadata[KGSL_GPUOBJ_ALLOC_METADATA_MAX + 1];
 	struct work_struct work;
+	struct llist_node gather;
 	/*
 	 * @map_count: Count how many vmas this object is mapped in - used for
 	 * debugfs accounting
@@ -299,7 +307,7 @@ typedef int (*readtimestamp_func)(struct kgsl_device *, void *,
  * struct event_group - A list of GPU events
  * @context: Pointer to the active context for the events
  * @lock: Spinlock for protecting the list
- * @events: List of active GPU events
+ * @events: List of active GPU events, sorted by expiry timestamp
  * @group: Node for the master group list
  * @processed: Last processed timestamp
  * @name: String name for the group (for the debugfs file)
@@ -386,6 +394,8 @@ long kgsl_ioctl_gpuobj_sync(struct kgsl_device_private *dev_priv,
 					unsigned int cmd, void *data);
 long kgsl_ioctl_gpu_command(struct kgsl_device_private *dev_priv,
 				unsigned int cmd, void *data);
+long kgsl_ioctl_gpu_command_list(struct kgsl_device_private *dev_priv,
+				unsigned int cmd, void *data);
 long kgsl_ioctl_gpuobj_set_info(struct kgsl_device_private *dev_priv,
 				unsigned int cmd, void *data);
 
@@ -49,6 +49,9 @@
  * @global_ts: The ringbuffer timestamp corresponding to this cmdbatch
  * @timeout_jiffies: For a syncpoint cmdbatch the jiffies at which the
  * timer will expire
+ * @queued_ns: ktime_get_ns() when the cmdbatch was queued on its context
+ * @deadline_ns: ktime_get_ns() by which the cmdbatch should be submitted
+ * @submit_ns: local_clock() when the cmdbatch was written to the ringbuffer
  * This structure defines an atomic batch of command buffers issued from
  * userspace.
  */
@@ -74,6 +77,9 @@ struct kgsl_cmdbatch {
 	uint64_t submit_ticks;
 	unsigned int global_ts;
 	unsigned long timeout_jiffies;
+	u64 queued_ns;
+	u64 deadline_ns;
+	u64 submit_ns;
 };
 
 /**
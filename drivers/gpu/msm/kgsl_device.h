@@ -105,6 +105,25 @@ struct kgsl_power_stats;
 struct kgsl_event;
 struct kgsl_snapshot;
 
+/* Number of IBs remembered from the previous snapshot */
+#define KGSL_SNAPSHOT_IB_DIGESTS 64
+
+/**
+ * struct kgsl_snapshot_ib_digest - An IB captured by an earlier snapshot
+ * @gpuaddr: GPU address of the IB
+ * @ptbase: Pagetable the IB is mapped in
+ * @size: Size of the IB in bytes
+ * @seq: Fault count of the snapshot that holds the IB data
+ * @crc: crc32 of the IB data
+ */
+struct kgsl_snapshot_ib_digest {
+	uint64_t gpuaddr;
+	uint64_t ptbase;
+	uint64_t size;
+	u32 seq;
+	u32 crc;
+};
+
 struct kgsl_functable {
 	/* Mandatory functions - these functions must be implemented
 	   by the client device.  The driver will not check for a NULL
@@ -150,6 +169,10 @@ struct kgsl_functable {
 	void (*drawctxt_destroy) (struct kgsl_context *context);
 	void (*drawctxt_dump) (struct kgsl_device *device,
 		struct kgsl_context *context);
+	int (*issueibcmds_list) (struct kgsl_device_private *dev_priv,
+		struct kgsl_context *context, struct kgsl_cmdbatch **cmdbatch,
+		uint32_t *timestamps, unsigned int count,
+		unsigned int *submitted);
 	long (*ioctl) (struct kgsl_device_private *dev_priv,
 		unsigned int cmd, unsigned long arg);
 	long (*compat_ioctl) (struct kgsl_device_private *dev_priv,
@@ -276,6 +299,11 @@ struct kgsl_device {
 	/* Use CP Crash dumper to get GPU snapshot*/
 	bool snapshot_crashdumper;
 
+	/* Compress frozen objects and skip IBs unchanged since last time */
+	bool snapshot_compress;
+	struct kgsl_snapshot_ib_digest snapshot_ibs[KGSL_SNAPSHOT_IB_DIGESTS];
+	unsigned int snapshot_ib_count;
+
 	struct kobject snapshot_kobj;
 
 	struct kobject ppd_kobj;
@@ -18,6 +18,7 @@
 #include <kgsl_device.h>
 
 #include "kgsl_debugfs.h"
+#include "kgsl_sync.h"
 #include "kgsl_trace.h"
 
 /*
@@ -79,6 +80,7 @@ static void _process_event_group(struct kgsl_device *device,
 	struct kgsl_event *event, *tmp;
 	unsigned int timestamp;
 	struct kgsl_context *context;
+	bool retired = false;
 
 	if (group == NULL)
 		return;
@@ -100,18 +102,32 @@ static void _process_event_group(struct kgsl_device *device,
 	if (!flush && _do_process_group(group->processed, timestamp) == false)
 		goto out;
 
+	/*
+	 * The list is sorted by timestamp so on a normal pass we can stop at
+	 * the first event that hasn't retired yet
+	 */
 	list_for_each_entry_safe(event, tmp, &group->events, node) {
 		if (timestamp_cmp(event->timestamp, timestamp) <= 0)
 			signal_event(device, event, KGSL_EVENT_RETIRED);
 		else if (flush)
 			signal_event(device, event, KGSL_EVENT_CANCELLED);
-
+		else
+			break;
 	}
 
 	group->processed = timestamp;
+	retired = true;
 
 out:
 	spin_unlock(&group->lock);
+
+	/*
+	 * Fences don't need an event of their own - signal everything on the
+	 * context timeline up to the retired timestamp in one go
+	 */
+	if (retired)
+		kgsl_sync_timeline_retire(context, timestamp, flush);
+
 	kgsl_context_put(context);
 }
 
@@ -155,11 +171,18 @@ void kgsl_cancel_events_timestamp(struct kgsl_device *device,
 	spin_lock(&group->lock);
 
 	list_for_each_entry_safe(event, tmp, &group->events, node) {
-		if (timestamp_cmp(timestamp, event->timestamp) == 0)
+		int cmp = timestamp_cmp(timestamp, event->timestamp);
+
+		if (cmp < 0)
+			break;
+
+		if (cmp == 0)
 			signal_event(device, event, KGSL_EVENT_CANCELLED);
 	}
 
 	spin_unlock(&group->lock);
+
+	kgsl_sync_timeline_retire(group->context, timestamp, false);
 }
 EXPORT_SYMBOL(kgsl_cancel_events_timestamp);
 
@@ -179,6 +202,8 @@ void kgsl_cancel_events(struct kgsl_device *device,
 		signal_event(device, event, KGSL_EVENT_CANCELLED);
 
 	spin_unlock(&group->lock);
+
+	kgsl_sync_timeline_retire(group->context, group->processed, true);
 }
 EXPORT_SYMBOL(kgsl_cancel_events);
 
@@ -198,6 +223,9 @@ void kgsl_cancel_event(struct kgsl_device *device,
 	spin_lock(&group->lock);
 
 	list_for_each_entry_safe(event, tmp, &group->events, node) {
+		if (timestamp_cmp(timestamp, event->timestamp) < 0)
+			break;
+
 		if (timestamp == event->timestamp && func == event->func &&
 			event->priv == priv)
 			signal_event(device, event, KGSL_EVENT_CANCELLED);
@@ -223,6 +251,9 @@ bool kgsl_event_pending(struct kgsl_device *device,
 	bool result = false;
 	spin_lock(&group->lock);
 	list_for_each_entry(event, &group->events, node) {
+		if (timestamp_cmp(timestamp, event->timestamp) < 0)
+			break;
+
 		if (timestamp == event->timestamp && func == event->func &&
 			event->priv == priv) {
 			result = true;
@@ -245,7 +276,7 @@ int kgsl_add_event(struct kgsl_device *device, struct kgsl_event_group *group,
 {
 	unsigned int queued;
 	struct kgsl_context *context = group->context;
-	struct kgsl_event *event;
+	struct kgsl_event *event, *pos;
 	unsigned int retired;
 
 	if (!func)
@@ -302,8 +333,17 @@ int kgsl_add_event(struct kgsl_device *device, struct kgsl_event_group *group,
 		return 0;
 	}
 
-	/* Add the event to the group list */
-	list_add_tail(&event->node, &group->events);
+	/*
+	 * Keep the group sorted by timestamp. New events are almost always
+	 * for the newest timestamp so walk backwards from the tail to find
+	 * the insertion point.
+	 */
+	list_for_each_entry_reverse(pos, &group->events, node) {
+		if (timestamp_cmp(pos->timestamp, timestamp) <= 0)
+			break;
+	}
+
+	list_add(&event->node, &pos->node);
 
 	spin_unlock(&group->lock);
 
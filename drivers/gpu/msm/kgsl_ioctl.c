@@ -91,6 +91,8 @@ static const struct kgsl_ioctl kgsl_ioctl_funcs[] = {
 			kgsl_ioctl_gpu_command),
 	KGSL_IOCTL_FUNC(IOCTL_KGSL_GPUOBJ_SET_INFO,
 			kgsl_ioctl_gpuobj_set_info),
+	KGSL_IOCTL_FUNC(IOCTL_KGSL_GPU_COMMAND_LIST,
+			kgsl_ioctl_gpu_command_list),
 };
 
 long kgsl_ioctl_copy_in(unsigned int kernel_cmd, unsigned int user_cmd,
@@ -157,7 +159,8 @@ long kgsl_ioctl(struct file *filep, unsigned int cmd, unsigned long arg)
 	struct adreno_device *adreno_dev = ADRENO_DEVICE(device);
 	long ret;
 
-	if (cmd == IOCTL_KGSL_GPU_COMMAND &&
+	if ((cmd == IOCTL_KGSL_GPU_COMMAND ||
+	     cmd == IOCTL_KGSL_GPU_COMMAND_LIST) &&
 	    READ_ONCE(device->state) != KGSL_STATE_ACTIVE)
 		kgsl_schedule_work(&adreno_dev->pwr_on_work);
 
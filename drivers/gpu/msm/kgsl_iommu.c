@@ -396,8 +396,24 @@ static int _iommu_map_sync_pc(struct kgsl_pagetable *pt,
 	return 0;
 }
 
-static int _iommu_unmap_sync_pc(struct kgsl_pagetable *pt,
-		struct kgsl_memdesc *memdesc, uint64_t addr, uint64_t size)
+/*
+ * Invalidate the TLB for a pagetable that defers invalidation on unmap.
+ * Must be called with the mmu pc sync lock held.
+ */
+static void _iommu_flush_tlb(struct kgsl_iommu_pt *iommu_pt)
+{
+	if (iommu_enable_config_clocks(iommu_pt->domain)) {
+		KGSL_CORE_ERR("unable to enable clocks for tlb invalidate\n");
+		return;
+	}
+
+	iommu_tlbiall(iommu_pt->domain);
+	iommu_disable_config_clocks(iommu_pt->domain);
+}
+
+static int __iommu_unmap_sync_pc(struct kgsl_pagetable *pt,
+		struct kgsl_memdesc *memdesc, uint64_t addr, uint64_t size,
+		bool tlbi)
 {
 	struct kgsl_iommu_pt *iommu_pt = pt->priv;
 	size_t unmapped = 0;
@@ -409,7 +425,14 @@ static int _iommu_unmap_sync_pc(struct kgsl_pagetable *pt,
 
 	_iommu_sync_mmu_pc(true);
 
-	unmapped = iommu_unmap(iommu_pt->domain, addr, size);
+	if (tlbi) {
+		unmapped = iommu_unmap(iommu_pt->domain, addr, size);
+		if (iommu_pt->defer_tlbi && unmapped)
+			_iommu_flush_tlb(iommu_pt);
+	} else {
+		unmapped = iommu_unmap_gather(iommu_pt->domain, addr, size,
+					      &iommu_pt->gather);
+	}
 
 	_iommu_sync_mmu_pc(false);
 
@@ -424,6 +447,12 @@ static int _iommu_unmap_sync_pc(struct kgsl_pagetable *pt,
 	return 0;
 }
 
+static inline int _iommu_unmap_sync_pc(struct kgsl_pagetable *pt,
+		struct kgsl_memdesc *memdesc, uint64_t addr, uint64_t size)
+{
+	return __iommu_unmap_sync_pc(pt, memdesc, addr, size, true);
+}
+
 static int _iommu_map_sg_offset_sync_pc(struct kgsl_pagetable *pt,
 		uint64_t addr, struct kgsl_memdesc *memdesc,
 		struct scatterlist *sg, int nents,
@@ -1295,6 +1324,8 @@ static int _init_per_process_pt(struct kgsl_mmu *mmu, struct kgsl_pagetable *pt)
 	struct kgsl_iommu *iommu = _IOMMU_PRIV(mmu);
 	struct kgsl_iommu_context *ctx = &iommu->ctx[KGSL_IOMMU_CONTEXT_USER];
 	int dynamic = 1;
+	int defer_tlbi = 1;
+	int cont_hint = 1;
 	unsigned int cb_num = ctx->cb_num;
 	int disable_htw = !MMU_FEATURE(mmu, KGSL_MMU_COHERENT_HTW);
 
@@ -1323,6 +1354,17 @@ static int _init_per_process_pt(struct kgsl_mmu *mmu, struct kgsl_pagetable *pt)
 		goto done;
 	}
 
+	/* Batch TLB invalidations on unmap if the IOMMU driver allows it */
+	if (!iommu_domain_set_attr(iommu_pt->domain,
+				DOMAIN_ATTR_DEFER_TLBI, &defer_tlbi)) {
+		iommu_pt->defer_tlbi = true;
+		iommu_iotlb_gather_init(&iommu_pt->gather);
+	}
+
+	/* Let aligned 64K chunks share a TLB entry where supported */
+	iommu_domain_set_attr(iommu_pt->domain,
+				DOMAIN_ATTR_CONT_HINT, &cont_hint);
+
 	iommu_domain_set_attr(iommu_pt->domain,
 				DOMAIN_ATTR_COHERENT_HTW_DISABLE, &disable_htw);
 
@@ -1687,6 +1729,54 @@ kgsl_iommu_unmap(struct kgsl_pagetable *pt, struct kgsl_memdesc *memdesc)
 			size);
 }
 
+/*
+ * kgsl_iommu_unmap_gather() - Unmap a memdesc but leave the TLB alone
+ * @pt: Pagetable to unmap from
+ * @memdesc: Memory descriptor to unmap
+ *
+ * The caller must call kgsl_iommu_flush_tlb() before the GPU address or the
+ * backing pages are reused.  Only supported on pagetables whose domain
+ * accepted DOMAIN_ATTR_DEFER_TLBI.
+ */
+static int
+kgsl_iommu_unmap_gather(struct kgsl_pagetable *pt,
+		struct kgsl_memdesc *memdesc)
+{
+	struct kgsl_iommu_pt *iommu_pt = pt->priv;
+	uint64_t addr = PAGE_ALIGN(memdesc->gpuaddr);
+	uint64_t size = memdesc->size;
+
+	if (!iommu_pt->defer_tlbi || kgsl_memdesc_is_secured(memdesc))
+		return -EOPNOTSUPP;
+
+	if (kgsl_memdesc_has_guard_page(memdesc))
+		size += kgsl_memdesc_guard_page_size(pt->mmu, memdesc);
+
+	if (size == 0 || addr == 0)
+		return 0;
+
+	return __iommu_unmap_sync_pc(pt, memdesc, addr, size, false);
+}
+
+static void kgsl_iommu_flush_tlb(struct kgsl_pagetable *pt)
+{
+	struct kgsl_iommu_pt *iommu_pt = pt->priv;
+
+	if (!iommu_pt->defer_tlbi)
+		return;
+
+	/*
+	 * Invalidate just the ranges gathered since the last flush when the
+	 * driver tracked them, else fall back to dropping the whole ASID.
+	 */
+	_iommu_sync_mmu_pc(true);
+	if (iommu_pt->gather.size)
+		iommu_iotlb_sync(iommu_pt->domain, &iommu_pt->gather);
+	else
+		_iommu_flush_tlb(iommu_pt);
+	_iommu_sync_mmu_pc(false);
+}
+
 /**
  * _iommu_map_guard_page - Map iommu guard page
  * @pt - Pointer to kgsl pagetable structure
@@ -2593,6 +2683,8 @@ struct kgsl_mmu_ops kgsl_iommu_ops = {
 static struct kgsl_mmu_pt_ops iommu_pt_ops = {
 	.mmu_map = kgsl_iommu_map,
 	.mmu_unmap = kgsl_iommu_unmap,
+	.mmu_unmap_gather = kgsl_iommu_unmap_gather,
+	.mmu_flush_tlb = kgsl_iommu_flush_tlb,
 	.mmu_destroy_pagetable = kgsl_iommu_destroy_pagetable,
 	.get_ttbr0 = kgsl_iommu_get_ttbr0,
 	.get_contextidr = kgsl_iommu_get_contextidr,
@@ -152,6 +152,8 @@ struct kgsl_iommu {
  * @ttbr0: register value to set when using this pagetable
  * @contextidr: register value to set when using this pagetable
  * @attached: is the pagetable attached?
+ * @defer_tlbi: the IOMMU driver leaves TLB invalidation on unmap to us
+ * @gather: ranges unmapped but not yet invalidated in deferred mode
  * @rbtree: all buffers mapped into the pagetable, indexed by gpuaddr
  * @va_start: Start of virtual range used in this pagetable.
  * @va_end: End of virtual range.
@@ -166,6 +168,8 @@ struct kgsl_iommu_pt {
 	u64 ttbr0;
 	u32 contextidr;
 	bool attached;
+	bool defer_tlbi;
+	struct iommu_iotlb_gather gather;
 
 	struct rb_root rbtree;
 
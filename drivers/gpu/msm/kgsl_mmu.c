@@ -517,6 +517,54 @@ kgsl_mmu_unmap(struct kgsl_pagetable *pagetable,
 }
 EXPORT_SYMBOL(kgsl_mmu_unmap);
 
+/**
+ * kgsl_mmu_unmap_gather() - Unmap a memdesc without invalidating the TLB
+ * @pagetable: Pagetable to unmap from
+ * @memdesc: Memory descriptor to unmap
+ *
+ * Return 0 if the memory was unmapped.  The caller must then call
+ * kgsl_mmu_flush_tlb() on the pagetable before the GPU address is put or the
+ * pages are freed.  On error nothing was unmapped and the memdesc is left for
+ * the regular unmap path.
+ */
+int kgsl_mmu_unmap_gather(struct kgsl_pagetable *pagetable,
+		struct kgsl_memdesc *memdesc)
+{
+	int ret;
+
+	if (memdesc->size == 0 || memdesc->gpuaddr == 0 ||
+		!(KGSL_MEMDESC_MAPPED & memdesc->priv) ||
+		kgsl_memdesc_is_global(memdesc))
+		return -EINVAL;
+
+	if (!PT_OP_VALID(pagetable, mmu_unmap_gather))
+		return -EOPNOTSUPP;
+
+	ret = pagetable->pt_ops->mmu_unmap_gather(pagetable, memdesc);
+	if (ret)
+		return ret;
+
+	atomic_dec(&pagetable->stats.entries);
+	atomic_long_sub(kgsl_memdesc_footprint(memdesc),
+		&pagetable->stats.mapped);
+
+	memdesc->priv &= ~KGSL_MEMDESC_MAPPED;
+
+	return 0;
+}
+EXPORT_SYMBOL(kgsl_mmu_unmap_gather);
+
+/**
+ * kgsl_mmu_flush_tlb() - Invalidate the TLB after gathered unmaps
+ * @pagetable: Pagetable to invalidate
+ */
+void kgsl_mmu_flush_tlb(struct kgsl_pagetable *pagetable)
+{
+	if (PT_OP_VALID(pagetable, mmu_flush_tlb))
+		pagetable->pt_ops->mmu_flush_tlb(pagetable);
+}
+EXPORT_SYMBOL(kgsl_mmu_flush_tlb);
+
 int kgsl_mmu_map_offset(struct kgsl_pagetable *pagetable,
 			uint64_t virtaddr, uint64_t virtoffset,
 			struct kgsl_memdesc *memdesc, uint64_t physoffset,
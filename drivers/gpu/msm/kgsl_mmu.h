@@ -88,6 +88,9 @@ struct kgsl_mmu_pt_ops {
 			struct kgsl_memdesc *memdesc);
 	int (*mmu_unmap)(struct kgsl_pagetable *pt,
 			struct kgsl_memdesc *memdesc);
+	int (*mmu_unmap_gather)(struct kgsl_pagetable *pt,
+			struct kgsl_memdesc *memdesc);
+	void (*mmu_flush_tlb)(struct kgsl_pagetable *pt);
 	void (*mmu_destroy_pagetable) (struct kgsl_pagetable *);
 	u64 (*get_ttbr0)(struct kgsl_pagetable *);
 	u32 (*get_contextidr)(struct kgsl_pagetable *);
@@ -181,6 +184,9 @@ int kgsl_mmu_map(struct kgsl_pagetable *pagetable,
 int kgsl_mmu_unmap(struct kgsl_pagetable *pagetable,
 		    struct kgsl_memdesc *memdesc);
 void kgsl_mmu_put_gpuaddr(struct kgsl_memdesc *memdesc);
+int kgsl_mmu_unmap_gather(struct kgsl_pagetable *pagetable,
+		struct kgsl_memdesc *memdesc);
+void kgsl_mmu_flush_tlb(struct kgsl_pagetable *pagetable);
 unsigned int kgsl_virtaddr_to_physaddr(void *virtaddr);
 unsigned int kgsl_mmu_log_fault_addr(struct kgsl_mmu *mmu,
 		u64 ttbr0, uint64_t addr);
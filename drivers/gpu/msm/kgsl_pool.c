@@ -16,6 +16,8 @@
 #include <linux/slab.h>
 #include <linux/highmem.h>
 #include <linux/version.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
 
 #include "kgsl.h"
 #include "kgsl_device.h"
@@ -25,29 +27,53 @@
 #define KGSL_MAX_POOL_ORDER 8
 #define KGSL_MAX_RESERVED_PAGES 4096
 
+/* How long the prefill backs off after the shrinker has taken pages */
+#define KGSL_POOL_PREFILL_BACKOFF (10 * HZ)
+
 /**
  * struct kgsl_page_pool - Structure to hold information for the pool
  * @pool_order: Page order describing the size of the page
- * @page_count: Number of pages currently present in the pool
+ * @page_count: Number of zeroed pages currently present in the pool
+ * @dirty_count: Number of freed pages waiting to be zeroed
  * @reserved_pages: Number of pages reserved at init for the pool
+ * @low_watermark: Number of zeroed pages the pool worker keeps on hand
  * @allocation_allowed: Tells if reserved pool gets exhausted, can we allocate
  * from system memory
- * @list_lock: Spinlock for page list in the pool
- * @page_list: List of pages held/reserved in this pool
+ * @list_lock: Spinlock for page lists in the pool
+ * @page_list: List of zeroed pages held/reserved in this pool
+ * @dirty_list: List of freed pages not yet zeroed
+ * @hits: Allocations served from the pool
+ * @misses: Allocations that fell back to the system
+ * @zero_ns: Time spent zeroing pages in the allocation path
+ * @bg_zero_ns: Time spent zeroing pages in the pool worker
+ * @kobj: Kobject for the pool's sysfs directory
  */
 struct kgsl_page_pool {
 	unsigned int pool_order;
 	int page_count;
+	int dirty_count;
 	unsigned int reserved_pages;
+	unsigned int low_watermark;
 	bool allocation_allowed;
 	spinlock_t list_lock;
 	struct list_head page_list;
+	struct list_head dirty_list;
+	atomic_long_t hits;
+	atomic_long_t misses;
+	atomic64_t zero_ns;
+	atomic64_t bg_zero_ns;
+	struct kobject kobj;
 };
 
 static struct kgsl_page_pool kgsl_pools[KGSL_MAX_POOLS];
 static int kgsl_num_pools;
 static int kgsl_pool_max_pages;
 
+static struct workqueue_struct *kgsl_pool_wq;
+static struct work_struct kgsl_pool_work;
+static unsigned long kgsl_pool_prefill_resume = INITIAL_JIFFIES;
+static struct kobject *kgsl_pool_kobj;
+
 
 /* Returns KGSL pool corresponding to input page order*/
 static struct kgsl_page_pool *
@@ -79,19 +105,54 @@ _kgsl_pool_zero_page(struct page *p, unsigned int pool_order)
 	}
 }
 
-/* Add a page to specified pool */
+/* Zero the page and account the time against the pool */
 static void
-_kgsl_pool_add_page(struct kgsl_page_pool *pool, struct page *p)
+_kgsl_pool_zero_page_timed(struct kgsl_page_pool *pool, struct page *p,
+		atomic64_t *counter)
 {
+	u64 start = ktime_get_ns();
+
 	_kgsl_pool_zero_page(p, pool->pool_order);
+	atomic64_add(ktime_get_ns() - start, counter);
+}
 
+/* Add a zeroed page to specified pool */
+static void
+_kgsl_pool_add_clean_page(struct kgsl_page_pool *pool, struct page *p)
+{
 	spin_lock(&pool->list_lock);
 	list_add_tail(&p->lru, &pool->page_list);
 	pool->page_count++;
 	spin_unlock(&pool->list_lock);
 }
 
-/* Returns a page from specified pool */
+/* Zero a page and add it to specified pool */
+static void
+_kgsl_pool_add_page(struct kgsl_page_pool *pool, struct page *p)
+{
+	_kgsl_pool_zero_page(p, pool->pool_order);
+	_kgsl_pool_add_clean_page(pool, p);
+}
+
+/* Queue a freed page on specified pool for the worker to zero */
+static void
+_kgsl_pool_add_dirty_page(struct kgsl_page_pool *pool, struct page *p)
+{
+	/* No worker once the pools are being torn down */
+	if (kgsl_pool_wq == NULL) {
+		_kgsl_pool_add_page(pool, p);
+		return;
+	}
+
+	spin_lock(&pool->list_lock);
+	list_add_tail(&p->lru, &pool->dirty_list);
+	pool->dirty_count++;
+	spin_unlock(&pool->list_lock);
+
+	queue_work(kgsl_pool_wq, &kgsl_pool_work);
+}
+
+/* Returns a zeroed page from specified pool */
 static struct page *
 _kgsl_pool_get_page(struct kgsl_page_pool *pool)
 {
@@ -108,14 +169,32 @@ _kgsl_pool_get_page(struct kgsl_page_pool *pool)
 	return p;
 }
 
-/* Returns the number of pages in specified pool */
+/* Returns a page from specified pool that has not been zeroed yet */
+static struct page *
+_kgsl_pool_get_dirty_page(struct kgsl_page_pool *pool)
+{
+	struct page *p = NULL;
+
+	spin_lock(&pool->list_lock);
+	if (pool->dirty_count) {
+		p = list_first_entry(&pool->dirty_list, struct page, lru);
+		pool->dirty_count--;
+		list_del(&p->lru);
+	}
+	spin_unlock(&pool->list_lock);
+
+	return p;
+}
+
+/* Returns the number of pages, zeroed or not, in specified pool */
 static int
 kgsl_pool_size(struct kgsl_page_pool *kgsl_pool)
 {
 	int size;
 
 	spin_lock(&kgsl_pool->list_lock);
-	size = kgsl_pool->page_count * (1 << kgsl_pool->pool_order);
+	size = (kgsl_pool->page_count + kgsl_pool->dirty_count) *
+		(1 << kgsl_pool->pool_order);
 	spin_unlock(&kgsl_pool->list_lock);
 
 	return size;
@@ -146,7 +225,11 @@ _kgsl_pool_shrink(struct kgsl_page_pool *pool, int num_pages)
 		return pcount;
 
 	for (j = 0; j < num_pages >> pool->pool_order; j++) {
-		struct page *page = _kgsl_pool_get_page(pool);
+		/* Pages still waiting to be zeroed are the cheapest to drop */
+		struct page *page = _kgsl_pool_get_dirty_page(pool);
+
+		if (page == NULL)
+			page = _kgsl_pool_get_page(pool);
 
 		if (page != NULL) {
 			__free_pages(page, pool->pool_order);
@@ -357,6 +440,22 @@ int kgsl_pool_alloc_page(int *page_size, struct page **pages,
 	pool_idx = kgsl_pool_idx_lookup(order);
 	page = _kgsl_pool_get_page(pool);
 
+	/* Take a freed page the worker has not got to yet and zero it here */
+	if (page == NULL) {
+		page = _kgsl_pool_get_dirty_page(pool);
+		if (page)
+			_kgsl_pool_zero_page_timed(pool, page, &pool->zero_ns);
+	}
+
+	if (page != NULL)
+		atomic_long_inc(&pool->hits);
+	else
+		atomic_long_inc(&pool->misses);
+
+	/* Let the worker top the pool back up */
+	if (kgsl_pool_wq && pool->page_count < pool->low_watermark)
+		queue_work(kgsl_pool_wq, &kgsl_pool_work);
+
 	/* Allocate a new page if not allocated from pool */
 	if (page == NULL) {
 		gfp_t gfp_mask = kgsl_gfp_mask(order);
@@ -380,7 +479,7 @@ int kgsl_pool_alloc_page(int *page_size, struct page **pages,
 				return -ENOMEM;
 		}
 
-		_kgsl_pool_zero_page(page, order);
+		_kgsl_pool_zero_page_timed(pool, page, &pool->zero_ns);
 	}
 
 done:
@@ -413,7 +512,7 @@ void kgsl_pool_free_page(struct page *page)
 			(kgsl_pool_size_total() < kgsl_pool_max_pages)) {
 		pool = _kgsl_get_pool_from_order(page_order);
 		if (pool != NULL) {
-			_kgsl_pool_add_page(pool, page);
+			_kgsl_pool_add_dirty_page(pool, page);
 			return;
 		}
 	}
@@ -458,6 +557,72 @@ static void kgsl_pool_reserve_pages(void)
 	}
 }
 
+/* Zero one freed page from specified pool, returns false if none is left */
+static bool kgsl_pool_zero_one(struct kgsl_page_pool *pool)
+{
+	struct page *page = _kgsl_pool_get_dirty_page(pool);
+
+	if (page == NULL)
+		return false;
+
+	_kgsl_pool_zero_page_timed(pool, page, &pool->bg_zero_ns);
+	_kgsl_pool_add_clean_page(pool, page);
+	return true;
+}
+
+/*
+ * Add one newly allocated, zeroed page to specified pool if it is below its
+ * low watermark. The allocation never enters direct reclaim or wakes kswapd,
+ * and returns false once the pool is full or memory is tight.
+ */
+static bool kgsl_pool_prefill_one(struct kgsl_page_pool *pool)
+{
+	gfp_t gfp_mask;
+	struct page *page;
+
+	if (pool->page_count >= pool->low_watermark ||
+			time_before(jiffies, kgsl_pool_prefill_resume))
+		return false;
+
+	if (kgsl_pool_max_pages &&
+			kgsl_pool_size_total() >= kgsl_pool_max_pages)
+		return false;
+
+	gfp_mask = (kgsl_gfp_mask(pool->pool_order) & ~__GFP_WAIT) |
+		__GFP_NORETRY | __GFP_NO_KSWAPD | __GFP_NOWARN;
+	page = alloc_pages(gfp_mask, pool->pool_order);
+	if (page == NULL)
+		return false;
+
+	_kgsl_pool_zero_page_timed(pool, page, &pool->bg_zero_ns);
+	_kgsl_pool_add_clean_page(pool, page);
+	return true;
+}
+
+/*
+ * Zero the pages freed back to the pools, then top each pool up to its low
+ * watermark, so that allocations find zeroed, flushed pages waiting.
+ */
+static void kgsl_pool_worker(struct work_struct *work)
+{
+	bool progress;
+	int i;
+
+	do {
+		progress = false;
+		for (i = 0; i < kgsl_num_pools; i++)
+			progress |= kgsl_pool_zero_one(&kgsl_pools[i]);
+		cond_resched();
+	} while (progress);
+
+	do {
+		progress = false;
+		for (i = 0; i < kgsl_num_pools; i++)
+			progress |= kgsl_pool_prefill_one(&kgsl_pools[i]);
+		cond_resched();
+	} while (progress);
+}
+
 /* Functions for the shrinker */
 
 static unsigned long
@@ -468,6 +633,9 @@ kgsl_pool_shrink_scan_objects(struct shrinker *shrinker,
 	int nr = sc->nr_to_scan;
 	int total_pages = kgsl_pool_size_total();
 
+	/* Memory is tight: keep the worker from refilling for a while */
+	kgsl_pool_prefill_resume = jiffies + KGSL_POOL_PREFILL_BACKOFF;
+
 	/* Target pages represents new  pool size */
 	int target_pages = (nr > total_pages) ? 0 : (total_pages - nr);
 
@@ -492,7 +660,7 @@ static struct shrinker kgsl_pool_shrinker = {
 };
 
 static void kgsl_pool_config(unsigned int order, unsigned int reserved_pages,
-		bool allocation_allowed)
+		unsigned int low_watermark, bool allocation_allowed)
 {
 #ifdef CONFIG_ALLOC_BUFFERS_IN_4K_CHUNKS
 	if (order > 0) {
@@ -506,9 +674,12 @@ static void kgsl_pool_config(unsigned int order, unsigned int reserved_pages,
 
 	kgsl_pools[kgsl_num_pools].pool_order = order;
 	kgsl_pools[kgsl_num_pools].reserved_pages = reserved_pages;
+	kgsl_pools[kgsl_num_pools].low_watermark =
+		min_t(unsigned int, low_watermark, KGSL_MAX_RESERVED_PAGES);
 	kgsl_pools[kgsl_num_pools].allocation_allowed = allocation_allowed;
 	spin_lock_init(&kgsl_pools[kgsl_num_pools].list_lock);
 	INIT_LIST_HEAD(&kgsl_pools[kgsl_num_pools].page_list);
+	INIT_LIST_HEAD(&kgsl_pools[kgsl_num_pools].dirty_list);
 	kgsl_num_pools++;
 }
 
@@ -520,6 +691,7 @@ static void kgsl_of_parse_mempools(struct device_node *node)
 
 	for_each_child_of_node(node, child) {
 		unsigned int index;
+		unsigned int low_watermark = 0;
 
 		if (of_property_read_u32(child, "reg", &index))
 			return;
@@ -537,8 +709,14 @@ static void kgsl_of_parse_mempools(struct device_node *node)
 		allocation_allowed = of_property_read_bool(child,
 				"qcom,mempool-allocate");
 
+		/* Pools that cannot grow have nothing to prefill with */
+		if (allocation_allowed)
+			of_property_read_u32(child,
+					"qcom,mempool-low-watermark",
+					&low_watermark);
+
 		kgsl_pool_config(ilog2(page_size >> PAGE_SHIFT), reserved_pages,
-				allocation_allowed);
+				low_watermark, allocation_allowed);
 	}
 }
 
@@ -555,6 +733,169 @@ static void kgsl_of_get_mempools(struct device_node *parent)
 	}
 }
 
+/* sysfs: /sys/class/kgsl/kgsl/mempools/pool<order>/ */
+
+struct kgsl_pool_attribute {
+	struct attribute attr;
+	ssize_t (*show)(struct kgsl_page_pool *pool, char *buf);
+	ssize_t (*store)(struct kgsl_page_pool *pool, const char *buf,
+			size_t count);
+};
+
+#define to_pool_attr(a) \
+container_of(a, struct kgsl_pool_attribute, attr)
+
+#define POOL_ATTR(_name, _mode, _show, _store) \
+static struct kgsl_pool_attribute pool_attr_##_name = \
+	__ATTR(_name, _mode, _show, _store)
+
+static ssize_t pool_page_count_show(struct kgsl_page_pool *pool, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%d\n", pool->page_count);
+}
+
+static ssize_t pool_dirty_count_show(struct kgsl_page_pool *pool, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%d\n", pool->dirty_count);
+}
+
+static ssize_t pool_hits_show(struct kgsl_page_pool *pool, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%ld\n",
+			atomic_long_read(&pool->hits));
+}
+
+static ssize_t pool_misses_show(struct kgsl_page_pool *pool, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%ld\n",
+			atomic_long_read(&pool->misses));
+}
+
+static ssize_t pool_zero_us_show(struct kgsl_page_pool *pool, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%llu\n",
+			div_u64(atomic64_read(&pool->zero_ns), NSEC_PER_USEC));
+}
+
+static ssize_t pool_bg_zero_us_show(struct kgsl_page_pool *pool, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%llu\n",
+		div_u64(atomic64_read(&pool->bg_zero_ns), NSEC_PER_USEC));
+}
+
+static ssize_t pool_low_watermark_show(struct kgsl_page_pool *pool,
+		char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", pool->low_watermark);
+}
+
+static ssize_t pool_low_watermark_store(struct kgsl_page_pool *pool,
+		const char *buf, size_t count)
+{
+	unsigned int val;
+	int ret;
+
+	ret = kgsl_sysfs_store(buf, &val);
+	if (ret)
+		return ret;
+
+	if (!pool->allocation_allowed || val > KGSL_MAX_RESERVED_PAGES)
+		return -EINVAL;
+
+	pool->low_watermark = val;
+	queue_work(kgsl_pool_wq, &kgsl_pool_work);
+	return count;
+}
+
+POOL_ATTR(page_count, 0444, pool_page_count_show, NULL);
+POOL_ATTR(dirty_count, 0444, pool_dirty_count_show, NULL);
+POOL_ATTR(hits, 0444, pool_hits_show, NULL);
+POOL_ATTR(misses, 0444, pool_misses_show, NULL);
+POOL_ATTR(zero_us, 0444, pool_zero_us_show, NULL);
+POOL_ATTR(bg_zero_us, 0444, pool_bg_zero_us_show, NULL);
+POOL_ATTR(low_watermark, 0644, pool_low_watermark_show,
+		pool_low_watermark_store);
+
+static struct attribute *pool_attrs[] = {
+	&pool_attr_page_count.attr,
+	&pool_attr_dirty_count.attr,
+	&pool_attr_hits.attr,
+	&pool_attr_misses.attr,
+	&pool_attr_zero_us.attr,
+	&pool_attr_bg_zero_us.attr,
+	&pool_attr_low_watermark.attr,
+	NULL,
+};
+
+static ssize_t pool_sysfs_show(struct kobject *kobj,
+		struct attribute *attr, char *buf)
+{
+	struct kgsl_pool_attribute *pattr = to_pool_attr(attr);
+	struct kgsl_page_pool *pool =
+		container_of(kobj, struct kgsl_page_pool, kobj);
+
+	return pattr->show ? pattr->show(pool, buf) : -EIO;
+}
+
+static ssize_t pool_sysfs_store(struct kobject *kobj,
+		struct attribute *attr, const char *buf, size_t count)
+{
+	struct kgsl_pool_attribute *pattr = to_pool_attr(attr);
+	struct kgsl_page_pool *pool =
+		container_of(kobj, struct kgsl_page_pool, kobj);
+
+	return pattr->store ? pattr->store(pool, buf, count) : -EIO;
+}
+
+static const struct sysfs_ops pool_sysfs_ops = {
+	.show = pool_sysfs_show,
+	.store = pool_sysfs_store,
+};
+
+/* The pools are static, there is nothing to free */
+static void pool_kobj_release(struct kobject *kobj)
+{
+}
+
+static struct kobj_type ktype_kgsl_pool = {
+	.sysfs_ops = &pool_sysfs_ops,
+	.default_attrs = pool_attrs,
+	.release = pool_kobj_release,
+};
+
+static void kgsl_pool_init_sysfs(void)
+{
+	int i;
+
+	kgsl_pool_kobj = kobject_create_and_add("mempools",
+			&kgsl_driver.virtdev.kobj);
+	if (kgsl_pool_kobj == NULL) {
+		WARN(1, "Unable to add sysfs dir 'mempools'\n");
+		return;
+	}
+
+	for (i = 0; i < kgsl_num_pools; i++) {
+		if (kobject_init_and_add(&kgsl_pools[i].kobj,
+				&ktype_kgsl_pool, kgsl_pool_kobj, "pool%u",
+				kgsl_pools[i].pool_order))
+			WARN(1, "Unable to add sysfs dir 'pool%u'\n",
+					kgsl_pools[i].pool_order);
+	}
+}
+
+static void kgsl_pool_uninit_sysfs(void)
+{
+	int i;
+
+	if (kgsl_pool_kobj == NULL)
+		return;
+
+	for (i = 0; i < kgsl_num_pools; i++)
+		kobject_put(&kgsl_pools[i].kobj);
+	kobject_put(kgsl_pool_kobj);
+	kgsl_pool_kobj = NULL;
+}
+
 void kgsl_init_page_pools(struct platform_device *pdev)
 {
 
@@ -564,12 +905,31 @@ void kgsl_init_page_pools(struct platform_device *pdev)
 	/* Reserve the appropriate number of pages for each pool */
 	kgsl_pool_reserve_pages();
 
+	/* Freed pages are zeroed and pools refilled in the background */
+	INIT_WORK(&kgsl_pool_work, kgsl_pool_worker);
+	kgsl_pool_wq = alloc_workqueue("kgsl-pool",
+			WQ_UNBOUND | WQ_FREEZABLE, 1);
+	if (kgsl_pool_wq == NULL)
+		kgsl_pool_wq = system_unbound_wq;
+	else
+		queue_work(kgsl_pool_wq, &kgsl_pool_work);
+
+	kgsl_pool_init_sysfs();
+
 	/* Initialize shrinker */
 	register_shrinker(&kgsl_pool_shrinker);
 }
 
 void kgsl_exit_page_pools(void)
 {
+	kgsl_pool_uninit_sysfs();
+
+	/* Stop the background worker before tearing the pools down */
+	cancel_work_sync(&kgsl_pool_work);
+	if (kgsl_pool_wq != system_unbound_wq)
+		destroy_workqueue(kgsl_pool_wq);
+	kgsl_pool_wq = NULL;
+
 	/* Release all pages in pools, if any.*/
 	kgsl_pool_reduce(0, true);
 
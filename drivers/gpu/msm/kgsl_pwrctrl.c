@@ -244,6 +244,9 @@ void kgsl_pwrctrl_buslevel_update(struct kgsl_device *device,
 	/* ask a governor to vote on behalf of us */
 	if (pwr->devbw)
 		devfreq_vbif_update_bw(ib_votes[last_vote_buslevel], ab);
+
+	/* let the DDR governor know before the traffic shows up */
+	bw_hwmon_set_floor(BW_HWMON_FLOOR_KGSL, ab);
 }
 EXPORT_SYMBOL(kgsl_pwrctrl_buslevel_update);
 
@@ -1207,6 +1210,119 @@ static ssize_t kgsl_pwrctrl_pwrscale_show(struct device *dev,
 	return snprintf(buf, PAGE_SIZE, "%u\n", psc->enabled);
 }
 
+static ssize_t kgsl_pwrctrl_frame_dcvs_store(struct device *dev,
+					   struct device_attribute *attr,
+					   const char *buf, size_t count)
+{
+	struct kgsl_device *device = kgsl_device_from_dev(dev);
+	struct kgsl_pwrscale_frame *frame;
+	unsigned int enable = 0;
+	unsigned long flags;
+	int ret;
+
+	if (device == NULL)
+		return 0;
+	frame = &device->pwrscale.frame;
+
+	ret = kgsl_sysfs_store(buf, &enable);
+	if (ret)
+		return ret;
+
+	/* Drop any old prediction so it can't outlive the mode switch */
+	spin_lock_irqsave(&frame->lock, flags);
+	frame->enabled = enable ? true : false;
+	frame->cycles = 0;
+	frame->time_ns = 0;
+	spin_unlock_irqrestore(&frame->lock, flags);
+
+	return count;
+}
+
+static ssize_t kgsl_pwrctrl_frame_dcvs_show(struct device *dev,
+					  struct device_attribute *attr,
+					  char *buf)
+{
+	struct kgsl_device *device = kgsl_device_from_dev(dev);
+
+	if (device == NULL)
+		return 0;
+
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+		device->pwrscale.frame.enabled);
+}
+
+static ssize_t kgsl_pwrctrl_frame_vsync_us_store(struct device *dev,
+					   struct device_attribute *attr,
+					   const char *buf, size_t count)
+{
+	struct kgsl_device *device = kgsl_device_from_dev(dev);
+	unsigned int val = 0;
+	int ret;
+
+	if (device == NULL)
+		return 0;
+
+	ret = kgsl_sysfs_store(buf, &val);
+	if (ret)
+		return ret;
+
+	if (val == 0)
+		return -EINVAL;
+
+	device->pwrscale.frame.vsync_us = val;
+
+	return count;
+}
+
+static ssize_t kgsl_pwrctrl_frame_vsync_us_show(struct device *dev,
+					  struct device_attribute *attr,
+					  char *buf)
+{
+	struct kgsl_device *device = kgsl_device_from_dev(dev);
+
+	if (device == NULL)
+		return 0;
+
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+		device->pwrscale.frame.vsync_us);
+}
+
+static ssize_t kgsl_pwrctrl_frame_target_store(struct device *dev,
+					   struct device_attribute *attr,
+					   const char *buf, size_t count)
+{
+	struct kgsl_device *device = kgsl_device_from_dev(dev);
+	unsigned int val = 0;
+	int ret;
+
+	if (device == NULL)
+		return 0;
+
+	ret = kgsl_sysfs_store(buf, &val);
+	if (ret)
+		return ret;
+
+	if (val == 0 || val > 100)
+		return -EINVAL;
+
+	device->pwrscale.frame.target = val;
+
+	return count;
+}
+
+static ssize_t kgsl_pwrctrl_frame_target_show(struct device *dev,
+					  struct device_attribute *attr,
+					  char *buf)
+{
+	struct kgsl_device *device = kgsl_device_from_dev(dev);
+
+	if (device == NULL)
+		return 0;
+
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+		device->pwrscale.frame.target);
+}
+
 static ssize_t kgsl_pwrctrl_gpu_model_show(struct device *dev,
 					struct device_attribute *attr,
 					char *buf)
@@ -1454,6 +1570,15 @@ static DEVICE_ATTR(force_non_retention_on, 0644,
 static DEVICE_ATTR(pwrscale, 0644,
 	kgsl_pwrctrl_pwrscale_show,
 	kgsl_pwrctrl_pwrscale_store);
+static DEVICE_ATTR(frame_dcvs, 0644,
+	kgsl_pwrctrl_frame_dcvs_show,
+	kgsl_pwrctrl_frame_dcvs_store);
+static DEVICE_ATTR(frame_vsync_us, 0644,
+	kgsl_pwrctrl_frame_vsync_us_show,
+	kgsl_pwrctrl_frame_vsync_us_store);
+static DEVICE_ATTR(frame_target, 0644,
+	kgsl_pwrctrl_frame_target_show,
+	kgsl_pwrctrl_frame_target_store);
 static DEVICE_ATTR(gpu_model, 0444, kgsl_pwrctrl_gpu_model_show, NULL);
 static DEVICE_ATTR(gpu_busy_percentage, 0444,
 	kgsl_pwrctrl_gpu_busy_percentage_show, NULL);
@@ -1489,6 +1614,9 @@ static const struct device_attribute *pwrctrl_attr_list[] = {
 	&dev_attr_force_non_retention_on,
 	&dev_attr_bus_split,
 	&dev_attr_pwrscale,
+	&dev_attr_frame_dcvs,
+	&dev_attr_frame_vsync_us,
+	&dev_attr_frame_target,
 	&dev_attr_gpu_model,
 	&dev_attr_gpu_busy_percentage,
 	&dev_attr_min_clock_mhz,
@@ -3139,3 +3267,23 @@ unsigned int kgsl_pwr_limits_get_freq(enum kgsl_deviceid id)
 	return freq;
 }
 EXPORT_SYMBOL(kgsl_pwr_limits_get_freq);
+
+/**
+ * kgsl_pwr_get_cur_freq() - Get the current frequency
+ * @id: Device ID
+ *
+ * Get the frequency the device is running at, or 0 if it is not active.
+ * This is a lockless snapshot meant for power estimates.
+ */
+unsigned int kgsl_pwr_get_cur_freq(enum kgsl_deviceid id)
+{
+	struct kgsl_device *device = kgsl_get_device(id);
+
+	if (IS_ERR_OR_NULL(device))
+		return 0;
+	if (ACCESS_ONCE(device->state) != KGSL_STATE_ACTIVE)
+		return 0;
+
+	return kgsl_pwrctrl_active_freq(&device->pwrctrl);
+}
+EXPORT_SYMBOL(kgsl_pwr_get_cur_freq);
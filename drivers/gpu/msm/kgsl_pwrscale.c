@@ -201,6 +201,88 @@ void kgsl_pwrscale_enable(struct kgsl_device *device)
 }
 EXPORT_SYMBOL(kgsl_pwrscale_enable);
 
+/**
+ * kgsl_pwrscale_frame_done() - Report the GPU work predicted for a frame
+ * @device: The device
+ * @context_id: Context that completed a frame
+ * @cycles: GPU cycles the context is expected to need for its next frame
+ *
+ * Called by the dispatcher when an end of frame cmdbatch retires.  The
+ * busiest context with a fresh prediction drives the frequency choice.
+ */
+void kgsl_pwrscale_frame_done(struct kgsl_device *device,
+		unsigned int context_id, u64 cycles)
+{
+	struct kgsl_pwrscale_frame *frame = &device->pwrscale.frame;
+	u64 now = local_clock();
+	unsigned long flags;
+
+	spin_lock_irqsave(&frame->lock, flags);
+	if (context_id == frame->context_id || cycles >= frame->cycles ||
+		now - frame->time_ns > (u64) frame->vsync_us * NSEC_PER_USEC *
+			KGSL_FRAME_STALE) {
+		frame->cycles = cycles;
+		frame->context_id = context_id;
+		frame->time_ns = now;
+	}
+	spin_unlock_irqrestore(&frame->lock, flags);
+}
+EXPORT_SYMBOL(kgsl_pwrscale_frame_done);
+
+/*
+ * _frame_target_freq() - Pick the lowest frequency that fits the next frame
+ * @device: The device
+ * @freq: Frequency recommended by the governor
+ *
+ * Return the slowest power level that can complete the predicted frame
+ * within the target share of the frame period, or @freq if there is no
+ * recent prediction.  Must be called with the device mutex held.
+ */
+static unsigned long _frame_target_freq(struct kgsl_device *device,
+		unsigned long freq)
+{
+	struct kgsl_pwrctrl *pwr = &device->pwrctrl;
+	struct kgsl_pwrscale_frame *frame = &device->pwrscale.frame;
+	struct devfreq *devfreq = device->pwrscale.devfreqptr;
+	u64 now = local_clock(), cycles, budget, required;
+	unsigned int context_id;
+	unsigned long flags, target;
+	int i;
+
+	/* Leave fixed frequency governors such as performance alone */
+	if (!frame->enabled || devfreq == NULL || devfreq->governor == NULL ||
+		strcmp(devfreq->governor->name, "msm-adreno-tz"))
+		return freq;
+
+	spin_lock_irqsave(&frame->lock, flags);
+	cycles = frame->cycles;
+	context_id = frame->context_id;
+	budget = (u64) frame->vsync_us * frame->target;
+	if (now - frame->time_ns > (u64) frame->vsync_us * NSEC_PER_USEC *
+			KGSL_FRAME_STALE)
+		cycles = 0;
+	spin_unlock_irqrestore(&frame->lock, flags);
+
+	if (cycles == 0 || budget == 0)
+		return freq;
+
+	/* cycles / (vsync_us * target / 100) in Hz */
+	required = div64_u64(cycles * USEC_PER_SEC * 100, budget);
+
+	target = pwr->pwrlevels[pwr->max_pwrlevel].gpu_freq;
+	for (i = pwr->min_pwrlevel; i >= (int) pwr->max_pwrlevel; i--) {
+		if (pwr->pwrlevels[i].gpu_freq >= required) {
+			target = pwr->pwrlevels[i].gpu_freq;
+			break;
+		}
+	}
+
+	trace_kgsl_pwrscale_frame(device, context_id, cycles, required,
+		freq, target);
+
+	return target;
+}
+
 static int _thermal_adjust(struct kgsl_pwrctrl *pwr, int level)
 {
 	if (level < pwr->active_pwrlevel)
@@ -255,6 +337,8 @@ int kgsl_devfreq_target(struct device *dev, unsigned long *freq, u32 flags)
 	level = pwr->active_pwrlevel;
 	pwr_level = &pwr->pwrlevels[level];
 
+	*freq = _frame_target_freq(device, *freq);
+
 	/* If the governor recommends a new frequency, update it here */
 	if (*freq != cur_freq) {
 		level = pwr->max_pwrlevel;
@@ -554,6 +638,15 @@ int kgsl_pwrscale_init(struct device *dev, const char *governor)
 
 	srcu_init_notifier_head(&pwrscale->nh);
 
+	spin_lock_init(&pwrscale->frame.lock);
+	pwrscale->frame.enabled = of_property_read_bool(
+		device->pdev->dev.of_node, "qcom,frame-dcvs");
+	if (of_property_read_u32(device->pdev->dev.of_node,
+			"qcom,frame-vsync-us", &pwrscale->frame.vsync_us) ||
+			pwrscale->frame.vsync_us == 0)
+		pwrscale->frame.vsync_us = KGSL_FRAME_VSYNC_US;
+	pwrscale->frame.target = KGSL_FRAME_TARGET;
+
 	profile->initial_freq =
 		pwr->pwrlevels[pwr->num_pwrlevels - 1].gpu_freq;
 	/* Let's start with 10 ms and tune in later */
@@ -33,6 +33,12 @@
  */
 #define STABLE_TIME	150
 
+/* Default frame period and the share of it the GPU should be busy for */
+#define KGSL_FRAME_VSYNC_US	16667
+#define KGSL_FRAME_TARGET	85
+/* Number of frame periods after which a prediction is no longer trusted */
+#define KGSL_FRAME_STALE	4
+
 struct kgsl_power_stats {
 	u64 busy_time;
 	u64 ram_time;
@@ -52,6 +58,26 @@ struct kgsl_pwr_history {
 	unsigned int size;
 };
 
+/**
+ * struct kgsl_pwrscale_frame - Frame based frequency prediction
+ * @lock: Protects the prediction against concurrent retires
+ * @enabled: Whether frame prediction overrides the governor
+ * @vsync_us: Frame period the GPU work needs to fit into
+ * @target: Percentage of @vsync_us the predicted frame may occupy
+ * @cycles: GPU cycles predicted for the next frame
+ * @context_id: Context that supplied @cycles
+ * @time_ns: local_clock() when @cycles was last updated
+ */
+struct kgsl_pwrscale_frame {
+	spinlock_t lock;
+	bool enabled;
+	unsigned int vsync_us;
+	unsigned int target;
+	u64 cycles;
+	unsigned int context_id;
+	u64 time_ns;
+};
+
 /**
  * struct kgsl_pwrscale - Power scaling settings for a KGSL device
  * @devfreqptr - Pointer to the devfreq device
@@ -72,6 +98,7 @@ struct kgsl_pwr_history {
  * @next_governor_call - Timestamp after which the governor may be notified of
  * a new sample
  * @history - History of power events with timestamps and durations
+ * @frame - Frame based frequency prediction state
  */
 struct kgsl_pwrscale {
 	struct devfreq *devfreqptr;
@@ -91,6 +118,7 @@ struct kgsl_pwrscale {
 	struct work_struct devfreq_notify_ws;
 	ktime_t next_governor_call;
 	struct kgsl_pwr_history history[KGSL_PWREVENT_MAX];
+	struct kgsl_pwrscale_frame frame;
 };
 
 int kgsl_pwrscale_init(struct device *dev, const char *governor);
@@ -104,6 +132,8 @@ void kgsl_pwrscale_wake(struct kgsl_device *device);
 
 void kgsl_pwrscale_enable(struct kgsl_device *device);
 void kgsl_pwrscale_disable(struct kgsl_device *device, bool turbo);
+void kgsl_pwrscale_frame_done(struct kgsl_device *device,
+		unsigned int context_id, u64 cycles);
 
 int kgsl_devfreq_target(struct device *dev, unsigned long *freq, u32 flags);
 int kgsl_devfreq_get_dev_status(struct device *, struct devfreq_dev_status *);
@@ -787,7 +787,17 @@ kgsl_sharedmem_page_alloc_user(struct kgsl_memdesc *memdesc,
 
 	align = (memdesc->flags & KGSL_MEMALIGN_MASK) >> KGSL_MEMALIGN_SHIFT;
 
-	page_size = kgsl_get_page_size(size, align);
+	/*
+	 * Don't let a small requested alignment force 4K pages on a large
+	 * buffer.  The alignment is raised to the first chunk size below so
+	 * the GPU address lines up with the pages and the IOMMU can map them
+	 * as large pages.  Secure buffers keep the alignment they asked for.
+	 */
+	if (memdesc->flags & KGSL_MEMFLAGS_SECURE)
+		page_size = kgsl_get_page_size(size, align);
+	else
+		page_size = kgsl_get_page_size(size,
+			max_t(unsigned int, align, ilog2(SZ_1M)));
 
 	/*
 	 * The alignment cannot be less than the intended page size - it can be
@@ -16,6 +16,9 @@
 #include <linux/utsname.h>
 #include <linux/sched.h>
 #include <linux/idr.h>
+#include <linux/vmalloc.h>
+#include <linux/lz4.h>
+#include <linux/crc32.h>
 
 #include "kgsl.h"
 #include "kgsl_log.h"
@@ -854,6 +857,27 @@ static ssize_t snapshot_crashdumper_store(struct kgsl_device *device,
 	return (ssize_t) ret < 0 ? ret : count;
 }
 
+/* Show whether frozen objects are compressed */
+static ssize_t compress_show(struct kgsl_device *device, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%d\n", device->snapshot_compress);
+}
+
+/* Enable or disable compression of frozen objects */
+static ssize_t compress_store(struct kgsl_device *device,
+	const char *buf, size_t count)
+{
+	unsigned int val = 0;
+	int ret;
+
+	ret = kgsl_sysfs_store(buf, &val);
+
+	if (!ret && device)
+		device->snapshot_compress = (bool)val;
+
+	return (ssize_t) ret < 0 ? ret : count;
+}
+
 /* Show the timestamp of the last collected snapshot */
 static ssize_t timestamp_show(struct kgsl_device *device, char *buf)
 {
@@ -882,6 +906,7 @@ static SNAPSHOT_ATTR(faultcount, 0644, faultcount_show, faultcount_store);
 static SNAPSHOT_ATTR(force_panic, 0644, force_panic_show, force_panic_store);
 static SNAPSHOT_ATTR(snapshot_crashdumper, 0644, snapshot_crashdumper_show,
 	snapshot_crashdumper_store);
+static SNAPSHOT_ATTR(compress, 0644, compress_show, compress_store);
 
 static ssize_t snapshot_sysfs_show(struct kobject *kobj,
 	struct attribute *attr, char *buf)
@@ -963,6 +988,9 @@ int kgsl_device_snapshot_init(struct kgsl_device *device)
 	device->snapshot_faultcount = 0;
 	device->force_panic = 0;
 	device->snapshot_crashdumper = 1;
+	device->snapshot_compress = of_property_read_bool(
+		device->pdev->dev.of_node, "qcom,snapshot-compress");
+	device->snapshot_ib_count = 0;
 
 	ret = kobject_init_and_add(&device->snapshot_kobj, &ktype_snapshot,
 		&device->dev->kobj, "snapshot");
@@ -988,6 +1016,10 @@ int kgsl_device_snapshot_init(struct kgsl_device *device)
 
 	ret  = sysfs_create_file(&device->snapshot_kobj,
 			&attr_snapshot_crashdumper.attr);
+	if (ret)
+		goto done;
+
+	ret  = sysfs_create_file(&device->snapshot_kobj, &attr_compress.attr);
 done:
 	return ret;
 }
@@ -1014,6 +1046,8 @@ void kgsl_device_snapshot_close(struct kgsl_device *device)
 	device->snapshot_faultcount = 0;
 	device->force_panic = 0;
 	device->snapshot_crashdumper = 1;
+	device->snapshot_compress = false;
+	device->snapshot_ib_count = 0;
 }
 EXPORT_SYMBOL(kgsl_device_snapshot_close);
 
@@ -1041,6 +1075,18 @@ int kgsl_snapshot_add_ib_obj_list(struct kgsl_snapshot *snapshot,
 	return 0;
 }
 
+static void _mark_ib_dumped(struct kgsl_snapshot *snapshot,
+		struct kgsl_snapshot_object *obj)
+{
+	if (kgsl_addr_range_overlap(obj->gpuaddr, obj->size,
+				snapshot->ib1base, snapshot->ib1size))
+		snapshot->ib1dumped = true;
+
+	if (kgsl_addr_range_overlap(obj->gpuaddr, obj->size,
+				snapshot->ib2base, snapshot->ib2size))
+		snapshot->ib2dumped = true;
+}
+
 static size_t _mempool_add_object(struct kgsl_snapshot *snapshot, u8 *data,
 		struct kgsl_snapshot_object *obj)
 {
@@ -1068,13 +1114,7 @@ static size_t _mempool_add_object(struct kgsl_snapshot *snapshot, u8 *data,
 		kgsl_mmu_pagetable_get_ttbr0(obj->entry->priv->pagetable);
 	header->type = obj->type;
 
-	if (kgsl_addr_range_overlap(obj->gpuaddr, obj->size,
-				snapshot->ib1base, snapshot->ib1size))
-		snapshot->ib1dumped = true;
-
-	if (kgsl_addr_range_overlap(obj->gpuaddr, obj->size,
-				snapshot->ib2base, snapshot->ib2size))
-		snapshot->ib2dumped = true;
+	_mark_ib_dumped(snapshot, obj);
 
 	memcpy(dest, obj->entry->memdesc.hostptr + obj->offset, size);
 	kgsl_memdesc_unmap(&obj->entry->memdesc);
@@ -1082,6 +1122,206 @@ static size_t _mempool_add_object(struct kgsl_snapshot *snapshot, u8 *data,
 	return section->size;
 }
 
+/* Worst case mempool space for an object when compression is enabled */
+static size_t _lz4_object_size(struct kgsl_snapshot_object *obj)
+{
+	return lz4_compressbound(obj->size) +
+		sizeof(struct kgsl_snapshot_gpu_object_lz4) +
+		sizeof(struct kgsl_snapshot_section_header);
+}
+
+static struct kgsl_snapshot_ib_digest *_find_ib_digest(
+		struct kgsl_device *device, uint64_t gpuaddr, uint64_t ptbase,
+		uint64_t size, u32 crc)
+{
+	unsigned int i;
+
+	for (i = 0; i < device->snapshot_ib_count; i++) {
+		struct kgsl_snapshot_ib_digest *d = &device->snapshot_ibs[i];
+
+		if (d->gpuaddr == gpuaddr && d->ptbase == ptbase &&
+			d->size == size && d->crc == crc)
+			return d;
+	}
+
+	return NULL;
+}
+
+/*
+ * _mempool_add_object_lz4() - Add a compressed object to the mempool
+ * @device: Device being snapshotted
+ * @snapshot: The snapshot instance
+ * @data: Mempool location to write the section to
+ * @obj: Object to save
+ * @wrkmem: lz4 scratch memory
+ * @digests: IBs captured by this snapshot, for the next one to compare with
+ * @count: Number of entries in @digests
+ *
+ * IBs that match one saved by the previous snapshot are written as a
+ * reference to that snapshot instead of being copied again.  Return the
+ * size of the section or 0 on error.
+ */
+static size_t _mempool_add_object_lz4(struct kgsl_device *device,
+		struct kgsl_snapshot *snapshot, u8 *data,
+		struct kgsl_snapshot_object *obj, void *wrkmem,
+		struct kgsl_snapshot_ib_digest *digests, unsigned int *count)
+{
+	struct kgsl_snapshot_section_header *section =
+		(struct kgsl_snapshot_section_header *)data;
+	struct kgsl_snapshot_ib_digest *prev = NULL;
+	uint64_t ptbase, size = obj->size;
+	u32 crc, seq = device->snapshot_faultcount;
+	u8 *src;
+
+	if (!kgsl_memdesc_map(&obj->entry->memdesc)) {
+		KGSL_CORE_ERR("snapshot: failed to map GPU object\n");
+		return 0;
+	}
+
+	src = obj->entry->memdesc.hostptr + obj->offset;
+	ptbase = kgsl_mmu_pagetable_get_ttbr0(obj->entry->priv->pagetable);
+	crc = crc32_le(~0, src, size);
+
+	_mark_ib_dumped(snapshot, obj);
+
+	if (obj->type == SNAPSHOT_GPU_OBJECT_IB) {
+		prev = _find_ib_digest(device, obj->gpuaddr, ptbase, size,
+			crc);
+		if (prev)
+			seq = prev->seq;
+	}
+
+	section->magic = SNAPSHOT_SECTION_MAGIC;
+
+	if (prev) {
+		struct kgsl_snapshot_gpu_object_ref *header =
+			(struct kgsl_snapshot_gpu_object_ref *)
+			(data + sizeof(*section));
+
+		section->id = KGSL_SNAPSHOT_SECTION_GPU_OBJECT_REF;
+		section->size = sizeof(*header) + sizeof(*section);
+
+		header->type = obj->type;
+		header->gpuaddr = obj->gpuaddr;
+		header->ptbase = ptbase;
+		header->size = size >> 2;
+		header->seq = seq;
+		header->crc = crc;
+	} else {
+		struct kgsl_snapshot_gpu_object_lz4 *header =
+			(struct kgsl_snapshot_gpu_object_lz4 *)
+			(data + sizeof(*section));
+		u8 *dest = data + sizeof(*section) + sizeof(*header);
+		size_t csize = lz4_compressbound(size);
+
+		if (lz4_compress(src, size, dest, &csize, wrkmem) ||
+			csize >= size) {
+			memcpy(dest, src, size);
+			csize = 0;
+		}
+
+		/* Pad the section to keep the next one dword aligned */
+		section->id = KGSL_SNAPSHOT_SECTION_GPU_OBJECT_LZ4;
+		section->size = ALIGN((csize ? csize : size) + sizeof(*header) +
+			sizeof(*section), 4);
+
+		header->type = obj->type;
+		header->gpuaddr = obj->gpuaddr;
+		header->ptbase = ptbase;
+		header->size = size >> 2;
+		header->seq = seq;
+		header->crc = crc;
+		header->csize = csize;
+	}
+
+	kgsl_memdesc_unmap(&obj->entry->memdesc);
+
+	if (obj->type == SNAPSHOT_GPU_OBJECT_IB &&
+		*count < KGSL_SNAPSHOT_IB_DIGESTS) {
+		digests[*count].gpuaddr = obj->gpuaddr;
+		digests[*count].ptbase = ptbase;
+		digests[*count].size = size;
+		digests[*count].seq = seq;
+		digests[*count].crc = crc;
+		(*count)++;
+	}
+
+	return section->size;
+}
+
+/*
+ * _save_frozen_objs_lz4() - Compress the frozen objects into the mempool
+ * @device: Device being snapshotted
+ * @snapshot: The snapshot instance
+ *
+ * The mempool is sized for the worst case while the objects are written and
+ * then shrunk to what was actually used, so that only the compressed size
+ * is held until the snapshot is read.
+ */
+static void _save_frozen_objs_lz4(struct kgsl_device *device,
+		struct kgsl_snapshot *snapshot)
+{
+	struct kgsl_snapshot_ib_digest *digests;
+	struct kgsl_snapshot_object *obj, *tmp;
+	unsigned int count = 0;
+	size_t size = 0;
+	void *wrkmem, *ptr;
+
+	list_for_each_entry(obj, &snapshot->obj_list, node) {
+		obj->size = ALIGN(obj->size, 4);
+		size += ALIGN(_lz4_object_size(obj), 4);
+	}
+
+	wrkmem = vmalloc(LZ4_MEM_COMPRESS);
+	digests = kcalloc(KGSL_SNAPSHOT_IB_DIGESTS, sizeof(*digests),
+		GFP_KERNEL);
+	if (size && wrkmem && digests)
+		snapshot->mempool = vzalloc(size);
+
+	ptr = snapshot->mempool;
+	snapshot->mempool_size = 0;
+
+	/* even if vmalloc fails, make sure we clean up the obj_list */
+	list_for_each_entry_safe(obj, tmp, &snapshot->obj_list, node) {
+		if (snapshot->mempool) {
+			size_t ret = _mempool_add_object_lz4(device, snapshot,
+				ptr, obj, wrkmem, digests, &count);
+			ptr += ret;
+			snapshot->mempool_size += ret;
+		}
+
+		kgsl_snapshot_put_object(obj);
+	}
+
+	if (snapshot->mempool && snapshot->mempool_size < size) {
+		void *shrunk = NULL;
+
+		if (snapshot->mempool_size)
+			shrunk = vmalloc(snapshot->mempool_size);
+
+		if (shrunk || snapshot->mempool_size == 0) {
+			if (shrunk)
+				memcpy(shrunk, snapshot->mempool,
+					snapshot->mempool_size);
+			vfree(snapshot->mempool);
+			snapshot->mempool = shrunk;
+		}
+	}
+
+	/* Remember this snapshot's IBs so the next one can skip them */
+	if (snapshot->mempool && digests) {
+		memcpy(device->snapshot_ibs, digests,
+			count * sizeof(*digests));
+		device->snapshot_ib_count = count;
+	}
+
+	kfree(digests);
+	vfree(wrkmem);
+
+	KGSL_DRV_INFO(device, "snapshot: objects compressed to %zd bytes\n",
+		snapshot->mempool_size);
+}
+
 /**
  * kgsl_snapshot_save_frozen_objs() - Save the objects frozen in snapshot into
  * memory so that the data reported in these objects is correct when snapshot
@@ -1102,6 +1342,11 @@ void kgsl_snapshot_save_frozen_objs(struct work_struct *work)
 
 	kgsl_snapshot_process_ib_obj_list(snapshot);
 
+	if (device->snapshot_compress) {
+		_save_frozen_objs_lz4(device, snapshot);
+		goto done;
+	}
+
 	list_for_each_entry(obj, &snapshot->obj_list, node) {
 		obj->size = ALIGN(obj->size, 4);
 
@@ -55,6 +55,8 @@ struct kgsl_snapshot_section_header {
 #define KGSL_SNAPSHOT_SECTION_DEBUGBUS     0x0A01
 #define KGSL_SNAPSHOT_SECTION_GPU_OBJECT   0x0B01
 #define KGSL_SNAPSHOT_SECTION_GPU_OBJECT_V2 0x0B02
+#define KGSL_SNAPSHOT_SECTION_GPU_OBJECT_LZ4 0x0B03
+#define KGSL_SNAPSHOT_SECTION_GPU_OBJECT_REF 0x0B04
 #define KGSL_SNAPSHOT_SECTION_MEMLIST      0x0E01
 #define KGSL_SNAPSHOT_SECTION_MEMLIST_V2   0x0E02
 #define KGSL_SNAPSHOT_SECTION_SHADER       0x1201
@@ -255,6 +257,34 @@ struct kgsl_snapshot_gpu_object_v2 {
 	__u64 size;    /* Size of the object (in dwords) */
 } __packed;
 
+/*
+ * GPU object captured with snapshot compression enabled.  If csize is
+ * non-zero the section holds csize bytes of lz4 data, otherwise the object
+ * didn't compress and size dwords of raw data follow.
+ */
+struct kgsl_snapshot_gpu_object_lz4 {
+	int type;      /* Type of GPU object */
+	__u64 gpuaddr; /* GPU address of the the object */
+	__u64 ptbase;  /* Base for the pagetable the GPU address is valid in */
+	__u64 size;    /* Uncompressed size of the object (in dwords) */
+	__u32 seq;     /* Fault count of the snapshot holding the data */
+	__u32 crc;     /* crc32 of the uncompressed data */
+	__u32 csize;   /* Size of the compressed data (in bytes) */
+} __packed;
+
+/*
+ * IB that is unchanged since an earlier snapshot.  No data follows - it is
+ * in the GPU_OBJECT_LZ4 section with the same seq, gpuaddr and ptbase.
+ */
+struct kgsl_snapshot_gpu_object_ref {
+	int type;      /* Type of GPU object */
+	__u64 gpuaddr; /* GPU address of the the object */
+	__u64 ptbase;  /* Base for the pagetable the GPU address is valid in */
+	__u64 size;    /* Size of the object (in dwords) */
+	__u32 seq;     /* Fault count of the snapshot holding the data */
+	__u32 crc;     /* crc32 of the data */
+} __packed;
+
 void kgsl_snapshot_push_object(struct kgsl_process_private *process,
 	uint64_t gpuaddr, uint64_t dwords);
 #endif
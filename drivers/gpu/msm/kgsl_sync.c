@@ -77,64 +77,6 @@ static int kgsl_sync_pt_compare(struct sync_pt *a, struct sync_pt *b)
 	return timestamp_cmp(ts_a, ts_b);
 }
 
-struct kgsl_fence_event_priv {
-	struct kgsl_context *context;
-	unsigned int timestamp;
-};
-
-/**
- * kgsl_fence_event_cb - Event callback for a fence timestamp event
- * @device - The KGSL device that expired the timestamp
- * @context- Pointer to the context that owns the event
- * @priv: Private data for the callback
- * @result - Result of the event (retired or canceled)
- *
- * Signal a fence following the expiration of a timestamp
- */
-
-static void kgsl_fence_event_cb(struct kgsl_device *device,
-		struct kgsl_event_group *group, void *priv, int result)
-{
-	struct kgsl_fence_event_priv *ev = priv;
-	kgsl_sync_timeline_signal(ev->context->timeline, ev->timestamp);
-	kgsl_context_put(ev->context);
-	kfree(ev);
-}
-
-static int _add_fence_event(struct kgsl_device *device,
-	struct kgsl_context *context, unsigned int timestamp)
-{
-	struct kgsl_fence_event_priv *event;
-	int ret;
-
-	event = kmalloc(sizeof(*event), GFP_KERNEL);
-	if (event == NULL)
-		return -ENOMEM;
-
-	/*
-	 * Increase the refcount for the context to keep it through the
-	 * callback
-	 */
-	if (!_kgsl_context_get(context)) {
-		kfree(event);
-		return -ENOENT;
-	}
-
-	event->context = context;
-	event->timestamp = timestamp;
-	event->context = context;
-
-	ret = kgsl_add_event(device, &context->events, timestamp,
-		kgsl_fence_event_cb, event);
-
-	if (ret) {
-		kgsl_context_put(context);
-		kfree(event);
-	}
-
-	return ret;
-}
-
 /**
  * kgsl_add_fence_event - Create a new fence event
  * @device - KGSL device to create the event on
@@ -144,8 +86,9 @@ static int _add_fence_event(struct kgsl_device *device,
  * @owner - driver instance that owns this event
  * @returns 0 on success or error code on error
  *
- * Create a fence and register an event to signal the fence when
- * the timestamp expires
+ * Create a fence on the context timeline. The fence is signaled in batch
+ * with every other fence on the timeline when the event group for the
+ * context retires the timestamp.
  */
 
 int kgsl_add_fence_event(struct kgsl_device *device,
@@ -154,6 +97,7 @@ int kgsl_add_fence_event(struct kgsl_device *device,
 {
 	struct kgsl_timestamp_event_fence priv;
 	struct kgsl_context *context;
+	struct kgsl_sync_timeline *ktimeline;
 	struct sync_pt *pt;
 	struct sync_fence *fence = NULL;
 	int ret = -EINVAL;
@@ -172,6 +116,18 @@ int kgsl_add_fence_event(struct kgsl_device *device,
 	if (test_bit(KGSL_CONTEXT_PRIV_INVALID, &context->priv))
 		goto out;
 
+	/*
+	 * Unless the caller is generating their own timestamps only allow
+	 * fences on timestamps that have been queued, otherwise nothing would
+	 * ever retire them
+	 */
+	if (!(context->flags & KGSL_CONTEXT_USER_GENERATED_TS)) {
+		kgsl_readtimestamp(device, context, KGSL_TIMESTAMP_QUEUED,
+			&cur);
+		if (timestamp_cmp(timestamp, cur) > 0)
+			goto out;
+	}
+
 	pt = kgsl_sync_pt_create(context->timeline, context, timestamp);
 	if (pt == NULL) {
 		KGSL_DRV_CRIT_RATELIMIT(device, "kgsl_sync_pt_create failed\n");
@@ -198,21 +154,28 @@ int kgsl_add_fence_event(struct kgsl_device *device,
 	}
 
 	/*
-	 * If the timestamp hasn't expired yet create an event to trigger it.
-	 * Otherwise, just signal the fence - there is no reason to go through
-	 * the effort of creating a fence we don't need.
+	 * Remember the newest fence so that flushing the context can signal
+	 * it. This has to happen before the retired timestamp is read so
+	 * that a retire racing with us is either seen here or signals the
+	 * timeline once the fence exists.
 	 */
+	ktimeline = (struct kgsl_sync_timeline *) context->timeline;
+
+	spin_lock(&ktimeline->lock);
+	if (timestamp_cmp(timestamp, ktimeline->pending_timestamp) > 0)
+		ktimeline->pending_timestamp = timestamp;
+	spin_unlock(&ktimeline->lock);
 
+	/*
+	 * If the timestamp has already expired signal the fence right away
+	 * instead of waiting for the next retire
+	 */
 	kgsl_readtimestamp(device, context, KGSL_TIMESTAMP_RETIRED, &cur);
 
-	if (timestamp_cmp(cur, timestamp) >= 0) {
-		ret = 0;
+	if (timestamp_cmp(cur, timestamp) >= 0)
 		kgsl_sync_timeline_signal(context->timeline, cur);
-	} else {
-		ret = _add_fence_event(device, context, timestamp);
-		if (ret)
-			goto out;
-	}
+
+	ret = 0;
 
 	if (copy_to_user(data, &priv, sizeof(priv))) {
 		ret = -EFAULT;
@@ -314,6 +277,7 @@ static const struct sync_timeline_ops kgsl_sync_timeline_ops = {
 	.dup = kgsl_sync_pt_dup,
 	.has_signaled = kgsl_sync_pt_has_signaled,
 	.compare = kgsl_sync_pt_compare,
+	.ordered = true,
 	.timeline_value_str = kgsl_sync_timeline_value_str,
 	.pt_value_str = kgsl_sync_pt_value_str,
 	.fill_driver_data = kgsl_sync_fill_driver_data,
@@ -342,6 +306,7 @@ int kgsl_sync_timeline_create(struct kgsl_context *context)
 
 	ktimeline = (struct kgsl_sync_timeline *) context->timeline;
 	ktimeline->last_timestamp = 0;
+	ktimeline->pending_timestamp = 0;
 	ktimeline->device = context->device;
 	ktimeline->context_id = context->id;
 
@@ -363,6 +328,43 @@ static void kgsl_sync_timeline_signal(struct sync_timeline *timeline,
 	sync_timeline_signal(timeline);
 }
 
+/**
+ * kgsl_sync_timeline_retire() - Signal all the fences on a context timeline
+ * up to a retired timestamp
+ * @context: Pointer to the context that owns the timeline
+ * @timestamp: Retired timestamp
+ * @flush: True if every outstanding fence on the timeline should be signaled
+ *
+ * Called by the event group processing after the group lock is dropped so
+ * that all the fences retired by a single interrupt are signaled at once.
+ */
+void kgsl_sync_timeline_retire(struct kgsl_context *context,
+	unsigned int timestamp, bool flush)
+{
+	struct kgsl_sync_timeline *ktimeline;
+
+	if (context == NULL || context->timeline == NULL)
+		return;
+
+	ktimeline = (struct kgsl_sync_timeline *) context->timeline;
+
+	spin_lock(&ktimeline->lock);
+
+	if (flush && timestamp_cmp(ktimeline->pending_timestamp,
+		timestamp) > 0)
+		timestamp = ktimeline->pending_timestamp;
+
+	if (timestamp_cmp(timestamp, ktimeline->last_timestamp) <= 0) {
+		spin_unlock(&ktimeline->lock);
+		return;
+	}
+
+	ktimeline->last_timestamp = timestamp;
+	spin_unlock(&ktimeline->lock);
+
+	sync_timeline_signal(context->timeline);
+}
+
 void kgsl_sync_timeline_destroy(struct kgsl_context *context)
 {
 	sync_timeline_destroy(context->timeline);
@@ -19,6 +19,7 @@
 struct kgsl_sync_timeline {
 	struct sync_timeline timeline;
 	unsigned int last_timestamp;
+	unsigned int pending_timestamp;
 	struct kgsl_device *device;
 	u32 context_id;
 	spinlock_t lock;
@@ -46,6 +47,8 @@ int kgsl_add_fence_event(struct kgsl_device *device,
 	struct kgsl_device_private *owner);
 int kgsl_sync_timeline_create(struct kgsl_context *context);
 void kgsl_sync_timeline_destroy(struct kgsl_context *context);
+void kgsl_sync_timeline_retire(struct kgsl_context *context,
+	unsigned int timestamp, bool flush);
 struct kgsl_sync_fence_waiter *kgsl_sync_fence_async_wait(int fd,
 	void (*func)(void *priv), void *priv);
 int kgsl_sync_fence_async_cancel(struct kgsl_sync_fence_waiter *waiter);
@@ -70,6 +73,11 @@ static inline void kgsl_sync_timeline_destroy(struct kgsl_context *context)
 {
 }
 
+static inline void kgsl_sync_timeline_retire(struct kgsl_context *context,
+	unsigned int timestamp, bool flush)
+{
+}
+
 static inline struct
 kgsl_sync_fence_waiter *kgsl_sync_fence_async_wait(int fd,
 	void (*func)(void *priv), void *priv)
@@ -289,6 +289,39 @@ TRACE_EVENT(kgsl_pwrlevel,
 	)
 );
 
+TRACE_EVENT(kgsl_pwrscale_frame,
+
+	TP_PROTO(struct kgsl_device *device, unsigned int context_id,
+		u64 cycles, u64 required, unsigned long governor_freq,
+		unsigned long freq),
+
+	TP_ARGS(device, context_id, cycles, required, governor_freq, freq),
+
+	TP_STRUCT__entry(
+		__string(device_name, device->name)
+		__field(unsigned int, context_id)
+		__field(u64, cycles)
+		__field(u64, required)
+		__field(unsigned long, governor_freq)
+		__field(unsigned long, freq)
+	),
+
+	TP_fast_assign(
+		__assign_str(device_name, device->name);
+		__entry->context_id = context_id;
+		__entry->cycles = cycles;
+		__entry->required = required;
+		__entry->governor_freq = governor_freq;
+		__entry->freq = freq;
+	),
+
+	TP_printk(
+		"d_name=%s ctx=%u cycles=%llu required=%llu governor_freq=%lu freq=%lu",
+		__get_str(device_name), __entry->context_id, __entry->cycles,
+		__entry->required, __entry->governor_freq, __entry->freq
+	)
+);
+
 TRACE_EVENT(kgsl_buslevel,
 
 	TP_PROTO(struct kgsl_device *device, unsigned int pwrlevel,
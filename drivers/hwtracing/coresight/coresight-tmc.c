@@ -27,6 +27,9 @@
 #include <linux/of.h>
 #include <linux/of_address.h>
 #include <linux/coresight.h>
+#include <linux/workqueue.h>
+#include <linux/wait.h>
+#include <linux/sched.h>
 #include <linux/amba/bus.h>
 #include <asm/cacheflush.h>
 #include <linux/msm-sps.h>
@@ -66,6 +69,7 @@
 /* TMC_CTL - 0x020 */
 #define TMC_CTL_CAPT_EN		BIT(0)
 /* TMC_STS - 0x00C */
+#define TMC_STS_FULL		BIT(0)
 #define TMC_STS_TRIGGERED	BIT(1)
 /* TMC_AXICTL - 0x110 */
 #define TMC_AXICTL_PROT_CTL_B0	BIT(0)
@@ -93,6 +97,8 @@
 #define TMC_ETR_BAM_PIPE_INDEX	0
 #define TMC_ETR_BAM_NR_PIPES	2
 
+#define TMC_ETR_STREAM_INTERVAL_MS	20
+
 enum tmc_config_type {
 	TMC_CONFIG_TYPE_ETB,
 	TMC_CONFIG_TYPE_ETR,
@@ -162,6 +168,16 @@ struct tmc_etr_bam_data {
  * @enable:	this TMC is being used.
  * @config_type: TMC variant, must be of type @tmc_config_type.
  * @trigger_cntr: amount of words to store after a trigger.
+ * @streamdev:	specifics to handle the "/dev/xyz-stream" entry of an ETR.
+ * @streaming:	the stream device is open.
+ * @stream_resync: the write offset must be re-read before counting data.
+ * @stream_off:	offset in the buffer of RWP at the last drain.
+ * @stream_read_off: offset in the buffer of the oldest unread byte.
+ * @stream_avail: unread bytes in the buffer.
+ * @stream_overruns: times trace data was overwritten before being read.
+ * @stream_interval: ms between two drains of the buffer.
+ * @stream_work: periodic drain of the buffer.
+ * @stream_wq:	stream readers wait here for data.
  */
 struct tmc_drvdata {
 	void __iomem		*base;
@@ -188,6 +204,16 @@ struct tmc_drvdata {
 	struct usb_qdss_ch	*usbch;
 	struct tmc_etr_bam_data	*bamdata;
 	bool			enable_to_bam;
+	struct miscdevice	streamdev;
+	bool			streaming;
+	bool			stream_resync;
+	u32			stream_off;
+	u32			stream_read_off;
+	u32			stream_avail;
+	u32			stream_overruns;
+	u32			stream_interval;
+	struct delayed_work	stream_work;
+	wait_queue_head_t	stream_wq;
 };
 
 static void tmc_wait_for_ready(struct tmc_drvdata *drvdata)
@@ -554,6 +580,169 @@ static void tmc_etr_enable_hw(struct tmc_drvdata *drvdata)
 	CS_LOCK(drvdata->base);
 }
 
+static void tmc_etr_dump_hw(struct tmc_drvdata *drvdata);
+
+/*
+ * Resume a capture stopped by a drain of the stream: the buffer and RWP
+ * are left as they are, so the trace carries on where it stopped.
+ */
+static void tmc_etr_restart_hw(struct tmc_drvdata *drvdata)
+{
+	writel_relaxed(TMC_FFCR_EN_FMT | TMC_FFCR_EN_TI |
+		       TMC_FFCR_FON_FLIN | TMC_FFCR_FON_TRIG_EVT |
+		       TMC_FFCR_TRIGON_TRIGIN,
+		       drvdata->base + TMC_FFCR);
+	tmc_enable_hw(drvdata);
+}
+
+/* Table entry of data block @blk of the scatter gather buffer */
+static uint32_t *tmc_etr_sg_blk_ent(struct tmc_drvdata *drvdata, int blk)
+{
+	int ents_left = DIV_ROUND_UP(drvdata->size, PAGE_SIZE);
+	int ents_per_blk = PAGE_SIZE/sizeof(uint32_t);
+	uint32_t *virt_st_tbl = drvdata->vaddr;
+	phys_addr_t phys_pte;
+
+	/* Every table but the last one ends with the next table address */
+	while (ents_left > ents_per_blk && blk >= ents_per_blk - 1) {
+		phys_pte = TMC_ETR_SG_ENT_TO_BLK(virt_st_tbl[ents_per_blk - 1]);
+		virt_st_tbl = (uint32_t *)phys_to_virt(phys_pte);
+		blk -= ents_per_blk - 1;
+		ents_left -= ents_per_blk - 1;
+	}
+
+	return virt_st_tbl + blk;
+}
+
+static void *tmc_etr_stream_vaddr(struct tmc_drvdata *drvdata, u32 off)
+{
+	phys_addr_t phys_pte;
+
+	if (drvdata->memtype == TMC_ETR_MEM_TYPE_CONTIG)
+		return drvdata->vaddr + off;
+
+	phys_pte = TMC_ETR_SG_ENT_TO_BLK(*tmc_etr_sg_blk_ent(drvdata,
+							     off / PAGE_SIZE));
+	return phys_to_virt(phys_pte) + off % PAGE_SIZE;
+}
+
+/*
+ * Offset in the buffer RWP points to. The writer only moves forward, so
+ * the scatter gather blocks are searched from the one of the last drain.
+ */
+static u32 tmc_etr_stream_rwp_off(struct tmc_drvdata *drvdata, u32 rwp)
+{
+	int total_ents = DIV_ROUND_UP(drvdata->size, PAGE_SIZE);
+	int i, blk = (drvdata->stream_off / PAGE_SIZE) % total_ents;
+	phys_addr_t phys_pte;
+
+	if (drvdata->memtype == TMC_ETR_MEM_TYPE_CONTIG) {
+		if (rwp - drvdata->paddr < drvdata->size)
+			return rwp - drvdata->paddr;
+		goto err;
+	}
+
+	for (i = 0; i < total_ents; i++, blk = (blk + 1) % total_ents) {
+		phys_pte = TMC_ETR_SG_ENT_TO_BLK(*tmc_etr_sg_blk_ent(drvdata,
+								     blk));
+		if (phys_pte <= rwp && rwp < phys_pte + PAGE_SIZE)
+			return blk * PAGE_SIZE + rwp - phys_pte;
+	}
+
+err:
+	dev_err_ratelimited(drvdata->dev, "RWP %#x outside of the buffer\n",
+			    rwp);
+	return drvdata->stream_off % drvdata->size;
+}
+
+/* Start the stream at the current write offset; the TMC must be stopped */
+static void tmc_etr_stream_reset(struct tmc_drvdata *drvdata)
+{
+	u32 rwp = readl_relaxed(drvdata->base + TMC_RWP);
+
+	drvdata->stream_off = tmc_etr_stream_rwp_off(drvdata, rwp);
+	drvdata->stream_read_off = drvdata->stream_off;
+	drvdata->stream_avail = 0;
+	drvdata->stream_resync = false;
+}
+
+/*
+ * RWP and the Full flag are only meaningful while the TMC is stopped, so
+ * a drain briefly stops the capture, accounts what was written since the
+ * last drain and, if @restart, resumes it. Called with spinlock held.
+ */
+static void tmc_etr_stream_drain(struct tmc_drvdata *drvdata, bool restart)
+{
+	u32 sts, off, written;
+
+	CS_UNLOCK(drvdata->base);
+
+	tmc_flush_and_stop(drvdata);
+	sts = readl_relaxed(drvdata->base + TMC_STS);
+
+	if (drvdata->stream_resync) {
+		tmc_etr_stream_reset(drvdata);
+	} else {
+		off = tmc_etr_stream_rwp_off(drvdata,
+				readl_relaxed(drvdata->base + TMC_RWP));
+
+		/* Full: RWP wrapped since the capture was last started */
+		if ((sts & TMC_STS_FULL) && off >= drvdata->stream_off)
+			written = drvdata->size;
+		else
+			written = (off + drvdata->size - drvdata->stream_off) %
+				  drvdata->size;
+
+		drvdata->stream_off = off;
+		drvdata->stream_avail += written;
+		if (drvdata->stream_avail > drvdata->size) {
+			/* The reader fell behind, the oldest data is at RWP */
+			drvdata->stream_avail = drvdata->size;
+			drvdata->stream_read_off = off;
+			drvdata->stream_overruns++;
+		}
+	}
+
+	if (restart) {
+		tmc_etr_restart_hw(drvdata);
+	} else {
+		tmc_etr_dump_hw(drvdata);
+		tmc_disable_hw(drvdata);
+	}
+
+	CS_LOCK(drvdata->base);
+}
+
+static bool tmc_etr_stream_running(struct tmc_drvdata *drvdata)
+{
+	return drvdata->enable && drvdata->out_mode == TMC_ETR_OUT_MODE_MEM;
+}
+
+static void tmc_etr_stream_work(struct work_struct *work)
+{
+	struct tmc_drvdata *drvdata = container_of(to_delayed_work(work),
+						   struct tmc_drvdata,
+						   stream_work);
+	unsigned long flags;
+	bool avail;
+
+	spin_lock_irqsave(&drvdata->spinlock, flags);
+	if (!drvdata->streaming) {
+		spin_unlock_irqrestore(&drvdata->spinlock, flags);
+		return;
+	}
+	if (tmc_etr_stream_running(drvdata))
+		tmc_etr_stream_drain(drvdata, true);
+	avail = drvdata->stream_avail;
+	spin_unlock_irqrestore(&drvdata->spinlock, flags);
+
+	if (avail)
+		wake_up_interruptible(&drvdata->stream_wq);
+
+	schedule_delayed_work(&drvdata->stream_work,
+			      msecs_to_jiffies(drvdata->stream_interval));
+}
+
 static void tmc_etf_enable_hw(struct tmc_drvdata *drvdata)
 {
 	CS_UNLOCK(drvdata->base);
@@ -794,8 +983,11 @@ static int tmc_enable(struct tmc_drvdata *drvdata, enum tmc_mode mode)
 	if (drvdata->config_type == TMC_CONFIG_TYPE_ETB) {
 		tmc_etb_enable_hw(drvdata);
 	} else if (drvdata->config_type == TMC_CONFIG_TYPE_ETR) {
-		if (drvdata->out_mode == TMC_ETR_OUT_MODE_MEM)
+		if (drvdata->out_mode == TMC_ETR_OUT_MODE_MEM) {
+			/* RWP is only known once the new capture runs */
+			drvdata->stream_resync = true;
 			tmc_etr_enable_hw(drvdata);
+		}
 	} else {
 		if (mode == TMC_MODE_CIRCULAR_BUFFER)
 			tmc_etb_enable_hw(drvdata);
@@ -981,6 +1173,8 @@ static void tmc_disable(struct tmc_drvdata *drvdata, enum tmc_mode mode)
 	} else if (drvdata->config_type == TMC_CONFIG_TYPE_ETR) {
 		if (drvdata->out_mode == TMC_ETR_OUT_MODE_USB)
 			__tmc_etr_disable_to_bam(drvdata);
+		else if (drvdata->streaming)
+			tmc_etr_stream_drain(drvdata, false);
 		else
 			tmc_etr_disable_hw(drvdata);
 	} else {
@@ -993,6 +1187,10 @@ out:
 	drvdata->enable = false;
 	spin_unlock_irqrestore(&drvdata->spinlock, flags);
 
+	/* Let stream readers drain what is left and see the end */
+	if (drvdata->config_type == TMC_CONFIG_TYPE_ETR)
+		wake_up_interruptible(&drvdata->stream_wq);
+
 	if (drvdata->config_type == TMC_CONFIG_TYPE_ETR
 	    && drvdata->out_mode == TMC_ETR_OUT_MODE_USB) {
 		tmc_etr_bam_disable(drvdata);
@@ -1110,6 +1308,9 @@ static int tmc_open(struct inode *inode, struct file *file)
 						   struct tmc_drvdata, miscdev);
 	int ret = 0;
 
+	if (drvdata->streaming)
+		return -EBUSY;
+
 	if (drvdata->read_count++)
 		goto out;
 
@@ -1308,6 +1509,133 @@ out:
 	return 0;
 }
 
+static int tmc_stream_open(struct inode *inode, struct file *file)
+{
+	struct tmc_drvdata *drvdata = container_of(file->private_data,
+						   struct tmc_drvdata,
+						   streamdev);
+	unsigned long flags;
+	int ret = 0;
+
+	mutex_lock(&drvdata->mem_lock);
+	spin_lock_irqsave(&drvdata->spinlock, flags);
+	if (drvdata->streaming || drvdata->read_count) {
+		ret = -EBUSY;
+	} else if (drvdata->out_mode != TMC_ETR_OUT_MODE_MEM) {
+		ret = -EINVAL;
+	} else {
+		drvdata->streaming = true;
+		drvdata->stream_avail = 0;
+		drvdata->stream_overruns = 0;
+		/* The capture may be running: read RWP at the first drain */
+		drvdata->stream_resync = true;
+	}
+	spin_unlock_irqrestore(&drvdata->spinlock, flags);
+	mutex_unlock(&drvdata->mem_lock);
+	if (ret)
+		return ret;
+
+	schedule_delayed_work(&drvdata->stream_work, 0);
+	nonseekable_open(inode, file);
+
+	dev_dbg(drvdata->dev, "%s: successfully opened\n", __func__);
+	return 0;
+}
+
+static bool tmc_stream_readable(struct tmc_drvdata *drvdata)
+{
+	return ACCESS_ONCE(drvdata->stream_avail) ||
+	       !tmc_etr_stream_running(drvdata);
+}
+
+/*
+ * Hand out the data accounted by the drains while the capture carries
+ * on. A reader that falls behind by more than the buffer size loses the
+ * oldest data, which bumps stream_overruns.
+ */
+static ssize_t tmc_stream_read(struct file *file, char __user *data,
+			       size_t len, loff_t *ppos)
+{
+	struct tmc_drvdata *drvdata = container_of(file->private_data,
+						   struct tmc_drvdata,
+						   streamdev);
+	unsigned long flags;
+	u32 off, avail, overruns;
+	char *bufp;
+	int ret;
+
+	if (!tmc_stream_readable(drvdata)) {
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		ret = wait_event_interruptible(drvdata->stream_wq,
+					       tmc_stream_readable(drvdata));
+		if (ret)
+			return ret;
+	}
+
+	mutex_lock(&drvdata->mem_lock);
+
+	spin_lock_irqsave(&drvdata->spinlock, flags);
+	off = drvdata->stream_read_off;
+	avail = drvdata->stream_avail;
+	overruns = drvdata->stream_overruns;
+	spin_unlock_irqrestore(&drvdata->spinlock, flags);
+
+	/* Capture stopped and everything was read */
+	if (!avail || !drvdata->vaddr) {
+		mutex_unlock(&drvdata->mem_lock);
+		return 0;
+	}
+
+	len = min_t(size_t, len, avail);
+	len = min_t(size_t, len, drvdata->size - off);
+	bufp = tmc_etr_stream_vaddr(drvdata, off);
+	if (drvdata->memtype == TMC_ETR_MEM_TYPE_SG) {
+		len = min_t(size_t, len, PAGE_SIZE - off % PAGE_SIZE);
+		/* Drop lines cached from an earlier lap of the writer */
+		dmac_inv_range(bufp, bufp + len);
+	}
+
+	if (copy_to_user(data, bufp, len)) {
+		dev_dbg(drvdata->dev, "%s: copy_to_user failed\n", __func__);
+		mutex_unlock(&drvdata->mem_lock);
+		return -EFAULT;
+	}
+
+	spin_lock_irqsave(&drvdata->spinlock, flags);
+	/* Unless a drain moved the read offset past an overrun meanwhile */
+	if (overruns == drvdata->stream_overruns) {
+		drvdata->stream_read_off = (off + len) % drvdata->size;
+		drvdata->stream_avail -= len;
+	}
+	spin_unlock_irqrestore(&drvdata->spinlock, flags);
+
+	mutex_unlock(&drvdata->mem_lock);
+
+	*ppos += len;
+	return len;
+}
+
+static int tmc_stream_release(struct inode *inode, struct file *file)
+{
+	struct tmc_drvdata *drvdata = container_of(file->private_data,
+						   struct tmc_drvdata,
+						   streamdev);
+	unsigned long flags;
+
+	spin_lock_irqsave(&drvdata->spinlock, flags);
+	drvdata->streaming = false;
+	spin_unlock_irqrestore(&drvdata->spinlock, flags);
+
+	cancel_delayed_work_sync(&drvdata->stream_work);
+
+	if (drvdata->stream_overruns)
+		dev_info(drvdata->dev, "stream lost data %u times\n",
+			 drvdata->stream_overruns);
+	dev_dbg(drvdata->dev, "%s: released\n", __func__);
+	return 0;
+}
+
 static int tmc_etr_bam_init(struct amba_device *adev,
 			    struct tmc_drvdata *drvdata)
 {
@@ -1357,6 +1685,14 @@ static const struct file_operations tmc_fops = {
 	.llseek		= no_llseek,
 };
 
+static const struct file_operations tmc_stream_fops = {
+	.owner		= THIS_MODULE,
+	.open		= tmc_stream_open,
+	.read		= tmc_stream_read,
+	.release	= tmc_stream_release,
+	.llseek		= no_llseek,
+};
+
 static ssize_t status_show(struct device *dev,
 			   struct device_attribute *attr, char *buf)
 {
@@ -1575,6 +1911,38 @@ err0:
 }
 static DEVICE_ATTR_RW(out_mode);
 
+static ssize_t stream_interval_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct tmc_drvdata *drvdata = dev_get_drvdata(dev->parent);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", drvdata->stream_interval);
+}
+
+static ssize_t stream_interval_store(struct device *dev,
+				     struct device_attribute *attr,
+				     const char *buf, size_t size)
+{
+	struct tmc_drvdata *drvdata = dev_get_drvdata(dev->parent);
+	unsigned long val;
+
+	if (kstrtoul(buf, 10, &val) || !val)
+		return -EINVAL;
+
+	drvdata->stream_interval = val;
+	return size;
+}
+static DEVICE_ATTR_RW(stream_interval);
+
+static ssize_t stream_overruns_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct tmc_drvdata *drvdata = dev_get_drvdata(dev->parent);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", drvdata->stream_overruns);
+}
+static DEVICE_ATTR_RO(stream_overruns);
+
 static ssize_t available_out_modes_show(struct device *dev,
 				       struct device_attribute *attr,
 				       char *buf)
@@ -1603,6 +1971,8 @@ static struct attribute *coresight_etr_attrs[] = {
 	&dev_attr_mem_size.attr,
 	&dev_attr_mem_type.attr,
 	&dev_attr_out_mode.attr,
+	&dev_attr_stream_interval.attr,
+	&dev_attr_stream_overruns.attr,
 	&dev_attr_trigger_cntr.attr,
 	&dev_attr_status.attr,
 	NULL,
@@ -1667,6 +2037,9 @@ static int tmc_probe(struct amba_device *adev, const struct amba_id *id)
 		drvdata->mem_size = drvdata->size;
 		drvdata->memtype  = TMC_ETR_MEM_TYPE_CONTIG;
 		drvdata->mem_type = drvdata->memtype;
+		drvdata->stream_interval = TMC_ETR_STREAM_INTERVAL_MS;
+		INIT_DELAYED_WORK(&drvdata->stream_work, tmc_etr_stream_work);
+		init_waitqueue_head(&drvdata->stream_wq);
 	} else {
 		drvdata->size = readl_relaxed(drvdata->base + TMC_RSZ) * 4;
 	}
@@ -1719,9 +2092,26 @@ static int tmc_probe(struct amba_device *adev, const struct amba_id *id)
 	if (ret)
 		goto err_misc_register;
 
+	if (drvdata->config_type == TMC_CONFIG_TYPE_ETR) {
+		drvdata->streamdev.name = devm_kasprintf(dev, GFP_KERNEL,
+							 "%s-stream",
+							 pdata->name);
+		if (!drvdata->streamdev.name) {
+			ret = -ENOMEM;
+			goto err_stream_register;
+		}
+		drvdata->streamdev.minor = MISC_DYNAMIC_MINOR;
+		drvdata->streamdev.fops = &tmc_stream_fops;
+		ret = misc_register(&drvdata->streamdev);
+		if (ret)
+			goto err_stream_register;
+	}
+
 	dev_info(dev, "TMC initialized\n");
 	return 0;
 
+err_stream_register:
+	misc_deregister(&drvdata->miscdev);
 err_misc_register:
 	coresight_unregister(drvdata->csdev);
 	return ret;
@@ -1731,6 +2121,8 @@ static int tmc_remove(struct amba_device *adev)
 {
 	struct tmc_drvdata *drvdata = amba_get_drvdata(adev);
 
+	if (drvdata->config_type == TMC_CONFIG_TYPE_ETR)
+		misc_deregister(&drvdata->streamdev);
 	misc_deregister(&drvdata->miscdev);
 	coresight_unregister(drvdata->csdev);
 	if (drvdata->config_type == TMC_CONFIG_TYPE_ETR)
@@ -0,0 +1,629 @@
+/* The industrial I/O - block based buffers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * User space allocates a set of DMA coherent blocks, maps them and hands
+ * them to the buffer with IIO_BUFFER_BLOCK_ENQUEUE_IOCTL.  Queued blocks
+ * are filled either by the driver's DMA (see struct iio_block_buf_ops) or
+ * by the CPU from iio_push_to_buffers(), and come back, oldest first, with
+ * IIO_BUFFER_BLOCK_DEQUEUE_IOCTL once full or once the watermark is hit.
+ * No data is ever copied to user space.
+ */
+#include <linux/slab.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/device.h>
+#include <linux/dma-mapping.h>
+#include <linux/mm.h>
+#include <linux/sizes.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/sched.h>
+#include <linux/poll.h>
+#include <linux/iio/iio.h>
+#include <linux/iio/buffer.h>
+#include <linux/iio/sysfs.h>
+#include <linux/iio/block_buf.h>
+
+#define IIO_BLOCK_BUF_MAX_BLOCKS	32
+#define IIO_BLOCK_BUF_MAX_SIZE		SZ_1M
+
+struct iio_block_buf {
+	struct iio_buffer buffer;
+	struct device *dev;
+	const struct iio_block_buf_ops *ops;
+	void *driver_data;
+
+	/* Protects blocks, num_blocks, block_size and active */
+	struct mutex lock;
+	/* Protects the lists, fill and the state of the blocks */
+	spinlock_t list_lock;
+	struct list_head incoming;
+	struct list_head outgoing;
+
+	struct iio_block_buf_block *blocks[IIO_BLOCK_BUF_MAX_BLOCKS];
+	unsigned int num_blocks;
+	size_t block_size;
+
+	/* Block being filled by the CPU */
+	struct iio_block_buf_block *fill;
+	/* Datums after which a CPU filled block is completed, 0: when full */
+	unsigned int watermark;
+	bool active;
+};
+
+#define iio_to_block_buf(r) container_of(r, struct iio_block_buf, buffer)
+
+static void iio_block_buf_block_release(struct kref *kref)
+{
+	struct iio_block_buf_block *block =
+		container_of(kref, struct iio_block_buf_block, kref);
+	struct iio_block_buf *buf = block->buf;
+
+	dma_free_coherent(buf->dev, PAGE_ALIGN(block->block.size),
+			  block->vaddr, block->phys_addr);
+	kfree(block);
+	iio_buffer_put(&buf->buffer);
+}
+
+static void iio_block_buf_block_put(struct iio_block_buf_block *block)
+{
+	kref_put(&block->kref, iio_block_buf_block_release);
+}
+
+/* Called with list_lock held */
+static void __iio_block_buf_block_done(struct iio_block_buf_block *block,
+				       size_t bytes_used, u32 flags)
+{
+	struct iio_block_buf *buf = block->buf;
+
+	if (block->state == IIO_BLOCK_STATE_DEAD)
+		return;
+
+	block->block.bytes_used = bytes_used;
+	block->block.flags = flags;
+	block->block.timestamp = iio_get_time_ns();
+	block->state = IIO_BLOCK_STATE_DONE;
+	list_add_tail(&block->head, &buf->outgoing);
+}
+
+/**
+ * iio_block_buf_block_done() - hand a filled block back to user space
+ * @block:	block submitted through iio_block_buf_ops.submit
+ * @bytes_used:	number of bytes of valid data in the block
+ *
+ * May be called from atomic context, typically the DMA completion callback.
+ */
+void iio_block_buf_block_done(struct iio_block_buf_block *block,
+			      size_t bytes_used)
+{
+	struct iio_block_buf *buf = block->buf;
+	unsigned long flags;
+
+	spin_lock_irqsave(&buf->list_lock, flags);
+	__iio_block_buf_block_done(block, bytes_used, 0);
+	spin_unlock_irqrestore(&buf->list_lock, flags);
+
+	wake_up_interruptible_poll(&buf->buffer.pollq, POLLIN | POLLRDNORM);
+}
+EXPORT_SYMBOL_GPL(iio_block_buf_block_done);
+
+void *iio_block_buf_get_drvdata(struct iio_block_buf *buf)
+{
+	return buf->driver_data;
+}
+EXPORT_SYMBOL_GPL(iio_block_buf_get_drvdata);
+
+/* Called with lock held */
+static void iio_block_buf_submit_queued(struct iio_block_buf *buf)
+{
+	struct iio_block_buf_block *block;
+	int ret;
+
+	if (!buf->active || !buf->ops)
+		return;
+
+	for (;;) {
+		spin_lock_irq(&buf->list_lock);
+		block = list_first_entry_or_null(&buf->incoming,
+				struct iio_block_buf_block, head);
+		if (block) {
+			list_del_init(&block->head);
+			block->state = IIO_BLOCK_STATE_ACTIVE;
+		}
+		spin_unlock_irq(&buf->list_lock);
+		if (!block)
+			break;
+
+		ret = buf->ops->submit(buf, block);
+		if (ret) {
+			dev_warn(buf->dev, "block %u submit failed: %d\n",
+				 block->block.id, ret);
+			iio_block_buf_block_done(block, 0);
+		}
+	}
+}
+
+/* Called with lock held */
+static void iio_block_buf_drop_blocks(struct iio_block_buf *buf)
+{
+	unsigned int i;
+
+	spin_lock_irq(&buf->list_lock);
+	for (i = 0; i < buf->num_blocks; i++) {
+		list_del_init(&buf->blocks[i]->head);
+		buf->blocks[i]->state = IIO_BLOCK_STATE_DEAD;
+	}
+	buf->fill = NULL;
+	spin_unlock_irq(&buf->list_lock);
+
+	for (i = 0; i < buf->num_blocks; i++) {
+		iio_block_buf_block_put(buf->blocks[i]);
+		buf->blocks[i] = NULL;
+	}
+	buf->num_blocks = 0;
+	buf->block_size = 0;
+}
+
+static int iio_block_buf_alloc_blocks(struct iio_buffer *r,
+				      struct iio_buffer_block_alloc_req *req)
+{
+	struct iio_block_buf *buf = iio_to_block_buf(r);
+	struct iio_block_buf_block *block;
+	size_t size = PAGE_ALIGN(req->size);
+	unsigned int i;
+	int ret = 0;
+
+	if (req->type || !req->size || req->size > IIO_BLOCK_BUF_MAX_SIZE ||
+	    !req->count)
+		return -EINVAL;
+
+	mutex_lock(&buf->lock);
+	if (buf->active || buf->num_blocks) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	for (i = 0; i < min_t(u32, req->count, IIO_BLOCK_BUF_MAX_BLOCKS); i++) {
+		block = kzalloc(sizeof(*block), GFP_KERNEL);
+		if (!block)
+			break;
+		block->vaddr = dma_alloc_coherent(buf->dev, size,
+						  &block->phys_addr,
+						  GFP_KERNEL);
+		if (!block->vaddr) {
+			kfree(block);
+			break;
+		}
+
+		block->block.id = i;
+		block->block.size = req->size;
+		block->block.offset = i * size;
+		block->buf = buf;
+		block->state = IIO_BLOCK_STATE_DEQUEUED;
+		INIT_LIST_HEAD(&block->head);
+		kref_init(&block->kref);
+		iio_buffer_get(&buf->buffer);
+		buf->blocks[i] = block;
+	}
+
+	if (!i) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	buf->num_blocks = i;
+	buf->block_size = size;
+	req->count = i;
+	req->id = 0;
+out:
+	mutex_unlock(&buf->lock);
+	return ret;
+}
+
+static int iio_block_buf_free_blocks(struct iio_buffer *r)
+{
+	struct iio_block_buf *buf = iio_to_block_buf(r);
+	int ret = 0;
+
+	mutex_lock(&buf->lock);
+	if (buf->active)
+		ret = -EBUSY;
+	else
+		iio_block_buf_drop_blocks(buf);
+	mutex_unlock(&buf->lock);
+
+	return ret;
+}
+
+static int iio_block_buf_query_block(struct iio_buffer *r,
+				     struct iio_buffer_block *block)
+{
+	struct iio_block_buf *buf = iio_to_block_buf(r);
+	int ret = 0;
+
+	mutex_lock(&buf->lock);
+	if (block->id >= buf->num_blocks) {
+		ret = -EINVAL;
+	} else {
+		spin_lock_irq(&buf->list_lock);
+		*block = buf->blocks[block->id]->block;
+		spin_unlock_irq(&buf->list_lock);
+	}
+	mutex_unlock(&buf->lock);
+
+	return ret;
+}
+
+static int iio_block_buf_enqueue_block(struct iio_buffer *r,
+				       struct iio_buffer_block *block)
+{
+	struct iio_block_buf *buf = iio_to_block_buf(r);
+	struct iio_block_buf_block *b;
+	int ret = 0;
+
+	mutex_lock(&buf->lock);
+	if (block->id >= buf->num_blocks) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	b = buf->blocks[block->id];
+	spin_lock_irq(&buf->list_lock);
+	if (b->state != IIO_BLOCK_STATE_DEQUEUED) {
+		ret = -EINVAL;
+	} else {
+		b->block.bytes_used = 0;
+		b->block.flags = 0;
+		b->state = IIO_BLOCK_STATE_QUEUED;
+		list_add_tail(&b->head, &buf->incoming);
+	}
+	spin_unlock_irq(&buf->list_lock);
+
+	if (!ret)
+		iio_block_buf_submit_queued(buf);
+out:
+	mutex_unlock(&buf->lock);
+	return ret;
+}
+
+static int iio_block_buf_dequeue_block(struct iio_buffer *r,
+				       struct iio_buffer_block *block)
+{
+	struct iio_block_buf *buf = iio_to_block_buf(r);
+	struct iio_block_buf_block *b;
+
+	spin_lock_irq(&buf->list_lock);
+	b = list_first_entry_or_null(&buf->outgoing,
+				     struct iio_block_buf_block, head);
+	if (b) {
+		list_del_init(&b->head);
+		b->state = IIO_BLOCK_STATE_DEQUEUED;
+		*block = b->block;
+	}
+	spin_unlock_irq(&buf->list_lock);
+
+	return b ? 0 : -EAGAIN;
+}
+
+static int iio_store_to_block_buf(struct iio_buffer *r, const void *data)
+{
+	struct iio_block_buf *buf = iio_to_block_buf(r);
+	size_t bpd = r->bytes_per_datum;
+	struct iio_block_buf_block *block;
+	unsigned long flags;
+	size_t limit;
+	bool done = false;
+
+	spin_lock_irqsave(&buf->list_lock, flags);
+	block = buf->fill;
+	if (!block) {
+		block = list_first_entry_or_null(&buf->incoming,
+				struct iio_block_buf_block, head);
+		if (!block) {
+			spin_unlock_irqrestore(&buf->list_lock, flags);
+			return -EBUSY;
+		}
+		list_del_init(&block->head);
+		block->state = IIO_BLOCK_STATE_ACTIVE;
+		block->block.bytes_used = 0;
+		buf->fill = block;
+	}
+
+	memcpy(block->vaddr + block->block.bytes_used, data, bpd);
+	block->block.bytes_used += bpd;
+
+	limit = block->block.size;
+	if (buf->watermark)
+		limit = min_t(size_t, limit, buf->watermark * bpd);
+	if (block->block.bytes_used + bpd > limit) {
+		__iio_block_buf_block_done(block, block->block.bytes_used, 0);
+		buf->fill = NULL;
+		done = true;
+	}
+	spin_unlock_irqrestore(&buf->list_lock, flags);
+
+	if (done)
+		wake_up_interruptible_poll(&r->pollq, POLLIN | POLLRDNORM);
+
+	return 0;
+}
+
+static bool iio_block_buf_data_available(struct iio_buffer *r)
+{
+	struct iio_block_buf *buf = iio_to_block_buf(r);
+	bool empty;
+
+	spin_lock_irq(&buf->list_lock);
+	empty = list_empty(&buf->outgoing);
+	spin_unlock_irq(&buf->list_lock);
+
+	return !empty;
+}
+
+static int iio_block_buf_enable(struct iio_buffer *r,
+				struct iio_dev *indio_dev)
+{
+	struct iio_block_buf *buf = iio_to_block_buf(r);
+	int ret = 0;
+
+	mutex_lock(&buf->lock);
+	if (!buf->ops && buf->num_blocks &&
+	    buf->blocks[0]->block.size < r->bytes_per_datum) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	buf->active = true;
+	iio_block_buf_submit_queued(buf);
+out:
+	mutex_unlock(&buf->lock);
+	return ret;
+}
+
+static void iio_block_buf_disable(struct iio_buffer *r,
+				  struct iio_dev *indio_dev)
+{
+	struct iio_block_buf *buf = iio_to_block_buf(r);
+	struct iio_block_buf_block *block;
+	unsigned int i;
+
+	mutex_lock(&buf->lock);
+	if (!buf->active)
+		goto out;
+
+	buf->active = false;
+	if (buf->ops && buf->ops->abort)
+		buf->ops->abort(buf);
+
+	spin_lock_irq(&buf->list_lock);
+	for (i = 0; i < buf->num_blocks; i++) {
+		block = buf->blocks[i];
+		if (block->state != IIO_BLOCK_STATE_ACTIVE)
+			continue;
+
+		/* Hand over what was captured, keep empty blocks queued */
+		if (block->block.bytes_used) {
+			__iio_block_buf_block_done(block,
+					block->block.bytes_used,
+					IIO_BUFFER_BLOCK_FLAG_PARTIAL);
+		} else {
+			block->state = IIO_BLOCK_STATE_QUEUED;
+			list_add_tail(&block->head, &buf->incoming);
+		}
+	}
+	buf->fill = NULL;
+	spin_unlock_irq(&buf->list_lock);
+
+	wake_up_interruptible_poll(&r->pollq, POLLIN | POLLRDNORM);
+out:
+	mutex_unlock(&buf->lock);
+}
+
+static void iio_block_buf_vm_open(struct vm_area_struct *vma)
+{
+	struct iio_block_buf_block *block = vma->vm_private_data;
+
+	kref_get(&block->kref);
+}
+
+static void iio_block_buf_vm_close(struct vm_area_struct *vma)
+{
+	iio_block_buf_block_put(vma->vm_private_data);
+}
+
+static const struct vm_operations_struct iio_block_buf_vm_ops = {
+	.open = iio_block_buf_vm_open,
+	.close = iio_block_buf_vm_close,
+};
+
+static int iio_block_buf_mmap(struct iio_buffer *r, struct vm_area_struct *vma)
+{
+	struct iio_block_buf *buf = iio_to_block_buf(r);
+	unsigned long offset = vma->vm_pgoff << PAGE_SHIFT;
+	struct iio_block_buf_block *block;
+	unsigned int id;
+	int ret;
+
+	if (!(vma->vm_flags & VM_SHARED))
+		return -EINVAL;
+
+	mutex_lock(&buf->lock);
+	if (!buf->num_blocks || offset % buf->block_size) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	id = offset / buf->block_size;
+	if (id >= buf->num_blocks ||
+	    vma->vm_end - vma->vm_start != buf->block_size) {
+		ret = -EINVAL;
+		goto out;
+	}
+	block = buf->blocks[id];
+
+	/* dma_mmap_coherent() maps from the start of the block on */
+	vma->vm_pgoff = 0;
+	vma->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+	vma->vm_private_data = block;
+	vma->vm_ops = &iio_block_buf_vm_ops;
+
+	ret = dma_mmap_coherent(buf->dev, vma, block->vaddr,
+				block->phys_addr, buf->block_size);
+	if (!ret)
+		kref_get(&block->kref);
+out:
+	mutex_unlock(&buf->lock);
+	return ret;
+}
+
+static ssize_t iio_block_buf_watermark_show(struct device *dev,
+					    struct device_attribute *attr,
+					    char *buf)
+{
+	struct iio_dev *indio_dev = dev_to_iio_dev(dev);
+	struct iio_block_buf *bb = iio_to_block_buf(indio_dev->buffer);
+
+	return sprintf(buf, "%u\n", bb->watermark);
+}
+
+static ssize_t iio_block_buf_watermark_store(struct device *dev,
+					     struct device_attribute *attr,
+					     const char *buf, size_t len)
+{
+	struct iio_dev *indio_dev = dev_to_iio_dev(dev);
+	struct iio_block_buf *bb = iio_to_block_buf(indio_dev->buffer);
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint(buf, 10, &val);
+	if (ret)
+		return ret;
+
+	spin_lock_irq(&bb->list_lock);
+	bb->watermark = val;
+	spin_unlock_irq(&bb->list_lock);
+
+	return len;
+}
+
+static int iio_get_length_block_buf(struct iio_buffer *r)
+{
+	return r->length;
+}
+
+static int iio_set_length_block_buf(struct iio_buffer *r, int length)
+{
+	r->length = length;
+	return 0;
+}
+
+static int iio_get_bytes_per_datum_block_buf(struct iio_buffer *r)
+{
+	return r->bytes_per_datum;
+}
+
+static int iio_set_bytes_per_datum_block_buf(struct iio_buffer *r, size_t bpd)
+{
+	r->bytes_per_datum = bpd;
+	return 0;
+}
+
+static IIO_BUFFER_ENABLE_ATTR;
+static IIO_BUFFER_LENGTH_ATTR;
+static DEVICE_ATTR(watermark, S_IRUGO | S_IWUSR,
+		   iio_block_buf_watermark_show,
+		   iio_block_buf_watermark_store);
+
+static struct attribute *iio_block_buf_attributes[] = {
+	&dev_attr_length.attr,
+	&dev_attr_enable.attr,
+	&dev_attr_watermark.attr,
+	NULL,
+};
+
+static struct attribute_group iio_block_buf_attribute_group = {
+	.attrs = iio_block_buf_attributes,
+	.name = "buffer",
+};
+
+static void iio_block_buf_release(struct iio_buffer *r)
+{
+	struct iio_block_buf *buf = iio_to_block_buf(r);
+
+	put_device(buf->dev);
+	mutex_destroy(&buf->lock);
+	kfree(buf);
+}
+
+static const struct iio_buffer_access_funcs block_buf_access_funcs = {
+	.store_to = &iio_store_to_block_buf,
+	.data_available = &iio_block_buf_data_available,
+	.get_bytes_per_datum = &iio_get_bytes_per_datum_block_buf,
+	.set_bytes_per_datum = &iio_set_bytes_per_datum_block_buf,
+	.get_length = &iio_get_length_block_buf,
+	.set_length = &iio_set_length_block_buf,
+	.release = &iio_block_buf_release,
+	.enable = &iio_block_buf_enable,
+	.disable = &iio_block_buf_disable,
+	.alloc_blocks = &iio_block_buf_alloc_blocks,
+	.free_blocks = &iio_block_buf_free_blocks,
+	.query_block = &iio_block_buf_query_block,
+	.enqueue_block = &iio_block_buf_enqueue_block,
+	.dequeue_block = &iio_block_buf_dequeue_block,
+	.mmap = &iio_block_buf_mmap,
+};
+
+/**
+ * iio_block_buf_allocate() - allocate a block buffer
+ * @dma_dev:	device the blocks are allocated and mapped for
+ * @ops:	DMA hooks, NULL if the buffer is filled through
+ *		iio_push_to_buffers()
+ * @driver_data: returned by iio_block_buf_get_drvdata()
+ */
+struct iio_buffer *iio_block_buf_allocate(struct device *dma_dev,
+					  const struct iio_block_buf_ops *ops,
+					  void *driver_data)
+{
+	struct iio_block_buf *buf;
+
+	buf = kzalloc(sizeof(*buf), GFP_KERNEL);
+	if (!buf)
+		return NULL;
+
+	iio_buffer_init(&buf->buffer);
+	buf->buffer.attrs = &iio_block_buf_attribute_group;
+	buf->buffer.access = &block_buf_access_funcs;
+	buf->dev = get_device(dma_dev);
+	buf->ops = ops;
+	buf->driver_data = driver_data;
+	mutex_init(&buf->lock);
+	spin_lock_init(&buf->list_lock);
+	INIT_LIST_HEAD(&buf->incoming);
+	INIT_LIST_HEAD(&buf->outgoing);
+
+	return &buf->buffer;
+}
+EXPORT_SYMBOL_GPL(iio_block_buf_allocate);
+
+/**
+ * iio_block_buf_free() - free a block buffer
+ * @r:		buffer from iio_block_buf_allocate(), no longer enabled
+ *
+ * Blocks still mapped by user space are freed when they are unmapped.
+ */
+void iio_block_buf_free(struct iio_buffer *r)
+{
+	struct iio_block_buf *buf = iio_to_block_buf(r);
+
+	mutex_lock(&buf->lock);
+	iio_block_buf_drop_blocks(buf);
+	mutex_unlock(&buf->lock);
+
+	iio_buffer_put(r);
+}
+EXPORT_SYMBOL_GPL(iio_block_buf_free);
+
+MODULE_LICENSE("GPL");
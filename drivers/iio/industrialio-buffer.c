@@ -21,11 +21,14 @@
 #include <linux/slab.h>
 #include <linux/poll.h>
 #include <linux/sched.h>
+#include <linux/mm.h>
+#include <linux/uaccess.h>
 
 #include <linux/iio/iio.h>
 #include "iio_core.h"
 #include <linux/iio/sysfs.h>
 #include <linux/iio/buffer.h>
+#include <linux/iio/block_buf.h>
 
 static const char * const iio_endian_prefix[] = {
 	[IIO_BE] = "be",
@@ -83,6 +86,97 @@ ssize_t iio_buffer_read_first_n_outer(struct file *filp, char __user *buf,
 	return ret;
 }
 
+/**
+ * iio_buffer_mmap() - chrdev mmap of a block of the buffer
+ */
+int iio_buffer_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct iio_dev *indio_dev = filp->private_data;
+	struct iio_buffer *rb = indio_dev->buffer;
+
+	if (!indio_dev->info)
+		return -ENODEV;
+
+	if (!rb || !rb->access->mmap)
+		return -ENODEV;
+
+	return rb->access->mmap(rb, vma);
+}
+
+static int iio_buffer_dequeue_block(struct file *filp,
+				    struct iio_dev *indio_dev,
+				    struct iio_buffer_block *block)
+{
+	struct iio_buffer *rb = indio_dev->buffer;
+	int ret;
+
+	for (;;) {
+		ret = rb->access->dequeue_block(rb, block);
+		if (ret != -EAGAIN || (filp->f_flags & O_NONBLOCK))
+			return ret;
+
+		ret = wait_event_interruptible(rb->pollq,
+				iio_buffer_data_available(rb) ||
+				indio_dev->info == NULL);
+		if (ret)
+			return ret;
+		if (indio_dev->info == NULL)
+			return -ENODEV;
+	}
+}
+
+/**
+ * iio_buffer_ioctl() - block interface ioctls of the buffer chrdev
+ */
+long iio_buffer_ioctl(struct iio_dev *indio_dev, struct file *filp,
+		      unsigned int cmd, unsigned long arg)
+{
+	const struct iio_buffer_access_funcs *access;
+	struct iio_buffer *rb = indio_dev->buffer;
+	struct iio_buffer_block_alloc_req req;
+	struct iio_buffer_block block;
+	void __user *argp = (void __user *)arg;
+	int ret;
+
+	if (!rb || !rb->access->alloc_blocks)
+		return -EINVAL;
+	access = rb->access;
+
+	switch (cmd) {
+	case IIO_BUFFER_BLOCK_ALLOC_IOCTL:
+		if (copy_from_user(&req, argp, sizeof(req)))
+			return -EFAULT;
+		ret = access->alloc_blocks(rb, &req);
+		if (ret)
+			return ret;
+		if (copy_to_user(argp, &req, sizeof(req)))
+			return -EFAULT;
+		return 0;
+	case IIO_BUFFER_BLOCK_FREE_IOCTL:
+		return access->free_blocks(rb);
+	case IIO_BUFFER_BLOCK_QUERY_IOCTL:
+		if (copy_from_user(&block, argp, sizeof(block)))
+			return -EFAULT;
+		ret = access->query_block(rb, &block);
+		break;
+	case IIO_BUFFER_BLOCK_ENQUEUE_IOCTL:
+		if (copy_from_user(&block, argp, sizeof(block)))
+			return -EFAULT;
+		return access->enqueue_block(rb, &block);
+	case IIO_BUFFER_BLOCK_DEQUEUE_IOCTL:
+		ret = iio_buffer_dequeue_block(filp, indio_dev, &block);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if (ret)
+		return ret;
+	if (copy_to_user(argp, &block, sizeof(block)))
+		return -EFAULT;
+	return 0;
+}
+
 /**
  * iio_buffer_poll() - poll the buffer to find out if it has data
  */
@@ -516,6 +610,15 @@ static void iio_buffer_deactivate(struct iio_buffer *buffer)
 	iio_buffer_put(buffer);
 }
 
+static void iio_buffers_disable(struct iio_dev *indio_dev)
+{
+	struct iio_buffer *buffer;
+
+	list_for_each_entry(buffer, &indio_dev->buffer_list, buffer_list)
+		if (buffer->access->disable)
+			buffer->access->disable(buffer, indio_dev);
+}
+
 void iio_disable_all_buffers(struct iio_dev *indio_dev)
 {
 	struct iio_buffer *buffer, *_buffer;
@@ -525,6 +628,7 @@ void iio_disable_all_buffers(struct iio_dev *indio_dev)
 
 	if (indio_dev->setup_ops->predisable)
 		indio_dev->setup_ops->predisable(indio_dev);
+	iio_buffers_disable(indio_dev);
 
 	list_for_each_entry_safe(buffer, _buffer,
 			&indio_dev->buffer_list, buffer_list)
@@ -569,6 +673,7 @@ static int __iio_update_buffers(struct iio_dev *indio_dev,
 			if (ret)
 				return ret;
 		}
+		iio_buffers_disable(indio_dev);
 		indio_dev->currentmode = INDIO_DIRECT_MODE;
 		if (indio_dev->setup_ops->postdisable) {
 			ret = indio_dev->setup_ops->postdisable(indio_dev);
@@ -685,11 +790,24 @@ static int __iio_update_buffers(struct iio_dev *indio_dev,
 		goto error_run_postdisable;
 	}
 
+	list_for_each_entry(buffer, &indio_dev->buffer_list, buffer_list) {
+		if (!buffer->access->enable)
+			continue;
+		ret = buffer->access->enable(buffer, indio_dev);
+		if (ret) {
+			printk(KERN_INFO
+			       "Buffer not started: buffer enable failed (%d)\n", ret);
+			iio_buffers_disable(indio_dev);
+			goto error_disable_all_buffers;
+		}
+	}
+
 	if (indio_dev->setup_ops->postenable) {
 		ret = indio_dev->setup_ops->postenable(indio_dev);
 		if (ret) {
 			printk(KERN_INFO
 			       "Buffer not started: postenable failed (%d)\n", ret);
+			iio_buffers_disable(indio_dev);
 			indio_dev->currentmode = INDIO_DIRECT_MODE;
 			if (indio_dev->setup_ops->postdisable)
 				indio_dev->setup_ops->postdisable(indio_dev);
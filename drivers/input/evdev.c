@@ -14,6 +14,9 @@
 #define EVDEV_MINORS		32
 #define EVDEV_MIN_BUFFER_SIZE	64U
 #define EVDEV_BUF_PACKETS	8
+#define EVDEV_MAX_RING_SIZE	65536U
+#define EVDEV_RING_OFFSET	ALIGN(sizeof(struct input_event_ring), \
+				      SMP_CACHE_BYTES)
 
 #include <linux/poll.h>
 #include <linux/sched.h>
@@ -32,7 +35,6 @@
 struct evdev {
 	int open;
 	struct input_handle handle;
-	wait_queue_head_t wait;
 	struct evdev_client __rcu *grab;
 	struct list_head client_list;
 	spinlock_t client_lock; /* protects client_list */
@@ -47,6 +49,13 @@ struct evdev_client {
 	unsigned int tail;
 	unsigned int packet_head; /* [future] position of the first element of next packet */
 	spinlock_t buffer_lock; /* protects access to buffer, head and tail */
+	wait_queue_head_t wait;
+	/* mmap event ring, replaces buffer once set; the ring_* below too */
+	struct input_event_ring *ring;
+	unsigned int ring_size;
+	unsigned int ring_head; /* next event to write */
+	unsigned int ring_packet; /* end of the last published packet */
+	bool ring_dropping; /* rest of the current packet is dropped */
 	struct wake_lock wake_lock;
 	bool use_wake_lock;
 	char name[28];
@@ -165,31 +174,88 @@ static void __pass_event(struct evdev_client *client,
 	}
 }
 
+static struct input_ring_event *evdev_ring_event(struct evdev_client *client,
+						 unsigned int idx)
+{
+	struct input_ring_event *events =
+		(void *)client->ring + EVDEV_RING_OFFSET;
+
+	return &events[idx & (client->ring_size - 1)];
+}
+
+/*
+ * Queue an event to the mmap ring, caller must hold client->buffer_lock.
+ * Returns true when the event completed a packet and published it.
+ */
+static bool __pass_ring_event(struct evdev_client *client,
+			      const struct input_value *v, u64 time)
+{
+	struct input_event_ring *ring = client->ring;
+	struct input_ring_event *ev;
+	bool is_report = v->type == EV_SYN && v->code == SYN_REPORT;
+
+	/* the header is user writable, only trust our own copies */
+	if (!client->ring_dropping &&
+	    client->ring_head - ACCESS_ONCE(ring->tail) >= client->ring_size) {
+		client->ring_head = client->ring_packet;
+		client->ring_dropping = true;
+		ring->dropped++;
+	}
+
+	if (client->ring_dropping) {
+		if (is_report)
+			client->ring_dropping = false;
+		return false;
+	}
+
+	ev = evdev_ring_event(client, client->ring_head++);
+	ev->time = time;
+	ev->type = v->type;
+	ev->code = v->code;
+	ev->value = v->value;
+
+	if (!is_report)
+		return false;
+
+	client->ring_packet = client->ring_head;
+	/* the events of the packet must be visible before the new head */
+	smp_wmb();
+	ring->head = client->ring_packet;
+	kill_fasync(&client->fasync, SIGIO, POLL_IN);
+
+	return true;
+}
+
 static void evdev_pass_values(struct evdev_client *client,
 			const struct input_value *vals, unsigned int count,
 			ktime_t mono, ktime_t real)
 {
-	struct evdev *evdev = client->evdev;
 	const struct input_value *v;
 	struct input_event event;
 	bool wakeup = false;
+	ktime_t time;
 
 	if (client->revoked)
 		return;
 
-	event.time = ktime_to_timeval(client->clkid == CLOCK_MONOTONIC ?
-				      mono : real);
+	time = client->clkid == CLOCK_MONOTONIC ? mono : real;
+	event.time = ktime_to_timeval(time);
 
 	/* Interrupts are disabled, just acquire the lock. */
 	spin_lock(&client->buffer_lock);
 
 	for (v = vals; v != vals + count; v++) {
-		event.type = v->type;
-		event.code = v->code;
-		event.value = v->value;
-		__pass_event(client, &event);
-		if (v->type == EV_SYN && v->code == SYN_REPORT)
-			wakeup = true;
+		if (client->ring) {
+			if (__pass_ring_event(client, v, ktime_to_ns(time)))
+				wakeup = true;
+		} else {
+			event.type = v->type;
+			event.code = v->code;
+			event.value = v->value;
+			__pass_event(client, &event);
+			if (v->type == EV_SYN && v->code == SYN_REPORT)
+				wakeup = true;
+		}
 #ifdef CONFIG_USB_HMT_SAMSUNG_INPUT
 		if (v->type== EV_KEY && v->code >= KEY_HMT_CMD_START)
 			pr_info("%s type:KEY code:0x%x value:%x\n", __func__,
@@ -200,7 +266,7 @@ static void evdev_pass_values(struct evdev_client *client,
 	spin_unlock(&client->buffer_lock);
 
 	if (wakeup)
-		wake_up_interruptible(&evdev->wait);
+		wake_up_interruptible(&client->wait);
 }
 
 /*
@@ -361,11 +427,11 @@ static void evdev_hangup(struct evdev *evdev)
 	struct evdev_client *client;
 
 	spin_lock(&evdev->client_lock);
-	list_for_each_entry(client, &evdev->client_list, node)
+	list_for_each_entry(client, &evdev->client_list, node) {
 		kill_fasync(&client->fasync, SIGIO, POLL_HUP);
+		wake_up_interruptible(&client->wait);
+	}
 	spin_unlock(&evdev->client_lock);
-
-	wake_up_interruptible(&evdev->wait);
 }
 
 static int evdev_release(struct inode *inode, struct file *file)
@@ -382,6 +448,9 @@ static int evdev_release(struct inode *inode, struct file *file)
 	if (client->use_wake_lock)
 		wake_lock_destroy(&client->wake_lock);
 
+	/* mappings of the ring hold the file, so they are all gone */
+	vfree(client->ring);
+
 	if (is_vmalloc_addr(client))
 		vfree(client);
 	else
@@ -418,6 +487,7 @@ static int evdev_open(struct inode *inode, struct file *file)
 
 	client->bufsize = bufsize;
 	spin_lock_init(&client->buffer_lock);
+	init_waitqueue_head(&client->wait);
 	snprintf(client->name, sizeof(client->name), "%s-%d",
 			dev_name(&evdev->dev), task_tgid_vnr(current));
 	client->evdev = evdev;
@@ -508,6 +578,10 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 	if (count != 0 && count < input_event_size())
 		return -EINVAL;
 
+	/* events go to the mmap ring instead */
+	if (smp_load_acquire(&client->ring))
+		return -EINVAL;
+
 	for (;;) {
 		if (!evdev->exist || client->revoked)
 			return -ENODEV;
@@ -536,7 +610,7 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 			break;
 
 		if (!(file->f_flags & O_NONBLOCK)) {
-			error = wait_event_interruptible(evdev->wait,
+			error = wait_event_interruptible(client->wait,
 					client->packet_head != client->tail ||
 					!evdev->exist || client->revoked);
 			if (error)
@@ -552,21 +626,38 @@ static unsigned int evdev_poll(struct file *file, poll_table *wait)
 {
 	struct evdev_client *client = file->private_data;
 	struct evdev *evdev = client->evdev;
+	struct input_event_ring *ring;
 	unsigned int mask;
 
-	poll_wait(file, &evdev->wait, wait);
+	poll_wait(file, &client->wait, wait);
 
 	if (evdev->exist && !client->revoked)
 		mask = POLLOUT | POLLWRNORM;
 	else
 		mask = POLLHUP | POLLERR;
 
-	if (client->packet_head != client->tail)
+	ring = smp_load_acquire(&client->ring);
+	if (ring) {
+		if (ACCESS_ONCE(ring->tail) != ACCESS_ONCE(client->ring_packet))
+			mask |= POLLIN | POLLRDNORM;
+	} else if (client->packet_head != client->tail) {
 		mask |= POLLIN | POLLRDNORM;
+	}
 
 	return mask;
 }
 
+static int evdev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct evdev_client *client = file->private_data;
+	struct input_event_ring *ring = smp_load_acquire(&client->ring);
+
+	if (!ring)
+		return -EINVAL;
+
+	return remap_vmalloc_range(vma, ring, vma->vm_pgoff);
+}
+
 #ifdef CONFIG_COMPAT
 
 #define BITS_PER_LONG_COMPAT (sizeof(compat_long_t) * 8)
@@ -822,7 +913,7 @@ static int evdev_revoke(struct evdev *evdev, struct evdev_client *client,
 	client->revoked = true;
 	evdev_ungrab(evdev, client);
 	input_flush_device(&evdev->handle, file);
-	wake_up_interruptible(&evdev->wait);
+	wake_up_interruptible(&client->wait);
 
 	return 0;
 }
@@ -857,6 +948,44 @@ static int evdev_disable_suspend_block(struct evdev *evdev,
 	return 0;
 }
 
+/*
+ * Switch the client over to an mmap event ring. This is one way: the
+ * ring stays until the file is released.
+ */
+static int evdev_enable_ring(struct evdev_client *client, unsigned int size)
+{
+	struct input_event_ring *ring;
+
+	if (client->ring)
+		return -EBUSY;
+
+	if (size < EVDEV_MIN_BUFFER_SIZE || size > EVDEV_MAX_RING_SIZE ||
+	    !is_power_of_2(size))
+		return -EINVAL;
+
+	ring = vmalloc_user(EVDEV_RING_OFFSET +
+			    size * sizeof(struct input_ring_event));
+	if (!ring)
+		return -ENOMEM;
+
+	ring->size = size;
+	ring->offset = EVDEV_RING_OFFSET;
+
+	spin_lock_irq(&client->buffer_lock);
+	/* drop what is queued for read(), user space resyncs anyway */
+	client->head = client->tail = client->packet_head = 0;
+	if (client->use_wake_lock)
+		wake_unlock(&client->wake_lock);
+	client->ring_size = size;
+	client->ring_head = 0;
+	client->ring_packet = 0;
+	client->ring_dropping = false;
+	smp_store_release(&client->ring, ring);
+	spin_unlock_irq(&client->buffer_lock);
+
+	return 0;
+}
+
 static long evdev_do_ioctl(struct file *file, unsigned int cmd,
 			   void __user *p, int compat_mode)
 {
@@ -938,6 +1067,11 @@ static long evdev_do_ioctl(struct file *file, unsigned int cmd,
 		client->clkid = i;
 		return 0;
 
+	case EVIOCSRING:
+		if (copy_from_user(&i, p, sizeof(unsigned int)))
+			return -EFAULT;
+		return evdev_enable_ring(client, i);
+
 	case EVIOCGKEYCODE:
 		return evdev_handle_get_keycode(dev, p);
 
@@ -1116,6 +1250,7 @@ static const struct file_operations evdev_fops = {
 	.read		= evdev_read,
 	.write		= evdev_write,
 	.poll		= evdev_poll,
+	.mmap		= evdev_mmap,
 	.open		= evdev_open,
 	.release	= evdev_release,
 	.unlocked_ioctl	= evdev_ioctl,
@@ -1183,7 +1318,6 @@ static int evdev_connect(struct input_handler *handler, struct input_dev *dev,
 	INIT_LIST_HEAD(&evdev->client_list);
 	spin_lock_init(&evdev->client_lock);
 	mutex_init(&evdev->mutex);
-	init_waitqueue_head(&evdev->wait);
 	evdev->exist = true;
 
 	dev_no = minor;
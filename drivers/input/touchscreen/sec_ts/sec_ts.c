@@ -959,6 +959,23 @@ void sec_ts_reinit(struct sec_ts_data *ts)
 	return;
 }
 
+/* Account the time from the interrupt to the input_sync of its events */
+static void sec_ts_account_latency(struct sec_ts_data *ts)
+{
+	u32 us;
+
+	if (!ts->irq_time.tv64)
+		return;
+
+	us = ktime_us_delta(ktime_get(), ts->irq_time);
+	ts->irq_time.tv64 = 0;
+
+	ts->latency_last = us;
+	ts->latency_max = max(ts->latency_max, us);
+	ts->latency_total += us;
+	ts->latency_count++;
+}
+
 #define MAX_EVENT_COUNT 32
 static void sec_ts_read_event(struct sec_ts_data *ts)
 {
@@ -1460,6 +1477,7 @@ static void sec_ts_read_event(struct sec_ts_data *ts)
 	} while (remain_event_count >= 0);
 
 	input_sync(ts->input_dev);
+	sec_ts_account_latency(ts);
 }
 
 static irqreturn_t sec_ts_irq_thread(int irq, void *ptr)
@@ -1487,6 +1505,45 @@ static irqreturn_t sec_ts_irq_thread(int irq, void *ptr)
 	return IRQ_HANDLED;
 }
 
+static irqreturn_t sec_ts_irq_handler(int irq, void *ptr)
+{
+	struct sec_ts_data *ts = (struct sec_ts_data *)ptr;
+
+	ts->irq_time = ktime_get();
+
+	return IRQ_WAKE_THREAD;
+}
+
+/*
+ * Threaded handler as registered: the first run raises the irq thread to
+ * its real time priority, and every run keeps the PM QoS vote, if any,
+ * for a while so the i2c transfers of a touch stream don't pay the
+ * idle exit latency.
+ */
+static irqreturn_t sec_ts_irq_thread_fn(int irq, void *ptr)
+{
+	struct sec_ts_data *ts = (struct sec_ts_data *)ptr;
+	struct sched_param param = {
+		.sched_priority = ts->plat_data->irq_thread_prio,
+	};
+
+	if (unlikely(!ts->irq_thread_boosted)) {
+		ts->irq_thread_boosted = true;
+		if (param.sched_priority &&
+		    sched_setscheduler(current, SCHED_FIFO, &param))
+			input_err(true, &ts->client->dev,
+				  "%s: failed to set irq thread priority\n",
+				  __func__);
+	}
+
+	if (ts->plat_data->pm_qos_latency)
+		pm_qos_update_request_timeout(&ts->pm_qos_req,
+					      ts->plat_data->pm_qos_latency,
+					      SEC_TS_PM_QOS_HOLD_US);
+
+	return sec_ts_irq_thread(irq, ptr);
+}
+
 int get_tsp_status(void)
 {
 	return 0;
@@ -1814,6 +1871,17 @@ static int sec_ts_parse_dt(struct i2c_client *client)
 				pdata->irq_type, pdata->irq_type);
 	}
 
+	if (of_property_read_u32(np, "sec,irq-thread-prio",
+				 &pdata->irq_thread_prio))
+		pdata->irq_thread_prio = SEC_TS_IRQ_THREAD_PRIO;
+	else if (pdata->irq_thread_prio >= MAX_USER_RT_PRIO)
+		pdata->irq_thread_prio = MAX_USER_RT_PRIO - 1;
+
+	/* cpu_dma_latency to hold while touch is active, in us; 0: none */
+	if (of_property_read_u32(np, "sec,pm-qos-latency-us",
+				 &pdata->pm_qos_latency))
+		pdata->pm_qos_latency = 0;
+
 	if (of_property_read_u32(np, "sec,i2c-burstmax", &pdata->i2c_burstmax)) {
 		input_dbg(false, &client->dev, "%s: Failed to get i2c_burstmax property\n", __func__);
 		pdata->i2c_burstmax = 256;
@@ -2402,8 +2470,13 @@ static int sec_ts_probe(struct i2c_client *client, const struct i2c_device_id *i
 
 	input_info(true, &ts->client->dev, "%s: request_irq = %d\n", __func__, client->irq);
 
-	ret = request_threaded_irq(client->irq, NULL, sec_ts_irq_thread,
-			ts->plat_data->irq_type, SEC_TS_I2C_NAME, ts);
+	if (ts->plat_data->pm_qos_latency)
+		pm_qos_add_request(&ts->pm_qos_req, PM_QOS_CPU_DMA_LATENCY,
+				   PM_QOS_DEFAULT_VALUE);
+
+	ret = request_threaded_irq(client->irq, sec_ts_irq_handler,
+			sec_ts_irq_thread_fn, ts->plat_data->irq_type,
+			SEC_TS_I2C_NAME, ts);
 	if (ret < 0) {
 		input_err(true, &ts->client->dev, "%s: Unable to request threaded irq\n", __func__);
 		goto err_irq;
@@ -2467,6 +2540,8 @@ static int sec_ts_probe(struct i2c_client *client, const struct i2c_device_id *i
 	free_irq(client->irq, ts);
 #endif
 err_irq:
+	if (ts->plat_data->pm_qos_latency)
+		pm_qos_remove_request(&ts->pm_qos_req);
 	if (ts->plat_data->support_dex) {
 		input_unregister_device(ts->input_dev_pad);
 		ts->input_dev_pad = NULL;
@@ -2943,6 +3018,8 @@ static int sec_ts_remove(struct i2c_client *client)
 
 	disable_irq_nosync(ts->client->irq);
 	free_irq(ts->client->irq, ts);
+	if (ts->plat_data->pm_qos_latency)
+		pm_qos_remove_request(&ts->pm_qos_req);
 	input_info(true, &ts->client->dev, "%s: irq disabled\n", __func__);
 
 #ifdef USE_POWER_RESET_WORK
@@ -31,7 +31,9 @@
 #include <linux/module.h>
 #include <linux/of_gpio.h>
 #include <linux/platform_device.h>
+#include <linux/pm_qos.h>
 #include <linux/regulator/consumer.h>
+#include <linux/sched.h>
 #include <linux/slab.h>
 #include <linux/time.h>
 #include <linux/uaccess.h>
@@ -67,6 +69,11 @@
 #define SEC_TS_I2C_NAME		"sec_ts"
 #define SEC_TS_DEVICE_NAME	"SEC_TS"
 
+/* one above the other irq threads, see irq_thread() */
+#define SEC_TS_IRQ_THREAD_PRIO		(MAX_USER_RT_PRIO / 2 + 1)
+/* how long the PM QoS vote outlives the last touch interrupt */
+#define SEC_TS_PM_QOS_HOLD_US		(100 * USEC_PER_MSEC)
+
 #define USE_OPEN_CLOSE
 #undef USE_RESET_DURING_POWER_ON
 #undef USE_RESET_EXIT_LPM
@@ -696,6 +703,14 @@ struct sec_ts_data {
 	struct mutex eventlock;
 	struct mutex modechange;
 
+	ktime_t irq_time;		/* hard irq time of pending events */
+	bool irq_thread_boosted;
+	struct pm_qos_request pm_qos_req;
+	unsigned int latency_count;	/* irq to input_sync, in us */
+	u32 latency_last;
+	u32 latency_max;
+	u64 latency_total;
+
 	int nv;
 	int disassemble_count;
 
@@ -819,6 +834,8 @@ struct sec_ts_plat_data {
 	int max_y;
 	unsigned irq_gpio;
 	int irq_type;
+	u32 irq_thread_prio;
+	u32 pm_qos_latency;
 	int i2c_burstmax;
 	int always_lpmode;
 	int bringup;
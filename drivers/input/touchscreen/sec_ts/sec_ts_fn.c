@@ -443,6 +443,46 @@ static ssize_t clear_comm_err_count_store(struct device *dev,
 	return count;
 }
 
+static ssize_t read_irq_latency_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct sec_cmd_data *sec = dev_get_drvdata(dev);
+	struct sec_ts_data *ts = container_of(sec, struct sec_ts_data, sec);
+	unsigned int count;
+	u32 last, max;
+	u64 avg;
+
+	mutex_lock(&ts->eventlock);
+	count = ts->latency_count;
+	last = ts->latency_last;
+	max = ts->latency_max;
+	avg = count ? div_u64(ts->latency_total, count) : 0;
+	mutex_unlock(&ts->eventlock);
+
+	/* interrupt to input_sync, in us */
+	return snprintf(buf, SEC_CMD_BUF_SIZE, "count:%u last:%u max:%u avg:%llu",
+			count, last, max, avg);
+}
+
+static ssize_t clear_irq_latency_store(struct device *dev,
+		struct device_attribute *attr,
+		const char *buf, size_t count)
+{
+	struct sec_cmd_data *sec = dev_get_drvdata(dev);
+	struct sec_ts_data *ts = container_of(sec, struct sec_ts_data, sec);
+
+	mutex_lock(&ts->eventlock);
+	ts->latency_count = 0;
+	ts->latency_last = 0;
+	ts->latency_max = 0;
+	ts->latency_total = 0;
+	mutex_unlock(&ts->eventlock);
+
+	input_info(true, &ts->client->dev, "%s: clear\n", __func__);
+
+	return count;
+}
+
 static ssize_t read_module_id_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -1422,6 +1462,7 @@ static DEVICE_ATTR(multi_count, 0664, read_multi_count_show, clear_multi_count_s
 static DEVICE_ATTR(wet_mode, 0664, read_wet_mode_show, clear_wet_mode_store);
 static DEVICE_ATTR(noise_mode, 0664, read_noise_mode_show, clear_noise_mode_store);
 static DEVICE_ATTR(comm_err_count, 0664, read_comm_err_count_show, clear_comm_err_count_store);
+static DEVICE_ATTR(irq_latency, 0664, read_irq_latency_show, clear_irq_latency_store);
 static DEVICE_ATTR(checksum, 0664, read_checksum_show, clear_checksum_store);
 static DEVICE_ATTR(holding_time, 0664, read_holding_time_show, clear_holding_time_store);
 static DEVICE_ATTR(all_touch_count, 0664, read_all_touch_count_show, clear_all_touch_count_store);
@@ -1453,6 +1494,7 @@ static struct attribute *cmd_attributes[] = {
 	&dev_attr_wet_mode.attr,
 	&dev_attr_noise_mode.attr,
 	&dev_attr_comm_err_count.attr,
+	&dev_attr_irq_latency.attr,
 	&dev_attr_checksum.attr,
 	&dev_attr_holding_time.attr,
 	&dev_attr_all_touch_count.attr,
@@ -464,6 +464,7 @@ struct arm_smmu_domain {
 	struct mutex			assign_lock;
 	struct list_head		secure_pool_list;
 	bool				non_fatal_faults;
+	bool				gather_tlbi; /* under pgtbl lock */
 };
 
 static struct iommu_ops arm_smmu_ops;
@@ -1045,6 +1046,23 @@ static void arm_smmu_flush_pgtable(void *addr, size_t size, void *cookie)
 	}
 }
 
+/*
+ * Called by the page table code after an unmap.  Domains that set
+ * DOMAIN_ATTR_DEFER_TLBI batch their invalidations and issue them through
+ * iommu_tlbiall() themselves, and unmap_nosync callers through
+ * iommu_iotlb_sync().
+ */
+static void arm_smmu_tlb_flush_all(void *cookie)
+{
+	struct arm_smmu_domain *smmu_domain = cookie;
+
+	if (smmu_domain->attributes & (1 << DOMAIN_ATTR_DEFER_TLBI) ||
+	    smmu_domain->gather_tlbi)
+		return;
+
+	arm_smmu_tlb_inv_context(cookie);
+}
+
 static void arm_smmu_tlbi_domain(struct iommu_domain *domain)
 {
 	arm_smmu_tlb_inv_context(domain->priv);
@@ -1151,7 +1169,7 @@ static void arm_smmu_free_pages_exact(void *cookie, void *virt, size_t size)
 }
 
 static struct iommu_gather_ops arm_smmu_gather_ops = {
-	.tlb_flush_all	= arm_smmu_tlb_inv_context,
+	.tlb_flush_all	= arm_smmu_tlb_flush_all,
 	.tlb_add_flush	= arm_smmu_tlb_inv_range_nosync,
 	.tlb_sync	= arm_smmu_tlb_sync,
 	.flush_pgtable	= arm_smmu_flush_pgtable,
@@ -1735,6 +1753,10 @@ static int arm_smmu_init_domain_context(struct iommu_domain *domain,
 			.oas		= oas,
 			.tlb		= &arm_smmu_gather_ops,
 		};
+
+		if (smmu_domain->attributes & (1 << DOMAIN_ATTR_CONT_HINT))
+			smmu_domain->pgtbl_cfg.quirks |=
+				IO_PGTABLE_QUIRK_CONT_HINT;
 	}
 
 	if (is_fast)
@@ -2498,8 +2520,8 @@ out:
 	return ret;
 }
 
-static size_t arm_smmu_unmap(struct iommu_domain *domain, unsigned long iova,
-			     size_t size)
+static size_t __arm_smmu_unmap(struct iommu_domain *domain,
+			       unsigned long iova, size_t size, bool nosync)
 {
 	size_t ret;
 	unsigned long flags;
@@ -2543,8 +2565,15 @@ static size_t arm_smmu_unmap(struct iommu_domain *domain, unsigned long iova,
 		}
 	}
 
+	/*
+	 * Table pages freed here go straight back to HLOS on secure domains,
+	 * so those can't leave the walk cache pointing at them.
+	 */
 	flags = arm_smmu_pgtbl_lock(smmu_domain);
+	smmu_domain->gather_tlbi = nosync &&
+				   !arm_smmu_has_secure_vmid(smmu_domain);
 	ret = ops->unmap(ops, iova, size);
+	smmu_domain->gather_tlbi = false;
 	arm_smmu_pgtbl_unlock(smmu_domain, flags);
 
 	/*
@@ -2574,6 +2603,76 @@ static size_t arm_smmu_unmap(struct iommu_domain *domain, unsigned long iova,
 	return ret;
 }
 
+static size_t arm_smmu_unmap(struct iommu_domain *domain, unsigned long iova,
+			     size_t size)
+{
+	return __arm_smmu_unmap(domain, iova, size, false);
+}
+
+static size_t arm_smmu_unmap_nosync(struct iommu_domain *domain,
+				    unsigned long iova, size_t size)
+{
+	return __arm_smmu_unmap(domain, iova, size, true);
+}
+
+/*
+ * Past this many pages a single TLBIASID beats walking the ranges one
+ * TLBIVA at a time.
+ */
+#define ARM_SMMU_GATHER_MAX_TLBIVA	64
+
+/*
+ * Invalidate what a batch of unmap_nosync calls left behind with one sync
+ * at the end: a few small ranges page by page, anything else by ASID.
+ * Stage 2 contexts always go by VMID.
+ */
+static void arm_smmu_iotlb_sync(struct iommu_domain *domain,
+				struct iommu_iotlb_gather *gather)
+{
+	struct arm_smmu_domain *smmu_domain = domain->priv;
+	struct arm_smmu_device *smmu;
+	int atomic_ctx = smmu_domain->attributes & (1 << DOMAIN_ATTR_ATOMIC);
+	unsigned long iova, end;
+	unsigned int i;
+
+	if (arm_smmu_is_slave_side_secure(smmu_domain))
+		return;
+
+	if (!atomic_ctx)
+		mutex_lock(&smmu_domain->init_mutex);
+
+	smmu = smmu_domain->smmu;
+	if (!smmu)
+		goto out_unlock;
+
+	if (atomic_ctx ? arm_smmu_enable_clocks_atomic(smmu) :
+			 arm_smmu_enable_clocks(smmu))
+		goto out_unlock;
+
+	if (gather->overflow ||
+	    gather->size > ARM_SMMU_GATHER_MAX_TLBIVA * SZ_4K ||
+	    smmu_domain->cfg.cbar == CBAR_TYPE_S2_TRANS) {
+		arm_smmu_tlb_inv_context(smmu_domain);
+	} else {
+		for (i = 0; i < gather->nr_ranges; i++) {
+			iova = gather->ranges[i].iova;
+			end = iova + gather->ranges[i].size;
+			for (; iova < end; iova += SZ_4K)
+				arm_smmu_tlb_inv_range_nosync(iova, SZ_4K,
+							false, smmu_domain);
+		}
+		arm_smmu_tlb_sync(smmu_domain);
+	}
+
+	if (atomic_ctx)
+		arm_smmu_disable_clocks_atomic(smmu);
+	else
+		arm_smmu_disable_clocks(smmu);
+out_unlock:
+	if (!atomic_ctx)
+		mutex_unlock(&smmu_domain->init_mutex);
+}
+
 static phys_addr_t arm_smmu_iova_to_phys(struct iommu_domain *domain,
 					 dma_addr_t iova)
 {
@@ -2970,6 +3069,16 @@ static int arm_smmu_domain_get_attr(struct iommu_domain *domain,
 					& (1 << DOMAIN_ATTR_FAST));
 		ret = 0;
 		break;
+	case DOMAIN_ATTR_DEFER_TLBI:
+		*((int *)data) = !!(smmu_domain->attributes
+					& (1 << DOMAIN_ATTR_DEFER_TLBI));
+		ret = 0;
+		break;
+	case DOMAIN_ATTR_CONT_HINT:
+		*((int *)data) = !!(smmu_domain->attributes
+					& (1 << DOMAIN_ATTR_CONT_HINT));
+		ret = 0;
+		break;
 	case DOMAIN_ATTR_PGTBL_INFO: {
 		struct iommu_pgtbl_info *info = data;
 
@@ -3114,6 +3223,28 @@ static int arm_smmu_domain_set_attr(struct iommu_domain *domain,
 			smmu_domain->attributes |= 1 << DOMAIN_ATTR_FAST;
 		ret = 0;
 		break;
+	case DOMAIN_ATTR_DEFER_TLBI:
+		if (*((int *)data))
+			smmu_domain->attributes |= 1 << DOMAIN_ATTR_DEFER_TLBI;
+		else
+			smmu_domain->attributes &=
+					~(1 << DOMAIN_ATTR_DEFER_TLBI);
+		ret = 0;
+		break;
+	case DOMAIN_ATTR_CONT_HINT:
+		if (smmu_domain->smmu != NULL) {
+			dev_err(smmu_domain->smmu->dev,
+			  "cannot change contiguous hint while attached\n");
+			ret = -EBUSY;
+			break;
+		}
+		if (*((int *)data))
+			smmu_domain->attributes |= 1 << DOMAIN_ATTR_CONT_HINT;
+		else
+			smmu_domain->attributes &=
+					~(1 << DOMAIN_ATTR_CONT_HINT);
+		ret = 0;
+		break;
 	case DOMAIN_ATTR_EARLY_MAP: {
 		int early_map = *((int *)data);
 
@@ -3210,6 +3341,7 @@ static struct iommu_ops arm_smmu_ops = {
 	.detach_dev		= arm_smmu_detach_dev,
 	.map			= arm_smmu_map,
 	.unmap			= arm_smmu_unmap,
+	.unmap_nosync		= arm_smmu_unmap_nosync,
 	.map_sg			= arm_smmu_map_sg,
 	.iova_to_phys		= arm_smmu_iova_to_phys,
 	.iova_to_phys_hard	= arm_smmu_iova_to_phys_hard,
@@ -3224,6 +3356,7 @@ static struct iommu_ops arm_smmu_ops = {
 	.reg_read		= arm_smmu_reg_read,
 	.reg_write		= arm_smmu_reg_write,
 	.tlbi_domain		= arm_smmu_tlbi_domain,
+	.iotlb_sync		= arm_smmu_iotlb_sync,
 	.enable_config_clocks	= arm_smmu_enable_config_clocks,
 	.disable_config_clocks	= arm_smmu_disable_config_clocks,
 };
@@ -14,6 +14,8 @@
 #include <linux/dma-mapping.h>
 #include <linux/dma-mapping-fast.h>
 #include <linux/io-pgtable-fast.h>
+#include <linux/log2.h>
+#include <linux/percpu.h>
 #include <asm/cacheflush.h>
 #include <asm/dma-iommu.h>
 
@@ -230,6 +232,179 @@ static void __fast_smmu_free_iova(struct dma_fast_smmu_mapping *mapping,
 	mapping->have_stale_tlbs = true;
 }
 
+/*
+ * Streaming mappings of up to FAST_IOVA_CACHE_MAX are rounded up to a
+ * power of two and served from per-cpu magazines, so that map/unmap
+ * traffic from several cores doesn't serialize on mapping->lock for every
+ * buffer.  The magazines only fill up while mapping->lock is contended;
+ * a lone user goes straight to the bitmap and sees the same allocation
+ * order as before.  Each cpu keeps, per size class:
+ *
+ * - an alloc magazine of ranges taken from the bitmap in one batch.  They
+ *   went through the stale TLB check above when they were allocated and
+ *   nothing has mapped them since, so they can be handed out as they are.
+ *
+ * - a free magazine of unmapped ranges.  Their TLB entries may still be
+ *   live, so they are never reused directly: they go back to the bitmap
+ *   together on the next trip through mapping->lock, and the stale bit
+ *   tracking decides when to invalidate.
+ *
+ * cache->lock is only contended when a failed allocation drains the
+ * caches of every cpu.  It nests outside mapping->lock.
+ */
+#define FAST_IOVA_CACHE_ORDERS	5
+#define FAST_IOVA_CACHE_MAX	(FAST_PAGE_SIZE << (FAST_IOVA_CACHE_ORDERS - 1))
+#define FAST_IOVA_MAG_SIZE	16
+
+struct fast_smmu_iova_mag {
+	unsigned int	count;
+	dma_addr_t	iova[FAST_IOVA_MAG_SIZE];
+};
+
+struct fast_smmu_iova_cache {
+	spinlock_t	lock;
+	struct fast_smmu_iova_mag alloc[FAST_IOVA_CACHE_ORDERS];
+	struct fast_smmu_iova_mag free[FAST_IOVA_CACHE_ORDERS];
+};
+
+/* IOVA space reserved for a streaming mapping of @len bytes */
+static size_t __fast_smmu_iova_len(size_t len)
+{
+	return len <= FAST_IOVA_CACHE_MAX ? roundup_pow_of_two(len) : len;
+}
+
+/* caller holds mapping->lock */
+static void __fast_smmu_mag_flush(struct dma_fast_smmu_mapping *mapping,
+				  struct fast_smmu_iova_mag *mag, size_t size)
+{
+	while (mag->count)
+		__fast_smmu_free_iova(mapping, mag->iova[--mag->count], size);
+}
+
+/*
+ * Hand every cached range back to the bitmap.  The clean ranges of the
+ * alloc magazines are freed like any other, which at worst costs an
+ * early TLB invalidation.
+ */
+static void fast_smmu_drain_iova_caches(struct dma_fast_smmu_mapping *mapping)
+{
+	struct fast_smmu_iova_cache *cache;
+	unsigned long flags;
+	size_t size;
+	int cpu, order;
+
+	for_each_possible_cpu(cpu) {
+		cache = per_cpu_ptr(mapping->iova_cache, cpu);
+		spin_lock_irqsave(&cache->lock, flags);
+		spin_lock(&mapping->lock);
+		for (order = 0; order < FAST_IOVA_CACHE_ORDERS; order++) {
+			size = FAST_PAGE_SIZE << order;
+			__fast_smmu_mag_flush(mapping, &cache->alloc[order],
+					      size);
+			__fast_smmu_mag_flush(mapping, &cache->free[order],
+					      size);
+		}
+		spin_unlock(&mapping->lock);
+		spin_unlock_irqrestore(&cache->lock, flags);
+	}
+}
+
+static dma_addr_t __fast_smmu_cache_alloc_iova(
+	struct dma_fast_smmu_mapping *mapping, struct dma_attrs *attrs,
+	size_t size)
+{
+	int order = ilog2(size >> FAST_PAGE_SHIFT);
+	struct fast_smmu_iova_cache *cache;
+	struct fast_smmu_iova_mag *mag;
+	dma_addr_t iova;
+	unsigned int batch = 1;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	cache = this_cpu_ptr(mapping->iova_cache);
+	spin_lock(&cache->lock);
+	mag = &cache->alloc[order];
+	if (!mag->count) {
+		if (!spin_trylock(&mapping->lock)) {
+			spin_lock(&mapping->lock);
+			batch = FAST_IOVA_MAG_SIZE / 2;
+		}
+		__fast_smmu_mag_flush(mapping, &cache->free[order], size);
+		while (mag->count < batch) {
+			iova = __fast_smmu_alloc_iova(mapping, attrs, size);
+			if (iova == DMA_ERROR_CODE)
+				break;
+			mag->iova[mag->count++] = iova;
+		}
+		spin_unlock(&mapping->lock);
+	}
+	iova = mag->count ? mag->iova[--mag->count] : DMA_ERROR_CODE;
+	spin_unlock(&cache->lock);
+	local_irq_restore(flags);
+
+	return iova;
+}
+
+static dma_addr_t fast_smmu_alloc_iova(struct dma_fast_smmu_mapping *mapping,
+				       struct dma_attrs *attrs, size_t size)
+{
+	dma_addr_t iova;
+	unsigned long flags;
+
+	if (size <= FAST_IOVA_CACHE_MAX) {
+		iova = __fast_smmu_cache_alloc_iova(mapping, attrs, size);
+		if (likely(iova != DMA_ERROR_CODE))
+			return iova;
+	} else {
+		spin_lock_irqsave(&mapping->lock, flags);
+		iova = __fast_smmu_alloc_iova(mapping, attrs, size);
+		spin_unlock_irqrestore(&mapping->lock, flags);
+		if (likely(iova != DMA_ERROR_CODE))
+			return iova;
+	}
+
+	/* the space we need may be sitting in the per-cpu caches */
+	fast_smmu_drain_iova_caches(mapping);
+
+	spin_lock_irqsave(&mapping->lock, flags);
+	iova = __fast_smmu_alloc_iova(mapping, attrs, size);
+	spin_unlock_irqrestore(&mapping->lock, flags);
+
+	return iova;
+}
+
+static void fast_smmu_free_iova(struct dma_fast_smmu_mapping *mapping,
+				dma_addr_t iova, size_t size)
+{
+	struct fast_smmu_iova_cache *cache;
+	struct fast_smmu_iova_mag *mag;
+	unsigned long flags;
+
+	if (size > FAST_IOVA_CACHE_MAX) {
+		spin_lock_irqsave(&mapping->lock, flags);
+		__fast_smmu_free_iova(mapping, iova, size);
+		spin_unlock_irqrestore(&mapping->lock, flags);
+		return;
+	}
+
+	local_irq_save(flags);
+	cache = this_cpu_ptr(mapping->iova_cache);
+	spin_lock(&cache->lock);
+	mag = &cache->free[ilog2(size >> FAST_PAGE_SHIFT)];
+	if (mag->count < FAST_IOVA_MAG_SIZE &&
+	    !spin_trylock(&mapping->lock)) {
+		mag->iova[mag->count++] = iova;
+	} else {
+		if (mag->count == FAST_IOVA_MAG_SIZE)
+			spin_lock(&mapping->lock);
+		__fast_smmu_mag_flush(mapping, mag, size);
+		__fast_smmu_free_iova(mapping, iova, size);
+		spin_unlock(&mapping->lock);
+	}
+	spin_unlock(&cache->lock);
+	local_irq_restore(flags);
+}
+
 
 static void __fast_dma_page_cpu_to_dev(struct page *page, unsigned long off,
 				       size_t size, enum dma_data_direction dir)
@@ -271,12 +446,12 @@ static dma_addr_t fast_smmu_map_page(struct device *dev, struct page *page,
 {
 	struct dma_fast_smmu_mapping *mapping = dev->archdata.mapping->fast;
 	dma_addr_t iova;
-	unsigned long flags;
 	av8l_fast_iopte *pmd;
 	phys_addr_t phys_plus_off = page_to_phys(page) + offset;
 	phys_addr_t phys_to_map = round_down(phys_plus_off, FAST_PAGE_SIZE);
 	unsigned long offset_from_phys_to_map = phys_plus_off & ~FAST_PAGE_MASK;
 	size_t len = ALIGN(size + offset_from_phys_to_map, FAST_PAGE_SIZE);
+	size_t iova_len = __fast_smmu_iova_len(len);
 	int nptes = len >> FAST_PAGE_SHIFT;
 	bool skip_sync = dma_get_attr(DMA_ATTR_SKIP_CPU_SYNC, attrs);
 	int prot = __fast_dma_direction_to_prot(dir);
@@ -288,28 +463,26 @@ static dma_addr_t fast_smmu_map_page(struct device *dev, struct page *page,
 		__fast_dma_page_cpu_to_dev(phys_to_page(phys_to_map),
 					   offset_from_phys_to_map, size, dir);
 
-	spin_lock_irqsave(&mapping->lock, flags);
-
-	iova = __fast_smmu_alloc_iova(mapping, attrs, len);
+	iova = fast_smmu_alloc_iova(mapping, attrs, iova_len);
 
 	if (unlikely(iova == DMA_ERROR_CODE))
 		goto fail;
 
+	/* we own every pte of the range, no need for mapping->lock */
 	pmd = iopte_pmd_offset(mapping->pgtbl_pmds, iova);
 
-	if (unlikely(av8l_fast_map_public(pmd, phys_to_map, len, prot)))
+	if (unlikely(av8l_fast_map_public(pmd, phys_to_map, len, prot,
+					  mapping->cont_hint)))
 		goto fail_free_iova;
 
 	if (!skip_sync)		/* TODO: should ask SMMU if coherent */
 		dmac_clean_range(pmd, pmd + nptes);
 
-	spin_unlock_irqrestore(&mapping->lock, flags);
 	return iova + offset_from_phys_to_map;
 
 fail_free_iova:
-	__fast_smmu_free_iova(mapping, iova, size);
+	fast_smmu_free_iova(mapping, iova, iova_len);
 fail:
-	spin_unlock_irqrestore(&mapping->lock, flags);
 	return DMA_ERROR_CODE;
 }
 
@@ -318,7 +491,6 @@ static void fast_smmu_unmap_page(struct device *dev, dma_addr_t iova,
 			       struct dma_attrs *attrs)
 {
 	struct dma_fast_smmu_mapping *mapping = dev->archdata.mapping->fast;
-	unsigned long flags;
 	av8l_fast_iopte *pmd = iopte_pmd_offset(mapping->pgtbl_pmds, iova);
 	unsigned long offset = iova & ~FAST_PAGE_MASK;
 	size_t len = ALIGN(size + offset, FAST_PAGE_SIZE);
@@ -329,12 +501,11 @@ static void fast_smmu_unmap_page(struct device *dev, dma_addr_t iova,
 	if (!skip_sync)
 		__fast_dma_page_dev_to_cpu(page, offset, size, dir);
 
-	spin_lock_irqsave(&mapping->lock, flags);
 	av8l_fast_unmap_public(pmd, len);
 	if (!skip_sync)		/* TODO: should ask SMMU if coherent */
 		dmac_clean_range(pmd, pmd + nptes);
-	__fast_smmu_free_iova(mapping, iova, len);
-	spin_unlock_irqrestore(&mapping->lock, flags);
+	fast_smmu_free_iova(mapping, iova & FAST_PAGE_MASK,
+			    __fast_smmu_iova_len(len));
 }
 
 static int fast_smmu_map_sg(struct device *dev, struct scatterlist *sg,
@@ -455,7 +626,8 @@ static void *fast_smmu_alloc(struct device *dev, size_t size,
 		ptep = iopte_pmd_offset(mapping->pgtbl_pmds, iova_iter);
 		if (unlikely(av8l_fast_map_public(
 				     ptep, page_to_phys(miter.page),
-				     miter.length, prot))) {
+				     miter.length, prot,
+				     mapping->cont_hint))) {
 			dev_err(dev, "no map public\n");
 			/* TODO: unwind previously successful mappings */
 			goto out_free_iova;
@@ -592,6 +764,7 @@ static struct dma_fast_smmu_mapping *__fast_smmu_create_mapping_sized(
 	dma_addr_t base, size_t size)
 {
 	struct dma_fast_smmu_mapping *fast;
+	int cpu;
 
 	fast = kzalloc(sizeof(struct dma_fast_smmu_mapping), GFP_KERNEL);
 	if (!fast)
@@ -606,9 +779,17 @@ static struct dma_fast_smmu_mapping *__fast_smmu_create_mapping_sized(
 	if (!fast->bitmap)
 		goto err2;
 
+	fast->iova_cache = alloc_percpu(struct fast_smmu_iova_cache);
+	if (!fast->iova_cache)
+		goto err3;
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(fast->iova_cache, cpu)->lock);
+
 	spin_lock_init(&fast->lock);
 
 	return fast;
+err3:
+	kfree(fast->bitmap);
 err2:
 	kfree(fast);
 err:
@@ -629,7 +810,7 @@ err:
 int fast_smmu_attach_device(struct device *dev,
 			    struct dma_iommu_mapping *mapping)
 {
-	int htw_disable = 1, atomic_domain = 1;
+	int htw_disable = 1, atomic_domain = 1, cont_hint;
 	struct iommu_domain *domain = mapping->domain;
 	struct iommu_pgtbl_info info;
 	size_t size = mapping->bits << PAGE_SHIFT;
@@ -651,6 +832,10 @@ int fast_smmu_attach_device(struct device *dev,
 	mapping->fast->domain = domain;
 	mapping->fast->dev = dev;
 
+	if (iommu_domain_get_attr(domain, DOMAIN_ATTR_CONT_HINT, &cont_hint))
+		cont_hint = 0;
+	mapping->fast->cont_hint = cont_hint;
+
 	if (iommu_attach_device(domain, dev))
 		return -EINVAL;
 
@@ -686,6 +871,7 @@ void fast_smmu_detach_device(struct device *dev,
 	dev->archdata.mapping = NULL;
 	set_dma_ops(dev, NULL);
 
+	free_percpu(mapping->fast->iova_cache);
 	kfree(mapping->fast->bitmap);
 	kfree(mapping->fast);
 }
@@ -85,6 +85,7 @@
 
 #define ARM_LPAE_PTE_NSTABLE		(((arm_lpae_iopte)1) << 63)
 #define ARM_LPAE_PTE_XN			(((arm_lpae_iopte)3) << 53)
+#define ARM_LPAE_PTE_CONT		(((arm_lpae_iopte)1) << 52)
 #define ARM_LPAE_PTE_AF			(((arm_lpae_iopte)1) << 10)
 #define ARM_LPAE_PTE_SH_NS		(((arm_lpae_iopte)0) << 8)
 #define ARM_LPAE_PTE_SH_OS		(((arm_lpae_iopte)2) << 8)
@@ -167,6 +168,10 @@
 #define ARM_LPAE_MAIR_ATTR_IDX_CACHE	1
 #define ARM_LPAE_MAIR_ATTR_IDX_DEV	2
 
+/* Contiguous hint: 16 naturally aligned 4K pages make one 64K TLB entry */
+#define ARM_LPAE_CONT_PTES		16
+#define ARM_LPAE_CONT_SIZE		(ARM_LPAE_CONT_PTES * SZ_4K)
+
 /* IOPTE accessors */
 #define iopte_deref(pte, d)						\
 	(__va(iopte_val(pte) & ((1ULL << ARM_LPAE_MAX_ADDR_BITS) - 1)	\
@@ -476,6 +481,9 @@ static int arm_lpae_map_sg(struct io_pgtable_ops *ops, unsigned long iova,
 	int i, ret;
 	unsigned int min_pagesz;
 	struct map_state ms;
+	unsigned long cont_end = 0;
+	bool cont = (data->iop.cfg.quirks & IO_PGTABLE_QUIRK_CONT_HINT) &&
+		data->pg_shift == ilog2(SZ_4K);
 
 	/* If no access, then nothing to do */
 	if (!(iommu_prot & (IOMMU_READ | IOMMU_WRITE)))
@@ -503,20 +511,37 @@ static int arm_lpae_map_sg(struct io_pgtable_ops *ops, unsigned long iova,
 		while (size) {
 			size_t pgsize = iommu_pgsize(
 				data->iop.cfg.pgsize_bitmap, iova | phys, size);
+			arm_lpae_iopte pte_prot = prot;
+
+			/*
+			 * Mark every page of a naturally aligned 64K run so the
+			 * walker can cache the whole run in one TLB entry
+			 */
+			if (cont && pgsize == SZ_4K) {
+				if (iova >= cont_end &&
+				    size >= ARM_LPAE_CONT_SIZE &&
+				    IS_ALIGNED(iova | phys,
+					       ARM_LPAE_CONT_SIZE))
+					cont_end = iova + ARM_LPAE_CONT_SIZE;
+
+				if (iova < cont_end)
+					pte_prot |= ARM_LPAE_PTE_CONT;
+			}
 
 			if (ms.pgtable && (iova < ms.iova_end)) {
 				arm_lpae_iopte *ptep = ms.pgtable +
 					ARM_LPAE_LVL_IDX(iova, MAP_STATE_LVL,
 							 data);
 				ret = arm_lpae_init_pte(
-					data, iova, phys, prot, MAP_STATE_LVL,
-					ptep, ms.prev_pgtable, false);
+					data, iova, phys, pte_prot,
+					MAP_STATE_LVL, ptep, ms.prev_pgtable,
+					false);
 				if (ret)
 					goto out_err;
 				ms.num_pte++;
 			} else {
 				ret = __arm_lpae_map(data, iova, phys, pgsize,
-						prot, lvl, ptep, NULL, &ms);
+						pte_prot, lvl, ptep, NULL, &ms);
 				if (ret)
 					goto out_err;
 			}
@@ -623,6 +648,27 @@ static int arm_lpae_split_blk_unmap(struct arm_lpae_io_pgtable *data,
 	return size;
 }
 
+/*
+ * Drop the contiguous hint from the group of page entries around idx.  Used
+ * when only part of a contiguous run is unmapped so the walker never sees a
+ * hinted group with holes in it.
+ */
+static void arm_lpae_clear_cont(struct arm_lpae_io_pgtable *data,
+				arm_lpae_iopte *table, int idx)
+{
+	arm_lpae_iopte *group = table + round_down(idx, ARM_LPAE_CONT_PTES);
+	int i;
+
+	if (!(table[idx] & ARM_LPAE_PTE_CONT))
+		return;
+
+	for (i = 0; i < ARM_LPAE_CONT_PTES; i++)
+		group[i] &= ~ARM_LPAE_PTE_CONT;
+
+	data->iop.cfg.tlb->flush_pgtable(group,
+		ARM_LPAE_CONT_PTES * sizeof(*group), data->iop.cookie);
+}
+
 static int __arm_lpae_unmap(struct arm_lpae_io_pgtable *data,
 			    unsigned long iova, size_t size, int lvl,
 			    arm_lpae_iopte *ptep, arm_lpae_iopte *prev_ptep)
@@ -668,6 +714,15 @@ static int __arm_lpae_unmap(struct arm_lpae_io_pgtable *data,
 		 * swoop.
 		 */
 
+		if (data->iop.cfg.quirks & IO_PGTABLE_QUIRK_CONT_HINT) {
+			if (!IS_ALIGNED(tl_offset, ARM_LPAE_CONT_PTES))
+				arm_lpae_clear_cont(data, table, tl_offset);
+			if (!IS_ALIGNED(tl_offset + entries,
+					ARM_LPAE_CONT_PTES))
+				arm_lpae_clear_cont(data, table,
+						    tl_offset + entries - 1);
+		}
+
 		table += tl_offset;
 
 		memset(table, 0, table_len);
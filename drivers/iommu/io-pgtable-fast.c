@@ -52,6 +52,7 @@ struct av8l_fast_io_pgtable {
 
 #define AV8L_FAST_PTE_NSTABLE		(((av8l_fast_iopte)1) << 63)
 #define AV8L_FAST_PTE_XN		(((av8l_fast_iopte)3) << 53)
+#define AV8L_FAST_PTE_CONT		(((av8l_fast_iopte)1) << 52)
 #define AV8L_FAST_PTE_AF		(((av8l_fast_iopte)1) << 10)
 #define AV8L_FAST_PTE_SH_NS		(((av8l_fast_iopte)0) << 8)
 #define AV8L_FAST_PTE_SH_OS		(((av8l_fast_iopte)2) << 8)
@@ -138,6 +139,10 @@ struct av8l_fast_io_pgtable {
 
 #define AV8L_FAST_PAGE_SHIFT		12
 
+/* A naturally aligned 64K run of ptes can share one TLB entry */
+#define AV8L_FAST_CONT_PTES		16
+#define AV8L_FAST_CONT_SIZE		(AV8L_FAST_CONT_PTES * SZ_4K)
+
 
 #ifdef CONFIG_IOMMU_IO_PGTABLE_FAST_PROVE_TLB
 
@@ -172,8 +177,13 @@ void av8l_fast_clear_stale_ptes(av8l_fast_iopte *pmds, bool skip_sync)
 	int i;
 	av8l_fast_iopte *pmdp = pmds;
 
+	/*
+	 * Only touch the stale markers: streaming mappings write the ptes
+	 * of the ranges they own without the mapping lock, so a vacant pte
+	 * may be getting mapped under our feet.
+	 */
 	for (i = 0; i < ((SZ_1G * 4UL) >> AV8L_FAST_PAGE_SHIFT); ++i) {
-		if (!(*pmdp & AV8L_FAST_PTE_VALID)) {
+		if (*pmdp == AV8L_FAST_PTE_UNMAPPED_NEED_TLBI) {
 			*pmdp = 0;
 			if (!skip_sync)
 				dmac_clean_range(pmdp, pmdp + 1);
@@ -187,11 +197,23 @@ static void __av8l_check_for_stale_tlb(av8l_fast_iopte *ptep)
 }
 #endif
 
-/* caller must take care of cache maintenance on *ptep */
+static bool av8l_fast_cont_aligned(av8l_fast_iopte *ptep)
+{
+	/* the pmds are virtually contiguous from a page boundary */
+	return IS_ALIGNED((unsigned long)ptep,
+			  AV8L_FAST_CONT_PTES * sizeof(*ptep));
+}
+
+/*
+ * caller must take care of cache maintenance on *ptep.  With @cont, every
+ * naturally aligned 64K run inside the range gets the contiguous hint, so
+ * the range has to be unmapped as a whole (or through av8l_fast_unmap,
+ * which drops the hint around partial unmaps).
+ */
 int av8l_fast_map_public(av8l_fast_iopte *ptep, phys_addr_t paddr, size_t size,
-			 int prot)
+			 int prot, bool cont)
 {
-	int i, nptes = size >> AV8L_FAST_PAGE_SHIFT;
+	int i, cont_left = 0, nptes = size >> AV8L_FAST_PAGE_SHIFT;
 	av8l_fast_iopte pte = AV8L_FAST_PTE_XN
 		| AV8L_FAST_PTE_TYPE_PAGE
 		| AV8L_FAST_PTE_AF
@@ -212,13 +234,28 @@ int av8l_fast_map_public(av8l_fast_iopte *ptep, phys_addr_t paddr, size_t size,
 
 	paddr &= AV8L_FAST_PTE_ADDR_MASK;
 	for (i = 0; i < nptes; i++, paddr += SZ_4K) {
+		if (cont && !cont_left && nptes - i >= AV8L_FAST_CONT_PTES &&
+		    IS_ALIGNED(paddr, AV8L_FAST_CONT_SIZE) &&
+		    av8l_fast_cont_aligned(ptep + i))
+			cont_left = AV8L_FAST_CONT_PTES;
+
 		__av8l_check_for_stale_tlb(ptep + i);
-		*(ptep + i) = pte | paddr;
+		if (cont_left) {
+			*(ptep + i) = pte | paddr | AV8L_FAST_PTE_CONT;
+			cont_left--;
+		} else {
+			*(ptep + i) = pte | paddr;
+		}
 	}
 
 	return 0;
 }
 
+static bool av8l_fast_use_cont(struct av8l_fast_io_pgtable *data)
+{
+	return data->iop.cfg.quirks & IO_PGTABLE_QUIRK_CONT_HINT;
+}
+
 static int av8l_fast_map(struct io_pgtable_ops *ops, unsigned long iova,
 			 phys_addr_t paddr, size_t size, int prot)
 {
@@ -226,7 +263,7 @@ static int av8l_fast_map(struct io_pgtable_ops *ops, unsigned long iova,
 	av8l_fast_iopte *ptep = iopte_pmd_offset(data->pmds, iova);
 	unsigned long nptes = size >> AV8L_FAST_PAGE_SHIFT;
 
-	av8l_fast_map_public(ptep, paddr, size, prot);
+	av8l_fast_map_public(ptep, paddr, size, prot, av8l_fast_use_cont(data));
 	data->iop.cfg.tlb->flush_pgtable(
 		ptep, sizeof(*ptep) * nptes,
 		data->iop.cookie);
@@ -251,6 +288,27 @@ void av8l_fast_unmap_public(av8l_fast_iopte *ptep, size_t size)
 	__av8l_fast_unmap(ptep, size, true);
 }
 
+/*
+ * Drop the contiguous hint from the 64K group around ptep, so that a
+ * partial unmap never leaves the walker a hinted group with holes in it.
+ */
+static void av8l_fast_clear_cont(struct av8l_fast_io_pgtable *data,
+				 av8l_fast_iopte *ptep)
+{
+	av8l_fast_iopte *group = (av8l_fast_iopte *)round_down(
+		(unsigned long)ptep, AV8L_FAST_CONT_PTES * sizeof(*ptep));
+	int i;
+
+	if (!(*ptep & AV8L_FAST_PTE_CONT))
+		return;
+
+	for (i = 0; i < AV8L_FAST_CONT_PTES; i++)
+		group[i] &= ~AV8L_FAST_PTE_CONT;
+
+	data->iop.cfg.tlb->flush_pgtable(group,
+		AV8L_FAST_CONT_PTES * sizeof(*group), data->iop.cookie);
+}
+
 /* upper layer must take care of TLB invalidation */
 static size_t av8l_fast_unmap(struct io_pgtable_ops *ops, unsigned long iova,
 			      size_t size)
@@ -259,6 +317,13 @@ static size_t av8l_fast_unmap(struct io_pgtable_ops *ops, unsigned long iova,
 	av8l_fast_iopte *ptep = iopte_pmd_offset(data->pmds, iova);
 	unsigned long nptes = size >> AV8L_FAST_PAGE_SHIFT;
 
+	if (av8l_fast_use_cont(data)) {
+		if (!av8l_fast_cont_aligned(ptep))
+			av8l_fast_clear_cont(data, ptep);
+		if (!av8l_fast_cont_aligned(ptep + nptes))
+			av8l_fast_clear_cont(data, ptep + nptes - 1);
+	}
+
 	__av8l_fast_unmap(ptep, size, false);
 
 	data->iop.cfg.tlb->flush_pgtable(
@@ -302,11 +367,46 @@ static phys_addr_t av8l_fast_iova_to_phys(struct io_pgtable_ops *ops,
 	return phys | (iova & 0xfff);
 }
 
+/*
+ * Write the ptes of every segment first and do the cache maintenance for
+ * the whole (virtually contiguous) run of ptes once at the end.
+ */
 static int av8l_fast_map_sg(struct io_pgtable_ops *ops, unsigned long iova,
 			    struct scatterlist *sg, unsigned int nents,
 			    int prot, size_t *size)
 {
-	return -ENODEV;
+	struct av8l_fast_io_pgtable *data = iof_pgtable_ops_to_data(ops);
+	av8l_fast_iopte *ptep = iopte_pmd_offset(data->pmds, iova);
+	bool cont = av8l_fast_use_cont(data);
+	struct scatterlist *s;
+	size_t mapped = 0;
+	int i;
+
+	for_each_sg(sg, s, nents, i) {
+		phys_addr_t phys = page_to_phys(sg_page(s)) + s->offset;
+
+		if (!IS_ALIGNED(phys | s->length, SZ_4K) ||
+		    iova + mapped + s->length > (SZ_1G * 4ULL))
+			goto out_err;
+
+		av8l_fast_map_public(ptep + (mapped >> AV8L_FAST_PAGE_SHIFT),
+				     phys, s->length, prot, cont);
+		mapped += s->length;
+	}
+
+	data->iop.cfg.tlb->flush_pgtable(
+		ptep, sizeof(*ptep) * (mapped >> AV8L_FAST_PAGE_SHIFT),
+		data->iop.cookie);
+
+	return mapped;
+
+out_err:
+	/* Return the size of the partial mapping so that they can be undone */
+	data->iop.cfg.tlb->flush_pgtable(
+		ptep, sizeof(*ptep) * (mapped >> AV8L_FAST_PAGE_SHIFT),
+		data->iop.cookie);
+	*size = mapped;
+	return 0;
 }
 
 static struct av8l_fast_io_pgtable *
@@ -427,9 +527,14 @@ av8l_fast_alloc_pgtable(struct io_pgtable_cfg *cfg, void *cookie)
 	if (!data)
 		return NULL;
 
-	/* restrict according to the fast map requirements */
+	/*
+	 * restrict according to the fast map requirements.  Every level 3
+	 * table is preallocated, so there are no block mappings: 64K and 2M
+	 * are only advertised so that the core hands us big chunks, which
+	 * get written in one pass (with the contiguous hint if asked for).
+	 */
 	cfg->ias = 32;
-	cfg->pgsize_bitmap = SZ_4K;
+	cfg->pgsize_bitmap = SZ_4K | SZ_64K | SZ_2M;
 
 	/* TCR */
 	reg = (AV8L_FAST_TCR_SH_IS << AV8L_FAST_TCR_SH0_SHIFT) |
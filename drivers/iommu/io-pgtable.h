@@ -55,6 +55,7 @@ struct iommu_gather_ops {
  */
 struct io_pgtable_cfg {
 	#define IO_PGTABLE_QUIRK_ARM_NS	(1 << 0)	/* Set NS bit in PTEs */
+	#define IO_PGTABLE_QUIRK_CONT_HINT (1 << 1)	/* Mark 64K runs cont */
 	int				quirks;
 	unsigned long			pgsize_bitmap;
 	unsigned int			ias;
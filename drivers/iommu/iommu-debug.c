@@ -25,6 +25,9 @@
 #include <soc/qcom/secure_buffer.h>
 #include <linux/qcom_iommu.h>
 #include <linux/dma-mapping.h>
+#include <linux/kthread.h>
+#include <linux/sort.h>
+#include <linux/vmalloc.h>
 #include <asm/cacheflush.h>
 #include <asm/dma-iommu.h>
 #include "iommu-debug.h"
@@ -476,7 +479,7 @@ static const struct file_operations iommu_debug_secure_profiling_fops = {
 static int iommu_debug_profiling_fast_show(struct seq_file *s, void *ignored)
 {
 	struct iommu_debug_device *ddev = s->private;
-	size_t sizes[] = {SZ_4K, SZ_8K, SZ_16K, SZ_64K, 0};
+	size_t sizes[] = {SZ_4K, SZ_8K, SZ_16K, SZ_64K, SZ_2M, 0};
 	enum iommu_attr attrs[] = {
 		DOMAIN_ATTR_FAST,
 		DOMAIN_ATTR_COHERENT_HTW_DISABLE,
@@ -630,6 +633,397 @@ static const struct file_operations iommu_debug_profiling_fast_dma_api_fops = {
 	.release = single_release,
 };
 
+/*
+ * Benchmark suite: every case is run against a regular and a fast
+ * (DOMAIN_ATTR_FAST) context, first from one thread and then from
+ * bench_threads threads at once, nr_iters map/unmap pairs per thread.
+ * Each result is one line of key=value pairs so runs on different SoCs
+ * and kernels can be diffed and parsed by scripts.  Throughput is the sum
+ * over threads of the rate at which each thread completed the operation.
+ * DMA API cases skip CPU cache maintenance to time the IOMMU work only.
+ */
+#define IOMMU_BENCH_MAX_THREADS	8
+#define IOMMU_BENCH_IOVA_BASE	SZ_256M
+#define IOMMU_BENCH_IOVA_STRIDE	SZ_16M
+
+static u32 bench_threads = 1;
+
+static int bench_threads_set(void *data, u64 val)
+{
+	*(u32 *)data = clamp_t(u64, val, 1, IOMMU_BENCH_MAX_THREADS);
+	return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(iommu_debug_bench_threads_ops,
+			nr_iters_get, bench_threads_set, "%llu\n");
+
+enum iommu_bench_api {
+	IOMMU_BENCH_IOMMU_MAP,
+	IOMMU_BENCH_IOMMU_MAP_SG,
+	IOMMU_BENCH_DMA_MAP,
+	IOMMU_BENCH_DMA_MAP_SG,
+};
+
+static const char * const iommu_bench_api_names[] = {
+	[IOMMU_BENCH_IOMMU_MAP]		= "iommu_map",
+	[IOMMU_BENCH_IOMMU_MAP_SG]	= "iommu_map_sg",
+	[IOMMU_BENCH_DMA_MAP]		= "dma_map_single",
+	[IOMMU_BENCH_DMA_MAP_SG]	= "dma_map_sg",
+};
+
+struct iommu_bench_case {
+	enum iommu_bench_api api;
+	size_t size;
+	unsigned int nents;
+};
+
+static const struct iommu_bench_case iommu_bench_iommu_cases[] = {
+	{ IOMMU_BENCH_IOMMU_MAP, SZ_4K, 1 },
+	{ IOMMU_BENCH_IOMMU_MAP, SZ_64K, 1 },
+	{ IOMMU_BENCH_IOMMU_MAP, SZ_2M, 1 },
+	{ IOMMU_BENCH_IOMMU_MAP_SG, SZ_64K, 16 },
+	{ IOMMU_BENCH_IOMMU_MAP_SG, SZ_1M, 256 },
+};
+
+static const struct iommu_bench_case iommu_bench_dma_cases[] = {
+	{ IOMMU_BENCH_DMA_MAP, SZ_4K, 1 },
+	{ IOMMU_BENCH_DMA_MAP, SZ_64K, 1 },
+	{ IOMMU_BENCH_DMA_MAP, SZ_2M, 1 },
+	{ IOMMU_BENCH_DMA_MAP_SG, SZ_64K, 16 },
+	{ IOMMU_BENCH_DMA_MAP_SG, SZ_1M, 256 },
+};
+
+struct iommu_bench_thread {
+	const struct iommu_bench_case *bc;
+	struct device *dev;
+	struct iommu_domain *domain;
+	unsigned long iova;
+	unsigned int iters;
+	u64 *map_ns;
+	u64 *unmap_ns;
+	u64 map_total_ns;
+	u64 unmap_total_ns;
+	struct completion *start;
+	struct completion done;
+	int ret;
+};
+
+static int iommu_bench_map(struct iommu_bench_thread *t,
+			   struct sg_table *table, struct dma_attrs *attrs,
+			   dma_addr_t *dma_addr)
+{
+	const struct iommu_bench_case *bc = t->bc;
+
+	switch (bc->api) {
+	case IOMMU_BENCH_IOMMU_MAP:
+		return iommu_map(t->domain, t->iova, sg_phys(table->sgl),
+				 bc->size, IOMMU_READ | IOMMU_WRITE);
+	case IOMMU_BENCH_IOMMU_MAP_SG:
+		if (iommu_map_sg(t->domain, t->iova, table->sgl, table->nents,
+				 IOMMU_READ | IOMMU_WRITE) != bc->size)
+			return -EINVAL;
+		return 0;
+	case IOMMU_BENCH_DMA_MAP:
+		*dma_addr = dma_map_single_attrs(t->dev, sg_virt(table->sgl),
+						 bc->size, DMA_TO_DEVICE,
+						 attrs);
+		if (dma_mapping_error(t->dev, *dma_addr))
+			return -ENOMEM;
+		return 0;
+	case IOMMU_BENCH_DMA_MAP_SG:
+		if (!dma_map_sg_attrs(t->dev, table->sgl, table->nents,
+				      DMA_TO_DEVICE, attrs))
+			return -ENOMEM;
+		return 0;
+	}
+	return -EINVAL;
+}
+
+static int iommu_bench_unmap(struct iommu_bench_thread *t,
+			     struct sg_table *table, struct dma_attrs *attrs,
+			     dma_addr_t dma_addr)
+{
+	const struct iommu_bench_case *bc = t->bc;
+
+	switch (bc->api) {
+	case IOMMU_BENCH_IOMMU_MAP:
+	case IOMMU_BENCH_IOMMU_MAP_SG:
+		if (iommu_unmap(t->domain, t->iova, bc->size) != bc->size)
+			return -EINVAL;
+		return 0;
+	case IOMMU_BENCH_DMA_MAP:
+		dma_unmap_single_attrs(t->dev, dma_addr, bc->size,
+				       DMA_TO_DEVICE, attrs);
+		return 0;
+	case IOMMU_BENCH_DMA_MAP_SG:
+		dma_unmap_sg_attrs(t->dev, table->sgl, table->nents,
+				   DMA_TO_DEVICE, attrs);
+		return 0;
+	}
+	return -EINVAL;
+}
+
+static int iommu_bench_thread_fn(void *data)
+{
+	struct iommu_bench_thread *t = data;
+	size_t chunk_size = t->bc->size / t->bc->nents;
+	struct sg_table table;
+	struct dma_attrs attrs;
+	dma_addr_t dma_addr = 0;
+	ktime_t t0, t1, t2;
+	unsigned int i;
+
+	init_dma_attrs(&attrs);
+	dma_set_attr(DMA_ATTR_SKIP_CPU_SYNC, &attrs);
+
+	t->ret = iommu_debug_build_phoney_sg_table(t->dev, &table,
+						   t->bc->size, chunk_size);
+	wait_for_completion(t->start);
+	if (t->ret)
+		goto out;
+
+	for (i = 0; i < t->iters; ++i) {
+		t0 = ktime_get();
+		t->ret = iommu_bench_map(t, &table, &attrs, &dma_addr);
+		t1 = ktime_get();
+		if (t->ret)
+			break;
+		t->ret = iommu_bench_unmap(t, &table, &attrs, dma_addr);
+		t2 = ktime_get();
+		if (t->ret)
+			break;
+
+		t->map_ns[i] = ktime_to_ns(ktime_sub(t1, t0));
+		t->unmap_ns[i] = ktime_to_ns(ktime_sub(t2, t1));
+		t->map_total_ns += t->map_ns[i];
+		t->unmap_total_ns += t->unmap_ns[i];
+	}
+
+	iommu_debug_destroy_phoney_sg_table(t->dev, &table, chunk_size);
+out:
+	/* @t belongs to the caller again as soon as this completes */
+	complete(&t->done);
+	return 0;
+}
+
+static int iommu_bench_cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void iommu_bench_report(struct seq_file *s, const char *config,
+			       const struct iommu_bench_case *bc,
+			       unsigned int nr_threads, unsigned int iters,
+			       const char *op, u64 *ns, u64 ops_per_sec)
+{
+	unsigned int n = nr_threads * iters;
+
+	sort(ns, n, sizeof(*ns), iommu_bench_cmp_u64, NULL);
+	seq_printf(s,
+		   "config=%s api=%s op=%s size=%zu nents=%u threads=%u iters=%u ops_per_sec=%llu bytes_per_sec=%llu p50_ns=%llu p90_ns=%llu p99_ns=%llu max_ns=%llu\n",
+		   config, iommu_bench_api_names[bc->api], op, bc->size,
+		   bc->nents, nr_threads, iters, ops_per_sec,
+		   ops_per_sec * bc->size, ns[(n - 1) * 50 / 100],
+		   ns[(n - 1) * 90 / 100], ns[(n - 1) * 99 / 100], ns[n - 1]);
+}
+
+static void iommu_bench_run(struct seq_file *s, const char *config,
+			    struct device *dev, struct iommu_domain *domain,
+			    const struct iommu_bench_case *bc,
+			    unsigned int nr_threads)
+{
+	DECLARE_COMPLETION_ONSTACK(start);
+	struct iommu_bench_thread *threads, *t;
+	struct task_struct *task;
+	unsigned int iters = iters_per_op, n = nr_threads * iters;
+	unsigned int i, created;
+	u64 map_ops = 0, unmap_ops = 0;
+	u64 *samples;
+	int ret = 0;
+
+	threads = kcalloc(nr_threads, sizeof(*threads), GFP_KERNEL);
+	samples = vmalloc(2 * n * sizeof(*samples));
+	if (!threads || !samples) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (created = 0; created < nr_threads; ++created) {
+		t = &threads[created];
+		t->bc = bc;
+		t->dev = dev;
+		t->domain = domain;
+		t->iova = IOMMU_BENCH_IOVA_BASE +
+			  created * IOMMU_BENCH_IOVA_STRIDE;
+		t->iters = iters;
+		t->map_ns = samples + created * iters;
+		t->unmap_ns = samples + n + created * iters;
+		t->start = &start;
+		init_completion(&t->done);
+
+		task = kthread_run(iommu_bench_thread_fn, t, "iommu_bench/%u",
+				   created);
+		if (IS_ERR(task)) {
+			ret = PTR_ERR(task);
+			break;
+		}
+	}
+
+	complete_all(&start);
+	for (i = 0; i < created; ++i) {
+		t = &threads[i];
+		wait_for_completion(&t->done);
+		if (t->ret && !ret)
+			ret = t->ret;
+		map_ops += div64_u64((u64)iters * NSEC_PER_SEC,
+				     max_t(u64, t->map_total_ns, 1));
+		unmap_ops += div64_u64((u64)iters * NSEC_PER_SEC,
+				       max_t(u64, t->unmap_total_ns, 1));
+	}
+	if (ret)
+		goto out;
+
+	iommu_bench_report(s, config, bc, nr_threads, iters, "map",
+			   samples, map_ops);
+	iommu_bench_report(s, config, bc, nr_threads, iters, "unmap",
+			   samples + n, unmap_ops);
+out:
+	if (ret)
+		seq_printf(s,
+			   "config=%s api=%s size=%zu nents=%u threads=%u error=%d\n",
+			   config, iommu_bench_api_names[bc->api], bc->size,
+			   bc->nents, nr_threads, ret);
+	vfree(samples);
+	kfree(threads);
+}
+
+static void iommu_bench_run_cases(struct seq_file *s, const char *config,
+				  struct device *dev,
+				  struct iommu_domain *domain,
+				  const struct iommu_bench_case *cases,
+				  int nr_cases)
+{
+	int i;
+
+	for (i = 0; i < nr_cases; ++i) {
+		iommu_bench_run(s, config, dev, domain, &cases[i], 1);
+		if (bench_threads > 1)
+			iommu_bench_run(s, config, dev, domain, &cases[i],
+					bench_threads);
+	}
+}
+
+/* Raw iommu_map()/iommu_map_sg() on a domain of our own */
+static void iommu_bench_iommu(struct seq_file *s, struct device *dev,
+			      const char *config, int fast)
+{
+	struct iommu_domain *domain;
+	struct bus_type *bus;
+	int one = 1;
+
+	bus = msm_iommu_get_bus(dev);
+	if (!bus)
+		return;
+
+	domain = iommu_domain_alloc(bus);
+	if (!domain) {
+		seq_printf(s, "config=%s error=%d\n", config, -ENOMEM);
+		return;
+	}
+
+	if (iommu_domain_set_attr(domain, DOMAIN_ATTR_COHERENT_HTW_DISABLE,
+				  &one) ||
+	    iommu_domain_set_attr(domain, DOMAIN_ATTR_ATOMIC, &one) ||
+	    (fast && iommu_domain_set_attr(domain, DOMAIN_ATTR_FAST, &one))) {
+		seq_printf(s, "config=%s error=%d\n", config, -EINVAL);
+		goto out_domain_free;
+	}
+
+	if (iommu_attach_device(domain, dev)) {
+		seq_printf(s, "config=%s error=%d\n", config, -EBUSY);
+		goto out_domain_free;
+	}
+
+	if (iommu_enable_config_clocks(domain)) {
+		seq_printf(s, "config=%s error=%d\n", config, -EIO);
+		goto out_detach;
+	}
+
+	iommu_bench_run_cases(s, config, dev, domain, iommu_bench_iommu_cases,
+			      ARRAY_SIZE(iommu_bench_iommu_cases));
+
+	iommu_disable_config_clocks(domain);
+out_detach:
+	iommu_detach_device(domain, dev);
+out_domain_free:
+	iommu_domain_free(domain);
+}
+
+/* Streaming DMA API on a fresh arm or fast mapping attached to @dev */
+static void iommu_bench_dma(struct seq_file *s, struct device *dev,
+			    const char *config, int fast)
+{
+	struct dma_iommu_mapping *mapping;
+
+	mapping = arm_iommu_create_mapping(&platform_bus_type, 0, SZ_1G * 4UL);
+	if (!mapping) {
+		seq_printf(s, "config=%s error=%d\n", config, -ENOMEM);
+		return;
+	}
+
+	if (fast && iommu_domain_set_attr(mapping->domain, DOMAIN_ATTR_FAST,
+					  &fast)) {
+		seq_printf(s, "config=%s error=%d\n", config, -EINVAL);
+		goto out_release_mapping;
+	}
+
+	if (arm_iommu_attach_device(dev, mapping)) {
+		seq_printf(s, "config=%s error=%d\n", config, -EBUSY);
+		goto out_release_mapping;
+	}
+
+	if (iommu_enable_config_clocks(mapping->domain)) {
+		seq_printf(s, "config=%s error=%d\n", config, -EIO);
+		goto out_detach;
+	}
+
+	iommu_bench_run_cases(s, config, dev, mapping->domain,
+			      iommu_bench_dma_cases,
+			      ARRAY_SIZE(iommu_bench_dma_cases));
+
+	iommu_disable_config_clocks(mapping->domain);
+out_detach:
+	arm_iommu_detach_device(dev);
+out_release_mapping:
+	arm_iommu_release_mapping(mapping);
+}
+
+static int iommu_debug_benchmark_show(struct seq_file *s, void *ignored)
+{
+	struct iommu_debug_device *ddev = s->private;
+
+	iommu_bench_iommu(s, ddev->dev, "regular", 0);
+	iommu_bench_iommu(s, ddev->dev, "fast", 1);
+	iommu_bench_dma(s, ddev->dev, "regular", 0);
+	iommu_bench_dma(s, ddev->dev, "fast", 1);
+
+	return 0;
+}
+
+static int iommu_debug_benchmark_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, iommu_debug_benchmark_show, inode->i_private);
+}
+
+static const struct file_operations iommu_debug_benchmark_fops = {
+	.open	 = iommu_debug_benchmark_open,
+	.read	 = seq_read,
+	.llseek	 = seq_lseek,
+	.release = single_release,
+};
+
 static int __tlb_stress_sweep(struct device *dev, struct seq_file *s)
 {
 	int i, ret = 0;
@@ -1141,6 +1535,156 @@ static const struct file_operations iommu_debug_functional_fast_dma_api_fops = {
 	.release = single_release,
 };
 
+/*
+ * Maps @size at a 2M aligned iova with iommu_map, punches a 4K hole into
+ * the first 64K run, then maps it again with iommu_map_sg in @chunk_size
+ * segments.  Every 4K page of the result is checked each time.
+ */
+static int __functional_iommu_map_test(struct device *dev,
+				       struct iommu_domain *domain,
+				       size_t size, size_t chunk_size)
+{
+	const unsigned long iova = SZ_2M;
+	const phys_addr_t paddr = SZ_1G;
+	struct sg_table table;
+	phys_addr_t sg_phys;
+	unsigned long off;
+	int ret = 0;
+
+	if (iommu_map(domain, iova, paddr, size, IOMMU_READ | IOMMU_WRITE)) {
+		dev_err(dev, "iommu_map of %s failed\n", _size_to_string(size));
+		return -EINVAL;
+	}
+
+	for (off = 0; off < size; off += SZ_4K) {
+		if (__check_mapping(dev, domain, iova + off, paddr + off)) {
+			ret = -EINVAL;
+			goto out_unmap;
+		}
+	}
+
+	if (iommu_unmap(domain, iova + SZ_16K, SZ_4K) != SZ_4K ||
+	    iommu_iova_to_phys(domain, iova + SZ_16K)) {
+		dev_err(dev, "partial unmap of a 64K run failed\n");
+		ret = -EINVAL;
+		goto out_unmap;
+	}
+
+	for (off = 0; off < SZ_64K; off += SZ_4K) {
+		if (off != SZ_16K &&
+		    __check_mapping(dev, domain, iova + off, paddr + off)) {
+			ret = -EINVAL;
+			goto out_unmap;
+		}
+	}
+
+out_unmap:
+	iommu_unmap(domain, iova, size);
+	if (ret)
+		return ret;
+
+	if (iommu_debug_build_phoney_sg_table(dev, &table, size, chunk_size))
+		return -ENOMEM;
+
+	if (iommu_map_sg(domain, iova, table.sgl, table.nents,
+			 IOMMU_READ | IOMMU_WRITE) != size) {
+		dev_err(dev, "iommu_map_sg of %s failed\n",
+			_size_to_string(size));
+		ret = -EINVAL;
+		goto out_destroy_table;
+	}
+
+	sg_phys = page_to_phys(sg_page(table.sgl));
+	for (off = 0; off < size; off += SZ_4K) {
+		if (__check_mapping(dev, domain, iova + off,
+				    sg_phys + off % chunk_size)) {
+			ret = -EINVAL;
+			break;
+		}
+	}
+
+	iommu_unmap(domain, iova, size);
+out_destroy_table:
+	iommu_debug_destroy_phoney_sg_table(dev, &table, chunk_size);
+	return ret;
+}
+
+static int iommu_debug_functional_fast_iommu_show(struct seq_file *s,
+						      void *ignored)
+{
+	struct iommu_debug_device *ddev = s->private;
+	struct device *dev = ddev->dev;
+	const size_t sizes[] = { SZ_64K, SZ_2M, SZ_1M * 12, 0 };
+	enum iommu_attr attrs[] = {
+		DOMAIN_ATTR_FAST,
+		DOMAIN_ATTR_COHERENT_HTW_DISABLE,
+		DOMAIN_ATTR_ATOMIC,
+		DOMAIN_ATTR_CONT_HINT,
+	};
+	struct iommu_domain *domain;
+	struct bus_type *bus;
+	const size_t *sz;
+	int i, one = 1, ret = -EINVAL;
+
+	bus = msm_iommu_get_bus(dev);
+	if (!bus)
+		goto out;
+
+	domain = iommu_domain_alloc(bus);
+	if (!domain)
+		goto out;
+
+	for (i = 0; i < ARRAY_SIZE(attrs); ++i) {
+		if (iommu_domain_set_attr(domain, attrs[i], &one)) {
+			seq_printf(s, "Couldn't set attribute %d\n", attrs[i]);
+			goto out_domain_free;
+		}
+	}
+
+	if (iommu_attach_device(domain, dev))
+		goto out_domain_free;
+
+	if (iommu_enable_config_clocks(domain)) {
+		ds_printf(dev, s, "Couldn't enable clocks\n");
+		goto out_detach;
+	}
+
+	ret = 0;
+	for (sz = sizes; *sz; ++sz) {
+		ds_printf(dev, s, "iommu_map/iommu_map_sg @%s",
+			  _size_to_string(*sz));
+		if (__functional_iommu_map_test(dev, domain, *sz, SZ_64K)) {
+			ds_printf(dev, s, "  -> FAILED\n");
+			ret = -EINVAL;
+		} else {
+			ds_printf(dev, s, "  -> SUCCEEDED\n");
+		}
+	}
+
+	iommu_disable_config_clocks(domain);
+out_detach:
+	iommu_detach_device(domain, dev);
+out_domain_free:
+	iommu_domain_free(domain);
+out:
+	seq_printf(s, "%s\n", ret ? "FAIL" : "SUCCESS");
+	return 0;
+}
+
+static int iommu_debug_functional_fast_iommu_open(struct inode *inode,
+						      struct file *file)
+{
+	return single_open(file, iommu_debug_functional_fast_iommu_show,
+			   inode->i_private);
+}
+
+static const struct file_operations iommu_debug_functional_fast_iommu_fops = {
+	.open	 = iommu_debug_functional_fast_iommu_open,
+	.read	 = seq_read,
+	.llseek	 = seq_lseek,
+	.release = single_release,
+};
+
 static int iommu_debug_functional_arm_dma_api_show(struct seq_file *s,
 						   void *ignored)
 {
@@ -1661,6 +2205,21 @@ static int snarf_iommu_devices(struct device *dev, const char *name)
 		goto err_rmdir;
 	}
 
+	if (!debugfs_create_file("bench_threads", S_IRUSR | S_IWUSR, dir,
+				 &bench_threads,
+				 &iommu_debug_bench_threads_ops)) {
+		pr_err("Couldn't create iommu/devices/%s/bench_threads debugfs file\n",
+		       name);
+		goto err_rmdir;
+	}
+
+	if (!debugfs_create_file("benchmark", S_IRUSR, dir, ddev,
+				 &iommu_debug_benchmark_fops)) {
+		pr_err("Couldn't create iommu/devices/%s/benchmark debugfs file\n",
+		       name);
+		goto err_rmdir;
+	}
+
 	if (!debugfs_create_file("functional_fast_dma_api", S_IRUSR, dir, ddev,
 				 &iommu_debug_functional_fast_dma_api_fops)) {
 		pr_err("Couldn't create iommu/devices/%s/functional_fast_dma_api debugfs file\n",
@@ -1668,6 +2227,13 @@ static int snarf_iommu_devices(struct device *dev, const char *name)
 		goto err_rmdir;
 	}
 
+	if (!debugfs_create_file("functional_fast_iommu", S_IRUSR, dir, ddev,
+				 &iommu_debug_functional_fast_iommu_fops)) {
+		pr_err("Couldn't create iommu/devices/%s/functional_fast_iommu debugfs file\n",
+		       name);
+		goto err_rmdir;
+	}
+
 	if (!debugfs_create_file("functional_arm_dma_api", S_IRUSR, dir, ddev,
 				 &iommu_debug_functional_arm_dma_api_fops)) {
 		pr_err("Couldn't create iommu/devices/%s/functional_arm_dma_api debugfs file\n",
@@ -1182,7 +1182,8 @@ int iommu_map(struct iommu_domain *domain, unsigned long iova,
 }
 EXPORT_SYMBOL_GPL(iommu_map);
 
-size_t iommu_unmap(struct iommu_domain *domain, unsigned long iova, size_t size)
+static size_t __iommu_unmap(struct iommu_domain *domain, unsigned long iova,
+			    size_t size, bool nosync)
 {
 	size_t unmapped_page, unmapped = 0;
 	unsigned int min_pagesz;
@@ -1218,7 +1219,11 @@ size_t iommu_unmap(struct iommu_domain *domain, unsigned long iova, size_t size)
 	while (unmapped < size) {
 		size_t left = size - unmapped;
 
-		unmapped_page = domain->ops->unmap(domain, iova, left);
+		if (nosync)
+			unmapped_page = domain->ops->unmap_nosync(domain, iova,
+								  left);
+		else
+			unmapped_page = domain->ops->unmap(domain, iova, left);
 		if (!unmapped_page)
 			break;
 
@@ -1233,8 +1238,74 @@ size_t iommu_unmap(struct iommu_domain *domain, unsigned long iova, size_t size)
 	trace_unmap_end(iova, 0, size);
 	return unmapped;
 }
+
+size_t iommu_unmap(struct iommu_domain *domain, unsigned long iova, size_t size)
+{
+	return __iommu_unmap(domain, iova, size, false);
+}
 EXPORT_SYMBOL_GPL(iommu_unmap);
 
+static void iommu_iotlb_gather_add(struct iommu_iotlb_gather *gather,
+				   unsigned long iova, size_t size)
+{
+	unsigned int n = gather->nr_ranges;
+
+	gather->size += size;
+	if (n && gather->ranges[n - 1].iova + gather->ranges[n - 1].size ==
+	    iova) {
+		gather->ranges[n - 1].size += size;
+	} else if (n < IOMMU_GATHER_MAX_RANGES) {
+		gather->ranges[n].iova = iova;
+		gather->ranges[n].size = size;
+		gather->nr_ranges++;
+	} else {
+		gather->overflow = true;
+	}
+}
+
+/**
+ * iommu_unmap_gather() - unmap a range and defer its TLB invalidation
+ * @domain: domain to unmap from
+ * @iova: start of the range
+ * @size: size of the range
+ * @gather: where to record the range
+ *
+ * The caller must call iommu_iotlb_sync() on @gather before the range or
+ * the memory it pointed at is reused.  Domains whose driver can't defer
+ * the invalidation are unmapped with iommu_unmap() and add nothing to
+ * @gather.
+ */
+size_t iommu_unmap_gather(struct iommu_domain *domain, unsigned long iova,
+			  size_t size, struct iommu_iotlb_gather *gather)
+{
+	size_t unmapped;
+
+	if (!domain->ops->unmap_nosync || !domain->ops->iotlb_sync)
+		return iommu_unmap(domain, iova, size);
+
+	unmapped = __iommu_unmap(domain, iova, size, true);
+	if (unmapped && !IS_ERR_VALUE(unmapped))
+		iommu_iotlb_gather_add(gather, iova, unmapped);
+
+	return unmapped;
+}
+EXPORT_SYMBOL_GPL(iommu_unmap_gather);
+
+/**
+ * iommu_iotlb_sync() - invalidate everything gathered and reset the gather
+ * @domain: domain the gather belongs to
+ * @gather: ranges collected by iommu_unmap_gather()
+ */
+void iommu_iotlb_sync(struct iommu_domain *domain,
+		      struct iommu_iotlb_gather *gather)
+{
+	if (gather->size && domain->ops->iotlb_sync)
+		domain->ops->iotlb_sync(domain, gather);
+
+	iommu_iotlb_gather_init(gather);
+}
+EXPORT_SYMBOL_GPL(iommu_iotlb_sync);
+
 size_t default_iommu_map_sg(struct iommu_domain *domain, unsigned long iova,
 			 struct scatterlist *sg, unsigned int nents, int prot)
 {
@@ -17,6 +17,9 @@
 #include <linux/rbtree.h>
 #include <linux/mutex.h>
 #include <linux/err.h>
+#include <linux/debugfs.h>
+#include <linux/module.h>
+#include <linux/seq_file.h>
 
 #include <linux/msm_dma_iommu_mapping.h>
 
@@ -29,10 +32,18 @@
  * @dir - The direction for the unmap.
  * @meta - Backpointer to the meta this guy belongs to.
  * @ref - for reference counting this mapping
+ * @lru - node in the device's list of idle lazy mappings
+ * @idev - per device cache state, NULL if this mapping isn't tracked
+ * @size - bytes mapped
+ * @active - outstanding map calls not yet unmapped
+ * @lazy - mapping is kept around after the last unmap
  *
  * Represents a mapping of one dma_buf buffer to a particular device
  * and address range. There may exist other mappings of this buffer in
  * different devices. All mappings will have the same cacheability and security.
+ *
+ * @lru and @active are protected by the meta lock, @lru additionally by
+ * msm_iommu_lru_mutex.
  */
 struct msm_iommu_map {
 	struct list_head lnode;
@@ -43,6 +54,37 @@ struct msm_iommu_map {
 	enum dma_data_direction dir;
 	struct msm_iommu_meta *meta;
 	struct kref ref;
+	struct list_head lru;
+	struct msm_iommu_dev *idev;
+	size_t size;
+	unsigned int active;
+	bool lazy;
+};
+
+/**
+ * struct msm_iommu_dev - per device cache of idle lazy mappings
+ * @node - entry in msm_iommu_devs
+ * @dev - the device, used as key
+ * @lru - idle mappings, least recently unmapped first
+ * @idle_bytes - bytes of IOVA held by idle mappings
+ * @nr_idle - number of idle mappings
+ * @hits - map calls served by an existing mapping
+ * @misses - map calls that had to create a mapping
+ * @evictions - idle mappings torn down to stay within the limits
+ *
+ * A lazy mapping outlives its last unmap so the next map of the same
+ * buffer is free; bounding the idle ones per device keeps long lived
+ * buffers from pinning IOVA space and page tables forever.
+ */
+struct msm_iommu_dev {
+	struct list_head node;
+	struct device *dev;
+	struct list_head lru;
+	size_t idle_bytes;
+	unsigned int nr_idle;
+	atomic_long_t hits;
+	atomic_long_t misses;
+	atomic_long_t evictions;
 };
 
 struct msm_iommu_meta {
@@ -51,11 +93,98 @@ struct msm_iommu_meta {
 	struct kref ref;
 	struct mutex lock;
 	void *buffer;
+	bool late_unmap;
 };
 
 static struct rb_root iommu_root;
 static DEFINE_MUTEX(msm_iommu_map_mutex);
 
+static LIST_HEAD(msm_iommu_devs);
+static DEFINE_MUTEX(msm_iommu_lru_mutex);
+
+static unsigned int max_idle_kb = 256 << 10;
+module_param(max_idle_kb, uint, 0644);
+MODULE_PARM_DESC(max_idle_kb, "Idle lazy mapping IOVA kept per device (kB)");
+
+static struct msm_iommu_dev *msm_iommu_dev_get(struct device *dev)
+{
+	struct msm_iommu_dev *idev;
+
+	mutex_lock(&msm_iommu_lru_mutex);
+	list_for_each_entry(idev, &msm_iommu_devs, node) {
+		if (idev->dev == dev)
+			goto out;
+	}
+
+	idev = kzalloc(sizeof(*idev), GFP_KERNEL);
+	if (idev) {
+		idev->dev = dev;
+		INIT_LIST_HEAD(&idev->lru);
+		list_add(&idev->node, &msm_iommu_devs);
+	}
+out:
+	mutex_unlock(&msm_iommu_lru_mutex);
+	return idev;
+}
+
+/* meta lock held */
+static void msm_iommu_map_idle(struct msm_iommu_map *map)
+{
+	struct msm_iommu_dev *idev = map->idev;
+
+	mutex_lock(&msm_iommu_lru_mutex);
+	list_add_tail(&map->lru, &idev->lru);
+	idev->idle_bytes += map->size;
+	idev->nr_idle++;
+	mutex_unlock(&msm_iommu_lru_mutex);
+}
+
+/* meta lock held */
+static void msm_iommu_map_busy(struct msm_iommu_map *map)
+{
+	struct msm_iommu_dev *idev = map->idev;
+
+	if (list_empty(&map->lru))
+		return;
+
+	mutex_lock(&msm_iommu_lru_mutex);
+	list_del_init(&map->lru);
+	idev->idle_bytes -= map->size;
+	idev->nr_idle--;
+	mutex_unlock(&msm_iommu_lru_mutex);
+}
+
+static void msm_iommu_map_release(struct kref *kref);
+
+/*
+ * Tear down the least recently used idle mappings of @idev until they
+ * hold no more than @limit bytes. The meta lock nests outside the lru
+ * mutex elsewhere so only trylock it here, and skip mappings whose
+ * buffer is busy; an idle mapping holds just its lazy reference.
+ */
+static void msm_iommu_dev_evict(struct msm_iommu_dev *idev, size_t limit)
+{
+	struct msm_iommu_map *map, *tmp;
+
+	mutex_lock(&msm_iommu_lru_mutex);
+	list_for_each_entry_safe(map, tmp, &idev->lru, lru) {
+		struct msm_iommu_meta *meta = map->meta;
+
+		if (idev->idle_bytes <= limit)
+			break;
+		if (!mutex_trylock(&meta->lock))
+			continue;
+
+		list_del_init(&map->lru);
+		idev->idle_bytes -= map->size;
+		idev->nr_idle--;
+		atomic_long_inc(&idev->evictions);
+		kref_put(&map->ref, msm_iommu_map_release);
+		mutex_unlock(&meta->lock);
+	}
+	mutex_unlock(&msm_iommu_lru_mutex);
+}
+
 static void msm_iommu_meta_add(struct msm_iommu_meta *meta)
 {
 	struct rb_root *root = &iommu_root;
@@ -178,10 +307,20 @@ static inline int __msm_dma_map_sg(struct device *dev, struct scatterlist *sg,
 		}
 		if (late_unmap) {
 			kref_get(&iommu_meta->ref);
+			iommu_meta->late_unmap = true;
 			extra_meta_ref_taken = true;
 		}
 	} else {
 		kref_get(&iommu_meta->ref);
+		/*
+		 * First lazy mapping of a buffer mapped eagerly so far: the
+		 * meta must now also live until msm_dma_buf_freed(), which
+		 * drops this reference.
+		 */
+		if (late_unmap && !iommu_meta->late_unmap) {
+			kref_get(&iommu_meta->ref);
+			iommu_meta->late_unmap = true;
+		}
 	}
 
 	mutex_unlock(&msm_iommu_map_mutex);
@@ -189,6 +328,10 @@ static inline int __msm_dma_map_sg(struct device *dev, struct scatterlist *sg,
 	mutex_lock(&iommu_meta->lock);
 	iommu_map = msm_iommu_lookup(iommu_meta, dev);
 	if (!iommu_map) {
+		struct msm_iommu_dev *idev = NULL;
+		struct scatterlist *s;
+		int i;
+
 		iommu_map = kmalloc(sizeof(*iommu_map), GFP_ATOMIC);
 
 		if (!iommu_map) {
@@ -196,7 +339,15 @@ static inline int __msm_dma_map_sg(struct device *dev, struct scatterlist *sg,
 			goto out_unlock;
 		}
 
+		if (late_unmap)
+			idev = msm_iommu_dev_get(dev);
+
 		ret = dma_map_sg_attrs(dev, sg, nents, dir, attrs);
+		if (ret != nents && idev) {
+			/* out of IOVA space, give back what is idle and retry */
+			msm_iommu_dev_evict(idev, 0);
+			ret = dma_map_sg_attrs(dev, sg, nents, dir, attrs);
+		}
 		if (ret != nents) {
 			kfree(iommu_map);
 			goto out_unlock;
@@ -208,14 +359,29 @@ static inline int __msm_dma_map_sg(struct device *dev, struct scatterlist *sg,
 		iommu_map->meta = iommu_meta;
 		iommu_map->sgl.dma_address = sg->dma_address;
 		iommu_map->sgl.dma_length = sg->dma_length;
+		iommu_map->nents = nents;
+		iommu_map->dir = dir;
 		iommu_map->dev = dev;
+		INIT_LIST_HEAD(&iommu_map->lru);
+		iommu_map->idev = idev;
+		iommu_map->size = 0;
+		for_each_sg(sg, s, nents, i)
+			iommu_map->size += s->length;
+		iommu_map->active = 1;
+		iommu_map->lazy = late_unmap;
 		msm_iommu_add(iommu_meta, iommu_map);
+		if (idev)
+			atomic_long_inc(&idev->misses);
 
 	} else {
 		sg->dma_address = iommu_map->sgl.dma_address;
 		sg->dma_length = iommu_map->sgl.dma_length;
 
 		kref_get(&iommu_map->ref);
+		if (iommu_map->active++ == 0 && iommu_map->idev)
+			msm_iommu_map_busy(iommu_map);
+		if (iommu_map->idev)
+			atomic_long_inc(&iommu_map->idev->hits);
 		/*
 		 * Need to do cache operations here based on "dir" in the
 		 * future if we go with coherent mappings.
@@ -296,6 +462,8 @@ static void msm_iommu_map_release(struct kref *kref)
 	struct msm_iommu_map *map = container_of(kref, struct msm_iommu_map,
 						ref);
 
+	if (map->idev)
+		msm_iommu_map_busy(map);
 	list_del(&map->lnode);
 	dma_unmap_sg(map->dev, &map->sgl, map->nents, map->dir);
 	kfree(map);
@@ -306,6 +474,7 @@ void msm_dma_unmap_sg(struct device *dev, struct scatterlist *sgl, int nents,
 {
 	struct msm_iommu_map *iommu_map;
 	struct msm_iommu_meta *meta;
+	struct msm_iommu_dev *idev = NULL;
 
 	mutex_lock(&msm_iommu_map_mutex);
 	meta = msm_iommu_meta_lookup(dma_buf->priv);
@@ -335,11 +504,17 @@ void msm_dma_unmap_sg(struct device *dev, struct scatterlist *sgl, int nents,
 	 */
 	iommu_map->dir = dir;
 
+	if (--iommu_map->active == 0 && iommu_map->lazy && iommu_map->idev) {
+		idev = iommu_map->idev;
+		msm_iommu_map_idle(iommu_map);
+	}
 	kref_put(&iommu_map->ref, msm_iommu_map_release);
 	mutex_unlock(&meta->lock);
 
 	msm_iommu_meta_put(meta);
 
+	if (idev)
+		msm_iommu_dev_evict(idev, (size_t)max_idle_kb << 10);
 out:
 	return;
 }
@@ -383,3 +558,40 @@ out:
 
 }
 
+static int msm_iommu_devs_show(struct seq_file *s, void *unused)
+{
+	struct msm_iommu_dev *idev;
+
+	seq_printf(s, "%-32s %8s %10s %10s %10s %10s\n", "device", "idle",
+		   "idle_kb", "hits", "misses", "evictions");
+	mutex_lock(&msm_iommu_lru_mutex);
+	list_for_each_entry(idev, &msm_iommu_devs, node)
+		seq_printf(s, "%-32s %8u %10zu %10ld %10ld %10ld\n",
+			   dev_name(idev->dev), idev->nr_idle,
+			   idev->idle_bytes >> 10,
+			   atomic_long_read(&idev->hits),
+			   atomic_long_read(&idev->misses),
+			   atomic_long_read(&idev->evictions));
+	mutex_unlock(&msm_iommu_lru_mutex);
+	return 0;
+}
+
+static int msm_iommu_devs_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_iommu_devs_show, NULL);
+}
+
+static const struct file_operations msm_iommu_devs_fops = {
+	.open = msm_iommu_devs_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init msm_dma_iommu_mapping_init(void)
+{
+	debugfs_create_file("msm_dma_iommu_mapping", 0444, NULL, NULL,
+			    &msm_iommu_devs_fops);
+	return 0;
+}
+late_initcall(msm_dma_iommu_mapping_init);
@@ -72,6 +72,7 @@ int msm_iommu_map_extra(struct iommu_domain *domain,
 				unsigned long page_size,
 				int prot)
 {
+	struct iommu_iotlb_gather gather;
 	int ret = 0;
 	int i = 0;
 	unsigned long temp_iova = start_iova;
@@ -126,10 +127,12 @@ int msm_iommu_map_extra(struct iommu_domain *domain,
 	}
 	return ret;
 out:
+	iommu_iotlb_gather_init(&gather);
 	for (; i > 0; --i) {
 		temp_iova -= page_size;
-		iommu_unmap(domain, start_iova, page_size);
+		iommu_unmap_gather(domain, temp_iova, page_size, &gather);
 	}
+	iommu_iotlb_sync(domain, &gather);
 	return ret;
 }
 
@@ -143,11 +146,15 @@ void msm_iommu_unmap_extra(struct iommu_domain *domain,
 	unsigned long aligned_size = ALIGN(size, page_size);
 	unsigned long nrpages =  aligned_size >> (PAGE_SHIFT + order);
 	unsigned long temp_iova = start_iova;
+	struct iommu_iotlb_gather gather;
 
+	/* One invalidate for the whole extent rather than one per page */
+	iommu_iotlb_gather_init(&gather);
 	for (i = 0; i < nrpages; ++i) {
-		iommu_unmap(domain, temp_iova, page_size);
+		iommu_unmap_gather(domain, temp_iova, page_size, &gather);
 		temp_iova += page_size;
 	}
+	iommu_iotlb_sync(domain, &gather);
 }
 
 static int msm_iommu_map_iova_phys(struct iommu_domain *domain,
@@ -383,6 +383,15 @@ struct cached_dev {
 	unsigned		writeback_rate_update_seconds;
 	unsigned		writeback_rate_d_term;
 	unsigned		writeback_rate_p_term_inverse;
+
+	/*
+	 * Writeback slows to a trickle when running on battery below this
+	 * capacity (percent), or when the battery is at least this hot
+	 * (tenths of a degree C). 0 disables the check.
+	 */
+	unsigned		writeback_throttle_capacity;
+	int			writeback_throttle_temp;
+	bool			writeback_throttled;
 };
 
 enum alloc_reserve {
@@ -678,6 +687,12 @@ struct cache_set {
 	unsigned		shrinker_disabled:1;
 	unsigned		copy_gc_enabled:1;
 
+	/*
+	 * If nonzero, the btree node cache stops growing past this many
+	 * nodes and recycles the least recently used clean ones instead
+	 */
+	unsigned		btree_cache_max;
+
 #define BUCKET_HASH_BITS	12
 	struct hlist_head	bucket_hash[1 << BUCKET_HASH_BITS];
 };
@@ -907,6 +907,20 @@ static struct btree *mca_alloc(struct cache_set *c, struct btree_op *op,
 		if (!mca_reap(b, btree_order(k), false))
 			goto out;
 
+	/*
+	 * On small memory machines the cache is capped: rather than
+	 * allocating, reuse the oldest clean node not accessed lately.
+	 */
+	if (c->btree_cache_max &&
+	    c->btree_cache_used >= max_t(int, c->btree_cache_max,
+					 mca_reserve(c)))
+		list_for_each_entry_reverse(b, &c->btree_cache, list) {
+			if (!b->accessed &&
+			    !mca_reap(b, btree_order(k), false))
+				goto out;
+			b->accessed = 0;
+		}
+
 	/* We never free struct btree itself, just the memory that holds the on
 	 * disk node. Check the freed list before allocating a new one:
 	 */
@@ -211,13 +211,21 @@ void bch_moving_gc(struct cache_set *c)
 		unsigned sectors_to_move = 0;
 		unsigned reserve_sectors = ca->sb.bucket_size *
 			fifo_used(&ca->free[RESERVE_MOVINGGC]);
+		/*
+		 * With discards the flash device learns about every bucket we
+		 * free and reclaims it without copying; moving a mostly full
+		 * bucket would then cost more flash writes than it frees.
+		 */
+		unsigned max_used = ca->discard
+			? ca->sb.bucket_size / 2
+			: ca->sb.bucket_size - 1;
 
 		ca->heap.used = 0;
 
 		for_each_bucket(b, ca) {
 			if (GC_MARK(b) == GC_MARK_METADATA ||
 			    !GC_SECTORS_USED(b) ||
-			    GC_SECTORS_USED(b) == ca->sb.bucket_size ||
+			    GC_SECTORS_USED(b) > max_used ||
 			    atomic_read(&b->pin))
 				continue;
 
@@ -83,6 +83,9 @@ rw_attribute(writeback_rate_update_seconds);
 rw_attribute(writeback_rate_d_term);
 rw_attribute(writeback_rate_p_term_inverse);
 read_attribute(writeback_rate_debug);
+rw_attribute(writeback_throttle_capacity);
+rw_attribute(writeback_throttle_temp);
+read_attribute(writeback_throttled);
 
 read_attribute(stripe_size);
 read_attribute(partial_stripes_expensive);
@@ -104,6 +107,7 @@ rw_attribute(expensive_debug_checks);
 rw_attribute(cache_replacement_policy);
 rw_attribute(btree_shrinker_disabled);
 rw_attribute(copy_gc_enabled);
+rw_attribute(btree_cache_max);
 rw_attribute(size);
 
 SHOW(__bch_cached_dev)
@@ -131,6 +135,9 @@ SHOW(__bch_cached_dev)
 	var_print(writeback_rate_update_seconds);
 	var_print(writeback_rate_d_term);
 	var_print(writeback_rate_p_term_inverse);
+	var_print(writeback_throttle_capacity);
+	var_print(writeback_throttle_temp);
+	var_printf(writeback_throttled,	"%i");
 
 	if (attr == &sysfs_writeback_rate_debug) {
 		char rate[20];
@@ -214,6 +221,10 @@ STORE(__cached_dev)
 	d_strtoul_nonzero(writeback_rate_update_seconds);
 	d_strtoul(writeback_rate_d_term);
 	d_strtoul_nonzero(writeback_rate_p_term_inverse);
+	sysfs_strtoul_clamp(writeback_throttle_capacity,
+			    dc->writeback_throttle_capacity, 0, 100);
+	sysfs_strtoul_clamp(writeback_throttle_temp,
+			    dc->writeback_throttle_temp, 0, INT_MAX);
 
 	sysfs_strtoul_clamp(sequential_cutoff,
 			    dc->sequential_cutoff,
@@ -326,6 +337,9 @@ static struct attribute *bch_cached_dev_files[] = {
 	&sysfs_writeback_rate_d_term,
 	&sysfs_writeback_rate_p_term_inverse,
 	&sysfs_writeback_rate_debug,
+	&sysfs_writeback_throttle_capacity,
+	&sysfs_writeback_throttle_temp,
+	&sysfs_writeback_throttled,
 	&sysfs_dirty_data,
 	&sysfs_stripe_size,
 	&sysfs_partial_stripes_expensive,
@@ -574,6 +588,7 @@ SHOW(__bch_cache_set)
 	sysfs_printf(gc_always_rewrite,		"%i", c->gc_always_rewrite);
 	sysfs_printf(btree_shrinker_disabled,	"%i", c->shrinker_disabled);
 	sysfs_printf(copy_gc_enabled,		"%i", c->copy_gc_enabled);
+	sysfs_print(btree_cache_max,		c->btree_cache_max);
 
 	if (attr == &sysfs_bset_tree_stats)
 		return bch_bset_print_stats(c, buf);
@@ -666,6 +681,7 @@ STORE(__bch_cache_set)
 	sysfs_strtoul(gc_always_rewrite,	c->gc_always_rewrite);
 	sysfs_strtoul(btree_shrinker_disabled,	c->shrinker_disabled);
 	sysfs_strtoul(copy_gc_enabled,		c->copy_gc_enabled);
+	sysfs_strtoul(btree_cache_max,		c->btree_cache_max);
 
 	return size;
 }
@@ -741,6 +757,7 @@ static struct attribute *bch_cache_set_internal_files[] = {
 	&sysfs_gc_always_rewrite,
 	&sysfs_btree_shrinker_disabled,
 	&sysfs_copy_gc_enabled,
+	&sysfs_btree_cache_max,
 	NULL
 };
 KTYPE(bch_cache_set_internal);
@@ -14,10 +14,38 @@
 #include <linux/delay.h>
 #include <linux/freezer.h>
 #include <linux/kthread.h>
+#include <linux/power_supply.h>
 #include <trace/events/bcache.h>
 
 /* Rate limiting */
 
+static bool writeback_should_throttle(struct cached_dev *dc)
+{
+#ifdef CONFIG_POWER_SUPPLY
+	struct power_supply *psy;
+	union power_supply_propval val;
+
+	if (!dc->writeback_throttle_capacity && !dc->writeback_throttle_temp)
+		return false;
+
+	psy = power_supply_get_by_name("battery");
+	if (!psy || !psy->get_property)
+		return false;
+
+	if (dc->writeback_throttle_temp &&
+	    !psy->get_property(psy, POWER_SUPPLY_PROP_TEMP, &val) &&
+	    val.intval >= dc->writeback_throttle_temp)
+		return true;
+
+	if (dc->writeback_throttle_capacity &&
+	    power_supply_is_system_supplied() <= 0 &&
+	    !psy->get_property(psy, POWER_SUPPLY_PROP_CAPACITY, &val) &&
+	    val.intval < dc->writeback_throttle_capacity)
+		return true;
+#endif
+	return false;
+}
+
 static void __update_writeback_rate(struct cached_dev *dc)
 {
 	struct cache_set *c = dc->disk.c;
@@ -38,6 +66,20 @@ static void __update_writeback_rate(struct cached_dev *dc)
 
 	dc->disk.sectors_dirty_last = dirty;
 
+	/*
+	 * Writing back to a slow backing device keeps it and the cache busy;
+	 * put that off while the battery is low or hot, unless dirty data
+	 * has grown to twice the target.
+	 */
+	if (dc->writeback_throttled && dirty < target * 2) {
+		dc->writeback_rate.rate = 1;
+		dc->writeback_rate_proportional = 0;
+		dc->writeback_rate_derivative = 0;
+		dc->writeback_rate_change = 0;
+		dc->writeback_rate_target = target;
+		return;
+	}
+
 	/* Scale to sectors per second */
 
 	proportional *= dc->writeback_rate_update_seconds;
@@ -76,6 +118,8 @@ static void update_writeback_rate(struct work_struct *work)
 					     struct cached_dev,
 					     writeback_rate_update);
 
+	dc->writeback_throttled = writeback_should_throttle(dc);
+
 	down_read(&dc->writeback_lock);
 
 	if (atomic_read(&dc->has_dirty) &&
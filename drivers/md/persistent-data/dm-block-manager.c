@@ -365,6 +365,11 @@ static void dm_block_manager_write_callback(struct dm_buffer *buf)
 struct dm_block_manager {
 	struct dm_bufio_client *bufio;
 	bool read_only:1;
+
+	atomic64_t read_locks;
+	atomic64_t read_misses;
+	atomic64_t write_locks;
+	atomic64_t prefetches;
 };
 
 struct dm_block_manager *dm_block_manager_create(struct block_device *bdev,
@@ -392,6 +397,10 @@ struct dm_block_manager *dm_block_manager_create(struct block_device *bdev,
 	}
 
 	bm->read_only = false;
+	atomic64_set(&bm->read_locks, 0);
+	atomic64_set(&bm->read_misses, 0);
+	atomic64_set(&bm->write_locks, 0);
+	atomic64_set(&bm->prefetches, 0);
 
 	return bm;
 
@@ -453,7 +462,13 @@ int dm_bm_read_lock(struct dm_block_manager *bm, dm_block_t b,
 	void *p;
 	int r;
 
-	p = dm_bufio_read(bm->bufio, b, (struct dm_buffer **) result);
+	atomic64_inc(&bm->read_locks);
+	/* Look in the cache first, only so that misses can be counted */
+	p = dm_bufio_get(bm->bufio, b, (struct dm_buffer **) result);
+	if (!p) {
+		atomic64_inc(&bm->read_misses);
+		p = dm_bufio_read(bm->bufio, b, (struct dm_buffer **) result);
+	}
 	if (unlikely(IS_ERR(p)))
 		return PTR_ERR(p);
 
@@ -489,6 +504,8 @@ int dm_bm_write_lock(struct dm_block_manager *bm,
 	if (bm->read_only)
 		return -EPERM;
 
+	atomic64_inc(&bm->write_locks);
+
 	p = dm_bufio_read(bm->bufio, b, (struct dm_buffer **) result);
 	if (unlikely(IS_ERR(p)))
 		return PTR_ERR(p);
@@ -606,9 +623,19 @@ EXPORT_SYMBOL_GPL(dm_bm_flush);
 
 void dm_bm_prefetch(struct dm_block_manager *bm, dm_block_t b)
 {
+	atomic64_inc(&bm->prefetches);
 	dm_bufio_prefetch(bm->bufio, b, 1);
 }
 
+void dm_bm_get_stats(struct dm_block_manager *bm, struct dm_bm_stats *stats)
+{
+	stats->read_locks = atomic64_read(&bm->read_locks);
+	stats->read_misses = atomic64_read(&bm->read_misses);
+	stats->write_locks = atomic64_read(&bm->write_locks);
+	stats->prefetches = atomic64_read(&bm->prefetches);
+}
+EXPORT_SYMBOL_GPL(dm_bm_get_stats);
+
 void dm_bm_set_read_only(struct dm_block_manager *bm)
 {
 	bm->read_only = true;
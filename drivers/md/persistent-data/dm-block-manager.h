@@ -112,6 +112,19 @@ int dm_bm_flush(struct dm_block_manager *bm);
  */
 void dm_bm_prefetch(struct dm_block_manager *bm, dm_block_t b);
 
+/*
+ * Counters since the block manager was created.  read_misses are the read
+ * locks that had to wait for the block to come in from disk.
+ */
+struct dm_bm_stats {
+	uint64_t read_locks;
+	uint64_t read_misses;
+	uint64_t write_locks;
+	uint64_t prefetches;
+};
+
+void dm_bm_get_stats(struct dm_block_manager *bm, struct dm_bm_stats *stats);
+
 /*
  * Switches the bm to a read only mode.  Once read-only mode
  * has been entered the following functions will return -EPERM.
@@ -334,8 +334,16 @@ static int btree_lookup_raw(struct ro_spine *s, dm_block_t block, uint64_t key,
 		if (i < 0 || i >= nr_entries)
 			return -ENODATA;
 
-		if (flags & INTERNAL_NODE)
+		if (flags & INTERNAL_NODE) {
 			block = value64(ro_node(s), i);
+			/*
+			 * Metadata is mostly looked up in key order, start
+			 * reading the next sibling while we go down this one.
+			 */
+			if (i + 1 < nr_entries)
+				dm_bm_prefetch(dm_tm_get_bm(s->info->tm),
+					       value64(ro_node(s), i + 1));
+		}
 
 	} while (!(flags & LEAF_NODE));
 
@@ -848,6 +856,11 @@ static int walk_node(struct dm_btree_info *info, dm_block_t block,
 	n = dm_block_data(node);
 
 	nr = le32_to_cpu(n->header.nr_entries);
+	/* All the children are going to be visited, read them in parallel */
+	if (le32_to_cpu(n->header.flags) & INTERNAL_NODE)
+		for (i = 0; i < nr; i++)
+			dm_bm_prefetch(dm_tm_get_bm(info->tm), value64(n, i));
+
 	for (i = 0; i < nr; i++) {
 		if (le32_to_cpu(n->header.flags) & INTERNAL_NODE) {
 			r = walk_node(info, value64(n, i), fn, context);
@@ -23,6 +23,10 @@
 #include <linux/dma-mapping.h>
 #include <linux/msm_dma_iommu_mapping.h>
 #include <linux/workqueue.h>
+#include <linux/hashtable.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/fs.h>
 #include "cam_smmu_api.h"
 
 #define SCRATCH_ALLOC_START SZ_128K
@@ -35,6 +39,9 @@
 #define COOKIE_MASK ((1<<COOKIE_SIZE)-1)
 #define HANDLE_INIT (-1)
 #define CAM_SMMU_CB_MAX 2
+#define CAM_SMMU_BUF_HASH_BITS 5
+/* unreferenced mappings kept per context bank until the session ends */
+#define CAM_SMMU_MAX_CACHED_BUFS 64
 
 #define GET_SMMU_HDL(x, y) (((x) << COOKIE_SIZE) | ((y) & COOKIE_MASK))
 #define GET_SMMU_TABLE_IDX(x) (((x) >> COOKIE_SIZE) & COOKIE_MASK)
@@ -96,6 +103,10 @@ struct cam_context_bank_info {
 	uint8_t scratch_buf_support;
 	struct scratch_mapping scratch_map;
 	struct list_head smmu_buf_list;
+	DECLARE_HASHTABLE(smmu_buf_hash, CAM_SMMU_BUF_HASH_BITS);
+	u32 cached_cnt;
+	u32 map_hits;
+	u32 map_misses;
 	struct mutex lock;
 	int handle;
 	enum cam_smmu_ops_param state;
@@ -113,6 +124,7 @@ struct cam_iommu_cb_set {
 	struct work_struct smmu_work;
 	struct mutex payload_list_lock;
 	struct list_head payload_list;
+	struct dentry *debugfs;
 };
 
 static struct of_device_id msm_cam_smmu_dt_match[] = {
@@ -131,6 +143,7 @@ struct cam_dma_buff_info {
 	int ref_count;
 	dma_addr_t paddr;
 	struct list_head list;
+	struct hlist_node hnode;
 	int ion_fd;
 	size_t len;
 	size_t phys_len;
@@ -474,6 +487,8 @@ void cam_smmu_reset_iommu_table(enum cam_smmu_init_dir ops)
 	for (i = 0; i < iommu_cb_set.cb_num; i++) {
 		iommu_cb_set.cb_info[i].handle = HANDLE_INIT;
 		INIT_LIST_HEAD(&iommu_cb_set.cb_info[i].smmu_buf_list);
+		hash_init(iommu_cb_set.cb_info[i].smmu_buf_hash);
+		iommu_cb_set.cb_info[i].cached_cnt = 0;
 		iommu_cb_set.cb_info[i].state = CAM_SMMU_DETACH;
 		iommu_cb_set.cb_info[i].dev = NULL;
 		iommu_cb_set.cb_info[i].cb_count = 0;
@@ -685,8 +700,8 @@ static struct cam_dma_buff_info *cam_smmu_find_mapping_by_ion_index(int idx,
 {
 	struct cam_dma_buff_info *mapping;
 
-	list_for_each_entry(mapping, &iommu_cb_set.cb_info[idx].smmu_buf_list,
-			list) {
+	hash_for_each_possible(iommu_cb_set.cb_info[idx].smmu_buf_hash,
+			mapping, hnode, ion_fd) {
 		if (mapping->ion_fd == ion_fd) {
 			CDBG(" find ion_fd %d\n", ion_fd);
 			return mapping;
@@ -731,6 +746,37 @@ static void cam_smmu_clean_buffer_list(int idx)
 			continue;
 		}
 	}
+	iommu_cb_set.cb_info[idx].cached_cnt = 0;
+}
+
+/*
+ * unmap the buffers which were kept mapped after their last user put them,
+ * either all of them when the session on the context bank goes away, or only
+ * those user space has closed: the mapping then holds the last reference on
+ * the dma buffer and would keep its memory pinned until the session ends
+ */
+static void cam_smmu_release_cached_buffers(int idx, bool closed_only)
+{
+	struct cam_context_bank_info *cb = &iommu_cb_set.cb_info[idx];
+	struct cam_dma_buff_info *mapping_info, *temp;
+
+	list_for_each_entry_safe(mapping_info, temp, &cb->smmu_buf_list, list) {
+		if (mapping_info->ion_fd == 0xDEADBEEF ||
+			mapping_info->ref_count > 0)
+			continue;
+
+		if (closed_only &&
+			file_count(mapping_info->buf->file) > 1)
+			continue;
+
+		if (cam_smmu_unmap_buf_and_remove_from_list(mapping_info,
+				idx) < 0) {
+			pr_err("Error: unmap cached fd %d fail\n",
+				mapping_info->ion_fd);
+			continue;
+		}
+		cb->cached_cnt--;
+	}
 }
 
 static int cam_smmu_attach(int idx)
@@ -845,6 +891,8 @@ static int cam_smmu_map_buffer_and_add_to_list(int idx, int ion_fd,
 
 	/* add to the list */
 	list_add(&mapping_info->list, &iommu_cb_set.cb_info[idx].smmu_buf_list);
+	hash_add(iommu_cb_set.cb_info[idx].smmu_buf_hash, &mapping_info->hnode,
+		ion_fd);
 	return 0;
 
 err_unmap_sg:
@@ -883,27 +931,69 @@ static int cam_smmu_unmap_buf_and_remove_from_list(
 	mapping_info->buf = NULL;
 
 	list_del_init(&mapping_info->list);
+	hash_del(&mapping_info->hnode);
 
 	/* free one buffer */
 	kfree(mapping_info);
 	return 0;
 }
 
+/*
+ * A cached mapping is only reused if the fd still refers to the very same
+ * dma buffer: user space may have closed the fd in the meantime and got the
+ * number back for another buffer.
+ */
+static bool cam_smmu_cached_buf_valid(struct cam_dma_buff_info *mapping,
+	int ion_fd, enum dma_data_direction dma_dir)
+{
+	struct dma_buf *buf;
+	bool valid;
+
+	if (mapping->dir != dma_dir)
+		return false;
+
+	buf = dma_buf_get(ion_fd);
+	if (IS_ERR_OR_NULL(buf))
+		return false;
+
+	valid = (buf == mapping->buf);
+	dma_buf_put(buf);
+
+	return valid;
+}
+
 static enum cam_smmu_buf_state cam_smmu_check_fd_in_list(int idx,
-					int ion_fd, dma_addr_t *paddr_ptr,
-					size_t *len_ptr)
+	int ion_fd, enum dma_data_direction dma_dir, dma_addr_t *paddr_ptr,
+	size_t *len_ptr)
 {
+	struct cam_context_bank_info *cb = &iommu_cb_set.cb_info[idx];
 	struct cam_dma_buff_info *mapping;
-	list_for_each_entry(mapping,
-			&iommu_cb_set.cb_info[idx].smmu_buf_list,
-			list) {
-		if (mapping->ion_fd == ion_fd) {
-			mapping->ref_count++;
-			*paddr_ptr = mapping->paddr;
-			*len_ptr = mapping->len;
-			return CAM_SMMU_BUFF_EXIST;
+
+	hash_for_each_possible(cb->smmu_buf_hash, mapping, hnode, ion_fd) {
+		if (mapping->ion_fd != ion_fd)
+			continue;
+
+		if (!mapping->ref_count) {
+			if (!cam_smmu_cached_buf_valid(mapping, ion_fd,
+					dma_dir)) {
+				CDBG("stale cached mapping for fd %d\n",
+					ion_fd);
+				cb->cached_cnt--;
+				cam_smmu_unmap_buf_and_remove_from_list(mapping,
+					idx);
+				break;
+			}
+			cb->cached_cnt--;
 		}
+
+		mapping->ref_count++;
+		*paddr_ptr = mapping->paddr;
+		*len_ptr = mapping->len;
+		cb->map_hits++;
+		return CAM_SMMU_BUFF_EXIST;
 	}
+
+	cb->map_misses++;
 	return CAM_SMMU_BUFF_NOT_EXIST;
 }
 
@@ -954,9 +1044,12 @@ int cam_smmu_ops(int handle, enum cam_smmu_ops_param ops)
 	switch (ops) {
 	case CAM_SMMU_ATTACH: {
 		ret = cam_smmu_attach(idx);
+		iommu_cb_set.cb_info[idx].map_hits = 0;
+		iommu_cb_set.cb_info[idx].map_misses = 0;
 		break;
 	}
 	case CAM_SMMU_DETACH: {
+		cam_smmu_release_cached_buffers(idx, false);
 		ret = 0;
 		break;
 	}
@@ -1306,13 +1399,16 @@ int cam_smmu_get_phy_addr(int handle, int ion_fd,
 		goto get_addr_end;
 	}
 
-	buf_state = cam_smmu_check_fd_in_list(idx, ion_fd, paddr_ptr, len_ptr);
+	buf_state = cam_smmu_check_fd_in_list(idx, ion_fd, dma_dir, paddr_ptr,
+			len_ptr);
 	if (buf_state == CAM_SMMU_BUFF_EXIST) {
 		CDBG("ion_fd:%d already in the list, give same addr back",
 				 ion_fd);
 		rc = 0;
 		goto get_addr_end;
 	}
+
+	cam_smmu_release_cached_buffers(idx, true);
 	rc = cam_smmu_map_buffer_and_add_to_list(idx, ion_fd, dma_dir,
 			paddr_ptr, len_ptr);
 	if (rc < 0) {
@@ -1356,6 +1452,9 @@ int cam_smmu_put_phy_addr(int handle, int ion_fd)
 		goto put_addr_end;
 	}
 
+	/* still referenced here, so this can't release mapping_info */
+	cam_smmu_release_cached_buffers(idx, true);
+
 	mapping_info->ref_count--;
 	if (mapping_info->ref_count > 0) {
 		CDBG("There are still %u buffer(s) with same fd %d",
@@ -1364,6 +1463,13 @@ int cam_smmu_put_phy_addr(int handle, int ion_fd)
 		goto put_addr_end;
 	}
 
+	/* keep it mapped for the next queue of the same buffer */
+	if (iommu_cb_set.cb_info[idx].cached_cnt < CAM_SMMU_MAX_CACHED_BUFS) {
+		iommu_cb_set.cb_info[idx].cached_cnt++;
+		rc = 0;
+		goto put_addr_end;
+	}
+
 	/* unmapping one buffer from device */
 	rc = cam_smmu_unmap_buf_and_remove_from_list(mapping_info, idx);
 	if (rc < 0) {
@@ -1396,6 +1502,7 @@ int cam_smmu_destroy_handle(int handle)
 		return -EINVAL;
 	}
 
+	cam_smmu_release_cached_buffers(idx, false);
 	if (!list_empty_careful(&iommu_cb_set.cb_info[idx].smmu_buf_list)) {
 		pr_err("Client %s buffer list is not clean!\n",
 			iommu_cb_set.cb_info[idx].name);
@@ -1610,6 +1717,35 @@ cb_init_fail:
 	return rc;
 }
 
+static int cam_smmu_stats_show(struct seq_file *s, void *unused)
+{
+	struct cam_context_bank_info *cb;
+	unsigned int i;
+
+	for (i = 0; i < iommu_cb_set.cb_num; i++) {
+		cb = &iommu_cb_set.cb_info[i];
+		mutex_lock(&cb->lock);
+		seq_printf(s, "%s: hits=%u misses=%u cached=%u\n",
+			cb->name ? cb->name : "unknown", cb->map_hits,
+			cb->map_misses, cb->cached_cnt);
+		mutex_unlock(&cb->lock);
+	}
+
+	return 0;
+}
+
+static int cam_smmu_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cam_smmu_stats_show, NULL);
+}
+
+static const struct file_operations cam_smmu_stats_fops = {
+	.open = cam_smmu_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int cam_smmu_probe(struct platform_device *pdev)
 {
 	int rc = 0;
@@ -1649,12 +1785,17 @@ static int cam_smmu_probe(struct platform_device *pdev)
 	mutex_init(&iommu_cb_set.payload_list_lock);
 	INIT_LIST_HEAD(&iommu_cb_set.payload_list);
 
+	iommu_cb_set.debugfs = debugfs_create_file("cam_smmu_stats", 0444,
+		NULL, NULL, &cam_smmu_stats_fops);
+
 	return rc;
 }
 
 static int cam_smmu_remove(struct platform_device *pdev)
 {
 	/* release all the context banks and memory allocated */
+	debugfs_remove(iommu_cb_set.debugfs);
+	iommu_cb_set.debugfs = NULL;
 	cam_smmu_reset_iommu_table(CAM_SMMU_TABLE_DEINIT);
 	if (of_device_is_compatible(pdev->dev.of_node, "qcom,msm-cam-smmu"))
 		cam_smmu_release_cb(pdev);
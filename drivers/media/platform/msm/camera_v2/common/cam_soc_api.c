@@ -24,6 +24,7 @@
 #include <linux/module.h>
 #include <linux/of_platform.h>
 #include <linux/msm-bus.h>
+#include <linux/devfreq.h>
 #include "cam_soc_api.h"
 
 struct msm_cam_bus_pscale_data {
@@ -33,6 +34,7 @@ struct msm_cam_bus_pscale_data {
 	uint32_t num_paths;
 	unsigned int vector_index;
 	bool dyn_vote;
+	uint64_t ab;
 	struct mutex lock;
 };
 
@@ -935,6 +937,18 @@ uint32_t msm_camera_register_bus_client(struct platform_device *pdev,
 }
 EXPORT_SYMBOL(msm_camera_register_bus_client);
 
+/* Hint the DDR governor with the AB of all camera bus clients */
+static void msm_camera_update_bw_floor(void)
+{
+	uint64_t ab = 0;
+	int i;
+
+	for (i = 0; i < CAM_BUS_CLIENT_MAX; i++)
+		ab += ACCESS_ONCE(g_cv[i].ab);
+
+	bw_hwmon_set_floor(BW_HWMON_FLOOR_CAMERA, ab >> 20);
+}
+
 /* Update the bus bandwidth */
 uint32_t msm_camera_update_bus_bw(int id, uint64_t ab, uint64_t ib)
 {
@@ -957,7 +971,9 @@ uint32_t msm_camera_update_bus_bw(int id, uint64_t ab, uint64_t ib)
 	idx = g_cv[id].vector_index;
 	idx = 1 - idx;
 	g_cv[id].vector_index = idx;
+	g_cv[id].ab = ab;
 	mutex_unlock(&g_cv[id].lock);
+	msm_camera_update_bw_floor();
 
 	pdata = g_cv[id].pdata;
 	path = &(pdata->usecase[idx]);
@@ -1011,6 +1027,8 @@ uint32_t msm_camera_unregister_bus_client(enum cam_bus_client id)
 	g_cv[id].num_paths = 0;
 	g_cv[id].vector_index = 0;
 	g_cv[id].dyn_vote = 0;
+	g_cv[id].ab = 0;
+	msm_camera_update_bw_floor();
 
 	return 0;
 }
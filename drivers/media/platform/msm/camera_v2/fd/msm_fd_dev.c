@@ -35,6 +35,10 @@
 #define MSM_FD_DEF_THRESHOLD 5
 #define MSM_FD_MAX_THRESHOLD_VALUE 9
 
+/* Tracking mode full frame interval and roi margin in face sizes */
+#define MSM_FD_MAX_TRACK_INTERVAL 30
+#define MSM_FD_TRACK_ROI_MARGIN 1
+
 /* Face angle lookup table */
 #define MSM_FD_DEF_ANGLE_IDX 2
 static int msm_fd_angle[] = {45, 135, 359};
@@ -206,6 +210,90 @@ int msm_fd_buf_init(struct vb2_buffer *vb)
 	return 0;
 }
 
+/*
+ * msm_fd_track_reset - Restart tracking with a full frame pass.
+ * @ctx: Fd context.
+ */
+static void msm_fd_track_reset(struct fd_ctx *ctx)
+{
+	spin_lock(&ctx->fd_device->slock);
+	ctx->track_cnt = 0;
+	memset(&ctx->track_roi, 0x00, sizeof(ctx->track_roi));
+	spin_unlock(&ctx->fd_device->slock);
+}
+
+/*
+ * msm_fd_track_crop - Select scan region of next buffer in tracking mode.
+ * @ctx: Fd context.
+ * @crop: Buffer crop, holding the user crop on entry.
+ *
+ * Every track_interval buffer and whenever no face is tracked the
+ * whole user crop is scanned, otherwise only the tracking roi.
+ */
+static void msm_fd_track_crop(struct fd_ctx *ctx, struct v4l2_rect *crop)
+{
+	if (!ctx->track_interval)
+		return;
+
+	spin_lock(&ctx->fd_device->slock);
+	if ((ctx->track_cnt++ % ctx->track_interval) &&
+		ctx->track_roi.width && ctx->track_roi.height)
+		*crop = ctx->track_roi;
+	spin_unlock(&ctx->fd_device->slock);
+}
+
+/*
+ * msm_fd_track_update - Update tracking roi from detection result.
+ * @ctx: Fd context.
+ * @stats: Detection result.
+ *
+ * The roi is the bounding box of all detected faces expanded by
+ * MSM_FD_TRACK_ROI_MARGIN of the biggest face size on each side and
+ * clipped to the user crop.
+ */
+static void msm_fd_track_update(struct fd_ctx *ctx,
+	struct msm_fd_stats *stats)
+{
+	struct v4l2_rect *crop = &ctx->format.crop;
+	struct v4l2_rect *face;
+	struct v4l2_rect roi;
+	int x1 = INT_MAX, y1 = INT_MAX;
+	int x2 = 0, y2 = 0;
+	int margin = 0;
+	int i;
+
+	if (!ctx->track_interval)
+		return;
+
+	memset(&roi, 0x00, sizeof(roi));
+	for (i = 0; i < stats->face_cnt; i++) {
+		face = &stats->face_data[i].face;
+		x1 = min_t(int, x1, face->left);
+		y1 = min_t(int, y1, face->top);
+		x2 = max_t(int, x2, face->left + face->width);
+		y2 = max_t(int, y2, face->top + face->height);
+		margin = max_t(int, margin, face->width);
+	}
+
+	if (stats->face_cnt) {
+		margin *= MSM_FD_TRACK_ROI_MARGIN;
+		x1 = max_t(int, x1 - margin, crop->left);
+		y1 = max_t(int, y1 - margin, crop->top);
+		x2 = min_t(int, x2 + margin, crop->left + crop->width);
+		y2 = min_t(int, y2 + margin, crop->top + crop->height);
+		if (x2 > x1 && y2 > y1) {
+			roi.left = x1;
+			roi.top = y1;
+			roi.width = x2 - x1;
+			roi.height = y2 - y1;
+		}
+	}
+
+	spin_lock(&ctx->fd_device->slock);
+	ctx->track_roi = roi;
+	spin_unlock(&ctx->fd_device->slock);
+}
+
 /*
  * msm_fd_buf_queue - vb2_ops buf_queue callback.
  * @vb: Pointer to vb2 buffer struct.
@@ -217,6 +305,7 @@ static void msm_fd_buf_queue(struct vb2_buffer *vb)
 		(struct msm_fd_buffer *)vb;
 
 	fd_buffer->format = ctx->format;
+	msm_fd_track_crop(ctx, &fd_buffer->format.crop);
 	fd_buffer->settings = ctx->settings;
 	fd_buffer->work_addr = ctx->work_buf.addr;
 	msm_fd_hw_add_buffer(ctx->fd_device, fd_buffer);
@@ -739,6 +828,7 @@ static int msm_fd_s_fmt_vid_out(struct file *file,
 	ctx->format.crop.left = 0;
 	ctx->format.crop.width = fd_size[index].width;
 	ctx->format.crop.height = fd_size[index].height;
+	msm_fd_track_reset(ctx);
 
 	return 0;
 }
@@ -954,6 +1044,15 @@ static int msm_fd_guery_ctrl(struct file *file, void *fh,
 		strlcpy(a->name, "msm fd ion fd of working memory",
 			sizeof(a->name));
 		break;
+	case V4L2_CID_FD_TRACKING_INTERVAL:
+		a->type = V4L2_CTRL_TYPE_INTEGER;
+		a->default_value = 0;
+		a->minimum = 0;
+		a->maximum = MSM_FD_MAX_TRACK_INTERVAL;
+		a->step = 1;
+		strlcpy(a->name, "msm fd tracking full frame interval",
+			sizeof(a->name));
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -999,6 +1098,9 @@ static int msm_fd_g_ctrl(struct file *file, void *fh, struct v4l2_control *a)
 
 		a->value = ctx->work_buf.fd;
 		break;
+	case V4L2_CID_FD_TRACKING_INTERVAL:
+		a->value = ctx->track_interval;
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -1077,6 +1179,15 @@ static int msm_fd_s_ctrl(struct file *file, void *fh, struct v4l2_control *a)
 		}
 		mutex_unlock(&ctx->fd_device->recovery_lock);
 		break;
+	case V4L2_CID_FD_TRACKING_INTERVAL:
+		if (a->value > MSM_FD_MAX_TRACK_INTERVAL)
+			a->value = MSM_FD_MAX_TRACK_INTERVAL;
+		else if (a->value < 0)
+			a->value = 0;
+
+		ctx->track_interval = a->value;
+		msm_fd_track_reset(ctx);
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -1162,6 +1273,7 @@ static int msm_fd_s_crop(struct file *file, void *fh,
 		return -EINVAL;
 
 	ctx->format.crop = crop->c;
+	msm_fd_track_reset(ctx);
 
 	return 0;
 }
@@ -1272,6 +1384,8 @@ static void msm_fd_wq_handler(struct work_struct *work)
 	/* Stats are ready, set correct frame id */
 	atomic_set(&stats->frame_id, ctx->sequence);
 
+	msm_fd_track_update(ctx, stats);
+
 	/* If Recovery mode is on, we got IRQ after recovery, reset it */
 	if (fd->recovery_mode) {
 		fd->recovery_mode = 0;
@@ -149,6 +149,10 @@ struct msm_fd_stats {
  * @mem_pool: FD hw memory pool.
  * @stats: Pointer to statistic buffers.
  * @work_buf: Working memory buffer handle.
+ * @track_interval: Full frame detection interval in tracking mode,
+ *  0 if tracking is disabled.
+ * @track_cnt: Number of buffers queued since tracking was enabled.
+ * @track_roi: Region around last detected faces, empty if none.
  */
 struct fd_ctx {
 	struct msm_fd_device *fd_device;
@@ -162,6 +166,9 @@ struct fd_ctx {
 	struct msm_fd_stats *stats;
 	struct msm_fd_buf_handle work_buf;
 	struct mutex lock;
+	unsigned int track_interval;
+	unsigned int track_cnt;
+	struct v4l2_rect track_roi;
 };
 
 /*
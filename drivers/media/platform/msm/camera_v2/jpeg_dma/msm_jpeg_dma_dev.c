@@ -1059,6 +1059,8 @@ static void msm_jpegdma_process_buffers(struct jpegdma_ctx *ctx,
 
 	plane_idx = ctx->plane_idx;
 	config_idx = ctx->config_idx;
+	if (!plane_idx)
+		ctx->job_start = ktime_get();
 	msm_jpegdma_hw_start(ctx->jdma_device, &addr,
 		&ctx->plane_config[config_idx].plane[plane_idx],
 		&ctx->plane_config[config_idx].speed);
@@ -1152,6 +1154,8 @@ void msm_jpegdma_isr_processing_done(struct msm_jpegdma_device *dma)
 			}
 			complete_all(&ctx->completion);
 			ctx->plane_idx = 0;
+			dev_dbg(dma->dev, "Jpeg v4l2 dma job done %lld us\n",
+				ktime_us_delta(ktime_get(), ctx->job_start));
 
 			v4l2_m2m_buf_done(src_buf, VB2_BUF_STATE_DONE);
 			v4l2_m2m_buf_done(dst_buf, VB2_BUF_STATE_DONE);
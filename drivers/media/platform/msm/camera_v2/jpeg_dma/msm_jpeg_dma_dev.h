@@ -250,6 +250,7 @@ struct msm_jpegdma_buf_handle {
  * @pending_config: Flag set if there is pending plane configuration.
  * @plane_idx: Processing plane index.
  * @format_idx: Current format index.
+ * @job_start: Time the first plane of the current job was started.
  */
 struct jpegdma_ctx {
 	struct mutex lock;
@@ -269,6 +270,7 @@ struct jpegdma_ctx {
 
 	unsigned int plane_idx;
 	unsigned int format_idx;
+	ktime_t job_start;
 };
 
 /*
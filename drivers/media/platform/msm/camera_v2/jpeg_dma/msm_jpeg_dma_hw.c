@@ -742,6 +742,10 @@ static void msm_jpegdma_hw_config_vbif(struct msm_jpegdma_device *dma)
  * @dma: Pointer to dma device.
  * @min_addr: Pointer to jpeg dma addr, containing min addrs of the plane.
  * @max_addr: Pointer to jpeg dma addr, containing max addrs of the plane.
+ *
+ * The vbif prefetch settings are static, they are programmed only when
+ * called without addresses after hw reset. Per plane calls update only
+ * the prefetch address window.
  */
 static void msm_jpegdma_hw_config_mmu_prefetch(struct msm_jpegdma_device *dma,
 	struct msm_jpegdma_addr *min_addr,
@@ -752,11 +756,12 @@ static void msm_jpegdma_hw_config_mmu_prefetch(struct msm_jpegdma_device *dma,
 	if (!dma->prefetch_regs_num)
 		return;
 
-	for (i = 0; i < dma->prefetch_regs_num; i++)
-		msm_jpegdma_hw_write_reg(dma, MSM_JPEGDMA_IOMEM_VBIF,
-			dma->prefetch_regs[i].reg, dma->prefetch_regs[i].val);
-
-	if (min_addr != NULL && max_addr != NULL) {
+	if (min_addr == NULL || max_addr == NULL) {
+		for (i = 0; i < dma->prefetch_regs_num; i++)
+			msm_jpegdma_hw_write_reg(dma, MSM_JPEGDMA_IOMEM_VBIF,
+				dma->prefetch_regs[i].reg,
+				dma->prefetch_regs[i].val);
+	} else {
 		msm_jpegdma_hw_write_reg(dma, MSM_JPEGDMA_IOMEM_CORE,
 			MSM_JPEGDMA_S0_MMU_PF_ADDR_MIN, min_addr->in_addr);
 		msm_jpegdma_hw_write_reg(dma, MSM_JPEGDMA_IOMEM_CORE,
@@ -1178,6 +1183,7 @@ int msm_jpegdma_hw_abort(struct msm_jpegdma_device *dma)
 		dev_err(dma->dev, "Fail to reset hw\n");
 		return ret;
 	}
+	msm_jpegdma_hw_config_mmu_prefetch(dma, NULL, NULL);
 	return 0;
 }
 
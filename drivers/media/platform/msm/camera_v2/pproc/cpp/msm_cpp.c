@@ -2769,6 +2769,57 @@ static int msm_cpp_cfg(struct cpp_device *cpp_dev,
 	return rc;
 }
 
+static int msm_cpp_cfg_batch(struct cpp_device *cpp_dev,
+	struct msm_camera_v4l2_ioctl_t *ioctl_ptr)
+{
+	struct msm_cpp_frame_batch_t batch;
+	struct msm_camera_v4l2_ioctl_t frame_ioctl;
+	int32_t status[MSM_CPP_MAX_BATCH_FRAMES];
+	int32_t rc = 0;
+	uint32_t i;
+
+	if (ioctl_ptr->len != sizeof(batch)) {
+		pr_err("%s:%d: invalid length\n", __func__, __LINE__);
+		return -EINVAL;
+	}
+
+	if (copy_from_user(&batch, (void __user *)ioctl_ptr->ioctl_ptr,
+			sizeof(batch)))
+		return -EFAULT;
+
+	if (!batch.num_frames ||
+		batch.num_frames > MSM_CPP_MAX_BATCH_FRAMES ||
+		!batch.frames) {
+		pr_err("%s: invalid batch of %u frames\n", __func__,
+			batch.num_frames);
+		return -EINVAL;
+	}
+
+	/*
+	 * Frames are independent of each other, so a failure is reported
+	 * in that frame's status slot and the remaining frames are still
+	 * submitted. The first error is returned as the ioctl result.
+	 */
+	frame_ioctl = *ioctl_ptr;
+	frame_ioctl.len = sizeof(struct msm_cpp_frame_info_t);
+	for (i = 0; i < batch.num_frames; i++) {
+		frame_ioctl.ioctl_ptr = (void __user *)&batch.frames[i];
+		status[i] = msm_cpp_cfg(cpp_dev, &frame_ioctl);
+		if (status[i] < 0 && !rc)
+			rc = status[i];
+	}
+
+	ioctl_ptr->trans_code = rc;
+
+	if (batch.status && copy_to_user((void __user *)batch.status, status,
+		sizeof(int32_t) * batch.num_frames)) {
+		pr_err("Error: cannot copy batch status");
+		return -EFAULT;
+	}
+
+	return rc;
+}
+
 void msm_cpp_clean_queue(struct cpp_device *cpp_dev)
 {
 	struct msm_queue_cmd *frame_qcmd = NULL;
@@ -3039,6 +3090,10 @@ long msm_cpp_subdev_ioctl(struct v4l2_subdev *sd,
 		CPP_DBG("VIDIOC_MSM_CPP_CFG\n");
 		rc = msm_cpp_cfg(cpp_dev, ioctl_ptr);
 		break;
+	case VIDIOC_MSM_CPP_CFG_BATCH:
+		CPP_DBG("VIDIOC_MSM_CPP_CFG_BATCH\n");
+		rc = msm_cpp_cfg_batch(cpp_dev, ioctl_ptr);
+		break;
 	case VIDIOC_MSM_CPP_FLUSH_QUEUE:
 		CPP_DBG("VIDIOC_MSM_CPP_FLUSH_QUEUE\n");
 		rc = msm_cpp_flush_frames(cpp_dev);
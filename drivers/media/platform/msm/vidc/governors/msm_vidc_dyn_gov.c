@@ -10,7 +10,9 @@
  * GNU General Public License for more details.
  */
 
+#include <linux/debugfs.h>
 #include <linux/module.h>
+#include <linux/seq_file.h>
 #include "governor.h"
 #include "fixedpoint.h"
 #include "msm_vidc_internal.h"
@@ -20,6 +22,31 @@
 static bool debug;
 module_param(debug, bool, 0644);
 
+/*
+ * Number of votes kept in the debugfs vote log.  Each entry records what
+ * the model asked for against the busy/total time the device reported
+ * for the same update, so the model can be checked against real usage.
+ */
+#define VOTE_LOG_SIZE 64
+
+struct vote_log_entry {
+	u64 time_ns;
+	const char *governor;
+	unsigned long sessions;
+	unsigned long ab_kbps;
+	unsigned long freq;
+	unsigned long busy_time, total_time;
+};
+
+static struct {
+	struct mutex lock;
+	struct vote_log_entry entries[VOTE_LOG_SIZE];
+	unsigned int head, count;
+	struct dentry *dir;
+} vote_log = {
+	.lock = __MUTEX_INITIALIZER(vote_log.lock),
+};
+
 enum governor_mode {
 	GOVERNOR_DDR,
 	GOVERNOR_VMEM,
@@ -1041,6 +1068,76 @@ static unsigned long __calculate(struct vidc_bus_vote_data *d,
 }
 
 
+static void __log_vote(struct governor *gov, unsigned long sessions,
+		unsigned long ab_kbps, unsigned long freq,
+		struct devfreq_dev_status *stats)
+{
+	struct vote_log_entry *e;
+
+	mutex_lock(&vote_log.lock);
+	e = &vote_log.entries[vote_log.head];
+	e->time_ns = ktime_get_ns();
+	e->governor = gov->devfreq_gov.name;
+	e->sessions = sessions;
+	e->ab_kbps = ab_kbps;
+	e->freq = freq;
+	e->busy_time = stats->busy_time;
+	e->total_time = stats->total_time;
+
+	vote_log.head = (vote_log.head + 1) % VOTE_LOG_SIZE;
+	if (vote_log.count < VOTE_LOG_SIZE)
+		vote_log.count++;
+	mutex_unlock(&vote_log.lock);
+}
+
+static int __vote_log_show(struct seq_file *s, void *unused)
+{
+	unsigned int c, idx;
+
+	seq_printf(s, "%-16s %-16s %8s %12s %12s %12s %12s\n",
+			"time (ns)", "governor", "sessions", "ab (kbps)",
+			"vote", "busy", "total");
+
+	mutex_lock(&vote_log.lock);
+	idx = (vote_log.head + VOTE_LOG_SIZE - vote_log.count) %
+		VOTE_LOG_SIZE;
+	for (c = 0; c < vote_log.count; ++c) {
+		struct vote_log_entry *e = &vote_log.entries[idx];
+
+		seq_printf(s, "%-16llu %-16s %8lu %12lu %12lu %12lu %12lu\n",
+				e->time_ns, e->governor, e->sessions,
+				e->ab_kbps, e->freq, e->busy_time,
+				e->total_time);
+		idx = (idx + 1) % VOTE_LOG_SIZE;
+	}
+	mutex_unlock(&vote_log.lock);
+
+	return 0;
+}
+
+static int __vote_log_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, __vote_log_show, inode->i_private);
+}
+
+static ssize_t __vote_log_write(struct file *file, const char __user *buf,
+		size_t count, loff_t *ppos)
+{
+	mutex_lock(&vote_log.lock);
+	vote_log.head = vote_log.count = 0;
+	mutex_unlock(&vote_log.lock);
+
+	return count;
+}
+
+static const struct file_operations vote_log_fops = {
+	.open = __vote_log_open,
+	.read = seq_read,
+	.write = __vote_log_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int __get_target_freq(struct devfreq *dev, unsigned long *freq,
 		u32 *flag)
 {
@@ -1069,6 +1166,7 @@ static int __get_target_freq(struct devfreq *dev, unsigned long *freq,
 
 	*freq = clamp(ab_kbps, dev->min_freq, dev->max_freq ?: UINT_MAX);
 exit:
+	__log_vote(gov, vidc_data->data_count, ab_kbps, *freq, &stats);
 	return 0;
 }
 
@@ -1123,6 +1221,11 @@ static int __init msm_vidc_bw_gov_init(void)
 {
 	int c = 0, rc = 0;
 
+	vote_log.dir = debugfs_create_dir("msm_vidc_dyn_gov", NULL);
+	if (!IS_ERR_OR_NULL(vote_log.dir))
+		debugfs_create_file("vote_log", S_IRUGO | S_IWUSR,
+				vote_log.dir, NULL, &vote_log_fops);
+
 	for (c = 0; c < ARRAY_SIZE(governors); ++c) {
 		dprintk(VIDC_DBG, "Adding governor %s\n",
 				governors[c].devfreq_gov.name);
@@ -1148,6 +1251,8 @@ static void __exit msm_vidc_bw_gov_exit(void)
 				governors[c].devfreq_gov.name);
 		devfreq_remove_governor(&governors[c].devfreq_gov);
 	}
+
+	debugfs_remove_recursive(vote_log.dir);
 }
 module_exit(msm_vidc_bw_gov_exit);
 MODULE_LICENSE("GPL v2");
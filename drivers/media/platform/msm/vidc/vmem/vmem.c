@@ -23,6 +23,7 @@
 #include <linux/of.h>
 #include <linux/platform_device.h>
 #include <linux/regulator/consumer.h>
+#include <linux/sched.h>
 #include <linux/slab.h>
 #include <linux/workqueue.h>
 #include "vmem.h"
@@ -118,6 +119,20 @@ struct vmem {
 	} bus;
 	atomic_t alloc_count;
 	struct dentry *debugfs_root;
+	/* Serialises allocations, protects owner */
+	struct mutex lock;
+	/* Held across owner.reclaim(), vmem_free() waits on it */
+	struct mutex reclaim_lock;
+	struct {
+		int prio;
+		size_t size;
+		pid_t pid;
+		char comm[TASK_COMM_LEN];
+		void (*reclaim)(void *priv);
+		void *priv;
+		bool reclaim_pending;
+		unsigned int reclaim_count;
+	} owner;
 };
 
 static struct vmem *vmem;
@@ -285,24 +300,40 @@ static void __disable_interrupts(struct vmem *v)
 }
 
 /**
- * vmem_allocate: - Allocates memory from VMEM.  Allocations have a few
+ * vmem_allocate_prio: - Allocates memory from VMEM.  Allocations have a few
  * restrictions: only allocations of the entire VMEM memory are allowed, and
  * , as a result, only single outstanding allocations are allowed.
  *
  * @size: amount of bytes to allocate
  * @addr: A pointer to phys_addr_t where the physical address of the memory
  * allocated is stored.
+ * @prio: Priority of the requesting session, higher values win.
+ * @reclaim: Optional callback asking the owner to give VMEM back.  It's
+ * called without the allocation lock held and shouldn't block; the owner
+ * is expected to vmem_free() at its next convenient point, e.g. at a
+ * session transition, but not from the callback itself.  vmem_free() waits
+ * for a callback in flight, so @priv may be released once it returns.
+ * Owners without a callback are never asked.
+ * @priv: Cookie passed to @reclaim.
+ *
+ * When VMEM is held by a lower priority owner that can be reclaimed, that
+ * owner is asked to give it back and -EBUSY is returned, so the caller can
+ * retry at its next session transition.
  *
  * Return: 0 in case of successful allocation (i.e. *addr != NULL). -ENOTSUPP,
  * if platform doesn't support VMEM. -EEXIST, if there are outstanding VMEM
- * allocations.  -ENOMEM, if platform can't support allocation of `size` bytes.
- * -EAGAIN, if `size` does not allocate the entire VMEM region.  -EIO in case of
- * internal errors.
+ * allocations.  -EBUSY, if the outstanding allocation is being reclaimed.
+ * -ENOMEM, if platform can't support allocation of `size` bytes.  -EAGAIN, if
+ * `size` does not allocate the entire VMEM region.  -EIO in case of internal
+ * errors.
  */
-int vmem_allocate(size_t size, phys_addr_t *addr)
+int vmem_allocate_prio(size_t size, phys_addr_t *addr, int prio,
+		void (*reclaim)(void *priv), void *priv)
 {
 	int rc = 0, c = 0;
 	resource_size_t max_size = 0;
+	void (*owner_reclaim)(void *priv) = NULL;
+	void *owner_priv = NULL;
 
 	if (!vmem) {
 		pr_err("No vmem, try rebooting your device\n");
@@ -317,24 +348,39 @@ int vmem_allocate(size_t size, phys_addr_t *addr)
 
 	max_size = resource_size(vmem->mem.resource);
 
+	mutex_lock(&vmem->lock);
 	if (atomic_read(&vmem->alloc_count)) {
-		pr_err("Only single allocations allowed for vmem\n");
-		rc = -EEXIST;
-		goto exit;
+		if (vmem->owner.reclaim && prio > vmem->owner.prio) {
+			if (!vmem->owner.reclaim_pending) {
+				vmem->owner.reclaim_pending = true;
+				vmem->owner.reclaim_count++;
+				owner_reclaim = vmem->owner.reclaim;
+				owner_priv = vmem->owner.priv;
+				pr_debug("Reclaiming from %s (%d), prio %d < %d\n",
+						vmem->owner.comm,
+						vmem->owner.pid,
+						vmem->owner.prio, prio);
+			}
+			rc = -EBUSY;
+		} else {
+			pr_err("Only single allocations allowed for vmem\n");
+			rc = -EEXIST;
+		}
+		goto unlock;
 	} else if (size > max_size) {
 		pr_err("Out of memory, have max %pa\n", &max_size);
 		rc = -ENOMEM;
-		goto exit;
+		goto unlock;
 	} else if (size != max_size) {
 		pr_err("Only support allocations of size %pa\n", &max_size);
 		rc = -EAGAIN;
-		goto exit;
+		goto unlock;
 	}
 
 	rc = __power_on(vmem);
 	if (rc) {
 		pr_err("Failed power on (%d)\n", rc);
-		goto exit;
+		goto unlock;
 	}
 
 	BUG_ON(vmem->num_banks != DIV_ROUND_UP(size, vmem->bank_size));
@@ -348,13 +394,38 @@ int vmem_allocate(size_t size, phys_addr_t *addr)
 	/* Enable interrupts to detect faults */
 	__enable_interrupts(vmem);
 
+	vmem->owner.prio = prio;
+	vmem->owner.size = size;
+	vmem->owner.pid = task_tgid_nr(current);
+	get_task_comm(vmem->owner.comm, current);
+	vmem->owner.reclaim = reclaim;
+	vmem->owner.priv = priv;
+	vmem->owner.reclaim_pending = false;
+
 	atomic_inc(&vmem->alloc_count);
 	*addr = (phys_addr_t)vmem->mem.resource->start;
-	return 0;
+unlock:
+	/* Taken before the unlock so that a vmem_free() can't slip between */
+	if (owner_reclaim)
+		mutex_lock(&vmem->reclaim_lock);
+	mutex_unlock(&vmem->lock);
+	if (owner_reclaim) {
+		owner_reclaim(owner_priv);
+		mutex_unlock(&vmem->reclaim_lock);
+	}
 exit:
 	return rc;
 }
 
+/**
+ * vmem_allocate: - Allocates memory from VMEM with the lowest priority and
+ * without a reclaim callback.  See vmem_allocate_prio().
+ */
+int vmem_allocate(size_t size, phys_addr_t *addr)
+{
+	return vmem_allocate_prio(size, addr, 0, NULL, NULL);
+}
+
 /**
  * vmem_free: - Frees the memory allocated via vmem_allocate.  Undefined
  * behaviour if to_free is a not a pointer returned via vmem_allocate
@@ -365,6 +436,7 @@ void vmem_free(phys_addr_t to_free)
 	if (!to_free || !vmem)
 		return;
 
+	mutex_lock(&vmem->lock);
 	BUG_ON(atomic_read(&vmem->alloc_count) == 0);
 
 	for (c = 0; c < vmem->num_banks; ++c) {
@@ -381,7 +453,40 @@ void vmem_free(phys_addr_t to_free)
 
 	__disable_interrupts(vmem);
 	__power_off(vmem);
+	vmem->owner.size = 0;
+	vmem->owner.reclaim = NULL;
+	vmem->owner.priv = NULL;
+	vmem->owner.reclaim_pending = false;
 	atomic_dec(&vmem->alloc_count);
+	mutex_unlock(&vmem->lock);
+
+	/* Wait for a reclaim callback still using the old owner's priv */
+	mutex_lock(&vmem->reclaim_lock);
+	mutex_unlock(&vmem->reclaim_lock);
+}
+
+/**
+ * vmem_occupancy_show: - Prints the current VMEM owner to debugfs.
+ */
+int vmem_occupancy_show(struct seq_file *s, void *unused)
+{
+	if (!vmem)
+		return -ENODEV;
+
+	mutex_lock(&vmem->lock);
+	if (atomic_read(&vmem->alloc_count))
+		seq_printf(s, "owner %s (%d) prio %d size %zu reclaim %s\n",
+				vmem->owner.comm, vmem->owner.pid,
+				vmem->owner.prio, vmem->owner.size,
+				!vmem->owner.reclaim ? "no" :
+				vmem->owner.reclaim_pending ? "pending" :
+				"yes");
+	else
+		seq_puts(s, "free\n");
+	seq_printf(s, "reclaims %u\n", vmem->owner.reclaim_count);
+	mutex_unlock(&vmem->lock);
+
+	return 0;
 }
 
 struct vmem_interrupt_cookie {
@@ -595,6 +700,8 @@ static int vmem_probe(struct platform_device *pdev)
 		pr_err("Failed allocate context memory in probe\n");
 		return -ENOMEM;
 	}
+	mutex_init(&v->lock);
+	mutex_init(&v->reclaim_lock);
 
 
 	rc = __init_resources(v, pdev);
@@ -17,6 +17,8 @@
 #ifdef CONFIG_MSM_VIDC_VMEM
 
 int vmem_allocate(size_t size, phys_addr_t *addr);
+int vmem_allocate_prio(size_t size, phys_addr_t *addr, int prio,
+		void (*reclaim)(void *priv), void *priv);
 void vmem_free(phys_addr_t to_free);
 
 #else
@@ -26,6 +28,12 @@ static inline int vmem_allocate(size_t size, phys_addr_t *addr)
 	return -ENODEV;
 }
 
+static inline int vmem_allocate_prio(size_t size, phys_addr_t *addr,
+		int prio, void (*reclaim)(void *priv), void *priv)
+{
+	return -ENODEV;
+}
+
 static inline void vmem_free(phys_addr_t to_free)
 {
 }
@@ -15,6 +15,7 @@
 #include <linux/fs.h>
 #include <linux/platform_device.h>
 #include "vmem.h"
+#include "vmem_debugfs.h"
 
 struct vmem_debugfs_cookie {
 	phys_addr_t addr;
@@ -51,6 +52,18 @@ static int __vmem_alloc_set(void *priv, u64 val)
 DEFINE_SIMPLE_ATTRIBUTE(fops_vmem_alloc, __vmem_alloc_get,
 		__vmem_alloc_set, "%llu");
 
+static int __vmem_occupancy_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, vmem_occupancy_show, inode->i_private);
+}
+
+static const struct file_operations fops_vmem_occupancy = {
+	.open = __vmem_occupancy_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 struct dentry *vmem_debugfs_init(struct platform_device *pdev)
 {
 	struct vmem_debugfs_cookie *alloc_cookie = NULL;
@@ -70,6 +83,8 @@ struct dentry *vmem_debugfs_init(struct platform_device *pdev)
 
 	debugfs_create_file("alloc", S_IRUSR | S_IWUSR, debugfs_root,
 			alloc_cookie, &fops_vmem_alloc);
+	debugfs_create_file("occupancy", S_IRUSR, debugfs_root,
+			NULL, &fops_vmem_occupancy);
 
 exit:
 	return debugfs_root;
@@ -14,8 +14,10 @@
 #define __VMEM_DEBUGFS_H__
 
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 struct dentry *vmem_debugfs_init(struct platform_device *pdev);
 void vmem_debugfs_deinit(struct dentry *debugfs_root);
+int vmem_occupancy_show(struct seq_file *s, void *unused);
 
 #endif /* __VMEM_DEBUGFS_H__ */
@@ -27,6 +27,7 @@
 #include <linux/msm_audio_ion.h>
 #include <linux/compat.h>
 #include <linux/mutex.h>
+#include <linux/math64.h>
 #include "audio_utils_aio.h"
 #ifdef CONFIG_USE_DEV_CTRL_VOLUME
 #include <linux/qdsp6v2/audio_dev_ctl.h>
@@ -270,6 +271,164 @@ static int audio_aio_outport_flush(struct q6audio_aio *audio)
 	return rc;
 }
 
+static bool audio_aio_ring_drained(struct q6audio_aio *audio)
+{
+	unsigned long flags;
+	bool drained;
+
+	spin_lock_irqsave(&audio->dsp_lock, flags);
+	drained = audio->ring.hw == audio->ring.appl;
+	spin_unlock_irqrestore(&audio->dsp_lock, flags);
+	return drained;
+}
+
+/*
+ * Hand committed ring data to the DSP, called with dsp_lock held. Only
+ * whole periods (or the tail up to the ring end) are sent while other
+ * writes are outstanding, so the DSP sees few, large buffers; a short
+ * remainder goes out once the DSP would otherwise run dry.
+ */
+static void audio_aio_ring_submit(struct q6audio_aio *audio)
+{
+	struct audio_aio_ring *ring = &audio->ring;
+	struct audio_aio_write_param param;
+	uint32_t off, len;
+	int rc;
+
+	while (ring->count < AUDIO_AIO_RING_MAX_PERIODS &&
+		ring->appl > ring->queued) {
+		div_u64_rem(ring->queued, ring->size, &off);
+		len = min_t(uint64_t, ring->appl - ring->queued,
+				ring->period);
+		if (len < ring->period && len < ring->size - off &&
+			ring->count)
+			break;
+		len = min(len, ring->size - off);
+
+		memset(&param, 0, sizeof(param));
+		param.paddr = ring->paddr + off;
+		param.len = len;
+		/* No meta with the ring, so no valid time stamp */
+		param.flags = 0xFF00;
+		param.uid = audio->ac->session;
+		rc = q6asm_async_write(audio->ac, &param);
+		if (rc < 0) {
+			pr_err("%s[%pK]:ring write failed rc=%d\n",
+				__func__, audio, rc);
+			break;
+		}
+		ring->len[(ring->head + ring->count) %
+			AUDIO_AIO_RING_MAX_PERIODS] = len;
+		ring->count++;
+		ring->queued += len;
+	}
+}
+
+static void audio_aio_ring_write_ack(struct q6audio_aio *audio)
+{
+	struct audio_aio_ring *ring = &audio->ring;
+	union msm_audio_event_payload event_payload;
+	unsigned long flags;
+	bool notify = false;
+	bool drained;
+
+	spin_lock_irqsave(&audio->dsp_lock, flags);
+	if (!ring->count) {
+		pr_warning("%s: ignore unexpected event from dsp\n", __func__);
+		spin_unlock_irqrestore(&audio->dsp_lock, flags);
+		return;
+	}
+	ring->hw += ring->len[ring->head];
+	ring->head = (ring->head + 1) % AUDIO_AIO_RING_MAX_PERIODS;
+	ring->count--;
+	audio_aio_ring_submit(audio);
+	if (ring->hw - ring->notified >= ring->threshold) {
+		ring->notified = ring->hw;
+		memset(&event_payload, 0, sizeof(event_payload));
+		event_payload.reserved = ring->size -
+					(uint32_t)(ring->appl - ring->hw);
+		notify = true;
+	}
+	drained = ring->hw == ring->appl;
+	spin_unlock_irqrestore(&audio->dsp_lock, flags);
+
+	if (notify)
+		audio_aio_post_event(audio, AUDIO_EVENT_RING_AVAIL,
+					event_payload);
+	if (drained && (audio->drv_status & ADRV_STATUS_FSYNC))
+		wake_up(&audio->write_wait);
+}
+
+static int audio_aio_ring_set(struct q6audio_aio *audio,
+				struct msm_audio_shared_ring *cfg)
+{
+	struct audio_aio_ring *ring = &audio->ring;
+	struct audio_aio_ion_region *region = NULL;
+	void *vaddr = (void *)(uintptr_t)cfg->vaddr;
+	unsigned long flags;
+	int rc;
+
+	if (cfg->size && (!cfg->period || cfg->period > cfg->size ||
+		(cfg->period & 0x1) || cfg->threshold > cfg->size)) {
+		pr_err("%s[%pK]:invalid ring size %u period %u threshold %u\n",
+			__func__, audio, cfg->size, cfg->period,
+			cfg->threshold);
+		return -EINVAL;
+	}
+	if (audio->feedback == NON_TUNNEL_MODE)
+		return -EPERM;
+	if (cfg->size) {
+		rc = audio_aio_ion_lookup_vaddr(audio, vaddr, cfg->size,
+						&region);
+		if (rc || (region->paddr + (vaddr - region->vaddr)) & 0x1) {
+			pr_err("%s[%pK]:ring %pK, %u not in an ion region\n",
+				__func__, audio, vaddr, cfg->size);
+			return -EINVAL;
+		}
+	}
+
+	spin_lock_irqsave(&audio->dsp_lock, flags);
+	if (ring->queued != ring->hw || !list_empty(&audio->out_queue)) {
+		spin_unlock_irqrestore(&audio->dsp_lock, flags);
+		return -EBUSY;
+	}
+	if (ring->region)
+		ring->region->ref_cnt--;
+	memset(ring, 0, sizeof(*ring));
+	if (region) {
+		region->ref_cnt++;
+		ring->region = region;
+		ring->paddr = region->paddr + (vaddr - region->vaddr);
+		ring->size = cfg->size;
+		ring->period = cfg->period;
+		ring->threshold = cfg->threshold ? cfg->threshold :
+							cfg->period;
+	}
+	spin_unlock_irqrestore(&audio->dsp_lock, flags);
+	pr_debug("%s[%pK]:ring paddr %pK size %u period %u\n", __func__,
+		audio, &ring->paddr, ring->size, ring->period);
+	return 0;
+}
+
+static int audio_aio_ring_commit(struct q6audio_aio *audio, uint32_t bytes)
+{
+	struct audio_aio_ring *ring = &audio->ring;
+	unsigned long flags;
+	int rc = 0;
+
+	spin_lock_irqsave(&audio->dsp_lock, flags);
+	if (!ring->size)
+		rc = -EINVAL;
+	else if (ring->appl - ring->hw + bytes > ring->size)
+		rc = -ENOSPC;
+	else {
+		ring->appl += bytes;
+		audio_aio_ring_submit(audio);
+	}
+	spin_unlock_irqrestore(&audio->dsp_lock, flags);
+	return rc;
+}
+
 /* Write buffer to DSP / Handle Ack from DSP */
 void audio_aio_async_write_ack(struct q6audio_aio *audio, uint32_t token,
 				uint32_t *payload)
@@ -282,6 +441,11 @@ void audio_aio_async_write_ack(struct q6audio_aio *audio, uint32_t token,
 	if (audio->wflush)
 		return;
 
+	if (audio->ring.size) {
+		audio_aio_ring_write_ack(audio);
+		return;
+	}
+
 	spin_lock_irqsave(&audio->dsp_lock, flags);
 	if (list_empty(&audio->out_queue)) {
 		pr_warning("%s: ingore unexpected event from dsp\n", __func__);
@@ -332,6 +496,13 @@ void audio_aio_async_out_flush(struct q6audio_aio *audio)
 		memset(&audio->eos_write_payload , 0,
 			sizeof(union msm_audio_event_payload));
 	}
+	/* The DSP dropped whatever it held, restart the ring empty */
+	audio->ring.appl = 0;
+	audio->ring.queued = 0;
+	audio->ring.hw = 0;
+	audio->ring.notified = 0;
+	audio->ring.head = 0;
+	audio->ring.count = 0;
 	spin_unlock_irqrestore(&audio->dsp_lock, flags);
 	list_for_each_safe(ptr, next, &audio->out_queue) {
 		buf_node = list_entry(ptr, struct audio_aio_buffer_node, list);
@@ -652,7 +823,8 @@ int audio_aio_fsync(struct file *file, loff_t start, loff_t end, int datasync)
 
 	pr_debug("%s[%pK]Wait for write done from DSP\n", __func__, audio);
 	rc = wait_event_interruptible(audio->write_wait,
-					(list_empty(&audio->out_queue)) ||
+					(list_empty(&audio->out_queue) &&
+					audio_aio_ring_drained(audio)) ||
 					audio->wflush || audio->stopped);
 
 	if (audio->stopped || audio->wflush) {
@@ -919,6 +1091,10 @@ static long audio_aio_process_event_req_compat(struct q6audio_aio *audio,
 		usr_evt_32.event_payload.error_info.err_type =
 			usr_evt.event_payload.error_info.err_type;
 		break;
+	case AUDIO_EVENT_RING_AVAIL:
+		usr_evt_32.event_payload.reserved =
+			usr_evt.event_payload.reserved;
+		break;
 	default:
 		pr_debug("%s: unknown audio event type = %d rc = %ld",
 			 __func__, usr_evt_32.event_type, rc);
@@ -1167,6 +1343,11 @@ static int audio_aio_buf_add_shared(struct q6audio_aio *audio, u32 dir,
 	pr_debug("%s[%pK]:node %pK dir %x buf_addr %pK buf_len %d data_len %d\n",
 		 __func__, audio, buf_node, dir, buf_node->buf.buf_addr,
 		buf_node->buf.buf_len, buf_node->buf.data_len);
+	if (dir && audio->ring.size) {
+		/* Playback goes through the shared ring */
+		kfree(buf_node);
+		return -EBUSY;
+	}
 	buf_node->paddr = audio_aio_ion_fixup(audio, buf_node->buf.buf_addr,
 						buf_node->buf.buf_len, 1,
 						&buf_node->kvaddr);
@@ -1561,6 +1742,56 @@ static long audio_aio_shared_ioctl(struct file *file, unsigned int cmd,
 		mutex_unlock(&audio->lock);
 		break;
 	}
+	case AUDIO_SET_SHARED_RING: {
+		struct msm_audio_shared_ring cfg;
+
+		if (copy_from_user(&cfg, (void *)arg, sizeof(cfg))) {
+			pr_err("%s: copy_from_user for AUDIO_SET_SHARED_RING failed\n",
+				__func__);
+			rc = -EFAULT;
+			break;
+		}
+		mutex_lock(&audio->lock);
+		mutex_lock(&audio->write_lock);
+		rc = audio_aio_ring_set(audio, &cfg);
+		mutex_unlock(&audio->write_lock);
+		mutex_unlock(&audio->lock);
+		break;
+	}
+	case AUDIO_SHARED_RING_COMMIT: {
+		uint32_t bytes;
+
+		if (get_user(bytes, (uint32_t __user *)arg)) {
+			rc = -EFAULT;
+			break;
+		}
+		mutex_lock(&audio->write_lock);
+		if (audio->drv_status & ADRV_STATUS_FSYNC)
+			rc = -EBUSY;
+		else if (!audio->enabled)
+			rc = -EPERM;
+		else
+			rc = audio_aio_ring_commit(audio, bytes);
+		mutex_unlock(&audio->write_lock);
+		break;
+	}
+	case AUDIO_GET_SHARED_RING_POS: {
+		struct msm_audio_shared_ring_pos pos;
+		unsigned long flags;
+
+		memset(&pos, 0, sizeof(pos));
+		spin_lock_irqsave(&audio->dsp_lock, flags);
+		pos.appl_bytes = audio->ring.appl;
+		pos.hw_bytes = audio->ring.hw;
+		pos.size = audio->ring.size;
+		spin_unlock_irqrestore(&audio->dsp_lock, flags);
+		if (copy_to_user((void *)arg, &pos, sizeof(pos))) {
+			pr_err("%s: copy_to_user for AUDIO_GET_SHARED_RING_POS failed\n",
+				__func__);
+			rc = -EFAULT;
+		}
+		break;
+	}
 	default:
 		pr_err("%s: Unknown ioctl cmd = %d", __func__, cmd);
 		rc =  -EINVAL;
@@ -1585,6 +1816,9 @@ static long audio_aio_ioctl(struct file *file, unsigned int cmd,
 	case AUDIO_GET_SESSION_ID:
 	case AUDIO_PM_AWAKE:
 	case AUDIO_PM_RELAX:
+	case AUDIO_SET_SHARED_RING:
+	case AUDIO_SHARED_RING_COMMIT:
+	case AUDIO_GET_SHARED_RING_POS:
 		rc = audio_aio_shared_ioctl(file, cmd, arg);
 		break;
 	case AUDIO_GET_STATS: {
@@ -1883,6 +2117,9 @@ static long audio_aio_compat_ioctl(struct file *file, unsigned int cmd,
 	case AUDIO_GET_SESSION_ID:
 	case AUDIO_PM_AWAKE:
 	case AUDIO_PM_RELAX:
+	case AUDIO_SET_SHARED_RING:
+	case AUDIO_SHARED_RING_COMMIT:
+	case AUDIO_GET_SHARED_RING_POS:
 		rc = audio_aio_shared_ioctl(file, cmd, arg);
 		break;
 	case AUDIO_GET_STATS_32: {
@@ -145,6 +145,25 @@ struct audio_aio_buffer_node {
 	union meta_data meta_info;
 };
 
+/* Writes the driver keeps outstanding on the DSP in shared ring mode */
+#define AUDIO_AIO_RING_MAX_PERIODS	8
+
+/* Shared ring playback state, protected by dsp_lock */
+struct audio_aio_ring {
+	struct audio_aio_ion_region *region;
+	phys_addr_t paddr;
+	uint32_t size;
+	uint32_t period;
+	uint32_t threshold;
+	uint64_t appl;          /* bytes committed by the client */
+	uint64_t queued;        /* bytes handed to the DSP */
+	uint64_t hw;            /* bytes acked by the DSP */
+	uint64_t notified;      /* hw position of the last RING_AVAIL */
+	uint32_t len[AUDIO_AIO_RING_MAX_PERIODS];
+	uint32_t head;
+	uint32_t count;
+};
+
 struct q6audio_aio;
 struct audio_aio_drv_operations {
 	void (*out_flush) (struct q6audio_aio *);
@@ -186,6 +205,7 @@ struct q6audio_aio {
 	struct list_head ion_region_queue;     /* protected by lock */
 	struct ion_client *client;
 	struct audio_aio_drv_operations drv_ops;
+	struct audio_aio_ring ring;
 	union msm_audio_event_payload eos_write_payload;
 	uint32_t device_events;
 	uint16_t volume;
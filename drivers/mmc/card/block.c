@@ -99,6 +99,13 @@ MODULE_ALIAS("mmc:block");
 #define PCKD_TRGR_LOWER_BOUND		5
 #define PCKD_TRGR_PRECISION_MULTIPLIER	100
 
+/* adaptive packing controller, see mmc_blk_pack_ctrl_update() */
+#define PACK_CTRL_WINDOW		64
+#define PACK_CTRL_READ_PCT_MAX		60
+#define PACK_CTRL_QD_MIN		2
+#define PACK_CTRL_LARGE_WR_SECTORS	256
+#define PACK_CTRL_MIN_PACKED		2
+
 static struct mmc_cmdq_req *mmc_cmdq_prep_dcmd(
 		struct mmc_queue_req *mqrq, struct mmc_queue *mq);
 static DEFINE_MUTEX(block_mutex);
@@ -156,6 +163,9 @@ struct mmc_blk_data {
 	struct device_attribute power_ro_lock;
 	struct device_attribute num_wr_reqs_to_start_packing;
 	struct device_attribute no_pack_for_random;
+	struct device_attribute max_segs;
+	struct device_attribute max_seg_size;
+	struct device_attribute sg_stats;
 	int	area_type;
 };
 
@@ -451,6 +461,159 @@ exit:
 	return ret;
 }
 
+static ssize_t
+max_segs_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+	int ret;
+
+	if (!md)
+		return -EINVAL;
+	ret = snprintf(buf, PAGE_SIZE, "%u\n",
+		       queue_max_segments(md->queue.queue));
+
+	mmc_blk_put(md);
+	return ret;
+}
+
+/*
+ * The sg tables were sized for host->max_segs when the queue was set up,
+ * so the limit can only be lowered below that. Queues that bounce map all
+ * segments into a single host segment and are left alone.
+ */
+static ssize_t
+max_segs_store(struct device *dev, struct device_attribute *attr,
+	       const char *buf, size_t count)
+{
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+	struct request_queue *q;
+	struct mmc_card *card;
+	unsigned int value = 0;
+	int ret = count;
+
+	if (!md)
+		return -EINVAL;
+
+	card = md->queue.card;
+	if (!card || md->queue.mqrq_cur->bounce_buf) {
+		ret = -EINVAL;
+		goto exit;
+	}
+
+	if (kstrtouint(buf, 0, &value) || !value ||
+	    value > card->host->max_segs) {
+		pr_err("%s: max_segs %u is not valid (1..%u)\n",
+			mmc_hostname(card->host), value,
+			card->host->max_segs);
+		ret = -EINVAL;
+		goto exit;
+	}
+
+	q = md->queue.queue;
+	spin_lock_irq(q->queue_lock);
+	blk_queue_max_segments(q, value);
+	spin_unlock_irq(q->queue_lock);
+
+exit:
+	mmc_blk_put(md);
+	return ret;
+}
+
+static ssize_t
+max_seg_size_show(struct device *dev, struct device_attribute *attr,
+		  char *buf)
+{
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+	int ret;
+
+	if (!md)
+		return -EINVAL;
+	ret = snprintf(buf, PAGE_SIZE, "%u\n",
+		       queue_max_segment_size(md->queue.queue));
+
+	mmc_blk_put(md);
+	return ret;
+}
+
+static ssize_t
+max_seg_size_store(struct device *dev, struct device_attribute *attr,
+		   const char *buf, size_t count)
+{
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+	struct request_queue *q;
+	struct mmc_card *card;
+	unsigned int value = 0;
+	int ret = count;
+
+	if (!md)
+		return -EINVAL;
+
+	card = md->queue.card;
+	if (!card || md->queue.mqrq_cur->bounce_buf) {
+		ret = -EINVAL;
+		goto exit;
+	}
+
+	if (kstrtouint(buf, 0, &value) || value < PAGE_SIZE ||
+	    value > card->host->max_seg_size) {
+		pr_err("%s: max_seg_size %u is not valid (%lu..%u)\n",
+			mmc_hostname(card->host), value, PAGE_SIZE,
+			card->host->max_seg_size);
+		ret = -EINVAL;
+		goto exit;
+	}
+
+	q = md->queue.queue;
+	spin_lock_irq(q->queue_lock);
+	blk_queue_max_segment_size(q, value);
+	spin_unlock_irq(q->queue_lock);
+
+exit:
+	mmc_blk_put(md);
+	return ret;
+}
+
+static ssize_t
+sg_stats_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+	struct mmc_sg_stats *st;
+	u64 avg = 0;
+	int ret;
+
+	if (!md)
+		return -EINVAL;
+
+	st = &md->queue.sg_stats;
+	if (st->nr_reqs)
+		avg = div64_u64(st->nr_segs, st->nr_reqs);
+
+	ret = snprintf(buf, PAGE_SIZE,
+		       "reqs:\t\t%llu\nsegs:\t\t%llu\navg_segs:\t%llu\n"
+		       "max_segs_seen:\t%u\nbounced_reqs:\t%llu\n"
+		       "bounced_bytes:\t%llu\n",
+		       st->nr_reqs, st->nr_segs, avg, st->max_segs_seen,
+		       st->nr_bounced, st->bounced_bytes);
+
+	mmc_blk_put(md);
+	return ret;
+}
+
+static ssize_t
+sg_stats_store(struct device *dev, struct device_attribute *attr,
+	       const char *buf, size_t count)
+{
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+
+	if (!md)
+		return -EINVAL;
+
+	memset(&md->queue.sg_stats, 0, sizeof(md->queue.sg_stats));
+
+	mmc_blk_put(md);
+	return count;
+}
+
 static int mmc_blk_open(struct block_device *bdev, fmode_t mode)
 {
 	struct mmc_blk_data *md = mmc_blk_get(bdev->bd_disk);
@@ -2612,6 +2775,7 @@ static int mmc_blk_err_check(struct mmc_card *card,
 			return MMC_BLK_ABORT;
 		else if (err)
 			return MMC_BLK_CMD_ERR;
+		mmc_lat_mark(card->host, &brq->mrq, MMC_LAT_BUSY_DONE);
 	}
 
 	/* if general error occurs, retry the write operation. */
@@ -2739,6 +2903,7 @@ static void mmc_blk_rw_rq_prep(struct mmc_queue_req *mqrq,
 	memset(brq, 0, sizeof(struct mmc_blk_request));
 	brq->mrq.cmd = &brq->cmd;
 	brq->mrq.data = &brq->data;
+	mmc_lat_mark(card->host, &brq->mrq, MMC_LAT_QUEUED);
 
 	brq->cmd.arg = blk_rq_pos(req);
 	if (!mmc_card_blockaddr(card))
@@ -2983,6 +3148,61 @@ static int get_packed_trigger(int potential, struct mmc_card *card,
 	return trigger;
 }
 
+/*
+ * Account @req in the current window and, once PACK_CTRL_WINDOW requests
+ * have been seen, decide how packing should behave for the next window.
+ * Packing is only worth it when there is a backlog of small writes: it is
+ * suppressed when reads dominate, when the queue is too shallow to form a
+ * pack, or when writes are already large. When it is allowed, the packed
+ * command size shrinks with the read share so that reads don't queue
+ * behind a full-size packed write.
+ */
+static void mmc_blk_pack_ctrl_update(struct mmc_queue *mq,
+				     struct request *req)
+{
+	struct mmc_pack_ctrl *ctrl = &mq->pack_ctrl;
+	struct request_queue *q = mq->queue;
+	unsigned int max_packed = mq->card->ext_csd.max_packed_writes;
+	unsigned int total;
+
+	if (req && !(req->cmd_flags & MMC_REQ_SPECIAL_MASK)) {
+		if (rq_data_dir(req) == READ) {
+			ctrl->nr_reads++;
+		} else {
+			ctrl->nr_writes++;
+			ctrl->wr_sectors += blk_rq_sectors(req);
+		}
+		ctrl->qd_sum += q->nr_rqs[BLK_RW_SYNC] +
+				q->nr_rqs[BLK_RW_ASYNC];
+	}
+
+	total = ctrl->nr_reads + ctrl->nr_writes;
+	if (total < PACK_CTRL_WINDOW)
+		return;
+
+	ctrl->read_pct = ctrl->nr_reads * 100 / total;
+	ctrl->avg_qd = ctrl->qd_sum / total;
+	ctrl->avg_wr_sectors = ctrl->nr_writes ?
+			       ctrl->wr_sectors / ctrl->nr_writes : 0;
+
+	ctrl->allow_packing = ctrl->read_pct <= PACK_CTRL_READ_PCT_MAX &&
+			      ctrl->avg_qd >= PACK_CTRL_QD_MIN &&
+			      ctrl->avg_wr_sectors < PACK_CTRL_LARGE_WR_SECTORS;
+	if (ctrl->allow_packing) {
+		max_packed = max_packed * (100 - ctrl->read_pct) / 100;
+		ctrl->max_packed = max_t(unsigned int, max_packed,
+					 PACK_CTRL_MIN_PACKED);
+		ctrl->nr_on++;
+	} else {
+		ctrl->nr_off++;
+	}
+
+	ctrl->nr_reads = 0;
+	ctrl->nr_writes = 0;
+	ctrl->wr_sectors = 0;
+	ctrl->qd_sum = 0;
+}
+
 static void mmc_blk_write_packing_control(struct mmc_queue *mq,
 					  struct request *req)
 {
@@ -3001,6 +3221,12 @@ static void mmc_blk_write_packing_control(struct mmc_queue *mq,
 	 * not have an effect on the write packing. Therefore we have to enable
 	 * the write packing
 	 */
+	if (mq->pack_ctrl.is_adaptive) {
+		mmc_blk_pack_ctrl_update(mq, req);
+		mq->wr_packing_enabled = mq->pack_ctrl.allow_packing;
+		return;
+	}
+
 	if (!(host->caps2 & MMC_CAP2_PACKED_WR_CONTROL)) {
 		mq->wr_packing_enabled = true;
 		return;
@@ -3092,6 +3318,9 @@ static u8 mmc_blk_prep_packed_list(struct mmc_queue *mq, struct request *req)
 	    mmc_host_packed_wr(card->host))
 		max_packed_rw = card->ext_csd.max_packed_writes;
 
+	if (mq->pack_ctrl.is_adaptive)
+		max_packed_rw = min(max_packed_rw, mq->pack_ctrl.max_packed);
+
 	if (max_packed_rw == 0)
 		goto no_packed;
 
@@ -3276,6 +3505,7 @@ static void mmc_blk_packed_hdr_wrq_prep(struct mmc_queue_req *mqrq,
 	brq->mrq.data = &brq->data;
 	brq->mrq.sbc = &brq->sbc;
 	brq->mrq.stop = &brq->stop;
+	mmc_lat_mark(card->host, &brq->mrq, MMC_LAT_QUEUED);
 
 	brq->sbc.opcode = MMC_SET_BLOCK_COUNT;
 	brq->sbc.arg = MMC_CMD23_ARG_PACKED | (packed->blocks + hdr_blocks);
@@ -3463,6 +3693,7 @@ static struct mmc_cmdq_req *mmc_blk_cmdq_rw_prep(
 	struct mmc_cmdq_req *cmdq_rq = &mqrq->cmdq_req;
 
 	memset(&mqrq->cmdq_req, 0, sizeof(struct mmc_cmdq_req));
+	mmc_lat_mark(card->host, &cmdq_rq->mrq, MMC_LAT_QUEUED);
 
 	cmdq_rq->tag = req->tag;
 	if (read_dir) {
@@ -4170,6 +4401,7 @@ void mmc_blk_cmdq_complete_rq(struct request *rq)
 		goto out;
 	}
 
+	mmc_lat_record(host, mrq, err);
 	blk_end_request(rq, err, cmdq_req->data.bytes_xfered);
 
 out:
@@ -4198,6 +4430,7 @@ void mmc_blk_cmdq_req_done(struct mmc_request *mrq)
 {
 	struct request *req = mrq->req;
 
+	mmc_lat_mark(mrq->host, mrq, MMC_LAT_XFER_DONE);
 	blk_complete_request(req);
 }
 EXPORT_SYMBOL(mmc_blk_cmdq_req_done);
@@ -4264,6 +4497,7 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 			 */
 			mmc_blk_reset_success(md, type);
 
+			mmc_lat_record(card->host, &brq->mrq, 0);
 			if (mmc_packed_cmd(mq_rq->cmd_type)) {
 				ret = mmc_blk_end_packed_req(mq_rq);
 				break;
@@ -4880,6 +5114,9 @@ static void mmc_blk_remove_req(struct mmc_blk_data *md)
 			mmc_cmdq_clean(&md->queue, card);
 		device_remove_file(disk_to_dev(md->disk),
 				   &md->num_wr_reqs_to_start_packing);
+		device_remove_file(disk_to_dev(md->disk), &md->max_segs);
+		device_remove_file(disk_to_dev(md->disk), &md->max_seg_size);
+		device_remove_file(disk_to_dev(md->disk), &md->sg_stats);
 		if (md->disk->flags & GENHD_FL_UP) {
 			device_remove_file(disk_to_dev(md->disk), &md->force_ro);
 			if ((md->area_type & MMC_BLK_DATA_AREA_BOOT) &&
@@ -4966,8 +5203,41 @@ static int mmc_add_disk(struct mmc_blk_data *md)
 	if (ret)
 		goto no_pack_for_random_fails;
 
+	md->max_segs.show = max_segs_show;
+	md->max_segs.store = max_segs_store;
+	sysfs_attr_init(&md->max_segs.attr);
+	md->max_segs.attr.name = "max_segs";
+	md->max_segs.attr.mode = S_IRUGO | S_IWUSR;
+	ret = device_create_file(disk_to_dev(md->disk), &md->max_segs);
+	if (ret)
+		goto max_segs_fail;
+
+	md->max_seg_size.show = max_seg_size_show;
+	md->max_seg_size.store = max_seg_size_store;
+	sysfs_attr_init(&md->max_seg_size.attr);
+	md->max_seg_size.attr.name = "max_seg_size";
+	md->max_seg_size.attr.mode = S_IRUGO | S_IWUSR;
+	ret = device_create_file(disk_to_dev(md->disk), &md->max_seg_size);
+	if (ret)
+		goto max_seg_size_fail;
+
+	md->sg_stats.show = sg_stats_show;
+	md->sg_stats.store = sg_stats_store;
+	sysfs_attr_init(&md->sg_stats.attr);
+	md->sg_stats.attr.name = "sg_stats";
+	md->sg_stats.attr.mode = S_IRUGO | S_IWUSR;
+	ret = device_create_file(disk_to_dev(md->disk), &md->sg_stats);
+	if (ret)
+		goto sg_stats_fail;
+
 	return ret;
 
+sg_stats_fail:
+	device_remove_file(disk_to_dev(md->disk), &md->max_seg_size);
+max_seg_size_fail:
+	device_remove_file(disk_to_dev(md->disk), &md->max_segs);
+max_segs_fail:
+	device_remove_file(disk_to_dev(md->disk), &md->no_pack_for_random);
 no_pack_for_random_fails:
 	device_remove_file(disk_to_dev(md->disk),
 			   &md->num_wr_reqs_to_start_packing);
@@ -20,6 +20,8 @@
 #include <linux/mmc/card.h>
 #include <linux/mmc/host.h>
 #include <linux/delay.h>
+#include <linux/sort.h>
+#include <linux/math64.h>
 #include <linux/test-iosched.h>
 #include "queue.h"
 
@@ -64,6 +66,18 @@
 
 #define NEW_REQ_TEST_SLEEP_TIME 1
 #define NEW_REQ_TEST_NUM_BIOS 64
+
+/* latency benchmark: requests per mix, issued BENCH_QUEUE_DEPTH at a time */
+#define BENCH_NUM_REQS		256
+#define BENCH_QUEUE_DEPTH	4
+#define BENCH_ISSUE_SLOTS	16
+#define BENCH_SEQ_BIOS		TEST_MAX_BIOS_PER_REQ
+#define BENCH_RAND_BIOS		1
+#define BENCH_BIO_SECTORS	((BIO_U32_SIZE * sizeof(int)) >> 9)
+#define BENCH_RAND_SLOTS	(TEST_MAX_SECTOR_RANGE / \
+				 (BIO_U32_SIZE * sizeof(int)))
+#define BENCH_MIXED_READ_PCT	70
+#define BENCH_WAIT_MS		10000
 enum is_random {
 	NON_RANDOM_TEST,
 	RANDOM_TEST,
@@ -130,10 +144,28 @@ enum mmc_block_test_testcases {
 	PACKING_CONTROL_MAX_TESTCASE = TEST_PACK_MIX_NO_PACKED_PACKED_NO_PACKED,
 	TEST_LONG_SEQUENTIAL_READ,
 	TEST_LONG_SEQUENTIAL_WRITE,
+	TEST_LATENCY_BENCHMARK,
 
 	TEST_NEW_REQ_NOTIFICATION,
 };
 
+enum mmc_block_bench_mix {
+	BENCH_SEQ_READ,
+	BENCH_SEQ_WRITE,
+	BENCH_RAND_READ,
+	BENCH_RAND_WRITE,
+	BENCH_RAND_MIXED,
+	BENCH_NR_MIXES,
+};
+
+static const char * const bench_mix_str[BENCH_NR_MIXES] = {
+	[BENCH_SEQ_READ]	= "seq read 512K",
+	[BENCH_SEQ_WRITE]	= "seq write 512K",
+	[BENCH_RAND_READ]	= "rand read 4K",
+	[BENCH_RAND_WRITE]	= "rand write 4K",
+	[BENCH_RAND_MIXED]	= "rand 70/30 r/w 4K",
+};
+
 enum mmc_block_test_group {
 	TEST_NO_GROUP,
 	TEST_GENERAL_GROUP,
@@ -153,6 +185,17 @@ struct mmc_block_test_debug {
 	struct dentry *long_sequential_read_test;
 	struct dentry *long_sequential_write_test;
 	struct dentry *new_req_notification_test;
+	struct dentry *latency_benchmark_test;
+};
+
+struct mmc_block_bench {
+	enum mmc_block_bench_mix mix;
+	/* issue time of the outstanding requests, indexed by req_id */
+	ktime_t issue_t[BENCH_ISSUE_SLOTS];
+	u32 lat_us[BENCH_NUM_REQS];
+	unsigned int nr_lat;
+	unsigned long bytes;
+	wait_queue_head_t wait;
 };
 
 static struct blk_dev_test_type *mmc_bdt;
@@ -189,6 +232,9 @@ struct mmc_block_test_data {
 
 	unsigned int  completed_req_count;
 
+	/* latency benchmark state */
+	struct mmc_block_bench bench;
+
 	struct test_iosched *test_iosched;
 };
 
@@ -595,6 +641,8 @@ static char *get_test_case_str(int testcase)
 		return "\"long sequential read\"";
 	case TEST_LONG_SEQUENTIAL_WRITE:
 		return "\"long sequential write\"";
+	case TEST_LATENCY_BENCHMARK:
+		return "\"latency benchmark\"";
 	case TEST_NEW_REQ_NOTIFICATION:
 		return "\"new request notification test\"";
 	}
@@ -2488,6 +2536,234 @@ const struct file_operations long_sequential_write_test_ops = {
 	.read = long_sequential_write_test_read,
 };
 
+static void bench_end_io_fn(struct request *rq, int err)
+{
+	struct test_request *test_rq =
+		(struct test_request *)rq->elv.priv[0];
+	struct test_iosched *tios = rq->q->elevator->elevator_data;
+	struct mmc_block_test_data *mbtd = tios->blk_dev_test_data;
+	struct mmc_block_bench *bench = &mbtd->bench;
+	ktime_t issue_t;
+	unsigned long flags;
+
+	BUG_ON(!test_rq);
+
+	issue_t = bench->issue_t[test_rq->req_id & (BENCH_ISSUE_SLOTS - 1)];
+
+	spin_lock_irqsave(&tios->lock, flags);
+	list_del_init(&test_rq->queuelist);
+	tios->dispatched_count--;
+	__blk_put_request(tios->req_q, test_rq->rq);
+	if (bench->nr_lat < BENCH_NUM_REQS)
+		bench->lat_us[bench->nr_lat++] =
+			ktime_us_delta(ktime_get(), issue_t);
+	bench->bytes += test_rq->buf_size;
+	spin_unlock_irqrestore(&tios->lock, flags);
+
+	test_iosched_free_test_req_data_buffer(test_rq);
+	kfree(test_rq);
+	mbtd->completed_req_count++;
+	wake_up(&bench->wait);
+
+	check_test_completion(tios);
+}
+
+/* Pick direction, start sector and size of the next benchmark request */
+static void bench_next_req(struct test_iosched *tios, u32 *seq_sector,
+			   int *direction, u32 *sector, int *num_bios)
+{
+	struct mmc_block_test_data *mbtd = tios->blk_dev_test_data;
+	unsigned int *seed = &mbtd->random_test_seed;
+
+	switch (mbtd->bench.mix) {
+	case BENCH_SEQ_READ:
+	case BENCH_SEQ_WRITE:
+		*direction = mbtd->bench.mix == BENCH_SEQ_READ ? READ : WRITE;
+		*num_bios = BENCH_SEQ_BIOS;
+		*sector = *seq_sector;
+		*seq_sector += BENCH_SEQ_BIOS * BENCH_BIO_SECTORS;
+		return;
+	case BENCH_RAND_READ:
+		*direction = READ;
+		break;
+	case BENCH_RAND_WRITE:
+		*direction = WRITE;
+		break;
+	default:
+		*direction = pseudo_random_seed(seed, 0, 100) <
+			     BENCH_MIXED_READ_PCT ? READ : WRITE;
+		break;
+	}
+
+	*num_bios = BENCH_RAND_BIOS;
+	*sector = tios->start_sector + BENCH_BIO_SECTORS *
+		  pseudo_random_seed(seed, 0, BENCH_RAND_SLOTS);
+}
+
+/*
+ * Issue BENCH_NUM_REQS requests of the current mix, BENCH_QUEUE_DEPTH at a
+ * time, and wait for each batch to complete before issuing the next one so
+ * that the measured latency is not dominated by time spent in the queue.
+ */
+static int run_latency_bench(struct test_iosched *tios)
+{
+	struct mmc_block_test_data *mbtd = tios->blk_dev_test_data;
+	struct mmc_block_bench *bench = &mbtd->bench;
+	u32 seq_sector = tios->start_sector;
+	u32 sector;
+	int direction, num_bios;
+	int ret = 0;
+	int i, j;
+
+	tios->test_count = 0;
+	mbtd->completed_req_count = 0;
+	bench->nr_lat = 0;
+	bench->bytes = 0;
+
+	for (i = 0; i < BENCH_NUM_REQS; i += BENCH_QUEUE_DEPTH) {
+		for (j = 0; j < BENCH_QUEUE_DEPTH; j++) {
+			bench_next_req(tios, &seq_sector, &direction, &sector,
+				       &num_bios);
+			bench->issue_t[tios->wr_rd_next_req_id &
+				       (BENCH_ISSUE_SLOTS - 1)] = ktime_get();
+			ret = test_iosched_add_wr_rd_test_req(tios, 0,
+				direction, sector, num_bios,
+				direction == WRITE ? TEST_PATTERN_5A :
+						     TEST_NO_PATTERN,
+				bench_end_io_fn);
+			if (ret) {
+				pr_err("%s: failed to add a request, err = %d",
+					__func__, ret);
+				return ret;
+			}
+		}
+
+		blk_run_queue(tios->req_q);
+
+		if (!wait_event_timeout(bench->wait,
+				mbtd->completed_req_count >=
+					i + BENCH_QUEUE_DEPTH,
+				msecs_to_jiffies(BENCH_WAIT_MS))) {
+			pr_err("%s: timed out after %u completions",
+				__func__, mbtd->completed_req_count);
+			return -ETIMEDOUT;
+		}
+	}
+
+	return ret;
+}
+
+static int bench_cmp_u32(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void bench_report(struct mmc_block_test_data *mbtd)
+{
+	struct mmc_block_bench *bench = &mbtd->bench;
+	unsigned int n = bench->nr_lat;
+	u64 us = ktime_to_us(mbtd->test_info.test_duration);
+
+	if (!n || !us) {
+		pr_err("%s: %s: no samples", __func__,
+			bench_mix_str[bench->mix]);
+		return;
+	}
+
+	sort(bench->lat_us, n, sizeof(u32), bench_cmp_u32, NULL);
+
+	pr_info("%s: %-18s %u reqs %llu KiB/s %llu IOPS", __func__,
+		bench_mix_str[bench->mix], n,
+		div64_u64((u64)bench->bytes * USEC_PER_SEC, us * 1024),
+		div64_u64((u64)n * USEC_PER_SEC, us));
+	pr_info("%s: %-18s lat usec p50 %u p90 %u p99 %u max %u", __func__,
+		bench_mix_str[bench->mix], bench->lat_us[n * 50 / 100],
+		bench->lat_us[n * 90 / 100], bench->lat_us[n * 99 / 100],
+		bench->lat_us[n - 1]);
+}
+
+static ssize_t latency_benchmark_test_write(struct file *file,
+				const char __user *buf,
+				size_t count,
+				loff_t *ppos)
+{
+	struct mmc_block_test_data *mbtd = file->private_data;
+	struct test_iosched *tios = mbtd->test_iosched;
+	int ret = 0;
+	int i, mix;
+	int number = -1;
+
+	pr_info("%s: -- Latency Benchmark TEST --", __func__);
+
+	sscanf(buf, "%d", &number);
+
+	if (number <= 0)
+		number = 1;
+
+	memset(&mbtd->test_info, 0, sizeof(struct test_info));
+	mbtd->test_group = TEST_GENERAL_GROUP;
+
+	mbtd->test_info.data = mbtd;
+	mbtd->test_info.get_test_case_str_fn = get_test_case_str;
+	mbtd->test_info.run_test_fn = run_latency_bench;
+
+	for (i = 0 ; i < number ; ++i) {
+		pr_info("%s: Cycle # %d / %d", __func__, i+1, number);
+		pr_info("%s: ====================", __func__);
+
+		for (mix = 0; mix < BENCH_NR_MIXES; mix++) {
+			mbtd->bench.mix = mix;
+			mbtd->test_info.testcase = TEST_LATENCY_BENCHMARK;
+			mbtd->is_random = NON_RANDOM_TEST;
+			ret = test_iosched_start_test(tios, &mbtd->test_info);
+			if (ret)
+				return count;
+
+			bench_report(mbtd);
+		}
+
+		/* Allow FS requests to be dispatched */
+		msleep(1000);
+	}
+
+	return count;
+}
+
+static ssize_t latency_benchmark_test_read(struct file *file,
+			       char __user *buffer,
+			       size_t count,
+			       loff_t *offset)
+{
+	if (!access_ok(VERIFY_WRITE, buffer, count))
+		return -EFAULT;
+
+	memset((void *)buffer, 0, count);
+
+	snprintf(buffer, count,
+		 "\nlatency_benchmark_test\n"
+		 "=========\n"
+		 "Description:\n"
+		 "This test runs sequential 512K read and write, random 4K "
+		 "read and write and a random 70/30 read/write mix, each "
+		 "with a queue depth of 4, and reports throughput, IOPS and "
+		 "the p50/p90/p99/max request latency of every mix.\n"
+		 "WARNING: the write mixes overwrite the test area.\n");
+
+	if (message_repeat == 1) {
+		message_repeat = 0;
+		return strnlen(buffer, count);
+	} else
+		return 0;
+}
+
+const struct file_operations latency_benchmark_test_ops = {
+	.open = test_open,
+	.write = latency_benchmark_test_write,
+	.read = latency_benchmark_test_read,
+};
+
 static ssize_t new_req_notification_test_write(struct file *file,
 				const char __user *buf,
 				size_t count,
@@ -2571,6 +2847,7 @@ static void mmc_block_test_debugfs_cleanup(struct mmc_block_test_data *mbtd)
 	debugfs_remove(mbtd->debug.long_sequential_read_test);
 	debugfs_remove(mbtd->debug.long_sequential_write_test);
 	debugfs_remove(mbtd->debug.new_req_notification_test);
+	debugfs_remove(mbtd->debug.latency_benchmark_test);
 }
 
 static int mmc_block_test_debugfs_init(struct test_iosched *tios)
@@ -2667,6 +2944,16 @@ static int mmc_block_test_debugfs_init(struct test_iosched *tios)
 	if (!mbtd->debug.long_sequential_write_test)
 		goto err_nomem;
 
+	mbtd->debug.latency_benchmark_test = debugfs_create_file(
+					"latency_benchmark_test",
+					S_IRUGO | S_IWUGO,
+					tests_root,
+					mbtd,
+					&latency_benchmark_test_ops);
+
+	if (!mbtd->debug.latency_benchmark_test)
+		goto err_nomem;
+
 	return 0;
 
 err_nomem:
@@ -2706,6 +2993,7 @@ static int mmc_block_test_probe(struct test_iosched *tios)
 	}
 	tios->blk_dev_test_data = mbtd;
 	mbtd->test_iosched = tios;
+	init_waitqueue_head(&mbtd->bench.wait);
 
 	max_packed_reqs = mq->card->ext_csd.max_packed_writes;
 	mbtd->exp_packed_stats.packing_events =
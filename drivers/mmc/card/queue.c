@@ -10,6 +10,8 @@
  *
  */
 #include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
 #include <linux/module.h>
 #include <linux/blkdev.h>
 #include <linux/freezer.h>
@@ -19,6 +21,8 @@
 #include <linux/bitops.h>
 #include <linux/delay.h>
 #include <linux/backing-dev.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <linux/mmc/card.h>
 #include <linux/mmc/host.h>
@@ -56,57 +60,65 @@ static int mmc_prep_request(struct request_queue *q, struct request *req)
 	return BLKPREP_OK;
 }
 
-static struct request *mmc_peek_request(struct mmc_queue *mq)
+/*
+ * Peek the next request and, if it may be issued, start its tag, all under
+ * a single hold of the queue lock. Returns true when the request in
+ * mq->cmdq_req_peeked owns a CMDQ slot and can be handed to issue_fn.
+ */
+static bool mmc_cmdq_fetch_request(struct mmc_queue *mq,
+				   struct mmc_cmdq_context_info *ctx)
 {
 	struct request_queue *q = mq->queue;
-	mq->cmdq_req_peeked = NULL;
+	struct request *req = NULL;
+	bool ready = false;
 
 	spin_lock_irq(q->queue_lock);
 	if (!blk_queue_stopped(q))
-		mq->cmdq_req_peeked = blk_peek_request(q);
+		req = blk_peek_request(q);
+	mq->cmdq_req_peeked = req;
+
+	if (req &&
+	    !((req->cmd_flags & (REQ_FLUSH | REQ_DISCARD)) &&
+	      test_bit(CMDQ_STATE_DCMD_ACTIVE, &ctx->curr_state)))
+		ready = !blk_queue_start_tag(q, req);
 	spin_unlock_irq(q->queue_lock);
 
-	return mq->cmdq_req_peeked;
+	return ready;
 }
 
-static bool mmc_check_blk_queue_start_tag(struct request_queue *q,
-					  struct request *req)
+static inline bool mmc_cmdq_can_issue(struct mmc_host *host)
 {
-	int ret;
+	struct mmc_cmdq_context_info *ctx = &host->cmdq_ctx;
+	struct mmc_card *card = host->card;
 
-	spin_lock_irq(q->queue_lock);
-	ret = blk_queue_start_tag(q, req);
-	spin_unlock_irq(q->queue_lock);
+	if (!card->part_curr && !mmc_card_suspended(card) &&
+	    (mmc_host_halt(host) || mmc_host_cq_disable(host)))
+		return false;
 
-	return !!ret;
+	return !test_bit(CMDQ_STATE_ERR, &ctx->curr_state);
 }
 
 static inline void mmc_cmdq_ready_wait(struct mmc_host *host,
 					struct mmc_queue *mq)
 {
 	struct mmc_cmdq_context_info *ctx = &host->cmdq_ctx;
-	struct request_queue *q = mq->queue;
 
 	/*
 	 * Wait until all of the following conditions are true:
-	 * 1. There is a request pending in the block layer queue
+	 * 1. cmdq state should be unhalted.
+	 * 2. cmdq state shouldn't be in error state.
+	 * 3. There is a request pending in the block layer queue
 	 *    to be processed.
-	 * 2. If the peeked request is flush/discard then there shouldn't
+	 * 4. If the peeked request is flush/discard then there shouldn't
 	 *    be any other direct command active.
-	 * 3. cmdq state should be unhalted.
-	 * 4. cmdq state shouldn't be in error state.
 	 * 5. free tag available to process the new request.
+	 *
+	 * The host state is checked first as it needs no locking; the
+	 * remaining conditions are evaluated with one queue lock round trip.
 	 */
 	wait_event(ctx->wait, kthread_should_stop()
-		|| (mmc_peek_request(mq) &&
-		!((mq->cmdq_req_peeked->cmd_flags & (REQ_FLUSH | REQ_DISCARD))
-		  && test_bit(CMDQ_STATE_DCMD_ACTIVE, &ctx->curr_state))
-		&& !(!host->card->part_curr && !mmc_card_suspended(host->card)
-		     && mmc_host_halt(host))
-		&& !(!host->card->part_curr && mmc_host_cq_disable(host) &&
-			!mmc_card_suspended(host->card))
-		&& !test_bit(CMDQ_STATE_ERR, &ctx->curr_state)
-		&& !mmc_check_blk_queue_start_tag(q, mq->cmdq_req_peeked)));
+		|| (mmc_cmdq_can_issue(host)
+		    && mmc_cmdq_fetch_request(mq, ctx)));
 }
 
 static int mmc_cmdq_thread(void *d)
@@ -126,6 +138,8 @@ static int mmc_cmdq_thread(void *d)
 			break;
 
 		ret = mq->cmdq_issue_fn(mq, mq->cmdq_req_peeked);
+		/* the request now owns its slot, it is no longer peeked */
+		mq->cmdq_req_peeked = NULL;
 		/*
 		 * Don't requeue if issue_fn fails.
 		 * Recovery will be come by completion softirq
@@ -246,11 +260,20 @@ static void mmc_request_fn(struct request_queue *q)
 		wake_up_process(mq->thread);
 }
 
+/*
+ * Hosts with scatter-gather DMA can take hundreds of segments per request,
+ * so the table may not fit in a physically contiguous allocation once
+ * memory is fragmented. It is only ever walked by the CPU, so fall back
+ * to vmalloc rather than shrinking max_segs.
+ */
 static struct scatterlist *mmc_alloc_sg(int sg_len, int *err)
 {
 	struct scatterlist *sg;
+	size_t size = sizeof(struct scatterlist) * sg_len;
 
-	sg = kmalloc(sizeof(struct scatterlist)*sg_len, GFP_KERNEL);
+	sg = kmalloc(size, GFP_KERNEL | __GFP_NOWARN);
+	if (!sg && size > PAGE_SIZE)
+		sg = vmalloc(size);
 	if (!sg)
 		*err = -ENOMEM;
 	else {
@@ -261,6 +284,11 @@ static struct scatterlist *mmc_alloc_sg(int sg_len, int *err)
 	return sg;
 }
 
+static void mmc_free_sg(struct scatterlist *sg)
+{
+	kvfree(sg);
+}
+
 static void mmc_queue_setup_discard(struct request_queue *q,
 				    struct mmc_card *card)
 {
@@ -458,7 +486,7 @@ retry:
 		goto success;
 
 prev_sg_alloc_failed:
-		kfree(mqrq_cur->sg);
+		mmc_free_sg(mqrq_cur->sg);
 		mqrq_cur->sg = NULL;
 cur_sg_alloc_failed:
 		host->max_segs /= 2;
@@ -508,18 +536,18 @@ success:
 
 	return 0;
  free_bounce_sg:
-	kfree(mqrq_cur->bounce_sg);
+	mmc_free_sg(mqrq_cur->bounce_sg);
 	mqrq_cur->bounce_sg = NULL;
-	kfree(mqrq_prev->bounce_sg);
+	mmc_free_sg(mqrq_prev->bounce_sg);
 	mqrq_prev->bounce_sg = NULL;
 
  cleanup_queue:
-	kfree(mqrq_cur->sg);
+	mmc_free_sg(mqrq_cur->sg);
 	mqrq_cur->sg = NULL;
 	kfree(mqrq_cur->bounce_buf);
 	mqrq_cur->bounce_buf = NULL;
 
-	kfree(mqrq_prev->sg);
+	mmc_free_sg(mqrq_prev->sg);
 	mqrq_prev->sg = NULL;
 	kfree(mqrq_prev->bounce_buf);
 	mqrq_prev->bounce_buf = NULL;
@@ -547,19 +575,19 @@ void mmc_cleanup_queue(struct mmc_queue *mq)
 	blk_start_queue(q);
 	spin_unlock_irqrestore(q->queue_lock, flags);
 
-	kfree(mqrq_cur->bounce_sg);
+	mmc_free_sg(mqrq_cur->bounce_sg);
 	mqrq_cur->bounce_sg = NULL;
 
-	kfree(mqrq_cur->sg);
+	mmc_free_sg(mqrq_cur->sg);
 	mqrq_cur->sg = NULL;
 
 	kfree(mqrq_cur->bounce_buf);
 	mqrq_cur->bounce_buf = NULL;
 
-	kfree(mqrq_prev->bounce_sg);
+	mmc_free_sg(mqrq_prev->bounce_sg);
 	mqrq_prev->bounce_sg = NULL;
 
-	kfree(mqrq_prev->sg);
+	mmc_free_sg(mqrq_prev->sg);
 	mqrq_prev->sg = NULL;
 
 	kfree(mqrq_prev->bounce_buf);
@@ -569,6 +597,78 @@ void mmc_cleanup_queue(struct mmc_queue *mq)
 }
 EXPORT_SYMBOL(mmc_cleanup_queue);
 
+#ifdef CONFIG_DEBUG_FS
+static int mmc_pack_ctrl_show(struct seq_file *s, void *data)
+{
+	struct mmc_queue *mq = s->private;
+	struct mmc_pack_ctrl *ctrl = &mq->pack_ctrl;
+
+	seq_printf(s, "adaptive:\t\t%d\n", ctrl->is_adaptive);
+	seq_printf(s, "packing allowed:\t%d\n", ctrl->allow_packing);
+	seq_printf(s, "max packed:\t\t%u\n", ctrl->max_packed);
+	seq_printf(s, "read share (%%):\t\t%u\n", ctrl->read_pct);
+	seq_printf(s, "avg queue depth:\t%u\n", ctrl->avg_qd);
+	seq_printf(s, "avg write (sectors):\t%u\n", ctrl->avg_wr_sectors);
+	seq_printf(s, "windows packing on:\t%llu\n", ctrl->nr_on);
+	seq_printf(s, "windows packing off:\t%llu\n", ctrl->nr_off);
+
+	return 0;
+}
+
+static int mmc_pack_ctrl_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mmc_pack_ctrl_show, inode->i_private);
+}
+
+static ssize_t mmc_pack_ctrl_write(struct file *file,
+		const char __user *ubuf, size_t cnt, loff_t *ppos)
+{
+	struct mmc_queue *mq = ((struct seq_file *)file->private_data)->private;
+	struct mmc_pack_ctrl *ctrl = &mq->pack_ctrl;
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint_from_user(ubuf, cnt, 0, &val);
+	if (ret)
+		return ret;
+
+	/* start over from an empty window with packing allowed */
+	ctrl->nr_reads = 0;
+	ctrl->nr_writes = 0;
+	ctrl->wr_sectors = 0;
+	ctrl->qd_sum = 0;
+	ctrl->allow_packing = true;
+	ctrl->max_packed = mq->card->ext_csd.max_packed_writes;
+	ctrl->is_adaptive = !!val;
+
+	return cnt;
+}
+
+static const struct file_operations mmc_pack_ctrl_fops = {
+	.open		= mmc_pack_ctrl_open,
+	.read		= seq_read,
+	.write		= mmc_pack_ctrl_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void mmc_pack_ctrl_debugfs_init(struct mmc_queue *mq,
+				       struct mmc_card *card)
+{
+	if (!card->debugfs_root)
+		return;
+
+	mq->pack_ctrl.debugfs = debugfs_create_file("pack_ctrl",
+			S_IRUSR | S_IWUSR, card->debugfs_root, mq,
+			&mmc_pack_ctrl_fops);
+}
+#else
+static inline void mmc_pack_ctrl_debugfs_init(struct mmc_queue *mq,
+					      struct mmc_card *card)
+{
+}
+#endif
+
 int mmc_packed_init(struct mmc_queue *mq, struct mmc_card *card)
 {
 	struct mmc_queue_req *mqrq_cur = &mq->mqrq[0];
@@ -597,6 +697,8 @@ int mmc_packed_init(struct mmc_queue *mq, struct mmc_card *card)
 	INIT_LIST_HEAD(&mqrq_cur->packed->list);
 	INIT_LIST_HEAD(&mqrq_prev->packed->list);
 
+	mmc_pack_ctrl_debugfs_init(mq, card);
+
 out:
 	return ret;
 }
@@ -606,6 +708,8 @@ void mmc_packed_clean(struct mmc_queue *mq)
 	struct mmc_queue_req *mqrq_cur = &mq->mqrq[0];
 	struct mmc_queue_req *mqrq_prev = &mq->mqrq[1];
 
+	debugfs_remove(mq->pack_ctrl.debugfs);
+	mq->pack_ctrl.debugfs = NULL;
 	kfree(mqrq_cur->packed);
 	mqrq_cur->packed = NULL;
 	kfree(mqrq_prev->packed);
@@ -691,7 +795,7 @@ int mmc_cmdq_init(struct mmc_queue *mq, struct mmc_card *card)
 
 free_mqrq_sg:
 	for (i = 0; i < q_depth; i++)
-		kfree(mq->mqrq_cmdq[i].sg);
+		mmc_free_sg(mq->mqrq_cmdq[i].sg);
 	kfree(mq->mqrq_cmdq);
 	mq->mqrq_cmdq = NULL;
 out:
@@ -708,7 +812,7 @@ void mmc_cmdq_clean(struct mmc_queue *mq, struct mmc_card *card)
 	blk_queue_free_tags(mq->queue);
 
 	for (i = 0; i < q_depth; i++)
-		kfree(mq->mqrq_cmdq[i].sg);
+		mmc_free_sg(mq->mqrq_cmdq[i].sg);
 	kfree(mq->mqrq_cmdq);
 	mq->mqrq_cmdq = NULL;
 }
@@ -872,6 +976,21 @@ static unsigned int mmc_queue_packed_map_sg(struct mmc_queue *mq,
 	return sg_len;
 }
 
+static void mmc_queue_sg_account(struct mmc_queue *mq, unsigned int sg_len,
+				 size_t bounced)
+{
+	struct mmc_sg_stats *st = &mq->sg_stats;
+
+	st->nr_reqs++;
+	st->nr_segs += sg_len;
+	if (sg_len > st->max_segs_seen)
+		st->max_segs_seen = sg_len;
+	if (bounced) {
+		st->nr_bounced++;
+		st->bounced_bytes += bounced;
+	}
+}
+
 /*
  * Prepare the sg list(s) to be handed of to the host driver
  */
@@ -887,10 +1006,12 @@ unsigned int mmc_queue_map_sg(struct mmc_queue *mq, struct mmc_queue_req *mqrq)
 
 	if (!mqrq->bounce_buf) {
 		if (mmc_packed_cmd(cmd_type))
-			return mmc_queue_packed_map_sg(mq, mqrq->packed,
-						       mqrq->sg, cmd_type);
+			sg_len = mmc_queue_packed_map_sg(mq, mqrq->packed,
+							 mqrq->sg, cmd_type);
 		else
-			return blk_rq_map_sg(mq->queue, mqrq->req, mqrq->sg);
+			sg_len = blk_rq_map_sg(mq->queue, mqrq->req, mqrq->sg);
+		mmc_queue_sg_account(mq, sg_len, 0);
+		return sg_len;
 	}
 
 	BUG_ON(!mqrq->bounce_sg);
@@ -908,6 +1029,7 @@ unsigned int mmc_queue_map_sg(struct mmc_queue *mq, struct mmc_queue_req *mqrq)
 		buflen += sg->length;
 
 	sg_init_one(mqrq->sg, mqrq->bounce_buf, buflen);
+	mmc_queue_sg_account(mq, 1, buflen);
 
 	return 1;
 }
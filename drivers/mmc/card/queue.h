@@ -5,6 +5,7 @@
 
 struct request;
 struct task_struct;
+struct dentry;
 
 struct mmc_blk_request {
 	struct mmc_request	mrq;
@@ -44,6 +45,54 @@ struct mmc_queue_req {
 	struct mmc_cmdq_req	cmdq_req;
 };
 
+/**
+ * struct mmc_pack_ctrl - adaptive write packing controller
+ * @is_adaptive: let the controller own the packing decision
+ * @allow_packing: packing decision taken at the end of the last window
+ * @max_packed: packed command size limit for the current window
+ * @nr_reads: read requests seen in the current window
+ * @nr_writes: write requests seen in the current window
+ * @wr_sectors: sectors written in the current window
+ * @qd_sum: sum of the queue depth sampled at each request in the window
+ * @read_pct: share of reads in the last window, in percent
+ * @avg_qd: average queue depth in the last window
+ * @avg_wr_sectors: average write size in the last window, in sectors
+ * @nr_on: windows that ended with packing allowed
+ * @nr_off: windows that ended with packing suppressed
+ * @debugfs: debugfs file exporting the controller state
+ */
+struct mmc_pack_ctrl {
+	bool		is_adaptive;
+	bool		allow_packing;
+	u8		max_packed;
+	unsigned int	nr_reads;
+	unsigned int	nr_writes;
+	unsigned int	wr_sectors;
+	unsigned int	qd_sum;
+	unsigned int	read_pct;
+	unsigned int	avg_qd;
+	unsigned int	avg_wr_sectors;
+	u64		nr_on;
+	u64		nr_off;
+	struct dentry	*debugfs;
+};
+
+/**
+ * struct mmc_sg_stats - scatter-gather mapping statistics
+ * @nr_reqs: requests mapped for the host
+ * @nr_segs: segments handed to the host over all mapped requests
+ * @max_segs_seen: largest segment count of a single mapped request
+ * @nr_bounced: requests copied through the bounce buffer
+ * @bounced_bytes: bytes copied through the bounce buffer
+ */
+struct mmc_sg_stats {
+	u64		nr_reqs;
+	u64		nr_segs;
+	unsigned int	max_segs_seen;
+	u64		nr_bounced;
+	u64		bounced_bytes;
+};
+
 struct mmc_queue {
 	struct mmc_card		*card;
 	struct task_struct	*thread;
@@ -68,6 +117,8 @@ struct mmc_queue {
 	int			num_of_potential_packed_wr_reqs;
 	int			num_wr_reqs_to_start_packing;
 	bool			no_pack_for_random;
+	struct mmc_pack_ctrl	pack_ctrl;
+	struct mmc_sg_stats	sg_stats;
 	struct work_struct	cmdq_err_work;
 
 	struct completion	cmdq_pending_req_done;
@@ -916,6 +916,7 @@ void mmc_request_done(struct mmc_host *host, struct mmc_request *mrq)
 			mrq->done(mrq);
 	} else {
 		mmc_should_fail_request(host, mrq);
+		mmc_lat_mark(host, mrq, MMC_LAT_XFER_DONE);
 
 		led_trigger_event(host->led, LED_OFF);
 
@@ -978,6 +979,7 @@ static void __mmc_start_request(struct mmc_host *host, struct mmc_request *mrq)
 		return;
 	}
 
+	mmc_lat_mark(host, mrq, MMC_LAT_ISSUED);
 	host->ops->request(host, mrq);
 }
 
@@ -1080,6 +1082,7 @@ static void mmc_start_cmdq_request(struct mmc_host *host,
 	}
 
 	mmc_host_clk_hold(host);
+	mmc_lat_mark(host, mrq, MMC_LAT_ISSUED);
 	if (likely(host->cmdq_ops->request))
 		host->cmdq_ops->request(host, mrq);
 	else
@@ -52,6 +52,44 @@ static const struct file_operations mmc_ring_buffer_fops = {
 	.release	= single_release,
 };
 
+#ifdef CONFIG_MMC_RING_BUFFER
+static int mmc_req_latency_show(struct seq_file *s, void *data)
+{
+	struct mmc_host *mmc = s->private;
+
+	mmc_dump_lat_buffer(mmc, s);
+	return 0;
+}
+
+static int mmc_req_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mmc_req_latency_show, inode->i_private);
+}
+
+static ssize_t mmc_req_latency_write(struct file *file,
+		const char __user *ubuf, size_t cnt, loff_t *ppos)
+{
+	struct mmc_host *mmc = ((struct seq_file *)file->private_data)->private;
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint_from_user(ubuf, cnt, 0, &val);
+	if (ret)
+		return ret;
+
+	ret = mmc_lat_enable(mmc, !!val);
+	return ret ? ret : cnt;
+}
+
+static const struct file_operations mmc_req_latency_fops = {
+	.open		= mmc_req_latency_open,
+	.read		= seq_read,
+	.write		= mmc_req_latency_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
+
 static int mmc_ios_show(struct seq_file *s, void *data)
 {
 	static const char *vdd_str[] = {
@@ -398,6 +436,9 @@ void mmc_add_host_debugfs(struct mmc_host *host)
 	if (!debugfs_create_file("ring_buffer", S_IRUSR,
 				root, host, &mmc_ring_buffer_fops))
 		goto err_node;
+	if (!debugfs_create_file("req_latency", S_IRUSR | S_IWUSR,
+				root, host, &mmc_req_latency_fops))
+		goto err_node;
 #endif
 
 #ifdef CONFIG_MMC_CLKGATE
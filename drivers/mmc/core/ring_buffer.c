@@ -13,6 +13,7 @@
 
 #include <linux/mmc/ring_buffer.h>
 #include <linux/mmc/host.h>
+#include <linux/vmalloc.h>
 
 void mmc_stop_tracing(struct mmc_host *mmc)
 {
@@ -65,6 +66,10 @@ void mmc_trace_write(struct mmc_host *mmc,
 void mmc_trace_init(struct mmc_host *mmc)
 {
 	BUILD_BUG_ON_NOT_POWER_OF_2(MMC_TRACE_RBUF_NUM_EVENTS);
+	BUILD_BUG_ON_NOT_POWER_OF_2(MMC_LAT_RBUF_NUM_RECS);
+
+	/* the latency recorder shares the lock even if this fails */
+	spin_lock_init(&mmc->trace_buf.trace_lock);
 
 	mmc->trace_buf.data = (char *)
 				__get_free_pages(GFP_KERNEL|__GFP_ZERO,
@@ -76,7 +81,6 @@ void mmc_trace_init(struct mmc_host *mmc)
 		return;
 	}
 
-	spin_lock_init(&mmc->trace_buf.trace_lock);
 	mmc->trace_buf.wr_idx = -1;
 }
 
@@ -85,6 +89,110 @@ void mmc_trace_free(struct mmc_host *mmc)
 	if (mmc->trace_buf.data)
 		free_pages((unsigned long)mmc->trace_buf.data,
 			MMC_TRACE_RBUF_SZ_ORDER);
+	mmc->trace_buf.lat_enabled = false;
+	vfree(mmc->trace_buf.lat);
+	mmc->trace_buf.lat = NULL;
+}
+
+/*
+ * The latency recorder keeps one fixed-size binary record per completed
+ * data request, so unlike mmc_trace_write() nothing is formatted on the
+ * I/O path. Timestamps are sampled with mmc_lat_mark() while the recorder
+ * is enabled and turned into per-phase durations by mmc_lat_record().
+ */
+int mmc_lat_enable(struct mmc_host *mmc, bool enable)
+{
+	struct mmc_lat_rec *lat = NULL;
+	unsigned long flags;
+
+	if (enable && !mmc->trace_buf.lat) {
+		lat = vzalloc(MMC_LAT_RBUF_NUM_RECS * sizeof(*lat));
+		if (!lat)
+			return -ENOMEM;
+	}
+
+	spin_lock_irqsave(&mmc->trace_buf.trace_lock, flags);
+	if (lat && !mmc->trace_buf.lat) {
+		mmc->trace_buf.lat = lat;
+		mmc->trace_buf.lat_wr_idx = 0;
+		lat = NULL;
+	}
+	mmc->trace_buf.lat_enabled = enable;
+	spin_unlock_irqrestore(&mmc->trace_buf.trace_lock, flags);
+
+	vfree(lat);
+	return 0;
+}
+
+void mmc_lat_record(struct mmc_host *mmc, struct mmc_request *mrq, int err)
+{
+	ktime_t *ts = mrq->lat_ts;
+	ktime_t now, cmd_done, hw_done;
+	struct mmc_lat_rec *rec;
+	bool busy;
+	unsigned long flags;
+
+	if (!mmc->trace_buf.lat_enabled || !mmc->trace_buf.lat ||
+	    !ktime_to_ns(ts[MMC_LAT_QUEUED]) ||
+	    !ktime_to_ns(ts[MMC_LAT_ISSUED]) ||
+	    !ktime_to_ns(ts[MMC_LAT_XFER_DONE]))
+		goto out;
+
+	now = ktime_get();
+	busy = !!ktime_to_ns(ts[MMC_LAT_BUSY_DONE]);
+	/* without a host driver mark the command is part of the transfer */
+	cmd_done = ktime_to_ns(ts[MMC_LAT_CMD_DONE]) ?
+		   ts[MMC_LAT_CMD_DONE] : ts[MMC_LAT_ISSUED];
+	hw_done = busy ? ts[MMC_LAT_BUSY_DONE] : ts[MMC_LAT_XFER_DONE];
+
+	spin_lock_irqsave(&mmc->trace_buf.trace_lock, flags);
+	rec = &mmc->trace_buf.lat[mmc->trace_buf.lat_wr_idx++ &
+				  (MMC_LAT_RBUF_NUM_RECS - 1)];
+	rec->ts_ns = ktime_to_ns(ts[MMC_LAT_QUEUED]);
+	rec->phase_us[MMC_LAT_PH_ISSUE] =
+		ktime_us_delta(cmd_done, ts[MMC_LAT_QUEUED]);
+	rec->phase_us[MMC_LAT_PH_XFER] =
+		ktime_us_delta(ts[MMC_LAT_XFER_DONE], cmd_done);
+	rec->phase_us[MMC_LAT_PH_BUSY] = busy ?
+		ktime_us_delta(ts[MMC_LAT_BUSY_DONE],
+			       ts[MMC_LAT_XFER_DONE]) : 0;
+	rec->phase_us[MMC_LAT_PH_COMPLETE] = ktime_us_delta(now, hw_done);
+	rec->opcode = mrq->cmd ? mrq->cmd->opcode : 0;
+	rec->blocks = mrq->data ? mrq->data->blocks : 0;
+	rec->is_write = mrq->data && (mrq->data->flags & MMC_DATA_WRITE);
+	rec->err = err;
+	spin_unlock_irqrestore(&mmc->trace_buf.trace_lock, flags);
+
+out:
+	memset(ts, 0, sizeof(mrq->lat_ts));
+}
+EXPORT_SYMBOL(mmc_lat_record);
+
+void mmc_dump_lat_buffer(struct mmc_host *mmc, struct seq_file *s)
+{
+	struct mmc_lat_rec *rec;
+	unsigned int idx, end;
+	unsigned long flags;
+
+	seq_puts(s, "ts_ns opcode dir blocks issue_us xfer_us busy_us complete_us err\n");
+
+	spin_lock_irqsave(&mmc->trace_buf.trace_lock, flags);
+	if (!mmc->trace_buf.lat)
+		goto out;
+
+	end = mmc->trace_buf.lat_wr_idx;
+	idx = end > MMC_LAT_RBUF_NUM_RECS ? end - MMC_LAT_RBUF_NUM_RECS : 0;
+	for (; idx != end; idx++) {
+		rec = &mmc->trace_buf.lat[idx & (MMC_LAT_RBUF_NUM_RECS - 1)];
+		seq_printf(s, "%lld %u %c %u %u %u %u %u %d\n",
+			   rec->ts_ns, rec->opcode, rec->is_write ? 'W' : 'R',
+			   rec->blocks, rec->phase_us[MMC_LAT_PH_ISSUE],
+			   rec->phase_us[MMC_LAT_PH_XFER],
+			   rec->phase_us[MMC_LAT_PH_BUSY],
+			   rec->phase_us[MMC_LAT_PH_COMPLETE], rec->err);
+	}
+out:
+	spin_unlock_irqrestore(&mmc->trace_buf.trace_lock, flags);
 }
 
 void mmc_dump_trace_buffer(struct mmc_host *mmc, struct seq_file *s)
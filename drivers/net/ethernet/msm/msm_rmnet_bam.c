@@ -245,6 +245,15 @@ static void bam_recv_notify(void *dev, struct sk_buff *skb)
 			((struct net_device *)dev)->name, __func__);
 }
 
+/* Rx batch Callback, Called in Work Queue context */
+static void bam_recv_list_notify(void *dev, struct sk_buff_head *list)
+{
+	struct sk_buff *skb;
+
+	while ((skb = __skb_dequeue(list)))
+		bam_recv_notify(dev, skb);
+}
+
 static struct sk_buff *_rmnet_add_headroom(struct sk_buff **skb,
 					   struct net_device *dev)
 {
@@ -341,6 +350,9 @@ static void bam_notify(void *dev, int event, unsigned long data)
 	case BAM_DMUX_RECEIVE:
 		bam_recv_notify(dev, (struct sk_buff *)(data));
 		break;
+	case BAM_DMUX_RECEIVE_LIST:
+		bam_recv_list_notify(dev, (struct sk_buff_head *)(data));
+		break;
 	case BAM_DMUX_WRITE_DONE:
 		bam_write_done(dev, (struct sk_buff *)(data));
 		break;
@@ -383,6 +395,7 @@ static int __rmnet_open(struct net_device *dev)
 					__func__, p->ch_id, r);
 			return -ENODEV;
 		}
+		msm_bam_dmux_set_rx_list(p->ch_id, 1);
 	}
 
 	p->device_up = DEVICE_ACTIVE;
@@ -17,6 +17,10 @@
 #include <linux/stacktrace.h>
 #include <linux/wcnss_wlan.h>
 #include <linux/spinlock.h>
+#include <linux/jiffies.h>
+#include <linux/of.h>
+#include <linux/sort.h>
+#include <linux/mm.h>
 #ifdef	CONFIG_WCNSS_SKB_PRE_ALLOC
 #include <linux/skbuff.h>
 #endif
@@ -31,6 +35,18 @@ static DEFINE_SPINLOCK(alloc_lock);
 
 #define PRE_ALLOC_DEBUGFS_DIR		"cnss-prealloc"
 #define PRE_ALLOC_DEBUGFS_FILE_OBJ	"status"
+#define PRE_ALLOC_DT_COMPAT		"qcom,cnss-prealloc"
+#define PRE_ALLOC_DT_POOLS		"qcom,prealloc-pools"
+
+/*
+ * Slots above the high-water mark of their pool are handed to the
+ * shrinker once the WLAN driver has been up and its peak usage has not
+ * grown for this long; 0 keeps the pools fully populated.
+ */
+static unsigned int reclaim_delay_ms = 30000;
+module_param(reclaim_delay_ms, uint, 0644);
+MODULE_PARM_DESC(reclaim_delay_ms,
+		 "Delay after the last usage peak before unused slots can be reclaimed (ms, 0: never)");
 
 static struct dentry *debug_base;
 
@@ -54,81 +70,42 @@ static struct wcnss_prealloc wcnss_skb_allocs[] = {
 };
 #endif
 
-/* pre-alloced mem for WLAN driver */
-static struct wcnss_prealloc wcnss_allocs[] = {
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 128 * 1024, NULL},
-	{0, 128 * 1024, NULL},
+/*
+ * Pre-alloced mem for WLAN driver, one pool per slot size, smallest first.
+ * A slot whose buffer was reclaimed has a NULL ptr and is refilled when a
+ * request finds no populated free slot in its pool.
+ */
+struct wcnss_prealloc_pool {
+	size_t size;
+	int nr_slots;
+	int populated;
+	int used;
+	int high_water;
+	/* requests the pool could not serve, and refills/reclaims */
+	unsigned long misses;
+	unsigned long refills;
+	unsigned long reclaimed;
+	struct wcnss_prealloc *slots;
+};
+
+/* Default pools: slot size in Kb, number of slots */
+static const u32 wcnss_default_pools[][2] = {
+	{8, 8},
+	{16, 42},
+	{32, 10},
+	{64, 9},
+	{128, 2},
 };
 
+static struct wcnss_prealloc_pool *wcnss_pools;
+static int wcnss_nr_pools;
+/* Requests no pool could serve */
+static unsigned long wcnss_prealloc_failures;
+/* Set by the first request; nothing is reclaimed before the driver ran */
+static bool wcnss_prealloc_active;
+/* jiffies at which a high-water mark last went up */
+static unsigned long wcnss_high_water_stamp;
+
 #ifdef CONFIG_WCNSS_SKB_PRE_ALLOC
 int cnss_skb_prealloc_init(void)
 {
@@ -151,15 +128,93 @@ int cnss_skb_prealloc_init(void)
 }
 #endif
 
+static int wcnss_prealloc_pool_cmp(const void *a, const void *b)
+{
+	const struct wcnss_prealloc_pool *pa = a, *pb = b;
+
+	if (pa->size == pb->size)
+		return 0;
+	return pa->size < pb->size ? -1 : 1;
+}
+
+/*
+ * The pools can be sized per board with an optional node:
+ *
+ *	cnss_prealloc {
+ *		compatible = "qcom,cnss-prealloc";
+ *		qcom,prealloc-pools = <8 8>, <16 42>, <32 10>, <64 9>;
+ *	};
+ *
+ * listing the slot size in Kb and the number of slots of each pool.
+ */
+static int wcnss_prealloc_pools_setup(void)
+{
+	const u32 *cfg = &wcnss_default_pools[0][0];
+	int len = 2 * ARRAY_SIZE(wcnss_default_pools);
+	struct device_node *np;
+	u32 *dt_cfg = NULL;
+	int i, n;
+
+	np = of_find_compatible_node(NULL, NULL, PRE_ALLOC_DT_COMPAT);
+	if (np) {
+		n = of_property_count_u32_elems(np, PRE_ALLOC_DT_POOLS);
+		if (n > 0 && !(n % 2))
+			dt_cfg = kcalloc(n, sizeof(*dt_cfg), GFP_KERNEL);
+		if (dt_cfg && !of_property_read_u32_array(np,
+				PRE_ALLOC_DT_POOLS, dt_cfg, n)) {
+			cfg = dt_cfg;
+			len = n;
+		} else if (n != -EINVAL) {
+			pr_err("%s: bad %s, using the default pools\n",
+			       __func__, PRE_ALLOC_DT_POOLS);
+		}
+		of_node_put(np);
+	}
+
+	wcnss_pools = kcalloc(len / 2, sizeof(*wcnss_pools), GFP_KERNEL);
+	if (!wcnss_pools) {
+		kfree(dt_cfg);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < len; i += 2) {
+		if (!cfg[i] || !cfg[i + 1])
+			continue;
+		wcnss_pools[wcnss_nr_pools].size = cfg[i] * 1024;
+		wcnss_pools[wcnss_nr_pools].nr_slots = cfg[i + 1];
+		wcnss_nr_pools++;
+	}
+	kfree(dt_cfg);
+
+	sort(wcnss_pools, wcnss_nr_pools, sizeof(*wcnss_pools),
+	     wcnss_prealloc_pool_cmp, NULL);
+
+	return 0;
+}
+
 int wcnss_prealloc_init(void)
 {
-	int i, ret;
+	struct wcnss_prealloc_pool *pool;
+	int i, j, ret;
+
+	ret = wcnss_prealloc_pools_setup();
+	if (ret)
+		return ret;
 
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		wcnss_allocs[i].occupied = 0;
-		wcnss_allocs[i].ptr = kmalloc(wcnss_allocs[i].size, GFP_KERNEL);
-		if (wcnss_allocs[i].ptr == NULL)
+	for (i = 0; i < wcnss_nr_pools; i++) {
+		pool = &wcnss_pools[i];
+		pool->slots = kcalloc(pool->nr_slots, sizeof(*pool->slots),
+				      GFP_KERNEL);
+		if (!pool->slots)
 			return -ENOMEM;
+
+		for (j = 0; j < pool->nr_slots; j++) {
+			pool->slots[j].size = pool->size;
+			pool->slots[j].ptr = kmalloc(pool->size, GFP_KERNEL);
+			if (pool->slots[j].ptr == NULL)
+				return -ENOMEM;
+			pool->populated++;
+		}
 	}
 	ret = cnss_skb_prealloc_init();
 
@@ -182,12 +237,18 @@ void cnss_skb_prealloc_deinit(void) {}
 
 void wcnss_prealloc_deinit(void)
 {
-	int i = 0;
-
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		kfree(wcnss_allocs[i].ptr);
-		wcnss_allocs[i].ptr = NULL;
+	struct wcnss_prealloc_pool *pool;
+	int i, j;
+
+	for (i = 0; i < wcnss_nr_pools; i++) {
+		pool = &wcnss_pools[i];
+		for (j = 0; pool->slots && j < pool->nr_slots; j++)
+			kfree(pool->slots[j].ptr);
+		kfree(pool->slots);
 	}
+	kfree(wcnss_pools);
+	wcnss_pools = NULL;
+	wcnss_nr_pools = 0;
 
 	cnss_skb_prealloc_deinit();
 }
@@ -214,24 +275,80 @@ static inline void wcnss_prealloc_save_stack_trace(struct wcnss_prealloc *entry)
 }
 #endif
 
+/*
+ * Pick a free slot of @pool, preferring one that still has its buffer;
+ * called with alloc_lock held.
+ */
+static struct wcnss_prealloc *
+wcnss_prealloc_pool_take(struct wcnss_prealloc_pool *pool)
+{
+	struct wcnss_prealloc *empty = NULL;
+	int i;
+
+	for (i = 0; i < pool->nr_slots; i++) {
+		if (pool->slots[i].occupied)
+			continue;
+		if (pool->slots[i].ptr)
+			return &pool->slots[i];
+		if (!empty)
+			empty = &pool->slots[i];
+	}
+
+	return empty;
+}
+
 void *wcnss_prealloc_get(size_t size)
 {
-	int i = 0;
+	struct wcnss_prealloc_pool *pool;
+	struct wcnss_prealloc *entry;
 	unsigned long flags;
+	void *ptr;
+	int i = 0;
 
 	spin_lock_irqsave(&alloc_lock, flags);
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		if (wcnss_allocs[i].occupied)
+	if (!wcnss_prealloc_active) {
+		wcnss_prealloc_active = true;
+		wcnss_high_water_stamp = jiffies;
+	}
+
+	for (i = 0; i < wcnss_nr_pools; i++) {
+		pool = &wcnss_pools[i];
+		if (pool->size < size)
 			continue;
 
-		if (wcnss_allocs[i].size >= size) {
-			/* we found the slot */
-			wcnss_allocs[i].occupied = 1;
+		entry = wcnss_prealloc_pool_take(pool);
+		if (entry && !entry->ptr) {
+			/* reclaimed earlier, hold the slot while refilling */
+			entry->occupied = 1;
 			spin_unlock_irqrestore(&alloc_lock, flags);
-			wcnss_prealloc_save_stack_trace(&wcnss_allocs[i]);
-			return wcnss_allocs[i].ptr;
+			ptr = kmalloc(pool->size, GFP_ATOMIC | __GFP_NOWARN);
+			spin_lock_irqsave(&alloc_lock, flags);
+			entry->occupied = 0;
+			if (ptr) {
+				entry->ptr = ptr;
+				pool->populated++;
+				pool->refills++;
+			} else {
+				entry = NULL;
+			}
+		}
+
+		if (!entry) {
+			pool->misses++;
+			continue;
 		}
+
+		/* we found the slot */
+		entry->occupied = 1;
+		if (++pool->used > pool->high_water) {
+			pool->high_water = pool->used;
+			wcnss_high_water_stamp = jiffies;
+		}
+		spin_unlock_irqrestore(&alloc_lock, flags);
+		wcnss_prealloc_save_stack_trace(entry);
+		return entry->ptr;
 	}
+	wcnss_prealloc_failures++;
 	spin_unlock_irqrestore(&alloc_lock, flags);
 
 	pr_err("wcnss: %s: prealloc not available for size: %zu\n",
@@ -243,13 +360,23 @@ EXPORT_SYMBOL(wcnss_prealloc_get);
 
 int wcnss_prealloc_put(void *ptr)
 {
-	int i = 0;
+	struct wcnss_prealloc_pool *pool;
 	unsigned long flags;
+	int i, j;
+
+	if (!ptr)
+		return 0;
 
 	spin_lock_irqsave(&alloc_lock, flags);
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		if (wcnss_allocs[i].ptr == ptr) {
-			wcnss_allocs[i].occupied = 0;
+	for (i = 0; i < wcnss_nr_pools; i++) {
+		pool = &wcnss_pools[i];
+		for (j = 0; j < pool->nr_slots; j++) {
+			if (pool->slots[j].ptr != ptr)
+				continue;
+			if (pool->slots[j].occupied) {
+				pool->slots[j].occupied = 0;
+				pool->used--;
+			}
 			spin_unlock_irqrestore(&alloc_lock, flags);
 			return 1;
 		}
@@ -260,6 +387,91 @@ int wcnss_prealloc_put(void *ptr)
 }
 EXPORT_SYMBOL(wcnss_prealloc_put);
 
+/* Called with alloc_lock held */
+static bool wcnss_prealloc_settled(void)
+{
+	unsigned int delay = ACCESS_ONCE(reclaim_delay_ms);
+
+	return wcnss_prealloc_active && delay &&
+	       time_after(jiffies, wcnss_high_water_stamp +
+				   msecs_to_jiffies(delay));
+}
+
+static unsigned long
+wcnss_prealloc_pool_pages(struct wcnss_prealloc_pool *pool)
+{
+	return DIV_ROUND_UP(pool->size, PAGE_SIZE);
+}
+
+static unsigned long wcnss_prealloc_shrink_count(struct shrinker *shrink,
+						 struct shrink_control *sc)
+{
+	struct wcnss_prealloc_pool *pool;
+	unsigned long flags, count = 0;
+	int i;
+
+	spin_lock_irqsave(&alloc_lock, flags);
+	if (wcnss_prealloc_settled()) {
+		for (i = 0; i < wcnss_nr_pools; i++) {
+			pool = &wcnss_pools[i];
+			if (pool->populated > pool->high_water)
+				count += (pool->populated - pool->high_water) *
+					 wcnss_prealloc_pool_pages(pool);
+		}
+	}
+	spin_unlock_irqrestore(&alloc_lock, flags);
+
+	return count;
+}
+
+/*
+ * Free the populated slots above the high-water mark of each pool,
+ * largest slots first; what the driver needed at its peak stays reserved.
+ */
+static unsigned long wcnss_prealloc_shrink_scan(struct shrinker *shrink,
+						struct shrink_control *sc)
+{
+	struct wcnss_prealloc_pool *pool;
+	struct wcnss_prealloc *entry;
+	unsigned long flags, freed = 0;
+	int i, j;
+
+	spin_lock_irqsave(&alloc_lock, flags);
+	if (!wcnss_prealloc_settled()) {
+		spin_unlock_irqrestore(&alloc_lock, flags);
+		return SHRINK_STOP;
+	}
+
+	for (i = wcnss_nr_pools - 1; i >= 0; i--) {
+		pool = &wcnss_pools[i];
+		for (j = 0; j < pool->nr_slots; j++) {
+			if (freed >= sc->nr_to_scan ||
+			    pool->populated <= pool->high_water)
+				break;
+
+			entry = &pool->slots[j];
+			if (entry->occupied || !entry->ptr)
+				continue;
+
+			kfree(entry->ptr);
+			entry->ptr = NULL;
+			pool->populated--;
+			pool->reclaimed++;
+			freed += wcnss_prealloc_pool_pages(pool);
+		}
+	}
+	spin_unlock_irqrestore(&alloc_lock, flags);
+
+	return freed;
+}
+
+static struct shrinker wcnss_prealloc_shrinker = {
+	.count_objects = wcnss_prealloc_shrink_count,
+	.scan_objects = wcnss_prealloc_shrink_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+static bool wcnss_prealloc_shrinker_registered;
+
 #ifdef CONFIG_WCNSS_SKB_PRE_ALLOC
 struct sk_buff *wcnss_skb_prealloc_get(unsigned int size)
 {
@@ -275,7 +487,7 @@ struct sk_buff *wcnss_skb_prealloc_get(unsigned int size)
 			/* we found the slot */
 			wcnss_skb_allocs[i].occupied = 1;
 			spin_unlock_irqrestore(&alloc_lock, flags);
-			wcnss_prealloc_save_stack_trace(&wcnss_allocs[i]);
+			wcnss_prealloc_save_stack_trace(&wcnss_skb_allocs[i]);
 			return wcnss_skb_allocs[i].ptr;
 		}
 	}
@@ -311,23 +523,26 @@ EXPORT_SYMBOL(wcnss_skb_prealloc_put);
 #ifdef CONFIG_SLUB_DEBUG_ON
 void wcnss_prealloc_check_memory_leak(void)
 {
-	int i;
+	struct wcnss_prealloc *entry;
 	bool leak_detected = false;
+	int i, j;
 
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		if (!wcnss_allocs[i].occupied)
-			continue;
+	for (i = 0; i < wcnss_nr_pools; i++) {
+		for (j = 0; j < wcnss_pools[i].nr_slots; j++) {
+			entry = &wcnss_pools[i].slots[j];
+			if (!entry->occupied)
+				continue;
 
-		if (!leak_detected) {
-			pr_err("wcnss_prealloc: Memory leak detected\n");
-			leak_detected = true;
-		}
+			if (!leak_detected) {
+				pr_err("wcnss_prealloc: Memory leak detected\n");
+				leak_detected = true;
+			}
 
-		pr_err("Size: %zu, addr: %pK, backtrace:\n",
-		       wcnss_allocs[i].size, wcnss_allocs[i].ptr);
-		print_stack_trace(&wcnss_allocs[i].trace, 1);
+			pr_err("Size: %zu, addr: %pK, backtrace:\n",
+			       entry->size, entry->ptr);
+			print_stack_trace(&entry->trace, 1);
+		}
 	}
-
 }
 #endif
 
@@ -382,57 +597,59 @@ int wcnss_skb_pre_alloc_reset(void)
 
 int wcnss_pre_alloc_reset(void)
 {
-	int i, n = 0;
-
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		if (!wcnss_allocs[i].occupied)
-			continue;
+	struct wcnss_prealloc_pool *pool;
+	unsigned long flags;
+	int i, j, n = 0;
 
-		wcnss_allocs[i].occupied = 0;
-		n++;
+	spin_lock_irqsave(&alloc_lock, flags);
+	for (i = 0; i < wcnss_nr_pools; i++) {
+		pool = &wcnss_pools[i];
+		for (j = 0; j < pool->nr_slots; j++) {
+			/* leave slots being refilled to wcnss_prealloc_get */
+			if (!pool->slots[j].occupied || !pool->slots[j].ptr)
+				continue;
+
+			pool->slots[j].occupied = 0;
+			n++;
+		}
+		pool->used = 0;
 	}
+	spin_unlock_irqrestore(&alloc_lock, flags);
 
 	return n;
 }
 
 int prealloc_memory_stats_show(struct seq_file *fp, void *data)
 {
+	struct wcnss_prealloc_pool *pool;
+	unsigned long flags;
+	size_t tsize = 0, tused = 0, tpopulated = 0;
 	int i = 0;
-	int used_slots = 0, free_slots = 0;
-	unsigned int tsize = 0, tused = 0, size = 0;
-
-	seq_puts(fp, "\nSlot_Size(Kb)\t\t[Used : Free]\n");
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		tsize += wcnss_allocs[i].size;
-		if (size != wcnss_allocs[i].size) {
-			if (size) {
-				seq_printf(
-					fp, "[%d : %d]\n",
-					used_slots, free_slots);
-			}
 
-			size = wcnss_allocs[i].size;
-			used_slots = 0;
-			free_slots = 0;
-			seq_printf(fp, "%d Kb\t\t\t", size / 1024);
-		}
-
-		if (wcnss_allocs[i].occupied) {
-			tused += wcnss_allocs[i].size;
-			++used_slots;
-		} else {
-			++free_slots;
-		}
+	spin_lock_irqsave(&alloc_lock, flags);
+	seq_puts(fp, "\nSlot_Size(Kb)\t\t[Used : Free]\tPopulated\tHigh_Water\tMisses\tRefills\tReclaimed\n");
+	for (i = 0; i < wcnss_nr_pools; i++) {
+		pool = &wcnss_pools[i];
+		tsize += pool->size * pool->nr_slots;
+		tused += pool->size * pool->used;
+		tpopulated += pool->size * pool->populated;
+
+		seq_printf(fp, "%zu Kb\t\t\t[%d : %d]\t%d\t\t%d\t\t%lu\t%lu\t%lu\n",
+			   pool->size / 1024, pool->used,
+			   pool->nr_slots - pool->used, pool->populated,
+			   pool->high_water, pool->misses, pool->refills,
+			   pool->reclaimed);
 	}
-	seq_printf(fp, "[%d : %d]\n", used_slots, free_slots);
 
 	/* Convert byte to Kb */
-	if (tsize)
-		tsize = tsize / 1024;
-	if (tused)
-		tused = tused / 1024;
-	seq_printf(fp, "\nMemory Status:\nTotal Memory: %dKb\n", tsize);
-	seq_printf(fp, "Used: %dKb\nFree: %dKb\n", tused, tsize - tused);
+	seq_printf(fp, "\nMemory Status:\nTotal Memory: %zuKb\n", tsize / 1024);
+	seq_printf(fp, "Used: %zuKb\nFree: %zuKb\n", tused / 1024,
+		   (tsize - tused) / 1024);
+	seq_printf(fp, "Populated: %zuKb\nFailed requests: %lu\n",
+		   tpopulated / 1024, wcnss_prealloc_failures);
+	seq_printf(fp, "Reclaim: %s\n", !reclaim_delay_ms ? "disabled" :
+		   wcnss_prealloc_settled() ? "allowed" : "waiting");
+	spin_unlock_irqrestore(&alloc_lock, flags);
 
 	return 0;
 }
@@ -457,9 +674,19 @@ static int __init wcnss_pre_alloc_init(void)
 	ret = wcnss_prealloc_init();
 	if (ret) {
 		pr_err("%s: Failed to init the prealloc pool\n", __func__);
+		wcnss_prealloc_deinit();
 		return ret;
 	}
 
+	ret = register_shrinker(&wcnss_prealloc_shrinker);
+	if (ret) {
+		/* the pools just stay fully populated */
+		pr_err("%s: Failed to register the shrinker\n", __func__);
+		ret = 0;
+	} else {
+		wcnss_prealloc_shrinker_registered = true;
+	}
+
 	debug_base = debugfs_create_dir(PRE_ALLOC_DEBUGFS_DIR, NULL);
 	if (IS_ERR_OR_NULL(debug_base)) {
 		pr_err("%s: Failed to create debugfs dir\n", __func__);
@@ -476,6 +703,8 @@ static int __init wcnss_pre_alloc_init(void)
 
 static void __exit wcnss_pre_alloc_exit(void)
 {
+	if (wcnss_prealloc_shrinker_registered)
+		unregister_shrinker(&wcnss_prealloc_shrinker);
 	wcnss_prealloc_deinit();
 	debugfs_remove_recursive(debug_base);
 }
@@ -29,6 +29,24 @@
 
 #define GSI_RESET_WA_MIN_SLEEP 1000
 #define GSI_RESET_WA_MAX_SLEEP 2000
+
+#define GSI_EVT_MODER_SAMPLE_MS 100
+
+/*
+ * adaptive moderation levels: a ring moves up a level once its event rate
+ * reaches the rate of the next level and back down once it drops below half
+ * the rate of its current level
+ */
+static const struct {
+	unsigned long rate;
+	uint8_t modc;
+} gsi_evt_moder_levels[] = {
+	{ 0, 1 },
+	{ 4000, 4 },
+	{ 16000, 8 },
+	{ 48000, 16 },
+};
+
 static const struct of_device_id msm_gsi_match[] = {
 	{ .compatible = "qcom,msm_gsi", },
 	{ },
@@ -391,6 +409,106 @@ static void gsi_process_evt_re(struct gsi_evt_ctx *ctx,
 	ctx->stats.completed++;
 }
 
+static void gsi_write_evt_ring_moder(struct gsi_evt_ctx *ctx,
+		uint16_t modt, uint8_t modc)
+{
+	uint32_t val;
+
+	val = (((modt << GSI_EE_n_EV_CH_k_CNTXT_8_INT_MODT_SHFT) &
+		GSI_EE_n_EV_CH_k_CNTXT_8_INT_MODT_BMSK) |
+		((modc << GSI_EE_n_EV_CH_k_CNTXT_8_INT_MODC_SHFT) &
+		 GSI_EE_n_EV_CH_k_CNTXT_8_INT_MODC_BMSK));
+	gsi_writel(val, gsi_ctx->base +
+			GSI_EE_n_EV_CH_k_CNTXT_8_OFFS(ctx->id,
+				gsi_ctx->per.ee));
+
+	ctx->moder.cur_modt = modt;
+	ctx->moder.cur_modc = modc;
+	ctx->moder.updates++;
+}
+
+static void gsi_init_evt_ring_moder(struct gsi_evt_ctx *ctx)
+{
+	struct gsi_evt_moder *moder = &ctx->moder;
+
+	moder->adaptive = ctx->props.int_mod_adaptive &&
+		ctx->props.int_modt && ctx->props.intr == GSI_INTR_IRQ;
+	moder->cur_modt = ctx->props.int_modt;
+	moder->cur_modc = ctx->props.int_modc;
+	moder->level = 0;
+	moder->sample_jiffies = jiffies;
+	moder->sample_completed = ctx->stats.completed;
+
+	/* the ring context was just programmed from the props */
+	if (moder->override)
+		gsi_write_evt_ring_moder(ctx, moder->ovr_modt,
+			moder->ovr_modc);
+}
+
+static void gsi_sample_evt_ring_moder(struct gsi_evt_ctx *ctx)
+{
+	struct gsi_evt_moder *moder = &ctx->moder;
+	unsigned long elapsed = jiffies - moder->sample_jiffies;
+	unsigned int level;
+	uint8_t modc;
+
+	if (!moder->adaptive || moder->override)
+		return;
+
+	if (elapsed < msecs_to_jiffies(GSI_EVT_MODER_SAMPLE_MS))
+		return;
+
+	moder->rate = (ctx->stats.completed - moder->sample_completed) * HZ /
+		elapsed;
+	moder->sample_jiffies = jiffies;
+	moder->sample_completed = ctx->stats.completed;
+
+	level = moder->level;
+	if (level + 1 < ARRAY_SIZE(gsi_evt_moder_levels) &&
+		moder->rate >= gsi_evt_moder_levels[level + 1].rate)
+		level++;
+	else if (level &&
+		moder->rate < gsi_evt_moder_levels[level].rate / 2)
+		level--;
+
+	if (level == moder->level)
+		return;
+
+	moder->level = level;
+	modc = max(gsi_evt_moder_levels[level].modc, ctx->props.int_modc);
+	gsi_write_evt_ring_moder(ctx, ctx->props.int_modt, modc);
+}
+
+/**
+ * gsi_set_evt_ring_moder_override() - fix the moderation of an event ring
+ * @ctx: event ring context
+ * @enable: true to apply @modt/@modc, false to return to the configured
+ *	    (and possibly adaptive) moderation
+ * @modt: moderation timer in 32KHz cycles
+ * @modc: moderation counter
+ */
+void gsi_set_evt_ring_moder_override(struct gsi_evt_ctx *ctx, bool enable,
+	uint16_t modt, uint8_t modc)
+{
+	struct gsi_evt_moder *moder = &ctx->moder;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ctx->ring.slock, flags);
+	moder->override = enable;
+	moder->ovr_modt = modt;
+	moder->ovr_modc = modc;
+	if (enable) {
+		gsi_write_evt_ring_moder(ctx, modt, modc);
+	} else {
+		gsi_write_evt_ring_moder(ctx, ctx->props.int_modt,
+			ctx->props.int_modc);
+		moder->level = 0;
+		moder->sample_jiffies = jiffies;
+		moder->sample_completed = ctx->stats.completed;
+	}
+	spin_unlock_irqrestore(&ctx->ring.slock, flags);
+}
+
 static void gsi_ring_evt_doorbell(struct gsi_evt_ctx *ctx)
 {
 	uint32_t val;
@@ -495,6 +613,7 @@ check_again:
 			gsi_ring_evt_doorbell(ctx);
 			if (cntr != 0)
 				goto check_again;
+			gsi_sample_evt_ring_moder(ctx);
 			spin_unlock_irqrestore(&ctx->ring.slock, flags);
 		}
 	}
@@ -1173,6 +1292,7 @@ int gsi_alloc_evt_ring(struct gsi_evt_ring_props *props, unsigned long dev_hdl,
 	gsi_init_evt_ring(props, &ctx->ring);
 
 	ctx->id = evt_id;
+	gsi_init_evt_ring_moder(ctx);
 	*evt_ring_hdl = evt_id;
 	atomic_inc(&gsi_ctx->num_evt_ring);
 	if (props->intf == GSI_EVT_CHTYPE_GPI_EV)
@@ -1416,6 +1536,7 @@ int gsi_reset_evt_ring(unsigned long evt_ring_hdl)
 
 	gsi_program_evt_ring_ctx(&ctx->props, evt_ring_hdl, gsi_ctx->per.ee);
 	gsi_init_evt_ring(&ctx->props, &ctx->ring);
+	gsi_init_evt_ring_moder(ctx);
 
 	/* restore scratch */
 	__gsi_write_evt_ring_scratch(evt_ring_hdl, ctx->scratch);
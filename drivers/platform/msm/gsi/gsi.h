@@ -139,6 +139,34 @@ struct gsi_evt_stats {
 	unsigned long completed;
 };
 
+/**
+ * struct gsi_evt_moder - runtime interrupt moderation state of an event ring
+ * @adaptive: int_modc is tuned from the sampled event rate
+ * @override: moderation is fixed to @ovr_modt/@ovr_modc from debugfs
+ * @ovr_modt: override moderation timer
+ * @ovr_modc: override moderation counter
+ * @cur_modt: moderation timer currently programmed
+ * @cur_modc: moderation counter currently programmed
+ * @level: index in the adaptive moderation level table
+ * @sample_jiffies: start of the current rate sample
+ * @sample_completed: completed events at the start of the sample
+ * @rate: last sampled rate in events per second
+ * @updates: number of moderation register updates
+ */
+struct gsi_evt_moder {
+	bool adaptive;
+	bool override;
+	uint16_t ovr_modt;
+	uint8_t ovr_modc;
+	uint16_t cur_modt;
+	uint8_t cur_modc;
+	unsigned int level;
+	unsigned long sample_jiffies;
+	unsigned long sample_completed;
+	unsigned long rate;
+	unsigned long updates;
+};
+
 struct gsi_evt_ctx {
 	struct gsi_evt_ring_props props;
 	enum gsi_evt_ring_state state;
@@ -150,6 +178,7 @@ struct gsi_evt_ctx {
 	atomic_t chan_ref_cnt;
 	union __packed gsi_evt_scratch scratch;
 	struct gsi_evt_stats stats;
+	struct gsi_evt_moder moder;
 };
 
 struct gsi_ee_scratch {
@@ -295,5 +324,7 @@ extern struct gsi_ctx *gsi_ctx;
 void gsi_debugfs_init(void);
 uint16_t gsi_find_idx_from_addr(struct gsi_ring_ctx *ctx, uint64_t addr);
 void gsi_update_ch_dp_stats(struct gsi_chan_ctx *ctx, uint16_t used);
+void gsi_set_evt_ring_moder_override(struct gsi_evt_ctx *ctx, bool enable,
+	uint16_t modt, uint8_t modc);
 
 #endif
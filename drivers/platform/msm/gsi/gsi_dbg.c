@@ -661,6 +661,81 @@ static ssize_t gsi_enable_ipc_low(struct file *file,
 }
 
 
+static ssize_t gsi_evt_moder(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
+{
+	u32 evt_id;
+	u32 modt, modc;
+	struct gsi_evt_ctx *ctx;
+	struct gsi_evt_moder *moder;
+	char *sptr, *token;
+
+	if (sizeof(dbg_buff) < count + 1)
+		goto error;
+
+	if (copy_from_user(dbg_buff, buf, count))
+		goto error;
+
+	dbg_buff[count] = '\0';
+
+	sptr = strim(dbg_buff);
+
+	token = strsep(&sptr, " ");
+	if (!token || kstrtou32(token, 0, &evt_id))
+		goto error;
+
+	if (evt_id >= gsi_ctx->max_ev || evt_id >= GSI_EVT_RING_MAX) {
+		TERR("invalid evt id %u\n", evt_id);
+		goto error;
+	}
+
+	ctx = &gsi_ctx->evtr[evt_id];
+	if (ctx->state != GSI_EVT_RING_STATE_ALLOCATED) {
+		TERR("evt %u not allocated\n", evt_id);
+		goto error;
+	}
+	moder = &ctx->moder;
+
+	token = strsep(&sptr, " ");
+	if (!token) {
+		/* get */
+		PRT_STAT("EV%2d: modt=%u modc=%u cfg_modt=%u cfg_modc=%u\n",
+			evt_id, moder->cur_modt, moder->cur_modc,
+			ctx->props.int_modt, ctx->props.int_modc);
+		PRT_STAT("adaptive=%d override=%d level=%u rate=%lu/s updates=%lu\n",
+			moder->adaptive, moder->override, moder->level,
+			moder->rate, moder->updates);
+		return count;
+	}
+
+	if (!strcmp(token, "auto")) {
+		gsi_set_evt_ring_moder_override(ctx, false, 0, 0);
+		return count;
+	}
+
+	if (kstrtou32(token, 0, &modt))
+		goto error;
+
+	token = strsep(&sptr, " ");
+	if (!token || kstrtou32(token, 0, &modc))
+		goto error;
+
+	if (modt > U16_MAX || modc > U8_MAX || !modc) {
+		TERR("invalid modt %u modc %u\n", modt, modc);
+		goto error;
+	}
+
+	TDBG("evt_id=%u modt=%u modc=%u\n", evt_id, modt, modc);
+	gsi_set_evt_ring_moder_override(ctx, true, modt, modc);
+
+	return count;
+
+error:
+	TERR("Usage: (set) echo <evt_id> <modt> <modc> > evt_moder\n");
+	TERR("Usage: (restore) echo <evt_id> auto > evt_moder\n");
+	TERR("Usage: (get) echo <evt_id> > evt_moder\n");
+	return -EFAULT;
+}
 
 const struct file_operations gsi_ev_dump_ops = {
 	.write = gsi_dump_evt,
@@ -694,6 +769,10 @@ const struct file_operations gsi_ipc_low_ops = {
 	.write = gsi_enable_ipc_low,
 };
 
+const struct file_operations gsi_evt_moder_ops = {
+	.write = gsi_evt_moder,
+};
+
 void gsi_debugfs_init(void)
 {
 	static struct dentry *dfile;
@@ -761,6 +840,13 @@ void gsi_debugfs_init(void)
 		goto fail;
 	}
 
+	dfile = debugfs_create_file("evt_moder", write_only_mode,
+		dent, 0, &gsi_evt_moder_ops);
+	if (!dfile || IS_ERR(dfile)) {
+		TERR("could not create evt_moder\n");
+		goto fail;
+	}
+
 	return;
 fail:
 	debugfs_remove_recursive(dent);
@@ -1856,6 +1856,34 @@ int ipa_dma_async_memcpy(u64 dest, u64 src, int len,
 }
 EXPORT_SYMBOL(ipa_dma_async_memcpy);
 
+/**
+ * ipa_dma_async_memcpy_batch()- Perform a batch of asynchronous memcpy
+ * operations using IPA, with a single completion callback.
+ *
+ * @descs: copies to perform.
+ * @num: number of copies in @descs.
+ * @user_cb: callback function to notify the client when all copies are done.
+ * @user_param: cookie for user_cb.
+ *
+ * Return codes: 0: success
+ *		-EINVAL: invalid params
+ *		-EPERM: operation not permitted as ipa_dma isn't enable or
+ *			initialized
+ *		-ENOMEM: failed to allocate the batch
+ *		-EFAULT: descr fifo is full.
+ */
+int ipa_dma_async_memcpy_batch(const struct ipa_dma_memcpy_desc *descs,
+		int num, void (*user_cb)(void *user1), void *user_param)
+{
+	int ret;
+
+	IPA_API_DISPATCH_RETURN(ipa_dma_async_memcpy_batch, descs, num,
+		user_cb, user_param);
+
+	return ret;
+}
+EXPORT_SYMBOL(ipa_dma_async_memcpy_batch);
+
 /**
  * ipa_dma_uc_memcpy() - Perform a memcpy action using IPA uC
  * @dest: physical address to store the copied data.
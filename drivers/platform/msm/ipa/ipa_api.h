@@ -224,6 +224,10 @@ struct ipa_api_controller {
 	int (*ipa_dma_async_memcpy)(u64 dest, u64 src, int len,
 		void (*user_cb)(void *user1), void *user_param);
 
+	int (*ipa_dma_async_memcpy_batch)(
+		const struct ipa_dma_memcpy_desc *descs, int num,
+		void (*user_cb)(void *user1), void *user_param);
+
 	int (*ipa_dma_uc_memcpy)(phys_addr_t dest, phys_addr_t src, int len);
 
 	void (*ipa_dma_destroy)(void);
@@ -111,8 +111,12 @@ static struct dentry *dfile_ntn_stats;
 static struct dentry *dfile_dbg_cnt;
 static struct dentry *dfile_msg;
 static struct dentry *dfile_ip4_nat;
+static struct dentry *dfile_ip4_nat_occupancy;
 static struct dentry *dfile_rm_stats;
 static struct dentry *dfile_status_stats;
+static struct dentry *dfile_tx_db_stats;
+static struct dentry *dfile_fltrt_commit_stats;
+static struct dentry *dfile_dp_stats;
 static struct dentry *dfile_active_clients;
 static char dbg_buff[IPA_MAX_MSG_LEN];
 static char *active_clients_buf;
@@ -1023,6 +1027,8 @@ static ssize_t ipa3_read_stats(struct file *file, char __user *ubuf,
 		"wan_repl_rx_empty=%u\n"
 		"lan_rx_empty=%u\n"
 		"lan_repl_rx_empty=%u\n"
+		"wan_rx_page_recycled=%u\n"
+		"wan_rx_page_alloc=%u\n"
 		"flow_enable=%u\n"
 		"flow_disable=%u\n",
 		ipa3_ctx->stats.tx_sw_pkts,
@@ -1039,6 +1045,8 @@ static ssize_t ipa3_read_stats(struct file *file, char __user *ubuf,
 		ipa3_ctx->stats.wan_repl_rx_empty,
 		ipa3_ctx->stats.lan_rx_empty,
 		ipa3_ctx->stats.lan_repl_rx_empty,
+		ipa3_ctx->stats.wan_rx_page_recycled,
+		ipa3_ctx->stats.wan_rx_page_alloc,
 		ipa3_ctx->stats.flow_enable,
 		ipa3_ctx->stats.flow_disable);
 	cnt += nbytes;
@@ -1468,6 +1476,25 @@ static ssize_t ipa3_read_msg(struct file *file, char __user *ubuf,
 	return simple_read_from_buffer(ubuf, count, ppos, dbg_buff, cnt);
 }
 
+static ssize_t ipa3_read_nat4_occupancy(struct file *file,
+		char __user *ubuf, size_t count, loff_t *ppos)
+{
+	struct ipa3_nat_occupancy occ;
+	int nbytes;
+
+	if (ipa3_nat_get_occupancy(&occ))
+		nbytes = scnprintf(dbg_buff, IPA_MAX_MSG_LEN,
+			"Not supported for local(shared) memory\n");
+	else
+		nbytes = scnprintf(dbg_buff, IPA_MAX_MSG_LEN,
+			"base=%u/%u expn=%u/%u expn_peak=%u\n",
+			occ.base_used, occ.base_entries,
+			occ.expn_used, occ.expn_entries,
+			occ.expn_used_peak);
+
+	return simple_read_from_buffer(ubuf, count, ppos, dbg_buff, nbytes);
+}
+
 static ssize_t ipa3_read_nat4(struct file *file,
 		char __user *ubuf, size_t count,
 		loff_t *ppos) {
@@ -1727,6 +1754,117 @@ static ssize_t ipa_status_stats_read(struct file *file, char __user *ubuf,
 	return 0;
 }
 
+static ssize_t ipa3_read_tx_db_stats(struct file *file, char __user *ubuf,
+		size_t count, loff_t *ppos)
+{
+	struct ipa3_ep_context *ep;
+	struct ipa3_tx_db_stats stats;
+	int nbytes;
+	int cnt = 0;
+	int i;
+
+	for (i = 0; i < ipa3_ctx->ipa_num_pipes; i++) {
+		ep = &ipa3_ctx->ep[i];
+		if (!ep->valid || !ep->sys || !IPA_CLIENT_IS_PROD(ep->client))
+			continue;
+
+		spin_lock_bh(&ep->sys->spinlock);
+		stats = ep->sys->tx_db_stats;
+		spin_unlock_bh(&ep->sys->spinlock);
+
+		nbytes = scnprintf(dbg_buff + cnt, IPA_MAX_MSG_LEN - cnt,
+			"ep=%d client=%s xfers=%u deferred=%u timer_flush=%u batch_max=%u\n",
+			i, ipa_clients_strings[ep->client], stats.xfers,
+			stats.deferred, stats.timer_flush, stats.batch_max);
+		cnt += nbytes;
+	}
+
+	return simple_read_from_buffer(ubuf, count, ppos, dbg_buff, cnt);
+}
+
+static int ipa3_print_dp_lat_hist(const char *name,
+	const struct ipa3_dp_stats *stats, enum ipa3_dp_lat_stage stage,
+	int cnt)
+{
+	int i;
+
+	cnt += scnprintf(dbg_buff + cnt, IPA_MAX_MSG_LEN - cnt,
+		"  %s max_us=%u:", name, stats->lat_max_us[stage]);
+	for (i = 0; i < IPA3_DP_LAT_BUCKETS; i++)
+		cnt += scnprintf(dbg_buff + cnt, IPA_MAX_MSG_LEN - cnt,
+			" %u", stats->lat_hist[stage][i]);
+	cnt += scnprintf(dbg_buff + cnt, IPA_MAX_MSG_LEN - cnt, "\n");
+
+	return cnt;
+}
+
+static ssize_t ipa3_read_dp_stats(struct file *file, char __user *ubuf,
+		size_t count, loff_t *ppos)
+{
+	struct ipa3_ep_context *ep;
+	struct ipa3_dp_stats stats;
+	int cnt;
+	int i;
+
+	cnt = scnprintf(dbg_buff, IPA_MAX_MSG_LEN,
+		"latency %s, buckets are <1us then [2^(n-1), 2^n) us\n",
+		ipa3_ctx->dp_lat_enable ? "enabled" : "disabled");
+
+	for (i = 0; i < ipa3_ctx->ipa_num_pipes; i++) {
+		ep = &ipa3_ctx->ep[i];
+		if (!ep->valid || !ep->sys || !IPA_CLIENT_IS_CONS(ep->client))
+			continue;
+
+		spin_lock_bh(&ep->sys->spinlock);
+		stats = ep->sys->dp_stats;
+		spin_unlock_bh(&ep->sys->spinlock);
+
+		cnt += scnprintf(dbg_buff + cnt, IPA_MAX_MSG_LEN - cnt,
+			"ep=%d client=%s frames=%u aggr_close_status=%u aggr_close_byte=%u aggr_close_force=%u repl_starved=%u repl_retry=%u\n",
+			i, ipa_clients_strings[ep->client], stats.aggr_frames,
+			stats.aggr_close_status, stats.aggr_close_byte,
+			stats.aggr_close_force, stats.repl_starved,
+			stats.repl_retry);
+		cnt = ipa3_print_dp_lat_hist("drv", &stats, IPA3_DP_LAT_DRV,
+			cnt);
+		cnt = ipa3_print_dp_lat_hist("netif", &stats,
+			IPA3_DP_LAT_NETIF, cnt);
+	}
+
+	return simple_read_from_buffer(ubuf, count, ppos, dbg_buff, cnt);
+}
+
+static int ipa3_print_fltrt_commit_stats(const char *name,
+	const struct ipa3_fltrt_commit_stats *stats, int cnt)
+{
+	int i;
+
+	for (i = 0; i < IPA_IP_MAX; i++)
+		cnt += scnprintf(dbg_buff + cnt, IPA_MAX_MSG_LEN - cnt,
+			"%s v%d: commits=%u nop=%u parts_skipped=%u hash_flush=%u bytes=%llu last_us=%u max_us=%u\n",
+			name, i == IPA_IP_v4 ? 4 : 6, stats[i].commits,
+			stats[i].nop_commits, stats[i].parts_skipped,
+			stats[i].hash_flush, stats[i].bytes_written,
+			stats[i].last_us, stats[i].max_us);
+
+	return cnt;
+}
+
+static ssize_t ipa3_read_fltrt_commit_stats(struct file *file,
+		char __user *ubuf, size_t count, loff_t *ppos)
+{
+	int cnt = 0;
+
+	mutex_lock(&ipa3_ctx->lock);
+	cnt = ipa3_print_fltrt_commit_stats("rt",
+		ipa3_ctx->rt_commit_stats, cnt);
+	cnt = ipa3_print_fltrt_commit_stats("flt",
+		ipa3_ctx->flt_commit_stats, cnt);
+	mutex_unlock(&ipa3_ctx->lock);
+
+	return simple_read_from_buffer(ubuf, count, ppos, dbg_buff, cnt);
+}
+
 static ssize_t ipa3_print_active_clients_log(struct file *file,
 		char __user *ubuf, size_t count, loff_t *ppos)
 {
@@ -1881,10 +2019,26 @@ const struct file_operations ipa3_status_stats_ops = {
 	.read = ipa_status_stats_read,
 };
 
+const struct file_operations ipa3_tx_db_stats_ops = {
+	.read = ipa3_read_tx_db_stats,
+};
+
+const struct file_operations ipa3_dp_stats_ops = {
+	.read = ipa3_read_dp_stats,
+};
+
+const struct file_operations ipa3_fltrt_commit_stats_ops = {
+	.read = ipa3_read_fltrt_commit_stats,
+};
+
 const struct file_operations ipa3_nat4_ops = {
 	.read = ipa3_read_nat4,
 };
 
+const struct file_operations ipa3_nat4_occupancy_ops = {
+	.read = ipa3_read_nat4_occupancy,
+};
+
 const struct file_operations ipa3_rm_stats = {
 	.read = ipa3_rm_read_stats,
 };
@@ -2080,6 +2234,13 @@ void ipa3_debugfs_init(void)
 		goto fail;
 	}
 
+	dfile_ip4_nat_occupancy = debugfs_create_file("ip4_nat_occupancy",
+			read_only_mode, dent, 0, &ipa3_nat4_occupancy_ops);
+	if (!dfile_ip4_nat_occupancy || IS_ERR(dfile_ip4_nat_occupancy)) {
+		IPAERR("fail to create file for debug_fs ip4 nat occupancy\n");
+		goto fail;
+	}
+
 	dfile_rm_stats = debugfs_create_file("rm_stats",
 			read_only_mode, dent, 0, &ipa3_rm_stats);
 	if (!dfile_rm_stats || IS_ERR(dfile_rm_stats)) {
@@ -2094,6 +2255,34 @@ void ipa3_debugfs_init(void)
 		goto fail;
 	}
 
+	dfile_tx_db_stats = debugfs_create_file("tx_db_stats",
+			read_only_mode, dent, 0, &ipa3_tx_db_stats_ops);
+	if (!dfile_tx_db_stats || IS_ERR(dfile_tx_db_stats)) {
+		IPAERR("fail to create file for debug_fs tx_db_stats\n");
+		goto fail;
+	}
+
+	dfile_fltrt_commit_stats = debugfs_create_file("fltrt_commit_stats",
+			read_only_mode, dent, 0, &ipa3_fltrt_commit_stats_ops);
+	if (!dfile_fltrt_commit_stats || IS_ERR(dfile_fltrt_commit_stats)) {
+		IPAERR("fail to create file for debug_fs fltrt_commit_stats\n");
+		goto fail;
+	}
+
+	dfile_dp_stats = debugfs_create_file("dp_stats",
+			read_only_mode, dent, 0, &ipa3_dp_stats_ops);
+	if (!dfile_dp_stats || IS_ERR(dfile_dp_stats)) {
+		IPAERR("fail to create file for debug_fs dp_stats\n");
+		goto fail;
+	}
+
+	file = debugfs_create_u32("enable_dp_latency", read_write_mode,
+		dent, &ipa3_ctx->dp_lat_enable);
+	if (!file) {
+		IPAERR("could not create enable_dp_latency file\n");
+		goto fail;
+	}
+
 	file = debugfs_create_u32("enable_clock_scaling", read_write_mode,
 		dent, &ipa3_ctx->enable_clock_scaling);
 	if (!file) {
@@ -32,6 +32,7 @@
 	sizeof(struct sps_iovec) - 1)
 #define IPA_DMA_MAX_PENDING_ASYNC (IPA_DMA_SYS_DESC_MAX_FIFO_SZ / \
 	sizeof(struct sps_iovec) - 1)
+#define IPA_DMA_MAX_BATCH 64
 
 #define IPADMA_DRV_NAME "ipa_dma"
 
@@ -98,6 +99,7 @@ static void ipa3_dma_debugfs_destroy(void) {}
  * @total_sync_memcpy: total number of sync memcpy (statistics)
  * @total_async_memcpy: total number of async memcpy (statistics)
  * @total_uc_memcpy: total number of uc memcpy (statistics)
+ * @total_async_memcpy_batch: total number of async memcpy batches (statistics)
  */
 struct ipa3_dma_ctx {
 	unsigned enable_ref_cnt;
@@ -118,6 +120,7 @@ struct ipa3_dma_ctx {
 	atomic_t total_sync_memcpy;
 	atomic_t total_async_memcpy;
 	atomic_t total_uc_memcpy;
+	atomic_t total_async_memcpy_batch;
 	struct ipa_mem_buffer ipa_dma_dummy_src_sync;
 	struct ipa_mem_buffer ipa_dma_dummy_dst_sync;
 	struct ipa_mem_buffer ipa_dma_dummy_src_async;
@@ -1032,6 +1035,272 @@ fail_mem_alloc:
 	return res;
 }
 
+static void ipa3_dma_fill_xfer_elem(struct gsi_xfer_elem *xfer_elem,
+	u64 addr, u16 len, u16 flags, void *xfer_user_data)
+{
+	xfer_elem->addr = addr;
+	xfer_elem->len = len;
+	xfer_elem->type = GSI_XFER_ELEM_DATA;
+	xfer_elem->flags = flags;
+	xfer_elem->xfer_user_data = xfer_user_data;
+}
+
+/**
+ * ipa3_dma_async_memcpy_batch()- Perform a batch of asynchronous memcpy
+ * operations using IPA.
+ *
+ * @descs: copies to perform.
+ * @num: number of copies in @descs, up to IPA_DMA_MAX_BATCH.
+ * @user_cb: callback function to notify the client when all the copies
+ *	were done.
+ * @user_param: cookie for user_cb.
+ *
+ * All the copies are queued at once, with a single doorbell per channel,
+ * and the client is notified once, when the last copy completes.
+ *
+ * Return codes: 0: success
+ *		-EINVAL: invalid params
+ *		-EPERM: operation not permitted as ipa_dma isn't enable or
+ *			initialized
+ *		-ENOMEM: failed to allocate the batch
+ *		-SPS_ERROR: on sps faliures
+ *		-EFAULT: descr fifo is full.
+ */
+int ipa3_dma_async_memcpy_batch(const struct ipa_dma_memcpy_desc *descs,
+		int num, void (*user_cb)(void *user1), void *user_param)
+{
+	int ep_idx;
+	int res = 0;
+	int i;
+	int num_cons = 0;
+	int num_prod = 0;
+	u64 dest, src;
+	u64 dummy_dst, dummy_src;
+	int len;
+	struct ipa3_dma_xfer_wrapper **xfer_descr;
+	struct ipa3_sys_context *prod_sys;
+	struct ipa3_sys_context *cons_sys;
+	struct gsi_xfer_elem *xfer_elem_cons = NULL;
+	struct gsi_xfer_elem *xfer_elem_prod = NULL;
+	unsigned long flags;
+
+	IPADMA_FUNC_ENTRY();
+	if (ipa3_dma_ctx == NULL) {
+		IPADMA_ERR("IPADMA isn't initialized, can't memcpy\n");
+		return -EPERM;
+	}
+	if (!descs || num <= 0 || num > IPA_DMA_MAX_BATCH) {
+		IPADMA_ERR("invalid batch, num %d\n", num);
+		return -EINVAL;
+	}
+	for (i = 0; i < num; i++) {
+		dest = descs[i].dest;
+		src = descs[i].src;
+		len = descs[i].len;
+		IPADMA_DBG_LOW("%d: dest = 0x%llx, src = 0x%llx, len = %d\n",
+			i, dest, src, len);
+		if ((max(src, dest) - min(src, dest)) < len) {
+			IPADMA_ERR("invalid addresses - overlapping buffers\n");
+			return -EINVAL;
+		}
+		if (len > IPA_DMA_MAX_PKT_SZ || len <= 0) {
+			IPADMA_ERR("invalid len, %d\n", len);
+			return -EINVAL;
+		}
+		if (ipa3_ctx->transport_prototype != IPA_TRANSPORT_TYPE_GSI &&
+			(((u32)src != src) || ((u32)dest != dest))) {
+			IPADMA_ERR(
+				"Bad addr - only 32b addr supported for BAM");
+			return -EINVAL;
+		}
+	}
+	if (!user_cb) {
+		IPADMA_ERR("null pointer: user_cb\n");
+		return -EINVAL;
+	}
+	spin_lock_irqsave(&ipa3_dma_ctx->pending_lock, flags);
+	if (!ipa3_dma_ctx->enable_ref_cnt) {
+		IPADMA_ERR("can't memcpy, IPA_DMA isn't enabled\n");
+		spin_unlock_irqrestore(&ipa3_dma_ctx->pending_lock, flags);
+		return -EPERM;
+	}
+	atomic_add(num, &ipa3_dma_ctx->async_memcpy_pending_cnt);
+	spin_unlock_irqrestore(&ipa3_dma_ctx->pending_lock, flags);
+
+	xfer_descr = kcalloc(num, sizeof(*xfer_descr), GFP_KERNEL);
+	if (!xfer_descr) {
+		IPADMA_ERR("failed to alloc xfer descr array\n");
+		res = -ENOMEM;
+		goto fail_pending;
+	}
+
+	if (ipa3_ctx->transport_prototype == IPA_TRANSPORT_TYPE_SPS) {
+		if (atomic_read(&ipa3_dma_ctx->async_memcpy_pending_cnt) >=
+				IPA_DMA_MAX_PENDING_ASYNC) {
+			IPADMA_ERR("Reached pending requests limit\n");
+			res = -EFAULT;
+			goto fail_mem_alloc;
+		}
+	}
+
+	ep_idx = ipa3_get_ep_mapping(IPA_CLIENT_MEMCPY_DMA_ASYNC_CONS);
+	if (-1 == ep_idx) {
+		IPADMA_ERR("Client %u is not mapped\n",
+			IPA_CLIENT_MEMCPY_DMA_ASYNC_CONS);
+		res = -EFAULT;
+		goto fail_mem_alloc;
+	}
+	cons_sys = ipa3_ctx->ep[ep_idx].sys;
+
+	ep_idx = ipa3_get_ep_mapping(IPA_CLIENT_MEMCPY_DMA_ASYNC_PROD);
+	if (-1 == ep_idx) {
+		IPADMA_ERR("Client %u is not mapped\n",
+			IPA_CLIENT_MEMCPY_DMA_ASYNC_PROD);
+		res = -EFAULT;
+		goto fail_mem_alloc;
+	}
+	prod_sys = ipa3_ctx->ep[ep_idx].sys;
+
+	for (i = 0; i < num; i++) {
+		xfer_descr[i] = kmem_cache_zalloc(
+			ipa3_dma_ctx->ipa_dma_xfer_wrapper_cache, GFP_KERNEL);
+		if (!xfer_descr[i]) {
+			IPADMA_ERR("failed to alloc xfrer descr wrapper\n");
+			res = -ENOMEM;
+			goto fail_mem_alloc;
+		}
+		xfer_descr[i]->phys_addr_dest = descs[i].dest;
+		xfer_descr[i]->phys_addr_src = descs[i].src;
+		xfer_descr[i]->len = descs[i].len;
+	}
+	/* only the last copy of the batch notifies the client */
+	xfer_descr[num - 1]->callback = user_cb;
+	xfer_descr[num - 1]->user1 = user_param;
+
+	if (ipa3_ctx->transport_prototype == IPA_TRANSPORT_TYPE_GSI) {
+		/* room for the dummy copies of the prefetch workaround */
+		xfer_elem_cons = kcalloc(2 * num, sizeof(*xfer_elem_cons),
+			GFP_KERNEL);
+		xfer_elem_prod = kcalloc(2 * num, sizeof(*xfer_elem_prod),
+			GFP_KERNEL);
+		if (!xfer_elem_cons || !xfer_elem_prod) {
+			IPADMA_ERR("failed to alloc xfer elements\n");
+			res = -ENOMEM;
+			goto fail_mem_alloc;
+		}
+
+		dummy_dst = ipa3_dma_ctx->ipa_dma_dummy_dst_async.phys_base;
+		dummy_src = ipa3_dma_ctx->ipa_dma_dummy_src_async.phys_base;
+		for (i = 0; i < num; i++) {
+			dest = descs[i].dest;
+			src = descs[i].src;
+			len = descs[i].len;
+			/*
+			 * when copy is less than 9B we need to chain another
+			 * dummy copy so the total size will be larger
+			 * (for ipav3.5)
+			 */
+			if ((ipa_get_hw_type() == IPA_HW_v3_5) && len <
+				IPA_DMA_PREFETCH_WA_THRESHOLD) {
+				ipa3_dma_fill_xfer_elem(
+					&xfer_elem_cons[num_cons++], dest, len,
+					GSI_XFER_FLAG_EOT, NULL);
+				ipa3_dma_fill_xfer_elem(
+					&xfer_elem_cons[num_cons++], dummy_dst,
+					IPA_DMA_DUMMY_BUFF_SZ,
+					GSI_XFER_FLAG_EOT, xfer_descr[i]);
+				ipa3_dma_fill_xfer_elem(
+					&xfer_elem_prod[num_prod++], src, len,
+					GSI_XFER_FLAG_CHAIN, NULL);
+				ipa3_dma_fill_xfer_elem(
+					&xfer_elem_prod[num_prod++], dummy_src,
+					IPA_DMA_DUMMY_BUFF_SZ,
+					GSI_XFER_FLAG_EOT, NULL);
+			} else {
+				ipa3_dma_fill_xfer_elem(
+					&xfer_elem_cons[num_cons++], dest, len,
+					GSI_XFER_FLAG_EOT, xfer_descr[i]);
+				ipa3_dma_fill_xfer_elem(
+					&xfer_elem_prod[num_prod++], src, len,
+					GSI_XFER_FLAG_EOT, NULL);
+			}
+		}
+	}
+
+	spin_lock_irqsave(&ipa3_dma_ctx->async_lock, flags);
+	for (i = 0; i < num; i++) {
+		list_add_tail(&xfer_descr[i]->link, &cons_sys->head_desc_list);
+		cons_sys->len++;
+	}
+	if (ipa3_ctx->transport_prototype == IPA_TRANSPORT_TYPE_GSI) {
+		res = gsi_queue_xfer(cons_sys->ep->gsi_chan_hdl, num_cons,
+			xfer_elem_cons, true);
+		if (res) {
+			IPADMA_ERR("Failed: gsi_queue_xfer on dest descr res: %d\n",
+				res);
+			goto fail_send;
+		}
+		res = gsi_queue_xfer(prod_sys->ep->gsi_chan_hdl, num_prod,
+			xfer_elem_prod, true);
+		if (res) {
+			IPADMA_ERR("Failed: gsi_queue_xfer on src descr res: %d\n",
+				res);
+			ipa_assert();
+			goto fail_send;
+		}
+	} else {
+		for (i = 0; i < num; i++) {
+			res = sps_transfer_one(cons_sys->ep->ep_hdl,
+				descs[i].dest, descs[i].len, xfer_descr[i], 0);
+			if (res) {
+				IPADMA_ERR(
+					"Failed: sps_transfer_one on dest descr\n");
+				if (i)
+					BUG();
+				goto fail_send;
+			}
+			res = sps_transfer_one(prod_sys->ep->ep_hdl,
+				descs[i].src, descs[i].len, NULL,
+				SPS_IOVEC_FLAG_EOT);
+			if (res) {
+				IPADMA_ERR(
+					"Failed: sps_transfer_one on src descr\n");
+				BUG();
+				goto fail_send;
+			}
+		}
+	}
+	spin_unlock_irqrestore(&ipa3_dma_ctx->async_lock, flags);
+	atomic_inc(&ipa3_dma_ctx->total_async_memcpy_batch);
+
+	kfree(xfer_elem_prod);
+	kfree(xfer_elem_cons);
+	kfree(xfer_descr);
+	IPADMA_FUNC_EXIT();
+	return res;
+
+fail_send:
+	for (i = 0; i < num; i++) {
+		list_del(&xfer_descr[i]->link);
+		cons_sys->len--;
+	}
+	spin_unlock_irqrestore(&ipa3_dma_ctx->async_lock, flags);
+fail_mem_alloc:
+	kfree(xfer_elem_prod);
+	kfree(xfer_elem_cons);
+	for (i = 0; i < num; i++)
+		if (xfer_descr[i])
+			kmem_cache_free(
+				ipa3_dma_ctx->ipa_dma_xfer_wrapper_cache,
+				xfer_descr[i]);
+	kfree(xfer_descr);
+fail_pending:
+	atomic_sub(num, &ipa3_dma_ctx->async_memcpy_pending_cnt);
+	if (ipa3_dma_ctx->destroy_pending && !ipa3_dma_work_pending())
+			complete(&ipa3_dma_ctx->done);
+	return res;
+}
+
 /**
  * ipa3_dma_uc_memcpy() - Perform a memcpy action using IPA uC
  * @dest: physical address to store the copied data.
@@ -1201,7 +1470,8 @@ void ipa3_dma_async_memcpy_notify_cb(void *priv
 	}
 	atomic_inc(&ipa3_dma_ctx->total_async_memcpy);
 	atomic_dec(&ipa3_dma_ctx->async_memcpy_pending_cnt);
-	xfer_descr_expected->callback(xfer_descr_expected->user1);
+	if (xfer_descr_expected->callback)
+		xfer_descr_expected->callback(xfer_descr_expected->user1);
 
 	kmem_cache_free(ipa3_dma_ctx->ipa_dma_xfer_wrapper_cache,
 		xfer_descr_expected);
@@ -1257,6 +1527,10 @@ static ssize_t ipa3_dma_debugfs_read(struct file *file, char __user *ubuf,
 			IPADMA_MAX_MSG_LEN - nbytes,
 			"total uc memcpy: %d\n	",
 			atomic_read(&ipa3_dma_ctx->total_uc_memcpy));
+		nbytes += scnprintf(&dbg_buff[nbytes],
+			IPADMA_MAX_MSG_LEN - nbytes,
+			"total async memcpy batches: %d\n	",
+			atomic_read(&ipa3_dma_ctx->total_async_memcpy_batch));
 		nbytes += scnprintf(&dbg_buff[nbytes],
 			IPADMA_MAX_MSG_LEN - nbytes,
 			"pending sync memcpy jobs: %d\n	",
@@ -1300,6 +1574,7 @@ static ssize_t ipa3_dma_debugfs_reset_statistics(struct file *file,
 
 		atomic_set(&ipa3_dma_ctx->total_async_memcpy, 0);
 		atomic_set(&ipa3_dma_ctx->total_sync_memcpy, 0);
+		atomic_set(&ipa3_dma_ctx->total_async_memcpy_batch, 0);
 		break;
 	default:
 		IPADMA_ERR("invalid argument: To reset statistics echo 0\n");
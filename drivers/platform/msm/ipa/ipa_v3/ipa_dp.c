@@ -49,6 +49,9 @@
 
 #define IPA_RX_BUFF_CLIENT_HEADROOM 256
 
+/* pool entries inspected for a free page before allocating outside of it */
+#define IPA_RX_PAGE_MAX_SCAN 8
+
 #define IPA_WLAN_RX_POOL_SZ 100
 #define IPA_WLAN_RX_POOL_SZ_LOW_WM 5
 #define IPA_WLAN_RX_BUFF_SZ 2048
@@ -72,6 +75,10 @@
 
 #define IPA_TX_SEND_COMPL_NOP_DELAY_NS (2 * 1000 * 1000)
 
+/* deferred Tx doorbells are rung at the latest after this many xfers/ns */
+#define IPA_TX_DB_BATCH_MAX 32
+#define IPA_TX_DB_FLUSH_DELAY_NS (100 * 1000)
+
 static struct sk_buff *ipa3_get_skb_ipa_rx(unsigned int len, gfp_t flags);
 static void ipa3_replenish_wlan_rx_cache(struct ipa3_sys_context *sys);
 static void ipa3_replenish_rx_cache(struct ipa3_sys_context *sys);
@@ -89,6 +96,7 @@ static void ipa3_wq_rx_avail(struct work_struct *work);
 static void ipa3_alloc_wlan_rx_common_cache(u32 size);
 static void ipa3_cleanup_wlan_rx_common_cache(void);
 static void ipa3_wq_repl_rx(struct work_struct *work);
+static int ipa3_rx_page_pool_init(struct ipa3_sys_context *sys);
 static void ipa3_dma_memcpy_notify(struct ipa3_sys_context *sys,
 		struct ipa_mem_buffer *mem_info);
 static int ipa_gsi_setup_channel(struct ipa_sys_connect_params *in,
@@ -402,6 +410,7 @@ int ipa3_send(struct ipa3_sys_context *sys,
 	int result;
 	u32 mem_flag = GFP_ATOMIC;
 	const struct ipa_gsi_ep_config *gsi_ep_cfg;
+	bool ring_db = true;
 
 	if (unlikely(!in_atomic))
 		mem_flag = GFP_KERNEL;
@@ -457,6 +466,8 @@ int ipa3_send(struct ipa3_sys_context *sys,
 		}
 
 		tx_pkt->type = desc[i].type;
+		if (desc[i].skip_db_ring)
+			ring_db = false;
 
 		if (desc[i].type != IPA_DATA_DESC_SKB_PAGED) {
 			tx_pkt->mem.base = desc[i].pyld;
@@ -532,17 +543,37 @@ int ipa3_send(struct ipa3_sys_context *sys,
 		}
 	}
 
+	if (!ring_db && sys->tx_db_pending + 1 >= IPA_TX_DB_BATCH_MAX)
+		ring_db = true;
+
 	IPADBG_LOW("ch:%lu queue xfer\n", sys->ep->gsi_chan_hdl);
 	result = gsi_queue_xfer(sys->ep->gsi_chan_hdl, num_desc,
-			gsi_xfer_elem_array, true);
+			gsi_xfer_elem_array, ring_db);
 	if (result != GSI_STATUS_SUCCESS) {
 		IPAERR("GSI xfer failed.\n");
 		goto failure;
 	}
 
+	sys->tx_db_stats.xfers++;
+	if (ring_db) {
+		/* the doorbell also covers all the deferred xfers */
+		if (sys->tx_db_pending + 1 > sys->tx_db_stats.batch_max)
+			sys->tx_db_stats.batch_max = sys->tx_db_pending + 1;
+		sys->tx_db_pending = 0;
+	} else {
+		sys->tx_db_stats.deferred++;
+		sys->tx_db_pending++;
+	}
+
 	kfree(gsi_xfer_elem_array);
 	spin_unlock_bh(&sys->spinlock);
 
+	/* set the timer for ringing the deferred doorbell */
+	if (!ring_db && !hrtimer_active(&sys->tx_db_timer))
+		hrtimer_start(&sys->tx_db_timer,
+			ktime_set(0, IPA_TX_DB_FLUSH_DELAY_NS),
+			HRTIMER_MODE_REL);
+
 	/* set the timer for sending the NOP descriptor */
 	if (sys->use_comm_evt_ring && !hrtimer_active(&sys->db_timer)) {
 		ktime_t time = ktime_set(0, IPA_TX_SEND_COMPL_NOP_DELAY_NS);
@@ -900,64 +931,95 @@ static int ipa3_handle_rx_core(struct ipa3_sys_context *sys, bool process_all,
 }
 
 /**
- * ipa3_rx_switch_to_intr_mode() - Operate the Rx data path in interrupt mode
+ * __ipa3_rx_switch_to_intr_mode() - Operate the Rx data path in interrupt mode
+ *
+ * Return codes: 0 on success, negative on failure in which case the pipe is
+ * left in polling mode and the caller is responsible for retrying
  */
-static void ipa3_rx_switch_to_intr_mode(struct ipa3_sys_context *sys)
+static int __ipa3_rx_switch_to_intr_mode(struct ipa3_sys_context *sys)
 {
 	int ret;
 
 	if (ipa3_ctx->transport_prototype == IPA_TRANSPORT_TYPE_GSI) {
 		if (!atomic_read(&sys->curr_polling_state)) {
 			IPAERR("already in intr mode\n");
-			goto fail;
+			return -EINVAL;
 		}
 		atomic_set(&sys->curr_polling_state, 0);
-		ipa3_dec_release_wakelock();
 		ret = gsi_config_channel_mode(sys->ep->gsi_chan_hdl,
 			GSI_CHAN_MODE_CALLBACK);
 		if (ret != GSI_STATUS_SUCCESS) {
 			IPAERR("Failed to switch to intr mode.\n");
-			goto fail;
+			atomic_set(&sys->curr_polling_state, 1);
+			return -EFAULT;
 		}
+		ipa3_dec_release_wakelock();
 	} else {
 		ret = sps_get_config(sys->ep->ep_hdl, &sys->ep->connect);
 		if (ret) {
 			IPAERR("sps_get_config() failed %d\n", ret);
-			goto fail;
+			return ret;
 		}
 		if (!atomic_read(&sys->curr_polling_state) &&
 			((sys->ep->connect.options & SPS_O_EOT) == SPS_O_EOT)) {
 			IPADBG("already in intr mode\n");
-			return;
+			return 0;
 		}
 		if (!atomic_read(&sys->curr_polling_state)) {
 			IPAERR("already in intr mode\n");
-			goto fail;
+			return -EINVAL;
 		}
 		sys->event.options = SPS_O_EOT;
 		ret = sps_register_event(sys->ep->ep_hdl, &sys->event);
 		if (ret) {
 			IPAERR("sps_register_event() failed %d\n", ret);
-			goto fail;
+			return ret;
 		}
 		sys->ep->connect.options =
 			SPS_O_AUTO_ENABLE | SPS_O_ACK_TRANSFERS | SPS_O_EOT;
 		ret = sps_set_config(sys->ep->ep_hdl, &sys->ep->connect);
 		if (ret) {
 			IPAERR("sps_set_config() failed %d\n", ret);
-			goto fail;
+			return ret;
 		}
 		atomic_set(&sys->curr_polling_state, 0);
 		ipa3_handle_rx_core(sys, true, false);
 		ipa3_dec_release_wakelock();
 	}
-	return;
 
-fail:
-	queue_delayed_work(sys->wq, &sys->switch_to_intr_work,
+	return 0;
+}
+
+static void ipa3_rx_switch_to_intr_mode(struct ipa3_sys_context *sys)
+{
+	if (__ipa3_rx_switch_to_intr_mode(sys))
+		queue_delayed_work(sys->wq, &sys->switch_to_intr_work,
 			msecs_to_jiffies(1));
 }
 
+/**
+ * ipa3_rx_start_poll() - Hand a pipe which just entered polling mode to its
+ * poller
+ *
+ * NAPI enabled pipes are polled by the client, which holds an IPA clock vote
+ * for as long as its poll cycle lasts. If the vote cannot be taken from this
+ * atomic context, fall back to the IPA driver's polling work.
+ */
+static void ipa3_rx_start_poll(struct ipa3_sys_context *sys)
+{
+	struct ipa_active_client_logging_info log_info;
+
+	if (sys->ep->napi_enabled) {
+		IPA_ACTIVE_CLIENTS_PREP_SIMPLE(log_info);
+		if (!ipa3_inc_client_enable_clks_no_block(&log_info)) {
+			sys->ep->client_notify(sys->ep->priv,
+				IPA_CLIENT_START_POLL, 0);
+			return;
+		}
+	}
+	queue_work(sys->wq, &sys->work);
+}
+
 /**
  * ipa_rx_notify() - Callback function which is called by the SPS driver when a
  * a packet is received
@@ -1000,7 +1062,7 @@ static void ipa3_sps_irq_rx_notify(struct sps_event_notify *notify)
 			ipa3_inc_acquire_wakelock();
 			atomic_set(&sys->curr_polling_state, 1);
 			trace_intr_to_poll3(sys->ep->client);
-			queue_work(sys->wq, &sys->work);
+			ipa3_rx_start_poll(sys);
 		}
 		break;
 	default:
@@ -1073,6 +1135,63 @@ static void ipa3_switch_to_intr_rx_work_func(struct work_struct *work)
 	ipa3_handle_rx(sys);
 }
 
+static void ipa3_napi_clk_work_func(struct work_struct *work)
+{
+	/* drop the clock vote taken in ipa3_rx_start_poll() */
+	IPA_ACTIVE_CLIENTS_DEC_SIMPLE();
+}
+
+/**
+ * ipa3_rx_poll() - Poll the Rx pipe from the client's NAPI context
+ * @clnt_hdl:	[in] opaque client handle assigned by IPA to client
+ * @budget:	[in] maximal number of packets to process
+ *
+ * Processes up to @budget packets. If the pipe drained before the budget was
+ * consumed it is switched back to interrupt mode and the client is told to
+ * complete its NAPI. Must be called only after IPA_CLIENT_START_POLL.
+ *
+ * Returns: number of packets processed, or @budget if the pipe has to be
+ * polled again
+ */
+int ipa3_rx_poll(u32 clnt_hdl, int budget)
+{
+	struct ipa3_ep_context *ep;
+	int cnt = 0;
+	int ret;
+
+	if (clnt_hdl >= ipa3_ctx->ipa_num_pipes ||
+	    ipa3_ctx->ep[clnt_hdl].valid == 0) {
+		IPAERR("bad parm 0x%x\n", clnt_hdl);
+		return 0;
+	}
+	ep = &ipa3_ctx->ep[clnt_hdl];
+
+	while (cnt < budget && atomic_read(&ep->sys->curr_polling_state)) {
+		ret = ipa3_handle_rx_core(ep->sys, false, true);
+		if (ret == 0)
+			break;
+		cnt += ret;
+	}
+
+	if (cnt >= budget)
+		return budget;
+
+	trace_poll_to_intr3(ep->client);
+	if (__ipa3_rx_switch_to_intr_mode(ep->sys))
+		return budget;
+
+	ep->client_notify(ep->priv, IPA_CLIENT_COMP_NAPI, 0);
+	/*
+	 * an interrupt may have re-armed polling before NAPI completed, in
+	 * which case its schedule request was lost; reuse its clock vote
+	 */
+	if (atomic_read(&ep->sys->curr_polling_state))
+		ep->client_notify(ep->priv, IPA_CLIENT_START_POLL, 0);
+	queue_work(ep->sys->wq, &ep->sys->napi_clk_work);
+
+	return cnt;
+}
+
 enum hrtimer_restart ipa3_ring_doorbell_timer_fn(struct hrtimer *param)
 {
 	struct ipa3_sys_context *sys = container_of(param,
@@ -1082,6 +1201,36 @@ enum hrtimer_restart ipa3_ring_doorbell_timer_fn(struct hrtimer *param)
 	return HRTIMER_NORESTART;
 }
 
+static enum hrtimer_restart ipa3_tx_db_timer_fn(struct hrtimer *param)
+{
+	struct ipa3_sys_context *sys = container_of(param,
+		struct ipa3_sys_context, tx_db_timer);
+
+	queue_work(sys->wq, &sys->tx_db_work);
+	return HRTIMER_NORESTART;
+}
+
+/**
+ * ipa3_tx_db_work_func() - Ring the Tx doorbell left deferred by the last
+ * burst, in case the sender did not follow up with a final xfer
+ * @work: work struct
+ */
+static void ipa3_tx_db_work_func(struct work_struct *work)
+{
+	struct ipa3_sys_context *sys = container_of(work,
+		struct ipa3_sys_context, tx_db_work);
+
+	spin_lock_bh(&sys->spinlock);
+	if (sys->tx_db_pending) {
+		gsi_start_xfer(sys->ep->gsi_chan_hdl);
+		if (sys->tx_db_pending > sys->tx_db_stats.batch_max)
+			sys->tx_db_stats.batch_max = sys->tx_db_pending;
+		sys->tx_db_pending = 0;
+		sys->tx_db_stats.timer_flush++;
+	}
+	spin_unlock_bh(&sys->spinlock);
+}
+
 /**
  * ipa3_setup_sys_pipe() - Setup an IPA end-point in system-BAM mode and perform
  * IPA EP configuration
@@ -1171,6 +1320,9 @@ int ipa3_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl)
 		hrtimer_init(&ep->sys->db_timer, CLOCK_MONOTONIC,
 			HRTIMER_MODE_REL);
 		ep->sys->db_timer.function = ipa3_ring_doorbell_timer_fn;
+		hrtimer_init(&ep->sys->tx_db_timer, CLOCK_MONOTONIC,
+			HRTIMER_MODE_REL);
+		ep->sys->tx_db_timer.function = ipa3_tx_db_timer_fn;
 	} else {
 		memset(ep->sys, 0, offsetof(struct ipa3_sys_context, ep));
 	}
@@ -1187,6 +1339,8 @@ int ipa3_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl)
 	ep->client_notify = sys_in->notify;
 	ep->priv = sys_in->priv;
 	ep->keep_ipa_awake = sys_in->keep_ipa_awake;
+	ep->napi_enabled = sys_in->napi_enabled &&
+		sys_in->client == IPA_CLIENT_APPS_WAN_CONS;
 	atomic_set(&ep->avail_fifo_desc,
 		((sys_in->desc_fifo_sz/sizeof(struct sps_iovec))-1));
 
@@ -1310,6 +1464,10 @@ int ipa3_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl)
 		} else {
 			atomic_set(&ep->sys->repl.head_idx, 0);
 			atomic_set(&ep->sys->repl.tail_idx, 0);
+			if (ep->client == IPA_CLIENT_APPS_WAN_CONS &&
+			    ipa3_rx_page_pool_init(ep->sys))
+				IPAERR("ep=%d fail to alloc rx page pool\n",
+					ipa_ep_idx);
 			ipa3_wq_repl_rx(&ep->sys->repl_work);
 		}
 	}
@@ -1407,6 +1565,8 @@ int ipa3_teardown_sys_pipe(u32 clnt_hdl)
 
 	if (IPA_CLIENT_IS_CONS(ep->client))
 		cancel_delayed_work_sync(&ep->sys->replenish_rx_work);
+	else
+		hrtimer_cancel(&ep->sys->tx_db_timer);
 	flush_workqueue(ep->sys->wq);
 	if (ipa3_ctx->transport_prototype == IPA_TRANSPORT_TYPE_GSI) {
 		/* channel stop might fail on timeout if IPA is busy */
@@ -1679,6 +1839,7 @@ int ipa3_tx_dp(enum ipa_client_type dst, struct sk_buff *skb,
 		desc[data_idx].type = IPA_DATA_DESC_SKB;
 		desc[data_idx].callback = ipa3_tx_comp_usr_notify_release;
 		desc[data_idx].user1 = skb;
+		desc[data_idx].skip_db_ring = meta && meta->xmit_more;
 		desc[data_idx].user2 = (meta && meta->pkt_init_dst_ep_valid &&
 				meta->pkt_init_dst_ep_remote) ?
 				src_ep_idx :
@@ -1731,6 +1892,7 @@ int ipa3_tx_dp(enum ipa_client_type dst, struct sk_buff *skb,
 		desc[data_idx].type = IPA_DATA_DESC_SKB;
 		desc[data_idx].callback = ipa3_tx_comp_usr_notify_release;
 		desc[data_idx].user1 = skb;
+		desc[data_idx].skip_db_ring = meta && meta->xmit_more;
 		desc[data_idx].user2 = src_ep_idx;
 
 		if (meta && meta->dma_address_valid) {
@@ -1790,6 +1952,177 @@ static void ipa3_wq_handle_rx(struct work_struct *work)
 	ipa3_handle_rx(sys);
 }
 
+/**
+ * ipa3_rx_page_pool_init() - Allocate the Rx page pool of a pipe
+ * @sys:	[in] system pipe context, its Rx buffer size and replenish
+ *		cache must already be set
+ *
+ * The pool is sized to back every buffer that may sit in the pipe and in the
+ * replenish cache at once, pages are allocated lazily on first use.
+ *
+ * Return codes: 0 on success, -ENOMEM if the pool could not be allocated
+ */
+static int ipa3_rx_page_pool_init(struct ipa3_sys_context *sys)
+{
+	struct ipa3_page_recycle_ctx *pool = &sys->page_recycle;
+
+	pool->order = get_order(IPA_REAL_GENERIC_RX_BUFF_SZ(sys->rx_buff_sz));
+	pool->capacity = sys->repl.capacity + sys->rx_pool_sz;
+	pool->next = 0;
+	pool->cache = kcalloc(pool->capacity, sizeof(*pool->cache),
+		GFP_KERNEL);
+	if (!pool->cache) {
+		pool->capacity = 0;
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void ipa3_rx_page_pool_destroy(struct ipa3_sys_context *sys)
+{
+	struct ipa3_page_recycle_ctx *pool = &sys->page_recycle;
+	DEFINE_DMA_ATTRS(attrs);
+	u32 i;
+
+	if (!pool->cache)
+		return;
+
+	/* skbs still held by the stack own the CPU view of their page */
+	dma_set_attr(DMA_ATTR_SKIP_CPU_SYNC, &attrs);
+	for (i = 0; i < pool->capacity; i++) {
+		if (!pool->cache[i].page)
+			continue;
+		dma_unmap_single_attrs(ipa3_ctx->pdev, pool->cache[i].dma_addr,
+			PAGE_SIZE << pool->order, DMA_FROM_DEVICE, &attrs);
+		put_page(pool->cache[i].page);
+	}
+	kfree(pool->cache);
+	pool->cache = NULL;
+	pool->capacity = 0;
+}
+
+/**
+ * ipa3_rx_page_get() - Back an Rx packet wrapper with a DMA mapped page
+ * @sys:	[in] system pipe context
+ * @rx_pkt:	[in] Rx packet wrapper to fill
+ * @flag:	[in] allocation flags
+ *
+ * Reuses a pool page once the stack has released it, only syncing it back to
+ * the device. An empty pool entry is filled with a newly mapped page. If all
+ * the inspected entries are still in use the page is allocated and mapped for
+ * this packet alone, as for skb backed buffers.
+ *
+ * Return codes: 0 on success, -ENOMEM on allocation or mapping failure
+ */
+static int ipa3_rx_page_get(struct ipa3_sys_context *sys,
+	struct ipa3_rx_pkt_wrapper *rx_pkt, gfp_t flag)
+{
+	struct ipa3_page_recycle_ctx *pool = &sys->page_recycle;
+	struct ipa3_rx_page *entry = NULL;
+	struct page *page;
+	dma_addr_t dma_addr;
+	int idx = -1;
+	int i;
+
+	for (i = 0; i < IPA_RX_PAGE_MAX_SCAN && i < pool->capacity; i++) {
+		idx = pool->next;
+		pool->next = (pool->next + 1) % pool->capacity;
+		if (!pool->cache[idx].page ||
+		    page_count(pool->cache[idx].page) == 1) {
+			entry = &pool->cache[idx];
+			break;
+		}
+	}
+
+	if (entry && entry->page) {
+		page = entry->page;
+		dma_addr = entry->dma_addr;
+		dma_sync_single_range_for_device(ipa3_ctx->pdev, dma_addr,
+			NET_SKB_PAD, sys->rx_buff_sz, DMA_FROM_DEVICE);
+		get_page(page);
+		IPA_STATS_INC_CNT(ipa3_ctx->stats.wan_rx_page_recycled);
+		goto done;
+	}
+
+	page = alloc_pages(flag | __GFP_COMP | __GFP_NOWARN, pool->order);
+	if (!page)
+		return -ENOMEM;
+	dma_addr = dma_map_single(ipa3_ctx->pdev, page_address(page),
+		PAGE_SIZE << pool->order, DMA_FROM_DEVICE);
+	if (dma_mapping_error(ipa3_ctx->pdev, dma_addr)) {
+		__free_pages(page, pool->order);
+		return -ENOMEM;
+	}
+	IPA_STATS_INC_CNT(ipa3_ctx->stats.wan_rx_page_alloc);
+
+	if (entry) {
+		entry->page = page;
+		entry->dma_addr = dma_addr;
+		get_page(page);
+	} else {
+		idx = -1;
+	}
+
+done:
+	rx_pkt->page = page;
+	rx_pkt->page_idx = idx;
+	rx_pkt->data.skb = NULL;
+	rx_pkt->data.dma_addr = dma_addr + NET_SKB_PAD;
+	return 0;
+}
+
+/**
+ * ipa3_rx_page_build_skb() - Wrap the buffer of a page backed Rx packet
+ * @sys:	[in] system pipe context
+ * @rx_pkt:	[in] received packet wrapper
+ *
+ * The skb takes over the page reference of the packet, so the page goes back
+ * to the pool once the stack frees the skb and all of its clones.
+ */
+static struct sk_buff *ipa3_rx_page_build_skb(struct ipa3_sys_context *sys,
+	struct ipa3_rx_pkt_wrapper *rx_pkt)
+{
+	u32 frag_sz = PAGE_SIZE << sys->page_recycle.order;
+	dma_addr_t dma_addr = rx_pkt->data.dma_addr - NET_SKB_PAD;
+	struct sk_buff *skb;
+
+	if (rx_pkt->page_idx < 0)
+		dma_unmap_single(ipa3_ctx->pdev, dma_addr, frag_sz,
+			DMA_FROM_DEVICE);
+	else
+		dma_sync_single_range_for_cpu(ipa3_ctx->pdev, dma_addr,
+			NET_SKB_PAD, sys->rx_buff_sz, DMA_FROM_DEVICE);
+
+	skb = build_skb(page_address(rx_pkt->page), frag_sz);
+	if (unlikely(!skb)) {
+		put_page(rx_pkt->page);
+		return NULL;
+	}
+	skb_reserve(skb, NET_SKB_PAD);
+	skb_put(skb, sys->rx_buff_sz);
+
+	return skb;
+}
+
+static void ipa3_free_rx_buff(struct ipa3_sys_context *sys,
+	struct ipa3_rx_pkt_wrapper *rx_pkt)
+{
+	if (rx_pkt->page) {
+		if (rx_pkt->page_idx < 0)
+			dma_unmap_single(ipa3_ctx->pdev,
+				rx_pkt->data.dma_addr - NET_SKB_PAD,
+				PAGE_SIZE << sys->page_recycle.order,
+				DMA_FROM_DEVICE);
+		put_page(rx_pkt->page);
+		return;
+	}
+
+	dma_unmap_single(ipa3_ctx->pdev, rx_pkt->data.dma_addr,
+		sys->rx_buff_sz, DMA_FROM_DEVICE);
+	sys->free_skb(rx_pkt->data.skb);
+}
+
 static void ipa3_wq_repl_rx(struct work_struct *work)
 {
 	struct ipa3_sys_context *sys;
@@ -1820,6 +2153,15 @@ begin:
 		INIT_WORK(&rx_pkt->work, ipa3_wq_rx_avail);
 		rx_pkt->sys = sys;
 
+		if (sys->page_recycle.cache) {
+			if (ipa3_rx_page_get(sys, rx_pkt, flag)) {
+				pr_err_ratelimited("%s fail alloc page sys=%p\n",
+						__func__, sys);
+				goto fail_skb_alloc;
+			}
+			goto queue_pkt;
+		}
+
 		rx_pkt->data.skb = sys->get_skb(sys->rx_buff_sz, flag);
 		if (rx_pkt->data.skb == NULL) {
 			pr_err_ratelimited("%s fail alloc skb sys=%p\n",
@@ -1837,6 +2179,7 @@ begin:
 			goto fail_dma_mapping;
 		}
 
+queue_pkt:
 		sys->repl.cache[curr] = rx_pkt;
 		curr = next;
 		/* ensure write is done before setting tail index */
@@ -2134,9 +2477,11 @@ fail_dma_mapping:
 fail_skb_alloc:
 	kmem_cache_free(ipa3_ctx->rx_pkt_wrapper_cache, rx_pkt);
 fail_kmem_cache_alloc:
-	if (rx_len_cached - sys->len_pending_xfer == 0)
+	if (rx_len_cached - sys->len_pending_xfer == 0) {
+		IPA_STATS_INC_CNT(sys->dp_stats.repl_starved);
 		queue_delayed_work(sys->wq, &sys->replenish_rx_work,
 				msecs_to_jiffies(1));
+	}
 }
 
 static void ipa3_replenish_rx_cache_recycle(struct ipa3_sys_context *sys)
@@ -2254,9 +2599,11 @@ fail_dma_mapping:
 	INIT_LIST_HEAD(&rx_pkt->link);
 	spin_unlock_bh(&sys->spinlock);
 fail_kmem_cache_alloc:
-	if (rx_len_cached - sys->len_pending_xfer == 0)
+	if (rx_len_cached - sys->len_pending_xfer == 0) {
+		IPA_STATS_INC_CNT(sys->dp_stats.repl_starved);
 		queue_delayed_work(sys->wq, &sys->replenish_rx_work,
 		msecs_to_jiffies(1));
+	}
 }
 
 static void ipa3_fast_replenish_rx_cache(struct ipa3_sys_context *sys)
@@ -2332,6 +2679,7 @@ static void ipa3_fast_replenish_rx_cache(struct ipa3_sys_context *sys)
 			IPA_STATS_INC_CNT(ipa3_ctx->stats.lan_rx_empty);
 		else
 			WARN_ON(1);
+		IPA_STATS_INC_CNT(sys->dp_stats.repl_starved);
 		queue_delayed_work(sys->wq, &sys->replenish_rx_work,
 				msecs_to_jiffies(1));
 	}
@@ -2344,6 +2692,7 @@ static void ipa3_replenish_rx_work_func(struct work_struct *work)
 
 	dwork = container_of(work, struct delayed_work, work);
 	sys = container_of(dwork, struct ipa3_sys_context, replenish_rx_work);
+	IPA_STATS_INC_CNT(sys->dp_stats.repl_retry);
 	IPA_ACTIVE_CLIENTS_INC_SIMPLE();
 	sys->repl_hdlr(sys);
 	IPA_ACTIVE_CLIENTS_DEC_SIMPLE();
@@ -2363,9 +2712,7 @@ static void ipa3_cleanup_rx(struct ipa3_sys_context *sys)
 	list_for_each_entry_safe(rx_pkt, r,
 				 &sys->head_desc_list, link) {
 		list_del(&rx_pkt->link);
-		dma_unmap_single(ipa3_ctx->pdev, rx_pkt->data.dma_addr,
-			sys->rx_buff_sz, DMA_FROM_DEVICE);
-		sys->free_skb(rx_pkt->data.skb);
+		ipa3_free_rx_buff(sys, rx_pkt);
 		kmem_cache_free(ipa3_ctx->rx_pkt_wrapper_cache, rx_pkt);
 	}
 
@@ -2383,14 +2730,14 @@ static void ipa3_cleanup_rx(struct ipa3_sys_context *sys)
 		tail = atomic_read(&sys->repl.tail_idx);
 		while (head != tail) {
 			rx_pkt = sys->repl.cache[head];
-			dma_unmap_single(ipa3_ctx->pdev, rx_pkt->data.dma_addr,
-					sys->rx_buff_sz, DMA_FROM_DEVICE);
-			sys->free_skb(rx_pkt->data.skb);
+			ipa3_free_rx_buff(sys, rx_pkt);
 			kmem_cache_free(ipa3_ctx->rx_pkt_wrapper_cache, rx_pkt);
 			head = (head + 1) % sys->repl.capacity;
 		}
 		kfree(sys->repl.cache);
 	}
+
+	ipa3_rx_page_pool_destroy(sys);
 }
 
 static struct sk_buff *ipa3_skb_copy_for_client(struct sk_buff *skb, int len)
@@ -2518,6 +2865,9 @@ begin:
 			if (sys->status_stat->curr == IPA_MAX_STATUS_STAT_NUM)
 				sys->status_stat->curr = 0;
 		}
+		if (IPAHAL_PKT_STATUS_MASK_FLAG_VAL(
+			IPAHAL_PKT_STATUS_MASK_PREV_EOT_SHFT, &status))
+			IPA_STATS_INC_CNT(sys->dp_stats.aggr_close_byte);
 
 		if ((status.status_opcode !=
 			IPAHAL_PKT_STATUS_OPCODE_DROPPED_PACKET) &&
@@ -2571,6 +2921,7 @@ begin:
 			IPADBG_LOW("Skip aggr close status\n");
 			skb_pull(skb, pkt_status_sz);
 			IPA_STATS_INC_CNT(ipa3_ctx->stats.aggr_close);
+			IPA_STATS_INC_CNT(sys->dp_stats.aggr_close_status);
 			IPA_STATS_DEC_CNT(ipa3_ctx->stats.rx_excp_pkts
 				[IPAHAL_PKT_STATUS_EXCEPTION_NONE]);
 			continue;
@@ -2687,12 +3038,12 @@ begin:
 }
 
 static struct sk_buff *ipa3_join_prev_skb(struct sk_buff *prev_skb,
-		struct sk_buff *skb, unsigned int len)
+		struct sk_buff *skb, unsigned int len, gfp_t flags)
 {
 	struct sk_buff *skb2;
 
 	skb2 = skb_copy_expand(prev_skb, 0,
-			len, GFP_KERNEL);
+			len, flags);
 	if (likely(skb2)) {
 		memcpy(skb_put(skb2, len),
 			skb->data, len);
@@ -2709,12 +3060,13 @@ static void ipa3_wan_rx_handle_splt_pyld(struct sk_buff *skb,
 		struct ipa3_sys_context *sys)
 {
 	struct sk_buff *skb2;
+	gfp_t flags = sys->ep->napi_enabled ? GFP_ATOMIC : GFP_KERNEL;
 
 	IPADBG_LOW("rem %d skb %d\n", sys->len_rem, skb->len);
 	if (sys->len_rem <= skb->len) {
 		if (sys->prev_skb) {
 			skb2 = ipa3_join_prev_skb(sys->prev_skb, skb,
-					sys->len_rem);
+					sys->len_rem, flags);
 			if (likely(skb2)) {
 				IPADBG_LOW(
 					"removing Status element from skb and sending to WAN client");
@@ -2732,7 +3084,7 @@ static void ipa3_wan_rx_handle_splt_pyld(struct sk_buff *skb,
 	} else {
 		if (sys->prev_skb) {
 			skb2 = ipa3_join_prev_skb(sys->prev_skb, skb,
-					skb->len);
+					skb->len, flags);
 			sys->prev_skb = skb2;
 		}
 		sys->len_rem -= skb->len;
@@ -2796,6 +3148,9 @@ static int ipa3_wan_rx_pyld_hdlr(struct sk_buff *skb,
 			if (sys->status_stat->curr == IPA_MAX_STATUS_STAT_NUM)
 				sys->status_stat->curr = 0;
 		}
+		if (IPAHAL_PKT_STATUS_MASK_FLAG_VAL(
+			IPAHAL_PKT_STATUS_MASK_PREV_EOT_SHFT, &status))
+			IPA_STATS_INC_CNT(sys->dp_stats.aggr_close_byte);
 
 		if ((status.status_opcode !=
 			IPAHAL_PKT_STATUS_OPCODE_DROPPED_PACKET) &&
@@ -2822,6 +3177,7 @@ static int ipa3_wan_rx_pyld_hdlr(struct sk_buff *skb,
 			skb_pull(skb, pkt_status_sz);
 			IPA_STATS_DEC_CNT(ipa3_ctx->stats.rx_pkts);
 			IPA_STATS_INC_CNT(ipa3_ctx->stats.wan_aggr_close);
+			IPA_STATS_INC_CNT(sys->dp_stats.aggr_close_status);
 			continue;
 		}
 		ep_idx = ipa3_get_ep_mapping(IPA_CLIENT_APPS_WAN_CONS);
@@ -2858,7 +3214,8 @@ static int ipa3_wan_rx_pyld_hdlr(struct sk_buff *skb,
 			frame_len += IPA_DL_CHECKSUM_LENGTH;
 		IPADBG_LOW("frame_len %d\n", frame_len);
 
-		skb2 = skb_clone(skb, GFP_KERNEL);
+		skb2 = skb_clone(skb, sys->ep->napi_enabled ?
+			GFP_ATOMIC : GFP_KERNEL);
 		if (likely(skb2)) {
 			/*
 			 * the len of actual data is smaller than expected
@@ -2964,6 +3321,74 @@ static void ipa3_recycle_rx_wrapper(struct ipa3_rx_pkt_wrapper *rx_pkt)
 	spin_unlock_bh(&rx_pkt->sys->spinlock);
 }
 
+static void ipa3_dp_lat_record(struct ipa3_dp_stats *stats,
+	enum ipa3_dp_lat_stage stage, u64 delta_ns)
+{
+	u32 us;
+	int bucket;
+
+	us = (u32)min_t(u64, div_u64(delta_ns, NSEC_PER_USEC), U32_MAX);
+	bucket = min_t(int, fls(us), IPA3_DP_LAT_BUCKETS - 1);
+	IPA_STATS_INC_CNT(stats->lat_hist[stage][bucket]);
+	if (us > stats->lat_max_us[stage])
+		stats->lat_max_us[stage] = us;
+}
+
+static inline void ipa3_dp_lat_stamp_comp(struct ipa3_rx_pkt_wrapper *rx_pkt)
+{
+	if (ipa3_ctx->dp_lat_enable)
+		rx_pkt->comp_ts = ktime_get_ns();
+}
+
+/**
+ * ipa3_dp_lat_netif_rx() - account the handoff to netif latency of a packet
+ * @client: consumer client the packet was received on
+ * @skb: packet about to be passed to the network stack
+ *
+ * The handoff time is carried in skb->tstamp, which is set at handoff with
+ * the same clock the network stack uses for Rx timestamps. Packets which had
+ * no timestamp set by IPA are ignored.
+ */
+void ipa3_dp_lat_netif_rx(enum ipa_client_type client, struct sk_buff *skb)
+{
+	struct ipa3_ep_context *ep;
+	s64 delta;
+	int ep_idx;
+
+	if (!ipa3_ctx->dp_lat_enable || !skb->tstamp.tv64)
+		return;
+
+	ep_idx = ipa3_get_ep_mapping(client);
+	if (ep_idx == IPA_EP_NOT_ALLOCATED)
+		return;
+
+	ep = &ipa3_ctx->ep[ep_idx];
+	if (!ep->valid || !ep->sys)
+		return;
+
+	delta = ktime_to_ns(ktime_sub(ktime_get_real(), skb->tstamp));
+	if (delta < 0)
+		return;
+
+	ipa3_dp_lat_record(&ep->sys->dp_stats, IPA3_DP_LAT_NETIF, delta);
+}
+
+/**
+ * ipa3_dp_stats_aggr_force_close() - account a SW forced aggregation close
+ * @clnt_hdl: pipe the aggregation frame was force closed on
+ */
+void ipa3_dp_stats_aggr_force_close(u32 clnt_hdl)
+{
+	struct ipa3_ep_context *ep;
+
+	if (clnt_hdl >= ipa3_ctx->ipa_num_pipes)
+		return;
+
+	ep = &ipa3_ctx->ep[clnt_hdl];
+	if (ep->valid && ep->sys)
+		IPA_STATS_INC_CNT(ep->sys->dp_stats.aggr_close_force);
+}
+
 static void ipa3_wq_rx_common(struct ipa3_sys_context *sys, u32 size)
 {
 	struct ipa3_rx_pkt_wrapper *rx_pkt_expected;
@@ -2982,13 +3407,32 @@ static void ipa3_wq_rx_common(struct ipa3_sys_context *sys, u32 size)
 	if (size)
 		rx_pkt_expected->len = size;
 	spin_unlock_bh(&sys->spinlock);
-	rx_skb = rx_pkt_expected->data.skb;
-	dma_unmap_single(ipa3_ctx->pdev, rx_pkt_expected->data.dma_addr,
+	if (rx_pkt_expected->page) {
+		rx_skb = ipa3_rx_page_build_skb(sys, rx_pkt_expected);
+		if (unlikely(!rx_skb)) {
+			IPAERR_RL("failed to build rx skb\n");
+			sys->free_rx_wrapper(rx_pkt_expected);
+			sys->repl_hdlr(sys);
+			return;
+		}
+	} else {
+		rx_skb = rx_pkt_expected->data.skb;
+		dma_unmap_single(ipa3_ctx->pdev,
+			rx_pkt_expected->data.dma_addr,
 			sys->rx_buff_sz, DMA_FROM_DEVICE);
+	}
 	skb_set_tail_pointer(rx_skb, rx_pkt_expected->len);
 	rx_skb->len = rx_pkt_expected->len;
 	*(unsigned int *)rx_skb->cb = rx_skb->len;
 	rx_skb->truesize = rx_pkt_expected->len + sizeof(struct sk_buff);
+	IPA_STATS_INC_CNT(sys->dp_stats.aggr_frames);
+	if (ipa3_ctx->dp_lat_enable) {
+		if (rx_pkt_expected->comp_ts)
+			ipa3_dp_lat_record(&sys->dp_stats, IPA3_DP_LAT_DRV,
+				ktime_get_ns() - rx_pkt_expected->comp_ts);
+		__net_timestamp(rx_skb);
+	}
+	rx_pkt_expected->comp_ts = 0;
 	sys->pyld_hdlr(rx_skb, sys);
 	sys->free_rx_wrapper(rx_pkt_expected);
 	sys->repl_hdlr(sys);
@@ -3072,6 +3516,7 @@ void ipa3_sps_irq_rx_no_aggr_notify(struct sps_event_notify *notify)
 		if (IPA_CLIENT_IS_APPS_CONS(rx_pkt->sys->ep->client))
 			atomic_set(&ipa3_ctx->transport_pm.eot_activity, 1);
 		rx_pkt->len = notify->data.transfer.iovec.size;
+		ipa3_dp_lat_stamp_comp(rx_pkt);
 		IPADBG_LOW("event %d notified sys=%p len=%u\n",
 				notify->event_id,
 				notify->user, rx_pkt->len);
@@ -3121,6 +3566,7 @@ static int ipa3_assign_policy(struct ipa_sys_connect_params *in,
 	}
 
 	if (IPA_CLIENT_IS_PROD(in->client)) {
+		INIT_WORK(&sys->tx_db_work, ipa3_tx_db_work_func);
 		if (sys->ep->skip_ep_cfg) {
 			sys->policy = IPA_POLICY_INTR_POLL_MODE;
 			sys->use_comm_evt_ring = true;
@@ -3147,6 +3593,7 @@ static int ipa3_assign_policy(struct ipa_sys_connect_params *in,
 					| SPS_O_ACK_TRANSFERS);
 			sys->sps_callback = ipa3_sps_irq_rx_notify;
 			INIT_WORK(&sys->work, ipa3_wq_handle_rx);
+			INIT_WORK(&sys->napi_clk_work, ipa3_napi_clk_work_func);
 			INIT_DELAYED_WORK(&sys->switch_to_intr_work,
 				ipa3_switch_to_intr_rx_work_func);
 			INIT_DELAYED_WORK(&sys->replenish_rx_work,
@@ -3177,7 +3624,8 @@ static int ipa3_assign_policy(struct ipa_sys_connect_params *in,
 					IPA_CLIENT_APPS_WAN_CONS) {
 				sys->pyld_hdlr = ipa3_wan_rx_pyld_hdlr;
 				sys->free_rx_wrapper = ipa3_free_rx_wrapper;
-				if (nr_cpu_ids > 1)
+				/* NAPI polls from softirq, it cannot sleep */
+				if (nr_cpu_ids > 1 || in->napi_enabled)
 					sys->repl_hdlr =
 						ipa3_fast_replenish_rx_cache;
 				else
@@ -3752,6 +4200,7 @@ static void ipa_gsi_irq_rx_notify_cb(struct gsi_chan_xfer_notify *notify)
 	sys->ep->bytes_xfered_valid = true;
 	sys->ep->bytes_xfered = notify->bytes_xfered;
 	sys->ep->phys_base = rx_pkt_rcvd->data.dma_addr;
+	ipa3_dp_lat_stamp_comp(rx_pkt_rcvd);
 
 	switch (notify->evt_id) {
 	case GSI_CHAN_EVT_EOT:
@@ -3763,7 +4212,7 @@ static void ipa_gsi_irq_rx_notify_cb(struct gsi_chan_xfer_notify *notify)
 				GSI_CHAN_MODE_POLL);
 			ipa3_inc_acquire_wakelock();
 			atomic_set(&sys->curr_polling_state, 1);
-			queue_work(sys->wq, &sys->work);
+			ipa3_rx_start_poll(sys);
 		}
 		break;
 	default:
@@ -3915,6 +4364,7 @@ static int ipa_gsi_setup_channel(struct ipa_sys_connect_params *in,
 
 		gsi_evt_ring_props.int_modt = IPA_GSI_EVT_RING_INT_MODT;
 		gsi_evt_ring_props.int_modc = 1;
+		gsi_evt_ring_props.int_mod_adaptive = true;
 
 		IPADBG("client=%d moderation threshold cycles=%u cnt=%u\n",
 			ep->client,
@@ -4115,6 +4565,7 @@ static int ipa_handle_rx_core_gsi(struct ipa3_sys_context *sys,
 				xfer_notify.chan_user_data;
 			rx_pkt = (struct ipa3_rx_pkt_wrapper *)
 				xfer_notify.xfer_user_data;
+			ipa3_dp_lat_stamp_comp(rx_pkt);
 			mem_info.phys_base = rx_pkt->data.dma_addr;
 			mem_info.size = xfer_notify.bytes_xfered;
 
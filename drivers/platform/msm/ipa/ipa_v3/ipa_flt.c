@@ -819,7 +819,9 @@ static bool ipa_flt_skip_pipe_config(int pipe)
  * __ipa_commit_flt_v3() - commit flt tables to the hw
  *  commit the headers and the bodies if are local with internal cache flushing.
  *  The headers (and local bodies) will first be created into dma buffers and
- *  then written via IC to the SRAM
+ *  then written via IC to the SRAM. Only the header entries and bodies that
+ *  changed since the last commit are written and the hashable rules cache is
+ *  flushed only if a hashable part changed.
  * @ipt: the ip address family type
  *
  * Return: 0 on success, negative on failure
@@ -841,6 +843,15 @@ int __ipa_commit_flt_v3(enum ipa_ip_type ip)
 	bool lcl_hash, lcl_nhash;
 	struct ipahal_reg_fltrt_hash_flush flush;
 	struct ipahal_reg_valmask valmask;
+	struct ipa_mem_buffer *part[IPA3_TBL_IMG_MAX];
+	u32 ofst[IPA3_TBL_IMG_MAX];
+	u32 size[IPA3_TBL_IMG_MAX];
+	u32 hdr_ofst;
+	u32 hdr_written = 0;
+	struct ipa3_tbl_img *img = ipa3_ctx->flt_tbl_img[ip];
+	struct ipa3_fltrt_commit_stats *stats = &ipa3_ctx->flt_commit_stats[ip];
+	u64 start_ns = ktime_get_ns();
+	int p;
 
 	if (ip == IPA_IP_v4) {
 		lcl_hash_hdr = ipa3_ctx->smem_restricted_bytes +
@@ -892,30 +903,54 @@ int __ipa_commit_flt_v3(enum ipa_ip_type ip)
 		goto fail_size_valid;
 	}
 
+	part[IPA3_TBL_IMG_NHASH_HDR] = &nhash_hdr;
+	part[IPA3_TBL_IMG_HASH_HDR] = &hash_hdr;
+	part[IPA3_TBL_IMG_NHASH_BDY] = lcl_nhash ? &nhash_bdy : NULL;
+	part[IPA3_TBL_IMG_HASH_BDY] = lcl_hash ? &hash_bdy : NULL;
+
+	/*
+	 * only the parts that changed since the last commit are written,
+	 * headers are written per pipe so only the size is used for them
+	 */
+	for (p = 0; p < IPA3_TBL_IMG_MAX; p++) {
+		size[p] = 0;
+		if (!part[p])
+			continue;
+		size[p] = ipa3_tbl_img_diff(&img[p], part[p], &ofst[p]);
+		if (!size[p])
+			stats->parts_skipped++;
+	}
+
 	/* flushing ipa internal hashable flt rules cache */
-	memset(&flush, 0, sizeof(flush));
-	if (ip == IPA_IP_v4)
-		flush.v4_flt = true;
-	else
-		flush.v6_flt = true;
-	ipahal_get_fltrt_hash_flush_valmask(&flush, &valmask);
-	reg_write_cmd.skip_pipeline_clear = false;
-	reg_write_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
-	reg_write_cmd.offset = ipahal_get_reg_ofst(IPA_FILT_ROUT_HASH_FLUSH);
-	reg_write_cmd.value = valmask.val;
-	reg_write_cmd.value_mask = valmask.mask;
-	cmd_pyld[0] = ipahal_construct_imm_cmd(
-		IPA_IMM_CMD_REGISTER_WRITE, &reg_write_cmd, false);
-	if (!cmd_pyld[0]) {
-		IPAERR("fail construct register_write imm cmd: IP %d\n", ip);
-		rc = -EFAULT;
-		goto fail_reg_write_construct;
+	if (size[IPA3_TBL_IMG_HASH_HDR] || size[IPA3_TBL_IMG_HASH_BDY]) {
+		memset(&flush, 0, sizeof(flush));
+		if (ip == IPA_IP_v4)
+			flush.v4_flt = true;
+		else
+			flush.v6_flt = true;
+		ipahal_get_fltrt_hash_flush_valmask(&flush, &valmask);
+		reg_write_cmd.skip_pipeline_clear = false;
+		reg_write_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
+		reg_write_cmd.offset =
+			ipahal_get_reg_ofst(IPA_FILT_ROUT_HASH_FLUSH);
+		reg_write_cmd.value = valmask.val;
+		reg_write_cmd.value_mask = valmask.mask;
+		cmd_pyld[0] = ipahal_construct_imm_cmd(
+			IPA_IMM_CMD_REGISTER_WRITE, &reg_write_cmd, false);
+		if (!cmd_pyld[0]) {
+			IPAERR("fail construct register_write imm cmd: IP %d\n",
+				ip);
+			rc = -EFAULT;
+			goto fail_reg_write_construct;
+		}
+		desc[0].opcode =
+			ipahal_imm_cmd_get_opcode(IPA_IMM_CMD_REGISTER_WRITE);
+		desc[0].pyld = cmd_pyld[0]->data;
+		desc[0].len = cmd_pyld[0]->len;
+		desc[0].type = IPA_IMM_CMD_DESC;
+		num_cmd++;
+		stats->hash_flush++;
 	}
-	desc[0].opcode = ipahal_imm_cmd_get_opcode(IPA_IMM_CMD_REGISTER_WRITE);
-	desc[0].pyld = cmd_pyld[0]->data;
-	desc[0].len = cmd_pyld[0]->len;
-	desc[0].type = IPA_IMM_CMD_DESC;
-	num_cmd++;
 
 	hdr_idx = 0;
 	for (i = 0; i < ipa3_ctx->ipa_num_pipes; i++) {
@@ -929,81 +964,73 @@ int __ipa_commit_flt_v3(enum ipa_ip_type ip)
 			continue;
 		}
 
-		IPADBG_LOW("Prepare imm cmd for hdr at index %d for pipe %d\n",
-			hdr_idx, i);
+		hdr_ofst = hdr_idx * IPA_HW_TBL_HDR_WIDTH;
+		hdr_idx++;
 
-		mem_cmd.is_read = false;
-		mem_cmd.skip_pipeline_clear = false;
-		mem_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
-		mem_cmd.size = IPA_HW_TBL_HDR_WIDTH;
-		mem_cmd.system_addr = nhash_hdr.phys_base +
-			hdr_idx * IPA_HW_TBL_HDR_WIDTH;
-		mem_cmd.local_addr = lcl_nhash_hdr +
-			hdr_idx * IPA_HW_TBL_HDR_WIDTH;
-		cmd_pyld[num_cmd] = ipahal_construct_imm_cmd(
-			IPA_IMM_CMD_DMA_SHARED_MEM, &mem_cmd, false);
-		if (!cmd_pyld[num_cmd]) {
-			IPAERR("fail construct dma_shared_mem cmd: IP = %d\n",
-				ip);
-			goto fail_imm_cmd_construct;
+		if (size[IPA3_TBL_IMG_NHASH_HDR] &&
+			ipa3_tbl_img_changed(&img[IPA3_TBL_IMG_NHASH_HDR],
+			&nhash_hdr, hdr_ofst, IPA_HW_TBL_HDR_WIDTH)) {
+			IPADBG_LOW("Prepare imm cmd for nhash hdr of pipe %d\n",
+				i);
+
+			mem_cmd.is_read = false;
+			mem_cmd.skip_pipeline_clear = false;
+			mem_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
+			mem_cmd.size = IPA_HW_TBL_HDR_WIDTH;
+			mem_cmd.system_addr = nhash_hdr.phys_base + hdr_ofst;
+			mem_cmd.local_addr = lcl_nhash_hdr + hdr_ofst;
+			cmd_pyld[num_cmd] = ipahal_construct_imm_cmd(
+				IPA_IMM_CMD_DMA_SHARED_MEM, &mem_cmd, false);
+			if (!cmd_pyld[num_cmd]) {
+				IPAERR("fail construct dma_shared_mem cmd\n");
+				goto fail_imm_cmd_construct;
+			}
+			desc[num_cmd].opcode = ipahal_imm_cmd_get_opcode(
+				IPA_IMM_CMD_DMA_SHARED_MEM);
+			desc[num_cmd].pyld = cmd_pyld[num_cmd]->data;
+			desc[num_cmd].len = cmd_pyld[num_cmd]->len;
+			desc[num_cmd++].type = IPA_IMM_CMD_DESC;
+			hdr_written += IPA_HW_TBL_HDR_WIDTH;
 		}
-		desc[num_cmd].opcode =
-			ipahal_imm_cmd_get_opcode(IPA_IMM_CMD_DMA_SHARED_MEM);
-		desc[num_cmd].pyld = cmd_pyld[num_cmd]->data;
-		desc[num_cmd].len = cmd_pyld[num_cmd]->len;
-		desc[num_cmd++].type = IPA_IMM_CMD_DESC;
 
-		mem_cmd.is_read = false;
-		mem_cmd.skip_pipeline_clear = false;
-		mem_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
-		mem_cmd.size = IPA_HW_TBL_HDR_WIDTH;
-		mem_cmd.system_addr = hash_hdr.phys_base +
-			hdr_idx * IPA_HW_TBL_HDR_WIDTH;
-		mem_cmd.local_addr = lcl_hash_hdr +
-			hdr_idx * IPA_HW_TBL_HDR_WIDTH;
-		cmd_pyld[num_cmd] = ipahal_construct_imm_cmd(
-			IPA_IMM_CMD_DMA_SHARED_MEM, &mem_cmd, false);
-		if (!cmd_pyld[num_cmd]) {
-			IPAERR("fail construct dma_shared_mem cmd: IP = %d\n",
-				ip);
-			goto fail_imm_cmd_construct;
+		if (size[IPA3_TBL_IMG_HASH_HDR] &&
+			ipa3_tbl_img_changed(&img[IPA3_TBL_IMG_HASH_HDR],
+			&hash_hdr, hdr_ofst, IPA_HW_TBL_HDR_WIDTH)) {
+			IPADBG_LOW("Prepare imm cmd for hash hdr of pipe %d\n",
+				i);
+
+			mem_cmd.is_read = false;
+			mem_cmd.skip_pipeline_clear = false;
+			mem_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
+			mem_cmd.size = IPA_HW_TBL_HDR_WIDTH;
+			mem_cmd.system_addr = hash_hdr.phys_base + hdr_ofst;
+			mem_cmd.local_addr = lcl_hash_hdr + hdr_ofst;
+			cmd_pyld[num_cmd] = ipahal_construct_imm_cmd(
+				IPA_IMM_CMD_DMA_SHARED_MEM, &mem_cmd, false);
+			if (!cmd_pyld[num_cmd]) {
+				IPAERR("fail construct dma_shared_mem cmd\n");
+				goto fail_imm_cmd_construct;
+			}
+			desc[num_cmd].opcode = ipahal_imm_cmd_get_opcode(
+				IPA_IMM_CMD_DMA_SHARED_MEM);
+			desc[num_cmd].pyld = cmd_pyld[num_cmd]->data;
+			desc[num_cmd].len = cmd_pyld[num_cmd]->len;
+			desc[num_cmd++].type = IPA_IMM_CMD_DESC;
+			hdr_written += IPA_HW_TBL_HDR_WIDTH;
 		}
-		desc[num_cmd].opcode =
-			ipahal_imm_cmd_get_opcode(IPA_IMM_CMD_DMA_SHARED_MEM);
-		desc[num_cmd].pyld = cmd_pyld[num_cmd]->data;
-		desc[num_cmd].len = cmd_pyld[num_cmd]->len;
-		desc[num_cmd++].type = IPA_IMM_CMD_DESC;
-
-		hdr_idx++;
 	}
 
-	if (lcl_nhash) {
-		mem_cmd.is_read = false;
-		mem_cmd.skip_pipeline_clear = false;
-		mem_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
-		mem_cmd.size = nhash_bdy.size;
-		mem_cmd.system_addr = nhash_bdy.phys_base;
-		mem_cmd.local_addr = lcl_nhash_bdy;
-		cmd_pyld[num_cmd] = ipahal_construct_imm_cmd(
-			IPA_IMM_CMD_DMA_SHARED_MEM, &mem_cmd, false);
-		if (!cmd_pyld[num_cmd]) {
-			IPAERR("fail construct dma_shared_mem cmd: IP = %d\n",
-				ip);
-			goto fail_imm_cmd_construct;
-		}
-		desc[num_cmd].opcode =
-			ipahal_imm_cmd_get_opcode(IPA_IMM_CMD_DMA_SHARED_MEM);
-		desc[num_cmd].pyld = cmd_pyld[num_cmd]->data;
-		desc[num_cmd].len = cmd_pyld[num_cmd]->len;
-		desc[num_cmd++].type = IPA_IMM_CMD_DESC;
-	}
-	if (lcl_hash) {
+	for (p = IPA3_TBL_IMG_NHASH_BDY; p < IPA3_TBL_IMG_MAX; p++) {
+		if (!size[p])
+			continue;
+
 		mem_cmd.is_read = false;
 		mem_cmd.skip_pipeline_clear = false;
 		mem_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
-		mem_cmd.size = hash_bdy.size;
-		mem_cmd.system_addr = hash_bdy.phys_base;
-		mem_cmd.local_addr = lcl_hash_bdy;
+		mem_cmd.size = size[p];
+		mem_cmd.system_addr = part[p]->phys_base + ofst[p];
+		mem_cmd.local_addr = ofst[p] + (p == IPA3_TBL_IMG_HASH_BDY ?
+			lcl_hash_bdy : lcl_nhash_bdy);
 		cmd_pyld[num_cmd] = ipahal_construct_imm_cmd(
 			IPA_IMM_CMD_DMA_SHARED_MEM, &mem_cmd, false);
 		if (!cmd_pyld[num_cmd]) {
@@ -1018,12 +1045,28 @@ int __ipa_commit_flt_v3(enum ipa_ip_type ip)
 		desc[num_cmd++].type = IPA_IMM_CMD_DESC;
 	}
 
-	if (ipa3_send_cmd(num_cmd, desc)) {
+	if (!num_cmd) {
+		IPADBG_LOW("FLT tables unchanged. IP %d\n", ip);
+		stats->nop_commits++;
+	} else if (ipa3_send_cmd(num_cmd, desc)) {
 		IPAERR("fail to send immediate command\n");
+		/* SRAM may be partially written, rewrite it all next time */
+		for (p = 0; p < IPA3_TBL_IMG_MAX; p++)
+			ipa3_tbl_img_invalidate(&img[p]);
 		rc = -EFAULT;
 		goto fail_imm_cmd_construct;
 	}
 
+	stats->bytes_written += hdr_written;
+	for (p = 0; p < IPA3_TBL_IMG_MAX; p++) {
+		if (!part[p])
+			continue;
+		if (p >= IPA3_TBL_IMG_NHASH_BDY)
+			stats->bytes_written += size[p];
+		if (size[p] || img[p].size != part[p]->size)
+			ipa3_tbl_img_update(&img[p], part[p]);
+	}
+
 	IPADBG_LOW("Hashable HEAD\n");
 	IPA_DUMP_BUFF(hash_hdr.base, hash_hdr.phys_base, hash_hdr.size);
 
@@ -1044,6 +1087,7 @@ int __ipa_commit_flt_v3(enum ipa_ip_type ip)
 
 	__ipa_reap_sys_flt_tbls(ip, IPA_RULE_HASHABLE);
 	__ipa_reap_sys_flt_tbls(ip, IPA_RULE_NON_HASHABLE);
+	ipa3_fltrt_commit_stats_update(stats, start_ns);
 
 fail_imm_cmd_construct:
 	for (i = 0 ; i < num_cmd ; i++)
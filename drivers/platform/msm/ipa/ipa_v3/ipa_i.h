@@ -504,6 +504,48 @@ struct ipa3_rt_tbl_set {
 	u32 tbl_cnt;
 };
 
+/**
+ * enum ipa3_tbl_img_part - parts of a filter/routing table image that are
+ * written to IPA SRAM on commit, in the order they are written
+ */
+enum ipa3_tbl_img_part {
+	IPA3_TBL_IMG_NHASH_HDR,
+	IPA3_TBL_IMG_HASH_HDR,
+	IPA3_TBL_IMG_NHASH_BDY,
+	IPA3_TBL_IMG_HASH_BDY,
+	IPA3_TBL_IMG_MAX
+};
+
+/**
+ * struct ipa3_tbl_img - copy of a table image part last written to SRAM
+ * @base: copy of the image, NULL if the SRAM content is not known
+ * @size: size of the image in bytes
+ */
+struct ipa3_tbl_img {
+	void *base;
+	u32 size;
+};
+
+/**
+ * struct ipa3_fltrt_commit_stats - filter/routing commit statistics
+ * @commits: number of successful commits
+ * @nop_commits: commits that found nothing changed and wrote nothing
+ * @parts_skipped: unchanged table parts whose write was skipped
+ * @hash_flush: number of hashable rules cache flushes
+ * @bytes_written: bytes written to SRAM
+ * @last_us: duration of the last commit
+ * @max_us: duration of the longest commit
+ */
+struct ipa3_fltrt_commit_stats {
+	u32 commits;
+	u32 nop_commits;
+	u32 parts_skipped;
+	u32 hash_flush;
+	u64 bytes_written;
+	u32 last_us;
+	u32 max_us;
+};
+
 /**
  * struct ipa3_wlan_stats - Wlan stats for each wlan endpoint
  * @rx_pkts_rcvd: Packets sent by wlan driver
@@ -589,6 +631,7 @@ struct ipa3_status_stats {
  * @skip_ep_cfg: boolean field that determines if EP should be configured
  *  by IPA driver
  * @keep_ipa_awake: when true, IPA will not be clock gated
+ * @napi_enabled: when true, Rx is polled from the client's NAPI context
  * @disconnect_in_progress: Indicates client disconnect in progress.
  * @qmi_request_sent: Indicates whether QMI request to enable clear data path
  *					request is sent or not.
@@ -626,6 +669,7 @@ struct ipa3_ep_context {
 	u32 dflt_flt6_rule_hdl;
 	bool skip_ep_cfg;
 	bool keep_ipa_awake;
+	bool napi_enabled;
 	struct ipa3_wlan_stats wstats;
 	u32 uc_offload_state;
 	bool disconnect_in_progress;
@@ -683,6 +727,85 @@ struct ipa3_repl_ctx {
 	u32 capacity;
 };
 
+/**
+ * struct ipa3_tx_db_stats - Tx doorbell batching statistics of a pipe
+ * @xfers: transfers queued on the channel
+ * @deferred: transfers queued without ringing the doorbell
+ * @timer_flush: deferred doorbells rung by the flush timer
+ * @batch_max: largest number of transfers covered by a single doorbell
+ */
+struct ipa3_tx_db_stats {
+	u32 xfers;
+	u32 deferred;
+	u32 timer_flush;
+	u32 batch_max;
+};
+
+/**
+ * enum ipa3_dp_lat_stage - Rx data path stages covered by latency histograms
+ * @IPA3_DP_LAT_DRV: descriptor completion to skb handoff to the client
+ * @IPA3_DP_LAT_NETIF: skb handoff to the network stack accepting the packet
+ */
+enum ipa3_dp_lat_stage {
+	IPA3_DP_LAT_DRV,
+	IPA3_DP_LAT_NETIF,
+	IPA3_DP_LAT_STAGE_MAX
+};
+
+/* log2 microsecond buckets, the last one holds everything above 16ms */
+#define IPA3_DP_LAT_BUCKETS 16
+
+/**
+ * struct ipa3_dp_stats - Rx data path instrumentation of a pipe
+ * @lat_hist: latency histograms per stage, bucket n counts samples in
+ *  [2^(n-1), 2^n) usec and bucket 0 counts samples below 1 usec
+ * @lat_max_us: largest latency seen per stage
+ * @repl_starved: times the ring dropped to the yellow watermark and a
+ *  delayed replenish was scheduled
+ * @repl_retry: delayed replenish work executions
+ * @aggr_frames: aggregated buffers completed by the hardware
+ * @aggr_close_status: zero length aggregation close statuses received
+ * @aggr_close_byte: frames closed on the hard byte limit (PREV_EOT)
+ * @aggr_close_force: frames closed by a SW forced close
+ */
+struct ipa3_dp_stats {
+	u32 lat_hist[IPA3_DP_LAT_STAGE_MAX][IPA3_DP_LAT_BUCKETS];
+	u32 lat_max_us[IPA3_DP_LAT_STAGE_MAX];
+	u32 repl_starved;
+	u32 repl_retry;
+	u32 aggr_frames;
+	u32 aggr_close_status;
+	u32 aggr_close_byte;
+	u32 aggr_close_force;
+};
+
+/**
+ * struct ipa3_rx_page - entry of the Rx page pool
+ * @page: the page, the pool holds a reference on it for as long as it lives
+ * @dma_addr: DMA address of the whole page, mapped once when allocated
+ */
+struct ipa3_rx_page {
+	struct page *page;
+	dma_addr_t dma_addr;
+};
+
+/**
+ * struct ipa3_page_recycle_ctx - pool of pre-mapped Rx pages
+ * @cache: pool entries
+ * @capacity: number of pool entries
+ * @next: next entry to inspect for a free page
+ * @order: allocation order of the pool pages
+ *
+ * A page is free again once every skb built on it was released by the stack,
+ * i.e. when only the pool reference is left.
+ */
+struct ipa3_page_recycle_ctx {
+	struct ipa3_rx_page *cache;
+	u32 capacity;
+	u32 next;
+	u32 order;
+};
+
 /**
  * struct ipa3_sys_context - IPA endpoint context for system to BAM pipes
  * @head_desc_list: header descriptors list
@@ -713,12 +836,18 @@ struct ipa3_sys_context {
 	unsigned int len_partial;
 	bool drop_packet;
 	struct work_struct work;
+	struct work_struct napi_clk_work;
 	void (*sps_callback)(struct sps_event_notify *notify);
 	enum sps_option sps_option;
 	struct delayed_work replenish_rx_work;
 	struct work_struct repl_work;
 	void (*repl_hdlr)(struct ipa3_sys_context *sys);
 	struct ipa3_repl_ctx repl;
+	struct ipa3_page_recycle_ctx page_recycle;
+	u32 tx_db_pending;
+	struct work_struct tx_db_work;
+	struct ipa3_tx_db_stats tx_db_stats;
+	struct ipa3_dp_stats dp_stats;
 
 	/* ordering is important - mutable fields go above */
 	struct ipa3_ep_context *ep;
@@ -726,6 +855,7 @@ struct ipa3_sys_context {
 	struct list_head rcycl_list;
 	spinlock_t spinlock;
 	struct hrtimer db_timer;
+	struct hrtimer tx_db_timer;
 	struct workqueue_struct *wq;
 	struct workqueue_struct *repl_wq;
 	struct ipa3_status_stats *status_stat;
@@ -786,7 +916,8 @@ struct ipa3_tx_pkt_wrapper {
  * @len: len in bytes to copy
  * @link: linked to the wrappers list on the proper(sync/async) cons pipe
  * @xfer_done: completion object for sync_memcpy completion
- * @callback: IPADMA client provided completion callback
+ * @callback: IPADMA client provided completion callback, NULL for all but
+ *	the last copy of a batch
  * @user1: cookie1 for above callback
  *
  * This struct can wrap both sync and async memcpy transfers descriptors.
@@ -838,6 +969,9 @@ struct ipa3_desc {
  * @dma_address: DMA address of this Rx packet
  * @link: linked to the Rx packets on that pipe
  * @len: how many bytes are copied into skb's flat buffer
+ * @page: page backing the buffer instead of skb until it is received
+ * @page_idx: Rx page pool entry of page, -1 if allocated outside of the pool
+ * @comp_ts: time the completion was seen, 0 unless latency tracking is on
  */
 struct ipa3_rx_pkt_wrapper {
 	struct list_head link;
@@ -845,6 +979,9 @@ struct ipa3_rx_pkt_wrapper {
 	u32 len;
 	struct work_struct work;
 	struct ipa3_sys_context *sys;
+	struct page *page;
+	int page_idx;
+	u64 comp_ts;
 };
 
 /**
@@ -868,6 +1005,7 @@ struct ipa3_rx_pkt_wrapper {
  * @size_base_tables: base table size
  * @size_expansion_tables: expansion table size
  * @public_ip_addr: ip address of nat table
+ * @expn_used_peak: highest expansion table occupancy seen for the table
  */
 struct ipa3_nat_mem {
 	struct class *class;
@@ -893,6 +1031,23 @@ struct ipa3_nat_mem {
 	void *tmp_vaddr;
 	dma_addr_t tmp_dma_handle;
 	bool is_tmp_mem;
+	u32 expn_used_peak;
+};
+
+/**
+ * struct ipa3_nat_occupancy - IPv4 NAT table occupancy
+ * @base_entries: number of base table entries
+ * @base_used: number of enabled base table entries
+ * @expn_entries: number of expansion table entries
+ * @expn_used: number of enabled expansion table entries
+ * @expn_used_peak: highest expansion table occupancy seen for the table
+ */
+struct ipa3_nat_occupancy {
+	u32 base_entries;
+	u32 base_used;
+	u32 expn_entries;
+	u32 expn_used;
+	u32 expn_used_peak;
 };
 
 /**
@@ -929,6 +1084,8 @@ struct ipa3_stats {
 	u32 wan_repl_rx_empty;
 	u32 lan_rx_empty;
 	u32 lan_repl_rx_empty;
+	u32 wan_rx_page_recycled;
+	u32 wan_rx_page_alloc;
 	u32 flow_enable;
 	u32 flow_disable;
 	u32 tx_non_linear;
@@ -1182,6 +1339,10 @@ struct ipa_cne_evt {
  * @ip4_flt_tbl_lcl: where ip4 flt tables reside 1-local; 0-system
  * @ip6_flt_tbl_lcl: where ip6 flt tables reside 1-local; 0-system
  * @empty_rt_tbl_mem: empty routing tables memory
+ * @rt_tbl_img: routing table images last written to SRAM, per IP type
+ * @flt_tbl_img: filter table images last written to SRAM, per IP type
+ * @rt_commit_stats: routing commit statistics, per IP type
+ * @flt_commit_stats: filter commit statistics, per IP type
  * @power_mgmt_wq: workqueue for power management
  * @transport_power_mgmt_wq: workqueue transport related power management
  * @tag_process_before_gating: indicates whether to start tag process before
@@ -1204,6 +1365,7 @@ struct ipa_cne_evt {
  * @ctrl: holds the core specific operations based on
  *  core version (vtable like)
  * @enable_clock_scaling: clock scaling is enabled ?
+ * @dp_lat_enable: Rx data path latency histograms are collected
  * @curr_ipa_clk_rate: ipa3_clk current rate
  * @wcstats: wlan common buffer stats
  * @uc_ctx: uC interface context
@@ -1275,6 +1437,10 @@ struct ipa3_context {
 	bool ip6_flt_tbl_hash_lcl;
 	bool ip6_flt_tbl_nhash_lcl;
 	struct ipa_mem_buffer empty_rt_tbl_mem;
+	struct ipa3_tbl_img rt_tbl_img[IPA_IP_MAX][IPA3_TBL_IMG_MAX];
+	struct ipa3_tbl_img flt_tbl_img[IPA_IP_MAX][IPA3_TBL_IMG_MAX];
+	struct ipa3_fltrt_commit_stats rt_commit_stats[IPA_IP_MAX];
+	struct ipa3_fltrt_commit_stats flt_commit_stats[IPA_IP_MAX];
 	struct gen_pool *pipe_mem_pool;
 	struct dma_pool *dma_pool;
 	struct ipa3_active_clients ipa3_active_clients;
@@ -1317,6 +1483,7 @@ struct ipa3_context {
 	struct device *uc_pdev;
 	spinlock_t idr_lock;
 	u32 enable_clock_scaling;
+	u32 dp_lat_enable;
 	u32 curr_ipa_clk_rate;
 	bool q6_proxy_clk_vote_valid;
 	struct mutex q6_proxy_clk_vote_mutex;
@@ -1691,6 +1858,8 @@ int ipa3_nat_dma_cmd(struct ipa_ioc_nat_dma_cmd *dma);
 int ipa3_nat_del_cmd(struct ipa_ioc_v4_nat_del *del);
 int ipa3_del_nat_table(struct ipa_ioc_nat_ipv6ct_table_del *del);
 
+int ipa3_nat_get_occupancy(struct ipa3_nat_occupancy *occ);
+
 /*
  * Messaging
  */
@@ -1742,6 +1911,10 @@ int ipa3_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl);
 
 int ipa3_teardown_sys_pipe(u32 clnt_hdl);
 
+int ipa3_rx_poll(u32 clnt_hdl, int budget);
+void ipa3_dp_lat_netif_rx(enum ipa_client_type client, struct sk_buff *skb);
+void ipa3_dp_stats_aggr_force_close(u32 clnt_hdl);
+
 int ipa3_sys_setup(struct ipa_sys_connect_params *sys_in,
 	unsigned long *ipa_bam_hdl,
 	u32 *ipa_pipe_num, u32 *clnt_hdl, bool en_status);
@@ -1821,6 +1994,9 @@ int ipa3_dma_sync_memcpy(u64 dest, u64 src, int len);
 int ipa3_dma_async_memcpy(u64 dest, u64 src, int len,
 			void (*user_cb)(void *user1), void *user_param);
 
+int ipa3_dma_async_memcpy_batch(const struct ipa_dma_memcpy_desc *descs,
+			int num, void (*user_cb)(void *user1), void *user_param);
+
 int ipa3_dma_uc_memcpy(phys_addr_t dest, phys_addr_t src, int len);
 
 void ipa3_dma_destroy(void);
@@ -2116,6 +2292,15 @@ int ipa3_rt_read_tbl_from_hw(u32 tbl_idx,
 	struct ipa3_debugfs_rt_entry entry[],
 	int *num_entry);
 int ipa3_calc_extra_wrd_bytes(const struct ipa_ipfltri_rule_eq *attrib);
+u32 ipa3_tbl_img_diff(const struct ipa3_tbl_img *img,
+	const struct ipa_mem_buffer *mem, u32 *ofst);
+bool ipa3_tbl_img_changed(const struct ipa3_tbl_img *img,
+	const struct ipa_mem_buffer *mem, u32 ofst, u32 size);
+void ipa3_tbl_img_update(struct ipa3_tbl_img *img,
+	const struct ipa_mem_buffer *mem);
+void ipa3_tbl_img_invalidate(struct ipa3_tbl_img *img);
+void ipa3_fltrt_commit_stats_update(struct ipa3_fltrt_commit_stats *stats,
+	u64 start_ns);
 int ipa3_restore_suspend_handler(void);
 int ipa3_inject_dma_task_for_gsi(void);
 int ipa3_uc_panic_notifier(struct notifier_block *this,
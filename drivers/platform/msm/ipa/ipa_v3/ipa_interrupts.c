@@ -527,6 +527,7 @@ void ipa3_suspend_active_aggr_wa(u32 clnt_hdl)
 	if (aggr_active_bitmap & (1 << clnt_hdl)) {
 		/* force close aggregation */
 		ipahal_write_reg(IPA_AGGR_FORCE_CLOSE, (1 << clnt_hdl));
+		ipa3_dp_stats_aggr_force_close(clnt_hdl);
 
 		/* simulate suspend IRQ */
 		irq_num = ipa3_irq_mapping[IPA_TX_SUSPEND_IRQ];
@@ -41,6 +41,13 @@ enum nat_table_type {
 #define IPA_TABLE_MAX_ENTRIES 1000
 #define MAX_ALLOC_NAT_SIZE (IPA_TABLE_MAX_ENTRIES * NAT_TABLE_ENTRY_SIZE_BYTE)
 
+/* enable bit in the upper half of the flags word of a NAT rule */
+#define NAT_ENTRY_FLAGS_WORD 4
+#define NAT_ENTRY_ENABLE (0x8000 << 16)
+
+/* expansion table occupancy, in percent, that is reported as high */
+#define IPA_NAT_EXPN_HIGH_WM 75
+
 static int ipa3_nat_vma_fault_remap(
 	 struct vm_area_struct *vma, struct vm_fault *vmf)
 {
@@ -595,6 +602,7 @@ int ipa3_nat_init_cmd(struct ipa_ioc_v4_nat_init *init)
 
 	IPADBG("size_expansion_tables: %d\n", init->expn_table_entries);
 	ipa3_ctx->nat_mem.size_expansion_tables = init->expn_table_entries;
+	ipa3_ctx->nat_mem.expn_used_peak = 0;
 
 	IPADBG("return\n");
 	result = 0;
@@ -891,6 +899,72 @@ bail:
 	return result;
 }
 
+static u32 ipa3_nat_count_used(const char *tbl, u32 entries)
+{
+	const u32 *entry = (const u32 *)tbl;
+	u32 used = 0;
+	u32 i;
+
+	for (i = 0; i < entries; i++) {
+		if (entry[NAT_ENTRY_FLAGS_WORD] & NAT_ENTRY_ENABLE)
+			used++;
+		entry += NAT_TABLE_ENTRY_SIZE_BYTE / sizeof(u32);
+	}
+
+	return used;
+}
+
+/**
+ * ipa3_nat_get_occupancy() - Get the occupancy of the IPv4 NAT table
+ * @occ:	[out] table occupancy
+ *
+ * Counts the enabled entries of the base and expansion tables. Only supported
+ * when the table resides in system memory. An expansion table filled beyond
+ * IPA_NAT_EXPN_HIGH_WM percent is reported, as new connections that don't fit
+ * in it fall back to software NAT.
+ *
+ * Returns:	0 on success, negative on failure
+ */
+int ipa3_nat_get_occupancy(struct ipa3_nat_occupancy *occ)
+{
+	struct ipa3_nat_mem *nat_ctx = &(ipa3_ctx->nat_mem);
+	int result = 0;
+
+	memset(occ, 0, sizeof(*occ));
+
+	mutex_lock(&nat_ctx->lock);
+	if (!nat_ctx->is_sys_mem || !nat_ctx->is_mapped ||
+		!nat_ctx->ipv4_rules_addr) {
+		IPADBG("NAT table not in system memory\n");
+		result = -EPERM;
+		goto bail;
+	}
+
+	occ->base_entries = nat_ctx->size_base_tables + 1;
+	occ->base_used = ipa3_nat_count_used(nat_ctx->ipv4_rules_addr,
+		occ->base_entries);
+
+	if (nat_ctx->size_expansion_tables &&
+		nat_ctx->ipv4_expansion_rules_addr) {
+		occ->expn_entries = nat_ctx->size_expansion_tables;
+		occ->expn_used = ipa3_nat_count_used(
+			nat_ctx->ipv4_expansion_rules_addr, occ->expn_entries);
+	}
+
+	if (occ->expn_used > nat_ctx->expn_used_peak)
+		nat_ctx->expn_used_peak = occ->expn_used;
+	occ->expn_used_peak = nat_ctx->expn_used_peak;
+
+	if (occ->expn_entries && occ->expn_used * 100 >=
+		occ->expn_entries * IPA_NAT_EXPN_HIGH_WM)
+		IPAERR_RL("NAT expansion table %u/%u used\n",
+			occ->expn_used, occ->expn_entries);
+
+bail:
+	mutex_unlock(&nat_ctx->lock);
+	return result;
+}
+
 /**
 * ipa3_del_nat_table() - Delete the NAT table
 * @del:	[in] delete table parameters
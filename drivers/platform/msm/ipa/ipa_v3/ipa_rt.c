@@ -659,6 +659,8 @@ static bool ipa_rt_valid_lcl_tbl_size(enum ipa_ip_type ipt,
 /**
  * __ipa_commit_rt_v3() - commit rt tables to the hw
  * commit the headers and the bodies if are local with internal cache flushing
+ * Only the parts of the image that changed since the last commit are written
+ * and the hashable rules cache is flushed only if a hashable part changed.
  * @ipt: the ip address family type
  *
  * Return: 0 on success, negative on failure
@@ -679,7 +681,14 @@ int __ipa_commit_rt_v3(enum ipa_ip_type ip)
 	bool lcl_hash, lcl_nhash;
 	struct ipahal_reg_fltrt_hash_flush flush;
 	struct ipahal_reg_valmask valmask;
-	int i;
+	struct ipa_mem_buffer *part[IPA3_TBL_IMG_MAX];
+	u32 lcl_addr[IPA3_TBL_IMG_MAX];
+	u32 ofst[IPA3_TBL_IMG_MAX];
+	u32 size[IPA3_TBL_IMG_MAX];
+	struct ipa3_tbl_img *img = ipa3_ctx->rt_tbl_img[ip];
+	struct ipa3_fltrt_commit_stats *stats = &ipa3_ctx->rt_commit_stats[ip];
+	u64 start_ns = ktime_get_ns();
+	int i, p;
 
 	memset(desc, 0, sizeof(desc));
 	memset(cmd_pyld, 0, sizeof(cmd_pyld));
@@ -735,97 +744,65 @@ int __ipa_commit_rt_v3(enum ipa_ip_type ip)
 		goto fail_size_valid;
 	}
 
-	/* flushing ipa internal hashable rt rules cache */
-	memset(&flush, 0, sizeof(flush));
-	if (ip == IPA_IP_v4)
-		flush.v4_rt = true;
-	else
-		flush.v6_rt = true;
-	ipahal_get_fltrt_hash_flush_valmask(&flush, &valmask);
-	reg_write_cmd.skip_pipeline_clear = false;
-	reg_write_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
-	reg_write_cmd.offset = ipahal_get_reg_ofst(IPA_FILT_ROUT_HASH_FLUSH);
-	reg_write_cmd.value = valmask.val;
-	reg_write_cmd.value_mask = valmask.mask;
-	cmd_pyld[num_cmd] = ipahal_construct_imm_cmd(
-		IPA_IMM_CMD_REGISTER_WRITE, &reg_write_cmd, false);
-	if (!cmd_pyld[num_cmd]) {
-		IPAERR("fail construct register_write imm cmd. IP %d\n", ip);
-		goto fail_size_valid;
-	}
-	desc[num_cmd].opcode =
-		ipahal_imm_cmd_get_opcode(IPA_IMM_CMD_REGISTER_WRITE);
-	desc[num_cmd].pyld = cmd_pyld[num_cmd]->data;
-	desc[num_cmd].len = cmd_pyld[num_cmd]->len;
-	desc[num_cmd].type = IPA_IMM_CMD_DESC;
-	num_cmd++;
-
-	mem_cmd.is_read = false;
-	mem_cmd.skip_pipeline_clear = false;
-	mem_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
-	mem_cmd.size = nhash_hdr.size;
-	mem_cmd.system_addr = nhash_hdr.phys_base;
-	mem_cmd.local_addr = lcl_nhash_hdr;
-	cmd_pyld[num_cmd] = ipahal_construct_imm_cmd(
-		IPA_IMM_CMD_DMA_SHARED_MEM, &mem_cmd, false);
-	if (!cmd_pyld[num_cmd]) {
-		IPAERR("fail construct dma_shared_mem imm cmd. IP %d\n", ip);
-		goto fail_imm_cmd_construct;
-	}
-	desc[num_cmd].opcode =
-		ipahal_imm_cmd_get_opcode(IPA_IMM_CMD_DMA_SHARED_MEM);
-	desc[num_cmd].pyld = cmd_pyld[num_cmd]->data;
-	desc[num_cmd].len = cmd_pyld[num_cmd]->len;
-	desc[num_cmd].type = IPA_IMM_CMD_DESC;
-	num_cmd++;
-
-	mem_cmd.is_read = false;
-	mem_cmd.skip_pipeline_clear = false;
-	mem_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
-	mem_cmd.size = hash_hdr.size;
-	mem_cmd.system_addr = hash_hdr.phys_base;
-	mem_cmd.local_addr = lcl_hash_hdr;
-	cmd_pyld[num_cmd] = ipahal_construct_imm_cmd(
-		IPA_IMM_CMD_DMA_SHARED_MEM, &mem_cmd, false);
-	if (!cmd_pyld[num_cmd]) {
-		IPAERR("fail construct dma_shared_mem imm cmd. IP %d\n", ip);
-		goto fail_imm_cmd_construct;
+	part[IPA3_TBL_IMG_NHASH_HDR] = &nhash_hdr;
+	part[IPA3_TBL_IMG_HASH_HDR] = &hash_hdr;
+	part[IPA3_TBL_IMG_NHASH_BDY] = lcl_nhash ? &nhash_bdy : NULL;
+	part[IPA3_TBL_IMG_HASH_BDY] = lcl_hash ? &hash_bdy : NULL;
+	lcl_addr[IPA3_TBL_IMG_NHASH_HDR] = lcl_nhash_hdr;
+	lcl_addr[IPA3_TBL_IMG_HASH_HDR] = lcl_hash_hdr;
+	lcl_addr[IPA3_TBL_IMG_NHASH_BDY] = lcl_nhash_bdy;
+	lcl_addr[IPA3_TBL_IMG_HASH_BDY] = lcl_hash_bdy;
+
+	/* only the parts that changed since the last commit are written */
+	for (p = 0; p < IPA3_TBL_IMG_MAX; p++) {
+		size[p] = 0;
+		if (!part[p])
+			continue;
+		size[p] = ipa3_tbl_img_diff(&img[p], part[p], &ofst[p]);
+		if (!size[p])
+			stats->parts_skipped++;
 	}
-	desc[num_cmd].opcode =
-		ipahal_imm_cmd_get_opcode(IPA_IMM_CMD_DMA_SHARED_MEM);
-	desc[num_cmd].pyld = cmd_pyld[num_cmd]->data;
-	desc[num_cmd].len = cmd_pyld[num_cmd]->len;
-	desc[num_cmd].type = IPA_IMM_CMD_DESC;
-	num_cmd++;
 
-	if (lcl_nhash) {
-		mem_cmd.is_read = false;
-		mem_cmd.skip_pipeline_clear = false;
-		mem_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
-		mem_cmd.size = nhash_bdy.size;
-		mem_cmd.system_addr = nhash_bdy.phys_base;
-		mem_cmd.local_addr = lcl_nhash_bdy;
+	/* flushing ipa internal hashable rt rules cache */
+	if (size[IPA3_TBL_IMG_HASH_HDR] || size[IPA3_TBL_IMG_HASH_BDY]) {
+		memset(&flush, 0, sizeof(flush));
+		if (ip == IPA_IP_v4)
+			flush.v4_rt = true;
+		else
+			flush.v6_rt = true;
+		ipahal_get_fltrt_hash_flush_valmask(&flush, &valmask);
+		reg_write_cmd.skip_pipeline_clear = false;
+		reg_write_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
+		reg_write_cmd.offset =
+			ipahal_get_reg_ofst(IPA_FILT_ROUT_HASH_FLUSH);
+		reg_write_cmd.value = valmask.val;
+		reg_write_cmd.value_mask = valmask.mask;
 		cmd_pyld[num_cmd] = ipahal_construct_imm_cmd(
-			IPA_IMM_CMD_DMA_SHARED_MEM, &mem_cmd, false);
+			IPA_IMM_CMD_REGISTER_WRITE, &reg_write_cmd, false);
 		if (!cmd_pyld[num_cmd]) {
-			IPAERR("fail construct dma_shared_mem cmd. IP %d\n",
+			IPAERR("fail construct register_write imm cmd. IP %d\n",
 				ip);
-			goto fail_imm_cmd_construct;
+			goto fail_size_valid;
 		}
 		desc[num_cmd].opcode =
-			ipahal_imm_cmd_get_opcode(IPA_IMM_CMD_DMA_SHARED_MEM);
+			ipahal_imm_cmd_get_opcode(IPA_IMM_CMD_REGISTER_WRITE);
 		desc[num_cmd].pyld = cmd_pyld[num_cmd]->data;
 		desc[num_cmd].len = cmd_pyld[num_cmd]->len;
 		desc[num_cmd].type = IPA_IMM_CMD_DESC;
 		num_cmd++;
+		stats->hash_flush++;
 	}
-	if (lcl_hash) {
+
+	for (p = 0; p < IPA3_TBL_IMG_MAX; p++) {
+		if (!size[p])
+			continue;
+
 		mem_cmd.is_read = false;
 		mem_cmd.skip_pipeline_clear = false;
 		mem_cmd.pipeline_clear_options = IPAHAL_HPS_CLEAR;
-		mem_cmd.size = hash_bdy.size;
-		mem_cmd.system_addr = hash_bdy.phys_base;
-		mem_cmd.local_addr = lcl_hash_bdy;
+		mem_cmd.size = size[p];
+		mem_cmd.system_addr = part[p]->phys_base + ofst[p];
+		mem_cmd.local_addr = lcl_addr[p] + ofst[p];
 		cmd_pyld[num_cmd] = ipahal_construct_imm_cmd(
 			IPA_IMM_CMD_DMA_SHARED_MEM, &mem_cmd, false);
 		if (!cmd_pyld[num_cmd]) {
@@ -841,12 +818,26 @@ int __ipa_commit_rt_v3(enum ipa_ip_type ip)
 		num_cmd++;
 	}
 
-	if (ipa3_send_cmd(num_cmd, desc)) {
+	if (!num_cmd) {
+		IPADBG_LOW("RT tables unchanged. IP %d\n", ip);
+		stats->nop_commits++;
+	} else if (ipa3_send_cmd(num_cmd, desc)) {
 		IPAERR("fail to send immediate command\n");
+		/* SRAM may be partially written, rewrite it all next time */
+		for (p = 0; p < IPA3_TBL_IMG_MAX; p++)
+			ipa3_tbl_img_invalidate(&img[p]);
 		rc = -EFAULT;
 		goto fail_imm_cmd_construct;
 	}
 
+	for (p = 0; p < IPA3_TBL_IMG_MAX; p++) {
+		if (!part[p])
+			continue;
+		stats->bytes_written += size[p];
+		if (size[p] || img[p].size != part[p]->size)
+			ipa3_tbl_img_update(&img[p], part[p]);
+	}
+
 	IPADBG_LOW("Hashable HEAD\n");
 	IPA_DUMP_BUFF(hash_hdr.base, hash_hdr.phys_base, hash_hdr.size);
 
@@ -866,6 +857,7 @@ int __ipa_commit_rt_v3(enum ipa_ip_type ip)
 	}
 
 	__ipa_reap_sys_rt_tbls(ip);
+	ipa3_fltrt_commit_stats_update(stats, start_ns);
 
 fail_imm_cmd_construct:
 	for (i = 0 ; i < num_cmd ; i++)
@@ -5715,6 +5715,7 @@ static int ipa3_tag_generate_force_close_desc(struct ipa3_desc desc[],
 		desc[desc_idx].callback = ipa3_tag_destroy_imm;
 		desc[desc_idx].user1 = cmd_pyld;
 		desc_idx++;
+		ipa3_dp_stats_aggr_force_close(i);
 	}
 
 	return desc_idx;
@@ -6055,6 +6056,7 @@ int ipa3_bind_api_controller(enum ipa_hw_type ipa_hw_type,
 	api_ctrl->ipa_dma_disable = ipa3_dma_disable;
 	api_ctrl->ipa_dma_sync_memcpy = ipa3_dma_sync_memcpy;
 	api_ctrl->ipa_dma_async_memcpy = ipa3_dma_async_memcpy;
+	api_ctrl->ipa_dma_async_memcpy_batch = ipa3_dma_async_memcpy_batch;
 	api_ctrl->ipa_dma_uc_memcpy = ipa3_dma_uc_memcpy;
 	api_ctrl->ipa_dma_destroy = ipa3_dma_destroy;
 	api_ctrl->ipa_mhi_init_engine = ipa3_mhi_init_engine;
@@ -6633,6 +6635,116 @@ int ipa3_calc_extra_wrd_bytes(const struct ipa_ipfltri_rule_eq *attrib)
 	return num;
 }
 
+/**
+ * ipa3_tbl_img_diff() - find the range of a table image that differs from the
+ * copy last written to SRAM
+ * @img: copy of the image last written
+ * @mem: new image
+ * @ofst: [out] offset of the range, aligned to IPA_HW_TBL_WIDTH
+ *
+ * The whole image is reported as changed when the SRAM content is not known.
+ *
+ * Return value: size of the range to write, 0 if nothing changed
+ */
+u32 ipa3_tbl_img_diff(const struct ipa3_tbl_img *img,
+	const struct ipa_mem_buffer *mem, u32 *ofst)
+{
+	const u8 *old = img->base;
+	const u8 *new = mem->base;
+	u32 first, last, len;
+
+	*ofst = 0;
+	if (!old)
+		return mem->size;
+
+	len = min(img->size, mem->size);
+	for (first = 0; first < len; first++)
+		if (old[first] != new[first])
+			break;
+
+	/* a shrunk image is only referenced up to its new size */
+	if (first == mem->size)
+		return 0;
+
+	last = mem->size;
+	if (img->size == mem->size)
+		while (last > first && old[last - 1] == new[last - 1])
+			last--;
+
+	first = rounddown(first, IPA_HW_TBL_WIDTH);
+	last = min_t(u32, roundup(last, IPA_HW_TBL_WIDTH), mem->size);
+	*ofst = first;
+
+	return last - first;
+}
+
+/**
+ * ipa3_tbl_img_changed() - check if a range of a table image differs from the
+ * copy last written to SRAM
+ * @img: copy of the image last written
+ * @mem: new image
+ * @ofst: offset of the range
+ * @size: size of the range
+ *
+ * Return value: true if the range needs to be written
+ */
+bool ipa3_tbl_img_changed(const struct ipa3_tbl_img *img,
+	const struct ipa_mem_buffer *mem, u32 ofst, u32 size)
+{
+	if (!img->base || img->size != mem->size)
+		return true;
+
+	return memcmp(img->base + ofst, mem->base + ofst, size) != 0;
+}
+
+/**
+ * ipa3_tbl_img_update() - record a table image as written to SRAM
+ * @img: copy of the image to update
+ * @mem: image written
+ *
+ * If no copy can be kept the SRAM content is considered unknown and the next
+ * commit writes the image in full.
+ */
+void ipa3_tbl_img_update(struct ipa3_tbl_img *img,
+	const struct ipa_mem_buffer *mem)
+{
+	ipa3_tbl_img_invalidate(img);
+	if (!mem->size)
+		return;
+
+	img->base = kmemdup(mem->base, mem->size, GFP_KERNEL);
+	if (img->base)
+		img->size = mem->size;
+}
+
+/**
+ * ipa3_tbl_img_invalidate() - forget the copy of a table image
+ * @img: copy of the image
+ */
+void ipa3_tbl_img_invalidate(struct ipa3_tbl_img *img)
+{
+	kfree(img->base);
+	img->base = NULL;
+	img->size = 0;
+}
+
+/**
+ * ipa3_fltrt_commit_stats_update() - account a successful flt/rt commit
+ * @stats: commit statistics to update
+ * @start_ns: time the commit started
+ */
+void ipa3_fltrt_commit_stats_update(struct ipa3_fltrt_commit_stats *stats,
+	u64 start_ns)
+{
+	u32 us;
+
+	us = div_u64(ktime_get_ns() - start_ns, NSEC_PER_USEC);
+	stats->commits++;
+	stats->last_us = us;
+	if (us > stats->max_us)
+		stats->max_us = us;
+}
+
 /**
  * ipa3_calc_extra_wrd_bytes()- generate an equation from rule read from IPA HW
  * @attrib: equation attribute
@@ -95,6 +95,8 @@ struct ipa3_rmnet_plat_drv_res {
  * @ch_id: channel id
  * @lock: spinlock for mutual exclusion
  * @device_status: holds device status
+ * @napi: NAPI context polling the IPA->APPS pipe
+ * @napi_polling: set while the Rx callback runs from the NAPI poll
  *
  * WWAN private - holds all relevant info about WWAN driver
  */
@@ -109,6 +111,8 @@ struct ipa3_wwan_private {
 	spinlock_t lock;
 	struct completion resource_granted_completion;
 	enum ipa3_wwan_device_status device_status;
+	struct napi_struct napi;
+	bool napi_polling;
 };
 
 struct rmnet_ipa3_context {
@@ -1125,16 +1129,16 @@ send:
 	}
 	/* IPA_RM checking end */
 
+	memset(&meta, 0, sizeof(meta));
+	/* let IPA ring the doorbell once for the whole burst */
+	meta.xmit_more = skb->xmit_more;
 	if (RMNET_MAP_GET_CD_BIT(skb)) {
-		memset(&meta, 0, sizeof(meta));
 		meta.pkt_init_dst_ep_valid = true;
 		meta.pkt_init_dst_ep_remote = true;
 		meta.pkt_init_dst_ep =
 			ipa3_get_ep_mapping(IPA_CLIENT_Q6_WAN_CONS);
-		ret = ipa3_tx_dp(IPA_CLIENT_APPS_WAN_PROD, skb, &meta);
-	} else {
-		ret = ipa3_tx_dp(IPA_CLIENT_APPS_WAN_PROD, skb, NULL);
 	}
+	ret = ipa3_tx_dp(IPA_CLIENT_APPS_WAN_PROD, skb, &meta);
 
 	if (ret) {
 		ret = NETDEV_TX_BUSY;
@@ -1222,19 +1226,33 @@ static void apps_ipa_packet_receive_notify(void *priv,
 {
 	struct sk_buff *skb = (struct sk_buff *)data;
 	struct net_device *dev = (struct net_device *)priv;
+	struct ipa3_wwan_private *wwan_ptr = netdev_priv(dev);
 	int result;
-	unsigned int packet_len = skb->len;
+	unsigned int packet_len;
 
-	IPAWANDBG_LOW("Rx packet was received");
-	if (evt != IPA_RECEIVE) {
+	switch (evt) {
+	case IPA_RECEIVE:
+		break;
+	case IPA_CLIENT_START_POLL:
+		napi_schedule(&wwan_ptr->napi);
+		return;
+	case IPA_CLIENT_COMP_NAPI:
+		napi_complete(&wwan_ptr->napi);
+		return;
+	default:
 		IPAWANERR("A none IPA_RECEIVE event in wan_ipa_receive\n");
 		return;
 	}
 
+	IPAWANDBG_LOW("Rx packet was received");
+	packet_len = skb->len;
 	skb->dev = IPA_NETDEV();
 	skb->protocol = htons(ETH_P_MAP);
+	ipa3_dp_lat_netif_rx(IPA_CLIENT_APPS_WAN_CONS, skb);
 
-	if (dev->stats.rx_packets % IPA_WWAN_RX_SOFTIRQ_THRESH == 0) {
+	if (wwan_ptr->napi_polling) {
+		result = napi_gro_receive(&wwan_ptr->napi, skb) == GRO_DROP;
+	} else if (dev->stats.rx_packets % IPA_WWAN_RX_SOFTIRQ_THRESH == 0) {
 		trace_rmnet_ipa_netifni3(dev->stats.rx_packets);
 		result = netif_rx_ni(skb);
 	} else {
@@ -1251,6 +1269,27 @@ static void apps_ipa_packet_receive_notify(void *priv,
 	dev->stats.rx_bytes += packet_len;
 }
 
+/**
+ * ipa3_wwan_poll() - NAPI poll handler of the IPA->APPS pipe
+ * @napi: NAPI context
+ * @budget: maximal number of packets to receive
+ *
+ * Return codes:
+ * number of packets received
+ */
+static int ipa3_wwan_poll(struct napi_struct *napi, int budget)
+{
+	struct ipa3_wwan_private *wwan_ptr =
+		container_of(napi, struct ipa3_wwan_private, napi);
+	int rcvd;
+
+	wwan_ptr->napi_polling = true;
+	rcvd = ipa3_rx_poll(rmnet_ipa3_ctx->ipa3_to_apps_hdl, budget);
+	wwan_ptr->napi_polling = false;
+
+	return rcvd;
+}
+
 /**
  * handle3_egress_format() - Egress data format configuration
  *
@@ -1680,6 +1719,7 @@ static int ipa3_wwan_ioctl(struct net_device *dev, struct ifreq *ifr, int cmd)
 			rmnet_ipa3_ctx->ipa_to_apps_ep_cfg.desc_fifo_sz =
 				IPA_SYS_DESC_FIFO_SZ;
 			rmnet_ipa3_ctx->ipa_to_apps_ep_cfg.priv = dev;
+			rmnet_ipa3_ctx->ipa_to_apps_ep_cfg.napi_enabled = true;
 
 			mutex_lock(&rmnet_ipa3_ctx->pipe_handle_guard);
 			if (atomic_read(&rmnet_ipa3_ctx->is_ssr)) {
@@ -2164,6 +2204,9 @@ static int ipa3_wwan_probe(struct platform_device *pdev)
 	spin_lock_init(&rmnet_ipa3_ctx->wwan_priv->lock);
 	init_completion(
 		&rmnet_ipa3_ctx->wwan_priv->resource_granted_completion);
+	netif_napi_add(dev, &rmnet_ipa3_ctx->wwan_priv->napi,
+		ipa3_wwan_poll, NAPI_POLL_WEIGHT);
+	napi_enable(&rmnet_ipa3_ctx->wwan_priv->napi);
 
 	if (!atomic_read(&rmnet_ipa3_ctx->is_ssr)) {
 		/* IPA_RM configuration starts */
@@ -2278,6 +2321,7 @@ static int ipa3_wwan_remove(struct platform_device *pdev)
 
 	pr_info("rmnet_ipa started deinitialization\n");
 	mutex_lock(&rmnet_ipa3_ctx->pipe_handle_guard);
+	napi_disable(&rmnet_ipa3_ctx->wwan_priv->napi);
 	ret = ipa3_teardown_sys_pipe(rmnet_ipa3_ctx->ipa3_to_apps_hdl);
 	if (ret < 0)
 		IPAWANERR("Failed to teardown IPA->APPS pipe\n");
@@ -2307,8 +2351,10 @@ static int ipa3_wwan_remove(struct platform_device *pdev)
 		IPA_RM_RESOURCE_WWAN_0_PROD, ret);
 	cancel_work_sync(&ipa3_tx_wakequeue_work);
 	cancel_delayed_work(&ipa_tether_stats_poll_wakequeue_work);
-	if (IPA_NETDEV())
+	if (IPA_NETDEV()) {
+		netif_napi_del(&rmnet_ipa3_ctx->wwan_priv->napi);
 		free_netdev(IPA_NETDEV());
+	}
 	rmnet_ipa3_ctx->wwan_priv = NULL;
 	/* No need to remove wwan_ioctl during SSR */
 	if (!atomic_read(&rmnet_ipa3_ctx->is_ssr))
@@ -21,6 +21,8 @@
 #define IPA_DMA_TEST_LOOP_NUM			1000
 #define IPA_DMA_TEST_INT_LOOP_NUM		50
 #define IPA_DMA_TEST_ASYNC_PARALLEL_LOOP_NUM	128
+#define IPA_DMA_TEST_BATCH_NUM			64
+#define IPA_DMA_TEST_BATCH_LOOP_NUM		100
 #define IPA_DMA_RUN_TEST_UNIT_IN_LOOP(test_unit, iters, rc, args...)	\
 	do {								\
 		int __i;						\
@@ -48,6 +50,17 @@ struct ipa_test_dma_async_user_data {
 	struct completion copy_done;
 };
 
+/**
+ * struct ipa_test_dma_batch_user_data - user_data structure for counting
+ *	async memcpy completions
+ * @pending: number of copies not yet completed
+ * @copy_done: Completion object, completed once no copy is pending
+ */
+struct ipa_test_dma_batch_user_data {
+	atomic_t pending;
+	struct completion copy_done;
+};
+
 /**
  * ipa_test_dma_setup() - Suite setup function
  */
@@ -1043,6 +1056,163 @@ static int ipa_test_dma_parallel_async_memcpy_in_loop(void *priv)
 	return 0;
 }
 
+static void ipa_test_dma_batch_memcpy_cb(void *user_param)
+{
+	struct ipa_test_dma_batch_user_data *udata =
+		(struct ipa_test_dma_batch_user_data *)user_param;
+
+	if (!udata) {
+		IPA_UT_ERR("Invalid user param\n");
+		return;
+	}
+
+	if (atomic_dec_and_test(&udata->pending))
+		complete(&udata->copy_done);
+}
+
+/**
+ * ipa_test_dma_batch_run() - copy src to dest in IPA_DMA_TEST_BATCH_NUM chunks
+ *
+ * @descs: chunk copies
+ * @batch: use a single batch submission instead of one async memcpy per chunk
+ * @udata: completion counting user data
+ */
+static int ipa_test_dma_batch_run(struct ipa_dma_memcpy_desc *descs,
+	bool batch, struct ipa_test_dma_batch_user_data *udata)
+{
+	int rc;
+	int i;
+
+	init_completion(&udata->copy_done);
+	if (batch) {
+		atomic_set(&udata->pending, 1);
+		rc = ipa_dma_async_memcpy_batch(descs, IPA_DMA_TEST_BATCH_NUM,
+			ipa_test_dma_batch_memcpy_cb, udata);
+		if (rc) {
+			IPA_UT_LOG("batch memcpy initiation fail rc=%d\n", rc);
+			return rc;
+		}
+	} else {
+		atomic_set(&udata->pending, IPA_DMA_TEST_BATCH_NUM);
+		for (i = 0; i < IPA_DMA_TEST_BATCH_NUM; i++) {
+			rc = ipa_dma_async_memcpy(descs[i].dest, descs[i].src,
+				descs[i].len, ipa_test_dma_batch_memcpy_cb,
+				udata);
+			if (rc) {
+				IPA_UT_LOG(
+					"async memcpy initiation fail i=%d rc=%d\n",
+					i, rc);
+				/* wait for the copies already queued */
+				if (atomic_sub_and_test(
+					IPA_DMA_TEST_BATCH_NUM - i,
+					&udata->pending))
+					return rc;
+				wait_for_completion(&udata->copy_done);
+				return rc;
+			}
+		}
+	}
+
+	wait_for_completion(&udata->copy_done);
+
+	return 0;
+}
+
+/**
+ * TEST: Batched async memory copy throughput
+ *
+ *	1. dma enable
+ *	2. copy a buffer in small chunks with one async memcpy per chunk, in
+ *	   loop, and measure the throughput
+ *	3. copy the same buffer with one batch of async memcpy, in loop, and
+ *	   measure the throughput
+ *	4. compare src and dest after each of the above, dest is cleared
+ *	   before each
+ *	5. dma disable
+ */
+static int ipa_test_dma_async_memcpy_batch_throughput(void *priv)
+{
+	int rc;
+	int i, j;
+	int chunk_sz = IPA_TEST_DMA_MEMCPY_BUFF_SIZE / IPA_DMA_TEST_BATCH_NUM;
+	struct ipa_mem_buffer src_mem;
+	struct ipa_mem_buffer dest_mem;
+	struct ipa_dma_memcpy_desc descs[IPA_DMA_TEST_BATCH_NUM];
+	struct ipa_test_dma_batch_user_data udata;
+	u64 bytes = (u64)IPA_TEST_DMA_MEMCPY_BUFF_SIZE *
+		IPA_DMA_TEST_BATCH_LOOP_NUM;
+	u64 start, time_ns[2];
+
+	IPA_UT_LOG("Test Start\n");
+
+	rc = ipa_dma_enable();
+	if (rc) {
+		IPA_UT_LOG("DMA enable failed rc=%d\n", rc);
+		IPA_UT_TEST_FAIL_REPORT("fail enable dma");
+		return rc;
+	}
+
+	rc = ipa_test_dma_alloc_buffs(&src_mem, &dest_mem,
+		IPA_TEST_DMA_MEMCPY_BUFF_SIZE);
+	if (rc) {
+		IPA_UT_LOG("fail to alloc buffers\n");
+		IPA_UT_TEST_FAIL_REPORT("fail to alloc buffers");
+		(void)ipa_dma_disable();
+		return rc;
+	}
+
+	for (i = 0; i < IPA_DMA_TEST_BATCH_NUM; i++) {
+		descs[i].dest = dest_mem.phys_base + i * chunk_sz;
+		descs[i].src = src_mem.phys_base + i * chunk_sz;
+		descs[i].len = chunk_sz;
+	}
+
+	for (j = 0; j < 2; j++) {
+		memset(dest_mem.base, 0, dest_mem.size);
+		start = ktime_get_ns();
+		for (i = 0; i < IPA_DMA_TEST_BATCH_LOOP_NUM; i++) {
+			rc = ipa_test_dma_batch_run(descs, j, &udata);
+			if (rc) {
+				IPA_UT_TEST_FAIL_REPORT(
+					"async memcpy initiate failed");
+				goto free_buffs;
+			}
+		}
+		time_ns[j] = ktime_get_ns() - start;
+
+		rc = memcmp(dest_mem.base, src_mem.base, dest_mem.size);
+		if (rc) {
+			IPA_UT_LOG("BAD memcpy - buffs are not equal (%s)\n",
+				j ? "batch" : "single");
+			IPA_UT_TEST_FAIL_REPORT(
+				"BAD memcpy - buffs are not equal");
+			rc = -EFAULT;
+			goto free_buffs;
+		}
+	}
+
+	IPA_UT_LOG("%d x %dB copies: single %llu KB/s batch %llu KB/s\n",
+		IPA_DMA_TEST_BATCH_NUM, chunk_sz,
+		div64_u64(bytes * NSEC_PER_SEC, (time_ns[0] ? : 1) * 1024),
+		div64_u64(bytes * NSEC_PER_SEC, (time_ns[1] ? : 1) * 1024));
+
+free_buffs:
+	ipa_test_dma_destroy_buffs(&src_mem, &dest_mem);
+	if (rc) {
+		(void)ipa_dma_disable();
+		return rc;
+	}
+
+	rc = ipa_dma_disable();
+	if (rc) {
+		IPA_UT_LOG("DMA disable failed rc=%d\n", rc);
+		IPA_UT_TEST_FAIL_REPORT("fail disable dma");
+		return rc;
+	}
+
+	return 0;
+}
+
 /**
  * TEST: Sync memory copy
  *
@@ -1141,4 +1311,8 @@ IPA_UT_DEFINE_SUITE_START(dma, "DMA for GSI",
 		"Sync memory copy with max packet size",
 		ipa_test_dma_sync_memcpy_max_pkt_size,
 		true, IPA_HW_v3_0, IPA_HW_MAX),
+	IPA_UT_ADD_TEST(async_memcpy_batch_throughput,
+		"Batched async memory copy throughput",
+		ipa_test_dma_async_memcpy_batch_throughput,
+		true, IPA_HW_v3_0, IPA_HW_MAX),
 } IPA_UT_DEFINE_SUITE_END(dma);
@@ -153,6 +153,45 @@ static inline struct msm_bus_node_device_type *to_msm_bus_node(struct device *d)
 int msm_bus_enable_limiter(struct msm_bus_node_device_type *nodedev,
 				int throttle_en, uint64_t lim_bw);
 int msm_bus_commit_data(struct list_head *clist);
+
+enum msm_bus_lat_type {
+	MSM_BUS_LAT_TOTAL,
+	MSM_BUS_LAT_AGG,
+	MSM_BUS_LAT_SEND,
+	MSM_BUS_LAT_ACK,
+	MSM_BUS_LAT_NR,
+};
+
+/* Latency buckets grow by 4x from 16us up; the last one is open ended */
+#define MSM_BUS_LAT_BUCKETS	7
+
+/*
+ * Vote statistics of all clients registered under one name. Entries are
+ * never freed so that the history survives clients coming and going.
+ */
+struct msm_bus_vote_stats {
+	struct list_head link;
+	char *name;
+	u64 votes;
+	u64 redundant;
+	u64 commits;
+	u64 rpm_msgs;
+	u64 total_us[MSM_BUS_LAT_NR];
+	u32 max_us[MSM_BUS_LAT_NR];
+	u32 hist[MSM_BUS_LAT_NR][MSM_BUS_LAT_BUCKETS];
+};
+
+/* RPM time spent by the ongoing commit, filled in by send_rpm_msg() */
+struct msm_bus_rpm_times {
+	u64 send_ns;
+	u64 ack_ns;
+	unsigned int msgs;
+};
+
+struct seq_file;
+
+extern struct msm_bus_rpm_times msm_bus_rpm_times;
+int msm_bus_vote_stats_show(struct seq_file *m, void *unused);
 void *msm_bus_realloc_devmem(struct device *dev, void *p, size_t old_size,
 					size_t new_size, gfp_t flags);
 
@@ -11,11 +11,14 @@
  */
 #include <linux/kernel.h>
 #include <linux/init.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
 #include <linux/module.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/rtmutex.h>
 #include <linux/clk.h>
+#include <linux/workqueue.h>
 #include <linux/msm-bus.h>
 #include "msm_bus_core.h"
 #include "msm_bus_adhoc.h"
@@ -35,13 +38,139 @@ struct handle_type {
 	struct msm_bus_client **cl_list;
 };
 
+/* Route found by getpath(), from the destination back to the source */
+struct path_cache_type {
+	struct list_head link;
+	int src;
+	int dest;
+	int num_hops;
+	struct device *hops[0];
+};
+
 static struct handle_type handle_list;
 static LIST_HEAD(input_list);
 static LIST_HEAD(apply_list);
 static LIST_HEAD(commit_list);
+static LIST_HEAD(path_cache);
 
 DEFINE_RT_MUTEX(msm_bus_adhoc_lock);
 
+/*
+ * Requests that only lower bandwidth are committed at most once every
+ * commit_epoch_ms, together with whatever else came in meanwhile; any
+ * increase is committed right away along with everything pending.
+ */
+static unsigned int commit_epoch_ms = 1;
+module_param(commit_epoch_ms, uint, 0644);
+static bool commit_urgent;
+
+static void commit_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(commit_work, commit_work_fn);
+
+static LIST_HEAD(vote_stats_list);
+/* Commits that ran off the epoch work rather than in a client's context */
+static struct msm_bus_vote_stats deferred_stats = {
+	.name = "deferred-commit",
+};
+
+/* Called with msm_bus_adhoc_lock held */
+static struct msm_bus_vote_stats *get_vote_stats(const char *name)
+{
+	struct msm_bus_vote_stats *stats;
+
+	if (!name)
+		return NULL;
+
+	list_for_each_entry(stats, &vote_stats_list, link) {
+		if (!strcmp(stats->name, name))
+			return stats;
+	}
+
+	stats = kzalloc(sizeof(*stats), GFP_KERNEL);
+	if (!stats)
+		return NULL;
+
+	stats->name = kstrdup(name, GFP_KERNEL);
+	if (!stats->name) {
+		kfree(stats);
+		return NULL;
+	}
+	list_add_tail(&stats->link, &vote_stats_list);
+	return stats;
+}
+
+static void vote_stats_add(struct msm_bus_vote_stats *stats,
+				enum msm_bus_lat_type type, u64 ns)
+{
+	u32 us = min_t(u64, div_u64(ns, NSEC_PER_USEC), U32_MAX);
+	u32 limit = 16;
+	int i;
+
+	for (i = 0; i < MSM_BUS_LAT_BUCKETS - 1 && us >= limit; i++)
+		limit <<= 2;
+
+	stats->hist[type][i]++;
+	stats->total_us[type] += us;
+	stats->max_us[type] = max(stats->max_us[type], us);
+}
+
+/* Called with msm_bus_adhoc_lock held */
+static void account_vote(struct msm_bus_vote_stats *stats, const char *name,
+				ktime_t start, bool redundant)
+{
+	if (redundant)
+		trace_bus_redundant_vote(name);
+
+	if (!stats)
+		return;
+
+	stats->votes++;
+	if (redundant)
+		stats->redundant++;
+	else
+		vote_stats_add(stats, MSM_BUS_LAT_TOTAL,
+				ktime_to_ns(ktime_sub(ktime_get(), start)));
+}
+
+static void vote_stats_show_one(struct seq_file *m,
+				struct msm_bus_vote_stats *stats)
+{
+	static const char * const lat_names[MSM_BUS_LAT_NR] = {
+		[MSM_BUS_LAT_TOTAL]	= "total",
+		[MSM_BUS_LAT_AGG]	= "agg",
+		[MSM_BUS_LAT_SEND]	= "send",
+		[MSM_BUS_LAT_ACK]	= "ack",
+	};
+	int type, i;
+
+	seq_printf(m, "%s: votes=%llu redundant=%llu commits=%llu rpm_msgs=%llu\n",
+			stats->name, stats->votes, stats->redundant,
+			stats->commits, stats->rpm_msgs);
+	for (type = 0; type < MSM_BUS_LAT_NR; type++) {
+		seq_printf(m, "\t%-5s sum_us=%llu max_us=%u hist:",
+				lat_names[type], stats->total_us[type],
+				stats->max_us[type]);
+		for (i = 0; i < MSM_BUS_LAT_BUCKETS; i++)
+			seq_printf(m, " %u", stats->hist[type][i]);
+		seq_putc(m, '\n');
+	}
+}
+
+int msm_bus_vote_stats_show(struct seq_file *m, void *unused)
+{
+	struct msm_bus_vote_stats *stats;
+
+	seq_puts(m, "hist buckets (us): <16 <64 <256 <1024 <4096 <16384 >=16384\n");
+
+	rt_mutex_lock(&msm_bus_adhoc_lock);
+	vote_stats_show_one(m, &deferred_stats);
+	list_for_each_entry(stats, &vote_stats_list, link)
+		vote_stats_show_one(m, stats);
+	rt_mutex_unlock(&msm_bus_adhoc_lock);
+
+	return 0;
+}
+
 static bool chk_bl_list(struct list_head *black_list, unsigned int id)
 {
 	struct msm_bus_node_device_type *bus_node = NULL;
@@ -395,6 +524,88 @@ exit_getpath:
 	return first_hop;
 }
 
+static struct path_cache_type *find_cached_path(int src, int dest)
+{
+	struct path_cache_type *path;
+
+	list_for_each_entry(path, &path_cache, link)
+		if (path->src == src && path->dest == dest)
+			return path;
+
+	return NULL;
+}
+
+/* Remember the route getpath() just laid out starting at @first_hop */
+static void cache_path(struct msm_bus_node_device_type *src_node, int dest,
+			int first_hop)
+{
+	struct msm_bus_node_device_type *node = src_node;
+	struct path_cache_type *path;
+	struct device *dev = &src_node->dev;
+	struct link_node *lnode;
+	int idx = first_hop, num_hops = 0;
+
+	while (dev) {
+		node = to_msm_bus_node(dev);
+		lnode = &node->lnode_list[idx];
+		idx = lnode->next;
+		dev = lnode->next_dev;
+		num_hops++;
+	}
+
+	path = kzalloc(sizeof(*path) + num_hops * sizeof(dev), GFP_KERNEL);
+	if (!path)
+		return;
+
+	path->src = src_node->node_info->id;
+	path->dest = dest;
+	path->num_hops = num_hops;
+
+	dev = &src_node->dev;
+	idx = first_hop;
+	while (dev) {
+		node = to_msm_bus_node(dev);
+		path->hops[--num_hops] = dev;
+		lnode = &node->lnode_list[idx];
+		idx = lnode->next;
+		dev = lnode->next_dev;
+	}
+
+	list_add_tail(&path->link, &path_cache);
+}
+
+/*
+ * The topology doesn't change once probed, so the route between a src and
+ * a dest only needs to be searched for once; clients registering again
+ * just get fresh link nodes along the known route.
+ */
+static int getpath_cached(struct device *src_dev, int dest,
+			const char *cl_name)
+{
+	struct msm_bus_node_device_type *src_node = to_msm_bus_node(src_dev);
+	struct path_cache_type *path;
+	int i, hop;
+
+	if (!src_node)
+		return getpath(src_dev, dest, cl_name);
+
+	path = find_cached_path(src_node->node_info->id, dest);
+	if (!path) {
+		hop = getpath(src_dev, dest, cl_name);
+		if (hop >= 0)
+			cache_path(src_node, dest, hop);
+		return hop;
+	}
+
+	hop = gen_lnode(path->hops[0], dest, -1, cl_name);
+	for (i = 1; i < path->num_hops && hop >= 0; i++)
+		hop = gen_lnode(path->hops[i],
+			to_msm_bus_node(path->hops[i - 1])->node_info->id,
+			hop, cl_name);
+
+	return hop;
+}
+
 static uint64_t scheme1_agg_scheme(struct msm_bus_node_device_type *bus_dev,
 			struct msm_bus_node_device_type *fab_dev, int ctx)
 {
@@ -655,9 +866,43 @@ static int msm_bus_apply_rules(struct list_head *list, bool after_clk_commit)
 	return ret;
 }
 
-static void commit_data(void)
+/*
+ * Aggregate every node touched since the last commit once, then commit
+ * them all in one go. The time spent is accounted to @stats.
+ */
+static void __commit_data(struct msm_bus_vote_stats *stats)
 {
 	bool rules_registered = msm_rule_are_rules_registered();
+	struct msm_bus_rpm_times *rpm = &msm_bus_rpm_times;
+	struct msm_bus_node_device_type *node;
+	struct rule_update_path_info *rule_node;
+	ktime_t start = ktime_get();
+	u64 agg_ns;
+	int ctx;
+
+	memset(rpm, 0, sizeof(*rpm));
+	list_for_each_entry(node, &commit_list, link) {
+		if (node->node_info->is_fab_dev)
+			continue;
+
+		for (ctx = 0; ctx < NUM_CTX; ctx++)
+			node->node_bw[ctx].cur_clk_hz =
+					aggregate_bus_req(node, ctx);
+
+		if (rules_registered) {
+			rule_node = &node->node_info->rule;
+			rule_node->id = node->node_info->id;
+			rule_node->ib = node->node_bw[ACTIVE_CTX].max_ib;
+			rule_node->ab = node->node_bw[ACTIVE_CTX].sum_ab;
+			rule_node->clk = node->node_bw[ACTIVE_CTX].cur_clk_hz;
+			if (!rule_node->added) {
+				list_add_tail(&rule_node->link, &input_list);
+				rule_node->added = true;
+			}
+		}
+	}
+
+	agg_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
 
 	if (rules_registered) {
 		msm_rules_update_path(&input_list, &apply_list);
@@ -666,6 +911,18 @@ static void commit_data(void)
 
 	msm_bus_commit_data(&commit_list);
 
+	trace_bus_commit_latency(stats ? stats->name : "unknown", agg_ns,
+				rpm->send_ns, rpm->ack_ns, rpm->msgs);
+	if (stats) {
+		stats->commits++;
+		stats->rpm_msgs += rpm->msgs;
+		vote_stats_add(stats, MSM_BUS_LAT_AGG, agg_ns);
+		if (rpm->msgs) {
+			vote_stats_add(stats, MSM_BUS_LAT_SEND, rpm->send_ns);
+			vote_stats_add(stats, MSM_BUS_LAT_ACK, rpm->ack_ns);
+		}
+	}
+
 	if (rules_registered) {
 		msm_bus_apply_rules(&apply_list, true);
 		del_inp_list(&input_list);
@@ -674,6 +931,42 @@ static void commit_data(void)
 	INIT_LIST_HEAD(&input_list);
 	INIT_LIST_HEAD(&apply_list);
 	INIT_LIST_HEAD(&commit_list);
+	commit_urgent = false;
+}
+
+static void commit_work_fn(struct work_struct *work)
+{
+	rt_mutex_lock(&msm_bus_adhoc_lock);
+	if (!list_empty(&commit_list))
+		__commit_data(&deferred_stats);
+	rt_mutex_unlock(&msm_bus_adhoc_lock);
+}
+
+/* Called with msm_bus_adhoc_lock held */
+static void commit_data(struct msm_bus_vote_stats *stats)
+{
+	if (list_empty(&commit_list))
+		return;
+
+	if (commit_urgent || !commit_epoch_ms) {
+		cancel_delayed_work(&commit_work);
+		__commit_data(stats);
+	} else if (!delayed_work_pending(&commit_work)) {
+		schedule_delayed_work(&commit_work,
+				msecs_to_jiffies(commit_epoch_ms));
+	}
+}
+
+/*
+ * Nodes waiting on commit_list are linked through the same list head the
+ * path search uses, so get them out before searching.
+ */
+static void flush_commit_data(void)
+{
+	if (!list_empty(&commit_list)) {
+		cancel_delayed_work(&commit_work);
+		__commit_data(&deferred_stats);
+	}
 }
 
 static void add_node_to_clist(struct msm_bus_node_device_type *node)
@@ -702,8 +995,6 @@ static int update_path(struct device *src_dev, int dest, uint64_t act_req_ib,
 	struct msm_bus_node_device_type *dev_info = NULL;
 	int curr_idx;
 	int ret = 0;
-	struct rule_update_path_info *rule_node;
-	bool rules_registered = msm_rule_are_rules_registered();
 
 	if (IS_ERR_OR_NULL(src_dev)) {
 		MSM_BUS_ERR("%s: No source device", __func__);
@@ -720,8 +1011,10 @@ static int update_path(struct device *src_dev, int dest, uint64_t act_req_ib,
 	}
 	curr_idx = src_idx;
 
+	if (act_req_ib > cur_ib || act_req_bw > cur_bw)
+		commit_urgent = true;
+
 	while (next_dev) {
-		int i;
 		dev_info = to_msm_bus_node(next_dev);
 
 		if (curr_idx >= dev_info->num_lnodes) {
@@ -743,25 +1036,9 @@ static int update_path(struct device *src_dev, int dest, uint64_t act_req_ib,
 		lnode->lnode_ib[DUAL_CTX] = slp_req_ib;
 		lnode->lnode_ab[DUAL_CTX] = slp_req_bw;
 
-		for (i = 0; i < NUM_CTX; i++)
-			dev_info->node_bw[i].cur_clk_hz =
-					aggregate_bus_req(dev_info, i);
-
+		/* Aggregated once for all requests at commit time */
 		add_node_to_clist(dev_info);
 
-		if (rules_registered) {
-			rule_node = &dev_info->node_info->rule;
-			rule_node->id = dev_info->node_info->id;
-			rule_node->ib = dev_info->node_bw[ACTIVE_CTX].max_ib;
-			rule_node->ab = dev_info->node_bw[ACTIVE_CTX].sum_ab;
-			rule_node->clk =
-				dev_info->node_bw[ACTIVE_CTX].cur_clk_hz;
-			if (!rule_node->added) {
-				list_add_tail(&rule_node->link, &input_list);
-				rule_node->added = true;
-			}
-		}
-
 		next_dev = lnode->next_dev;
 		curr_idx = lnode->next;
 	}
@@ -905,7 +1182,7 @@ static void unregister_client_adhoc(uint32_t cl)
 		remove_path(src_dev, dest, cur_clk, cur_bw, lnode,
 						pdata->active_only);
 	}
-	commit_data();
+	commit_data(client->stats);
 	msm_bus_dbg_client_data(client->pdata, MSM_BUS_DBG_UNREGISTER, cl);
 	kfree(client->src_pnode);
 	kfree(client->src_devs);
@@ -1032,7 +1309,8 @@ static uint32_t register_client_adhoc(struct msm_bus_scale_pdata *pdata)
 		}
 		client->src_devs[i] = dev;
 
-		lnode[i] = getpath(dev, dest, client->pdata->name);
+		flush_commit_data();
+		lnode[i] = getpath_cached(dev, dest, client->pdata->name);
 		if (lnode[i] < 0) {
 			MSM_BUS_ERR("%s:Failed to find path.src %d dest %d",
 				__func__, src, dest);
@@ -1040,6 +1318,7 @@ static uint32_t register_client_adhoc(struct msm_bus_scale_pdata *pdata)
 		}
 	}
 
+	client->stats = get_vote_stats(pdata->name);
 	handle = gen_handle(client);
 	msm_bus_dbg_client_data(client->pdata, MSM_BUS_DBG_REGISTER,
 					handle);
@@ -1121,7 +1400,7 @@ static int update_client_paths(struct msm_bus_client *client, bool log_trns,
 		if (log_trns)
 			getpath_debug(src, lnode, pdata->active_only);
 	}
-	commit_data();
+	commit_data(client->stats);
 exit_update_client_paths:
 	return ret;
 }
@@ -1132,6 +1411,7 @@ static int update_context(uint32_t cl, bool active_only,
 	int ret = 0;
 	struct msm_bus_scale_pdata *pdata;
 	struct msm_bus_client *client;
+	ktime_t start = ktime_get();
 
 	rt_mutex_lock(&msm_bus_adhoc_lock);
 	if (!cl) {
@@ -1154,6 +1434,7 @@ static int update_context(uint32_t cl, bool active_only,
 	if (pdata->active_only == active_only) {
 		MSM_BUS_ERR("No change in context(%d==%d), skip\n",
 					pdata->active_only, active_only);
+		account_vote(client->stats, pdata->name, start, true);
 		ret = -ENXIO;
 		goto exit_update_context;
 	}
@@ -1174,6 +1455,7 @@ static int update_context(uint32_t cl, bool active_only,
 		goto exit_update_context;
 	}
 
+	account_vote(client->stats, pdata->name, start, false);
 	trace_bus_update_request_end(pdata->name);
 
 exit_update_context:
@@ -1188,6 +1470,7 @@ static int update_request_adhoc(uint32_t cl, unsigned int index)
 	struct msm_bus_client *client;
 	const char *test_cl = "Null";
 	bool log_transaction = false;
+	ktime_t start = ktime_get();
 
 	rt_mutex_lock(&msm_bus_adhoc_lock);
 
@@ -1222,6 +1505,7 @@ static int update_request_adhoc(uint32_t cl, unsigned int index)
 	if (client->curr == index) {
 		MSM_BUS_DBG("%s: Not updating client request idx %d unchanged",
 				__func__, index);
+		account_vote(client->stats, pdata->name, start, true);
 		goto exit_update_request;
 	}
 
@@ -1237,6 +1521,7 @@ static int update_request_adhoc(uint32_t cl, unsigned int index)
 		goto exit_update_request;
 	}
 
+	account_vote(client->stats, pdata->name, start, false);
 	trace_bus_update_request_end(pdata->name);
 
 exit_update_request:
@@ -1259,6 +1544,7 @@ static int update_bw_adhoc(struct msm_bus_client_handle *cl, u64 ab, u64 ib)
 	char *test_cl = "test-client";
 	bool log_transaction = false;
 	u64 slp_ib, slp_ab;
+	ktime_t start = ktime_get();
 
 	rt_mutex_lock(&msm_bus_adhoc_lock);
 
@@ -1275,6 +1561,7 @@ static int update_bw_adhoc(struct msm_bus_client_handle *cl, u64 ab, u64 ib)
 
 	if ((cl->cur_act_ib == ib) && (cl->cur_act_ab == ab)) {
 		MSM_BUS_DBG("%s:no change in request", cl->name);
+		account_vote(cl->stats, cl->name, start, true);
 		goto exit_update_request;
 	}
 
@@ -1295,7 +1582,7 @@ static int update_bw_adhoc(struct msm_bus_client_handle *cl, u64 ab, u64 ib)
 		goto exit_update_request;
 	}
 
-	commit_data();
+	commit_data(cl->stats);
 	cl->cur_act_ib = ib;
 	cl->cur_act_ab = ab;
 	cl->cur_slp_ib = slp_ib;
@@ -1303,6 +1590,7 @@ static int update_bw_adhoc(struct msm_bus_client_handle *cl, u64 ab, u64 ib)
 
 	if (log_transaction)
 		getpath_debug(cl->mas, cl->first_hop, cl->active_only);
+	account_vote(cl->stats, cl->name, start, false);
 	trace_bus_update_request_end(cl->name);
 exit_update_request:
 	rt_mutex_unlock(&msm_bus_adhoc_lock);
@@ -1314,6 +1602,7 @@ static int update_bw_context(struct msm_bus_client_handle *cl, u64 act_ab,
 				u64 act_ib, u64 slp_ib, u64 slp_ab)
 {
 	int ret = 0;
+	ktime_t start = ktime_get();
 
 	rt_mutex_lock(&msm_bus_adhoc_lock);
 	if (!cl) {
@@ -1327,6 +1616,7 @@ static int update_bw_context(struct msm_bus_client_handle *cl, u64 act_ab,
 		(cl->cur_slp_ib == slp_ib) &&
 		(cl->cur_slp_ab == slp_ab)) {
 		MSM_BUS_ERR("No change in vote");
+		account_vote(cl->stats, cl->name, start, true);
 		goto exit_change_context;
 	}
 
@@ -1341,11 +1631,12 @@ static int update_bw_context(struct msm_bus_client_handle *cl, u64 act_ab,
 				__func__, ret, cl->active_only);
 		goto exit_change_context;
 	}
-	commit_data();
+	commit_data(cl->stats);
 	cl->cur_act_ib = act_ib;
 	cl->cur_act_ab = act_ab;
 	cl->cur_slp_ib = slp_ib;
 	cl->cur_slp_ab = slp_ab;
+	account_vote(cl->stats, cl->name, start, false);
 	trace_bus_update_request_end(cl->name);
 exit_change_context:
 	rt_mutex_unlock(&msm_bus_adhoc_lock);
@@ -1365,7 +1656,7 @@ static void unregister_adhoc(struct msm_bus_client_handle *cl)
 
 	remove_path(cl->mas_dev, cl->slv, cl->cur_act_ib, cl->cur_act_ab,
 				cl->first_hop, cl->active_only);
-	commit_data();
+	commit_data(cl->stats);
 	msm_bus_dbg_remove_client(cl);
 	kfree(cl->name);
 	kfree(cl);
@@ -1417,7 +1708,9 @@ register_adhoc(uint32_t mas, uint32_t slv, char *name, bool active_only)
 		goto exit_register;
 	}
 
-	client->first_hop = getpath(client->mas_dev, client->slv, client->name);
+	flush_commit_data();
+	client->first_hop = getpath_cached(client->mas_dev, client->slv,
+						client->name);
 	if (client->first_hop < 0) {
 		MSM_BUS_ERR("%s:Failed to find path.src %d dest %d",
 			__func__, client->mas, client->slv);
@@ -1425,6 +1718,7 @@ register_adhoc(uint32_t mas, uint32_t slv, char *name, bool active_only)
 		goto exit_register;
 	}
 
+	client->stats = get_vote_stats(client->name);
 	MSM_BUS_DBG("%s:Client handle %p %s", __func__, client,
 						client->name);
 	msm_bus_dbg_add_client(client);
@@ -275,12 +275,15 @@ struct msm_bus_fabnodeinfo {
 	struct msm_bus_inode_info *info;
 };
 
+struct msm_bus_vote_stats;
+
 struct msm_bus_client {
 	int id;
 	struct msm_bus_scale_pdata *pdata;
 	int *src_pnode;
 	int curr;
 	struct device **src_devs;
+	struct msm_bus_vote_stats *stats;
 };
 
 uint64_t msm_bus_div64(unsigned int width, uint64_t bw);
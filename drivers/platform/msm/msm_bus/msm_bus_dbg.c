@@ -669,6 +669,18 @@ static const struct file_operations rules_dbg_fops = {
 	.read		= rules_dbg_read,
 };
 
+static int vote_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_bus_vote_stats_show, NULL);
+}
+
+static const struct file_operations vote_stats_fops = {
+	.open		= vote_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int msm_bus_dbg_record_fabric(const char *fabname, struct dentry *file)
 {
 	struct msm_bus_fab_list *fablist;
@@ -893,6 +905,10 @@ static int __init msm_bus_debugfs_init(void)
 		rules_dbg, &val, &rules_dbg_fops) == NULL)
 		goto err;
 
+	if (debugfs_create_file("vote_stats", S_IRUGO, dir, NULL,
+		&vote_stats_fops) == NULL)
+		goto err;
+
 	if (debugfs_create_file("update_request", S_IRUGO | S_IWUSR,
 		shell_client, &val, &shell_client_en_fops) == NULL)
 		goto err;
@@ -15,6 +15,7 @@
 #include <linux/init.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/slab.h>
 #include <soc/qcom/rpm-smd.h>
@@ -239,6 +240,42 @@ static int setrate_nodeclk(struct nodeclk *nclk, long rate)
 	return ret;
 }
 
+struct msm_bus_rpm_times msm_bus_rpm_times;
+
+/*
+ * Same as msm_rpm_send_message(), but accounts the time spent sending the
+ * request and waiting for its ack separately.
+ */
+static int bus_rpm_send_message(int rpm_ctx, int rsc_type, int rsc_id,
+				struct msm_rpm_kvp *kvp)
+{
+	struct msm_rpm_request *req;
+	ktime_t start, sent;
+	int ret;
+
+	start = ktime_get();
+	req = msm_rpm_create_request(rpm_ctx, rsc_type, rsc_id, 1);
+	if (IS_ERR(req))
+		return PTR_ERR(req);
+	if (!req)
+		return -ENOMEM;
+
+	ret = msm_rpm_add_kvp_data(req, kvp->key, kvp->data, kvp->length);
+	if (ret)
+		goto exit_free_req;
+
+	ret = msm_rpm_send_request(req);
+	sent = ktime_get();
+	ret = msm_rpm_wait_for_ack(ret);
+
+	msm_bus_rpm_times.send_ns += ktime_to_ns(ktime_sub(sent, start));
+	msm_bus_rpm_times.ack_ns += ktime_to_ns(ktime_sub(ktime_get(), sent));
+	msm_bus_rpm_times.msgs++;
+exit_free_req:
+	msm_rpm_free_request(req);
+	return ret;
+}
+
 static int send_rpm_msg(struct msm_bus_node_device_type *ndev, int ctx)
 {
 	int ret = 0;
@@ -264,8 +301,8 @@ static int send_rpm_msg(struct msm_bus_node_device_type *ndev, int ctx)
 
 	if (ndev->node_info->mas_rpm_id != -1) {
 		rsc_type = RPM_BUS_MASTER_REQ;
-		ret = msm_rpm_send_message(rpm_ctx, rsc_type,
-			ndev->node_info->mas_rpm_id, &rpm_kvp, 1);
+		ret = bus_rpm_send_message(rpm_ctx, rsc_type,
+			ndev->node_info->mas_rpm_id, &rpm_kvp);
 		if (ret) {
 			MSM_BUS_ERR("%s: Failed to send RPM message:",
 					__func__);
@@ -281,8 +318,8 @@ static int send_rpm_msg(struct msm_bus_node_device_type *ndev, int ctx)
 
 	if (ndev->node_info->slv_rpm_id != -1) {
 		rsc_type = RPM_BUS_SLAVE_REQ;
-		ret = msm_rpm_send_message(rpm_ctx, rsc_type,
-			ndev->node_info->slv_rpm_id, &rpm_kvp, 1);
+		ret = bus_rpm_send_message(rpm_ctx, rsc_type,
+			ndev->node_info->slv_rpm_id, &rpm_kvp);
 		if (ret) {
 			MSM_BUS_ERR("%s: Failed to send RPM message:",
 						__func__);
@@ -1680,6 +1680,57 @@ int sps_transfer_one(struct sps_pipe *h, phys_addr_t addr, u32 size,
 }
 EXPORT_SYMBOL(sps_transfer_one);
 
+/**
+ * Perform a number of single buffer DMA transfers on an SPS connection end
+ * point with one lock hold and one pipe write offset update
+ *
+ */
+int sps_transfer_bulk(struct sps_pipe *h, struct sps_iovec *iovec,
+		      void **user, u32 count)
+{
+	struct sps_pipe *pipe = h;
+	struct sps_bam *bam;
+	int result;
+	u32 i;
+
+	if (h == NULL) {
+		SPS_ERR(sps, "sps:%s:pipe is NULL.\n", __func__);
+		return SPS_ERROR;
+	} else if (iovec == NULL) {
+		SPS_ERR(sps, "sps:%s:iovec list is NULL.\n", __func__);
+		return SPS_ERROR;
+	} else if (count == 0) {
+		SPS_ERR(sps, "sps:%s:iovec list is empty.\n", __func__);
+		return SPS_ERROR;
+	}
+
+	/* Verify content of IOVECs */
+	for (i = 0; i < count; i++) {
+		if (iovec[i].size > SPS_IOVEC_MAX_SIZE) {
+			SPS_ERR(sps,
+				"sps:%s:iovec size is invalid.\n", __func__);
+			return SPS_ERROR;
+		}
+
+		if (sps_check_iovec_flags(iovec[i].flags))
+			return SPS_ERROR;
+	}
+
+	bam = sps_bam_lock(pipe);
+	if (bam == NULL)
+		return SPS_ERROR;
+
+	SPS_DBG(bam, "sps:%s.\n", __func__);
+
+	result = sps_bam_pipe_transfer_bulk(bam, pipe->pipe_index, iovec,
+					    user, count);
+
+	sps_bam_unlock(bam);
+
+	return result;
+}
+EXPORT_SYMBOL(sps_transfer_bulk);
+
 /**
  * Read event queue for an SPS connection end point
  *
@@ -2369,6 +2420,43 @@ int sps_get_iovec(struct sps_pipe *h, struct sps_iovec *iovec)
 }
 EXPORT_SYMBOL(sps_get_iovec);
 
+/**
+ * Get a number of processed I/O vectors (completed transfers)
+ *
+ */
+int sps_get_iovecs(struct sps_pipe *h, struct sps_iovec *iovec, u32 max,
+		   u32 *count)
+{
+	struct sps_pipe *pipe = h;
+	struct sps_bam *bam;
+	int result;
+
+	if (h == NULL) {
+		SPS_ERR(sps, "sps:%s:pipe is NULL.\n", __func__);
+		return SPS_ERROR;
+	} else if (iovec == NULL || count == NULL) {
+		SPS_ERR(sps, "sps:%s:iovec or count pointer is NULL.\n",
+			__func__);
+		return SPS_ERROR;
+	}
+
+	bam = sps_bam_lock(pipe);
+	if (bam == NULL) {
+		SPS_ERR(sps, "sps:%s:BAM is not found by handle.\n", __func__);
+		return SPS_ERROR;
+	}
+
+	SPS_DBG(bam, "sps:%s; BAM: %pa; pipe index:%d; max:%d.\n",
+		__func__, BAM_ID(bam), pipe->pipe_index, max);
+
+	result = sps_bam_pipe_get_iovecs(bam, pipe->pipe_index, iovec, max,
+					 count);
+	sps_bam_unlock(bam);
+
+	return result;
+}
+EXPORT_SYMBOL(sps_get_iovecs);
+
 /**
  * Perform timer control
  *
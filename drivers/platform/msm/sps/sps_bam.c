@@ -1554,6 +1554,33 @@ int sps_bam_pipe_transfer_one(struct sps_bam *dev,
 	return 0;
 }
 
+/**
+ * Check that a number of descriptors can be queued on a BAM pipe
+ *
+ */
+static int sps_bam_pipe_check_free(struct sps_bam *dev, u32 pipe_index,
+				   u32 num_desc)
+{
+	struct sps_pipe *pipe = dev->pipes[pipe_index];
+	u32 count;
+
+	if (!pipe->sys.ack_xfers && pipe->polled) {
+		sps_bam_pipe_get_unused_desc_num(dev, pipe_index,
+					&count);
+		count = pipe->desc_size / sizeof(struct sps_iovec) - count - 1;
+	} else
+		sps_bam_get_free_count(dev, pipe_index, &count);
+
+	if (count < num_desc) {
+		SPS_ERR(dev,
+			"sps:Insufficient free desc: BAM %pa pipe %d: %d\n",
+			BAM_ID(dev), pipe_index, count);
+		return SPS_ERROR;
+	}
+
+	return 0;
+}
+
 /**
  * Submit a transfer to a BAM pipe
  *
@@ -1562,12 +1589,10 @@ int sps_bam_pipe_transfer(struct sps_bam *dev,
 			 u32 pipe_index, struct sps_transfer *transfer)
 {
 	struct sps_iovec *iovec;
-	u32 count;
 	u32 flags;
 	void *user;
 	int n;
 	int result;
-	struct sps_pipe *pipe = dev->pipes[pipe_index];
 
 	if (transfer->iovec_count == 0) {
 		SPS_ERR(dev, "sps:iovec count zero: BAM %pa pipe %d\n",
@@ -1575,19 +1600,8 @@ int sps_bam_pipe_transfer(struct sps_bam *dev,
 		return SPS_ERROR;
 	}
 
-	if (!pipe->sys.ack_xfers && pipe->polled) {
-		sps_bam_pipe_get_unused_desc_num(dev, pipe_index,
-					&count);
-		count = pipe->desc_size / sizeof(struct sps_iovec) - count - 1;
-	} else
-		sps_bam_get_free_count(dev, pipe_index, &count);
-
-	if (count < transfer->iovec_count) {
-		SPS_ERR(dev,
-			"sps:Insufficient free desc: BAM %pa pipe %d: %d\n",
-			BAM_ID(dev), pipe_index, count);
+	if (sps_bam_pipe_check_free(dev, pipe_index, transfer->iovec_count))
 		return SPS_ERROR;
-	}
 
 	user = NULL;		/* NULL for all except last descriptor */
 	for (n = (int)transfer->iovec_count - 1, iovec = transfer->iovec;
@@ -1611,6 +1625,43 @@ int sps_bam_pipe_transfer(struct sps_bam *dev,
 	return 0;
 }
 
+/**
+ * Submit a number of independent buffers to a BAM pipe
+ *
+ */
+int sps_bam_pipe_transfer_bulk(struct sps_bam *dev, u32 pipe_index,
+			       struct sps_iovec *iovec, void **user,
+			       u32 count)
+{
+	u32 flags;
+	u32 n;
+	int result;
+
+	if (count == 0) {
+		SPS_ERR(dev, "sps:iovec count zero: BAM %pa pipe %d\n",
+			BAM_ID(dev), pipe_index);
+		return SPS_ERROR;
+	}
+
+	if (sps_bam_pipe_check_free(dev, pipe_index, count))
+		return SPS_ERROR;
+
+	/* Only the last descriptor updates the pipe write offset */
+	for (n = 0; n < count; n++, iovec++) {
+		flags = iovec->flags;
+		if (n < count - 1)
+			flags |= SPS_IOVEC_FLAG_NO_SUBMIT;
+
+		result = sps_bam_pipe_transfer_one(dev, pipe_index,
+						 iovec->addr, iovec->size,
+						 user ? user[n] : NULL, flags);
+		if (result)
+			return SPS_ERROR;
+	}
+
+	return 0;
+}
+
 int sps_bam_pipe_inject_zlt(struct sps_bam *dev, u32 pipe_index)
 {
 	struct sps_pipe *pipe = dev->pipes[pipe_index];
@@ -2185,14 +2236,12 @@ int sps_bam_pipe_get_event(struct sps_bam *dev,
 }
 
 /**
- * Get processed I/O vector
+ * Validate a BAM pipe for get_iovec use and poll it if needed
  */
-int sps_bam_pipe_get_iovec(struct sps_bam *dev, u32 pipe_index,
-			   struct sps_iovec *iovec)
+static int sps_bam_pipe_prepare_get_iovec(struct sps_bam *dev,
+					  u32 pipe_index)
 {
 	struct sps_pipe *pipe = dev->pipes[pipe_index];
-	struct sps_iovec *desc;
-	u32 read_offset;
 
 	/* Is this a valid pipe configured for get_iovec use? */
 	if (!pipe->sys.ack_xfers ||
@@ -2210,6 +2259,21 @@ int sps_bam_pipe_get_iovec(struct sps_bam *dev, u32 pipe_index,
 		pipe_handler_eot(dev, pipe);
 	}
 
+	return 0;
+}
+
+/**
+ * Fetch the next completed descriptor of a prepared BAM pipe
+ *
+ * Returns false if there is none.
+ */
+static bool sps_bam_pipe_fetch_iovec(struct sps_bam *dev, u32 pipe_index,
+				     struct sps_iovec *iovec)
+{
+	struct sps_pipe *pipe = dev->pipes[pipe_index];
+	struct sps_iovec *desc;
+	u32 read_offset;
+
 	/* Is there a completed descriptor? */
 	if (pipe->sys.no_queue)
 		read_offset =
@@ -2217,14 +2281,8 @@ int sps_bam_pipe_get_iovec(struct sps_bam *dev, u32 pipe_index,
 	else
 		read_offset = pipe->sys.cache_offset;
 
-	if (read_offset == pipe->sys.acked_offset) {
-		/* No, so clear the iovec to indicate FIFO is empty */
-		memset(iovec, 0, sizeof(*iovec));
-		SPS_DBG(dev,
-			"sps:%s; BAM: %pa; pipe index:%d; no iovec to process.\n",
-			__func__, BAM_ID(dev), pipe_index);
-		return 0;
-	}
+	if (read_offset == pipe->sys.acked_offset)
+		return false;
 
 	/* Fetch next descriptor */
 	desc = (struct sps_iovec *) (pipe->sys.desc_buf +
@@ -2244,6 +2302,47 @@ int sps_bam_pipe_get_iovec(struct sps_bam *dev, u32 pipe_index,
 		__func__, pipe->pipe_index, (void *)(long)desc->addr,
 		desc->size, desc->flags, pipe->sys.acked_offset);
 
+	return true;
+}
+
+/**
+ * Get processed I/O vector
+ */
+int sps_bam_pipe_get_iovec(struct sps_bam *dev, u32 pipe_index,
+			   struct sps_iovec *iovec)
+{
+	if (sps_bam_pipe_prepare_get_iovec(dev, pipe_index))
+		return SPS_ERROR;
+
+	if (!sps_bam_pipe_fetch_iovec(dev, pipe_index, iovec)) {
+		/* No, so clear the iovec to indicate FIFO is empty */
+		memset(iovec, 0, sizeof(*iovec));
+		SPS_DBG(dev,
+			"sps:%s; BAM: %pa; pipe index:%d; no iovec to process.\n",
+			__func__, BAM_ID(dev), pipe_index);
+	}
+
+	return 0;
+}
+
+/**
+ * Get a number of processed I/O vectors
+ */
+int sps_bam_pipe_get_iovecs(struct sps_bam *dev, u32 pipe_index,
+			    struct sps_iovec *iovec, u32 max, u32 *count)
+{
+	u32 n = 0;
+
+	*count = 0;
+	if (sps_bam_pipe_prepare_get_iovec(dev, pipe_index))
+		return SPS_ERROR;
+
+	while (n < max && sps_bam_pipe_fetch_iovec(dev, pipe_index, iovec)) {
+		iovec++;
+		n++;
+	}
+	*count = n;
+
 	return 0;
 }
 
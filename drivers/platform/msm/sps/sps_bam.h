@@ -461,6 +461,29 @@ int sps_bam_pipe_transfer_one(struct sps_bam *dev, u32 pipe_index, u32 addr,
 int sps_bam_pipe_transfer(struct sps_bam *dev, u32 pipe_index,
 			 struct sps_transfer *transfer);
 
+/**
+ * Submit a number of independent buffers to a BAM pipe
+ *
+ * This function queues one descriptor per I/O vector and updates the pipe
+ * write offset once for the whole batch.
+ *
+ * @dev - pointer to BAM device descriptor
+ *
+ * @pipe_index - pipe index
+ *
+ * @iovec - array of I/O vectors, flags are per descriptor
+ *
+ * @user - array of user pointers, one per I/O vector, or NULL
+ *
+ * @count - number of I/O vectors
+ *
+ * @return 0 on success, negative value on error
+ *
+ */
+int sps_bam_pipe_transfer_bulk(struct sps_bam *dev, u32 pipe_index,
+			       struct sps_iovec *iovec, void **user,
+			       u32 count);
+
 /**
  * Get a BAM pipe event
  *
@@ -495,6 +518,27 @@ int sps_bam_pipe_get_event(struct sps_bam *dev, u32 pipe_index,
 int sps_bam_pipe_get_iovec(struct sps_bam *dev, u32 pipe_index,
 			   struct sps_iovec *iovec);
 
+/**
+ * Get a number of processed I/O vectors
+ *
+ * This function fetches up to max processed I/O vectors, polling the pipe
+ * only once for the whole batch.
+ *
+ * @dev - pointer to BAM device descriptor
+ *
+ * @pipe_index - pipe index
+ *
+ * @iovec - array of at least max I/O vector structs (output)
+ *
+ * @max - maximum number of I/O vectors to fetch
+ *
+ * @count - number of I/O vectors fetched (output)
+ *
+ * @return 0 on success, negative value on error
+ */
+int sps_bam_pipe_get_iovecs(struct sps_bam *dev, u32 pipe_index,
+			    struct sps_iovec *iovec, u32 max, u32 *count);
+
 /**
  * Determine whether a BAM pipe descriptor FIFO is empty
  *
@@ -27,6 +27,9 @@
 #include <linux/workqueue.h>
 #include <linux/dma-mapping.h>
 #include <linux/pm_runtime.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #define USB_THRESHOLD 512
 #define USB_BAM_MAX_STR_LEN 50
@@ -157,6 +160,14 @@ static int (*release_resource_cb[MAX_BAMS])(void)  = {
 	[DWC3_CTRL] = ss_usb_cons_release_resource,
 };
 
+/* suspend/resume latency, from the bus event to pipes stopped/started */
+struct usb_bam_latency {
+	u32 count;
+	s64 last_us;
+	s64 max_us;
+	s64 total_us;
+};
+
 struct usb_bam_ipa_handshake_info {
 	enum ipa_rm_event cur_prod_state;
 	enum ipa_rm_event cur_cons_state;
@@ -187,6 +198,11 @@ struct usb_bam_ipa_handshake_info {
 	struct mutex suspend_resume_mutex;
 	struct work_struct resume_work;
 	struct work_struct finish_suspend_work;
+
+	ktime_t suspend_start;
+	ktime_t resume_start;
+	struct usb_bam_latency suspend_lat;
+	struct usb_bam_latency resume_lat;
 };
 
 struct usb_bam_host_info {
@@ -219,6 +235,21 @@ static struct {
 };
 
 /*put_timestamp - writes time stamp to buffer */
+static void usb_bam_latency_record(struct usb_bam_latency *lat, ktime_t start)
+{
+	s64 us;
+
+	if (!ktime_to_ns(start))
+		return;
+
+	us = ktime_us_delta(ktime_get(), start);
+	lat->count++;
+	lat->last_us = us;
+	lat->total_us += us;
+	if (us > lat->max_us)
+		lat->max_us = us;
+}
+
 static void __maybe_unused put_timestamp(char *tbuf)
 {
 	unsigned long long t;
@@ -533,6 +564,38 @@ int usb_bam_free_fifos(enum usb_ctrl cur_bam, u8 idx)
 	return 0;
 }
 
+int usb_bam_set_fifo_sizes(enum usb_ctrl cur_bam, u8 idx, u32 data_size,
+			   u32 desc_size)
+{
+	struct usb_bam_ctx_type *ctx = &msm_usb_bam[cur_bam];
+	struct usb_bam_pipe_connect *pipe_connect;
+
+	if (idx >= ctx->max_connections) {
+		log_event_err("%s: Invalid connection index %d\n", __func__,
+				idx);
+		return -EINVAL;
+	}
+	pipe_connect = &ctx->usb_bam_connections[idx];
+
+	/* pipe and OCI memory FIFOs are fixed windows given by DT */
+	if (pipe_connect->mem_type != SYSTEM_MEM)
+		return -EOPNOTSUPP;
+	/* each descriptor is a 8 byte sps_iovec */
+	if (!data_size || !desc_size || desc_size % sizeof(struct sps_iovec))
+		return -EINVAL;
+	if (pipe_connect->enabled || pipe_connect->data_mem_buf.base ||
+	    pipe_connect->desc_mem_buf.base)
+		return -EBUSY;
+
+	log_event_dbg("%s: idx %d data fifo %x->%x desc fifo %x->%x\n",
+			__func__, idx, pipe_connect->data_fifo_size, data_size,
+			pipe_connect->desc_fifo_size, desc_size);
+	pipe_connect->data_fifo_size = data_size;
+	pipe_connect->desc_fifo_size = desc_size;
+	return 0;
+}
+EXPORT_SYMBOL(usb_bam_set_fifo_sizes);
+
 static int connect_pipe(enum usb_ctrl cur_bam, u8 idx, u32 *usb_pipe_idx)
 {
 	int ret;
@@ -1357,7 +1420,12 @@ static void usb_bam_finish_suspend(enum usb_ctrl cur_bam)
 	}
 	info[cur_bam].pipes_to_suspend = 0;
 	info[cur_bam].pipes_resumed = 0;
+	usb_bam_latency_record(&info[cur_bam].suspend_lat,
+			       info[cur_bam].suspend_start);
+	info[cur_bam].suspend_start = ktime_set(0, 0);
 	spin_unlock(&usb_bam_ipa_handshake_info_lock);
+	log_event_dbg("%s: suspend took %lld us\n", __func__,
+			info[cur_bam].suspend_lat.last_us);
 
 	/* ACK on the last pipe */
 	if (info[cur_bam].pipes_suspended == ctx->pipes_enabled_per_bam &&
@@ -1799,6 +1867,8 @@ void usb_bam_suspend(enum usb_ctrl cur_bam,
 	log_event_dbg("%s: Adding src=%d dst=%d in pipes_to_suspend=%d\n",
 			__func__, src_idx,
 			dst_idx, info[cur_bam].pipes_to_suspend);
+	if (!info[cur_bam].pipes_to_suspend)
+		info[cur_bam].suspend_start = ktime_get();
 	info[cur_bam].suspend_src_idx[info[cur_bam].pipes_to_suspend] = src_idx;
 	info[cur_bam].suspend_dst_idx[info[cur_bam].pipes_to_suspend] = dst_idx;
 	info[cur_bam].pipes_to_suspend++;
@@ -1873,19 +1943,14 @@ static void usb_bam_start_suspend(struct usb_bam_ipa_handshake_info *info_ptr)
 		log_event_dbg("Consumer not released yet\n");
 }
 
-static void usb_bam_finish_resume(struct work_struct *w)
+static void __usb_bam_finish_resume(enum usb_ctrl cur_bam)
 {
 	/* TODO: Change this when HSIC device support is introduced */
-	enum usb_ctrl cur_bam;
-	struct usb_bam_ipa_handshake_info *info_ptr;
 	struct usb_bam_pipe_connect *pipe_connect;
 	struct usb_bam_ctx_type *ctx;
 	struct device *bam_dev;
 	u32 idx, dst_idx, suspended;
 
-	info_ptr = container_of(w, struct usb_bam_ipa_handshake_info,
-			resume_work);
-	cur_bam = info_ptr->bam_type;
 	ctx = &msm_usb_bam[cur_bam];
 	bam_dev = &ctx->usb_bam_pdev->dev;
 
@@ -1959,17 +2024,30 @@ static void usb_bam_finish_resume(struct work_struct *w)
 						 ipa_rm_resource_cons[cur_bam]);
 		}
 	}
+	usb_bam_latency_record(&info[cur_bam].resume_lat,
+			       info[cur_bam].resume_start);
+	info[cur_bam].resume_start = ktime_set(0, 0);
 
 	spin_unlock(&usb_bam_ipa_handshake_info_lock);
 	mutex_unlock(&info[cur_bam].suspend_resume_mutex);
-	log_event_dbg("%s: done..PM Runtime PUT :%d\n",
-			  __func__, get_pm_runtime_counter(bam_dev));
+	log_event_dbg("%s: done in %lld us..PM Runtime PUT :%d\n",
+			  __func__, info[cur_bam].resume_lat.last_us,
+			  get_pm_runtime_counter(bam_dev));
 	/* Put to match _get at the beginning of this routine */
 	pm_runtime_put(&ctx->usb_bam_pdev->dev);
 }
 
-void usb_bam_resume(enum usb_ctrl cur_bam,
-		    struct usb_bam_connect_ipa_params *ipa_params)
+static void usb_bam_finish_resume(struct work_struct *w)
+{
+	struct usb_bam_ipa_handshake_info *info_ptr;
+
+	info_ptr = container_of(w, struct usb_bam_ipa_handshake_info,
+			resume_work);
+	__usb_bam_finish_resume(info_ptr->bam_type);
+}
+
+static bool usb_bam_resume_prepare(enum usb_ctrl cur_bam,
+			struct usb_bam_connect_ipa_params *ipa_params)
 {
 	u8 src_idx, dst_idx;
 	struct usb_bam_ctx_type *ctx = &msm_usb_bam[cur_bam];
@@ -1979,7 +2057,7 @@ void usb_bam_resume(enum usb_ctrl cur_bam,
 
 	if (!ipa_params) {
 		log_event_err("%s: Invalid ipa params\n", __func__);
-		return;
+		return false;
 	}
 
 	src_idx = ipa_params->src_idx;
@@ -1989,21 +2067,47 @@ void usb_bam_resume(enum usb_ctrl cur_bam,
 			dst_idx >= ctx->max_connections) {
 		log_event_err("%s: Invalid connection index src=%d dst=%d\n",
 			__func__, src_idx, dst_idx);
-		return;
+		return false;
 	}
 
 	pipe_connect = &ctx->usb_bam_connections[src_idx];
 	log_event_dbg("%s: bam=%s mode =%d\n", __func__,
 		bam_enable_strings[cur_bam], pipe_connect->bam_mode);
 	if (pipe_connect->bam_mode != USB_BAM_DEVICE)
-		return;
+		return false;
 
 	info[cur_bam].in_lpm = false;
 	spin_lock(&usb_bam_ipa_handshake_info_lock);
 	info[cur_bam].bus_suspend = 0;
+	if (!ktime_to_ns(info[cur_bam].resume_start))
+		info[cur_bam].resume_start = ktime_get();
 	spin_unlock(&usb_bam_ipa_handshake_info_lock);
-	queue_work(ctx->usb_bam_wq, &info[cur_bam].resume_work);
+	return true;
+}
+
+void usb_bam_resume(enum usb_ctrl cur_bam,
+		    struct usb_bam_connect_ipa_params *ipa_params)
+{
+	struct usb_bam_ctx_type *ctx = &msm_usb_bam[cur_bam];
+
+	if (usb_bam_resume_prepare(cur_bam, ipa_params))
+		queue_work(ctx->usb_bam_wq, &info[cur_bam].resume_work);
+}
+
+void usb_bam_resume_sync(enum usb_ctrl cur_bam,
+			 struct usb_bam_connect_ipa_params *ipa_params)
+{
+	struct usb_bam_ctx_type *ctx = &msm_usb_bam[cur_bam];
+
+	might_sleep();
+	if (!usb_bam_resume_prepare(cur_bam, ipa_params))
+		return;
+
+	/* let an already queued suspend or resume run first */
+	flush_workqueue(ctx->usb_bam_wq);
+	__usb_bam_finish_resume(cur_bam);
 }
+EXPORT_SYMBOL(usb_bam_resume_sync);
 
 static void _msm_bam_wait_for_host_prod_granted(enum usb_ctrl bam_type)
 {
@@ -3214,8 +3318,9 @@ static int usb_bam_probe(struct platform_device *pdev)
 	INIT_WORK(&info[bam_type].finish_suspend_work, usb_bam_finish_suspend_);
 	mutex_init(&info[bam_type].suspend_resume_mutex);
 
+	/* resume work sits on the wakeup path, don't queue it behind others */
 	ctx->usb_bam_wq = alloc_workqueue("usb_bam_wq",
-		WQ_UNBOUND | WQ_MEM_RECLAIM, 1);
+		WQ_UNBOUND | WQ_MEM_RECLAIM | WQ_HIGHPRI, 1);
 	if (!ctx->usb_bam_wq) {
 		log_event_err("unable to create workqueue usb_bam_wq\n");
 		return -ENOMEM;
@@ -3597,8 +3702,47 @@ static struct platform_driver usb_bam_driver = {
 	},
 };
 
+static struct dentry *usb_bam_dbg_root;
+
+static int usb_bam_latency_show(struct seq_file *s, void *unused)
+{
+	struct usb_bam_latency *lats[2];
+	int i, j;
+
+	/* unlocked snapshot, the lock only exists once a BAM probed */
+	seq_puts(s, "bam       event    count  last_us  max_us   avg_us\n");
+	for (i = 0; i < MAX_BAMS; i++) {
+		lats[0] = &info[i].suspend_lat;
+		lats[1] = &info[i].resume_lat;
+		for (j = 0; j < 2; j++)
+			seq_printf(s, "%-9s %-8s %-6u %-8lld %-8lld %lld\n",
+				bam_enable_strings[i],
+				j ? "resume" : "suspend", lats[j]->count,
+				lats[j]->last_us, lats[j]->max_us,
+				lats[j]->count ? div_s64(lats[j]->total_us,
+							 lats[j]->count) : 0);
+	}
+	return 0;
+}
+
+static int usb_bam_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, usb_bam_latency_show, inode->i_private);
+}
+
+static const struct file_operations usb_bam_latency_fops = {
+	.open = usb_bam_latency_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int __init init(void)
 {
+	usb_bam_dbg_root = debugfs_create_dir("usb_bam", NULL);
+	if (!IS_ERR_OR_NULL(usb_bam_dbg_root))
+		debugfs_create_file("latency", S_IRUGO, usb_bam_dbg_root,
+				    NULL, &usb_bam_latency_fops);
 	return platform_driver_register(&usb_bam_driver);
 }
 module_init(init);
@@ -3606,6 +3750,7 @@ module_init(init);
 static void __exit cleanup(void)
 {
 	platform_driver_unregister(&usb_bam_driver);
+	debugfs_remove_recursive(usb_bam_dbg_root);
 }
 module_exit(cleanup);
 
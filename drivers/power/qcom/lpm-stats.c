@@ -45,6 +45,8 @@ struct level_stats {
 	int64_t max_time[CONFIG_MSM_IDLE_STATS_BUCKET_COUNT];
 	int success_count;
 	int failed_count;
+	int premature_count;
+	int timeout_count;
 	int64_t total_time;
 	uint64_t enter_time;
 };
@@ -124,6 +126,14 @@ static void level_stats_print(struct seq_file *m, struct level_stats *stats)
 		seq_puts(m, seqs);
 	}
 
+	if (stats->premature_count || stats->timeout_count) {
+		snprintf(seqs, MAX_STR_LEN,
+			"  premature exits: %7d\n"
+			"  prediction timeouts: %7d\n",
+			stats->premature_count, stats->timeout_count);
+		seq_puts(m, seqs);
+	}
+
 	bucket_time = stats->first_bucket_time;
 	for (i = 0;
 		i < CONFIG_MSM_IDLE_STATS_BUCKET_COUNT - 1;
@@ -190,6 +200,8 @@ static void level_stats_reset(struct level_stats *stats)
 	memset(stats->max_time, 0, sizeof(stats->max_time));
 	stats->success_count = 0;
 	stats->failed_count = 0;
+	stats->premature_count = 0;
+	stats->timeout_count = 0;
 	stats->total_time = 0;
 }
 
@@ -843,6 +855,56 @@ void lpm_stats_cpu_exit(uint32_t index, uint64_t time, bool success)
 }
 EXPORT_SYMBOL(lpm_stats_cpu_exit);
 
+static void update_mispredict_stats(struct lpm_stats *stats, uint32_t index,
+				bool premature)
+{
+	if (index >= stats->num_levels)
+		return;
+
+	if (premature)
+		stats->time_stats[index].premature_count++;
+	else
+		stats->time_stats[index].timeout_count++;
+}
+
+/**
+ * lpm_stats_cluster_mispredict() - API to report a mispredicted cluster
+ * low power mode.
+ *
+ * @stats:	Pointer to the cluster's lpm_stats object.
+ * @index:	Index of the cluster lpm level.
+ * @premature:	True if the cluster woke up before the level paid off,
+ *		false if the predicted wakeup never came.
+ */
+void lpm_stats_cluster_mispredict(struct lpm_stats *stats, uint32_t index,
+				bool premature)
+{
+	if (IS_ERR_OR_NULL(stats) || !stats->time_stats)
+		return;
+
+	update_mispredict_stats(stats, index, premature);
+}
+EXPORT_SYMBOL(lpm_stats_cluster_mispredict);
+
+/**
+ * lpm_stats_cpu_mispredict() - API to report a mispredicted cpu low power
+ * mode.
+ *
+ * @index:	cpu's lpm level index.
+ * @premature:	True if the cpu woke up before the level paid off, false
+ *		if the predicted wakeup never came.
+ */
+void lpm_stats_cpu_mispredict(uint32_t index, bool premature)
+{
+	struct lpm_stats *stats = &__get_cpu_var(cpu_stats);
+
+	if (!stats->time_stats)
+		return;
+
+	update_mispredict_stats(stats, index, premature);
+}
+EXPORT_SYMBOL(lpm_stats_cpu_mispredict);
+
 /**
  * lpm_stats_suspend_enter() - API to communicate system entering suspend.
  *
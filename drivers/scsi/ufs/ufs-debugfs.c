@@ -1391,6 +1391,228 @@ static const struct file_operations ufsdbg_req_stats_desc = {
 	.write		= ufsdbg_req_stats_write,
 };
 
+static ssize_t ufsdbg_lat_hist_write(struct file *filp,
+		const char __user *ubuf, size_t cnt, loff_t *ppos)
+{
+	struct ufs_hba *hba = filp->f_mapping->host->i_private;
+	int val;
+	int ret;
+	unsigned long flags;
+
+	ret = kstrtoint_from_user(ubuf, cnt, 0, &val);
+	if (ret) {
+		dev_err(hba->dev, "%s: Invalid argument\n", __func__);
+		return ret;
+	}
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	ufshcd_init_lat_hist(hba);
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+
+	return cnt;
+}
+
+/* upper bound (usec) of the bucket holding the given percentile */
+static u32 ufsdbg_lat_hist_pct(const u32 *b, u64 total, int pct)
+{
+	u64 target = div64_u64(total * pct + 99, 100);
+	u64 sum = 0;
+	int i;
+
+	for (i = 0; i < UFS_HIST_BUCKETS - 1; i++) {
+		sum += b[i];
+		if (sum >= target)
+			break;
+	}
+	return 1U << i;
+}
+
+static void ufsdbg_lat_hist_row(struct seq_file *file, const char *name,
+				const u32 *b)
+{
+	u64 total = 0;
+	int i;
+
+	for (i = 0; i < UFS_HIST_BUCKETS; i++)
+		total += b[i];
+	if (!total)
+		return;
+
+	seq_printf(file, "%-24s %-10llu %-8u %-8u ", name, total,
+		   ufsdbg_lat_hist_pct(b, total, 50),
+		   ufsdbg_lat_hist_pct(b, total, 99));
+	for (i = 0; i < UFS_HIST_BUCKETS; i++)
+		seq_printf(file, " %u", b[i]);
+	seq_puts(file, "\n");
+}
+
+static int ufsdbg_lat_hist_show(struct seq_file *file, void *data)
+{
+	static const char * const ops[] = {
+		"read", "write", "flush", "discard" };
+	static const char * const sizes[] = { "4k", "64k", "large" };
+	static const char * const pms[] = { "active", "hibern8", "gated" };
+	struct ufs_hba *hba = (struct ufs_hba *)file->private;
+	struct ufshcd_lat_hist *hist;
+	char name[32];
+	unsigned long flags;
+	int op, size, pm, lun;
+
+	hist = kmalloc(sizeof(*hist), GFP_KERNEL);
+	if (!hist)
+		return -ENOMEM;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	memcpy(hist, &hba->ufs_stats.lat_hist, sizeof(*hist));
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+
+	seq_puts(file, "bucket n: [2^(n-1), 2^n) usec, p50/p99 in usec (bucket upper bound)\n");
+	seq_printf(file, "%-24s %-10s %-8s %-8s  buckets 0..%d\n",
+		   "class", "count", "p50", "p99", UFS_HIST_BUCKETS - 1);
+
+	for (op = 0; op < UFS_HIST_OP_NUM; op++)
+		for (size = 0; size < UFS_HIST_SIZE_NUM; size++)
+			for (pm = 0; pm < UFS_HIST_PM_NUM; pm++) {
+				snprintf(name, sizeof(name), "%s/%s/%s",
+					 ops[op], sizes[size], pms[pm]);
+				ufsdbg_lat_hist_row(file, name,
+						hist->op[op][size][pm]);
+			}
+
+	for (lun = 0; lun < UFS_HIST_LUNS; lun++)
+		for (pm = 0; pm < UFS_HIST_PM_NUM; pm++) {
+			snprintf(name, sizeof(name), "lun%d/%s", lun, pms[pm]);
+			ufsdbg_lat_hist_row(file, name, hist->lun[lun][pm]);
+		}
+
+	kfree(hist);
+	return 0;
+}
+
+static int ufsdbg_lat_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ufsdbg_lat_hist_show, inode->i_private);
+}
+
+static const struct file_operations ufsdbg_lat_hist_desc = {
+	.open		= ufsdbg_lat_hist_open,
+	.read		= seq_read,
+	.write		= ufsdbg_lat_hist_write,
+};
+
+static ssize_t ufsdbg_idle_pred_write(struct file *filp,
+		const char __user *ubuf, size_t cnt, loff_t *ppos)
+{
+	struct ufs_hba *hba = filp->f_mapping->host->i_private;
+	struct ufs_idle_pred *pred = &hba->idle_pred;
+	int val;
+	int ret;
+	unsigned long flags;
+
+	ret = kstrtoint_from_user(ubuf, cnt, 0, &val);
+	if (ret) {
+		dev_err(hba->dev, "%s: Invalid argument\n", __func__);
+		return ret;
+	}
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	pred->h8_enter_cnt = 0;
+	pred->h8_exit_cnt = 0;
+	pred->h8_wasted_cnt = 0;
+	pred->gate_cnt = 0;
+	pred->ungate_cnt = 0;
+	pred->gate_wasted_cnt = 0;
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+
+	return cnt;
+}
+
+static int ufsdbg_idle_pred_show(struct seq_file *file, void *data)
+{
+	struct ufs_hba *hba = (struct ufs_hba *)file->private;
+	struct ufs_idle_pred *pred = &hba->idle_pred;
+	unsigned long flags;
+	int lun;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	seq_printf(file, "enabled:\t\t%d\n", pred->is_enabled);
+	for (lun = 0; lun < UFS_IDLE_PRED_LUNS; lun++)
+		if (pred->gap_us[lun])
+			seq_printf(file, "lun%d idle gap (us):\t%u\n", lun,
+				   pred->gap_us[lun]);
+	seq_printf(file, "hibern8 enter:\t\t%llu\n", pred->h8_enter_cnt);
+	seq_printf(file, "hibern8 exit:\t\t%llu\n", pred->h8_exit_cnt);
+	seq_printf(file, "hibern8 wasted:\t\t%llu\n", pred->h8_wasted_cnt);
+	seq_printf(file, "clk gate:\t\t%llu\n", pred->gate_cnt);
+	seq_printf(file, "clk ungate:\t\t%llu\n", pred->ungate_cnt);
+	seq_printf(file, "clk gate wasted:\t%llu\n", pred->gate_wasted_cnt);
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+
+	return 0;
+}
+
+static int ufsdbg_idle_pred_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ufsdbg_idle_pred_show, inode->i_private);
+}
+
+static const struct file_operations ufsdbg_idle_pred_desc = {
+	.open		= ufsdbg_idle_pred_open,
+	.read		= seq_read,
+	.write		= ufsdbg_idle_pred_write,
+};
+
+static ssize_t ufsdbg_db_batch_write(struct file *filp,
+		const char __user *ubuf, size_t cnt, loff_t *ppos)
+{
+	struct ufs_hba *hba = filp->f_mapping->host->i_private;
+	struct ufs_db_batch *batch = &hba->db_batch;
+	int val;
+	int ret;
+	unsigned long flags;
+
+	ret = kstrtoint_from_user(ubuf, cnt, 0, &val);
+	if (ret) {
+		dev_err(hba->dev, "%s: Invalid argument\n", __func__);
+		return ret;
+	}
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	batch->rung_cnt = 0;
+	batch->deferred_cnt = 0;
+	batch->timer_cnt = 0;
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+
+	return cnt;
+}
+
+static int ufsdbg_db_batch_show(struct seq_file *file, void *data)
+{
+	struct ufs_hba *hba = (struct ufs_hba *)file->private;
+	struct ufs_db_batch *batch = &hba->db_batch;
+	unsigned long flags;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	seq_printf(file, "enabled:\t\t%d\n", batch->is_enabled);
+	seq_printf(file, "pending:\t\t0x%lx\n", batch->pending);
+	seq_printf(file, "deferred reqs:\t\t%llu\n", batch->deferred_cnt);
+	seq_printf(file, "batched doorbells:\t%llu\n", batch->rung_cnt);
+	seq_printf(file, "timer flushes:\t\t%llu\n", batch->timer_cnt);
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+
+	return 0;
+}
+
+static int ufsdbg_db_batch_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ufsdbg_db_batch_show, inode->i_private);
+}
+
+static const struct file_operations ufsdbg_db_batch_desc = {
+	.open		= ufsdbg_db_batch_open,
+	.read		= seq_read,
+	.write		= ufsdbg_db_batch_write,
+};
 
 static int ufsdbg_reset_controller_show(struct seq_file *file, void *data)
 {
@@ -1624,6 +1846,39 @@ void ufsdbg_add_debugfs(struct ufs_hba *hba)
 		goto err;
 	}
 
+	hba->debugfs_files.lat_hist =
+		debugfs_create_file("latency_hist", S_IRUSR | S_IWUSR,
+			hba->debugfs_files.stats_folder, hba,
+			&ufsdbg_lat_hist_desc);
+	if (!hba->debugfs_files.lat_hist) {
+		dev_err(hba->dev,
+			"%s:  failed create latency_hist debugfs entry\n",
+			__func__);
+		goto err;
+	}
+
+	hba->debugfs_files.idle_pred =
+		debugfs_create_file("idle_pred", S_IRUSR | S_IWUSR,
+			hba->debugfs_files.stats_folder, hba,
+			&ufsdbg_idle_pred_desc);
+	if (!hba->debugfs_files.idle_pred) {
+		dev_err(hba->dev,
+			"%s:  failed create idle_pred debugfs entry\n",
+			__func__);
+		goto err;
+	}
+
+	hba->debugfs_files.db_batch =
+		debugfs_create_file("doorbell_batch", S_IRUSR | S_IWUSR,
+			hba->debugfs_files.stats_folder, hba,
+			&ufsdbg_db_batch_desc);
+	if (!hba->debugfs_files.db_batch) {
+		dev_err(hba->dev,
+			"%s:  failed create doorbell_batch debugfs entry\n",
+			__func__);
+		goto err;
+	}
+
 	hba->debugfs_files.reset_controller =
 		debugfs_create_file("reset_controller", S_IRUSR | S_IWUSR,
 			hba->debugfs_files.debugfs_root, hba,
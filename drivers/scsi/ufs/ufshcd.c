@@ -43,6 +43,7 @@
 #include <linux/nls.h>
 #include <linux/of.h>
 #include <linux/blkdev.h>
+#include <linux/sizes.h>
 
 #include "ufshcd.h"
 #include "ufshci.h"
@@ -107,6 +108,43 @@ static void ufshcd_update_tag_stats_completion(struct ufs_hba *hba,
 		hba->ufs_stats.q_depth--;
 }
 
+static void update_lat_hist(struct ufs_hba *hba, struct ufshcd_lrb *lrbp,
+			    struct request *rq, s64 delta)
+{
+	struct ufshcd_lat_hist *hist = &hba->ufs_stats.lat_hist;
+	unsigned int bytes;
+	int op, size, bucket;
+	u8 pm = lrbp->issue_pm_state;
+
+	if (!rq || !(rq->cmd_type & REQ_TYPE_FS) || pm >= UFS_HIST_PM_NUM)
+		return;
+
+	if (rq->cmd_flags & REQ_FLUSH)
+		op = UFS_HIST_OP_FLUSH;
+	else if (rq->cmd_flags & REQ_DISCARD)
+		op = UFS_HIST_OP_DISCARD;
+	else if (rq_data_dir(rq) == READ)
+		op = UFS_HIST_OP_READ;
+	else
+		op = UFS_HIST_OP_WRITE;
+
+	bytes = blk_rq_bytes(rq);
+	if (bytes <= SZ_4K)
+		size = UFS_HIST_SIZE_4K;
+	else if (bytes <= SZ_64K)
+		size = UFS_HIST_SIZE_64K;
+	else
+		size = UFS_HIST_SIZE_LARGE;
+
+	bucket = delta > 0 ? ilog2((u64)delta) + 1 : 0;
+	if (bucket >= UFS_HIST_BUCKETS)
+		bucket = UFS_HIST_BUCKETS - 1;
+
+	hist->op[op][size][pm][bucket]++;
+	if (lrbp->lun < UFS_HIST_LUNS)
+		hist->lun[lrbp->lun][pm][bucket]++;
+}
+
 static void update_req_stats(struct ufs_hba *hba, struct ufshcd_lrb *lrbp)
 {
 	int rq_type;
@@ -114,6 +152,8 @@ static void update_req_stats(struct ufs_hba *hba, struct ufshcd_lrb *lrbp)
 	s64 delta = ktime_us_delta(lrbp->complete_time_stamp,
 		lrbp->issue_time_stamp);
 
+	update_lat_hist(hba, lrbp, rq, delta);
+
 	/* update general request statistics */
 	if (hba->ufs_stats.req_stats[TS_TAG].count == 0)
 		hba->ufs_stats.req_stats[TS_TAG].min = delta;
@@ -214,6 +254,21 @@ void ufshcd_update_query_stats(struct ufs_hba *hba,
 /* default value of auto suspend is 3 seconds */
 #define UFSHCD_AUTO_SUSPEND_DELAY_MS 3000 /* millisecs */
 
+/* Predictive clock scaling */
+#define UFSHCD_BOOST_QDEPTH		4	/* outstanding requests */
+#define UFSHCD_BOOST_BURST_READS	8	/* sync reads per window */
+#define UFSHCD_BOOST_BURST_WINDOW_MS	10
+#define UFSHCD_BOOST_HOLD_MS		300
+#define UFSHCD_SCALE_DOWN_CNT		3	/* devfreq polling windows */
+
+/* Idle gap prediction for clock gating and hibern8 entry */
+#define UFS_IDLE_PRED_WINDOW_MS		1000	/* ignore LUNs idle longer */
+#define UFS_IDLE_PRED_MAX_GAP_US	(1000 * 1000)
+#define UFS_IDLE_PRED_H8_BREAKEVEN_US	2000
+#define UFS_IDLE_PRED_GATE_BREAKEVEN_US	10000
+#define UFS_IDLE_PRED_LONG_MULT		8	/* x break-even: no delay */
+#define UFS_IDLE_PRED_DEFER_MULT	4	/* delay stretch for short gaps */
+
 #define UFSHCD_CLK_GATING_DELAY_MS_PWR_SAVE	10
 #define UFSHCD_CLK_GATING_DELAY_MS_PERF		50
 
@@ -376,6 +431,8 @@ static void __ufshcd_suspend_clkscaling(struct ufs_hba *hba);
 static void ufshcd_release_all(struct ufs_hba *hba);
 static void ufshcd_hba_vreg_set_lpm(struct ufs_hba *hba);
 static void ufshcd_hba_vreg_set_hpm(struct ufs_hba *hba);
+static void ufshcd_db_batch_flush(struct ufs_hba *hba);
+static enum hrtimer_restart ufshcd_db_batch_timer(struct hrtimer *timer);
 static int ufshcd_devfreq_target(struct device *dev,
 				unsigned long *freq, u32 flags);
 static int ufshcd_devfreq_get_dev_status(struct device *dev,
@@ -1181,6 +1238,93 @@ static int ufshcd_scale_clks(struct ufs_hba *hba, bool scale_up)
 	return ret;
 }
 
+/*
+ * Smallest recent per-LUN idle gap EWMA, or U32_MAX when no LUN saw
+ * traffic within UFS_IDLE_PRED_WINDOW_MS. Must be called with host lock
+ * acquired.
+ */
+static u32 ufshcd_idle_pred_gap_us(struct ufs_hba *hba)
+{
+	struct ufs_idle_pred *pred = &hba->idle_pred;
+	ktime_t now = ktime_get();
+	u32 gap = U32_MAX;
+	int lun;
+
+	for (lun = 0; lun < UFS_IDLE_PRED_LUNS; lun++) {
+		if (!pred->gap_us[lun] ||
+		    ktime_us_delta(now, pred->last_arrival[lun]) >
+				UFS_IDLE_PRED_WINDOW_MS * USEC_PER_MSEC)
+			continue;
+		gap = min(gap, pred->gap_us[lun]);
+	}
+
+	return gap;
+}
+
+/*
+ * Pick the gating/hibern8 entry delay from the predicted idle gap: go
+ * right away when the gap is well past the break-even time of the
+ * transition, hold off longer when the next request is expected before
+ * the transition pays off. Must be called with host lock acquired.
+ */
+static unsigned long ufshcd_idle_pred_delay_ms(struct ufs_hba *hba,
+					       unsigned long delay_ms,
+					       u32 breakeven_us)
+{
+	u32 gap;
+
+	if (!hba->idle_pred.is_enabled)
+		return delay_ms;
+
+	gap = ufshcd_idle_pred_gap_us(hba);
+	if (gap >= breakeven_us * UFS_IDLE_PRED_LONG_MULT)
+		return 0;
+	if (gap < breakeven_us)
+		return delay_ms * UFS_IDLE_PRED_DEFER_MULT;
+	return delay_ms;
+}
+
+/* Must be called with host lock acquired */
+static void ufshcd_idle_pred_arrival(struct ufs_hba *hba,
+				     struct ufshcd_lrb *lrbp)
+{
+	struct ufs_idle_pred *pred = &hba->idle_pred;
+	u8 lun = lrbp->lun;
+	ktime_t now;
+	s64 gap;
+	int tag;
+
+	if (!lrbp->cmd || lun >= UFS_IDLE_PRED_LUNS)
+		return;
+
+	now = ktime_get();
+	pred->last_arrival[lun] = now;
+	if (!ktime_to_us(pred->last_complete[lun]))
+		return;
+
+	/* only the gap after the LUN drained says anything about idling */
+	for_each_set_bit(tag, &hba->outstanding_reqs, hba->nutrs)
+		if (hba->lrb[tag].cmd && hba->lrb[tag].lun == lun)
+			return;
+
+	gap = ktime_us_delta(now, pred->last_complete[lun]);
+	gap = clamp_t(s64, gap, 1, UFS_IDLE_PRED_MAX_GAP_US);
+	/* EWMA, the newest sample weighs 1/8 */
+	if (pred->gap_us[lun])
+		pred->gap_us[lun] = (pred->gap_us[lun] * 7 + (u32)gap) >> 3;
+	else
+		pred->gap_us[lun] = gap;
+}
+
+/* Must be called with host lock acquired */
+static void ufshcd_idle_pred_complete(struct ufs_hba *hba,
+				      struct ufshcd_lrb *lrbp)
+{
+	if (lrbp->cmd && lrbp->lun < UFS_IDLE_PRED_LUNS)
+		hba->idle_pred.last_complete[lrbp->lun] =
+			lrbp->complete_time_stamp;
+}
+
 static void ufshcd_ungate_work(struct work_struct *work)
 {
 	int ret;
@@ -1200,6 +1344,11 @@ static void ufshcd_ungate_work(struct work_struct *work)
 	ufshcd_hba_vreg_set_hpm(hba);
 	ufshcd_enable_clocks(hba);
 
+	hba->idle_pred.ungate_cnt++;
+	if (ktime_us_delta(ktime_get(), hba->idle_pred.gate_t) <
+			UFS_IDLE_PRED_GATE_BREAKEVEN_US)
+		hba->idle_pred.gate_wasted_cnt++;
+
 	/* Exit from hibern8 */
 	if (ufshcd_can_hibern8_during_gating(hba)) {
 		/* Prevent gating in this path */
@@ -1354,6 +1503,9 @@ static void ufshcd_gate_work(struct work_struct *work)
 	/* Put the host controller in low power mode if possible */
 	ufshcd_hba_vreg_set_lpm(hba);
 
+	hba->idle_pred.gate_t = ktime_get();
+	hba->idle_pred.gate_cnt++;
+
 	/*
 	 * In case you are here to cancel this work the gating state
 	 * would be marked as REQ_CLKS_ON. In this case keep the state
@@ -1394,7 +1546,9 @@ static void __ufshcd_release(struct ufs_hba *hba, bool no_sched)
 	trace_ufshcd_clk_gating(dev_name(hba->dev), hba->clk_gating.state);
 
 	schedule_delayed_work(&hba->clk_gating.gate_work,
-			      msecs_to_jiffies(hba->clk_gating.delay_ms));
+		msecs_to_jiffies(ufshcd_idle_pred_delay_ms(hba,
+				hba->clk_gating.delay_ms,
+				UFS_IDLE_PRED_GATE_BREAKEVEN_US)));
 }
 
 void ufshcd_release(struct ufs_hba *hba, bool no_sched)
@@ -1722,7 +1876,9 @@ static void __ufshcd_hibern8_release(struct ufs_hba *hba, bool no_sched)
 	 * work gets scheduled atleast after 2 jiffies (any time between
 	 * 1000/HZ ms to 2000/HZ ms).
 	 */
-	delay_in_jiffies = msecs_to_jiffies(hba->hibern8_on_idle.delay_ms);
+	delay_in_jiffies = msecs_to_jiffies(ufshcd_idle_pred_delay_ms(hba,
+				hba->hibern8_on_idle.delay_ms,
+				UFS_IDLE_PRED_H8_BREAKEVEN_US));
 	if (delay_in_jiffies == 1)
 		delay_in_jiffies++;
 
@@ -1935,6 +2091,103 @@ static void ufshcd_exit_hibern8_on_idle(struct ufs_hba *hba)
 	device_remove_file(hba->dev, &hba->hibern8_on_idle.enable_attr);
 }
 
+static ssize_t ufshcd_idle_pred_enable_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%d\n", hba->idle_pred.is_enabled);
+}
+
+static ssize_t ufshcd_idle_pred_enable_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	unsigned long flags;
+	u32 value;
+
+	if (kstrtou32(buf, 0, &value))
+		return -EINVAL;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	hba->idle_pred.is_enabled = !!value;
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+	return count;
+}
+
+static inline bool ufshcd_is_idle_pred_allowed(struct ufs_hba *hba)
+{
+	return ufshcd_is_clkgating_allowed(hba) ||
+		ufshcd_is_hibern8_on_idle_allowed(hba);
+}
+
+static void ufshcd_init_idle_pred(struct ufs_hba *hba)
+{
+	if (!ufshcd_is_idle_pred_allowed(hba))
+		return;
+
+	hba->idle_pred.enable_attr.show = ufshcd_idle_pred_enable_show;
+	hba->idle_pred.enable_attr.store = ufshcd_idle_pred_enable_store;
+	sysfs_attr_init(&hba->idle_pred.enable_attr.attr);
+	hba->idle_pred.enable_attr.attr.name = "idle_pred_enable";
+	hba->idle_pred.enable_attr.attr.mode = S_IRUGO | S_IWUSR;
+	if (device_create_file(hba->dev, &hba->idle_pred.enable_attr))
+		dev_err(hba->dev, "Failed to create sysfs for idle_pred_enable\n");
+}
+
+static void ufshcd_exit_idle_pred(struct ufs_hba *hba)
+{
+	if (!ufshcd_is_idle_pred_allowed(hba))
+		return;
+	device_remove_file(hba->dev, &hba->idle_pred.enable_attr);
+}
+
+static ssize_t ufshcd_db_batch_enable_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%d\n", hba->db_batch.is_enabled);
+}
+
+static ssize_t ufshcd_db_batch_enable_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	unsigned long flags;
+	u32 value;
+
+	if (kstrtou32(buf, 0, &value))
+		return -EINVAL;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	hba->db_batch.is_enabled = !!value;
+	if (!hba->db_batch.is_enabled)
+		ufshcd_db_batch_flush(hba);
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+	return count;
+}
+
+static void ufshcd_init_db_batch(struct ufs_hba *hba)
+{
+	hrtimer_init(&hba->db_batch.timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	hba->db_batch.timer.function = ufshcd_db_batch_timer;
+
+	hba->db_batch.enable_attr.show = ufshcd_db_batch_enable_show;
+	hba->db_batch.enable_attr.store = ufshcd_db_batch_enable_store;
+	sysfs_attr_init(&hba->db_batch.enable_attr.attr);
+	hba->db_batch.enable_attr.attr.name = "doorbell_batch_enable";
+	hba->db_batch.enable_attr.attr.mode = S_IRUGO | S_IWUSR;
+	if (device_create_file(hba->dev, &hba->db_batch.enable_attr))
+		dev_err(hba->dev, "Failed to create sysfs for doorbell_batch_enable\n");
+}
+
+static void ufshcd_exit_db_batch(struct ufs_hba *hba)
+{
+	device_remove_file(hba->dev, &hba->db_batch.enable_attr);
+	hrtimer_cancel(&hba->db_batch.timer);
+}
+
 static void ufshcd_hold_all(struct ufs_hba *hba)
 {
 	ufshcd_hold(hba, false);
@@ -1977,6 +2230,64 @@ static void ufshcd_clk_scaling_start_busy(struct ufs_hba *hba)
 	}
 }
 
+/*
+ * Scale up without waiting for the end of the devfreq polling window when
+ * the queue depth spikes or a burst of sync reads (typically a foreground
+ * task faulting in its working set) shows up. Must be called with host
+ * lock acquired.
+ */
+static void ufshcd_clk_scaling_predict(struct ufs_hba *hba,
+				       struct ufshcd_lrb *lrbp)
+{
+	struct ufs_clk_scaling *scaling = &hba->clk_scaling;
+	struct request *rq = lrbp->cmd ? lrbp->cmd->request : NULL;
+	bool boost = false;
+
+	if (!ufshcd_is_clkscaling_supported(hba) || !scaling->is_predictive ||
+	    !scaling->is_allowed || hba->pm_op_in_progress)
+		return;
+
+	if (scaling->active_reqs >= UFSHCD_BOOST_QDEPTH) {
+		boost = true;
+	} else if (rq && rq_data_dir(rq) == READ && rq_is_sync(rq)) {
+		if (time_after(jiffies, scaling->burst_start_t +
+			msecs_to_jiffies(UFSHCD_BOOST_BURST_WINDOW_MS))) {
+			scaling->burst_start_t = jiffies;
+			scaling->burst_reads = 0;
+		}
+		if (++scaling->burst_reads >= UFSHCD_BOOST_BURST_READS)
+			boost = true;
+	}
+
+	if (!boost)
+		return;
+
+	if (scaling->is_scaled_up) {
+		/* demand is still there, push the scale down further out */
+		scaling->boost_until = jiffies +
+			msecs_to_jiffies(UFSHCD_BOOST_HOLD_MS);
+		scaling->down_cnt = 0;
+	} else if (!scaling->is_boost_pending) {
+		scaling->is_boost_pending = true;
+		queue_work(scaling->workq, &scaling->boost_work);
+	}
+}
+
+/*
+ * A boost work cancelled before it ran would leave is_boost_pending set and
+ * no boost would ever be queued again, so clear it along with the cancel.
+ */
+static void ufshcd_cancel_clk_scaling_boost(struct ufs_hba *hba)
+{
+	unsigned long flags;
+
+	cancel_work_sync(&hba->clk_scaling.boost_work);
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	hba->clk_scaling.is_boost_pending = false;
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+}
+
 static void ufshcd_clk_scaling_update_busy(struct ufs_hba *hba)
 {
 	struct ufs_clk_scaling *scaling = &hba->clk_scaling;
@@ -1992,6 +2303,93 @@ static void ufshcd_clk_scaling_update_busy(struct ufs_hba *hba)
 	}
 }
 
+/*
+ * Doorbell batching: while more requests are sitting in the block layer
+ * queue and the device already has work in flight, the doorbell write for
+ * a new transfer request is deferred so that a burst of requests is
+ * handed to the controller with a single MMIO write. A deferred tag is
+ * marked outstanding but excluded from completion handling until it has
+ * actually been rung.
+ */
+#define UFSHCD_DB_BATCH_MAX		8
+#define UFSHCD_DB_BATCH_DELAY_US	20
+
+/* Caller must hold the host lock */
+static unsigned long ufshcd_db_batch_take(struct ufs_hba *hba)
+{
+	struct ufs_db_batch *batch = &hba->db_batch;
+	unsigned long pending = batch->pending;
+
+	if (!pending)
+		return 0;
+
+	batch->pending = 0;
+	batch->count = 0;
+	batch->rung_cnt++;
+	hrtimer_try_to_cancel(&batch->timer);
+	return pending;
+}
+
+/* Caller must hold the host lock */
+static void ufshcd_db_batch_flush(struct ufs_hba *hba)
+{
+	unsigned long pending = ufshcd_db_batch_take(hba);
+
+	if (!pending)
+		return;
+
+	ufshcd_writel(hba, pending, REG_UTP_TRANSFER_REQ_DOOR_BELL);
+	/* Make sure that doorbell is committed immediately */
+	wmb();
+}
+
+static bool ufshcd_db_batch_defer(struct ufs_hba *hba, unsigned int tag)
+{
+	struct ufs_db_batch *batch = &hba->db_batch;
+	struct scsi_cmnd *cmd = hba->lrb[tag].cmd;
+	struct request_queue *q;
+
+	if (!batch->is_enabled || !cmd ||
+	    batch->count + 1 >= UFSHCD_DB_BATCH_MAX)
+		return false;
+
+	/* Never hold back a request from an idle device */
+	if (!(hba->outstanding_reqs & ~batch->pending & ~(1UL << tag)))
+		return false;
+
+	/*
+	 * Only defer when another request is about to be dispatched; the
+	 * queue is sampled without its lock as this is just a hint, the
+	 * timer bounds the delay if no request follows.
+	 */
+	q = cmd->request->q;
+	if (list_empty(&q->queue_head) && !q->nr_sorted)
+		return false;
+
+	batch->pending |= 1UL << tag;
+	batch->deferred_cnt++;
+	if (!batch->count++)
+		hrtimer_start(&batch->timer,
+			ns_to_ktime(UFSHCD_DB_BATCH_DELAY_US * NSEC_PER_USEC),
+			HRTIMER_MODE_REL);
+	return true;
+}
+
+static enum hrtimer_restart ufshcd_db_batch_timer(struct hrtimer *timer)
+{
+	struct ufs_hba *hba = container_of(timer, struct ufs_hba,
+					   db_batch.timer);
+	unsigned long flags;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	if (hba->db_batch.pending)
+		hba->db_batch.timer_cnt++;
+	ufshcd_db_batch_flush(hba);
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+
+	return HRTIMER_NORESTART;
+}
+
 /**
  * ufshcd_send_command - Send SCSI or device management commands
  * @hba: per adapter instance
@@ -2005,10 +2403,15 @@ int ufshcd_send_command(struct ufs_hba *hba, unsigned int task_tag)
 	hba->lrb[task_tag].issue_time_stamp = ktime_get();
 	hba->lrb[task_tag].complete_time_stamp = ktime_set(0, 0);
 	ufshcd_clk_scaling_start_busy(hba);
+	ufshcd_clk_scaling_predict(hba, &hba->lrb[task_tag]);
+	ufshcd_idle_pred_arrival(hba, &hba->lrb[task_tag]);
 	__set_bit(task_tag, &hba->outstanding_reqs);
-	ufshcd_writel(hba, 1 << task_tag, REG_UTP_TRANSFER_REQ_DOOR_BELL);
-	/* Make sure that doorbell is committed immediately */
-	wmb();
+	if (!ufshcd_db_batch_defer(hba, task_tag)) {
+		ufshcd_writel(hba, (1 << task_tag) | ufshcd_db_batch_take(hba),
+			      REG_UTP_TRANSFER_REQ_DOOR_BELL);
+		/* Make sure that doorbell is committed immediately */
+		wmb();
+	}
 	ufshcd_cond_add_cmd_trace(hba, task_tag, "send");
 	ufshcd_update_tag_stats(hba, task_tag);
 	return ret;
@@ -2570,6 +2973,7 @@ static int ufshcd_queuecommand(struct Scsi_Host *host, struct scsi_cmnd *cmd)
 	unsigned long flags;
 	int tag;
 	int err = 0;
+	u8 issue_pm_state;
 
 	hba = shost_priv(host);
 
@@ -2625,6 +3029,16 @@ static int ufshcd_queuecommand(struct Scsi_Host *host, struct scsi_cmnd *cmd)
 		goto out;
 	}
 
+	/* remember what the request had to wake up, for the latency stats */
+	if (ufshcd_is_clkgating_allowed(hba) &&
+	    hba->clk_gating.state != CLKS_ON)
+		issue_pm_state = UFS_HIST_PM_GATED;
+	else if (ufshcd_is_hibern8_on_idle_allowed(hba) &&
+		 hba->hibern8_on_idle.state != HIBERN8_EXITED)
+		issue_pm_state = UFS_HIST_PM_HIBERN8;
+	else
+		issue_pm_state = UFS_HIST_PM_ACTIVE;
+
 	err = ufshcd_hold(hba, true);
 	if (err) {
 		err = SCSI_MLQUEUE_HOST_BUSY;
@@ -2670,6 +3084,7 @@ static int ufshcd_queuecommand(struct Scsi_Host *host, struct scsi_cmnd *cmd)
 	lrbp->intr_cmd = !ufshcd_is_intr_aggr_allowed(hba) ? true : false;
 	lrbp->command_type = UTP_CMD_TYPE_SCSI;
 	lrbp->req_abort_skip = false;
+	lrbp->issue_pm_state = issue_pm_state;
 
 	/* form UPIU before issuing the command */
 	ufshcd_compose_upiu(hba, lrbp);
@@ -3915,6 +4330,7 @@ int ufshcd_wait_for_doorbell_clr(struct ufs_hba *hba, u64 wait_timeout_us)
 		ret = -EBUSY;
 		goto out;
 	}
+	ufshcd_db_batch_flush(hba);
 
 	/*
 	 * Wait for all the outstanding tasks/transfer requests.
@@ -4063,6 +4479,8 @@ static int __ufshcd_uic_hibern8_enter(struct ufs_hba *hba)
 	} else {
 		dev_dbg(hba->dev, "%s: Hibern8 Enter at %lld us", __func__,
 			ktime_to_us(ktime_get()));
+		hba->idle_pred.h8_enter_t = ktime_get();
+		hba->idle_pred.h8_enter_cnt++;
 	}
 
 	return ret;
@@ -4102,6 +4520,10 @@ static int ufshcd_uic_hibern8_exit(struct ufs_hba *hba)
 			ktime_to_us(ktime_get()));
 		hba->ufs_stats.last_hibern8_exit_tstamp = ktime_get();
 		hba->ufs_stats.hibern8_exit_cnt++;
+		hba->idle_pred.h8_exit_cnt++;
+		if (ktime_us_delta(ktime_get(), hba->idle_pred.h8_enter_t) <
+				UFS_IDLE_PRED_H8_BREAKEVEN_US)
+			hba->idle_pred.h8_wasted_cnt++;
 	}
 
 	return ret;
@@ -5057,6 +5479,7 @@ void ufshcd_abort_outstanding_transfer_requests(struct ufs_hba *hba, int result)
 			clear_bit_unlock(index, &hba->lrb_in_use);
 			lrbp->complete_time_stamp = ktime_get();
 			update_req_stats(hba, lrbp);
+			ufshcd_idle_pred_complete(hba, lrbp);
 			/* Mark completed command as NULL in LRB */
 			lrbp->cmd = NULL;
 			ufshcd_release_all(hba);
@@ -5112,6 +5535,7 @@ static void __ufshcd_transfer_req_compl(struct ufs_hba *hba,
 			clear_bit_unlock(index, &hba->lrb_in_use);
 			lrbp->complete_time_stamp = ktime_get();
 			update_req_stats(hba, lrbp);
+			ufshcd_idle_pred_complete(hba, lrbp);
 			/* Mark completed command as NULL in LRB */
 			lrbp->cmd = NULL;
 			__ufshcd_release(hba, false);
@@ -5186,9 +5610,14 @@ static void ufshcd_transfer_req_compl(struct ufs_hba *hba)
 		ufshcd_reset_intr_aggr(hba);
 
 	tr_doorbell = ufshcd_readl(hba, REG_UTP_TRANSFER_REQ_DOOR_BELL);
-	completed_reqs = tr_doorbell ^ hba->outstanding_reqs;
+	/* Deferred tags were never rung, so they can't have completed */
+	completed_reqs = (tr_doorbell ^ hba->outstanding_reqs) &
+			 ~hba->db_batch.pending;
 
 	__ufshcd_transfer_req_compl(hba, completed_reqs);
+
+	/* The device just freed up slots, hand it what is pending */
+	ufshcd_db_batch_flush(hba);
 }
 
 /**
@@ -5624,6 +6053,7 @@ static void ufshcd_err_handler(struct work_struct *work)
 
 	hba->ufshcd_state = UFSHCD_STATE_RESET;
 	ufshcd_set_eh_in_progress(hba);
+	ufshcd_db_batch_flush(hba);
 
 	/* Complete requests that have door-bell cleared by h/w */
 	ufshcd_complete_requests(hba);
@@ -6167,6 +6597,9 @@ static int ufshcd_abort(struct scsi_cmnd *cmd)
 		return ufshcd_eh_host_reset_handler(cmd);
 
 	ufshcd_hold_all(hba);
+	spin_lock_irqsave(host->host_lock, flags);
+	ufshcd_db_batch_flush(hba);
+	spin_unlock_irqrestore(host->host_lock, flags);
 	reg = ufshcd_readl(hba, REG_UTP_TRANSFER_REQ_DOOR_BELL);
 	/* If command is already aborted/completed, return SUCCESS */
 	if (!(test_bit(tag, &hba->outstanding_reqs))) {
@@ -8049,6 +8482,7 @@ static int ufshcd_suspend(struct ufs_hba *hba, enum ufs_pm_op pm_op)
 	if (hba->clk_scaling.is_allowed) {
 		cancel_work_sync(&hba->clk_scaling.suspend_work);
 		cancel_work_sync(&hba->clk_scaling.resume_work);
+		ufshcd_cancel_clk_scaling_boost(hba);
 		ufshcd_suspend_clkscaling(hba);
 	}
 
@@ -8618,8 +9052,11 @@ void ufshcd_remove(struct ufs_hba *hba)
 
 	ufshcd_exit_clk_gating(hba);
 	ufshcd_exit_hibern8_on_idle(hba);
+	ufshcd_exit_idle_pred(hba);
+	ufshcd_exit_db_batch(hba);
 	if (ufshcd_is_clkscaling_supported(hba)) {
 		device_remove_file(hba->dev, &hba->clk_scaling.enable_attr);
+		device_remove_file(hba->dev, &hba->clk_scaling.predict_attr);
 		devfreq_remove_device(hba->devfreq);
 	}
 	ufshcd_hba_exit(hba);
@@ -8937,6 +9374,7 @@ static ssize_t ufshcd_clkscale_enable_store(struct device *dev,
 
 	cancel_work_sync(&hba->clk_scaling.suspend_work);
 	cancel_work_sync(&hba->clk_scaling.resume_work);
+	ufshcd_cancel_clk_scaling_boost(hba);
 
 	hba->clk_scaling.is_allowed = value;
 
@@ -8956,6 +9394,59 @@ out:
 	return count;
 }
 
+static ssize_t ufshcd_clkscale_predict_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%d\n",
+			hba->clk_scaling.is_predictive);
+}
+
+static ssize_t ufshcd_clkscale_predict_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	unsigned long flags;
+	u32 value;
+
+	if (kstrtou32(buf, 0, &value))
+		return -EINVAL;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	hba->clk_scaling.is_predictive = !!value;
+	hba->clk_scaling.boost_until = jiffies;
+	hba->clk_scaling.down_cnt = 0;
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+
+	return count;
+}
+
+static void ufshcd_clk_scaling_boost_work(struct work_struct *work)
+{
+	struct ufs_hba *hba = container_of(work, struct ufs_hba,
+					   clk_scaling.boost_work);
+	unsigned long irq_flags;
+	int ret = 0;
+
+	/* serialize against devfreq's own ->target() calls */
+	mutex_lock(&hba->devfreq->lock);
+	if (hba->clk_scaling.is_allowed && !hba->clk_scaling.is_scaled_up)
+		ret = ufshcd_devfreq_scale(hba, true);
+	mutex_unlock(&hba->devfreq->lock);
+
+	if (ret)
+		dev_err(hba->dev, "%s: failed to scale clocks up %d\n",
+			__func__, ret);
+
+	spin_lock_irqsave(hba->host->host_lock, irq_flags);
+	hba->clk_scaling.boost_until = jiffies +
+		msecs_to_jiffies(UFSHCD_BOOST_HOLD_MS);
+	hba->clk_scaling.down_cnt = 0;
+	hba->clk_scaling.is_boost_pending = false;
+	spin_unlock_irqrestore(hba->host->host_lock, irq_flags);
+}
+
 static void ufshcd_clk_scaling_suspend_work(struct work_struct *work)
 {
 	struct ufs_hba *hba = container_of(work, struct ufs_hba,
@@ -8995,18 +9486,40 @@ static int ufshcd_devfreq_target(struct device *dev,
 {
 	int ret = 0;
 	struct ufs_hba *hba = dev_get_drvdata(dev);
+	struct ufs_clk_scaling *scaling = &hba->clk_scaling;
 	bool release_clk_hold = false;
+	bool scale_up;
 	unsigned long irq_flags;
 
 	if (!ufshcd_is_clkscaling_supported(hba))
 		return -EINVAL;
 
+	/* simple_ondemand only ever asks for the max or the min */
+	if (*freq != UINT_MAX && *freq != 0)
+		return 0;
+	scale_up = *freq == UINT_MAX;
+
 	spin_lock_irqsave(hba->host->host_lock, irq_flags);
 	if (ufshcd_eh_in_progress(hba)) {
 		spin_unlock_irqrestore(hba->host->host_lock, irq_flags);
 		return 0;
 	}
 
+	/*
+	 * In predictive mode, hold the high gear for a while after a boost
+	 * and only scale down once devfreq asked for it several windows in
+	 * a row, so short gaps in a burst don't bounce the link.
+	 */
+	if (scale_up) {
+		scaling->down_cnt = 0;
+	} else if (scaling->is_predictive && scaling->is_scaled_up &&
+		   (time_before(jiffies, scaling->boost_until) ||
+		    ++scaling->down_cnt < UFSHCD_SCALE_DOWN_CNT)) {
+		spin_unlock_irqrestore(hba->host->host_lock, irq_flags);
+		*freq = UINT_MAX;
+		return 0;
+	}
+
 	if (ufshcd_is_clkgating_allowed(hba) &&
 	    (hba->clk_gating.state != CLKS_ON)) {
 		if (cancel_delayed_work(&hba->clk_gating.gate_work)) {
@@ -9026,17 +9539,17 @@ static int ufshcd_devfreq_target(struct device *dev,
 	}
 	spin_unlock_irqrestore(hba->host->host_lock, irq_flags);
 
-	if (*freq == UINT_MAX)
-		err = ufshcd_scale_clks(hba, true);
-	else if (*freq == 0)
-		err = ufshcd_scale_clks(hba, false);
+	if (ufshcd_is_devfreq_scaling_required(hba, scale_up))
+		ret = ufshcd_devfreq_scale(hba, scale_up);
 
 	spin_lock_irqsave(hba->host->host_lock, irq_flags);
+	if (!ret && !scale_up)
+		scaling->down_cnt = 0;
 	if (release_clk_hold)
 		__ufshcd_release(hba);
 	spin_unlock_irqrestore(hba->host->host_lock, irq_flags);
 
-	return err;
+	return ret;
 }
 
 static int ufshcd_devfreq_get_dev_status(struct device *dev,
@@ -9086,6 +9599,14 @@ static void ufshcd_clkscaling_init_sysfs(struct ufs_hba *hba)
 	hba->clk_scaling.enable_attr.attr.mode = S_IRUGO | S_IWUSR;
 	if (device_create_file(hba->dev, &hba->clk_scaling.enable_attr))
 		dev_err(hba->dev, "Failed to create sysfs for clkscale_enable\n");
+
+	hba->clk_scaling.predict_attr.show = ufshcd_clkscale_predict_show;
+	hba->clk_scaling.predict_attr.store = ufshcd_clkscale_predict_store;
+	sysfs_attr_init(&hba->clk_scaling.predict_attr.attr);
+	hba->clk_scaling.predict_attr.attr.name = "clkscale_predict";
+	hba->clk_scaling.predict_attr.attr.mode = S_IRUGO | S_IWUSR;
+	if (device_create_file(hba->dev, &hba->clk_scaling.predict_attr))
+		dev_err(hba->dev, "Failed to create sysfs for clkscale_predict\n");
 }
 
 static void ufshcd_init_lanes_per_dir(struct ufs_hba *hba)
@@ -9199,6 +9720,8 @@ int ufshcd_init(struct ufs_hba *hba, void __iomem *mmio_base, unsigned int irq)
 
 	ufshcd_init_clk_gating(hba);
 	ufshcd_init_hibern8_on_idle(hba);
+	ufshcd_init_idle_pred(hba);
+	ufshcd_init_db_batch(hba);
 
 	/*
 	 * In order to avoid any spurious interrupt immediately after
@@ -9252,6 +9775,8 @@ int ufshcd_init(struct ufs_hba *hba, void __iomem *mmio_base, unsigned int irq)
 			  ufshcd_clk_scaling_suspend_work);
 		INIT_WORK(&hba->clk_scaling.resume_work,
 			  ufshcd_clk_scaling_resume_work);
+		INIT_WORK(&hba->clk_scaling.boost_work,
+			  ufshcd_clk_scaling_boost_work);
 
 		snprintf(wq_name, ARRAY_SIZE(wq_name), "ufs_clkscaling_%d",
 			 host->host_no);
@@ -9300,6 +9825,8 @@ out_remove_scsi_host:
 	scsi_remove_host(hba->host);
 exit_gating:
 	ufshcd_exit_clk_gating(hba);
+	ufshcd_exit_idle_pred(hba);
+	ufshcd_exit_db_batch(hba);
 	ufshcd_exit_latency_hist(hba);
 out_disable:
 	hba->is_irq_enabled = false;
@@ -47,6 +47,7 @@
 #include <linux/spinlock.h>
 #include <linux/rwsem.h>
 #include <linux/workqueue.h>
+#include <linux/hrtimer.h>
 #include <linux/errno.h>
 #include <linux/types.h>
 #include <linux/wait.h>
@@ -191,6 +192,7 @@ struct ufs_pm_lvl_states {
  * @issue_time_stamp: time stamp for debug purposes
  * @complete_time_stamp: time stamp for statistics
  * @req_abort_skip: skip request abort task flag
+ * @issue_pm_state: link/clock power state seen when the command was queued
  */
 struct ufshcd_lrb {
 	struct utp_transfer_req_desc *utr_descriptor_ptr;
@@ -216,6 +218,7 @@ struct ufshcd_lrb {
 	ktime_t complete_time_stamp;
 
 	bool req_abort_skip;
+	u8 issue_pm_state;
 };
 
 /**
@@ -459,6 +462,62 @@ struct ufs_hibern8_on_idle {
 	bool is_enabled;
 };
 
+#define UFS_IDLE_PRED_LUNS	8
+
+/**
+ * struct ufs_idle_pred - idle gap prediction for clock gating and hibern8
+ * @is_enabled: scale the gating/hibern8 delays by the predicted idle gap
+ * @last_arrival: arrival time of the last request, per LUN
+ * @last_complete: completion time of the last request, per LUN
+ * @gap_us: EWMA of the idle gaps (in usec) seen before new requests, per LUN
+ * @h8_enter_t: time of the last hibern8 entry
+ * @gate_t: time of the last clock gating
+ * @h8_enter_cnt: number of hibern8 entries
+ * @h8_exit_cnt: number of hibern8 exits
+ * @h8_wasted_cnt: hibern8 exits that came before the break-even time
+ * @gate_cnt: number of clock gatings
+ * @ungate_cnt: number of clock ungatings
+ * @gate_wasted_cnt: ungatings that came before the break-even time
+ * @enable_attr: sysfs attribute to enable/disable idle prediction
+ */
+struct ufs_idle_pred {
+	bool is_enabled;
+	ktime_t last_arrival[UFS_IDLE_PRED_LUNS];
+	ktime_t last_complete[UFS_IDLE_PRED_LUNS];
+	u32 gap_us[UFS_IDLE_PRED_LUNS];
+	ktime_t h8_enter_t;
+	ktime_t gate_t;
+	u64 h8_enter_cnt;
+	u64 h8_exit_cnt;
+	u64 h8_wasted_cnt;
+	u64 gate_cnt;
+	u64 ungate_cnt;
+	u64 gate_wasted_cnt;
+	struct device_attribute enable_attr;
+};
+
+/**
+ * struct ufs_db_batch - transfer request doorbell batching
+ * @is_enabled: defer doorbell writes while more requests are queued
+ * @pending: tags composed and marked outstanding but not yet rung
+ * @count: number of tags in @pending
+ * @timer: bounds how long a pending tag may wait for the doorbell
+ * @rung_cnt: number of doorbell writes covering batched tags
+ * @deferred_cnt: number of requests whose doorbell write was deferred
+ * @timer_cnt: batches that were flushed by @timer expiry
+ * @enable_attr: sysfs attribute to enable/disable doorbell batching
+ */
+struct ufs_db_batch {
+	bool is_enabled;
+	unsigned long pending;
+	u32 count;
+	struct hrtimer timer;
+	u64 rung_cnt;
+	u64 deferred_cnt;
+	u64 timer_cnt;
+	struct device_attribute enable_attr;
+};
+
 struct ufs_saved_pwr_info {
 	struct ufs_pa_layer_attr info;
 	bool is_valid;
@@ -482,6 +541,14 @@ struct ufs_saved_pwr_info {
  * @is_busy_started: tracks if busy period has started or not
  * @is_suspended: tracks if devfreq is suspended or not
  * @is_scaled_up: tracks if we are currently scaled up or scaled down
+ * @predict_attr: sysfs attribute to enable/disable predictive scaling
+ * @boost_work: worker to scale up ahead of the devfreq polling window
+ * @boost_until: no scale down is done before this time (in jiffies)
+ * @burst_start_t: start time (in jiffies) of the current read burst window
+ * @burst_reads: number of sync reads issued in the current burst window
+ * @down_cnt: consecutive scale down requests seen from devfreq
+ * @is_predictive: scale up on queue depth spikes and sync read bursts
+ * @is_boost_pending: tracks if boost_work is queued or running
  */
 struct ufs_clk_scaling {
 	int active_reqs;
@@ -497,6 +564,14 @@ struct ufs_clk_scaling {
 	bool is_busy_started;
 	bool is_suspended;
 	bool is_scaled_up;
+	struct device_attribute predict_attr;
+	struct work_struct boost_work;
+	unsigned long boost_until;
+	unsigned long burst_start_t;
+	int burst_reads;
+	int down_cnt;
+	bool is_predictive;
+	bool is_boost_pending;
 };
 
 /**
@@ -535,6 +610,9 @@ struct debugfs_files {
 	struct dentry *dme_peer_read;
 	struct dentry *dbg_print_en;
 	struct dentry *req_stats;
+	struct dentry *lat_hist;
+	struct dentry *idle_pred;
+	struct dentry *db_batch;
 	struct dentry *query_stats;
 	u32 dme_local_attr_id;
 	u32 dme_peer_attr_id;
@@ -577,6 +655,46 @@ struct ufshcd_req_stat {
 };
 #endif
 
+/* latency histogram classes */
+enum ufs_hist_op {
+	UFS_HIST_OP_READ,
+	UFS_HIST_OP_WRITE,
+	UFS_HIST_OP_FLUSH,
+	UFS_HIST_OP_DISCARD,
+	UFS_HIST_OP_NUM,
+};
+
+enum ufs_hist_size {
+	UFS_HIST_SIZE_4K,	/* up to 4KB */
+	UFS_HIST_SIZE_64K,	/* up to 64KB */
+	UFS_HIST_SIZE_LARGE,
+	UFS_HIST_SIZE_NUM,
+};
+
+enum ufs_hist_pm {
+	UFS_HIST_PM_ACTIVE,	/* clocks on, link active */
+	UFS_HIST_PM_HIBERN8,	/* clocks on, link in hibern8 */
+	UFS_HIST_PM_GATED,	/* clocks gated */
+	UFS_HIST_PM_NUM,
+};
+
+#define UFS_HIST_LUNS		8
+/* bucket n counts completions taking [2^(n-1), 2^n) usec, last is open */
+#define UFS_HIST_BUCKETS	20
+
+#ifdef CONFIG_DEBUG_FS
+/**
+ * struct ufshcd_lat_hist - log2 bucketed request latency histograms
+ * @op: completions by request type, size class and issue power state
+ * @lun: completions by LUN and issue power state
+ */
+struct ufshcd_lat_hist {
+	u32 op[UFS_HIST_OP_NUM][UFS_HIST_SIZE_NUM][UFS_HIST_PM_NUM]
+		[UFS_HIST_BUCKETS];
+	u32 lun[UFS_HIST_LUNS][UFS_HIST_PM_NUM][UFS_HIST_BUCKETS];
+};
+#endif
+
 /**
  * struct ufs_stats - keeps usage/err statistics
  * @enabled: enable tag stats for debugfs
@@ -584,6 +702,7 @@ struct ufshcd_req_stat {
  * @q_depth: current amount of busy slots
  * @err_stats: counters to keep track of various errors
  * @req_stats: request handling time statistics per request type
+ * @lat_hist: request latency histograms
  * @query_stats_arr: array that holds query statistics
  * @hibern8_exit_cnt: Counter to keep track of number of exits,
  *		reset this after link-startup.
@@ -602,6 +721,7 @@ struct ufs_stats {
 	int q_depth;
 	int err_stats[UFS_ERR_MAX];
 	struct ufshcd_req_stat req_stats[TS_NUM_STATS];
+	struct ufshcd_lat_hist lat_hist;
 	int query_stats_arr[UPIU_QUERY_OPCODE_MAX][MAX_QUERY_IDN];
 
 #endif
@@ -683,6 +803,8 @@ struct ufs_stats {
  * @pwr_info: holds current power mode
  * @max_pwr_info: keeps the device max valid pwm
  * @hibern8_on_idle: UFS Hibern8 on idle related data
+ * @idle_pred: idle gap predictor driving clock gating/hibern8 entry delays
+ * @db_batch: transfer request doorbell batching state
  * @urgent_bkops_lvl: keeps track of urgent bkops level for device
  * @is_urgent_bkops_lvl_checked: keeps track if the urgent bkops level for
  *  device is known or not.
@@ -842,6 +964,8 @@ struct ufs_hba {
 
 	struct ufs_clk_gating clk_gating;
 	struct ufs_hibern8_on_idle hibern8_on_idle;
+	struct ufs_idle_pred idle_pred;
+	struct ufs_db_batch db_batch;
 
 	/* Control to enable/disable host capabilities */
 	u32 caps;
@@ -1065,8 +1189,14 @@ static inline void ufshcd_init_req_stats(struct ufs_hba *hba)
 {
 	memset(hba->ufs_stats.req_stats, 0, sizeof(hba->ufs_stats.req_stats));
 }
+
+static inline void ufshcd_init_lat_hist(struct ufs_hba *hba)
+{
+	memset(&hba->ufs_stats.lat_hist, 0, sizeof(hba->ufs_stats.lat_hist));
+}
 #else
 static inline void ufshcd_init_req_stats(struct ufs_hba *hba) {}
+static inline void ufshcd_init_lat_hist(struct ufs_hba *hba) {}
 #endif
 
 #define ASCII_STD true
@@ -64,6 +64,9 @@ static int bam_adaptive_timer_enabled;
 module_param_named(adaptive_timer_enabled,
 			bam_adaptive_timer_enabled,
 		   int, S_IRUGO | S_IWUSR | S_IWGRP);
+static int rx_poll_budget = 64;
+module_param_named(rx_poll_budget, rx_poll_budget,
+		   int, S_IRUGO | S_IWUSR | S_IWGRP);
 
 static struct bam_ops_if bam_default_ops = {
 	/* smsm */
@@ -165,6 +168,8 @@ struct bam_ch_info {
 	char name[BAM_DMUX_CH_NAME_MAX_LEN];
 	int num_tx_pkts;
 	int use_wm;
+	int rx_list;
+	struct sk_buff_head rx_batch;
 };
 
 #define A2_NUM_PIPES		6
@@ -205,6 +210,7 @@ static int bam_mux_initialized;
 
 static int polling_mode;
 static unsigned long rx_timer_interval;
+static int rx_batch_len;
 
 static LIST_HEAD(bam_rx_pool);
 static DEFINE_MUTEX(bam_rx_pool_mutexlock);
@@ -519,14 +525,56 @@ static void process_dynamic_mtu(bool current_state)
 	old_state = current_state;
 }
 
-static void bam_mux_process_data(struct sk_buff *rx_skb)
+/**
+ * bam_mux_flush_rx_batch() - Deliver the batched rx data packets to clients
+ *
+ * Data packets are batched per channel while the rx descriptors are drained
+ * and delivered here, either as a list to clients which asked for it or one
+ * by one otherwise. The rx pool is refilled once for the whole batch. Must be
+ * called from the rx polling context.
+ */
+static void bam_mux_flush_rx_batch(void)
 {
 	unsigned long flags;
-	struct bam_mux_hdr *rx_hdr;
-	unsigned long event_data;
-	uint8_t ch_id;
+	struct sk_buff *skb;
 	void (*notify)(void *, int, unsigned long);
 	void *priv;
+	int rx_list;
+	int i;
+
+	if (!rx_batch_len)
+		return;
+
+	for (i = 0; i < BAM_DMUX_NUM_CHANNELS; ++i) {
+		if (skb_queue_empty(&bam_ch[i].rx_batch))
+			continue;
+
+		spin_lock_irqsave(&bam_ch[i].lock, flags);
+		notify = bam_ch[i].notify;
+		priv = bam_ch[i].priv;
+		rx_list = bam_ch[i].rx_list;
+		spin_unlock_irqrestore(&bam_ch[i].lock, flags);
+
+		if (notify && rx_list)
+			notify(priv, BAM_DMUX_RECEIVE_LIST,
+				(unsigned long)(&bam_ch[i].rx_batch));
+		else if (notify)
+			while ((skb = __skb_dequeue(&bam_ch[i].rx_batch)))
+				notify(priv, BAM_DMUX_RECEIVE,
+					(unsigned long)(skb));
+
+		/* anything left was either not consumed or has no client */
+		__skb_queue_purge(&bam_ch[i].rx_batch);
+	}
+	rx_batch_len = 0;
+
+	queue_rx();
+}
+
+static void bam_mux_process_data(struct sk_buff *rx_skb)
+{
+	struct bam_mux_hdr *rx_hdr;
+	uint8_t ch_id;
 
 	rx_hdr = (struct bam_mux_hdr *)rx_skb->data;
 	ch_id = rx_hdr->ch_id;
@@ -538,22 +586,13 @@ static void bam_mux_process_data(struct sk_buff *rx_skb)
 	rx_skb->len = rx_hdr->pkt_len;
 	rx_skb->truesize = rx_hdr->pkt_len + sizeof(struct sk_buff);
 
-	event_data = (unsigned long)(rx_skb);
-	notify = NULL;
-	priv = NULL;
-
-	spin_lock_irqsave(&bam_ch[ch_id].lock, flags);
-	if (bam_ch[ch_id].notify) {
-		notify = bam_ch[ch_id].notify;
-		priv = bam_ch[ch_id].priv;
-	}
-	spin_unlock_irqrestore(&bam_ch[ch_id].lock, flags);
-	if (notify)
-		notify(priv, BAM_DMUX_RECEIVE, event_data);
-	else
-		dev_kfree_skb_any(rx_skb);
-
-	queue_rx();
+	/*
+	 * Buffers are only returned to the rx pool when the batch is flushed,
+	 * so never let a batch hold more than half of the pool.
+	 */
+	__skb_queue_tail(&bam_ch[ch_id].rx_batch, rx_skb);
+	if (++rx_batch_len >= min_t(int, rx_poll_budget, num_buffers / 2))
+		bam_mux_flush_rx_batch();
 }
 
 /**
@@ -698,6 +737,10 @@ static void handle_bam_mux_cmd(struct work_struct *work)
 		return;
 	}
 
+	/* control commands must not overtake data already batched */
+	if (rx_hdr->cmd != BAM_MUX_HDR_CMD_DATA)
+		bam_mux_flush_rx_batch();
+
 	switch (rx_hdr->cmd) {
 	case BAM_MUX_HDR_CMD_DATA:
 		if (rx_hdr->pkt_len == 0xffff)
@@ -1121,6 +1164,7 @@ int msm_bam_dmux_open(uint32_t id, void *priv,
 	bam_ch[id].status |= BAM_CH_LOCAL_OPEN;
 	bam_ch[id].num_tx_pkts = 0;
 	bam_ch[id].use_wm = 0;
+	bam_ch[id].rx_list = 0;
 	spin_unlock_irqrestore(&bam_ch[id].lock, flags);
 
 	notify(priv, BAM_DMUX_TRANSMIT_SIZE, ul_mtu);
@@ -1213,6 +1257,24 @@ int msm_bam_dmux_close(uint32_t id)
 	return rc;
 }
 
+int msm_bam_dmux_set_rx_list(uint32_t id, int enable)
+{
+	unsigned long flags;
+	int ret = 0;
+
+	if (id >= BAM_DMUX_NUM_CHANNELS)
+		return -EINVAL;
+
+	spin_lock_irqsave(&bam_ch[id].lock, flags);
+	if (bam_ch_is_local_open(id))
+		bam_ch[id].rx_list = !!enable;
+	else
+		ret = -ENODEV;
+	spin_unlock_irqrestore(&bam_ch[id].lock, flags);
+
+	return ret;
+}
+
 int msm_bam_dmux_is_ch_full(uint32_t id)
 {
 	unsigned long flags;
@@ -1331,6 +1393,7 @@ static void rx_switch_to_interrupt_mode(void)
 		info->sps_size = iov.size;
 		handle_bam_mux_cmd(&info->work);
 	}
+	bam_mux_flush_rx_batch();
 	return;
 
 fail:
@@ -1380,6 +1443,7 @@ static void rx_timer_work_func(struct work_struct *work)
 				BAM_DMUX_LOG(
 						"%s: polling exit, global reset detected\n",
 						__func__);
+				bam_mux_flush_rx_batch();
 				return;
 			}
 
@@ -1424,6 +1488,7 @@ static void rx_timer_work_func(struct work_struct *work)
 			info->sps_size = iov.size;
 			handle_bam_mux_cmd(&info->work);
 		}
+		bam_mux_flush_rx_batch();
 
 		if (inactive_cycles >= POLLING_INACTIVITY) {
 			BAM_DMUX_LOG("%s: polling exit, no data\n", __func__);
@@ -2766,6 +2831,7 @@ static int bam_dmux_probe(struct platform_device *pdev)
 
 	for (rc = 0; rc < BAM_DMUX_NUM_CHANNELS; ++rc) {
 		spin_lock_init(&bam_ch[rc].lock);
+		skb_queue_head_init(&bam_ch[rc].rx_batch);
 		scnprintf(bam_ch[rc].name, BAM_DMUX_CH_NAME_MAX_LEN,
 					"bam_dmux_ch_%d", rc);
 		/* bus 2, ie a2 stream 2 */
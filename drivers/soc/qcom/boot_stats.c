@@ -140,6 +140,18 @@ unsigned long long int msm_timer_get_sclk_ticks(void)
 	return t1;
 }
 
+/*
+ * Report the phases of a peripheral image boot: reading and setting up
+ * the metadata, loading and verifying the segments, then authentication
+ * and reset.
+ */
+void boot_stats_pil(const char *name, s64 init_us, s64 load_us, s64 auth_us)
+{
+	pr_info("KPI: PIL %s: init %lld us, load %lld us, auth %lld us\n",
+		name, init_us, load_us, auth_us);
+}
+EXPORT_SYMBOL(boot_stats_pil);
+
 int boot_stats_init(void)
 {
 	int ret;
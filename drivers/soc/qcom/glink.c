@@ -14,11 +14,13 @@
 #include <linux/ipc_logging.h>
 #include <linux/kthread.h>
 #include <linux/list.h>
+#include <linux/log2.h>
 #include <linux/spinlock.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/sched.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/types.h>
 #include <linux/workqueue.h>
@@ -40,6 +42,11 @@
 #define GLINK_CH_XPRT_NAME_SIZE ((3 * GLINK_NAME_SIZE) + 4)
 #define GLINK_KTHREAD_PRIO 1
 
+/* Size classes and depth of the per-channel rx intent pool */
+#define GLINK_RX_INTENT_POOL_MIN_SIZE	64
+#define GLINK_RX_INTENT_POOL_MAX_SIZE	SZ_16K
+#define GLINK_RX_INTENT_POOL_DEPTH	8
+
 /**
  * struct glink_qos_priority_bin - Packet Scheduler's priority bucket
  * @max_rate_kBps:	Maximum rate supported by the priority bucket.
@@ -200,6 +207,9 @@ static DEFINE_MUTEX(edge_list_lock_lhd0);
  * @local_rx_intent_list:		Active RX Intents queued by client
  * @local_rx_intent_ntfy_list:		Client notified, waiting for rx_done()
  * @local_rx_intent_free_list:		Available intent container structure
+ * @local_rx_intent_pool_list:		Released intents with buffers
+ * @local_rx_intent_pool_cnt:		Number of intents in the pool
+ * @rx_intent_pool:			Channel pools its rx intents
  *
  * @rmt_rx_intent_lst_lock_lhc2:	Remote RX intent list lock
  * @rmt_rx_intent_list:			Remote RX intent list
@@ -230,6 +240,10 @@ static DEFINE_MUTEX(edge_list_lock_lhd0);
  * @req_rate_kBps:			Current QoS request by the channel.
  * @tx_intent_cnt:			Intent count to transmit soon in future.
  * @tx_cnt:				Packets to be picked by tx scheduler.
+ * @tx_pkt_cnt:				Packets fully transmitted.
+ * @tx_lat_total_us:			Sum of the queueing latencies of the
+ *					transmitted packets.
+ * @tx_lat_max_us:			Longest queueing latency of a packet.
  */
 struct channel_ctx {
 	struct rwref_lock ch_state_lhb2;
@@ -278,6 +292,9 @@ struct channel_ctx {
 	struct list_head local_rx_intent_list;
 	struct list_head local_rx_intent_ntfy_list;
 	struct list_head local_rx_intent_free_list;
+	struct list_head local_rx_intent_pool_list;
+	uint32_t local_rx_intent_pool_cnt;
+	bool rx_intent_pool;
 
 	spinlock_t rmt_rx_intent_lst_lock_lhc2;
 	struct list_head rmt_rx_intent_list;
@@ -309,6 +326,9 @@ struct channel_ctx {
 	unsigned long req_rate_kBps;
 	uint32_t tx_intent_cnt;
 	uint32_t tx_cnt;
+	uint32_t tx_pkt_cnt;
+	uint64_t tx_lat_total_us;
+	uint32_t tx_lat_max_us;
 };
 
 static struct glink_core_if core_impl;
@@ -393,7 +413,8 @@ static struct glink_core_rx_intent *ch_get_local_rx_intent_notified(
 		struct channel_ctx *ctx, const void *ptr);
 
 static void ch_remove_local_rx_intent_notified(struct channel_ctx *ctx,
-			struct glink_core_rx_intent *liid_ptr, bool reuse);
+			struct glink_core_rx_intent *liid_ptr, bool reuse,
+			bool pool);
 
 static struct glink_core_rx_intent *ch_get_free_local_rx_intent(
 		struct channel_ctx *ctx);
@@ -1271,6 +1292,68 @@ void ch_push_remote_rx_intent(struct channel_ctx *ctx, size_t size,
 			intent->intent_size);
 }
 
+/**
+ * ch_rx_intent_buf_size() - Size of the buffer to allocate for an rx_intent
+ * @ctx:	Local channel context
+ * @size:	Requested size of intent
+ *
+ * Return: @size rounded up to its pool size class if the channel pools its
+ * intents and the size is poolable, @size otherwise.
+ */
+static size_t ch_rx_intent_buf_size(struct channel_ctx *ctx, size_t size)
+{
+	if (!ctx->rx_intent_pool || size > GLINK_RX_INTENT_POOL_MAX_SIZE)
+		return size;
+
+	if (size < GLINK_RX_INTENT_POOL_MIN_SIZE)
+		return GLINK_RX_INTENT_POOL_MIN_SIZE;
+
+	return roundup_pow_of_two(size);
+}
+
+/**
+ * ch_get_pooled_local_rx_intent() - Take an intent out of the intent pool
+ * @ctx:	Local channel context
+ * @buf_size:	Size class of the intent buffer
+ *
+ * Return: Pooled intent with a buffer of @buf_size, or NULL if there is none.
+ */
+static struct glink_core_rx_intent *ch_get_pooled_local_rx_intent(
+	struct channel_ctx *ctx, size_t buf_size)
+{
+	struct glink_core_rx_intent *intent;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ctx->local_rx_intent_lst_lock_lhc1, flags);
+	list_for_each_entry(intent, &ctx->local_rx_intent_pool_list, list) {
+		if (intent->buf_size == buf_size) {
+			list_del(&intent->list);
+			ctx->local_rx_intent_pool_cnt--;
+			spin_unlock_irqrestore(
+					&ctx->local_rx_intent_lst_lock_lhc1,
+					flags);
+			return intent;
+		}
+	}
+	spin_unlock_irqrestore(&ctx->local_rx_intent_lst_lock_lhc1, flags);
+	return NULL;
+}
+
+/**
+ * ch_rx_intent_poolable() - Check if a released intent can be pooled
+ * @ctx:	Local channel context
+ * @intent:	Intent released by the client
+ *
+ * Return: true if the intent should keep its buffer and go to the pool.
+ */
+static bool ch_rx_intent_poolable(struct channel_ctx *ctx,
+	struct glink_core_rx_intent *intent)
+{
+	return ctx->rx_intent_pool && intent->data &&
+		intent->buf_size <= GLINK_RX_INTENT_POOL_MAX_SIZE &&
+		ctx->local_rx_intent_pool_cnt < GLINK_RX_INTENT_POOL_DEPTH;
+}
+
 /**
  * ch_push_local_rx_intent() - Create an rx_intent
  * @ctx:	Local channel context
@@ -1278,13 +1361,15 @@ void ch_push_remote_rx_intent(struct channel_ctx *ctx, size_t size,
  * @size:	Size of intent
  *
  * This functions creates a local intent and adds it to the local
- * intent list.
+ * intent list. Channels opened with GLINK_OPT_RX_INTENT_POOL take the intent
+ * from the pool when one of the same size class is available.
  */
 struct glink_core_rx_intent *ch_push_local_rx_intent(struct channel_ctx *ctx,
 		const void *pkt_priv, size_t size)
 {
 	struct glink_core_rx_intent *intent;
 	unsigned long flags;
+	size_t buf_size;
 	int ret;
 
 	if (GLINK_MAX_PKT_SIZE < size) {
@@ -1293,6 +1378,11 @@ struct glink_core_rx_intent *ch_push_local_rx_intent(struct channel_ctx *ctx,
 		return NULL;
 	}
 
+	buf_size = ch_rx_intent_buf_size(ctx, size);
+	intent = ch_get_pooled_local_rx_intent(ctx, buf_size);
+	if (intent)
+		goto init_intent;
+
 	intent = ch_get_free_local_rx_intent(ctx);
 	if (!intent) {
 		if (ctx->max_used_liid >= ctx->transport_ptr->max_iid) {
@@ -1315,7 +1405,7 @@ struct glink_core_rx_intent *ch_push_local_rx_intent(struct channel_ctx *ctx,
 
 	/* transport is responsible for allocating/reserving for the intent */
 	ret = ctx->transport_ptr->ops->allocate_rx_intent(
-					ctx->transport_ptr->ops, size, intent);
+				ctx->transport_ptr->ops, buf_size, intent);
 	if (ret < 0) {
 		/* intent data allocation failure */
 		GLINK_ERR_CH(ctx, "%s: unable to allocate intent sz[%zu] %d",
@@ -1327,7 +1417,9 @@ struct glink_core_rx_intent *ch_push_local_rx_intent(struct channel_ctx *ctx,
 				flags);
 		return NULL;
 	}
+	intent->buf_size = buf_size;
 
+init_intent:
 	intent->pkt_priv = pkt_priv;
 	intent->intent_size = size;
 	intent->write_offset = 0;
@@ -1558,13 +1650,15 @@ struct glink_core_rx_intent *ch_get_local_rx_intent_notified(
  * @ctx:	Local channel context
  * @ptr:	Pointer to the rx intent
  * @reuse:	Reuse the rx intent
+ * @pool:	Keep the intent and its buffer in the intent pool
  *
  * This functions parses the local intent notify list for a specific channel
  * and checks for the intent. If found, the function deletes the intent
- * from local_rx_intent_notified list and adds it to local_rx_intent_free list.
+ * from local_rx_intent_notified list and adds it to local_rx_intent_free list,
+ * or to the intent pool if @pool is set.
  */
 void ch_remove_local_rx_intent_notified(struct channel_ctx *ctx,
-	struct glink_core_rx_intent *liid_ptr, bool reuse)
+	struct glink_core_rx_intent *liid_ptr, bool reuse, bool pool)
 {
 	struct glink_core_rx_intent *ptr_intent, *tmp_intent;
 	unsigned long flags;
@@ -1583,12 +1677,17 @@ void ch_remove_local_rx_intent_notified(struct channel_ctx *ctx,
 			ptr_intent->bounce_buf = NULL;
 			ptr_intent->write_offset = 0;
 			ptr_intent->pkt_size = 0;
-			if (reuse)
+			if (reuse) {
 				list_add_tail(&ptr_intent->list,
 					&ctx->local_rx_intent_list);
-			else
+			} else if (pool) {
+				list_add_tail(&ptr_intent->list,
+					&ctx->local_rx_intent_pool_list);
+				ctx->local_rx_intent_pool_cnt++;
+			} else {
 				list_add_tail(&ptr_intent->list,
 					&ctx->local_rx_intent_free_list);
+			}
 			spin_unlock_irqrestore(
 					&ctx->local_rx_intent_lst_lock_lhc1,
 					flags);
@@ -1671,6 +1770,15 @@ void ch_purge_intent_lists(struct channel_ctx *ctx)
 		GLINK_INFO_CH(ctx, "%s: waiting on glink_rx_done()\n",
 				__func__);
 
+	list_for_each_entry_safe(ptr_intent, tmp_intent,
+				&ctx->local_rx_intent_pool_list, list) {
+		ctx->transport_ptr->ops->deallocate_rx_intent(
+					ctx->transport_ptr->ops, ptr_intent);
+		list_del(&ptr_intent->list);
+		kfree(ptr_intent);
+	}
+	ctx->local_rx_intent_pool_cnt = 0;
+
 	list_for_each_entry_safe(ptr_intent, tmp_intent,
 				&ctx->local_rx_intent_free_list, list) {
 		list_del(&ptr_intent->list);
@@ -1853,6 +1961,7 @@ static struct channel_ctx *ch_name_to_ch_ctx_create(
 	INIT_LIST_HEAD(&ctx->local_rx_intent_list);
 	INIT_LIST_HEAD(&ctx->local_rx_intent_ntfy_list);
 	INIT_LIST_HEAD(&ctx->local_rx_intent_free_list);
+	INIT_LIST_HEAD(&ctx->local_rx_intent_pool_list);
 	spin_lock_init(&ctx->local_rx_intent_lst_lock_lhc1);
 	INIT_LIST_HEAD(&ctx->rmt_rx_intent_list);
 	spin_lock_init(&ctx->rmt_rx_intent_lst_lock_lhc2);
@@ -2608,6 +2717,7 @@ void *glink_open(const struct glink_open_config *cfg)
 	ctx->notify_tx_abort = cfg->notify_tx_abort;
 	ctx->notify_rx_tracer_pkt = cfg->notify_rx_tracer_pkt;
 	ctx->notify_remote_rx_intent = cfg->notify_remote_rx_intent;
+	ctx->rx_intent_pool = !!(cfg->options & GLINK_OPT_RX_INTENT_POOL);
 
 	if (!ctx->notify_rx_intent_req)
 		ctx->notify_rx_intent_req = glink_dummy_notify_rx_intent_req;
@@ -3166,6 +3276,7 @@ int glink_rx_done(void *handle, const void *ptr, bool reuse)
 	struct channel_ctx *ctx = (struct channel_ctx *)handle;
 	struct glink_core_rx_intent *liid_ptr;
 	uint32_t id;
+	bool pool = false;
 	int ret = 0;
 
 	ret = glink_get_ch_ctx(ctx);
@@ -3194,11 +3305,13 @@ int glink_rx_done(void *handle, const void *ptr, bool reuse)
 			ctx->transport_ptr->ops->deallocate_rx_intent(
 					ctx->transport_ptr->ops, liid_ptr);
 		}
+	} else if (ch_rx_intent_poolable(ctx, liid_ptr)) {
+		pool = true;
 	} else {
 		ctx->transport_ptr->ops->deallocate_rx_intent(
 					ctx->transport_ptr->ops, liid_ptr);
 	}
-	ch_remove_local_rx_intent_notified(ctx, liid_ptr, reuse);
+	ch_remove_local_rx_intent_notified(ctx, liid_ptr, reuse, pool);
 	/* send rx done */
 	ctx->transport_ptr->ops->tx_cmd_local_rx_done(ctx->transport_ptr->ops,
 			ctx->lcid, id, reuse);
@@ -5037,6 +5150,56 @@ static void glink_core_remote_rx_intent_put_cookie(
 	rwref_put(&ctx->ch_state_lhb2);
 }
 
+/**
+ * ch_queue_pooled_rx_intent() - Queue a pooled intent for a remote request
+ * @ctx:	Local channel context
+ * @size:	Size requested by the remote side
+ *
+ * Intents queued this way are reported to the client with a NULL pkt_priv.
+ *
+ * Return: true if an intent was taken from the pool and sent to the remote.
+ */
+static bool ch_queue_pooled_rx_intent(struct channel_ctx *ctx, size_t size)
+{
+	struct glink_core_rx_intent *intent;
+	unsigned long flags;
+	int ret;
+
+	if (!ctx->rx_intent_pool || size > GLINK_RX_INTENT_POOL_MAX_SIZE ||
+	    (ctx->transport_ptr->capabilities & GCAP_INTENTLESS))
+		return false;
+
+	intent = ch_get_pooled_local_rx_intent(ctx,
+				ch_rx_intent_buf_size(ctx, size));
+	if (!intent)
+		return false;
+
+	intent->pkt_priv = NULL;
+	intent->intent_size = size;
+	intent->write_offset = 0;
+	intent->pkt_size = 0;
+	intent->bounce_buf = NULL;
+
+	spin_lock_irqsave(&ctx->local_rx_intent_lst_lock_lhc1, flags);
+	list_add_tail(&intent->list, &ctx->local_rx_intent_list);
+	spin_unlock_irqrestore(&ctx->local_rx_intent_lst_lock_lhc1, flags);
+
+	ret = ctx->transport_ptr->ops->tx_cmd_local_rx_intent(
+			ctx->transport_ptr->ops, ctx->lcid, size, intent->id);
+	if (ret) {
+		spin_lock_irqsave(&ctx->local_rx_intent_lst_lock_lhc1, flags);
+		list_move_tail(&intent->list, &ctx->local_rx_intent_pool_list);
+		ctx->local_rx_intent_pool_cnt++;
+		spin_unlock_irqrestore(&ctx->local_rx_intent_lst_lock_lhc1,
+					flags);
+		return false;
+	}
+
+	GLINK_DBG_CH(ctx, "%s: L[%u]:%zu queued pooled intent\n", __func__,
+			intent->id, intent->intent_size);
+	return true;
+}
+
 /**
  * glink_core_rx_cmd_remote_rx_intent_req() - Receive a request for rx_intent
  *                                            from remote side
@@ -5069,6 +5232,13 @@ static void glink_core_rx_cmd_remote_rx_intent_req(
 		return;
 	}
 
+	if (ch_queue_pooled_rx_intent(ctx, size)) {
+		if_ptr->tx_cmd_remote_rx_intent_req_ack(if_ptr, ctx->lcid,
+							true);
+		rwref_put(&ctx->ch_state_lhb2);
+		return;
+	}
+
 	cb_ret = ctx->notify_rx_intent_req(ctx, ctx->user_priv, size);
 	if_ptr->tx_cmd_remote_rx_intent_req_ack(if_ptr, ctx->lcid, cb_ret);
 	rwref_put(&ctx->ch_state_lhb2);
@@ -5312,6 +5482,7 @@ static void xprt_schedule_tx(struct glink_core_xprt_ctx *xprt_ptr,
 			&xprt_ptr->prio_bin[ch_ptr->curr_priority].tx_ready);
 
 	spin_lock(&ch_ptr->tx_lists_lock_lhc3);
+	tx_info->queue_time = ktime_get();
 	list_add_tail(&tx_info->list_node, &ch_ptr->tx_active);
 	glink_qos_do_ch_tx(ch_ptr);
 	if (unlikely(tx_info->tracer_pkt))
@@ -5399,6 +5570,25 @@ static void glink_scheduler_eval_prio(struct channel_ctx *ctx,
 	ctx->token_start_time = arch_counter_get_cntpct();
 }
 
+/**
+ * glink_scheduler_update_tx_lat() - Account the queueing latency of a packet
+ * @ctx:	Channel on which the packet was transmitted.
+ * @tx_info:	Packet which was fully written to the transport.
+ *
+ * Note - must be called with tx_lists_lock_lhc3 locked.
+ */
+static void glink_scheduler_update_tx_lat(struct channel_ctx *ctx,
+			struct glink_core_tx_pkt *tx_info)
+{
+	uint32_t lat_us;
+
+	lat_us = (uint32_t)ktime_us_delta(ktime_get(), tx_info->queue_time);
+	ctx->tx_pkt_cnt++;
+	ctx->tx_lat_total_us += lat_us;
+	if (lat_us > ctx->tx_lat_max_us)
+		ctx->tx_lat_max_us = lat_us;
+}
+
 /**
  * glink_scheduler_tx() - Transmit operation by the scheduler
  * @ctx:	Channel which is scheduled for transmission.
@@ -5497,6 +5687,7 @@ static int glink_scheduler_tx(struct channel_ctx *ctx,
 
 		if (!tx_info->size_remaining) {
 			num_pkts++;
+			glink_scheduler_update_tx_lat(ctx, tx_info);
 			list_del_init(&tx_info->list_node);
 		}
 		rwref_put(&tx_info->pkt_ref);
@@ -5606,6 +5797,16 @@ static void tx_func(struct kthread_work *work)
 		if (list_empty(&ch_ptr->tx_active)) {
 			list_del_init(&ch_ptr->tx_ready_list_node);
 			glink_qos_done_ch_tx(ch_ptr);
+		} else {
+			/*
+			 * Channel was given its MTU worth of the transport.
+			 * Move it behind the other ready channels of the same
+			 * priority so that a bulk channel cannot hold off
+			 * the rest of its priority bucket until it drains.
+			 */
+			prio = ch_ptr->curr_priority;
+			list_move_tail(&ch_ptr->tx_ready_list_node,
+				       &xprt_ptr->prio_bin[prio].tx_ready);
 		}
 
 		spin_unlock(&ch_ptr->tx_lists_lock_lhc3);
@@ -6052,12 +6253,58 @@ int glink_get_ch_tx_pkt_count(struct channel_ctx *ch_ctx)
 	if (ch_ctx == NULL)
 		return -EINVAL;
 
-	/* FUTURE: packet stats not yet implemented */
-
-	return -ENOSYS;
+	return ch_ctx->tx_pkt_cnt;
 }
 EXPORT_SYMBOL(glink_get_ch_tx_pkt_count);
 
+/**
+ * glink_get_ch_tx_lat_info() - get the transmit queueing latency of a channel
+ * @ch_ctx:	pointer to the channel context.
+ * @avg_us:	average time from glink_tx() until the packet is fully
+ *		written to the transport, in microseconds.
+ * @max_us:	maximum of the same time, in microseconds.
+ *
+ * Return: 0 on success, -EINVAL in case of invalid input
+ */
+int glink_get_ch_tx_lat_info(struct channel_ctx *ch_ctx, uint32_t *avg_us,
+			     uint32_t *max_us)
+{
+	unsigned long flags;
+	uint64_t total_us;
+	uint32_t cnt;
+
+	if (ch_ctx == NULL || avg_us == NULL || max_us == NULL)
+		return -EINVAL;
+
+	spin_lock_irqsave(&ch_ctx->tx_lists_lock_lhc3, flags);
+	total_us = ch_ctx->tx_lat_total_us;
+	cnt = ch_ctx->tx_pkt_cnt;
+	*max_us = ch_ctx->tx_lat_max_us;
+	spin_unlock_irqrestore(&ch_ctx->tx_lists_lock_lhc3, flags);
+
+	if (cnt)
+		do_div(total_us, cnt);
+	*avg_us = (uint32_t)total_us;
+	return 0;
+}
+EXPORT_SYMBOL(glink_get_ch_tx_lat_info);
+
+/**
+ * glink_get_ch_priority() - get the current transmit priority of a channel
+ * @ch_ctx:	pointer to the channel context.
+ *
+ * Return: priority bucket the tx scheduler serves the channel from,
+ *	   -EINVAL in case of invalid input
+ */
+int glink_get_ch_priority(struct channel_ctx *ch_ctx)
+{
+	if (ch_ctx == NULL)
+		return -EINVAL;
+
+	return ch_ctx->curr_priority;
+}
+EXPORT_SYMBOL(glink_get_ch_priority);
+
 /**
  * glink_get_ch_rx_pkt_count() - get the total number of packets
  *				recieved at this channel
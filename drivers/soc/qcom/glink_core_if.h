@@ -68,6 +68,7 @@ struct glink_core_version {
  * pkt_priv:	G-Link core owned packet-private data
  * list:	G-Link core owned list node
  * bounce_buf:	Pointer to the temporary/internal bounce buffer
+ * buf_size:	G-Link core owned size of the allocated intent buffer
  */
 struct glink_core_rx_intent {
 	void *data;
@@ -85,6 +86,7 @@ struct glink_core_rx_intent {
 	struct list_head list;
 	const void *pkt_priv;
 	void *bounce_buf;
+	size_t buf_size;
 };
 
 /**
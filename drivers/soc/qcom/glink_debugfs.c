@@ -298,8 +298,25 @@ static void glink_dfs_update_ch_intent(struct seq_file *s)
  */
 static void glink_dfs_update_ch_stats(struct seq_file *s)
 {
-	/* FUTURE:  add channel statistics */
-	seq_puts(s, "not yet implemented\n");
+	struct glink_dbgfs_data *dfs_d;
+	struct channel_ctx *ch_ctx;
+	uint32_t avg_us;
+	uint32_t max_us;
+
+	dfs_d = s->private;
+	ch_ctx = dfs_d->priv_data;
+	if (ch_ctx == NULL)
+		return;
+
+	if (glink_get_ch_tx_lat_info(ch_ctx, &avg_us, &max_us))
+		return;
+
+	seq_printf(s, "%-20s: %d\n", "TX priority",
+			glink_get_ch_priority(ch_ctx));
+	seq_printf(s, "%-20s: %d\n", "TX packets",
+			glink_get_ch_tx_pkt_count(ch_ctx));
+	seq_printf(s, "%-20s: %u\n", "TX queue avg (us)", avg_us);
+	seq_printf(s, "%-20s: %u\n", "TX queue max (us)", max_us);
 }
 
 /**
@@ -637,6 +637,27 @@ char *glink_get_ch_xprt_name(struct channel_ctx *ch_ctx);
  */
 int glink_get_ch_tx_pkt_count(struct channel_ctx *ch_ctx);
 
+/**
+ * glink_get_ch_tx_lat_info() - get the transmit queueing latency of a channel
+ * @ch_ctx:	pointer to the channel context.
+ * @avg_us:	average time from glink_tx() until the packet is fully
+ *		written to the transport, in microseconds.
+ * @max_us:	maximum of the same time, in microseconds.
+ *
+ * Return: 0 on success, -EINVAL in case of invalid input
+ */
+int glink_get_ch_tx_lat_info(struct channel_ctx *ch_ctx, uint32_t *avg_us,
+			     uint32_t *max_us);
+
+/**
+ * glink_get_ch_priority() - get the current transmit priority of a channel
+ * @ch_ctx:	pointer to the channel context.
+ *
+ * Return: priority bucket the tx scheduler serves the channel from,
+ *	   -EINVAL in case of invalid input
+ */
+int glink_get_ch_priority(struct channel_ctx *ch_ctx);
+
 /**
  * glink_get_ch_rx_pkt_count() - get the total number of packets
  *				recieved at this channel
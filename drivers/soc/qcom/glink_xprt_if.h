@@ -13,6 +13,7 @@
 #define _SOC_QCOM_GLINK_XPRT_IF_H_
 
 #include <linux/bitops.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
 #include <linux/types.h>
 
@@ -59,6 +60,7 @@ enum xprt_ids {
  * @pprovider:		Packet-specific physical buffer provider function.
  * @cookie:		Transport-specific cookie
  * @pkt_ref:		Active references to the packet.
+ * @queue_time:		Time at which the packet was queued for transmit.
  */
 struct glink_core_tx_pkt {
 	struct list_head list_node;
@@ -77,6 +79,7 @@ struct glink_core_tx_pkt {
 	void * (*pprovider)(void *iovec, size_t offset, size_t *size);
 	void *cookie;
 	struct rwref_lock pkt_ref;
+	ktime_t queue_time;
 };
 
 /**
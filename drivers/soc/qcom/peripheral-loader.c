@@ -36,6 +36,7 @@
 #include <soc/qcom/ramdump.h>
 #include <soc/qcom/subsystem_restart.h>
 #include <soc/qcom/secure_buffer.h>
+#include <soc/qcom/boot_stats.h>
 
 #include <asm/uaccess.h>
 #include <asm/setup.h>
@@ -55,7 +56,10 @@
 #endif
 
 #define PIL_NUM_DESC		10
+/* Segments of an image read from storage at the same time */
+#define PIL_LOAD_MAX_ACTIVE	4
 static void __iomem *pil_info_base;
+static struct workqueue_struct *pil_load_wq;
 
 /**
  * proxy_timeout - Override for proxy vote timeouts
@@ -66,6 +70,10 @@ static void __iomem *pil_info_base;
 static int proxy_timeout_ms = -1;
 module_param(proxy_timeout_ms, int, S_IRUGO | S_IWUSR);
 
+/* Load the segments of an image concurrently, on pil_load_wq */
+static bool parallel_load = true;
+module_param(parallel_load, bool, S_IRUGO | S_IWUSR);
+
 static bool disable_timeouts;
 static const char firmware_error_msg[] = "firmware_error\n";
 /**
@@ -658,6 +666,23 @@ static void unmap_fw_mem(void *vaddr, size_t size, void *data)
 	dma_unremap(info->dev, vaddr, size);
 }
 
+/**
+ * struct pil_seg_load - a segment being loaded on pil_load_wq
+ * @work: runs pil_load_seg() for @seg
+ * @desc: descriptor of the image @seg belongs to
+ * @seg: segment to load
+ * @done: completed once @ret is set
+ * @ret: result of pil_load_seg()
+ */
+struct pil_seg_load {
+	struct work_struct work;
+	struct pil_desc *desc;
+	struct pil_seg *seg;
+	struct completion done;
+	int ret;
+};
+
+/* Copy a segment into memory and zero its trailing part */
 static int pil_load_seg(struct pil_desc *desc, struct pil_seg *seg)
 {
 	int ret = 0, count;
@@ -715,10 +740,17 @@ static int pil_load_seg(struct pil_desc *desc, struct pil_seg *seg)
 		paddr += size;
 	}
 
+	return ret;
+}
+
+static int pil_verify_seg(struct pil_desc *desc, struct pil_seg *seg)
+{
+	int ret = 0;
+
 	if (desc->ops->verify_blob) {
 		ret = desc->ops->verify_blob(desc, seg->paddr, seg->sz);
 		if (ret) {
-			pil_err(desc, "Blob%u failed verification\n", num);
+			pil_err(desc, "Blob%u failed verification\n", seg->num);
 			subsys_set_error(desc->subsys_dev, firmware_error_msg);
 		}
 	}
@@ -726,6 +758,76 @@ static int pil_load_seg(struct pil_desc *desc, struct pil_seg *seg)
 	return ret;
 }
 
+static void pil_load_seg_work(struct work_struct *work)
+{
+	struct pil_seg_load *load = container_of(work, struct pil_seg_load,
+						 work);
+
+	load->ret = pil_load_seg(load->desc, load->seg);
+	complete(&load->done);
+}
+
+/*
+ * Load all segments of an image. Up to PIL_LOAD_MAX_ACTIVE segments are
+ * read from storage at the same time, while verify_blob() is still run
+ * in segment order, as it always was: it may accumulate state across
+ * blobs, as the modem MBA does. Each segment is verified as soon as it
+ * and all those before it are in memory, so verification overlaps with
+ * loading the rest.
+ */
+static int pil_load_segs(struct pil_desc *desc)
+{
+	struct pil_priv *priv = desc->priv;
+	struct pil_seg_load *loads = NULL;
+	struct pil_seg *seg;
+	int i, n = 0, ret = 0;
+
+	list_for_each_entry(seg, &priv->segs, list)
+		n++;
+
+	if (parallel_load && pil_load_wq && n > 1)
+		loads = kcalloc(n, sizeof(*loads), GFP_KERNEL);
+
+	if (!loads) {
+		list_for_each_entry(seg, &priv->segs, list) {
+			ret = pil_load_seg(desc, seg);
+			if (!ret)
+				ret = pil_verify_seg(desc, seg);
+			if (ret)
+				return ret;
+		}
+		return 0;
+	}
+
+	i = 0;
+	list_for_each_entry(seg, &priv->segs, list) {
+		INIT_WORK(&loads[i].work, pil_load_seg_work);
+		init_completion(&loads[i].done);
+		loads[i].desc = desc;
+		loads[i].seg = seg;
+		queue_work(pil_load_wq, &loads[i].work);
+		i++;
+	}
+
+	i = 0;
+	list_for_each_entry(seg, &priv->segs, list) {
+		/* after a failure, only wait for loads already running */
+		if (ret && cancel_work_sync(&loads[i].work)) {
+			i++;
+			continue;
+		}
+		wait_for_completion(&loads[i].done);
+		if (!ret)
+			ret = loads[i].ret;
+		if (!ret)
+			ret = pil_verify_seg(desc, seg);
+		i++;
+	}
+
+	kfree(loads);
+	return ret;
+}
+
 static int pil_parse_devicetree(struct pil_desc *desc)
 {
 	struct device_node *ofnode = desc->dev->of_node;
@@ -779,8 +881,8 @@ int pil_boot(struct pil_desc *desc)
 	char fw_name[30];
 	const struct pil_mdt *mdt;
 	const struct elf32_hdr *ehdr;
-	struct pil_seg *seg;
 	const struct firmware *fw;
+	ktime_t start, load_start, auth_start;
 	struct pil_priv *priv = desc->priv;
 	bool mem_protect = false;
 	bool hyp_assign = false;
@@ -789,6 +891,8 @@ int pil_boot(struct pil_desc *desc)
 	if (desc->shutdown_fail)
 		pil_err(desc, "Subsystem shutdown failed previously!\n");
 
+	start = ktime_get();
+
 	/* Reinitialize for new image */
 	pil_release_mmap(desc);
 
@@ -873,11 +977,10 @@ int pil_boot(struct pil_desc *desc)
 		hyp_assign = true;
 	}
 
-	list_for_each_entry(seg, &desc->priv->segs, list) {
-		ret = pil_load_seg(desc, seg);
-		if (ret)
-			goto err_deinit_image;
-	}
+	load_start = ktime_get();
+	ret = pil_load_segs(desc);
+	if (ret)
+		goto err_deinit_image;
 
 	if (desc->subsys_vmid > 0) {
 		ret =  pil_reclaim_mem(desc, priv->region_start,
@@ -891,6 +994,7 @@ int pil_boot(struct pil_desc *desc)
 		hyp_assign = false;
 	}
 
+	auth_start = ktime_get();
 	ret = desc->ops->auth_and_reset(desc);
 	if (ret) {
 		pil_err(desc, "Failed to bring out of reset\n");
@@ -899,6 +1003,9 @@ int pil_boot(struct pil_desc *desc)
 		goto err_auth_and_reset;
 	}
 	pil_info(desc, "Brought out of reset\n");
+	boot_stats_pil(desc->name, ktime_us_delta(load_start, start),
+		       ktime_us_delta(auth_start, load_start),
+		       ktime_us_delta(ktime_get(), auth_start));
 	desc->modem_ssr = false;
 err_auth_and_reset:
 	if (ret && desc->subsys_vmid > 0) {
@@ -1143,6 +1250,11 @@ static int __init msm_pil_init(void)
 		writel_relaxed(0, pil_info_base + (i * sizeof(u32)));
 
 out:
+	pil_load_wq = alloc_workqueue("pil_load", WQ_UNBOUND,
+				      PIL_LOAD_MAX_ACTIVE);
+	if (!pil_load_wq)
+		pr_warn("pil: no load workqueue, loading segments one by one\n");
+
 	return register_pm_notifier(&pil_pm_notifier);
 }
 device_initcall(msm_pil_init);
@@ -1150,6 +1262,8 @@ device_initcall(msm_pil_init);
 static void __exit msm_pil_exit(void)
 {
 	unregister_pm_notifier(&pil_pm_notifier);
+	if (pil_load_wq)
+		destroy_workqueue(pil_load_wq);
 	if (pil_info_base)
 		iounmap(pil_info_base);
 }
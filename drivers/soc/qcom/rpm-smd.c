@@ -139,11 +139,19 @@ struct msm_rpm_kvp_data {
 	bool valid;
 };
 
+/*
+ * Sleep set request of a resource. @buf holds the pending request, updated
+ * in place by every new sleep vote until the next flush. @sent holds the
+ * KVPs last sent to the RPM, so that a flush can skip requests that ended up
+ * with the values the RPM already has.
+ */
 struct slp_buf {
 	struct rb_node node;
 	char ubuf[MAX_SLEEP_BUFFER];
 	char *buf;
 	bool valid;
+	uint32_t sent_len;
+	char sent[MAX_SLEEP_BUFFER];
 };
 static struct rb_root tr_root = RB_ROOT;
 static int (*msm_rpm_send_buffer)(char *buf, uint32_t size, bool noirq);
@@ -559,6 +567,18 @@ static int msm_rpm_read_sleep_ack(void)
 	return ret;
 }
 
+/*
+ * Returns true if the pending KVPs of @s match the ones last sent to the RPM,
+ * e.g. when a vote was changed and then restored between two flushes.
+ */
+static bool msm_rpm_sleep_req_redundant(struct slp_buf *s)
+{
+	uint32_t len = get_data_len(s->buf);
+
+	return s->sent_len == len &&
+		!memcmp(s->sent, get_first_kvp(s->buf), len);
+}
+
 static int msm_rpm_flush_requests(bool print)
 {
 	struct rb_node *t;
@@ -572,6 +592,11 @@ static int msm_rpm_flush_requests(bool print)
 		if (!s->valid)
 			continue;
 
+		if (msm_rpm_sleep_req_redundant(s)) {
+			s->valid = false;
+			continue;
+		}
+
 		if (print)
 			msm_rpm_print_sleep_buffer(s);
 
@@ -589,6 +614,10 @@ static int msm_rpm_flush_requests(bool print)
 					get_rsc_type(s->buf),
 					get_rsc_id(s->buf));
 
+		if (ret == get_buf_len(s->buf)) {
+			s->sent_len = get_data_len(s->buf);
+			memcpy(s->sent, get_first_kvp(s->buf), s->sent_len);
+		}
 		s->valid = false;
 		count++;
 
@@ -131,10 +131,24 @@ struct smem_partition_allocation_header {
 	uint32_t reserved[1];
 };
 
+/*
+ * Location of an item found in a secure partition, relative to the partition
+ * header. Items are never freed, so once found the location stays valid and
+ * later lookups can skip the allocation header walk. Misses are not cached
+ * since the remote side may allocate the item later. An offset of 0 means
+ * the item has not been found yet.
+ */
+struct smem_item_cache {
+	uint32_t offset;
+	uint32_t size;
+};
+
 struct smem_partition_info {
 	uint32_t partition_num;
 	uint32_t offset;
 	uint32_t size_cacheline;
+	/* indexed by item id, [1] for items with SMEM_ITEM_CACHED_FLAG */
+	struct smem_item_cache *item_cache[2];
 };
 
 static struct smem_partition_info partitions[NUM_SMEM_SUBSYSTEMS];
@@ -359,6 +373,72 @@ static void *__smem_get_entry_nonsecure(unsigned id, unsigned *size,
 	return ret;
 }
 
+/**
+ * smem_item_cache_store - Remember where a secure partition item was found
+ *
+ * @to_proc: SMEM host that shares the item with apps
+ * @cached:  True for items with SMEM_ITEM_CACHED_FLAG
+ * @id:      ID of SMEM item
+ * @offset:  Offset of the item from the partition header
+ * @size:    Size of the item as returned to the caller
+ *
+ * The per-partition table is allocated on first use. Failing to allocate it
+ * only means that lookups keep walking the partition.
+ */
+static void smem_item_cache_store(unsigned to_proc, bool cached, unsigned id,
+					uint32_t offset, uint32_t size)
+{
+	struct smem_item_cache *cache;
+	struct smem_item_cache *new_cache;
+
+	cache = ACCESS_ONCE(partitions[to_proc].item_cache[cached]);
+	if (!cache) {
+		new_cache = kcalloc(SMEM_NUM_ITEMS, sizeof(*new_cache),
+								GFP_ATOMIC);
+		if (!new_cache)
+			return;
+		cache = cmpxchg(&partitions[to_proc].item_cache[cached], NULL,
+								new_cache);
+		if (cache)
+			kfree(new_cache);
+		else
+			cache = new_cache;
+	}
+
+	cache[id].size = size;
+	/* publish the size before the offset that marks the entry valid */
+	smp_wmb();
+	cache[id].offset = offset;
+}
+
+/**
+ * smem_item_cache_find - Look up a previously found secure partition item
+ *
+ * @to_proc: SMEM host that shares the item with apps
+ * @cached:  True for items with SMEM_ITEM_CACHED_FLAG
+ * @id:      ID of SMEM item
+ * @hdr:     Header of the partition shared with @to_proc
+ * @size:    Pointer to size variable for storing the result
+ * @returns: Pointer to SMEM item or NULL if it has not been cached
+ */
+static void *smem_item_cache_find(unsigned to_proc, bool cached, unsigned id,
+			struct smem_partition_header *hdr, unsigned *size)
+{
+	struct smem_item_cache *cache;
+	uint32_t offset;
+
+	cache = ACCESS_ONCE(partitions[to_proc].item_cache[cached]);
+	if (!cache)
+		return NULL;
+
+	offset = ACCESS_ONCE(cache[id].offset);
+	if (!offset)
+		return NULL;
+	smp_rmb();
+	*size = cache[id].size;
+	return (void *)(hdr) + offset;
+}
+
 /**
  * __smem_get_entry_secure - Get pointer and size of existing SMEM item with
  *                   security support
@@ -391,6 +471,7 @@ static void *__smem_get_entry_secure(unsigned id,
 	uint32_t a_hdr_size;
 	uint32_t item_size;
 	void *item = NULL;
+	bool cached;
 	int rc;
 
 	SMEM_DBG("%s(%u, %u, %u, %d, %d)\n", __func__, id, to_proc,
@@ -418,6 +499,11 @@ static void *__smem_get_entry_secure(unsigned id,
 	partition_num = partitions[to_proc].partition_num;
 	partition_size = readl_relaxed(&toc->entry[partition_num].size);
 	hdr = smem_areas[0].virt_addr + partitions[to_proc].offset;
+	cached = !!(flags & SMEM_ITEM_CACHED_FLAG);
+	item = smem_item_cache_find(to_proc, cached, id, hdr, size);
+	if (item)
+		return item;
+
 	if (unlikely(!spinlocks_initialized)) {
 		rc = init_smem_remote_spinlock();
 		if (unlikely(rc)) {
@@ -443,7 +529,7 @@ static void *__smem_get_entry_secure(unsigned id,
 		BUG();
 	}
 
-	if (flags & SMEM_ITEM_CACHED_FLAG) {
+	if (cached) {
 		a_hdr_size = ALIGN(sizeof(*alloc_hdr),
 				partitions[to_proc].size_cacheline);
 		offset_free_cached = hdr->offset_free_cached;
@@ -519,6 +605,10 @@ static void *__smem_get_entry_secure(unsigned id,
 	if (use_rspinlock)
 		remote_spin_unlock_irqrestore(&remote_spinlock, lflags);
 
+	if (item)
+		smem_item_cache_store(to_proc, cached, id,
+					(void *)(item) - (void *)(hdr), *size);
+
 	return item;
 }
 
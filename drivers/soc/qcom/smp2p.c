@@ -25,6 +25,9 @@
 #include "smp2p_private_api.h"
 #include "smp2p_private.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/trace_smp2p.h>
+
 #define NUM_LOG_PAGES 3
 
 /**
@@ -1589,6 +1592,8 @@ static void smp2p_send_interrupt(int remote_pid)
 			smp2p_int_cfgs[remote_pid].name, remote_pid);
 
 	++smp2p_int_cfgs[remote_pid].out_interrupt_count;
+	trace_smp2p_send_interrupt(remote_pid,
+			smp2p_int_cfgs[remote_pid].out_interrupt_count);
 	if (remote_pid != SMP2P_REMOTE_MOCK_PROC &&
 			smp2p_int_cfgs[remote_pid].out_int_mask) {
 		/* flush any pending writes before triggering interrupt */
@@ -1655,6 +1660,8 @@ static void smp2p_in_edge_notify(int pid)
 				data.previous_value = pos->prev_entry_val;
 				data.current_value = curr_data;
 				pos->prev_entry_val = curr_data;
+				trace_smp2p_entry_update(pid, pos->name,
+					data.previous_value, curr_data);
 				raw_notifier_call_chain(
 					&pos->in_notifier_list,
 					SMP2P_ENTRY_UPDATE, (void *)&data);
@@ -1688,6 +1695,8 @@ static irqreturn_t smp2p_interrupt_handler(int irq, void *data)
 
 	spin_lock_irqsave(&out_list[remote_pid].out_item_lock_lha1, flags);
 	++smp2p_int_cfgs[remote_pid].in_interrupt_count;
+	trace_smp2p_isr(remote_pid,
+			smp2p_int_cfgs[remote_pid].in_interrupt_count);
 
 	if (out_list[remote_pid].smem_edge_state != SMP2P_EDGE_STATE_OPENED)
 		smp2p_do_negotiation(remote_pid, &out_list[remote_pid]);
@@ -13,8 +13,13 @@
  */
 #include <linux/ctype.h>
 #include <linux/list.h>
+#include <linux/completion.h>
 #include <linux/debugfs.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+#include <linux/module.h>
+#include <linux/sched.h>
 #include "smp2p_private.h"
 
 #if defined(CONFIG_DEBUG_FS)
@@ -286,6 +291,178 @@ static void smp2p_items(struct seq_file *s)
 		smp2p_item(s, pid);
 }
 
+#define SMP2P_LAT_BUCKETS 16
+#define SMP2P_LAT_TIMEOUT_MS 100
+
+static int smp2p_lat_iterations = 1000;
+module_param_named(lat_iterations, smp2p_lat_iterations,
+		   int, S_IRUGO | S_IWUSR | S_IWGRP);
+
+/**
+ * struct smp2p_lat_ctx - Remote loopback latency benchmark state.
+ *
+ * @out_nb: Notifies the opening of the local entry.
+ * @in_nb: Notifies changes in the remote loopback entry.
+ * @out_open: Completed once the local entry is open.
+ * @resp: Completed when the remote echoes @expected back.
+ * @expected: Data of the echo request in flight.
+ */
+struct smp2p_lat_ctx {
+	struct notifier_block out_nb;
+	struct notifier_block in_nb;
+	struct completion out_open;
+	struct completion resp;
+	uint32_t expected;
+};
+
+static int smp2p_lat_out_notify(struct notifier_block *nb,
+				unsigned long event, void *data)
+{
+	struct smp2p_lat_ctx *ctx;
+
+	ctx = container_of(nb, struct smp2p_lat_ctx, out_nb);
+	if (event == SMP2P_OPEN)
+		complete(&ctx->out_open);
+	return 0;
+}
+
+static int smp2p_lat_in_notify(struct notifier_block *nb,
+				unsigned long event, void *data)
+{
+	struct msm_smp2p_update_notif *notif = data;
+	struct smp2p_lat_ctx *ctx;
+	uint32_t val;
+
+	if (event != SMP2P_ENTRY_UPDATE || !notif)
+		return 0;
+
+	ctx = container_of(nb, struct smp2p_lat_ctx, in_nb);
+	val = notif->current_value;
+	if (!SMP2P_GET_RMT_CMD_TYPE(val) &&
+	    SMP2P_GET_RMT_CMD(val) == SMP2P_LB_CMD_ECHO &&
+	    SMP2P_GET_RMT_DATA(val) == ctx->expected)
+		complete(&ctx->resp);
+	return 0;
+}
+
+/**
+ * smp2p_lat_run - Ping-pong echo commands with a remote loopback server.
+ *
+ * @s: pointer to output file
+ * @pid: Remote processor ID
+ *
+ * Temporarily takes over the local loopback entry, sends
+ * smp2p_lat_iterations echo requests one at a time and records the round
+ * trip time of each into a log2 histogram of microseconds.
+ */
+static void smp2p_lat_run(struct seq_file *s, int pid)
+{
+	struct smp2p_lat_ctx ctx;
+	struct msm_smp2p_out *out = NULL;
+	unsigned hist[SMP2P_LAT_BUCKETS] = {0};
+	unsigned timeouts = 0, done = 0;
+	uint32_t min_us = UINT_MAX, max_us = 0;
+	uint64_t total_us = 0;
+	uint32_t lat_us, val;
+	ktime_t start;
+	int i, ret;
+
+	seq_printf(s, "%s (%d): ", smp2p_pid_to_name(pid), pid);
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.out_nb.notifier_call = smp2p_lat_out_notify;
+	ctx.in_nb.notifier_call = smp2p_lat_in_notify;
+	init_completion(&ctx.out_open);
+	init_completion(&ctx.resp);
+
+	msm_smp2p_deinit_rmt_lpb_proc(pid);
+	ret = msm_smp2p_out_open(pid, SMP2P_RLPB_ENTRY_NAME, &ctx.out_nb,
+				 &out);
+	if (ret) {
+		seq_printf(s, "outbound open failed %d\n", ret);
+		goto restore_lpb;
+	}
+	if (!wait_for_completion_timeout(&ctx.out_open,
+				msecs_to_jiffies(SMP2P_LAT_TIMEOUT_MS))) {
+		seq_puts(s, "outbound entry not opened by remote\n");
+		goto close_out;
+	}
+	ret = msm_smp2p_in_register(pid, SMP2P_RLPB_ENTRY_NAME, &ctx.in_nb);
+	if (ret) {
+		seq_printf(s, "inbound register failed %d\n", ret);
+		goto close_out;
+	}
+
+	for (i = 0; i < smp2p_lat_iterations; i++) {
+		val = 0;
+		ctx.expected = (i + 1) & SMP2P_RMT_DATA_MASK;
+		SMP2P_SET_RMT_CMD_TYPE_REQ(val);
+		SMP2P_SET_RMT_CMD(val, SMP2P_LB_CMD_ECHO);
+		SMP2P_SET_RMT_DATA(val, ctx.expected);
+		reinit_completion(&ctx.resp);
+
+		start = ktime_get();
+		ret = msm_smp2p_out_write(out, val);
+		if (ret) {
+			seq_printf(s, "write failed %d\n", ret);
+			break;
+		}
+		if (!wait_for_completion_timeout(&ctx.resp,
+				msecs_to_jiffies(SMP2P_LAT_TIMEOUT_MS))) {
+			timeouts++;
+			continue;
+		}
+		lat_us = (uint32_t)ktime_us_delta(ktime_get(), start);
+
+		done++;
+		total_us += lat_us;
+		min_us = min(min_us, lat_us);
+		max_us = max(max_us, lat_us);
+		hist[min_t(int, fls(lat_us), SMP2P_LAT_BUCKETS - 1)]++;
+	}
+
+	msm_smp2p_in_unregister(pid, SMP2P_RLPB_ENTRY_NAME, &ctx.in_nb);
+
+	if (done) {
+		do_div(total_us, done);
+		seq_printf(s, "%u rt, %u timeouts, us min/avg/max %u/%llu/%u\n",
+			   done, timeouts, min_us, total_us, max_us);
+		for (i = 0; i < SMP2P_LAT_BUCKETS; i++)
+			if (hist[i])
+				seq_printf(s, "\t< %6lu us: %u\n",
+					   1UL << i, hist[i]);
+	} else {
+		seq_printf(s, "no responses, %u timeouts\n", timeouts);
+	}
+
+close_out:
+	msm_smp2p_out_close(&out);
+restore_lpb:
+	msm_smp2p_init_rmt_lpb_proc(pid);
+}
+
+/**
+ * Run the remote loopback latency benchmark on all remote processors.
+ *
+ * @s:   pointer to output file
+ */
+static void smp2p_lat_bench(struct seq_file *s)
+{
+	struct smp2p_interrupt_config *int_cfg;
+	int pid;
+
+	int_cfg = smp2p_get_interrupt_config();
+	if (!int_cfg)
+		return;
+
+	for (pid = 0; pid < SMP2P_NUM_PROCS; ++pid) {
+		if (!int_cfg[pid].is_configured ||
+				pid == SMP2P_REMOTE_MOCK_PROC)
+			continue;
+		smp2p_lat_run(s, pid);
+	}
+}
+
 static struct dentry *dent;
 
 static int debugfs_show(struct seq_file *s, void *data)
@@ -327,6 +504,7 @@ static int __init smp2p_debugfs_init(void)
 
 	debug_create("int_stats", smp2p_int_stats);
 	debug_create("items", smp2p_items);
+	debug_create("lpb_latency", smp2p_lat_bench);
 
 	return 0;
 }
@@ -725,6 +725,79 @@ static int subsystem_powerup(struct subsys_device *dev, void *data)
 	return 0;
 }
 
+struct subsys_powerup_work {
+	struct work_struct work;
+	struct subsys_device *dev;
+	int ret;
+};
+
+static void subsystem_powerup_work(struct work_struct *work)
+{
+	struct subsys_powerup_work *pw = container_of(work,
+					struct subsys_powerup_work, work);
+
+	pw->ret = subsystem_powerup(pw->dev, NULL);
+}
+
+static bool subsys_in_list(struct subsys_device **list, unsigned count,
+			   const char *name)
+{
+	while (name && count--) {
+		struct subsys_device *dev = *list++;
+
+		if (dev && !strcmp(dev->desc->name, name))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Power up the subsystems of a restart order. Those that do not depend
+ * on another member of the order boot at the same time, one work each,
+ * and the others follow in order once they are all up.
+ */
+static int subsystem_powerup_all(struct subsys_device **list, unsigned count)
+{
+	struct subsys_powerup_work *works;
+	struct subsys_device *dev;
+	unsigned i;
+	int ret = 0;
+
+	if (count < 2)
+		return for_each_subsys_device(list, count, NULL,
+					      subsystem_powerup);
+
+	works = kcalloc(count, sizeof(*works), GFP_KERNEL);
+	if (!works)
+		return for_each_subsys_device(list, count, NULL,
+					      subsystem_powerup);
+
+	for (i = 0; i < count; i++) {
+		dev = list[i];
+		if (!dev || subsys_in_list(list, count, dev->desc->depends_on))
+			continue;
+		works[i].dev = dev;
+		INIT_WORK(&works[i].work, subsystem_powerup_work);
+		queue_work(system_unbound_wq, &works[i].work);
+	}
+
+	for (i = 0; i < count; i++) {
+		if (!works[i].dev)
+			continue;
+		flush_work(&works[i].work);
+		if (!ret)
+			ret = works[i].ret;
+	}
+
+	for (i = 0; i < count && !ret; i++) {
+		if (list[i] && !works[i].dev)
+			ret = subsystem_powerup(list[i], NULL);
+	}
+
+	kfree(works);
+	return ret;
+}
+
 static int __find_subsys(struct device *dev, void *data)
 {
 	struct subsys_device *subsys = to_subsys(dev);
@@ -1036,7 +1109,7 @@ static void subsystem_restart_wq_func(struct work_struct *work)
 	for_each_subsys_device(list, count, NULL, subsystem_free_memory);
 
 	notify_each_subsys_device(list, count, SUBSYS_BEFORE_POWERUP, NULL);
-	ret = for_each_subsys_device(list, count, NULL, subsystem_powerup);
+	ret = subsystem_powerup_all(list, count);
 	if (ret)
 		goto err;
 	notify_each_subsys_device(list, count, SUBSYS_AFTER_POWERUP, NULL);
@@ -93,6 +93,17 @@ static DEFINE_MUTEX(list_lock);
 /* long lru_count - The count of pages on our LRU list. */
 static atomic_long_t lru_count;
 
+/*
+ * The shrinker punches holes without holding list_lock. Pin and unpin wait
+ * on ashmem_shrink_wait until no purge is in flight, so a range reported
+ * as purged cannot lose data written after it was pinned again.
+ */
+static atomic_t ashmem_shrink_inflight = ATOMIC_INIT(0);
+static DECLARE_WAIT_QUEUE_HEAD(ashmem_shrink_wait);
+
+/* Number of coalesced extents collected per list_lock hold */
+#define ASHMEM_PURGE_BATCH	16
+
 /* mmap_lock - protects mmap operations */
 static DEFINE_MUTEX(mmap_lock);
 
@@ -414,49 +425,134 @@ static int ashmem_mmap(struct file *file, struct vm_area_struct *vma)
 	return 0;
 }
 
+/**
+ * struct ashmem_purge - A coalesced extent waiting to be punched out
+ * @file:	The backing file, with a reference held
+ * @pgstart:	The starting page (inclusive)
+ * @pgend:	The ending page (inclusive)
+ */
+struct ashmem_purge {
+	struct file *file;
+	size_t pgstart;
+	size_t pgend;
+};
+
+/**
+ * range_purge() - Marks a range purged and takes it off the LRU
+ * @range:	   The range being purged
+ * @purge:	   The extent @range is merged into
+ *
+ * This function is protected by list_lock.
+ */
+static void range_purge(struct ashmem_range *range, struct ashmem_purge *purge)
+{
+	purge->pgstart = min(purge->pgstart, range->pgstart);
+	purge->pgend = max(purge->pgend, range->pgend);
+	range->purged = ASHMEM_WAS_PURGED;
+	lru_del(range);
+}
+
+/**
+ * range_coalesce() - Collects @range and its unpinned neighbours
+ * @range:	      The least recently unpinned range
+ * @purge:	      Filled with one extent covering all of them
+ *
+ * The area's unpinned list is sorted by descending page, so neighbours that
+ * abut @range and are still on the LRU are merged into a single hole punch.
+ * This function is protected by list_lock.
+ *
+ * Return: the number of pages collected
+ */
+static size_t range_coalesce(struct ashmem_range *range,
+			     struct ashmem_purge *purge)
+{
+	struct list_head *head = &range->asma->unpinned_list;
+	struct ashmem_range *r;
+
+	purge->file = range->asma->file;
+	purge->pgstart = range->pgstart;
+	purge->pgend = range->pgend;
+	range_purge(range, purge);
+
+	r = range;
+	list_for_each_entry_continue_reverse(r, head, unpinned) {
+		if (!range_on_lru(r) || r->pgstart != purge->pgend + 1)
+			break;
+		range_purge(r, purge);
+	}
+
+	r = range;
+	list_for_each_entry_continue(r, head, unpinned) {
+		if (!range_on_lru(r) || r->pgend + 1 != purge->pgstart)
+			break;
+		range_purge(r, purge);
+	}
+
+	get_file(purge->file);
+	return purge->pgend - purge->pgstart + 1;
+}
+
 /*
  * ashmem_shrink - our cache shrinker, called from mm/vmscan.c :: shrink_slab
  *
- * 'nr_to_scan' is the number of objects to scan for freeing.
+ * 'nr_to_scan' is the number of pages to free, the same unit as
+ * ashmem_shrink_count().
  *
  * 'gfp_mask' is the mask of the allocation that got us into this mess.
  *
- * Return value is the number of objects freed or -1 if we cannot
+ * Return value is the number of pages freed or SHRINK_STOP if we cannot
  * proceed without risk of deadlock (due to gfp_mask).
  *
- * We approximate LRU via least-recently-unpinned, jettisoning unpinned partial
- * chunks of ashmem regions LRU-wise one-at-a-time until we hit 'nr_to_scan'
- * pages freed.
+ * We approximate LRU via least-recently-unpinned. Each pass takes the
+ * oldest ranges, coalesced with any abutting unpinned ranges of the same
+ * area, in a batch under one list_lock hold and then punches them out with
+ * the lock dropped, until 'nr_to_scan' pages are freed.
  */
 static unsigned long
 ashmem_shrink_scan(struct shrinker *shrink, struct shrink_control *sc)
 {
-	struct ashmem_range *range, *next;
+	struct ashmem_purge batch[ASHMEM_PURGE_BATCH];
+	struct ashmem_range *range;
 	unsigned long freed = 0;
+	int i, n;
 
 	/* We might recurse into filesystem code, so bail out if necessary */
 	if (!(sc->gfp_mask & __GFP_FS))
 		return SHRINK_STOP;
 
-	if (!mutex_trylock(&list_lock))
-		return -1;
+	while (freed < sc->nr_to_scan) {
+		if (!mutex_trylock(&list_lock))
+			break;
+
+		n = 0;
+		while (n < ASHMEM_PURGE_BATCH && freed < sc->nr_to_scan &&
+		       !list_empty(&ashmem_lru_list)) {
+			range = list_first_entry(&ashmem_lru_list,
+						 struct ashmem_range, lru);
+			freed += range_coalesce(range, &batch[n++]);
+		}
+		if (n)
+			atomic_inc(&ashmem_shrink_inflight);
+		mutex_unlock(&list_lock);
+
+		if (!n)
+			break;
 
-	list_for_each_entry_safe(range, next, &ashmem_lru_list, lru) {
-		loff_t start = range->pgstart * PAGE_SIZE;
-		loff_t end = (range->pgend + 1) * PAGE_SIZE;
+		for (i = 0; i < n; i++) {
+			loff_t start = batch[i].pgstart * PAGE_SIZE;
+			loff_t end = (batch[i].pgend + 1) * PAGE_SIZE;
 
-		range->asma->file->f_op->fallocate(range->asma->file,
+			batch[i].file->f_op->fallocate(batch[i].file,
 				FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
 				start, end - start);
-		range->purged = ASHMEM_WAS_PURGED;
-		lru_del(range);
+			fput(batch[i].file);
+		}
 
-		freed += range_size(range);
-		if (--sc->nr_to_scan <= 0)
-			break;
+		if (atomic_dec_and_test(&ashmem_shrink_inflight))
+			wake_up_all(&ashmem_shrink_wait);
 	}
-	mutex_unlock(&list_lock);
-	return freed;
+
+	return freed ? freed : SHRINK_STOP;
 }
 
 static unsigned long
@@ -705,7 +801,15 @@ static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
 	pgstart = pin.offset / PAGE_SIZE;
 	pgend = pgstart + (pin.len / PAGE_SIZE) - 1;
 
-	mutex_lock(&list_lock);
+	/* inflight only goes up under list_lock, so recheck it there */
+	for (;;) {
+		wait_event(ashmem_shrink_wait,
+			   !atomic_read(&ashmem_shrink_inflight));
+		mutex_lock(&list_lock);
+		if (!atomic_read(&ashmem_shrink_inflight))
+			break;
+		mutex_unlock(&list_lock);
+	}
 
 	switch (cmd) {
 	case ASHMEM_PIN:
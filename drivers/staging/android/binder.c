@@ -71,6 +71,10 @@
 #include <linux/pid_namespace.h>
 #include <linux/security.h>
 #include <linux/spinlock.h>
+#include <linux/ktime.h>
+#include <linux/mman.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
 
 #include "binder.h"
 #include "binder_alloc.h"
@@ -121,6 +125,9 @@ BINDER_DEBUG_ENTRY(proc);
 
 #define BINDER_SMALL_BUF_SIZE (PAGE_SIZE * 64)
 
+/* Upper bound for BINDER_SET_ASYNC_BATCH */
+#define BINDER_MAX_ASYNC_BATCH 16
+
 enum {
 	BINDER_DEBUG_USER_ERROR             = 1U << 0,
 	BINDER_DEBUG_FAILED_TRANSACTION     = 1U << 1,
@@ -186,6 +193,9 @@ module_param_call(stop_on_user_error, binder_set_stop_on_user_error,
 #define to_binder_fd_array_object(hdr) \
 	container_of(hdr, struct binder_fd_array_object, hdr)
 
+#define to_binder_fd_mem_object(hdr) \
+	container_of(hdr, struct binder_fd_mem_object, hdr)
+
 enum binder_stat_types {
 	BINDER_STAT_PROC,
 	BINDER_STAT_THREAD,
@@ -216,6 +226,51 @@ static inline void binder_stats_created(enum binder_stat_types type)
 	atomic_inc(&binder_stats.obj_created[type]);
 }
 
+/*
+ * Latency histogram with log2 buckets in microseconds: bucket 0 is
+ * below 1us, bucket n covers [2^(n-1), 2^n) us and the last bucket
+ * collects everything from 16ms up.
+ */
+#define BINDER_LAT_BUCKETS	16
+
+struct binder_lat_hist {
+	atomic_t bucket[BINDER_LAT_BUCKETS];
+	atomic64_t total_ns;
+	u64 max_ns;		/* racy, debugging only */
+};
+
+static void binder_lat_hist_add(struct binder_lat_hist *h, u64 ns)
+{
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+	int b = us ? min_t(int, ilog2(us) + 1, BINDER_LAT_BUCKETS - 1) : 0;
+
+	atomic_inc(&h->bucket[b]);
+	atomic64_add(ns, &h->total_ns);
+	if (ns > h->max_ns)
+		h->max_ns = ns;
+}
+
+/**
+ * struct binder_proc_lat - per-process hot path statistics
+ * @delivery:         enqueue to pickup latency of incoming transactions
+ * @reply:            reply enqueue to wakeup latency of the waiting caller
+ * @pending:          transactions queued on proc->todo, not yet picked up
+ *                    (protected by @proc->inner_lock)
+ * @max_pending:      high watermark of @pending
+ *                    (protected by @proc->inner_lock)
+ * @no_idle_thread:   transactions queued because no thread was waiting
+ * @starved:          times work was pending, no thread was waiting and
+ *                    the thread pool was already at max_threads
+ */
+struct binder_proc_lat {
+	struct binder_lat_hist delivery;
+	struct binder_lat_hist reply;
+	int pending;
+	int max_pending;
+	atomic_t no_idle_thread;
+	atomic_t starved;
+};
+
 struct binder_transaction_log_entry {
 	int debug_id;
 	int debug_id_done;
@@ -368,6 +423,15 @@ struct binder_error {
  *                        (invariant after initialized)
  * @txn_security_ctx:     require sender's security context
  *                        (invariant after initialized)
+ * @lat:                  enqueue to pickup latency of transactions
+ *                        to this node
+ * @async_depth:          number of works on @async_todo
+ *                        (protected by @proc->inner_lock)
+ * @async_batched:        async transactions delivered in a batch beyond
+ *                        the first whose buffers are not freed yet
+ *                        (protected by @proc->inner_lock)
+ * @max_async_depth:      high watermark of @async_depth
+ *                        (protected by @proc->inner_lock)
  * @async_todo:           list of async work items
  *                        (protected by @proc->inner_lock)
  *
@@ -411,6 +475,10 @@ struct binder_node {
 	};
 	bool has_async_transaction;
 	struct list_head async_todo;
+	struct binder_lat_hist lat;
+	int async_depth;
+	int max_async_depth;
+	int async_batched;
 };
 
 struct binder_ref_death {
@@ -527,6 +595,7 @@ struct binder_priority {
  *                        (protected by @inner_lock)
  * @stats:                per-process binder statistics
  *                        (atomics, no lock needed)
+ * @lat:                  per-process latency and thread pool statistics
  * @delivered_death:      list of delivered death notification
  *                        (protected by @inner_lock)
  * @max_threads:          cap on number of binder threads
@@ -541,6 +610,9 @@ struct binder_priority {
  *                        (protected by @inner_lock)
  * @default_priority:     default scheduler priority
  *                        (invariant after initialized)
+ * @async_batch:          max async transactions to one node returned by
+ *                        a single read, 0 or 1 disables batching
+ *                        (set with BINDER_SET_ASYNC_BATCH, no lock needed)
  * @debugfs_entry:        debugfs node
  * @alloc:                binder allocator bookkeeping
  * @context:              binder_context for this proc
@@ -568,12 +640,14 @@ struct binder_proc {
 
 	struct list_head todo;
 	struct binder_stats stats;
+	struct binder_proc_lat lat;
 	struct list_head delivered_death;
 	int max_threads;
 	int requested_threads;
 	int requested_threads_started;
 	int tmp_ref;
 	struct binder_priority default_priority;
+	int async_batch;
 	struct dentry *debugfs_entry;
 	struct binder_alloc alloc;
 	struct binder_context *context;
@@ -655,6 +729,7 @@ struct binder_transaction {
 	struct binder_thread *to_thread;
 	struct binder_transaction *to_parent;
 	unsigned need_reply:1;
+	unsigned has_fd_mem:1;	/* buffer holds BINDER_TYPE_FD_MEM objects */
 	/* unsigned is_dead:1; */	/* not used at the moment */
 
 	struct binder_buffer *buffer;
@@ -665,6 +740,7 @@ struct binder_transaction {
 	bool    set_priority_called;
 	kuid_t	sender_euid;
 	binder_uintptr_t security_ctx;
+	u64	enqueue_ns;
 	/**
 	 * @lock:  protects @from, @to_proc, and @to_thread
 	 *
@@ -2242,6 +2318,9 @@ static size_t binder_validate_object(struct binder_buffer *buffer, u64 offset)
 	case BINDER_TYPE_FDA:
 		object_size = sizeof(struct binder_fd_array_object);
 		break;
+	case BINDER_TYPE_FD_MEM:
+		object_size = sizeof(struct binder_fd_mem_object);
+		break;
 	default:
 		return 0;
 	}
@@ -2431,6 +2510,17 @@ static void binder_transaction_buffer_release(struct binder_proc *proc,
 			if (failed_at)
 				task_close_fd(proc, fp->fd);
 		} break;
+		case BINDER_TYPE_FD_MEM: {
+			struct binder_fd_mem_object *fp =
+				to_binder_fd_mem_object(hdr);
+
+			binder_debug(BINDER_DEBUG_TRANSACTION,
+				     "        fd mem %d size %lld\n", fp->fd,
+				     (u64)fp->length);
+			/* the mapping, if any, is owned by the target */
+			if (failed_at)
+				task_close_fd(proc, fp->fd);
+		} break;
 		case BINDER_TYPE_PTR:
 			/*
 			 * Nothing to do here, this will get cleaned up when the
@@ -2667,6 +2757,87 @@ err_fd_not_accepted:
 	return ret;
 }
 
+static int binder_translate_fd_mem(struct binder_fd_mem_object *fp,
+				   struct binder_transaction *t,
+				   struct binder_thread *thread,
+				   struct binder_transaction *in_reply_to)
+{
+	struct binder_proc *proc = thread->proc;
+	struct file *file;
+	int ret = 0;
+
+	file = fget(fp->fd);
+	if (!file) {
+		binder_user_error("%d:%d got transaction with invalid fd mem, %d\n",
+				  proc->pid, thread->pid, fp->fd);
+		return -EBADF;
+	}
+	if (!fp->length || fp->offset + fp->length < fp->offset ||
+	    fp->offset + fp->length > ULONG_MAX ||
+	    !(file->f_mode & FMODE_READ) || !file->f_op->mmap) {
+		binder_user_error("%d:%d got invalid fd mem %d, offset %lld size %lld\n",
+				  proc->pid, thread->pid, fp->fd,
+				  (u64)fp->offset, (u64)fp->length);
+		ret = -EINVAL;
+	}
+	fput(file);
+	if (ret)
+		return ret;
+
+	return binder_translate_fd(fp->fd, t, thread, in_reply_to);
+}
+
+/**
+ * binder_map_fd_mem() - map BINDER_TYPE_FD_MEM payloads into the target
+ * @proc:	receiving process, must be current's process
+ * @t:		transaction being received
+ *
+ * Runs in the target's context when it picks up @t, so the payloads can
+ * be mapped read-only into its address space with vm_mmap(). An object
+ * that cannot be mapped keeps @buffer 0 and the target falls back to
+ * the installed fd.
+ */
+static void binder_map_fd_mem(struct binder_proc *proc,
+			      struct binder_transaction *t)
+{
+	struct binder_buffer *buffer = t->buffer;
+	binder_size_t *offp, *off_end;
+	unsigned long addr;
+	u64 start;
+
+	offp = (binder_size_t *)(buffer->data +
+				 ALIGN(buffer->data_size, sizeof(void *)));
+	off_end = (void *)offp + buffer->offsets_size;
+	for (; offp < off_end; offp++) {
+		struct binder_object_header *hdr;
+		struct binder_fd_mem_object *fp;
+		struct file *file;
+
+		if (!binder_validate_object(buffer, *offp))
+			continue;
+		hdr = (struct binder_object_header *)(buffer->data + *offp);
+		if (hdr->type != BINDER_TYPE_FD_MEM)
+			continue;
+		fp = to_binder_fd_mem_object(hdr);
+
+		file = fget(fp->fd);
+		if (!file)
+			continue;
+		start = round_down((u64)fp->offset, PAGE_SIZE);
+		addr = vm_mmap(file, 0,
+			       PAGE_ALIGN(fp->offset - start + fp->length),
+			       PROT_READ, MAP_SHARED, start);
+		fput(file);
+		if (IS_ERR_VALUE(addr)) {
+			binder_debug(BINDER_DEBUG_TRANSACTION,
+				     "%d: fd mem %d map failed %ld, fall back to fd\n",
+				     proc->pid, fp->fd, (long)addr);
+			continue;
+		}
+		fp->buffer = addr + (fp->offset - start);
+	}
+}
+
 static int binder_translate_fd_array(struct binder_fd_array_object *fda,
 				     struct binder_buffer_object *parent,
 				     struct binder_transaction *t,
@@ -2815,6 +2986,41 @@ static int binder_fixup_parent(struct binder_transaction *t,
 	return 0;
 }
 
+/**
+ * binder_proc_lat_queued_ilocked() - account a transaction queued to proc->todo
+ * @proc:	process the transaction was queued to
+ *
+ * Requires the proc->inner_lock to be held.
+ */
+static void binder_proc_lat_queued_ilocked(struct binder_proc *proc)
+{
+	if (++proc->lat.pending > proc->lat.max_pending)
+		proc->lat.max_pending = proc->lat.pending;
+}
+
+/**
+ * binder_txn_latency() - record enqueue to pickup latency of a transaction
+ * @proc:	process picking up the transaction
+ * @t:		transaction being picked up
+ *
+ * Transactions to a node are accounted to the node and to @proc's
+ * delivery histogram, replies to @proc's reply histogram.
+ */
+static void binder_txn_latency(struct binder_proc *proc,
+			       struct binder_transaction *t)
+{
+	struct binder_node *node = t->buffer->target_node;
+	u64 ns = ktime_get_ns() - t->enqueue_ns;
+
+	if (node) {
+		binder_lat_hist_add(&proc->lat.delivery, ns);
+		binder_lat_hist_add(&node->lat, ns);
+	} else {
+		binder_lat_hist_add(&proc->lat.reply, ns);
+	}
+	trace_binder_transaction_latency(t, proc, !node, ns);
+}
+
 /**
  * binder_proc_transaction() - sends a transaction to a process and wakes it up
  * @t:		transaction to send
@@ -2866,14 +3072,19 @@ static bool binder_proc_transaction(struct binder_transaction *t,
 	if (!thread && !pending_async)
 		thread = binder_select_thread_ilocked(proc);
 
+	t->enqueue_ns = ktime_get_ns();
 	if (thread) {
 		binder_transaction_priority(thread->task, t, node_prio,
 					    node->inherit_rt);
 		binder_enqueue_thread_work_ilocked(thread, &t->work);
 	} else if (!pending_async) {
 		binder_enqueue_work_ilocked(&t->work, &proc->todo);
+		binder_proc_lat_queued_ilocked(proc);
+		atomic_inc(&proc->lat.no_idle_thread);
 	} else {
 		binder_enqueue_work_ilocked(&t->work, &node->async_todo);
+		if (++node->async_depth > node->max_async_depth)
+			node->max_async_depth = node->async_depth;
 	}
 
 	if (!pending_async)
@@ -3331,6 +3542,22 @@ static void binder_transaction(struct binder_proc *proc,
 			fp->pad_binder = 0;
 			fp->fd = target_fd;
 		} break;
+		case BINDER_TYPE_FD_MEM: {
+			struct binder_fd_mem_object *fp =
+				to_binder_fd_mem_object(hdr);
+			int target_fd = binder_translate_fd_mem(fp, t, thread,
+								in_reply_to);
+
+			if (target_fd < 0) {
+				return_error = BR_FAILED_REPLY;
+				return_error_param = target_fd;
+				return_error_line = __LINE__;
+				goto err_translate_failed;
+			}
+			fp->fd = target_fd;
+			fp->buffer = 0;
+			t->has_fd_mem = 1;
+		} break;
 		case BINDER_TYPE_FDA: {
 			struct binder_fd_array_object *fda =
 				to_binder_fd_array_object(hdr);
@@ -3432,6 +3659,7 @@ static void binder_transaction(struct binder_proc *proc,
 		}
 		BUG_ON(t->buffer->async_transaction != 0);
 		binder_pop_transaction_ilocked(target_thread, in_reply_to);
+		t->enqueue_ns = ktime_get_ns();
 		binder_enqueue_thread_work_ilocked(target_thread, &t->work);
 		binder_inner_proc_unlock(target_proc);
 		wake_up_interruptible_sync(&target_thread->wait);
@@ -3552,6 +3780,64 @@ err_invalid_target_handle:
 	}
 }
 
+/**
+ * binder_handoff_async_ilocked() - queue the next async work of a node
+ * @thread:	thread that freed the previous async buffer of @node
+ * @node:	node the work was dequeued from
+ * @w:		next work from @node->async_todo
+ *
+ * Async work on a node is serialized, so waking another thread for it
+ * buys no parallelism. When batching is enabled and @thread is a looper,
+ * which is about to read again, the work is handed to it directly and
+ * the wakeup is skipped.
+ *
+ * Requires the proc->inner_lock to be held.
+ */
+static void binder_handoff_async_ilocked(struct binder_thread *thread,
+					 struct binder_node *node,
+					 struct binder_work *w)
+{
+	struct binder_proc *proc = node->proc;
+
+	node->async_depth--;
+	if (READ_ONCE(proc->async_batch) > 1 &&
+	    (thread->looper & (BINDER_LOOPER_STATE_REGISTERED |
+			       BINDER_LOOPER_STATE_ENTERED))) {
+		binder_enqueue_thread_work_ilocked(thread, w);
+		return;
+	}
+	binder_enqueue_work_ilocked(w, &proc->todo);
+	binder_proc_lat_queued_ilocked(proc);
+	binder_wakeup_proc_ilocked(proc);
+}
+
+/**
+ * binder_dequeue_async_batch() - take the next async work of a node
+ * @node:	node whose async transaction was just delivered
+ *
+ * Used by binder_thread_read() to return more queued async transactions
+ * to @node in the same read. Each one taken is accounted in
+ * @node->async_batched so BC_FREE_BUFFER only moves on to the next work
+ * once all buffers of the batch are freed.
+ *
+ * Return: the next transaction or NULL if @node->async_todo is empty
+ */
+static struct binder_transaction *
+binder_dequeue_async_batch(struct binder_node *node)
+{
+	struct binder_work *w;
+
+	binder_node_inner_lock(node);
+	w = binder_dequeue_work_head_ilocked(&node->async_todo);
+	if (w) {
+		node->async_depth--;
+		node->async_batched++;
+	}
+	binder_node_inner_unlock(node);
+
+	return w ? container_of(w, struct binder_transaction, work) : NULL;
+}
+
 static int binder_thread_write(struct binder_proc *proc,
 			struct binder_thread *thread,
 			binder_uintptr_t binder_buffer, size_t size,
@@ -3755,14 +4041,17 @@ static int binder_thread_write(struct binder_proc *proc,
 				binder_node_inner_lock(buf_node);
 				BUG_ON(!buf_node->has_async_transaction);
 				BUG_ON(buf_node->proc != proc);
-				w = binder_dequeue_work_head_ilocked(
-						&buf_node->async_todo);
-				if (!w) {
-					buf_node->has_async_transaction = 0;
+				if (buf_node->async_batched) {
+					/* the rest of a batch is in flight */
+					buf_node->async_batched--;
 				} else {
-					binder_enqueue_work_ilocked(
-							w, &proc->todo);
-					binder_wakeup_proc_ilocked(proc);
+					w = binder_dequeue_work_head_ilocked(
+							&buf_node->async_todo);
+					if (!w)
+						buf_node->has_async_transaction = 0;
+					else
+						binder_handoff_async_ilocked(
+							thread, buf_node, w);
 				}
 				binder_node_inner_unlock(buf_node);
 			}
@@ -4103,6 +4392,7 @@ static int binder_thread_read(struct binder_proc *proc,
 
 	int ret = 0;
 	int wait_for_proc_work;
+	int batched = 0;
 
 	if (*consumed == 0) {
 		if (put_user(BR_NOOP, (uint32_t __user *)ptr))
@@ -4178,6 +4468,8 @@ retry:
 
 		switch (w->type) {
 		case BINDER_WORK_TRANSACTION: {
+			if (list == &proc->todo)
+				proc->lat.pending--;
 			binder_inner_proc_unlock(proc);
 			t = container_of(w, struct binder_transaction, work);
 		} break;
@@ -4341,7 +4633,9 @@ retry:
 		if (!t)
 			continue;
 
+deliver:
 		BUG_ON(t->buffer == NULL);
+		binder_txn_latency(proc, t);
 		if (t->buffer->target_node) {
 			struct binder_node *target_node = t->buffer->target_node;
 			struct binder_priority node_prio;
@@ -4372,6 +4666,9 @@ retry:
 			trd->sender_pid = 0;
 		}
 
+		if (t->has_fd_mem)
+			binder_map_fd_mem(proc, t);
+
 		trd->data_size = t->buffer->data_size;
 		trd->offsets_size = t->buffer->offsets_size;
 		trd->data.ptr.buffer = (binder_uintptr_t)
@@ -4430,7 +4727,22 @@ retry:
 			thread->transaction_stack = t;
 			binder_inner_proc_unlock(thread->proc);
 		} else {
+			struct binder_node *async_node = NULL;
+
+			if (cmd != BR_REPLY)
+				async_node = t->buffer->target_node;
 			binder_free_transaction(t);
+
+			/* return more queued async work of the node at once */
+			if (async_node &&
+			    ++batched < READ_ONCE(proc->async_batch) &&
+			    end - ptr >= sizeof(tr) + 4) {
+				t = binder_dequeue_async_batch(async_node);
+				if (t) {
+					trsize = sizeof(*trd);
+					goto deliver;
+				}
+			}
 		}
 		break;
 	}
@@ -4453,8 +4765,13 @@ done:
 		if (put_user(BR_SPAWN_LOOPER, (uint32_t __user *)buffer))
 			return -EFAULT;
 		binder_stat_br(proc, thread, BR_SPAWN_LOOPER);
-	} else
+	} else {
+		if (list_empty(&proc->waiting_threads) &&
+		    proc->requested_threads_started >= proc->max_threads &&
+		    proc->lat.pending)
+			atomic_inc(&proc->lat.starved);
 		binder_inner_proc_unlock(proc);
+	}
 	return 0;
 }
 
@@ -4869,6 +5186,17 @@ static long binder_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		if (ret)
 			goto err;
 		break;
+	case BINDER_SET_ASYNC_BATCH: {
+		u32 async_batch;
+
+		if (copy_from_user(&async_batch, ubuf, sizeof(async_batch))) {
+			ret = -EINVAL;
+			goto err;
+		}
+		WRITE_ONCE(proc->async_batch,
+			   min_t(u32, async_batch, BINDER_MAX_ASYNC_BATCH));
+		break;
+	}
 	case BINDER_SET_MAX_THREADS: {
 		int max_threads;
 
@@ -5796,6 +6124,73 @@ static int binder_transactions_show(struct seq_file *m, void *unused)
 	return 0;
 }
 
+static void print_binder_lat_hist(struct seq_file *m, const char *prefix,
+				  struct binder_lat_hist *h)
+{
+	unsigned int count = 0;
+	int i;
+
+	for (i = 0; i < BINDER_LAT_BUCKETS; i++)
+		count += atomic_read(&h->bucket[i]);
+	if (!count)
+		return;
+
+	seq_printf(m, "%s: count %u avg %llu us max %llu us\n", prefix, count,
+		   div_u64(div_u64(atomic64_read(&h->total_ns), count),
+			   NSEC_PER_USEC),
+		   div_u64(h->max_ns, NSEC_PER_USEC));
+	seq_printf(m, "%s  us:", prefix);
+	for (i = 0; i < BINDER_LAT_BUCKETS; i++)
+		seq_printf(m, " %s%u:%d", i == BINDER_LAT_BUCKETS - 1 ? ">=" : "<",
+			   i == BINDER_LAT_BUCKETS - 1 ? 1U << (i - 1) : 1U << i,
+			   atomic_read(&h->bucket[i]));
+	seq_puts(m, "\n");
+}
+
+static void print_binder_proc_lat(struct seq_file *m, struct binder_proc *proc)
+{
+	struct binder_node *node;
+	struct rb_node *n;
+	char prefix[32];
+
+	seq_printf(m, "proc %d\n", proc->pid);
+	binder_inner_proc_lock(proc);
+	seq_printf(m, "  pending %d max %d no idle thread %d starved %d\n",
+		   proc->lat.pending, proc->lat.max_pending,
+		   atomic_read(&proc->lat.no_idle_thread),
+		   atomic_read(&proc->lat.starved));
+	binder_inner_proc_unlock(proc);
+	print_binder_lat_hist(m, "  delivery", &proc->lat.delivery);
+	print_binder_lat_hist(m, "  reply", &proc->lat.reply);
+
+	binder_inner_proc_lock(proc);
+	for (n = rb_first(&proc->nodes); n != NULL; n = rb_next(n)) {
+		node = rb_entry(n, struct binder_node, rb_node);
+		if (!atomic64_read(&node->lat.total_ns) &&
+		    !node->max_async_depth)
+			continue;
+		seq_printf(m, "  node %d u%016llx async depth %d max %d\n",
+			   node->debug_id, (u64)node->ptr, node->async_depth,
+			   node->max_async_depth);
+		snprintf(prefix, sizeof(prefix), "    node %d", node->debug_id);
+		print_binder_lat_hist(m, prefix, &node->lat);
+	}
+	binder_inner_proc_unlock(proc);
+}
+
+static int binder_latency_show(struct seq_file *m, void *unused)
+{
+	struct binder_proc *proc;
+
+	seq_puts(m, "binder latency:\n");
+	mutex_lock(&binder_procs_lock);
+	hlist_for_each_entry(proc, &binder_procs, proc_node)
+		print_binder_proc_lat(m, proc);
+	mutex_unlock(&binder_procs_lock);
+
+	return 0;
+}
+
 static int binder_proc_show(struct seq_file *m, void *unused)
 {
 	struct binder_proc *itr;
@@ -5875,6 +6270,7 @@ BINDER_DEBUG_ENTRY(state);
 BINDER_DEBUG_ENTRY(stats);
 BINDER_DEBUG_ENTRY(transactions);
 BINDER_DEBUG_ENTRY(transaction_log);
+BINDER_DEBUG_ENTRY(latency);
 
 static int __init init_binder_device(const char *name)
 {
@@ -6020,6 +6416,11 @@ static int __init binder_init(void)
 				    binder_debugfs_dir_entry_root,
 				    &binder_transaction_log_failed,
 				    &binder_transaction_log_fops);
+		debugfs_create_file("latency",
+				    S_IRUGO,
+				    binder_debugfs_dir_entry_root,
+				    NULL,
+				    &binder_latency_fops);
 	}
 
 	/*
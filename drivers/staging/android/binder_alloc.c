@@ -69,6 +69,9 @@ void binder_buffer_pool_destroy(void)
 	kmem_cache_destroy(binder_buffer_pool);
 }
 
+static void binder_free_buf_locked(struct binder_alloc *alloc,
+				   struct binder_buffer *buffer);
+
 static struct binder_buffer *binder_buffer_next(struct binder_buffer *buffer)
 {
 	return list_entry(buffer->entry.next, struct binder_buffer, entry);
@@ -201,6 +204,90 @@ struct binder_buffer *binder_alloc_prepare_to_free(struct binder_alloc *alloc,
 	return buffer;
 }
 
+/*
+ * Take the smallest cached buffer that fits @size. It is still on
+ * allocated_buffers and its pages are still mapped, so it can be handed
+ * out as is.
+ */
+static struct binder_buffer *binder_alloc_cache_get(struct binder_alloc *alloc,
+						    size_t size)
+{
+	struct binder_buffer *buffer;
+	size_t buffer_size, best_size = 0;
+	int i, best = -1;
+
+	if (size > BINDER_ALLOC_CACHE_MAX_SIZE)
+		return NULL;
+
+	for (i = 0; i < alloc->cache_count; i++) {
+		buffer_size = binder_alloc_buffer_size(alloc, alloc->cache[i]);
+		if (buffer_size >= size &&
+		    (best < 0 || buffer_size < best_size)) {
+			best = i;
+			best_size = buffer_size;
+		}
+	}
+	if (best < 0)
+		return NULL;
+
+	buffer = alloc->cache[best];
+	alloc->cache[best] = alloc->cache[--alloc->cache_count];
+	buffer->cached = 0;
+
+	binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
+		     "%d: binder_alloc_buf size %zd reused cached %pK size %zd\n",
+		      alloc->pid, size, buffer, best_size);
+	return buffer;
+}
+
+/*
+ * Park a freed small buffer in the cache instead of merging it back into
+ * the free tree. Returns false if the buffer has to be freed normally.
+ */
+static bool binder_alloc_cache_put(struct binder_alloc *alloc,
+				   struct binder_buffer *buffer)
+{
+	size_t size;
+
+	if (alloc->cache_count >= BINDER_ALLOC_CACHE_SLOTS || !alloc->vma ||
+	    binder_alloc_buffer_size(alloc, buffer) >
+	    BINDER_ALLOC_CACHE_MAX_SIZE)
+		return false;
+
+	BUG_ON(buffer->free);
+	BUG_ON(buffer->transaction != NULL);
+
+	if (buffer->async_transaction) {
+		size = ALIGN(buffer->data_size, sizeof(void *)) +
+			ALIGN(buffer->offsets_size, sizeof(void *)) +
+			ALIGN(buffer->extra_buffers_size, sizeof(void *));
+		alloc->free_async_space += size + sizeof(struct binder_buffer);
+		buffer->async_transaction = 0;
+	}
+	buffer->cached = 1;
+	buffer->target_node = NULL;
+	alloc->cache[alloc->cache_count++] = buffer;
+	return true;
+}
+
+/**
+ * binder_alloc_cache_drain() - free all cached buffers
+ * @alloc:	binder_alloc for this proc
+ *
+ * Release the buffers in the small-buffer cache so their pages go back
+ * to the lru and can be reclaimed. The caller must hold alloc->mutex.
+ */
+void binder_alloc_cache_drain(struct binder_alloc *alloc)
+{
+	struct binder_buffer *buffer;
+
+	while (alloc->cache_count) {
+		buffer = alloc->cache[--alloc->cache_count];
+		buffer->cached = 0;
+		binder_free_buf_locked(alloc, buffer);
+	}
+}
+
 static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 				    void *start, void *end)
 {
@@ -395,6 +482,10 @@ struct binder_buffer *binder_alloc_new_buf_locked(struct binder_alloc *alloc,
 	/* Pad 0-size buffers so they get assigned unique addresses */
 	size = max(size, sizeof(void *));
 
+	buffer = binder_alloc_cache_get(alloc, size);
+	if (buffer)
+		goto init_buffer;
+
 	while (n) {
 		buffer = rb_entry(n, struct binder_buffer, rb_node);
 		BUG_ON(!buffer->free);
@@ -486,6 +577,7 @@ struct binder_buffer *binder_alloc_new_buf_locked(struct binder_alloc *alloc,
 	binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
 		     "%d: binder_alloc_buf size %zd got %pK\n",
 		      alloc->pid, size, buffer);
+init_buffer:
 	buffer->data_size = data_size;
 	buffer->offsets_size = offsets_size;
 	buffer->async_transaction = is_async;
@@ -659,13 +751,15 @@ static void binder_free_buf_locked(struct binder_alloc *alloc,
  * @alloc:	binder_alloc for this proc
  * @buffer:	kernel pointer to buffer
  *
- * Free the buffer allocated via binder_alloc_new_buffer()
+ * Free the buffer allocated via binder_alloc_new_buffer(). Small buffers
+ * are parked in the per-proc cache for reuse while it has room.
  */
 void binder_alloc_free_buf(struct binder_alloc *alloc,
 			    struct binder_buffer *buffer)
 {
 	mutex_lock(&alloc->mutex);
-	binder_free_buf_locked(alloc, buffer);
+	if (!binder_alloc_cache_put(alloc, buffer))
+		binder_free_buf_locked(alloc, buffer);
 	mutex_unlock(&alloc->mutex);
 }
 
@@ -779,6 +873,7 @@ void binder_alloc_deferred_release(struct binder_alloc *alloc)
 
 	buffers = 0;
 	mutex_lock(&alloc->mutex);
+	binder_alloc_cache_drain(alloc);
 	while ((n = rb_first(&alloc->allocated_buffers))) {
 		buffer = rb_entry(n, struct binder_buffer, rb_node);
 
@@ -857,9 +952,13 @@ void binder_alloc_print_allocated(struct seq_file *m,
 	struct rb_node *n;
 
 	mutex_lock(&alloc->mutex);
-	for (n = rb_first(&alloc->allocated_buffers); n != NULL; n = rb_next(n))
-		print_binder_buffer(m, "  buffer",
-				    rb_entry(n, struct binder_buffer, rb_node));
+	for (n = rb_first(&alloc->allocated_buffers); n != NULL; n = rb_next(n)) {
+		struct binder_buffer *buffer;
+
+		buffer = rb_entry(n, struct binder_buffer, rb_node);
+		if (!buffer->cached)
+			print_binder_buffer(m, "  buffer", buffer);
+	}
 	mutex_unlock(&alloc->mutex);
 }
 
@@ -905,7 +1004,8 @@ int binder_alloc_get_allocated_count(struct binder_alloc *alloc)
 
 	mutex_lock(&alloc->mutex);
 	for (n = rb_first(&alloc->allocated_buffers); n != NULL; n = rb_next(n))
-		count++;
+		if (!rb_entry(n, struct binder_buffer, rb_node)->cached)
+			count++;
 	mutex_unlock(&alloc->mutex);
 	return count;
 }
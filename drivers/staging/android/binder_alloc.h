@@ -33,6 +33,7 @@ struct binder_transaction;
  * @free:               true if buffer is free
  * @allow_user_free:    describe the second member of struct blah,
  * @async_transaction:  describe the second member of struct blah,
+ * @cached:             buffer is parked in the proc's small-buffer cache
  * @debug_id:           describe the second member of struct blah,
  * @transaction:        describe the second member of struct blah,
  * @target_node:        describe the second member of struct blah,
@@ -50,7 +51,8 @@ struct binder_buffer {
 	unsigned free:1;
 	unsigned allow_user_free:1;
 	unsigned async_transaction:1;
-	unsigned debug_id:29;
+	unsigned cached:1;
+	unsigned debug_id:28;
 
 	struct binder_transaction *transaction;
 
@@ -61,6 +63,15 @@ struct binder_buffer {
 	void *data;
 };
 
+/*
+ * Small buffers freed by the target are kept allocated and mapped in a
+ * per-proc cache so the next small transaction can reuse one without
+ * searching the free tree or mapping pages. Each cached buffer pins at
+ * most the two pages it touches.
+ */
+#define BINDER_ALLOC_CACHE_SLOTS	4
+#define BINDER_ALLOC_CACHE_MAX_SIZE	PAGE_SIZE
+
 /**
  * struct binder_lru_page - page object used for binder shrinker
  * @page_ptr: pointer to physical page in mmap'd space
@@ -92,6 +103,9 @@ struct binder_lru_page {
  * @buffer_size:        size of address space specified via mmap
  * @pid:                pid for associated binder_proc (invariant after init)
  * @pages_high:         high watermark of offset in @pages
+ * @cache:              recently freed small buffers, still on
+ *                      @allocated_buffers and with their pages mapped
+ * @cache_count:        number of buffers in @cache
  *
  * Bookkeeping structure for per-proc address space management for binder
  * buffers. It is normally initialized during binder_init() and binder_mmap()
@@ -113,6 +127,8 @@ struct binder_alloc {
 	uint32_t buffer_free;
 	int pid;
 	size_t pages_high;
+	struct binder_buffer *cache[BINDER_ALLOC_CACHE_SLOTS];
+	int cache_count;
 };
 
 enum lru_status binder_alloc_free_page(struct list_head *item,
@@ -137,6 +153,7 @@ binder_alloc_prepare_to_free(struct binder_alloc *alloc,
 			     uintptr_t user_ptr);
 extern void binder_alloc_free_buf(struct binder_alloc *alloc,
 				  struct binder_buffer *buffer);
+void binder_alloc_cache_drain(struct binder_alloc *alloc);
 extern int binder_alloc_mmap_handler(struct binder_alloc *alloc,
 				     struct vm_area_struct *vma);
 extern void binder_alloc_deferred_release(struct binder_alloc *alloc);
@@ -19,10 +19,12 @@
 
 #include <linux/mm_types.h>
 #include <linux/err.h>
+#include <linux/ktime.h>
 #include "binder_alloc.h"
 
 #define BUFFER_NUM 5
 #define BUFFER_MIN_SIZE (PAGE_SIZE / 8)
+#define LATENCY_LOOPS 1000
 
 static bool binder_selftest_run = true;
 static int binder_selftest_failures;
@@ -146,6 +148,11 @@ static void binder_selftest_free_buf(struct binder_alloc *alloc,
 	for (i = 0; i < BUFFER_NUM; i++)
 		binder_alloc_free_buf(alloc, buffers[seq[i]]);
 
+	/* Cached buffers keep their pages; release them to test the lru. */
+	mutex_lock(&alloc->mutex);
+	binder_alloc_cache_drain(alloc);
+	mutex_unlock(&alloc->mutex);
+
 	for (i = 0; i < end / PAGE_SIZE; i++) {
 		/**
 		 * Error message on a free page can be false positive
@@ -279,6 +286,45 @@ static void binder_selftest_alloc_offset(struct binder_alloc *alloc,
 	}
 }
 
+/*
+ * Time alloc/free round trips of a small buffer, with the small-buffer
+ * cache in use and with it drained after every free.
+ */
+static void binder_selftest_latency(struct binder_alloc *alloc, bool cached)
+{
+	struct binder_buffer *buffer;
+	u64 start, total = 0, worst = 0, t;
+	int i;
+
+	for (i = 0; i < LATENCY_LOOPS; i++) {
+		start = ktime_get_ns();
+		buffer = binder_alloc_new_buf(alloc, BUFFER_MIN_SIZE, 0, 0, 0);
+		if (IS_ERR(buffer)) {
+			pr_err("latency: alloc failed %ld\n", PTR_ERR(buffer));
+			binder_selftest_failures++;
+			return;
+		}
+		binder_alloc_free_buf(alloc, buffer);
+		t = ktime_get_ns() - start;
+
+		if (!cached) {
+			mutex_lock(&alloc->mutex);
+			binder_alloc_cache_drain(alloc);
+			mutex_unlock(&alloc->mutex);
+		}
+		total += t;
+		if (t > worst)
+			worst = t;
+	}
+	pr_info("latency %s: avg %llu ns max %llu ns over %d round trips\n",
+		cached ? "cached" : "uncached", div_u64(total, LATENCY_LOOPS),
+		worst, LATENCY_LOOPS);
+
+	mutex_lock(&alloc->mutex);
+	binder_alloc_cache_drain(alloc);
+	mutex_unlock(&alloc->mutex);
+}
+
 /**
  * binder_selftest_alloc() - Test alloc and free of buffer pages.
  * @alloc: Pointer to alloc struct.
@@ -286,7 +332,8 @@ static void binder_selftest_alloc_offset(struct binder_alloc *alloc,
  * Allocate BUFFER_NUM buffers to cover all page alignment cases,
  * then free them in all orders possible. Check that pages are
  * correctly allocated, put onto lru when buffers are freed, and
- * are freed when binder_alloc_free_page is called.
+ * are freed when binder_alloc_free_page is called. Finally report the
+ * small-buffer alloc/free latency with and without the buffer cache.
  */
 void binder_selftest_alloc(struct binder_alloc *alloc)
 {
@@ -299,6 +346,8 @@ void binder_selftest_alloc(struct binder_alloc *alloc)
 		goto done;
 	pr_info("STARTED\n");
 	binder_selftest_alloc_offset(alloc, end_offset, 0);
+	binder_selftest_latency(alloc, false);
+	binder_selftest_latency(alloc, true);
 	binder_selftest_run = false;
 	if (binder_selftest_failures > 0)
 		pr_info("%d tests FAILED\n", binder_selftest_failures);
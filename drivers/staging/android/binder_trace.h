@@ -169,6 +169,30 @@ TRACE_EVENT(binder_transaction_received,
 	TP_printk("transaction=%d", __entry->debug_id)
 );
 
+TRACE_EVENT(binder_transaction_latency,
+	TP_PROTO(struct binder_transaction *t, struct binder_proc *proc,
+		 bool reply, u64 latency_ns),
+	TP_ARGS(t, proc, reply, latency_ns),
+
+	TP_STRUCT__entry(
+		__field(int, debug_id)
+		__field(int, to_proc)
+		__field(int, to_node)
+		__field(bool, reply)
+		__field(u64, latency_ns)
+	),
+	TP_fast_assign(
+		__entry->debug_id = t->debug_id;
+		__entry->to_proc = proc->pid;
+		__entry->to_node = reply ? 0 : t->buffer->target_node->debug_id;
+		__entry->reply = reply;
+		__entry->latency_ns = latency_ns;
+	),
+	TP_printk("transaction=%d dest_proc=%d dest_node=%d reply=%d latency_ns=%llu",
+		  __entry->debug_id, __entry->to_proc, __entry->to_node,
+		  __entry->reply, __entry->latency_ns)
+);
+
 TRACE_EVENT(binder_transaction_node_to_ref,
 	TP_PROTO(struct binder_transaction *t, struct binder_node *node,
 		 struct binder_ref_data *rdata),
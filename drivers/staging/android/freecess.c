@@ -17,6 +17,11 @@
 #include <net/sock.h>
 #include <linux/hrtimer.h>
 #include <linux/proc_fs.h>
+#include <linux/miscdevice.h>
+#include <linux/vmalloc.h>
+#include <linux/poll.h>
+#include <linux/uaccess.h>
+#include <linux/cred.h>
 
 
 #define RET_OK   0
@@ -66,6 +71,165 @@ struct priv_data
 
 static freecess_hook mod_recv_handler[MOD_END];
 
+/*
+ * Event ring: while the daemon has /dev/freecess open, MSG_TO_USER events
+ * are written into a shared ring instead of being sent one skb at a time
+ * over netlink. If the ring is full the event falls back to netlink.
+ */
+#define FREECESS_RING_SIZE	(FREECESS_RING_DATA_OFFSET + \
+	PAGE_ALIGN(FREECESS_RING_RECORDS * sizeof(struct kfreecess_msg_data)))
+
+static void *freecess_ring;
+static struct freecess_ring_hdr *ring_hdr;
+static struct kfreecess_msg_data *ring_data;
+static DEFINE_SPINLOCK(ring_lock);
+static DECLARE_WAIT_QUEUE_HEAD(ring_wait);
+static atomic_t ring_opened;
+
+static unsigned int ring_pending(void)
+{
+	/* pairs with the daemon's store to tail after consuming */
+	smp_mb();
+	return ACCESS_ONCE(ring_hdr->head) - ACCESS_ONCE(ring_hdr->tail);
+}
+
+static int ring_post(int mod, struct priv_data *data)
+{
+	struct kfreecess_msg_data *rec;
+	unsigned long flags;
+	unsigned int head, pending;
+
+	if (!atomic_read(&ring_opened))
+		return RET_ERR;
+
+	spin_lock_irqsave(&ring_lock, flags);
+	head = ring_hdr->head;
+	pending = head - ACCESS_ONCE(ring_hdr->tail);
+	if (pending >= FREECESS_RING_RECORDS) {
+		ring_hdr->dropped++;
+		spin_unlock_irqrestore(&ring_lock, flags);
+		return RET_ERR;
+	}
+
+	rec = &ring_data[head % FREECESS_RING_RECORDS];
+	memset(rec, 0, sizeof(*rec));
+	rec->type = MSG_TO_USER;
+	rec->mod = mod;
+	rec->src_portid = KERNEL_ID_NETLINK;
+	rec->dst_portid = atomic_read(&bind_port[mod]);
+	if (data) {
+		rec->caller_pid = data->caller_pid;
+		rec->target_uid = data->target_uid;
+		if (mod == MOD_PKG)
+			memcpy(&rec->pkg_info, &data->pkg_info, sizeof(pkg_info_t));
+		else
+			rec->flag = data->flag;
+	}
+	/* publish the record before the new head */
+	smp_wmb();
+	ring_hdr->head = head + 1;
+	spin_unlock_irqrestore(&ring_lock, flags);
+
+	if (!pending)
+		wake_up_interruptible(&ring_wait);
+	return RET_OK;
+}
+
+static int ring_open(struct inode *inode, struct file *file)
+{
+	//only allow system user to consume the ring, as with netlink
+	if (from_kuid(&init_user_ns, current_euid()) != 1000)
+		return -EPERM;
+
+	if (atomic_cmpxchg(&ring_opened, 0, 1))
+		return -EBUSY;
+
+	spin_lock_irq(&ring_lock);
+	ring_hdr->head = 0;
+	ring_hdr->tail = 0;
+	ring_hdr->dropped = 0;
+	spin_unlock_irq(&ring_lock);
+	return 0;
+}
+
+static int ring_release(struct inode *inode, struct file *file)
+{
+	atomic_set(&ring_opened, 0);
+	return 0;
+}
+
+static int ring_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start != FREECESS_RING_SIZE)
+		return -EINVAL;
+
+	return remap_vmalloc_range(vma, freecess_ring, 0);
+}
+
+static ssize_t ring_read(struct file *file, char __user *buf, size_t count,
+			 loff_t *ppos)
+{
+	u64 pending;
+	int ret;
+
+	if (count < sizeof(pending))
+		return -EINVAL;
+
+	if (!ring_pending()) {
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		ret = wait_event_interruptible(ring_wait, ring_pending());
+		if (ret)
+			return ret;
+	}
+
+	pending = ring_pending();
+	if (copy_to_user(buf, &pending, sizeof(pending)))
+		return -EFAULT;
+	return sizeof(pending);
+}
+
+static unsigned int ring_poll(struct file *file, poll_table *wait)
+{
+	poll_wait(file, &ring_wait, wait);
+	return ring_pending() ? POLLIN | POLLRDNORM : 0;
+}
+
+static const struct file_operations ring_fops = {
+	.owner		= THIS_MODULE,
+	.open		= ring_open,
+	.release	= ring_release,
+	.mmap		= ring_mmap,
+	.read		= ring_read,
+	.poll		= ring_poll,
+};
+
+static struct miscdevice ring_miscdev = {
+	.minor	= MISC_DYNAMIC_MINOR,
+	.name	= "freecess",
+	.fops	= &ring_fops,
+};
+
+static int ring_init(void)
+{
+	int ret;
+
+	freecess_ring = vmalloc_user(FREECESS_RING_SIZE);
+	if (!freecess_ring)
+		return -ENOMEM;
+
+	ring_hdr = freecess_ring;
+	ring_hdr->nr_records = FREECESS_RING_RECORDS;
+	ring_data = freecess_ring + FREECESS_RING_DATA_OFFSET;
+
+	ret = misc_register(&ring_miscdev);
+	if (ret) {
+		vfree(freecess_ring);
+		freecess_ring = NULL;
+	}
+	return ret;
+}
+
 static int check_msg_type(int type)
 {
 	return (type < MSG_TYPE_END) && (type > 0);
@@ -115,6 +279,9 @@ int mod_sendmsg(int type, int mod, struct priv_data* data)
 		return RET_ERR;
 	}
 
+	if (type == MSG_TO_USER && ring_post(mod, data) == RET_OK)
+		return RET_OK;
+
 	msg_len = sizeof(struct	kfreecess_msg_data);
 	skb = nlmsg_new(msg_len, GFP_ATOMIC);
 	if (!skb) {
@@ -583,6 +750,9 @@ static int __init kfreecess_init(void)
 		}
 	}
 
+	if (ring_init())
+		pr_err("create /dev/freecess failed, events go over netlink\n");
+
 	freecess_runinfo_init(&freecess_info);
 	atomic_set(&kfreecess_init_suc, 1);
 	return RET_OK;
@@ -590,6 +760,11 @@ static int __init kfreecess_init(void)
 
 static void __exit kfreecess_exit(void)
 {
+	if (freecess_ring) {
+		misc_deregister(&ring_miscdev);
+		vfree(freecess_ring);
+	}
+
 	if (kfreecess_mod_sock)
 		netlink_kernel_release(kfreecess_mod_sock);
 
@@ -29,6 +29,7 @@
 #include <linux/kthread.h>
 #include <linux/list.h>
 #include <linux/list_sort.h>
+#include <linux/math64.h>
 #include <linux/memblock.h>
 #include <linux/miscdevice.h>
 #include <linux/export.h>
@@ -85,6 +86,12 @@ struct ion_device {
  * @display_name:	used for debugging (unique version of @name)
  * @display_serial:	used for debugging (to make display_name unique)
  * @task:		used for debugging
+ * @alloc_count:	successful allocations over the client's lifetime
+ * @alloc_fail:		failed allocations over the client's lifetime
+ * @alloc_bytes:	bytes allocated over the client's lifetime
+ * @alloc_ns:		time spent in allocations, successful or not
+ * @held_bytes:		bytes currently referenced through handles,
+ *			allocated or imported
  *
  * A client represents a list of buffers this client may access.
  * The mutex stored here is used to protect both handles tree
@@ -102,6 +109,11 @@ struct ion_client {
 	struct task_struct *task;
 	pid_t pid;
 	struct dentry *debug_root;
+	atomic_long_t alloc_count;
+	atomic_long_t alloc_fail;
+	atomic_long_t alloc_bytes;
+	atomic64_t alloc_ns;
+	atomic_long_t held_bytes;
 };
 
 /**
@@ -185,6 +197,19 @@ static void ion_buffer_add(struct ion_device *dev,
 	rb_insert_color(&buffer->node, &dev->buffers);
 }
 
+static int ion_heap_allocate(struct ion_heap *heap, struct ion_buffer *buffer,
+			     unsigned long len, unsigned long align,
+			     unsigned long flags)
+{
+	u64 start = ktime_get_ns();
+	int ret;
+
+	ret = heap->ops->allocate(heap, buffer, len, align, flags);
+	trace_ion_heap_allocate(heap->name, heap->id, len, flags, ret,
+				ktime_get_ns() - start);
+	return ret;
+}
+
 /* this function should only be called while dev->lock is held */
 static struct ion_buffer *ion_buffer_create(struct ion_heap *heap,
 				     struct ion_device *dev,
@@ -206,15 +231,14 @@ static struct ion_buffer *ion_buffer_create(struct ion_heap *heap,
 	buffer->flags = flags;
 	kref_init(&buffer->ref);
 
-	ret = heap->ops->allocate(heap, buffer, len, align, flags);
+	ret = ion_heap_allocate(heap, buffer, len, align, flags);
 
 	if (ret) {
 		if (!(heap->flags & ION_HEAP_FLAG_DEFER_FREE))
 			goto err2;
 
 		ion_heap_freelist_drain(heap, 0);
-		ret = heap->ops->allocate(heap, buffer, len, align,
-					  flags);
+		ret = ion_heap_allocate(heap, buffer, len, align, flags);
 		if (ret)
 			goto err2;
 	}
@@ -286,12 +310,18 @@ err2:
 
 void ion_buffer_destroy(struct ion_buffer *buffer)
 {
+	struct ion_heap *heap = buffer->heap;
+	u64 start;
+
 	if (WARN_ON(buffer->kmap_cnt > 0))
 		buffer->heap->ops->unmap_kernel(buffer->heap, buffer);
 	buffer->heap->ops->unmap_dma(buffer->heap, buffer);
 
 	atomic_long_sub(buffer->size, &buffer->heap->total_allocated);
+	start = ktime_get_ns();
 	buffer->heap->ops->free(buffer);
+	trace_ion_heap_free(heap->name, heap->id, buffer->size, buffer->flags,
+			    0, ktime_get_ns() - start);
 	if (buffer->pages)
 		vfree(buffer->pages);
 	kfree(buffer);
@@ -374,6 +404,7 @@ static struct ion_handle *ion_handle_create(struct ion_client *client,
 	ion_buffer_get(buffer);
 	ion_buffer_add_to_handle(buffer);
 	handle->buffer = buffer;
+	atomic_long_add(buffer->size, &client->held_bytes);
 
 	return handle;
 }
@@ -395,6 +426,7 @@ static void ion_handle_destroy(struct kref *kref)
 	if (!RB_EMPTY_NODE(&handle->node))
 		rb_erase(&handle->node, &client->handles);
 
+	atomic_long_sub(buffer->size, &client->held_bytes);
 	ion_buffer_remove_from_handle(buffer);
 	ion_buffer_put(buffer);
 
@@ -554,8 +586,9 @@ static int ion_handle_add(struct ion_client *client, struct ion_handle *handle)
 	return 0;
 }
 
-static struct ion_handle *__ion_alloc(struct ion_client *client, size_t len,
-			     size_t align, unsigned int heap_id_mask,
+static struct ion_handle *__ion_alloc_handle(struct ion_client *client,
+			     size_t len, size_t align,
+			     unsigned int heap_id_mask,
 			     unsigned int flags, bool grab_handle)
 {
 	struct ion_handle *handle;
@@ -663,6 +696,33 @@ static struct ion_handle *__ion_alloc(struct ion_client *client, size_t len,
 	return handle;
 }
 
+static struct ion_handle *__ion_alloc(struct ion_client *client, size_t len,
+			     size_t align, unsigned int heap_id_mask,
+			     unsigned int flags, bool grab_handle)
+{
+	struct ion_handle *handle;
+	u64 start = ktime_get_ns();
+	u64 elapsed;
+
+	handle = __ion_alloc_handle(client, len, align, heap_id_mask, flags,
+				    grab_handle);
+	elapsed = ktime_get_ns() - start;
+
+	atomic64_add(elapsed, &client->alloc_ns);
+	if (IS_ERR(handle)) {
+		atomic_long_inc(&client->alloc_fail);
+		trace_ion_alloc_latency(client->name, -1, len, heap_id_mask,
+					flags, PTR_ERR(handle), elapsed);
+	} else {
+		atomic_long_inc(&client->alloc_count);
+		atomic_long_add(handle->buffer->size, &client->alloc_bytes);
+		trace_ion_alloc_latency(client->name, handle->buffer->heap->id,
+					handle->buffer->size, heap_id_mask,
+					flags, 0, elapsed);
+	}
+	return handle;
+}
+
 struct ion_handle *ion_alloc(struct ion_client *client, size_t len,
 			     size_t align, unsigned int heap_id_mask,
 			     unsigned int flags)
@@ -932,6 +992,50 @@ static const struct file_operations debug_client_fops = {
 	.release = single_release,
 };
 
+/*
+ * One line per client from counters kept at alloc and handle time, so
+ * unlike the per client files nothing walks handles or buffers.
+ */
+static int ion_debug_client_stats_show(struct seq_file *s, void *unused)
+{
+	struct ion_device *dev = s->private;
+	struct rb_node *n;
+
+	seq_printf(s, "%-24s %6s %10s %10s %12s %8s %10s\n", "client", "pid",
+		   "held_kb", "allocs", "alloc_kb", "fails", "avg_us");
+
+	down_read(&dev->lock);
+	for (n = rb_first(&dev->clients); n; n = rb_next(n)) {
+		struct ion_client *client = rb_entry(n, struct ion_client,
+						     node);
+		long count = atomic_long_read(&client->alloc_count);
+		long fail = atomic_long_read(&client->alloc_fail);
+		u64 ns = atomic64_read(&client->alloc_ns);
+
+		seq_printf(s, "%-24s %6d %10ld %10ld %12ld %8ld %10llu\n",
+			   client->display_name, client->pid,
+			   atomic_long_read(&client->held_bytes) >> 10, count,
+			   atomic_long_read(&client->alloc_bytes) >> 10, fail,
+			   count + fail ? div64_u64(ns, (u64)(count + fail) *
+						     NSEC_PER_USEC) : 0);
+	}
+	up_read(&dev->lock);
+	return 0;
+}
+
+static int ion_debug_client_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ion_debug_client_stats_show,
+			   inode->i_private);
+}
+
+static const struct file_operations debug_client_stats_fops = {
+	.open = ion_debug_client_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int ion_get_client_serial(const struct rb_root *root,
 					const unsigned char *name)
 {
@@ -2074,6 +2178,8 @@ void ion_device_add_heap(struct ion_device *dev, struct ion_heap *heap)
 		pr_err("Failed to create heap debugfs at %s/%s\n",
 			path, heap->name);
 	}
+	if (heap->debugfs_init)
+		heap->debugfs_init(heap, dev->heaps_debug_root);
 
 #ifdef DEBUG_HEAP_SHRINKER
 	if (heap->shrinker.count_objects && heap->shrinker.scan_objects) {
@@ -2155,6 +2261,9 @@ struct ion_device *ion_device_create(long (*custom_ioctl)
 						idev->debug_root);
 	if (!idev->clients_debug_root)
 		pr_err("ion: failed to create debugfs clients directory.\n");
+	if (!debugfs_create_file("client_stats", 0444, idev->debug_root, idev,
+				 &debug_client_stats_fops))
+		pr_err("ion: failed to create debugfs client_stats file.\n");
 
 debugfs_done:
 
@@ -16,17 +16,46 @@
 
 #include <linux/debugfs.h>
 #include <linux/dma-mapping.h>
+#include <linux/compaction.h>
 #include <linux/err.h>
+#include <linux/freezer.h>
 #include <linux/fs.h>
+#include <linux/kthread.h>
 #include <linux/list.h>
 #include <linux/module.h>
+#include <linux/sched.h>
 #include <linux/slab.h>
 #include <linux/swap.h>
 #include <linux/vmalloc.h>
 #include <linux/vmstat.h>
 #include <linux/mmzone.h>
+#include <linux/percpu.h>
 #include "ion_priv.h"
 
+/*
+ * Background zeroing: pages freed with ion_page_pool_free_dirty() are
+ * parked on the pool's dirty list and zeroed by a SCHED_IDLE thread,
+ * which then moves them to the clean lists. When idle the same thread
+ * tops up pools with a prefill target with zeroed pages from the buddy
+ * allocator, compacting memory first if a high order can't be had.
+ */
+static bool background_zero = true;
+module_param(background_zero, bool, 0644);
+MODULE_PARM_DESC(background_zero, "Zero freed pool pages in the background");
+
+/* don't prefill again this soon after the shrinker took pages from a pool */
+#define ION_POOL_PREFILL_BACKOFF	(10 * HZ)
+/* minimum time between two compaction runs for the same pool */
+#define ION_POOL_COMPACT_INTERVAL	HZ
+
+static struct task_struct *ion_pool_zero_task;
+static DECLARE_WAIT_QUEUE_HEAD(ion_pool_zero_wait);
+static DEFINE_MUTEX(ion_pool_zero_lock);
+static LIST_HEAD(ion_pool_zero_pools);
+static atomic_t ion_pool_dirty_pages = ATOMIC_INIT(0);
+static atomic_t ion_pool_prefill_wanted = ATOMIC_INIT(0);
+static unsigned long ion_pool_prefill_resume = INITIAL_JIFFIES;
+
 static void *ion_page_pool_alloc_pages(struct ion_page_pool *pool)
 {
 	struct page *page;
@@ -110,25 +139,222 @@ static struct page *ion_page_pool_remove(struct ion_page_pool *pool, bool high,
 	return page;
 }
 
+static void ion_page_pool_pcp_stat(struct page *page, int page_count)
+{
+	mod_zone_page_state(page_zone(page), NR_FILE_PAGES, page_count);
+	mod_zone_page_state(page_zone(page), NR_INACTIVE_FILE, page_count);
+}
+
+/* Take an item off the dirty list, pool->mutex held */
+static struct page *ion_page_pool_remove_dirty(struct ion_page_pool *pool)
+{
+	struct page *page;
+
+	BUG_ON(!pool->dirty_count);
+	page = list_first_entry(&pool->dirty_items, struct page, lru);
+	list_del(&page->lru);
+	pool->dirty_count--;
+	atomic_dec(&ion_pool_dirty_pages);
+	ion_page_pool_pcp_stat(page, -(1 << pool->order));
+
+	return page;
+}
+
+/* Zero an item taken off the dirty list, freeing it on failure */
+static struct page *ion_page_pool_clean(struct ion_page_pool *pool,
+					struct page *page)
+{
+	if (msm_ion_heap_high_order_page_zero(page, pool->order)) {
+		ion_page_pool_free_pages(pool, page);
+		return NULL;
+	}
+	return page;
+}
+
+static bool ion_page_pool_need_prefill(struct ion_page_pool *pool)
+{
+	int target = (pool->prefill_kb >> (PAGE_SHIFT - 10)) >> pool->order;
+
+	return pool->high_count + ion_page_pool_low_count(pool) < target;
+}
+
+static void ion_page_pool_wake_prefill(struct ion_page_pool *pool)
+{
+	if (!ion_pool_zero_task || !ion_page_pool_need_prefill(pool))
+		return;
+	if (!atomic_xchg(&ion_pool_prefill_wanted, 1))
+		wake_up(&ion_pool_zero_wait);
+}
+
+/* Move @nr items from @pages onto the pool lists, pool->mutex held */
+static void ion_page_pool_put_batch(struct ion_page_pool *pool,
+				    struct page **pages, int nr)
+{
+	int i;
+
+	for (i = 0; i < nr; i++) {
+		list_add(&pages[i]->lru, &pool->low_items);
+		pool->low_count++;
+		pool->nr_unreserved++;
+	}
+}
+
+static struct page *ion_page_pool_pcp_alloc(struct ion_page_pool *pool)
+{
+	struct ion_page_pool_pcp *pcp;
+	struct page *batch[ION_POOL_PCP_PAGES];
+	struct page *page = NULL;
+	int nr = 0;
+
+	if (!pool->pcp_high)
+		return NULL;
+
+	pcp = get_cpu_ptr(pool->pcp);
+	spin_lock(&pcp->lock);
+	if (pcp->count)
+		page = pcp->items[--pcp->count];
+	spin_unlock(&pcp->lock);
+	put_cpu_ptr(pool->pcp);
+	if (page) {
+		atomic_dec(&pool->pcp_count);
+		goto out;
+	}
+
+	/* empty: refill a batch from the pool in one go */
+	if (!mutex_trylock(&pool->mutex))
+		return NULL;
+	while (nr < pool->pcp_batch && pool->low_count) {
+		batch[nr] = list_first_entry(&pool->low_items, struct page,
+					     lru);
+		list_del(&batch[nr]->lru);
+		pool->low_count--;
+		nr++;
+	}
+	pool->nr_unreserved = min_t(int, pool->high_count + pool->low_count,
+				    pool->nr_unreserved);
+	mutex_unlock(&pool->mutex);
+	if (!nr)
+		return NULL;
+
+	page = batch[--nr];
+	atomic_add(nr, &pool->pcp_count);
+
+	pcp = get_cpu_ptr(pool->pcp);
+	spin_lock(&pcp->lock);
+	while (nr && pcp->count < pool->pcp_high)
+		pcp->items[pcp->count++] = batch[--nr];
+	spin_unlock(&pcp->lock);
+	put_cpu_ptr(pool->pcp);
+
+	/* raced with frees on this cpu, give the rest back */
+	if (nr) {
+		atomic_sub(nr, &pool->pcp_count);
+		mutex_lock(&pool->mutex);
+		ion_page_pool_put_batch(pool, batch, nr);
+		mutex_unlock(&pool->mutex);
+	}
+out:
+	ion_page_pool_pcp_stat(page, -(1 << pool->order));
+	return page;
+}
+
+static bool ion_page_pool_pcp_free(struct ion_page_pool *pool,
+				   struct page *page)
+{
+	struct ion_page_pool_pcp *pcp;
+	struct page *batch[ION_POOL_PCP_PAGES];
+	int nr = 0;
+
+	if (!pool->pcp_high || PageHighMem(page))
+		return false;
+
+	ion_page_pool_pcp_stat(page, 1 << pool->order);
+	atomic_inc(&pool->pcp_count);
+
+	pcp = get_cpu_ptr(pool->pcp);
+	spin_lock(&pcp->lock);
+	/* full: drain a batch to the pool to make room */
+	if (pcp->count == pool->pcp_high) {
+		while (nr < pool->pcp_batch)
+			batch[nr++] = pcp->items[--pcp->count];
+	}
+	pcp->items[pcp->count++] = page;
+	spin_unlock(&pcp->lock);
+	put_cpu_ptr(pool->pcp);
+
+	if (nr) {
+		atomic_sub(nr, &pool->pcp_count);
+		mutex_lock(&pool->mutex);
+		ion_page_pool_put_batch(pool, batch, nr);
+		mutex_unlock(&pool->mutex);
+	}
+	return true;
+}
+
+/* Move all items in the per-CPU caches back to the pool lists */
+static void ion_page_pool_pcp_drain(struct ion_page_pool *pool)
+{
+	struct ion_page_pool_pcp *pcp;
+	struct page *batch[ION_POOL_PCP_PAGES];
+	int cpu, nr;
+
+	if (!pool->pcp_high || !atomic_read(&pool->pcp_count))
+		return;
+
+	for_each_possible_cpu(cpu) {
+		pcp = per_cpu_ptr(pool->pcp, cpu);
+		spin_lock(&pcp->lock);
+		nr = pcp->count;
+		memcpy(batch, pcp->items, nr * sizeof(batch[0]));
+		pcp->count = 0;
+		spin_unlock(&pcp->lock);
+		if (!nr)
+			continue;
+
+		atomic_sub(nr, &pool->pcp_count);
+		mutex_lock(&pool->mutex);
+		ion_page_pool_put_batch(pool, batch, nr);
+		mutex_unlock(&pool->mutex);
+	}
+}
+
 void *ion_page_pool_alloc(struct ion_page_pool *pool, bool *from_pool)
 {
 	struct page *page = NULL;
+	bool dirty = false;
 
 	BUG_ON(!pool);
 
 	*from_pool = true;
 
+	page = ion_page_pool_pcp_alloc(pool);
+	if (page)
+		goto out;
+
 	if (mutex_trylock(&pool->mutex)) {
-		if (pool->high_count)
+		if (pool->high_count) {
 			page = ion_page_pool_remove(pool, true, false);
-		else if (pool->low_count)
+		} else if (pool->low_count) {
 			page = ion_page_pool_remove(pool, false, false);
+		} else if (pool->dirty_count) {
+			page = ion_page_pool_remove_dirty(pool);
+			dirty = true;
+		}
 		mutex_unlock(&pool->mutex);
 	}
+	/* the worker hasn't got to it yet, still cheaper than the buddy */
+	if (dirty)
+		page = ion_page_pool_clean(pool, page);
 	if (!page) {
 		page = ion_page_pool_alloc_pages(pool);
 		*from_pool = false;
 	}
+out:
+	if (*from_pool)
+		atomic_long_inc(&pool->hits);
+	else
+		atomic_long_inc(&pool->misses);
+	ion_page_pool_wake_prefill(pool);
 	return page;
 }
 
@@ -150,6 +376,9 @@ void *ion_page_pool_prefetch(struct ion_page_pool *pool, bool *from_pool)
 	if (!page) {
 		page = ion_page_pool_alloc_pages(pool);
 		*from_pool = false;
+		atomic_long_inc(&pool->misses);
+	} else {
+		atomic_long_inc(&pool->hits);
 	}
 	return page;
 }
@@ -162,6 +391,10 @@ void *ion_page_pool_alloc_pool_only(struct ion_page_pool *pool)
 
 	BUG_ON(!pool);
 
+	page = ion_page_pool_pcp_alloc(pool);
+	if (page)
+		return page;
+
 	if (mutex_trylock(&pool->mutex)) {
 		if (pool->high_count)
 			page = ion_page_pool_remove(pool, true, false);
@@ -180,6 +413,9 @@ void ion_page_pool_free(struct ion_page_pool *pool, struct page *page,
 
 	BUG_ON(pool->order != compound_order(page));
 
+	if (!prefetch && ion_page_pool_pcp_free(pool, page))
+		return;
+
 	ret = ion_page_pool_add(pool, page, prefetch);
 	/* FIXME? For a secure page, not hyp unassigned in this err path */
 	if (ret)
@@ -191,9 +427,28 @@ void ion_page_pool_free_immediate(struct ion_page_pool *pool, struct page *page)
 	ion_page_pool_free_pages(pool, page);
 }
 
+bool ion_page_pool_background_zero(void)
+{
+	return ion_pool_zero_task && background_zero;
+}
+
+void ion_page_pool_free_dirty(struct ion_page_pool *pool, struct page *page)
+{
+	BUG_ON(pool->order != compound_order(page));
+
+	ion_page_pool_pcp_stat(page, 1 << pool->order);
+	mutex_lock(&pool->mutex);
+	list_add_tail(&page->lru, &pool->dirty_items);
+	pool->dirty_count++;
+	mutex_unlock(&pool->mutex);
+
+	if (atomic_inc_return(&ion_pool_dirty_pages) == 1)
+		wake_up(&ion_pool_zero_wait);
+}
+
 int ion_page_pool_total(struct ion_page_pool *pool, bool high)
 {
-	int count = pool->low_count;
+	int count = ion_page_pool_low_count(pool) + pool->dirty_count;
 
 	if (high)
 		count += pool->high_count;
@@ -215,11 +470,15 @@ int ion_page_pool_shrink(struct ion_page_pool *pool, gfp_t gfp_mask,
 	if (nr_to_scan == 0)
 		return ion_page_pool_total(pool, high);
 
+	ion_page_pool_pcp_drain(pool);
 	while (freed < nr_to_scan) {
 		struct page *page;
 
 		mutex_lock(&pool->mutex);
-		if (pool->low_count) {
+		if (pool->dirty_count) {
+			/* not worth zeroing something we are about to free */
+			page = ion_page_pool_remove_dirty(pool);
+		} else if (pool->low_count) {
 			page = ion_page_pool_remove(pool, false, false);
 		} else if (high && pool->high_count) {
 			page = ion_page_pool_remove(pool, true, false);
@@ -232,6 +491,9 @@ int ion_page_pool_shrink(struct ion_page_pool *pool, gfp_t gfp_mask,
 		freed += (1 << pool->order);
 	}
 
+	if (freed && pool->prefill_kb)
+		ion_pool_prefill_resume = jiffies + ION_POOL_PREFILL_BACKOFF;
+
 	return freed;
 }
 
@@ -239,28 +501,167 @@ struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order)
 {
 	struct ion_page_pool *pool = kmalloc(sizeof(struct ion_page_pool),
 					     GFP_KERNEL);
+	int cpu;
+
 	if (!pool)
 		return NULL;
+	pool->pcp = alloc_percpu(struct ion_page_pool_pcp);
+	if (!pool->pcp) {
+		kfree(pool);
+		return NULL;
+	}
+	for_each_possible_cpu(cpu) {
+		struct ion_page_pool_pcp *pcp = per_cpu_ptr(pool->pcp, cpu);
+
+		spin_lock_init(&pcp->lock);
+		pcp->count = 0;
+	}
+	/* large orders are rare and too big to park per cpu */
+	pool->pcp_high = ION_POOL_PCP_PAGES >> order;
+	pool->pcp_batch = max(pool->pcp_high / 2, 1);
+	atomic_set(&pool->pcp_count, 0);
 	pool->high_count = 0;
 	pool->low_count = 0;
 	pool->nr_unreserved = 0;
+	pool->dirty_count = 0;
+	pool->prefill_kb = 0;
+	pool->compact_after = jiffies;
+	atomic_long_set(&pool->hits, 0);
+	atomic_long_set(&pool->misses, 0);
+	atomic_long_set(&pool->refills, 0);
+	atomic_long_set(&pool->compactions, 0);
 	INIT_LIST_HEAD(&pool->low_items);
 	INIT_LIST_HEAD(&pool->high_items);
+	INIT_LIST_HEAD(&pool->dirty_items);
 	pool->gfp_mask = gfp_mask | __GFP_COMP;
 	pool->order = order;
 	mutex_init(&pool->mutex);
 	plist_node_init(&pool->list, order);
 
+	mutex_lock(&ion_pool_zero_lock);
+	list_add_tail(&pool->zero_list, &ion_pool_zero_pools);
+	mutex_unlock(&ion_pool_zero_lock);
+
 	return pool;
 }
 
 void ion_page_pool_destroy(struct ion_page_pool *pool)
 {
+	mutex_lock(&ion_pool_zero_lock);
+	list_del(&pool->zero_list);
+	mutex_unlock(&ion_pool_zero_lock);
+
+	ion_page_pool_pcp_drain(pool);
+	while (pool->dirty_count)
+		ion_page_pool_free_pages(pool,
+					 ion_page_pool_remove_dirty(pool));
+	free_percpu(pool->pcp);
 	kfree(pool);
 }
 
+/* Zero one dirty item and move it to the clean lists */
+static bool ion_page_pool_zero_one(struct ion_page_pool *pool)
+{
+	struct page *page;
+
+	mutex_lock(&pool->mutex);
+	if (!pool->dirty_count) {
+		mutex_unlock(&pool->mutex);
+		return false;
+	}
+	page = ion_page_pool_remove_dirty(pool);
+	mutex_unlock(&pool->mutex);
+
+	page = ion_page_pool_clean(pool, page);
+	if (page)
+		ion_page_pool_add(pool, page, false);
+	return true;
+}
+
+/*
+ * Compact in the background, kswapd style, rather than let the next
+ * allocation fall back to smaller orders; compaction keeps its own
+ * per-zone deferral on top of our interval.
+ */
+static bool ion_page_pool_compact(struct ion_page_pool *pool)
+{
+	if (!IS_ENABLED(CONFIG_COMPACTION) || !pool->order ||
+	    time_before(jiffies, pool->compact_after))
+		return false;
+
+	pool->compact_after = jiffies + ION_POOL_COMPACT_INTERVAL;
+	atomic_long_inc(&pool->compactions);
+	compact_pgdat(NODE_DATA(numa_node_id()), pool->order);
+	return true;
+}
+
+/* Add one zeroed item from the buddy allocator, never reclaiming for it */
+static bool ion_page_pool_prefill_one(struct ion_page_pool *pool)
+{
+	gfp_t gfp = (pool->gfp_mask | __GFP_NORETRY | __GFP_NO_KSWAPD |
+		     __GFP_NOWARN) & ~(__GFP_WAIT | __GFP_ZERO);
+	struct page *page;
+
+	if (!ion_page_pool_need_prefill(pool) ||
+	    time_before(jiffies, ion_pool_prefill_resume))
+		return false;
+
+	page = alloc_pages(gfp, pool->order);
+	if (!page && ion_page_pool_compact(pool))
+		page = alloc_pages(gfp, pool->order);
+	if (!page)
+		return false;
+	if (msm_ion_heap_high_order_page_zero(page, pool->order)) {
+		__free_pages(page, pool->order);
+		return false;
+	}
+	ion_page_pool_alloc_set_cache_policy(pool, page);
+	ion_page_pool_add(pool, page, false);
+	atomic_long_inc(&pool->refills);
+	return true;
+}
+
+static int ion_page_pool_zero_thread(void *data)
+{
+	struct ion_page_pool *pool;
+
+	set_freezable();
+	while (true) {
+		wait_event_freezable(ion_pool_zero_wait,
+			atomic_read(&ion_pool_dirty_pages) > 0 ||
+			atomic_read(&ion_pool_prefill_wanted));
+
+		atomic_set(&ion_pool_prefill_wanted, 0);
+		mutex_lock(&ion_pool_zero_lock);
+		list_for_each_entry(pool, &ion_pool_zero_pools, zero_list) {
+			while (ion_page_pool_zero_one(pool))
+				cond_resched();
+		}
+		/* frees outrank prefill, go back to them as soon as any arrive */
+		list_for_each_entry(pool, &ion_pool_zero_pools, zero_list) {
+			while (!atomic_read(&ion_pool_dirty_pages) &&
+			       ion_page_pool_prefill_one(pool))
+				cond_resched();
+		}
+		mutex_unlock(&ion_pool_zero_lock);
+	}
+
+	return 0;
+}
+
 static int __init ion_page_pool_init(void)
 {
+	struct sched_param param = { .sched_priority = 0 };
+	struct task_struct *task;
+
+	task = kthread_run(ion_page_pool_zero_thread, NULL, "ion_pool_zero");
+	if (IS_ERR(task)) {
+		pr_err("%s: creating thread for background zeroing failed\n",
+		       __func__);
+		return 0;
+	}
+	sched_setscheduler(task, SCHED_IDLE, &param);
+	ion_pool_zero_task = task;
 	return 0;
 }
 
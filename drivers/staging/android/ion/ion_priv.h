@@ -177,6 +177,8 @@ struct ion_heap_ops {
  * @task:		task struct of deferred free thread
  * @debug_show:		called when heap debug file is read to add any
  *			heap specific debug info to output
+ * @debugfs_init:	called once the heap is added to create any heap
+ *			specific debugfs files under @root
  *
  * Represents a pool of memory from which buffers can be made.  In some
  * systems the only heap is regular system memory allocated via vmalloc.
@@ -200,6 +202,7 @@ struct ion_heap {
 	struct task_struct *task;
 
 	int (*debug_show)(struct ion_heap *heap, struct seq_file *, void *);
+	void (*debugfs_init)(struct ion_heap *heap, struct dentry *root);
 	atomic_long_t total_allocated;
 	atomic_long_t total_allocated_peak;
 	atomic_long_t total_handles;
@@ -409,6 +412,20 @@ void ion_carveout_free(struct ion_heap *heap, ion_phys_addr_t addr,
  * invalidated from the cache, provides a significant performance benefit on
  * many systems */
 
+/*
+ * Per-CPU front cache of a page pool: holds up to ION_POOL_PCP_PAGES
+ * pages worth of lowmem items and exchanges them with the pool in
+ * batches of half that, so most allocations and frees never take the
+ * pool mutex.
+ */
+#define ION_POOL_PCP_PAGES	64
+
+struct ion_page_pool_pcp {
+	spinlock_t lock;
+	int count;
+	struct page *items[ION_POOL_PCP_PAGES];
+};
+
 /**
  * struct ion_page_pool - pagepool struct
  * @high_count:		number of highmem items in the pool
@@ -422,6 +439,20 @@ void ion_carveout_free(struct ion_heap *heap, ion_phys_addr_t addr,
  * @gfp_mask:		gfp_mask to use from alloc
  * @order:		order of pages in the pool
  * @list:		plist node for list of pools
+ * @pcp:		per-CPU front caches, lowmem items only
+ * @pcp_high:		max items in each front cache, 0 if disabled
+ * @pcp_batch:		items moved between a front cache and the pool at once
+ * @pcp_count:		items in all front caches
+ * @dirty_count:	number of items waiting to be zeroed
+ * @dirty_items:	list of items freed without zeroing, highmem or not
+ * @prefill_kb:		target the zeroing thread tops this pool up to when
+ *			idle, 0 to disable
+ * @compact_after:	jiffies before which the pool won't compact again
+ * @zero_list:		node in the list of pools served by the zeroing thread
+ * @hits:		allocations served from the pool
+ * @misses:		allocations that had to go to the buddy allocator
+ * @refills:		items added by the prefill
+ * @compactions:	compaction runs started by the prefill
  *
  * Allows you to keep a pool of pre allocated pages to use from your heap.
  * Keeping a pool of pages that is ready for dma, ie any cached mapping have
@@ -438,14 +469,35 @@ struct ion_page_pool {
 	gfp_t gfp_mask;
 	unsigned int order;
 	struct plist_node list;
+	struct ion_page_pool_pcp __percpu *pcp;
+	int pcp_high;
+	int pcp_batch;
+	atomic_t pcp_count;
+	int dirty_count;
+	struct list_head dirty_items;
+	u32 prefill_kb;
+	unsigned long compact_after;
+	struct list_head zero_list;
+	atomic_long_t hits;
+	atomic_long_t misses;
+	atomic_long_t refills;
+	atomic_long_t compactions;
 };
 
+/* lowmem items in the pool, including those in the per-CPU caches */
+static inline int ion_page_pool_low_count(struct ion_page_pool *pool)
+{
+	return pool->low_count + atomic_read(&pool->pcp_count);
+}
+
 struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order);
 void ion_page_pool_destroy(struct ion_page_pool *);
 void *ion_page_pool_alloc(struct ion_page_pool *, bool *from_pool);
 void *ion_page_pool_alloc_pool_only(struct ion_page_pool *);
 void ion_page_pool_free(struct ion_page_pool *, struct page *, bool prefetch);
 void ion_page_pool_free_immediate(struct ion_page_pool *, struct page *);
+bool ion_page_pool_background_zero(void);
+void ion_page_pool_free_dirty(struct ion_page_pool *, struct page *);
 int ion_page_pool_total(struct ion_page_pool *pool, bool high);
 void *ion_page_pool_prefetch(struct ion_page_pool *pool, bool *from_pool);
 
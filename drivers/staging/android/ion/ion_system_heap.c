@@ -16,6 +16,7 @@
  */
 
 #include <asm/page.h>
+#include <linux/debugfs.h>
 #include <linux/dma-mapping.h>
 #include <linux/err.h>
 #include <linux/highmem.h>
@@ -73,24 +74,31 @@ struct page_info {
 	struct list_head list;
 };
 
+static struct ion_page_pool *buffer_page_pool(struct ion_system_heap *heap,
+					      struct ion_buffer *buffer,
+					      unsigned long order)
+{
+	int vmid = get_secure_vmid(buffer->flags);
+
+	if (vmid > 0)
+		return heap->secure_pools[vmid][order_to_index(order)];
+	else if (ion_buffer_cached(buffer))
+		return heap->cached_pools[order_to_index(order)];
+	else
+		return heap->uncached_pools[order_to_index(order)];
+}
+
 static struct page *alloc_buffer_page(struct ion_system_heap *heap,
 				      struct ion_buffer *buffer,
 				      unsigned long order,
 				      bool *from_pool)
 {
-	bool cached = ion_buffer_cached(buffer);
 	bool prefetch = buffer->flags & ION_FLAG_POOL_PREFETCH;
 	struct page *page;
 	struct ion_page_pool *pool;
-	int vmid = get_secure_vmid(buffer->flags);
 
 	if (*from_pool) {
-		if (vmid > 0)
-			pool = heap->secure_pools[vmid][order_to_index(order)];
-		else if (!cached)
-			pool = heap->uncached_pools[order_to_index(order)];
-		else
-			pool = heap->cached_pools[order_to_index(order)];
+		pool = buffer_page_pool(heap, buffer, order);
 
 		if (prefetch)
 			page = ion_page_pool_prefetch(pool, from_pool);
@@ -116,18 +124,11 @@ static void free_buffer_page(struct ion_system_heap *heap,
 			     struct ion_buffer *buffer, struct page *page,
 			     unsigned int order)
 {
-	bool cached = ion_buffer_cached(buffer);
 	bool prefetch = buffer->flags & ION_FLAG_POOL_PREFETCH;
-	int vmid = get_secure_vmid(buffer->flags);
 
 	if (!(buffer->flags & ION_FLAG_POOL_FORCE_ALLOC)) {
-		struct ion_page_pool *pool;
-		if (vmid > 0)
-			pool = heap->secure_pools[vmid][order_to_index(order)];
-		else if (cached)
-			pool = heap->cached_pools[order_to_index(order)];
-		else
-			pool = heap->uncached_pools[order_to_index(order)];
+		struct ion_page_pool *pool = buffer_page_pool(heap, buffer,
+							      order);
 
 		if (buffer->private_flags & ION_PRIV_FLAG_SHRINKER_FREE)
 			ion_page_pool_free_immediate(pool, page);
@@ -223,6 +224,8 @@ static int ion_system_heap_allocate(struct ion_heap *heap,
 	struct pages_mem data;
 	unsigned int sz;
 	int vmid = get_secure_vmid(buffer->flags);
+	unsigned int orders_used = 0, pool_hits = 0, pool_misses = 0;
+	u64 zero_ns;
 
 	if (align > PAGE_SIZE)
 		return -EINVAL;
@@ -240,13 +243,16 @@ static int ion_system_heap_allocate(struct ion_heap *heap,
 			goto err;
 
 		sz = (1 << info->order) * PAGE_SIZE;
+		orders_used |= 1 << info->order;
 
 		if (info->from_pool) {
 			list_add_tail(&info->list, &pages_from_pool);
+			pool_hits++;
 		} else {
 			list_add_tail(&info->list, &pages);
 			data.size += sz;
 			++nents_sync;
+			pool_misses++;
 		}
 		size_remaining -= sz;
 		max_order = info->order;
@@ -305,7 +311,9 @@ static int ion_system_heap_allocate(struct ion_heap *heap,
 
 	} while (sg);
 
+	zero_ns = ktime_get_ns();
 	ret = msm_ion_heap_pages_zero(data.pages, data.size >> PAGE_SHIFT);
+	zero_ns = ktime_get_ns() - zero_ns;
 	if (ret) {
 		pr_err("Unable to zero pages\n");
 		goto err_free_sg2;
@@ -326,6 +334,8 @@ static int ion_system_heap_allocate(struct ion_heap *heap,
 	if (nents_sync)
 		sg_free_table(&table_sync);
 	msm_ion_heap_free_pages_mem(&data);
+	trace_ion_system_heap_allocate(heap->id, size, orders_used, pool_hits,
+				       pool_misses, zero_ns);
 	return 0;
 
 err_free_sg2:
@@ -369,19 +379,39 @@ void ion_system_heap_free(struct ion_buffer *buffer)
 	LIST_HEAD(pages);
 	int i;
 	int vmid = get_secure_vmid(buffer->flags);
+	bool dirty = false;
+	u64 zero_ns = 0;
 
 	if (!(buffer->private_flags & ION_PRIV_FLAG_SHRINKER_FREE) &&
 	    !(buffer->flags & ION_FLAG_POOL_FORCE_ALLOC)) {
-		if (vmid < 0)
+		/*
+		 * Leave the zeroing to the pool thread; prefetch pages keep
+		 * their reservation so they still take the synchronous path.
+		 */
+		if (vmid < 0 && !(buffer->flags & ION_FLAG_POOL_PREFETCH) &&
+		    ion_page_pool_background_zero())
+			dirty = true;
+		else if (vmid < 0) {
+			zero_ns = ktime_get_ns();
 			msm_ion_heap_sg_table_zero(table, buffer->size);
+			zero_ns = ktime_get_ns() - zero_ns;
+		}
 	} else if (vmid > 0) {
 		if (ion_system_secure_heap_unassign_sg(table, vmid))
 			return;
 	}
 
-	for_each_sg(table->sgl, sg, table->nents, i)
-		free_buffer_page(sys_heap, buffer, sg_page(sg),
-				get_order(sg->length));
+	for_each_sg(table->sgl, sg, table->nents, i) {
+		unsigned int order = get_order(sg->length);
+
+		if (dirty)
+			ion_page_pool_free_dirty(
+				buffer_page_pool(sys_heap, buffer, order),
+				sg_page(sg));
+		else
+			free_buffer_page(sys_heap, buffer, sg_page(sg), order);
+	}
+	trace_ion_system_heap_free(heap->id, buffer->size, dirty, zero_ns);
 	sg_free_table(table);
 	kfree(table);
 }
@@ -537,15 +567,22 @@ static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 					pool->high_count);
 			seq_printf(s,
 				"%d order %u lowmem pages in uncached pool = %lu total\n",
-				pool->low_count, pool->order,
+				ion_page_pool_low_count(pool), pool->order,
+				(1 << pool->order) * PAGE_SIZE *
+					ion_page_pool_low_count(pool));
+			seq_printf(s,
+				"%d order %u dirty pages in uncached pool = %lu total\n",
+				pool->dirty_count, pool->order,
 				(1 << pool->order) * PAGE_SIZE *
-					pool->low_count);
+					pool->dirty_count);
 		}
 
 		uncached_total += (1 << pool->order) * PAGE_SIZE *
 			pool->high_count;
 		uncached_total += (1 << pool->order) * PAGE_SIZE *
-			pool->low_count;
+			ion_page_pool_low_count(pool);
+		uncached_total += (1 << pool->order) * PAGE_SIZE *
+			pool->dirty_count;
 	}
 
 	for (i = 0; i < num_orders; i++) {
@@ -557,15 +594,22 @@ static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 				(1 << pool->order) * PAGE_SIZE * pool->high_count);
 			seq_printf(s,
 				"%d order %u lowmem pages in cached pool = %lu total\n",
-				pool->low_count, pool->order,
+				ion_page_pool_low_count(pool), pool->order,
+				(1 << pool->order) * PAGE_SIZE *
+					ion_page_pool_low_count(pool));
+			seq_printf(s,
+				"%d order %u dirty pages in cached pool = %lu total\n",
+				pool->dirty_count, pool->order,
 				(1 << pool->order) * PAGE_SIZE *
-					pool->low_count);
+					pool->dirty_count);
 		}
 
 		cached_total += (1 << pool->order) * PAGE_SIZE *
 			pool->high_count;
 		cached_total += (1 << pool->order) * PAGE_SIZE *
-			pool->low_count;
+			ion_page_pool_low_count(pool);
+		cached_total += (1 << pool->order) * PAGE_SIZE *
+			pool->dirty_count;
 	}
 
 	for (i = 0; i < num_orders; i++) {
@@ -582,15 +626,16 @@ static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 						pool->high_count);
 				seq_printf(s,
 					"VMID  %d: %d order %u lowmem pages in secure pool = %lu total\n",
-					j, pool->low_count, pool->order,
+					j, ion_page_pool_low_count(pool),
+					pool->order,
 					(1 << pool->order) * PAGE_SIZE *
-						pool->low_count);
+						ion_page_pool_low_count(pool));
 			}
 
 			secure_total += (1 << pool->order) * PAGE_SIZE *
 				pool->high_count;
 			secure_total += (1 << pool->order) * PAGE_SIZE *
-				pool->low_count;
+				ion_page_pool_low_count(pool);
 		}
 	}
 
@@ -631,13 +676,15 @@ void show_ion_system_heap_pool_size(struct seq_file *s)
 	for (i = 0; i < num_orders; i++) {
 		pool = system_heap->uncached_pools[i];
 		uncached += (1 << pool->order) * pool->high_count;
-		uncached += (1 << pool->order) * pool->low_count;
+		uncached += (1 << pool->order) * ion_page_pool_low_count(pool);
+		uncached += (1 << pool->order) * pool->dirty_count;
 	}
 
 	for (i = 0; i < num_orders; i++) {
 		pool = system_heap->cached_pools[i];
 		cached += (1 << pool->order) * pool->high_count;
-		cached += (1 << pool->order) * pool->low_count;
+		cached += (1 << pool->order) * ion_page_pool_low_count(pool);
+		cached += (1 << pool->order) * pool->dirty_count;
 	}
 
 	for (i = 0; i < num_orders; i++) {
@@ -646,7 +693,8 @@ void show_ion_system_heap_pool_size(struct seq_file *s)
 				continue;
 			pool = system_heap->secure_pools[j][i];
 			secure += (1 << pool->order) * pool->high_count;
-			secure += (1 << pool->order) * pool->low_count;
+			secure += (1 << pool->order) *
+				ion_page_pool_low_count(pool);
 		}
 	}
 
@@ -658,6 +706,75 @@ void show_ion_system_heap_pool_size(struct seq_file *s)
 			(uncached + cached + secure) << (PAGE_SHIFT - 10));
 }
 
+static int ion_system_heap_pool_stats_show(struct seq_file *s, void *unused)
+{
+	struct ion_system_heap *sys_heap = s->private;
+	struct ion_page_pool *uncached, *cached;
+	int i;
+
+	seq_printf(s, "%5s %10s %10s %10s %10s %10s %10s %10s\n", "order",
+		   "hits", "misses", "c_hits", "c_misses", "target_kb",
+		   "refills", "compacts");
+	for (i = 0; i < num_orders; i++) {
+		uncached = sys_heap->uncached_pools[i];
+		cached = sys_heap->cached_pools[i];
+		seq_printf(s, "%5u %10ld %10ld %10ld %10ld %10u %10ld %10ld\n",
+			   orders[i], atomic_long_read(&uncached->hits),
+			   atomic_long_read(&uncached->misses),
+			   atomic_long_read(&cached->hits),
+			   atomic_long_read(&cached->misses),
+			   uncached->prefill_kb,
+			   atomic_long_read(&uncached->refills),
+			   atomic_long_read(&uncached->compactions));
+	}
+	return 0;
+}
+
+static int ion_system_heap_pool_stats_open(struct inode *inode,
+					   struct file *file)
+{
+	return single_open(file, ion_system_heap_pool_stats_show,
+			   inode->i_private);
+}
+
+static const struct file_operations pool_stats_fops = {
+	.open = ion_system_heap_pool_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/*
+ * <heap>_pools/order<N>_target_kb sets how much the pool thread keeps
+ * prefilled in the uncached pool of that order, from its next allocation
+ * on; stats shows per order hits and misses for both the uncached and
+ * cached pools.
+ */
+static void ion_system_heap_debugfs_init(struct ion_heap *heap,
+					 struct dentry *root)
+{
+	struct ion_system_heap *sys_heap = container_of(heap,
+							struct ion_system_heap,
+							heap);
+	struct dentry *dir;
+	char name[64];
+	int i;
+
+	snprintf(name, sizeof(name), "%s_pools", heap->name);
+	dir = debugfs_create_dir(name, root);
+	if (!dir) {
+		pr_err("Failed to create %s debugfs directory\n", name);
+		return;
+	}
+
+	debugfs_create_file("stats", 0444, dir, sys_heap, &pool_stats_fops);
+	for (i = 0; i < num_orders; i++) {
+		snprintf(name, sizeof(name), "order%u_target_kb", orders[i]);
+		debugfs_create_u32(name, 0644, dir,
+				   &sys_heap->uncached_pools[i]->prefill_kb);
+	}
+}
+
 static void ion_system_heap_destroy_pools(struct ion_page_pool **pools)
 {
 	int i;
@@ -751,6 +868,7 @@ struct ion_heap *ion_system_heap_create(struct ion_platform_heap *unused)
 		goto err_create_cached_pools;
 
 	heap->heap.debug_show = ion_system_heap_debug_show;
+	heap->heap.debugfs_init = ion_system_heap_debugfs_init;
 	if (!system_heap)
 		system_heap = heap;
 	else
@@ -18,18 +18,23 @@
 #include <linux/dma-buf.h>
 #include <linux/dma-direction.h>
 #include <linux/fs.h>
+#include <linux/ktime.h>
 #include <linux/miscdevice.h>
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/sched.h>
 #include <linux/slab.h>
+#include <linux/sort.h>
 #include <linux/uaccess.h>
 #include <linux/vmalloc.h>
 
 #include "ion.h"
+#include "msm/msm_ion.h"
 #include "../uapi/ion_test.h"
 
+#define ION_TEST_MAX_ITERATIONS 65536
+
 #define u64_to_uptr(x) ((void __user *)(unsigned long)(x))
 
 struct ion_test_device {
@@ -143,6 +148,62 @@ err:
 	return ret;
 }
 
+static int ion_test_cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int ion_test_alloc_latency(struct ion_test_alloc_latency *lat)
+{
+	struct ion_client *client;
+	struct ion_handle *handle;
+	unsigned int i, n = lat->iterations;
+	u64 *samples, start;
+	int ret = 0;
+
+	if (!IS_ENABLED(CONFIG_ION_MSM))
+		return -ENODEV;
+	if (!n || n > ION_TEST_MAX_ITERATIONS || !lat->len)
+		return -EINVAL;
+
+	samples = vmalloc(n * sizeof(*samples));
+	if (!samples)
+		return -ENOMEM;
+
+	client = msm_ion_client_create("ion-test");
+	if (IS_ERR_OR_NULL(client)) {
+		ret = client ? PTR_ERR(client) : -ENODEV;
+		goto out;
+	}
+
+	for (i = 0; i < n; i++) {
+		start = ktime_get_ns();
+		handle = ion_alloc(client, lat->len, PAGE_SIZE,
+				   lat->heap_id_mask, lat->flags);
+		samples[i] = ktime_get_ns() - start;
+		if (IS_ERR_OR_NULL(handle)) {
+			ret = handle ? PTR_ERR(handle) : -ENOMEM;
+			break;
+		}
+		ion_free(client, handle);
+		cond_resched();
+	}
+	ion_client_destroy(client);
+	if (ret)
+		goto out;
+
+	sort(samples, n, sizeof(*samples), ion_test_cmp_u64, NULL);
+	lat->p50_ns = samples[n / 2];
+	lat->p90_ns = samples[n * 9 / 10];
+	lat->p99_ns = samples[n * 99 / 100];
+	lat->max_ns = samples[n - 1];
+out:
+	vfree(samples);
+	return ret;
+}
+
 static long ion_test_ioctl(struct file *filp, unsigned int cmd,
 						unsigned long arg)
 {
@@ -151,6 +212,7 @@ static long ion_test_ioctl(struct file *filp, unsigned int cmd,
 
 	union {
 		struct ion_test_rw_data test_rw;
+		struct ion_test_alloc_latency alloc_latency;
 	} data;
 
 	if (_IOC_SIZE(cmd) > sizeof(data))
@@ -192,6 +254,11 @@ static long ion_test_ioctl(struct file *filp, unsigned int cmd,
 					data.test_rw.write);
 		break;
 	}
+	case ION_IOC_TEST_ALLOC_LATENCY:
+	{
+		ret = ion_test_alloc_latency(&data.alloc_latency);
+		break;
+	}
 	default:
 		return -ENOTTY;
 	}
@@ -47,6 +47,13 @@
 #include <linux/cpuset.h>
 #include <linux/vmpressure.h>
 #include <linux/zcache.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
+#include <linux/spinlock.h>
+#include <linux/ktime.h>
+#include <linux/hashtable.h>
+#include <linux/profile.h>
+#include <linux/slab.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/almk.h>
@@ -123,6 +130,78 @@ static int vmpressure_file_min;
 module_param_named(vmpressure_file_min, vmpressure_file_min, int,
 	S_IRUGO | S_IWUSR);
 
+/*
+ * Stall mode: rather than comparing free and file pages against minfree,
+ * kill once vmpressure has stayed at or above stall_pressure for
+ * stall_ms, and go one adj level deeper for every further stall_ms it
+ * lasts. Only the lowest minfree level still kills on its own, as free
+ * memory is about to run out. 0 keeps the minfree behaviour.
+ */
+static int lmk_stall_ms;
+module_param_named(stall_ms, lmk_stall_ms, int, S_IRUGO | S_IWUSR);
+
+static int lmk_stall_pressure = 60;
+module_param_named(stall_pressure, lmk_stall_pressure, int,
+	S_IRUGO | S_IWUSR);
+
+/* ktime_get_ns() when the current stall began, 0 if not stalling */
+static atomic64_t lmk_stall_start = ATOMIC64_INIT(0);
+
+static void lmk_stall_update(unsigned long pressure)
+{
+	if (pressure >= lmk_stall_pressure) {
+		if (!atomic64_read(&lmk_stall_start))
+			atomic64_cmpxchg(&lmk_stall_start, 0, ktime_get_ns());
+	} else {
+		atomic64_set(&lmk_stall_start, 0);
+	}
+}
+
+static u64 lmk_stall_ns(void)
+{
+	u64 start = atomic64_read(&lmk_stall_start);
+
+	return start ? ktime_get_ns() - start : 0;
+}
+
+static short lmk_stall_adj(int other_free, int other_file, int array_size)
+{
+	unsigned int stall_ms = div_u64(lmk_stall_ns(), NSEC_PER_MSEC);
+	int level;
+
+	if (other_free < lowmem_minfree[0] && other_file < lowmem_minfree[0])
+		return lowmem_adj[0];
+	if (stall_ms < lmk_stall_ms)
+		return OOM_SCORE_ADJ_MAX + 1;
+
+	level = array_size - stall_ms / lmk_stall_ms;
+	return lowmem_adj[max(level, 0)];
+}
+
+/*
+ * Async reaper: a victim blocked in the kernel may take a long time to
+ * reach exit_mm(), so a kthread zaps its private anonymous memory as
+ * soon as the kill is sent. Nothing else may still be using the mm.
+ */
+static int lmk_reap = 1;
+module_param_named(reap, lmk_reap, int, S_IRUGO | S_IWUSR);
+
+#define LMK_REAP_QUEUE		8
+#define LMK_REAP_RETRIES	10
+
+struct lmk_reap_entry {
+	struct task_struct *tsk;
+	u64 kill_ns;
+	u64 stall_ns;
+};
+
+static struct lmk_reap_entry lmk_reap_queue[LMK_REAP_QUEUE];
+static int lmk_reap_head;
+static int lmk_reap_count;
+static DEFINE_SPINLOCK(lmk_reap_lock);
+static DECLARE_WAIT_QUEUE_HEAD(lmk_reap_wait);
+static struct task_struct *lmk_reaper;
+
 enum {
 	VMPRESSURE_NO_ADJUST = 0,
 	VMPRESSURE_ADJUST_ENCROACH,
@@ -156,6 +235,8 @@ static int lmk_vmpressure_notifier(struct notifier_block *nb,
 	unsigned long pressure = action;
 	int array_size = ARRAY_SIZE(lowmem_adj);
 
+	lmk_stall_update(pressure);
+
 	if (!enable_adaptive_lmk)
 		return 0;
 
@@ -237,6 +318,354 @@ static int test_task_state(struct task_struct *p, int state)
 
 static DEFINE_MUTEX(scan_mutex);
 
+/*
+ * Candidate index: every process whose oom_score_adj has been written and
+ * is not negative sits on a bucket covering 16 adj values, so a scan only
+ * has to look at the top buckets instead of walking every process. Entries
+ * hold a reference on the group leader and are dropped when it exits, or
+ * lazily when a scan finds it dead. Processes that never had their adj
+ * written are only found by the full scan, which runs whenever the index
+ * produces no victim.
+ */
+static int lmk_index = 1;
+module_param_named(index, lmk_index, int, S_IRUGO | S_IWUSR);
+
+#define LMK_INDEX_SHIFT		4
+#define LMK_INDEX_BUCKETS	((OOM_SCORE_ADJ_MAX >> LMK_INDEX_SHIFT) + 1)
+#define LMK_INDEX_BATCH		32
+
+struct lmk_index_entry {
+	struct hlist_node hnode;
+	struct list_head node;
+	struct task_struct *tsk;
+	short adj;
+};
+
+static struct kmem_cache *lmk_index_cache;
+static DEFINE_SPINLOCK(lmk_index_lock);
+static DEFINE_HASHTABLE(lmk_index_hash, 8);
+static struct list_head lmk_index_buckets[LMK_INDEX_BUCKETS];
+
+/* last victim, so the index path can honour lowmem_deathpending_timeout */
+static struct task_struct *lowmem_last_victim;
+
+/* lmk_index_lock held */
+static struct lmk_index_entry *lmk_index_find(struct task_struct *tsk)
+{
+	struct lmk_index_entry *e;
+
+	hash_for_each_possible(lmk_index_hash, e, hnode, (unsigned long)tsk)
+		if (e->tsk == tsk)
+			return e;
+	return NULL;
+}
+
+static void lmk_index_remove(struct task_struct *tsk)
+{
+	struct lmk_index_entry *e;
+
+	spin_lock(&lmk_index_lock);
+	e = lmk_index_find(tsk);
+	if (e) {
+		hash_del(&e->hnode);
+		list_del(&e->node);
+	}
+	spin_unlock(&lmk_index_lock);
+
+	if (e) {
+		put_task_struct(e->tsk);
+		kmem_cache_free(lmk_index_cache, e);
+	}
+}
+
+/*
+ * Called from the /proc oom_adj and oom_score_adj writers with task_lock
+ * and the sighand lock held.
+ */
+void lowmem_adj_update(struct task_struct *task)
+{
+	struct task_struct *tsk = task->group_leader;
+	short adj = task->signal->oom_score_adj;
+	struct lmk_index_entry *e;
+
+	if (!lmk_index_cache)
+		return;
+	if (adj < 0 || (tsk->flags & PF_EXITING)) {
+		lmk_index_remove(tsk);
+		return;
+	}
+
+	spin_lock(&lmk_index_lock);
+	e = lmk_index_find(tsk);
+	if (!e) {
+		e = kmem_cache_alloc(lmk_index_cache,
+				     GFP_ATOMIC | __GFP_NOWARN);
+		if (!e)
+			goto out;
+		get_task_struct(tsk);
+		e->tsk = tsk;
+		hash_add(lmk_index_hash, &e->hnode, (unsigned long)tsk);
+		INIT_LIST_HEAD(&e->node);
+	}
+	e->adj = adj;
+	list_move_tail(&e->node,
+		       &lmk_index_buckets[adj >> LMK_INDEX_SHIFT]);
+out:
+	spin_unlock(&lmk_index_lock);
+}
+
+static int lmk_task_exit_notify(struct notifier_block *nb,
+				unsigned long action, void *data)
+{
+	struct task_struct *tsk = data;
+
+	if (thread_group_leader(tsk))
+		lmk_index_remove(tsk);
+	return NOTIFY_OK;
+}
+
+static struct notifier_block lmk_task_exit_nb = {
+	.notifier_call = lmk_task_exit_notify,
+};
+
+struct lowmem_victim {
+	struct task_struct *p;
+	int tasksize;
+	short adj;
+};
+
+/*
+ * Compare @tsk against the best victim so far. Returns true if a previous
+ * kill is still pending and the scan should stop. rcu_read_lock held.
+ */
+static bool lowmem_consider(struct task_struct *tsk, short min_score_adj,
+			    struct lowmem_victim *v)
+{
+	struct task_struct *p;
+	short oom_score_adj;
+	int tasksize;
+
+	if (tsk->flags & PF_KTHREAD)
+		return false;
+
+	/* if task no longer has any memory ignore it */
+	if (test_task_flag(tsk, TIF_MM_RELEASED))
+		return false;
+
+	if (time_before_eq(jiffies, lowmem_deathpending_timeout)) {
+		if (test_task_flag(tsk, TIF_MEMDIE))
+			return true;
+	}
+
+	p = find_lock_task_mm(tsk);
+	if (!p)
+		return false;
+
+	oom_score_adj = p->signal->oom_score_adj;
+	if (oom_score_adj < min_score_adj) {
+		task_unlock(p);
+		return false;
+	}
+	tasksize = get_mm_rss(p->mm);
+	task_unlock(p);
+	if (tasksize <= 0)
+		return false;
+	if (v->p) {
+		if (oom_score_adj < v->adj)
+			return false;
+		if (oom_score_adj == v->adj && tasksize <= v->tasksize)
+			return false;
+	}
+	v->p = p;
+	v->tasksize = tasksize;
+	v->adj = oom_score_adj;
+	lowmem_print(3, "select '%s' (%d), adj %hd, size %d, to kill\n",
+		     p->comm, p->pid, oom_score_adj, tasksize);
+	return false;
+}
+
+/*
+ * Walk the index from the top bucket down, stopping at the first bucket
+ * that yields a victim; RSS is only sampled for tasks in the buckets
+ * visited. A bucket is taken LMK_INDEX_BATCH entries at a time, visited
+ * entries are parked on a local list until the whole bucket has been seen
+ * and are put back in order afterwards. rcu_read_lock held.
+ */
+static bool lowmem_select_indexed(short min_score_adj,
+				  struct lowmem_victim *v, int *scanned)
+{
+	struct task_struct *cand[LMK_INDEX_BATCH];
+	struct task_struct *last = lowmem_last_victim;
+	struct lmk_index_entry *e, *tmp;
+	LIST_HEAD(visited);
+	bool pending = false;
+	int b, i, n;
+
+	if (last && time_before_eq(jiffies, lowmem_deathpending_timeout) &&
+	    !test_task_flag(last, TIF_MM_RELEASED) &&
+	    test_task_flag(last, TIF_MEMDIE))
+		return true;
+
+	for (b = LMK_INDEX_BUCKETS - 1;
+	     b >= max_t(short, min_score_adj, 0) >> LMK_INDEX_SHIFT; b--) {
+		do {
+			n = 0;
+			spin_lock(&lmk_index_lock);
+			list_for_each_entry_safe(e, tmp, &lmk_index_buckets[b],
+						 node) {
+				if (n == LMK_INDEX_BATCH)
+					break;
+				list_move_tail(&e->node, &visited);
+				if (e->adj < min_score_adj)
+					continue;
+				get_task_struct(e->tsk);
+				cand[n++] = e->tsk;
+			}
+			if (list_empty(&lmk_index_buckets[b]))
+				list_splice_init(&visited,
+						 &lmk_index_buckets[b]);
+			spin_unlock(&lmk_index_lock);
+
+			for (i = 0; i < n; i++) {
+				if (cand[i]->exit_state)
+					lmk_index_remove(cand[i]);
+				else if (!pending)
+					pending = lowmem_consider(cand[i],
+							min_score_adj, v);
+				put_task_struct(cand[i]);
+			}
+			*scanned += n;
+		} while (!list_empty(&visited));
+		if (pending || v->p)
+			break;
+	}
+
+	return pending;
+}
+
+/* rcu_read_lock held */
+static void lmk_queue_reap(struct task_struct *tsk, u64 stall_ns)
+{
+	struct lmk_reap_entry *e;
+
+	if (!lmk_reap || !lmk_reaper)
+		return;
+
+	spin_lock(&lmk_reap_lock);
+	if (lmk_reap_count < LMK_REAP_QUEUE) {
+		e = &lmk_reap_queue[(lmk_reap_head + lmk_reap_count++) %
+				    LMK_REAP_QUEUE];
+		get_task_struct(tsk);
+		e->tsk = tsk;
+		e->kill_ns = ktime_get_ns();
+		e->stall_ns = stall_ns;
+	}
+	spin_unlock(&lmk_reap_lock);
+	wake_up(&lmk_reap_wait);
+}
+
+/* does a process outside @tsk's thread group, not being killed, use @mm */
+static bool lmk_mm_shared(struct task_struct *tsk, struct mm_struct *mm)
+{
+	struct task_struct *p, *t;
+	bool ret = false;
+
+	/* one user per thread, plus the reaper's own reference */
+	if (atomic_read(&mm->mm_users) <= get_nr_threads(tsk) + 1)
+		return false;
+
+	rcu_read_lock();
+	for_each_process(p) {
+		if (same_thread_group(p, tsk) || (p->flags & PF_KTHREAD) ||
+		    fatal_signal_pending(p))
+			continue;
+		for_each_thread(p, t) {
+			if (ACCESS_ONCE(t->mm) == mm) {
+				ret = true;
+				goto out;
+			}
+		}
+	}
+out:
+	rcu_read_unlock();
+	return ret;
+}
+
+/*
+ * Returns false if mmap_sem was contended and the caller should retry,
+ * true once there is nothing left to do. @freed is in pages.
+ */
+static bool lmk_reap_task(struct task_struct *tsk, unsigned long *freed)
+{
+	struct task_struct *p;
+	struct mm_struct *mm;
+	struct vm_area_struct *vma;
+	unsigned long rss;
+
+	*freed = 0;
+	p = find_lock_task_mm(tsk);
+	if (!p)
+		return true;
+	mm = p->mm;
+	atomic_inc(&mm->mm_users);
+	task_unlock(p);
+
+	if (mm->core_state || lmk_mm_shared(tsk, mm))
+		goto out;
+
+	if (!down_read_trylock(&mm->mmap_sem)) {
+		mmput(mm);
+		return false;
+	}
+
+	rss = get_mm_rss(mm);
+	for (vma = mm->mmap; vma; vma = vma->vm_next) {
+		if (vma->vm_file || (vma->vm_flags & (VM_LOCKED | VM_HUGETLB |
+				VM_PFNMAP | VM_IO | VM_SHARED)))
+			continue;
+		zap_page_range(vma, vma->vm_start,
+			       vma->vm_end - vma->vm_start, NULL);
+	}
+	*freed = rss - min(rss, get_mm_rss(mm));
+	up_read(&mm->mmap_sem);
+out:
+	mmput(mm);
+	return true;
+}
+
+static int lmk_reap_thread(void *data)
+{
+	struct lmk_reap_entry e;
+	unsigned long freed;
+	int i;
+
+	set_freezable();
+	while (true) {
+		wait_event_freezable(lmk_reap_wait, lmk_reap_count > 0);
+
+		spin_lock(&lmk_reap_lock);
+		e = lmk_reap_queue[lmk_reap_head];
+		lmk_reap_head = (lmk_reap_head + 1) % LMK_REAP_QUEUE;
+		lmk_reap_count--;
+		spin_unlock(&lmk_reap_lock);
+
+		for (i = 0; i < LMK_REAP_RETRIES; i++) {
+			if (lmk_reap_task(e.tsk, &freed))
+				break;
+			msleep(100);
+		}
+		trace_lowmemory_reap(e.tsk, freed * (long)(PAGE_SIZE / 1024),
+				     ktime_get_ns() - e.kill_ns,
+				     ktime_get_ns() - e.kill_ns + e.stall_ns);
+		lowmem_print(2, "reaped %lukB from '%s' (%d)\n",
+			     freed * (PAGE_SIZE / 1024), e.tsk->comm,
+			     e.tsk->pid);
+		put_task_struct(e.tsk);
+	}
+
+	return 0;
+}
+
 int can_use_cma_pages(gfp_t gfp_mask)
 {
 	int can_use = 0;
@@ -409,18 +838,21 @@ void tune_lmk_param(int *other_free, int *other_file, struct shrink_control *sc)
 static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 {
 	struct task_struct *tsk;
-	struct task_struct *selected = NULL;
+	struct task_struct *selected;
+	struct lowmem_victim v = { NULL };
 	unsigned long rem = 0;
-	int tasksize;
 	int i;
 	int ret = 0;
 	short min_score_adj = OOM_SCORE_ADJ_MAX + 1;
 	int minfree = 0;
-	int selected_tasksize = 0;
+	int selected_tasksize;
 	short selected_oom_score_adj;
 	int array_size = ARRAY_SIZE(lowmem_adj);
 	int other_free;
 	int other_file;
+	int scanned = 0;
+	bool pending = false;
+	u64 scan_start;
 
 	if (!mutex_trylock(&scan_mutex))
 		return 0;
@@ -450,6 +882,10 @@ static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 		}
 	}
 
+	if (lmk_stall_ms > 0)
+		min_score_adj = lmk_stall_adj(other_free, other_file,
+					      array_size);
+
 	ret = adjust_minadj(&min_score_adj);
 
 	lowmem_print(3, "lowmem_scan %lu, %x, ofree %d %d, ma %hd\n",
@@ -464,59 +900,34 @@ static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 		return 0;
 	}
 
-	selected_oom_score_adj = min_score_adj;
-
+	scan_start = ktime_get_ns();
 	rcu_read_lock();
-	for_each_process(tsk) {
-		struct task_struct *p;
-		short oom_score_adj;
-
-		if (tsk->flags & PF_KTHREAD)
-			continue;
-
-		/* if task no longer has any memory ignore it */
-		if (test_task_flag(tsk, TIF_MM_RELEASED))
-			continue;
-
-		if (time_before_eq(jiffies, lowmem_deathpending_timeout)) {
-			if (test_task_flag(tsk, TIF_MEMDIE)) {
-				rcu_read_unlock();
-				mutex_unlock(&scan_mutex);
-				return 0;
+	if (lmk_index && lmk_index_cache)
+		pending = lowmem_select_indexed(min_score_adj, &v, &scanned);
+	if (!pending && !v.p) {
+		for_each_process(tsk) {
+			scanned++;
+			if (lowmem_consider(tsk, min_score_adj, &v)) {
+				pending = true;
+				break;
 			}
 		}
-
-		p = find_lock_task_mm(tsk);
-		if (!p)
-			continue;
-
-		oom_score_adj = p->signal->oom_score_adj;
-		if (oom_score_adj < min_score_adj) {
-			task_unlock(p);
-			continue;
-		}
-		tasksize = get_mm_rss(p->mm);
-		task_unlock(p);
-		if (tasksize <= 0)
-			continue;
-		if (selected) {
-			if (oom_score_adj < selected_oom_score_adj)
-				continue;
-			if (oom_score_adj == selected_oom_score_adj &&
-			    tasksize <= selected_tasksize)
-				continue;
-		}
-		selected = p;
-		selected_tasksize = tasksize;
-		selected_oom_score_adj = oom_score_adj;
-		lowmem_print(3, "select '%s' (%d), adj %hd, size %d, to kill\n",
-			     p->comm, p->pid, oom_score_adj, tasksize);
 	}
+	if (pending) {
+		rcu_read_unlock();
+		mutex_unlock(&scan_mutex);
+		return 0;
+	}
+
+	selected = v.p;
+	selected_tasksize = v.tasksize;
+	selected_oom_score_adj = v.adj;
 	if (selected) {
 		long cache_size = other_file * (long)(PAGE_SIZE / 1024);
 		long cache_limit = minfree * (long)(PAGE_SIZE / 1024);
 		long free = other_free * (long)(PAGE_SIZE / 1024);
-		trace_lowmemory_kill(selected, cache_size, cache_limit, free);
+		trace_lowmemory_kill(selected, cache_size, cache_limit, free,
+				     scanned, ktime_get_ns() - scan_start);
 
 		if (test_task_flag(selected, TIF_MEMDIE) &&
 		    (test_task_state(selected, TASK_UNINTERRUPTIBLE))) {
@@ -563,6 +974,14 @@ static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 		lowmem_deathpending_timeout = jiffies + HZ;
 		set_tsk_thread_flag(selected, TIF_MEMDIE);
 		send_sig(SIGKILL, selected, 0);
+		lmk_queue_reap(selected, lmk_stall_ns());
+		if (lowmem_last_victim)
+			put_task_struct(lowmem_last_victim);
+		get_task_struct(selected);
+		lowmem_last_victim = selected;
+		/* the next level has to be earned by a fresh stall */
+		if (atomic64_read(&lmk_stall_start))
+			atomic64_set(&lmk_stall_start, ktime_get_ns());
 		rem += selected_tasksize;
 		rcu_read_unlock();
 		/* give the system time to free up the memory */
@@ -588,8 +1007,23 @@ static struct shrinker lowmem_shrinker = {
 
 static int __init lowmem_init(void)
 {
+	int i;
+
+	for (i = 0; i < LMK_INDEX_BUCKETS; i++)
+		INIT_LIST_HEAD(&lmk_index_buckets[i]);
+	lmk_index_cache = KMEM_CACHE(lmk_index_entry, 0);
+	if (lmk_index_cache &&
+	    profile_event_register(PROFILE_TASK_EXIT, &lmk_task_exit_nb)) {
+		kmem_cache_destroy(lmk_index_cache);
+		lmk_index_cache = NULL;
+	}
 	register_shrinker(&lowmem_shrinker);
 	vmpressure_notifier_register(&lmk_vmpr_nb);
+	lmk_reaper = kthread_run(lmk_reap_thread, NULL, "lmk_reaper");
+	if (IS_ERR(lmk_reaper)) {
+		pr_err("failed to start the reaper thread\n");
+		lmk_reaper = NULL;
+	}
 	return 0;
 }
 
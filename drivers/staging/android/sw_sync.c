@@ -15,11 +15,15 @@
  */
 
 #include <linux/kernel.h>
+#include <linux/debugfs.h>
 #include <linux/export.h>
 #include <linux/file.h>
 #include <linux/fs.h>
+#include <linux/ktime.h>
 #include <linux/miscdevice.h>
 #include <linux/module.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
 #include <linux/syscalls.h>
 #include <linux/uaccess.h>
 #include <linux/sw_sync.h>
@@ -38,6 +42,8 @@ struct sync_pt *sw_sync_pt_create(struct sw_sync_timeline *obj, u32 value)
 
 	pt = (struct sw_sync_pt *)
 		sync_pt_create(&obj->obj, sizeof(struct sw_sync_pt));
+	if (pt == NULL)
+		return NULL;
 
 	pt->value = value;
 
@@ -105,6 +111,7 @@ static struct sync_timeline_ops sw_sync_timeline_ops = {
 	.dup = sw_sync_pt_dup,
 	.has_signaled = sw_sync_pt_has_signaled,
 	.compare = sw_sync_pt_compare,
+	.ordered = true,
 	.fill_driver_data = sw_sync_fill_driver_data,
 	.timeline_value_str = sw_sync_timeline_value_str,
 	.pt_value_str = sw_sync_pt_value_str,
@@ -250,13 +257,106 @@ static struct miscdevice sw_sync_dev = {
 	.fops	= &sw_sync_fops,
 };
 
+#ifdef CONFIG_DEBUG_FS
+/*
+ * Benchmark of timeline signaling: queue @nr_pts fences on a fresh
+ * timeline, then retire them one increment at a time the way a GPU or
+ * display timeline does, and report the cost per increment.
+ */
+static void sw_sync_bench_run(struct seq_file *s, unsigned int nr_pts)
+{
+	struct sw_sync_timeline *obj;
+	struct sync_fence **fences;
+	struct sync_pt *pt;
+	ktime_t start;
+	u64 elapsed_ns;
+	unsigned int i, n;
+
+	fences = kcalloc(nr_pts, sizeof(*fences), GFP_KERNEL);
+	obj = sw_sync_timeline_create("sw_sync_bench");
+	if (fences == NULL || obj == NULL)
+		goto out;
+
+	for (n = 0; n < nr_pts; n++) {
+		pt = sw_sync_pt_create(obj, n + 1);
+		if (pt == NULL)
+			break;
+		fences[n] = sync_fence_create("sw_sync_bench", pt);
+		if (fences[n] == NULL) {
+			sync_pt_free(pt);
+			break;
+		}
+	}
+
+	start = ktime_get();
+	for (i = 0; i < n; i++)
+		sw_sync_timeline_inc(obj, 1);
+	elapsed_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	seq_printf(s, "pts=%u signals=%u total_ns=%llu ns_per_signal=%llu\n",
+		   n, n, elapsed_ns, n ? div_u64(elapsed_ns, n) : 0);
+
+	for (i = 0; i < n; i++)
+		sync_fence_put(fences[i]);
+out:
+	if (obj)
+		sync_timeline_destroy(&obj->obj);
+	kfree(fences);
+}
+
+static int sw_sync_bench_show(struct seq_file *s, void *unused)
+{
+	static const unsigned int nr_pts[] = { 16, 128, 1024 };
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(nr_pts); i++)
+		sw_sync_bench_run(s, nr_pts[i]);
+
+	return 0;
+}
+
+static int sw_sync_bench_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sw_sync_bench_show, inode->i_private);
+}
+
+static const struct file_operations sw_sync_bench_fops = {
+	.open	 = sw_sync_bench_open,
+	.read	 = seq_read,
+	.llseek	 = seq_lseek,
+	.release = single_release,
+};
+
+static struct dentry *sw_sync_bench_dentry;
+
+static void sw_sync_bench_init(void)
+{
+	sw_sync_bench_dentry = debugfs_create_file("sw_sync_bench", S_IRUSR,
+						   NULL, NULL,
+						   &sw_sync_bench_fops);
+}
+
+static void sw_sync_bench_exit(void)
+{
+	debugfs_remove(sw_sync_bench_dentry);
+}
+#else
+static inline void sw_sync_bench_init(void) { }
+static inline void sw_sync_bench_exit(void) { }
+#endif
+
 static int __init sw_sync_device_init(void)
 {
-	return misc_register(&sw_sync_dev);
+	int ret = misc_register(&sw_sync_dev);
+
+	if (!ret)
+		sw_sync_bench_init();
+	return ret;
 }
 
 static void __exit sw_sync_device_remove(void)
 {
+	sw_sync_bench_exit();
 	misc_deregister(&sw_sync_dev);
 }
 
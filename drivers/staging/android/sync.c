@@ -152,6 +152,9 @@ void sync_timeline_signal(struct sync_timeline *obj)
 			list_del_init(pos);
 			list_add(&pt->signaled_list, &signaled_pts);
 			kref_get(&pt->fence->kref);
+		} else if (obj->ops->ordered) {
+			/* everything behind an active pt is active too */
+			break;
 		}
 	}
 
@@ -222,10 +225,16 @@ static struct sync_pt *sync_pt_dup(struct sync_pt *pt)
 	return pt->parent->ops->dup(pt);
 }
 
-/* Adds a sync pt to the active queue.  Called when added to a fence */
+/*
+ * Adds a sync pt to the active queue.  Called when added to a fence.
+ * On ordered timelines the pt goes after every pt that signals no later
+ * than it; new pts are almost always the latest, so the walk from the
+ * tail ends right away.
+ */
 static void sync_pt_activate(struct sync_pt *pt)
 {
 	struct sync_timeline *obj = pt->parent;
+	struct list_head *pos;
 	unsigned long flags;
 	int err;
 
@@ -235,7 +244,18 @@ static void sync_pt_activate(struct sync_pt *pt)
 	if (err != 0)
 		goto out;
 
-	list_add_tail(&pt->active_list, &obj->active_list_head);
+	pos = obj->active_list_head.prev;
+	if (obj->ops->ordered) {
+		for (; pos != &obj->active_list_head; pos = pos->prev) {
+			struct sync_pt *prev =
+				container_of(pos, struct sync_pt, active_list);
+
+			if (obj->ops->compare(pt, prev) >= 0)
+				break;
+		}
+	}
+
+	list_add(&pt->active_list, pos);
 
 out:
 	spin_unlock_irqrestore(&obj->active_list_lock, flags);
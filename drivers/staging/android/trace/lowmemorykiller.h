@@ -9,9 +9,9 @@
 
 TRACE_EVENT(lowmemory_kill,
 	TP_PROTO(struct task_struct *killed_task, long cache_size, \
-		 long cache_limit, long free),
+		 long cache_limit, long free, int scanned, u64 scan_ns),
 
-	TP_ARGS(killed_task, cache_size, cache_limit, free),
+	TP_ARGS(killed_task, cache_size, cache_limit, free, scanned, scan_ns),
 
 	TP_STRUCT__entry(
 			__array(char, comm, TASK_COMM_LEN)
@@ -19,6 +19,8 @@ TRACE_EVENT(lowmemory_kill,
 			__field(long, pagecache_size)
 			__field(long, pagecache_limit)
 			__field(long, free)
+			__field(int, scanned)
+			__field(u64, scan_ns)
 	),
 
 	TP_fast_assign(
@@ -27,13 +29,42 @@ TRACE_EVENT(lowmemory_kill,
 			__entry->pagecache_size = cache_size;
 			__entry->pagecache_limit = cache_limit;
 			__entry->free = free;
+			__entry->scanned = scanned;
+			__entry->scan_ns = scan_ns;
 	),
 
-	TP_printk("%s (%d), page cache %ldkB (limit %ldkB), free %ldKb",
+	TP_printk("%s (%d), page cache %ldkB (limit %ldkB), free %ldKb, scanned %d in %lluns",
 		__entry->comm, __entry->pid, __entry->pagecache_size,
-		__entry->pagecache_limit, __entry->free)
+		__entry->pagecache_limit, __entry->free,
+		__entry->scanned, __entry->scan_ns)
 );
 
+TRACE_EVENT(lowmemory_reap,
+	TP_PROTO(struct task_struct *reaped_task, long freed,
+		 u64 kill_latency_ns, u64 pressure_latency_ns),
+
+	TP_ARGS(reaped_task, freed, kill_latency_ns, pressure_latency_ns),
+
+	TP_STRUCT__entry(
+			__array(char, comm, TASK_COMM_LEN)
+			__field(pid_t, pid)
+			__field(long, freed)
+			__field(u64, kill_latency_ns)
+			__field(u64, pressure_latency_ns)
+	),
+
+	TP_fast_assign(
+			memcpy(__entry->comm, reaped_task->comm, TASK_COMM_LEN);
+			__entry->pid = reaped_task->pid;
+			__entry->freed = freed;
+			__entry->kill_latency_ns = kill_latency_ns;
+			__entry->pressure_latency_ns = pressure_latency_ns;
+	),
+
+	TP_printk("%s (%d), freed %ldkB, %lluns after kill, %lluns after pressure",
+		__entry->comm, __entry->pid, __entry->freed,
+		__entry->kill_latency_ns, __entry->pressure_latency_ns)
+);
 
 #endif /* if !defined(_TRACE_LOWMEMORYKILLER_H) || defined(TRACE_HEADER_MULTI_READ) */
 
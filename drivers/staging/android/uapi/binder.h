@@ -34,6 +34,7 @@ enum {
 	BINDER_TYPE_FD		= B_PACK_CHARS('f', 'd', '*', B_TYPE_LARGE),
 	BINDER_TYPE_FDA		= B_PACK_CHARS('f', 'd', 'a', B_TYPE_LARGE),
 	BINDER_TYPE_PTR		= B_PACK_CHARS('p', 't', '*', B_TYPE_LARGE),
+	BINDER_TYPE_FD_MEM	= B_PACK_CHARS('f', 'd', 'm', B_TYPE_LARGE),
 };
 
 /**
@@ -212,6 +213,32 @@ struct binder_fd_array_object {
 	binder_size_t			parent_offset;
 };
 
+/* struct binder_fd_mem_object - large payload passed by shared memory
+ * @hdr:		common header structure
+ * @fd:			ashmem or dma-buf fd holding the payload; the driver
+ *			replaces it with the fd installed in the target
+ * @offset:		offset of the payload in @fd
+ * @length:		length of the payload
+ * @buffer:		set by the driver when the target reads the
+ *			transaction: the address of the payload mapped
+ *			read-only in the target, or 0 if it could not be
+ *			mapped
+ *
+ * Lets the sender hand over a large payload (camera metadata, bitmaps)
+ * without copying it into the transaction buffer. The target owns both
+ * the fd and the mapping and must munmap() and close() them when done.
+ * If @buffer is 0 the target falls back to mapping or reading @fd
+ * itself. Only worth it for payloads well above a page; small
+ * payloads are cheaper to copy.
+ */
+struct binder_fd_mem_object {
+	struct binder_object_header	hdr;
+	__u32				fd;
+	binder_size_t			offset;
+	binder_size_t			length;
+	binder_uintptr_t		buffer;
+};
+
 /*
  * On 64-bit platforms where user code may run in 32-bits the driver must
  * translate the buffer (and local binder) addresses appropriately.
@@ -272,6 +299,7 @@ struct binder_node_info_for_ref {
 #define BINDER_GET_NODE_INFO_FOR_REF	_IOWR('b', 12, struct binder_node_info_for_ref)
 #define BINDER_SET_CONTEXT_MGR_EXT	_IOW('b', 13, struct flat_binder_object)
 #define BINDER_SET_SYSTEM_SERVER_PID		_IOW('b', 14, __u32)
+#define BINDER_SET_ASYNC_BATCH		_IOW('b', 15, __u32)
 /*
  * NOTE: Two special error codes you should check for when calling
  * in to the driver are:
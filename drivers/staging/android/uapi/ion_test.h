@@ -35,6 +35,29 @@ struct ion_test_rw_data {
 	int __padding;
 };
 
+/**
+ * struct ion_test_alloc_latency - allocation latency measurement
+ * @len:		size of each allocation
+ * @heap_id_mask:	heaps to allocate from
+ * @flags:		allocation flags
+ * @iterations:		number of allocations to time
+ * @p50_ns:		returned median allocation latency
+ * @p90_ns:		returned 90th percentile
+ * @p99_ns:		returned 99th percentile
+ * @max_ns:		returned worst case
+ */
+struct ion_test_alloc_latency {
+	__u64 len;
+	__u32 heap_id_mask;
+	__u32 flags;
+	__u32 iterations;
+	__u32 __padding;
+	__u64 p50_ns;
+	__u64 p90_ns;
+	__u64 p99_ns;
+	__u64 max_ns;
+};
+
 #define ION_IOC_MAGIC		'I'
 
 /**
@@ -66,5 +89,15 @@ struct ion_test_rw_data {
 #define ION_IOC_TEST_KERNEL_MAPPING \
 			_IOW(ION_IOC_MAGIC, 0xf2, struct ion_test_rw_data)
 
+/**
+ * DOC: ION_IOC_TEST_ALLOC_LATENCY - time allocations from a heap
+ *
+ * Allocates and frees a buffer @iterations times from the kernel and
+ * returns latency percentiles of the allocations, e.g. to compare page
+ * pool changes. Only expected to be used for debugging and testing.
+ */
+#define ION_IOC_TEST_ALLOC_LATENCY \
+			_IOWR(ION_IOC_MAGIC, 0xf3, struct ion_test_alloc_latency)
+
 
 #endif /* _UAPI_LINUX_ION_H */
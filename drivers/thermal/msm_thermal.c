@@ -58,6 +58,7 @@
 #include <linux/delay.h>
 #endif
 #include <linux/msm-bus.h>
+#include <linux/msm_kgsl.h>
 
 #define CREATE_TRACE_POINTS
 #define TRACE_MSM_THERMAL
@@ -269,6 +270,7 @@ struct cpu_info {
 	uint32_t user_min_freq;
 	uint32_t limited_max_freq;
 	uint32_t limited_min_freq;
+	uint32_t pb_max_freq;
 	bool freq_thresh_clear;
 	struct cluster_info *parent_ptr;
 #ifdef CONFIG_SEC_AP_HEALTH
@@ -327,6 +329,7 @@ enum msm_thresh_list {
 	MSM_VDD_MX_RESTRICTION,
 	MSM_THERM_DDR_LM,
 	MSM_THERM_HW_SAMPLING,
+	MSM_POWER_BUDGET,
 	MSM_LIST_MAX_NR,
 };
 
@@ -1079,46 +1082,45 @@ void devmgr_unregister_mitigation_client(struct device *dev,
 		dev_mgr->update(dev_mgr);
 }
 
-static int  msm_thermal_cpufreq_callback(struct notifier_block *nfb,
-		unsigned long event, void *data)
+/*
+ * Cast the current mitigation of @cpu as its thermal frequency vote.  A
+ * synchronous cluster is mitigated as a whole, so vote for all its cpus.
+ */
+static void msm_thermal_cpufreq_vote(int cpu)
 {
-	struct cpufreq_policy *policy = data;
 	uint32_t max_freq_req, min_freq_req;
+	cpumask_t mask;
+	int i;
 
-	switch (event) {
-	case CPUFREQ_INCOMPATIBLE:
-		if (SYNC_CORE(policy->cpu)) {
-			max_freq_req =
-				cpus[policy->cpu].parent_ptr->limited_max_freq;
-			min_freq_req =
-				cpus[policy->cpu].parent_ptr->limited_min_freq;
-		} else {
-			max_freq_req = cpus[policy->cpu].limited_max_freq;
-			min_freq_req = cpus[policy->cpu].limited_min_freq;
-		}
-		pr_debug("mitigating CPU%d to freq max: %u min: %u\n",
-		policy->cpu, max_freq_req, min_freq_req);
+	cpumask_clear(&mask);
+	cpumask_set_cpu(cpu, &mask);
+	if (SYNC_CORE(cpu)) {
+		get_cluster_mask(cpu, &mask);
+		max_freq_req = cpus[cpu].parent_ptr->limited_max_freq;
+		min_freq_req = cpus[cpu].parent_ptr->limited_min_freq;
+	} else {
+		max_freq_req = cpus[cpu].limited_max_freq;
+		min_freq_req = cpus[cpu].limited_min_freq;
+	}
+	max_freq_req = min(max_freq_req, cpus[cpu].pb_max_freq);
+	pr_debug("mitigating CPU%d to freq max: %u min: %u\n",
+		cpu, max_freq_req, min_freq_req);
 
-		cpufreq_verify_within_limits(policy, min_freq_req,
-			max_freq_req);
+	if (max_freq_req < min_freq_req)
+		pr_err("Invalid frequency request Max:%u Min:%u\n",
+			max_freq_req, min_freq_req);
 
-		if (max_freq_req < min_freq_req)
-			pr_err("Invalid frequency request Max:%u Min:%u\n",
-				max_freq_req, min_freq_req);
-		break;
-	}
-	return NOTIFY_OK;
+	for_each_cpu(i, &mask)
+		cpufreq_constraint_set(CPUFREQ_CONSTRAINT_THERMAL, i,
+			min_freq_req, max_freq_req);
 }
 
-static struct notifier_block msm_thermal_cpufreq_notifier = {
-	.notifier_call = msm_thermal_cpufreq_callback,
-};
-
 static void update_cpu_freq(int cpu)
 {
-	int ret = 0;
 	cpumask_t mask;
 
+	/* Vote even when offline so the policy picks it up on the way up */
+	msm_thermal_cpufreq_vote(cpu);
 	get_cluster_mask(cpu, &mask);
 	if (cpu_online(cpu)) {
 		if ((cpumask_intersects(&mask, &throttling_mask))
@@ -1136,13 +1138,11 @@ static void update_cpu_freq(int cpu)
 		trace_thermal_pre_frequency_mit(cpu,
 			cpus[cpu].limited_max_freq,
 			cpus[cpu].limited_min_freq);
-		ret = cpufreq_update_policy(cpu);
+		/* Mitigation can't wait for the next batch */
+		cpufreq_constraint_update();
 		trace_thermal_post_frequency_mit(cpu,
 			cpufreq_quick_get_max(cpu),
 			cpus[cpu].limited_min_freq);
-		if (ret)
-			pr_err("Unable to update policy for cpu:%d. err:%d\n",
-				cpu, ret);
 	}
 }
 
@@ -3778,11 +3778,348 @@ exit:
 	return ret;
 }
 
+/*
+ * Power budget mitigation. Rather than stepping the frequency down above
+ * a threshold and back up below it, predict the temperature from its
+ * slope, derive the power the device can sustain from that and split it
+ * between the CPU clusters and the GPU in proportion to their demand,
+ * using the per-OPP power tables from devicetree.
+ */
+#define PB_EVENT_WIN_MIN	1
+#define PB_EVENT_WIN_MAX	8
+#define PB_EVENT_FAST_MS	2000
+#define PB_EVENT_SLOW_MS	30000
+
+struct pb_opp {
+	uint32_t freq;
+	uint32_t power;
+};
+
+struct pb_actor {
+	const char *name;
+	cpumask_t cpus;
+	bool is_gpu;
+	struct pb_opp *opp;
+	int opp_cnt;
+	uint32_t req_power;
+	uint32_t granted_power;
+	uint32_t max_freq;
+};
+
+struct pb_data {
+	bool enabled;
+	uint32_t sensor_id;
+	uint32_t poll_ms;
+	int32_t control_temp_degC;
+	int32_t window_degC;
+	uint32_t horizon_ms;
+	uint32_t sustainable_power;
+	uint32_t k_p;
+	uint32_t k_i;
+	int64_t integral;
+	long prev_temp_mdegC;
+	long slope;
+	ktime_t prev_ts;
+	bool released;
+	bool event_driven;
+	bool armed;
+	int32_t event_win_degC;
+	ktime_t armed_ts;
+	struct pb_actor *actors;
+	int actor_cnt;
+	void *gpu_limit;
+	struct delayed_work work;
+};
+
+static struct pb_data pb;
+static bool power_budget = true;
+
+static int set_power_budget(const char *val, const struct kernel_param *kp)
+{
+	int ret = param_set_bool(val, kp);
+
+	if (!ret && pb.enabled)
+		mod_delayed_work(system_wq, &pb.work, 0);
+	return ret;
+}
+
+static struct kernel_param_ops power_budget_ops = {
+	.set = set_power_budget,
+	.get = param_get_bool,
+};
+module_param_cb(power_budget, &power_budget_ops, &power_budget, 0644);
+
+static uint32_t pb_max_power(struct pb_actor *actor)
+{
+	return actor->opp[actor->opp_cnt - 1].power;
+}
+
+/* Power drawn at @freq, rounding up to the next OPP */
+static uint32_t pb_freq_to_power(struct pb_actor *actor, uint32_t freq)
+{
+	int i;
+
+	for (i = 0; i < actor->opp_cnt - 1; i++) {
+		if (actor->opp[i].freq >= freq)
+			break;
+	}
+	return actor->opp[i].power;
+}
+
+/* Highest OPP that fits in @power, never below the lowest one */
+static uint32_t pb_power_to_freq(struct pb_actor *actor, uint32_t power)
+{
+	int i;
+
+	for (i = actor->opp_cnt - 1; i > 0; i--) {
+		if (actor->opp[i].power <= power)
+			break;
+	}
+	return actor->opp[i].freq;
+}
+
+static uint32_t pb_get_req_power(struct pb_actor *actor)
+{
+	uint32_t cpu, freq = 0, online = 0;
+
+	if (actor->is_gpu) {
+#ifdef CONFIG_MSM_KGSL
+		freq = kgsl_pwr_get_cur_freq(KGSL_DEVICE_3D0);
+#endif
+		return freq ? pb_freq_to_power(actor, freq) : 0;
+	}
+
+	for_each_cpu(cpu, &actor->cpus) {
+		if (!cpu_online(cpu))
+			continue;
+		if (!online++)
+			freq = cpufreq_quick_get(cpu);
+	}
+	if (!online || !freq)
+		return 0;
+
+	/* The table is for the whole cluster running */
+	return pb_freq_to_power(actor, freq) * online /
+		cpumask_weight(&actor->cpus);
+}
+
+/*
+ * Grant every actor a share of @budget proportional to its demand, then
+ * hand out what is left over to the actors that can use more.
+ */
+static void pb_divvy_up_power(uint32_t budget)
+{
+	uint64_t total_req = 0, headroom = 0, extra = 0, share;
+	struct pb_actor *actor;
+	int i;
+
+	for (i = 0; i < pb.actor_cnt; i++)
+		total_req += pb.actors[i].req_power;
+
+	for (i = 0; i < pb.actor_cnt; i++) {
+		actor = &pb.actors[i];
+		if (total_req)
+			share = div64_u64((uint64_t)budget * actor->req_power,
+					total_req);
+		else
+			share = budget / pb.actor_cnt;
+		if (share > pb_max_power(actor)) {
+			extra += share - pb_max_power(actor);
+			share = pb_max_power(actor);
+		}
+		actor->granted_power = share;
+		headroom += pb_max_power(actor) - share;
+	}
+
+	if (!extra || !headroom)
+		return;
+
+	for (i = 0; i < pb.actor_cnt; i++) {
+		actor = &pb.actors[i];
+		share = div64_u64(extra * (pb_max_power(actor) -
+				actor->granted_power), headroom);
+		actor->granted_power += min_t(uint64_t, share,
+				pb_max_power(actor) - actor->granted_power);
+	}
+}
+
+static void pb_apply_limit(struct pb_actor *actor, uint32_t max_freq)
+{
+	uint32_t cpu;
+
+	if (actor->max_freq == max_freq)
+		return;
+	actor->max_freq = max_freq;
+
+	if (actor->is_gpu) {
+#ifdef CONFIG_MSM_KGSL
+		if (!pb.gpu_limit)
+			pb.gpu_limit = kgsl_pwr_limits_add(KGSL_DEVICE_3D0);
+		if (IS_ERR_OR_NULL(pb.gpu_limit)) {
+			pb.gpu_limit = NULL;
+			actor->max_freq = UINT_MAX;
+			return;
+		}
+		if (max_freq == UINT_MAX)
+			kgsl_pwr_limits_set_default(pb.gpu_limit);
+		else
+			kgsl_pwr_limits_set_freq(pb.gpu_limit, max_freq);
+#endif
+		return;
+	}
+
+	get_online_cpus();
+	for_each_cpu(cpu, &actor->cpus) {
+		cpus[cpu].pb_max_freq = max_freq;
+		msm_thermal_cpufreq_vote(cpu);
+	}
+	put_online_cpus();
+}
+
+static void pb_release(void)
+{
+	int i;
+
+	pb.integral = 0;
+	if (pb.released)
+		return;
+
+	for (i = 0; i < pb.actor_cnt; i++)
+		pb_apply_limit(&pb.actors[i], UINT_MAX);
+	pb.released = true;
+	pr_debug("power budget released\n");
+}
+
+static void pb_threshold_notify(struct therm_threshold *thresh_data)
+{
+	if (pb.armed)
+		mod_delayed_work(system_wq, &pb.work, 0);
+}
+
+/*
+ * Once the KTM threshold monitor runs, stop polling while the budget is
+ * released and wait for the temperature to leave a window around its
+ * current value instead. The window widens when it is left quickly and
+ * narrows back when it holds, and never reaches past the engage point.
+ */
+static bool pb_arm_thresholds(long temp)
+{
+	struct therm_threshold *th = thresh[MSM_POWER_BUDGET].thresh_list;
+	long engage = pb.control_temp_degC - pb.window_degC;
+	int64_t held_ms;
+	int ret;
+
+	if (!pb.event_driven || temp + 1 > engage)
+		return false;
+
+	if (pb.armed) {
+		held_ms = ktime_to_ms(ktime_sub(ktime_get(), pb.armed_ts));
+		if (held_ms < PB_EVENT_FAST_MS)
+			pb.event_win_degC = min(pb.event_win_degC * 2,
+						PB_EVENT_WIN_MAX);
+		else if (held_ms > PB_EVENT_SLOW_MS)
+			pb.event_win_degC = max(pb.event_win_degC / 2,
+						PB_EVENT_WIN_MIN);
+	}
+
+	th->threshold[0].temp = min(temp + pb.event_win_degC, engage) *
+				tsens_scaling_factor;
+	th->threshold[1].temp = (temp - pb.event_win_degC) *
+				tsens_scaling_factor;
+	th->trip_triggered = -1;
+	ret = sensor_mgr_set_threshold(th->sensor_id, th->threshold);
+	if (ret < 0 || !IS_HI_THRESHOLD_SET(ret)) {
+		pb.armed = false;
+		return false;
+	}
+
+	pb.armed = true;
+	pb.armed_ts = ktime_get();
+	pr_debug("waiting for temp to leave %ld..%ld degC\n",
+		temp - pb.event_win_degC,
+		min(temp + pb.event_win_degC, engage));
+	return true;
+}
+
+static void do_power_budget(struct work_struct *work)
+{
+	int64_t budget, err, max_budget = 0;
+	long temp = 0, temp_mdegC, predicted;
+	struct pb_actor *actor;
+	ktime_t now;
+	int64_t dt_ms;
+	int i;
+
+	if (!power_budget) {
+		pb.armed = false;
+		pb_release();
+		return;
+	}
+
+	if (therm_get_temp(pb.sensor_id, THERM_TSENS_ID, &temp)) {
+		pr_err("Unable to read TSENS sensor:%d\n", pb.sensor_id);
+		goto reschedule;
+	}
+
+	now = ktime_get();
+	temp_mdegC = temp * 1000;
+	dt_ms = ktime_to_ms(ktime_sub(now, pb.prev_ts));
+	if (pb.prev_ts.tv64 && dt_ms > 0)
+		pb.slope = (3 * pb.slope + div64_s64((int64_t)(temp_mdegC -
+				pb.prev_temp_mdegC) * MSEC_PER_SEC, dt_ms)) / 4;
+	pb.prev_ts = now;
+	pb.prev_temp_mdegC = temp_mdegC;
+
+	predicted = temp_mdegC + pb.slope * (long)pb.horizon_ms /
+			(long)MSEC_PER_SEC;
+	if (predicted < (pb.control_temp_degC - pb.window_degC) * 1000) {
+		pb_release();
+		if (pb_arm_thresholds(temp))
+			return;
+		goto reschedule;
+	}
+	pb.armed = false;
+
+	for (i = 0; i < pb.actor_cnt; i++) {
+		pb.actors[i].req_power = pb_get_req_power(&pb.actors[i]);
+		max_budget += pb_max_power(&pb.actors[i]);
+	}
+
+	err = (int64_t)pb.control_temp_degC * 1000 - predicted;
+	pb.integral += div64_s64(err * pb.k_i, 1000);
+	pb.integral = clamp_t(int64_t, pb.integral,
+			-(int64_t)pb.sustainable_power,
+			(int64_t)pb.sustainable_power);
+	budget = pb.sustainable_power + div64_s64(err * pb.k_p, 1000) +
+			pb.integral;
+	budget = clamp_t(int64_t, budget, 0, max_budget);
+
+	pb_divvy_up_power(budget);
+	for (i = 0; i < pb.actor_cnt; i++) {
+		actor = &pb.actors[i];
+		pb_apply_limit(actor, actor->granted_power >=
+			pb_max_power(actor) ? UINT_MAX :
+			pb_power_to_freq(actor, actor->granted_power));
+		pr_debug("%s: req:%umW granted:%umW max_freq:%u\n",
+			actor->name, actor->req_power,
+			actor->granted_power, actor->max_freq);
+	}
+	pb.released = false;
+	pr_debug("temp:%ld predicted:%ld mdegC slope:%ld mdegC/s budget:%lldmW\n",
+		temp, predicted, pb.slope, budget);
+
+reschedule:
+	schedule_delayed_work(&pb.work, msecs_to_jiffies(pb.poll_ms));
+}
+
 static void do_freq_control(long temp)
 {
 	uint32_t cpu = 0;
 	uint32_t max_freq = cpus[cpu].limited_max_freq;
 
+	/* The power budget controller owns the thermal frequency limits */
+	if (pb.enabled)
+		return;
 	if (core_ptr)
 		return do_cluster_freq_ctrl(temp);
 	if (!freq_table_get)
@@ -4376,12 +4713,14 @@ int msm_thermal_set_cluster_freq(uint32_t cluster, uint32_t freq, bool is_max)
 				if (freq >= cluster_ptr->freq_table[cluster_ptr->freq_idx_high].frequency) {
 					for_each_cpu_mask(i, cluster_ptr->cluster_cores) {
 						cpus[i].mitigation_by_engine = false;
-					}
+					
+}
 				}
 				else
 					for_each_cpu_mask(i, cluster_ptr->cluster_cores) {
 						cpus[i].mitigation_by_engine = true;
-					}
+					
+}
 			}
 #endif
 			pr_debug("Update Cluster%d %s frequency to %d\n",
@@ -4905,6 +5244,12 @@ static void thermal_monitor_init(void)
 			therm_ddr_lm_apply_limit(true);
 	}
 
+	/* Let the power budget controller sleep on thresholds when cool */
+	if (pb.enabled && !(convert_to_zone_id(&thresh[MSM_POWER_BUDGET]))) {
+		pb.event_driven = true;
+		mod_delayed_work(system_wq, &pb.work, 0);
+	}
+
 	if (tsens_sampling && tsens_sampling->enabled &&
 		!(convert_to_zone_id(&thresh[MSM_THERM_HW_SAMPLING]))) {
 		thresh[MSM_THERM_HW_SAMPLING].thresh_list->trip_triggered = -1;
@@ -5607,12 +5952,15 @@ static void msm_thermal_init_cpu_mit(enum cpu_mit_type cpu_mit)
 int msm_thermal_init(struct msm_thermal_data *pdata)
 {
 	int ret = 0;
+	uint32_t cpu;
 
 	ret = devmgr_devices_init(pdata->pdev);
 	if (ret)
 		pr_err("cannot initialize devm devices. err:%d\n", ret);
 
 	msm_thermal_init_cpu_mit(CPU_FREQ_MITIGATION | CPU_HOTPLUG_MITIGATION);
+	for_each_possible_cpu(cpu)
+		cpus[cpu].pb_max_freq = UINT_MAX;
 	BUG_ON(!pdata);
 	memcpy(&msm_thermal_info, pdata, sizeof(struct msm_thermal_data));
 
@@ -5624,16 +5972,13 @@ int msm_thermal_init(struct msm_thermal_data *pdata)
 
 	enabled = 1;
 	polling_enabled = 1;
-	ret = cpufreq_register_notifier(&msm_thermal_cpufreq_notifier,
-			CPUFREQ_POLICY_NOTIFIER);
-	if (ret)
-		pr_err("cannot register cpufreq notifier. err:%d\n", ret);
-
 	register_reboot_notifier(&msm_thermal_reboot_notifier);
 	pm_notifier(msm_thermal_suspend_callback, 0);
 	INIT_DELAYED_WORK(&retry_hotplug_work, retry_hotplug);
 	INIT_DELAYED_WORK(&check_temp_work, check_temp);
 	schedule_delayed_work(&check_temp_work, 0);
+	if (pb.enabled)
+		schedule_delayed_work(&pb.work, 0);
 
 	if (num_possible_cpus() > 1) {
 		cpus_previously_online_update();
@@ -7373,6 +7718,197 @@ PROBE_RESET_EXIT:
 	return ret;
 }
 
+static int pb_read_opp_table(struct device *dev, struct device_node *node,
+		char *key, int stride, uint32_t **buf)
+{
+	int len = 0;
+
+	if (!of_get_property(node, key, &len) || !len)
+		return -ENODEV;
+	len /= sizeof(uint32_t);
+	if (len % stride)
+		return -EINVAL;
+
+	*buf = devm_kzalloc(dev, len * sizeof(uint32_t), GFP_KERNEL);
+	if (!*buf)
+		return -ENOMEM;
+
+	return of_property_read_u32_array(node, key, *buf, len) ? : len;
+}
+
+static int pb_add_actor(struct device *dev, struct pb_actor *actor,
+		uint32_t *entries, int cnt, int stride)
+{
+	int i;
+
+	actor->opp = devm_kzalloc(dev, cnt * sizeof(struct pb_opp),
+				GFP_KERNEL);
+	if (!actor->opp)
+		return -ENOMEM;
+
+	for (i = 0; i < cnt; i++) {
+		actor->opp[i].freq = entries[i * stride + stride - 2];
+		actor->opp[i].power = entries[i * stride + stride - 1];
+		if (i && (actor->opp[i].freq <= actor->opp[i - 1].freq ||
+			actor->opp[i].power < actor->opp[i - 1].power)) {
+			pr_err("%s power table is not in ascending order\n",
+				actor->name);
+			return -EINVAL;
+		}
+	}
+	actor->opp_cnt = cnt;
+	actor->max_freq = UINT_MAX;
+	return 0;
+}
+
+/*
+ * qcom,pb-cpu-power holds <cpu freq_khz power_mw> triplets, cpu being any
+ * cpu of the cluster, and qcom,pb-gpu-power <freq_hz power_mw> pairs.
+ * Powers are those of the whole cluster or GPU at full load.
+ */
+static int probe_power_budget(struct device_node *node,
+		struct msm_thermal_data *data,
+		struct platform_device *pdev)
+{
+	char *key = NULL;
+	uint32_t *cpu_tbl = NULL, *gpu_tbl = NULL, cpu, val;
+	int ret = 0, cpu_len, gpu_len = 0, i, j, cnt;
+	struct pb_actor *actor;
+	cpumask_t done, mask;
+
+	key = "qcom,pb-control-temp";
+	ret = of_property_read_u32(node, key, &pb.control_temp_degC);
+	if (ret)
+		goto PROBE_PB_EXIT;
+
+	key = "qcom,pb-sustainable-power";
+	ret = of_property_read_u32(node, key, &pb.sustainable_power);
+	if (ret)
+		goto PROBE_PB_EXIT;
+
+	key = "qcom,pb-cpu-power";
+	cpu_len = pb_read_opp_table(&pdev->dev, node, key, 3, &cpu_tbl);
+	if (cpu_len < 0) {
+		ret = cpu_len;
+		goto PROBE_PB_EXIT;
+	}
+
+	key = "qcom,pb-gpu-power";
+	if (of_find_property(node, key, NULL)) {
+		gpu_len = pb_read_opp_table(&pdev->dev, node, key, 2,
+					&gpu_tbl);
+		if (gpu_len < 0) {
+			ret = gpu_len;
+			goto PROBE_PB_EXIT;
+		}
+	}
+
+	pb.sensor_id = data->sensor_id;
+	key = "qcom,pb-sensor-id";
+	if (!of_property_read_u32(node, key, &val))
+		pb.sensor_id = val;
+	pb.poll_ms = data->poll_ms;
+	key = "qcom,pb-poll-ms";
+	if (!of_property_read_u32(node, key, &val) && val)
+		pb.poll_ms = val;
+	pb.window_degC = 10;
+	key = "qcom,pb-window";
+	if (!of_property_read_u32(node, key, &val) && val)
+		pb.window_degC = val;
+	pb.horizon_ms = 2000;
+	key = "qcom,pb-horizon-ms";
+	of_property_read_u32(node, key, &pb.horizon_ms);
+	pb.k_p = 2 * pb.sustainable_power / pb.window_degC;
+	key = "qcom,pb-k-p";
+	of_property_read_u32(node, key, &pb.k_p);
+	pb.k_i = max_t(uint32_t, pb.k_p / 20, 1);
+	key = "qcom,pb-k-i";
+	of_property_read_u32(node, key, &pb.k_i);
+
+	/* One actor per cluster found in the cpu table, plus the GPU */
+	cpumask_clear(&done);
+	for (i = 0; i < cpu_len; i += 3) {
+		if (cpu_tbl[i] >= num_possible_cpus()) {
+			ret = -EINVAL;
+			goto PROBE_PB_EXIT;
+		}
+		cpumask_clear(&mask);
+		get_cluster_mask(cpu_tbl[i], &mask);
+		if (!cpumask_intersects(&done, &mask))
+			pb.actor_cnt++;
+		cpumask_or(&done, &done, &mask);
+	}
+	if (gpu_len)
+		pb.actor_cnt++;
+
+	key = "qcom,pb-cpu-power";
+	pb.actors = devm_kzalloc(&pdev->dev,
+			pb.actor_cnt * sizeof(struct pb_actor), GFP_KERNEL);
+	if (!pb.actors) {
+		ret = -ENOMEM;
+		goto PROBE_PB_EXIT;
+	}
+
+	cpumask_clear(&done);
+	actor = pb.actors;
+	for (i = 0; i < cpu_len; i += 3 * cnt) {
+		cpumask_clear(&mask);
+		get_cluster_mask(cpu_tbl[i], &mask);
+		if (cpumask_intersects(&done, &mask)) {
+			pr_err("power table of cpu%u is not contiguous\n",
+				cpu_tbl[i]);
+			ret = -EINVAL;
+			goto PROBE_PB_EXIT;
+		}
+		for (cnt = 1, j = i + 3; j < cpu_len; j += 3, cnt++) {
+			cpu = cpu_tbl[j];
+			if (!cpumask_test_cpu(cpu, &mask))
+				break;
+		}
+		cpumask_copy(&actor->cpus, &mask);
+		cpumask_or(&done, &done, &mask);
+		actor->name = devm_kasprintf(&pdev->dev, GFP_KERNEL,
+				"cpu%u", cpu_tbl[i]);
+		ret = actor->name ? pb_add_actor(&pdev->dev, actor,
+				&cpu_tbl[i], cnt, 3) : -ENOMEM;
+		if (ret)
+			goto PROBE_PB_EXIT;
+		actor++;
+	}
+
+	if (gpu_len) {
+		key = "qcom,pb-gpu-power";
+		actor->name = "gpu";
+		actor->is_gpu = true;
+		ret = pb_add_actor(&pdev->dev, actor, gpu_tbl, gpu_len / 2, 2);
+		if (ret)
+			goto PROBE_PB_EXIT;
+	}
+
+	key = "qcom,pb-control-temp";
+	ret = sensor_mgr_init_threshold(&thresh[MSM_POWER_BUDGET],
+		pb.sensor_id, pb.control_temp_degC - pb.window_degC,
+		pb.control_temp_degC - pb.window_degC - PB_EVENT_WIN_MIN,
+		pb_threshold_notify);
+	if (ret)
+		goto PROBE_PB_EXIT;
+
+	INIT_DELAYED_WORK(&pb.work, do_power_budget);
+	pb.event_win_degC = PB_EVENT_WIN_MIN;
+	pb.released = true;
+	pb.enabled = true;
+
+PROBE_PB_EXIT:
+	if (ret) {
+		dev_info(&pdev->dev,
+		"%s:Failed reading node=%s, key=%s. err=%d. KTM continues\n",
+			__func__, node->full_name, key, ret);
+		pb.actor_cnt = 0;
+		pb.enabled = false;
+	}
+	return ret;
+}
+
 static int probe_freq_mitigation(struct device_node *node,
 		struct msm_thermal_data *data,
 		struct platform_device *pdev)
@@ -7838,6 +8374,7 @@ static int msm_thermal_dev_probe(struct platform_device *pdev)
 	ret = probe_ocr(node, &data, pdev);
 
 	ret = probe_therm_dynamic_hw_sampling(node, &data, pdev);
+	ret = probe_power_budget(node, &data, pdev);
 	ret = fetch_cpu_mitigaiton_info(&data, pdev);
 	if (ret) {
 		pr_err("Error fetching CPU mitigation information. err:%d\n",
@@ -7892,6 +8429,15 @@ static int msm_thermal_dev_exit(struct platform_device *inp_dev)
 
 	uio_unregister_device(info);
 	unregister_reboot_notifier(&msm_thermal_reboot_notifier);
+	if (pb.enabled) {
+		pb.armed = false;
+		cancel_delayed_work_sync(&pb.work);
+		sensor_mgr_remove_threshold(&thresh[MSM_POWER_BUDGET]);
+		pb_release();
+#ifdef CONFIG_MSM_KGSL
+		kgsl_pwr_limits_del(pb.gpu_limit);
+#endif
+	}
 	if (msm_therm_debugfs && msm_therm_debugfs->parent)
 		debugfs_remove_recursive(msm_therm_debugfs->parent);
 	msm_thermal_ioctl_cleanup();
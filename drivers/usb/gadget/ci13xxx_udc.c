@@ -1870,6 +1870,208 @@ out:
 
 }
 
+/**
+ * _req_unmap: releases the DMA mapping of a request
+ * @mEp:  endpoint
+ * @mReq: request
+ */
+static void _req_unmap(struct ci13xxx_ep *mEp, struct ci13xxx_req *mReq)
+{
+	enum dma_data_direction dir = mEp->dir ? DMA_TO_DEVICE :
+						 DMA_FROM_DEVICE;
+
+	if (!mReq->map)
+		return;
+
+	if (mReq->req.num_sgs) {
+		dma_unmap_sg(mEp->device, mReq->req.sg, mReq->req.num_sgs,
+			     dir);
+		mReq->req.num_mapped_sgs = 0;
+	} else {
+		dma_unmap_single(mEp->device, mReq->req.dma,
+				 mReq->req.length, dir);
+		mReq->req.dma = DMA_ERROR_CODE;
+	}
+	mReq->map = 0;
+}
+
+/**
+ * _req_free_tds: frees the extra dTDs of a multi-dTD request
+ * @mEp:  endpoint
+ * @mReq: request
+ *
+ * Like mReq->ptr the extra dTDs stay with the request after completion,
+ * as the controller may still read the last one, and are only released
+ * when the request is queued again or freed.
+ */
+static void _req_free_tds(struct ci13xxx_ep *mEp, struct ci13xxx_req *mReq)
+{
+	unsigned i;
+
+	if (!mReq->tds)
+		return;
+
+	for (i = 1; i < mReq->ntds; i++)
+		dma_pool_free(mEp->td_pool, mReq->tds[i].ptr,
+			      mReq->tds[i].dma);
+	kfree(mReq->tds);
+	mReq->tds  = NULL;
+	mReq->ntds = 0;
+}
+
+/**
+ * _req_last_td: returns the dTD the next request gets linked behind
+ * @mReq: request
+ */
+static struct ci13xxx_td *_req_last_td(struct ci13xxx_req *mReq)
+{
+	if (mReq->zptr)
+		return mReq->zptr;
+	if (mReq->ntds)
+		return mReq->tds[mReq->ntds - 1].ptr;
+	return mReq->ptr;
+}
+
+/**
+ * _req_active_td: finds the first dTD of a request not yet retired
+ * @mReq: request
+ * @dma:  DMA address of that dTD
+ *
+ * This function returns true if the request still has an active dTD
+ */
+static bool _req_active_td(struct ci13xxx_req *mReq, dma_addr_t *dma)
+{
+	unsigned i;
+
+	if (TD_STATUS_ACTIVE & mReq->ptr->token) {
+		*dma = mReq->dma;
+		return true;
+	}
+	for (i = 1; i < mReq->ntds; i++) {
+		if (TD_STATUS_ACTIVE & mReq->tds[i].ptr->token) {
+			*dma = mReq->tds[i].dma;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * _td_fill: sets up a dTD for a physically contiguous chunk
+ * @td:  transfer descriptor
+ * @dma: DMA address of the chunk
+ * @len: chunk length, see _td_chunk()
+ */
+static void _td_fill(struct ci13xxx_td *td, dma_addr_t dma, unsigned len)
+{
+	unsigned i;
+
+	memset(td, 0, sizeof(*td));
+	td->token    = len << ffs_nr(TD_TOTAL_BYTES);
+	td->token   &= TD_TOTAL_BYTES;
+	td->token   |= TD_STATUS_ACTIVE;
+	td->next     = TD_TERMINATE;
+	td->page[0]  = dma;
+	for (i = 1; i < 5; i++)
+		td->page[i] = (dma + i * CI13XXX_PAGE_SIZE) &
+							~TD_RESERVED_MASK;
+}
+
+/**
+ * _td_chunk: returns how much of a segment the next dTD can carry
+ * @dma:  DMA address of the remaining segment
+ * @len:  remaining segment length
+ * @maxp: endpoint max packet size
+ *
+ * A dTD covers five pages from its (unaligned) start.  Every dTD but the
+ * last ends on a packet boundary, as the controller finishes a dTD with a
+ * short packet.
+ */
+static unsigned _td_chunk(dma_addr_t dma, unsigned len, unsigned maxp)
+{
+	unsigned max = 5 * CI13XXX_PAGE_SIZE - (dma & TD_RESERVED_MASK);
+
+	if (len <= max)
+		return len;
+	return rounddown(max, maxp);
+}
+
+/**
+ * _hardware_build_tds: sets up a request as a chain of dTDs
+ * @mEp:  endpoint
+ * @mReq: request, mapped and with no SPS mode
+ *
+ * Used for scatter-gather requests and bulk requests that don't fit a
+ * single dTD.  Only the last dTD of the chain interrupts on completion.
+ * This function returns an error code
+ */
+static int _hardware_build_tds(struct ci13xxx_ep *mEp,
+			       struct ci13xxx_req *mReq)
+{
+	struct usb_request *req = &mReq->req;
+	unsigned maxp = mEp->ep.maxpacket;
+	unsigned nsegs = req->num_sgs ? req->num_mapped_sgs : 1;
+	struct scatterlist *sg = req->sg;
+	struct ci13xxx_td *last;
+	unsigned ntds = 0, i, n, len, c;
+	dma_addr_t dma;
+
+	/* size the chain */
+	for (i = 0; i < nsegs; i++) {
+		dma = req->num_sgs ? sg_dma_address(sg) : req->dma;
+		len = req->num_sgs ? sg_dma_len(sg) : req->length;
+		if (i + 1 < nsegs && len % maxp)
+			return -EINVAL;
+		for (; len; ntds++, dma += c, len -= c)
+			c = _td_chunk(dma, len, maxp);
+		if (req->num_sgs)
+			sg = sg_next(sg);
+	}
+	if (!ntds)
+		ntds = 1;
+
+	mReq->tds = kcalloc(ntds, sizeof(*mReq->tds), GFP_ATOMIC);
+	if (!mReq->tds)
+		return -ENOMEM;
+	mReq->tds[0].ptr = mReq->ptr;
+	mReq->tds[0].dma = mReq->dma;
+	for (mReq->ntds = 1; mReq->ntds < ntds; mReq->ntds++) {
+		struct ci13xxx_td_ext *td = &mReq->tds[mReq->ntds];
+
+		td->ptr = dma_pool_alloc(mEp->td_pool, GFP_ATOMIC, &td->dma);
+		if (!td->ptr) {
+			_req_free_tds(mEp, mReq);
+			return -ENOMEM;
+		}
+	}
+
+	/* fill it in, an empty request still gets one dTD */
+	_td_fill(mReq->ptr, 0, 0);
+	sg = req->sg;
+	for (i = 0, n = 0; i < nsegs; i++) {
+		dma = req->num_sgs ? sg_dma_address(sg) : req->dma;
+		len = req->num_sgs ? sg_dma_len(sg) : req->length;
+		for (; len; n++, dma += c, len -= c) {
+			c = _td_chunk(dma, len, maxp);
+			_td_fill(mReq->tds[n].ptr, dma, c);
+			mReq->tds[n].len = c;
+			if (n)
+				mReq->tds[n - 1].ptr->next =
+					mReq->tds[n].dma & TD_ADDR_MASK;
+		}
+		if (req->num_sgs)
+			sg = sg_next(sg);
+	}
+
+	last = mReq->tds[ntds - 1].ptr;
+	if (mReq->zptr)
+		last->next = mReq->zdma;
+	else if (!req->no_interrupt)
+		last->token |= TD_IOC;
+
+	return 0;
+}
+
 /**
  * _hardware_queue: configures a request at hardware level
  * @gadget: gadget
@@ -1891,7 +2093,16 @@ static int _hardware_enqueue(struct ci13xxx_ep *mEp, struct ci13xxx_req *mReq)
 		return -EALREADY;
 
 	mReq->req.status = -EALREADY;
-	if (length && mReq->req.dma == DMA_ERROR_CODE) {
+	_req_free_tds(mEp, mReq);
+	if (mReq->req.num_sgs) {
+		mReq->req.num_mapped_sgs = dma_map_sg(mEp->device,
+				mReq->req.sg, mReq->req.num_sgs,
+				mEp->dir ? DMA_TO_DEVICE : DMA_FROM_DEVICE);
+		if (!mReq->req.num_mapped_sgs)
+			return -ENOMEM;
+
+		mReq->map = 1;
+	} else if (length && mReq->req.dma == DMA_ERROR_CODE) {
 		mReq->req.dma = \
 			dma_map_single(mEp->device, mReq->req.buf,
 				       length, mEp->dir ? DMA_TO_DEVICE :
@@ -1906,13 +2117,7 @@ static int _hardware_enqueue(struct ci13xxx_ep *mEp, struct ci13xxx_req *mReq)
 		mReq->zptr = dma_pool_alloc(mEp->td_pool, GFP_ATOMIC,
 					   &mReq->zdma);
 		if (mReq->zptr == NULL) {
-			if (mReq->map) {
-				dma_unmap_single(mEp->device, mReq->req.dma,
-					length, mEp->dir ? DMA_TO_DEVICE :
-					DMA_FROM_DEVICE);
-				mReq->req.dma = DMA_ERROR_CODE;
-				mReq->map     = 0;
-			}
+			_req_unmap(mEp, mReq);
 			return -ENOMEM;
 		}
 		memset(mReq->zptr, 0, sizeof(*mReq->zptr));
@@ -1924,8 +2129,22 @@ static int _hardware_enqueue(struct ci13xxx_ep *mEp, struct ci13xxx_req *mReq)
 
 	/*
 	 * TD configuration
-	 * TODO - handle requests which spawns into several TDs
 	 */
+	if (mReq->req.num_sgs || length > (4 * CI13XXX_PAGE_SIZE)) {
+		ret = _hardware_build_tds(mEp, mReq);
+		if (ret) {
+			if (mReq->zptr) {
+				dma_pool_free(mEp->td_pool, mReq->zptr,
+					      mReq->zdma);
+				mReq->zptr = NULL;
+			}
+			_req_unmap(mEp, mReq);
+			mReq->req.status = ret;
+			return ret;
+		}
+		goto td_done;
+	}
+
 	memset(mReq->ptr, 0, sizeof(*mReq->ptr));
 	mReq->ptr->token    = length << ffs_nr(TD_TOTAL_BYTES);
 	mReq->ptr->token   &= TD_TOTAL_BYTES;
@@ -1959,6 +2178,7 @@ static int _hardware_enqueue(struct ci13xxx_ep *mEp, struct ci13xxx_req *mReq)
 	for (i = 1; i < 5; i++)
 		mReq->ptr->page[i] = (mReq->req.dma + i * CI13XXX_PAGE_SIZE) &
 							~TD_RESERVED_MASK;
+td_done:
 	wmb();
 
 	/* Remote Wakeup */
@@ -1986,10 +2206,7 @@ static int _hardware_enqueue(struct ci13xxx_ep *mEp, struct ci13xxx_req *mReq)
 
 		mReqPrev = list_entry(mEp->qh.queue.prev,
 				struct ci13xxx_req, queue);
-		if (mReqPrev->zptr)
-			mReqPrev->zptr->next = mReq->dma & TD_ADDR_MASK;
-		else
-			mReqPrev->ptr->next = mReq->dma & TD_ADDR_MASK;
+		_req_last_td(mReqPrev)->next = mReq->dma & TD_ADDR_MASK;
 		wmb();
 		if (hw_cread(CAP_ENDPTPRIME, BIT(n)))
 			goto done;
@@ -2015,7 +2232,8 @@ static int _hardware_enqueue(struct ci13xxx_ep *mEp, struct ci13xxx_req *mReq)
 
 	/* Hardware may leave few TDs unprocessed, check and reprime with 1st */
 	if (!list_empty(&mEp->qh.queue)) {
-		struct ci13xxx_req *mReq_active, *mReq_next;
+		struct ci13xxx_req *mReq_next;
+		dma_addr_t active_dma = mReq->dma;
 		u32 i = 0;
 
 		/* Nothing to be done if hardware already finished this TD */
@@ -2023,12 +2241,10 @@ static int _hardware_enqueue(struct ci13xxx_ep *mEp, struct ci13xxx_req *mReq)
 			goto done;
 
 		/* Iterate forward to find first TD with ACTIVE bit set */
-		mReq_active = mReq;
 		list_for_each_entry(mReq_next, &mEp->qh.queue, queue) {
 			i++;
 			mEp->dTD_active_re_q_count++;
-			if (TD_STATUS_ACTIVE & mReq_next->ptr->token) {
-				mReq_active = mReq_next;
+			if (_req_active_td(mReq_next, &active_dma)) {
 				dbg_event(_usb_addr(mEp), "ReQUE",
 					  mReq_next->ptr->token);
 				pr_debug("!!ReQ(%u-%u-%x)-%u!!\n", mEp->num,
@@ -2038,7 +2254,7 @@ static int _hardware_enqueue(struct ci13xxx_ep *mEp, struct ci13xxx_req *mReq)
 		}
 
 		/*  QH configuration */
-		mEp->qh.ptr->td.next = mReq_active->dma;
+		mEp->qh.ptr->td.next = active_dma;
 		mEp->qh.ptr->td.token &= ~TD_STATUS;
 		goto prime;
 	}
@@ -2112,6 +2328,8 @@ static int _hardware_dequeue(struct ci13xxx_ep *mEp, struct ci13xxx_req *mReq)
 
 	if ((TD_STATUS_ACTIVE & mReq->ptr->token) != 0)
 		return -EBUSY;
+	if ((TD_STATUS_ACTIVE & _req_last_td(mReq)->token) != 0)
+		return -EBUSY;
 
 	if (CI13XX_REQ_VENDOR_ID(mReq->req.udc_priv) == MSM_VENDOR_ID)
 		if ((mReq->req.udc_priv & MSM_SPS_MODE) &&
@@ -2137,11 +2355,22 @@ static int _hardware_dequeue(struct ci13xxx_ep *mEp, struct ci13xxx_req *mReq)
 
 	mReq->req.status = 0;
 
-	if (mReq->map) {
-		dma_unmap_single(mEp->device, mReq->req.dma, mReq->req.length,
-				 mEp->dir ? DMA_TO_DEVICE : DMA_FROM_DEVICE);
-		mReq->req.dma = DMA_ERROR_CODE;
-		mReq->map     = 0;
+	_req_unmap(mEp, mReq);
+
+	if (mReq->ntds) {
+		unsigned i, status = 0, actual = 0;
+
+		for (i = 0; i < mReq->ntds; i++) {
+			u32 token = mReq->tds[i].ptr->token;
+
+			status |= token & (TD_STATUS_HALTED |
+					   TD_STATUS_DT_ERR | TD_STATUS_TR_ERR);
+			actual += mReq->tds[i].len - ((token & TD_TOTAL_BYTES)
+						>> ffs_nr(TD_TOTAL_BYTES));
+		}
+		mReq->req.status = status ? -1 : 0;
+		mReq->req.actual = mReq->req.status ? 0 : actual;
+		return mReq->req.actual;
 	}
 
 	mReq->req.status = mReq->ptr->token & TD_STATUS;
@@ -2268,13 +2497,7 @@ static void release_ep_request(struct ci13xxx_ep  *mEp,
 	}
 	mReq->req.status = -ESHUTDOWN;
 
-	if (mReq->map) {
-		dma_unmap_single(mEp->device, mReq->req.dma,
-			mReq->req.length,
-			mEp->dir ? DMA_TO_DEVICE : DMA_FROM_DEVICE);
-		mReq->req.dma = DMA_ERROR_CODE;
-		mReq->map     = 0;
-	}
+	_req_unmap(mEp, mReq);
 
 	if (mReq->zptr) {
 		dma_pool_free(mEp->td_pool, mReq->zptr, mReq->zdma);
@@ -3082,6 +3305,7 @@ static void ep_free_request(struct usb_ep *ep, struct usb_request *req)
 
 	spin_lock_irqsave(mEp->lock, flags);
 
+	_req_free_tds(mEp, mReq);
 	if (mReq->ptr)
 		dma_pool_free(mEp->td_pool, mReq->ptr, mReq->dma);
 	kfree(mReq);
@@ -3159,7 +3383,17 @@ static int ep_queue(struct usb_ep *ep, struct usb_request *req,
 		goto done;
 	}
 
-	if (req->length > (4 * CI13XXX_PAGE_SIZE)) {
+	if (req->num_sgs || (req->length > (4 * CI13XXX_PAGE_SIZE) &&
+			     mEp->dir == TX)) {
+		/* chained dTDs, see _hardware_build_tds() */
+		if (mEp->type != USB_ENDPOINT_XFER_BULK ||
+		    (CI13XX_REQ_VENDOR_ID(req->udc_priv) == MSM_VENDOR_ID &&
+		     (req->udc_priv & MSM_SPS_MODE))) {
+			retval = -EINVAL;
+			err("SG and large IN reqs are supported only for Bulk");
+			goto done;
+		}
+	} else if (req->length > (4 * CI13XXX_PAGE_SIZE)) {
 		if (!list_empty(&mEp->qh.queue)) {
 			retval = -EAGAIN;
 			err("Queue is busy. Large req is not allowed");
@@ -3843,6 +4077,7 @@ static int udc_probe(struct ci13xxx_udc_driver *driver, struct device *dev,
 	udc->gadget.speed        = USB_SPEED_UNKNOWN;
 	udc->gadget.max_speed    = USB_SPEED_HIGH;
 	udc->gadget.is_otg       = 0;
+	udc->gadget.sg_supported = 1;
 	udc->gadget.name         = driver->name;
 
 	/* alloc resources */
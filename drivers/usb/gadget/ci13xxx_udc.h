@@ -94,6 +94,13 @@ struct ci13xxx_multi_req {
 	void                *buf;
 };
 
+/* one dTD of a request spanning several of them (SG or large bulk IN) */
+struct ci13xxx_td_ext {
+	struct ci13xxx_td   *ptr;
+	dma_addr_t           dma;
+	unsigned             len;
+};
+
 /* Extension of usb_request */
 struct ci13xxx_req {
 	struct usb_request   req;
@@ -104,6 +111,8 @@ struct ci13xxx_req {
 	struct ci13xxx_td   *zptr;
 	dma_addr_t           zdma;
 	struct ci13xxx_multi_req multi;
+	struct ci13xxx_td_ext *tds;	/* tds[0] is ptr, NULL if single dTD */
+	unsigned             ntds;
 };
 
 /* Extension of usb_ep */
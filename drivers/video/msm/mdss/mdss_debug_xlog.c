@@ -17,6 +17,9 @@
 #include <linux/debugfs.h>
 #include <linux/uaccess.h>
 #include <linux/dma-buf.h>
+#include <linux/vmalloc.h>
+#include <linux/percpu.h>
+#include <asm/local.h>
 
 #include "mdss.h"
 #include "mdss_mdp.h"
@@ -46,20 +49,24 @@ DEFINE_MUTEX(XLOG_DUMP_LOCK);
 #define MDSS_XLOG_PRINT_ENTRY	256
 
 /*
- * xlog keeps this number of entries in memory for debug purpose. This
- * number must be greater than print entry to prevent out of bound xlog
- * entry array access.
+ * xlog keeps this number of entries per cpu in memory for debug purpose.
+ * This number must be a power of two and greater than print entry so a
+ * dump never has to look beyond what a single cpu ring still holds.
  */
-#define MDSS_XLOG_ENTRY	(MDSS_XLOG_PRINT_ENTRY * 16)
+#define MDSS_XLOG_CPU_ENTRY	(MDSS_XLOG_PRINT_ENTRY * 4)
 #define MDSS_XLOG_MAX_DATA 15
 #define MDSS_XLOG_BUF_MAX 512
 #define MDSS_XLOG_BUF_ALIGN 32
 
-DEFINE_SPINLOCK(xlock);
-
+/*
+ * Every cpu appends to its own ring without taking a shared lock. A slot is
+ * reserved with an irq safe local increment and published by writing its
+ * sequence last, so that a dump running on another cpu can detect and skip
+ * an entry that is being written or was overwritten while it was copied.
+ */
 struct tlog {
-	u32 counter;
-	s64 time;
+	unsigned long seq;
+	u64 time;
 	const char *name;
 	int line;
 	u32 data[MDSS_XLOG_MAX_DATA];
@@ -67,11 +74,20 @@ struct tlog {
 	int pid;
 };
 
+struct mdss_xlog_cpu {
+	struct tlog logs[MDSS_XLOG_CPU_ENTRY];
+	local_t curr;
+};
+
+static DEFINE_PER_CPU(struct mdss_xlog_cpu *, xlog_cpu_ring);
+
+/* serializes dump readers only, writers never take it */
+static DEFINE_SPINLOCK(xlog_dump_lock);
+
 struct mdss_dbg_xlog {
-	struct tlog logs[MDSS_XLOG_ENTRY];
+	unsigned long head[NR_CPUS];
 	u32 first;
-	u32 last;
-	u32 curr;
+	u64 prev_time;
 	struct dentry *xlog;
 	u32 xlog_enable;
 	u32 panic_on_err;
@@ -96,7 +112,8 @@ static inline bool mdss_xlog_is_enabled(u32 flag)
 
 void mdss_xlog(const char *name, int line, int flag, ...)
 {
-	unsigned long flags;
+	struct mdss_xlog_cpu *xc;
+	unsigned long idx;
 	int i, val = 0;
 	va_list args;
 	struct tlog *log;
@@ -104,12 +121,20 @@ void mdss_xlog(const char *name, int line, int flag, ...)
 	if (!mdss_xlog_is_enabled(flag))
 		return;
 
-	spin_lock_irqsave(&xlock, flags);
-	log = &mdss_dbg_xlog.logs[mdss_dbg_xlog.curr];
-	log->time = ktime_to_us(ktime_get());
+	preempt_disable();
+	xc = __this_cpu_read(xlog_cpu_ring);
+	if (!xc)
+		goto end;
+
+	idx = local_inc_return(&xc->curr) - 1;
+	log = &xc->logs[idx & (MDSS_XLOG_CPU_ENTRY - 1)];
+
+	log->seq = 0;
+	smp_wmb(); /* invalidate the slot before overwriting it */
+
+	log->time = ktime_get_ns();
 	log->name = name;
 	log->line = line;
-	log->data_cnt = 0;
 	log->pid = current->pid;
 
 	va_start(args, flag);
@@ -123,44 +148,117 @@ void mdss_xlog(const char *name, int line, int flag, ...)
 	}
 	va_end(args);
 	log->data_cnt = i;
-	mdss_dbg_xlog.curr = (mdss_dbg_xlog.curr + 1) % MDSS_XLOG_ENTRY;
-	mdss_dbg_xlog.last++;
 
-	spin_unlock_irqrestore(&xlock, flags);
+	smp_wmb(); /* publish the entry only once it is complete */
+	log->seq = idx + 1;
+end:
+	preempt_enable();
 }
 
-/* always dump the last entries which are not dumped yet */
-static bool __mdss_xlog_dump_calc_range(void)
+/* copy entry @idx of @xc, returns its sequence relative to @idx */
+static long __mdss_xlog_read(struct mdss_xlog_cpu *xc, unsigned long idx,
+	struct tlog *out)
+{
+	struct tlog *log = &xc->logs[idx & (MDSS_XLOG_CPU_ENTRY - 1)];
+	unsigned long seq;
+
+	seq = ACCESS_ONCE(log->seq);
+	smp_rmb(); /* read the sequence before the entry */
+	if (seq != idx + 1)
+		return seq ? (long)(seq - (idx + 1)) : -1;
+
+	*out = *log;
+	smp_rmb(); /* read the entry before checking it again */
+	if (ACCESS_ONCE(log->seq) != seq)
+		return 1;
+
+	return 0;
+}
+
+/*
+ * find the oldest entry which is not dumped yet across all cpu rings.
+ * Entries that got overwritten under the dump cursor are skipped, an entry
+ * which is still being written ends the scan of its ring for now.
+ */
+static bool __mdss_xlog_oldest(struct tlog *out, int *out_cpu)
 {
-	static u32 next;
-	bool need_dump = true;
-	unsigned long flags;
 	struct mdss_dbg_xlog *xlog = &mdss_dbg_xlog;
+	struct mdss_xlog_cpu *xc;
+	struct tlog log;
+	bool found = false;
+	unsigned long end;
+	long ret;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		xc = per_cpu(xlog_cpu_ring, cpu);
+		if (!xc)
+			continue;
+
+		end = local_read(&xc->curr);
+		while (xlog->head[cpu] != end) {
+			ret = __mdss_xlog_read(xc, xlog->head[cpu], &log);
+			if (ret > 0) {
+				xlog->head[cpu]++;
+				continue;
+			}
 
-	spin_lock_irqsave(&xlock, flags);
+			if (!ret && (!found || log.time < out->time)) {
+				*out = log;
+				*out_cpu = cpu;
+				found = true;
+			}
+			break;
+		}
+	}
 
-	xlog->first = next;
+	return found;
+}
 
-	if (xlog->last == xlog->first) {
-		need_dump = false;
-		goto dump_exit;
+/* always dump the last entries which are not dumped yet */
+static bool __mdss_xlog_dump_next(struct tlog *log, u32 *index,
+	u64 *prev_time)
+{
+	struct mdss_dbg_xlog *xlog = &mdss_dbg_xlog;
+	struct mdss_xlog_cpu *xc;
+	unsigned long end, flags;
+	u32 pending = 0, skipped = 0;
+	bool need_dump;
+	int cpu;
+
+	spin_lock_irqsave(&xlog_dump_lock, flags);
+
+	for_each_possible_cpu(cpu) {
+		xc = per_cpu(xlog_cpu_ring, cpu);
+		if (!xc)
+			continue;
+
+		end = local_read(&xc->curr);
+		if (end - xlog->head[cpu] > MDSS_XLOG_CPU_ENTRY)
+			xlog->head[cpu] = end - MDSS_XLOG_CPU_ENTRY;
+		pending += end - xlog->head[cpu];
 	}
 
-	if (xlog->last < xlog->first) {
-		xlog->first %= MDSS_XLOG_ENTRY;
-		if (xlog->last < xlog->first)
-			xlog->last += MDSS_XLOG_ENTRY;
+	if (pending > MDSS_XLOG_PRINT_ENTRY) {
+		pr_warn("xlog buffer overflow before dump: %d\n", pending);
+		while (pending - skipped > MDSS_XLOG_PRINT_ENTRY &&
+				__mdss_xlog_oldest(log, &cpu)) {
+			xlog->head[cpu]++;
+			xlog->prev_time = log->time;
+			skipped++;
+		}
+		xlog->first += skipped;
 	}
 
-	if ((xlog->last - xlog->first) > MDSS_XLOG_PRINT_ENTRY) {
-		pr_warn("xlog buffer overflow before dump: %d\n",
-			xlog->last - xlog->first);
-		xlog->first = xlog->last - MDSS_XLOG_PRINT_ENTRY;
+	need_dump = __mdss_xlog_oldest(log, &cpu);
+	if (need_dump) {
+		xlog->head[cpu]++;
+		*index = xlog->first++;
+		*prev_time = xlog->prev_time;
+		xlog->prev_time = log->time;
 	}
-	next = xlog->first + 1;
 
-dump_exit:
-	spin_unlock_irqrestore(&xlock, flags);
+	spin_unlock_irqrestore(&xlog_dump_lock, flags);
 
 	return need_dump;
 }
@@ -169,19 +267,20 @@ static ssize_t mdss_xlog_dump_entry(char *xlog_buf, ssize_t xlog_buf_size)
 {
 	int i;
 	ssize_t off = 0;
-	struct tlog *log, *prev_log;
-	unsigned long flags;
-
-	spin_lock_irqsave(&xlock, flags);
+	struct tlog log;
+	u64 time, delta, prev_time;
+	u32 index;
 
-	log = &mdss_dbg_xlog.logs[mdss_dbg_xlog.first %
-		MDSS_XLOG_ENTRY];
+	if (!__mdss_xlog_dump_next(&log, &index, &prev_time))
+		return 0;
 
-	prev_log = &mdss_dbg_xlog.logs[(mdss_dbg_xlog.first - 1) %
-		MDSS_XLOG_ENTRY];
+	time = log.time;
+	delta = time - min(prev_time, time);
+	do_div(time, NSEC_PER_USEC);
+	do_div(delta, NSEC_PER_USEC);
 
 	off = snprintf((xlog_buf + off), (xlog_buf_size - off), "%s:%-4d",
-		log->name, log->line);
+		log.name, log.line);
 
 	if (off < MDSS_XLOG_BUF_ALIGN) {
 		memset((xlog_buf + off), 0x20, (MDSS_XLOG_BUF_ALIGN - off));
@@ -189,17 +288,15 @@ static ssize_t mdss_xlog_dump_entry(char *xlog_buf, ssize_t xlog_buf_size)
 	}
 
 	off += snprintf((xlog_buf + off), (xlog_buf_size - off),
-		"=>[%-8d:%-11llu:%9llu][%-4d]:", mdss_dbg_xlog.first,
-		log->time, (log->time - prev_log->time), log->pid);
+		"=>[%-8d:%-11llu:%9llu][%-4d]:", index, time, delta,
+		log.pid);
 
-	for (i = 0; i < log->data_cnt; i++)
+	for (i = 0; i < log.data_cnt; i++)
 		off += snprintf((xlog_buf + off), (xlog_buf_size - off),
-			"%x ", log->data[i]);
+			"%x ", log.data[i]);
 
 	off += snprintf((xlog_buf + off), (xlog_buf_size - off), "\n");
 
-	spin_unlock_irqrestore(&xlock, flags);
-
 	return off;
 }
 
@@ -207,10 +304,8 @@ static void mdss_xlog_dump_all(void)
 {
 	char xlog_buf[MDSS_XLOG_BUF_MAX];
 
-	while (__mdss_xlog_dump_calc_range()) {
-		mdss_xlog_dump_entry(xlog_buf, MDSS_XLOG_BUF_MAX);
+	while (mdss_xlog_dump_entry(xlog_buf, MDSS_XLOG_BUF_MAX) > 0)
 		pr_info("%s", xlog_buf);
-	}
 }
 
 u32 get_dump_range(struct dump_offset *range_node, size_t max_offset)
@@ -733,9 +828,9 @@ static ssize_t mdss_xlog_dump_read(struct file *file, char __user *buff,
 	ssize_t len = 0;
 	char xlog_buf[MDSS_XLOG_BUF_MAX];
 
-	if (__mdss_xlog_dump_calc_range()) {
-		len = mdss_xlog_dump_entry(xlog_buf, MDSS_XLOG_BUF_MAX);
-		if (len < 0 || len > count) {
+	len = mdss_xlog_dump_entry(xlog_buf, MDSS_XLOG_BUF_MAX);
+	if (len > 0) {
+		if (len > count) {
 			pr_err("len is more than the size of user buffer\n");
 			return 0;
 		}
@@ -794,8 +889,15 @@ int mdss_create_xlog_debug(struct mdss_debug_data *mdd)
 	INIT_WORK(&mdss_dbg_xlog.xlog_dump_work, xlog_debug_work);
 	mdss_dbg_xlog.work_panic = false;
 
-	for (i = 0; i < MDSS_XLOG_ENTRY; i++)
-		mdss_dbg_xlog.logs[i].counter = i;
+	for_each_possible_cpu(i) {
+		if (per_cpu(xlog_cpu_ring, i))
+			continue;
+
+		per_cpu(xlog_cpu_ring, i) =
+			vzalloc(sizeof(struct mdss_xlog_cpu));
+		if (!per_cpu(xlog_cpu_ring, i))
+			pr_err("xlog buffer allocation fails for cpu%d\n", i);
+	}
 
 	debugfs_create_file("dump", 0644, mdss_dbg_xlog.xlog, NULL,
 						&mdss_xlog_fops);
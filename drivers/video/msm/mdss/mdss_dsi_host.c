@@ -1705,13 +1705,56 @@ static void print_cmd_desc(struct mdss_dsi_ctrl_pdata *ctrl,
 
 #endif
 
+/* worst case tx buffer space taken by one command, headers included */
+static inline int mdss_dsi_cmd_buf_len(struct dsi_cmd_desc *cm)
+{
+	return (DSI_HOST_HDR_SIZE * 2) + ALIGN(cm->dchdr.dlen, 4);
+}
+
+/*
+ * A command which does not ask for a delay after it can share one dma
+ * transfer with the command that follows, as long as both still fit in
+ * the tx buffer. Video mode panels with the mdp running can only take
+ * commands during BLLP, so every command keeps its own transfer there.
+ */
+static bool mdss_dsi_cmd_can_batch(struct mdss_dsi_ctrl_pdata *ctrl,
+	struct dsi_buf *tp, struct dsi_cmd_desc *cm, int cnt)
+{
+	/* 8 bytes for the start alignment done by mdss_dsi_buf_init() */
+	int len = tp->len + 8 + mdss_dsi_cmd_buf_len(cm);
+
+	if (!cnt || cm->dchdr.wait)
+		return false;
+
+	if ((ctrl->panel_mode == DSI_VIDEO_MODE) &&
+	    (ctrl->ctrl_state & CTRL_STATE_MDP_ACTIVE))
+		return false;
+
+	/*
+	 * The transfer only ends with the next command marked last, the
+	 * whole chain up to it has to fit in the buffer as well.
+	 */
+	while (cnt--) {
+		cm++;
+		len += mdss_dsi_cmd_buf_len(cm);
+		if (len > tp->size)
+			return false;
+		if (cm->dchdr.last)
+			return true;
+	}
+
+	/* a chain that is never terminated is not ours to extend */
+	return false;
+}
+
 static int mdss_dsi_cmds2buf_tx(struct mdss_dsi_ctrl_pdata *ctrl,
 			struct dsi_cmd_desc *cmds, int cnt, int use_dma_tpg)
 {
 	struct dsi_buf *tp;
-	struct dsi_cmd_desc *cm;
+	struct dsi_cmd_desc *cm, desc;
 	struct dsi_ctrl_hdr *dchdr;
 	int len, wait, tot = 0;
+	bool batch;
 
 	tp = &ctrl->tx_buf;
 	mdss_dsi_buf_init(tp);
@@ -1724,15 +1767,23 @@ static int mdss_dsi_cmds2buf_tx(struct mdss_dsi_ctrl_pdata *ctrl,
 
 	while (cnt--) {
 		dchdr = &cm->dchdr;
+		batch = dchdr->last && mdss_dsi_cmd_can_batch(ctrl, tp, cm, cnt);
 		mdss_dsi_buf_reserve(tp, len);
-		len = mdss_dsi_cmd_dma_add(tp, cm);
+		if (batch) {
+			/* chain into the next command's transfer */
+			desc = *cm;
+			desc.dchdr.last = 0;
+			len = mdss_dsi_cmd_dma_add(tp, &desc);
+		} else {
+			len = mdss_dsi_cmd_dma_add(tp, cm);
+		}
 		if (!len) {
 			pr_err("%s: failed to add cmd = 0x%x\n",
 				__func__,  cm->payload[0]);
 			return 0;
 		}
 		tot += len;
-		if (dchdr->last) {
+		if (dchdr->last && !batch) {
 			tp->data = tp->start; /* begin of buf */
 
 			wait = mdss_dsi_wait4video_eng_busy(ctrl);
@@ -19,7 +19,9 @@
 #include <linux/videodev2.h>
 #include <linux/bootmem.h>
 #include <linux/console.h>
+#include <linux/cpufreq.h>
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <linux/delay.h>
 #include <linux/device.h>
 #include <linux/dma-mapping.h>
@@ -124,6 +126,7 @@ static int mdss_fb_fbmem_ion_mmap(struct fb_info *info,
 static int mdss_fb_alloc_fb_ion_memory(struct msm_fb_data_type *mfd,
 		size_t size);
 static void mdss_fb_release_fences(struct msm_fb_data_type *mfd);
+static void mdss_fb_lat_debugfs_init(struct msm_fb_data_type *mfd);
 static int __mdss_fb_sync_buf_done_callback(struct notifier_block *p,
 		unsigned long val, void *data);
 
@@ -1476,6 +1479,8 @@ static int mdss_fb_remove(struct platform_device *pdev)
 
 	mdss_fb_unregister_input_handler(mfd);
 	mdss_panel_debugfs_cleanup(mfd->panel_info);
+	debugfs_remove_recursive(mfd->lat.dentry);
+	mfd->lat.dentry = NULL;
 
 	if (mdss_fb_suspend_sub(mfd))
 		pr_err("msm_fb_remove: can't stop the device %d\n",
@@ -2122,6 +2127,8 @@ static int mdss_fb_blank_sub(int blank_mode, struct fb_info *info,
 	case FB_BLANK_UNBLANK:
 		pr_debug("unblank called. cur pwr state=%d\n", cur_power_state);
 		ret = mdss_fb_blank_unblank(mfd);
+		if (!ret)
+			pm_resume_screen_on();
 		break;
 	case BLANK_FLAG_ULP:
 		req_power_state = MDSS_PANEL_POWER_LP2;
@@ -2841,6 +2848,7 @@ static int mdss_fb_register(struct msm_fb_data_type *mfd)
 	init_waitqueue_head(&mfd->idle_wait_q);
 	init_waitqueue_head(&mfd->ioctl_q);
 	init_waitqueue_head(&mfd->kickoff_wait_q);
+	spin_lock_init(&mfd->lat.lock);
 
 	ret = fb_alloc_cmap(&fbi->cmap, 256, 0);
 	if (ret)
@@ -2856,6 +2864,7 @@ static int mdss_fb_register(struct msm_fb_data_type *mfd)
 	snprintf(panel_name, ARRAY_SIZE(panel_name), "mdss_panel_fb%d",
 		mfd->index);
 	mdss_panel_debugfs_init(panel_info, panel_name);
+	mdss_fb_lat_debugfs_init(mfd);
 	pr_info("FrameBuffer[%d] %dx%d registered successfully!\n", mfd->index,
 					fbi->var.xres, fbi->var.yres);
 
@@ -3211,6 +3220,185 @@ static void mdss_fb_release_fences(struct msm_fb_data_type *mfd)
 	mutex_unlock(&sync_pt_data->sync_mutex);
 }
 
+static u32 mdss_fb_lat_us(ktime_t start, ktime_t end)
+{
+	return clamp_t(s64, ktime_us_delta(end, start), 0, U32_MAX);
+}
+
+static void mdss_fb_lat_add(struct mdss_fb_lat_stats *lat,
+	enum mdss_fb_lat_stage stage, u32 us)
+{
+	int bucket = min_t(int, ilog2(us | 1), MDSS_FB_LAT_BUCKETS - 1);
+
+	lat->hist[stage][bucket]++;
+	lat->cnt[stage]++;
+	lat->max_us[stage] = max(lat->max_us[stage], us);
+}
+
+static void mdss_fb_lat_commit(struct msm_fb_data_type *mfd)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&mfd->lat.lock, flags);
+	mfd->lat.commit_ts = ktime_get();
+	spin_unlock_irqrestore(&mfd->lat.lock, flags);
+}
+
+static void mdss_fb_lat_kickoff(struct msm_fb_data_type *mfd)
+{
+	struct mdss_fb_lat_stats *lat = &mfd->lat;
+	ktime_t now = ktime_get();
+	unsigned long flags;
+
+	spin_lock_irqsave(&lat->lock, flags);
+	lat->commit_us = 0;
+	if (lat->commit_ts.tv64) {
+		lat->commit_us = mdss_fb_lat_us(lat->commit_ts, now);
+		mdss_fb_lat_add(lat, MDSS_FB_LAT_COMMIT_KICKOFF,
+				lat->commit_us);
+		lat->commit_ts = ktime_set(0, 0);
+	}
+	lat->kickoff_ts = now;
+	lat->done_ts = ktime_set(0, 0);
+	spin_unlock_irqrestore(&lat->lock, flags);
+}
+
+/**
+ * mdss_fb_lat_frame_done() - record hardware completion of the last kickoff
+ * @mfd:	Framebuffer data structure for display
+ *
+ * Called from the vsync or pingpong done interrupt, so that the time spent
+ * between the hardware event and the release fence signal can be accounted.
+ */
+void mdss_fb_lat_frame_done(struct msm_fb_data_type *mfd)
+{
+	struct mdss_fb_lat_stats *lat = &mfd->lat;
+	unsigned long flags;
+
+	spin_lock_irqsave(&lat->lock, flags);
+	if (lat->kickoff_ts.tv64 && !lat->done_ts.tv64)
+		lat->done_ts = ktime_get();
+	spin_unlock_irqrestore(&lat->lock, flags);
+}
+
+static void mdss_fb_lat_fence(struct msm_fb_data_type *mfd)
+{
+	struct mdss_fb_lat_stats *lat = &mfd->lat;
+	ktime_t now = ktime_get(), done;
+	u32 commit_us, kickoff_us, fence_us;
+	unsigned long flags;
+
+	spin_lock_irqsave(&lat->lock, flags);
+	if (!lat->kickoff_ts.tv64) {
+		spin_unlock_irqrestore(&lat->lock, flags);
+		return;
+	}
+
+	/* interfaces which do not report the hardware event */
+	done = lat->done_ts.tv64 ? lat->done_ts : now;
+
+	commit_us = lat->commit_us;
+	kickoff_us = mdss_fb_lat_us(lat->kickoff_ts, done);
+	fence_us = mdss_fb_lat_us(done, now);
+	mdss_fb_lat_add(lat, MDSS_FB_LAT_KICKOFF_DONE, kickoff_us);
+	mdss_fb_lat_add(lat, MDSS_FB_LAT_DONE_FENCE, fence_us);
+
+	lat->kickoff_ts = ktime_set(0, 0);
+	lat->done_ts = ktime_set(0, 0);
+	spin_unlock_irqrestore(&lat->lock, flags);
+
+	trace_mdp_frame_latency(mfd->index, commit_us, kickoff_us, fence_us);
+}
+
+static int mdss_fb_lat_show(struct seq_file *s, void *unused)
+{
+	static const char * const stage_name[MDSS_FB_LAT_MAX] = {
+		[MDSS_FB_LAT_COMMIT_KICKOFF] = "commit->kickoff",
+		[MDSS_FB_LAT_KICKOFF_DONE] = "kickoff->done",
+		[MDSS_FB_LAT_DONE_FENCE] = "done->fence",
+	};
+	struct msm_fb_data_type *mfd = s->private;
+	u32 hist[MDSS_FB_LAT_MAX][MDSS_FB_LAT_BUCKETS];
+	u32 max_us[MDSS_FB_LAT_MAX], cnt[MDSS_FB_LAT_MAX];
+	unsigned long flags;
+	int i, j;
+
+	spin_lock_irqsave(&mfd->lat.lock, flags);
+	memcpy(hist, mfd->lat.hist, sizeof(hist));
+	memcpy(max_us, mfd->lat.max_us, sizeof(max_us));
+	memcpy(cnt, mfd->lat.cnt, sizeof(cnt));
+	spin_unlock_irqrestore(&mfd->lat.lock, flags);
+
+	for (i = 0; i < MDSS_FB_LAT_MAX; i++) {
+		seq_printf(s, "%s: frames=%u max=%uus\n", stage_name[i],
+			cnt[i], max_us[i]);
+		for (j = 0; j < MDSS_FB_LAT_BUCKETS; j++) {
+			if (!hist[i][j])
+				continue;
+			seq_printf(s, "  >=%-8u: %u\n", j ? (1U << j) : 0,
+				hist[i][j]);
+		}
+	}
+
+	return 0;
+}
+
+static int mdss_fb_lat_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mdss_fb_lat_show, inode->i_private);
+}
+
+/* any write clears the collected statistics */
+static ssize_t mdss_fb_lat_write(struct file *file,
+	const char __user *user_buf, size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct msm_fb_data_type *mfd = s->private;
+	unsigned long flags;
+
+	spin_lock_irqsave(&mfd->lat.lock, flags);
+	memset(mfd->lat.hist, 0, sizeof(mfd->lat.hist));
+	memset(mfd->lat.max_us, 0, sizeof(mfd->lat.max_us));
+	memset(mfd->lat.cnt, 0, sizeof(mfd->lat.cnt));
+	spin_unlock_irqrestore(&mfd->lat.lock, flags);
+
+	return count;
+}
+
+static const struct file_operations mdss_fb_lat_fops = {
+	.open = mdss_fb_lat_open,
+	.read = seq_read,
+	.write = mdss_fb_lat_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void mdss_fb_lat_debugfs_init(struct msm_fb_data_type *mfd)
+{
+	static struct dentry *root;
+	char name[8];
+
+	if (!root) {
+		root = debugfs_create_dir("mdss_fb", NULL);
+		if (IS_ERR_OR_NULL(root)) {
+			root = NULL;
+			return;
+		}
+	}
+
+	snprintf(name, sizeof(name), "fb%d", mfd->index);
+	mfd->lat.dentry = debugfs_create_dir(name, root);
+	if (IS_ERR_OR_NULL(mfd->lat.dentry)) {
+		mfd->lat.dentry = NULL;
+		return;
+	}
+
+	debugfs_create_file("frame_latency", 0644, mfd->lat.dentry, mfd,
+			&mdss_fb_lat_fops);
+	debugfs_create_bool("fast_fence", 0644, mfd->lat.dentry,
+			&mfd->lat.fast_fence);
+}
+
 static void mdss_fb_release_kickoff(struct msm_fb_data_type *mfd)
 {
 	if (mfd->wait_for_kickoff) {
@@ -3269,6 +3457,8 @@ static int __mdss_fb_sync_buf_done_callback(struct notifier_block *p,
 	case MDP_NOTIFY_FRAME_FLUSHED:
 		pr_debug("%s: frame flushed\n", sync_pt_data->fence_name);
 		sync_pt_data->flushed = true;
+		mdss_fb_lat_kickoff(mfd);
+		cpufreq_notify_frame_commit();
 		break;
 	case MDP_NOTIFY_FRAME_TIMEOUT:
 		pr_err("%s: frame timeout\n", sync_pt_data->fence_name);
@@ -3277,6 +3467,7 @@ static int __mdss_fb_sync_buf_done_callback(struct notifier_block *p,
 	case MDP_NOTIFY_FRAME_DONE:
 		pr_debug("%s: frame done\n", sync_pt_data->fence_name);
 		mdss_fb_signal_timeline(sync_pt_data);
+		mdss_fb_lat_fence(mfd);
 		mdss_fb_calc_fps(mfd);
 		break;
 	case MDP_NOTIFY_FRAME_CFG_DONE:
@@ -3407,6 +3598,7 @@ static int mdss_fb_pan_display_ex(struct fb_info *info,
 	atomic_inc(&mfd->mdp_sync_pt_data.commit_cnt);
 	atomic_inc(&mfd->commits_pending);
 	atomic_inc(&mfd->kickoff_pending);
+	mdss_fb_lat_commit(mfd);
 	wake_up_all(&mfd->commit_wait_q);
 	mutex_unlock(&mfd->mdp_sync_pt_data.sync_mutex);
 	if (wait_for_finish) {
@@ -3607,6 +3799,7 @@ int mdss_fb_atomic_commit(struct fb_info *info,
 	atomic_inc(&mfd->mdp_sync_pt_data.commit_cnt);
 	atomic_inc(&mfd->commits_pending);
 	atomic_inc(&mfd->kickoff_pending);
+	mdss_fb_lat_commit(mfd);
 	wake_up_all(&mfd->commit_wait_q);
 	mutex_unlock(&mfd->mdp_sync_pt_data.sync_mutex);
 
@@ -264,6 +264,42 @@ struct msm_fb_fps_info {
 	u32 measured_fps;
 };
 
+/* log2 microsecond buckets, the last one collects everything beyond */
+#define MDSS_FB_LAT_BUCKETS 16
+
+enum mdss_fb_lat_stage {
+	MDSS_FB_LAT_COMMIT_KICKOFF,
+	MDSS_FB_LAT_KICKOFF_DONE,
+	MDSS_FB_LAT_DONE_FENCE,
+	MDSS_FB_LAT_MAX,
+};
+
+/**
+ * struct mdss_fb_lat_stats - per frame display pipeline latency
+ * @lock: protects the timestamps, may be taken from interrupt context
+ * @commit_ts: time the last user commit was queued to the display thread
+ * @kickoff_ts: time the frame was flushed to hardware
+ * @done_ts: time hardware reported the frame done (vsync or pingpong)
+ * @commit_us: commit to kickoff latency of the frame in flight
+ * @hist: latency histogram per stage
+ * @max_us: worst latency seen per stage
+ * @cnt: number of samples per stage
+ * @fast_fence: complete command mode frames on a high priority workqueue
+ * @dentry: debugfs directory of the fb
+ */
+struct mdss_fb_lat_stats {
+	spinlock_t lock;
+	ktime_t commit_ts;
+	ktime_t kickoff_ts;
+	ktime_t done_ts;
+	u32 commit_us;
+	u32 hist[MDSS_FB_LAT_MAX][MDSS_FB_LAT_BUCKETS];
+	u32 max_us[MDSS_FB_LAT_MAX];
+	u32 cnt[MDSS_FB_LAT_MAX];
+	u32 fast_fence;
+	struct dentry *dentry;
+};
+
 struct msm_fb_data_type {
 	u32 key;
 	u32 index;
@@ -371,6 +407,8 @@ struct msm_fb_data_type {
 	bool pending_switch;
 	struct mutex switch_lock;
 	struct input_handler *input_handler;
+
+	struct mdss_fb_lat_stats lat;
 };
 
 static inline void mdss_fb_update_notify_update(struct msm_fb_data_type *mfd)
@@ -473,4 +511,5 @@ void mdss_fb_report_panel_dead(struct msm_fb_data_type *mfd);
 void mdss_panelinfo_to_fb_var(struct mdss_panel_info *pinfo,
 						struct fb_var_screeninfo *var);
 void mdss_fb_calc_fps(struct msm_fb_data_type *mfd);
+void mdss_fb_lat_frame_done(struct msm_fb_data_type *mfd);
 #endif /* MDSS_FB_H */
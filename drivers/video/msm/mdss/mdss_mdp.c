@@ -42,6 +42,7 @@
 #include <linux/clk/msm-clk.h>
 #include <linux/irqdomain.h>
 #include <linux/irq.h>
+#include <linux/devfreq.h>
 
 #include <linux/msm-bus.h>
 #include <linux/msm-bus-board.h>
@@ -692,6 +693,8 @@ int mdss_bus_scale_set_quota(int client, u64 ab_quota, u64 ib_quota)
 
 	rc = mdss_mdp_bus_scale_set_quota(total_ab_rt, total_ab_nrt,
 			total_ib_rt, total_ib_nrt);
+	bw_hwmon_set_floor(BW_HWMON_FLOOR_MDSS,
+			(total_ab_rt + total_ab_nrt) >> 20);
 
 	mutex_unlock(&mdss_res->bus_lock);
 
@@ -889,6 +889,58 @@ struct mdss_mdp_pipe_multirect_params {
 	void *next; /* pointer to next pipe or layer */
 };
 
+/**
+ * struct mdss_mdp_pipe_cfg_sig - pipe state the derived configuration
+ * depends on
+ * @src_fmt:		source format of the pipe
+ * @mixer:		left mixer the pipe is staged on
+ * @src:		source rectangle
+ * @flags:		pipe flags (rotation, flip, deinterlace...)
+ * @bwc_mode:		bandwidth compression mode
+ * @horz_deci:		horizontal decimation factor
+ * @vert_deci:		vertical decimation factor
+ * @mixer_width:	width of the left mixer
+ * @mixer_type:		type of the left mixer
+ * @rotator_mode:	true if the left mixer is in rotator mode
+ * @intf_num:		interface of the ctl the mixer belongs to
+ */
+struct mdss_mdp_pipe_cfg_sig {
+	struct mdss_mdp_format_params *src_fmt;
+	struct mdss_mdp_mixer *mixer;
+	struct mdss_rect src;
+	u32 flags;
+	u32 bwc_mode;
+	u8 horz_deci;
+	u8 vert_deci;
+	u32 mixer_width;
+	u32 mixer_type;
+	u32 rotator_mode;
+	u32 intf_num;
+};
+
+/**
+ * struct mdss_mdp_pipe_cfg_cache - configuration derived from the pipe
+ * geometry, reused across commits while the signature doesn't change
+ * @sig:		pipe state the values below were computed from
+ * @stride_valid:	@ps holds the SMP strides for @sig
+ * @ps:			SMP strides from mdss_mdp_calc_stride()
+ * @blks_valid:		@num_blks holds the SMP block count for @sig
+ * @num_blks:		SMP blocks from mdss_mdp_smp_calc_num_blocks()
+ * @qos_valid:		@qos_lut and @total_fl hold the QoS LUT for @sig
+ * @qos_lut:		QoS LUT from mdss_mdp_pipe_qos_lut()
+ * @total_fl:		fill level the QoS LUT was picked for
+ */
+struct mdss_mdp_pipe_cfg_cache {
+	struct mdss_mdp_pipe_cfg_sig sig;
+	bool stride_valid;
+	struct mdss_mdp_plane_sizes ps;
+	bool blks_valid;
+	u32 num_blks;
+	bool qos_valid;
+	u32 qos_lut;
+	u32 total_fl;
+};
+
 struct mdss_mdp_pipe {
 	u32 num;
 	u32 type;
@@ -963,6 +1015,8 @@ struct mdss_mdp_pipe {
 	u8 supported_formats[BITS_TO_BYTES(MDP_IMGTYPE_LIMIT1)];
 
 	struct mdss_mdp_pipe_multirect_params multirect;
+
+	struct mdss_mdp_pipe_cfg_cache cfg_cache;
 };
 
 struct mdss_mdp_writeback_arg {
@@ -972,6 +1026,40 @@ struct mdss_mdp_writeback_arg {
 
 struct mdss_mdp_wfd;
 
+#define MDSS_MDP_ADFPS_STEPS 5
+
+/**
+ * struct mdss_mdp_adfps - adaptive refresh rate policy
+ * @enable:		policy is active for the framebuffer
+ * @lock:		protects the policy state
+ * @work:		periodic sampling of the commit rate
+ * @commits:		commits since the last sample
+ * @sample_time:	time of the last sample
+ * @input_time:		jiffies of the last touch event
+ * @steps:		refresh rates the policy picks from, highest first
+ * @num_steps:		number of valid entries in @steps
+ * @cur:		index of the refresh rate currently programmed
+ * @down_cnt:		consecutive samples that asked for a lower rate
+ * @stopped:		sampling stopped while idle, restarted by a commit
+ * @since:		time the panel switched to @cur
+ * @residency_us:	time spent at each refresh rate in @steps
+ */
+struct mdss_mdp_adfps {
+	bool enable;
+	struct mutex lock;
+	struct delayed_work work;
+	atomic_t commits;
+	ktime_t sample_time;
+	unsigned long input_time;
+	u32 steps[MDSS_MDP_ADFPS_STEPS];
+	u32 num_steps;
+	u32 cur;
+	u32 down_cnt;
+	bool stopped;
+	ktime_t since;
+	u64 residency_us[MDSS_MDP_ADFPS_STEPS];
+};
+
 struct mdss_overlay_private {
 	bool vsync_en;
 	ktime_t vsync_time;
@@ -1033,6 +1121,8 @@ struct mdss_overlay_private {
 	struct kthread_worker worker;
 	struct kthread_work vsync_work;
 	struct task_struct *thread;
+
+	struct mdss_mdp_adfps adfps;
 };
 
 struct mdss_mdp_set_ot_params {
@@ -1898,6 +1988,9 @@ void mdss_mdp_intersect_rect(struct mdss_rect *res_rect,
 void mdss_mdp_crop_rect(struct mdss_rect *src_rect,
 	struct mdss_rect *dst_rect,
 	const struct mdss_rect *sci_rect);
+void mdss_mdp_union_rect(struct mdss_rect *res_rect,
+	const struct mdss_rect *rect1,
+	const struct mdss_rect *rect2);
 void rect_copy_mdss_to_mdp(struct mdp_rect *user, struct mdss_rect *kernel);
 void rect_copy_mdp_to_mdss(struct mdp_rect *user, struct mdss_rect *kernel);
 bool mdss_rect_overlap_check(struct mdss_rect *rect1, struct mdss_rect *rect2);
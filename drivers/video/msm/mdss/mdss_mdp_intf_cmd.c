@@ -1169,6 +1169,19 @@ static int mdss_mdp_cmd_intf_recovery(void *data, int event)
 	return 0;
 }
 
+/*
+ * release fences are signaled from pp_done_work, keep it off the shared
+ * system workqueue when the fb asks for the fast fence path
+ */
+static inline struct workqueue_struct *mdss_mdp_cmd_pp_done_wq(
+	struct mdss_mdp_ctl *ctl)
+{
+	if (ctl->mfd && ctl->mfd->lat.fast_fence)
+		return system_highpri_wq;
+
+	return system_wq;
+}
+
 static void mdss_mdp_cmd_pingpong_done(void *arg)
 {
 	struct mdss_mdp_ctl *ctl = arg;
@@ -1214,8 +1227,11 @@ static void mdss_mdp_cmd_pingpong_done(void *arg)
 			       atomic_read(&ctx->koff_cnt));
 		if (sync_ppdone) {
 			atomic_inc(&ctx->pp_done_cnt);
+			if (ctl->mfd)
+				mdss_fb_lat_frame_done(ctl->mfd);
 			if (!ctl->commit_in_progress)
-				schedule_work(&ctx->pp_done_work);
+				queue_work(mdss_mdp_cmd_pp_done_wq(ctl),
+					&ctx->pp_done_work);
 
 			mdss_mdp_resource_control(ctl,
 				MDP_RSRC_CTL_EVENT_PP_DONE);
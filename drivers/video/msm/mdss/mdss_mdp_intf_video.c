@@ -984,6 +984,8 @@ static void mdss_mdp_video_vsync_intr_done(void *arg)
 		 ctl->num, ctl->vsync_cnt, (int)ktime_to_ms(vsync_time));
 
 	ctx->polling_en = false;
+	if (ctl->mfd)
+		mdss_fb_lat_frame_done(ctl->mfd);
 	complete_all(&ctx->vsync_comp);
 	spin_lock(&ctx->vsync_lock);
 	list_for_each_entry(tmp, &ctx->vsync_handlers, list) {
@@ -59,11 +59,18 @@
 #define DFPS_DATA_MAX_FPS 0x7fffffff
 #define DFPS_DATA_MAX_CLK_RATE 250000
 
+/* adaptive dfps: commit rate sampling period and policy tuning */
+#define ADFPS_SAMPLE_MS 500
+#define ADFPS_DOWN_SAMPLES 3
+#define ADFPS_HEADROOM_PCT 10
+#define ADFPS_INPUT_HOLD_MS 2000
+
 static int mdss_mdp_overlay_free_fb_pipe(struct msm_fb_data_type *mfd);
 static int mdss_mdp_overlay_fb_parse_dt(struct msm_fb_data_type *mfd);
 static int mdss_mdp_overlay_off(struct msm_fb_data_type *mfd);
 static void __overlay_kickoff_requeue(struct msm_fb_data_type *mfd);
 static void __vsync_retire_signal(struct msm_fb_data_type *mfd, int val);
+static void mdss_mdp_adfps_commit(struct mdss_overlay_private *mdp5_data);
 static int __vsync_set_vsync_handler(struct msm_fb_data_type *mfd);
 static int mdss_mdp_update_panel_info(struct msm_fb_data_type *mfd,
 		int mode, int dest_ctrl);
@@ -1947,6 +1954,131 @@ int mdss_mode_switch_post(struct msm_fb_data_type *mfd, u32 mode)
 	return rc;
 }
 
+/*
+ * partial update is only worth it when the roi is at most this share of the
+ * full frame, past that the pipe reprogramming and extra panel commands for
+ * the roi switch eat up what is saved on the DSI link and DDR fetch.
+ */
+#define MDSS_MDP_DAMAGE_ROI_MAX_PCT	75
+
+static bool __is_pipe_buf_updated(struct mdss_mdp_pipe *pipe)
+{
+	struct mdss_mdp_data *buf;
+
+	buf = list_first_entry_or_null(&pipe->buf_queue,
+			struct mdss_mdp_data, pipe_list);
+	if (!buf)
+		return false;
+
+	if (buf->state == MDP_BUF_STATE_READY)
+		return true;
+
+	/* a newer buffer is queued behind the active one */
+	return !list_is_last(&buf->pipe_list, &pipe->buf_queue);
+}
+
+static bool __align_damage_roi(struct mdss_rect *roi,
+	struct mdss_panel_roi_alignment *align, u32 width, u32 height)
+{
+	u32 x2 = roi->x + roi->w, y2 = roi->y + roi->h;
+	u32 x = roi->x, y = roi->y, w, h;
+
+	if (align->xstart_pix_align)
+		x = rounddown(x, align->xstart_pix_align);
+	if (align->ystart_pix_align)
+		y = rounddown(y, align->ystart_pix_align);
+
+	w = max(x2 - x, align->min_width);
+	h = max(y2 - y, align->min_height);
+	if (align->width_pix_align)
+		w = roundup(w, align->width_pix_align);
+	if (align->height_pix_align)
+		h = roundup(h, align->height_pix_align);
+
+	if (((x + w) > width) || ((y + h) > height))
+		return false;
+
+	*roi = (struct mdss_rect) {x, y, w, h};
+	return true;
+}
+
+/**
+ * __calc_damage_roi() - derive partial update roi from updated layers
+ * @mfd: Msm frame buffer data structure for the associated fb
+ * @roi: output roi of the left mixer
+ *
+ * Used when user program did not provide any roi for the commit. The
+ * destination rects of all pipes which fetch a new buffer are merged into
+ * one bounding box which is then aligned to the panel requirements. The
+ * box is only used if it is sufficiently cheaper than a full frame and it
+ * stays valid for every staged pipe, see __is_roi_valid(). Any geometry
+ * change or layer removal falls back to a full frame update since the
+ * previous position of the layer is not tracked.
+ *
+ * Return: true if @roi holds a valid partial update region.
+ */
+static bool __calc_damage_roi(struct msm_fb_data_type *mfd,
+	struct mdss_rect *roi)
+{
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	struct mdss_mdp_ctl *ctl = mfd_to_ctl(mfd);
+	struct mdss_panel_info *pinfo = &ctl->panel_data->panel_info;
+	struct mdss_mdp_mixer *mixer = ctl->mixer_left;
+	struct mdss_mdp_pipe *pipe;
+	struct mdss_rect damage = {0}, res;
+	u64 full_area, roi_area;
+
+	if (!pinfo->partial_update_enabled || !ctl->play_cnt ||
+	    ctl->pending_mode_switch || is_split_lm(mfd) ||
+	    (pinfo->compression_mode == COMPRESSION_DSC) ||
+	    !list_empty(&mdp5_data->pipes_cleanup))
+		return false;
+
+	list_for_each_entry(pipe, &mdp5_data->pipes_used, list) {
+		if (pipe->params_changed || pipe->dirty ||
+		    pipe->src_split_req)
+			return false;
+
+		if (!__is_pipe_buf_updated(pipe))
+			continue;
+
+		if (damage.w && damage.h)
+			mdss_mdp_union_rect(&damage, &damage, &pipe->dst);
+		else
+			damage = pipe->dst;
+	}
+
+	if (!damage.w || !damage.h)
+		return false;
+
+	if (!__align_damage_roi(&damage, &pinfo->roi_alignment,
+				mixer->width, mixer->height))
+		return false;
+
+	full_area = (u64) mixer->width * mixer->height;
+	roi_area = (u64) damage.w * damage.h;
+	if ((roi_area * 100) > (full_area * MDSS_MDP_DAMAGE_ROI_MAX_PCT))
+		return false;
+
+	list_for_each_entry(pipe, &mdp5_data->pipes_used, list) {
+		if (!mdss_rect_overlap_check(&pipe->dst, &damage))
+			return false;
+
+		if (pipe->scaler.enable || (pipe->src.w != pipe->dst.w) ||
+		    (pipe->src.h != pipe->dst.h)) {
+			mdss_mdp_intersect_rect(&res, &pipe->dst, &damage);
+			if (!mdss_rect_cmp(&res, &pipe->dst))
+				return false;
+		}
+	}
+
+	pr_debug("damage roi:-> %d %d %d %d\n",
+		damage.x, damage.y, damage.w, damage.h);
+	*roi = damage;
+
+	return true;
+}
+
 static void __validate_and_set_roi(struct msm_fb_data_type *mfd,
 	struct mdp_display_commit *commit)
 {
@@ -1961,8 +2093,10 @@ static void __validate_and_set_roi(struct msm_fb_data_type *mfd,
 		goto set_roi;
 
 	if (!memcmp(&commit->l_roi, &tmp_roi, sizeof(tmp_roi)) &&
-	    !memcmp(&commit->r_roi, &tmp_roi, sizeof(tmp_roi)))
+	    !memcmp(&commit->r_roi, &tmp_roi, sizeof(tmp_roi))) {
+		skip_partial_update = !__calc_damage_roi(mfd, &l_roi);
 		goto set_roi;
+	}
 
 	rect_copy_mdp_to_mdss(&commit->l_roi, &l_roi);
 	rect_copy_mdp_to_mdss(&commit->r_roi, &r_roi);
@@ -3045,6 +3179,7 @@ int mdss_mdp_overlay_kickoff(struct msm_fb_data_type *mfd,
 	}
 
 	mdss_fb_update_notify_update(mfd);
+	mdss_mdp_adfps_commit(mdp5_data);
 
 #if defined(CONFIG_FB_MSM_MDSS_SAMSUNG)
 	mdss_mdp_ctl_intf_event(mdp5_data->ctl, MDSS_SAMSUNG_EVENT_FRAME_UPDATE, NULL, false);
@@ -3982,12 +4117,284 @@ static ssize_t dynamic_fps_sysfs_wta_dfps(struct device *dev,
 	return count;
 } /* dynamic_fps_sysfs_wta_dfps */
 
+static bool __adfps_supported(struct mdss_panel_info *pinfo)
+{
+	/* only the modes that can switch with just a new fps value */
+	return pinfo->dynamic_fps &&
+		(pinfo->dfps_update == DFPS_IMMEDIATE_CLK_UPDATE_MODE ||
+		pinfo->dfps_update == DFPS_IMMEDIATE_PORCH_UPDATE_MODE_VFP ||
+		pinfo->dfps_update == DFPS_IMMEDIATE_PORCH_UPDATE_MODE_HFP);
+}
+
+static void __adfps_build_steps(struct mdss_mdp_adfps *adfps,
+	struct mdss_panel_info *pinfo)
+{
+	/* 1, 4/5, 2/3, 1/2 and 2/5 of the default refresh rate */
+	static const u32 num[MDSS_MDP_ADFPS_STEPS] = { 1, 4, 2, 1, 2 };
+	static const u32 den[MDSS_MDP_ADFPS_STEPS] = { 1, 5, 3, 2, 5 };
+	u32 base, fps;
+	int i;
+
+	base = pinfo->default_fps ? pinfo->default_fps :
+		mdss_panel_get_framerate(pinfo, FPS_RESOLUTION_DEFAULT);
+	if (pinfo->max_fps && base > pinfo->max_fps)
+		base = pinfo->max_fps;
+
+	adfps->num_steps = 0;
+	for (i = 0; i < MDSS_MDP_ADFPS_STEPS; i++) {
+		fps = base * num[i] / den[i];
+		if (fps < pinfo->min_fps)
+			break;
+		if (adfps->num_steps &&
+			fps == adfps->steps[adfps->num_steps - 1])
+			continue;
+		adfps->steps[adfps->num_steps++] = fps;
+	}
+}
+
+static int __adfps_index(struct mdss_mdp_adfps *adfps, u32 fps)
+{
+	int i;
+
+	for (i = 0; i < adfps->num_steps; i++)
+		if (adfps->steps[i] == fps)
+			return i;
+
+	return -EINVAL;
+}
+
+static void __adfps_account(struct mdss_mdp_adfps *adfps, ktime_t now)
+{
+	adfps->residency_us[adfps->cur] += ktime_us_delta(now, adfps->since);
+	adfps->since = now;
+}
+
+static void __adfps_set_fps(struct mdss_mdp_ctl *ctl, u32 fps)
+{
+	struct dynamic_fps_data data = {0};
+	int ret;
+
+	data.fps = fps;
+	ret = mdss_mdp_dfps_update_params(ctl->mfd, ctl->panel_data, &data);
+	if (!ret)
+		ret = mdss_mdp_ctl_update_fps(ctl);
+
+	if (ret)
+		pr_err("adaptive dfps failed to set %d fps ret=%d\n", fps, ret);
+}
+
+/*
+ * __adfps_work() - adaptive refresh rate policy
+ *
+ * Sample the commit rate of the framebuffer and program the lowest refresh
+ * rate that still covers it with some headroom. Raising the rate happens on
+ * the first sample that needs it, lowering it only after the rate stayed low
+ * for a few samples. Touch input holds the panel at the default rate, the
+ * early wake up path of video panels already switches back to it.
+ */
+static void __adfps_work(struct work_struct *work)
+{
+	struct mdss_mdp_adfps *adfps = container_of(to_delayed_work(work),
+		struct mdss_mdp_adfps, work);
+	struct mdss_overlay_private *mdp5_data = container_of(adfps,
+		struct mdss_overlay_private, adfps);
+	struct mdss_mdp_ctl *ctl = mdp5_data->ctl;
+	struct mdss_panel_info *pinfo;
+	u32 commits, needed;
+	s64 elapsed_us;
+	ktime_t now;
+	int i, idx, target;
+
+	mutex_lock(&adfps->lock);
+
+	if (!adfps->enable || !ctl || !ctl->mfd || !ctl->panel_data ||
+		!mdss_mdp_ctl_is_power_on(ctl)) {
+		adfps->stopped = true;
+		goto unlock;
+	}
+
+	pinfo = &ctl->panel_data->panel_info;
+	now = ktime_get();
+
+	/* Restarted by a commit, just open a new sampling window */
+	if (adfps->stopped) {
+		adfps->stopped = false;
+		adfps->sample_time = now;
+		goto resched;
+	}
+
+	elapsed_us = ktime_us_delta(now, adfps->sample_time);
+	commits = atomic_xchg(&adfps->commits, 0);
+	adfps->sample_time = now;
+
+	/* Follow rate changes done behind our back (early wake up, sysfs) */
+	idx = __adfps_index(adfps,
+		mdss_panel_get_framerate(pinfo, FPS_RESOLUTION_DEFAULT));
+	if (idx >= 0 && idx != adfps->cur) {
+		__adfps_account(adfps, now);
+		adfps->cur = idx;
+	}
+
+	if (ctl->mfd->idle_state == MDSS_FB_IDLE || elapsed_us <= 0) {
+		needed = 0;
+	} else {
+		u64 window = (u64) elapsed_us * 100;
+
+		needed = div64_u64((u64) commits * USEC_PER_SEC *
+			(100 + ADFPS_HEADROOM_PCT) + window - 1, window);
+	}
+
+	target = 0;
+	if (time_after(jiffies, adfps->input_time +
+			msecs_to_jiffies(ADFPS_INPUT_HOLD_MS))) {
+		for (i = 0; i < adfps->num_steps; i++)
+			if (adfps->steps[i] >= needed)
+				target = i;
+	}
+
+	if (target > adfps->cur && ++adfps->down_cnt < ADFPS_DOWN_SAMPLES)
+		goto resched;
+
+	adfps->down_cnt = 0;
+
+	if (target != adfps->cur) {
+		pr_debug("fb%d: commit rate %d fps, %d -> %d fps\n",
+			ctl->mfd->index, needed, adfps->steps[adfps->cur],
+			adfps->steps[target]);
+		__adfps_account(adfps, now);
+		adfps->cur = target;
+		__adfps_set_fps(ctl, adfps->steps[target]);
+	}
+
+	/* Nothing left to lower, wait for the next commit to start again */
+	if (!commits && adfps->cur == adfps->num_steps - 1) {
+		adfps->stopped = true;
+		goto unlock;
+	}
+
+resched:
+	schedule_delayed_work(&adfps->work, msecs_to_jiffies(ADFPS_SAMPLE_MS));
+unlock:
+	mutex_unlock(&adfps->lock);
+}
+
+static void mdss_mdp_adfps_commit(struct mdss_overlay_private *mdp5_data)
+{
+	struct mdss_mdp_adfps *adfps = &mdp5_data->adfps;
+
+	if (!adfps->enable)
+		return;
+
+	atomic_inc(&adfps->commits);
+	if (!delayed_work_pending(&adfps->work))
+		schedule_delayed_work(&adfps->work,
+			msecs_to_jiffies(ADFPS_SAMPLE_MS));
+}
+
+static ssize_t adaptive_fps_sysfs_rda(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)fbi->par;
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", mdp5_data->adfps.enable);
+}
+
+static ssize_t adaptive_fps_sysfs_wta(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)fbi->par;
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	struct mdss_mdp_adfps *adfps = &mdp5_data->adfps;
+	struct mdss_panel_data *pdata;
+	bool enable;
+	int idx, rc;
+
+	rc = strtobool(buf, &enable);
+	if (rc)
+		return rc;
+
+	pdata = dev_get_platdata(&mfd->pdev->dev);
+	if (!pdata || !__adfps_supported(&pdata->panel_info)) {
+		pr_err_once("adaptive dfps not supported on fb%d\n",
+			mfd->index);
+		return -EINVAL;
+	}
+
+	mutex_lock(&adfps->lock);
+
+	if (enable && !adfps->enable) {
+		__adfps_build_steps(adfps, &pdata->panel_info);
+		idx = __adfps_index(adfps,
+			mdss_panel_get_framerate(&pdata->panel_info,
+				FPS_RESOLUTION_DEFAULT));
+		adfps->cur = idx >= 0 ? idx : 0;
+		adfps->down_cnt = 0;
+		adfps->stopped = false;
+		adfps->since = adfps->sample_time = ktime_get();
+		atomic_set(&adfps->commits, 0);
+		memset(adfps->residency_us, 0, sizeof(adfps->residency_us));
+		adfps->enable = true;
+		schedule_delayed_work(&adfps->work,
+			msecs_to_jiffies(ADFPS_SAMPLE_MS));
+	} else if (!enable && adfps->enable) {
+		adfps->enable = false;
+		__adfps_account(adfps, ktime_get());
+
+		/* Hand the panel back at its default refresh rate */
+		if (adfps->cur && mdp5_data->ctl &&
+			mdss_mdp_ctl_is_power_on(mdp5_data->ctl))
+			__adfps_set_fps(mdp5_data->ctl, adfps->steps[0]);
+		adfps->cur = 0;
+	}
+
+	mutex_unlock(&adfps->lock);
+
+	if (!enable)
+		cancel_delayed_work_sync(&adfps->work);
+
+	return count;
+}
+
+static ssize_t adaptive_fps_residency_sysfs_rda(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)fbi->par;
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	struct mdss_mdp_adfps *adfps = &mdp5_data->adfps;
+	ssize_t len = 0;
+	int i;
+
+	mutex_lock(&adfps->lock);
+
+	if (adfps->enable)
+		__adfps_account(adfps, ktime_get());
+
+	for (i = 0; i < adfps->num_steps; i++)
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%u %llu\n",
+			adfps->steps[i],
+			div_u64(adfps->residency_us[i], USEC_PER_MSEC));
+
+	mutex_unlock(&adfps->lock);
+
+	return len;
+}
+
 
 static DEVICE_ATTR(dynamic_fps, S_IRUGO | S_IWUSR, dynamic_fps_sysfs_rda_dfps,
 	dynamic_fps_sysfs_wta_dfps);
+static DEVICE_ATTR(adaptive_fps, S_IRUGO | S_IWUSR, adaptive_fps_sysfs_rda,
+	adaptive_fps_sysfs_wta);
+static DEVICE_ATTR(adaptive_fps_residency, S_IRUGO,
+	adaptive_fps_residency_sysfs_rda, NULL);
 
 static struct attribute *dynamic_fps_fs_attrs[] = {
 	&dev_attr_dynamic_fps.attr,
+	&dev_attr_adaptive_fps.attr,
+	&dev_attr_adaptive_fps_residency.attr,
 	NULL,
 };
 static struct attribute_group dynamic_fps_fs_attrs_group = {
@@ -6126,6 +6533,8 @@ static int mdss_mdp_overlay_off(struct msm_fb_data_type *mfd)
 #if defined(CONFIG_FB_MSM_MDSS_SAMSUNG)
 	vdd = mdss_samsung_get_vdd(mdp5_data->ctl);
 #endif
+	cancel_delayed_work_sync(&mdp5_data->adfps.work);
+
 	/*
 	 * Keep a reference to the runtime pm until the overlay is turned
 	 * off, and then release this last reference at the end. This will
@@ -6632,6 +7041,14 @@ int mdss_mdp_input_event_handler(struct msm_fb_data_type *mfd)
 {
 	int rc = 0;
 	struct mdss_mdp_ctl *ctl = mfd_to_ctl(mfd);
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+
+	/* Hold the adaptive dfps policy at the default rate while touched */
+	if (mdp5_data && mdp5_data->adfps.enable) {
+		mdp5_data->adfps.input_time = jiffies;
+		if (!delayed_work_pending(&mdp5_data->adfps.work))
+			schedule_delayed_work(&mdp5_data->adfps.work, 0);
+	}
 
 	if (ctl && mdss_panel_is_power_on(ctl->power_state) &&
 	    ctl->ops.early_wake_up_fnc)
@@ -6720,6 +7137,8 @@ int mdss_mdp_overlay_init(struct msm_fb_data_type *mfd)
 	mutex_init(&mdp5_data->list_lock);
 	mutex_init(&mdp5_data->ov_lock);
 	mutex_init(&mdp5_data->dfps_lock);
+	mutex_init(&mdp5_data->adfps.lock);
+	INIT_DELAYED_WORK(&mdp5_data->adfps.work, __adfps_work);
 	mdp5_data->hw_refresh = true;
 	mdp5_data->cursor_ndx[CURSOR_PIPE_LEFT] = MSMFB_NEW_REQUEST;
 	mdp5_data->cursor_ndx[CURSOR_PIPE_RIGHT] = MSMFB_NEW_REQUEST;
@@ -99,6 +99,46 @@ static inline u32 mdss_mdp_pipe_read(struct mdss_mdp_pipe *pipe, u32 reg)
 	return readl_relaxed(pipe->base + reg);
 }
 
+/**
+ * mdss_mdp_pipe_cfg_cache() - get the derived configuration cache of a pipe
+ * @pipe: pointer to a pipe
+ *
+ * The stride, SMP block count and QoS LUT of a pipe only depend on the pipe
+ * geometry and format, which rarely change between commits. Compare the
+ * current state against the signature the cache was built for and drop the
+ * cached values if anything changed.
+ */
+static struct mdss_mdp_pipe_cfg_cache *mdss_mdp_pipe_cfg_cache(
+	struct mdss_mdp_pipe *pipe)
+{
+	struct mdss_mdp_pipe_cfg_cache *cache = &pipe->cfg_cache;
+	struct mdss_mdp_pipe_cfg_sig sig;
+
+	memset(&sig, 0, sizeof(sig));
+	sig.src_fmt = pipe->src_fmt;
+	sig.mixer = pipe->mixer_left;
+	sig.src = pipe->src;
+	sig.flags = pipe->flags;
+	sig.bwc_mode = pipe->bwc_mode;
+	sig.horz_deci = pipe->horz_deci;
+	sig.vert_deci = pipe->vert_deci;
+
+	if (pipe->mixer_left) {
+		sig.mixer_width = pipe->mixer_left->width;
+		sig.mixer_type = pipe->mixer_left->type;
+		sig.rotator_mode = pipe->mixer_left->rotator_mode;
+		if (pipe->mixer_left->ctl)
+			sig.intf_num = pipe->mixer_left->ctl->intf_num;
+	}
+
+	if (memcmp(&sig, &cache->sig, sizeof(sig))) {
+		memset(cache, 0, sizeof(*cache));
+		cache->sig = sig;
+	}
+
+	return cache;
+}
+
 static inline int mdss_calc_fill_level(struct mdss_mdp_format_params *fmt,
 	u32 src_width)
 {
@@ -171,10 +211,14 @@ static inline u32 get_qos_lut_macrotile(u32 total_fl)
 static void mdss_mdp_pipe_qos_lut(struct mdss_mdp_pipe *pipe)
 {
 	struct mdss_mdp_ctl *ctl = pipe->mixer_left->ctl;
+	struct mdss_mdp_pipe_cfg_cache *cache = mdss_mdp_pipe_cfg_cache(pipe);
 	u32 qos_lut;
 	u32 total_fl = 0;
 
-	if ((ctl->intf_num == MDSS_MDP_NO_INTF) ||
+	if (cache->qos_valid) {
+		qos_lut = cache->qos_lut;
+		total_fl = cache->total_fl;
+	} else if ((ctl->intf_num == MDSS_MDP_NO_INTF) ||
 			pipe->mixer_left->rotator_mode) {
 		qos_lut = QOS_LUT_NRT_READ; /* low priority for nrt */
 	} else {
@@ -187,6 +231,10 @@ static void mdss_mdp_pipe_qos_lut(struct mdss_mdp_pipe *pipe)
 			qos_lut = get_qos_lut_macrotile(total_fl);
 	}
 
+	cache->qos_lut = qos_lut;
+	cache->total_fl = total_fl;
+	cache->qos_valid = true;
+
 	trace_mdp_perf_set_qos_luts(pipe->num, pipe->src_fmt->format,
 		ctl->intf_num, pipe->mixer_left->rotator_mode, total_fl,
 		qos_lut, mdss_mdp_is_linear_format(pipe->src_fmt));
@@ -499,9 +547,15 @@ u32 mdss_mdp_smp_calc_num_blocks(struct mdss_mdp_pipe *pipe)
 	int rc = 0;
 	int i, num_blks = 0;
 	struct mdss_data_type *mdata = mdss_mdp_get_mdata();
+	struct mdss_mdp_pipe_cfg_cache *cache;
+
 	if (mdata->has_pixel_ram)
 		return 0;
 
+	cache = mdss_mdp_pipe_cfg_cache(pipe);
+	if (cache->blks_valid)
+		return cache->num_blks;
+
 	rc = mdss_mdp_calc_stride(pipe, &ps);
 	if (rc) {
 		pr_err("wrong stride calc\n");
@@ -517,6 +571,9 @@ u32 mdss_mdp_smp_calc_num_blocks(struct mdss_mdp_pipe *pipe)
 
 	pr_debug("SMP blks %d mb_cnt for pnum=%d\n",
 		num_blks, pipe->num);
+
+	cache->num_blks = num_blks;
+	cache->blks_valid = true;
 	return num_blks;
 }
 
@@ -655,7 +712,7 @@ void mdss_mdp_smp_unreserve(struct mdss_mdp_pipe *pipe)
 	mutex_unlock(&mdss_mdp_smp_lock);
 }
 
-static int mdss_mdp_calc_stride(struct mdss_mdp_pipe *pipe,
+static int __mdss_mdp_calc_stride(struct mdss_mdp_pipe *pipe,
 	struct mdss_mdp_plane_sizes *ps)
 {
 	struct mdss_data_type *mdata = mdss_mdp_get_mdata();
@@ -742,6 +799,23 @@ static int mdss_mdp_calc_stride(struct mdss_mdp_pipe *pipe,
 	return rc;
 }
 
+static int mdss_mdp_calc_stride(struct mdss_mdp_pipe *pipe,
+	struct mdss_mdp_plane_sizes *ps)
+{
+	struct mdss_mdp_pipe_cfg_cache *cache = mdss_mdp_pipe_cfg_cache(pipe);
+	int rc;
+
+	if (!cache->stride_valid) {
+		rc = __mdss_mdp_calc_stride(pipe, &cache->ps);
+		if (rc)
+			return rc;
+		cache->stride_valid = true;
+	}
+
+	*ps = cache->ps;
+	return 0;
+}
+
 static u32 mdss_mdp_calc_per_plane_num_blks(u32 ystride,
 	struct mdss_mdp_pipe *pipe)
 {
@@ -1118,6 +1192,7 @@ static void mdss_mdp_init_pipe_params(struct mdss_mdp_pipe *pipe)
 	pipe->mixer_stage = MDSS_MDP_STAGE_UNUSED;
 	memset(&pipe->scaler, 0, sizeof(struct mdp_scale_data));
 	memset(&pipe->layer, 0, sizeof(struct mdp_input_layer));
+	memset(&pipe->cfg_cache, 0, sizeof(pipe->cfg_cache));
 
 	pipe->multirect.mode = MDSS_MDP_PIPE_MULTIRECT_NONE;
 }
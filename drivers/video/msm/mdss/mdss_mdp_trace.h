@@ -376,6 +376,26 @@ TRACE_EVENT(mdp_cmd_wait_pingpong,
 			__entry->kickoff_cnt)
 );
 
+TRACE_EVENT(mdp_frame_latency,
+	TP_PROTO(u32 fb_num, u32 commit_us, u32 kickoff_us, u32 fence_us),
+	TP_ARGS(fb_num, commit_us, kickoff_us, fence_us),
+	TP_STRUCT__entry(
+			__field(u32, fb_num)
+			__field(u32, commit_us)
+			__field(u32, kickoff_us)
+			__field(u32, fence_us)
+	),
+	TP_fast_assign(
+			__entry->fb_num = fb_num;
+			__entry->commit_us = commit_us;
+			__entry->kickoff_us = kickoff_us;
+			__entry->fence_us = fence_us;
+	),
+	TP_printk("fb%d commit:%uus kickoff:%uus fence:%uus",
+			__entry->fb_num, __entry->commit_us,
+			__entry->kickoff_us, __entry->fence_us)
+);
+
 TRACE_EVENT(tracing_mark_write,
 	TP_PROTO(int pid, const char *name, bool trace_begin),
 	TP_ARGS(pid, name, trace_begin),
@@ -238,6 +238,24 @@ void mdss_mdp_intersect_rect(struct mdss_rect *res_rect,
 		*res_rect = (struct mdss_rect){l, t, (r-l), (b-t)};
 }
 
+/*
+ * mdss_mdp_union_rect() - bounding box of two rects
+ * @res_rect - resulting rect, may alias either input
+ * @rect1 - rect value to merge
+ * @rect2 - rect value to merge
+ */
+void mdss_mdp_union_rect(struct mdss_rect *res_rect,
+	const struct mdss_rect *rect1,
+	const struct mdss_rect *rect2)
+{
+	int l = min(rect1->x, rect2->x);
+	int t = min(rect1->y, rect2->y);
+	int r = max((rect1->x + rect1->w), (rect2->x + rect2->w));
+	int b = max((rect1->y + rect1->h), (rect2->y + rect2->h));
+
+	*res_rect = (struct mdss_rect){l, t, (r-l), (b-t)};
+}
+
 void mdss_mdp_crop_rect(struct mdss_rect *src_rect,
 	struct mdss_rect *dst_rect,
 	const struct mdss_rect *sci_rect)
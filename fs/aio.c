@@ -46,9 +46,10 @@
 
 #include "internal.h"
 
-#define AIO_RING_MAGIC			0xa10a10a1
-#define AIO_RING_COMPAT_FEATURES	1
+#define AIO_RING_COMPAT_FEATURES	(1 | AIO_RING_COMPAT_USER_POLL)
 #define AIO_RING_INCOMPAT_FEATURES	0
+
+/* Must match struct aio_ring_header, that userspace polls */
 struct aio_ring {
 	unsigned	id;	/* kernel internal index number */
 	unsigned	nr;	/* number of io_events */
@@ -464,6 +465,13 @@ static int aio_setup_ring(struct kioctx *ctx)
 	ctx->user_id = ctx->mmap_base;
 	ctx->nr_events = nr_events; /* trusted copy */
 
+	BUILD_BUG_ON(offsetof(struct aio_ring, head) !=
+		     offsetof(struct aio_ring_header, head));
+	BUILD_BUG_ON(offsetof(struct aio_ring, tail) !=
+		     offsetof(struct aio_ring_header, tail));
+	BUILD_BUG_ON(offsetof(struct aio_ring, header_length) !=
+		     offsetof(struct aio_ring_header, header_length));
+
 	ring = kmap_atomic(ctx->ring_pages[0]);
 	ring->nr = nr_events;	/* user copy */
 	ring->id = ~0U;
@@ -1584,12 +1592,16 @@ out_put_req:
 	return ret;
 }
 
+/* iocb pointers fetched from userspace at a time by io_submit() */
+#define AIO_SUBMIT_BATCH	16
+
 long do_io_submit(aio_context_t ctx_id, long nr,
 		  struct iocb __user *__user *iocbpp, bool compat)
 {
+	struct iocb __user *user_iocbs[AIO_SUBMIT_BATCH];
 	struct kioctx *ctx;
 	long ret = 0;
-	int i = 0;
+	int i = 0, j, batch = 0;
 	struct blk_plug plug;
 
 	if (unlikely(nr < 0))
@@ -1613,14 +1625,25 @@ long do_io_submit(aio_context_t ctx_id, long nr,
 	 * AKPM: should this return a partial result if some of the IOs were
 	 * successfully submitted?
 	 */
-	for (i=0; i<nr; i++) {
+	for (i=0, j=0; i<nr; i++, j++) {
 		struct iocb __user *user_iocb;
 		struct iocb tmp;
 
-		if (unlikely(__get_user(user_iocb, iocbpp + i))) {
-			ret = -EFAULT;
-			break;
+		/* one user copy per batch of pointers rather than per iocb */
+		if (j == batch) {
+			unsigned long left;
+
+			batch = min_t(long, nr - i, AIO_SUBMIT_BATCH);
+			left = __copy_from_user(user_iocbs, iocbpp + i,
+						batch * sizeof(*user_iocbs));
+			batch -= DIV_ROUND_UP(left, sizeof(*user_iocbs));
+			j = 0;
+			if (unlikely(!batch)) {
+				ret = -EFAULT;
+				break;
+			}
 		}
+		user_iocb = user_iocbs[j];
 
 		if (unlikely(copy_from_user(&tmp, user_iocb, sizeof(tmp)))) {
 			ret = -EFAULT;
@@ -39,6 +39,10 @@
 #include <linux/ratelimit.h>
 #include <linux/list_lru.h>
 #include <linux/kasan.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/sysctl.h>
+#include <linux/workqueue.h>
 
 #include "internal.h"
 #include "mount.h"
@@ -84,6 +88,13 @@
 int sysctl_vfs_cache_pressure __read_mostly = 100;
 EXPORT_SYMBOL_GPL(sysctl_vfs_cache_pressure);
 
+/*
+ * Most unused negative dentries a superblock may keep, 0 for no limit.
+ * Lookups of names that don't exist would otherwise grow the dcache until
+ * memory pressure, and push out the dentries positive lookups need.
+ */
+unsigned long sysctl_negative_dentry_limit __read_mostly;
+
 __cacheline_aligned_in_smp DEFINE_SEQLOCK(rename_lock);
 
 EXPORT_SYMBOL(rename_lock);
@@ -364,20 +375,33 @@ static void dentry_unlink_inode(struct dentry * dentry)
  * rules. d_lock must be held by the caller.
  */
 #define D_FLAG_VERIFY(dentry,x) WARN_ON_ONCE(((dentry)->d_flags & (DCACHE_LRU_LIST | DCACHE_SHRINK_LIST)) != (x))
+static inline struct list_lru *d_lru_list(struct dentry *dentry)
+{
+	if (dentry->d_flags & DCACHE_NEGATIVE_LRU)
+		return &dentry->d_sb->s_dentry_neg_lru;
+	return &dentry->d_sb->s_dentry_lru;
+}
+
+static void d_neg_lru_check(struct super_block *sb);
+
 static void d_lru_add(struct dentry *dentry)
 {
 	D_FLAG_VERIFY(dentry, 0);
 	dentry->d_flags |= DCACHE_LRU_LIST;
+	if (d_is_negative(dentry))
+		dentry->d_flags |= DCACHE_NEGATIVE_LRU;
 	this_cpu_inc(nr_dentry_unused);
-	WARN_ON_ONCE(!list_lru_add(&dentry->d_sb->s_dentry_lru, &dentry->d_lru));
+	WARN_ON_ONCE(!list_lru_add(d_lru_list(dentry), &dentry->d_lru));
+	if (dentry->d_flags & DCACHE_NEGATIVE_LRU)
+		d_neg_lru_check(dentry->d_sb);
 }
 
 static void d_lru_del(struct dentry *dentry)
 {
 	D_FLAG_VERIFY(dentry, DCACHE_LRU_LIST);
-	dentry->d_flags &= ~DCACHE_LRU_LIST;
+	WARN_ON_ONCE(!list_lru_del(d_lru_list(dentry), &dentry->d_lru));
+	dentry->d_flags &= ~(DCACHE_LRU_LIST | DCACHE_NEGATIVE_LRU);
 	this_cpu_dec(nr_dentry_unused);
-	WARN_ON_ONCE(!list_lru_del(&dentry->d_sb->s_dentry_lru, &dentry->d_lru));
 }
 
 static void d_shrink_del(struct dentry *dentry)
@@ -405,7 +429,7 @@ static void d_shrink_add(struct dentry *dentry, struct list_head *list)
 static void d_lru_isolate(struct dentry *dentry)
 {
 	D_FLAG_VERIFY(dentry, DCACHE_LRU_LIST);
-	dentry->d_flags &= ~DCACHE_LRU_LIST;
+	dentry->d_flags &= ~(DCACHE_LRU_LIST | DCACHE_NEGATIVE_LRU);
 	this_cpu_dec(nr_dentry_unused);
 	list_del_init(&dentry->d_lru);
 }
@@ -413,6 +437,7 @@ static void d_lru_isolate(struct dentry *dentry)
 static void d_lru_shrink_move(struct dentry *dentry, struct list_head *list)
 {
 	D_FLAG_VERIFY(dentry, DCACHE_LRU_LIST);
+	dentry->d_flags &= ~DCACHE_NEGATIVE_LRU;
 	dentry->d_flags |= DCACHE_SHRINK_LIST;
 	list_move_tail(&dentry->d_lru, list);
 }
@@ -1069,12 +1094,53 @@ long prune_dcache_sb(struct super_block *sb, unsigned long nr_to_scan,
 	LIST_HEAD(dispose);
 	long freed;
 
-	freed = list_lru_walk_node(&sb->s_dentry_lru, nid, dentry_lru_isolate,
+	/* Unused negative dentries are the cheapest to lose, go first */
+	freed = list_lru_walk_node(&sb->s_dentry_neg_lru, nid,
+				   dentry_lru_isolate, &dispose, &nr_to_scan);
+	freed += list_lru_walk_node(&sb->s_dentry_lru, nid, dentry_lru_isolate,
 				       &dispose, &nr_to_scan);
 	shrink_dentry_list(&dispose);
 	return freed;
 }
 
+/*
+ * Trimming a superblock over its negative dentry budget can end up freeing
+ * parents and inodes, so it is not done from d_lru_add() with d_lock held
+ * and whatever locks dput()'s caller has: a work item does it instead.
+ */
+#define NEG_DENTRY_TRIM_BATCH	64
+
+static void d_neg_lru_trim_sb(struct super_block *sb, void *arg)
+{
+	unsigned long limit = sysctl_negative_dentry_limit;
+	unsigned long count = list_lru_count(&sb->s_dentry_neg_lru);
+	LIST_HEAD(dispose);
+
+	if (!limit || count <= limit)
+		return;
+
+	/* a little below the limit, not to come back for every new one */
+	list_lru_walk(&sb->s_dentry_neg_lru, dentry_lru_isolate, &dispose,
+		      count - limit + NEG_DENTRY_TRIM_BATCH);
+	shrink_dentry_list(&dispose);
+}
+
+static void d_neg_lru_trim(struct work_struct *work)
+{
+	iterate_supers(d_neg_lru_trim_sb, NULL);
+}
+
+static DECLARE_WORK(d_neg_lru_trim_work, d_neg_lru_trim);
+
+static void d_neg_lru_check(struct super_block *sb)
+{
+	unsigned long limit = sysctl_negative_dentry_limit;
+
+	if (unlikely(limit) &&
+	    list_lru_count(&sb->s_dentry_neg_lru) > limit + NEG_DENTRY_TRIM_BATCH)
+		schedule_work(&d_neg_lru_trim_work);
+}
+
 static enum lru_status dentry_lru_isolate_shrink(struct list_head *item,
 						spinlock_t *lru_lock, void *arg)
 {
@@ -1110,9 +1176,12 @@ void shrink_dcache_sb(struct super_block *sb)
 
 		list_lru_walk(&sb->s_dentry_lru,
 			dentry_lru_isolate_shrink, &dispose, 1024);
+		list_lru_walk(&sb->s_dentry_neg_lru,
+			dentry_lru_isolate_shrink, &dispose, 1024);
 		shrink_dentry_list(&dispose);
 		cond_resched();
-	} while (list_lru_count(&sb->s_dentry_lru) > 0);
+	} while (list_lru_count(&sb->s_dentry_lru) > 0 ||
+		 list_lru_count(&sb->s_dentry_neg_lru) > 0);
 }
 EXPORT_SYMBOL(shrink_dcache_sb);
 
@@ -3475,6 +3544,70 @@ static void __init dcache_init(void)
 		INIT_HLIST_BL_HEAD(dentry_hashtable + loop);
 }
 
+static struct ctl_table dcache_sysctls[] = {
+	{
+		.procname	= "negative_dentry_limit",
+		.data		= &sysctl_negative_dentry_limit,
+		.maxlen		= sizeof(sysctl_negative_dentry_limit),
+		.mode		= 0644,
+		.proc_handler	= proc_doulongvec_minmax,
+	},
+	{ }
+};
+
+#ifdef CONFIG_DEBUG_FS
+static const char * const rcuwalk_fallback_names[RCUWALK_FALLBACK_NR] = {
+	[RCUWALK_DCACHE_MISS]	= "dcache_miss",
+	[RCUWALK_REVALIDATE]	= "revalidate",
+	[RCUWALK_PERMISSION]	= "permission",
+	[RCUWALK_SYMLINK]	= "symlink",
+	[RCUWALK_LAST]		= "last",
+	[RCUWALK_SEQ_RETRY]	= "seq_retry",
+};
+
+static void rcuwalk_stats_sb(struct super_block *sb, void *arg)
+{
+	struct seq_file *m = arg;
+	int i;
+
+	seq_printf(m, "%s %s", sb->s_id, sb->s_type->name);
+	for (i = 0; i < RCUWALK_FALLBACK_NR; i++)
+		seq_printf(m, " %s=%ld", rcuwalk_fallback_names[i],
+			   atomic_long_read(&sb->s_rcuwalk_fallback[i]));
+	seq_printf(m, " neg_unused=%lu\n",
+		   list_lru_count(&sb->s_dentry_neg_lru));
+}
+
+static int rcuwalk_stats_show(struct seq_file *m, void *v)
+{
+	iterate_supers(rcuwalk_stats_sb, m);
+	return 0;
+}
+
+static int rcuwalk_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, rcuwalk_stats_show, NULL);
+}
+
+static const struct file_operations rcuwalk_stats_fops = {
+	.open		= rcuwalk_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
+
+static int __init dcache_sysctl_init(void)
+{
+	register_sysctl("fs", dcache_sysctls);
+#ifdef CONFIG_DEBUG_FS
+	debugfs_create_file("rcuwalk_stats", S_IRUSR, NULL, NULL,
+			    &rcuwalk_stats_fops);
+#endif
+	return 0;
+}
+fs_initcall(dcache_sysctl_init);
+
 /* SLAB cache for __getname() consumers */
 struct kmem_cache *names_cachep __read_mostly;
 EXPORT_SYMBOL(names_cachep);
@@ -23,9 +23,17 @@
 #include <linux/notifier.h>
 #include <linux/reboot.h>
 #include <linux/writeback.h>
-
-#define DYN_FSYNC_VERSION_MAJOR 1
-#define DYN_FSYNC_VERSION_MINOR 5
+#include <linux/delay.h>
+#include <linux/dyn_sync_cntrl.h>
+#include <linux/hashtable.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+
+#define DYN_FSYNC_VERSION_MAJOR 2
+#define DYN_FSYNC_VERSION_MINOR 0
 
 /*
  * fsync_mutex protects dyn_fsync_active during power suspend / late resume
@@ -36,6 +44,164 @@ static DEFINE_MUTEX(fsync_mutex);
 bool power_suspend_active __read_mostly = true;
 bool dyn_fsync_active __read_mostly = true;
 
+/*
+ * Group commit: fsync callers of the same file join the batch that is still
+ * open on it. While a flush is in flight the next batch fills up, and its
+ * leader runs a single ->fsync() over the union of the ranges once the
+ * previous flush is done. Each caller's flush starts after the caller
+ * arrived, so durability is the same as with one fsync per caller.
+ */
+#define DYN_FSYNC_HASH_BITS 6
+
+struct dyn_fsync_batch {
+	unsigned int users;
+	loff_t start;
+	loff_t end;
+	int datasync;
+	int ret;
+	bool done;
+};
+
+struct dyn_fsync_group {
+	struct hlist_node node;
+	struct inode *inode;
+	unsigned int users;
+	bool running;			/* a flush is in flight */
+	struct dyn_fsync_batch *next;	/* batch still taking callers */
+	wait_queue_head_t wq;
+};
+
+/* protects the groups, their batches and the stats */
+static DEFINE_SPINLOCK(dyn_fsync_lock);
+static DEFINE_HASHTABLE(dyn_fsync_groups, DYN_FSYNC_HASH_BITS);
+
+/* how long a batch leader waits for more callers before flushing */
+static unsigned int dyn_fsync_window_us __read_mostly;
+
+static u64 dyn_fsync_calls;
+static u64 dyn_fsync_flushes;
+static u64 dyn_fsync_wait_ns;
+static u64 dyn_fsync_max_wait_ns;
+
+static struct dyn_fsync_group *dyn_fsync_find_group(struct inode *inode)
+{
+	struct dyn_fsync_group *g;
+
+	hash_for_each_possible(dyn_fsync_groups, g, node, (unsigned long)inode)
+		if (g->inode == inode)
+			return g;
+	return NULL;
+}
+
+int dyn_fsync_range(struct file *file, loff_t start, loff_t end, int datasync)
+{
+	struct inode *inode = file->f_mapping->host;
+	struct dyn_fsync_group *g, *new_g;
+	struct dyn_fsync_batch *b, *new_b;
+	bool leader = false, free_b = false, free_g = false;
+	u64 t0, delta;
+	int ret;
+
+	new_g = kmalloc(sizeof(*new_g), GFP_KERNEL);
+	new_b = kmalloc(sizeof(*new_b), GFP_KERNEL);
+	if (!new_g || !new_b) {
+		kfree(new_g);
+		kfree(new_b);
+		return file->f_op->fsync(file, start, end, datasync);
+	}
+
+	t0 = ktime_get_ns();
+
+	spin_lock(&dyn_fsync_lock);
+	g = dyn_fsync_find_group(inode);
+	if (!g) {
+		g = new_g;
+		new_g = NULL;
+		g->inode = inode;
+		g->users = 0;
+		g->running = false;
+		g->next = NULL;
+		init_waitqueue_head(&g->wq);
+		hash_add(dyn_fsync_groups, &g->node, (unsigned long)inode);
+	}
+	g->users++;
+
+	b = g->next;
+	if (!b) {
+		b = new_b;
+		new_b = NULL;
+		b->users = 0;
+		b->start = start;
+		b->end = end;
+		b->datasync = datasync;
+		b->ret = 0;
+		b->done = false;
+		g->next = b;
+		leader = true;
+	} else {
+		b->start = min(b->start, start);
+		b->end = max(b->end, end);
+		b->datasync = b->datasync && datasync;
+	}
+	b->users++;
+	dyn_fsync_calls++;
+	spin_unlock(&dyn_fsync_lock);
+
+	kfree(new_g);
+	kfree(new_b);
+
+	if (leader) {
+		if (dyn_fsync_window_us)
+			usleep_range(dyn_fsync_window_us,
+				     dyn_fsync_window_us + dyn_fsync_window_us / 4);
+
+		spin_lock(&dyn_fsync_lock);
+		while (g->running) {
+			spin_unlock(&dyn_fsync_lock);
+			wait_event(g->wq, !ACCESS_ONCE(g->running));
+			spin_lock(&dyn_fsync_lock);
+		}
+		/* close the batch, later callers start the next one */
+		g->running = true;
+		g->next = NULL;
+		spin_unlock(&dyn_fsync_lock);
+
+		ret = file->f_op->fsync(file, b->start, b->end, b->datasync);
+
+		spin_lock(&dyn_fsync_lock);
+		b->ret = ret;
+		b->done = true;
+		g->running = false;
+		dyn_fsync_flushes++;
+		spin_unlock(&dyn_fsync_lock);
+		wake_up_all(&g->wq);
+	} else {
+		wait_event(g->wq, ACCESS_ONCE(b->done));
+	}
+
+	delta = ktime_get_ns() - t0;
+
+	spin_lock(&dyn_fsync_lock);
+	ret = b->ret;
+	dyn_fsync_wait_ns += delta;
+	if (delta > dyn_fsync_max_wait_ns)
+		dyn_fsync_max_wait_ns = delta;
+	if (!--b->users)
+		free_b = true;
+	if (!--g->users) {
+		hash_del(&g->node);
+		free_g = true;
+	}
+	spin_unlock(&dyn_fsync_lock);
+
+	if (free_b)
+		kfree(b);
+	if (free_g)
+		kfree(g);
+
+	return ret;
+}
+
 static ssize_t dyn_fsync_active_show(struct kobject *kobj,
 		struct kobj_attribute *attr, char *buf)
 {
@@ -78,6 +244,46 @@ static ssize_t dyn_fsync_powersuspend_show(struct kobject *kobj,
 	return sprintf(buf, "power suspend active: %u\n", power_suspend_active);
 }
 
+static ssize_t dyn_fsync_window_show(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", dyn_fsync_window_us);
+}
+
+static ssize_t dyn_fsync_window_store(struct kobject *kobj,
+		struct kobj_attribute *attr, const char *buf, size_t count)
+{
+	unsigned int data;
+
+	if (kstrtouint(buf, 0, &data) || data > USEC_PER_SEC / 10)
+		return -EINVAL;
+
+	dyn_fsync_window_us = data;
+	return count;
+}
+
+static ssize_t dyn_fsync_stats_show(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	u64 calls, flushes, wait_ns, max_wait_ns;
+
+	spin_lock(&dyn_fsync_lock);
+	calls = dyn_fsync_calls;
+	flushes = dyn_fsync_flushes;
+	wait_ns = dyn_fsync_wait_ns;
+	max_wait_ns = dyn_fsync_max_wait_ns;
+	spin_unlock(&dyn_fsync_lock);
+
+	return sprintf(buf, "calls: %llu\nflushes: %llu\n"
+		"calls per flush: %llu.%02llu\n"
+		"avg latency us: %llu\nmax latency us: %llu\n",
+		calls, flushes,
+		flushes ? div64_u64(calls, flushes) : 0,
+		flushes ? div64_u64(calls * 100, flushes) % 100 : 0,
+		calls ? div64_u64(wait_ns, calls * NSEC_PER_USEC) : 0,
+		div64_u64(max_wait_ns, NSEC_PER_USEC));
+}
+
 static struct kobj_attribute dyn_fsync_active_attribute = 
 	__ATTR(Dyn_fsync_active, 0660,
 		dyn_fsync_active_show,
@@ -89,11 +295,21 @@ static struct kobj_attribute dyn_fsync_version_attribute =
 static struct kobj_attribute dyn_fsync_powersuspend_attribute = 
 	__ATTR(Dyn_fsync_earlysuspend, 0444, dyn_fsync_powersuspend_show, NULL);
 
+static struct kobj_attribute dyn_fsync_window_attribute =
+	__ATTR(Dyn_fsync_window_us, 0660,
+		dyn_fsync_window_show,
+		dyn_fsync_window_store);
+
+static struct kobj_attribute dyn_fsync_stats_attribute =
+	__ATTR(Dyn_fsync_stats, 0444, dyn_fsync_stats_show, NULL);
+
 static struct attribute *dyn_fsync_active_attrs[] =
 	{
 		&dyn_fsync_active_attribute.attr,
 		&dyn_fsync_version_attribute.attr,
 		&dyn_fsync_powersuspend_attribute.attr,
+		&dyn_fsync_window_attribute.attr,
+		&dyn_fsync_stats_attribute.attr,
 		NULL,
 	};
 
@@ -23,6 +23,7 @@
 #include <linux/poll.h>
 #include <linux/string.h>
 #include <linux/list.h>
+#include <linux/llist.h>
 #include <linux/hash.h>
 #include <linux/spinlock.h>
 #include <linux/syscalls.h>
@@ -53,11 +54,14 @@
  * 3) ep->lock (spinlock)
  *
  * The acquire order is the one listed above, from 1 to 3.
- * We need a spinlock (ep->lock) because we manipulate objects
- * from inside the poll callback, that might be triggered from
- * a wake_up() that in turn might be called from IRQ context.
- * So we can't sleep inside the poll callback and hence we need
- * a spinlock. During the event transfer loop (from kernel to
+ * We need a spinlock (ep->lock) because ep_insert(), ep_modify() and
+ * the event transfer loop manipulate the ready list from contexts that
+ * can race with each other. The poll callback, which might be triggered
+ * from a wake_up() that in turn might be called from IRQ context, takes
+ * no lock at all: it pushes the item on the lockless "ep->rdlhead" list,
+ * which is moved over to the ready list under "ep->lock" by whoever
+ * consumes it next. Tasks sleeping in epoll_wait() are queued on "ep->wq"
+ * under its own wait queue lock. During the event transfer loop (from kernel to
  * user space) we could end up sleeping due a copy_to_user(), so
  * we need a lock that will allow us to sleep. This lock is a
  * mutex (ep->mtx). It is acquired during the event transfer loop,
@@ -95,6 +99,9 @@
 /* Epoll private bits inside the event mask */
 #define EP_PRIVATE_BITS (EPOLLWAKEUP | EPOLLONESHOT | EPOLLET)
 
+/* Set in eppoll_entry->revents by a wakeup that did not say what happened */
+#define EP_REVENTS_UNKNOWN 0x80000000
+
 /* Maximum number of nesting allowed inside epoll sets */
 #define EP_MAX_NESTS 4
 
@@ -146,10 +153,10 @@ struct epitem {
 	struct list_head rdllink;
 
 	/*
-	 * Works together "struct eventpoll"->ovflist in keeping the
-	 * single linked chain of items.
+	 * Links this item to "struct eventpoll"->rdlhead. Its "next" pointer
+	 * is EP_UNACTIVE_PTR while the item is not queued there.
 	 */
-	struct epitem *next;
+	struct llist_node rdlnode;
 
 	/* The file descriptor information this item refers to */
 	struct epoll_filefd ffd;
@@ -203,11 +210,10 @@ struct eventpoll {
 	struct rb_root rbr;
 
 	/*
-	 * This is a single linked list that chains all the "struct epitem" that
-	 * happened while transferring ready events to userspace w/out
-	 * holding ->lock.
+	 * Items that became ready since the ready list was last looked at,
+	 * queued here without any lock by ep_poll_callback().
 	 */
-	struct epitem *ovflist;
+	struct llist_head rdlhead;
 
 	/* wakeup_source used when ep_scan_ready_list is running */
 	struct wakeup_source *ws;
@@ -238,6 +244,9 @@ struct eppoll_entry {
 
 	/* The wait queue head that linked the "wait" wait queue item */
 	wait_queue_head_t *whead;
+
+	/* Event masks reported by the wakeups, see ep_item_revents() */
+	atomic_t revents;
 };
 
 /* Wrapper struct used by poll queueing */
@@ -258,6 +267,9 @@ struct ep_send_events_data {
 /* Maximum number of epoll watched descriptors, per user */
 static long max_user_watches __read_mostly;
 
+/* Trust the wakeup keys of edge triggered sockets instead of re-polling */
+static int et_skip_repoll __read_mostly;
+
 /*
  * This mutex is used to serialize ep_free() and eventpoll_release_file().
  */
@@ -304,6 +316,13 @@ struct ctl_table epoll_table[] = {
 		.extra1		= &zero,
 		.extra2		= &long_max,
 	},
+	{
+		.procname	= "et_skip_repoll",
+		.data		= &et_skip_repoll,
+		.maxlen		= sizeof(et_skip_repoll),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec,
+	},
 	{ }
 };
 #endif /* CONFIG_SYSCTL */
@@ -377,7 +396,7 @@ static void ep_nested_calls_init(struct nested_calls *ncalls)
  */
 static inline int ep_events_available(struct eventpoll *ep)
 {
-	return !list_empty(&ep->rdllist) || ep->ovflist != EP_UNACTIVE_PTR;
+	return !list_empty(&ep->rdllist) || !llist_empty(&ep->rdlhead);
 }
 
 /**
@@ -582,6 +601,63 @@ static inline void ep_pm_stay_awake_rcu(struct epitem *epi)
 	rcu_read_unlock();
 }
 
+/*
+ * Moves the items queued by ep_poll_callback() over to the ready list and
+ * returns how many were moved. Must be called with "ep->lock" held.
+ *
+ * epoll_wait() checks ep_events_available() without "ep->lock", and while
+ * the batch is in flight here both lists look empty to it. A caller that
+ * is not about to consume the ready list itself must therefore wake
+ * "ep->wq" once it moved something, see ep_drain_rdlhead_remove().
+ */
+static int ep_drain_rdlhead(struct eventpoll *ep)
+{
+	struct llist_node *node, *next;
+	struct epitem *epi;
+	int moved = 0;
+
+	/* llist_del_all() hands them back newest first */
+	node = llist_reverse_order(llist_del_all(&ep->rdlhead));
+	for (; node; node = next) {
+		epi = llist_entry(node, struct epitem, rdlnode);
+		next = node->next;
+		/*
+		 * From here on ep_poll_callback() may queue the item again,
+		 * it will then just be found linked on the next drain.
+		 */
+		smp_store_release(&node->next, EP_UNACTIVE_PTR);
+
+		/*
+		 * The item might already be in the ready list, or in the
+		 * "txlist" of a scan in progress, which the list_splice() in
+		 * ep_scan_ready_list() takes care of.
+		 */
+		if (!ep_is_linked(&epi->rdllink)) {
+			list_add_tail(&epi->rdllink, &ep->rdllist);
+			ep_pm_stay_awake(epi);
+		}
+		moved++;
+	}
+
+	return moved;
+}
+
+/*
+ * Drains "ep->rdlhead" for ep_remove() and the ep_insert() error path,
+ * which do not consume the ready list, and takes "epi", which is going
+ * away, off the ready list. Must be called with "ep->lock" held.
+ */
+static void ep_drain_rdlhead_remove(struct eventpoll *ep, struct epitem *epi)
+{
+	int moved = ep_drain_rdlhead(ep);
+
+	if (ep_is_linked(&epi->rdllink))
+		list_del_init(&epi->rdllink);
+
+	if (moved && !list_empty(&ep->rdllist) && waitqueue_active(&ep->wq))
+		wake_up(&ep->wq);
+}
+
 /**
  * ep_scan_ready_list - Scans the ready list in a way that makes possible for
  *                      the scan code, to call f_op->poll(). Also allows for
@@ -602,7 +678,6 @@ static int ep_scan_ready_list(struct eventpoll *ep,
 {
 	int error, pwake = 0;
 	unsigned long flags;
-	struct epitem *epi, *nepi;
 	LIST_HEAD(txlist);
 
 	/*
@@ -615,15 +690,13 @@ static int ep_scan_ready_list(struct eventpoll *ep,
 
 	/*
 	 * Steal the ready list, and re-init the original one to the
-	 * empty list. Also, set ep->ovflist to NULL so that events
-	 * happening while looping w/out locks, are not lost. We cannot
-	 * have the poll callback to queue directly on ep->rdllist,
-	 * because we want the "sproc" callback to be able to do it
-	 * in a lockless way.
+	 * empty list. The poll callback never touches ep->rdllist, events
+	 * happening while looping w/out locks stay in ep->rdlhead, so the
+	 * "sproc" callback is able to requeue items in a lockless way.
 	 */
 	spin_lock_irqsave(&ep->lock, flags);
+	ep_drain_rdlhead(ep);
 	list_splice_init(&ep->rdllist, &txlist);
-	ep->ovflist = NULL;
 	spin_unlock_irqrestore(&ep->lock, flags);
 
 	/*
@@ -637,25 +710,7 @@ static int ep_scan_ready_list(struct eventpoll *ep,
 	 * other events might have been queued by the poll callback.
 	 * We re-insert them inside the main ready-list here.
 	 */
-	for (nepi = ep->ovflist; (epi = nepi) != NULL;
-	     nepi = epi->next, epi->next = EP_UNACTIVE_PTR) {
-		/*
-		 * We need to check if the item is already in the list.
-		 * During the "sproc" callback execution time, items are
-		 * queued into ->ovflist but the "txlist" might already
-		 * contain them, and the list_splice() below takes care of them.
-		 */
-		if (!ep_is_linked(&epi->rdllink)) {
-			list_add_tail(&epi->rdllink, &ep->rdllist);
-			ep_pm_stay_awake(epi);
-		}
-	}
-	/*
-	 * We need to set back ep->ovflist to EP_UNACTIVE_PTR, so that after
-	 * releasing the lock, events will be queued in the normal way inside
-	 * ep->rdllist.
-	 */
-	ep->ovflist = EP_UNACTIVE_PTR;
+	ep_drain_rdlhead(ep);
 
 	/*
 	 * Quickly re-inject items left on "txlist".
@@ -669,7 +724,7 @@ static int ep_scan_ready_list(struct eventpoll *ep,
 		 * the ->poll() wait list (delayed after we release the lock).
 		 */
 		if (waitqueue_active(&ep->wq))
-			wake_up_locked(&ep->wq);
+			wake_up(&ep->wq);
 		if (waitqueue_active(&ep->poll_wait))
 			pwake++;
 	}
@@ -717,9 +772,12 @@ static int ep_remove(struct eventpoll *ep, struct epitem *epi)
 
 	rb_erase(&epi->rbn, &ep->rbr);
 
+	/*
+	 * No poll callback can queue the item anymore, but an earlier one
+	 * may have left it in ep->rdlhead.
+	 */
 	spin_lock_irqsave(&ep->lock, flags);
-	if (ep_is_linked(&epi->rdllink))
-		list_del_init(&epi->rdllink);
+	ep_drain_rdlhead_remove(ep, epi);
 	spin_unlock_irqrestore(&ep->lock, flags);
 
 	wakeup_source_unregister(ep_wakeup_source(epi));
@@ -806,6 +864,43 @@ static inline unsigned int ep_item_poll(struct epitem *epi, poll_table *pt)
 	return epi->ffd.file->f_op->poll(epi->ffd.file, pt) & epi->event.events;
 }
 
+/*
+ * Forget the event masks the wakeups left on the item, the next transfer
+ * of its events has to call ->poll() again. Must be called with "mtx" held.
+ */
+static void ep_item_revents_reset(struct epitem *epi)
+{
+	struct eppoll_entry *pwq;
+
+	list_for_each_entry(pwq, &epi->pwqlist, llink)
+		atomic_set(&pwq->revents, EP_REVENTS_UNKNOWN);
+}
+
+/*
+ * Returns the events to report for an item taken off the ready list.
+ * With /proc/sys/fs/epoll/et_skip_repoll set, an edge triggered socket
+ * whose wakeups since the last transfer all came with an event mask is
+ * reported from those masks, without calling ->poll() again. Sockets
+ * always pass the mask for data and error wakeups, while the ones that
+ * do not (e.g. state changes) still get the full ->poll().
+ */
+static unsigned int ep_item_revents(struct epitem *epi, poll_table *pt)
+{
+	struct eppoll_entry *pwq;
+	unsigned int revents = 0;
+
+	if (!et_skip_repoll || !(epi->event.events & EPOLLET) ||
+	    !S_ISSOCK(file_inode(epi->ffd.file)->i_mode))
+		return ep_item_poll(epi, pt);
+
+	list_for_each_entry(pwq, &epi->pwqlist, llink)
+		revents |= atomic_xchg(&pwq->revents, 0);
+	if (!revents || (revents & EP_REVENTS_UNKNOWN))
+		return ep_item_poll(epi, pt);
+
+	return revents & epi->event.events;
+}
+
 static int ep_read_events_proc(struct eventpoll *ep, struct list_head *head,
 			       void *priv)
 {
@@ -958,8 +1053,8 @@ static int ep_alloc(struct eventpoll **pep)
 	init_waitqueue_head(&ep->wq);
 	init_waitqueue_head(&ep->poll_wait);
 	INIT_LIST_HEAD(&ep->rdllist);
+	init_llist_head(&ep->rdlhead);
 	ep->rbr = RB_ROOT;
-	ep->ovflist = EP_UNACTIVE_PTR;
 	ep->user = user;
 
 	*pep = ep;
@@ -1007,12 +1102,10 @@ static struct epitem *ep_find(struct eventpoll *ep, struct file *file, int fd)
  */
 static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *key)
 {
-	int pwake = 0;
-	unsigned long flags;
+	struct eppoll_entry *pwq = ep_pwq_from_wait(wait);
 	struct epitem *epi = ep_item_from_wait(wait);
 	struct eventpoll *ep = epi->ep;
-
-	spin_lock_irqsave(&ep->lock, flags);
+	unsigned int events = ACCESS_ONCE(epi->event.events);
 
 	/*
 	 * If the event mask does not contain any poll(2) event, we consider the
@@ -1020,8 +1113,8 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 	 * EPOLLONESHOT bit that disables the descriptor when an event is received,
 	 * until the next EPOLL_CTL_MOD will be issued.
 	 */
-	if (!(epi->event.events & ~EP_PRIVATE_BITS))
-		goto out_unlock;
+	if (!(events & ~EP_PRIVATE_BITS))
+		goto out;
 
 	/*
 	 * Check the events coming with the callback. At this stage, not
@@ -1029,54 +1122,42 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 	 * callback. We need to be able to handle both cases here, hence the
 	 * test for "key" != NULL before the event match test.
 	 */
-	if (key && !((unsigned long) key & epi->event.events))
-		goto out_unlock;
+	if (key && !((unsigned long) key & events))
+		goto out;
+
+	if (et_skip_repoll && (events & EPOLLET))
+		atomic_or(key ? (unsigned long) key & events : EP_REVENTS_UNKNOWN,
+			  &pwq->revents);
 
 	/*
-	 * If we are transferring events to userspace, we can hold no locks
-	 * (because we're accessing user memory, and because of linux f_op->poll()
-	 * semantics). All the events that happen during that period of time are
-	 * chained in ep->ovflist and requeued later on.
+	 * Queue the item on the lockless list unless it is there already.
+	 * Contended wakeups of a large epoll set used to serialize on
+	 * ep->lock here; now only the consumer takes it, once per batch.
 	 */
-	if (ep->ovflist != EP_UNACTIVE_PTR) {
-		if (epi->next == EP_UNACTIVE_PTR) {
-			epi->next = ep->ovflist;
-			ep->ovflist = epi;
-			if (epi->ws) {
-				/*
-				 * Activate ep->ws since epi->ws may get
-				 * deactivated at any time.
-				 */
-				__pm_stay_awake(ep->ws);
-			}
-
+	if (cmpxchg(&epi->rdlnode.next, EP_UNACTIVE_PTR, NULL) ==
+	    EP_UNACTIVE_PTR) {
+		llist_add(&epi->rdlnode, &ep->rdlhead);
+		if (ep_has_wakeup_source(epi)) {
+			/*
+			 * Activate ep->ws too since epi->ws may get
+			 * deactivated at any time by a scan in progress.
+			 */
+			ep_pm_stay_awake_rcu(epi);
+			__pm_stay_awake(ep->ws);
 		}
-		goto out_unlock;
-	}
-
-	/* If this file is already in the ready list we exit soon */
-	if (!ep_is_linked(&epi->rdllink)) {
-		list_add_tail(&epi->rdllink, &ep->rdllist);
-		ep_pm_stay_awake_rcu(epi);
 	}
 
 	/*
 	 * Wake up ( if active ) both the eventpoll wait list and the ->poll()
-	 * wait list.
+	 * wait list. The llist_add() above is a full barrier, it pairs with
+	 * set_current_state() in ep_poll().
 	 */
 	if (waitqueue_active(&ep->wq))
-		wake_up_locked(&ep->wq);
+		wake_up(&ep->wq);
 	if (waitqueue_active(&ep->poll_wait))
-		pwake++;
-
-out_unlock:
-	spin_unlock_irqrestore(&ep->lock, flags);
-
-	/* We have to call this outside the lock */
-	if (pwake)
 		ep_poll_safewake(&ep->poll_wait);
 
-
+out:
 	if ((unsigned long)key & POLLFREE) {
 		/*
 		 * If we race with ep_remove_wait_queue() it can miss
@@ -1110,6 +1191,7 @@ static void ep_ptable_queue_proc(struct file *file, wait_queue_head_t *whead,
 		init_waitqueue_func_entry(&pwq->wait, ep_poll_callback);
 		pwq->whead = whead;
 		pwq->base = epi;
+		atomic_set(&pwq->revents, EP_REVENTS_UNKNOWN);
 		add_wait_queue(whead, &pwq->wait);
 		list_add_tail(&pwq->llink, &epi->pwqlist);
 		epi->nwait++;
@@ -1299,7 +1381,7 @@ static int ep_insert(struct eventpoll *ep, struct epoll_event *event,
 	ep_set_ffd(&epi->ffd, tfile, fd);
 	epi->event = *event;
 	epi->nwait = 0;
-	epi->next = EP_UNACTIVE_PTR;
+	epi->rdlnode.next = EP_UNACTIVE_PTR;
 	if (epi->event.events & EPOLLWAKEUP) {
 		error = ep_create_wakeup_source(epi);
 		if (error)
@@ -1351,12 +1433,13 @@ static int ep_insert(struct eventpoll *ep, struct epoll_event *event,
 
 	/* If the file is already "ready" we drop it inside the ready list */
 	if ((revents & event->events) && !ep_is_linked(&epi->rdllink)) {
+		ep_item_revents_reset(epi);
 		list_add_tail(&epi->rdllink, &ep->rdllist);
 		ep_pm_stay_awake(epi);
 
 		/* Notify waiting tasks that events are available */
 		if (waitqueue_active(&ep->wq))
-			wake_up_locked(&ep->wq);
+			wake_up(&ep->wq);
 		if (waitqueue_active(&ep->poll_wait))
 			pwake++;
 	}
@@ -1382,13 +1465,10 @@ error_remove_epi:
 
 	/*
 	 * We need to do this because an event could have been arrived on some
-	 * allocated wait queue. Note that we don't care about the ep->ovflist
-	 * list, since that is used/cleaned only inside a section bound by "mtx".
-	 * And ep_insert() is called with "mtx" held.
+	 * allocated wait queue.
 	 */
 	spin_lock_irqsave(&ep->lock, flags);
-	if (ep_is_linked(&epi->rdllink))
-		list_del_init(&epi->rdllink);
+	ep_drain_rdlhead_remove(ep, epi);
 	spin_unlock_irqrestore(&ep->lock, flags);
 
 	wakeup_source_unregister(ep_wakeup_source(epi));
@@ -1432,8 +1512,8 @@ static int ep_modify(struct eventpoll *ep, struct epitem *epi, struct epoll_even
 	 *    we do not miss events from ep_poll_callback if an
 	 *    event occurs immediately after we call f_op->poll().
 	 *    We need this because we did not take ep->lock while
-	 *    changing epi above (but ep_poll_callback does take
-	 *    ep->lock).
+	 *    changing epi above (and ep_poll_callback takes no
+	 *    lock of ours at all).
 	 *
 	 * 2) We also need to ensure we do not miss _past_ events
 	 *    when calling f_op->poll().  This barrier also
@@ -1456,6 +1536,7 @@ static int ep_modify(struct eventpoll *ep, struct epitem *epi, struct epoll_even
 	 * list, push it inside.
 	 */
 	if (revents & event->events) {
+		ep_item_revents_reset(epi);
 		spin_lock_irq(&ep->lock);
 		if (!ep_is_linked(&epi->rdllink)) {
 			list_add_tail(&epi->rdllink, &ep->rdllist);
@@ -1463,7 +1544,7 @@ static int ep_modify(struct eventpoll *ep, struct epitem *epi, struct epoll_even
 
 			/* Notify waiting tasks that events are available */
 			if (waitqueue_active(&ep->wq))
-				wake_up_locked(&ep->wq);
+				wake_up(&ep->wq);
 			if (waitqueue_active(&ep->poll_wait))
 				pwake++;
 		}
@@ -1517,7 +1598,7 @@ static int ep_send_events_proc(struct eventpoll *ep, struct list_head *head,
 
 		list_del_init(&epi->rdllink);
 
-		revents = ep_item_poll(epi, &pt);
+		revents = ep_item_revents(epi, &pt);
 
 		/*
 		 * If the event mask intersect the caller-requested one,
@@ -1528,6 +1609,7 @@ static int ep_send_events_proc(struct eventpoll *ep, struct list_head *head,
 		if (revents) {
 			if (__put_user(revents, &uevent->events) ||
 			    __put_user(epi->event.data, &uevent->data)) {
+				ep_item_revents_reset(epi);
 				list_add(&epi->rdllink, head);
 				ep_pm_stay_awake(epi);
 				return eventcnt ? eventcnt : -EFAULT;
@@ -1546,7 +1628,7 @@ static int ep_send_events_proc(struct eventpoll *ep, struct list_head *head,
 				 * into ep->rdllist besides us. The epoll_ctl()
 				 * callers are locked out by
 				 * ep_scan_ready_list() holding "mtx" and the
-				 * poll callback will queue them in ep->ovflist.
+				 * poll callback will queue them in ep->rdlhead.
 				 */
 				list_add_tail(&epi->rdllink, &ep->rdllist);
 				ep_pm_stay_awake(epi);
@@ -1617,12 +1699,11 @@ static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 		 * caller specified a non blocking operation.
 		 */
 		timed_out = 1;
-		spin_lock_irqsave(&ep->lock, flags);
 		goto check_events;
 	}
 
 fetch_events:
-	spin_lock_irqsave(&ep->lock, flags);
+	spin_lock_irqsave(&ep->wq.lock, flags);
 
 	if (!ep_events_available(ep)) {
 		/*
@@ -1647,23 +1728,22 @@ fetch_events:
 				break;
 			}
 
-			spin_unlock_irqrestore(&ep->lock, flags);
+			spin_unlock_irqrestore(&ep->wq.lock, flags);
 			if (!freezable_schedule_hrtimeout_range(to, slack,
 								HRTIMER_MODE_ABS))
 				timed_out = 1;
 
-			spin_lock_irqsave(&ep->lock, flags);
+			spin_lock_irqsave(&ep->wq.lock, flags);
 		}
 		__remove_wait_queue(&ep->wq, &wait);
 
 		set_current_state(TASK_RUNNING);
 	}
+	spin_unlock_irqrestore(&ep->wq.lock, flags);
 check_events:
 	/* Is it worth to try to dig for events ? */
 	eavail = ep_events_available(ep);
 
-	spin_unlock_irqrestore(&ep->lock, flags);
-
 	/*
 	 * Try to transfer events to user space. In case we get 0 events and
 	 * there's still timeout left over, we go trying again in search of
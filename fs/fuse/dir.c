@@ -1441,12 +1441,26 @@ static int fuse_readdir(struct file *file, struct dir_context *ctx)
 	struct page *page;
 	struct inode *inode = file_inode(file);
 	struct fuse_conn *fc = get_fuse_conn(inode);
+	struct fuse_file *ff = file->private_data;
 	struct fuse_req *req;
 	u64 attr_version = 0;
 
 	if (is_bad_inode(inode))
 		return -EIO;
 
+	if (ff->shortcircuit_enabled && ff->rw_lower_file) {
+		/*
+		 * The daemon revoked the lower listing with
+		 * FUSE_NOTIFY_INVAL_INODE. Offsets of the two listings don't
+		 * mix, so switch over at the next rewind only.
+		 */
+		if (ctx->pos == 0 &&
+		    ff->dir_sc_gen != atomic_read(&get_fuse_inode(inode)->dir_sc_gen))
+			fuse_shortcircuit_release(ff);
+		else
+			return fuse_shortcircuit_readdir(file, ctx);
+	}
+
 	req = fuse_get_req(fc, 1);
 	if (IS_ERR(req))
 		return PTR_ERR(req);
@@ -1542,7 +1556,14 @@ static void fuse_put_link(struct dentry *dentry, struct nameidata *nd, void *c)
 
 static int fuse_dir_open(struct inode *inode, struct file *file)
 {
-	return fuse_open_common(inode, file, true);
+	/* read before OPENDIR, an invalidation racing with it revokes */
+	int gen = atomic_read(&get_fuse_inode(inode)->dir_sc_gen);
+	int err;
+
+	err = fuse_open_common(inode, file, true);
+	if (!err)
+		((struct fuse_file *)file->private_data)->dir_sc_gen = gen;
+	return err;
 }
 
 static int fuse_dir_release(struct inode *inode, struct file *file)
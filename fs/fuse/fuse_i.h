@@ -109,6 +109,9 @@ struct fuse_inode {
 
 	/** Miscellaneous bits describing inode state */
 	unsigned long state;
+
+	/** Bumped by FUSE_NOTIFY_INVAL_INODE, revokes shortcircuit readdir */
+	atomic_t dir_sc_gen;
 };
 
 /** FUSE inode state bits */
@@ -161,6 +164,9 @@ struct fuse_file {
 	/* the read write file */
 	struct file *rw_lower_file;
 	bool shortcircuit_enabled;
+
+	/* fuse_inode dir_sc_gen seen before OPENDIR was sent */
+	int dir_sc_gen;
 };
 
 /** One input argument of a request */
@@ -26,6 +26,14 @@ ssize_t fuse_shortcircuit_read_iter(struct kiocb *iocb, struct iov_iter *to);
 
 ssize_t fuse_shortcircuit_write_iter(struct kiocb *iocb, struct iov_iter *from);
 
+ssize_t fuse_shortcircuit_splice_read(struct file *file, loff_t *ppos,
+				      struct pipe_inode_info *pipe,
+				      size_t len, unsigned int flags);
+
+int fuse_shortcircuit_mmap(struct file *file, struct vm_area_struct *vma);
+
+int fuse_shortcircuit_readdir(struct file *file, struct dir_context *ctx);
+
 void fuse_shortcircuit_release(struct fuse_file *ff);
 
 #endif /* _FS_FUSE_SHORCIRCUIT_H */
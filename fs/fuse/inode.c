@@ -93,6 +93,7 @@ static struct inode *fuse_alloc_inode(struct super_block *sb)
 	fi->writectr = 0;
 	fi->orig_ino = 0;
 	fi->state = 0;
+	atomic_set(&fi->dir_sc_gen, 0);
 	INIT_LIST_HEAD(&fi->write_files);
 	INIT_LIST_HEAD(&fi->queued_writes);
 	INIT_LIST_HEAD(&fi->writepages);
@@ -339,6 +340,8 @@ int fuse_reverse_inval_inode(struct super_block *sb, u64 nodeid,
 		return -ENOENT;
 
 	fuse_invalidate_attr(inode);
+	if (S_ISDIR(inode->i_mode))
+		atomic_inc(&get_fuse_inode(inode)->dir_sc_gen);
 	if (offset >= 0) {
 		pg_start = offset >> PAGE_CACHE_SHIFT;
 		if (len <= 0)
@@ -30,7 +30,8 @@ void fuse_setup_shortcircuit(struct fuse_conn *fc, struct fuse_req *req)
 		return;
 
 	if ((req->in.h.opcode != FUSE_OPEN) &&
-	    (req->in.h.opcode != FUSE_CREATE))
+	    (req->in.h.opcode != FUSE_CREATE) &&
+	    (req->in.h.opcode != FUSE_OPENDIR))
 		return;
 
 	open_out_index = req->in.numargs - 1;
@@ -40,6 +41,11 @@ void fuse_setup_shortcircuit(struct fuse_conn *fc, struct fuse_req *req)
 
 	open_out = req->out.args[open_out_index].value;
 
+	/* older daemons leave lower_fd zeroed in OPENDIR replies */
+	if ((req->in.h.opcode == FUSE_OPENDIR) &&
+	    !(open_out->open_flags & FOPEN_SHORTCIRCUIT_DIR))
+		return;
+
 	daemon_fd = (int)open_out->lower_fd;
 	if (daemon_fd < 0)
 		return;
@@ -107,6 +113,67 @@ ssize_t fuse_shortcircuit_write_iter(struct kiocb *iocb, struct iov_iter *from)
 	return fuse_shortcircuit_read_write_iter(iocb, from, 1);
 }
 
+ssize_t fuse_shortcircuit_splice_read(struct file *file, loff_t *ppos,
+				      struct pipe_inode_info *pipe,
+				      size_t len, unsigned int flags)
+{
+	ssize_t ret_val;
+	struct fuse_file *ff = file->private_data;
+	struct file *lower_file = ff->rw_lower_file;
+
+	if (!lower_file->f_op->splice_read)
+		return default_file_splice_read(lower_file, ppos, pipe,
+						len, flags);
+
+	ret_val = lower_file->f_op->splice_read(lower_file, ppos, pipe,
+						len, flags);
+	if (ret_val >= 0)
+		fsstack_copy_attr_atime(file_inode(file),
+					file_inode(lower_file));
+	return ret_val;
+}
+
+int fuse_shortcircuit_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	int ret_val;
+	struct fuse_file *ff = file->private_data;
+	struct file *lower_file = ff->rw_lower_file;
+
+	if (!lower_file->f_op->mmap)
+		return -ENODEV;
+
+	/*
+	 * Map the lower file itself: faults then go to the lower
+	 * filesystem's vm_ops and page cache, not to the daemon.
+	 * mmap_region() took a reference on file for vm_file, hand it over
+	 * to the lower file on success.
+	 */
+	vma->vm_file = get_file(lower_file);
+	ret_val = lower_file->f_op->mmap(lower_file, vma);
+	if (ret_val) {
+		vma->vm_file = file;
+		fput(lower_file);
+		return ret_val;
+	}
+
+	fput(file);
+	file_accessed(file);
+	return 0;
+}
+
+int fuse_shortcircuit_readdir(struct file *file, struct dir_context *ctx)
+{
+	int ret_val;
+	struct fuse_file *ff = file->private_data;
+	struct file *lower_file = ff->rw_lower_file;
+	struct inode *fuse_inode = file_inode(file);
+
+	ret_val = iterate_dir(lower_file, ctx);
+	fsstack_copy_attr_atime(fuse_inode, file_inode(lower_file));
+
+	return ret_val;
+}
+
 void fuse_shortcircuit_release(struct fuse_file *ff)
 {
 	if (!(ff->rw_lower_file))
@@ -616,6 +616,17 @@ drop_root_mnt:
 	return -ECHILD;
 }
 
+/*
+ * Account a walk that had to leave RCU mode against the superblock it was
+ * on; read back through debugfs rcuwalk_stats.  Only called in RCU mode, so
+ * nd->path.mnt can't go away under us.
+ */
+static inline void rcuwalk_fallback(struct nameidata *nd,
+				    enum rcuwalk_fallback why)
+{
+	atomic_long_inc(&nd->path.mnt->mnt_sb->s_rcuwalk_fallback[why]);
+}
+
 static inline int d_revalidate(struct dentry *dentry, unsigned int flags)
 {
 	return dentry->d_op->d_revalidate(dentry, flags);
@@ -646,11 +657,13 @@ static int complete_walk(struct nameidata *nd)
 			return -ECHILD;
 		}
 		if (unlikely(!lockref_get_not_dead(&dentry->d_lockref))) {
+			rcuwalk_fallback(nd, RCUWALK_SEQ_RETRY);
 			rcu_read_unlock();
 			mntput(nd->path.mnt);
 			return -ECHILD;
 		}
 		if (read_seqcount_retry(&dentry->d_seq, nd->seq)) {
+			rcuwalk_fallback(nd, RCUWALK_SEQ_RETRY);
 			rcu_read_unlock();
 			dput(dentry);
 			mntput(nd->path.mnt);
@@ -1222,6 +1235,7 @@ static int follow_dotdot_rcu(struct nameidata *nd)
 	return 0;
 
 failed:
+	rcuwalk_fallback(nd, RCUWALK_SEQ_RETRY);
 	nd->flags &= ~LOOKUP_RCU;
 	if (!(nd->flags & LOOKUP_ROOT))
 		nd->root.mnt = NULL;
@@ -1426,16 +1440,20 @@ static int lookup_fast(struct nameidata *nd,
 	if (nd->flags & LOOKUP_RCU) {
 		unsigned seq;
 		dentry = __d_lookup_rcu(parent, &nd->last, &seq);
-		if (!dentry)
+		if (!dentry) {
+			rcuwalk_fallback(nd, RCUWALK_DCACHE_MISS);
 			goto unlazy;
+		}
 
 		/*
 		 * This sequence count validates that the inode matches
 		 * the dentry name information from lookup.
 		 */
 		*inode = dentry->d_inode;
-		if (read_seqcount_retry(&dentry->d_seq, seq))
+		if (read_seqcount_retry(&dentry->d_seq, seq)) {
+			rcuwalk_fallback(nd, RCUWALK_SEQ_RETRY);
 			return -ECHILD;
+		}
 
 		/*
 		 * This sequence count validates that the parent had no
@@ -1444,8 +1462,10 @@ static int lookup_fast(struct nameidata *nd,
 		 * The memory barrier in read_seqcount_begin of child is
 		 *  enough, we can use __read_seqcount_retry here.
 		 */
-		if (__read_seqcount_retry(&parent->d_seq, nd->seq))
+		if (__read_seqcount_retry(&parent->d_seq, nd->seq)) {
+			rcuwalk_fallback(nd, RCUWALK_SEQ_RETRY);
 			return -ECHILD;
+		}
 		nd->seq = seq;
 
 		if (unlikely(dentry->d_flags & DCACHE_OP_REVALIDATE)) {
@@ -1453,6 +1473,7 @@ static int lookup_fast(struct nameidata *nd,
 			if (unlikely(status <= 0)) {
 				if (status != -ECHILD)
 					need_reval = 0;
+				rcuwalk_fallback(nd, RCUWALK_REVALIDATE);
 				goto unlazy;
 			}
 		}
@@ -1530,6 +1551,7 @@ static inline int may_lookup(struct nameidata *nd)
 		int err = inode_permission2(nd->path.mnt, nd->inode, MAY_EXEC|MAY_NOT_BLOCK);
 		if (err != -ECHILD)
 			return err;
+		rcuwalk_fallback(nd, RCUWALK_PERMISSION);
 		if (unlazy_walk(nd, NULL))
 			return -ECHILD;
 	}
@@ -1600,6 +1622,7 @@ static inline int walk_component(struct nameidata *nd, struct path *path,
 
 	if (should_follow_link(path->dentry, follow)) {
 		if (nd->flags & LOOKUP_RCU) {
+			rcuwalk_fallback(nd, RCUWALK_SYMLINK);
 			if (unlikely(nd->path.mnt != path->mnt ||
 				     unlazy_walk(nd, path->dentry))) {
 				err = -ECHILD;
@@ -2276,6 +2299,7 @@ mountpoint_last(struct nameidata *nd, struct path *path)
 
 	/* If we're in rcuwalk, drop out of it to handle last component */
 	if (nd->flags & LOOKUP_RCU) {
+		rcuwalk_fallback(nd, RCUWALK_LAST);
 		if (unlazy_walk(nd, NULL)) {
 			error = -ECHILD;
 			goto out;
@@ -3067,6 +3091,7 @@ finish_lookup:
 
 	if (should_follow_link(path->dentry, !symlink_ok)) {
 		if (nd->flags & LOOKUP_RCU) {
+			rcuwalk_fallback(nd, RCUWALK_SYMLINK);
 			if (unlikely(nd->path.mnt != path->mnt ||
 				     unlazy_walk(nd, path->dentry))) {
 				error = -ECHILD;
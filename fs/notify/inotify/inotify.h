@@ -4,6 +4,7 @@
 
 struct inotify_event_info {
 	struct fsnotify_event fse;
+	struct hlist_node merge_node;	/* in group merge_hash while queued */
 	int wd;
 	u32 sync_cookie;
 	int name_len;
@@ -20,6 +21,13 @@ static inline struct inotify_event_info *INOTIFY_E(struct fsnotify_event *fse)
 	return container_of(fse, struct inotify_event_info, fse);
 }
 
+/*
+ * Every queued event is hashed by (wd, name) so that a new event can be
+ * matched against the newest queued event on the same object, wherever it
+ * sits in the queue, instead of only against the tail.
+ */
+#define INOTIFY_MERGE_HASH_BITS	7
+
 extern void inotify_ignored_and_remove_idr(struct fsnotify_mark *fsn_mark,
 					   struct fsnotify_group *group);
 extern int inotify_handle_event(struct fsnotify_group *group,
@@ -25,6 +25,7 @@
 #include <linux/dcache.h> /* d_unlinked */
 #include <linux/fs.h> /* struct inode */
 #include <linux/fsnotify_backend.h>
+#include <linux/hash.h>
 #include <linux/inotify.h>
 #include <linux/path.h> /* struct path */
 #include <linux/slab.h> /* kmem_* */
@@ -53,13 +54,58 @@ static bool event_compare(struct fsnotify_event *old_fsn,
 	return false;
 }
 
+static struct hlist_head *inotify_merge_bucket(struct fsnotify_group *group,
+					       struct inotify_event_info *event)
+{
+	u32 hash = event->wd;
+
+	if (!group->inotify_data.merge_hash)
+		return NULL;
+	if (event->name_len)
+		hash ^= full_name_hash(event->name, event->name_len);
+	return &group->inotify_data.merge_hash[hash_32(hash,
+						INOTIFY_MERGE_HASH_BITS)];
+}
+
+/*
+ * Merge the new event into the newest queued event on the same (wd, name)
+ * if both carry the same information.  Only the newest one is looked at, so
+ * the order of the events on a given object is kept: MODIFY, CLOSE_WRITE,
+ * MODIFY still reports the last write.  Otherwise the new event becomes the
+ * newest one for its object.
+ *
+ * Called with the group->notification_mutex held.
+ */
 static int inotify_merge(struct list_head *list,
 			  struct fsnotify_event *event)
 {
+	struct fsnotify_group *group;
+	struct inotify_event_info *new, *old;
 	struct fsnotify_event *last_event;
+	struct hlist_head *head;
 
-	last_event = list_entry(list->prev, struct fsnotify_event, list);
-	return event_compare(last_event, event);
+	group = container_of(list, struct fsnotify_group, notification_list);
+	new = INOTIFY_E(event);
+	head = inotify_merge_bucket(group, new);
+	if (!head) {
+		if (list_empty(list))
+			return 0;
+		last_event = list_entry(list->prev, struct fsnotify_event, list);
+		return event_compare(last_event, event);
+	}
+
+	hlist_for_each_entry(old, head, merge_node) {
+		if (old->wd != new->wd || old->name_len != new->name_len ||
+		    (new->name_len && strcmp(old->name, new->name)))
+			continue;
+		if (event_compare(&old->fse, event))
+			return 1;
+		hlist_del_init(&old->merge_node);
+		break;
+	}
+	hlist_add_head(&new->merge_node, head);
+
+	return 0;
 }
 
 int inotify_handle_event(struct fsnotify_group *group,
@@ -102,6 +148,7 @@ int inotify_handle_event(struct fsnotify_group *group,
 
 	fsn_event = &event->fse;
 	fsnotify_init_event(fsn_event, inode, mask);
+	INIT_HLIST_NODE(&event->merge_node);
 	event->wd = i_mark->wd;
 	event->sync_cookie = cookie;
 	event->name_len = len;
@@ -165,6 +212,7 @@ static void inotify_free_group_priv(struct fsnotify_group *group)
 	/* ideally the idr is empty and we won't hit the BUG in the callback */
 	idr_for_each(&group->inotify_data.idr, idr_callback, group);
 	idr_destroy(&group->inotify_data.idr);
+	kfree(group->inotify_data.merge_hash);
 	if (group->inotify_data.user) {
 		atomic_dec(&group->inotify_data.user->inotify_devs);
 		free_uid(group->inotify_data.user);
@@ -134,34 +134,39 @@ static int round_event_name_len(struct fsnotify_event *fsn_event)
 }
 
 /*
- * Get an inotify_kernel_event if one exists and is small
- * enough to fit in "count". Return an error pointer if
- * not large enough.
+ * Move as many queued events as fit in "count" to "batch", so that a
+ * reader takes the notification_mutex once per read() rather than once
+ * per event.  Returns the number of bytes the events will take, or
+ * -EINVAL if not even the first one fits.
  *
  * Called with the group->notification_mutex held.
  */
-static struct fsnotify_event *get_one_event(struct fsnotify_group *group,
-					    size_t count)
+static ssize_t get_events(struct fsnotify_group *group, size_t count,
+			  struct list_head *batch)
 {
-	size_t event_size = sizeof(struct inotify_event);
+	size_t event_size, len = 0;
 	struct fsnotify_event *event;
 
-	if (fsnotify_notify_queue_is_empty(group))
-		return NULL;
-
-	event = fsnotify_peek_first_event(group);
+	while (!fsnotify_notify_queue_is_empty(group)) {
+		event = fsnotify_peek_first_event(group);
 
-	pr_debug("%s: group=%p event=%p\n", __func__, group, event);
+		pr_debug("%s: group=%p event=%p\n", __func__, group, event);
 
-	event_size += round_event_name_len(event);
-	if (event_size > count)
-		return ERR_PTR(-EINVAL);
+		event_size = sizeof(struct inotify_event) +
+			     round_event_name_len(event);
+		if (event_size > count - len)
+			break;
 
-	/* held the notification_mutex the whole time, so this is the
-	 * same event we peeked above */
-	fsnotify_remove_first_event(group);
+		fsnotify_remove_first_event(group);
+		/* no longer a candidate for merging new events into */
+		hlist_del_init(&INOTIFY_E(event)->merge_node);
+		list_add_tail(&event->list, batch);
+		len += event_size;
+	}
 
-	return event;
+	if (!len && !fsnotify_notify_queue_is_empty(group))
+		return -EINVAL;
+	return len;
 }
 
 /*
@@ -224,8 +229,9 @@ static ssize_t inotify_read(struct file *file, char __user *buf,
 			    size_t count, loff_t *pos)
 {
 	struct fsnotify_group *group;
-	struct fsnotify_event *kevent;
+	struct fsnotify_event *kevent, *next;
 	char __user *start;
+	LIST_HEAD(batch);
 	int ret;
 	DEFINE_WAIT(wait);
 
@@ -236,21 +242,32 @@ static ssize_t inotify_read(struct file *file, char __user *buf,
 		prepare_to_wait(&group->notification_waitq, &wait, TASK_INTERRUPTIBLE);
 
 		mutex_lock(&group->notification_mutex);
-		kevent = get_one_event(group, count);
+		ret = get_events(group, count, &batch);
 		mutex_unlock(&group->notification_mutex);
 
-		pr_debug("%s: group=%p kevent=%p\n", __func__, group, kevent);
+		pr_debug("%s: group=%p ret=%d\n", __func__, group, ret);
 
-		if (kevent) {
-			ret = PTR_ERR(kevent);
-			if (IS_ERR(kevent))
-				break;
-			ret = copy_event_to_user(group, kevent, buf);
-			fsnotify_destroy_event(group, kevent);
-			if (ret < 0)
+		if (ret < 0)
+			break;
+		if (ret) {
+			list_for_each_entry_safe(kevent, next, &batch, list) {
+				ret = copy_event_to_user(group, kevent, buf);
+				if (ret < 0)
+					break;
+				list_del_init(&kevent->list);
+				fsnotify_destroy_event(group, kevent);
+				buf += ret;
+				count -= ret;
+			}
+			if (ret < 0) {
+				/* give back, in order, what could not be copied */
+				mutex_lock(&group->notification_mutex);
+				list_for_each_entry(kevent, &batch, list)
+					group->q_len++;
+				list_splice(&batch, &group->notification_list);
+				mutex_unlock(&group->notification_mutex);
 				break;
-			buf += ret;
-			count -= ret;
+			}
 			continue;
 		}
 
@@ -646,11 +663,15 @@ static struct fsnotify_group *inotify_new_group(unsigned int max_events)
 	}
 	group->overflow_event = &oevent->fse;
 	fsnotify_init_event(group->overflow_event, NULL, FS_Q_OVERFLOW);
+	INIT_HLIST_NODE(&oevent->merge_node);
 	oevent->wd = -1;
 	oevent->sync_cookie = 0;
 	oevent->name_len = 0;
 
 	group->max_events = max_events;
+	/* without it new events are only merged into the tail of the queue */
+	group->inotify_data.merge_hash = kcalloc(1 << INOTIFY_MERGE_HASH_BITS,
+					sizeof(struct hlist_head), GFP_KERNEL);
 
 	spin_lock_init(&group->inotify_data.idr_lock);
 	idr_init(&group->inotify_data.idr);
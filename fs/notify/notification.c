@@ -113,7 +113,8 @@ int fsnotify_add_event(struct fsnotify_group *group,
 		goto queue;
 	}
 
-	if (!list_empty(list) && merge) {
+	/* merge() also sees an empty queue so it can track what gets queued */
+	if (merge) {
 		ret = merge(list, event);
 		if (ret) {
 			mutex_unlock(&group->notification_mutex);
@@ -126,7 +127,14 @@ queue:
 	list_add_tail(&event->list, list);
 	mutex_unlock(&group->notification_mutex);
 
-	wake_up(&group->notification_waitq);
+	/*
+	 * Readers get on the waitqueue before they look at the queue under
+	 * notification_mutex, so either they see this event or we see them
+	 * here.  Don't take the waitqueue lock for every event of a burst
+	 * nobody is sleeping on.
+	 */
+	if (waitqueue_active(&group->notification_waitq))
+		wake_up(&group->notification_waitq);
 	kill_fasync(&group->fsn_fa, SIGIO, POLL_IN);
 	return ret;
 }
@@ -779,6 +779,160 @@ const struct file_operations proc_tid_smaps_operations = {
 	.release	= proc_map_release,
 };
 
+/*
+ * /proc/PID/smaps_rollup: the sum of all the smaps entries of the process,
+ * gathered in a single walk and printed once, for readers that only want
+ * the totals.
+ */
+static int show_smaps_rollup(struct seq_file *m, void *v)
+{
+	struct mm_struct *mm = m->private;
+	struct vm_area_struct *vma;
+	struct mem_size_stats mss;
+	struct mm_walk smaps_walk = {
+		.pmd_entry = smaps_pte_range,
+		.mm = mm,
+		.private = &mss,
+	};
+	unsigned long first_vma_start = 0, last_vma_end = 0;
+	u64 pss_locked = 0;
+
+	if (!mm || !atomic_inc_not_zero(&mm->mm_users))
+		return 0;
+
+	memset(&mss, 0, sizeof(mss));
+
+	down_read(&mm->mmap_sem);
+	if (mm->mmap)
+		first_vma_start = mm->mmap->vm_start;
+	for (vma = mm->mmap; vma; vma = vma->vm_next) {
+		u64 pss = mss.pss;
+
+		mss.vma = vma;
+		if (!is_vm_hugetlb_page(vma))
+			walk_page_range(vma->vm_start, vma->vm_end,
+					&smaps_walk);
+		if (vma->vm_flags & VM_LOCKED)
+			pss_locked += mss.pss - pss;
+		last_vma_end = vma->vm_end;
+	}
+	up_read(&mm->mmap_sem);
+	mmput(mm);
+
+	/* Same layout as smaps, parsers skip the "maps" line */
+	seq_setwidth(m, 25 + sizeof(void *) * 6 - 1);
+	seq_printf(m, "%08lx-%08lx ---p 00000000 00:00 0 ", first_vma_start,
+		   last_vma_end);
+	seq_pad(m, ' ');
+	seq_puts(m, "[rollup]\n");
+
+	seq_printf(m,
+		   "Rss:            %8lu kB\n"
+		   "Pss:            %8lu kB\n"
+		   "Shared_Clean:   %8lu kB\n"
+		   "Shared_Dirty:   %8lu kB\n"
+		   "Private_Clean:  %8lu kB\n"
+		   "Private_Dirty:  %8lu kB\n"
+		   "Referenced:     %8lu kB\n"
+		   "Anonymous:      %8lu kB\n"
+		   "AnonHugePages:  %8lu kB\n"
+		   "Swap:           %8lu kB\n"
+		   "SwapPss:        %8lu kB\n"
+		   "Locked:         %8lu kB\n",
+		   mss.resident >> 10,
+		   (unsigned long)(mss.pss >> (10 + PSS_SHIFT)),
+		   mss.shared_clean  >> 10,
+		   mss.shared_dirty  >> 10,
+		   mss.private_clean >> 10,
+		   mss.private_dirty >> 10,
+		   mss.referenced >> 10,
+		   mss.anonymous >> 10,
+		   mss.anonymous_thp >> 10,
+		   mss.swap >> 10,
+		   (unsigned long)(mss.swap_pss >> (10 + PSS_SHIFT)),
+		   (unsigned long)(pss_locked >> (10 + PSS_SHIFT)));
+	return 0;
+}
+
+/*
+ * /proc/PID/smaps_simple: resident and swapped out totals straight from
+ * the mm counters, without walking any page table. There is no Pss here,
+ * shared pages are accounted in full to every process mapping them.
+ */
+static int show_smaps_simple(struct seq_file *m, void *v)
+{
+	struct mm_struct *mm = m->private;
+	unsigned long anon, file, swap;
+
+	if (!mm || !atomic_inc_not_zero(&mm->mm_users))
+		return 0;
+
+	anon = get_mm_counter(mm, MM_ANONPAGES);
+	file = get_mm_counter(mm, MM_FILEPAGES);
+	swap = get_mm_counter(mm, MM_SWAPENTS);
+	mmput(mm);
+
+	seq_printf(m,
+		   "Rss:            %8lu kB\n"
+		   "RssAnon:        %8lu kB\n"
+		   "RssFile:        %8lu kB\n"
+		   "Swap:           %8lu kB\n",
+		   (anon + file) << (PAGE_SHIFT - 10),
+		   anon << (PAGE_SHIFT - 10),
+		   file << (PAGE_SHIFT - 10),
+		   swap << (PAGE_SHIFT - 10));
+	return 0;
+}
+
+static int smaps_totals_open(struct inode *inode, struct file *file,
+			     int (*show)(struct seq_file *, void *))
+{
+	struct mm_struct *mm = proc_mem_open(inode, PTRACE_MODE_READ);
+	int ret;
+
+	if (IS_ERR(mm))
+		return PTR_ERR(mm);
+
+	ret = single_open(file, show, mm);
+	if (ret && mm)
+		mmdrop(mm);
+	return ret;
+}
+
+static int smaps_totals_release(struct inode *inode, struct file *file)
+{
+	struct seq_file *seq = file->private_data;
+
+	if (seq->private)
+		mmdrop(seq->private);
+
+	return single_release(inode, file);
+}
+
+static int smaps_rollup_open(struct inode *inode, struct file *file)
+{
+	return smaps_totals_open(inode, file, show_smaps_rollup);
+}
+
+static int smaps_simple_open(struct inode *inode, struct file *file)
+{
+	return smaps_totals_open(inode, file, show_smaps_simple);
+}
+
+const struct file_operations proc_pid_smaps_rollup_operations = {
+	.open		= smaps_rollup_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= smaps_totals_release,
+};
+
+const struct file_operations proc_pid_smaps_simple_operations = {
+	.open		= smaps_simple_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= smaps_totals_release,
+};
+
 /*
  * We do not want to have constant page-shift bits sitting in
  * pagemap entries and are about to reuse them some time soon.
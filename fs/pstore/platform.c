@@ -28,7 +28,11 @@
 #include <linux/console.h>
 #include <linux/module.h>
 #include <linux/pstore.h>
+#ifdef CONFIG_PSTORE_LZ4_COMPRESS
+#include <linux/lz4.h>
+#else
 #include <linux/zlib.h>
+#endif
 #include <linux/string.h>
 #include <linux/timer.h>
 #include <linux/slab.h>
@@ -68,11 +72,17 @@ struct pstore_info *psinfo;
 
 static char *backend;
 
+#ifdef CONFIG_PSTORE_LZ4_COMPRESS
+/* lz4 needs the worst case output room, the dump is copied from there */
+static void *lz4_workspace;
+static unsigned char *lz4_outbuf;
+#else
 /* Compression parameters */
 #define COMPR_LEVEL 6
 #define WINDOW_BITS 12
 #define MEM_LEVEL 4
 static struct z_stream_s stream;
+#endif
 
 static char *big_oops_buf;
 static size_t big_oops_buf_sz;
@@ -129,6 +139,60 @@ bool pstore_cannot_block_path(enum kmsg_dump_reason reason)
 }
 EXPORT_SYMBOL_GPL(pstore_cannot_block_path);
 
+#ifdef CONFIG_PSTORE_LZ4_COMPRESS
+static int pstore_compress(const void *in, void *out, size_t inlen,
+							size_t outlen)
+{
+	size_t outsize = lz4_compressbound(inlen);
+	int err;
+
+	err = lz4_compress(in, inlen, lz4_outbuf, &outsize, lz4_workspace);
+	if (err || outsize >= inlen || outsize > outlen)
+		return -EIO;
+
+	memcpy(out, lz4_outbuf, outsize);
+	return outsize;
+}
+
+static int pstore_decompress(void *in, void *out, size_t inlen, size_t outlen)
+{
+	size_t outsize = outlen;
+	int err;
+
+	err = lz4_decompress_unknownoutputsize(in, inlen, out, &outsize);
+	if (err)
+		return -EIO;
+
+	return outsize;
+}
+
+static void allocate_buf_for_compression(void)
+{
+	/*
+	 * lz4 packs kernel logs a little worse than deflate but runs several
+	 * times faster, which matters as the dump is taken with interrupts
+	 * off on the panic path.
+	 */
+	big_oops_buf_sz = (psinfo->bufsize * 100) / 50;
+	big_oops_buf = kmalloc(big_oops_buf_sz, GFP_KERNEL);
+	if (!big_oops_buf) {
+		pr_err("No memory for uncompressed data; skipping compression\n");
+		return;
+	}
+
+	lz4_workspace = kmalloc(LZ4_MEM_COMPRESS, GFP_KERNEL);
+	lz4_outbuf = kmalloc(lz4_compressbound(big_oops_buf_sz), GFP_KERNEL);
+	if (!lz4_workspace || !lz4_outbuf) {
+		pr_err("No memory for compression workspace; skipping compression\n");
+		kfree(lz4_outbuf);
+		lz4_outbuf = NULL;
+		kfree(lz4_workspace);
+		lz4_workspace = NULL;
+		kfree(big_oops_buf);
+		big_oops_buf = NULL;
+	}
+}
+#else
 /* Derived from logfs_compress() */
 static int pstore_compress(const void *in, void *out, size_t inlen,
 							size_t outlen)
@@ -236,6 +300,7 @@ static void allocate_buf_for_compression(void)
 	}
 
 }
+#endif
 
 /*
  * Called when compression fails, since the printk buffer
@@ -37,6 +37,8 @@
 #include <linux/of.h>
 #include <linux/of_address.h>
 
+#include "internal.h"
+
 #define RAMOOPS_KERNMSG_HDR "===="
 #define MIN_MEM_SIZE 4096UL
 
@@ -53,6 +55,11 @@ static ulong ramoops_ftrace_size = MIN_MEM_SIZE;
 module_param_named(ftrace_size, ramoops_ftrace_size, ulong, 0400);
 MODULE_PARM_DESC(ftrace_size, "size of ftrace log");
 
+static bool ramoops_ftrace_per_cpu;
+module_param_named(ftrace_per_cpu, ramoops_ftrace_per_cpu, bool, 0400);
+MODULE_PARM_DESC(ftrace_per_cpu,
+		"split the ftrace log in one zone per CPU (default 0)");
+
 static ulong ramoops_pmsg_size = MIN_MEM_SIZE;
 module_param_named(pmsg_size, ramoops_pmsg_size, ulong, 0400);
 MODULE_PARM_DESC(pmsg_size, "size of user space message log");
@@ -87,7 +94,7 @@ MODULE_PARM_DESC(ramoops_ecc,
 struct ramoops_context {
 	struct persistent_ram_zone **przs;
 	struct persistent_ram_zone *cprz;
-	struct persistent_ram_zone *fprz;
+	struct persistent_ram_zone **fprzs;
 	struct persistent_ram_zone *mprz;
 	phys_addr_t phys_addr;
 	unsigned long size;
@@ -96,9 +103,11 @@ struct ramoops_context {
 	size_t console_size;
 	size_t ftrace_size;
 	size_t pmsg_size;
+	unsigned int flags;
 	int dump_oops;
 	struct persistent_ram_ecc_info ecc_info;
 	unsigned int max_dump_cnt;
+	unsigned int max_ftrace_cnt;
 	unsigned int dump_write_cnt;
 	/* _read_cnt need clear on ramoops_pstore_open */
 	unsigned int dump_read_cnt;
@@ -178,6 +187,38 @@ static bool prz_ok(struct persistent_ram_zone *prz)
 			   persistent_ram_ecc_string(prz, NULL, 0));
 }
 
+/*
+ * Per-CPU ftrace zones are handed back as a single record, the zones one
+ * after the other: every entry still carries the CPU it was logged on.
+ * The oldest entry of a zone that wrapped may have been partly overwritten,
+ * drop it so that the following zones stay aligned on entries.
+ */
+static ssize_t ramoops_read_ftrace_zones(struct ramoops_context *cxt,
+					 char **buf)
+{
+	size_t size = 0, off = 0, sz, skip;
+	unsigned int i;
+
+	for (i = 0; i < cxt->max_ftrace_cnt; i++)
+		size += persistent_ram_old_size(cxt->fprzs[i]);
+	if (!size)
+		return 0;
+
+	*buf = kmalloc(size, GFP_KERNEL);
+	if (*buf == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < cxt->max_ftrace_cnt; i++) {
+		sz = persistent_ram_old_size(cxt->fprzs[i]);
+		skip = sz % sizeof(struct pstore_ftrace_record);
+		memcpy(*buf + off, persistent_ram_old(cxt->fprzs[i]) + skip,
+		       sz - skip);
+		off += sz - skip;
+	}
+
+	return off;
+}
+
 static ssize_t ramoops_pstore_read(u64 *id, enum pstore_type_id *type,
 				   int *count, struct timespec *time,
 				   char **buf, bool *compressed,
@@ -194,8 +235,20 @@ static ssize_t ramoops_pstore_read(u64 *id, enum pstore_type_id *type,
 	if (!prz_ok(prz))
 		prz = ramoops_get_next_prz(&cxt->cprz, &cxt->console_read_cnt,
 					   1, id, type, PSTORE_TYPE_CONSOLE, 0);
-	if (!prz_ok(prz))
-		prz = ramoops_get_next_prz(&cxt->fprz, &cxt->ftrace_read_cnt,
+	if (!prz_ok(prz) && cxt->max_ftrace_cnt > 1 &&
+	    !cxt->ftrace_read_cnt++) {
+		size = ramoops_read_ftrace_zones(cxt, buf);
+		if (size) {
+			*id = 0;
+			*type = PSTORE_TYPE_FTRACE;
+			time->tv_sec = 0;
+			time->tv_nsec = 0;
+			*compressed = false;
+			return size;
+		}
+	}
+	if (!prz_ok(prz) && cxt->fprzs)
+		prz = ramoops_get_next_prz(cxt->fprzs, &cxt->ftrace_read_cnt,
 					   1, id, type, PSTORE_TYPE_FTRACE, 0);
 	if (!prz_ok(prz))
 		prz = ramoops_get_next_prz(&cxt->mprz, &cxt->pmsg_read_cnt,
@@ -259,9 +312,18 @@ static int notrace ramoops_pstore_write_buf(enum pstore_type_id type,
 		persistent_ram_write(cxt->cprz, buf, size);
 		return 0;
 	} else if (type == PSTORE_TYPE_FTRACE) {
-		if (!cxt->fprz)
+		unsigned int zonenum = 0;
+
+		if (!cxt->fprzs)
 			return -ENOMEM;
-		persistent_ram_write(cxt->fprz, buf, size);
+		/*
+		 * pstore_ftrace_call() runs with interrupts off. With a zone
+		 * per CPU nobody else writes to ours, and its start and size
+		 * counters stay in this CPU's cache.
+		 */
+		if (cxt->max_ftrace_cnt > 1)
+			zonenum = raw_smp_processor_id();
+		persistent_ram_write(cxt->fprzs[zonenum], buf, size);
 		return 0;
 	} else if (type == PSTORE_TYPE_PMSG) {
 		if (!cxt->mprz)
@@ -329,6 +391,7 @@ static int ramoops_pstore_erase(enum pstore_type_id type, u64 id, int count,
 				struct timespec time, struct pstore_info *psi)
 {
 	struct ramoops_context *cxt = psi->data;
+	unsigned int i;
 	struct persistent_ram_zone *prz;
 
 	switch (type) {
@@ -341,7 +404,14 @@ static int ramoops_pstore_erase(enum pstore_type_id type, u64 id, int count,
 		prz = cxt->cprz;
 		break;
 	case PSTORE_TYPE_FTRACE:
-		prz = cxt->fprz;
+		if (!cxt->fprzs)
+			return -EINVAL;
+		/* The per-CPU zones were read back as one record */
+		for (i = 1; i < cxt->max_ftrace_cnt; i++) {
+			persistent_ram_free_old(cxt->fprzs[i]);
+			persistent_ram_zap(cxt->fprzs[i]);
+		}
+		prz = cxt->fprzs[0];
 		break;
 	case PSTORE_TYPE_PMSG:
 		prz = cxt->mprz;
@@ -458,6 +528,63 @@ static int ramoops_init_prz(struct device *dev, struct ramoops_context *cxt,
 	return 0;
 }
 
+static void ramoops_free_ftrace_przs(struct ramoops_context *cxt)
+{
+	unsigned int i;
+
+	if (!cxt->fprzs)
+		return;
+
+	for (i = 0; i < cxt->max_ftrace_cnt; i++)
+		if (cxt->fprzs[i])
+			persistent_ram_free(cxt->fprzs[i]);
+	kfree(cxt->fprzs);
+	cxt->fprzs = NULL;
+	cxt->max_ftrace_cnt = 0;
+}
+
+static int ramoops_init_ftrace_przs(struct device *dev,
+				    struct ramoops_context *cxt,
+				    phys_addr_t *paddr, size_t sz)
+{
+	unsigned int i, cnt = 1;
+	size_t zone_sz;
+	int err;
+
+	if (!sz)
+		return 0;
+
+	if (cxt->flags & RAMOOPS_FLAG_FTRACE_PER_CPU)
+		cnt = nr_cpu_ids;
+	zone_sz = sz / cnt;
+	if (cnt > 1 && zone_sz < MIN_MEM_SIZE) {
+		dev_warn(dev, "ftrace log too small for %u zones, not splitting it\n",
+			 cnt);
+		cnt = 1;
+		zone_sz = sz;
+	}
+
+	cxt->fprzs = kcalloc(cnt, sizeof(*cxt->fprzs), GFP_KERNEL);
+	if (!cxt->fprzs)
+		return -ENOMEM;
+	cxt->max_ftrace_cnt = cnt;
+
+	for (i = 0; i < cnt; i++) {
+		err = ramoops_init_prz(dev, cxt, &cxt->fprzs[i], paddr,
+				       zone_sz, LINUX_VERSION_CODE);
+		if (err) {
+			cxt->fprzs[i] = NULL;
+			ramoops_free_ftrace_przs(cxt);
+			return err;
+		}
+	}
+
+	/* Keep the pmsg zone where it was, whatever the rounding above */
+	*paddr += sz - zone_sz * cnt;
+
+	return 0;
+}
+
 void notrace ramoops_console_write_buf(const char *buf, size_t size)
 {
 	struct ramoops_context *cxt = &oops_cxt;
@@ -507,6 +634,8 @@ static int ramoops_parse_dt(struct platform_device *pdev,
 	pdata->mem_address = res->start;
 	pdata->mem_type = of_property_read_bool(of_node, "unbuffered");
 	pdata->dump_oops = !of_property_read_bool(of_node, "no-dump-oops");
+	if (of_property_read_bool(of_node, "ftrace-per-cpu"))
+		pdata->flags |= RAMOOPS_FLAG_FTRACE_PER_CPU;
 
 #define parse_size(name, field) {					\
 		ret = ramoops_parse_dt_size(pdev, name, &value);	\
@@ -576,6 +705,7 @@ static int ramoops_probe(struct platform_device *pdev)
 	cxt->console_size = pdata->console_size;
 	cxt->ftrace_size = pdata->ftrace_size;
 	cxt->pmsg_size = pdata->pmsg_size;
+	cxt->flags = pdata->flags;
 	cxt->dump_oops = pdata->dump_oops;
 	cxt->ecc_info = pdata->ecc_info;
 
@@ -592,8 +722,7 @@ static int ramoops_probe(struct platform_device *pdev)
 	if (err)
 		goto fail_init_cprz;
 
-	err = ramoops_init_prz(dev, cxt, &cxt->fprz, &paddr, cxt->ftrace_size,
-			       LINUX_VERSION_CODE);
+	err = ramoops_init_ftrace_przs(dev, cxt, &paddr, cxt->ftrace_size);
 	if (err)
 		goto fail_init_fprz;
 
@@ -647,7 +776,7 @@ fail_clear:
 	cxt->max_dump_cnt = 0;
 	kfree(cxt->mprz);
 fail_init_mprz:
-	kfree(cxt->fprz);
+	ramoops_free_ftrace_przs(cxt);
 fail_init_fprz:
 	kfree(cxt->cprz);
 fail_init_cprz:
@@ -711,6 +840,8 @@ static void ramoops_register_dummy(void)
 	dummy_data->console_size = ramoops_console_size;
 	dummy_data->ftrace_size = ramoops_ftrace_size;
 	dummy_data->pmsg_size = ramoops_pmsg_size;
+	if (ramoops_ftrace_per_cpu)
+		dummy_data->flags |= RAMOOPS_FLAG_FTRACE_PER_CPU;
 	dummy_data->dump_oops = dump_oops;
 	/*
 	 * For backwards compatibility ramoops.ecc=1 means 16 bytes ECC
@@ -115,6 +115,10 @@ static int sdcardfs_d_revalidate(struct dentry *dentry, unsigned int flags)
 		iput(inode);
 	}
 
+	/* the packagelist may have changed since we were derived */
+	if (err > 0)
+		fixup_perms_if_stale(parent_dentry, dentry);
+
 out:
 	dput(parent_dentry);
 	dput(lower_cur_parent_dentry);
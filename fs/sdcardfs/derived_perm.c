@@ -83,6 +83,8 @@ void get_derived_permission_new(struct dentry *parent, struct dentry *dentry,
 	 */
 
 	inherit_derived_state(parent->d_inode, dentry->d_inode);
+	/* read before the packagelist is consulted below */
+	info->data->pkg_gen = get_packagelist_gen();
 
 	/* Files don't get special labels */
 	if (!S_ISDIR(dentry->d_inode->i_mode)) {
@@ -371,11 +373,51 @@ static void __fixup_perms_recursive(struct dentry *dentry, struct limit_search *
 	spin_unlock(&dentry->d_lock);
 }
 
+/*
+ * Fix up the cached package directories a packagelist change applies to
+ * right away, so that a process already inside one of them can't keep
+ * using the old owner.
+ */
 void fixup_perms_recursive(struct dentry *dentry, struct limit_search *limit)
 {
 	__fixup_perms_recursive(dentry, limit, 0);
 }
 
+/*
+ * Package directories take their owner from the packagelist. Besides the
+ * eager fixup above, a package directory is derived again on revalidation
+ * when it was derived with an older packagelist generation; this covers
+ * dentries instantiated while an update was being applied.
+ */
+void fixup_perms_if_stale(struct dentry *parent, struct dentry *dentry)
+{
+	struct sdcardfs_inode_data *data;
+	unsigned int gen = get_packagelist_gen();
+
+	if (!sbinfo_has_sdcard_magic(SDCARDFS_SB(dentry->d_sb)))
+		return;
+
+	spin_lock(&parent->d_lock);
+	spin_lock_nested(&dentry->d_lock, DENTRY_D_LOCK_NESTED);
+	if (!parent->d_inode || !dentry->d_inode)
+		goto out;
+
+	data = SDCARDFS_I(dentry->d_inode)->data;
+	if (data->pkg_gen == gen)
+		goto out;
+
+	if (needs_fixup(SDCARDFS_I(parent->d_inode)->data->perm)) {
+		get_derived_permission(parent, dentry);
+		fixup_tmp_permissions(dentry->d_inode);
+	} else {
+		/* not owned by a package, nothing to derive again */
+		data->pkg_gen = gen;
+	}
+out:
+	spin_unlock(&dentry->d_lock);
+	spin_unlock(&parent->d_lock);
+}
+
 /* main function for updating derived permission */
 inline void update_derived_permission_lock(struct dentry *dentry)
 {
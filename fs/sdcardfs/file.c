@@ -432,6 +432,28 @@ out:
 	return err;
 }
 
+/*
+ * Sdcardfs splice_read, hand the lower page cache pages to the pipe
+ * instead of copying them through ->read (default_file_splice_read)
+ */
+static ssize_t sdcardfs_splice_read(struct file *file, loff_t *ppos,
+		struct pipe_inode_info *pipe, size_t len, unsigned int flags)
+{
+	ssize_t err;
+	struct file *lower_file;
+
+	lower_file = sdcardfs_lower_file(file);
+	if (!lower_file->f_op->splice_read)
+		return default_file_splice_read(file, ppos, pipe, len, flags);
+
+	err = lower_file->f_op->splice_read(lower_file, ppos, pipe, len, flags);
+	/* update upper inode atime as needed */
+	if (err >= 0)
+		fsstack_copy_attr_atime(file->f_path.dentry->d_inode,
+					file_inode(lower_file));
+	return err;
+}
+
 const struct file_operations sdcardfs_main_fops = {
 	.llseek		= generic_file_llseek,
 	.read		= sdcardfs_read,
@@ -448,6 +470,7 @@ const struct file_operations sdcardfs_main_fops = {
 	.fasync		= sdcardfs_fasync,
 	.read_iter	= sdcardfs_read_iter,
 	.write_iter	= sdcardfs_write_iter,
+	.splice_read	= sdcardfs_splice_read,
 };
 
 /* trimmed directory options */
@@ -220,6 +220,172 @@ int sdcardfs_interpose(struct dentry *dentry, struct super_block *sb,
 	return PTR_ERR(ret_dentry);
 }
 
+/*
+ * Case-insensitive lookup cache
+ *
+ * When the exact lower lookup misses, the lower directory is scanned for
+ * a name that matches case-insensitively. The result is remembered in
+ * the parent directory, keyed by the case-folded d_name hash:
+ *  - a positive entry holds the lower name. It is verified by the exact
+ *    lower lookup it saves the scan for, so it can not go stale.
+ *  - a negative entry is only trusted while the lower directory's
+ *    mtime/ctime are unchanged, and for at most SDCARDFS_CI_NEG_TTL to
+ *    cover updates within the timestamp granularity of the lower fs.
+ */
+#define SDCARDFS_CI_CACHE_SIZE		8
+#define SDCARDFS_CI_NEG_TTL		(HZ)
+
+struct sdcardfs_ci_entry {
+	char *name;		/* lower name, or the missed name if negative */
+	unsigned int len;
+	unsigned int hash;
+	bool negative;
+	unsigned long stamp;
+	struct timespec mtime;
+	struct timespec ctime;
+};
+
+struct sdcardfs_ci_cache {
+	spinlock_t lock;
+	unsigned int next;	/* round-robin replacement */
+	struct sdcardfs_ci_entry ent[SDCARDFS_CI_CACHE_SIZE];
+};
+
+enum {
+	CI_CACHE_MISS,
+	CI_CACHE_POSITIVE,
+	CI_CACHE_NEGATIVE,
+};
+
+void sdcardfs_free_ci_cache(struct sdcardfs_inode_info *info)
+{
+	struct sdcardfs_ci_cache *cache = info->ci_cache;
+	int i;
+
+	if (!cache)
+		return;
+
+	for (i = 0; i < SDCARDFS_CI_CACHE_SIZE; i++)
+		kfree(cache->ent[i].name);
+	kfree(cache);
+	info->ci_cache = NULL;
+}
+
+static inline bool ci_entry_match(struct sdcardfs_ci_entry *ent,
+		const struct qstr *name)
+{
+	struct qstr q = QSTR_INIT(ent->name, ent->len);
+
+	return ent->name && ent->hash == name->hash && qstr_case_eq(name, &q);
+}
+
+/* copies the lower name of a positive hit into buf (PATH_MAX) */
+static int ci_cache_get(struct inode *dir, struct inode *lower_dir,
+		const struct qstr *name, char *buf)
+{
+	struct sdcardfs_ci_cache *cache = SDCARDFS_I(dir)->ci_cache;
+	int ret = CI_CACHE_MISS;
+	int i;
+
+	if (!cache)
+		return CI_CACHE_MISS;
+
+	spin_lock(&cache->lock);
+	for (i = 0; i < SDCARDFS_CI_CACHE_SIZE; i++) {
+		struct sdcardfs_ci_entry *ent = &cache->ent[i];
+
+		if (!ci_entry_match(ent, name))
+			continue;
+
+		if (!ent->negative) {
+			memcpy(buf, ent->name, ent->len);
+			buf[ent->len] = 0;
+			ret = CI_CACHE_POSITIVE;
+		} else if (timespec_equal(&ent->mtime, &lower_dir->i_mtime) &&
+				timespec_equal(&ent->ctime, &lower_dir->i_ctime) &&
+				time_before(jiffies, ent->stamp + SDCARDFS_CI_NEG_TTL)) {
+			ret = CI_CACHE_NEGATIVE;
+		}
+		break;
+	}
+	spin_unlock(&cache->lock);
+	return ret;
+}
+
+/* lower_name NULL records a miss */
+static void ci_cache_add(struct inode *dir, struct inode *lower_dir,
+		const struct qstr *name, const char *lower_name)
+{
+	struct sdcardfs_inode_info *info = SDCARDFS_I(dir);
+	struct sdcardfs_ci_cache *cache = info->ci_cache;
+	struct sdcardfs_ci_entry *ent = NULL;
+	unsigned int len = lower_name ? strlen(lower_name) : name->len;
+	char *copy, *old;
+	int i;
+
+	if (!cache) {
+		struct sdcardfs_ci_cache *new;
+
+		new = kzalloc(sizeof(*new), GFP_KERNEL);
+		if (!new)
+			return;
+		spin_lock_init(&new->lock);
+		cache = cmpxchg(&info->ci_cache, NULL, new);
+		if (cache)
+			kfree(new);
+		else
+			cache = new;
+	}
+
+	copy = kmemdup(lower_name ? lower_name : name->name, len + 1, GFP_KERNEL);
+	if (!copy)
+		return;
+	copy[len] = 0;
+
+	spin_lock(&cache->lock);
+	for (i = 0; i < SDCARDFS_CI_CACHE_SIZE; i++) {
+		if (ci_entry_match(&cache->ent[i], name)) {
+			ent = &cache->ent[i];
+			break;
+		}
+	}
+	if (!ent) {
+		ent = &cache->ent[cache->next];
+		cache->next = (cache->next + 1) % SDCARDFS_CI_CACHE_SIZE;
+	}
+	old = ent->name;
+	ent->name = copy;
+	ent->len = len;
+	ent->hash = name->hash;
+	ent->negative = !lower_name;
+	ent->stamp = jiffies;
+	ent->mtime = lower_dir->i_mtime;
+	ent->ctime = lower_dir->i_ctime;
+	spin_unlock(&cache->lock);
+	kfree(old);
+}
+
+static void ci_cache_drop(struct inode *dir, const struct qstr *name)
+{
+	struct sdcardfs_ci_cache *cache = SDCARDFS_I(dir)->ci_cache;
+	char *old = NULL;
+	int i;
+
+	if (!cache)
+		return;
+
+	spin_lock(&cache->lock);
+	for (i = 0; i < SDCARDFS_CI_CACHE_SIZE; i++) {
+		if (ci_entry_match(&cache->ent[i], name)) {
+			old = cache->ent[i].name;
+			cache->ent[i].name = NULL;
+			break;
+		}
+	}
+	spin_unlock(&cache->lock);
+	kfree(old);
+}
+
 struct sdcardfs_name_data {
 	struct dir_context ctx;
 	const struct qstr *to_find;
@@ -280,6 +446,8 @@ static struct dentry *__sdcardfs_lookup(struct dentry *dentry,
 	if (err == -ENOENT) {
 		struct file *file;
 		const struct cred *cred = current_cred();
+		struct inode *dir = dentry->d_parent->d_inode;
+		struct inode *lower_dir = lower_dir_dentry->d_inode;
 
 		struct sdcardfs_name_data buffer = {
 			.ctx.actor = sdcardfs_name_match,
@@ -292,6 +460,19 @@ static struct dentry *__sdcardfs_lookup(struct dentry *dentry,
 			err = -ENOMEM;
 			goto out;
 		}
+
+		switch (ci_cache_get(dir, lower_dir, name, buffer.name)) {
+		case CI_CACHE_NEGATIVE:
+			goto put_name;
+		case CI_CACHE_POSITIVE:
+			err = vfs_path_lookup(lower_dir_dentry, lower_dir_mnt,
+						buffer.name, 0, &lower_path);
+			if (!err)
+				goto put_name;
+			ci_cache_drop(dir, name);
+			break;
+		}
+
 		file = dentry_open(lower_parent_path, O_RDONLY, cred);
 		if (IS_ERR(file)) {
 			err = PTR_ERR(file);
@@ -302,6 +483,9 @@ static struct dentry *__sdcardfs_lookup(struct dentry *dentry,
 		if (err)
 			goto put_name;
 
+		ci_cache_add(dir, lower_dir, name,
+				buffer.found ? buffer.name : NULL);
+
 		if (buffer.found)
 			err = vfs_path_lookup(lower_dir_dentry,
 						lower_dir_mnt,
@@ -34,6 +34,7 @@
 struct hashtable_entry {
 	struct hlist_node hlist;
 	struct hlist_node dlist; /* for deletion cleanup */
+	struct rcu_head rcu;
 	struct qstr key;
 	atomic_t value;
 };
@@ -42,6 +43,29 @@ static DEFINE_HASHTABLE(package_to_appid, 8);
 static DEFINE_HASHTABLE(package_to_userid, 8);
 static DEFINE_HASHTABLE(ext_to_groupid, 8);
 
+/*
+ * Lookups only take rcu_read_lock(). Writers serialize on this mutex and
+ * free unlinked entries after a grace period.
+ */
+static DEFINE_MUTEX(packagelist_lock);
+
+/*
+ * Bumped whenever an update may change derived permissions. Package
+ * directories remember the generation they were derived with and are
+ * fixed up on their next revalidation (see fixup_perms_if_stale()).
+ */
+static atomic_t packagelist_gen = ATOMIC_INIT(1);
+
+unsigned int get_packagelist_gen(void)
+{
+	return atomic_read(&packagelist_gen);
+}
+
+static inline void packagelist_changed(void)
+{
+	atomic_inc(&packagelist_gen);
+}
+
 
 static struct kmem_cache *hashtable_entry_cachep;
 
@@ -250,6 +274,11 @@ static int insert_userid_exclude_entry_locked(const struct qstr *key, userid_t v
 	return 0;
 }
 
+/*
+ * The walks run after packagelist_lock is dropped: they only serialize with
+ * mount and unmount, and a dentry derived in between already sees the new
+ * tables.
+ */
 static void fixup_all_perms_name(const struct qstr *key)
 {
 	struct sdcardfs_sb_info *sbinfo;
@@ -257,10 +286,13 @@ static void fixup_all_perms_name(const struct qstr *key)
 		.flags = BY_NAME,
 		.name = QSTR_INIT(key->name, key->len),
 	};
+
+	mutex_lock(&sdcardfs_super_list_lock);
 	list_for_each_entry(sbinfo, &sdcardfs_super_list, list) {
 		if (sbinfo_has_sdcard_magic(sbinfo))
 			fixup_perms_recursive(sbinfo->sb->s_root, &limit);
 	}
+	mutex_unlock(&sdcardfs_super_list_lock);
 }
 
 static void fixup_all_perms_name_userid(const struct qstr *key, userid_t userid)
@@ -271,10 +303,13 @@ static void fixup_all_perms_name_userid(const struct qstr *key, userid_t userid)
 		.name = QSTR_INIT(key->name, key->len),
 		.userid = userid,
 	};
+
+	mutex_lock(&sdcardfs_super_list_lock);
 	list_for_each_entry(sbinfo, &sdcardfs_super_list, list) {
 		if (sbinfo_has_sdcard_magic(sbinfo))
 			fixup_perms_recursive(sbinfo->sb->s_root, &limit);
 	}
+	mutex_unlock(&sdcardfs_super_list_lock);
 }
 
 static void fixup_all_perms_userid(userid_t userid)
@@ -284,21 +319,26 @@ static void fixup_all_perms_userid(userid_t userid)
 		.flags = BY_USERID,
 		.userid = userid,
 	};
+
+	mutex_lock(&sdcardfs_super_list_lock);
 	list_for_each_entry(sbinfo, &sdcardfs_super_list, list) {
 		if (sbinfo_has_sdcard_magic(sbinfo))
 			fixup_perms_recursive(sbinfo->sb->s_root, &limit);
 	}
+	mutex_unlock(&sdcardfs_super_list_lock);
 }
 
 static int insert_packagelist_entry(const struct qstr *key, appid_t value)
 {
 	int err;
 
-	mutex_lock(&sdcardfs_super_list_lock);
+	mutex_lock(&packagelist_lock);
 	err = insert_packagelist_appid_entry_locked(key, value);
+	if (!err)
+		packagelist_changed();
+	mutex_unlock(&packagelist_lock);
 	if (!err)
 		fixup_all_perms_name(key);
-	mutex_unlock(&sdcardfs_super_list_lock);
 
 	return err;
 }
@@ -307,9 +347,9 @@ static int insert_ext_gid_entry(const struct qstr *key, appid_t value)
 {
 	int err;
 
-	mutex_lock(&sdcardfs_super_list_lock);
+	mutex_lock(&packagelist_lock);
 	err = insert_ext_gid_entry_locked(key, value);
-	mutex_unlock(&sdcardfs_super_list_lock);
+	mutex_unlock(&packagelist_lock);
 
 	return err;
 }
@@ -318,11 +358,13 @@ static int insert_userid_exclude_entry(const struct qstr *key, userid_t value)
 {
 	int err;
 
-	mutex_lock(&sdcardfs_super_list_lock);
+	mutex_lock(&packagelist_lock);
 	err = insert_userid_exclude_entry_locked(key, value);
+	if (!err)
+		packagelist_changed();
+	mutex_unlock(&packagelist_lock);
 	if (!err)
 		fixup_all_perms_name_userid(key, value);
-	mutex_unlock(&sdcardfs_super_list_lock);
 
 	return err;
 }
@@ -333,6 +375,17 @@ static void free_hashtable_entry(struct hashtable_entry *entry)
 	kmem_cache_free(hashtable_entry_cachep, entry);
 }
 
+static void free_hashtable_entry_rcu(struct rcu_head *head)
+{
+	free_hashtable_entry(container_of(head, struct hashtable_entry, rcu));
+}
+
+/* readers may still walk past entry, free it after a grace period */
+static inline void release_hashtable_entry(struct hashtable_entry *entry)
+{
+	call_rcu(&entry->rcu, free_hashtable_entry_rcu);
+}
+
 static void remove_packagelist_entry_locked(const struct qstr *key)
 {
 	struct hashtable_entry *hash_cur;
@@ -353,17 +406,17 @@ static void remove_packagelist_entry_locked(const struct qstr *key)
 			break;
 		}
 	}
-	synchronize_rcu();
 	hlist_for_each_entry_safe(hash_cur, h_t, &free_list, dlist)
-		free_hashtable_entry(hash_cur);
+		release_hashtable_entry(hash_cur);
 }
 
 static void remove_packagelist_entry(const struct qstr *key)
 {
-	mutex_lock(&sdcardfs_super_list_lock);
+	mutex_lock(&packagelist_lock);
 	remove_packagelist_entry_locked(key);
+	packagelist_changed();
+	mutex_unlock(&packagelist_lock);
 	fixup_all_perms_name(key);
-	mutex_unlock(&sdcardfs_super_list_lock);
 }
 
 static void remove_ext_gid_entry_locked(const struct qstr *key, gid_t group)
@@ -374,8 +427,7 @@ static void remove_ext_gid_entry_locked(const struct qstr *key, gid_t group)
 	hash_for_each_possible_rcu(ext_to_groupid, hash_cur, hlist, hash) {
 		if (qstr_case_eq(key, &hash_cur->key) && atomic_read(&hash_cur->value) == group) {
 			hash_del_rcu(&hash_cur->hlist);
-			synchronize_rcu();
-			free_hashtable_entry(hash_cur);
+			release_hashtable_entry(hash_cur);
 			break;
 		}
 	}
@@ -383,9 +435,9 @@ static void remove_ext_gid_entry_locked(const struct qstr *key, gid_t group)
 
 static void remove_ext_gid_entry(const struct qstr *key, gid_t group)
 {
-	mutex_lock(&sdcardfs_super_list_lock);
+	mutex_lock(&packagelist_lock);
 	remove_ext_gid_entry_locked(key, group);
-	mutex_unlock(&sdcardfs_super_list_lock);
+	mutex_unlock(&packagelist_lock);
 }
 
 static void remove_userid_all_entry_locked(userid_t userid)
@@ -401,18 +453,18 @@ static void remove_userid_all_entry_locked(userid_t userid)
 			hlist_add_head(&hash_cur->dlist, &free_list);
 		}
 	}
-	synchronize_rcu();
 	hlist_for_each_entry_safe(hash_cur, h_t, &free_list, dlist) {
-		free_hashtable_entry(hash_cur);
+		release_hashtable_entry(hash_cur);
 	}
 }
 
 static void remove_userid_all_entry(userid_t userid)
 {
-	mutex_lock(&sdcardfs_super_list_lock);
+	mutex_lock(&packagelist_lock);
 	remove_userid_all_entry_locked(userid);
+	packagelist_changed();
+	mutex_unlock(&packagelist_lock);
 	fixup_all_perms_userid(userid);
-	mutex_unlock(&sdcardfs_super_list_lock);
 }
 
 static void remove_userid_exclude_entry_locked(const struct qstr *key, userid_t userid)
@@ -424,8 +476,7 @@ static void remove_userid_exclude_entry_locked(const struct qstr *key, userid_t
 		if (qstr_case_eq(key, &hash_cur->key) &&
 				atomic_read(&hash_cur->value) == userid) {
 			hash_del_rcu(&hash_cur->hlist);
-			synchronize_rcu();
-			free_hashtable_entry(hash_cur);
+			release_hashtable_entry(hash_cur);
 			break;
 		}
 	}
@@ -433,10 +484,11 @@ static void remove_userid_exclude_entry_locked(const struct qstr *key, userid_t
 
 static void remove_userid_exclude_entry(const struct qstr *key, userid_t userid)
 {
-	mutex_lock(&sdcardfs_super_list_lock);
+	mutex_lock(&packagelist_lock);
 	remove_userid_exclude_entry_locked(key, userid);
+	packagelist_changed();
+	mutex_unlock(&packagelist_lock);
 	fixup_all_perms_name_userid(key, userid);
-	mutex_unlock(&sdcardfs_super_list_lock);
 }
 
 static void packagelist_destroy(void)
@@ -446,7 +498,7 @@ static void packagelist_destroy(void)
 	HLIST_HEAD(free_list);
 	int i;
 
-	mutex_lock(&sdcardfs_super_list_lock);
+	mutex_lock(&packagelist_lock);
 	hash_for_each_rcu(package_to_appid, i, hash_cur, hlist) {
 		hash_del_rcu(&hash_cur->hlist);
 		hlist_add_head(&hash_cur->dlist, &free_list);
@@ -458,7 +510,7 @@ static void packagelist_destroy(void)
 	synchronize_rcu();
 	hlist_for_each_entry_safe(hash_cur, h_t, &free_list, dlist)
 		free_hashtable_entry(hash_cur);
-	mutex_unlock(&sdcardfs_super_list_lock);
+	mutex_unlock(&packagelist_lock);
 	pr_info("sdcardfs: destroyed packagelist pkgld\n");
 }
 
@@ -882,5 +934,7 @@ void packagelist_exit(void)
 {
 	configfs_sdcardfs_exit();
 	packagelist_destroy();
+	/* wait for entries still queued by release_hashtable_entry() */
+	rcu_barrier();
 	kmem_cache_destroy(hashtable_entry_cachep);
 }
@@ -170,6 +170,7 @@ extern int new_dentry_private_data(struct dentry *dentry);
 extern void free_dentry_private_data(struct dentry *dentry);
 extern struct dentry *sdcardfs_lookup(struct inode *dir, struct dentry *dentry,
 				unsigned int flags);
+extern void sdcardfs_free_ci_cache(struct sdcardfs_inode_info *info);
 extern struct inode *sdcardfs_iget(struct super_block *sb,
 				 struct inode *lower_inode, userid_t id);
 extern int sdcardfs_interpose(struct dentry *dentry, struct super_block *sb,
@@ -193,6 +194,9 @@ struct sdcardfs_inode_data {
 	bool under_obb;
 
 	bool under_knox;
+
+	/* packagelist generation perm/d_uid were derived with */
+	unsigned int pkg_gen;
 };
 
 /* sdcardfs inode data in memory */
@@ -205,6 +209,9 @@ struct sdcardfs_inode_info {
 	spinlock_t top_lock;
 	struct sdcardfs_inode_data *top_data;
 
+	/* case-insensitive lookup results of a directory (see lookup.c) */
+	struct sdcardfs_ci_cache *ci_cache;
+
 	struct inode vfs_inode;
 };
 
@@ -535,6 +542,7 @@ extern appid_t get_appid(const char *app_name);
 extern appid_t get_ext_gid(const char *app_name);
 extern appid_t is_excluded(const char *app_name, userid_t userid);
 extern int check_caller_access_to_name(struct inode *parent_node, const struct qstr *name);
+extern unsigned int get_packagelist_gen(void);
 extern int packagelist_init(void);
 extern void packagelist_exit(void);
 
@@ -552,6 +560,7 @@ extern void setup_derived_state(struct inode *inode, perm_t perm,
 extern void get_derived_permission(struct dentry *parent, struct dentry *dentry);
 extern void get_derived_permission_new(struct dentry *parent, struct dentry *dentry, const struct qstr *name);
 extern void fixup_perms_recursive(struct dentry *dentry, struct limit_search *limit);
+extern void fixup_perms_if_stale(struct dentry *parent, struct dentry *dentry);
 
 extern void update_derived_permission_lock(struct dentry *dentry);
 void fixup_lower_ownership(struct dentry *dentry, const char *name);
@@ -233,6 +233,7 @@ static void i_callback(struct rcu_head *head)
 	struct inode *inode = container_of(head, struct inode, i_rcu);
 
 	release_own_data(SDCARDFS_I(inode));
+	sdcardfs_free_ci_cache(SDCARDFS_I(inode));
 	kmem_cache_free(sdcardfs_inode_cachep, SDCARDFS_I(inode));
 }
 
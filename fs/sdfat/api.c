@@ -346,6 +346,19 @@ s32 fsapi_map_clus(struct inode *inode, u32 clu_offset, u32 *clu, int dest)
 }
 EXPORT_SYMBOL(fsapi_map_clus);
 
+/* return the number of clusters contiguous on disk after the given one */
+u32 fsapi_get_contig_clus(struct inode *inode, u32 clu_offset, u32 clu, u32 max)
+{
+	u32 cnt;
+	struct super_block *sb = inode->i_sb;
+
+	mutex_lock(&(SDFAT_SB(sb)->s_vlock));
+	cnt = fscore_get_contig_clus(inode, clu_offset, clu, max);
+	mutex_unlock(&(SDFAT_SB(sb)->s_vlock));
+	return cnt;
+}
+EXPORT_SYMBOL(fsapi_get_contig_clus);
+
 /* reserve a cluster */
 s32 fsapi_reserve_clus(struct inode *inode)
 {
@@ -361,6 +374,17 @@ s32 fsapi_reserve_clus(struct inode *inode)
 }
 EXPORT_SYMBOL(fsapi_reserve_clus);
 
+/* drop the preallocation window of a file */
+void fsapi_release_prealloc(struct inode *inode)
+{
+	struct super_block *sb = inode->i_sb;
+
+	mutex_lock(&(SDFAT_SB(sb)->s_vlock));
+	fscore_release_prealloc(inode);
+	mutex_unlock(&(SDFAT_SB(sb)->s_vlock));
+}
+EXPORT_SYMBOL(fsapi_release_prealloc);
+
 /*----------------------------------------------------------------------*/
 /*  Directory Operation Functions                                       */
 /*----------------------------------------------------------------------*/
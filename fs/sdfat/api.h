@@ -31,10 +31,16 @@ extern "C" {
 /*----------------------------------------------------------------------*/
 /* cache size (in number of sectors)                */
 /* (should be an exponential value of 2)            */
+/* These are the sizes for small volumes. They are  */
+/* doubled per doubling of the volume size above    */
+/* 1 << META_CACHE_SCALE_BITS bytes, at most        */
+/* META_CACHE_MAX_SHIFT times                       */
 #define FAT_CACHE_SIZE          128
-#define FAT_CACHE_HASH_SIZE     64
+#define FAT_CACHE_HASH_SIZE     128
 #define BUF_CACHE_SIZE          256
-#define BUF_CACHE_HASH_SIZE     64
+#define BUF_CACHE_HASH_SIZE     256
+#define META_CACHE_SCALE_BITS   35	/* 32GB */
+#define META_CACHE_MAX_SHIFT    3
 
 /* Read-ahead related                                */
 /* First config vars. should be pow of 2             */
@@ -164,6 +170,8 @@ typedef struct {
 typedef struct {
 	spinlock_t cache_lru_lock;
 	struct list_head cache_lru;
+	struct rb_root cache_tree;	// caches sorted by file cluster
+	struct list_head shrink_list;	// on the shrinker list while it has caches
 	s32 nr_caches;
 	u32 cache_valid_id;	// for avoiding the race between alloc and free
 } EXTENT_T;
@@ -193,6 +201,16 @@ typedef struct {
 	HINT_FEMP_T hint_femp;	// hint for first empty entry
 } FILE_ID_T;
 
+/* in-memory preallocation window of an appending file */
+#define MAX_PREALLOC_WIN	8
+
+typedef struct {
+	FILE_ID_T *owner;	// file the window is kept for, NULL if unused
+	u32 start;		// next cluster the owner is expected to take
+	u32 end;		// first cluster past the window
+	u32 seq;		// age stamp for replacement
+} PREALLOC_WIN_T;
+
 typedef struct {
 	s8 *lfn;
 	s8 *sfn;
@@ -296,19 +314,32 @@ typedef struct __FS_INFO_T {
 	s32       reserved_clusters;  // # of reserved clusters (DA)
 	void        *amap;                  // AU Allocation Map
 
+	/* preallocation windows (see prealloc_skip_clus) */
+	struct {
+		PREALLOC_WIN_T win[MAX_PREALLOC_WIN];
+		u32 nr_win;
+		u32 seq;
+		FILE_ID_T *cur;		// file being allocated for
+		bool bypass;		// free space is short, ignore windows
+	} prealloc;
+
 	/* fat cache */
 	struct {
-		cache_ent_t pool[FAT_CACHE_SIZE];
+		cache_ent_t *pool;
+		u32 size;
 		cache_ent_t lru_list;
-		cache_ent_t hash_list[FAT_CACHE_HASH_SIZE];
+		cache_ent_t *hash_list;
+		u32 hash_size;
 	} fcache;
 
 	/* meta cache */
 	struct {
-		cache_ent_t pool[BUF_CACHE_SIZE];
+		cache_ent_t *pool;
+		u32 size;
 		cache_ent_t lru_list;
 		cache_ent_t keep_list;        // CACHEs in this list will not be kicked by normal lru operations
-		cache_ent_t hash_list[BUF_CACHE_HASH_SIZE];
+		cache_ent_t *hash_list;
+		u32 hash_size;
 	} dcache;
 } FS_INFO_T;
 
@@ -347,7 +378,9 @@ s32 fsapi_unlink(struct inode *inode, FILE_ID_T *fid);
 s32 fsapi_read_inode(struct inode *inode, DIR_ENTRY_T *info);
 s32 fsapi_write_inode(struct inode *inode, DIR_ENTRY_T *info, int sync);
 s32 fsapi_map_clus(struct inode *inode, u32 clu_offset, u32 *clu, int dest);
+u32 fsapi_get_contig_clus(struct inode *inode, u32 clu_offset, u32 clu, u32 max);
 s32 fsapi_reserve_clus(struct inode *inode);
+void fsapi_release_prealloc(struct inode *inode);
 
 /* directory management functions */
 s32 fsapi_mkdir(struct inode *inode, u8 *path, FILE_ID_T *fid);
@@ -29,6 +29,9 @@
 /************************************************************************/
 
 #include <linux/swap.h> /* for mark_page_accessed() */
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/mm.h>
 #include <asm/unaligned.h>
 
 #include "sdfat.h"
@@ -194,6 +197,7 @@ u8 *fcache_getblk(struct super_block *sb, u64 sec)
 	u32 page_ra_count = FCACHE_MAX_RA_SIZE >> sb->s_blocksize_bits;
 
 	bp = __fcache_find(sb, sec);
+	sdfat_statistics_set_cache(SDFAT_CACHE_FAT, bp != NULL);
 	if (bp) {
 		if (bdev_check_bdi_valid(sb)) {
 			__fcache_ent_flush(sb, bp, 0);
@@ -272,16 +276,64 @@ s32 fcache_modify(struct super_block *sb, u64 sec)
 /*======================================================================*/
 /*  Cache Initialization Functions                                      */
 /*======================================================================*/
+/*
+ * Large volumes come with huge directories and long FAT chains, so the
+ * caches (and their hash tables, to keep the chains short) are doubled
+ * per doubling of the device size above 1 << META_CACHE_SCALE_BITS.
+ * fsi is not filled in yet at this point, so go by the block device size.
+ */
+static u32 __meta_cache_shift(struct super_block *sb)
+{
+	u64 bytes = (u64)i_size_read(sb->s_bdev->bd_inode);
+	u32 shift = 0;
+
+	while ((shift < META_CACHE_MAX_SHIFT) &&
+			(bytes >> (META_CACHE_SCALE_BITS + shift)))
+		shift++;
+
+	return shift;
+}
+
+static cache_ent_t *__meta_cache_alloc(u32 nr)
+{
+	cache_ent_t *p;
+
+	p = kcalloc(nr, sizeof(cache_ent_t), GFP_KERNEL | __GFP_NOWARN);
+	if (!p)
+		p = vzalloc(nr * sizeof(cache_ent_t));
+	return p;
+}
+
 s32 meta_cache_init(struct super_block *sb)
 {
 	FS_INFO_T *fsi = &(SDFAT_SB(sb)->fsi);
+	u32 shift = __meta_cache_shift(sb);
 	s32 i;
 
+	fsi->fcache.size = FAT_CACHE_SIZE << shift;
+	fsi->fcache.hash_size = FAT_CACHE_HASH_SIZE << shift;
+	fsi->dcache.size = BUF_CACHE_SIZE << shift;
+	fsi->dcache.hash_size = BUF_CACHE_HASH_SIZE << shift;
+
+	fsi->fcache.pool = __meta_cache_alloc(fsi->fcache.size);
+	fsi->fcache.hash_list = __meta_cache_alloc(fsi->fcache.hash_size);
+	fsi->dcache.pool = __meta_cache_alloc(fsi->dcache.size);
+	fsi->dcache.hash_list = __meta_cache_alloc(fsi->dcache.hash_size);
+	if (!fsi->fcache.pool || !fsi->fcache.hash_list ||
+			!fsi->dcache.pool || !fsi->dcache.hash_list) {
+		meta_cache_shutdown(sb);
+		return -ENOMEM;
+	}
+
+	DMSG("%s: fcache %u/%u, dcache %u/%u (entries/buckets)\n", __func__,
+		fsi->fcache.size, fsi->fcache.hash_size,
+		fsi->dcache.size, fsi->dcache.hash_size);
+
 	/* LRU list */
 	fsi->fcache.lru_list.next = &fsi->fcache.lru_list;
 	fsi->fcache.lru_list.prev = fsi->fcache.lru_list.next;
 
-	for (i = 0; i < FAT_CACHE_SIZE; i++) {
+	for (i = 0; i < fsi->fcache.size; i++) {
 		fsi->fcache.pool[i].sec = ~0;
 		fsi->fcache.pool[i].flag = 0;
 		fsi->fcache.pool[i].bh = NULL;
@@ -296,7 +348,7 @@ s32 meta_cache_init(struct super_block *sb)
 	fsi->dcache.keep_list.prev = fsi->dcache.keep_list.next;
 
 	// Initially, all the BUF_CACHEs are in the LRU list
-	for (i = 0; i < BUF_CACHE_SIZE; i++) {
+	for (i = 0; i < fsi->dcache.size; i++) {
 		fsi->dcache.pool[i].sec = ~0;
 		fsi->dcache.pool[i].flag = 0;
 		fsi->dcache.pool[i].bh = NULL;
@@ -306,24 +358,24 @@ s32 meta_cache_init(struct super_block *sb)
 	}
 
 	/* HASH list */
-	for (i = 0; i < FAT_CACHE_HASH_SIZE; i++) {
+	for (i = 0; i < fsi->fcache.hash_size; i++) {
 		fsi->fcache.hash_list[i].sec = ~0;
 		fsi->fcache.hash_list[i].hash.next = &(fsi->fcache.hash_list[i]);
 ;
 		fsi->fcache.hash_list[i].hash.prev = fsi->fcache.hash_list[i].hash.next;
 	}
 
-	for (i = 0; i < FAT_CACHE_SIZE; i++)
+	for (i = 0; i < fsi->fcache.size; i++)
 		__fcache_insert_hash(sb, &(fsi->fcache.pool[i]));
 
-	for (i = 0; i < BUF_CACHE_HASH_SIZE; i++) {
+	for (i = 0; i < fsi->dcache.hash_size; i++) {
 		fsi->dcache.hash_list[i].sec = ~0;
 		fsi->dcache.hash_list[i].hash.next = &(fsi->dcache.hash_list[i]);
 
 		fsi->dcache.hash_list[i].hash.prev = fsi->dcache.hash_list[i].hash.next;
 	}
 
-	for (i = 0; i < BUF_CACHE_SIZE; i++)
+	for (i = 0; i < fsi->dcache.size; i++)
 		__dcache_insert_hash(sb, &(fsi->dcache.pool[i]));
 
 	return 0;
@@ -331,6 +383,16 @@ s32 meta_cache_init(struct super_block *sb)
 
 s32 meta_cache_shutdown(struct super_block *sb)
 {
+	FS_INFO_T *fsi = &(SDFAT_SB(sb)->fsi);
+
+	kvfree(fsi->fcache.pool);
+	fsi->fcache.pool = NULL;
+	kvfree(fsi->fcache.hash_list);
+	fsi->fcache.hash_list = NULL;
+	kvfree(fsi->dcache.pool);
+	fsi->dcache.pool = NULL;
+	kvfree(fsi->dcache.hash_list);
+	fsi->dcache.hash_list = NULL;
 	return 0;
 }
 
@@ -396,7 +458,7 @@ static cache_ent_t *__fcache_find(struct super_block *sb, u64 sec)
 	cache_ent_t *bp, *hp;
 	FS_INFO_T *fsi = &(SDFAT_SB(sb)->fsi);
 
-	off = (sec + (sec >> fsi->sect_per_clus_bits)) & (FAT_CACHE_HASH_SIZE - 1);
+	off = (sec + (sec >> fsi->sect_per_clus_bits)) & (fsi->fcache.hash_size - 1);
 	hp = &(fsi->fcache.hash_list[off]);
 	for (bp = hp->hash.next; bp != hp; bp = bp->hash.next) {
 		if (bp->sec == sec) {
@@ -445,7 +507,7 @@ static void __fcache_insert_hash(struct super_block *sb, cache_ent_t *bp)
 	FS_INFO_T *fsi;
 
 	fsi = &(SDFAT_SB(sb)->fsi);
-	off = (bp->sec + (bp->sec >> fsi->sect_per_clus_bits)) & (FAT_CACHE_HASH_SIZE-1);
+	off = (bp->sec + (bp->sec >> fsi->sect_per_clus_bits)) & (fsi->fcache.hash_size - 1);
 
 	hp = &(fsi->fcache.hash_list[off]);
 	bp->hash.next = hp->hash.next;
@@ -555,6 +617,7 @@ u8 *dcache_getblk(struct super_block *sb, u64 sec)
 	FS_INFO_T *fsi = &(SDFAT_SB(sb)->fsi);
 
 	bp = __dcache_find(sb, sec);
+	sdfat_statistics_set_cache(SDFAT_CACHE_BUF, bp != NULL);
 	if (bp) {
 		if (bdev_check_bdi_valid(sb)) {
 			MMSG("%s: found cache(%p, sect:%llu). But invalid BDI\n"
@@ -761,7 +824,7 @@ static cache_ent_t *__dcache_find(struct super_block *sb, u64 sec)
 	cache_ent_t *bp, *hp;
 	FS_INFO_T *fsi = &(SDFAT_SB(sb)->fsi);
 
-	off = (sec + (sec >> fsi->sect_per_clus_bits)) & (BUF_CACHE_HASH_SIZE - 1);
+	off = (sec + (sec >> fsi->sect_per_clus_bits)) & (fsi->dcache.hash_size - 1);
 
 	hp = &(fsi->dcache.hash_list[off]);
 	for (bp = hp->hash.next; bp != hp; bp = bp->hash.next) {
@@ -815,7 +878,7 @@ static void __dcache_insert_hash(struct super_block *sb, cache_ent_t *bp)
 	FS_INFO_T *fsi;
 
 	fsi = &(SDFAT_SB(sb)->fsi);
-	off = (bp->sec + (bp->sec >> fsi->sect_per_clus_bits)) & (BUF_CACHE_HASH_SIZE-1);
+	off = (bp->sec + (bp->sec >> fsi->sect_per_clus_bits)) & (fsi->dcache.hash_size - 1);
 
 	hp = &(fsi->dcache.hash_list[off]);
 	bp->hash.next = hp->hash.next;
@@ -3136,6 +3136,205 @@ s32 fscore_write_inode(struct inode *inode, DIR_ENTRY_T *info, s32 sync)
  * Output: errcode, cluster number
  * *clu = (~0), if it's unable to allocate a new cluster
  */
+/*
+ * Count the clusters following "clu" (the cluster at "clu_offset" in the file)
+ * that are contiguous with it on disk and still allocated to the file,
+ * looking at no more than "max" of them. The FAT entries walked here are the
+ * ones the next mappings of a sequential reader would need anyway.
+ */
+u32 fscore_get_contig_clus(struct inode *inode, u32 clu_offset, u32 clu, u32 max)
+{
+	struct super_block *sb = inode->i_sb;
+	FS_INFO_T *fsi = &(SDFAT_SB(sb)->fsi);
+	FILE_ID_T *fid = &(SDFAT_I(inode)->fid);
+	u32 num_clusters = 0;
+	u32 cnt = 0, content;
+
+	if (SDFAT_I(inode)->i_size_ondisk > 0)
+		num_clusters = (u32)((SDFAT_I(inode)->i_size_ondisk-1) >> fsi->cluster_size_bits) + 1;
+
+	if (clu_offset + 1 >= num_clusters)
+		return 0;
+
+	max = min(max, num_clusters - clu_offset - 1);
+
+	/* no fat-chain, all the clusters are contiguous */
+	if (fid->flags == 0x03)
+		return max;
+
+	if (fid->type != TYPE_FILE)
+		return 0;
+
+	while (cnt < max) {
+		if (fat_ent_get_safe(sb, clu + cnt, &content))
+			break;
+		if (content != clu + cnt + 1)
+			break;
+		cnt++;
+	}
+
+	return cnt;
+}
+
+/*
+ *  Preallocation windows
+ *
+ *  A window is a run of clusters right behind the last cluster of a
+ *  growing file. It lives in memory only: allocations for other files
+ *  skip it while searching for free clusters, so that two files growing
+ *  at the same time do not interleave. Nothing is written to disk, a
+ *  crash just forgets the windows.
+ *  Smart allocation has its own AU based placement and is left alone.
+ */
+static inline bool __prealloc_enabled(struct super_block *sb)
+{
+	struct sdfat_sb_info *sbi = SDFAT_SB(sb);
+
+	return sbi->options.prealloc &&
+		!(sbi->options.improved_allocation & SDFAT_ALLOC_SMART);
+}
+
+static PREALLOC_WIN_T *__prealloc_find(FS_INFO_T *fsi, FILE_ID_T *fid)
+{
+	s32 i;
+
+	for (i = 0; i < MAX_PREALLOC_WIN; i++) {
+		if (fsi->prealloc.win[i].owner == fid)
+			return &fsi->prealloc.win[i];
+	}
+	return NULL;
+}
+
+static void __prealloc_drop(FS_INFO_T *fsi, PREALLOC_WIN_T *win)
+{
+	win->owner = NULL;
+	fsi->prealloc.nr_win--;
+}
+
+/* return the first cluster from clu not held in a window for another file */
+u32 prealloc_skip_clus(struct super_block *sb, u32 clu)
+{
+	FS_INFO_T *fsi = &(SDFAT_SB(sb)->fsi);
+	s32 i;
+
+	if (!fsi->prealloc.nr_win || fsi->prealloc.bypass)
+		return clu;
+
+	for (i = 0; i < MAX_PREALLOC_WIN; i++) {
+		PREALLOC_WIN_T *win = &fsi->prealloc.win[i];
+
+		if (!win->owner || (win->owner == fsi->prealloc.cur))
+			continue;
+
+		/* caller wraps around if the window ends the volume */
+		if ((clu >= win->start) && (clu < win->end))
+			return win->end;
+	}
+	return clu;
+}
+
+/*
+ * called by alloc_cluster before searching: windows are ignored unless
+ * enough free clusters are left outside of them, so they can never make
+ * an allocation fail.
+ */
+void prealloc_check_space(struct super_block *sb, u32 num_alloc)
+{
+	FS_INFO_T *fsi = &(SDFAT_SB(sb)->fsi);
+	u32 num_free = fsi->num_clusters - CLUS_BASE - fsi->used_clusters;
+	u32 held = 0;
+	s32 i;
+
+	fsi->prealloc.bypass = false;
+
+	if (!fsi->prealloc.nr_win)
+		return;
+
+	for (i = 0; i < MAX_PREALLOC_WIN; i++) {
+		PREALLOC_WIN_T *win = &fsi->prealloc.win[i];
+
+		if (win->owner && (win->owner != fsi->prealloc.cur))
+			held += win->end - win->start;
+	}
+
+	if ((u64)held + num_alloc + max(fsi->reserved_clusters, 0) > num_free)
+		fsi->prealloc.bypass = true;
+}
+
+/* open a new window for fid at clu, clipped by the other windows */
+static void __prealloc_open(struct super_block *sb, FILE_ID_T *fid, u32 clu)
+{
+	FS_INFO_T *fsi = &(SDFAT_SB(sb)->fsi);
+	PREALLOC_WIN_T *win = NULL;
+	u32 end;
+	s32 i;
+
+	if (clu >= fsi->num_clusters)
+		return;
+
+	end = min_t(u32, clu + SDFAT_SB(sb)->options.prealloc, fsi->num_clusters);
+
+	for (i = 0; i < MAX_PREALLOC_WIN; i++) {
+		PREALLOC_WIN_T *other = &fsi->prealloc.win[i];
+
+		if (!other->owner) {
+			if (!win)
+				win = other;
+			continue;
+		}
+
+		if ((clu >= other->start) && (clu < other->end))
+			return;
+		if ((other->start > clu) && (other->start < end))
+			end = other->start;
+	}
+
+	if (!win) {
+		/* replace the oldest one */
+		win = &fsi->prealloc.win[0];
+		for (i = 1; i < MAX_PREALLOC_WIN; i++) {
+			if ((s32)(fsi->prealloc.win[i].seq - win->seq) < 0)
+				win = &fsi->prealloc.win[i];
+		}
+		__prealloc_drop(fsi, win);
+	}
+
+	win->owner = fid;
+	win->start = clu;
+	win->end = end;
+	win->seq = fsi->prealloc.seq++;
+	fsi->prealloc.nr_win++;
+}
+
+/* advance the window of fid past the clusters it has just been given */
+static void __prealloc_end(struct super_block *sb, FILE_ID_T *fid, u32 clu, u32 num)
+{
+	FS_INFO_T *fsi = &(SDFAT_SB(sb)->fsi);
+	PREALLOC_WIN_T *win;
+	/* a multi-cluster request may be chained non-contiguously,
+	 * the window only needs to be roughly right
+	 */
+	u32 next = clu + num;
+
+	fsi->prealloc.cur = NULL;
+	fsi->prealloc.bypass = false;
+
+	if (IS_CLUS_EOF(clu) || !__prealloc_enabled(sb))
+		return;
+
+	win = __prealloc_find(fsi, fid);
+	if (win) {
+		if ((clu >= win->start) && (clu < win->end) && (next < win->end)) {
+			win->start = next;
+			return;
+		}
+		/* used up, or the allocator went elsewhere */
+		__prealloc_drop(fsi, win);
+	}
+
+	__prealloc_open(sb, fid, next);
+}
+
 s32 fscore_map_clus(struct inode *inode, u32 clu_offset, u32 *clu, int dest)
 {
 	s32 ret, modified = false;
@@ -3237,7 +3436,15 @@ s32 fscore_map_clus(struct inode *inode, u32 clu_offset, u32 *clu, int dest)
 			return -EIO;
 		}
 
+		if (fid->type == TYPE_FILE)
+			fsi->prealloc.cur = fid;
+
 		ret = fsi->fs_func->alloc_cluster(sb, num_to_be_allocated, &new_clu, ALLOC_COLD);
+
+		if (fid->type == TYPE_FILE)
+			__prealloc_end(sb, fid, ret ? CLUS_EOF : new_clu.dir,
+					num_to_be_allocated);
+
 		if (ret)
 			return ret;
 
@@ -3381,6 +3588,20 @@ s32 fscore_reserve_clus(struct inode *inode)
 	return 0;
 }
 
+/* drop the preallocation window held for a file (close, evict) */
+void fscore_release_prealloc(struct inode *inode)
+{
+	FS_INFO_T *fsi = &(SDFAT_SB(inode->i_sb)->fsi);
+	PREALLOC_WIN_T *win;
+
+	if (!fsi->prealloc.nr_win)
+		return;
+
+	win = __prealloc_find(fsi, &(SDFAT_I(inode)->fid));
+	if (win)
+		__prealloc_drop(fsi, win);
+}
+
 /* remove an entry, BUT don't truncate */
 s32 fscore_unlink(struct inode *inode, FILE_ID_T *fid)
 {
@@ -96,7 +96,9 @@ s32 fscore_remove(struct inode *inode, FILE_ID_T *fid);
 s32 fscore_read_inode(struct inode *inode, DIR_ENTRY_T *info);
 s32 fscore_write_inode(struct inode *inode, DIR_ENTRY_T *info, int sync);
 s32 fscore_map_clus(struct inode *inode, u32 clu_offset, u32 *clu, int dest);
+u32 fscore_get_contig_clus(struct inode *inode, u32 clu_offset, u32 clu, u32 max);
 s32 fscore_reserve_clus(struct inode *inode);
+void fscore_release_prealloc(struct inode *inode);
 s32 fscore_unlink(struct inode *inode, FILE_ID_T *fid);
 
 /* directory management functions */
@@ -119,6 +121,10 @@ void get_uniname_from_dos_entry(struct super_block *sb, DOS_DENTRY_T *ep, UNI_NA
 /* file operation functions */
 s32 walk_fat_chain(struct super_block *sb, CHAIN_T *p_dir, u32 byte_offset, u32 *clu);
 
+/* cluster allocation: preallocation windows */
+void prealloc_check_space(struct super_block *sb, u32 num_alloc);
+u32 prealloc_skip_clus(struct super_block *sb, u32 clu);
+
 /* sdfat/cache.c */
 s32  meta_cache_init(struct super_block *sb);
 s32  meta_cache_shutdown(struct super_block *sb);
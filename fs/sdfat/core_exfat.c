@@ -1351,6 +1351,8 @@ static s32 exfat_alloc_cluster(struct super_block *sb, u32 num_alloc, CHAIN_T *p
 	if (num_alloc > total_cnt - fsi->used_clusters)
 		return -ENOSPC;
 
+	prealloc_check_space(sb, num_alloc);
+
 	hint_clu = p_chain->dir;
 	/* find new cluster */
 	if (IS_CLUS_EOF(hint_clu)) {
@@ -1383,6 +1385,14 @@ static s32 exfat_alloc_cluster(struct super_block *sb, u32 num_alloc, CHAIN_T *p
 	p_chain->dir = CLUS_EOF;
 
 	while ((new_clu = test_alloc_bitmap(sb, hint_clu - CLUS_BASE)) != CLUS_EOF) {
+		u32 skip_clu = prealloc_skip_clus(sb, new_clu);
+
+		/* held for another file, search again behind it */
+		if (skip_clu != new_clu) {
+			hint_clu = (skip_clu >= fsi->num_clusters) ? CLUS_BASE : skip_clu;
+			continue;
+		}
+
 		if ((new_clu != hint_clu) && (p_chain->flags == 0x03)) {
 			if (exfat_chain_cont_cluster(sb, p_chain->dir, num_clusters)) {
 				ret = -EIO;
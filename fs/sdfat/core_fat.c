@@ -250,6 +250,8 @@ static s32 fat_alloc_cluster(struct super_block *sb, u32 num_alloc, CHAIN_T *p_c
 	if (num_alloc > total_cnt - fsi->used_clusters)
 		return -ENOSPC;
 
+	prealloc_check_space(sb, num_alloc);
+
 	new_clu = p_chain->dir;
 	if (IS_CLUS_EOF(new_clu))
 		new_clu = fsi->clu_srch_ptr;
@@ -266,7 +268,8 @@ static s32 fat_alloc_cluster(struct super_block *sb, u32 num_alloc, CHAIN_T *p_c
 			goto error;
 		}
 
-		if (IS_CLUS_FREE(read_clu)) {
+		if (IS_CLUS_FREE(read_clu) &&
+				(prealloc_skip_clus(sb, new_clu) == new_clu)) {
 			if (fat_ent_set(sb, new_clu, CLUS_EOF)) {
 				ret = -EIO;
 				goto error;
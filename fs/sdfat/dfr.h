@@ -36,6 +36,9 @@
 
 #define	DFR_MAX_AU_MOVED		(16)	// Maximum # of AUs for a request
 
+#define	DFR_BG_DEFAULT_INTERVAL		(0)	// Idle check period in seconds for background mode (0: off)
+#define	DFR_BG_MAX_INTERVAL		(3600)	// Upper bound of the idle check period
+
 
 /* Debugging support*/
 #define dfr_err(fmt, args...) pr_err("DFR: " fmt "\n", args)
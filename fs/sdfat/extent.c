@@ -38,14 +38,28 @@
 /************************************************************************/
 
 #include <linux/slab.h>
+#include <linux/rbtree.h>
+#include <linux/shrinker.h>
 #include "sdfat.h"
 #include "core.h"
 
+/*
+ * Each inode keeps its extents in an rbtree sorted by file cluster, so a
+ * lookup finds the nearest extent in O(log n), plus an LRU list used to
+ * recycle entries once the per-inode limit is reached. Inodes holding
+ * extents are linked on extent_inode_list, from which the shrinker frees
+ * the least recently used extents of each inode under memory pressure.
+ *
+ * Lock order: extent->cache_lru_lock -> extent_inode_lock. The shrinker
+ * goes the other way and therefore only trylocks the inode lock.
+ */
+
 #define EXTENT_CACHE_VALID	0
 /* this must be > 0. */
-#define EXTENT_MAX_CACHE	16
+#define EXTENT_MAX_CACHE	1024
 
 struct extent_cache {
+	struct rb_node rb_node;
 	struct list_head cache_list;
 	u32 nr_contig;	/* number of contiguous clusters */
 	u32 fcluster;	/* cluster number in the file. */
@@ -61,13 +75,88 @@ struct extent_cache_id {
 
 static struct kmem_cache *extent_cache_cachep;
 
+static LIST_HEAD(extent_inode_list);
+static DEFINE_SPINLOCK(extent_inode_lock);
+static atomic_t extent_nr_caches = ATOMIC_INIT(0);
+
 static void init_once(void *c)
 {
 	struct extent_cache *cache = (struct extent_cache *)c;
 
+	RB_CLEAR_NODE(&cache->rb_node);
 	INIT_LIST_HEAD(&cache->cache_list);
 }
 
+static inline void extent_cache_free(struct extent_cache *cache)
+{
+	BUG_ON(!list_empty(&cache->cache_list));
+	kmem_cache_free(extent_cache_cachep, cache);
+}
+
+/* must be called with cache_lru_lock held */
+static void __extent_cache_remove(EXTENT_T *extent, struct extent_cache *cache)
+{
+	rb_erase(&cache->rb_node, &extent->cache_tree);
+	RB_CLEAR_NODE(&cache->rb_node);
+	list_del_init(&cache->cache_list);
+	extent->nr_caches--;
+	atomic_dec(&extent_nr_caches);
+	extent_cache_free(cache);
+}
+
+static unsigned long extent_cache_count(struct shrinker *shrink,
+					struct shrink_control *sc)
+{
+	return atomic_read(&extent_nr_caches);
+}
+
+static unsigned long extent_cache_scan(struct shrinker *shrink,
+				       struct shrink_control *sc)
+{
+	EXTENT_T *extent, *tmp;
+	struct extent_cache *cache;
+	unsigned long freed = 0;
+	s32 target;
+	LIST_HEAD(scanned);
+
+	spin_lock(&extent_inode_lock);
+	list_for_each_entry_safe(extent, tmp, &extent_inode_list, shrink_list) {
+		if (freed >= sc->nr_to_scan)
+			break;
+
+		if (!spin_trylock(&extent->cache_lru_lock))
+			continue;
+
+		/* take at most half of an inode before moving on */
+		target = extent->nr_caches / 2;
+		while (!list_empty(&extent->cache_lru) &&
+		       (extent->nr_caches > target) &&
+		       (freed < sc->nr_to_scan)) {
+			cache = list_entry(extent->cache_lru.prev,
+					   struct extent_cache, cache_list);
+			__extent_cache_remove(extent, cache);
+			freed++;
+		}
+
+		if (list_empty(&extent->cache_lru))
+			list_del_init(&extent->shrink_list);
+		else
+			list_move_tail(&extent->shrink_list, &scanned);
+		spin_unlock(&extent->cache_lru_lock);
+	}
+	/* start with the inodes which were not scanned next time */
+	list_splice_tail(&scanned, &extent_inode_list);
+	spin_unlock(&extent_inode_lock);
+
+	return freed;
+}
+
+static struct shrinker extent_cache_shrinker = {
+	.count_objects = extent_cache_count,
+	.scan_objects = extent_cache_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
 s32 extent_cache_init(void)
 {
 	extent_cache_cachep = kmem_cache_create("sdfat_extent_cache",
@@ -76,6 +165,12 @@ s32 extent_cache_init(void)
 				init_once);
 	if (!extent_cache_cachep)
 		return -ENOMEM;
+
+	if (register_shrinker(&extent_cache_shrinker)) {
+		kmem_cache_destroy(extent_cache_cachep);
+		extent_cache_cachep = NULL;
+		return -ENOMEM;
+	}
 	return 0;
 }
 
@@ -83,6 +178,7 @@ void extent_cache_shutdown(void)
 {
 	if (!extent_cache_cachep)
 		return;
+	unregister_shrinker(&extent_cache_shrinker);
 	kmem_cache_destroy(extent_cache_cachep);
 }
 
@@ -94,6 +190,8 @@ void extent_cache_init_inode(struct inode *inode)
 	extent->nr_caches = 0;
 	extent->cache_valid_id = EXTENT_CACHE_VALID + 1;
 	INIT_LIST_HEAD(&extent->cache_lru);
+	extent->cache_tree = RB_ROOT;
+	INIT_LIST_HEAD(&extent->shrink_list);
 }
 
 static inline struct extent_cache *extent_cache_alloc(void)
@@ -101,12 +199,6 @@ static inline struct extent_cache *extent_cache_alloc(void)
 	return kmem_cache_alloc(extent_cache_cachep, GFP_NOFS);
 }
 
-static inline void extent_cache_free(struct extent_cache *cache)
-{
-	BUG_ON(!list_empty(&cache->cache_list));
-	kmem_cache_free(extent_cache_cachep, cache);
-}
-
 static inline void extent_cache_update_lru(struct inode *inode,
 					struct extent_cache *cache)
 {
@@ -116,31 +208,61 @@ static inline void extent_cache_update_lru(struct inode *inode,
 		list_move(&cache->cache_list, &extent->cache_lru);
 }
 
+static void extent_cache_insert(EXTENT_T *extent, struct extent_cache *cache)
+{
+	struct rb_node **p = &extent->cache_tree.rb_node;
+	struct rb_node *parent = NULL;
+	struct extent_cache *ex;
+
+	while (*p) {
+		parent = *p;
+		ex = rb_entry(parent, struct extent_cache, rb_node);
+		if (cache->fcluster < ex->fcluster)
+			p = &(*p)->rb_left;
+		else
+			p = &(*p)->rb_right;
+	}
+	rb_link_node(&cache->rb_node, parent, p);
+	rb_insert_color(&cache->rb_node, &extent->cache_tree);
+}
+
+/* Find the extent with the greatest file cluster <= "fclus". */
+static struct extent_cache *extent_cache_find(EXTENT_T *extent, u32 fclus)
+{
+	struct rb_node *node = extent->cache_tree.rb_node;
+	struct extent_cache *p, *hit = NULL;
+
+	while (node) {
+		p = rb_entry(node, struct extent_cache, rb_node);
+		if (p->fcluster <= fclus) {
+			hit = p;
+			if (p->fcluster == fclus)
+				break;
+			node = node->rb_right;
+		} else {
+			node = node->rb_left;
+		}
+	}
+	return hit;
+}
+
 static u32 extent_cache_lookup(struct inode *inode, u32 fclus,
 			    struct extent_cache_id *cid,
 			    u32 *cached_fclus, u32 *cached_dclus)
 {
 	EXTENT_T *extent = &(SDFAT_I(inode)->fid.extent);
-
-	static struct extent_cache nohit = { .fcluster = 0, };
-
-	struct extent_cache *hit = &nohit, *p;
+	struct extent_cache *hit;
 	u32 offset = CLUS_EOF;
 
 	spin_lock(&extent->cache_lru_lock);
-	list_for_each_entry(p, &extent->cache_lru, cache_list) {
-		/* Find the cache of "fclus" or nearest cache. */
-		if (p->fcluster <= fclus && hit->fcluster < p->fcluster) {
-			hit = p;
-			if ((hit->fcluster + hit->nr_contig) < fclus) {
-				offset = hit->nr_contig;
-			} else {
-				offset = fclus - hit->fcluster;
-				break;
-			}
-		}
-	}
-	if (hit != &nohit) {
+	hit = extent_cache_find(extent, fclus);
+	if (hit) {
+		/* Use the cache of "fclus" or the end of the nearest one. */
+		if ((hit->fcluster + hit->nr_contig) < fclus)
+			offset = hit->nr_contig;
+		else
+			offset = fclus - hit->fcluster;
+
 		extent_cache_update_lru(inode, hit);
 
 		cid->id = extent->cache_valid_id;
@@ -159,17 +281,15 @@ static struct extent_cache *extent_cache_merge(struct inode *inode,
 					 struct extent_cache_id *new)
 {
 	EXTENT_T *extent = &(SDFAT_I(inode)->fid.extent);
-
 	struct extent_cache *p;
 
-	list_for_each_entry(p, &extent->cache_lru, cache_list) {
-		/* Find the same part as "new" in cluster-chain. */
-		if (p->fcluster == new->fcluster) {
-			ASSERT(p->dcluster == new->dcluster);
-			if (new->nr_contig > p->nr_contig)
-				p->nr_contig = new->nr_contig;
-			return p;
-		}
+	/* Find the same part as "new" in cluster-chain. */
+	p = extent_cache_find(extent, new->fcluster);
+	if (p && p->fcluster == new->fcluster) {
+		ASSERT(p->dcluster == new->dcluster);
+		if (new->nr_contig > p->nr_contig)
+			p->nr_contig = new->nr_contig;
+		return p;
 	}
 	return NULL;
 }
@@ -203,6 +323,12 @@ static void extent_cache_add(struct inode *inode, struct extent_cache_id *new)
 			}
 
 			spin_lock(&extent->cache_lru_lock);
+			if (new->id != EXTENT_CACHE_VALID &&
+			    new->id != extent->cache_valid_id) {
+				extent->nr_caches--;
+				extent_cache_free(tmp);
+				goto out;
+			}
 			cache = extent_cache_merge(inode, new);
 			if (cache != NULL) {
 				extent->nr_caches--;
@@ -210,13 +336,28 @@ static void extent_cache_add(struct inode *inode, struct extent_cache_id *new)
 				goto out_update_lru;
 			}
 			cache = tmp;
+			atomic_inc(&extent_nr_caches);
+			if (list_empty(&extent->shrink_list)) {
+				spin_lock(&extent_inode_lock);
+				list_add_tail(&extent->shrink_list,
+					      &extent_inode_list);
+				spin_unlock(&extent_inode_lock);
+			}
 		} else {
 			struct list_head *p = extent->cache_lru.prev;
+
 			cache = list_entry(p, struct extent_cache, cache_list);
+			rb_erase(&cache->rb_node, &extent->cache_tree);
 		}
 		cache->fcluster = new->fcluster;
 		cache->dcluster = new->dcluster;
 		cache->nr_contig = new->nr_contig;
+		extent_cache_insert(extent, cache);
+		/* a new entry is linked here, a recycled one is moved */
+		if (list_empty(&cache->cache_list)) {
+			list_add(&cache->cache_list, &extent->cache_lru);
+			goto out;
+		}
 	}
 out_update_lru:
 	extent_cache_update_lru(inode, cache);
@@ -236,9 +377,12 @@ static void __extent_cache_inval_inode(struct inode *inode)
 	while (!list_empty(&extent->cache_lru)) {
 		cache = list_entry(extent->cache_lru.next,
 				   struct extent_cache, cache_list);
-		list_del_init(&cache->cache_list);
-		extent->nr_caches--;
-		extent_cache_free(cache);
+		__extent_cache_remove(extent, cache);
+	}
+	if (!list_empty(&extent->shrink_list)) {
+		spin_lock(&extent_inode_lock);
+		list_del_init(&extent->shrink_list);
+		spin_unlock(&extent_inode_lock);
 	}
 	/* Update. The copy of caches before this id is discarded. */
 	extent->cache_valid_id++;
@@ -1723,6 +1723,73 @@ defrag_check_fs_busy(
 }
 
 
+/**
+ * @fn		__dfr_bg_work
+ * @brief	idle-time trigger for background defrag
+ * @param	work	dfr_bg_work of sdfat_sb_info
+ * @remark	File selection and relocation stay in defrag_daemon
+ *		(IOC_DFR_TRAV/IOC_DFR_REQ). This only decides *when* to wake it:
+ *		the bdev must have seen no I/O since the previous check, and
+ *		userspace must not have suspended background mode.
+ */
+static void __dfr_bg_work(struct work_struct *work)
+{
+	struct sdfat_sb_info *sbi = container_of(to_delayed_work(work),
+					struct sdfat_sb_info, dfr_bg_work);
+	struct super_block *sb = sbi->host_sb;
+	struct hd_struct *part = sb->s_bdev->bd_part;
+	char *envp[] = { "SDFAT_DFR=BACKGROUND", NULL };
+	int reserved_clus = 0, queued_pages = 0;
+	int total = 0, clean = 0, full = 0;
+	unsigned long ios;
+	int busy, uevent = 0;
+
+	/* unmount in progress */
+	if (!sb->s_root)
+		return;
+
+	if (!sbi->dfr_bg_interval || sbi->dfr_bg_suspend)
+		return;
+
+	ios = part_stat_read(part, ios[READ]) + part_stat_read(part, ios[WRITE]);
+	busy = (ios != sbi->dfr_bg_last_ios) || part_in_flight(part) ||
+		defrag_check_fs_busy(sb, &reserved_clus, &queued_pages);
+	sbi->dfr_bg_last_ios = ios;
+
+	if (busy) {
+		sbi->dfr_bg_nr_throttled++;
+		goto out;
+	}
+
+	if (atomic_read(&sbi->dfr_info.stat) != DFR_SB_STAT_IDLE)
+		goto out;
+
+	__lock_super(sb);
+	uevent = fsapi_dfr_check_dfr_required(sb, &total, &clean, &full);
+	__unlock_super(sb);
+
+	if (uevent) {
+		sbi->dfr_bg_nr_wakeups++;
+		kobject_uevent_env(&sbi->sb_kobj, KOBJ_CHANGE, envp);
+		dfr_debug("bg uevent for defrag_daemon, total_au %d, "
+				"clean_au %d, full_au %d", total, clean, full);
+	}
+out:
+	if (sbi->dfr_bg_interval && !sbi->dfr_bg_suspend)
+		queue_delayed_work(system_freezable_wq, &sbi->dfr_bg_work,
+				sbi->dfr_bg_interval * HZ);
+}
+
+static void __dfr_bg_arm(struct sdfat_sb_info *sbi)
+{
+	if (sbi->dfr_bg_interval && !sbi->dfr_bg_suspend)
+		mod_delayed_work(system_freezable_wq, &sbi->dfr_bg_work,
+				sbi->dfr_bg_interval * HZ);
+	else
+		cancel_delayed_work(&sbi->dfr_bg_work);
+}
+
+
 /**
  * @fn		sdfat_ioctl_defrag_req
  * @brief	ioctl to send defrag requests
@@ -1776,6 +1843,13 @@ sdfat_ioctl_defrag_req(
 			err = -EBUSY;
 			goto error;
 		}
+
+		/* Background requests are refused while userspace is interactive */
+		if ((head.mode & DFR_MODE_BACKGROUND) && sbi->dfr_bg_suspend) {
+			dfr_debug("bg defrag suspended, cancel defrag (mode %d)", head.mode);
+			err = -EBUSY;
+			goto error;
+		}
 	}
 
 	/* Total length is saved in the chunk header's nr_chunks field */
@@ -2049,6 +2123,10 @@ static inline int __alloc_dfr_mem_if_required(struct super_block *sb)
 #ifdef	CONFIG_SDFAT_DFR
 	struct sdfat_sb_info *sbi = SDFAT_SB(sb);
 
+	/* always initialized, put_super cancels it unconditionally */
+	INIT_DELAYED_WORK(&sbi->dfr_bg_work, __dfr_bg_work);
+	sbi->dfr_bg_interval = DFR_BG_DEFAULT_INTERVAL;
+
 	if (!sbi->options.defrag)
 		return 0;
 
@@ -2079,6 +2157,13 @@ static inline int __alloc_dfr_mem_if_required(struct super_block *sb)
 	return 0;
 }
 
+static void __cancel_dfr_bg_work(struct sdfat_sb_info *sbi)
+{
+#ifdef	CONFIG_SDFAT_DFR
+	cancel_delayed_work_sync(&sbi->dfr_bg_work);
+#endif
+}
+
 static void __free_dfr_mem_if_required(struct super_block *sb)
 {
 #ifdef	CONFIG_SDFAT_DFR
@@ -3039,6 +3124,9 @@ static int sdfat_file_release(struct inode *inode, struct file *filp)
 	/* FIXME : Added bug_on to confirm that there is no size mismatch */
 	sdfat_debug_bug_on(SDFAT_I(inode)->fid.size != i_size_read(inode));
 	SDFAT_I(inode)->fid.size = i_size_read(inode);
+	/* the writer is done, give the window back to other files */
+	if (filp->f_mode & FMODE_WRITE)
+		fsapi_release_prealloc(inode);
 	fsapi_sync_fs(sb, 0);
 	return 0;
 }
@@ -3179,6 +3267,8 @@ static int sdfat_bmap(struct inode *inode, sector_t sector, sector_t *phys,
 	const unsigned char blocksize_bits = sb->s_blocksize_bits;
 	sector_t last_block;
 	unsigned int cluster, clu_offset, sec_offset;
+	int lookup_only = (*create == BMAP_NOT_CREATE);
+	int dfr_on = 0;
 	int err = 0;
 
 	*phys = 0;
@@ -3214,6 +3304,7 @@ static int sdfat_bmap(struct inode *inode, sector_t sector, sector_t *phys,
 		(loff_t)((loff_t)clu_offset << fsi->cluster_size_bits),
 		(loff_t)((loff_t)(clu_offset + 1) << fsi->cluster_size_bits),
 			__func__))) {
+		dfr_on = 1;
 		err = __do_dfr_map_cluster(inode, clu_offset, &cluster);
 	} else {
 		if (*create & BMAP_ADD_CLUSTER)
@@ -3238,6 +3329,26 @@ static int sdfat_bmap(struct inode *inode, sector_t sector, sector_t *phys,
 
 		*phys = CLUS_TO_SECT(fsi, cluster) + sec_offset;
 		*mapped_blocks = fsi->sect_per_clus - sec_offset;
+
+		/*
+		 * For plain lookups (read, readahead) keep mapping across the
+		 * cluster boundary as long as the next clusters follow on disk,
+		 * so that a single get_block call can feed a bio as large as
+		 * the device takes.
+		 */
+		if (lookup_only && !dfr_on && (sector < last_block)) {
+			unsigned int max_bytes;
+			u32 contig;
+
+			max_bytes = queue_max_sectors(bdev_get_queue(sb->s_bdev)) << 9;
+			contig = fsapi_get_contig_clus(inode, clu_offset, cluster,
+					max_bytes >> fsi->cluster_size_bits);
+			/* don't map past i_size beyond the current cluster */
+			if (contig && (last_block - sector > *mapped_blocks)) {
+				*mapped_blocks = min_t(u64, last_block - sector,
+					*mapped_blocks + ((u64)contig << fsi->sect_per_clus_bits));
+			}
+		}
 	}
 #if 0
 	else {
@@ -4102,6 +4213,7 @@ static void sdfat_evict_inode(struct inode *inode)
 	invalidate_inode_buffers(inode);
 	clear_inode(inode);
 	fsapi_invalidate_extent(inode);
+	fsapi_release_prealloc(inode);
 	sdfat_detach(inode);
 
 	/* after end of this function, caller will remove inode hash */
@@ -4118,6 +4230,7 @@ static void sdfat_put_super(struct super_block *sb)
 	sdfat_log_msg(sb, KERN_INFO, "trying to unmount...");
 
 	__cancel_delayed_work_sync(sbi);
+	__cancel_dfr_bg_work(sbi);
 
 	if (__is_sb_dirty(sb))
 		sdfat_write_super(sb);
@@ -4142,6 +4255,8 @@ static void sdfat_put_super(struct super_block *sb)
 	sb->s_fs_info = NULL;
 
 	kobject_del(&sbi->sb_kobj);
+	/* sysfs writers are drained now, catch a re-arm that raced with us */
+	__cancel_dfr_bg_work(sbi);
 	kobject_put(&sbi->sb_kobj);
 	if (!sbi->use_vmalloc)
 		kfree(sbi);
@@ -4374,6 +4489,8 @@ static int __sdfat_show_options(struct seq_file *m, struct super_block *sb)
 		seq_puts(m, ",adj_hid");
 	if (opts->adj_req)
 		seq_puts(m, ",adj_req");
+	if (opts->prealloc)
+		seq_printf(m, ",prealloc=%u", opts->prealloc);
 	seq_printf(m, ",symlink=%u", opts->symlink);
 	seq_printf(m, ",bps=%ld", sb->s_blocksize);
 	if (opts->errors == SDFAT_ERRORS_CONT)
@@ -4505,6 +4622,62 @@ static ssize_t fullau_show(struct sdfat_sb_info *sbi, char *buf)
 }
 SDFAT_ATTR(fullau, 0444, fullau_show, NULL);
 
+#ifdef	CONFIG_SDFAT_DFR
+static ssize_t dfr_bg_show(struct sdfat_sb_info *sbi, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", sbi->dfr_bg_interval);
+}
+
+static ssize_t dfr_bg_store(struct sdfat_sb_info *sbi, const char *buf, size_t len)
+{
+	unsigned int val;
+	int err;
+
+	if (!sbi->options.defrag)
+		return -EOPNOTSUPP;
+
+	err = kstrtouint(buf, 0, &val);
+	if (err)
+		return err;
+
+	if (val > DFR_BG_MAX_INTERVAL)
+		return -EINVAL;
+
+	sbi->dfr_bg_interval = val;
+	__dfr_bg_arm(sbi);
+	return len;
+}
+SDFAT_ATTR(dfr_bg, 0644, dfr_bg_show, dfr_bg_store);
+
+static ssize_t dfr_bg_suspend_show(struct sdfat_sb_info *sbi, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%d\n", sbi->dfr_bg_suspend);
+}
+
+static ssize_t dfr_bg_suspend_store(struct sdfat_sb_info *sbi, const char *buf, size_t len)
+{
+	unsigned int val;
+	int err;
+
+	err = kstrtouint(buf, 0, &val);
+	if (err)
+		return err;
+
+	sbi->dfr_bg_suspend = !!val;
+	if (sbi->options.defrag)
+		__dfr_bg_arm(sbi);
+	return len;
+}
+SDFAT_ATTR(dfr_bg_suspend, 0644, dfr_bg_suspend_show, dfr_bg_suspend_store);
+
+static ssize_t dfr_bg_stat_show(struct sdfat_sb_info *sbi, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "wakeups %u throttled %u\n",
+			sbi->dfr_bg_nr_wakeups, sbi->dfr_bg_nr_throttled);
+}
+SDFAT_ATTR(dfr_bg_stat, 0444, dfr_bg_stat_show, NULL);
+#endif
+
 static struct attribute *sdfat_attrs[] = {
 	&sdfat_attr_type.attr,
 	&sdfat_attr_eio.attr,
@@ -4512,6 +4685,11 @@ static struct attribute *sdfat_attrs[] = {
 	&sdfat_attr_totalau.attr,
 	&sdfat_attr_cleanau.attr,
 	&sdfat_attr_fullau.attr,
+#ifdef	CONFIG_SDFAT_DFR
+	&sdfat_attr_dfr_bg.attr,
+	&sdfat_attr_dfr_bg_suspend.attr,
+	&sdfat_attr_dfr_bg_stat.attr,
+#endif
 	NULL,
 };
 
@@ -4568,6 +4746,7 @@ enum {
 	Opt_discard,
 	Opt_fs,
 	Opt_adj_req,
+	Opt_prealloc,
 };
 
 static const match_table_t sdfat_tokens = {
@@ -4596,6 +4775,7 @@ static const match_table_t sdfat_tokens = {
 	{Opt_discard, "discard"},
 	{Opt_fs, "fs=%s"},
 	{Opt_adj_req, "adj_req"},
+	{Opt_prealloc, "prealloc=%u"},
 	{Opt_err, NULL}
 };
 
@@ -4624,6 +4804,7 @@ static int parse_options(struct super_block *sb, char *options, int silent,
 	opts->symlink = 0;
 	opts->errors = SDFAT_ERRORS_RO;
 	opts->discard = 0;
+	opts->prealloc = 0;
 	*debug = 0;
 
 	if (!options)
@@ -4762,6 +4943,13 @@ static int parse_options(struct super_block *sb, char *options, int silent,
 			IMSG("adjust request config is not enabled. ignore\n");
 #endif
 			break;
+		case Opt_prealloc:
+			if (match_int(&args[0], &option))
+				return -EINVAL;
+			if (option < 0 || option > SDFAT_MAX_PREALLOC)
+				return -EINVAL;
+			opts->prealloc = option;
+			break;
 		default:
 			if (!silent) {
 				sdfat_msg(sb, KERN_ERR,
@@ -27,6 +27,7 @@
 #include <linux/ratelimit.h>
 #include <linux/version.h>
 #include <linux/kobject.h>
+#include <linux/rbtree.h>
 #include "api.h"
 
 #ifdef CONFIG_SDFAT_DFR
@@ -46,6 +47,8 @@
 #define SDFAT_ALLOC_DELAY	(1)    /* Delayed allocation */
 #define SDFAT_ALLOC_SMART	(2)    /* Smart allocation */
 
+#define SDFAT_MAX_PREALLOC	(4096) /* Upper bound of prealloc= in clusters */
+
 /*
  * sdfat allocator destination for smart allocation
  */
@@ -128,6 +131,7 @@ struct sdfat_mount_options {
 	unsigned char discard;      /* flag on if -o dicard specified and device support discard() */
 	unsigned char fs_type;      /* fs_type that user specified */
 	unsigned short adj_req;     /* support aligned mpage write */
+	unsigned int prealloc;      /* preallocation window in clusters (0: off) */
 };
 
 #define SDFAT_HASH_BITS    8
@@ -173,6 +177,14 @@ struct sdfat_sb_info {
 	unsigned int dfr_hint_idx;
 	int dfr_reserved_clus;
 
+	/* idle-time trigger for background defrag (see __dfr_bg_work) */
+	struct delayed_work dfr_bg_work;
+	unsigned int dfr_bg_interval;	/* seconds between idle checks, 0: off */
+	int dfr_bg_suspend;		/* set by userspace while interactive */
+	unsigned long dfr_bg_last_ios;	/* bdev I/O count seen at the last check */
+	unsigned int dfr_bg_nr_wakeups;	/* # of uevents sent to defrag_daemon */
+	unsigned int dfr_bg_nr_throttled; /* # of checks skipped for I/O activity */
+
 #ifdef	CONFIG_SDFAT_DFR_DEBUG
 	int dfr_spo_flag;
 #endif  /* CONFIG_SDFAT_DFR_DEBUG */
@@ -303,6 +315,12 @@ static inline void sdfat_save_attr(struct inode *inode, u32 attr)
 
 /* sdfat/statistics.c */
 /* bigdata function */
+enum {
+	SDFAT_CACHE_FAT,
+	SDFAT_CACHE_BUF,
+	SDFAT_CACHE_MAX
+};
+
 #ifdef CONFIG_SDFAT_STATISTICS
 extern int sdfat_statistics_init(struct kset *sdfat_kset);
 extern void sdfat_statistics_uninit(void);
@@ -313,6 +331,7 @@ extern void sdfat_statistics_set_create(u8 flags);
 extern void sdfat_statistics_set_rw(u8 flags, u32 clu_offset, s32 create);
 extern void sdfat_statistics_set_trunc(u8 flags, CHAIN_T *clu);
 extern void sdfat_statistics_set_vol_size(struct super_block *sb);
+extern void sdfat_statistics_set_cache(u8 type, s32 hit);
 #else
 static inline int sdfat_statistics_init(struct kset *sdfat_kset)
 {
@@ -326,6 +345,7 @@ static inline void sdfat_statistics_set_create(u8 flags) {};
 static inline void sdfat_statistics_set_rw(u8 flags, u32 clu_offset, s32 create) {};
 static inline void sdfat_statistics_set_trunc(u8 flags, CHAIN_T *clu) {};
 static inline void sdfat_statistics_set_vol_size(struct super_block *sb) {};
+static inline void sdfat_statistics_set_cache(u8 type, s32 hit) {};
 #endif
 
 /* sdfat/nls.c */
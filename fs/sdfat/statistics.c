@@ -41,6 +41,8 @@ static struct sdfat_statistics {
 	u32 mnt_cnt[SDFAT_MNT_MAX];
 	u32 nofat_op[SDFAT_OP_MAX];
 	u32 vol_size[SDFAT_VOL_MAX];
+	u64 cache_hit[SDFAT_CACHE_MAX];
+	u64 cache_miss[SDFAT_CACHE_MAX];
 } statistics;
 
 static struct kset *sdfat_statistics_kset;
@@ -128,11 +130,24 @@ static ssize_t vol_size_show(struct kobject *kobj,
 			statistics.vol_size[SDFAT_VOL_XTB]);
 }
 
+static ssize_t meta_cache_show(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buff)
+{
+	return snprintf(buff, PAGE_SIZE, "\"FCACHE_HIT\":\"%llu\","
+			"\"FCACHE_MISS\":\"%llu\",\"DCACHE_HIT\":\"%llu\","
+			"\"DCACHE_MISS\":\"%llu\"\n",
+			statistics.cache_hit[SDFAT_CACHE_FAT],
+			statistics.cache_miss[SDFAT_CACHE_FAT],
+			statistics.cache_hit[SDFAT_CACHE_BUF],
+			statistics.cache_miss[SDFAT_CACHE_BUF]);
+}
+
 static struct kobj_attribute vfat_cl_attr = __ATTR_RO(vfat_cl);
 static struct kobj_attribute exfat_cl_attr = __ATTR_RO(exfat_cl);
 static struct kobj_attribute mount_attr = __ATTR_RO(mount);
 static struct kobj_attribute nofat_op_attr = __ATTR_RO(nofat_op);
 static struct kobj_attribute vol_size_attr = __ATTR_RO(vol_size);
+static struct kobj_attribute meta_cache_attr = __ATTR_RO(meta_cache);
 
 static struct attribute *attributes_statistics[] = {
 	&vfat_cl_attr.attr,
@@ -140,6 +155,7 @@ static struct attribute *attributes_statistics[] = {
 	&mount_attr.attr,
 	&nofat_op_attr.attr,
 	&vol_size_attr.attr,
+	&meta_cache_attr.attr,
 	NULL,
 };
 
@@ -279,3 +295,17 @@ void sdfat_statistics_set_vol_size(struct super_block *sb)
 	else
 		statistics.vol_size[SDFAT_VOL_XTB]++;
 }
+
+/* type : SDFAT_CACHE_FAT or SDFAT_CACHE_BUF
+ * hit : lookup was served from the cache
+ *
+ * Called with fsi->v_sem held, counters of different volumes
+ * are summed up without further locking like the ones above.
+ */
+void sdfat_statistics_set_cache(u8 type, s32 hit)
+{
+	if (hit)
+		statistics.cache_hit[type]++;
+	else
+		statistics.cache_miss[type]++;
+}
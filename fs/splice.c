@@ -33,8 +33,78 @@
 #include <linux/socket.h>
 #include <linux/compat.h>
 #include <linux/aio.h>
+#include <linux/percpu.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include "internal.h"
 
+/*
+ * Accounting of pages gifted with vmsplice(SPLICE_F_GIFT): how many were
+ * queued, how many were handed on by reference to ->sendpage() and how
+ * many ended up copied by a write to a file.
+ */
+enum splice_gift_item {
+	SPLICE_GIFT_QUEUED,
+	SPLICE_GIFT_SENDPAGE,
+	SPLICE_GIFT_COPIED,
+	NR_SPLICE_GIFT_ITEMS
+};
+
+#ifdef CONFIG_DEBUG_FS
+static DEFINE_PER_CPU(unsigned long [NR_SPLICE_GIFT_ITEMS], splice_gift_stats);
+
+static inline void splice_gift_count(struct pipe_buffer *buf,
+				     enum splice_gift_item item)
+{
+	if (buf->flags & PIPE_BUF_FLAG_GIFT)
+		this_cpu_inc(splice_gift_stats[item]);
+}
+
+static int splice_gift_stats_show(struct seq_file *m, void *v)
+{
+	static const char * const names[NR_SPLICE_GIFT_ITEMS] = {
+		[SPLICE_GIFT_QUEUED]	= "queued",
+		[SPLICE_GIFT_SENDPAGE]	= "sendpage",
+		[SPLICE_GIFT_COPIED]	= "copied",
+	};
+	unsigned long sum;
+	int i, cpu;
+
+	for (i = 0; i < NR_SPLICE_GIFT_ITEMS; i++) {
+		sum = 0;
+		for_each_possible_cpu(cpu)
+			sum += per_cpu(splice_gift_stats, cpu)[i];
+		seq_printf(m, "%s %lu\n", names[i], sum);
+	}
+	return 0;
+}
+
+static int splice_gift_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, splice_gift_stats_show, NULL);
+}
+
+static const struct file_operations splice_gift_stats_fops = {
+	.open		= splice_gift_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init splice_gift_stats_init(void)
+{
+	debugfs_create_file("splice_gift_stats", S_IRUGO, NULL, NULL,
+			    &splice_gift_stats_fops);
+	return 0;
+}
+late_initcall(splice_gift_stats_init);
+#else
+static inline void splice_gift_count(struct pipe_buffer *buf,
+				     enum splice_gift_item item)
+{
+}
+#endif
+
 /*
  * Attempt to steal a page from a pipe buffer. This should perhaps go into
  * a vm helper function, it's already simplified quite a bit by the
@@ -212,8 +282,11 @@ ssize_t splice_to_pipe(struct pipe_inode_info *pipe,
 			buf->len = spd->partial[page_nr].len;
 			buf->private = spd->partial[page_nr].private;
 			buf->ops = spd->ops;
+			/* don't let a stale GIFT from an earlier user mark it */
+			buf->flags = 0;
 			if (spd->flags & SPLICE_F_GIFT)
 				buf->flags |= PIPE_BUF_FLAG_GIFT;
+			splice_gift_count(buf, SPLICE_GIFT_QUEUED);
 
 			pipe->nrbufs++;
 			page_nr++;
@@ -707,7 +780,7 @@ static int pipe_to_sendpage(struct pipe_inode_info *pipe,
 {
 	struct file *file = sd->u.file;
 	loff_t pos = sd->pos;
-	int more;
+	int more, ret;
 
 	if (!likely(file->f_op->sendpage))
 		return -EINVAL;
@@ -717,8 +790,15 @@ static int pipe_to_sendpage(struct pipe_inode_info *pipe,
 	if (sd->len < sd->total_len && pipe->nrbufs > 1)
 		more |= MSG_SENDPAGE_NOTLAST;
 
-	return file->f_op->sendpage(file, buf->page, buf->offset,
-				    sd->len, &pos, more);
+	/*
+	 * The socket takes its own reference on the page, a gifted user
+	 * page goes out in the skb frags without being copied.
+	 */
+	ret = file->f_op->sendpage(file, buf->page, buf->offset,
+				   sd->len, &pos, more);
+	if (ret == sd->len)
+		splice_gift_count(buf, SPLICE_GIFT_SENDPAGE);
+	return ret;
 }
 
 static void wakeup_pipe_writers(struct pipe_inode_info *pipe)
@@ -1047,6 +1127,7 @@ iter_file_splice_write(struct pipe_inode_info *pipe, struct file *out,
 				ret -= buf->len;
 				buf->len = 0;
 				buf->ops = NULL;
+				splice_gift_count(buf, SPLICE_GIFT_COPIED);
 				ops->release(pipe, buf);
 				pipe->curbuf = (pipe->curbuf + 1) & (pipe->buffers - 1);
 				pipe->nrbufs--;
@@ -1083,6 +1164,8 @@ static int write_pipe_buf(struct pipe_inode_info *pipe, struct pipe_buffer *buf,
 	data = kmap(buf->page);
 	ret = __kernel_write(sd->u.file, data + buf->offset, sd->len, &tmp);
 	kunmap(buf->page);
+	if (ret == sd->len)
+		splice_gift_count(buf, SPLICE_GIFT_COPIED);
 
 	return ret;
 }
@@ -78,9 +78,20 @@ struct squashfs_bio_request {
 
 static int squashfs_bio_submit(struct squashfs_read_request *req);
 
+/*
+ * Readahead submits the bios of all its blocks before any of them is
+ * decompressed.  Completion is handled on an unbound workqueue so that the
+ * blocks get decompressed on whichever CPUs are idle, each one using its
+ * own stream with SQUASHFS_DECOMP_MULTI_PERCPU, rather than one after the
+ * other on the CPU that issued the readahead.  Do not run more requests at
+ * once than there are decompressors, the others would only block on them.
+ */
 int squashfs_init_read_wq(void)
 {
-	squashfs_read_wq = create_workqueue("SquashFS read wq");
+	squashfs_read_wq = alloc_workqueue("squashfs_read",
+					   WQ_UNBOUND | WQ_HIGHPRI |
+					   WQ_MEM_RECLAIM,
+					   squashfs_max_decompressors());
 	return !!squashfs_read_wq;
 }
 
@@ -325,7 +336,7 @@ static int squashfs_bio_submit(struct squashfs_read_request *req)
 		squashfs_process_blocks(req);
 	else {
 		INIT_WORK(&req->offload, read_wq_handler);
-		schedule_work(&req->offload);
+		queue_work(squashfs_read_wq, &req->offload);
 	}
 	return 0;
 
@@ -16,6 +16,7 @@
 #include <linux/pagemap.h>
 #include <linux/quotaops.h>
 #include <linux/backing-dev.h>
+#include <linux/dyn_sync_cntrl.h>
 #include "internal.h"
 
 bool fsync_enabled = true;
@@ -447,6 +448,8 @@ int vfs_fsync_range(struct file *file, loff_t start, loff_t end, int datasync)
 		spin_unlock(&inode->i_lock);
 		mark_inode_dirty_sync(inode);
 	}
+	if (dyn_fsync_can_batch(file))
+		return dyn_fsync_range(file, start, end, datasync);
 	return file->f_op->fsync(file, start, end, datasync);
 }
 EXPORT_SYMBOL(vfs_fsync_range);
@@ -85,6 +85,12 @@ struct cpufreq_policy {
 	void			*governor_data;
 	bool			governor_enabled; /* governor start/stop flag */
 
+	/*
+	 * Set by the driver's ->init() when ->fast_switch() may be called
+	 * for this policy from scheduler context, i.e. without sleeping.
+	 */
+	bool			fast_switch_possible;
+
 	struct work_struct	update; /* if update_policy() needs to be
 					 * called, but you're in IRQ context */
 
@@ -275,6 +281,15 @@ struct cpufreq_driver {
 	int		(*target_intermediate)(struct cpufreq_policy *policy,
 					       unsigned int index);
 
+	/*
+	 * Only for policies with fast_switch_possible set.  Called with
+	 * interrupts disabled and must not sleep; switches straight to the
+	 * lowest table frequency at or above target_freq, without
+	 * transition notifiers, and returns it, or 0 if nothing was done.
+	 */
+	unsigned int	(*fast_switch)(struct cpufreq_policy *policy,
+				       unsigned int target_freq);
+
 	/* should be defined, if possible */
 	unsigned int	(*get)(unsigned int cpu);
 
@@ -384,6 +399,7 @@ static inline void cpufreq_resume(void) {}
 #define CPUFREQ_TRANSITION_NOTIFIER	(0)
 #define CPUFREQ_POLICY_NOTIFIER		(1)
 #define CPUFREQ_GOVINFO_NOTIFIER	(2)
+#define CPUFREQ_FRAME_NOTIFIER		(3)
 
 /* Transition notifiers */
 #define CPUFREQ_PRECHANGE		(0)
@@ -420,6 +436,12 @@ struct cpufreq_govinfo {
 };
 extern struct atomic_notifier_head cpufreq_govinfo_notifier_list;
 
+/*
+ * Display drivers report frame commits to CPUFREQ_FRAME_NOTIFIER users,
+ * e.g. boost drivers that hold a boost only while frames keep coming.
+ */
+void cpufreq_notify_frame_commit(void);
+
 #else /* CONFIG_CPU_FREQ */
 static inline int cpufreq_register_notifier(struct notifier_block *nb,
 						unsigned int list)
@@ -431,8 +453,41 @@ static inline int cpufreq_unregister_notifier(struct notifier_block *nb,
 {
 	return 0;
 }
+static inline void cpufreq_notify_frame_commit(void) { }
 #endif /* !CONFIG_CPU_FREQ */
 
+/*********************************************************************
+ *                   CPUFREQ FREQUENCY CONSTRAINTS                   *
+ *********************************************************************/
+
+/*
+ * Min/max frequency requesters, highest priority first.  When votes
+ * conflict a requester may only narrow the range left by the ones above
+ * it, so e.g. a boost min never overrides a thermal max.
+ */
+enum cpufreq_constraint_type {
+	CPUFREQ_CONSTRAINT_THERMAL,
+	CPUFREQ_CONSTRAINT_USER,
+	CPUFREQ_CONSTRAINT_PERFD,
+	CPUFREQ_CONSTRAINT_BOOST,
+	CPUFREQ_CONSTRAINT_NR,
+};
+
+#ifdef CONFIG_CPU_FREQ
+int cpufreq_constraint_set(enum cpufreq_constraint_type type,
+			   unsigned int cpu, unsigned int min,
+			   unsigned int max);
+void cpufreq_constraint_update(void);
+#else
+static inline int cpufreq_constraint_set(enum cpufreq_constraint_type type,
+					 unsigned int cpu, unsigned int min,
+					 unsigned int max)
+{
+	return 0;
+}
+static inline void cpufreq_constraint_update(void) { }
+#endif
+
 /**
  * cpufreq_scale - "old * mult / div" calculation for large values (32-bit-arch
  * safe)
@@ -497,6 +552,8 @@ struct cpufreq_governor {
 int cpufreq_driver_target(struct cpufreq_policy *policy,
 				 unsigned int target_freq,
 				 unsigned int relation);
+unsigned int cpufreq_driver_fast_switch(struct cpufreq_policy *policy,
+					unsigned int target_freq);
 int __cpufreq_driver_target(struct cpufreq_policy *policy,
 				   unsigned int target_freq,
 				   unsigned int relation);
@@ -181,6 +181,36 @@ static inline struct cpuidle_driver *cpuidle_get_cpu_driver(
 	struct cpuidle_device *dev) {return NULL; }
 #endif
 
+/*
+ * Wakeup source attribution: the first irq or ipi handled after an idle
+ * period is charged with ending it, see drivers/cpuidle/cpuidle.c.
+ */
+#ifdef CONFIG_CPU_IDLE
+DECLARE_PER_CPU(int, cpuidle_wakeup_pending);
+
+extern void __cpuidle_note_wakeup(unsigned int irq, int ipi,
+				  const char *ipi_name);
+extern void cpuidle_note_cluster_wakeup(void);
+extern unsigned int cpuidle_cluster_wakeup_irq(void);
+
+static inline void cpuidle_note_wakeup_irq(unsigned int irq)
+{
+	if (unlikely(__this_cpu_read(cpuidle_wakeup_pending)))
+		__cpuidle_note_wakeup(irq, -1, NULL);
+}
+
+static inline void cpuidle_note_wakeup_ipi(int ipi, const char *name)
+{
+	if (unlikely(__this_cpu_read(cpuidle_wakeup_pending)))
+		__cpuidle_note_wakeup(0, ipi, name);
+}
+#else
+static inline void cpuidle_note_wakeup_irq(unsigned int irq) { }
+static inline void cpuidle_note_wakeup_ipi(int ipi, const char *name) { }
+static inline void cpuidle_note_cluster_wakeup(void) { }
+static inline unsigned int cpuidle_cluster_wakeup_irq(void) {return 0; }
+#endif
+
 /* kernel/sched/idle.c */
 extern void sched_idle_set_state(struct cpuidle_state *idle_state, int index);
 
@@ -310,4 +310,26 @@ static inline int update_devfreq(struct devfreq *devfreq)
 }
 #endif /* CONFIG_PM_DEVFREQ */
 
+/*
+ * Expected bandwidth hints for the bw_hwmon governor: clients about to
+ * start a burst of traffic the monitor can't have seen yet.
+ */
+enum bw_hwmon_floor_client {
+	BW_HWMON_FLOOR_MDSS,
+	BW_HWMON_FLOOR_KGSL,
+	BW_HWMON_FLOOR_CAMERA,
+	BW_HWMON_FLOOR_NR,
+};
+
+#ifdef CONFIG_DEVFREQ_GOV_MSM_BW_HWMON
+extern int bw_hwmon_set_floor(enum bw_hwmon_floor_client client,
+			      unsigned long mbps);
+#else
+static inline int bw_hwmon_set_floor(enum bw_hwmon_floor_client client,
+				     unsigned long mbps)
+{
+	return 0;
+}
+#endif
+
 #endif /* __LINUX_DEVFREQ_H__ */
@@ -67,6 +67,36 @@
 #define DIAG_IOCTL_REGISTER_CALLBACK	37
 #define DIAG_IOCTL_HDLC_TOGGLE	38
 #define DIAG_IOCTL_QUERY_CON_ALL	40
+#define DIAG_IOCTL_MD_RING_SETUP	41
+
+/*
+ * Memory device ring buffer, set up with DIAG_IOCTL_MD_RING_SETUP and
+ * mapped with mmap() on the diag device. The first page of the mapping
+ * holds struct diag_md_ring_ctl; the data area starts at data_offset.
+ *
+ * head and tail are free running byte counters, the position in the data
+ * area is (counter & (size - 1)). The driver only writes head and the
+ * logger only writes tail. Each record is a struct diag_md_ring_rec
+ * followed by len bytes of data, padded to DIAG_MD_RING_ALIGN. proc is 0
+ * for local data and the same remote token read() reports otherwise. A
+ * record with proc DIAG_MD_RING_PAD carries no data and means the rest of
+ * the data area up to the wrap point is unused.
+ */
+#define DIAG_MD_RING_ALIGN		8
+#define DIAG_MD_RING_PAD		(-1)
+
+struct diag_md_ring_ctl {
+	uint32_t head;
+	uint32_t tail;
+	uint32_t size;
+	uint32_t data_offset;
+	uint32_t dropped;
+};
+
+struct diag_md_ring_rec {
+	int32_t proc;
+	uint32_t len;
+};
 
 /* PC Tools IDs */
 #define APQ8060_TOOLS_ID	4062
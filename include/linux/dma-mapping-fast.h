@@ -16,6 +16,8 @@
 #include <linux/iommu.h>
 #include <linux/io-pgtable-fast.h>
 
+struct fast_smmu_iova_cache;
+
 struct dma_fast_smmu_mapping {
 	struct device		*dev;
 	struct iommu_domain	*domain;
@@ -31,9 +33,12 @@ struct dma_fast_smmu_mapping {
 
 	dma_addr_t	pgtbl_dma_handle;
 	av8l_fast_iopte	*pgtbl_pmds;
+	bool		cont_hint;
 
 	spinlock_t	lock;
 	struct notifier_block notifier;
+
+	struct fast_smmu_iova_cache __percpu *iova_cache;
 };
 
 #ifdef CONFIG_IOMMU_IO_PGTABLE_FAST
@@ -0,0 +1,30 @@
+#ifndef _LINUX_DYN_SYNC_CNTRL_H
+#define _LINUX_DYN_SYNC_CNTRL_H
+
+#include <linux/fs.h>
+
+#ifdef CONFIG_DYNAMIC_FSYNC
+extern bool dyn_fsync_active;
+
+int dyn_fsync_range(struct file *file, loff_t start, loff_t end, int datasync);
+
+/* Group commit is only used on local block filesystems */
+static inline bool dyn_fsync_can_batch(struct file *file)
+{
+	return dyn_fsync_active &&
+	       (file_inode(file)->i_sb->s_type->fs_flags & FS_REQUIRES_DEV);
+}
+#else
+static inline bool dyn_fsync_can_batch(struct file *file)
+{
+	return false;
+}
+
+static inline int dyn_fsync_range(struct file *file, loff_t start,
+				  loff_t end, int datasync)
+{
+	return file->f_op->fsync(file, start, end, datasync);
+}
+#endif
+
+#endif /* _LINUX_DYN_SYNC_CNTRL_H */
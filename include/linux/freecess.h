@@ -42,6 +42,26 @@ struct kfreecess_msg_data
 	pkg_info_t pkg_info;	//MOD_PKG
 };
 
+/*
+ * Event ring shared with the userspace daemon through /dev/freecess.
+ * The first page of the mapping holds the header, records start at
+ * offset FREECESS_RING_DATA_OFFSET. The kernel advances head, the daemon
+ * advances tail once it has consumed records; both count records and
+ * wrap at FREECESS_RING_RECORDS. read() returns the number of pending
+ * records as a u64 and poll() reports POLLIN while any are pending. The
+ * kernel only wakes the daemon when the ring goes from empty to
+ * non-empty, so the daemon should drain until head == tail.
+ */
+#define FREECESS_RING_RECORDS		1024
+#define FREECESS_RING_DATA_OFFSET	4096
+
+struct freecess_ring_hdr {
+	unsigned int head;
+	unsigned int tail;
+	unsigned int nr_records;
+	unsigned int dropped;
+};
+
 typedef void (*freecess_hook)(void* data, unsigned int len);
 
 int sig_report(struct task_struct *caller, struct task_struct *p);
@@ -1226,6 +1226,17 @@ struct sb_writers {
 #endif
 };
 
+/* Reasons for a path walk on a superblock to drop out of RCU mode */
+enum rcuwalk_fallback {
+	RCUWALK_DCACHE_MISS,		/* component not in the dcache */
+	RCUWALK_REVALIDATE,		/* ->d_revalidate() needed to block */
+	RCUWALK_PERMISSION,		/* ->permission() needed to block */
+	RCUWALK_SYMLINK,		/* following a symlink */
+	RCUWALK_LAST,			/* last component of a mountpoint lookup */
+	RCUWALK_SEQ_RETRY,		/* raced with a rename or unlink, restart */
+	RCUWALK_FALLBACK_NR,
+};
+
 struct super_block {
 	struct list_head	s_list;		/* Keep this first */
 	dev_t			s_dev;		/* search index; _not_ kdev_t */
@@ -1310,11 +1321,16 @@ struct super_block {
 	struct workqueue_struct *s_dio_done_wq;
 	struct hlist_head s_pins;
 
+	/* Why path walks on this sb had to leave RCU mode */
+	atomic_long_t s_rcuwalk_fallback[RCUWALK_FALLBACK_NR];
+
 	/*
 	 * Keep the lru lists last in the structure so they always sit on their
-	 * own individual cachelines.
+	 * own individual cachelines.  Unused negative dentries have their own
+	 * LRU so that they can be kept within sysctl_negative_dentry_limit.
 	 */
 	struct list_lru		s_dentry_lru ____cacheline_aligned_in_smp;
+	struct list_lru		s_dentry_neg_lru ____cacheline_aligned_in_smp;
 	struct list_lru		s_inode_lru ____cacheline_aligned_in_smp;
 	struct rcu_head		rcu;
 
@@ -173,6 +173,7 @@ struct fsnotify_group {
 			spinlock_t	idr_lock;
 			struct idr      idr;
 			struct user_struct      *user;
+			struct hlist_head	*merge_hash;
 		} inotify_data;
 #endif
 #ifdef CONFIG_FANOTIFY
@@ -0,0 +1,120 @@
+/* The industrial I/O - block based buffers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ */
+#ifndef _IIO_BLOCK_BUF_H_
+#define _IIO_BLOCK_BUF_H_
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/**
+ * struct iio_buffer_block_alloc_req - request to allocate buffer blocks
+ * @type:	type of the blocks, must be 0
+ * @size:	size of each block in bytes
+ * @count:	in: number of blocks wanted, out: number of blocks allocated
+ * @id:		out: id of the first block allocated
+ */
+struct iio_buffer_block_alloc_req {
+	__u32	type;
+	__u32	size;
+	__u32	count;
+	__u32	id;
+};
+
+/* A block that has been filled only partially, e.g. on buffer disable */
+#define IIO_BUFFER_BLOCK_FLAG_PARTIAL	(1 << 0)
+
+/**
+ * struct iio_buffer_block - description of a buffer block
+ * @id:		id of the block
+ * @size:	size of the block in bytes
+ * @bytes_used:	number of bytes of valid data in the block
+ * @type:	type of the block, always 0
+ * @flags:	IIO_BUFFER_BLOCK_FLAG_*
+ * @offset:	mmap offset of the block on the buffer chrdev
+ * @timestamp:	time the block was completed, in ns
+ */
+struct iio_buffer_block {
+	__u32	id;
+	__u32	size;
+	__u32	bytes_used;
+	__u32	type;
+	__u32	flags;
+	__u32	offset;
+	__u64	timestamp;
+};
+
+#define IIO_BUFFER_BLOCK_ALLOC_IOCTL	_IOWR('i', 0xa0, \
+					      struct iio_buffer_block_alloc_req)
+#define IIO_BUFFER_BLOCK_FREE_IOCTL	_IO('i', 0xa1)
+#define IIO_BUFFER_BLOCK_QUERY_IOCTL	_IOWR('i', 0xa2, \
+					      struct iio_buffer_block)
+#define IIO_BUFFER_BLOCK_ENQUEUE_IOCTL	_IOW('i', 0xa3, struct iio_buffer_block)
+#define IIO_BUFFER_BLOCK_DEQUEUE_IOCTL	_IOR('i', 0xa4, struct iio_buffer_block)
+
+#ifdef __KERNEL__
+
+#include <linux/kref.h>
+#include <linux/list.h>
+
+struct device;
+struct iio_buffer;
+struct iio_block_buf;
+
+enum iio_block_buf_block_state {
+	IIO_BLOCK_STATE_DEQUEUED,
+	IIO_BLOCK_STATE_QUEUED,
+	IIO_BLOCK_STATE_ACTIVE,
+	IIO_BLOCK_STATE_DONE,
+	IIO_BLOCK_STATE_DEAD,
+};
+
+/**
+ * struct iio_block_buf_block - a block of a block buffer
+ * @block:	description of the block handed to user space
+ * @head:	entry in the incoming or outgoing list of the buffer
+ * @kref:	held by the buffer and by each mapping of the block
+ * @buf:	buffer the block belongs to
+ * @vaddr:	kernel address of the block memory
+ * @phys_addr:	DMA address of the block memory
+ * @state:	where the block currently is, see iio_block_buf_block_state
+ */
+struct iio_block_buf_block {
+	struct iio_buffer_block block;
+	struct list_head head;
+	struct kref kref;
+	struct iio_block_buf *buf;
+	void *vaddr;
+	dma_addr_t phys_addr;
+	enum iio_block_buf_block_state state;
+};
+
+/**
+ * struct iio_block_buf_ops - DMA hooks of a block buffer
+ * @submit:	start filling @block with DMA; call iio_block_buf_block_done()
+ *		once it is full. Called with the buffer enabled only.
+ * @abort:	stop all DMA transfers; blocks not completed by the time this
+ *		returns are queued again and resubmitted on the next enable.
+ *
+ * Buffers without ops are filled by the CPU through iio_push_to_buffers().
+ */
+struct iio_block_buf_ops {
+	int (*submit)(struct iio_block_buf *buf,
+		      struct iio_block_buf_block *block);
+	void (*abort)(struct iio_block_buf *buf);
+};
+
+struct iio_buffer *iio_block_buf_allocate(struct device *dma_dev,
+					  const struct iio_block_buf_ops *ops,
+					  void *driver_data);
+void iio_block_buf_free(struct iio_buffer *buffer);
+void iio_block_buf_block_done(struct iio_block_buf_block *block,
+			      size_t bytes_used);
+void *iio_block_buf_get_drvdata(struct iio_block_buf *buf);
+
+#endif /* __KERNEL__ */
+
+#endif /* _IIO_BLOCK_BUF_H_ */
@@ -16,6 +16,9 @@
 #ifdef CONFIG_IIO_BUFFER
 
 struct iio_buffer;
+struct iio_buffer_block;
+struct iio_buffer_block_alloc_req;
+struct vm_area_struct;
 
 /**
  * struct iio_buffer_access_funcs - access functions for buffers.
@@ -31,6 +34,16 @@ struct iio_buffer;
  * @set_length:		set number of datums in buffer
  * @release:		called when the last reference to the buffer is dropped,
  *			should free all resources allocated by the buffer.
+ * @enable:		called once the device is set up to capture into the
+ *			buffer, before the driver's postenable.
+ * @disable:		called when the device stops capturing into the buffer.
+ * @alloc_blocks:	allocate blocks for the block interface, see
+ *			IIO_BUFFER_BLOCK_ALLOC_IOCTL.
+ * @free_blocks:	free all blocks of the block interface.
+ * @query_block:	fill in the description of a block.
+ * @enqueue_block:	hand a block to the buffer to be filled.
+ * @dequeue_block:	take back the oldest filled block, -EAGAIN if none.
+ * @mmap:		map a block to user space.
  *
  * The purpose of this structure is to make the buffer element
  * modular as event for a given driver, different usecases may require
@@ -55,6 +68,20 @@ struct iio_buffer_access_funcs {
 	int (*set_length)(struct iio_buffer *buffer, int length);
 
 	void (*release)(struct iio_buffer *buffer);
+
+	int (*enable)(struct iio_buffer *buffer, struct iio_dev *indio_dev);
+	void (*disable)(struct iio_buffer *buffer, struct iio_dev *indio_dev);
+
+	int (*alloc_blocks)(struct iio_buffer *buffer,
+			    struct iio_buffer_block_alloc_req *req);
+	int (*free_blocks)(struct iio_buffer *buffer);
+	int (*query_block)(struct iio_buffer *buffer,
+			   struct iio_buffer_block *block);
+	int (*enqueue_block)(struct iio_buffer *buffer,
+			     struct iio_buffer_block *block);
+	int (*dequeue_block)(struct iio_buffer *buffer,
+			     struct iio_buffer_block *block);
+	int (*mmap)(struct iio_buffer *buffer, struct vm_area_struct *vma);
 };
 
 /**
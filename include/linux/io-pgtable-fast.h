@@ -20,7 +20,7 @@ typedef u64 av8l_fast_iopte;
 #define iopte_pmd_offset(pmds, iova) (pmds + (iova >> 12))
 
 int av8l_fast_map_public(av8l_fast_iopte *ptep, phys_addr_t paddr, size_t size,
-			 int prot);
+			 int prot, bool cont);
 void av8l_fast_unmap_public(av8l_fast_iopte *ptep, size_t size);
 
 /* events for notifiers passed to av8l_register_notify */
@@ -109,9 +109,39 @@ enum iommu_attr {
 	DOMAIN_ATTR_FAST,
 	DOMAIN_ATTR_PGTBL_INFO,
 	DOMAIN_ATTR_EARLY_MAP,
+	DOMAIN_ATTR_DEFER_TLBI,	/* unmap leaves TLB invalidation to caller */
+	DOMAIN_ATTR_CONT_HINT,	/* use the contiguous hint for 64K runs */
 	DOMAIN_ATTR_MAX,
 };
 
+#define IOMMU_GATHER_MAX_RANGES	8
+
+/**
+ * struct iommu_iotlb_gather - TLB invalidation left over by unmaps
+ * @size: total number of bytes gathered
+ * @nr_ranges: number of entries used in @ranges
+ * @overflow: more discontiguous ranges were gathered than @ranges holds
+ * @ranges: the unmapped ranges, adjacent ones merged
+ *
+ * Filled by iommu_unmap_gather() and consumed by iommu_iotlb_sync().
+ */
+struct iommu_iotlb_gather {
+	size_t		size;
+	unsigned int	nr_ranges;
+	bool		overflow;
+	struct {
+		unsigned long	iova;
+		size_t		size;
+	} ranges[IOMMU_GATHER_MAX_RANGES];
+};
+
+static inline void iommu_iotlb_gather_init(struct iommu_iotlb_gather *gather)
+{
+	gather->size = 0;
+	gather->nr_ranges = 0;
+	gather->overflow = false;
+}
+
 extern struct dentry *iommu_debugfs_top;
 
 #ifdef CONFIG_IOMMU_API
@@ -124,6 +154,7 @@ extern struct dentry *iommu_debugfs_top;
  * @detach_dev: detach device from an iommu domain
  * @map: map a physically contiguous memory region to an iommu domain
  * @unmap: unmap a physically contiguous memory region from an iommu domain
+ * @unmap_nosync: like @unmap, but leave the TLB invalidation to @iotlb_sync
  * @map_sg: map a scatter-gather list of physically contiguous memory chunks
  * to an iommu domain
  * @iova_to_phys: translate iova to physical address
@@ -140,6 +171,7 @@ extern struct dentry *iommu_debugfs_top;
  * @reg_read: read an IOMMU register
  * @reg_write: write an IOMMU register
  * @tlbi_domain: Invalidate all TLBs covering an iommu domain
+ * @iotlb_sync: Invalidate the TLB for everything in a gather and wait for it
  * @enable_config_clocks: Enable all config clocks for this domain's IOMMU
  * @disable_config_clocks: Disable all config clocks for this domain's IOMMU
  * @priv: per-instance data private to the iommu driver
@@ -154,6 +186,8 @@ struct iommu_ops {
 		   phys_addr_t paddr, size_t size, int prot);
 	size_t (*unmap)(struct iommu_domain *domain, unsigned long iova,
 		     size_t size);
+	size_t (*unmap_nosync)(struct iommu_domain *domain, unsigned long iova,
+			       size_t size);
 	size_t (*map_sg)(struct iommu_domain *domain, unsigned long iova,
 			 struct scatterlist *sg, unsigned int nents, int prot);
 	int (*map_range)(struct iommu_domain *domain, unsigned long iova,
@@ -188,6 +222,8 @@ struct iommu_ops {
 	void (*reg_write)(struct iommu_domain *domain, unsigned long val,
 			  unsigned long offset);
 	void (*tlbi_domain)(struct iommu_domain *domain);
+	void (*iotlb_sync)(struct iommu_domain *domain,
+			   struct iommu_iotlb_gather *gather);
 	int (*enable_config_clocks)(struct iommu_domain *domain);
 	void (*disable_config_clocks)(struct iommu_domain *domain);
 
@@ -223,6 +259,11 @@ extern int iommu_map(struct iommu_domain *domain, unsigned long iova,
 		     phys_addr_t paddr, size_t size, int prot);
 extern size_t iommu_unmap(struct iommu_domain *domain, unsigned long iova,
 		       size_t size);
+extern size_t iommu_unmap_gather(struct iommu_domain *domain,
+				 unsigned long iova, size_t size,
+				 struct iommu_iotlb_gather *gather);
+extern void iommu_iotlb_sync(struct iommu_domain *domain,
+			     struct iommu_iotlb_gather *gather);
 extern int iommu_map_range(struct iommu_domain *domain, unsigned long iova,
 		    struct scatterlist *sg, size_t len, int prot);
 extern int iommu_unmap_range(struct iommu_domain *domain, unsigned long iova,
@@ -415,6 +456,18 @@ static inline int iommu_unmap(struct iommu_domain *domain, unsigned long iova,
 	return -ENODEV;
 }
 
+static inline size_t iommu_unmap_gather(struct iommu_domain *domain,
+					unsigned long iova, size_t size,
+					struct iommu_iotlb_gather *gather)
+{
+	return 0;
+}
+
+static inline void iommu_iotlb_sync(struct iommu_domain *domain,
+				    struct iommu_iotlb_gather *gather)
+{
+}
+
 static inline int iommu_map_range(struct iommu_domain *domain,
 				unsigned long iova,
 				struct scatterlist *sg, size_t len, int prot)
@@ -97,10 +97,14 @@ enum ipa_aggr_mode {
  * invoked for on data path
  * @IPA_RECEIVE: data is struct sk_buff
  * @IPA_WRITE_DONE: data is struct sk_buff
+ * @IPA_CLIENT_START_POLL: data is NULL, client should schedule its NAPI
+ * @IPA_CLIENT_COMP_NAPI: data is NULL, client should complete its NAPI
  */
 enum ipa_dp_evt_type {
 	IPA_RECEIVE,
 	IPA_WRITE_DONE,
+	IPA_CLIENT_START_POLL,
+	IPA_CLIENT_COMP_NAPI,
 };
 
 /**
@@ -610,6 +614,8 @@ struct ipa_ext_intf {
  * @skip_ep_cfg: boolean field that determines if EP should be configured
  *  by IPA driver
  * @keep_ipa_awake: when true, IPA will not be clock gated
+ * @napi_enabled: when true, Rx is polled from the client's NAPI context
+ *  instead of the IPA driver's polling work
  */
 struct ipa_sys_connect_params {
 	struct ipa_ep_cfg ipa_ep_cfg;
@@ -619,12 +625,14 @@ struct ipa_sys_connect_params {
 	ipa_notify_cb notify;
 	bool skip_ep_cfg;
 	bool keep_ipa_awake;
+	bool napi_enabled;
 };
 
 /**
  * struct ipa_tx_meta - meta-data for the TX packet
  * @dma_address: dma mapped address of TX packet
  * @dma_address_valid: is above field valid?
+ * @xmit_more: more packets follow right away, the doorbell may be deferred
  */
 struct ipa_tx_meta {
 	u8 pkt_init_dst_ep;
@@ -632,6 +640,7 @@ struct ipa_tx_meta {
 	bool pkt_init_dst_ep_remote;
 	dma_addr_t dma_address;
 	bool dma_address_valid;
+	bool xmit_more;
 };
 
 /**
@@ -1161,6 +1170,18 @@ struct ipa_tz_unlock_reg_info {
 	u64 size;
 };
 
+/**
+ * struct ipa_dma_memcpy_desc - one copy of an IPADMA memcpy batch
+ * @dest: physical address to store the copied data
+ * @src: physical address of the source data to copy
+ * @len: number of bytes to copy
+ */
+struct ipa_dma_memcpy_desc {
+	u64 dest;
+	u64 src;
+	int len;
+};
+
 #if defined CONFIG_IPA || defined CONFIG_IPA3
 
 /*
@@ -1449,6 +1470,9 @@ int ipa_dma_sync_memcpy(u64 dest, u64 src, int len);
 int ipa_dma_async_memcpy(u64 dest, u64 src, int len,
 			void (*user_cb)(void *user1), void *user_param);
 
+int ipa_dma_async_memcpy_batch(const struct ipa_dma_memcpy_desc *descs,
+			int num, void (*user_cb)(void *user1), void *user_param);
+
 int ipa_dma_uc_memcpy(phys_addr_t dest, phys_addr_t src, int len);
 
 void ipa_dma_destroy(void);
@@ -2151,6 +2175,13 @@ static inline int ipa_dma_async_memcpy(phys_addr_t dest, phys_addr_t src
 	return -EPERM;
 }
 
+static inline int ipa_dma_async_memcpy_batch(
+			const struct ipa_dma_memcpy_desc *descs, int num,
+			void (*user_cb)(void *user1), void *user_param)
+{
+	return -EPERM;
+}
+
 static inline int ipa_dma_uc_memcpy(phys_addr_t dest, phys_addr_t src, int len)
 {
 	return -EPERM;
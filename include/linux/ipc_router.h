@@ -108,6 +108,7 @@ enum ipc_rtr_af_event_type {
  * @num_tx_bytes: Number of bytes transmitted.
  * @num_rx_bytes: Number of bytes received.
  * @priv: Private information registered by the port owner.
+ * @rcu: Defers freeing the port past the lock-free port lookups.
  */
 struct msm_ipc_port {
 	struct list_head list;
@@ -145,6 +146,7 @@ struct msm_ipc_port {
 	unsigned long num_tx_bytes;
 	unsigned long num_rx_bytes;
 	void *priv;
+	struct rcu_head rcu;
 };
 
 #ifdef CONFIG_IPC_ROUTER
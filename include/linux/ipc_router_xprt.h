@@ -147,6 +147,16 @@ struct msm_ipc_router_xprt {
 	void (*sft_close_done)(struct msm_ipc_router_xprt *xprt);
 };
 
+/**
+ * msm_ipc_router_xprt_notify() - Notify an event from an XPRT to the router
+ * @xprt: XPRT on which the event occurred.
+ * @event: One of IPC_ROUTER_XPRT_EVENT_*.
+ * @data: The received packet for IPC_ROUTER_XPRT_EVENT_DATA.
+ *
+ * On IPC_ROUTER_XPRT_EVENT_DATA the router takes over the fragments of the
+ * packet without copying them. The XPRT still owns the emptied packet and
+ * must release it with release_pkt() once this function returns.
+ */
 void msm_ipc_router_xprt_notify(struct msm_ipc_router_xprt *xprt,
 				unsigned event,
 				void *data);
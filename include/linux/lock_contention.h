@@ -0,0 +1,74 @@
+#ifndef __LINUX_LOCK_CONTENTION_H
+#define __LINUX_LOCK_CONTENTION_H
+
+/*
+ * Sampling lock contention profiler.
+ *
+ * The slowpaths of mutexes, rwsems and spinlocks time one in every
+ * sample_period contended acquisitions and account the wait to the call
+ * site and to a per-cpu histogram, without any of the lockdep machinery.
+ * It is switched on at run time through
+ * /sys/kernel/debug/lock_contention/enable and costs a patched out
+ * branch while off.
+ */
+
+#include <linux/types.h>
+#include <linux/static_key.h>
+
+enum lock_contention_type {
+	LOCK_CONTENTION_SPIN,
+	LOCK_CONTENTION_MUTEX,
+	LOCK_CONTENTION_RWSEM_READ,
+	LOCK_CONTENTION_RWSEM_WRITE,
+	LOCK_CONTENTION_NR,
+};
+
+#ifdef CONFIG_DEBUG_FS
+extern struct static_key lock_contention_key;
+
+extern u64 __lock_contention_begin(void);
+extern void __lock_contention_end(u64 start, enum lock_contention_type type,
+				  unsigned long ip);
+
+static inline bool lock_contention_enabled(void)
+{
+	return static_key_false(&lock_contention_key);
+}
+
+/*
+ * Returns the start time of a sampled wait, to be handed to
+ * lock_contention_end() once the lock is taken, or 0.
+ */
+static inline u64 lock_contention_begin(void)
+{
+	if (lock_contention_enabled())
+		return __lock_contention_begin();
+	return 0;
+}
+
+static inline void lock_contention_end(u64 start,
+				       enum lock_contention_type type,
+				       unsigned long ip)
+{
+	if (start)
+		__lock_contention_end(start, type, ip);
+}
+#else
+static inline bool lock_contention_enabled(void)
+{
+	return false;
+}
+
+static inline u64 lock_contention_begin(void)
+{
+	return 0;
+}
+
+static inline void lock_contention_end(u64 start,
+				       enum lock_contention_type type,
+				       unsigned long ip)
+{
+}
+#endif
+
+#endif /* __LINUX_LOCK_CONTENTION_H */
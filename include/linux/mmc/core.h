@@ -97,6 +97,16 @@ struct mmc_data {
 	bool			fault_injected; /* fault injected */
 };
 
+/* Points in the life of a request sampled by the latency recorder */
+enum mmc_lat_mark {
+	MMC_LAT_QUEUED,		/* prepared by the block driver */
+	MMC_LAT_ISSUED,		/* handed to the host driver */
+	MMC_LAT_CMD_DONE,	/* command response, marked by host drivers */
+	MMC_LAT_XFER_DONE,	/* host driver completed the request */
+	MMC_LAT_BUSY_DONE,	/* card left the programming state */
+	MMC_LAT_NR_MARKS,
+};
+
 struct mmc_host;
 struct mmc_request {
 	struct mmc_command	*sbc;		/* SET_BLOCK_COUNT for multiblock */
@@ -109,6 +119,9 @@ struct mmc_request {
 	struct mmc_host		*host;
 	struct mmc_cmdq_req	*cmdq_req;
 	struct request *req;
+#ifdef CONFIG_MMC_RING_BUFFER
+	ktime_t			lat_ts[MMC_LAT_NR_MARKS];
+#endif
 };
 
 struct mmc_bus_ops {
@@ -25,12 +25,34 @@
 #define MMC_TRACE_EVENT_SZ	256
 #define MMC_TRACE_RBUF_NUM_EVENTS	(MMC_TRACE_RBUF_SZ / MMC_TRACE_EVENT_SZ)
 
+#define MMC_LAT_RBUF_NUM_RECS	512
+
+enum mmc_lat_phase {
+	MMC_LAT_PH_ISSUE,	/* queued to command response */
+	MMC_LAT_PH_XFER,	/* command response to transfer done */
+	MMC_LAT_PH_BUSY,	/* transfer done to card not busy */
+	MMC_LAT_PH_COMPLETE,	/* last hardware event to completion */
+	MMC_LAT_NR_PHASES,
+};
+
+struct mmc_lat_rec {
+	s64	ts_ns;
+	u32	phase_us[MMC_LAT_NR_PHASES];
+	u32	blocks;
+	u8	opcode;
+	u8	is_write;
+	s16	err;
+};
+
 struct mmc_host;
 struct mmc_trace_buffer {
 	int	wr_idx;
 	bool stop_tracing;
 	spinlock_t trace_lock;
 	char *data;
+	bool lat_enabled;
+	unsigned int lat_wr_idx;
+	struct mmc_lat_rec *lat;
 };
 
 #ifdef CONFIG_MMC_RING_BUFFER
@@ -39,6 +61,16 @@ void mmc_trace_write(struct mmc_host *mmc, const char *fmt, ...);
 void mmc_trace_init(struct mmc_host *mmc);
 void mmc_trace_free(struct mmc_host *mmc);
 void mmc_dump_trace_buffer(struct mmc_host *mmc, struct seq_file *s);
+int mmc_lat_enable(struct mmc_host *mmc, bool enable);
+void mmc_lat_record(struct mmc_host *mmc, struct mmc_request *mrq, int err);
+void mmc_dump_lat_buffer(struct mmc_host *mmc, struct seq_file *s);
+
+/* struct mmc_host is not complete here, hence a macro */
+#define mmc_lat_mark(mmc, mrq, mark)					\
+	do {								\
+		if (unlikely((mmc)->trace_buf.lat_enabled))		\
+			(mrq)->lat_ts[(mark)] = ktime_get();		\
+	} while (0)
 #else
 static inline void mmc_stop_tracing(struct mmc_host *mmc) {}
 static inline void mmc_trace_write(struct mmc_host *mmc,
@@ -47,6 +79,15 @@ static inline void mmc_trace_init(struct mmc_host *mmc) {}
 static inline void mmc_trace_free(struct mmc_host *mmc) {}
 static inline void mmc_dump_trace_buffer(struct mmc_host *mmc,
 		struct seq_file *s) {}
+static inline int mmc_lat_enable(struct mmc_host *mmc, bool enable)
+{
+	return -ENODEV;
+}
+static inline void mmc_lat_record(struct mmc_host *mmc,
+		struct mmc_request *mrq, int err) {}
+static inline void mmc_dump_lat_buffer(struct mmc_host *mmc,
+		struct seq_file *s) {}
+#define mmc_lat_mark(mmc, mrq, mark)	do { } while (0)
 #endif
 
 #define MMC_TRACE(mmc, fmt, ...) \
@@ -66,6 +66,8 @@ struct msm_bus_scale_pdata {
 	unsigned int active_only;
 };
 
+struct msm_bus_vote_stats;
+
 struct msm_bus_client_handle {
 	char *name;
 	int mas;
@@ -77,6 +79,7 @@ struct msm_bus_client_handle {
 	u64 cur_slp_ib;
 	u64 cur_slp_ab;
 	bool active_only;
+	struct msm_bus_vote_stats *stats;
 };
 
 /* Scaling APIs */
@@ -1007,6 +1007,30 @@ int sps_register_event(struct sps_pipe *h, struct sps_register_event *reg);
 int sps_transfer_one(struct sps_pipe *h, phys_addr_t addr, u32 size,
 		     void *user, u32 flags);
 
+/**
+ * Perform a number of single buffer DMA transfers on an SPS connection end
+ * point
+ *
+ * This function is equivalent to calling sps_transfer_one() for every I/O
+ * vector, but the pipe is locked once and the hardware write pointer is
+ * updated once for the whole batch. Either all or none of the buffers are
+ * queued.
+ *
+ * @h - client context for SPS connection end point
+ *
+ * @iovec - array of I/O vectors. The upper address bits go in the flags,
+ *  as for sps_transfer().
+ *
+ * @user - array of user pointers, one per I/O vector, or NULL
+ *
+ * @count - number of I/O vectors
+ *
+ * @return 0 on success, negative value on error
+ *
+ */
+int sps_transfer_bulk(struct sps_pipe *h, struct sps_iovec *iovec,
+		      void **user, u32 count);
+
 /**
  * Read event queue for an SPS connection end point
  *
@@ -1036,6 +1060,26 @@ int sps_get_event(struct sps_pipe *h, struct sps_event_notify *event);
  */
 int sps_get_iovec(struct sps_pipe *h, struct sps_iovec *iovec);
 
+/**
+ * Get a number of processed I/O vectors (completed transfers)
+ *
+ * This function fetches up to max processed I/O vectors with one lock hold
+ * and, for polled pipes, one polling operation.
+ *
+ * @h - client context for SPS connection end point
+ *
+ * @iovec - array of at least max I/O vector structs (output)
+ *
+ * @max - maximum number of I/O vectors to fetch
+ *
+ * @count - number of I/O vectors fetched (output), 0 if none is processed
+ *
+ * @return 0 on success, negative value on error
+ *
+ */
+int sps_get_iovecs(struct sps_pipe *h, struct sps_iovec *iovec, u32 max,
+		   u32 *count);
+
 /**
  * Enable an SPS connection end point
  *
@@ -1496,6 +1540,13 @@ static inline int sps_transfer_one(struct sps_pipe *h, phys_addr_t addr,
 	return -EPERM;
 }
 
+static inline int sps_transfer_bulk(struct sps_pipe *h,
+				    struct sps_iovec *iovec, void **user,
+				    u32 count)
+{
+	return -EPERM;
+}
+
 static inline int sps_get_event(struct sps_pipe *h,
 				struct sps_event_notify *event)
 {
@@ -1507,6 +1558,12 @@ static inline int sps_get_iovec(struct sps_pipe *h, struct sps_iovec *iovec)
 	return -EPERM;
 }
 
+static inline int sps_get_iovecs(struct sps_pipe *h, struct sps_iovec *iovec,
+				 u32 max, u32 *count)
+{
+	return -EPERM;
+}
+
 static inline int sps_flow_on(struct sps_pipe *h)
 {
 	return -EPERM;
@@ -157,6 +157,9 @@ enum gsi_evt_ring_elem_size {
  *                   applicable)
  * @int_modt:        cycles base interrupt moderation (32KHz clock)
  * @int_modc:        interrupt moderation packet counter
+ * @int_mod_adaptive: if true, int_modc is raised at runtime with the event
+ *                   rate of the ring. int_modt must be set as it bounds the
+ *                   added latency. Only applies to GSI_INTR_IRQ rings
  * @intvec:          write data for MSI write
  * @msi_addr:        MSI address
  * @rp_update_addr:  physical address to which event read pointer should be
@@ -182,6 +185,7 @@ struct gsi_evt_ring_props {
 	void *ring_base_vaddr;
 	uint16_t int_modt;
 	uint8_t int_modc;
+	bool int_mod_adaptive;
 	uint32_t intvec;
 	uint64_t msi_addr;
 	uint64_t rp_update_addr;
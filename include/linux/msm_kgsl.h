@@ -9,5 +9,6 @@ void kgsl_pwr_limits_del(void *limit);
 int kgsl_pwr_limits_set_freq(void *limit, unsigned int freq);
 void kgsl_pwr_limits_set_default(void *limit);
 unsigned int kgsl_pwr_limits_get_freq(enum kgsl_deviceid id);
+unsigned int kgsl_pwr_get_cur_freq(enum kgsl_deviceid id);
 
 #endif /* _MSM_KGSL_H */
@@ -20,6 +20,9 @@ struct ip_conntrack_stat {
 	unsigned int expect_create;
 	unsigned int expect_delete;
 	unsigned int search_restart;
+	unsigned int cache_hit;
+	unsigned int table_full;
+	unsigned int hash_grow;
 };
 
 /* call to create an explicit dependency on nf_conntrack. */
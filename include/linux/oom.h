@@ -95,6 +95,14 @@ extern struct task_struct *find_lock_task_mm(struct task_struct *p);
 extern void dump_tasks(const struct mem_cgroup *memcg,
 		const nodemask_t *nodemask);
 
+#ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER
+extern void lowmem_adj_update(struct task_struct *task);
+#else
+static inline void lowmem_adj_update(struct task_struct *task)
+{
+}
+#endif
+
 /* sysctls */
 extern int sysctl_oom_dump_tasks;
 extern int sysctl_oom_kill_allocating_task;
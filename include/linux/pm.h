@@ -573,6 +573,11 @@ struct dev_pm_info {
 	struct wakeup_source	*wakeup;
 	bool			wakeup_path:1;
 	bool			syscore:1;
+	bool			async_auto:1;	/* Owned by the PM core */
+	struct list_head	suppliers;	/* Ditto */
+	struct list_head	consumers;	/* Ditto */
+	u32			suspend_time_us;	/* Ditto */
+	u32			resume_time_us;	/* Ditto */
 #else
 	unsigned int		should_wakeup:1;
 #endif
@@ -702,6 +707,11 @@ extern void __suspend_report_result(const char *function, void *fn, int ret);
 
 extern int device_pm_wait_for_dev(struct device *sub, struct device *dev);
 extern void dpm_for_each_dev(void *data, void (*fn)(struct device *, void *));
+extern int device_pm_add_link(struct device *consumer,
+			      struct device *supplier);
+extern void device_pm_remove_link(struct device *consumer,
+				  struct device *supplier);
+extern void pm_resume_screen_on(void);
 
 extern int pm_generic_prepare(struct device *dev);
 extern int pm_generic_suspend_late(struct device *dev);
@@ -745,6 +755,21 @@ static inline void dpm_for_each_dev(void *data, void (*fn)(struct device *, void
 {
 }
 
+static inline int device_pm_add_link(struct device *consumer,
+				     struct device *supplier)
+{
+	return 0;
+}
+
+static inline void device_pm_remove_link(struct device *consumer,
+					 struct device *supplier)
+{
+}
+
+static inline void pm_resume_screen_on(void)
+{
+}
+
 #define pm_generic_prepare		NULL
 #define pm_generic_suspend_late		NULL
 #define pm_generic_suspend_noirq	NULL
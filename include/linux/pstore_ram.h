@@ -88,6 +88,9 @@ void ramoops_console_write_buf(const char *buf, size_t size);
  * @mem_address	physical memory address to contain ramoops
  */
 
+/* Give each CPU its own ftrace zone instead of sharing a single one */
+#define RAMOOPS_FLAG_FTRACE_PER_CPU	BIT(0)
+
 struct ramoops_platform_data {
 	unsigned long	mem_size;
 	unsigned long	mem_address;
@@ -96,6 +99,7 @@ struct ramoops_platform_data {
 	unsigned long	console_size;
 	unsigned long	ftrace_size;
 	unsigned long	pmsg_size;
+	unsigned int	flags;
 	int		dump_oops;
 	struct persistent_ram_ecc_info ecc_info;
 };
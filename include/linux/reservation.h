@@ -44,11 +44,33 @@
 #include <linux/slab.h>
 #include <linux/seqlock.h>
 #include <linux/rcupdate.h>
+#include <linux/percpu.h>
 
 extern struct ww_class reservation_ww_class;
 extern struct lock_class_key reservation_seqcount_class;
 extern const char reservation_seqcount_string[];
 
+/**
+ * struct reservation_wait_stats - how lockless fence waits were resolved
+ * @nosleep: waits that found every fence signaled without blocking
+ * @sleep: waits that had to block on at least one fence
+ * @retry: lockless reads redone because the fences changed meanwhile
+ * @poll_nosleep: dma-buf polls answered without arming a callback
+ * @poll_sleep: dma-buf polls that took the poll lock to arm callbacks
+ */
+struct reservation_wait_stats {
+	unsigned long nosleep;
+	unsigned long sleep;
+	unsigned long retry;
+	unsigned long poll_nosleep;
+	unsigned long poll_sleep;
+};
+
+DECLARE_PER_CPU(struct reservation_wait_stats, reservation_wait_stats);
+
+#define reservation_wait_stat_inc(field) \
+	this_cpu_inc(reservation_wait_stats.field)
+
 struct reservation_object_list {
 	struct rcu_head rcu;
 	u32 shared_count, shared_max;
@@ -139,4 +161,6 @@ long reservation_object_wait_timeout_rcu(struct reservation_object *obj,
 bool reservation_object_test_signaled_rcu(struct reservation_object *obj,
 					  bool test_all);
 
+void reservation_wait_stats_read(struct reservation_wait_stats *stats);
+
 #endif /* _LINUX_RESERVATION_H */
@@ -35,6 +35,8 @@ struct rw_semaphore {
 	 * if the owner is running on the cpu.
 	 */
 	struct task_struct *owner;
+	/* A writer waited too long: spinners must not steal the lock */
+	bool handoff;
 #endif
 #ifdef CONFIG_DEBUG_LOCK_ALLOC
 	struct lockdep_map	dep_map;
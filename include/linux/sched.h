@@ -2052,8 +2052,18 @@ static inline int sched_update_freq_max_load(const cpumask_t *cpumask)
 {
 	return 0;
 }
+static inline int sched_isolate_cpu(int cpu)
+{
+	return -ENODEV;
+}
+static inline int sched_unisolate_cpu(int cpu)
+{
+	return -ENODEV;
+}
 #else
 int sched_update_freq_max_load(const cpumask_t *cpumask);
+extern int sched_isolate_cpu(int cpu);
+extern int sched_unisolate_cpu(int cpu);
 #endif
 
 #if defined(CONFIG_SCHED_FREQ_INPUT)
@@ -2274,6 +2284,7 @@ extern void sched_set_cluster_dstate(const cpumask_t *cluster_cpus, int dstate,
 				int wakeup_energy, int wakeup_latency);
 extern void sched_update_cpu_freq_min_max(const cpumask_t *cpus, u32 fmin, u32
 					  fmax);
+extern int sched_get_group_cpus(unsigned int group_id, struct cpumask *cpus);
 #ifdef CONFIG_SCHED_QHMP
 extern int sched_set_cpu_prefer_idle(int cpu, int prefer_idle);
 extern int sched_get_cpu_prefer_idle(int cpu);
@@ -2303,6 +2314,13 @@ static inline void sched_set_cluster_dstate(const cpumask_t *cluster_cpus,
 
 static inline void
 sched_update_cpu_freq_min_max(const cpumask_t *cpus, u32 fmin, u32 fmax) { }
+
+static inline int
+sched_get_group_cpus(unsigned int group_id, struct cpumask *cpus)
+{
+	cpumask_clear(cpus);
+	return 0;
+}
 #endif
 
 #ifdef CONFIG_NO_HZ_COMMON
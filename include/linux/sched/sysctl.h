@@ -85,6 +85,8 @@ extern unsigned int sysctl_sched_enable_thread_grouping;
 #if defined(CONFIG_SCHED_FREQ_INPUT)
 extern unsigned int sysctl_sched_new_task_windows;
 extern unsigned int sysctl_sched_pred_alert_freq;
+extern unsigned int sysctl_sched_pred_placement;
+extern unsigned int sysctl_sched_iowait_boost_pct;
 extern unsigned int sysctl_sched_freq_aggregate;
 extern unsigned int sysctl_sched_freq_aggregate_threshold_pct;
 #endif
@@ -39,6 +39,9 @@ struct seq_file;
  *			  1 if b will signal before a
  *			  0 if a and b will signal at the same time
  *			 -1 if a will signal before b
+ * @ordered:		pts are guaranteed to signal in @compare order, so
+ *			  the active list is kept sorted and signaling stops
+ *			  at the first pt that hasn't signaled
  * @free_pt:		called before sync_pt is freed
  * @release_obj:	called before sync_timeline is freed
  * @print_obj:		deprecated
@@ -62,6 +65,9 @@ struct sync_timeline_ops {
 	/* required */
 	int (*compare)(struct sync_pt *a, struct sync_pt *b);
 
+	/* optional */
+	bool ordered;
+
 	/* optional */
 	void (*free_pt)(struct sync_pt *sync_pt);
 
@@ -98,7 +104,8 @@ struct sync_timeline_ops {
  * @child_list_head:	list of children sync_pts for this sync_timeline
  * @child_list_lock:	lock protecting @child_list_head, destroyed, and
  *			  sync_pt.status
- * @active_list_head:	list of active (unsignaled/errored) sync_pts
+ * @active_list_head:	list of active (unsignaled/errored) sync_pts, in
+ *			  signaling order on ordered timelines
  * @sync_timeline_list:	membership in global sync_timeline_list
  */
 struct sync_timeline {
@@ -325,6 +325,18 @@ void usb_bam_suspend(enum usb_ctrl bam_type,
  */
 void usb_bam_resume(enum usb_ctrl bam_type,
 		     struct usb_bam_connect_ipa_params *ipa_params);
+
+/**
+ * Run the usb resume sequence in the caller's context instead of the
+ * usb_bam workqueue. May sleep.
+ *
+ * @bam_type - USB BAM type - dwc3/CI/hsic
+ *
+ * @ipa_params -  in/out parameters
+ */
+void usb_bam_resume_sync(enum usb_ctrl bam_type,
+			 struct usb_bam_connect_ipa_params *ipa_params);
+
 /**
  * Disconnect USB-to-Periperal SPS connection.
  *
@@ -426,6 +438,14 @@ int usb_bam_alloc_fifos(enum usb_ctrl cur_bam, u8 idx);
 */
 int usb_bam_free_fifos(enum usb_ctrl cur_bam, u8 idx);
 
+/**
+* Overrides the DT data and descriptor FIFO sizes of a system memory
+* connection, e.g. to use larger FIFOs on high throughput compositions.
+* Must be called before usb_bam_alloc_fifos().
+*/
+int usb_bam_set_fifo_sizes(enum usb_ctrl cur_bam, u8 idx, u32 data_size,
+			   u32 desc_size);
+
 #else
 static inline int usb_bam_connect(enum usb_ctrl bam, u8 idx, u32 *bam_pipe_idx)
 {
@@ -470,6 +490,9 @@ static inline void usb_bam_suspend(enum usb_ctrl bam_type,
 static inline void usb_bam_resume(enum usb_ctrl bam_type,
 	struct usb_bam_connect_ipa_params *ipa_params) {}
 
+static inline void usb_bam_resume_sync(enum usb_ctrl bam_type,
+	struct usb_bam_connect_ipa_params *ipa_params) {}
+
 static inline int usb_bam_disconnect_pipe(enum usb_ctrl bam_type, u8 idx)
 {
 	return -ENODEV;
@@ -523,5 +546,11 @@ int usb_bam_free_fifos(enum usb_ctrl cur_bam, u8 idx)
 	return false;
 }
 
+static inline int usb_bam_set_fifo_sizes(enum usb_ctrl cur_bam, u8 idx,
+					 u32 data_size, u32 desc_size)
+{
+	return -ENODEV;
+}
+
 #endif
 #endif				/* _USB_BAM_H_ */
@@ -3313,6 +3313,22 @@ void ieee80211_napi_add(struct ieee80211_hw *hw, struct napi_struct *napi,
  */
 void ieee80211_rx(struct ieee80211_hw *hw, struct sk_buff *skb);
 
+/**
+ * ieee80211_rx_list - receive a batch of frames
+ *
+ * Like ieee80211_rx(), for all the frames queued on @frames in order. The
+ * frames for the local stack, including those released from the A-MPDU
+ * reorder buffer on the way, are only handed to it once the batch has gone
+ * through mac80211, using GRO if the driver registered a NAPI context.
+ *
+ * The same context and synchronization rules as for ieee80211_rx() apply.
+ *
+ * @hw: the hardware the frames came in on
+ * @frames: the buffers to receive, all owned by mac80211 after this call;
+ *	the list is left empty
+ */
+void ieee80211_rx_list(struct ieee80211_hw *hw, struct sk_buff_head *frames);
+
 /**
  * ieee80211_rx_irqsafe - receive frame
  *
@@ -51,6 +51,7 @@ enum {
 	BAM_DMUX_UL_CONNECTED, /* data is null */
 	BAM_DMUX_UL_DISCONNECTED, /*data is null */
 	BAM_DMUX_TRANSMIT_SIZE, /* data is maximum negotiated transmit MTU */
+	BAM_DMUX_RECEIVE_LIST, /* data is struct sk_buff_head */
 };
 
 /*
@@ -82,6 +83,15 @@ int msm_bam_dmux_is_ch_full(uint32_t id);
 
 int msm_bam_dmux_is_ch_low(uint32_t id);
 
+/*
+ * Request received packets of an open channel to be delivered in batches
+ *     id - the logical channel
+ *     enable - when set, rx data is delivered with BAM_DMUX_RECEIVE_LIST
+ *              and the client dequeues the skbs it takes from the list,
+ *              skbs left on the list are freed by bam_dmux. Reset on open.
+ */
+int msm_bam_dmux_set_rx_list(uint32_t id, int enable);
+
 int msm_bam_dmux_reg_notify(void *priv,
 		       void (*notify)(void *priv, int event_type,
 						unsigned long data));
@@ -128,6 +138,11 @@ static inline int msm_bam_dmux_is_ch_low(uint32_t id)
 	return -ENODEV;
 }
 
+static inline int msm_bam_dmux_set_rx_list(uint32_t id, int enable)
+{
+	return -ENODEV;
+}
+
 static inline int msm_bam_dmux_reg_notify(void *priv,
 		       void (*notify)(void *priv, int event_type,
 						unsigned long data))
@@ -33,9 +33,15 @@ struct boot_stats {
 int boot_stats_init(void);
 int boot_stats_exit(void);
 unsigned long long int msm_timer_get_sclk_ticks(void);
+void boot_stats_pil(const char *name, s64 init_us, s64 load_us, s64 auth_us);
 #else
 static inline int boot_stats_init(void) { return 0; }
-unsigned long long int msm_timer_get_sclk_ticks(void) { return 0; }
+static inline void boot_stats_pil(const char *name, s64 init_us,
+				  s64 load_us, s64 auth_us) { }
+static inline unsigned long long int msm_timer_get_sclk_ticks(void)
+{
+	return 0;
+}
 #endif
 
 #ifdef CONFIG_MSM_BOOT_TIME_MARKER
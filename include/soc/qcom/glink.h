@@ -34,10 +34,17 @@ enum {
  *
  * Used to define the glink_open_config::options field which is passed into
  * glink_open().
+ *
+ * GLINK_OPT_RX_INTENT_POOL keeps the buffers of released rx intents in a small
+ * per-channel pool of power-of-two size classes and reuses them for new
+ * intents. Intent requests from the remote side are served from the pool
+ * without calling notify_rx_intent_req, in which case notify_rx is called
+ * with a NULL pkt_priv.
  */
 enum {
 	GLINK_OPT_INITIAL_XPORT = BIT(0),
 	GLINK_OPT_RX_INTENT_NOTIF = BIT(1),
+	GLINK_OPT_RX_INTENT_POOL = BIT(2),
 };
 
 /**
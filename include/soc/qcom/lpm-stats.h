@@ -49,6 +49,9 @@ void lpm_stats_cluster_exit(struct lpm_stats *stats, uint32_t index,
 				bool success);
 void lpm_stats_cpu_enter(uint32_t index, uint64_t time);
 void lpm_stats_cpu_exit(uint32_t index, uint64_t time, bool success);
+void lpm_stats_cluster_mispredict(struct lpm_stats *stats, uint32_t index,
+				bool premature);
+void lpm_stats_cpu_mispredict(uint32_t index, bool premature);
 void lpm_stats_suspend_enter(void);
 void lpm_stats_suspend_exit(void);
 #else
@@ -82,6 +85,17 @@ static inline void lpm_stats_cpu_exit(uint32_t index, bool success,
 	return;
 }
 
+static inline void lpm_stats_cluster_mispredict(struct lpm_stats *stats,
+					uint32_t index, bool premature)
+{
+	return;
+}
+
+static inline void lpm_stats_cpu_mispredict(uint32_t index, bool premature)
+{
+	return;
+}
+
 static inline void lpm_stats_suspend_enter(void)
 {
 	return;
@@ -426,6 +426,181 @@ DEFINE_EVENT(ion_alloc_error, ion_alloc_buffer_fail,
 	TP_ARGS(client_name, heap_name, len, mask, flags, error)
 );
 
+TRACE_EVENT(ion_alloc_latency,
+
+	TP_PROTO(const char *client_name,
+		 int heap_id,
+		 size_t len,
+		 unsigned int mask,
+		 unsigned int flags,
+		 long error,
+		 u64 time_ns),
+
+	TP_ARGS(client_name, heap_id, len, mask, flags, error, time_ns),
+
+	TP_STRUCT__entry(
+		__array(char,		client_name, 64)
+		__field(int,		heap_id)
+		__field(size_t,		len)
+		__field(unsigned int,	mask)
+		__field(unsigned int,	flags)
+		__field(long,		error)
+		__field(u64,		time_ns)
+	),
+
+	TP_fast_assign(
+		strlcpy(__entry->client_name, client_name, 64);
+		__entry->heap_id	= heap_id;
+		__entry->len		= len;
+		__entry->mask		= mask;
+		__entry->flags		= flags;
+		__entry->error		= error;
+		__entry->time_ns	= time_ns;
+	),
+
+	TP_printk(
+	"client_name=%s heap_id=%d len=%zu mask=0x%x flags=0x%x error=%ld time_ns=%llu",
+		__entry->client_name,
+		__entry->heap_id,
+		__entry->len,
+		__entry->mask,
+		__entry->flags,
+		__entry->error,
+		__entry->time_ns)
+);
+
+DECLARE_EVENT_CLASS(ion_heap_op,
+
+	TP_PROTO(const char *heap_name,
+		 unsigned int heap_id,
+		 size_t len,
+		 unsigned int flags,
+		 long error,
+		 u64 time_ns),
+
+	TP_ARGS(heap_name, heap_id, len, flags, error, time_ns),
+
+	TP_STRUCT__entry(
+		__field(const char *,	heap_name)
+		__field(unsigned int,	heap_id)
+		__field(size_t,		len)
+		__field(unsigned int,	flags)
+		__field(long,		error)
+		__field(u64,		time_ns)
+	),
+
+	TP_fast_assign(
+		__entry->heap_name	= heap_name;
+		__entry->heap_id	= heap_id;
+		__entry->len		= len;
+		__entry->flags		= flags;
+		__entry->error		= error;
+		__entry->time_ns	= time_ns;
+	),
+
+	TP_printk(
+	"heap_name=%s heap_id=%u len=%zu flags=0x%x error=%ld time_ns=%llu",
+		__entry->heap_name,
+		__entry->heap_id,
+		__entry->len,
+		__entry->flags,
+		__entry->error,
+		__entry->time_ns)
+);
+
+DEFINE_EVENT(ion_heap_op, ion_heap_allocate,
+
+	TP_PROTO(const char *heap_name,
+		 unsigned int heap_id,
+		 size_t len,
+		 unsigned int flags,
+		 long error,
+		 u64 time_ns),
+
+	TP_ARGS(heap_name, heap_id, len, flags, error, time_ns)
+);
+
+DEFINE_EVENT(ion_heap_op, ion_heap_free,
+
+	TP_PROTO(const char *heap_name,
+		 unsigned int heap_id,
+		 size_t len,
+		 unsigned int flags,
+		 long error,
+		 u64 time_ns),
+
+	TP_ARGS(heap_name, heap_id, len, flags, error, time_ns)
+);
+
+TRACE_EVENT(ion_system_heap_allocate,
+
+	TP_PROTO(unsigned int heap_id,
+		 size_t len,
+		 unsigned int orders,
+		 unsigned int pool_hits,
+		 unsigned int pool_misses,
+		 u64 zero_ns),
+
+	TP_ARGS(heap_id, len, orders, pool_hits, pool_misses, zero_ns),
+
+	TP_STRUCT__entry(
+		__field(unsigned int,	heap_id)
+		__field(size_t,		len)
+		__field(unsigned int,	orders)
+		__field(unsigned int,	pool_hits)
+		__field(unsigned int,	pool_misses)
+		__field(u64,		zero_ns)
+	),
+
+	TP_fast_assign(
+		__entry->heap_id	= heap_id;
+		__entry->len		= len;
+		__entry->orders		= orders;
+		__entry->pool_hits	= pool_hits;
+		__entry->pool_misses	= pool_misses;
+		__entry->zero_ns	= zero_ns;
+	),
+
+	TP_printk(
+	"heap_id=%u len=%zu orders=0x%x pool_hits=%u pool_misses=%u zero_ns=%llu",
+		__entry->heap_id,
+		__entry->len,
+		__entry->orders,
+		__entry->pool_hits,
+		__entry->pool_misses,
+		__entry->zero_ns)
+);
+
+TRACE_EVENT(ion_system_heap_free,
+
+	TP_PROTO(unsigned int heap_id,
+		 size_t len,
+		 bool deferred_zero,
+		 u64 zero_ns),
+
+	TP_ARGS(heap_id, len, deferred_zero, zero_ns),
+
+	TP_STRUCT__entry(
+		__field(unsigned int,	heap_id)
+		__field(size_t,		len)
+		__field(bool,		deferred_zero)
+		__field(u64,		zero_ns)
+	),
+
+	TP_fast_assign(
+		__entry->heap_id	= heap_id;
+		__entry->len		= len;
+		__entry->deferred_zero	= deferred_zero;
+		__entry->zero_ns	= zero_ns;
+	),
+
+	TP_printk("heap_id=%u len=%zu deferred_zero=%d zero_ns=%llu",
+		__entry->heap_id,
+		__entry->len,
+		__entry->deferred_zero,
+		__entry->zero_ns)
+);
+
 
 DECLARE_EVENT_CLASS(alloc_retry,
 
@@ -1051,9 +1051,10 @@ TRACE_EVENT(cache_hwmon_update,
 TRACE_EVENT(memlat_dev_meas,
 
 	TP_PROTO(const char *name, unsigned int dev_id, unsigned long inst,
-		 unsigned long mem, unsigned long freq, unsigned int ratio),
+		 unsigned long mem, unsigned long freq, unsigned int stall,
+		 unsigned int ratio),
 
-	TP_ARGS(name, dev_id, inst, mem, freq, ratio),
+	TP_ARGS(name, dev_id, inst, mem, freq, stall, ratio),
 
 	TP_STRUCT__entry(
 		__string(name, name)
@@ -1061,6 +1062,7 @@ TRACE_EVENT(memlat_dev_meas,
 		__field(unsigned long, inst)
 		__field(unsigned long, mem)
 		__field(unsigned long, freq)
+		__field(unsigned int, stall)
 		__field(unsigned int, ratio)
 	),
 
@@ -1070,15 +1072,17 @@ TRACE_EVENT(memlat_dev_meas,
 		__entry->inst = inst;
 		__entry->mem = mem;
 		__entry->freq = freq;
+		__entry->stall = stall;
 		__entry->ratio = ratio;
 	),
 
-	TP_printk("dev: %s, id=%u, inst=%lu, mem=%lu, freq=%lu, ratio=%u",
+	TP_printk("dev: %s, id=%u, inst=%lu, mem=%lu, freq=%lu, stall=%u, ratio=%u",
 		__get_str(name),
 		__entry->dev_id,
 		__entry->inst,
 		__entry->mem,
 		__entry->freq,
+		__entry->stall,
 		__entry->ratio)
 );
 
@@ -1137,6 +1141,48 @@ TRACE_EVENT(msmpower_max_ddr,
 		__entry->curr_max_ddr)
 );
 
+TRACE_EVENT(cpu_boost_input_start,
+
+	TP_PROTO(unsigned long cpus, unsigned int group_id),
+
+	TP_ARGS(cpus, group_id),
+
+	TP_STRUCT__entry(
+		__field(unsigned long, cpus)
+		__field(unsigned int, group_id)
+	),
+
+	TP_fast_assign(
+		__entry->cpus = cpus;
+		__entry->group_id = group_id;
+	),
+
+	TP_printk("cpus=%#lx group_id=%u",
+		__entry->cpus,
+		__entry->group_id)
+);
+
+TRACE_EVENT(cpu_boost_input_end,
+
+	TP_PROTO(unsigned int duration_ms, unsigned int frames),
+
+	TP_ARGS(duration_ms, frames),
+
+	TP_STRUCT__entry(
+		__field(unsigned int, duration_ms)
+		__field(unsigned int, frames)
+	),
+
+	TP_fast_assign(
+		__entry->duration_ms = duration_ms;
+		__entry->frames = frames;
+	),
+
+	TP_printk("duration_ms=%u frames=%u",
+		__entry->duration_ms,
+		__entry->frames)
+);
+
 #endif /* _TRACE_POWER_H */
 
 /* This part must be outside protection */
@@ -0,0 +1,117 @@
+/* Copyright (c) 2018, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM fastrpc
+
+#if !defined(_TRACE_ADSPRPC_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_ADSPRPC_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(fastrpc_invoke_send,
+
+	TP_PROTO(int cid, uint32_t handle, uint32_t sc, uint64_t ctxid),
+
+	TP_ARGS(cid, handle, sc, ctxid),
+
+	TP_STRUCT__entry(
+		__field(int, cid)
+		__field(uint32_t, handle)
+		__field(uint32_t, sc)
+		__field(uint64_t, ctxid)
+	),
+
+	TP_fast_assign(
+		__entry->cid = cid;
+		__entry->handle = handle;
+		__entry->sc = sc;
+		__entry->ctxid = ctxid;
+	),
+
+	TP_printk("cid:%d handle:0x%x sc:0x%08x ctx:0x%llx",
+		__entry->cid,
+		__entry->handle,
+		__entry->sc,
+		__entry->ctxid)
+);
+
+TRACE_EVENT(fastrpc_invoke_rsp,
+
+	TP_PROTO(uint64_t ctxid, int retval),
+
+	TP_ARGS(ctxid, retval),
+
+	TP_STRUCT__entry(
+		__field(uint64_t, ctxid)
+		__field(int, retval)
+	),
+
+	TP_fast_assign(
+		__entry->ctxid = ctxid;
+		__entry->retval = retval;
+	),
+
+	TP_printk("ctx:0x%llx retval:%d",
+		__entry->ctxid,
+		__entry->retval)
+);
+
+TRACE_EVENT(fastrpc_invoke_done,
+
+	TP_PROTO(int cid, uint32_t handle, uint32_t sc, uint64_t getargs,
+		 uint64_t invargs, uint64_t link, uint64_t dsp,
+		 uint64_t wakeup, uint64_t putargs),
+
+	TP_ARGS(cid, handle, sc, getargs, invargs, link, dsp, wakeup,
+		putargs),
+
+	TP_STRUCT__entry(
+		__field(int, cid)
+		__field(uint32_t, handle)
+		__field(uint32_t, sc)
+		__field(uint64_t, getargs)
+		__field(uint64_t, invargs)
+		__field(uint64_t, link)
+		__field(uint64_t, dsp)
+		__field(uint64_t, wakeup)
+		__field(uint64_t, putargs)
+	),
+
+	TP_fast_assign(
+		__entry->cid = cid;
+		__entry->handle = handle;
+		__entry->sc = sc;
+		__entry->getargs = getargs;
+		__entry->invargs = invargs;
+		__entry->link = link;
+		__entry->dsp = dsp;
+		__entry->wakeup = wakeup;
+		__entry->putargs = putargs;
+	),
+
+	TP_printk("cid:%d handle:0x%x sc:0x%08x getargs:%llu invargs:%llu link:%llu dsp:%llu wakeup:%llu putargs:%llu",
+		__entry->cid,
+		__entry->handle,
+		__entry->sc,
+		__entry->getargs,
+		__entry->invargs,
+		__entry->link,
+		__entry->dsp,
+		__entry->wakeup,
+		__entry->putargs)
+);
+
+#endif /* _TRACE_ADSPRPC_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
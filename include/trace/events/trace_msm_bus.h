@@ -270,6 +270,54 @@ TRACE_EVENT(bus_agg_bw,
 		__entry->ctx_set,
 		(unsigned long long)__entry->agg_ab)
 );
+
+TRACE_EVENT(bus_commit_latency,
+
+	TP_PROTO(const char *name, u64 agg_ns, u64 send_ns, u64 ack_ns,
+		unsigned int msgs),
+
+	TP_ARGS(name, agg_ns, send_ns, ack_ns, msgs),
+
+	TP_STRUCT__entry(
+		__string(name, name)
+		__field(u64, agg_ns)
+		__field(u64, send_ns)
+		__field(u64, ack_ns)
+		__field(unsigned int, msgs)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->agg_ns = agg_ns;
+		__entry->send_ns = send_ns;
+		__entry->ack_ns = ack_ns;
+		__entry->msgs = msgs;
+	),
+
+	TP_printk("client-name=%s agg_ns=%llu send_ns=%llu ack_ns=%llu msgs=%u",
+		__get_str(name),
+		(unsigned long long)__entry->agg_ns,
+		(unsigned long long)__entry->send_ns,
+		(unsigned long long)__entry->ack_ns,
+		__entry->msgs)
+);
+
+TRACE_EVENT(bus_redundant_vote,
+
+	TP_PROTO(const char *name),
+
+	TP_ARGS(name),
+
+	TP_STRUCT__entry(
+		__string(name, name)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, name);
+	),
+
+	TP_printk("client-name=%s", __get_str(name))
+);
 #endif
 #define TRACE_INCLUDE_FILE trace_msm_bus
 #include <trace/define_trace.h>
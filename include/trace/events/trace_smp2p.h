@@ -0,0 +1,86 @@
+/* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM smp2p
+
+#if !defined(_TRACE_SMP2P_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_SMP2P_H
+
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(smp2p_interrupt,
+
+	TP_PROTO(int remote_pid, unsigned int count),
+
+	TP_ARGS(remote_pid, count),
+
+	TP_STRUCT__entry(
+		__field(int, remote_pid)
+		__field(unsigned int, count)
+	),
+
+	TP_fast_assign(
+		__entry->remote_pid = remote_pid;
+		__entry->count = count;
+	),
+
+	TP_printk("pid:%d count:%u",
+		__entry->remote_pid,
+		__entry->count)
+);
+
+DEFINE_EVENT(smp2p_interrupt, smp2p_send_interrupt,
+
+	TP_PROTO(int remote_pid, unsigned int count),
+
+	TP_ARGS(remote_pid, count)
+);
+
+DEFINE_EVENT(smp2p_interrupt, smp2p_isr,
+
+	TP_PROTO(int remote_pid, unsigned int count),
+
+	TP_ARGS(remote_pid, count)
+);
+
+TRACE_EVENT(smp2p_entry_update,
+
+	TP_PROTO(int remote_pid, const char *name, uint32_t prev,
+		 uint32_t curr),
+
+	TP_ARGS(remote_pid, name, prev, curr),
+
+	TP_STRUCT__entry(
+		__field(int, remote_pid)
+		__string(name, name)
+		__field(uint32_t, prev)
+		__field(uint32_t, curr)
+	),
+
+	TP_fast_assign(
+		__entry->remote_pid = remote_pid;
+		__assign_str(name, name);
+		__entry->prev = prev;
+		__entry->curr = curr;
+	),
+
+	TP_printk("pid:%d entry:%s prev:0x%08x curr:0x%08x",
+		__entry->remote_pid,
+		__get_str(name),
+		__entry->prev,
+		__entry->curr)
+);
+
+#endif
+#define TRACE_INCLUDE_FILE trace_smp2p
+#include <trace/define_trace.h>
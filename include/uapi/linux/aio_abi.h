@@ -62,6 +62,39 @@ struct io_event {
 	__s64		res2;		/* secondary result */
 };
 
+/*
+ * The aio_context_t returned by io_setup() is the user address of the
+ * completion ring: this header, then "nr" struct io_event slots starting at
+ * "header_length" bytes.  "head" and "tail" are slot indices in [0, nr),
+ * the ring is empty when they are equal.
+ *
+ * When AIO_RING_COMPAT_USER_POLL is set in compat_features, events may be
+ * reaped from userspace instead of through io_getevents():
+ *  - the kernel fills in an event before it moves "tail" past it, so load
+ *    "tail" with acquire semantics before reading the events up to it;
+ *  - once done with the events, store the new "head" with release
+ *    semantics; the slots are reused by the kernel only after that;
+ *  - completions only wake threads sleeping in io_getevents() or signal
+ *    the eventfd set with IOCB_FLAG_RESFD, a poller costs no wakeups.
+ * A context must not be reaped from userspace and with io_getevents() at
+ * the same time.
+ */
+struct aio_ring_header {
+	__u32	id;		/* kernel internal */
+	__u32	nr;		/* number of io_event slots */
+	__u32	head;		/* written by the consumer */
+	__u32	tail;		/* written by the kernel */
+	__u32	magic;		/* AIO_RING_MAGIC */
+	__u32	compat_features;
+	__u32	incompat_features;
+	__u32	header_length;	/* offset of the first io_event */
+};
+
+#define AIO_RING_MAGIC			0xa10a10a1
+
+/* compat_features */
+#define AIO_RING_COMPAT_USER_POLL	(1 << 1)
+
 #if defined(__BYTE_ORDER) ? __BYTE_ORDER == __LITTLE_ENDIAN : defined(__LITTLE_ENDIAN)
 #define PADDED(x,y)	x, y
 #elif defined(__BYTE_ORDER) ? __BYTE_ORDER == __BIG_ENDIAN : defined(__BIG_ENDIAN)
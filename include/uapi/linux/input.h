@@ -122,6 +122,48 @@ struct input_event {
 	__s32 value;
 };
 
+/**
+ * struct input_ring_event - an event as stored in the mmap event ring
+ * @time: timestamp in ns, of the clock selected with EVIOCSCLOCKID
+ * @type: as in struct input_event
+ * @code: as in struct input_event
+ * @value: as in struct input_event
+ *
+ * Unlike struct input_event, the layout does not depend on the ABI of
+ * the process mapping the ring.
+ */
+struct input_ring_event {
+	__u64 time;
+	__u16 type;
+	__u16 code;
+	__s32 value;
+};
+
+/**
+ * struct input_event_ring - header of the mmap event ring
+ * @size: number of events in the ring, a power of two
+ * @offset: offset of the first event from the start of the mapping
+ * @head: written by the kernel, the events before it form complete
+ *	packets, each one ending with SYN_REPORT
+ * @tail: written by user space, the next event it will consume
+ * @dropped: packets dropped because the ring was full; the device state
+ *	should be resynced with the EVIOCG* ioctls, as for SYN_DROPPED
+ *
+ * EVIOCSRING switches an evdev client from read() to a ring of the given
+ * number of events, mapped with mmap() at offset 0. @head and @tail run
+ * free and are masked with @size - 1 to index the events. A packet is
+ * published in one go, with a single wakeup of poll(), when its
+ * SYN_REPORT arrives. Clients using a ring do not block suspend.
+ */
+struct input_event_ring {
+	__u32 size;
+	__u32 offset;
+	__u32 head;
+	__u32 tail;
+	__u32 dropped;
+	__u32 __reserved[3];
+};
+
 /*
  * Protocol version.
  */
@@ -254,6 +296,7 @@ struct input_keymap_entry {
 #define EVIOCSSUSPENDBLOCK	_IOW('E', 0x91, int)			/* set suspend block enable */
 
 #define EVIOCSCLOCKID		_IOW('E', 0xa0, int)			/* Set clockid to be used for timestamps */
+#define EVIOCSRING		_IOW('E', 0xa1, unsigned int)		/* Switch to an mmap event ring of that many events */
 
 /*
  * Device properties and quirks
@@ -72,6 +72,11 @@
 			       struct msm_audio_bitstream_error_info)
 
 #define AUDIO_SET_SRS_TRUMEDIA_PARAM _IOW(AUDIO_IOCTL_MAGIC, 43, unsigned)
+#define AUDIO_SET_SHARED_RING _IOW(AUDIO_IOCTL_MAGIC, 44, \
+				struct msm_audio_shared_ring)
+#define AUDIO_SHARED_RING_COMMIT _IOW(AUDIO_IOCTL_MAGIC, 45, uint32_t)
+#define AUDIO_GET_SHARED_RING_POS _IOR(AUDIO_IOCTL_MAGIC, 46, \
+				struct msm_audio_shared_ring_pos)
 
 /* Qualcomm extensions */
 #define AUDIO_SET_STREAM_CONFIG   _IOW(AUDIO_IOCTL_MAGIC, 80, \
@@ -195,6 +200,28 @@ struct msm_audio_stats {
 	uint32_t unused[2];
 };
 
+/*
+ * Shared ring playback: the client writes compressed data into a ring
+ * inside a region registered with AUDIO_REGISTER_ION and publishes it
+ * with AUDIO_SHARED_RING_COMMIT. The driver hands the DSP up to
+ * 'period' bytes per write and posts AUDIO_EVENT_RING_AVAIL once the
+ * DSP has consumed 'threshold' bytes since the last event.
+ */
+struct msm_audio_shared_ring {
+	uint64_t vaddr;
+	uint32_t size;
+	uint32_t period;
+	uint32_t threshold;
+	uint32_t reserved;
+};
+
+struct msm_audio_shared_ring_pos {
+	uint64_t appl_bytes;	/* committed by the client */
+	uint64_t hw_bytes;	/* consumed by the DSP */
+	uint32_t size;
+	uint32_t reserved;
+};
+
 struct msm_audio_ion_info {
 	int fd;
 	void *vaddr;
@@ -336,6 +363,7 @@ struct msm_audio_pcm_config {
 #define AUDIO_EVENT_READ_DONE   3
 #define AUDIO_EVENT_STREAM_INFO 4
 #define AUDIO_EVENT_BITSTREAM_ERROR_INFO 5
+#define AUDIO_EVENT_RING_AVAIL 6
 
 #define AUDIO_CODEC_TYPE_MP3 0
 #define AUDIO_CODEC_TYPE_AAC 1
@@ -314,6 +314,7 @@ enum kgsl_timestamp_type {
 #define KGSL_PROP_DEVICE_QDSS_STM	0x19
 #define KGSL_PROP_SECURE_BUFFER_ALIGNMENT 0x23
 #define KGSL_PROP_SECURE_CTXT_SUPPORT 0x24
+#define KGSL_PROP_CONTEXT_DEADLINE	0x25
 
 struct kgsl_shadowprop {
 	unsigned long gpuaddr;
@@ -1103,6 +1104,25 @@ struct kgsl_device_constraint_pwrlevel {
 	unsigned int level;
 };
 
+/**
+ * struct kgsl_context_deadline - KGSL_PROP_CONTEXT_DEADLINE argument
+ * @context_id: KGSL context ID
+ * @deadline_us: Time from queueing by which each submission should reach
+ * the GPU, 0 to use the driver default for the context
+ * @flags: KGSL_CONTEXT_DEADLINE_* flags
+ *
+ * Set with IOCTL_KGSL_SETPROPERTY. Only used when the dispatcher runs in
+ * deadline scheduling mode.
+ */
+struct kgsl_context_deadline {
+	unsigned int context_id;
+	unsigned int deadline_us;
+	unsigned int flags;
+};
+
+/* The context draws the compositor or UI frame */
+#define KGSL_CONTEXT_DEADLINE_UI	0x1
+
 /**
  * struct kgsl_syncsource_create - Argument to IOCTL_KGSL_SYNCSOURCE_CREATE
  * @id: returned id for the syncsource that was created.
@@ -1462,4 +1482,92 @@ struct kgsl_gpuobj_set_info {
 #define IOCTL_KGSL_GPUOBJ_SET_INFO \
 	_IOW(KGSL_IOC_TYPE, 0x4C, struct kgsl_gpuobj_set_info)
 
+/**
+ * struct kgsl_gpu_command_list - Argument for IOCTL_KGSL_GPU_COMMAND_LIST
+ * @cmds: Array of struct kgsl_gpu_command to submit in order
+ * @cmdsize: Size of the struct kgsl_gpu_command structure
+ * @numcmds: Number of entries in @cmds
+ * @synclist: List of kgsl_command_syncpoints that all the entries wait for
+ * @syncsize: Size of kgsl_command_syncpoint structure
+ * @numsyncs: Number of kgsl_command_syncpoints in syncpoint list
+ * @context_id: Context ID submitting the commands
+ * @timestamp: Timestamp of the last command in the list
+ *
+ * Submit several command batches to the same context in one call.  The
+ * context_id of each entry must be 0 or match @context_id.  The timestamp of
+ * each entry is written back to its kgsl_gpu_command.  If an entry fails the
+ * entries before it have already been queued and have their timestamps set.
+ */
+struct kgsl_gpu_command_list {
+	uint64_t __user cmds;
+	unsigned int cmdsize;
+	unsigned int numcmds;
+	uint64_t __user synclist;
+	unsigned int syncsize;
+	unsigned int numsyncs;
+	unsigned int context_id;
+	unsigned int timestamp;
+};
+
+#define IOCTL_KGSL_GPU_COMMAND_LIST \
+	_IOWR(KGSL_IOC_TYPE, 0x4D, struct kgsl_gpu_command_list)
+
+/* Sample the counters every time a cmdbatch of the context retires */
+#define KGSL_PERFCOUNTER_STREAM_RETIRE 0x1
+/* Sample the counters every period_us microseconds */
+#define KGSL_PERFCOUNTER_STREAM_PERIOD 0x2
+
+/* Maximum number of counters that can be streamed at once */
+#define KGSL_PERFCOUNTER_STREAM_MAX 16
+
+/**
+ * struct kgsl_perfcounter_stream_header - Header of a counter stream buffer
+ * @head: Dword offset into the data area where the kernel writes next
+ * @tail: Dword offset into the data area where userspace reads next
+ * @size: Size of the data area in dwords
+ * @dropped: Number of samples dropped because the ring was full
+ *
+ * The header sits at the start of the GPU object and the data area follows
+ * it directly.  Only userspace writes @tail; the kernel writes the rest.
+ * Each sample uses the adreno_profile log format: count, context type, pid,
+ * tid, context id and timestamp followed by five dwords per counter -
+ * groupid << 16 | countable, previous value hi/lo and current value hi/lo.
+ * Samples wrap around the end of the data area a dword at a time.
+ */
+struct kgsl_perfcounter_stream_header {
+	unsigned int head;
+	unsigned int tail;
+	unsigned int size;
+	unsigned int dropped;
+};
+
+/**
+ * struct kgsl_perfcounter_stream - argument to IOCTL_KGSL_PERFCOUNTER_STREAM
+ * @counters: Array of struct kgsl_perfcounter_read_group to sample, the
+ * value field is ignored
+ * @count: Number of entries in @counters
+ * @context_id: Context that owns the stream
+ * @id: GPU object id of the buffer to write samples into
+ * @flags: KGSL_PERFCOUNTER_STREAM_* mode, or 0 to stop the stream
+ * @period_us: Sampling period for KGSL_PERFCOUNTER_STREAM_PERIOD
+ * @__pad: Must be zero
+ *
+ * Start streaming counter samples into a ring buffer that userspace has
+ * mapped, avoiding a system call per sample.  The buffer must not be
+ * cached.  Only one stream can be active on a device at a time; it is
+ * stopped when @flags is 0 or when the owning context is destroyed.
+ */
+struct kgsl_perfcounter_stream {
+	uint64_t __user counters;
+	unsigned int count;
+	unsigned int context_id;
+	unsigned int id;
+	unsigned int flags;
+	unsigned int period_us;
+	unsigned int __pad;
+};
+
+#define IOCTL_KGSL_PERFCOUNTER_STREAM \
+	_IOW(KGSL_IOC_TYPE, 0x4E, struct kgsl_perfcounter_stream)
+
 #endif /* _UAPI_MSM_KGSL_H */
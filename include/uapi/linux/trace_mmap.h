@@ -0,0 +1,69 @@
+#ifndef _UAPI_LINUX_TRACE_MMAP_H
+#define _UAPI_LINUX_TRACE_MMAP_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/*
+ * Layout of a per CPU ring buffer mapped through trace_pipe_raw:
+ *
+ *   page 0		struct trace_buffer_meta
+ *   page 1 + id	sub-buffer @id (a struct buffer_data_page: u64
+ *			timestamp, long commit, then the event data)
+ *
+ * The mapping is read-only. The kernel only updates the meta page when
+ * TRACE_MMAP_IOCTL_GET_READER is issued.
+ */
+
+/**
+ * struct trace_buffer_meta - ring buffer meta page
+ * @meta_page_size:	size of the meta page, in bytes
+ * @meta_struct_len:	size of this structure, in bytes
+ * @subbuf_size:	size of each sub-buffer, in bytes
+ * @nr_subbufs:		number of sub-buffers in the mapping
+ * @reader.lost_events:	events overwritten before they could be read,
+ *			since the previous TRACE_MMAP_IOCTL_GET_READER
+ * @reader.id:		sub-buffer the reader owns; the writer never
+ *			overwrites it
+ * @reader.read:	offset in the event data of the first unread event
+ * @reader.commit:	offset in the event data past the last event handed
+ *			to user space; the events in [read, commit) are
+ *			consumed as far as the kernel is concerned
+ * @writer.id:		sub-buffer the writer is committing to
+ * @entries:		events left in the ring buffer
+ * @overrun:		events lost to overwrites since the last reset
+ * @read:		events consumed since the last reset
+ */
+struct trace_buffer_meta {
+	__u32	meta_page_size;
+	__u32	meta_struct_len;
+
+	__u32	subbuf_size;
+	__u32	nr_subbufs;
+
+	struct {
+		__u64	lost_events;
+		__u32	id;
+		__u32	read;
+		__u32	commit;
+		__u32	__reserved;
+	} reader;
+
+	struct {
+		__u32	id;
+		__u32	__reserved;
+	} writer;
+
+	__u64	entries;
+	__u64	overrun;
+	__u64	read;
+};
+
+/*
+ * Hand the next batch of events to user space: consumes what is left of
+ * the reader sub-buffer, swapping in a new one from the ring first when
+ * it was already fully consumed, and refreshes the meta page.
+ */
+#define TRACE_MMAP_IOCTL_GET_READER	_IO('R', 0x20)
+
+#endif /* _UAPI_LINUX_TRACE_MMAP_H */
@@ -71,6 +71,7 @@ struct msm_fd_result {
 #define V4L2_CID_FD_DETECTION_THRESHOLD  (V4L2_CID_PRIVATE_BASE + 4)
 #define V4L2_CID_FD_WORK_MEMORY_SIZE     (V4L2_CID_PRIVATE_BASE + 5)
 #define V4L2_CID_FD_WORK_MEMORY_FD       (V4L2_CID_PRIVATE_BASE + 6)
+#define V4L2_CID_FD_TRACKING_INTERVAL    (V4L2_CID_PRIVATE_BASE + 7)
 
 #endif
 
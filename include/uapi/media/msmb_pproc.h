@@ -17,6 +17,7 @@
 #define MSM_CPP_MAX_FW_NAME_LEN 32
 #define MAX_FREQ_TBL 10
 #define MSM_OUTPUT_BUF_CNT 8
+#define MSM_CPP_MAX_BATCH_FRAMES 8
 
 enum msm_cpp_frame_type {
 	MSM_CPP_OFFLINE_FRAME,
@@ -104,6 +105,18 @@ struct msm_cpp_frame_info_t {
 	struct msm_cpp_batch_info_t  batch_info;
 };
 
+/*
+ * Submit num_frames frames with one VIDIOC_MSM_CPP_CFG_BATCH call.
+ * frames points to an array of num_frames frame descriptors, each handled
+ * as by VIDIOC_MSM_CPP_CFG, and status to an array of num_frames results.
+ * Every frame still raises its own V4L2_EVENT_CPP_FRAME_DONE.
+ */
+struct msm_cpp_frame_batch_t {
+	uint32_t num_frames;
+	struct msm_cpp_frame_info_t *frames;
+	int32_t *status;
+};
+
 struct msm_cpp_pop_stream_info_t {
 	int32_t frame_id;
 	uint32_t identity;
@@ -240,6 +253,9 @@ struct msm_cpp_clock_settings_t {
 #define VIDIOC_MSM_CPP_DELETE_STREAM_BUFF\
 	_IOWR('V', BASE_VIDIOC_PRIVATE + 20, struct msm_camera_v4l2_ioctl_t)
 
+#define VIDIOC_MSM_CPP_CFG_BATCH \
+	_IOWR('V', BASE_VIDIOC_PRIVATE + 21, struct msm_camera_v4l2_ioctl_t)
+
 
 #define V4L2_EVENT_CPP_FRAME_DONE  (V4L2_EVENT_PRIVATE_START + 0)
 #define V4L2_EVENT_VPE_FRAME_DONE  (V4L2_EVENT_PRIVATE_START + 1)
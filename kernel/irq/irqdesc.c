@@ -16,6 +16,7 @@
 #include <linux/bitmap.h>
 #include <linux/irqdomain.h>
 #include <linux/wakeup_reason.h>
+#include <linux/cpuidle.h>
 
 #include "internals.h"
 
@@ -398,6 +399,7 @@ int __handle_domain_irq(struct irq_domain *domain, unsigned int hwirq,
 		ack_bad_irq(irq);
 		ret = -EINVAL;
 	} else {
+		cpuidle_note_wakeup_irq(irq);
 		generic_handle_irq(irq);
 	}
 
@@ -0,0 +1,305 @@
+/*
+ * kernel/locking/lock_contention.c
+ *
+ * Sampling lock contention profiler, see include/linux/lock_contention.h
+ *
+ * Every cpu accounts the waits it samples into its own call site table
+ * and histogram with interrupts off, so that recording never takes a
+ * lock; the debugfs files merge the per-cpu data when they are read.
+ *
+ *   enable		write 1 to clear the data and start sampling, 0 to stop
+ *   sample_period	time one in this many contended acquisitions
+ *   sites		call sites by total wait time, in us
+ *   histogram		number of waits per type and log2 bucket of wait time
+ */
+#include <linux/lock_contention.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/percpu.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+#include <linux/mutex.h>
+#include <linux/vmalloc.h>
+#include <linux/hash.h>
+#include <linux/sched.h>
+#include <linux/sort.h>
+
+#define LC_SITE_BITS		7
+#define LC_SITES		(1 << LC_SITE_BITS)
+#define LC_SITE_PROBES		8
+/* bucket 0: below 1us, bucket n: below 2^n us, the last one: anything */
+#define LC_HIST_BUCKETS		24
+
+struct lc_site {
+	unsigned long	ip;
+	unsigned int	type;
+	unsigned int	count;
+	u64		total_ns;
+	u64		max_ns;
+};
+
+struct lc_cpu {
+	struct lc_site	sites[LC_SITES];
+	unsigned long	hist[LOCK_CONTENTION_NR][LC_HIST_BUCKETS];
+	/* samples that found the site table full */
+	unsigned long	dropped;
+	unsigned int	sample;
+};
+
+static DEFINE_PER_CPU(struct lc_cpu, lc_cpus);
+
+struct static_key lock_contention_key = STATIC_KEY_INIT_FALSE;
+EXPORT_SYMBOL(lock_contention_key);
+
+static u32 sample_period = 8;
+static bool lc_enabled;
+static DEFINE_MUTEX(lc_mutex);
+
+static const char * const lc_type_names[LOCK_CONTENTION_NR] = {
+	[LOCK_CONTENTION_SPIN]		= "spin",
+	[LOCK_CONTENTION_MUTEX]		= "mutex",
+	[LOCK_CONTENTION_RWSEM_READ]	= "rwsem-r",
+	[LOCK_CONTENTION_RWSEM_WRITE]	= "rwsem-w",
+};
+
+u64 __lock_contention_begin(void)
+{
+	u32 period = max_t(u32, ACCESS_ONCE(sample_period), 1);
+
+	if (this_cpu_inc_return(lc_cpus.sample) % period)
+		return 0;
+
+	return local_clock() ?: 1;
+}
+EXPORT_SYMBOL(__lock_contention_begin);
+
+static struct lc_site *lc_site_find(struct lc_site *sites, unsigned int nr,
+				    unsigned long ip, unsigned int type)
+{
+	unsigned int i, idx = hash_long(ip ^ type, ilog2(nr));
+
+	for (i = 0; i < LC_SITE_PROBES; i++) {
+		struct lc_site *site = &sites[(idx + i) & (nr - 1)];
+
+		if (!site->ip) {
+			site->ip = ip;
+			site->type = type;
+			return site;
+		}
+		if (site->ip == ip && site->type == type)
+			return site;
+	}
+
+	return NULL;
+}
+
+void __lock_contention_end(u64 start, enum lock_contention_type type,
+			   unsigned long ip)
+{
+	u64 ns = local_clock() - start;
+	struct lc_site *site;
+	struct lc_cpu *lc;
+	unsigned long flags;
+
+	/* sleepers may finish on a cpu whose clock is slightly behind */
+	if ((s64)ns < 0)
+		return;
+
+	local_irq_save(flags);
+	lc = this_cpu_ptr(&lc_cpus);
+
+	lc->hist[type][min_t(unsigned int, fls64(ns >> 10),
+			     LC_HIST_BUCKETS - 1)]++;
+
+	site = lc_site_find(lc->sites, LC_SITES, ip, type);
+	if (site) {
+		site->count++;
+		site->total_ns += ns;
+		if (ns > site->max_ns)
+			site->max_ns = ns;
+	} else {
+		lc->dropped++;
+	}
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL(__lock_contention_end);
+
+static void lc_clear(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(&lc_cpus, cpu), 0, sizeof(struct lc_cpu));
+}
+
+static int lc_site_cmp(const void *a, const void *b)
+{
+	const struct lc_site *sa = a, *sb = b;
+
+	if (sa->total_ns == sb->total_ns)
+		return 0;
+	return sa->total_ns < sb->total_ns ? 1 : -1;
+}
+
+static int lc_sites_show(struct seq_file *m, void *v)
+{
+	unsigned int nr = roundup_pow_of_two(LC_SITES * num_possible_cpus());
+	struct lc_site *sites, *site, *src;
+	unsigned long dropped = 0;
+	unsigned int i;
+	int cpu;
+
+	sites = vzalloc(nr * sizeof(*sites));
+	if (!sites)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct lc_cpu *lc = per_cpu_ptr(&lc_cpus, cpu);
+
+		dropped += lc->dropped;
+		for (i = 0; i < LC_SITES; i++) {
+			src = &lc->sites[i];
+			if (!src->ip)
+				continue;
+
+			site = lc_site_find(sites, nr, src->ip, src->type);
+			if (!site) {
+				dropped += src->count;
+				continue;
+			}
+			site->count += src->count;
+			site->total_ns += src->total_ns;
+			site->max_ns = max(site->max_ns, src->max_ns);
+		}
+	}
+
+	sort(sites, nr, sizeof(*sites), lc_site_cmp, NULL);
+
+	seq_printf(m, "%-8s %10s %14s %10s  %s\n", "type", "count",
+		   "total-us", "max-us", "site");
+	for (i = 0; i < nr && sites[i].ip; i++) {
+		site = &sites[i];
+		seq_printf(m, "%-8s %10u %14llu %10llu  %pS\n",
+			   lc_type_names[site->type], site->count,
+			   div_u64(site->total_ns, NSEC_PER_USEC),
+			   div_u64(site->max_ns, NSEC_PER_USEC),
+			   (void *)site->ip);
+	}
+	seq_printf(m, "dropped: %lu\n", dropped);
+
+	vfree(sites);
+	return 0;
+}
+
+static int lc_sites_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lc_sites_show, NULL);
+}
+
+static const struct file_operations lc_sites_fops = {
+	.open		= lc_sites_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int lc_histogram_show(struct seq_file *m, void *v)
+{
+	struct lc_cpu *lc;
+	unsigned long count;
+	int type, bucket, cpu;
+
+	seq_printf(m, "%-8s", "<us");
+	for (bucket = 0; bucket < LC_HIST_BUCKETS - 1; bucket++)
+		seq_printf(m, " %lu", 1UL << bucket);
+	seq_puts(m, " inf\n");
+
+	for (type = 0; type < LOCK_CONTENTION_NR; type++) {
+		seq_printf(m, "%-8s", lc_type_names[type]);
+		for (bucket = 0; bucket < LC_HIST_BUCKETS; bucket++) {
+			count = 0;
+			for_each_possible_cpu(cpu) {
+				lc = per_cpu_ptr(&lc_cpus, cpu);
+				count += lc->hist[type][bucket];
+			}
+			seq_printf(m, " %lu", count);
+		}
+		seq_putc(m, '\n');
+	}
+
+	return 0;
+}
+
+static int lc_histogram_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lc_histogram_show, NULL);
+}
+
+static const struct file_operations lc_histogram_fops = {
+	.open		= lc_histogram_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static ssize_t lc_enable_read(struct file *file, char __user *ubuf,
+			      size_t count, loff_t *ppos)
+{
+	char buf[3];
+
+	buf[0] = lc_enabled ? '1' : '0';
+	buf[1] = '\n';
+	buf[2] = 0;
+	return simple_read_from_buffer(ubuf, count, ppos, buf, 2);
+}
+
+static ssize_t lc_enable_write(struct file *file, const char __user *ubuf,
+			       size_t count, loff_t *ppos)
+{
+	char buf[8];
+	bool enable;
+
+	if (copy_from_user(buf, ubuf, min(count, sizeof(buf) - 1)))
+		return -EFAULT;
+	buf[min(count, sizeof(buf) - 1)] = 0;
+	if (strtobool(buf, &enable))
+		return -EINVAL;
+
+	mutex_lock(&lc_mutex);
+	if (enable && !lc_enabled) {
+		lc_clear();
+		static_key_slow_inc(&lock_contention_key);
+	} else if (!enable && lc_enabled) {
+		static_key_slow_dec(&lock_contention_key);
+	}
+	lc_enabled = enable;
+	mutex_unlock(&lc_mutex);
+
+	return count;
+}
+
+static const struct file_operations lc_enable_fops = {
+	.open		= simple_open,
+	.read		= lc_enable_read,
+	.write		= lc_enable_write,
+	.llseek		= default_llseek,
+};
+
+static int __init lock_contention_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("lock_contention", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	debugfs_create_file("enable", 0600, dir, NULL, &lc_enable_fops);
+	debugfs_create_u32("sample_period", 0600, dir, &sample_period);
+	debugfs_create_file("sites", 0400, dir, NULL, &lc_sites_fops);
+	debugfs_create_file("histogram", 0400, dir, NULL,
+			    &lc_histogram_fops);
+
+	return 0;
+}
+late_initcall(lock_contention_init);
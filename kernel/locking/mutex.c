@@ -23,6 +23,8 @@
 #include <linux/sched/rt.h>
 #include <linux/export.h>
 #include <linux/spinlock.h>
+#include <linux/lock_contention.h>
+#include <linux/ftrace.h>
 #include <linux/interrupt.h>
 #include <linux/debug_locks.h>
 #include "mcs_spinlock.h"
@@ -494,6 +496,7 @@ __mutex_lock_common(struct mutex *lock, long state, unsigned int subclass,
 	struct task_struct *task = current;
 	struct mutex_waiter waiter;
 	unsigned long flags;
+	u64 contention;
 	int ret;
 
 	if (use_ww_ctx) {
@@ -502,12 +505,16 @@ __mutex_lock_common(struct mutex *lock, long state, unsigned int subclass,
 			return -EALREADY;
 	}
 
+	contention = lock_contention_begin();
+
 	preempt_disable();
 	mutex_acquire_nest(&lock->dep_map, subclass, 0, nest_lock, ip);
 
 	if (mutex_optimistic_spin(lock, ww_ctx, use_ww_ctx)) {
 		/* got the lock, yay! */
 		preempt_enable();
+		lock_contention_end(contention, LOCK_CONTENTION_MUTEX,
+				    CALLER_ADDR1);
 		return 0;
 	}
 
@@ -600,6 +607,7 @@ skip_wait:
 
 	spin_unlock_mutex(&lock->wait_lock, flags);
 	preempt_enable();
+	lock_contention_end(contention, LOCK_CONTENTION_MUTEX, CALLER_ADDR1);
 	return 0;
 
 err:
@@ -14,6 +14,12 @@
 #include <linux/init.h>
 #include <linux/export.h>
 #include <linux/sched/rt.h>
+#include <linux/percpu.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+#include <linux/lock_contention.h>
+#include <linux/ftrace.h>
 
 #include "mcs_spinlock.h"
 
@@ -84,6 +90,7 @@ void __init_rwsem(struct rw_semaphore *sem, const char *name,
 	INIT_LIST_HEAD(&sem->wait_list);
 #ifdef CONFIG_RWSEM_SPIN_ON_OWNER
 	sem->owner = NULL;
+	sem->handoff = false;
 	osq_lock_init(&sem->osq);
 #endif
 }
@@ -101,6 +108,53 @@ struct rwsem_waiter {
 	enum rwsem_waiter_type type;
 };
 
+/*
+ * A writer at the head of the queue for longer than this stops the lock
+ * from being stolen by optimistic spinners.
+ */
+#define RWSEM_WAIT_TIMEOUT	DIV_ROUND_UP(HZ, 250)
+
+/*
+ * Contention statistics of all rwsems, shown and cleared through
+ * /proc/rwsem_stat. Only the slowpaths update them.
+ */
+struct rwsem_stats {
+	unsigned long	read_slowpath;
+	unsigned long	read_spin;	/* taken spinning on a writer */
+	unsigned long	read_sleep;
+	unsigned long	write_slowpath;
+	unsigned long	write_spin;
+	unsigned long	write_sleep;
+	unsigned long	handoffs;
+	u64		read_wait_ns;
+	u64		read_wait_max_ns;
+	u64		write_wait_ns;
+	u64		write_wait_max_ns;
+};
+
+static DEFINE_PER_CPU(struct rwsem_stats, rwsem_stats);
+
+#define rwsem_stat_inc(field)	this_cpu_inc(rwsem_stats.field)
+
+static void rwsem_stat_wait(bool write, u64 start)
+{
+	struct rwsem_stats *stats;
+	u64 ns = local_clock() - start;
+
+	preempt_disable();
+	stats = this_cpu_ptr(&rwsem_stats);
+	if (write) {
+		stats->write_wait_ns += ns;
+		if (ns > stats->write_wait_max_ns)
+			stats->write_wait_max_ns = ns;
+	} else {
+		stats->read_wait_ns += ns;
+		if (ns > stats->read_wait_max_ns)
+			stats->read_wait_max_ns = ns;
+	}
+	preempt_enable();
+}
+
 enum rwsem_wake_type {
 	RWSEM_WAKE_ANY,		/* Wake whatever's at head of wait list */
 	RWSEM_WAKE_READERS,	/* Wake readers only */
@@ -199,57 +253,41 @@ __rwsem_do_wake(struct rw_semaphore *sem, enum rwsem_wake_type wake_type)
 	return sem;
 }
 
+#ifdef CONFIG_RWSEM_SPIN_ON_OWNER
+static inline bool rwsem_handoff_pending(struct rw_semaphore *sem)
+{
+	return ACCESS_ONCE(sem->handoff);
+}
+
 /*
- * Wait for the read lock to be granted
+ * Called with wait_lock held by a writer at the head of the queue that
+ * waited past its timeout, or that got the lock and clears the handoff.
  */
-__visible
-struct rw_semaphore __sched *rwsem_down_read_failed(struct rw_semaphore *sem)
+static inline void rwsem_set_handoff(struct rw_semaphore *sem, bool handoff)
 {
-	long count, adjustment = -RWSEM_ACTIVE_READ_BIAS;
-	struct rwsem_waiter waiter;
-	struct task_struct *tsk = current;
-
-	/* set up my own style of waitqueue */
-	waiter.task = tsk;
-	waiter.type = RWSEM_WAITING_FOR_READ;
-	get_task_struct(tsk);
-
-	raw_spin_lock_irq(&sem->wait_lock);
-	if (list_empty(&sem->wait_list))
-		adjustment += RWSEM_WAITING_BIAS;
-	list_add_tail(&waiter.list, &sem->wait_list);
-
-	/* we're now waiting on the lock, but no longer actively locking */
-	count = rwsem_atomic_update(adjustment, sem);
-
-	/* If there are no active locks, wake the front queued process(es).
-	 *
-	 * If there are no writers and we are first in the queue,
-	 * wake our own waiter to join the existing active readers !
-	 */
-	if (count == RWSEM_WAITING_BIAS ||
-	    (count > RWSEM_WAITING_BIAS &&
-	     adjustment != -RWSEM_ACTIVE_READ_BIAS))
-		sem = __rwsem_do_wake(sem, RWSEM_WAKE_ANY);
-
-	raw_spin_unlock_irq(&sem->wait_lock);
-
-	/* wait to be given the lock */
-	while (true) {
-		set_task_state(tsk, TASK_UNINTERRUPTIBLE);
-		if (!waiter.task)
-			break;
-		schedule();
-	}
-
-	tsk->state = TASK_RUNNING;
+	if (handoff && !sem->handoff)
+		rwsem_stat_inc(handoffs);
+	ACCESS_ONCE(sem->handoff) = handoff;
+}
+#else
+static inline bool rwsem_handoff_pending(struct rw_semaphore *sem)
+{
+	return false;
+}
 
-	return sem;
+static inline void rwsem_set_handoff(struct rw_semaphore *sem, bool handoff)
+{
 }
-EXPORT_SYMBOL(rwsem_down_read_failed);
+#endif
 
-static inline bool rwsem_try_write_lock(long count, struct rw_semaphore *sem)
+static inline bool rwsem_try_write_lock(long count, struct rw_semaphore *sem,
+					struct rwsem_waiter *waiter)
 {
+	/* The lock is handed off to the writer at the head of the queue */
+	if (rwsem_handoff_pending(sem) &&
+	    sem->wait_list.next != &waiter->list)
+		return false;
+
 	/*
 	 * Try acquiring the write lock. Check count first in order
 	 * to reduce unnecessary expensive cmpxchg() operations.
@@ -277,6 +315,9 @@ static inline bool rwsem_try_write_lock_unqueued(struct rw_semaphore *sem)
 		if (!(count == 0 || count == RWSEM_WAITING_BIAS))
 			return false;
 
+		if (rwsem_handoff_pending(sem))
+			return false;
+
 		old = cmpxchg(&sem->count, count, count + RWSEM_ACTIVE_WRITE_BIAS);
 		if (old == count)
 			return true;
@@ -392,13 +433,155 @@ done:
 	return taken;
 }
 
+/*
+ * Take the read lock if neither a writer nor any waiter is around, so
+ * that spinning readers never get ahead of the queue.
+ */
+static inline bool rwsem_try_read_lock_unqueued(struct rw_semaphore *sem)
+{
+	long old, count = ACCESS_ONCE(sem->count);
+
+	while (count >= 0) {
+		old = cmpxchg(&sem->count, count,
+			      count + RWSEM_ACTIVE_READ_BIAS);
+		if (old == count)
+			return true;
+
+		count = old;
+	}
+
+	return false;
+}
+
+/*
+ * A reader that found the lock write owned spins for as long as the
+ * writer runs. Page faults contending on mmap_sem with a short munmap()
+ * would otherwise all go to sleep and wait to be woken one after the
+ * other.
+ */
+static bool rwsem_optimistic_spin_read(struct rw_semaphore *sem)
+{
+	struct task_struct *owner;
+	bool taken = false;
+
+	preempt_disable();
+
+	if (!rwsem_can_spin_on_owner(sem))
+		goto done;
+
+	/* Stop being an active locker while spinning */
+	rwsem_atomic_add(-RWSEM_ACTIVE_READ_BIAS, sem);
+
+	if (osq_lock(&sem->osq)) {
+		while (true) {
+			owner = ACCESS_ONCE(sem->owner);
+			if (owner && !rwsem_spin_on_owner(sem, owner))
+				break;
+
+			if (rwsem_try_read_lock_unqueued(sem)) {
+				taken = true;
+				break;
+			}
+
+			/* Readers own it, or there is a queue: go wait */
+			if (!owner || need_resched())
+				break;
+
+			cpu_relax_lowlatency();
+		}
+		osq_unlock(&sem->osq);
+	}
+
+	/*
+	 * Try the fastpath again. On failure the slowpath undoes the bias
+	 * just as for a failed down_read().
+	 */
+	if (!taken)
+		taken = rwsem_atomic_update(RWSEM_ACTIVE_READ_BIAS, sem) > 0;
+done:
+	preempt_enable();
+	return taken;
+}
+
 #else
 static bool rwsem_optimistic_spin(struct rw_semaphore *sem)
 {
 	return false;
 }
+
+static bool rwsem_optimistic_spin_read(struct rw_semaphore *sem)
+{
+	return false;
+}
 #endif
 
+/*
+ * Wait for the read lock to be granted
+ */
+__visible
+struct rw_semaphore __sched *rwsem_down_read_failed(struct rw_semaphore *sem)
+{
+	long count, adjustment = -RWSEM_ACTIVE_READ_BIAS;
+	struct rwsem_waiter waiter;
+	struct task_struct *tsk = current;
+	u64 start = local_clock();
+	u64 contention = lock_contention_begin();
+
+	rwsem_stat_inc(read_slowpath);
+
+	/* spin while a running writer owns the lock, rather than sleeping */
+	if (rwsem_optimistic_spin_read(sem)) {
+		rwsem_stat_inc(read_spin);
+		rwsem_stat_wait(false, start);
+		lock_contention_end(contention, LOCK_CONTENTION_RWSEM_READ,
+				    CALLER_ADDR1);
+		return sem;
+	}
+
+	rwsem_stat_inc(read_sleep);
+
+	/* set up my own style of waitqueue */
+	waiter.task = tsk;
+	waiter.type = RWSEM_WAITING_FOR_READ;
+	get_task_struct(tsk);
+
+	raw_spin_lock_irq(&sem->wait_lock);
+	if (list_empty(&sem->wait_list))
+		adjustment += RWSEM_WAITING_BIAS;
+	list_add_tail(&waiter.list, &sem->wait_list);
+
+	/* we're now waiting on the lock, but no longer actively locking */
+	count = rwsem_atomic_update(adjustment, sem);
+
+	/* If there are no active locks, wake the front queued process(es).
+	 *
+	 * If there are no writers and we are first in the queue,
+	 * wake our own waiter to join the existing active readers !
+	 */
+	if (count == RWSEM_WAITING_BIAS ||
+	    (count > RWSEM_WAITING_BIAS &&
+	     adjustment != -RWSEM_ACTIVE_READ_BIAS))
+		sem = __rwsem_do_wake(sem, RWSEM_WAKE_ANY);
+
+	raw_spin_unlock_irq(&sem->wait_lock);
+
+	/* wait to be given the lock */
+	while (true) {
+		set_task_state(tsk, TASK_UNINTERRUPTIBLE);
+		if (!waiter.task)
+			break;
+		schedule();
+	}
+
+	tsk->state = TASK_RUNNING;
+	rwsem_stat_wait(false, start);
+	lock_contention_end(contention, LOCK_CONTENTION_RWSEM_READ,
+			    CALLER_ADDR1);
+
+	return sem;
+}
+EXPORT_SYMBOL(rwsem_down_read_failed);
+
 /*
  * Wait until we successfully acquire the write lock
  */
@@ -408,13 +591,25 @@ struct rw_semaphore __sched *rwsem_down_write_failed(struct rw_semaphore *sem)
 	long count;
 	bool waiting = true; /* any queued threads before us */
 	struct rwsem_waiter waiter;
+	u64 start = local_clock();
+	u64 contention = lock_contention_begin();
+	unsigned long timeout;
+
+	rwsem_stat_inc(write_slowpath);
 
 	/* undo write bias from down_write operation, stop active locking */
 	count = rwsem_atomic_update(-RWSEM_ACTIVE_WRITE_BIAS, sem);
 
 	/* do optimistic spinning and steal lock if possible */
-	if (rwsem_optimistic_spin(sem))
+	if (rwsem_optimistic_spin(sem)) {
+		rwsem_stat_inc(write_spin);
+		rwsem_stat_wait(true, start);
+		lock_contention_end(contention, LOCK_CONTENTION_RWSEM_WRITE,
+				    CALLER_ADDR1);
 		return sem;
+	}
+
+	rwsem_stat_inc(write_sleep);
 
 	/*
 	 * Optimistic spinning failed, proceed to the slowpath
@@ -447,10 +642,17 @@ struct rw_semaphore __sched *rwsem_down_write_failed(struct rw_semaphore *sem)
 		count = rwsem_atomic_update(RWSEM_WAITING_BIAS, sem);
 
 	/* wait until we successfully acquire the lock */
+	timeout = jiffies + RWSEM_WAIT_TIMEOUT;
 	set_current_state(TASK_UNINTERRUPTIBLE);
 	while (true) {
-		if (rwsem_try_write_lock(count, sem))
+		if (rwsem_try_write_lock(count, sem, &waiter))
 			break;
+
+		/* Waited long enough at the head of the queue, stop stealing */
+		if (sem->wait_list.next == &waiter.list &&
+		    time_after(jiffies, timeout))
+			rwsem_set_handoff(sem, true);
+
 		raw_spin_unlock_irq(&sem->wait_lock);
 
 		/* Block until there are no active lockers. */
@@ -463,8 +665,13 @@ struct rw_semaphore __sched *rwsem_down_write_failed(struct rw_semaphore *sem)
 	}
 	__set_current_state(TASK_RUNNING);
 
+	if (rwsem_handoff_pending(sem))
+		rwsem_set_handoff(sem, false);
 	list_del(&waiter.list);
 	raw_spin_unlock_irq(&sem->wait_lock);
+	rwsem_stat_wait(true, start);
+	lock_contention_end(contention, LOCK_CONTENTION_RWSEM_WRITE,
+			    CALLER_ADDR1);
 
 	return sem;
 }
@@ -512,3 +719,83 @@ struct rw_semaphore *rwsem_downgrade_wake(struct rw_semaphore *sem)
 	return sem;
 }
 EXPORT_SYMBOL(rwsem_downgrade_wake);
+
+#ifdef CONFIG_PROC_FS
+static int rwsem_stat_show(struct seq_file *m, void *v)
+{
+	struct rwsem_stats sum = { };
+	struct rwsem_stats *stats;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		stats = per_cpu_ptr(&rwsem_stats, cpu);
+		sum.read_slowpath += stats->read_slowpath;
+		sum.read_spin += stats->read_spin;
+		sum.read_sleep += stats->read_sleep;
+		sum.write_slowpath += stats->write_slowpath;
+		sum.write_spin += stats->write_spin;
+		sum.write_sleep += stats->write_sleep;
+		sum.handoffs += stats->handoffs;
+		sum.read_wait_ns += stats->read_wait_ns;
+		sum.read_wait_max_ns = max(sum.read_wait_max_ns,
+					   stats->read_wait_max_ns);
+		sum.write_wait_ns += stats->write_wait_ns;
+		sum.write_wait_max_ns = max(sum.write_wait_max_ns,
+					    stats->write_wait_max_ns);
+	}
+
+	seq_printf(m, "%-10s %14s %14s %14s %18s %14s\n", "class",
+		   "contended", "spin-acquired", "slept",
+		   "waittime-total", "waittime-max");
+	seq_printf(m, "%-10s %14lu %14lu %14lu %18llu %14llu\n", "read",
+		   sum.read_slowpath, sum.read_spin, sum.read_sleep,
+		   sum.read_wait_ns, sum.read_wait_max_ns);
+	seq_printf(m, "%-10s %14lu %14lu %14lu %18llu %14llu\n", "write",
+		   sum.write_slowpath, sum.write_spin, sum.write_sleep,
+		   sum.write_wait_ns, sum.write_wait_max_ns);
+	seq_printf(m, "handoffs: %lu\n", sum.handoffs);
+
+	return 0;
+}
+
+static int rwsem_stat_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, rwsem_stat_show, NULL);
+}
+
+/* Like /proc/lock_stat, writing 0 clears the statistics */
+static ssize_t rwsem_stat_write(struct file *file, const char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	char c;
+	int cpu;
+
+	if (count) {
+		if (get_user(c, buf))
+			return -EFAULT;
+
+		if (c != '0')
+			return count;
+
+		for_each_possible_cpu(cpu)
+			memset(per_cpu_ptr(&rwsem_stats, cpu), 0,
+			       sizeof(struct rwsem_stats));
+	}
+	return count;
+}
+
+static const struct file_operations rwsem_stat_fops = {
+	.open		= rwsem_stat_open,
+	.read		= seq_read,
+	.write		= rwsem_stat_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init rwsem_stat_init(void)
+{
+	proc_create("rwsem_stat", S_IRUSR | S_IWUSR, NULL, &rwsem_stat_fops);
+	return 0;
+}
+__initcall(rwsem_stat_init);
+#endif
@@ -20,6 +20,19 @@
 #include <linux/interrupt.h>
 #include <linux/debug_locks.h>
 #include <linux/export.h>
+#include <linux/lock_contention.h>
+
+/*
+ * Only time the acquisitions that find the lock taken. A lock that is
+ * released and grabbed by another cpu in between is sampled as
+ * uncontended, which is good enough to find the hot locks.
+ */
+static __always_inline u64 spin_contention_begin(raw_spinlock_t *lock)
+{
+	if (lock_contention_enabled() && raw_spin_is_locked(lock))
+		return lock_contention_begin();
+	return 0;
+}
 
 /*
  * If lockdep is enabled then we use the non-preemption spin-ops
@@ -148,7 +161,10 @@ EXPORT_SYMBOL(_raw_spin_trylock_bh);
 #ifndef CONFIG_INLINE_SPIN_LOCK
 void __lockfunc _raw_spin_lock(raw_spinlock_t *lock)
 {
+	u64 contention = spin_contention_begin(lock);
+
 	__raw_spin_lock(lock);
+	lock_contention_end(contention, LOCK_CONTENTION_SPIN, _RET_IP_);
 }
 EXPORT_SYMBOL(_raw_spin_lock);
 #endif
@@ -156,7 +172,12 @@ EXPORT_SYMBOL(_raw_spin_lock);
 #ifndef CONFIG_INLINE_SPIN_LOCK_IRQSAVE
 unsigned long __lockfunc _raw_spin_lock_irqsave(raw_spinlock_t *lock)
 {
-	return __raw_spin_lock_irqsave(lock);
+	u64 contention = spin_contention_begin(lock);
+	unsigned long flags;
+
+	flags = __raw_spin_lock_irqsave(lock);
+	lock_contention_end(contention, LOCK_CONTENTION_SPIN, _RET_IP_);
+	return flags;
 }
 EXPORT_SYMBOL(_raw_spin_lock_irqsave);
 #endif
@@ -164,7 +185,10 @@ EXPORT_SYMBOL(_raw_spin_lock_irqsave);
 #ifndef CONFIG_INLINE_SPIN_LOCK_IRQ
 void __lockfunc _raw_spin_lock_irq(raw_spinlock_t *lock)
 {
+	u64 contention = spin_contention_begin(lock);
+
 	__raw_spin_lock_irq(lock);
+	lock_contention_end(contention, LOCK_CONTENTION_SPIN, _RET_IP_);
 }
 EXPORT_SYMBOL(_raw_spin_lock_irq);
 #endif
@@ -172,7 +196,10 @@ EXPORT_SYMBOL(_raw_spin_lock_irq);
 #ifndef CONFIG_INLINE_SPIN_LOCK_BH
 void __lockfunc _raw_spin_lock_bh(raw_spinlock_t *lock)
 {
+	u64 contention = spin_contention_begin(lock);
+
 	__raw_spin_lock_bh(lock);
+	lock_contention_end(contention, LOCK_CONTENTION_SPIN, _RET_IP_);
 }
 EXPORT_SYMBOL(_raw_spin_lock_bh);
 #endif
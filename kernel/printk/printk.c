@@ -46,6 +46,7 @@
 #include <linux/irq_work.h>
 #include <linux/utsname.h>
 #include <linux/ctype.h>
+#include <linux/kthread.h>
 
 #include <asm/uaccess.h>
 
@@ -145,6 +146,10 @@ EXPORT_SYMBOL(console_set_on_cmdline);
 /* Flag: console code may call schedule() */
 static int console_may_schedule;
 
+/* Lines the consoles never got because the log buffer wrapped */
+static unsigned long console_dropped_lines;
+module_param_named(dropped_lines, console_dropped_lines, ulong, S_IRUGO);
+
 /*
  * The printk log buffer consists of a chain of concatenated variable
  * length records. Every record starts with a record header, containing
@@ -1538,6 +1543,72 @@ static int console_trylock_for_printk(void)
 	return 1;
 }
 
+/*
+ * With printk.offload set, printk() only stores the record once the
+ * system is up and leaves the consoles to the printk kthread, so that
+ * callers don't wait for a slow UART or pstore console. Oopses and panics
+ * still print synchronously.
+ */
+static bool __read_mostly printk_offload;
+module_param_named(offload, printk_offload, bool, S_IRUGO | S_IWUSR);
+
+/* Lines left to the printk kthread instead of being printed by printk() */
+static unsigned long console_deferred_lines;
+module_param_named(deferred_lines, console_deferred_lines, ulong, S_IRUGO);
+
+static struct task_struct *printk_kthread;
+
+static inline bool printk_can_offload(void)
+{
+	return printk_offload && printk_kthread && !oops_in_progress &&
+	       system_state == SYSTEM_RUNNING;
+}
+
+static bool printk_console_pending(void)
+{
+	unsigned long flags;
+	bool pending;
+
+	raw_spin_lock_irqsave(&logbuf_lock, flags);
+	/* resume_console() prints what was held back while suspended */
+	pending = console_seq != log_next_seq && !console_suspended;
+	raw_spin_unlock_irqrestore(&logbuf_lock, flags);
+
+	return pending;
+}
+
+static int printk_kthread_func(void *data)
+{
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!printk_console_pending())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		/* console_lock() lets console_unlock() cond_resched() */
+		console_lock();
+		console_unlock();
+	}
+
+	return 0;
+}
+
+static int __init printk_kthread_init(void)
+{
+	struct task_struct *tsk;
+
+	tsk = kthread_run(printk_kthread_func, NULL, "printk");
+	if (IS_ERR(tsk)) {
+		pr_err("printk: cannot start the console kthread: %ld\n",
+		       PTR_ERR(tsk));
+		return PTR_ERR(tsk);
+	}
+	printk_kthread = tsk;
+
+	return 0;
+}
+late_initcall(printk_kthread_init);
+
 int printk_delay_msec __read_mostly;
 
 static inline void printk_delay(void)
@@ -1669,6 +1740,7 @@ asmlinkage int vprintk_emit(int facility, int level,
 	int this_cpu;
 	int printed_len = 0;
 	bool in_sched = false;
+	bool offload;
 	/* cpu currently holding logbuf_lock in this function */
 	static volatile unsigned int logbuf_cpu = UINT_MAX;
 
@@ -1803,11 +1875,25 @@ asmlinkage int vprintk_emit(int facility, int level,
 						 dict, dictlen, text, text_len);
 	}
 
+	offload = printk_can_offload();
+	if (offload)
+		console_deferred_lines++;
+
 	logbuf_cpu = UINT_MAX;
 	raw_spin_unlock(&logbuf_lock);
 	lockdep_on();
 	local_irq_restore(flags);
 
+	/*
+	 * Leave the consoles to the printk kthread. From the scheduler the
+	 * irq_work queued by printk_deferred() wakes it up.
+	 */
+	if (offload) {
+		if (!in_sched)
+			wake_up_process(printk_kthread);
+		return printed_len;
+	}
+
 	/* If called from the scheduler, we can not call up(). */
 	if (!in_sched) {
 		lockdep_off();
@@ -2274,6 +2360,7 @@ again:
 		if (console_seq < log_first_seq) {
 			len = sprintf(text, "** %u printk messages dropped ** ",
 				      (unsigned)(log_first_seq - console_seq));
+			console_dropped_lines += log_first_seq - console_seq;
 
 			/* messages are gone, move to first one */
 			console_seq = log_first_seq;
@@ -2705,7 +2792,9 @@ static void wake_up_klogd_work_func(struct irq_work *irq_work)
 
 	if (pending & PRINTK_PENDING_OUTPUT) {
 		/* If trylock fails, someone else is doing the printing */
-		if (console_trylock())
+		if (printk_can_offload())
+			wake_up_process(printk_kthread);
+		else if (console_trylock())
 			console_unlock();
 	}
 
@@ -356,6 +356,8 @@ struct rcu_data {
 	wait_queue_head_t nocb_wq;	/* For nocb kthreads to sleep on. */
 	struct task_struct *nocb_kthread;
 	int nocb_defer_wakeup;		/* Defer wakeup of nocb_kthread. */
+	struct timer_list nocb_lazy_timer; /* Wakes leader for lazy CBs. */
+	bool nocb_lazy_pending;		/* Only lazy CBs, leader not woken. */
 
 	/* The following fields are used by the leader, hence own cacheline. */
 	struct rcu_head *nocb_gp_head ____cacheline_internodealigned_in_smp;
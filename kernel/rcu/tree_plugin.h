@@ -43,6 +43,8 @@
 static cpumask_var_t rcu_nocb_mask; /* CPUs to have callbacks offloaded. */
 static bool have_rcu_nocb_mask;	    /* Was rcu_nocb_mask allocated? */
 static bool __read_mostly rcu_nocb_poll;    /* Offload kthread are to poll. */
+static cpumask_var_t rcu_nocb_affinity; /* CPUs to run rcuo kthreads on. */
+static bool have_rcu_nocb_affinity; /* Was rcu_nocb_affinity allocated? */
 static char __initdata nocb_buf[NR_CPUS * 5];
 #endif /* #ifdef CONFIG_RCU_NOCB_CPU */
 
@@ -2168,6 +2170,29 @@ static int __init parse_rcu_nocb_poll(char *arg)
 }
 early_param("rcu_nocb_poll", parse_rcu_nocb_poll);
 
+/*
+ * Parse the boot-time list of CPUs the rcuo kthreads are confined to,
+ * for example the little cluster, so that callback floods offloaded
+ * from the big CPUs are not invoked right back on them.
+ */
+static int __init rcu_nocb_affinity_setup(char *str)
+{
+	alloc_bootmem_cpumask_var(&rcu_nocb_affinity);
+	have_rcu_nocb_affinity = true;
+	cpulist_parse(str, rcu_nocb_affinity);
+	return 1;
+}
+__setup("rcu_nocb_affinity=", rcu_nocb_affinity_setup);
+
+/*
+ * Jiffies that a no-CBs CPU holding nothing but lazy (kfree_rcu())
+ * callbacks waits before the leader is woken to start a grace period
+ * for them, 0 to wake it right away.  Batching them saves grace
+ * periods, and the wakeups of idle CPUs these imply.
+ */
+static int rcu_nocb_lazy_delay = DIV_ROUND_UP(HZ, 10);
+module_param(rcu_nocb_lazy_delay, int, 0644);
+
 /*
  * Wake up any no-CBs CPUs' kthreads that were waiting on the just-ended
  * grace period.
@@ -2222,6 +2247,21 @@ static void wake_nocb_leader(struct rcu_data *rdp, bool force)
 	}
 }
 
+/* The batching delay of lazy callbacks is over, kick the leader. */
+static void rcu_nocb_lazy_timer(unsigned long data)
+{
+	struct rcu_data *rdp = (struct rcu_data *)data;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	if (rdp->nocb_lazy_pending) {
+		rdp->nocb_lazy_pending = false;
+		wake_nocb_leader(rdp, false);
+		trace_rcu_nocb_wake(rdp->rsp->name, rdp->cpu, TPS("WakeLazy"));
+	}
+	local_irq_restore(flags);
+}
+
 /*
  * Does the specified CPU need an RCU callback for the specified flavor
  * of rcu_barrier()?
@@ -2282,9 +2322,21 @@ static void __call_rcu_nocb_enqueue(struct rcu_data *rdp,
 		return;
 	}
 	len = atomic_long_read(&rdp->nocb_q_count);
-	if (old_rhpp == &rdp->nocb_head) {
+	if (old_rhpp == &rdp->nocb_head &&
+	    rhcount == rhcount_lazy && ACCESS_ONCE(rcu_nocb_lazy_delay) > 0) {
+		/* ... after a while, if queue was empty and all is lazy ... */
+		rdp->nocb_lazy_pending = true;
+		if (!timer_pending(&rdp->nocb_lazy_timer))
+			mod_timer_pinned(&rdp->nocb_lazy_timer,
+					 jiffies + rcu_nocb_lazy_delay);
+		trace_rcu_nocb_wake(rdp->rsp->name, rdp->cpu,
+				    TPS("WakeLazyIsDeferred"));
+		rdp->qlen_last_fqs_check = 0;
+	} else if (old_rhpp == &rdp->nocb_head ||
+		   (rdp->nocb_lazy_pending && rhcount != rhcount_lazy)) {
+		/* ... if queue was empty or only lazy until now ... */
+		rdp->nocb_lazy_pending = false;
 		if (!irqs_disabled_flags(flags)) {
-			/* ... if queue was empty ... */
 			wake_nocb_leader(rdp, false);
 			trace_rcu_nocb_wake(rdp->rsp->name, rdp->cpu,
 					    TPS("WakeEmpty"));
@@ -2690,6 +2742,19 @@ void __init rcu_init_nohz(void)
 	pr_info("\tOffload RCU callbacks from CPUs: %s.\n", nocb_buf);
 	if (rcu_nocb_poll)
 		pr_info("\tPoll for callbacks from no-CBs CPUs.\n");
+	if (have_rcu_nocb_affinity) {
+		cpumask_and(rcu_nocb_affinity, rcu_nocb_affinity,
+			    cpu_possible_mask);
+		if (cpumask_empty(rcu_nocb_affinity)) {
+			pr_info("\tNote: kernel parameter 'rcu_nocb_affinity=' has no existing CPUs.\n");
+			have_rcu_nocb_affinity = false;
+		} else {
+			cpulist_scnprintf(nocb_buf, sizeof(nocb_buf),
+					  rcu_nocb_affinity);
+			pr_info("\tInvoke offloaded callbacks on CPUs: %s.\n",
+				nocb_buf);
+		}
+	}
 
 	for_each_rcu_flavor(rsp) {
 		for_each_cpu(cpu, rcu_nocb_mask) {
@@ -2714,6 +2779,8 @@ static void __init rcu_boot_init_nocb_percpu_data(struct rcu_data *rdp)
 	rdp->nocb_tail = &rdp->nocb_head;
 	init_waitqueue_head(&rdp->nocb_wq);
 	rdp->nocb_follower_tail = &rdp->nocb_follower_head;
+	setup_timer(&rdp->nocb_lazy_timer, rcu_nocb_lazy_timer,
+		    (unsigned long)rdp);
 }
 
 /*
@@ -2754,9 +2821,12 @@ static void rcu_spawn_one_nocb_kthread(struct rcu_state *rsp, int cpu)
 	}
 
 	/* Spawn the kthread for this CPU and RCU flavor. */
-	t = kthread_run(rcu_nocb_kthread, rdp_spawn,
-			"rcuo%c/%d", rsp->abbr, cpu);
+	t = kthread_create(rcu_nocb_kthread, rdp_spawn,
+			   "rcuo%c/%d", rsp->abbr, cpu);
 	BUG_ON(IS_ERR(t));
+	if (have_rcu_nocb_affinity)
+		set_cpus_allowed_ptr(t, rcu_nocb_affinity);
+	wake_up_process(t);
 	ACCESS_ONCE(rdp_spawn->nocb_kthread) = t;
 }
 
@@ -567,6 +567,22 @@ static inline void init_hrtick(void)
  	__old;								\
 })
 
+/*
+ * Every reschedule IPI the core scheduler sends goes through here so it
+ * is accounted to its cause in /proc/schedipi.  Counted on the sending
+ * cpu, which keeps the counters local without atomics.
+ */
+static inline void sched_count_ipi(enum sched_ipi_reason why)
+{
+	schedstat_inc(raw_rq(), ipi_count[why]);
+}
+
+static inline void sched_send_reschedule(int cpu, enum sched_ipi_reason why)
+{
+	sched_count_ipi(why);
+	smp_send_reschedule(cpu);
+}
+
 #if defined(CONFIG_SMP) && defined(TIF_POLLING_NRFLAG)
 /*
  * Atomically set TIF_NEED_RESCHED and test for TIF_POLLING_NRFLAG,
@@ -632,21 +648,26 @@ void resched_curr(struct rq *rq)
 
 	lockdep_assert_held(&rq->lock);
 
-	if (test_tsk_need_resched(curr))
-		return;
-
 	cpu = cpu_of(rq);
 
+	if (test_tsk_need_resched(curr)) {
+		if (cpu != smp_processor_id())
+			sched_count_ipi(SCHED_IPI_PENDING);
+		return;
+	}
+
 	if (cpu == smp_processor_id()) {
 		set_tsk_need_resched(curr);
 		set_preempt_need_resched();
 		return;
 	}
 
-	if (set_nr_and_not_polling(curr))
-		smp_send_reschedule(cpu);
-	else
+	if (set_nr_and_not_polling(curr)) {
+		sched_send_reschedule(cpu, SCHED_IPI_RESCHED);
+	} else {
+		sched_count_ipi(SCHED_IPI_POLLING);
 		trace_sched_wake_idle_without_ipi(cpu);
+	}
 }
 
 void resched_cpu(int cpu)
@@ -709,10 +730,12 @@ static void wake_up_idle_cpu(int cpu)
 	if (cpu == smp_processor_id())
 		return;
 
-	if (set_nr_and_not_polling(rq->idle))
-		smp_send_reschedule(cpu);
-	else
+	if (set_nr_and_not_polling(rq->idle)) {
+		sched_send_reschedule(cpu, SCHED_IPI_IDLE);
+	} else {
+		sched_count_ipi(SCHED_IPI_POLLING);
 		trace_sched_wake_idle_without_ipi(cpu);
+	}
 }
 
 static bool wake_up_full_nohz_cpu(int cpu)
@@ -1408,6 +1431,37 @@ move_list(struct list_head *dst, struct list_head *src, bool sync_rcu)
 	dst->next = first;
 }
 
+cpumask_t sched_isolated_cpus = CPU_MASK_NONE;
+
+/*
+ * Take an online CPU out of wakeup placement and load balancing without
+ * hotplugging it.  Tasks already there move on their next wakeup, or get
+ * pulled by the other CPUs' balancing; per-cpu threads keep running.  Undone
+ * by sched_unisolate_cpu(), which is just a bit flip.
+ */
+int sched_isolate_cpu(int cpu)
+{
+	cpumask_t avail;
+
+	if (!cpu_online(cpu))
+		return -EINVAL;
+
+	/* never isolate the last schedulable CPU */
+	cpumask_andnot(&avail, cpu_online_mask, &sched_isolated_cpus);
+	cpumask_clear_cpu(cpu, &avail);
+	if (cpumask_empty(&avail))
+		return -EBUSY;
+
+	cpumask_set_cpu(cpu, &sched_isolated_cpus);
+	return 0;
+}
+
+int sched_unisolate_cpu(int cpu)
+{
+	cpumask_clear_cpu(cpu, &sched_isolated_cpus);
+	return 0;
+}
+
 static int
 compare_clusters(void *priv, struct list_head *a, struct list_head *b)
 {
@@ -1606,7 +1660,7 @@ void boost_kick(int cpu)
 	struct rq *rq = cpu_rq(cpu);
 
 	if (!test_and_set_bit(BOOST_KICK, &rq->hmp_flags))
-		smp_send_reschedule(cpu);
+		sched_send_reschedule(cpu, SCHED_IPI_BOOST);
 }
 
 /* Clear any HMP scheduler related requests pending from or on cpu */
@@ -1740,6 +1794,87 @@ static __read_mostly unsigned int sched_io_is_busy;
 
 __read_mostly unsigned int sysctl_sched_pred_alert_freq = 10 * 1024 * 1024;
 
+/* Place waking tasks by max(demand, pred_demand) rather than by demand */
+__read_mostly unsigned int sysctl_sched_pred_placement;
+
+/*
+ * Floor, as a percentage of the window at the cluster's max possible
+ * frequency, for the busy time reported of a cpu that woke tasks from
+ * iowait.  Storage bound work (app launch, for one) sleeps too often for
+ * its busy time alone to ever raise the frequency.  0 disables it.
+ */
+__read_mostly unsigned int sysctl_sched_iowait_boost_pct;
+
+static int sched_pred_zero;
+static int sched_pred_one = 1;
+static int sched_pred_hundred = 100;
+
+static struct ctl_table sched_pred_sysctls[] = {
+	{
+		.procname	= "sched_pred_placement",
+		.data		= &sysctl_sched_pred_placement,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &sched_pred_zero,
+		.extra2		= &sched_pred_one,
+	},
+	{
+		.procname	= "sched_iowait_boost_pct",
+		.data		= &sysctl_sched_iowait_boost_pct,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &sched_pred_zero,
+		.extra2		= &sched_pred_hundred,
+	},
+	{ }
+};
+
+static inline void mark_iowait_boost(struct task_struct *p, int cpu)
+{
+	if (p->in_iowait && sysctl_sched_iowait_boost_pct)
+		ACCESS_ONCE(cpu_rq(cpu)->iowait_boost_pending) = true;
+}
+
+/*
+ * Called with rq->lock held for every busy query from sched_get_cpus_busy().
+ * Like the schedutil iowait boost, the floor starts at a quarter of the
+ * tunable, doubles on every query that saw iowait wakeups and halves on
+ * every one that did not, so one stray wakeup does not pin the frequency.
+ */
+static unsigned int update_iowait_boost(struct rq *rq)
+{
+	unsigned int boost_max = sysctl_sched_iowait_boost_pct;
+	unsigned int boost_min = boost_max > 4 ? boost_max >> 2 : boost_max;
+
+	if (!boost_max) {
+		rq->iowait_boost = 0;
+	} else if (rq->iowait_boost_pending) {
+		rq->iowait_boost = rq->iowait_boost ?
+				min(rq->iowait_boost << 1, boost_max) :
+				boost_min;
+	} else {
+		rq->iowait_boost >>= 1;
+		if (rq->iowait_boost < boost_min)
+			rq->iowait_boost = 0;
+	}
+	rq->iowait_boost_pending = false;
+
+	return rq->iowait_boost;
+}
+
+static int __init sched_pred_sysctl_init(void)
+{
+	register_sysctl("kernel", sched_pred_sysctls);
+	return 0;
+}
+late_initcall(sched_pred_sysctl_init);
+
+#else	/* CONFIG_SCHED_FREQ_INPUT */
+
+static inline void mark_iowait_boost(struct task_struct *p, int cpu) { }
+
 #endif	/* CONFIG_SCHED_FREQ_INPUT */
 
 /* 1 -> use PELT based load stats, 0 -> use window-based load stats */
@@ -2642,6 +2777,30 @@ u32 __weak get_freq_max_load(int cpu, u32 freq)
 DEFINE_PER_CPU(struct freq_max_load *, freq_max_load);
 static DEFINE_SPINLOCK(freq_max_load_lock);
 
+static void freq_max_load_fill_buckets(struct freq_max_load *max_load)
+{
+	u64 top;
+	int b, i = 0;
+
+	if (!max_load->length)
+		return;
+
+	/* smallest shift that maps the highest hdemand into the table */
+	top = max_load->freqs[max_load->length - 1].hdemand;
+	max_load->bucket_shift = 0;
+	while ((top >> max_load->bucket_shift) >= POWER_COST_BUCKETS)
+		max_load->bucket_shift++;
+
+	for (b = 0; b < POWER_COST_BUCKETS; b++) {
+		u64 start = (u64)b << max_load->bucket_shift;
+
+		while (i < max_load->length - 1 &&
+		       max_load->freqs[i].hdemand < start)
+			i++;
+		max_load->bucket_first[b] = i;
+	}
+}
+
 int sched_update_freq_max_load(const cpumask_t *cpumask)
 {
 	int i, cpu, ret;
@@ -2701,6 +2860,7 @@ int sched_update_freq_max_load(const cpumask_t *cpumask)
 				      cpu_max_possible_freq(cpu));
 			i++;
 		}
+		freq_max_load_fill_buckets(max_load);
 
 		rcu_assign_pointer(per_cpu(freq_max_load, cpu), max_load);
 		if (old_max_load)
@@ -2723,6 +2883,59 @@ fail:
 	return ret;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int sched_power_cost_show(struct seq_file *m, void *v)
+{
+	struct cpu_pwr_stats *per_cpu_info = get_cpu_pwr_stats();
+	struct freq_max_load *max_load;
+	int cpu, i;
+
+	if (!per_cpu_info)
+		return 0;
+
+	rcu_read_lock();
+	for_each_possible_cpu(cpu) {
+		max_load = rcu_dereference(per_cpu(freq_max_load, cpu));
+		if (!max_load || !per_cpu_info[cpu].ptable)
+			continue;
+
+		seq_printf(m, "cpu%d shift=%u\n", cpu, max_load->bucket_shift);
+		for (i = 0; i < max_load->length; i++)
+			seq_printf(m, "  freq=%u hdemand=%llu power=%u\n",
+				   per_cpu_info[cpu].ptable[i].freq,
+				   max_load->freqs[i].hdemand,
+				   per_cpu_info[cpu].ptable[i].power);
+		seq_puts(m, "  buckets:");
+		for (i = 0; i < POWER_COST_BUCKETS; i++)
+			seq_printf(m, " %u", max_load->bucket_first[i]);
+		seq_putc(m, '\n');
+	}
+	rcu_read_unlock();
+
+	return 0;
+}
+
+static int sched_power_cost_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, sched_power_cost_show, NULL);
+}
+
+static const struct file_operations sched_power_cost_fops = {
+	.open		= sched_power_cost_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static __init int sched_power_cost_debug_init(void)
+{
+	debugfs_create_file("sched_power_cost", 0444, NULL, NULL,
+			    &sched_power_cost_fops);
+	return 0;
+}
+late_initcall(sched_power_cost_debug_init);
+#endif /* CONFIG_DEBUG_FS */
+
 static void update_task_cpu_cycles(struct task_struct *p, int cpu)
 {
 	if (use_cycle_counter)
@@ -3318,6 +3531,7 @@ void sched_get_cpus_busy(struct sched_load *busy,
 	u64 nload[cpus], ngload[cpus];
 	u64 pload[cpus];
 	unsigned int cur_freq[cpus], max_freq[cpus];
+	unsigned int iowait_boost[cpus];
 	int notifier_sent[cpus];
 	int early_detection[cpus];
 	int cpu, i = 0;
@@ -3363,6 +3577,7 @@ void sched_get_cpus_busy(struct sched_load *busy,
 
 		notifier_sent[i] = rq->notifier_sent;
 		early_detection[i] = (rq->ed_task != NULL);
+		iowait_boost[i] = update_iowait_boost(rq);
 		rq->notifier_sent = 0;
 		cur_freq[i] = cpu_cur_freq(cpu);
 		max_freq[i] = cpu_max_freq(cpu);
@@ -3466,6 +3681,11 @@ skip_early:
 		pload[i] = scale_load_to_freq(pload[i], max_freq[i],
 					     rq->cluster->max_possible_freq);
 
+		if (iowait_boost[i])
+			load[i] = max_t(u64, load[i],
+				div64_u64((u64)window_size * iowait_boost[i],
+					  100));
+
 		busy[i].prev_load = div64_u64(load[i], NSEC_PER_USEC);
 		busy[i].new_task_load = div64_u64(nload[i], NSEC_PER_USEC);
 		busy[i].predicted_load = div64_u64(pload[i], NSEC_PER_USEC);
@@ -4140,6 +4360,34 @@ unsigned int sched_get_group_id(struct task_struct *p)
 	return group_id;
 }
 
+/*
+ * Fill @cpus with the cpus the tasks of related thread group @group_id are
+ * on, i.e. last ran on or are queued on.  Returns the number of tasks.
+ */
+int sched_get_group_cpus(unsigned int group_id, struct cpumask *cpus)
+{
+	struct related_thread_group *grp;
+	struct task_struct *p;
+	unsigned long flags;
+	int nr = 0;
+
+	cpumask_clear(cpus);
+
+	read_lock_irqsave(&related_thread_group_lock, flags);
+	grp = lookup_related_thread_group(group_id);
+	if (grp) {
+		raw_spin_lock(&grp->lock);
+		list_for_each_entry(p, &grp->tasks, grp_list) {
+			cpumask_set_cpu(task_cpu(p), cpus);
+			nr++;
+		}
+		raw_spin_unlock(&grp->lock);
+	}
+	read_unlock_irqrestore(&related_thread_group_lock, flags);
+
+	return nr;
+}
+
 static void update_cpu_cluster_capacity(const cpumask_t *cpus)
 {
 	int i;
@@ -4378,6 +4626,8 @@ static inline void set_window_start(struct rq *rq) {}
 
 static inline void migrate_sync_cpu(int cpu) {}
 
+static inline void mark_iowait_boost(struct task_struct *p, int cpu) { }
+
 #endif	/* CONFIG_SCHED_HMP */
 
 #ifdef CONFIG_SMP
@@ -4660,7 +4910,7 @@ void kick_process(struct task_struct *p)
 	preempt_disable();
 	cpu = task_cpu(p);
 	if ((cpu != smp_processor_id()) && task_curr(p))
-		smp_send_reschedule(cpu);
+		sched_send_reschedule(cpu, SCHED_IPI_KICK);
 	preempt_enable();
 }
 EXPORT_SYMBOL_GPL(kick_process);
@@ -4961,13 +5211,40 @@ static void ttwu_queue_remote(struct task_struct *p, int cpu)
 	struct rq *rq = cpu_rq(cpu);
 
 	if (llist_add(&p->wake_entry, &cpu_rq(cpu)->wake_list)) {
-		if (!set_nr_if_polling(rq->idle))
-			smp_send_reschedule(cpu);
-		else
+		if (!set_nr_if_polling(rq->idle)) {
+			sched_send_reschedule(cpu, SCHED_IPI_WAKE_LIST);
+		} else {
+			sched_count_ipi(SCHED_IPI_POLLING);
 			trace_sched_wake_idle_without_ipi(cpu);
+		}
+	} else {
+		sched_count_ipi(SCHED_IPI_COALESCED);
 	}
 }
 
+/*
+ * Should the wakeup of a task onto @cpu go through its wake_list?  Besides
+ * the cross-LLC case of TTWU_QUEUE, an idle target needs an IPI (or a
+ * polling kick) anyway, and a target whose wake_list is not empty already
+ * has one in flight: sched_ttwu_pending() will pick this task up with the
+ * others, so don't take the remote rq->lock per wakeup.
+ */
+static inline bool ttwu_queue_cond(int cpu)
+{
+	struct rq *rq = cpu_rq(cpu);
+
+	if (cpu == smp_processor_id())
+		return false;
+
+	if (sched_feat(TTWU_QUEUE) && !cpus_share_cache(smp_processor_id(), cpu))
+		return true;
+
+	if (!sched_feat(TTWU_COALESCE))
+		return false;
+
+	return !llist_empty(&rq->wake_list) || idle_cpu(cpu);
+}
+
 void wake_up_if_idle(int cpu)
 {
 	struct rq *rq = cpu_rq(cpu);
@@ -4979,11 +5256,12 @@ void wake_up_if_idle(int cpu)
 		goto out;
 
 	if (set_nr_if_polling(rq->idle)) {
+		sched_count_ipi(SCHED_IPI_POLLING);
 		trace_sched_wake_idle_without_ipi(cpu);
 	} else {
 		raw_spin_lock_irqsave(&rq->lock, flags);
 		if (is_idle_task(rq->curr))
-			smp_send_reschedule(cpu);
+			sched_send_reschedule(cpu, SCHED_IPI_IDLE);
 		/* Else cpu is not in idle, do nothing here */
 		raw_spin_unlock_irqrestore(&rq->lock, flags);
 	}
@@ -5003,7 +5281,7 @@ static void ttwu_queue(struct task_struct *p, int cpu)
 	struct rq *rq = cpu_rq(cpu);
 
 #if defined(CONFIG_SMP)
-	if (sched_feat(TTWU_QUEUE) && !cpus_share_cache(smp_processor_id(), cpu)) {
+	if (ttwu_queue_cond(cpu)) {
 		sched_clock_cpu(cpu); /* sync clocks x-cpu */
 		ttwu_queue_remote(p, cpu);
 		return;
@@ -5154,6 +5432,7 @@ try_to_wake_up(struct task_struct *p, unsigned int state, int wake_flags)
 
 	set_task_last_wake(p, wallclock);
 #endif /* CONFIG_SMP */
+	mark_iowait_boost(p, cpu);
 	ttwu_queue(p, cpu);
 stat:
 	ttwu_stat(p, cpu, wake_flags);
@@ -6065,11 +6344,21 @@ static bool early_detection_notify(struct rq *rq, u64 wallclock)
 
 	return 0;
 }
+
+static inline u64 rq_window_start(struct rq *rq)
+{
+	return rq->window_start;
+}
 #else /* CONFIG_SCHED_HMP */
 static bool early_detection_notify(struct rq *rq, u64 wallclock)
 {
 	return 0;
 }
+
+static inline u64 rq_window_start(struct rq *rq)
+{
+	return 0;
+}
 #endif /* CONFIG_SCHED_HMP */
 
 /*
@@ -6081,7 +6370,7 @@ void scheduler_tick(void)
 	int cpu = smp_processor_id();
 	struct rq *rq = cpu_rq(cpu);
 	struct task_struct *curr = rq->curr;
-	u64 wallclock;
+	u64 wallclock, old_window_start;
 	bool early_notif;
 	u32 old_load;
 	struct related_thread_group *grp;
@@ -6091,6 +6380,7 @@ void scheduler_tick(void)
 	raw_spin_lock(&rq->lock);
 	old_load = task_load(curr);
 	set_window_start(rq);
+	old_window_start = rq_window_start(rq);
 	update_rq_clock(rq);
 	curr->sched_class->task_tick(rq, curr, 0);
 	update_cpu_load_active(rq);
@@ -6102,6 +6392,13 @@ void scheduler_tick(void)
 	if (early_notif)
 		atomic_notifier_call_chain(&load_alert_notifier_head,
 					0, (void *)(long)cpu);
+	else if (rq_window_start(rq) != old_window_start)
+		/*
+		 * The window rolled over: alert the governor now if the
+		 * window that just closed needs another frequency, rather
+		 * than leaving it to the governor's next timer.
+		 */
+		check_for_freq_change(rq, false, true);
 
 	perf_event_task_tick();
 
@@ -10641,6 +10938,9 @@ int in_sched_functions(unsigned long addr)
  */
 struct task_group root_task_group;
 LIST_HEAD(task_groups);
+#ifdef CONFIG_SCHEDSTATS
+static DEFINE_PER_CPU(struct sched_lat_hist, root_lat_hist);
+#endif
 #endif
 
 DECLARE_PER_CPU(cpumask_var_t, load_balance_mask);
@@ -10712,6 +11012,9 @@ void __init sched_init(void)
 #ifdef CONFIG_CGROUP_SCHED
 	list_add(&root_task_group.list, &task_groups);
 	INIT_LIST_HEAD(&root_task_group.children);
+#ifdef CONFIG_SCHEDSTATS
+	root_task_group.lat_hist = &root_lat_hist;
+#endif
 	INIT_LIST_HEAD(&root_task_group.siblings);
 	autogroup_init(&init_task);
 
@@ -11043,6 +11346,9 @@ static void free_sched_group(struct task_group *tg)
 	free_fair_sched_group(tg);
 	free_rt_sched_group(tg);
 	autogroup_free(tg);
+#ifdef CONFIG_SCHEDSTATS
+	free_percpu(tg->lat_hist);
+#endif
 	kfree(tg);
 }
 
@@ -11055,6 +11361,12 @@ struct task_group *sched_create_group(struct task_group *parent)
 	if (!tg)
 		return ERR_PTR(-ENOMEM);
 
+#ifdef CONFIG_SCHEDSTATS
+	tg->lat_hist = alloc_percpu(struct sched_lat_hist);
+	if (!tg->lat_hist)
+		goto err;
+#endif
+
 	if (!alloc_fair_sched_group(tg, parent))
 		goto err;
 
@@ -11964,6 +12276,14 @@ static u64 cpu_rt_period_read_uint(struct cgroup_subsys_state *css,
 }
 #endif /* CONFIG_RT_GROUP_SCHED */
 
+#ifdef CONFIG_SCHEDSTATS
+static int cpu_lat_hist_show(struct seq_file *sf, void *v)
+{
+	sched_lat_hist_show_tg(sf, css_tg(seq_css(sf)));
+	return 0;
+}
+#endif
+
 static struct cftype cpu_files[] = {
 	{
 		.name = "notify_on_migrate",
@@ -12011,6 +12331,12 @@ static struct cftype cpu_files[] = {
 		.read_u64 = cpu_rt_period_read_uint,
 		.write_u64 = cpu_rt_period_write_uint,
 	},
+#endif
+#ifdef CONFIG_SCHEDSTATS
+	{
+		.name = "sched_lat_hist",
+		.seq_show = cpu_lat_hist_show,
+	},
 #endif
 	{ }	/* terminate */
 };
@@ -32,6 +32,7 @@ struct cpu_data {
 	bool	rejected;
 	bool	is_busy;
 	bool    not_preferred;
+	bool	isolated;
 	unsigned int busy;
 	unsigned int cpu;
 	struct list_head sib;
@@ -61,6 +62,13 @@ struct cpu_data {
 	struct kobject kobj;
 	struct list_head pending_lru;
 	bool disabled;
+	/*
+	 * Isolate mode: instead of hotplugging them, keep unneeded cores
+	 * online but out of the scheduler's placement and balancing, which
+	 * is undone in microseconds instead of a full CPU bring-up.
+	 */
+	bool isolate;
+	unsigned int nr_isolated;
 };
 
 static DEFINE_PER_CPU(struct cpu_data, cpu_state);
@@ -73,6 +81,12 @@ static void wake_up_hotplug_thread(struct cpu_data *state);
 static void add_to_pending_lru(struct cpu_data *state);
 static void update_lru(struct cpu_data *state);
 
+/* CPUs of the group the scheduler may currently use */
+static inline unsigned int active_cpus(struct cpu_data *f)
+{
+	return f->online_cpus - f->nr_isolated;
+}
+
 /* ========================= sysfs interface =========================== */
 
 static ssize_t store_min_cpus(struct cpu_data *state,
@@ -247,7 +261,8 @@ static ssize_t show_cpus(struct cpu_data *state, char *buf)
 	list_for_each_entry(c, &state->lru, sib) {
 		count += snprintf(buf + count, PAGE_SIZE - count,
 					"CPU%u (%s)\n", c->cpu,
-					c->online ? "Online" : "Offline");
+					!c->online ? "Offline" :
+					c->isolated ? "Isolated" : "Online");
 	}
 	spin_unlock_irqrestore(&state_lock, flags);
 	return count;
@@ -279,6 +294,8 @@ static ssize_t show_global_state(struct cpu_data *state, char *buf)
 					"\tCPU: %u\n", c->cpu);
 		count += snprintf(buf + count, PAGE_SIZE - count,
 					"\tOnline: %u\n", c->online);
+		count += snprintf(buf + count, PAGE_SIZE - count,
+					"\tIsolated: %u\n", c->isolated);
 		count += snprintf(buf + count, PAGE_SIZE - count,
 					"\tRejected: %u\n", c->rejected);
 		count += snprintf(buf + count, PAGE_SIZE - count,
@@ -371,6 +388,30 @@ static ssize_t show_disable(struct cpu_data *state, char *buf)
 	return snprintf(buf, PAGE_SIZE, "%u\n", state->disabled);
 }
 
+static ssize_t store_isolate(struct cpu_data *state,
+				const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1)
+		return -EINVAL;
+
+	val = !!val;
+
+	if (state->isolate == val)
+		return count;
+
+	state->isolate = val;
+	wake_up_hotplug_thread(state);
+
+	return count;
+}
+
+static ssize_t show_isolate(struct cpu_data *state, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", state->isolate);
+}
+
 struct core_ctl_attr {
 	struct attribute attr;
 	ssize_t (*show)(struct cpu_data *, char *);
@@ -398,6 +439,7 @@ core_ctl_attr_ro(online_cpus);
 core_ctl_attr_ro(global_state);
 core_ctl_attr_rw(not_preferred);
 core_ctl_attr_rw(disable);
+core_ctl_attr_rw(isolate);
 
 static struct attribute *default_attrs[] = {
 	&min_cpus.attr,
@@ -413,6 +455,7 @@ static struct attribute *default_attrs[] = {
 	&global_state.attr,
 	&not_preferred.attr,
 	&disable.attr,
+	&isolate.attr,
 	NULL
 };
 
@@ -571,7 +614,7 @@ static bool eval_need(struct cpu_data *f)
 		return 0;
 
 	spin_lock_irqsave(&state_lock, flags);
-	thres_idx = f->online_cpus ? f->online_cpus - 1 : 0;
+	thres_idx = active_cpus(f) ? active_cpus(f) - 1 : 0;
 	list_for_each_entry(c, &f->lru, sib) {
 		if (c->busy >= f->busy_up_thres[thres_idx])
 			c->is_busy = true;
@@ -825,6 +868,96 @@ done:
 	update_lru(f);
 }
 
+static void core_ctl_isolate_core(struct cpu_data *f, struct cpu_data *c)
+{
+	unsigned long flags;
+
+	pr_debug("Trying to Isolate CPU%u\n", c->cpu);
+	if (sched_isolate_cpu(c->cpu)) {
+		pr_debug("Unable to Isolate CPU%u\n", c->cpu);
+		return;
+	}
+
+	spin_lock_irqsave(&state_lock, flags);
+	c->isolated = true;
+	f->nr_isolated++;
+	spin_unlock_irqrestore(&state_lock, flags);
+	add_to_pending_lru(c);
+}
+
+static void core_ctl_unisolate_core(struct cpu_data *f, struct cpu_data *c)
+{
+	unsigned long flags;
+
+	pr_debug("Unisolating CPU%u\n", c->cpu);
+	sched_unisolate_cpu(c->cpu);
+
+	spin_lock_irqsave(&state_lock, flags);
+	c->isolated = false;
+	f->nr_isolated--;
+	spin_unlock_irqrestore(&state_lock, flags);
+	add_to_pending_lru(c);
+}
+
+/*
+ * Isolate mode counterpart of do_hotplug(): meet need_cpus by isolating
+ * and unisolating online cores.  Cores that are offline (from before the
+ * mode was enabled, or thermal) are only ever brought back, never taken
+ * down.  When the mode is turned off, everything is unisolated and plain
+ * hotplug takes over again.
+ */
+static void __ref do_isolation(struct cpu_data *f)
+{
+	unsigned int need;
+	struct cpu_data *c, *tmp;
+
+	need = f->isolate ? apply_limits(f, f->need_cpus) : f->num_cpus;
+	pr_debug("Trying to adjust group %u to %u active\n",
+		 f->first_cpu, need);
+
+	mutex_lock(&lru_lock);
+	if (active_cpus(f) > need) {
+		list_for_each_entry_safe(c, tmp, &f->lru, sib) {
+			if (!c->online || c->isolated)
+				continue;
+
+			if (active_cpus(f) == need)
+				break;
+
+			/* Don't isolate busy CPUs. */
+			if (c->is_busy)
+				continue;
+
+			core_ctl_isolate_core(f, c);
+		}
+
+		list_for_each_entry_safe(c, tmp, &f->lru, sib) {
+			if (!c->online || c->isolated)
+				continue;
+
+			if (active_cpus(f) <= f->max_cpus)
+				break;
+
+			core_ctl_isolate_core(f, c);
+		}
+	} else if (active_cpus(f) < need) {
+		list_for_each_entry_safe(c, tmp, &f->lru, sib) {
+			if (!c->isolated)
+				continue;
+
+			if (active_cpus(f) == need)
+				break;
+
+			core_ctl_unisolate_core(f, c);
+		}
+	}
+	mutex_unlock(&lru_lock);
+	update_lru(f);
+
+	if (!f->isolate || f->online_cpus < need)
+		do_hotplug(f);
+}
+
 static int __ref try_hotplug(void *data)
 {
 	struct cpu_data *f = data;
@@ -844,7 +977,10 @@ static int __ref try_hotplug(void *data)
 		f->pending = false;
 		spin_unlock_irqrestore(&f->pending_lock, flags);
 
-		do_hotplug(f);
+		if (f->isolate || f->nr_isolated)
+			do_isolation(f);
+		else
+			do_hotplug(f);
 	}
 
 	return 0;
@@ -902,7 +1038,7 @@ static int __ref cpu_callback(struct notifier_block *nfb,
 		 * so that there's no race with hotplug thread bringing up more
 		 * CPUs than necessary.
 		 */
-		if (!f->disabled &&
+		if (!f->disabled && !f->isolate &&
 			apply_limits(f, f->need_cpus) <= f->online_cpus) {
 			pr_debug("Prevent CPU%d onlining\n", cpu);
 			ret = NOTIFY_BAD;
@@ -938,6 +1074,15 @@ static int __ref cpu_callback(struct notifier_block *nfb,
 		break;
 
 	case CPU_DEAD:
+		/* An isolated CPU that goes offline is no longer isolated. */
+		if (state->isolated) {
+			sched_unisolate_cpu(cpu);
+			spin_lock_irqsave(&state_lock, flags);
+			state->isolated = false;
+			f->nr_isolated--;
+			spin_unlock_irqrestore(&state_lock, flags);
+		}
+
 		/* Move a CPU to the end of the LRU when it goes offline. */
 		ret = mutex_trylock(&lru_lock);
 		if (ret) {
@@ -18,6 +18,7 @@
 #include <trace/events/cpufreq_sched.h>
 
 #include "sched.h"
+#include "tune.h"
 
 #define THROTTLE_DOWN_NSEC	50000000 /* 50ms default */
 #define THROTTLE_UP_NSEC	500000 /* 500us default */
@@ -39,8 +40,11 @@ DEFINE_PER_CPU(struct sched_capacity_reqs, cpu_sched_capacity_reqs);
  * @up_throttle_nsec: throttle period length in nanoseconds if increasing OPP
  * @down_throttle_nsec: throttle period length in nanoseconds if decreasing OPP
  * @task: worker thread for dvfs transition that may block/sleep
- * @irq_work: callback used to wake up worker thread
+ * @irq_work: callback used to wake up worker thread or to fast switch
  * @requested_freq: last frequency requested by the sched governor
+ * @policy: policy this governor instance drives
+ * @fast_switch: the driver can change frequency from the irq_work
+ * @fast_lock: serializes fast switches of the policy
  *
  * struct gov_data is the per-policy cpufreq_sched-specific data structure. A
  * per-policy instance of it is created when the cpufreq_sched governor receives
@@ -58,6 +62,9 @@ struct gov_data {
 	struct task_struct *task;
 	struct irq_work irq_work;
 	unsigned int requested_freq;
+	struct cpufreq_policy *policy;
+	bool fast_switch;
+	raw_spinlock_t fast_lock;
 };
 
 static void cpufreq_sched_try_driver_target(struct cpufreq_policy *policy,
@@ -149,6 +156,44 @@ static int cpufreq_sched_thread(void *data)
 	return 0;
 }
 
+/*
+ * Program the request straight from the irq_work, skipping the wakeup of
+ * and the switch to the kthread.  A request that is still inside its up
+ * or down rate limit is left to the kthread, which sleeps until the limit
+ * expires.  Returns false if the kthread has to handle the request.
+ */
+static bool cpufreq_sched_fast_switch(struct gov_data *gd)
+{
+	struct cpufreq_policy *policy = gd->policy;
+	unsigned int freq;
+	ktime_t now, throttle;
+	bool done = true;
+
+	raw_spin_lock(&gd->fast_lock);
+
+	freq = gd->requested_freq;
+	if (freq == policy->cur)
+		goto out;
+
+	now = ktime_get();
+	throttle = freq < policy->cur ? gd->down_throttle : gd->up_throttle;
+	if (ktime_before(now, throttle)) {
+		done = false;
+		goto out;
+	}
+
+	if (!cpufreq_driver_fast_switch(policy, freq)) {
+		done = false;
+		goto out;
+	}
+
+	gd->up_throttle = ktime_add_ns(now, gd->up_throttle_nsec);
+	gd->down_throttle = ktime_add_ns(now, gd->down_throttle_nsec);
+out:
+	raw_spin_unlock(&gd->fast_lock);
+	return done;
+}
+
 static void cpufreq_sched_irq_work(struct irq_work *irq_work)
 {
 	struct gov_data *gd;
@@ -157,6 +202,9 @@ static void cpufreq_sched_irq_work(struct irq_work *irq_work)
 	if (!gd)
 		return;
 
+	if (gd->fast_switch && cpufreq_sched_fast_switch(gd))
+		return;
+
 	wake_up_process(gd->task);
 }
 
@@ -216,9 +264,10 @@ static void update_fdomain_capacity_request(int cpu)
 
 	/*
 	 * Throttling is not yet supported on platforms with fast cpufreq
-	 * drivers.
+	 * drivers.  Policies that can fast switch do it from the irq_work,
+	 * outside of the rq->lock held here.
 	 */
-	if (cpufreq_driver_slow)
+	if (gd->fast_switch || cpufreq_driver_slow)
 		irq_work_queue_on(&gd->irq_work, cpu);
 	else
 		cpufreq_sched_try_driver_target(policy, freq_new);
@@ -237,7 +286,8 @@ void update_cpu_capacity_request(int cpu, bool request)
 
 	scr = &per_cpu(cpu_sched_capacity_reqs, cpu);
 
-	new_capacity = scr->cfs + scr->rt;
+	/* Honour the utilization clamps of the boost groups on this CPU */
+	new_capacity = schedtune_cpu_util_clamp(cpu, scr->cfs) + scr->rt;
 	new_capacity = new_capacity * capacity_margin
 		/ SCHED_CAPACITY_SCALE;
 	new_capacity += scr->dl;
@@ -289,6 +339,9 @@ static int cpufreq_sched_policy_init(struct cpufreq_policy *policy)
 	pr_debug("%s: throttle threshold = %u [ns]\n",
 		  __func__, gd->up_throttle_nsec);
 
+	gd->policy = policy;
+	gd->fast_switch = policy->fast_switch_possible;
+	raw_spin_lock_init(&gd->fast_lock);
 	policy->governor_data = gd;
 
 	rc = sysfs_create_group(get_governor_parent_kobj(policy), get_sysfs_attr());
@@ -297,8 +350,9 @@ static int cpufreq_sched_policy_init(struct cpufreq_policy *policy)
 		goto err;
 	}
 
-	if (cpufreq_driver_is_slow()) {
-		cpufreq_driver_slow = true;
+	if (cpufreq_driver_is_slow() || gd->fast_switch) {
+		if (cpufreq_driver_is_slow())
+			cpufreq_driver_slow = true;
 		gd->task = kthread_create(cpufreq_sched_thread, policy,
 					  "kschedfreq:%d",
 					  cpumask_first(policy->related_cpus));
@@ -328,7 +382,8 @@ static int cpufreq_sched_policy_exit(struct cpufreq_policy *policy)
 	struct gov_data *gd = policy->governor_data;
 
 	clear_sched_freq();
-	if (cpufreq_driver_slow) {
+	if (gd->task) {
+		irq_work_sync(&gd->irq_work);
 		kthread_stop(gd->task);
 		put_task_struct(gd->task);
 	}
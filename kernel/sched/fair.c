@@ -2680,9 +2680,25 @@ static int task_load_will_fit(struct task_struct *p, u64 task_load, int cpu)
 	return 0;
 }
 
+/*
+ * Load used to pick a cluster for a waking task.  With
+ * sysctl_sched_pred_placement set, a task whose busy-time buckets predict a
+ * heavier next window than its recent history (a UI thread coming back after
+ * a touch, say) is placed for that prediction straight away instead of after
+ * a few windows of history.  Big task accounting keeps using task_load().
+ */
+static inline u32 task_placement_load(struct task_struct *p)
+{
+#ifdef CONFIG_SCHED_FREQ_INPUT
+	if (sysctl_sched_pred_placement)
+		return max(task_load(p), p->ravg.pred_demand);
+#endif
+	return task_load(p);
+}
+
 static int task_will_fit(struct task_struct *p, int cpu)
 {
-	u64 tload = scale_load_to_cpu(task_load(p), cpu);
+	u64 tload = scale_load_to_cpu(task_placement_load(p), cpu);
 
 	return task_load_will_fit(p, tload, cpu);
 }
@@ -2723,7 +2739,7 @@ struct cpu_pwr_stats __weak *get_cpu_pwr_stats(void)
  */
 unsigned int power_cost(int cpu, u64 demand)
 {
-	int first, mid, last;
+	int idx;
 	struct cpu_pwr_stats *per_cpu_info = get_cpu_pwr_stats();
 	struct cpu_pstate_pwr *costs;
 	struct freq_max_load *max_load;
@@ -2756,21 +2772,15 @@ unsigned int power_cost(int cpu, u64 demand)
 		goto unlock;
 	}
 
-	first = 0;
-	last = max_load->length - 1;
-	mid = (last - first) >> 1;
-	while (1) {
-		if (demand <= max_load->freqs[mid].hdemand)
-			last = mid;
-		else
-			first = mid;
-
-		if (last - first == 1)
-			break;
-		mid = first + ((last - first) >> 1);
-	}
+	/*
+	 * Lowest entry with demand <= hdemand; bucket_first[] starts us at
+	 * or just below it, so this is usually a single step.
+	 */
+	idx = max_load->bucket_first[demand >> max_load->bucket_shift];
+	while (demand > max_load->freqs[idx].hdemand)
+		idx++;
 
-	pc = costs[last].power;
+	pc = costs[idx].power;
 
 unlock:
 	rcu_read_unlock();
@@ -2925,7 +2935,7 @@ select_least_power_cluster(struct cpu_select_env *env)
 	struct sched_cluster *cluster;
 
 	if (env->rtg) {
-		env->task_load = scale_load_to_cpu(task_load(env->p),
+		env->task_load = scale_load_to_cpu(task_placement_load(env->p),
 			cluster_first_cpu(env->rtg->preferred_cluster));
 		return env->rtg->preferred_cluster;
 	}
@@ -2934,8 +2944,9 @@ select_least_power_cluster(struct cpu_select_env *env)
 		if (!skip_cluster(cluster, env)) {
 			int cpu = cluster_first_cpu(cluster);
 
-			env->task_load = scale_load_to_cpu(task_load(env->p),
-									 cpu);
+			env->task_load =
+				scale_load_to_cpu(task_placement_load(env->p),
+						  cpu);
 			if (task_load_will_fit(env->p, env->task_load, cpu))
 				return cluster;
 
@@ -2997,6 +3008,9 @@ struct cpu_select_env *env, struct cluster_cpu_stats *stats)
 		next = next_candidate(env->backup_list, 0, num_clusters);
 		__clear_bit(next->id, env->backup_list);
 		for_each_cpu_and(i, &env->p->cpus_allowed, &next->cpus) {
+			if (cpu_isolated(i))
+				continue;
+
 			trace_sched_cpu_load_wakeup(cpu_rq(i), idle_cpu(i),
 			sched_irqload(i), power_cost(i, task_load(env->p) +
 					cpu_cravg_sync(i, env->sync)), 0);
@@ -3035,7 +3049,7 @@ next_best_cluster(struct sched_cluster *cluster, struct cpu_select_env *env,
 		}
 	} while (!next);
 
-	env->task_load = scale_load_to_cpu(task_load(env->p),
+	env->task_load = scale_load_to_cpu(task_placement_load(env->p),
 					cluster_first_cpu(next));
 	return next;
 }
@@ -3154,6 +3168,7 @@ static void find_best_cpu_in_cluster(struct sched_cluster *c,
 	struct cpumask search_cpus;
 
 	cpumask_and(&search_cpus, tsk_cpus_allowed(env->p), &c->cpus);
+	cpumask_andnot(&search_cpus, &search_cpus, &sched_isolated_cpus);
 	if (env->ignore_prev_cpu)
 		cpumask_clear_cpu(env->prev_cpu, &search_cpus);
 
@@ -3221,7 +3236,8 @@ bias_to_prev_cpu(struct cpu_select_env *env, struct cluster_cpu_stats *stats)
 
 	prev_cpu = env->prev_cpu;
 	if (!cpumask_test_cpu(prev_cpu, tsk_cpus_allowed(task)) ||
-					unlikely(!cpu_active(prev_cpu)))
+					unlikely(!cpu_active(prev_cpu)) ||
+					cpu_isolated(prev_cpu))
 		return false;
 
 	if (task->ravg.mark_start - task->last_cpu_selected_ts >=
@@ -3238,7 +3254,7 @@ bias_to_prev_cpu(struct cpu_select_env *env, struct cluster_cpu_stats *stats)
 					sched_short_sleep_task_threshold)
 		return false;
 
-	env->task_load = scale_load_to_cpu(task_load(task), prev_cpu);
+	env->task_load = scale_load_to_cpu(task_placement_load(task), prev_cpu);
 	cluster = cpu_rq(prev_cpu)->cluster;
 
 	if (!task_load_will_fit(task, env->task_load, prev_cpu)) {
@@ -3323,7 +3339,7 @@ static int select_best_cpu(struct task_struct *p, int target, int reason,
 			if (sysctl_sched_prefer_sync_wakee_to_waker &&
 				cpu_rq(cpu)->nr_running == 1 &&
 				cpumask_test_cpu(cpu, tsk_cpus_allowed(p)) &&
-				cpu_active(cpu)) {
+				cpu_active(cpu) && !cpu_isolated(cpu)) {
 				fast_path = true;
 				target = cpu;
 				goto out;
@@ -9002,7 +9018,8 @@ static int load_balance(int this_cpu, struct rq *this_rq,
 	schedstat_inc(sd, lb_count[idle]);
 
 redo:
-	if (!should_we_balance(&env)) {
+	/* An isolated CPU must not pull work back onto itself */
+	if (!should_we_balance(&env) || cpu_isolated(this_cpu)) {
 		*continue_balancing = 0;
 		goto out_balanced;
 	}
@@ -56,6 +56,13 @@ SCHED_FEAT(NONTASK_CAPACITY, true)
  */
 SCHED_FEAT(TTWU_QUEUE, false)
 
+/*
+ * Queue remote wakeups of an idle CPU, or of one that already has a
+ * wakeup IPI in flight, on its wake_list so that back to back wakeups
+ * share one IPI instead of each taking the remote rq->lock.
+ */
+SCHED_FEAT(TTWU_COALESCE, true)
+
 SCHED_FEAT(FORCE_SD_OVERLAP, false)
 SCHED_FEAT(RT_RUNTIME_SHARE, true)
 SCHED_FEAT(LB_MIN, false)
@@ -1684,6 +1684,24 @@ static DEFINE_PER_CPU(cpumask_var_t, local_cpu_mask);
 
 #ifdef CONFIG_SCHED_HMP
 
+/*
+ * Would @p, on top of @cpu_load already queued there, complete within the
+ * window at the cpu's current frequency?  RT tasks with no demand history
+ * fit everywhere so they keep the plain lowest-load placement.
+ */
+static int rt_task_fits_cur_freq(struct task_struct *p, u64 cpu_load, int cpu)
+{
+	u64 load = task_load(p);
+
+	if (!load)
+		return 1;
+
+	load = scale_load_to_cpu(load + cpu_load, cpu);
+
+	return load * cpu_max_possible_freq(cpu) <=
+		(u64)cpu_cur_freq(cpu) * max_task_load();
+}
+
 static int find_lowest_rq_hmp(struct task_struct *task)
 {
 	struct cpumask *lowest_mask = __get_cpu_var(local_cpu_mask);
@@ -1692,6 +1710,8 @@ static int find_lowest_rq_hmp(struct task_struct *task)
 	int best_cpu = -1;
 	int prev_cpu = task_cpu(task);
 	u64 cpu_load, min_load = ULLONG_MAX;
+	int best_fits = 0, best_cstate = INT_MAX;
+	int fits, cstate;
 	int i;
 	int restrict_cluster = sched_boost() ? 0 :
 				sysctl_sched_restrict_cluster_spill;
@@ -1710,6 +1730,12 @@ static int find_lowest_rq_hmp(struct task_struct *task)
 	 * At this point we have built a mask of cpus representing the
 	 * lowest priority tasks in the system.  Now we want to elect
 	 * the best one based on our affinity and topology.
+	 *
+	 * cpupri treats all of those cpus alike.  Prefer one that can run
+	 * the task at its current frequency, then the shallowest idle
+	 * state, so audio and display threads neither queue behind a
+	 * little cpu at a low OPP nor pay a deep C-state exit, and only
+	 * then the least loaded one.
 	 */
 
 	for_each_sched_cluster(cluster) {
@@ -1723,18 +1749,37 @@ static int find_lowest_rq_hmp(struct task_struct *task)
 				continue;
 
 			cpu_load = cpu_rq(i)->hmp_stats.cumulative_runnable_avg;
+			fits = rt_task_fits_cur_freq(task, cpu_load, i);
+			cstate = idle_cpu(i) ? cpu_rq(i)->cstate : 0;
 			if (!restrict_cluster)
 				cpu_load = scale_load_to_cpu(cpu_load, i);
 
+			if (fits != best_fits) {
+				if (fits < best_fits)
+					continue;
+				goto pick;
+			}
+
+			if (cstate != best_cstate) {
+				if (cstate > best_cstate)
+					continue;
+				goto pick;
+			}
+
 			if (cpu_load < min_load ||
 				(cpu_load == min_load &&
 				(i == prev_cpu || (best_cpu != prev_cpu &&
-				cpus_share_cache(prev_cpu, i))))) {
-				min_load = cpu_load;
-				best_cpu = i;
-			}
+				cpus_share_cache(prev_cpu, i)))))
+				goto pick;
+
+			continue;
+pick:
+			best_fits = fits;
+			best_cstate = cstate;
+			min_load = cpu_load;
+			best_cpu = i;
 		}
-		if (restrict_cluster && best_cpu != -1)
+		if (restrict_cluster && best_cpu != -1 && best_fits)
 			break;
 	}
 
@@ -32,9 +32,18 @@ struct freq_max_load_entry {
 	u64 hdemand;
 };
 
+/*
+ * power_cost() lookup: demand >> bucket_shift indexes bucket_first[], the
+ * lowest entry whose hdemand is at least the bucket's lower bound, so the
+ * matching entry is found by stepping from there instead of searching.
+ */
+#define POWER_COST_BUCKETS	64
+
 struct freq_max_load {
 	struct rcu_head rcu;
 	int length;
+	unsigned int bucket_shift;
+	u8 bucket_first[POWER_COST_BUCKETS];
 	struct freq_max_load_entry freqs[0];
 };
 
@@ -193,6 +202,35 @@ struct dl_bw {
 
 extern struct mutex sched_domains_mutex;
 
+#ifdef CONFIG_SCHEDSTATS
+/*
+ * Runnable to running latency histogram: bucket 0 is under 1.024us, bucket
+ * n counts waits of [2^(n-1), 2^n) * 1.024us and the last one everything
+ * from ~16.8ms up.
+ */
+#define SCHED_LAT_BUCKETS	16
+
+struct sched_lat_hist {
+	unsigned int count[SCHED_LAT_BUCKETS];
+};
+#endif
+
+/*
+ * Reschedule IPIs, counted on the sending cpu: the first entries are IPIs
+ * actually sent, by cause, the rest are IPIs that were not needed.
+ */
+enum sched_ipi_reason {
+	SCHED_IPI_WAKE_LIST,	/* first wakeup queued on a remote wake_list */
+	SCHED_IPI_RESCHED,	/* resched_curr() of a remote cpu */
+	SCHED_IPI_IDLE,		/* wake_up_idle_cpu(), wake_up_if_idle() */
+	SCHED_IPI_BOOST,	/* boost_kick() */
+	SCHED_IPI_KICK,		/* kick_process() */
+	SCHED_IPI_COALESCED,	/* wakeup batched behind an IPI in flight */
+	SCHED_IPI_POLLING,	/* target was polling, need_resched was enough */
+	SCHED_IPI_PENDING,	/* target already had need_resched set */
+	SCHED_IPI_NR_REASONS,
+};
+
 #ifdef CONFIG_CGROUP_SCHED
 
 #include <linux/cgroup.h>
@@ -263,6 +301,11 @@ struct task_group {
 #endif
 
 	struct cfs_bandwidth cfs_bandwidth;
+
+#ifdef CONFIG_SCHEDSTATS
+	/* runnable to running latency of the group's tasks, per cpu */
+	struct sched_lat_hist __percpu *lat_hist;
+#endif
 };
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
@@ -725,6 +768,8 @@ struct rq {
 	u64 old_busy_time, old_busy_time_group;
 	int notifier_sent;
 	u64 old_estimated_time;
+	bool iowait_boost_pending;
+	unsigned int iowait_boost;
 #endif
 #endif
 
@@ -773,6 +818,13 @@ struct rq {
 	/* try_to_wake_up() stats */
 	unsigned int ttwu_count;
 	unsigned int ttwu_local;
+
+	/* runnable to running latency, all tasks and RT tasks only */
+	struct sched_lat_hist lat_hist;
+	struct sched_lat_hist rt_lat_hist;
+
+	/* reschedule IPIs sent (or avoided) from this cpu */
+	unsigned int ipi_count[SCHED_IPI_NR_REASONS];
 #endif
 
 #ifdef CONFIG_SMP
@@ -945,6 +997,17 @@ static inline void sched_ttwu_pending(void) { }
 
 #endif /* CONFIG_SMP */
 
+#ifdef CONFIG_SCHEDSTATS
+extern void sched_lat_account(struct rq *rq, struct task_struct *t,
+			      unsigned long long delta);
+#ifdef CONFIG_CGROUP_SCHED
+extern void sched_lat_hist_show_tg(struct seq_file *m, struct task_group *tg);
+#endif
+#else
+static inline void sched_lat_account(struct rq *rq, struct task_struct *t,
+				     unsigned long long delta) { }
+#endif
+
 #include "stats.h"
 #include "auto_group.h"
 
@@ -1210,11 +1273,24 @@ static inline int is_task_in_related_thread_group(struct task_struct *p)
 	return rcu_access_pointer(p->grp) != NULL;
 }
 
+/* Online CPUs core_ctl has taken out of task placement and balancing */
+extern cpumask_t sched_isolated_cpus;
+
+static inline int cpu_isolated(int cpu)
+{
+	return cpumask_test_cpu(cpu, &sched_isolated_cpus);
+}
+
 #else	/* CONFIG_SCHED_HMP */
 
 struct hmp_sched_stats;
 struct related_thread_group;
 
+static inline int cpu_isolated(int cpu)
+{
+	return 0;
+}
+
 static inline u64 scale_load_to_cpu(u64 load, int cpu)
 {
 	return load;
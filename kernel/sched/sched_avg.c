@@ -18,21 +18,47 @@
 #include <linux/hrtimer.h>
 #include <linux/sched.h>
 #include <linux/math64.h>
+#include <linux/seqlock.h>
 
 #include "sched.h"
 #include <trace/events/sched.h>
 
-static DEFINE_PER_CPU(u64, nr_prod_sum);
-static DEFINE_PER_CPU(u64, last_time);
-static DEFINE_PER_CPU(u64, nr_big_prod_sum);
-static DEFINE_PER_CPU(u64, nr);
-
-static DEFINE_PER_CPU(unsigned long, iowait_prod_sum);
-static DEFINE_PER_CPU(spinlock_t, nr_lock) = __SPIN_LOCK_UNLOCKED(nr_lock);
+/*
+ * Running integrals of nr_running, eligible big tasks and iowait tasks
+ * over time.  They only ever grow; writers are the enqueue/dequeue paths,
+ * already serialized by the cpu's rq->lock with interrupts disabled, and
+ * readers sample them under the seqcount without taking any lock.
+ */
+struct nr_avg_stats {
+	seqcount_t seq;
+	u64 last_time;
+	unsigned long nr;
+	u64 nr_prod_sum;
+	u64 nr_big_prod_sum;
+	u64 iowait_prod_sum;
+};
+
+/* Integrals as of the previous sched_get_nr_running_avg() */
+struct nr_avg_snap {
+	u64 nr_prod_sum;
+	u64 nr_big_prod_sum;
+	u64 iowait_prod_sum;
+};
+
+static DEFINE_PER_CPU(struct nr_avg_stats, nr_avg_stats);
+static DEFINE_PER_CPU(struct nr_avg_snap, nr_avg_snap);
 static s64 last_get_time;
 
 static DEFINE_PER_CPU(atomic64_t, last_busy_time) = ATOMIC64_INIT(0);
 
+static inline u64 nr_avg_delta(u64 now, u64 *prev)
+{
+	u64 delta = now > *prev ? now - *prev : 0;
+
+	*prev = max(now, *prev);
+	return delta;
+}
+
 /**
  * sched_get_nr_running_avg
  * @return: Average nr_running, iowait and nr_big_tasks value since last poll.
@@ -40,7 +66,8 @@ static DEFINE_PER_CPU(atomic64_t, last_busy_time) = ATOMIC64_INIT(0);
  *	    of accuracy.
  *
  * Obtains the average nr_running value since the last poll.
- * This function may not be called concurrently with itself
+ * This function may not be called concurrently with itself, but never
+ * stalls or contends with the scheduler.
  */
 void sched_get_nr_running_avg(int *avg, int *iowait_avg, int *big_avg)
 {
@@ -56,31 +83,32 @@ void sched_get_nr_running_avg(int *avg, int *iowait_avg, int *big_avg)
 	if (!diff)
 		return;
 
-	/* read and reset nr_running counts */
 	for_each_possible_cpu(cpu) {
-		unsigned long flags;
-
-		spin_lock_irqsave(&per_cpu(nr_lock, cpu), flags);
+		struct nr_avg_stats *stats = &per_cpu(nr_avg_stats, cpu);
+		struct nr_avg_snap *snap = &per_cpu(nr_avg_snap, cpu);
+		u64 nr_sum, big_sum, iowait_sum, last;
+		unsigned long nr;
+		unsigned int seq;
+
+		do {
+			seq = read_seqcount_begin(&stats->seq);
+			last = stats->last_time;
+			nr = stats->nr;
+			nr_sum = stats->nr_prod_sum;
+			big_sum = stats->nr_big_prod_sum;
+			iowait_sum = stats->iowait_prod_sum;
+		} while (read_seqcount_retry(&stats->seq, seq));
+
+		/* Extend the integrals from the last update up to now */
 		curr_time = sched_clock();
-		diff = curr_time - per_cpu(last_time, cpu);
-		BUG_ON((s64)diff < 0);
-
-		tmp_avg += per_cpu(nr_prod_sum, cpu);
-		tmp_avg += per_cpu(nr, cpu) * diff;
-
-		tmp_big_avg += per_cpu(nr_big_prod_sum, cpu);
-		tmp_big_avg += nr_eligible_big_tasks(cpu) * diff;
-
-		tmp_iowait += per_cpu(iowait_prod_sum, cpu);
-		tmp_iowait +=  nr_iowait_cpu(cpu) * diff;
-
-		per_cpu(last_time, cpu) = curr_time;
-
-		per_cpu(nr_prod_sum, cpu) = 0;
-		per_cpu(nr_big_prod_sum, cpu) = 0;
-		per_cpu(iowait_prod_sum, cpu) = 0;
-
-		spin_unlock_irqrestore(&per_cpu(nr_lock, cpu), flags);
+		diff = (s64)(curr_time - last) > 0 ? curr_time - last : 0;
+		nr_sum += nr * diff;
+		big_sum += nr_eligible_big_tasks(cpu) * diff;
+		iowait_sum += nr_iowait_cpu(cpu) * diff;
+
+		tmp_avg += nr_avg_delta(nr_sum, &snap->nr_prod_sum);
+		tmp_big_avg += nr_avg_delta(big_sum, &snap->nr_big_prod_sum);
+		tmp_iowait += nr_avg_delta(iowait_sum, &snap->iowait_prod_sum);
 	}
 
 	diff = curr_time - last_get_time;
@@ -103,14 +131,15 @@ EXPORT_SYMBOL(sched_get_nr_running_avg);
 
 #ifdef CONFIG_SCHED_HMP
 static inline void update_last_busy_time(int cpu, bool dequeue,
-				unsigned long prev_nr_run, u64 curr_time)
+				unsigned long prev_nr_run, unsigned long nr_run,
+				u64 curr_time)
 {
 	bool nr_run_trigger = false, load_trigger = false;
 
 	if (!hmp_capable() || is_min_capacity_cpu(cpu))
 		return;
 
-	if (prev_nr_run >= BUSY_NR_RUN && per_cpu(nr, cpu) < BUSY_NR_RUN)
+	if (prev_nr_run >= BUSY_NR_RUN && nr_run < BUSY_NR_RUN)
 		nr_run_trigger = true;
 
 	if (dequeue) {
@@ -128,7 +157,8 @@ static inline void update_last_busy_time(int cpu, bool dequeue,
 }
 #else
 static inline void update_last_busy_time(int cpu, bool dequeue,
-				unsigned long prev_nr_run, u64 curr_time)
+				unsigned long prev_nr_run, unsigned long nr_run,
+				u64 curr_time)
 {
 }
 #endif
@@ -140,30 +170,32 @@ static inline void update_last_busy_time(int cpu, bool dequeue,
  * @inc: Whether we are increasing or decreasing the count
  * @return: N/A
  *
- * Update average with latest nr_running value for CPU
+ * Update average with latest nr_running value for CPU.  Called with the
+ * cpu's rq->lock held, which serializes the seqcount writers.
  */
 void sched_update_nr_prod(int cpu, long delta, bool inc)
 {
+	struct nr_avg_stats *stats = &per_cpu(nr_avg_stats, cpu);
 	u64 diff;
 	u64 curr_time;
-	unsigned long flags, nr_running;
+	unsigned long nr_running;
 
-	spin_lock_irqsave(&per_cpu(nr_lock, cpu), flags);
-	nr_running = per_cpu(nr, cpu);
+	write_seqcount_begin(&stats->seq);
+	nr_running = stats->nr;
 	curr_time = sched_clock();
-	diff = curr_time - per_cpu(last_time, cpu);
+	diff = curr_time - stats->last_time;
 	BUG_ON((s64)diff < 0);
-	per_cpu(last_time, cpu) = curr_time;
-	per_cpu(nr, cpu) = nr_running + (inc ? delta : -delta);
+	stats->last_time = curr_time;
+	stats->nr = nr_running + (inc ? delta : -delta);
 
-	BUG_ON((s64)per_cpu(nr, cpu) < 0);
+	BUG_ON((s64)stats->nr < 0);
 
-	update_last_busy_time(cpu, !inc, nr_running, curr_time);
+	update_last_busy_time(cpu, !inc, nr_running, stats->nr, curr_time);
 
-	per_cpu(nr_prod_sum, cpu) += nr_running * diff;
-	per_cpu(nr_big_prod_sum, cpu) += nr_eligible_big_tasks(cpu) * diff;
-	per_cpu(iowait_prod_sum, cpu) += nr_iowait_cpu(cpu) * diff;
-	spin_unlock_irqrestore(&per_cpu(nr_lock, cpu), flags);
+	stats->nr_prod_sum += nr_running * diff;
+	stats->nr_big_prod_sum += nr_eligible_big_tasks(cpu) * diff;
+	stats->iowait_prod_sum += nr_iowait_cpu(cpu) * diff;
+	write_seqcount_end(&stats->seq);
 }
 EXPORT_SYMBOL(sched_update_nr_prod);
 
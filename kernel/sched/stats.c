@@ -137,9 +137,169 @@ static const struct file_operations proc_schedstat_operations = {
 	.release = seq_release,
 };
 
+static inline int sched_lat_bucket(unsigned long long delta)
+{
+	unsigned long units = delta >> 10;
+
+	if (!units)
+		return 0;
+	return min_t(int, fls_long(units), SCHED_LAT_BUCKETS - 1);
+}
+
+/*
+ * Called from sched_info_arrive() with the rq lock held, for every task
+ * that waited on a runqueue before getting the cpu.
+ */
+void sched_lat_account(struct rq *rq, struct task_struct *t,
+		       unsigned long long delta)
+{
+	int b = sched_lat_bucket(delta);
+
+	rq->lat_hist.count[b]++;
+	if (rt_task(t))
+		rq->rt_lat_hist.count[b]++;
+#ifdef CONFIG_CGROUP_SCHED
+	per_cpu_ptr(task_group(t)->lat_hist, cpu_of(rq))->count[b]++;
+#endif
+}
+
+/* upper bound of a bucket, in usecs */
+static unsigned long sched_lat_bucket_us(int b)
+{
+	return DIV_ROUND_UP((1UL << b) << 10, 1000);
+}
+
+static int sched_lat_percentile(const struct sched_lat_hist *h, u64 total,
+				unsigned int pct)
+{
+	u64 want = div64_u64(total * pct + 99, 100), seen = 0;
+	int b;
+
+	for (b = 0; b < SCHED_LAT_BUCKETS - 1; b++) {
+		seen += h->count[b];
+		if (seen >= want)
+			break;
+	}
+	return b;
+}
+
+static void sched_lat_hist_print(struct seq_file *m, const char *name,
+				 const struct sched_lat_hist *h)
+{
+	u64 total = 0;
+	int b;
+
+	seq_printf(m, "%s", name);
+	for (b = 0; b < SCHED_LAT_BUCKETS; b++) {
+		seq_printf(m, " %u", h->count[b]);
+		total += h->count[b];
+	}
+
+	if (!total) {
+		seq_puts(m, " p50=- p90=- p99=-\n");
+		return;
+	}
+
+	/* last bucket is open ended, report its lower bound */
+	seq_printf(m, " p50<%lu p90<%lu p99<%lu\n",
+		   sched_lat_bucket_us(sched_lat_percentile(h, total, 50)),
+		   sched_lat_bucket_us(sched_lat_percentile(h, total, 90)),
+		   sched_lat_bucket_us(sched_lat_percentile(h, total, 99)));
+}
+
+#ifdef CONFIG_CGROUP_SCHED
+void sched_lat_hist_show_tg(struct seq_file *m, struct task_group *tg)
+{
+	struct sched_lat_hist sum = { };
+	struct sched_lat_hist *h;
+	int cpu, b;
+
+	for_each_possible_cpu(cpu) {
+		h = per_cpu_ptr(tg->lat_hist, cpu);
+		for (b = 0; b < SCHED_LAT_BUCKETS; b++)
+			sum.count[b] += h->count[b];
+	}
+	sched_lat_hist_print(m, "all", &sum);
+}
+#endif
+
+static int schedlat_show(struct seq_file *m, void *v)
+{
+	char name[16];
+	int cpu;
+
+	seq_puts(m, "version 1\n");
+	for_each_online_cpu(cpu) {
+		struct rq *rq = cpu_rq(cpu);
+
+		snprintf(name, sizeof(name), "cpu%d", cpu);
+		sched_lat_hist_print(m, name, &rq->lat_hist);
+		snprintf(name, sizeof(name), "cpu%d_rt", cpu);
+		sched_lat_hist_print(m, name, &rq->rt_lat_hist);
+	}
+	return 0;
+}
+
+static int schedlat_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, schedlat_show, NULL);
+}
+
+static const struct file_operations proc_schedlat_operations = {
+	.open    = schedlat_open,
+	.read    = seq_read,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
+static const char * const sched_ipi_names[SCHED_IPI_NR_REASONS] = {
+	[SCHED_IPI_WAKE_LIST]	= "wake_list",
+	[SCHED_IPI_RESCHED]	= "resched",
+	[SCHED_IPI_IDLE]	= "idle",
+	[SCHED_IPI_BOOST]	= "boost",
+	[SCHED_IPI_KICK]	= "kick",
+	[SCHED_IPI_COALESCED]	= "coalesced",
+	[SCHED_IPI_POLLING]	= "polling",
+	[SCHED_IPI_PENDING]	= "pending",
+};
+
+static int schedipi_show(struct seq_file *m, void *v)
+{
+	int cpu, i;
+
+	seq_puts(m, "version 1\ncpu");
+	for (i = 0; i < SCHED_IPI_NR_REASONS; i++)
+		seq_printf(m, " %s", sched_ipi_names[i]);
+	seq_putc(m, '\n');
+
+	for_each_online_cpu(cpu) {
+		struct rq *rq = cpu_rq(cpu);
+
+		seq_printf(m, "cpu%d", cpu);
+		for (i = 0; i < SCHED_IPI_NR_REASONS; i++)
+			seq_printf(m, " %u", rq->ipi_count[i]);
+		seq_putc(m, '\n');
+	}
+	return 0;
+}
+
+static int schedipi_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, schedipi_show, NULL);
+}
+
+static const struct file_operations proc_schedipi_operations = {
+	.open    = schedipi_open,
+	.read    = seq_read,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
 static int __init proc_schedstat_init(void)
 {
 	proc_create("schedstat", 0, NULL, &proc_schedstat_operations);
+	proc_create("schedlat", 0, NULL, &proc_schedlat_operations);
+	proc_create("schedipi", 0, NULL, &proc_schedipi_operations);
 	return 0;
 }
 subsys_initcall(proc_schedstat_init);
@@ -129,6 +129,11 @@ struct schedtune {
 	/* Hint to bias scheduling of tasks on that SchedTune CGroup
 	 * towards idle CPUs */
 	int prefer_idle;
+
+	/* Utilization floor and ceiling for tasks on that SchedTune CGroup,
+	 * in [0..SCHED_CAPACITY_SCALE] */
+	unsigned long util_min;
+	unsigned long util_max;
 };
 
 static inline struct schedtune *css_st(struct cgroup_subsys_state *css)
@@ -161,6 +166,8 @@ root_schedtune = {
 	.perf_boost_idx = 0,
 	.perf_constrain_idx = 0,
 	.prefer_idle = 0,
+	.util_min = 0,
+	.util_max = SCHED_CAPACITY_SCALE,
 };
 
 int
@@ -225,9 +232,20 @@ struct boost_groups {
 	/* Maximum boost value for all RUNNABLE tasks on a CPU */
 	bool idle;
 	int boost_max;
+	/*
+	 * Utilization clamps for the CPU: the highest floor and the highest
+	 * ceiling of the boost groups with RUNNABLE tasks on it, so that a
+	 * CPU running any top-app task gets its floor and is capped only
+	 * when all of its tasks are capped.
+	 */
+	unsigned long util_min;
+	unsigned long util_max;
 	struct {
 		/* The boost for tasks on that boost group */
 		int boost;
+		/* The utilization clamps for tasks on that boost group */
+		unsigned long util_min;
+		unsigned long util_max;
 		/* Count of RUNNABLE tasks on that boost group */
 		unsigned tasks;
 	} group[BOOSTGROUPS_COUNT];
@@ -242,6 +260,9 @@ static void
 schedtune_cpu_update(int cpu)
 {
 	struct boost_groups *bg;
+	unsigned long util_min = 0;
+	unsigned long util_max = 0;
+	bool active = false;
 	int boost_max;
 	int idx;
 
@@ -249,7 +270,7 @@ schedtune_cpu_update(int cpu)
 
 	/* The root boost group is always active */
 	boost_max = bg->group[0].boost;
-	for (idx = 1; idx < BOOSTGROUPS_COUNT; ++idx) {
+	for (idx = 0; idx < BOOSTGROUPS_COUNT; ++idx) {
 		/*
 		 * A boost group affects a CPU only if it has
 		 * RUNNABLE tasks on that CPU
@@ -258,12 +279,21 @@ schedtune_cpu_update(int cpu)
 			continue;
 
 		boost_max = max(boost_max, bg->group[idx].boost);
+		util_min = max(util_min, bg->group[idx].util_min);
+		util_max = max(util_max, bg->group[idx].util_max);
+		active = true;
 	}
 	/* Ensures boost_max is non-negative when all cgroup boost values
 	 * are neagtive. Avoids under-accounting of cpu capacity which may cause
 	 * task stacking and frequency spikes.*/
 	boost_max = max(boost_max, 0);
 	bg->boost_max = boost_max;
+
+	/* An idle CPU is not clamped */
+	if (!active)
+		util_max = SCHED_CAPACITY_SCALE;
+	bg->util_min = min(util_min, util_max);
+	bg->util_max = util_max;
 }
 
 static int
@@ -309,6 +339,26 @@ schedtune_boostgroup_update(int idx, int boost)
 	return 0;
 }
 
+static void
+schedtune_boostgroup_update_clamp(int idx, unsigned long util_min,
+				  unsigned long util_max)
+{
+	struct boost_groups *bg;
+	int cpu;
+
+	/* Update per CPU boost groups */
+	for_each_possible_cpu(cpu) {
+		bg = &per_cpu(cpu_boost_groups, cpu);
+
+		bg->group[idx].util_min = util_min;
+		bg->group[idx].util_max = util_max;
+
+		/* Only CPUs with tasks in this group can see a change */
+		if (bg->group[idx].tasks)
+			schedtune_cpu_update(cpu);
+	}
+}
+
 #define ENQUEUE_TASK  1
 #define DEQUEUE_TASK -1
 
@@ -521,6 +571,31 @@ int schedtune_cpu_boost(int cpu)
 	return bg->boost_max;
 }
 
+/*
+ * Clamp a CPU utilization (capacity request) into the floor and ceiling of
+ * the boost groups currently RUNNABLE on that CPU.
+ */
+unsigned long schedtune_cpu_util_clamp(int cpu, unsigned long util)
+{
+	struct boost_groups *bg;
+
+	bg = &per_cpu(cpu_boost_groups, cpu);
+	return clamp(util, bg->util_min, bg->util_max);
+}
+
+unsigned long schedtune_task_util_clamp(struct task_struct *p,
+					unsigned long util)
+{
+	struct schedtune *st;
+
+	rcu_read_lock();
+	st = task_schedtune(p);
+	util = clamp(util, st->util_min, st->util_max);
+	rcu_read_unlock();
+
+	return util;
+}
+
 int schedtune_task_boost(struct task_struct *p)
 {
 	struct schedtune *st;
@@ -567,6 +642,52 @@ prefer_idle_write(struct cgroup_subsys_state *css, struct cftype *cft,
 	return 0;
 }
 
+static u64
+util_min_read(struct cgroup_subsys_state *css, struct cftype *cft)
+{
+	struct schedtune *st = css_st(css);
+
+	return st->util_min;
+}
+
+static int
+util_min_write(struct cgroup_subsys_state *css, struct cftype *cft,
+	       u64 util_min)
+{
+	struct schedtune *st = css_st(css);
+
+	if (util_min > st->util_max)
+		return -EINVAL;
+
+	st->util_min = util_min;
+	schedtune_boostgroup_update_clamp(st->idx, st->util_min, st->util_max);
+
+	return 0;
+}
+
+static u64
+util_max_read(struct cgroup_subsys_state *css, struct cftype *cft)
+{
+	struct schedtune *st = css_st(css);
+
+	return st->util_max;
+}
+
+static int
+util_max_write(struct cgroup_subsys_state *css, struct cftype *cft,
+	       u64 util_max)
+{
+	struct schedtune *st = css_st(css);
+
+	if (util_max > SCHED_CAPACITY_SCALE || util_max < st->util_min)
+		return -EINVAL;
+
+	st->util_max = util_max;
+	schedtune_boostgroup_update_clamp(st->idx, st->util_min, st->util_max);
+
+	return 0;
+}
+
 static s64
 boost_read(struct cgroup_subsys_state *css, struct cftype *cft)
 {
@@ -627,6 +748,16 @@ static struct cftype files[] = {
 		.read_u64 = prefer_idle_read,
 		.write_u64 = prefer_idle_write,
 	},
+	{
+		.name = "util_min",
+		.read_u64 = util_min_read,
+		.write_u64 = util_min_write,
+	},
+	{
+		.name = "util_max",
+		.read_u64 = util_max_read,
+		.write_u64 = util_max_write,
+	},
 	{ }	/* terminate */
 };
 
@@ -643,6 +774,8 @@ schedtune_boostgroup_init(struct schedtune *st)
 	for_each_possible_cpu(cpu) {
 		bg = &per_cpu(cpu_boost_groups, cpu);
 		bg->group[st->idx].boost = 0;
+		bg->group[st->idx].util_min = st->util_min;
+		bg->group[st->idx].util_max = st->util_max;
 		bg->group[st->idx].tasks = 0;
 	}
 
@@ -680,6 +813,7 @@ schedtune_css_alloc(struct cgroup_subsys_state *parent_css)
 
 	/* Initialize per CPUs boost group support */
 	st->idx = idx;
+	st->util_max = SCHED_CAPACITY_SCALE;
 	if (schedtune_boostgroup_init(st))
 		goto release;
 
@@ -696,6 +830,7 @@ schedtune_boostgroup_release(struct schedtune *st)
 {
 	/* Reset this boost group */
 	schedtune_boostgroup_update(st->idx, 0);
+	schedtune_boostgroup_update_clamp(st->idx, 0, SCHED_CAPACITY_SCALE);
 
 	/* Keep track of allocated boost groups */
 	allocated_group[st->idx] = NULL;
@@ -729,6 +864,8 @@ schedtune_init_cgroups(void)
 	for_each_possible_cpu(cpu) {
 		bg = &per_cpu(cpu_boost_groups, cpu);
 		memset(bg, 0, sizeof(struct boost_groups));
+		bg->util_max = SCHED_CAPACITY_SCALE;
+		bg->group[0].util_max = SCHED_CAPACITY_SCALE;
 		raw_spin_lock_init(&bg->lock);
 	}
 
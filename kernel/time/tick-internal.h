@@ -169,4 +169,5 @@ int __clockevents_update_freq(struct clock_event_device *dev, u32 freq);
 #endif
 
 extern void do_timer(unsigned long ticks);
+extern unsigned long timer_get_coalesced(int cpu);
 extern void update_wall_time(void);
@@ -165,8 +165,10 @@ static void tick_sched_handle(struct tick_sched *ts, struct pt_regs *regs)
 	 */
 	if (ts->tick_stopped) {
 		touch_softlockup_watchdog();
-		if (is_idle_task(current))
+		if (is_idle_task(current)) {
 			ts->idle_jiffies++;
+			ts->idle_timer_wakeups++;
+		}
 	}
 #endif
 	update_process_times(user_mode(regs));
@@ -42,6 +42,7 @@
 #include <linux/sched/sysctl.h>
 #include <linux/slab.h>
 #include <linux/compat.h>
+#include <linux/moduleparam.h>
 
 #include <asm/uaccess.h>
 #include <asm/unistd.h>
@@ -897,6 +898,43 @@ int mod_timer_pending(struct timer_list *timer, unsigned long expires)
 }
 EXPORT_SYMBOL(mod_timer_pending);
 
+/*
+ * Deferrable timers, and default-slack timers at least four boundaries
+ * out, expire at the next multiple of this many ms in absolute jiffies.
+ * The boundaries are the same on all CPUs, so the housekeeping timers of
+ * different drivers wake idle CPUs together.  0 turns coalescing off.
+ */
+static unsigned int timer_coalesce_ms;
+core_param(timer_coalesce_ms, timer_coalesce_ms, uint, 0644);
+
+/* Timers whose expiry coalescing moved, reported in /proc/timer_list */
+static DEFINE_PER_CPU(unsigned long, timers_coalesced);
+
+unsigned long timer_get_coalesced(int cpu)
+{
+	return per_cpu(timers_coalesced, cpu);
+}
+
+static unsigned long
+coalesce_expires(struct timer_list *timer, unsigned long expires)
+{
+	unsigned long boundary, aligned;
+
+	boundary = msecs_to_jiffies(ACCESS_ONCE(timer_coalesce_ms));
+	if (boundary <= 1)
+		return expires;
+
+	if (!tbase_get_deferrable(timer->base) &&
+	    (long)(expires - jiffies) < 4 * (long)boundary)
+		return expires;
+
+	aligned = roundup(expires, boundary);
+	if (aligned != expires)
+		this_cpu_inc(timers_coalesced);
+
+	return aligned;
+}
+
 /*
  * Decide where to put the timer while taking the slack into account
  *
@@ -913,6 +951,9 @@ unsigned long apply_slack(struct timer_list *timer, unsigned long expires)
 	unsigned long expires_limit, mask;
 	int bit;
 
+	if (timer->slack < 0 && timer_coalesce_ms)
+		return coalesce_expires(timer, expires);
+
 	if (timer->slack >= 0) {
 		expires_limit = expires + timer->slack;
 	} else {
@@ -20,6 +20,8 @@
 
 #include <asm/uaccess.h>
 
+#include "tick-internal.h"
+
 
 struct timer_list_iter {
 	int cpu;
@@ -178,6 +180,7 @@ static void print_cpu(struct seq_file *m, int cpu, u64 now)
 		P(idle_jiffies);
 		P(idle_calls);
 		P(idle_sleeps);
+		P(idle_timer_wakeups);
 		P_ns(idle_entrytime);
 		P_ns(idle_waketime);
 		P_ns(idle_exittime);
@@ -190,6 +193,8 @@ static void print_cpu(struct seq_file *m, int cpu, u64 now)
 			   (unsigned long long)jiffies);
 	}
 #endif
+	SEQ_printf(m, "  .%-15s: %lu\n", "timers_coalesced",
+		   timer_get_coalesced(cpu));
 
 #undef P
 #undef P_ns
@@ -256,7 +261,7 @@ static void timer_list_show_tickdevices_header(struct seq_file *m)
 
 static inline void timer_list_header(struct seq_file *m, u64 now)
 {
-	SEQ_printf(m, "Timer List Version: v0.7\n");
+	SEQ_printf(m, "Timer List Version: v0.8\n");
 	SEQ_printf(m, "HRTIMER_MAX_CLOCK_BASES: %d\n", HRTIMER_MAX_CLOCK_BASES);
 	SEQ_printf(m, "now at %Ld nsecs\n", (unsigned long long)now);
 	SEQ_printf(m, "\n");
@@ -280,20 +280,25 @@ static void msg_drop(struct ipc_log_context *ilctxt)
 /*
  * Commits messages to the FIFO.  If the FIFO is full, then enough
  * messages are dropped to create space for the new message.
+ *
+ * Only the context lock is taken: the context list lock guards the list
+ * of contexts, not their contents, and as a global lock taken by every
+ * writer of every log it was the most contended line here.  The reader
+ * is only woken when it may be waiting, and outside the context lock.
  */
 void ipc_log_write(void *ctxt, struct encode_context *ectxt)
 {
 	struct ipc_log_context *ilctxt = (struct ipc_log_context *)ctxt;
 	int bytes_to_write;
 	unsigned long flags;
+	bool wake;
 
 	if (!ilctxt || !ectxt) {
 		pr_err("%s: Invalid ipc_log or encode context\n", __func__);
 		return;
 	}
 
-	read_lock_irqsave(&context_list_lock_lha1, flags);
-	spin_lock(&ilctxt->context_lock_lhb1);
+	spin_lock_irqsave(&ilctxt->context_lock_lhb1, flags);
 	while (ilctxt->write_avail <= ectxt->offset)
 		msg_drop(ilctxt);
 
@@ -322,9 +327,16 @@ void ipc_log_write(void *ctxt, struct encode_context *ectxt)
 	}
 	ilctxt->write_page->hdr.write_offset += bytes_to_write;
 	ilctxt->write_avail -= ectxt->offset;
-	complete(&ilctxt->read_avail);
-	spin_unlock(&ilctxt->context_lock_lhb1);
-	read_unlock_irqrestore(&context_list_lock_lha1, flags);
+	/*
+	 * ipc_log_extract() rearms read_avail under the context lock before
+	 * a reader sleeps on it; while it is still done the reader will
+	 * come back for this message without another complete().
+	 */
+	wake = !ACCESS_ONCE(ilctxt->read_avail.done);
+	spin_unlock_irqrestore(&ilctxt->context_lock_lhb1, flags);
+
+	if (wake)
+		complete(&ilctxt->read_avail);
 }
 EXPORT_SYMBOL(ipc_log_write);
 
@@ -545,27 +557,23 @@ int ipc_log_extract(void *ctxt, char *buff, int size)
 	dctxt.output_format = OUTPUT_DEBUGFS;
 	dctxt.buff = buff;
 	dctxt.size = size;
-	read_lock_irqsave(&context_list_lock_lha1, flags);
-	spin_lock(&ilctxt->context_lock_lhb1);
+	spin_lock_irqsave(&ilctxt->context_lock_lhb1, flags);
 	while (dctxt.size >= MAX_MSG_DECODED_SIZE &&
 	       !is_nd_read_empty(ilctxt)) {
 		msg_read(ilctxt, &ectxt);
 		deserialize_func = get_deserialization_func(ilctxt,
 							ectxt.hdr.type);
-		spin_unlock(&ilctxt->context_lock_lhb1);
-		read_unlock_irqrestore(&context_list_lock_lha1, flags);
+		spin_unlock_irqrestore(&ilctxt->context_lock_lhb1, flags);
 		if (deserialize_func)
 			deserialize_func(&ectxt, &dctxt);
 		else
 			pr_err("%s: unknown message 0x%x\n",
 				__func__, ectxt.hdr.type);
-		read_lock_irqsave(&context_list_lock_lha1, flags);
-		spin_lock(&ilctxt->context_lock_lhb1);
+		spin_lock_irqsave(&ilctxt->context_lock_lhb1, flags);
 	}
 	if ((size - dctxt.size) == 0)
 		reinit_completion(&ilctxt->read_avail);
-	spin_unlock(&ilctxt->context_lock_lhb1);
-	read_unlock_irqrestore(&context_list_lock_lha1, flags);
+	spin_unlock_irqrestore(&ilctxt->context_lock_lhb1, flags);
 	return size - dctxt.size;
 }
 EXPORT_SYMBOL(ipc_log_extract);
@@ -726,13 +734,11 @@ int add_deserialization_func(void *ctxt, int type,
 	if (!df_info)
 		return -ENOSPC;
 
-	read_lock_irqsave(&context_list_lock_lha1, flags);
-	spin_lock(&ilctxt->context_lock_lhb1);
+	spin_lock_irqsave(&ilctxt->context_lock_lhb1, flags);
 	df_info->type = type;
 	df_info->dfunc = dfunc;
 	list_add_tail(&df_info->list, &ilctxt->dfunc_info_list);
-	spin_unlock(&ilctxt->context_lock_lhb1);
-	read_unlock_irqrestore(&context_list_lock_lha1, flags);
+	spin_unlock_irqrestore(&ilctxt->context_lock_lhb1, flags);
 	return 0;
 }
 EXPORT_SYMBOL(add_deserialization_func);
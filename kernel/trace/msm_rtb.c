@@ -25,8 +25,11 @@
 #include <linux/of.h>
 #include <linux/of_address.h>
 #include <linux/io.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
 #include <asm-generic/sizes.h>
 #include <linux/msm_rtb.h>
+#include <asm/sections.h>
 #include <asm/timex.h>
 
 #include <linux/sec_debug.h>
@@ -59,7 +62,31 @@ struct msm_rtb_layout {
 	uint64_t cycle_count;
 } __attribute__ ((__packed__));
 
+/* Compact write, selected with msm_rtb.compact=1 on the command line
+ * 1) 1 byte sentinel (0xAA)
+ * 2) 1 byte of log type
+ * 3) 2 bytes of the low index bits
+ * 4) 4 bytes of where the caller came from, as an offset from _text
+ *    (raw low 32 bits for LOGTYPE_NOPC entries)
+ * 5) 8 bytes extra data from the caller
+ * 6) 8 bytes of timestamp
+ *
+ * Total = 24 bytes, so the same carve-out holds 5/3 as many entries.
+ */
+struct msm_rtb_compact_layout {
+	unsigned char sentinel;
+	unsigned char log_type;
+	uint16_t idx;
+	int32_t caller;
+	uint64_t data;
+	uint64_t timestamp;
+} __attribute__ ((__packed__));
 
+/*
+ * active_mask is filter with enabled and initialized folded in, so the
+ * readl/writel hooks test a single word.  The address and caller ranges
+ * are only looked at when range_filter is set.
+ */
 struct msm_rtb_state {
 	struct msm_rtb_layout *rtb;
 	phys_addr_t phys;
@@ -69,6 +96,14 @@ struct msm_rtb_state {
 	int initialized;
 	uint32_t filter;
 	int step_size;
+	uint32_t active_mask;
+	int compact;
+	int record_size;
+	bool range_filter;
+	unsigned long addr_start;
+	unsigned long addr_end;
+	unsigned long caller_start;
+	unsigned long caller_end;
 };
 
 #if defined(CONFIG_MSM_RTB_SEPARATE_CPUS)
@@ -86,19 +121,186 @@ static struct msm_rtb_state msm_rtb = {
 #endif
 };
 
-module_param_named(filter, msm_rtb.filter, uint, 0644);
-module_param_named(enable, msm_rtb.enabled, int, 0644);
+static DEFINE_MUTEX(msm_rtb_filter_lock);
+static char msm_rtb_filter_module[MODULE_NAME_LEN];
+
+static void msm_rtb_update_mask(void)
+{
+	msm_rtb.active_mask = (msm_rtb.initialized && msm_rtb.enabled) ?
+				msm_rtb.filter : 0;
+	msm_rtb.range_filter = msm_rtb.addr_end || msm_rtb.caller_end;
+}
+
+static int msm_rtb_set_filter(const char *val, const struct kernel_param *kp)
+{
+	int ret = param_set_uint(val, kp);
+
+	if (!ret)
+		msm_rtb_update_mask();
+	return ret;
+}
+
+static const struct kernel_param_ops msm_rtb_filter_ops = {
+	.set = msm_rtb_set_filter,
+	.get = param_get_uint,
+};
+module_param_cb(filter, &msm_rtb_filter_ops, &msm_rtb.filter, 0644);
+
+static int msm_rtb_set_enable(const char *val, const struct kernel_param *kp)
+{
+	int ret = param_set_int(val, kp);
+
+	if (!ret)
+		msm_rtb_update_mask();
+	return ret;
+}
+
+static const struct kernel_param_ops msm_rtb_enable_ops = {
+	.set = msm_rtb_set_enable,
+	.get = param_get_int,
+};
+module_param_cb(enable, &msm_rtb_enable_ops, &msm_rtb.enabled, 0644);
+
+/* The record format can't change under the dump tools' feet */
+module_param_named(compact, msm_rtb.compact, int, 0444);
+
+/*
+ * filter_addr=<start>-<end>: only log readl/writel of __iomem addresses in
+ * [start, end).  Empty or 0 logs every address again.
+ */
+static int msm_rtb_set_filter_addr(const char *val,
+				   const struct kernel_param *kp)
+{
+	unsigned long start = 0, end = 0;
+
+	if (*val && *val != '\n' && strcmp(val, "0") && strcmp(val, "0\n")) {
+		if (sscanf(val, "%lx-%lx", &start, &end) != 2 || start >= end)
+			return -EINVAL;
+	}
+
+	mutex_lock(&msm_rtb_filter_lock);
+	msm_rtb.addr_end = 0;
+	smp_wmb();
+	msm_rtb.addr_start = start;
+	smp_wmb();
+	msm_rtb.addr_end = end;
+	msm_rtb_update_mask();
+	mutex_unlock(&msm_rtb_filter_lock);
+	return 0;
+}
+
+static int msm_rtb_get_filter_addr(char *buf, const struct kernel_param *kp)
+{
+	return scnprintf(buf, PAGE_SIZE, "%lx-%lx", msm_rtb.addr_start,
+			 msm_rtb.addr_end);
+}
+
+static const struct kernel_param_ops msm_rtb_filter_addr_ops = {
+	.set = msm_rtb_set_filter_addr,
+	.get = msm_rtb_get_filter_addr,
+};
+module_param_cb(filter_addr, &msm_rtb_filter_addr_ops, NULL, 0644);
+
+static void msm_rtb_set_caller_range(unsigned long start, unsigned long end)
+{
+	msm_rtb.caller_end = 0;
+	smp_wmb();
+	msm_rtb.caller_start = start;
+	smp_wmb();
+	msm_rtb.caller_end = end;
+	msm_rtb_update_mask();
+}
+
+/*
+ * filter_module=<name>: only log events whose caller is in the text of
+ * module <name>, or of the kernel image for "vmlinux".  Empty logs every
+ * caller again.
+ */
+static int msm_rtb_set_filter_module(const char *val,
+				     const struct kernel_param *kp)
+{
+	char buf[MODULE_NAME_LEN], *name;
+	unsigned long start = 0, end = 0;
+	int ret = 0;
+
+	strlcpy(buf, val, sizeof(buf));
+	name = strim(buf);
+
+	mutex_lock(&msm_rtb_filter_lock);
+	if (!strcmp(name, "vmlinux")) {
+		start = (unsigned long)_stext;
+		end = (unsigned long)_etext;
+	} else if (*name) {
+#ifdef CONFIG_MODULES
+		struct module *mod;
+
+		mutex_lock(&module_mutex);
+		mod = find_module(name);
+		if (mod) {
+			start = (unsigned long)mod->module_core;
+			end = start + mod->core_text_size;
+		}
+		mutex_unlock(&module_mutex);
+#endif
+		if (!end)
+			ret = -ENOENT;
+	}
+
+	if (!ret) {
+		strlcpy(msm_rtb_filter_module, name,
+			sizeof(msm_rtb_filter_module));
+		msm_rtb_set_caller_range(start, end);
+	}
+	mutex_unlock(&msm_rtb_filter_lock);
+	return ret;
+}
+
+static int msm_rtb_get_filter_module(char *buf, const struct kernel_param *kp)
+{
+	return scnprintf(buf, PAGE_SIZE, "%s", msm_rtb_filter_module);
+}
+
+static const struct kernel_param_ops msm_rtb_filter_module_ops = {
+	.set = msm_rtb_set_filter_module,
+	.get = msm_rtb_get_filter_module,
+};
+module_param_cb(filter_module, &msm_rtb_filter_module_ops, NULL, 0644);
+
+#ifdef CONFIG_MODULES
+/* Don't keep filtering on a text range that is about to be reused */
+static int msm_rtb_module_notify(struct notifier_block *nb,
+				 unsigned long action, void *data)
+{
+	struct module *mod = data;
+
+	if (action != MODULE_STATE_GOING)
+		return NOTIFY_DONE;
+
+	mutex_lock(&msm_rtb_filter_lock);
+	if (msm_rtb.caller_end &&
+	    msm_rtb.caller_start == (unsigned long)mod->module_core) {
+		msm_rtb_filter_module[0] = '\0';
+		msm_rtb_set_caller_range(0, 0);
+	}
+	mutex_unlock(&msm_rtb_filter_lock);
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block msm_rtb_module_nb = {
+	.notifier_call = msm_rtb_module_notify,
+};
+#endif
 
 #ifdef CONFIG_SEC_DEBUG_SUMMARY
 #define __set_rtb_state_info(name, member)				\
 	apss->iolog.rtb_state.name.size = sizeof(msm_rtb.member);	\
 	apss->iolog.rtb_state.name.offset =				\
 			offsetof(struct msm_rtb_state, member)
-#define __set_rtb_entry_info(name, member)				\
+#define __set_rtb_entry_info(layout, name, member)			\
 	apss->iolog.rtb_entry.name.size =				\
-			sizeof(((struct msm_rtb_layout *)0)->member);	\
+			sizeof(((struct layout *)0)->member);		\
 	apss->iolog.rtb_entry.name.offset =				\
-			offsetof(struct msm_rtb_layout, member)
+			offsetof(struct layout, member)
 
 void sec_debug_summary_set_rtb_info(struct sec_debug_summary_data_apss *apss)
 {
@@ -111,12 +313,25 @@ void sec_debug_summary_set_rtb_info(struct sec_debug_summary_data_apss *apss)
 	__set_rtb_state_info(initialized, initialized);
 	__set_rtb_state_info(step_size, step_size);
 
-	apss->iolog.rtb_entry.struct_size = sizeof(struct msm_rtb_layout);
-	__set_rtb_entry_info(log_type, log_type);
-	__set_rtb_entry_info(idx, idx);
-	__set_rtb_entry_info(caller, caller);
-	__set_rtb_entry_info(data, data);
-	__set_rtb_entry_info(timestamp, timestamp);
+	if (msm_rtb.compact) {
+		apss->iolog.rtb_entry.struct_size =
+			sizeof(struct msm_rtb_compact_layout);
+		__set_rtb_entry_info(msm_rtb_compact_layout, log_type,
+				     log_type);
+		__set_rtb_entry_info(msm_rtb_compact_layout, idx, idx);
+		__set_rtb_entry_info(msm_rtb_compact_layout, caller, caller);
+		__set_rtb_entry_info(msm_rtb_compact_layout, data, data);
+		__set_rtb_entry_info(msm_rtb_compact_layout, timestamp,
+				     timestamp);
+	} else {
+		apss->iolog.rtb_entry.struct_size =
+			sizeof(struct msm_rtb_layout);
+		__set_rtb_entry_info(msm_rtb_layout, log_type, log_type);
+		__set_rtb_entry_info(msm_rtb_layout, idx, idx);
+		__set_rtb_entry_info(msm_rtb_layout, caller, caller);
+		__set_rtb_entry_info(msm_rtb_layout, data, data);
+		__set_rtb_entry_info(msm_rtb_layout, timestamp, timestamp);
+	}
 
 	apss->iolog.rtb_pcpu_idx_pa = virt_to_phys(&msm_rtb_idx_cpu);
 
@@ -127,6 +342,7 @@ static int msm_rtb_panic_notifier(struct notifier_block *this,
 					unsigned long event, void *ptr)
 {
 	msm_rtb.enabled = 0;
+	msm_rtb_update_mask();
 	return NOTIFY_DONE;
 }
 
@@ -137,11 +353,31 @@ static struct notifier_block msm_rtb_panic_blk = {
 
 int notrace msm_rtb_event_should_log(enum logk_event_type log_type)
 {
-	return msm_rtb.initialized && msm_rtb.enabled &&
-		((1 << (log_type & ~LOGTYPE_NOPC)) & msm_rtb.filter);
+	return (1 << (log_type & ~LOGTYPE_NOPC)) &
+		ACCESS_ONCE(msm_rtb.active_mask);
 }
 EXPORT_SYMBOL(msm_rtb_event_should_log);
 
+static bool notrace msm_rtb_range_match(enum logk_event_type log_type,
+					unsigned long caller,
+					unsigned long data)
+{
+	unsigned int type = log_type & ~LOGTYPE_NOPC;
+	unsigned long end;
+
+	end = ACCESS_ONCE(msm_rtb.caller_end);
+	if (end && !(log_type & LOGTYPE_NOPC) &&
+	    (caller < msm_rtb.caller_start || caller >= end))
+		return false;
+
+	end = ACCESS_ONCE(msm_rtb.addr_end);
+	if (end && (type == LOGK_READL || type == LOGK_WRITEL) &&
+	    (data < msm_rtb.addr_start || data >= end))
+		return false;
+
+	return true;
+}
+
 static void msm_rtb_emit_sentinel(struct msm_rtb_layout *start)
 {
 	start->sentinel[0] = SENTINEL_BYTE_1;
@@ -181,11 +417,36 @@ static void msm_rtb_write_cyclecount(struct msm_rtb_layout *start)
 	start->cycle_count = get_cycles();
 }
 
+static void uncached_logk_compact_idx(enum logk_event_type log_type,
+				      uint64_t caller, uint64_t data, int idx)
+{
+	struct msm_rtb_compact_layout *start;
+
+	start = (struct msm_rtb_compact_layout *)msm_rtb.rtb +
+		(idx & (msm_rtb.nentries - 1));
+
+	start->sentinel = SENTINEL_BYTE_2;
+	start->log_type = (char)log_type;
+	start->idx = (uint16_t)idx;
+	if (log_type & LOGTYPE_NOPC)
+		start->caller = (int32_t)caller;
+	else
+		start->caller = (int32_t)(caller - (unsigned long)_text);
+	start->data = data;
+	start->timestamp = sched_clock();
+	mb();
+}
+
 static void uncached_logk_pc_idx(enum logk_event_type log_type, uint64_t caller,
 				 uint64_t data, int idx)
 {
 	struct msm_rtb_layout *start;
 
+	if (msm_rtb.compact) {
+		uncached_logk_compact_idx(log_type, caller, data, idx);
+		return;
+	}
+
 	start = &msm_rtb.rtb[idx & (msm_rtb.nentries - 1)];
 
 	msm_rtb_emit_sentinel(start);
@@ -267,6 +528,11 @@ int notrace uncached_logk_pc(enum logk_event_type log_type, void *caller,
 	if (!msm_rtb_event_should_log(log_type))
 		return 0;
 
+	if (unlikely(msm_rtb.range_filter) &&
+	    !msm_rtb_range_match(log_type, (unsigned long)caller,
+				 (unsigned long)data))
+		return 0;
+
 	i = msm_rtb_get_idx();
 	uncached_logk_pc_idx(log_type, (uint64_t)((unsigned long) caller),
 				(uint64_t)((unsigned long) data), i);
@@ -328,7 +594,10 @@ static int msm_rtb_probe(struct platform_device *pdev)
 	if (!msm_rtb.rtb)
 		return -ENOMEM;
 
-	msm_rtb.nentries = msm_rtb.size / sizeof(struct msm_rtb_layout);
+	msm_rtb.record_size = msm_rtb.compact ?
+				sizeof(struct msm_rtb_compact_layout) :
+				sizeof(struct msm_rtb_layout);
+	msm_rtb.nentries = msm_rtb.size / msm_rtb.record_size;
 
 	/* Round this down to a power of 2 */
 	msm_rtb.nentries = __rounddown_pow_of_two(msm_rtb.nentries);
@@ -349,7 +618,11 @@ static int msm_rtb_probe(struct platform_device *pdev)
 
 	atomic_notifier_chain_register(&panic_notifier_list,
 						&msm_rtb_panic_blk);
+#ifdef CONFIG_MODULES
+	register_module_notifier(&msm_rtb_module_nb);
+#endif
 	msm_rtb.initialized = 1;
+	msm_rtb_update_mask();
 	return 0;
 }
 
@@ -14,3 +14,5 @@
 #include <trace/events/power.h>
 
 EXPORT_TRACEPOINT_SYMBOL_GPL(cpu_idle);
+EXPORT_TRACEPOINT_SYMBOL_GPL(cpu_boost_input_start);
+EXPORT_TRACEPOINT_SYMBOL_GPL(cpu_boost_input_end);
@@ -7,6 +7,7 @@
 #include <linux/ring_buffer.h>
 #include <linux/trace_clock.h>
 #include <linux/trace_seq.h>
+#include <linux/trace_mmap.h>
 #include <linux/spinlock.h>
 #include <linux/irq_work.h>
 #include <linux/debugfs.h>
@@ -25,6 +26,7 @@
 #include <linux/cpu.h>
 #include <linux/fs.h>
 
+#include <asm/cacheflush.h>
 #include <asm/local.h>
 
 static void update_pages_handler(struct work_struct *work);
@@ -358,6 +360,7 @@ struct buffer_page {
 	unsigned	 read;		/* index for next read */
 	local_t		 entries;	/* entries on this page */
 	unsigned long	 real_end;	/* real end of data */
+	unsigned	 id;		/* sub-buffer id when mapped */
 	struct buffer_data_page *page;	/* Actual data page */
 };
 
@@ -497,6 +500,11 @@ struct ring_buffer_per_cpu {
 	struct completion		update_done;
 
 	struct rb_irq_work		irq_work;
+
+	/* user space mappings, see ring_buffer_map() */
+	unsigned int			mapped;
+	struct trace_buffer_meta	*meta_page;
+	struct buffer_page		**subbuf_ids;
 };
 
 struct ring_buffer {
@@ -1725,6 +1733,12 @@ int ring_buffer_resize(struct ring_buffer *buffer, unsigned long size,
 	/* prevent another thread from changing buffer sizes */
 	mutex_lock(&buffer->mutex);
 
+	/* A mapping may have been set up since, see ring_buffer_map() */
+	if (atomic_read(&buffer->resize_disabled)) {
+		mutex_unlock(&buffer->mutex);
+		return -EBUSY;
+	}
+
 	if (cpu_id == RING_BUFFER_ALL_CPUS) {
 		/* calculate the pages to update */
 		for_each_buffer_cpu(buffer, cpu) {
@@ -4418,6 +4432,11 @@ int ring_buffer_swap_cpu(struct ring_buffer *buffer_a,
 	if (atomic_read(&cpu_buffer_b->record_disabled))
 		goto out;
 
+	/* A mapping must keep seeing the buffer it was set up for */
+	ret = -EBUSY;
+	if (cpu_buffer_a->mapped || cpu_buffer_b->mapped)
+		goto out;
+
 	/*
 	 * We can't do a synchronize_sched here because this
 	 * function can be called in atomic context.
@@ -4542,6 +4561,7 @@ int ring_buffer_read_page(struct ring_buffer *buffer,
 	unsigned int commit;
 	unsigned int read;
 	u64 save_timestamp;
+	bool swap;
 	int ret = -1;
 
 	if (!cpumask_test_cpu(cpu, buffer->cpumask))
@@ -4582,16 +4602,19 @@ int ring_buffer_read_page(struct ring_buffer *buffer,
 	 * if len is not big enough to read the rest of the page or
 	 * a writer is still on the page, then
 	 * we must copy the data from the page to the buffer.
-	 * Otherwise, we can simply swap the page with the one passed in.
+	 * Otherwise, we can simply swap the page with the one passed in,
+	 * unless the buffer is mapped: the mapped pages must stay put.
 	 */
-	if (read || (len < (commit - read)) ||
-	    cpu_buffer->reader_page == cpu_buffer->commit_page) {
+	swap = !read && len >= (commit - read) &&
+		cpu_buffer->reader_page != cpu_buffer->commit_page;
+
+	if (!swap || cpu_buffer->mapped) {
 		struct buffer_data_page *rpage = cpu_buffer->reader_page->page;
 		unsigned int rpos = read;
 		unsigned int pos = 0;
 		unsigned int size;
 
-		if (full)
+		if (full && !swap)
 			goto out_unlock;
 
 		if (len > (commit - read))
@@ -4694,6 +4717,253 @@ int ring_buffer_read_page(struct ring_buffer *buffer,
 }
 EXPORT_SYMBOL_GPL(ring_buffer_read_page);
 
+static void rb_update_meta_page(struct ring_buffer_per_cpu *cpu_buffer)
+{
+	struct trace_buffer_meta *meta = cpu_buffer->meta_page;
+
+	meta->writer.id = ACCESS_ONCE(cpu_buffer->commit_page)->id;
+	meta->entries = local_read(&cpu_buffer->entries);
+	meta->overrun = local_read(&cpu_buffer->overrun);
+	meta->read = cpu_buffer->read;
+
+	flush_dcache_page(virt_to_page(meta));
+}
+
+/**
+ * ring_buffer_map - set up a per cpu buffer for mapping into user space
+ * @buffer: the ring buffer
+ * @cpu: the cpu buffer to map
+ *
+ * Allocates the meta page and numbers the sub-buffers of @cpu, which
+ * ring_buffer_map_page() then hands out. Mappings are reference counted,
+ * each call must be paired with ring_buffer_unmap(). As long as a mapping
+ * exists the buffer can not be resized or swapped, and
+ * ring_buffer_read_page() copies data out instead of swapping pages, so
+ * that the mapped pages stay in place.
+ */
+int ring_buffer_map(struct ring_buffer *buffer, int cpu)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	struct trace_buffer_meta *meta;
+	struct buffer_page **ids;
+	struct buffer_page *bpage;
+	struct list_head *head, *p;
+	unsigned long flags;
+	unsigned int nr, id = 0;
+	int ret = 0;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	/* Also keeps the pages from being resized under us */
+	mutex_lock(&buffer->mutex);
+
+	if (cpu_buffer->mapped) {
+		cpu_buffer->mapped++;
+		goto out;
+	}
+
+	/* The reader page plus the pages of the ring */
+	nr = cpu_buffer->nr_pages + 1;
+
+	meta = (void *)get_zeroed_page(GFP_KERNEL);
+	ids = kcalloc(nr, sizeof(*ids), GFP_KERNEL);
+	if (!meta || !ids) {
+		free_page((unsigned long)meta);
+		kfree(ids);
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	meta->meta_page_size = PAGE_SIZE;
+	meta->meta_struct_len = sizeof(*meta);
+	meta->subbuf_size = PAGE_SIZE;
+	meta->nr_subbufs = nr;
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+
+	/*
+	 * Writers never add or remove pages, and the reader page is only
+	 * swapped under the reader_lock, so the set of pages is stable.
+	 */
+	bpage = cpu_buffer->reader_page;
+	bpage->id = id;
+	ids[id++] = bpage;
+
+	head = rb_list_head(cpu_buffer->pages);
+	p = head;
+	do {
+		bpage = list_entry(p, struct buffer_page, list);
+		if (RB_WARN_ON(cpu_buffer, id >= nr))
+			break;
+		bpage->id = id;
+		ids[id++] = bpage;
+		p = rb_list_head(p->next);
+	} while (p != head);
+
+	cpu_buffer->meta_page = meta;
+	cpu_buffer->subbuf_ids = ids;
+	cpu_buffer->mapped = 1;
+
+	meta->reader.id = cpu_buffer->reader_page->id;
+	meta->reader.read = cpu_buffer->reader_page->read;
+	meta->reader.commit = cpu_buffer->reader_page->read;
+	rb_update_meta_page(cpu_buffer);
+
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+	atomic_inc(&buffer->resize_disabled);
+ out:
+	mutex_unlock(&buffer->mutex);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(ring_buffer_map);
+
+/**
+ * ring_buffer_unmap - drop a mapping taken with ring_buffer_map()
+ * @buffer: the ring buffer
+ * @cpu: the mapped cpu buffer
+ *
+ * The pages handed out by ring_buffer_map_page() must no longer be mapped
+ * anywhere once the last mapping is dropped.
+ */
+void ring_buffer_unmap(struct ring_buffer *buffer, int cpu)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	struct trace_buffer_meta *meta;
+	struct buffer_page **ids;
+	unsigned long flags;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	mutex_lock(&buffer->mutex);
+
+	if (RB_WARN_ON(cpu_buffer, !cpu_buffer->mapped))
+		goto out;
+
+	if (cpu_buffer->mapped > 1) {
+		cpu_buffer->mapped--;
+		goto out;
+	}
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+	meta = cpu_buffer->meta_page;
+	ids = cpu_buffer->subbuf_ids;
+	cpu_buffer->meta_page = NULL;
+	cpu_buffer->subbuf_ids = NULL;
+	cpu_buffer->mapped = 0;
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+	atomic_dec(&buffer->resize_disabled);
+
+	free_page((unsigned long)meta);
+	kfree(ids);
+ out:
+	mutex_unlock(&buffer->mutex);
+}
+EXPORT_SYMBOL_GPL(ring_buffer_unmap);
+
+/**
+ * ring_buffer_map_page - get a page of a mapped cpu buffer
+ * @buffer: the ring buffer
+ * @cpu: the mapped cpu buffer
+ * @pgoff: page offset in the mapping
+ *
+ * Page 0 is the meta page, page 1 + id the sub-buffer @id. Must be called
+ * while holding a mapping. Returns NULL if @pgoff is out of range.
+ */
+struct page *ring_buffer_map_page(struct ring_buffer *buffer, int cpu,
+				  unsigned long pgoff)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return NULL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	if (RB_WARN_ON(cpu_buffer, !cpu_buffer->mapped))
+		return NULL;
+
+	if (!pgoff)
+		return virt_to_page(cpu_buffer->meta_page);
+
+	if (pgoff > cpu_buffer->meta_page->nr_subbufs)
+		return NULL;
+
+	return virt_to_page(cpu_buffer->subbuf_ids[pgoff - 1]->page);
+}
+EXPORT_SYMBOL_GPL(ring_buffer_map_page);
+
+/**
+ * ring_buffer_map_get_reader - hand the next events to a mapped reader
+ * @buffer: the ring buffer
+ * @cpu: the mapped cpu buffer
+ *
+ * Consumes the events left on the reader page, first swapping in the
+ * next page from the ring when the reader page was already consumed, and
+ * records in the meta page where those events are: reader.id is the
+ * sub-buffer holding them, reader.read and reader.commit the offsets of
+ * the first event and past the last one in its data.
+ *
+ * Returns 0 on success (including when there is nothing to read, in
+ * which case reader.read == reader.commit), or -ENODEV if @cpu is not
+ * mapped.
+ */
+int ring_buffer_map_get_reader(struct ring_buffer *buffer, int cpu)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	struct trace_buffer_meta *meta;
+	struct buffer_page *reader;
+	unsigned long flags;
+	unsigned int read;
+	int ret = 0;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+
+	if (!cpu_buffer->mapped) {
+		ret = -ENODEV;
+		goto out;
+	}
+
+	meta = cpu_buffer->meta_page;
+
+	reader = rb_get_reader_page(cpu_buffer);
+	if (!reader)
+		reader = cpu_buffer->reader_page;
+
+	read = reader->read;
+	/* rb_get_reader_page() will not swap while there is more to read */
+	while (reader->read < rb_page_size(reader))
+		rb_advance_reader(cpu_buffer);
+
+	flush_dcache_page(virt_to_page(reader->page));
+
+	meta->reader.id = reader->id;
+	meta->reader.read = read;
+	meta->reader.commit = reader->read;
+	meta->reader.lost_events = cpu_buffer->lost_events;
+	cpu_buffer->lost_events = 0;
+
+	rb_update_meta_page(cpu_buffer);
+ out:
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(ring_buffer_map_get_reader);
+
 #ifdef CONFIG_HOTPLUG_CPU
 static int rb_cpu_notify(struct notifier_block *self,
 			 unsigned long action, void *hcpu)
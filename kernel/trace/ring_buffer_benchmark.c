@@ -4,6 +4,7 @@
  * Copyright (C) 2009 Steven Rostedt <srostedt@redhat.com>
  */
 #include <linux/ring_buffer.h>
+#include <linux/trace_mmap.h>
 #include <linux/completion.h>
 #include <linux/kthread.h>
 #include <linux/module.h>
@@ -31,6 +32,8 @@ static struct ring_buffer *buffer;
 static struct task_struct *producer;
 static struct task_struct *consumer;
 static unsigned long read;
+/* cpu buffers set up for the mapped reader */
+static struct cpumask mapped_cpus;
 
 static int disable_reader;
 module_param(disable_reader, uint, 0644);
@@ -58,7 +61,20 @@ MODULE_PARM_DESC(producer_fifo, "fifo prio for producer");
 module_param(consumer_fifo, uint, 0644);
 MODULE_PARM_DESC(consumer_fifo, "fifo prio for consumer");
 
-static int read_events;
+enum read_mode {
+	READ_EVENTS,
+	READ_PAGES,
+	READ_MAPPED,
+	READ_MODES,
+};
+
+static const char * const read_mode_names[READ_MODES] = {
+	[READ_EVENTS]	= "events",
+	[READ_PAGES]	= "pages",
+	[READ_MAPPED]	= "mapped pages",
+};
+
+static int read_mode = READ_MODES - 1;
 
 static int kill_test;
 
@@ -95,75 +111,83 @@ static enum event_status read_event(int cpu)
 	return EVENT_FOUND;
 }
 
-static enum event_status read_page(int cpu)
+/* Check the events between @start and @commit in the data of @rpage */
+static void read_page_data(int cpu, struct rb_page *rpage,
+			   unsigned long start, unsigned long commit)
 {
 	struct ring_buffer_event *event;
-	struct rb_page *rpage;
-	unsigned long commit;
-	void *bpage;
 	int *entry;
-	int ret;
 	int inc;
 	int i;
 
-	bpage = ring_buffer_alloc_read_page(buffer, cpu);
-	if (!bpage)
-		return EVENT_DROPPED;
+	for (i = start; i < commit && !kill_test; i += inc) {
 
-	ret = ring_buffer_read_page(buffer, &bpage, PAGE_SIZE, cpu, 1);
-	if (ret >= 0) {
-		rpage = bpage;
-		/* The commit may have missed event flags set, clear them */
-		commit = local_read(&rpage->commit) & 0xfffff;
-		for (i = 0; i < commit && !kill_test; i += inc) {
+		if (i >= (PAGE_SIZE - offsetof(struct rb_page, data))) {
+			KILL_TEST();
+			break;
+		}
 
-			if (i >= (PAGE_SIZE - offsetof(struct rb_page, data))) {
+		inc = -1;
+		event = (void *)&rpage->data[i];
+		switch (event->type_len) {
+		case RINGBUF_TYPE_PADDING:
+			/* failed writes may be discarded events */
+			if (!event->time_delta)
+				KILL_TEST();
+			inc = event->array[0] + 4;
+			break;
+		case RINGBUF_TYPE_TIME_EXTEND:
+			inc = 8;
+			break;
+		case 0:
+			entry = ring_buffer_event_data(event);
+			if (*entry != cpu) {
 				KILL_TEST();
 				break;
 			}
-
-			inc = -1;
-			event = (void *)&rpage->data[i];
-			switch (event->type_len) {
-			case RINGBUF_TYPE_PADDING:
-				/* failed writes may be discarded events */
-				if (!event->time_delta)
-					KILL_TEST();
-				inc = event->array[0] + 4;
-				break;
-			case RINGBUF_TYPE_TIME_EXTEND:
-				inc = 8;
-				break;
-			case 0:
-				entry = ring_buffer_event_data(event);
-				if (*entry != cpu) {
-					KILL_TEST();
-					break;
-				}
-				read++;
-				if (!event->array[0]) {
-					KILL_TEST();
-					break;
-				}
-				inc = event->array[0] + 4;
+			read++;
+			if (!event->array[0]) {
+				KILL_TEST();
 				break;
-			default:
-				entry = ring_buffer_event_data(event);
-				if (*entry != cpu) {
-					KILL_TEST();
-					break;
-				}
-				read++;
-				inc = ((event->type_len + 1) * 4);
 			}
-			if (kill_test)
-				break;
-
-			if (inc <= 0) {
+			inc = event->array[0] + 4;
+			break;
+		default:
+			entry = ring_buffer_event_data(event);
+			if (*entry != cpu) {
 				KILL_TEST();
 				break;
 			}
+			read++;
+			inc = ((event->type_len + 1) * 4);
 		}
+		if (kill_test)
+			break;
+
+		if (inc <= 0) {
+			KILL_TEST();
+			break;
+		}
+	}
+}
+
+static enum event_status read_page(int cpu)
+{
+	struct rb_page *rpage;
+	unsigned long commit;
+	void *bpage;
+	int ret;
+
+	bpage = ring_buffer_alloc_read_page(buffer, cpu);
+	if (!bpage)
+		return EVENT_DROPPED;
+
+	ret = ring_buffer_read_page(buffer, &bpage, PAGE_SIZE, cpu, 1);
+	if (ret >= 0) {
+		rpage = bpage;
+		/* The commit may have missed event flags set, clear them */
+		commit = local_read(&rpage->commit) & 0xfffff;
+		read_page_data(cpu, rpage, 0, commit);
 	}
 	ring_buffer_free_read_page(buffer, bpage);
 
@@ -172,10 +196,44 @@ static enum event_status read_page(int cpu)
 	return EVENT_FOUND;
 }
 
+/*
+ * Read through the same interface as a consumer mapping trace_pipe_raw,
+ * with the ioctl replaced by a direct call.
+ */
+static enum event_status read_mapped(int cpu)
+{
+	struct trace_buffer_meta *meta;
+	struct rb_page *rpage;
+	struct page *page;
+
+	if (!cpumask_test_cpu(cpu, &mapped_cpus))
+		return EVENT_DROPPED;
+
+	if (ring_buffer_map_get_reader(buffer, cpu) < 0) {
+		KILL_TEST();
+		return EVENT_DROPPED;
+	}
+
+	meta = page_address(ring_buffer_map_page(buffer, cpu, 0));
+	if (meta->reader.read == meta->reader.commit)
+		return EVENT_DROPPED;
+
+	page = ring_buffer_map_page(buffer, cpu, meta->reader.id + 1);
+	if (!page) {
+		KILL_TEST();
+		return EVENT_DROPPED;
+	}
+
+	rpage = page_address(page);
+	read_page_data(cpu, rpage, meta->reader.read, meta->reader.commit);
+
+	return EVENT_FOUND;
+}
+
 static void ring_buffer_consumer(void)
 {
-	/* toggle between reading pages and events */
-	read_events ^= 1;
+	/* cycle between reading events, pages and mapped pages */
+	read_mode = (read_mode + 1) % READ_MODES;
 
 	read = 0;
 	while (!reader_finish && !kill_test) {
@@ -188,10 +246,16 @@ static void ring_buffer_consumer(void)
 			for_each_online_cpu(cpu) {
 				enum event_status stat;
 
-				if (read_events)
+				switch (read_mode) {
+				case READ_EVENTS:
 					stat = read_event(cpu);
-				else
+					break;
+				case READ_PAGES:
 					stat = read_page(cpu);
+					break;
+				default:
+					stat = read_mapped(cpu);
+				}
 
 				if (kill_test)
 					break;
@@ -316,7 +380,7 @@ static void ring_buffer_producer(void)
 		trace_printk("Read:     (reader disabled)\n");
 	else
 		trace_printk("Read:     %ld  (by %s)\n", read,
-			read_events ? "events" : "pages");
+			read_mode_names[read_mode]);
 	trace_printk("Entries:  %lld\n", entries);
 	trace_printk("Total:    %lld\n", entries + overruns + read);
 	trace_printk("Missed:   %ld\n", missed);
@@ -413,15 +477,31 @@ static int ring_buffer_producer_thread(void *arg)
 	return 0;
 }
 
+static void ring_buffer_benchmark_unmap(void)
+{
+	int cpu;
+
+	for_each_cpu(cpu, &mapped_cpus)
+		ring_buffer_unmap(buffer, cpu);
+	cpumask_clear(&mapped_cpus);
+}
+
 static int __init ring_buffer_benchmark_init(void)
 {
 	int ret;
+	int cpu;
 
 	/* make a one meg buffer in overwite mode */
 	buffer = ring_buffer_alloc(1000000, RB_FL_OVERWRITE);
 	if (!buffer)
 		return -ENOMEM;
 
+	/* cpus coming up later are only read by events and pages */
+	for_each_online_cpu(cpu) {
+		if (!ring_buffer_map(buffer, cpu))
+			cpumask_set_cpu(cpu, &mapped_cpus);
+	}
+
 	if (!disable_reader) {
 		consumer = kthread_create(ring_buffer_consumer_thread,
 					  NULL, "rb_consumer");
@@ -465,6 +545,7 @@ static int __init ring_buffer_benchmark_init(void)
 		kthread_stop(consumer);
 
  out_fail:
+	ring_buffer_benchmark_unmap();
 	ring_buffer_free(buffer);
 	return ret;
 }
@@ -474,6 +555,7 @@ static void __exit ring_buffer_benchmark_exit(void)
 	kthread_stop(producer);
 	if (consumer)
 		kthread_stop(consumer);
+	ring_buffer_benchmark_unmap();
 	ring_buffer_free(buffer);
 }
 
@@ -21,6 +21,7 @@
 #include <linux/irqflags.h>
 #include <linux/debugfs.h>
 #include <linux/tracefs.h>
+#include <linux/trace_mmap.h>
 #include <linux/pagemap.h>
 #include <linux/hardirq.h>
 #include <linux/linkage.h>
@@ -1030,6 +1031,12 @@ update_max_tr(struct trace_array *tr, struct task_struct *tsk, int cpu)
 
 	arch_spin_lock(&tr->max_lock);
 
+	/* The pages of a mapped buffer must stay where user space sees them */
+	if (tr->mapped) {
+		arch_spin_unlock(&tr->max_lock);
+		return;
+	}
+
 	/* Inherit the recordable setting from trace_buffer */
 	if (ring_buffer_record_is_set_on(tr->trace_buffer.buffer))
 		ring_buffer_record_on(tr->max_buffer.buffer);
@@ -1069,6 +1076,11 @@ update_max_tr_single(struct trace_array *tr, struct task_struct *tsk, int cpu)
 
 	arch_spin_lock(&tr->max_lock);
 
+	if (tr->mapped) {
+		arch_spin_unlock(&tr->max_lock);
+		return;
+	}
+
 	ret = ring_buffer_swap_cpu(tr->max_buffer.buffer, tr->trace_buffer.buffer, cpu);
 
 	if (ret == -EBUSY) {
@@ -5267,6 +5279,11 @@ tracing_snapshot_write(struct file *filp, const char __user *ubuf, size_t cnt,
 			break;
 		}
 #endif
+		/* update_max_tr() would not swap, see tracing_buffers_mmap() */
+		if (tr->mapped) {
+			ret = -EBUSY;
+			break;
+		}
 		if (!tr->allocated_snapshot) {
 			ret = alloc_snapshot(tr);
 			if (ret < 0)
@@ -5754,12 +5771,140 @@ out:
 	return ret;
 }
 
+/*
+ * While any of its cpu buffers is mapped, the buffers of the array are not
+ * swapped by snapshots or latency tracers: the mapping and the
+ * TRACE_MMAP_IOCTL_GET_READER of the file must keep using the same buffer.
+ * tr->mapped is updated under max_lock, which the swaps are done under.
+ */
+static struct ring_buffer *
+tracing_buffers_get_mapped(struct trace_iterator *iter)
+{
+	struct trace_array *tr = iter->tr;
+	struct ring_buffer *buffer;
+
+	local_irq_disable();
+	arch_spin_lock(&tr->max_lock);
+	tr->mapped++;
+	buffer = iter->trace_buffer->buffer;
+	arch_spin_unlock(&tr->max_lock);
+	local_irq_enable();
+
+	return buffer;
+}
+
+static void tracing_buffers_put_mapped(struct trace_iterator *iter)
+{
+	struct trace_array *tr = iter->tr;
+
+	local_irq_disable();
+	arch_spin_lock(&tr->max_lock);
+	WARN_ON_ONCE(!tr->mapped);
+	tr->mapped--;
+	arch_spin_unlock(&tr->max_lock);
+	local_irq_enable();
+}
+
+static void tracing_buffers_mmap_open(struct vm_area_struct *vma)
+{
+	struct ftrace_buffer_info *info = vma->vm_file->private_data;
+
+	tracing_buffers_get_mapped(&info->iter);
+	/* Only takes a reference, the buffer is mapped already */
+	WARN_ON(ring_buffer_map(vma->vm_private_data, info->iter.cpu_file));
+}
+
+static void tracing_buffers_mmap_close(struct vm_area_struct *vma)
+{
+	struct ftrace_buffer_info *info = vma->vm_file->private_data;
+
+	ring_buffer_unmap(vma->vm_private_data, info->iter.cpu_file);
+	tracing_buffers_put_mapped(&info->iter);
+}
+
+static const struct vm_operations_struct tracing_buffers_vmops = {
+	.open		= tracing_buffers_mmap_open,
+	.close		= tracing_buffers_mmap_close,
+};
+
+/*
+ * Map the meta page and the sub-buffers of a cpu buffer read-only, see
+ * include/uapi/linux/trace_mmap.h for the layout. Readers then only need
+ * TRACE_MMAP_IOCTL_GET_READER to move forward.
+ */
+static int tracing_buffers_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct ftrace_buffer_info *info = filp->private_data;
+	struct trace_iterator *iter = &info->iter;
+	struct ring_buffer *buffer;
+	int cpu = iter->cpu_file;
+	unsigned long pgoff;
+	struct page *page;
+	int ret;
+
+	if (cpu == RING_BUFFER_ALL_CPUS || vma->vm_pgoff)
+		return -EINVAL;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+	vma->vm_flags |= VM_DONTCOPY | VM_DONTEXPAND | VM_DONTDUMP;
+
+	buffer = tracing_buffers_get_mapped(iter);
+	ret = ring_buffer_map(buffer, cpu);
+	if (ret) {
+		tracing_buffers_put_mapped(iter);
+		return ret;
+	}
+
+	for (pgoff = 0; pgoff < vma_pages(vma); pgoff++) {
+		page = ring_buffer_map_page(buffer, cpu, pgoff);
+		if (!page) {
+			ret = -EINVAL;
+			break;
+		}
+
+		ret = vm_insert_page(vma, vma->vm_start + pgoff * PAGE_SIZE,
+				     page);
+		if (ret)
+			break;
+	}
+
+	if (ret) {
+		ring_buffer_unmap(buffer, cpu);
+		tracing_buffers_put_mapped(iter);
+		return ret;
+	}
+
+	vma->vm_private_data = buffer;
+	vma->vm_ops = &tracing_buffers_vmops;
+
+	return 0;
+}
+
+static long tracing_buffers_ioctl(struct file *filp, unsigned int cmd,
+				  unsigned long arg)
+{
+	struct ftrace_buffer_info *info = filp->private_data;
+	struct trace_iterator *iter = &info->iter;
+
+	if (cmd != TRACE_MMAP_IOCTL_GET_READER)
+		return -ENOTTY;
+
+	return ring_buffer_map_get_reader(iter->trace_buffer->buffer,
+					  iter->cpu_file);
+}
+
 static const struct file_operations tracing_buffers_fops = {
 	.open		= tracing_buffers_open,
 	.read		= tracing_buffers_read,
 	.poll		= tracing_buffers_poll,
 	.release	= tracing_buffers_release,
 	.splice_read	= tracing_buffers_splice_read,
+	.mmap		= tracing_buffers_mmap,
+	.unlocked_ioctl	= tracing_buffers_ioctl,
+	.compat_ioctl	= tracing_buffers_ioctl,
 	.llseek		= no_llseek,
 };
 
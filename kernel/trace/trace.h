@@ -206,6 +206,8 @@ struct trace_array {
 	 * CONFIG_TRACER_MAX_TRACE.
 	 */
 	arch_spinlock_t		max_lock;
+	/* mmapped cpu buffers, the buffers are not swapped while any is */
+	unsigned int		mapped;
 	int			buffer_disabled;
 #ifdef CONFIG_FTRACE_SYSCALLS
 	int			sys_refcount_enter;
@@ -986,11 +988,14 @@ struct ftrace_event_field {
 	int			is_signed;
 };
 
+struct prog_entry;
+
 struct event_filter {
 	int			n_preds;	/* Number assigned */
 	int			a_preds;	/* allocated */
 	struct filter_pred	*preds;
 	struct filter_pred	*root;
+	struct prog_entry	*prog;		/* what is run to match */
 	char			*filter_string;
 };
 
@@ -1024,6 +1029,7 @@ struct ftrace_subsystem_dir {
 #define MAX_FILTER_PRED		16384
 
 struct filter_pred;
+struct filter_pred_set;
 struct regex;
 
 typedef int (*filter_pred_fn_t) (struct filter_pred *pred, void *event);
@@ -1049,6 +1055,7 @@ struct filter_pred {
 	u64 			val;
 	struct regex		regex;
 	unsigned short		*ops;
+	struct filter_pred_set	*set;
 	struct ftrace_event_field *field;
 	int 			offset;
 	int 			not;
@@ -23,6 +23,8 @@
 #include <linux/mutex.h>
 #include <linux/perf_event.h>
 #include <linux/slab.h>
+#include <linux/hash.h>
+#include <linux/log2.h>
 
 #include "trace.h"
 #include "trace_output.h"
@@ -456,119 +458,55 @@ static int walk_pred_tree(struct filter_pred *preds,
 }
 
 /*
- * A series of AND or ORs where found together. Instead of
- * climbing up and down the tree branches, an array of the
- * ops were made in order of checks. We can just move across
- * the array and short circuit if needed.
+ * Filters are not matched by walking the tree but by running a flat
+ * program built from it, see filter_build_prog(): one entry per leaf, in
+ * the order the walk would evaluate them. An entry jumps to @target when
+ * its predicate returns @when_to_branch and moves on to the next entry
+ * otherwise. The program ends with two entries without a predicate, for
+ * no match and match, whose @target is the result.
  */
-static int process_ops(struct filter_pred *preds,
-		       struct filter_pred *op, void *rec)
-{
-	struct filter_pred *pred;
-	int match = 0;
-	int type;
-	int i;
-
-	/*
-	 * Micro-optimization: We set type to true if op
-	 * is an OR and false otherwise (AND). Then we
-	 * just need to test if the match is equal to
-	 * the type, and if it is, we can short circuit the
-	 * rest of the checks:
-	 *
-	 * if ((match && op->op == OP_OR) ||
-	 *     (!match && op->op == OP_AND))
-	 *	  return match;
-	 */
-	type = op->op == OP_OR;
-
-	for (i = 0; i < op->val; i++) {
-		pred = &preds[op->ops[i]];
-		if (!WARN_ON_ONCE(!pred->fn))
-			match = pred->fn(pred, rec);
-		if (!!match == type)
-			return match;
-	}
-	return match;
-}
-
-struct filter_match_preds_data {
-	struct filter_pred *preds;
-	int match;
-	void *rec;
+struct prog_entry {
+	int			target;
+	int			when_to_branch;
+	struct filter_pred	*pred;
 };
 
-static int filter_match_preds_cb(enum move_type move, struct filter_pred *pred,
-				 int *err, void *data)
+static int filter_run_prog(struct prog_entry *prog, void *rec)
 {
-	struct filter_match_preds_data *d = data;
-
-	*err = 0;
-	switch (move) {
-	case MOVE_DOWN:
-		/* only AND and OR have children */
-		if (pred->left != FILTER_PRED_INVALID) {
-			/* If ops is set, then it was folded. */
-			if (!pred->ops)
-				return WALK_PRED_DEFAULT;
-			/* We can treat folded ops as a leaf node */
-			d->match = process_ops(d->preds, pred, d->rec);
-		} else {
-			if (!WARN_ON_ONCE(!pred->fn))
-				d->match = pred->fn(pred, d->rec);
-		}
+	struct filter_pred *pred;
+	int i = 0;
 
-		return WALK_PRED_PARENT;
-	case MOVE_UP_FROM_LEFT:
-		/*
-		 * Check for short circuits.
-		 *
-		 * Optimization: !!match == (pred->op == OP_OR)
-		 *   is the same as:
-		 * if ((match && pred->op == OP_OR) ||
-		 *     (!match && pred->op == OP_AND))
-		 */
-		if (!!d->match == (pred->op == OP_OR))
-			return WALK_PRED_PARENT;
-		break;
-	case MOVE_UP_FROM_RIGHT:
-		break;
+	while ((pred = prog[i].pred)) {
+		if (!!pred->fn(pred, rec) == prog[i].when_to_branch)
+			i = prog[i].target;
+		else
+			i++;
 	}
 
-	return WALK_PRED_DEFAULT;
+	return prog[i].target;
 }
 
 /* return 1 if event matches, 0 otherwise (discard) */
 int filter_match_preds(struct event_filter *filter, void *rec)
 {
-	struct filter_pred *preds;
-	struct filter_pred *root;
-	struct filter_match_preds_data data = {
-		/* match is currently meaningless */
-		.match = -1,
-		.rec   = rec,
-	};
-	int n_preds, ret;
+	struct prog_entry *prog;
 
 	/* no filter is considered a match */
 	if (!filter)
 		return 1;
 
-	n_preds = filter->n_preds;
-	if (!n_preds)
+	if (!filter->n_preds)
 		return 1;
 
 	/*
-	 * n_preds, root and filter->preds are protect with preemption disabled.
+	 * The program and the preds it points to are protected with
+	 * preemption disabled.
 	 */
-	root = rcu_dereference_sched(filter->root);
-	if (!root)
+	prog = rcu_dereference_sched(filter->prog);
+	if (!prog)
 		return 1;
 
-	data.preds = preds = rcu_dereference_sched(filter->preds);
-	ret = walk_pred_tree(preds, root, filter_match_preds_cb, &data);
-	WARN_ON(ret);
-	return data.match;
+	return filter_run_prog(prog, rec);
 }
 EXPORT_SYMBOL_GPL(filter_match_preds);
 
@@ -767,9 +705,14 @@ static void __free_preds(struct event_filter *filter)
 {
 	int i;
 
+	kfree(filter->prog);
+	filter->prog = NULL;
+
 	if (filter->preds) {
-		for (i = 0; i < filter->n_preds; i++)
+		for (i = 0; i < filter->n_preds; i++) {
 			kfree(filter->preds[i].ops);
+			kfree(filter->preds[i].set);
+		}
 		kfree(filter->preds);
 		filter->preds = NULL;
 	}
@@ -1501,6 +1444,126 @@ static int fold_pred_cb(enum move_type move, struct filter_pred *pred,
 	return WALK_PRED_DEFAULT;
 }
 
+/*
+ * Folded ORs of == (or ANDs of !=) on a single field with at least that
+ * many leafs, such as pid lists, are matched with one hash lookup.
+ */
+#define FILTER_SET_MIN		8
+
+/**
+ * struct filter_pred_set - values of a set membership predicate
+ * @offset:	offset of the field in the event
+ * @size:	size of the field
+ * @not:	match when the value is not in the set (ANDs of !=)
+ * @has_zero:	0 is in the set; it marks the free slots of @vals
+ * @bits:	log2 of the number of slots in @vals
+ * @vals:	open addressed hash table of the values
+ */
+struct filter_pred_set {
+	int		offset;
+	int		size;
+	int		not;
+	bool		has_zero;
+	unsigned int	bits;
+	u64		vals[];
+};
+
+static bool filter_set_lookup(struct filter_pred_set *set, u64 val,
+			      bool insert)
+{
+	unsigned int mask = (1U << set->bits) - 1;
+	unsigned int i;
+
+	if (!val) {
+		if (insert)
+			set->has_zero = true;
+		return set->has_zero;
+	}
+
+	for (i = hash_64(val, set->bits); set->vals[i]; i = (i + 1) & mask)
+		if (set->vals[i] == val)
+			return true;
+
+	if (insert)
+		set->vals[i] = val;
+
+	return false;
+}
+
+static int filter_pred_set(struct filter_pred *pred, void *event)
+{
+	struct filter_pred_set *set = pred->set;
+	void *addr = event + set->offset;
+	u64 val;
+
+	switch (set->size) {
+	case 8:
+		val = *(u64 *)addr;
+		break;
+	case 4:
+		val = *(u32 *)addr;
+		break;
+	case 2:
+		val = *(u16 *)addr;
+		break;
+	default:
+		val = *(u8 *)addr;
+		break;
+	}
+
+	return filter_set_lookup(set, val, false) ^ set->not;
+}
+
+static int fold_pred_set(struct filter_pred *preds, struct filter_pred *root)
+{
+	struct filter_pred *first = &preds[root->ops[0]];
+	int op = root->op == OP_OR ? OP_EQ : OP_NE;
+	struct filter_pred_set *set;
+	struct filter_pred *pred;
+	unsigned int bits;
+	u64 val;
+	int i;
+
+	if (root->val < FILTER_SET_MIN)
+		return 0;
+
+	if (first->fn != filter_pred_64 && first->fn != filter_pred_32 &&
+	    first->fn != filter_pred_16 && first->fn != filter_pred_8)
+		return 0;
+
+	for (i = 0; i < root->val; i++) {
+		pred = &preds[root->ops[i]];
+		if (pred->op != op || pred->fn != first->fn ||
+		    pred->offset != first->offset)
+			return 0;
+	}
+
+	/* Keep the table at most half full */
+	bits = ilog2(roundup_pow_of_two(root->val)) + 1;
+
+	set = kzalloc(sizeof(*set) + (sizeof(u64) << bits), GFP_KERNEL);
+	if (!set)
+		return -ENOMEM;
+
+	set->offset = first->offset;
+	set->size = first->field->size;
+	set->not = op == OP_NE;
+	set->bits = bits;
+
+	for (i = 0; i < root->val; i++) {
+		val = preds[root->ops[i]].val;
+		/* The equality preds only compare the field size */
+		if (set->size < 8)
+			val &= (1ULL << (set->size * 8)) - 1;
+		filter_set_lookup(set, val, true);
+	}
+
+	root->set = set;
+	root->fn = filter_pred_set;
+
+	return 0;
+}
+
 static int fold_pred(struct filter_pred *preds, struct filter_pred *root)
 {
 	struct fold_pred_data data = {
@@ -1508,6 +1571,7 @@ static int fold_pred(struct filter_pred *preds, struct filter_pred *root)
 		.count = 0,
 	};
 	int children;
+	int ret;
 
 	/* No need to keep the fold flag */
 	root->index &= ~FILTER_PRED_FOLD;
@@ -1526,7 +1590,11 @@ static int fold_pred(struct filter_pred *preds, struct filter_pred *root)
 
 	root->val = children;
 	data.children = children;
-	return walk_pred_tree(preds, root, fold_pred_cb, &data);
+	ret = walk_pred_tree(preds, root, fold_pred_cb, &data);
+	if (ret)
+		return ret;
+
+	return fold_pred_set(preds, root);
 }
 
 static int fold_pred_tree_cb(enum move_type move, struct filter_pred *pred,
@@ -1559,6 +1627,155 @@ static int fold_pred_tree(struct event_filter *filter,
 			      filter->preds);
 }
 
+struct filter_prog_data {
+	struct filter_pred	*preds;
+	struct filter_pred	*root;
+	struct prog_entry	*prog;
+	int			*entry;
+	int			count;
+};
+
+/* A leaf, or a folded op evaluated in one go or as an array of leafs */
+static inline bool filter_prog_leaf(struct filter_pred *pred)
+{
+	return pred->left == FILTER_PRED_INVALID || pred->ops;
+}
+
+/* The entry evaluating the first leaf of @pred */
+static int filter_prog_first(struct filter_prog_data *d,
+			     struct filter_pred *pred)
+{
+	while (!filter_prog_leaf(pred))
+		pred = &d->preds[pred->left];
+
+	return d->entry[pred->index];
+}
+
+/* The entry to go to once @pred evaluated to @match */
+static int filter_prog_target(struct filter_prog_data *d,
+			      struct filter_pred *pred, int match)
+{
+	struct filter_pred *parent;
+
+	while (pred != d->root) {
+		parent = &d->preds[pred->parent & ~FILTER_PRED_IS_RIGHT];
+		/*
+		 * Unless it short circuits its parent, a left child leads
+		 * to the right one. Otherwise its result is the parent's.
+		 */
+		if (!(pred->parent & FILTER_PRED_IS_RIGHT) &&
+		    match != (parent->op == OP_OR))
+			return filter_prog_first(d, &d->preds[parent->right]);
+		pred = parent;
+	}
+
+	/* The final entries for no match and match */
+	return d->count + match;
+}
+
+static int filter_prog_number_cb(enum move_type move, struct filter_pred *pred,
+				 int *err, void *data)
+{
+	struct filter_prog_data *d = data;
+
+	if (move != MOVE_DOWN || !filter_prog_leaf(pred))
+		return WALK_PRED_DEFAULT;
+
+	d->entry[pred->index] = d->count;
+	d->count += pred->ops && !pred->set ? pred->val : 1;
+
+	return WALK_PRED_PARENT;
+}
+
+static int filter_prog_emit_cb(enum move_type move, struct filter_pred *pred,
+			       int *err, void *data)
+{
+	struct filter_prog_data *d = data;
+	struct prog_entry *entry;
+	struct filter_pred *leaf = pred;
+	int sc = pred->op == OP_OR;
+	int e, i, target;
+
+	if (move != MOVE_DOWN || !filter_prog_leaf(pred))
+		return WALK_PRED_DEFAULT;
+
+	e = d->entry[pred->index];
+
+	/* All but the last leaf of a folded op can only short circuit it */
+	if (pred->ops && !pred->set) {
+		for (i = 0; i < pred->val - 1; i++, e++) {
+			entry = &d->prog[e];
+			entry->pred = &d->preds[pred->ops[i]];
+			entry->when_to_branch = sc;
+			entry->target = filter_prog_target(d, pred, sc);
+		}
+		leaf = &d->preds[pred->ops[i]];
+	}
+
+	/*
+	 * The last one decides the result of @pred, and one of the two
+	 * results always leads to the next entry.
+	 */
+	entry = &d->prog[e];
+	entry->pred = leaf;
+	target = filter_prog_target(d, pred, 1);
+	if (target == e + 1) {
+		entry->when_to_branch = 0;
+		entry->target = filter_prog_target(d, pred, 0);
+	} else {
+		entry->when_to_branch = 1;
+		entry->target = target;
+	}
+
+	if (WARN_ON(entry->target <= e)) {
+		*err = -EINVAL;
+		return WALK_PRED_ABORT;
+	}
+
+	return WALK_PRED_PARENT;
+}
+
+/*
+ * Flatten the (folded) tree into the program run by filter_match_preds(),
+ * which then no longer has to climb up and down the tree branches.
+ */
+static int filter_build_prog(struct event_filter *filter,
+			     struct filter_pred *root)
+{
+	struct filter_prog_data d = {
+		.preds	= filter->preds,
+		.root	= root,
+	};
+	int err;
+
+	d.entry = kcalloc(filter->n_preds, sizeof(*d.entry), GFP_KERNEL);
+	if (!d.entry)
+		return -ENOMEM;
+
+	err = walk_pred_tree(filter->preds, root, filter_prog_number_cb, &d);
+	if (err)
+		goto out;
+
+	d.prog = kcalloc(d.count + 2, sizeof(*d.prog), GFP_KERNEL);
+	if (!d.prog) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	err = walk_pred_tree(filter->preds, root, filter_prog_emit_cb, &d);
+	if (err) {
+		kfree(d.prog);
+		goto out;
+	}
+
+	d.prog[d.count].target = 0;
+	d.prog[d.count + 1].target = 1;
+	filter->prog = d.prog;
+ out:
+	kfree(d.entry);
+	return err;
+}
+
 static int replace_preds(struct ftrace_event_call *call,
 			 struct event_filter *filter,
 			 struct filter_parse_state *ps,
@@ -1650,6 +1867,10 @@ static int replace_preds(struct ftrace_event_call *call,
 		if (err)
 			goto fail;
 
+		err = filter_build_prog(filter, root);
+		if (err)
+			goto fail;
+
 		/* We don't set root until we know it works */
 		barrier();
 		filter->root = root;
@@ -2323,6 +2544,18 @@ static struct test_filter_data_t {
 	DATA_REC(YES, 1, 1, 1, 1, 1, 1, 1, 1, "bdfh"),
 	DATA_REC(YES, 0, 1, 0, 1, 0, 1, 0, 1, ""),
 	DATA_REC(YES, 1, 0, 1, 0, 1, 0, 1, 0, "bdfh"),
+#undef FILTER
+#define FILTER "a == 1 || a == 2 || a == 3 || a == 4 || " \
+	       "a == 5 || a == 6 || a == 7 || a == 0"
+	DATA_REC(YES, 5, 0, 0, 0, 0, 0, 0, 0, ""),
+	DATA_REC(YES, 0, 1, 1, 1, 1, 1, 1, 1, ""),
+	DATA_REC(NO,  9, 1, 1, 1, 1, 1, 1, 1, ""),
+#undef FILTER
+#define FILTER "(a != 1 && a != 2 && a != 3 && a != 4 && " \
+	       "a != 5 && a != 6 && a != 7 && a != 8) || b == 1"
+	DATA_REC(NO,  3, 0, 0, 0, 0, 0, 0, 0, ""),
+	DATA_REC(YES, 9, 0, 0, 0, 0, 0, 0, 0, ""),
+	DATA_REC(YES, 8, 1, 0, 0, 0, 0, 0, 0, ""),
 };
 
 #undef DATA_REC
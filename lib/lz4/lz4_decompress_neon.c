@@ -0,0 +1,83 @@
+/*
+ * NEON accelerated LZ4 decoder loops for arm64
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * The decoder is the generic one from lz4_uncompress.h; only the
+ * literal and match copy loops move 16 bytes per step through a Q
+ * register instead of 8 through a general purpose one. The 8 byte
+ * tail keeps the exact overrun contract of LZ4_WILDCOPY, so all the
+ * bounds checks of the generic decoder remain valid.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/lz4.h>
+
+#include <asm/neon.h>
+#include <asm/unaligned.h>
+#include <arm_neon.h>
+
+#include "lz4defs.h"
+#include "lz4_neon.h"
+
+#define LZ4_NEON_COPY16(s, d)				\
+	do {						\
+		vst1q_u8((d), vld1q_u8((s)));		\
+		d += 16;				\
+		s += 16;				\
+	} while (0)
+
+/* literals never overlap the output */
+#define LZ4_NEON_WILDCOPY(s, d, e)			\
+	do {						\
+		while ((d) + 16 <= (e))			\
+			LZ4_NEON_COPY16(s, d);		\
+		LZ4_WILDCOPY(s, d, e);			\
+	} while (0)
+
+/* a match may only be copied 16 bytes at a time if it is that far back */
+#define LZ4_NEON_SECURECOPY(s, d, e)			\
+	do {						\
+		if ((d) - (s) >= 16) {			\
+			while ((d) + 16 <= (e))		\
+				LZ4_NEON_COPY16(s, d);	\
+		}					\
+		LZ4_SECURECOPY(s, d, e);		\
+	} while (0)
+
+#define LZ4_UNCOMPRESS(name)	__##name##_neon
+#define LZ4_LITCOPY		LZ4_NEON_WILDCOPY
+#define LZ4_MATCHCOPY		LZ4_NEON_SECURECOPY
+#include "lz4_uncompress.h"
+
+int lz4_uncompress_neon(const char *source, char *dest, int osize)
+{
+	int ret;
+
+	kernel_neon_begin();
+	ret = __lz4_uncompress_neon(source, dest, osize);
+	kernel_neon_end();
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(lz4_uncompress_neon);
+
+int lz4_uncompress_unknownoutputsize_neon(const char *source, char *dest,
+				int isize, size_t maxoutputsize)
+{
+	int ret;
+
+	kernel_neon_begin();
+	ret = __lz4_uncompress_unknownoutputsize_neon(source, dest, isize,
+				maxoutputsize);
+	kernel_neon_end();
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(lz4_uncompress_unknownoutputsize_neon);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("NEON accelerated LZ4 decoder loops");
@@ -0,0 +1,29 @@
+/*
+ * NEON accelerated LZ4 decoder loops
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef __LZ4_NEON_H__
+#define __LZ4_NEON_H__
+
+#include <asm/hwcap.h>
+
+/*
+ * Below this output size saving and restoring the FP/SIMD state costs
+ * more than the wider copies gain.
+ */
+#define LZ4_NEON_MIN_SIZE	1024
+
+static inline bool lz4_neon_usable(size_t len)
+{
+	return len >= LZ4_NEON_MIN_SIZE && (elf_hwcap & HWCAP_ASIMD);
+}
+
+int lz4_uncompress_neon(const char *source, char *dest, int osize);
+int lz4_uncompress_unknownoutputsize_neon(const char *source, char *dest,
+				int isize, size_t maxoutputsize);
+
+#endif /* __LZ4_NEON_H__ */
@@ -31,6 +31,7 @@
 #include <linux/ipc_router.h>
 #include <linux/ipc_router_xprt.h>
 #include <linux/kref.h>
+#include <linux/rculist.h>
 #include <soc/qcom/subsystem_notif.h>
 #include <soc/qcom/subsystem_restart.h>
 
@@ -71,7 +72,14 @@ if (msm_ipc_router_debug_mask & RTR_DBG) \
 static LIST_HEAD(control_ports);
 static DECLARE_RWSEM(control_ports_lock_lha5);
 
-#define LP_HASH_SIZE 32
+/* Local ports, remote ports and routing table entries are looked up once per
+ * packet. Their hash lists are modified under the respective rwsems and read
+ * under RCU on the data path, so the lists must only be changed through the
+ * _rcu list helpers and their entries must be freed after a grace period.
+ * Port IDs are allocated sequentially, so masking in the low bits spreads
+ * them evenly across the buckets.
+ */
+#define LP_HASH_SIZE 128
 static struct list_head local_ports[LP_HASH_SIZE];
 static DECLARE_RWSEM(local_ports_lock_lhc2);
 
@@ -118,9 +126,10 @@ enum {
 	VALID = 1,
 };
 
-#define RP_HASH_SIZE 32
+#define RP_HASH_SIZE 64
 struct msm_ipc_router_remote_port {
 	struct list_head list;
+	struct rcu_head rcu;
 	struct kref ref;
 	struct mutex rport_lock_lhb2;
 	uint32_t node_id;
@@ -155,6 +164,7 @@ struct msm_ipc_router_xprt_info {
 #define RT_HASH_SIZE 4
 struct msm_ipc_routing_table_entry {
 	struct list_head list;
+	struct rcu_head rcu;
 	struct kref ref;
 	uint32_t node_id;
 	uint32_t neighbor_node_id;
@@ -431,14 +441,14 @@ static void ipc_router_log_msg(void *log_ctx, uint32_t xchng_type,
 	}
 }
 
-/* Must be called with routing_table_lock_lha3 locked. */
+/* Must be called with routing_table_lock_lha3 locked or under rcu_read_lock */
 static struct msm_ipc_routing_table_entry *lookup_routing_table(
 	uint32_t node_id)
 {
 	uint32_t key = (node_id % RT_HASH_SIZE);
 	struct msm_ipc_routing_table_entry *rt_entry;
 
-	list_for_each_entry(rt_entry, &routing_table[key], list) {
+	list_for_each_entry_rcu(rt_entry, &routing_table[key], list) {
 		if (rt_entry->node_id == node_id)
 			return rt_entry;
 	}
@@ -482,7 +492,7 @@ static struct msm_ipc_routing_table_entry *create_routing_table_entry(
 		rt_entry->neighbor_node_id = xprt_info->remote_node_id;
 
 	key = (node_id % RT_HASH_SIZE);
-	list_add_tail(&rt_entry->list, &routing_table[key]);
+	list_add_tail_rcu(&rt_entry->list, &routing_table[key]);
 out_create_rtentry1:
 	kref_get(&rt_entry->ref);
 out_create_rtentry2:
@@ -504,11 +514,11 @@ static struct msm_ipc_routing_table_entry *ipc_router_get_rtentry_ref(
 {
 	struct msm_ipc_routing_table_entry *rt_entry;
 
-	down_read(&routing_table_lock_lha3);
+	rcu_read_lock();
 	rt_entry = lookup_routing_table(node_id);
-	if (rt_entry)
-		kref_get(&rt_entry->ref);
-	up_read(&routing_table_lock_lha3);
+	if (rt_entry && !kref_get_unless_zero(&rt_entry->ref))
+		rt_entry = NULL;
+	rcu_read_unlock();
 	return rt_entry;
 }
 
@@ -529,7 +539,7 @@ void ipc_router_release_rtentry(struct kref *ref)
 	 * As part of SSR, all the internals of the routing table entry
 	 * are cleaned. So just free the routing table entry.
 	 */
-	kfree(rt_entry);
+	kfree_rcu(rt_entry, rcu);
 }
 
 struct rr_packet *rr_read(struct msm_ipc_router_xprt_info *xprt_info)
@@ -616,6 +626,35 @@ fail_clone:
 	return NULL;
 }
 
+/**
+ * move_pkt() - Move the contents of a packet into a new Router packet
+ * @pkt: Packet whose fragments and optional header are taken over.
+ *
+ * @return: pointer to the new packet on success, NULL on failure.
+ *
+ * Unlike clone_pkt(), the fragments of @pkt are handed over instead of
+ * being cloned, so no skb is allocated per fragment. @pkt is left empty and
+ * must still be released by its owner.
+ */
+static struct rr_packet *move_pkt(struct rr_packet *pkt)
+{
+	struct rr_packet *moved_pkt;
+
+	moved_pkt = create_pkt(NULL);
+	if (!moved_pkt)
+		return NULL;
+
+	memcpy(&(moved_pkt->hdr), &(pkt->hdr), sizeof(struct rr_header_v1));
+	moved_pkt->opt_hdr = pkt->opt_hdr;
+	pkt->opt_hdr.data = NULL;
+	pkt->opt_hdr.len = 0;
+	skb_queue_splice_tail_init(pkt->pkt_fragment_q,
+				   moved_pkt->pkt_fragment_q);
+	moved_pkt->length = pkt->length;
+	pkt->length = 0;
+	return moved_pkt;
+}
+
 /**
  * create_pkt() - Create a Router packet
  * @data: SKB queue to be contained inside the packet.
@@ -1298,7 +1337,7 @@ void msm_ipc_router_add_local_port(struct msm_ipc_port *port_ptr)
 
 	key = (port_ptr->this_port.port_id & (LP_HASH_SIZE - 1));
 	down_write(&local_ports_lock_lhc2);
-	list_add_tail(&port_ptr->list, &local_ports[key]);
+	list_add_tail_rcu(&port_ptr->list, &local_ports[key]);
 	up_write(&local_ports_lock_lhc2);
 }
 
@@ -1374,15 +1413,16 @@ static struct msm_ipc_port *ipc_router_get_port_ref(uint32_t port_id)
 	int key = (port_id & (LP_HASH_SIZE - 1));
 	struct msm_ipc_port *port_ptr;
 
-	down_read(&local_ports_lock_lhc2);
-	list_for_each_entry(port_ptr, &local_ports[key], list) {
+	rcu_read_lock();
+	list_for_each_entry_rcu(port_ptr, &local_ports[key], list) {
 		if (port_ptr->this_port.port_id == port_id) {
-			kref_get(&port_ptr->ref);
-			up_read(&local_ports_lock_lhc2);
+			if (!kref_get_unless_zero(&port_ptr->ref))
+				break;
+			rcu_read_unlock();
 			return port_ptr;
 		}
 	}
-	up_read(&local_ports_lock_lhc2);
+	rcu_read_unlock();
 	return NULL;
 }
 
@@ -1407,7 +1447,7 @@ void ipc_router_release_port(struct kref *ref)
 	wakeup_source_unregister(port_ptr->port_rx_ws);
 	if (port_ptr->endpoint)
 		sock_put(ipc_port_sk(port_ptr->endpoint));
-	kfree(port_ptr);
+	kfree_rcu(port_ptr, rcu);
 }
 
 /**
@@ -1424,24 +1464,25 @@ static struct msm_ipc_router_remote_port *ipc_router_get_rport_ref(
 	struct msm_ipc_routing_table_entry *rt_entry;
 	int key = (port_id & (RP_HASH_SIZE - 1));
 
-	rt_entry = ipc_router_get_rtentry_ref(node_id);
+	rcu_read_lock();
+	rt_entry = lookup_routing_table(node_id);
 	if (!rt_entry) {
+		rcu_read_unlock();
 		IPC_RTR_ERR("%s: Node is not up\n", __func__);
 		return NULL;
 	}
 
-	down_read(&rt_entry->lock_lha4);
-	list_for_each_entry(rport_ptr,
-			    &rt_entry->remote_port_list[key], list) {
+	list_for_each_entry_rcu(rport_ptr,
+				&rt_entry->remote_port_list[key], list) {
 		if (rport_ptr->port_id == port_id) {
-			kref_get(&rport_ptr->ref);
+			if (!kref_get_unless_zero(&rport_ptr->ref))
+				break;
 			goto out_lookup_rmt_port1;
 		}
 	}
 	rport_ptr = NULL;
 out_lookup_rmt_port1:
-	up_read(&rt_entry->lock_lha4);
-	kref_put(&rt_entry->ref, ipc_router_release_rtentry);
+	rcu_read_unlock();
 	return rport_ptr;
 }
 
@@ -1490,8 +1531,8 @@ static struct msm_ipc_router_remote_port *ipc_router_create_rport(
 	mutex_init(&rport_ptr->rport_lock_lhb2);
 	INIT_LIST_HEAD(&rport_ptr->resume_tx_port_list);
 	INIT_LIST_HEAD(&rport_ptr->conn_info_list);
-	list_add_tail(&rport_ptr->list,
-		      &rt_entry->remote_port_list[key]);
+	list_add_tail_rcu(&rport_ptr->list,
+			  &rt_entry->remote_port_list[key]);
 out_create_rmt_port1:
 	kref_get(&rport_ptr->ref);
 out_create_rmt_port2:
@@ -1648,7 +1689,7 @@ static void ipc_router_release_rport(struct kref *ref)
 	mutex_lock(&rport_ptr->rport_lock_lhb2);
 	msm_ipc_router_free_resume_tx_port(rport_ptr);
 	mutex_unlock(&rport_ptr->rport_lock_lhb2);
-	kfree(rport_ptr);
+	kfree_rcu(rport_ptr, rcu);
 }
 
 /**
@@ -1671,7 +1712,7 @@ static void ipc_router_destroy_rport(
 		return;
 	}
 	down_write(&rt_entry->lock_lha4);
-	list_del(&rport_ptr->list);
+	list_del_rcu(&rport_ptr->list);
 	up_write(&rt_entry->lock_lha4);
 	signal_rport_exit(rport_ptr);
 	kref_put(&rport_ptr->ref, ipc_router_release_rport);
@@ -2223,7 +2264,7 @@ static void cleanup_rmt_ports(struct msm_ipc_router_xprt_info *xprt_info,
 	for (j = 0; j < RP_HASH_SIZE; j++) {
 		list_for_each_entry_safe(rport_ptr, tmp_rport_ptr,
 				&rt_entry->remote_port_list[j], list) {
-			list_del(&rport_ptr->list);
+			list_del_rcu(&rport_ptr->list);
 			mutex_lock(&rport_ptr->rport_lock_lhb2);
 			server = rport_ptr->server;
 			rport_ptr->server = NULL;
@@ -2270,7 +2311,7 @@ static void msm_ipc_cleanup_routing_table(
 			cleanup_rmt_ports(xprt_info, rt_entry);
 			rt_entry->xprt_info = NULL;
 			up_write(&rt_entry->lock_lha4);
-			list_del(&rt_entry->list);
+			list_del_rcu(&rt_entry->list);
 			kref_put(&rt_entry->ref, ipc_router_release_rtentry);
 		}
 	}
@@ -3528,7 +3569,7 @@ int msm_ipc_router_close_port(struct msm_ipc_port *port_ptr)
 
 	if (port_ptr->type == SERVER_PORT || port_ptr->type == CLIENT_PORT) {
 		down_write(&local_ports_lock_lhc2);
-		list_del(&port_ptr->list);
+		list_del_rcu(&port_ptr->list);
 		up_write(&local_ports_lock_lhc2);
 
 		mutex_lock(&port_ptr->port_lock_lhc3);
@@ -3563,7 +3604,7 @@ int msm_ipc_router_close_port(struct msm_ipc_port *port_ptr)
 		up_write(&control_ports_lock_lha5);
 	} else if (port_ptr->type == IRSC_PORT) {
 		down_write(&local_ports_lock_lhc2);
-		list_del(&port_ptr->list);
+		list_del_rcu(&port_ptr->list);
 		up_write(&local_ports_lock_lhc2);
 		signal_irsc_completion();
 	}
@@ -3618,8 +3659,10 @@ int msm_ipc_router_bind_control_port(struct msm_ipc_port *port_ptr)
 		return -EINVAL;
 
 	down_write(&local_ports_lock_lhc2);
-	list_del(&port_ptr->list);
+	list_del_rcu(&port_ptr->list);
 	up_write(&local_ports_lock_lhc2);
+	/* Let lock-free lookups finish with the node before reusing it */
+	synchronize_rcu();
 	port_ptr->type = CONTROL_PORT;
 	down_write(&control_ports_lock_lha5);
 	list_add_tail(&port_ptr->list, &control_ports);
@@ -4256,7 +4299,7 @@ void msm_ipc_router_xprt_notify(struct msm_ipc_router_xprt *xprt,
 		xprt_info = xprt->priv;
 	}
 
-	pkt = clone_pkt((struct rr_packet *)data);
+	pkt = move_pkt((struct rr_packet *)data);
 	if (!pkt)
 		return;
 
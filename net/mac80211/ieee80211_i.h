@@ -225,6 +225,12 @@ struct ieee80211_rx_data {
 
 	unsigned int flags;
 
+	/*
+	 * Frames for the local stack are queued here instead of being
+	 * delivered right away, see ieee80211_rx_list()
+	 */
+	struct sk_buff_head *list;
+
 	/*
 	 * Index into sequence numbers array, 0..16
 	 * since the last (16) is used for non-QoS,
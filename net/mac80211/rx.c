@@ -2036,8 +2036,10 @@ ieee80211_deliver_skb(struct ieee80211_rx_data *rx)
 			     !ether_addr_equal(ehdr->h_dest, sdata->vif.addr)))
 			ether_addr_copy(ehdr->h_dest, sdata->vif.addr);
 
-		if (!(rx->flags & IEEE80211_RX_REORDER_TIMER) &&
-		    rx->local->napi)
+		if (rx->list)
+			__skb_queue_tail(rx->list, skb);
+		else if (!(rx->flags & IEEE80211_RX_REORDER_TIMER) &&
+			 rx->local->napi)
 			napi_gro_receive(rx->local->napi, skb);
 		else
 			netif_receive_skb(skb);
@@ -3305,7 +3307,8 @@ static bool ieee80211_prepare_and_rx_handle(struct ieee80211_rx_data *rx,
  * be called with rcu_read_lock protection.
  */
 static void __ieee80211_rx_handle_packet(struct ieee80211_hw *hw,
-					 struct sk_buff *skb)
+					 struct sk_buff *skb,
+					 struct sk_buff_head *list)
 {
 	struct ieee80211_local *local = hw_to_local(hw);
 	struct ieee80211_sub_if_data *sdata;
@@ -3320,6 +3323,7 @@ static void __ieee80211_rx_handle_packet(struct ieee80211_hw *hw,
 	memset(&rx, 0, sizeof(rx));
 	rx.skb = skb;
 	rx.local = local;
+	rx.list = list;
 
 	if (ieee80211_is_data(fc) || ieee80211_is_mgmt(fc))
 		local->dot11ReceivedFragmentCount++;
@@ -3413,11 +3417,8 @@ static void __ieee80211_rx_handle_packet(struct ieee80211_hw *hw,
 	dev_kfree_skb(skb);
 }
 
-/*
- * This is the receive path handler. It is called by a low level driver when an
- * 802.11 MPDU is received from the hardware.
- */
-void ieee80211_rx(struct ieee80211_hw *hw, struct sk_buff *skb)
+static void __ieee80211_rx(struct ieee80211_hw *hw, struct sk_buff *skb,
+			   struct sk_buff_head *list)
 {
 	struct ieee80211_local *local = hw_to_local(hw);
 	struct ieee80211_rate *rate = NULL;
@@ -3516,7 +3517,7 @@ void ieee80211_rx(struct ieee80211_hw *hw, struct sk_buff *skb)
 	ieee80211_tpt_led_trig_rx(local,
 			((struct ieee80211_hdr *)skb->data)->frame_control,
 			skb->len);
-	__ieee80211_rx_handle_packet(hw, skb);
+	__ieee80211_rx_handle_packet(hw, skb, list);
 
 	rcu_read_unlock();
 
@@ -3524,8 +3525,57 @@ void ieee80211_rx(struct ieee80211_hw *hw, struct sk_buff *skb)
  drop:
 	kfree_skb(skb);
 }
+
+/*
+ * This is the receive path handler. It is called by a low level driver when an
+ * 802.11 MPDU is received from the hardware.
+ */
+void ieee80211_rx(struct ieee80211_hw *hw, struct sk_buff *skb)
+{
+	__ieee80211_rx(hw, skb, NULL);
+}
 EXPORT_SYMBOL(ieee80211_rx);
 
+/* Upper bound on the frames held back from the local stack in a batch */
+#define IEEE80211_RX_LIST_MAX	64
+
+static void ieee80211_rx_deliver_list(struct ieee80211_local *local,
+				      struct sk_buff_head *list)
+{
+	struct sk_buff *skb;
+
+	while ((skb = __skb_dequeue(list))) {
+		if (local->napi)
+			napi_gro_receive(local->napi, skb);
+		else
+			netif_receive_skb(skb);
+	}
+}
+
+void ieee80211_rx_list(struct ieee80211_hw *hw, struct sk_buff_head *frames)
+{
+	struct ieee80211_local *local = hw_to_local(hw);
+	struct sk_buff_head list;
+	struct sk_buff *skb;
+
+	WARN_ON_ONCE(softirq_count() == 0);
+
+	/*
+	 * Run the whole batch through the rx handlers and the reorder
+	 * buffer before the stack sees any of it: mac80211 stays cache
+	 * hot, delivery happens outside of rx_path_lock, and GRO gets
+	 * the frames of a flow back to back.
+	 */
+	__skb_queue_head_init(&list);
+	while ((skb = __skb_dequeue(frames))) {
+		__ieee80211_rx(hw, skb, &list);
+		if (skb_queue_len(&list) >= IEEE80211_RX_LIST_MAX)
+			ieee80211_rx_deliver_list(local, &list);
+	}
+	ieee80211_rx_deliver_list(local, &list);
+}
+EXPORT_SYMBOL(ieee80211_rx_list);
+
 /* This is a version of the rx handler that can be called from hard irq
  * context. Post the skb on the queue and schedule the tasklet */
 void ieee80211_rx_irqsafe(struct ieee80211_hw *hw, struct sk_buff *skb)
@@ -33,6 +33,7 @@
 #include <linux/mm.h>
 #include <linux/nsproxy.h>
 #include <linux/rculist_nulls.h>
+#include <linux/workqueue.h>
 
 #include <net/netfilter/nf_conntrack.h>
 #include <net/netfilter/nf_conntrack_l3proto.h>
@@ -70,6 +71,33 @@ EXPORT_SYMBOL_GPL(nf_conntrack_locks);
 __cacheline_aligned_in_smp DEFINE_SPINLOCK(nf_conntrack_expect_lock);
 EXPORT_SYMBOL_GPL(nf_conntrack_expect_lock);
 
+/*
+ * Per-cpu cache of the conntracks last found by TCP lookups, indexed by
+ * tuple hash.  Entries hold no reference: nf_conn is SLAB_DESTROY_BY_RCU,
+ * so a hit is validated under RCU just like an entry met in a hash chain,
+ * and destroy_conntrack() clears the entries still pointing at a conntrack
+ * before it goes back to the slab.
+ */
+#define NF_CT_PCPU_CACHE_SIZE	16
+
+struct nf_ct_pcpu_cache {
+	struct nf_conntrack_tuple_hash *h[NF_CT_PCPU_CACHE_SIZE];
+};
+
+static DEFINE_PER_CPU(struct nf_ct_pcpu_cache, nf_ct_pcpu_cache);
+
+/*
+ * The init_net table is grown in the background once its chains average
+ * more than NF_CT_HASH_GROW_LOAD entries, up to one bucket per conntrack.
+ */
+#define NF_CT_HASH_GROW_LOAD	2
+#define NF_CT_HASH_GROW_MAX	(1U << 18)
+
+static bool nf_conntrack_hash_autogrow __read_mostly = true;
+
+static void nf_conntrack_hash_grow(struct work_struct *work);
+static DECLARE_WORK(nf_conntrack_hash_grow_work, nf_conntrack_hash_grow);
+
 static void nf_conntrack_double_unlock(unsigned int h1, unsigned int h2)
 {
 	h1 %= CONNTRACK_LOCKS;
@@ -305,6 +333,34 @@ static void nf_ct_del_from_dying_or_unconfirmed_list(struct nf_conn *ct)
 void (*delete_sfe_entry)(struct nf_conn *ct) __rcu __read_mostly;
 EXPORT_SYMBOL(delete_sfe_entry);
 
+static inline unsigned int nf_ct_pcpu_cache_slot(u32 hash)
+{
+	return hash % NF_CT_PCPU_CACHE_SIZE;
+}
+
+/*
+ * Only assured TCP conntracks are cached, see resolve_normal_ct(); the
+ * ASSURED bit is never cleared, so those are the only ones to look for.
+ * No new entry can point at @ct: that takes a reference, and it has none.
+ */
+static void nf_ct_pcpu_cache_clear(struct nf_conn *ct)
+{
+	struct nf_conntrack_tuple_hash *orig, *reply, *h;
+	struct nf_ct_pcpu_cache *cache;
+	int cpu, i;
+
+	orig = &ct->tuplehash[IP_CT_DIR_ORIGINAL];
+	reply = &ct->tuplehash[IP_CT_DIR_REPLY];
+	for_each_possible_cpu(cpu) {
+		cache = per_cpu_ptr(&nf_ct_pcpu_cache, cpu);
+		for (i = 0; i < NF_CT_PCPU_CACHE_SIZE; i++) {
+			h = ACCESS_ONCE(cache->h[i]);
+			if (h == orig || h == reply)
+				cmpxchg(&cache->h[i], h, NULL);
+		}
+	}
+}
+
 static void
 destroy_conntrack(struct nf_conntrack *nfct)
 {
@@ -320,6 +376,10 @@ destroy_conntrack(struct nf_conntrack *nfct)
 	NF_CT_ASSERT(atomic_read(&nfct->use) == 0);
 	NF_CT_ASSERT(!timer_pending(&ct->timeout));
 
+	if (nf_ct_protonum(ct) == IPPROTO_TCP &&
+	    test_bit(IPS_ASSURED_BIT, &ct->status))
+		nf_ct_pcpu_cache_clear(ct);
+
 	if (ct->sfe_entry != NULL) {
 		delete_entry = rcu_dereference(delete_sfe_entry);
 		if (delete_entry)
@@ -545,6 +605,42 @@ nf_conntrack_find_get(struct net *net, u16 zone,
 }
 EXPORT_SYMBOL_GPL(nf_conntrack_find_get);
 
+/* Same contract as __nf_conntrack_find_get(), from this cpu's cache */
+static struct nf_conntrack_tuple_hash *
+nf_ct_pcpu_cache_find_get(struct net *net, u16 zone,
+			  const struct nf_conntrack_tuple *tuple, u32 hash)
+{
+	struct nf_conntrack_tuple_hash *h;
+	struct nf_conn *ct;
+
+	rcu_read_lock();
+	h = this_cpu_read(nf_ct_pcpu_cache.h[nf_ct_pcpu_cache_slot(hash)]);
+	if (!h)
+		goto out;
+
+	ct = nf_ct_tuplehash_to_ctrack(h);
+	if (unlikely(nf_ct_is_dying(ct) ||
+		     !atomic_inc_not_zero(&ct->ct_general.use))) {
+		h = NULL;
+		goto out;
+	}
+	/* The conntrack may have been freed and reused meanwhile */
+	if (unlikely(!net_eq(nf_ct_net(ct), net) ||
+		     !nf_ct_key_equal(h, tuple, zone))) {
+		nf_ct_put(ct);
+		h = NULL;
+	}
+out:
+	rcu_read_unlock();
+	return h;
+}
+
+/* The caller holds a reference on the conntrack of @h */
+static void nf_ct_pcpu_cache_set(struct nf_conntrack_tuple_hash *h, u32 hash)
+{
+	this_cpu_write(nf_ct_pcpu_cache.h[nf_ct_pcpu_cache_slot(hash)], h);
+}
+
 static void __nf_conntrack_hash_insert(struct nf_conn *ct,
 				       unsigned int hash,
 				       unsigned int reply_hash)
@@ -862,6 +958,31 @@ void init_nf_conntrack_hash_rnd(void)
 	cmpxchg(&nf_conntrack_hash_rnd, 0, rand);
 }
 
+static unsigned int nf_conntrack_hash_grow_limit(void)
+{
+	unsigned int limit = NF_CT_HASH_GROW_MAX;
+
+	/* No point in having more buckets than conntracks */
+	if (nf_conntrack_max)
+		limit = min_t(unsigned int, limit, nf_conntrack_max);
+	return limit;
+}
+
+static void nf_conntrack_hash_check_grow(struct net *net)
+{
+	unsigned int size = net->ct.htable_size;
+	unsigned int count;
+
+	/* Only the init_net table can be resized, see hashsize */
+	if (!nf_conntrack_hash_autogrow || !net_eq(net, &init_net))
+		return;
+
+	count = atomic_read(&net->ct.count);
+	if (unlikely(count > NF_CT_HASH_GROW_LOAD * size) &&
+	    size < nf_conntrack_hash_grow_limit())
+		schedule_work(&nf_conntrack_hash_grow_work);
+}
+
 static struct nf_conn *
 __nf_conntrack_alloc(struct net *net, u16 zone,
 		     const struct nf_conntrack_tuple *orig,
@@ -881,11 +1002,13 @@ __nf_conntrack_alloc(struct net *net, u16 zone,
 
 	/* We don't want any race condition at early drop stage */
 	atomic_inc(&net->ct.count);
+	nf_conntrack_hash_check_grow(net);
 
 	if (nf_conntrack_max &&
 	    unlikely(atomic_read(&net->ct.count) > nf_conntrack_max)) {
 		if (!early_drop(net, hash)) {
 			atomic_dec(&net->ct.count);
+			NF_CT_STAT_INC_ATOMIC(net, table_full);
 			net_warn_ratelimited("nf_conntrack: table full, dropping packet\n");
 			return ERR_PTR(-ENOMEM);
 		}
@@ -1130,7 +1253,23 @@ resolve_normal_ct(struct net *net, struct nf_conn *tmpl,
 
 	/* look for tuple match */
 	hash = hash_conntrack_raw(&tuple, zone);
-	h = __nf_conntrack_find_get(net, zone, &tuple, hash);
+	h = NULL;
+	if (protonum == IPPROTO_TCP) {
+		h = nf_ct_pcpu_cache_find_get(net, zone, &tuple, hash);
+		if (h)
+			NF_CT_STAT_INC_ATOMIC(net, cache_hit);
+	}
+	if (!h) {
+		h = __nf_conntrack_find_get(net, zone, &tuple, hash);
+		/*
+		 * Established flows are what the cache is for; caching the
+		 * rest would mostly evict them.
+		 */
+		if (h && protonum == IPPROTO_TCP &&
+		    test_bit(IPS_ASSURED_BIT,
+			     &nf_ct_tuplehash_to_ctrack(h)->status))
+			nf_ct_pcpu_cache_set(h, hash);
+	}
 	if (!h) {
 		h = init_conntrack(net, tmpl, &tuple, l3proto, l4proto,
 				   skb, dataoff, hash);
@@ -1630,6 +1769,7 @@ i_see_dead_people:
 		goto i_see_dead_people;
 	}
 
+	cancel_work_sync(&nf_conntrack_hash_grow_work);
 	list_for_each_entry(net, net_exit_list, exit_list) {
 		nf_ct_free_hashtable(net->ct.hash, net->ct.htable_size);
 		nf_conntrack_proto_pernet_fini(net);
@@ -1669,27 +1809,15 @@ void *nf_ct_alloc_hashtable(unsigned int *sizep, int nulls)
 }
 EXPORT_SYMBOL_GPL(nf_ct_alloc_hashtable);
 
-int nf_conntrack_set_hashsize(const char *val, struct kernel_param *kp)
+/* Rehash the init_net conntracks into a new table of @hashsize buckets */
+static int nf_conntrack_hash_resize(unsigned int hashsize)
 {
-	int i, bucket, rc;
-	unsigned int hashsize, old_size;
+	int i, bucket;
+	unsigned int old_size;
 	struct hlist_nulls_head *hash, *old_hash;
 	struct nf_conntrack_tuple_hash *h;
 	struct nf_conn *ct;
 
-	if (current->nsproxy->net_ns != &init_net)
-		return -EOPNOTSUPP;
-
-	/* On boot, we can set this without any fancy locking. */
-	if (!nf_conntrack_htable_size)
-		return param_set_uint(val, kp);
-
-	rc = kstrtouint(val, 0, &hashsize);
-	if (rc)
-		return rc;
-	if (!hashsize)
-		return -EINVAL;
-
 	hash = nf_ct_alloc_hashtable(&hashsize, 1);
 	if (!hash)
 		return -ENOMEM;
@@ -1725,13 +1853,53 @@ int nf_conntrack_set_hashsize(const char *val, struct kernel_param *kp)
 	nf_conntrack_all_unlock();
 	local_bh_enable();
 
+	/* Wait for the lookups still walking the old table */
+	synchronize_net();
 	nf_ct_free_hashtable(old_hash, old_size);
 	return 0;
 }
+
+static void nf_conntrack_hash_grow(struct work_struct *work)
+{
+	unsigned int size = init_net.ct.htable_size;
+	unsigned int limit = nf_conntrack_hash_grow_limit();
+
+	if (size >= limit ||
+	    atomic_read(&init_net.ct.count) <= NF_CT_HASH_GROW_LOAD * size)
+		return;
+
+	if (!nf_conntrack_hash_resize(min(size * 2, limit))) {
+		NF_CT_STAT_INC_ATOMIC(&init_net, hash_grow);
+		pr_info("nf_conntrack: grew hash table to %u buckets\n",
+			init_net.ct.htable_size);
+	}
+}
+
+int nf_conntrack_set_hashsize(const char *val, struct kernel_param *kp)
+{
+	int rc;
+	unsigned int hashsize;
+
+	if (current->nsproxy->net_ns != &init_net)
+		return -EOPNOTSUPP;
+
+	/* On boot, we can set this without any fancy locking. */
+	if (!nf_conntrack_htable_size)
+		return param_set_uint(val, kp);
+
+	rc = kstrtouint(val, 0, &hashsize);
+	if (rc)
+		return rc;
+	if (!hashsize)
+		return -EINVAL;
+
+	return nf_conntrack_hash_resize(hashsize);
+}
 EXPORT_SYMBOL_GPL(nf_conntrack_set_hashsize);
 
 module_param_call(hashsize, nf_conntrack_set_hashsize, param_get_uint,
 		  &nf_conntrack_htable_size, 0600);
+module_param_named(hash_autogrow, nf_conntrack_hash_autogrow, bool, 0600);
 
 void nf_ct_untracked_status_or(unsigned long bits)
 {
@@ -15,6 +15,7 @@
 #define DEBUG
 
 #include <linux/file.h>
+#include <linux/hash.h>
 #include <linux/inetdevice.h>
 #include <linux/module.h>
 #include <linux/netfilter/x_tables.h>
@@ -139,6 +140,31 @@ static DEFINE_SPINLOCK(uid_tag_data_tree_lock);
 static struct rb_root proc_qtu_data_tree = RB_ROOT;
 /* No proc_qtu_data_tree_lock; use uid_tag_data_tree_lock */
 
+/*
+ * Per cpu cache of the tag_stat (and active counter set) that the last
+ * packets of a {net_dev, sk, uid} got billed to, so that most packets skip
+ * the iface/sock_tag/counter_set/tag_stat lookups and all of their locks.
+ * An entry is only used while its gen matches tag_stat_cache_gen, which is
+ * bumped by anything that could change the outcome of those lookups.
+ */
+#define TAG_STAT_CACHE_BITS 4
+
+struct tag_stat_cache_entry {
+	const struct net_device *net_dev;
+	const struct sock *sk;  /* Only used as a number, never dereferenced */
+	uid_t uid;
+	int active_set;
+	unsigned int gen;
+	struct tag_stat *ts;
+};
+
+struct tag_stat_cache {
+	struct tag_stat_cache_entry ent[1 << TAG_STAT_CACHE_BITS];
+};
+
+static DEFINE_PER_CPU(struct tag_stat_cache, tag_stat_cache);
+static atomic_t tag_stat_cache_gen = ATOMIC_INIT(1);
+
 static struct qtaguid_event_counts qtu_events;
 /*----------------------------------------------*/
 static bool can_manipulate_uids(void)
@@ -163,6 +189,16 @@ static bool can_read_other_uid_stats(kuid_t uid)
 		|| unlikely(uid_eq(current_fsuid(), xt_qtaguid_ctrl_file->uid));
 }
 
+/*
+ * Called after an update of the iface list, the sock tags, the counter sets
+ * or the tag_stat trees, so that no cpu keeps billing to what it cached.
+ */
+static void tag_stat_cache_invalidate(void)
+{
+	smp_mb__before_atomic();
+	atomic_inc(&tag_stat_cache_gen);
+}
+
 static inline void dc_add_byte_packets(struct data_counters *counters, int set,
 				  enum ifs_tx_rx direction,
 				  enum ifs_proto ifs_proto,
@@ -634,7 +670,7 @@ static int get_active_counter_set(tag_t tag)
 
 /*
  * Find the entry for tracking the specified interface.
- * Caller must hold iface_stat_list_lock
+ * Caller must hold iface_stat_list_lock or rcu_read_lock().
  */
 static struct iface_stat *get_iface_entry(const char *ifname)
 {
@@ -647,7 +683,7 @@ static struct iface_stat *get_iface_entry(const char *ifname)
 	}
 
 	/* Iterate over interfaces */
-	list_for_each_entry(iface_entry, &iface_stat_list, list) {
+	list_for_each_entry_rcu(iface_entry, &iface_stat_list, list) {
 		if (!strcmp(ifname, iface_entry->ifname))
 			goto done;
 	}
@@ -885,7 +921,7 @@ static struct iface_stat *iface_alloc(struct net_device *net_dev)
 	isw->iface_entry = new_iface;
 	INIT_WORK(&isw->iface_work, iface_create_proc_worker);
 	schedule_work(&isw->iface_work);
-	list_add(&new_iface->list, &iface_stat_list);
+	list_add_rcu(&new_iface->list, &iface_stat_list);
 	return new_iface;
 }
 
@@ -1231,22 +1267,40 @@ static void iface_stat_update_from_skb(const struct sk_buff *skb,
 	spin_unlock_bh(&iface_stat_list_lock);
 }
 
-static void tag_stat_update(struct tag_stat *tag_entry,
+/* Bill the local cpu's counters; BH is off in the xt table walk. */
+static void tag_stat_pcpu_update(struct tag_stat *tag_entry, int active_set,
+				 enum ifs_tx_rx direction, int proto,
+				 int bytes)
+{
+	struct tag_stat_pcpu *pcpu = this_cpu_ptr(tag_entry->pcpu);
+
+	u64_stats_update_begin(&pcpu->syncp);
+	data_counters_update(&pcpu->counters, active_set, direction, proto,
+			     bytes);
+	u64_stats_update_end(&pcpu->syncp);
+}
+
+static void tag_stat_update(struct tag_stat *tag_entry, int active_set,
 			enum ifs_tx_rx direction, int proto, int bytes)
 {
-	int active_set;
-	active_set = get_active_counter_set(tag_entry->tn.tag);
 	MT_DEBUG("qtaguid: tag_stat_update(tag=0x%llx (uid=%u) set=%d "
 		 "dir=%d proto=%d bytes=%d)\n",
 		 tag_entry->tn.tag, get_uid_from_tag(tag_entry->tn.tag),
 		 active_set, direction, proto, bytes);
-	data_counters_update(&tag_entry->counters, active_set, direction,
-			     proto, bytes);
-	if (tag_entry->parent_counters)
-		data_counters_update(tag_entry->parent_counters, active_set,
+	tag_stat_pcpu_update(tag_entry, active_set, direction, proto, bytes);
+	if (tag_entry->parent)
+		tag_stat_pcpu_update(tag_entry->parent, active_set,
 				     direction, proto, bytes);
 }
 
+static void tag_stat_free_rcu(struct rcu_head *head)
+{
+	struct tag_stat *ts_entry = container_of(head, struct tag_stat, rcu);
+
+	free_percpu(ts_entry->pcpu);
+	kfree(ts_entry);
+}
+
 /*
  * Create a new entry for tracking the specified {acct_tag,uid_tag} within
  * the interface.
@@ -1256,6 +1310,8 @@ static struct tag_stat *create_if_tag_stat(struct iface_stat *iface_entry,
 					   tag_t tag)
 {
 	struct tag_stat *new_tag_stat_entry = NULL;
+	int cpu;
+
 	IF_DEBUG("qtaguid: iface_stat: %s(): ife=%p tag=0x%llx"
 		 " (uid=%u)\n", __func__,
 		 iface_entry, tag, get_uid_from_tag(tag));
@@ -1264,34 +1320,55 @@ static struct tag_stat *create_if_tag_stat(struct iface_stat *iface_entry,
 		pr_err("qtaguid: iface_stat: tag stat alloc failed\n");
 		goto done;
 	}
+	new_tag_stat_entry->pcpu = alloc_percpu_gfp(struct tag_stat_pcpu,
+						    GFP_ATOMIC);
+	if (!new_tag_stat_entry->pcpu) {
+		pr_err("qtaguid: iface_stat: tag stat counters alloc failed\n");
+		kfree(new_tag_stat_entry);
+		new_tag_stat_entry = NULL;
+		goto done;
+	}
+	for_each_possible_cpu(cpu)
+		u64_stats_init(&per_cpu_ptr(new_tag_stat_entry->pcpu,
+					    cpu)->syncp);
 	new_tag_stat_entry->tn.tag = tag;
 	tag_stat_tree_insert(new_tag_stat_entry, &iface_entry->tag_stat_tree);
 done:
 	return new_tag_stat_entry;
 }
 
-static void if_tag_stat_update(const char *ifname, uid_t uid,
-			       const struct sock *sk, enum ifs_tx_rx direction,
-			       int proto, int bytes)
+static struct tag_stat_cache_entry *
+tag_stat_cache_slot(const struct net_device *net_dev, const struct sock *sk,
+		    uid_t uid)
+{
+	unsigned long key = (unsigned long)net_dev ^ (unsigned long)sk ^ uid;
+
+	return &this_cpu_ptr(&tag_stat_cache)->ent[hash_long(key,
+						TAG_STAT_CACHE_BITS)];
+}
+
+/*
+ * Find, or create, the tag_stat to bill for the socket/uid on the interface.
+ * Called under rcu_read_lock(); returns NULL if the interface is not tracked
+ * or on allocation failure.
+ */
+static struct tag_stat *if_tag_stat_lookup(const char *ifname, uid_t uid,
+					   const struct sock *sk,
+					   tag_t *tagp)
 {
 	struct tag_stat *tag_stat_entry;
 	tag_t tag, acct_tag;
 	tag_t uid_tag;
-	struct data_counters *uid_tag_counters;
+	struct tag_stat *uid_tag_stat;
 	struct sock_tag *sock_tag_entry;
 	struct iface_stat *iface_entry;
 	struct tag_stat *new_tag_stat = NULL;
-	MT_DEBUG("qtaguid: if_tag_stat_update(ifname=%s "
-		"uid=%u sk=%p dir=%d proto=%d bytes=%d)\n",
-		 ifname, uid, sk, direction, proto, bytes);
 
-	spin_lock_bh(&iface_stat_list_lock);
 	iface_entry = get_iface_entry(ifname);
 	if (!iface_entry) {
 		pr_err_ratelimited("qtaguid: tag_stat: stat_update() "
 				   "%s not found\n", ifname);
-		spin_unlock_bh(&iface_stat_list_lock);
-		return;
+		return NULL;
 	}
 	/* It is ok to process data when an iface_entry is inactive */
 
@@ -1315,6 +1392,7 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 		tag = combine_atag_with_uid(acct_tag, uid);
 		uid_tag = make_tag_from_uid(uid);
 	}
+	*tagp = tag;
 	MT_DEBUG("qtaguid: tag_stat: stat_update(): "
 		 " looking for tag=0x%llx (uid=%u) in ife=%p\n",
 		 tag, get_uid_from_tag(tag), iface_entry);
@@ -1328,7 +1406,7 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 		 * Updating the {acct_tag, uid_tag} entry handles both stats:
 		 * {0, uid_tag} will also get updated.
 		 */
-		tag_stat_update(tag_stat_entry, direction, proto, bytes);
+		new_tag_stat = tag_stat_entry;
 		goto unlock;
 	}
 
@@ -1344,9 +1422,9 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 		new_tag_stat = create_if_tag_stat(iface_entry, uid_tag);
 		if (!new_tag_stat)
 			goto unlock;
-		uid_tag_counters = &new_tag_stat->counters;
+		uid_tag_stat = new_tag_stat;
 	} else {
-		uid_tag_counters = &tag_stat_entry->counters;
+		uid_tag_stat = tag_stat_entry;
 	}
 
 	if (acct_tag) {
@@ -1354,7 +1432,7 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 		new_tag_stat = create_if_tag_stat(iface_entry, tag);
 		if (!new_tag_stat)
 			goto unlock;
-		new_tag_stat->parent_counters = uid_tag_counters;
+		new_tag_stat->parent = uid_tag_stat;
 	} else {
 		/*
 		 * For new_tag_stat to be still NULL here would require:
@@ -1366,16 +1444,63 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 		 */
 		BUG_ON(!new_tag_stat);
 	}
-	tag_stat_update(new_tag_stat, direction, proto, bytes);
 unlock:
 	spin_unlock_bh(&iface_entry->tag_stat_list_lock);
-	spin_unlock_bh(&iface_stat_list_lock);
+	return new_tag_stat;
+}
+
+static void if_tag_stat_update(const struct net_device *net_dev, uid_t uid,
+			       const struct sock *sk, enum ifs_tx_rx direction,
+			       int proto, int bytes)
+{
+	struct tag_stat_cache_entry *cache;
+	struct tag_stat *tag_stat_entry;
+	unsigned int gen;
+	int active_set;
+	tag_t tag;
+
+	MT_DEBUG("qtaguid: if_tag_stat_update(ifname=%s "
+		"uid=%u sk=%p dir=%d proto=%d bytes=%d)\n",
+		 net_dev->name, uid, sk, direction, proto, bytes);
+
+	/*
+	 * tag_stats are freed after a grace period, which is what keeps a
+	 * cached one around for as long as we use it.
+	 */
+	rcu_read_lock();
+	gen = atomic_read(&tag_stat_cache_gen);
+	cache = tag_stat_cache_slot(net_dev, sk, uid);
+	if (cache->gen == gen && cache->net_dev == net_dev &&
+	    cache->sk == sk && cache->uid == uid) {
+		tag_stat_update(cache->ts, cache->active_set, direction,
+				proto, bytes);
+		goto out;
+	}
+	/* Don't let the lookups below see state older than gen. */
+	smp_rmb();
+
+	tag_stat_entry = if_tag_stat_lookup(net_dev->name, uid, sk, &tag);
+	if (!tag_stat_entry)
+		goto out;
+	active_set = get_active_counter_set(tag);
+	tag_stat_update(tag_stat_entry, active_set, direction, proto, bytes);
+
+	cache->net_dev = net_dev;
+	cache->sk = sk;
+	cache->uid = uid;
+	cache->active_set = active_set;
+	cache->ts = tag_stat_entry;
+	cache->gen = gen;
+out:
+	rcu_read_unlock();
 }
 
 static int iface_netdev_event_handler(struct notifier_block *nb,
 				      unsigned long event, void *ptr) {
 	struct net_device *dev = netdev_notifier_info_to_dev(ptr);
 
+	/* Cached entries are keyed on net_dev, which could go away */
+	tag_stat_cache_invalidate();
 	if (unlikely(module_passive))
 		return NOTIFY_DONE;
 
@@ -1403,6 +1528,8 @@ static int iface_inet6addr_event_handler(struct notifier_block *nb,
 	struct inet6_ifaddr *ifa = ptr;
 	struct net_device *dev;
 
+	/* Cached entries are keyed on net_dev, which could go away */
+	tag_stat_cache_invalidate();
 	if (unlikely(module_passive))
 		return NOTIFY_DONE;
 
@@ -1434,6 +1561,8 @@ static int iface_inetaddr_event_handler(struct notifier_block *nb,
 	struct in_ifaddr *ifa = ptr;
 	struct net_device *dev;
 
+	/* Cached entries are keyed on net_dev, which could go away */
+	tag_stat_cache_invalidate();
 	if (unlikely(module_passive))
 		return NOTIFY_DONE;
 
@@ -1625,7 +1754,7 @@ static void account_for_uid(const struct sk_buff *skb,
 		 par->hooknum, el_dev->name, el_dev->type,
 		 par->family, proto, direction);
 
-	if_tag_stat_update(el_dev->name, uid,
+	if_tag_stat_update(el_dev, uid,
 			   skb->sk ? skb->sk : alternate_sk,
 			   direction,
 			   proto, skb->len);
@@ -2041,6 +2170,7 @@ static int ctrl_cmd_delete(const char *input)
 	}
 	spin_unlock_bh(&uid_tag_data_tree_lock);
 	spin_unlock_bh(&sock_tag_list_lock);
+	tag_stat_cache_invalidate();
 
 	sock_tag_tree_erase(&st_to_free_tree);
 
@@ -2087,7 +2217,13 @@ static int ctrl_cmd_delete(const char *input)
 					 entry_uid);
 				rb_erase(&ts_entry->tn.node,
 					 &iface_entry->tag_stat_tree);
-				kfree(ts_entry);
+				/*
+				 * Stop new cache hits on it before queueing
+				 * the free: the packet path might still be
+				 * billing to it until the grace period ends.
+				 */
+				tag_stat_cache_invalidate();
+				call_rcu(&ts_entry->rcu, tag_stat_free_rcu);
 			}
 		}
 		spin_unlock_bh(&iface_entry->tag_stat_list_lock);
@@ -2176,6 +2312,7 @@ static int ctrl_cmd_counter_set(const char *input)
 	}
 	tcs->active_set = counter_set;
 	spin_unlock_bh(&tag_counter_set_list_lock);
+	tag_stat_cache_invalidate();
 	atomic64_inc(&qtu_events.counter_set_changes);
 	res = 0;
 
@@ -2321,6 +2458,7 @@ static int ctrl_cmd_tag(const char *input)
 	}
 	spin_unlock_bh(&uid_tag_data_tree_lock);
 	spin_unlock_bh(&sock_tag_list_lock);
+	tag_stat_cache_invalidate();
 	/* We keep the ref to the sk until it is untagged */
 	CT_DEBUG("qtaguid: ctrl_tag(%s): done st@%pk ...->sk_refcnt=%d\n",
 		 input, sock_tag_entry,
@@ -2428,6 +2566,7 @@ int qtaguid_untag(struct socket *el_socket, bool kernel)
 	 */
 	tag_ref_entry->num_sock_tags--;
 	spin_unlock_bh(&sock_tag_list_lock);
+	tag_stat_cache_invalidate();
 	/*
 	 * Release the sock_fd that was grabbed at tag time.
 	 */
@@ -2522,10 +2661,9 @@ static void pp_stats_header(struct seq_file *m)
 }
 
 static int pp_stats_line(struct seq_file *m, struct tag_stat *ts_entry,
-			 int cnt_set)
+			 struct data_counters *cnts, int cnt_set)
 {
 	int ret;
-	struct data_counters *cnts;
 	tag_t tag = ts_entry->tn.tag;
 	uid_t stat_uid = get_uid_from_tag(tag);
 	struct proc_print_info *ppi = m->private;
@@ -2541,7 +2679,6 @@ static int pp_stats_line(struct seq_file *m, struct tag_stat *ts_entry,
 		return 0;
 	}
 	ppi->item_index++;
-	cnts = &ts_entry->counters;
 	ret = seq_printf(m, "%d %s 0x%llx %u %u "
 		"%llu %llu "
 		"%llu %llu "
@@ -2577,11 +2714,14 @@ static int pp_stats_line(struct seq_file *m, struct tag_stat *ts_entry,
 
 static bool pp_sets(struct seq_file *m, struct tag_stat *ts_entry)
 {
+	struct data_counters cnts;
 	int ret;
 	int counter_set;
+
+	tag_stat_fold(ts_entry, &cnts);
 	for (counter_set = 0; counter_set < IFS_MAX_COUNTER_SETS;
 	     counter_set++) {
-		ret = pp_stats_line(m, ts_entry, counter_set);
+		ret = pp_stats_line(m, ts_entry, &cnts, counter_set);
 		if (ret < 0)
 			return false;
 	}
@@ -2865,7 +3005,7 @@ static int qtudev_release(struct inode *inode, struct file *file)
 
 	spin_unlock_bh(&uid_tag_data_tree_lock);
 	spin_unlock_bh(&sock_tag_list_lock);
-
+	tag_stat_cache_invalidate();
 
 	sock_tag_tree_erase(&st_to_free_tree);
 
@@ -11,8 +11,12 @@
 #define __XT_QTAGUID_INTERNAL_H__
 
 #include <linux/types.h>
+#include <linux/percpu.h>
 #include <linux/rbtree.h>
+#include <linux/rcupdate.h>
 #include <linux/spinlock_types.h>
+#include <linux/string.h>
+#include <linux/u64_stats_sync.h>
 #include <linux/workqueue.h>
 
 /* Iface handling */
@@ -204,18 +208,57 @@ struct tag_node {
 	tag_t tag;
 };
 
+/* The share of a tag_stat's counters billed on one cpu */
+struct tag_stat_pcpu {
+	struct data_counters counters;
+	struct u64_stats_sync syncp;
+};
+
 struct tag_stat {
 	struct tag_node tn;
-	struct data_counters counters;
+	/*
+	 * Only ever updated on the local cpu, so the packet path needs no
+	 * lock; readers fold them with tag_stat_fold().
+	 */
+	struct tag_stat_pcpu __percpu *pcpu;
 	/*
 	 * If this tag is acct_tag based, we need to count against the
 	 * matching parent uid_tag.
 	 */
-	struct data_counters *parent_counters;
+	struct tag_stat *parent;
+	/* tag_stats are freed after a grace period, see ctrl_cmd_delete() */
+	struct rcu_head rcu;
 };
 
+static inline void tag_stat_fold(struct tag_stat *ts,
+				 struct data_counters *counters)
+{
+	struct byte_packet_counters *dst, *src;
+	struct tag_stat_pcpu *pcpu;
+	struct data_counters snap;
+	unsigned int start, i;
+	int cpu;
+
+	memset(counters, 0, sizeof(*counters));
+	for_each_possible_cpu(cpu) {
+		pcpu = per_cpu_ptr(ts->pcpu, cpu);
+		do {
+			start = u64_stats_fetch_begin_irq(&pcpu->syncp);
+			snap = pcpu->counters;
+		} while (u64_stats_fetch_retry_irq(&pcpu->syncp, start));
+
+		dst = &counters->bpc[0][0][0];
+		src = &snap.bpc[0][0][0];
+		for (i = 0; i < sizeof(snap) / sizeof(*src); i++) {
+			dst[i].bytes += src[i].bytes;
+			dst[i].packets += src[i].packets;
+		}
+	}
+}
+
 struct iface_stat {
-	struct list_head list;  /* in iface_stat_list */
+	/* in iface_stat_list, entries are never removed from it */
+	struct list_head list;
 	char *ifname;
 	bool active;
 	/* net_dev is only valid for active iface_stat */
@@ -21,6 +21,8 @@
  * cache eviction are simple, linear and based on last usage timestamp, i.e
  * the node that will be evicted is the one with the oldest timestamp.
  * Empty entries always have the oldest timestamp.
+ * Hit/miss/eviction counters are exported in debugfs as pfk_kc_stats,
+ * writing to the file resets them.
  */
 
 #include <linux/mutex.h>
@@ -31,6 +33,9 @@
 #include <linux/jiffies.h>
 #include <linux/slab.h>
 #include <linux/printk.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/math64.h>
 
 #include "pfk_kc.h"
 #include "pfk_ice.h"
@@ -109,6 +114,23 @@ struct kc_entry {
 
 static struct kc_entry kc_table[PFK_KC_TABLE_SIZE];
 
+/*
+ * Key cache statistics, protected by kc_lock. A lookup done from atomic
+ * context that misses is only counted as deferred, the retry from
+ * process context accounts for the actual miss.
+ */
+struct kc_stats {
+	u64 hits;
+	u64 misses;
+	u64 deferred;
+	u64 evictions;
+	u64 busy;
+	u64 scm_errors;
+};
+
+static struct kc_stats kc_stats;
+static struct dentry *kc_debugfs;
+
 /**
  * kc_is_ready() - driver is initialized and ready.
  *
@@ -411,6 +433,58 @@ static int kc_update_entry(struct kc_entry *entry, const unsigned char *key,
 	return ret;
 }
 
+static int kc_stats_show(struct seq_file *m, void *unused)
+{
+	struct kc_stats stats;
+	u64 lookups;
+	u32 permille;
+	int i, used = 0;
+
+	kc_spin_lock();
+	stats = kc_stats;
+	for (i = 0; i < PFK_KC_TABLE_SIZE; i++)
+		if (kc_entry_at_index(i)->state != FREE)
+			used++;
+	kc_spin_unlock();
+
+	lookups = stats.hits + stats.misses;
+	permille = lookups ? div64_u64(stats.hits * 1000, lookups) : 0;
+
+	seq_printf(m, "slots:      %d/%d\n", used, PFK_KC_TABLE_SIZE);
+	seq_printf(m, "hits:       %llu\n", stats.hits);
+	seq_printf(m, "misses:     %llu\n", stats.misses);
+	seq_printf(m, "hit rate:   %u.%u%%\n", permille / 10, permille % 10);
+	seq_printf(m, "evictions:  %llu\n", stats.evictions);
+	seq_printf(m, "deferred:   %llu\n", stats.deferred);
+	seq_printf(m, "busy:       %llu\n", stats.busy);
+	seq_printf(m, "scm errors: %llu\n", stats.scm_errors);
+
+	return 0;
+}
+
+static int kc_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, kc_stats_show, NULL);
+}
+
+static ssize_t kc_stats_write(struct file *file, const char __user *buf,
+		size_t count, loff_t *ppos)
+{
+	kc_spin_lock();
+	memset(&kc_stats, 0, sizeof(kc_stats));
+	kc_spin_unlock();
+
+	return count;
+}
+
+static const struct file_operations kc_stats_fops = {
+	.open = kc_stats_open,
+	.read = seq_read,
+	.write = kc_stats_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 /**
  * pfk_kc_init() - init function
  *
@@ -426,9 +500,16 @@ int pfk_kc_init(void)
 		entry = kc_entry_at_index(i);
 		entry->key_index = PFK_KC_STARTING_INDEX + i;
 	}
+	memset(&kc_stats, 0, sizeof(kc_stats));
 	kc_ready = true;
 	kc_spin_unlock();
 
+	/* statistics are optional, don't fail init over them */
+	kc_debugfs = debugfs_create_file("pfk_kc_stats", S_IRUSR | S_IWUSR,
+			NULL, NULL, &kc_stats_fops);
+	if (IS_ERR(kc_debugfs))
+		kc_debugfs = NULL;
+
 	return 0;
 }
 
@@ -442,6 +523,9 @@ int pfk_kc_deinit(void)
 	int res = pfk_kc_clear();
 	kc_ready = false;
 
+	debugfs_remove(kc_debugfs);
+	kc_debugfs = NULL;
+
 	return res;
 }
 
@@ -498,6 +582,7 @@ int pfk_kc_load_key_start(const unsigned char *key, size_t key_size,
 	entry = kc_find_key(key, key_size, salt, salt_size);
 	if (!entry) {
 		if (async) {
+			kc_stats.deferred++;
 			kc_spin_unlock();
 			return -EAGAIN;
 		}
@@ -508,11 +593,18 @@ int pfk_kc_load_key_start(const unsigned char *key, size_t key_size,
 			 * return EBUSY to upper layers so that the
 			 * request will be rescheduled
 			 */
+			kc_stats.busy++;
 			kc_spin_unlock();
 			return -EBUSY;
 		}
+		kc_stats.misses++;
+		if (entry->state == INACTIVE)
+			kc_stats.evictions++;
 	} else {
 		entry_exists = true;
+		if (entry->state == INACTIVE ||
+		    entry->state == ACTIVE_ICE_LOADED)
+			kc_stats.hits++;
 	}
 
 	pr_debug("entry with index %d is in state %d\n",
@@ -530,6 +622,7 @@ int pfk_kc_load_key_start(const unsigned char *key, size_t key_size,
 		if (ret) {
 			entry->state = SCM_ERROR;
 			entry->scm_error = ret;
+			kc_stats.scm_errors++;
 			pr_err("%s: key load error (%d)\n", __func__, ret);
 		} else {
 			entry->state = ACTIVE_ICE_LOADED;